@@ -74,6 +74,36 @@ __FBSDID("$FreeBSD$");
  */
 #define BUFSIZE_SMALL (MAXPHYS)
 
+/*
+ * Copy a regular file with copy_file_range(2), so the data does not pass
+ * through user space.  Returns -1, having copied nothing, if the kernel
+ * cannot copy between these files; 0 on success and 1 after an error.
+ */
+static int
+copy_range(int from_fd, int to_fd, const FTSENT *entp)
+{
+	ssize_t wcount;
+	off_t wtotal;
+
+	wtotal = 0;
+	while ((wcount = copy_file_range(from_fd, NULL, to_fd, NULL,
+	    SSIZE_MAX, 0)) > 0) {
+		wtotal += wcount;
+		if (info) {
+			info = 0;
+			(void)fprintf(stderr, "%s -> %s %3d%%\n",
+			    entp->fts_path, to.p_path,
+			    cp_pct(wtotal, entp->fts_statp->st_size));
+		}
+	}
+	if (wcount == 0)
+		return (0);
+	if (wtotal == 0 && errno == EINVAL)
+		return (-1);
+	warn("%s", to.p_path);
+	return (1);
+}
+
 int
 copy_file(const FTSENT *entp, int dne)
 {
@@ -83,7 +113,7 @@ copy_file(const FTSENT *entp, int dne)
 	ssize_t wcount;
 	size_t wresid;
 	off_t wtotal;
-	int ch, checkch, from_fd, rcount, rval, to_fd;
+	int ch, checkch, from_fd, rcount, rval, to_fd, cfr;
 	char *bufp;
 #ifdef VM_AND_BUFFER_CACHE_SYNCHRONIZED
 	char *p;
@@ -156,12 +186,18 @@ copy_file(const FTSENT *entp, int dne)
 
 	if (!lflag && !sflag) {
 		/*
-		 * Mmap and write if less than 8M (the limit is so we don't
+		 * Let the kernel copy regular files where it can.  Otherwise,
+		 * mmap and write if less than 8M (the limit is so we don't
 		 * totally trash memory on big files.  This is really a minor
 		 * hack, but it wins some CPU back.
 		 * Some filesystems, such as smbnetfs, don't support mmap,
 		 * so this is a best-effort attempt.
 		 */
+		if (S_ISREG(fs->st_mode) &&
+		    (cfr = copy_range(from_fd, to_fd, entp)) >= 0) {
+			if (cfr != 0)
+				rval = 1;
+		} else
 #ifdef VM_AND_BUFFER_CACHE_SYNCHRONIZED
 		if (S_ISREG(fs->st_mode) && fs->st_size > 0 &&
 		    fs->st_size <= 8 * 1024 * 1024 &&
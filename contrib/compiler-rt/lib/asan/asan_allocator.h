@@ -138,6 +138,12 @@ typedef VeryCompactSizeClassMap SizeClassMap;
 const uptr kAllocatorSpace =  0x10000000000ULL;
 const uptr kAllocatorSize  =  0x10000000000ULL;  // 3T.
 typedef DefaultSizeClassMap SizeClassMap;
+# elif defined(__riscv)
+// The top half of LowMem is the only range below the shadow that exists
+// under both Sv39 and Sv48; mmap(2) on FreeBSD fills the bottom upwards.
+const uptr kAllocatorSpace =  0x0800000000ULL;
+const uptr kAllocatorSize  =  0x0800000000ULL;  // 32G.
+typedef DefaultSizeClassMap SizeClassMap;
 # elif SANITIZER_WINDOWS
 const uptr kAllocatorSpace = ~(uptr)0;
 const uptr kAllocatorSize  =  0x8000000000ULL;  // 500G
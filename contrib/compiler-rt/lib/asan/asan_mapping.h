@@ -115,6 +115,20 @@
 // || `[0x40000000, 0x47ffffff]` || LowShadow  ||
 // || `[0x00000000, 0x3fffffff]` || LowMem     ||
 //
+// Shadow mapping on FreeBSD/riscv64 (Sv39) with SHADOW_OFFSET == 0x1000000000:
+// || `[0x1800000000, 0x3fffffffff]` || HighMem    ||
+// || `[0x1300000000, 0x17ffffffff]` || HighShadow ||
+// || `[0x1200000000, 0x12ffffffff]` || ShadowGap  ||
+// || `[0x1000000000, 0x11ffffffff]` || LowShadow  ||
+// || `[0x0000000000, 0x0fffffffff]` || LowMem     ||
+//
+// Shadow mapping on FreeBSD/riscv64 (Sv48) with SHADOW_OFFSET == 0x1000000000:
+// || `[0x101000000000, 0x7fffffffffff]` || HighMem    ||
+// || `[0x021200000000, 0x100fffffffff]` || HighShadow ||
+// || `[0x001200000000, 0x0211ffffffff]` || ShadowGap  ||
+// || `[0x001000000000, 0x0011ffffffff]` || LowShadow  ||
+// || `[0x000000000000, 0x000fffffffff]` || LowMem     ||
+//
 // Shadow mapping on NetBSD/x86-64 with SHADOW_OFFSET == 0x400000000000:
 // || `[0x4feffffffe01, 0x7f7ffffff000]` || HighMem    ||
 // || `[0x49fdffffffc0, 0x4feffffffe00]` || HighShadow ||
@@ -152,6 +166,7 @@ static const u64 kPPC64_ShadowOffset64 = 1ULL << 44;
 static const u64 kSystemZ_ShadowOffset64 = 1ULL << 52;
 static const u64 kFreeBSD_ShadowOffset32 = 1ULL << 30;  // 0x40000000
 static const u64 kFreeBSD_ShadowOffset64 = 1ULL << 46;  // 0x400000000000
+static const u64 kFreeBSD_RISCV64_ShadowOffset64 = 1ULL << 36;  // 0x1000000000
 static const u64 kNetBSD_ShadowOffset64 = 1ULL << 46;  // 0x400000000000
 static const u64 kWindowsShadowOffset32 = 3ULL << 28;  // 0x30000000
 
@@ -190,6 +205,8 @@ static const u64 kWindowsShadowOffset32 = 3ULL << 28;  // 0x30000000
 #    define SHADOW_OFFSET kPPC64_ShadowOffset64
 #  elif defined(__s390x__)
 #    define SHADOW_OFFSET kSystemZ_ShadowOffset64
+#  elif SANITIZER_FREEBSD && defined(__riscv)
+#    define SHADOW_OFFSET kFreeBSD_RISCV64_ShadowOffset64
 #  elif SANITIZER_FREEBSD
 #    define SHADOW_OFFSET kFreeBSD_ShadowOffset64
 #  elif SANITIZER_NETBSD
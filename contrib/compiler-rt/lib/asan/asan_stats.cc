@@ -126,8 +126,10 @@ static void PrintAccumulatedStats() {
   BlockingMutexLock lock(&print_lock);
   stats.Print();
   StackDepotStats *stack_depot_stats = StackDepotGetStats();
-  Printf("Stats: StackDepot: %zd ids; %zdM allocated\n",
-         stack_depot_stats->n_uniq_ids, stack_depot_stats->allocated >> 20);
+  Printf("Stats: StackDepot: %zd ids; %zdM allocated; %zd of %zd frames "
+         "stored\n",
+         stack_depot_stats->n_uniq_ids, stack_depot_stats->allocated >> 20,
+         stack_depot_stats->n_stored_frames, stack_depot_stats->n_frames);
   PrintInternalAllocatorStats();
 }
 
@@ -20,7 +20,12 @@
  *  To avoid needing a per-object lock, this code allocates an array of
  *  locks and hashes the object pointers to find the one that it should use.
  *  For operations that must be atomic on two locations, the lower lock is
- *  always acquired first, to avoid deadlock.
+ *  always acquired first, to avoid deadlock.  Each lock has a cache line to
+ *  itself so that unrelated objects do not contend through false sharing.
+ *
+ *  16-byte objects are handled without locks where the hardware has a
+ *  double-word compare-and-swap: CMPXCHG16B on x86-64 (checked at run time,
+ *  via cpu_model.c) and LDXP/STXP on AArch64.
  *
  *===----------------------------------------------------------------------===
  */
@@ -37,14 +42,48 @@
 #pragma redefine_extname __atomic_exchange_c SYMBOL_NAME(__atomic_exchange)
 #pragma redefine_extname __atomic_compare_exchange_c SYMBOL_NAME(__atomic_compare_exchange)
 
-/// Number of locks.  This allocates one page on 32-bit platforms, two on
-/// 64-bit.  This can be specified externally if a different trade between
-/// memory usage and contention probability is required for a given platform.
+/// Number of locks.  Each lock is padded to a cache line, so this allocates
+/// 256KB of zero-filled memory that is only faulted in as locks are touched.
+/// This can be specified externally if a different trade between memory usage
+/// and contention probability is required for a given platform.  It must be
+/// a power of two.
 #ifndef SPINLOCK_COUNT
-#define SPINLOCK_COUNT (1<<10)
+#define SPINLOCK_COUNT (1<<12)
 #endif
 static const long SPINLOCK_MASK = SPINLOCK_COUNT - 1;
 
+#ifndef CACHE_LINE_SIZE
+#define CACHE_LINE_SIZE 64
+#endif
+
+/// Upper bound, in pause instructions, of the exponential backoff between
+/// attempts to take a contended lock.
+#define SPINLOCK_BACKOFF_MAX 1024
+
+#if defined(__i386__) || defined(__x86_64__)
+#define cpu_relax() __builtin_ia32_pause()
+#elif defined(__aarch64__)
+#define cpu_relax() __asm__ __volatile__("yield" ::: "memory")
+#else
+#define cpu_relax() __asm__ __volatile__("" ::: "memory")
+#endif
+
+/// Waits, backing off exponentially, for a lock word to read as zero.  Gives
+/// up and returns 0 once the backoff reaches its limit while the lock is still
+/// held; returns 1 if the lock was seen free.
+__inline static int spin_until_free(_Atomic(uint32_t) *word, int limited) {
+  unsigned backoff = 1;
+  while (__c11_atomic_load(word, __ATOMIC_RELAXED) != 0) {
+    for (unsigned i = 0; i < backoff; i++)
+      cpu_relax();
+    if (backoff < SPINLOCK_BACKOFF_MAX)
+      backoff <<= 1;
+    else if (limited)
+      return 0;
+  }
+  return 1;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Platform-specific lock implementation.  Falls back to spinlocks if none is
 // defined.  Each platform should define the Lock type, and corresponding
@@ -55,23 +94,29 @@ static const long SPINLOCK_MASK = SPINLOCK_COUNT - 1;
 #include <sys/types.h>
 #include <machine/atomic.h>
 #include <sys/umtx.h>
-typedef struct _usem Lock;
+/// 0 is unlocked, 1 is locked and 2 is locked with possible sleepers, so the
+/// lock table can live in .bss.
+typedef _Atomic(uint32_t) Lock;
 __inline static void unlock(Lock *l) {
-  __c11_atomic_store((_Atomic(uint32_t)*)&l->_count, 1, __ATOMIC_RELEASE);
-  __c11_atomic_thread_fence(__ATOMIC_SEQ_CST);
-  if (l->_has_waiters)
-      _umtx_op(l, UMTX_OP_SEM_WAKE, 1, 0, 0);
+  if (__c11_atomic_exchange(l, 0, __ATOMIC_RELEASE) == 2)
+    _umtx_op(l, UMTX_OP_WAKE_PRIVATE, 1, 0, 0);
 }
+/// Locks a lock.  Spins with backoff for a while before sleeping in the
+/// kernel, since the critical sections are a few loads and stores.
 __inline static void lock(Lock *l) {
-  uint32_t old = 1;
-  while (!__c11_atomic_compare_exchange_weak((_Atomic(uint32_t)*)&l->_count, &old,
-        0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
-    _umtx_op(l, UMTX_OP_SEM_WAIT, 0, 0, 0);
-    old = 1;
+  uint32_t old = 0;
+  if (__c11_atomic_compare_exchange_strong(l, &old, 1, __ATOMIC_ACQUIRE,
+        __ATOMIC_RELAXED))
+    return;
+  if (spin_until_free(l, 1)) {
+    old = 0;
+    if (__c11_atomic_compare_exchange_strong(l, &old, 1, __ATOMIC_ACQUIRE,
+          __ATOMIC_RELAXED))
+      return;
   }
+  while (__c11_atomic_exchange(l, 2, __ATOMIC_ACQUIRE) != 0)
+    _umtx_op(l, UMTX_OP_WAIT_UINT_PRIVATE, 2, 0, 0);
 }
-/// locks for atomic operations
-static Lock locks[SPINLOCK_COUNT] = { [0 ...  SPINLOCK_COUNT-1] = {0,1,0} };
 
 #elif defined(__APPLE__)
 #include <libkern/OSAtomic.h>
@@ -84,47 +129,152 @@ __inline static void unlock(Lock *l) {
 __inline static void lock(Lock *l) {
   OSSpinLockLock(l);
 }
-static Lock locks[SPINLOCK_COUNT]; // initialized to OS_SPINLOCK_INIT which is 0
+// OS_SPINLOCK_INIT is 0, so the lock table is zero-initialized below.
 
 #else
-typedef _Atomic(uintptr_t) Lock;
+typedef _Atomic(uint32_t) Lock;
 /// Unlock a lock.  This is a release operation.
 __inline static void unlock(Lock *l) {
   __c11_atomic_store(l, 0, __ATOMIC_RELEASE);
 }
 /// Locks a lock.  In the current implementation, this is potentially
-/// unbounded in the contended case.
+/// unbounded in the contended case.  Waiters only read the lock word while it
+/// is held, and back off between attempts, to keep the line from bouncing.
 __inline static void lock(Lock *l) {
-  uintptr_t old = 0;
+  uint32_t old = 0;
   while (!__c11_atomic_compare_exchange_weak(l, &old, 1, __ATOMIC_ACQUIRE,
-        __ATOMIC_RELAXED))
+        __ATOMIC_RELAXED)) {
+    spin_until_free(l, 0);
     old = 0;
+  }
 }
-/// locks for atomic operations
-static Lock locks[SPINLOCK_COUNT];
 #endif
 
+/// locks for atomic operations
+static struct {
+  Lock l;
+} __attribute__((aligned(CACHE_LINE_SIZE))) locks[SPINLOCK_COUNT];
 
-/// Returns a lock to use for a given pointer.  
+/// Returns a lock to use for a given pointer.
 static __inline Lock *lock_for_pointer(void *ptr) {
-  intptr_t hash = (intptr_t)ptr;
+  uintptr_t hash = (uintptr_t)ptr;
   // Disregard the lowest 4 bits.  We want all values that may be part of the
   // same memory operation to hash to the same value and therefore use the same
-  // lock.  
+  // lock.
   hash >>= 4;
-  // Use the next bits as the basis for the hash
-  intptr_t low = hash & SPINLOCK_MASK;
-  // Now use the high(er) set of bits to perturb the hash, so that we don't
-  // get collisions from atomic fields in a single object
-  hash >>= 16;
-  hash ^= low;
+  // Multiply by the golden ratio to spread neighbouring objects across the
+  // table, then fold the well-mixed high bits back down so that objects a
+  // multiple of the table size apart still differ.
+  hash *= (uintptr_t)0x9e3779b97f4a7c15ULL;
+  hash ^= hash >> (sizeof(uintptr_t) * 4);
   // Return a pointer to the word to use
-  return locks + (hash & SPINLOCK_MASK);
+  return &locks[hash & SPINLOCK_MASK].l;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Lock-free 16-byte operations, built on a strong compare-and-swap that
+// always reports the value it found in *expected.  The operand must be
+// 16-byte aligned; misaligned objects always take the lock.
+////////////////////////////////////////////////////////////////////////////////
+#if defined(__x86_64__)
+#define HAVE_LOCK_FREE_16 1
+
+struct __processor_model {
+  unsigned int __cpu_vendor;
+  unsigned int __cpu_type;
+  unsigned int __cpu_subtype;
+  unsigned int __cpu_features[1];
+};
+extern struct __processor_model __cpu_model;
+extern unsigned int __cpu_features2;
+int __cpu_indicator_init(void);
+/// Must match ProcessorFeatures2 in cpu_model.c.
+#define FEATURE2_CMPXCHG16B 0
+
+/// 0 until probed, then 1 if CMPXCHG16B is usable and -1 otherwise.
+static _Atomic(int) has_cmpxchg16b;
+
+static __inline int cpu_has_cas_16(void) {
+  int state = __c11_atomic_load(&has_cmpxchg16b, __ATOMIC_RELAXED);
+  if (__builtin_expect(state == 0, 0)) {
+    // We may run before cpu_model.c's constructor.
+    __cpu_indicator_init();
+    state = (__cpu_features2 & (1 << FEATURE2_CMPXCHG16B)) ? 1 : -1;
+    __c11_atomic_store(&has_cmpxchg16b, state, __ATOMIC_RELAXED);
+  }
+  return state > 0;
+}
+
+static __inline int cas_16(__uint128_t *ptr, __uint128_t *expected,
+                           __uint128_t desired) {
+  uint64_t lo = (uint64_t)*expected, hi = (uint64_t)(*expected >> 64);
+  unsigned char ok;
+  __asm__ __volatile__("lock cmpxchg16b %1\n\tsete %0"
+                       : "=q"(ok), "+m"(*ptr), "+a"(lo), "+d"(hi)
+                       : "b"((uint64_t)desired), "c"((uint64_t)(desired >> 64))
+                       : "cc", "memory");
+  *expected = ((__uint128_t)hi << 64) | lo;
+  return ok;
+}
+
+#elif defined(__aarch64__)
+#define HAVE_LOCK_FREE_16 1
+
+#define cpu_has_cas_16() 1
+
+static __inline int cas_16(__uint128_t *ptr, __uint128_t *expected,
+                           __uint128_t desired) {
+  uint64_t elo = (uint64_t)*expected, ehi = (uint64_t)(*expected >> 64);
+  uint64_t lo, hi;
+  uint32_t fail;
+  // On a mismatch the loaded value is stored back, since LDXP alone is only
+  // single-copy atomic when paired with a successful STXP.
+  __asm__ __volatile__("1: ldaxp  %0, %1, %3\n"
+                       "   cmp    %0, %4\n"
+                       "   ccmp   %1, %5, #0, eq\n"
+                       "   b.ne   2f\n"
+                       "   stlxp  %w2, %6, %7, %3\n"
+                       "   cbnz   %w2, 1b\n"
+                       "   b      3f\n"
+                       "2: stlxp  %w2, %0, %1, %3\n"
+                       "   cbnz   %w2, 1b\n"
+                       "3:\n"
+                       : "=&r"(lo), "=&r"(hi), "=&r"(fail), "+Q"(*ptr)
+                       : "r"(elo), "r"(ehi), "r"((uint64_t)desired),
+                         "r"((uint64_t)(desired >> 64))
+                       : "cc", "memory");
+  *expected = ((__uint128_t)hi << 64) | lo;
+  return lo == elo && hi == ehi;
+}
+
+#else
+#define HAVE_LOCK_FREE_16 0
+#endif
+
+#if HAVE_LOCK_FREE_16
+static __inline int lock_free_16(void *ptr) {
+  return ((uintptr_t)ptr & 15) == 0 && cpu_has_cas_16();
+}
+
+static __inline __uint128_t atomic_load_16(__uint128_t *src) {
+  // Swapping 0 for 0 leaves memory unchanged and returns the current value.
+  __uint128_t val = 0;
+  cas_16(src, &val, 0);
+  return val;
+}
+
+static __inline __uint128_t atomic_exchange_16(__uint128_t *ptr,
+                                               __uint128_t val) {
+  __uint128_t old = 0;
+  while (!cas_16(ptr, &old, val))
+    ;
+  return old;
+}
+#endif
+
 /// Macros for determining whether a size is lock free.  Clang can not yet
-/// codegen __atomic_is_lock_free(16), so for now we assume 16-byte values are
-/// not lock free.
+/// codegen __atomic_is_lock_free(16), so 16-byte values go through the
+/// helpers above instead (see lock_free_16()).
 #define IS_LOCK_FREE_1 __c11_atomic_is_lock_free(1)
 #define IS_LOCK_FREE_2 __c11_atomic_is_lock_free(2)
 #define IS_LOCK_FREE_4 __c11_atomic_is_lock_free(4)
@@ -133,7 +283,16 @@ static __inline Lock *lock_for_pointer(void *ptr) {
 
 /// Macro that calls the compiler-generated lock-free versions of functions
 /// when they exist.
-#define LOCK_FREE_CASES() \
+#if HAVE_LOCK_FREE_16
+#define LOCK_FREE_CASE_16(ptr) \
+    case 16:\
+      if (lock_free_16(ptr)) {\
+        LOCK_FREE_ACTION_16;\
+      }
+#else
+#define LOCK_FREE_CASE_16(ptr)
+#endif
+#define LOCK_FREE_CASES(ptr) \
   do {\
   switch (size) {\
     case 2:\
@@ -148,11 +307,7 @@ static __inline Lock *lock_for_pointer(void *ptr) {
       if (IS_LOCK_FREE_8) {\
         LOCK_FREE_ACTION(uint64_t);\
       }\
-    case 16:\
-      if (IS_LOCK_FREE_16) {\
-        /* FIXME: __uint128_t isn't available on 32 bit platforms.
-        LOCK_FREE_ACTION(__uint128_t);*/\
-      }\
+    LOCK_FREE_CASE_16(ptr)\
   }\
   } while (0)
 
@@ -163,8 +318,12 @@ void __atomic_load_c(int size, void *src, void *dest, int model) {
 #define LOCK_FREE_ACTION(type) \
     *((type*)dest) = __c11_atomic_load((_Atomic(type)*)src, model);\
     return;
-  LOCK_FREE_CASES();
+#define LOCK_FREE_ACTION_16 \
+    *(__uint128_t*)dest = atomic_load_16((__uint128_t*)src);\
+    return;
+  LOCK_FREE_CASES(src);
 #undef LOCK_FREE_ACTION
+#undef LOCK_FREE_ACTION_16
   Lock *l = lock_for_pointer(src);
   lock(l);
   memcpy(dest, src, size);
@@ -175,10 +334,14 @@ void __atomic_load_c(int size, void *src, void *dest, int model) {
 /// pointer only.
 void __atomic_store_c(int size, void *dest, void *src, int model) {
 #define LOCK_FREE_ACTION(type) \
-    __c11_atomic_store((_Atomic(type)*)dest, *(type*)dest, model);\
+    __c11_atomic_store((_Atomic(type)*)dest, *(type*)src, model);\
+    return;
+#define LOCK_FREE_ACTION_16 \
+    atomic_exchange_16((__uint128_t*)dest, *(__uint128_t*)src);\
     return;
-  LOCK_FREE_CASES();
+  LOCK_FREE_CASES(dest);
 #undef LOCK_FREE_ACTION
+#undef LOCK_FREE_ACTION_16
   Lock *l = lock_for_pointer(dest);
   lock(l);
   memcpy(dest, src, size);
@@ -195,8 +358,12 @@ int __atomic_compare_exchange_c(int size, void *ptr, void *expected,
 #define LOCK_FREE_ACTION(type) \
   return __c11_atomic_compare_exchange_strong((_Atomic(type)*)ptr, (type*)expected,\
       *(type*)desired, success, failure)
-  LOCK_FREE_CASES();
+#define LOCK_FREE_ACTION_16 \
+  return cas_16((__uint128_t*)ptr, (__uint128_t*)expected,\
+      *(__uint128_t*)desired)
+  LOCK_FREE_CASES(ptr);
 #undef LOCK_FREE_ACTION
+#undef LOCK_FREE_ACTION_16
   Lock *l = lock_for_pointer(ptr);
   lock(l);
   if (memcmp(ptr, expected, size) == 0) {
@@ -216,8 +383,13 @@ void __atomic_exchange_c(int size, void *ptr, void *val, void *old, int model) {
     *(type*)old = __c11_atomic_exchange((_Atomic(type)*)ptr, *(type*)val,\
         model);\
     return;
-  LOCK_FREE_CASES();
+#define LOCK_FREE_ACTION_16 \
+    *(__uint128_t*)old = atomic_exchange_16((__uint128_t*)ptr,\
+        *(__uint128_t*)val);\
+    return;
+  LOCK_FREE_CASES(ptr);
 #undef LOCK_FREE_ACTION
+#undef LOCK_FREE_ACTION_16
   Lock *l = lock_for_pointer(ptr);
   lock(l);
   memcpy(old, ptr, size);
@@ -229,7 +401,7 @@ void __atomic_exchange_c(int size, void *ptr, void *val, void *old, int model) {
 // Where the size is known at compile time, the compiler may emit calls to
 // specialised versions of the above functions.
 ////////////////////////////////////////////////////////////////////////////////
-#ifdef __SIZEOF_INT128__
+#if defined(__SIZEOF_INT128__) && !HAVE_LOCK_FREE_16
 #define OPTIMISED_CASES\
   OPTIMISED_CASE(1, IS_LOCK_FREE_1, uint8_t)\
   OPTIMISED_CASE(2, IS_LOCK_FREE_2, uint16_t)\
@@ -336,3 +508,82 @@ OPTIMISED_CASES
 #define OPTIMISED_CASE(n, lockfree, type) ATOMIC_RMW(n, lockfree, type, xor, ^)
 OPTIMISED_CASES
 #undef OPTIMISED_CASE
+
+#if HAVE_LOCK_FREE_16
+////////////////////////////////////////////////////////////////////////////////
+// 16-byte variants, which use the compare-and-swap helpers when lock_free_16()
+// allows and otherwise the same locks as the generic functions.
+////////////////////////////////////////////////////////////////////////////////
+__uint128_t __atomic_load_16(__uint128_t *src, int model) {
+  if (lock_free_16(src))
+    return atomic_load_16(src);
+  Lock *l = lock_for_pointer(src);
+  lock(l);
+  __uint128_t val = *src;
+  unlock(l);
+  return val;
+}
+
+void __atomic_store_16(__uint128_t *dest, __uint128_t val, int model) {
+  if (lock_free_16(dest)) {
+    atomic_exchange_16(dest, val);
+    return;
+  }
+  Lock *l = lock_for_pointer(dest);
+  lock(l);
+  *dest = val;
+  unlock(l);
+}
+
+__uint128_t __atomic_exchange_16(__uint128_t *dest, __uint128_t val,
+    int model) {
+  if (lock_free_16(dest))
+    return atomic_exchange_16(dest, val);
+  Lock *l = lock_for_pointer(dest);
+  lock(l);
+  __uint128_t tmp = *dest;
+  *dest = val;
+  unlock(l);
+  return tmp;
+}
+
+int __atomic_compare_exchange_16(__uint128_t *ptr, __uint128_t *expected,
+    __uint128_t desired, int success, int failure) {
+  if (lock_free_16(ptr))
+    return cas_16(ptr, expected, desired);
+  Lock *l = lock_for_pointer(ptr);
+  lock(l);
+  if (*ptr == *expected) {
+    *ptr = desired;
+    unlock(l);
+    return 1;
+  }
+  *expected = *ptr;
+  unlock(l);
+  return 0;
+}
+
+#define ATOMIC_RMW_16(opname, op) \
+__uint128_t __atomic_fetch_##opname##_16(__uint128_t *ptr, __uint128_t val,\
+    int model) {\
+  if (lock_free_16(ptr)) {\
+    __uint128_t tmp = 0;\
+    while (!cas_16(ptr, &tmp, tmp op val))\
+      ;\
+    return tmp;\
+  }\
+  Lock *l = lock_for_pointer(ptr);\
+  lock(l);\
+  __uint128_t tmp = *ptr;\
+  *ptr = tmp op val;\
+  unlock(l);\
+  return tmp;\
+}
+
+ATOMIC_RMW_16(add, +)
+ATOMIC_RMW_16(sub, -)
+ATOMIC_RMW_16(and, &)
+ATOMIC_RMW_16(or, |)
+ATOMIC_RMW_16(xor, ^)
+#undef ATOMIC_RMW_16
+#endif
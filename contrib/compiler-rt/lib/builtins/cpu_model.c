@@ -113,6 +113,13 @@ enum ProcessorFeatures {
   FEATURE_AVX512VPOPCNTDQ
 };
 
+// Features that do not fit in __cpu_model.__cpu_features, whose layout is
+// shared with the compiler's __builtin_cpu_supports().  These are for use by
+// the rest of compiler-rt only; see atomic.c.
+enum ProcessorFeatures2 {
+  FEATURE2_CMPXCHG16B = 0
+};
+
 // The check below for i386 was copied from clang's cpuid.h (__get_cpuid_max).
 // Check motivated by bug reports for OpenSSL crashing on CPUs without CPUID
 // support. Consequently, for i386, the presence of CPUID is checked first
@@ -438,8 +445,10 @@ static void getAMDProcessorTypeAndSubtype(unsigned Family, unsigned Model,
 }
 
 static void getAvailableFeatures(unsigned ECX, unsigned EDX, unsigned MaxLeaf,
-                                 unsigned *FeaturesOut) {
+                                 unsigned *FeaturesOut,
+                                 unsigned *Features2Out) {
   unsigned Features = 0;
+  unsigned Features2 = 0;
   unsigned EAX, EBX;
 
   if ((EDX >> 15) & 1)
@@ -459,6 +468,8 @@ static void getAvailableFeatures(unsigned ECX, unsigned EDX, unsigned MaxLeaf,
     Features |= 1 << FEATURE_SSSE3;
   if ((ECX >> 12) & 1)
     Features |= 1 << FEATURE_FMA;
+  if ((ECX >> 13) & 1)
+    Features2 |= 1 << FEATURE2_CMPXCHG16B;
   if ((ECX >> 19) & 1)
     Features |= 1 << FEATURE_SSE4_1;
   if ((ECX >> 20) & 1)
@@ -528,6 +539,7 @@ static void getAvailableFeatures(unsigned ECX, unsigned EDX, unsigned MaxLeaf,
     Features |= 1 << FEATURE_FMA4;
 
   *FeaturesOut = Features;
+  *Features2Out = Features2;
 }
 
 #if defined(HAVE_INIT_PRIORITY)
@@ -548,6 +560,7 @@ struct __processor_model {
   unsigned int __cpu_subtype;
   unsigned int __cpu_features[1];
 } __cpu_model = {0, 0, 0, {0}};
+unsigned int __cpu_features2;
 
 /* A constructor function that is sets __cpu_model and __cpu_features with
    the right values.  This needs to run only once.  This constructor is
@@ -562,6 +575,7 @@ __cpu_indicator_init(void) {
   unsigned Vendor;
   unsigned Model, Family, Brand_id;
   unsigned Features = 0;
+  unsigned Features2 = 0;
 
   /* This function needs to run just once.  */
   if (__cpu_model.__cpu_vendor)
@@ -580,8 +594,9 @@ __cpu_indicator_init(void) {
   Brand_id = EBX & 0xff;
 
   /* Find available features. */
-  getAvailableFeatures(ECX, EDX, MaxLeaf, &Features);
+  getAvailableFeatures(ECX, EDX, MaxLeaf, &Features, &Features2);
   __cpu_model.__cpu_features[0] = Features;
+  __cpu_features2 = Features2;
 
   if (Vendor == SIG_INTEL) {
     /* Get CPU type.  */
@@ -33,6 +33,11 @@ bool EsanIsInitialized;
 bool EsanDuringInit;
 ShadowMapping Mapping;
 
+// A cached copy of the sample_rate flag and the per-thread countdown to the
+// next small access we process.
+static int SampleRate = 1;
+static THREADLOCAL int SampleCountdown;
+
 // Different tools use different scales within the same shadow mapping scheme.
 // The scale used here must match that used by the compiler instrumentation.
 // This array is indexed by the ToolType enum.
@@ -65,6 +70,15 @@ static const uptr ShadowScale[] = {
 void processRangeAccess(uptr PC, uptr Addr, int Size, bool IsWrite) {
   VPrintf(3, "in esan::%s %p: %c %p %d\n", __FUNCTION__, PC,
           IsWrite ? 'w' : 'r', Addr, Size);
+  // Sampling only applies to small accesses: ranges from interceptors can
+  // touch a lot of memory at once and we do not want to drop those.
+  if (SampleRate > 1 && Size <= 16) {
+    if (LIKELY(SampleCountdown > 0)) {
+      --SampleCountdown;
+      return;
+    }
+    SampleCountdown = SampleRate - 1;
+  }
   if (__esan_which_tool == ESAN_CacheFrag) {
     // TODO(bruening): add shadow mapping and update shadow bits here.
     // We'll move this to cache_frag.cpp once we have something.
@@ -198,6 +212,8 @@ void initializeLibrary(ToolType Tool) {
   SanitizerToolName = "EfficiencySanitizer";
   CacheBinaryName();
   initializeFlags();
+  if (getFlags()->sample_rate > 1)
+    SampleRate = getFlags()->sample_rate;
 
   // Intercepting libc _exit or exit via COMMON_INTERCEPTOR_ON_EXIT only
   // finalizes on an explicit exit call by the app.  To handle a normal
@@ -107,6 +107,35 @@ static const struct ApplicationRegion AppRegions[] = {
   {0xffffffffff600000u,   0xffffffffff601000u, true},
 };
 
+#elif SANITIZER_FREEBSD && defined(__x86_64__)
+// FreeBSD x86_64
+//
+// Application memory falls into these 2 regions:
+//
+// [0x00000000'00000000, 0x00000100'00000000) non-PIE, PIE, heap + libraries
+// [0x00007e00'00000000, 0x00008000'00000000) stack + shared page
+//
+// Non-PIE binaries load at 0x400000 and PIE ones at 0x1021000.  The
+// run-time linker and mmap without a hint start above the data segment
+// limit (around 0x00000008'00000000) and grow upwards, and the main stack
+// and the shared page sit just below 0x00008000'00000000.  This is a subset
+// of the Linux layout above, so the same formula and offsets apply and the
+// shadow and shadow(shadow) regions are those of the Linux non-PIE and
+// library regions:
+//
+//   shadow(app) = ((app & 0x00000fff'ffffffff) + offset) >> scale
+//
+// [0x00001300'00000000, 0x00001400'00000000)
+// [0x00002100'00000000, 0x00002300'00000000)
+//
+// Mappings outside these regions, such as those made with ASLR enabled,
+// are reported by checkMmapResult().
+
+static const struct ApplicationRegion AppRegions[] = {
+  {0x0000000000000000ull, 0x0000010000000000u, false},
+  {0x00007e0000000000u,   0x0000800000000000u, false},
+};
+
 #elif SANITIZER_LINUX && SANITIZER_MIPS64
 
 // Application memory falls into these 3 regions
@@ -0,0 +1,101 @@
+//===-- esan_sideline_freebsd.cpp -------------------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file is a part of EfficiencySanitizer, a family of performance tuners.
+//
+// Support for a separate or "sideline" tool thread on FreeBSD.
+//===----------------------------------------------------------------------===//
+
+#include "sanitizer_common/sanitizer_platform.h"
+#if SANITIZER_FREEBSD
+
+#include "esan_sideline.h"
+#include "sanitizer_common/sanitizer_atomic.h"
+#include "sanitizer_common/sanitizer_common.h"
+#include "sanitizer_common/sanitizer_linux.h"
+#include <pthread.h>
+#include <signal.h>
+
+namespace __esan {
+
+// FreeBSD has no equivalent of a CLONE_VM child outside the thread group, so
+// an itimer signal would be delivered to whichever app thread happens to
+// have it unblocked, and ITIMER_REAL would be taken away from the app.
+// Instead the sideline thread is a regular pthread with every signal blocked
+// that sleeps for the sampling period between samples.
+
+static SidelineThread *TheThread;
+
+int SidelineThread::runSideline(void *Arg) {
+  VPrintf(1, "Sideline thread starting\n");
+  SidelineThread *Thread = static_cast<SidelineThread*>(Arg);
+  while (atomic_load(&Thread->SidelineExit, memory_order_relaxed) == 0) {
+    SleepForMillis(Thread->Freq);
+    if (atomic_load(&Thread->SidelineExit, memory_order_relaxed) != 0)
+      break;
+    Thread->sampleFunc(Thread->FuncArg);
+  }
+  VPrintf(1, "Sideline thread exiting\n");
+  return 0;
+}
+
+bool SidelineThread::launchThread(SidelineFunc takeSample, void *Arg,
+                                  u32 FreqMilliSec) {
+  // See the comment in esan_sideline_linux.cpp about why we cannot rely on
+  // the constructor having run.
+  CHECK(TheThread == nullptr); // Only one sideline thread is supported.
+  TheThread = this;
+  sampleFunc = takeSample;
+  FuncArg = Arg;
+  Freq = FreqMilliSec;
+  Stack = nullptr;
+  atomic_store(&SidelineExit, 0, memory_order_relaxed);
+
+  // Start the thread with signals blocked so that it never runs app
+  // handlers, and restore our own mask afterwards.
+  __sanitizer_sigset_t SigSet, OldSet;
+  internal_sigfillset(&SigSet);
+  internal_sigprocmask(SIG_SETMASK, &SigSet, &OldSet);
+  pthread_t Tid;
+  int Res = pthread_create(&Tid, nullptr, [](void *Arg) -> void * {
+    runSideline(Arg);
+    return nullptr;
+  }, this);
+  internal_sigprocmask(SIG_SETMASK, &OldSet, nullptr);
+  if (Res != 0) {
+    Printf("FATAL: EfficiencySanitizer failed to spawn a thread (code %d).\n",
+           Res);
+    Die();
+    return false; // Not reached.
+  }
+  SidelineId = (uptr)Tid;
+  return true;
+}
+
+bool SidelineThread::joinThread() {
+  VPrintf(1, "Joining sideline thread\n");
+  atomic_store(&SidelineExit, 1, memory_order_relaxed);
+  int Res = pthread_join((pthread_t)SidelineId, nullptr);
+  if (Res != 0) {
+    VPrintf(1, "Failed to join sideline thread (errno %d)\n", Res);
+    return false;
+  }
+  return true;
+}
+
+// Must be called from the sideline thread itself.
+bool SidelineThread::adjustTimer(u32 FreqMilliSec) {
+  // The new period takes effect after the current sleep.
+  Freq = FreqMilliSec;
+  return true;
+}
+
+} // namespace __esan
+
+#endif // SANITIZER_FREEBSD
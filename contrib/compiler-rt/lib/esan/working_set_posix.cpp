@@ -47,7 +47,7 @@ bool processWorkingSetSigaction(int SigNum, const void *ActVoid,
     const struct sigaction *Act = (const struct sigaction *) ActVoid;
     struct sigaction *OldAct = (struct sigaction *) OldActVoid;
     if (OldAct)
-      internal_memcpy(OldAct, &AppSigAct, sizeof(OldAct));
+      internal_memcpy(OldAct, &AppSigAct, sizeof(AppSigAct));
     if (Act)
       internal_memcpy(&AppSigAct, Act, sizeof(AppSigAct));
     return false; // Skip real call.
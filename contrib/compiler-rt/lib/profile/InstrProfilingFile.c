@@ -22,6 +22,8 @@
 #else
 #include <sys/file.h>
 #include <sys/mman.h>
+#include <fcntl.h>
+#include <signal.h>
 #include <unistd.h>
 #if defined(__linux__)
 #include <sys/types.h>
@@ -80,16 +82,22 @@ typedef struct lprofFilename {
    * 2 profile data files. %1m is equivalent to %m. Also %m specifier
    * can only appear once at the end of the name pattern. */
   unsigned MergePoolSize;
+  /* Set by the %c specifier: map the counters onto the profile file so
+   * that it is always up to date, instead of writing it at exit. */
+  unsigned ContinuousMode;
   ProfileNameSpecifier PNS;
 } lprofFilename;
 
 COMPILER_RT_WEAK lprofFilename lprofCurFilename = {0, 0, 0, {0}, {0},
-                                                   0, 0, 0, PNS_unknown};
+                                                   0, 0, 0, 0, PNS_unknown};
 
 static int getCurFilenameLength();
 static const char *getCurFilename(char *FilenameBuf);
 static unsigned doMerging() { return lprofCurFilename.MergePoolSize; }
 
+/* Set once the counter section has been mapped onto the profile file. */
+static int ContinuousModeActive = 0;
+
 /* Return 1 if there is an error, otherwise return  0.  */
 static uint32_t fileWriter(ProfDataWriter *This, ProfDataIOVec *IOVecs,
                            uint32_t NumIOVecs) {
@@ -252,6 +260,267 @@ static int writeFile(const char *OutputName) {
   return RetVal;
 }
 
+#if !defined(_WIN32)
+/* Continuous mode.  The file holds two raw profiles: first a copy of the
+ * current one with every counter zero, then zero padding, then the live
+ * profile, whose counters start on a page boundary.  The counter section,
+ * which the linker page-aligns (see InstrProfilingPlatformLinux.c), is then
+ * mapped MAP_SHARED onto that part of the file, so the file is valid and
+ * current at all times.  Readers sum the profiles in a file and skip zero
+ * padding between them, so the leading copy only serves to move the live
+ * counters to a page-aligned offset without changing the raw format.  Value
+ * profile data is not written in this mode. */
+
+/* Byte offsets of the live profile and its counters within the file. */
+static void getContinuousModeLayout(uint64_t PageSize, uint64_t *ProfileSize,
+                                    uint64_t *LiveProfileOffset,
+                                    uint64_t *CountersOffset) {
+  uint64_t DataSize = __llvm_profile_get_data_size(__llvm_profile_begin_data(),
+                                                   __llvm_profile_end_data());
+  uint64_t CountersStart =
+      sizeof(__llvm_profile_header) + DataSize * sizeof(__llvm_profile_data);
+
+  *ProfileSize = __llvm_profile_get_size_for_buffer();
+  *CountersOffset = (*ProfileSize + CountersStart + PageSize - 1) &
+                    ~(PageSize - 1);
+  *LiveProfileOffset = *CountersOffset - CountersStart;
+}
+
+/* Like fileWriter, but leaves a hole in place of the counters so that they
+ * read back as zero.  Only used on a freshly truncated file. */
+static uint32_t zeroCountersWriter(ProfDataWriter *This, ProfDataIOVec *IOVecs,
+                                   uint32_t NumIOVecs) {
+  uint32_t I;
+  for (I = 0; I < NumIOVecs; I++)
+    if (IOVecs[I].Data == __llvm_profile_begin_counters())
+      IOVecs[I].Data = NULL;
+  return fileWriter(This, IOVecs, NumIOVecs);
+}
+
+/* Return 1 if \p File already has the continuous mode layout for this
+ * module, as left by an earlier run with %m. */
+static int hasContinuousModeLayout(FILE *File, uint64_t FileSize,
+                                   uint64_t LiveProfileOffset) {
+  char *Buffer;
+  int Compatible;
+
+  if (fseek(File, 0L, SEEK_END) == -1 || (uint64_t)ftell(File) != FileSize)
+    return 0;
+  Buffer = mmap(NULL, FileSize, PROT_READ, MAP_SHARED | MAP_FILE,
+                fileno(File), 0);
+  if (Buffer == MAP_FAILED)
+    return 0;
+  Compatible =
+      !__llvm_profile_check_compatibility(Buffer, LiveProfileOffset) &&
+      !__llvm_profile_check_compatibility(Buffer + LiveProfileOffset,
+                                          FileSize - LiveProfileOffset);
+  (void)munmap(Buffer, FileSize);
+  return Compatible;
+}
+
+static void initializeContinuousMode(void) {
+  uint64_t *CountersBegin = __llvm_profile_begin_counters();
+  uint64_t *CountersEnd = __llvm_profile_end_counters();
+  uint64_t CountersSize = (CountersEnd - CountersBegin) * sizeof(uint64_t);
+  uint64_t PageSize = getpagesize();
+  uint64_t ProfileSize, LiveProfileOffset, CountersOffset, I;
+  uint64_t *Saved = NULL;
+  ProfDataWriter Writer;
+  const char *Filename;
+  char *FilenameBuf;
+  FILE *File;
+  void *Addr;
+  int Reuse;
+
+  if (!lprofCurFilename.ContinuousMode || ContinuousModeActive ||
+      !CountersSize)
+    return;
+  if ((uintptr_t)CountersBegin % PageSize ||
+      (uintptr_t)CountersEnd % PageSize) {
+    PROF_WARN("Continuous mode disabled: %s\n",
+              "the counter section is not page aligned.");
+    return;
+  }
+
+  FilenameBuf = (char *)COMPILER_RT_ALLOCA(getCurFilenameLength() + 1);
+  Filename = getCurFilename(FilenameBuf);
+  if (!Filename)
+    return;
+  createProfileDir(Filename);
+  File = lprofOpenFileEx(Filename);
+  if (!File) {
+    PROF_ERR("Continuous mode: failed to open \"%s\": %s\n", Filename,
+             strerror(errno));
+    return;
+  }
+
+  getContinuousModeLayout(PageSize, &ProfileSize, &LiveProfileOffset,
+                          &CountersOffset);
+  Reuse = doMerging() &&
+          hasContinuousModeLayout(File, LiveProfileOffset + ProfileSize,
+                                  LiveProfileOffset);
+  if (Reuse) {
+    /* The counts already in the file are kept; add the ones gathered
+     * before we got here once the file is mapped. */
+    Saved = (uint64_t *)malloc(CountersSize);
+    if (!Saved)
+      goto fail;
+    memcpy(Saved, CountersBegin, CountersSize);
+  } else {
+    FreeHook = &free;
+    if (COMPILER_RT_FTRUNCATE(File, 0L) || fseek(File, 0L, SEEK_SET) == -1)
+      goto fail;
+    Writer.Write = zeroCountersWriter;
+    Writer.WriterCtx = File;
+    if (lprofWriteData(&Writer, NULL, 0) ||
+        fseek(File, LiveProfileOffset, SEEK_SET) == -1)
+      goto fail;
+    initFileWriter(&Writer, File);
+    if (lprofWriteData(&Writer, NULL, 0) || fflush(File))
+      goto fail;
+  }
+
+  Addr = mmap(CountersBegin, CountersSize, PROT_READ | PROT_WRITE,
+              MAP_FIXED | MAP_SHARED, fileno(File), CountersOffset);
+  if (Addr != CountersBegin)
+    goto fail;
+  if (Saved) {
+    for (I = 0; I < CountersSize / sizeof(uint64_t); I++)
+      __sync_fetch_and_add(&CountersBegin[I], Saved[I]);
+    free(Saved);
+  }
+  fclose(File);
+  ContinuousModeActive = 1;
+  return;
+
+fail:
+  PROF_ERR("Continuous mode: failed to map counters onto \"%s\": %s\n",
+           Filename, strerror(errno));
+  free(Saved);
+  fclose(File);
+}
+
+/* Signal-triggered snapshots.  If LLVM_PROFILE_SNAPSHOT_SIGNAL names a
+ * signal number, the runtime writes the current profile to
+ * "<profile>.snapshot" whenever that signal is delivered.  The data goes to
+ * a temporary file first and is renamed into place, so a reader never sees
+ * a partial snapshot.  Everything the handler calls is async-signal-safe. */
+#define SNAPSHOT_SUFFIX ".snapshot"
+#define SNAPSHOT_TMP_SUFFIX ".tmp"
+
+/* "<profile>.snapshot" followed by "<profile>.snapshot.tmp".  Replaced, and
+ * never freed, when the profile path changes, since a handler running on
+ * another thread may still be using the old one. */
+static char *volatile SnapshotPaths = NULL;
+static int SnapshotSignal = 0;
+static volatile sig_atomic_t SnapshotInProgress = 0;
+
+static uint32_t fdWriter(ProfDataWriter *This, ProfDataIOVec *IOVecs,
+                         uint32_t NumIOVecs) {
+  int Fd = (int)(intptr_t)This->WriterCtx;
+  uint32_t I;
+  for (I = 0; I < NumIOVecs; I++) {
+    size_t Length = IOVecs[I].ElmSize * IOVecs[I].NumElm;
+    const char *Data = (const char *)IOVecs[I].Data;
+    if (!Data) {
+      if (lseek(Fd, Length, SEEK_CUR) == -1)
+        return 1;
+      continue;
+    }
+    while (Length) {
+      ssize_t N = write(Fd, Data, Length);
+      if (N < 0 && errno == EINTR)
+        continue;
+      if (N <= 0)
+        return 1;
+      Data += N;
+      Length -= N;
+    }
+  }
+  return 0;
+}
+
+static void snapshotSignalHandler(int Sig) {
+  const char *Path = SnapshotPaths, *TmpPath;
+  ProfDataWriter Writer;
+  int SavedErrno = errno;
+  int Fd, rc;
+
+  (void)Sig;
+  if (!Path || SnapshotInProgress)
+    return;
+  SnapshotInProgress = 1;
+  TmpPath = Path + strlen(Path) + 1;
+  Fd = open(TmpPath, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  if (Fd >= 0) {
+    Writer.Write = fdWriter;
+    Writer.WriterCtx = (void *)(intptr_t)Fd;
+    rc = lprofWriteData(&Writer, NULL, 0);
+    /* Holes left at the end do not extend the file on their own. */
+    if (!rc)
+      rc = ftruncate(Fd, lseek(Fd, 0, SEEK_CUR));
+    close(Fd);
+    if (rc || rename(TmpPath, Path))
+      unlink(TmpPath);
+  }
+  SnapshotInProgress = 0;
+  errno = SavedErrno;
+}
+
+static void updateSnapshotPaths(void) {
+  size_t PathLen, SuffixLen = strlen(SNAPSHOT_SUFFIX);
+  const char *Filename;
+  char *FilenameBuf, *Paths;
+
+  if (!SnapshotSignal)
+    return;
+  FilenameBuf = (char *)COMPILER_RT_ALLOCA(getCurFilenameLength() + 1);
+  Filename = getCurFilename(FilenameBuf);
+  if (!Filename)
+    return;
+  PathLen = strlen(Filename) + SuffixLen;
+  Paths = (char *)malloc(2 * PathLen + strlen(SNAPSHOT_TMP_SUFFIX) + 2);
+  if (!Paths)
+    return;
+  strcpy(Paths, Filename);
+  strcat(Paths, SNAPSHOT_SUFFIX);
+  strcpy(Paths + PathLen + 1, Paths);
+  strcat(Paths + PathLen + 1, SNAPSHOT_TMP_SUFFIX);
+  SnapshotPaths = Paths;
+}
+
+static void installSnapshotHandler(void) {
+  const char *SignalStr = getenv("LLVM_PROFILE_SNAPSHOT_SIGNAL");
+  struct sigaction Action;
+
+  if (SnapshotSignal || !SignalStr || !SignalStr[0])
+    return;
+  SnapshotSignal = atoi(SignalStr);
+  if (SnapshotSignal <= 0 || SnapshotSignal >= NSIG) {
+    PROF_WARN("Invalid LLVM_PROFILE_SNAPSHOT_SIGNAL: %s\n", SignalStr);
+    SnapshotSignal = 0;
+    return;
+  }
+  updateSnapshotPaths();
+  memset(&Action, 0, sizeof(Action));
+  Action.sa_handler = snapshotSignalHandler;
+  Action.sa_flags = SA_RESTART;
+  sigemptyset(&Action.sa_mask);
+  if (sigaction(SnapshotSignal, &Action, NULL)) {
+    PROF_WARN("Unable to install profile snapshot handler: %s\n",
+              strerror(errno));
+    SnapshotSignal = 0;
+  }
+}
+#else
+static void initializeContinuousMode(void) {
+  if (lprofCurFilename.ContinuousMode)
+    PROF_WARN("Continuous mode is %s\n", "not supported on this platform.");
+}
+static void updateSnapshotPaths(void) {}
+static void installSnapshotHandler(void) {}
+#endif
+
 static void truncateCurrentFile(void) {
   const char *Filename;
   char *FilenameBuf;
@@ -269,6 +538,10 @@ static void truncateCurrentFile(void) {
   if (lprofCurFilename.MergePoolSize)
     return;
 
+  /* In continuous mode the file is rewritten when it is mapped. */
+  if (lprofCurFilename.ContinuousMode)
+    return;
+
   createProfileDir(Filename);
 
   /* Truncate the file.  Later we'll reopen and append. */
@@ -340,6 +613,8 @@ static int parseFilenamePattern(const char *FilenamePat,
                       FilenamePat);
             return -1;
           }
+      } else if (FilenamePat[I] == 'c') {
+        lprofCurFilename.ContinuousMode = 1;
       } else if (containsMergeSpecifier(FilenamePat, I)) {
         if (MergingEnabled) {
           PROF_WARN("%%m specifier can only be specified once in %s.\n",
@@ -371,6 +646,14 @@ static void parseAndSetFilename(const char *FilenamePat,
   if (PNS < OldPNS)
     return;
 
+  if (ContinuousModeActive) {
+    PROF_WARN("Profile path \"%s\" is ignored: counters are already mapped "
+              "onto \"%s\" (continuous mode).\n",
+              FilenamePat ? FilenamePat : DefaultProfileName,
+              lprofCurFilename.FilenamePat);
+    return;
+  }
+
   if (!FilenamePat)
     FilenamePat = DefaultProfileName;
 
@@ -396,6 +679,7 @@ static void parseAndSetFilename(const char *FilenamePat,
   }
 
   truncateCurrentFile();
+  updateSnapshotPaths();
 }
 
 /* Return buffer length that is required to store the current profile
@@ -408,7 +692,7 @@ static int getCurFilenameLength() {
     return 0;
 
   if (!(lprofCurFilename.NumPids || lprofCurFilename.NumHosts ||
-        lprofCurFilename.MergePoolSize))
+        lprofCurFilename.MergePoolSize || lprofCurFilename.ContinuousMode))
     return strlen(lprofCurFilename.FilenamePat);
 
   Len = strlen(lprofCurFilename.FilenamePat) +
@@ -431,7 +715,7 @@ static const char *getCurFilename(char *FilenameBuf) {
     return 0;
 
   if (!(lprofCurFilename.NumPids || lprofCurFilename.NumHosts ||
-        lprofCurFilename.MergePoolSize))
+        lprofCurFilename.MergePoolSize || lprofCurFilename.ContinuousMode))
     return lprofCurFilename.FilenamePat;
 
   PidLength = strlen(lprofCurFilename.PidChars);
@@ -522,16 +806,19 @@ void __llvm_profile_initialize_file(void) {
     /* Pass CopyFilenamePat = 1, to ensure that the filename would be valid 
        at the  moment when __llvm_profile_write_file() gets executed. */
     parseAndSetFilename(EnvFilenamePat, PNS_environment, 1);
-    return;
-  } else if (hasCommandLineOverrider) {
-    SelectedPat = INSTR_PROF_PROFILE_NAME_VAR;
-    PNS = PNS_command_line;
   } else {
-    SelectedPat = NULL;
-    PNS = PNS_default;
+    if (hasCommandLineOverrider) {
+      SelectedPat = INSTR_PROF_PROFILE_NAME_VAR;
+      PNS = PNS_command_line;
+    } else {
+      SelectedPat = NULL;
+      PNS = PNS_default;
+    }
+    parseAndSetFilename(SelectedPat, PNS, 0);
   }
 
-  parseAndSetFilename(SelectedPat, PNS, 0);
+  installSnapshotHandler();
+  initializeContinuousMode();
 }
 
 /* This API is directly called by the user application code. It has the
@@ -541,6 +828,7 @@ void __llvm_profile_initialize_file(void) {
 COMPILER_RT_VISIBILITY
 void __llvm_profile_set_filename(const char *FilenamePat) {
   parseAndSetFilename(FilenamePat, PNS_runtime_api, 1);
+  initializeContinuousMode();
 }
 
 /* The public API for writing profile data into the file with name
@@ -560,6 +848,10 @@ int __llvm_profile_write_file(void) {
     return 0;
   }
 
+  /* The counters are the file; there is nothing to write. */
+  if (ContinuousModeActive)
+    return 0;
+
   Length = getCurFilenameLength();
   FilenameBuf = (char *)COMPILER_RT_ALLOCA(Length + 1);
   Filename = getCurFilename(FilenameBuf);
@@ -23,6 +23,8 @@
 #define PROF_VNODES_START INSTR_PROF_SECT_START(INSTR_PROF_VNODES_SECT_NAME)
 #define PROF_VNODES_STOP INSTR_PROF_SECT_STOP(INSTR_PROF_VNODES_SECT_NAME)
 
+#define PROF_CNTS_PAGE_SIZE 4096
+
 /* Declare section start and stop symbols for various sections
  * generated by compiler instrumentation.
  */
@@ -38,8 +40,12 @@ extern ValueProfNode PROF_VNODES_STOP COMPILER_RT_VISIBILITY;
 /* Add dummy data to ensure the section is always created. */
 __llvm_profile_data
     __prof_data_sect_data[0] COMPILER_RT_SECTION(INSTR_PROF_DATA_SECT_NAME_STR);
-uint64_t
-    __prof_cnts_sect_data[0] COMPILER_RT_SECTION(INSTR_PROF_CNTS_SECT_NAME_STR);
+/* The counter section is page aligned at both ends so that continuous mode
+ * can map it onto the profile file.  The runtime is linked after the
+ * instrumented objects, so this zero-sized entry also pads the end of the
+ * section up to a page boundary. */
+uint64_t __prof_cnts_sect_data[0] COMPILER_RT_SECTION(
+    INSTR_PROF_CNTS_SECT_NAME_STR) COMPILER_RT_ALIGNAS(PROF_CNTS_PAGE_SIZE);
 char __prof_nms_sect_data[0] COMPILER_RT_SECTION(INSTR_PROF_NAME_SECT_NAME_STR);
 ValueProfNode __prof_vnodes_sect_data[0] COMPILER_RT_SECTION(INSTR_PROF_VNODES_SECT_NAME_STR);
 
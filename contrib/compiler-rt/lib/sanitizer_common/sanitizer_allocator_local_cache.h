@@ -85,9 +85,16 @@ struct SizeClassAllocator64LocalCache {
   static const uptr kNumClasses = SizeClassMap::kNumClasses;
   typedef typename Allocator::CompactPtrT CompactPtrT;
 
+  // A class starts out with room for 2 * MaxCachedHint chunks. After each
+  // refill it grows by that much again, up to kMaxGrowth times the
+  // initial size (and the size of chunks[]), so that classes a thread keeps
+  // going back to the allocator for move larger batches.
+  static const u32 kMaxGrowth = 4;
+
   struct PerClass {
     u32 count;
     u32 max_count;
+    u32 initial_max_count;
     uptr class_size;
     CompactPtrT chunks[2 * SizeClassMap::kMaxNumCachedHint];
   };
@@ -100,10 +107,18 @@ struct SizeClassAllocator64LocalCache {
     for (uptr i = 0; i < kNumClasses; i++) {
       PerClass *c = &per_class_[i];
       c->max_count = 2 * SizeClassMap::MaxCachedHint(i);
+      c->initial_max_count = c->max_count;
       c->class_size = Allocator::ClassIdToSize(i);
     }
   }
 
+  void GrowCache(PerClass *c) {
+    uptr limit = Min<uptr>(2 * SizeClassMap::kMaxNumCachedHint,
+                           kMaxGrowth * c->initial_max_count);
+    if (c->max_count < limit)
+      c->max_count = Min<uptr>(limit, c->max_count + c->initial_max_count);
+  }
+
   NOINLINE bool Refill(PerClass *c, SizeClassAllocator *allocator,
                        uptr class_id) {
     InitCache();
@@ -112,6 +127,7 @@ struct SizeClassAllocator64LocalCache {
                                               num_requested_chunks)))
       return false;
     c->count = num_requested_chunks;
+    GrowCache(c);
     return true;
   }
 
@@ -36,6 +36,11 @@ template<class SizeClassAllocator> struct SizeClassAllocator64LocalCache;
 //
 // A Region looks like this:
 // UserChunk1 ... UserChunkN <gap> MetaChunkN ... MetaChunk1 FreeArray
+//
+// Besides the free array, every size class has a small stash of full transfer
+// batches per NUMA domain. A thread cache draining a batch leaves it there and
+// one refilling on the same domain picks it up, neither taking the region
+// mutex; the free array is only used when the stash is full or empty.
 
 struct SizeClassAllocator64FlagMasks {  //  Bit masks.
   enum {
@@ -105,6 +110,8 @@ class SizeClassAllocator64 {
 
   NOINLINE void ReturnToAllocator(AllocatorStats *stat, uptr class_id,
                                   const CompactPtrT *chunks, uptr n_chunks) {
+    if (StashBatch(class_id, chunks, n_chunks))
+      return;
     RegionInfo *region = GetRegionInfo(class_id);
     uptr region_beg = GetRegionBeginBySizeClass(class_id);
     CompactPtrT *free_array = GetFreeArray(region_beg);
@@ -127,6 +134,8 @@ class SizeClassAllocator64 {
 
   NOINLINE bool GetFromAllocator(AllocatorStats *stat, uptr class_id,
                                  CompactPtrT *chunks, uptr n_chunks) {
+    if (UnstashBatch(class_id, chunks, n_chunks))
+      return true;
     RegionInfo *region = GetRegionInfo(class_id);
     uptr region_beg = GetRegionBeginBySizeClass(class_id);
     CompactPtrT *free_array = GetFreeArray(region_beg);
@@ -301,7 +310,8 @@ class SizeClassAllocator64 {
   }
 
   static uptr AdditionalSize() {
-    return RoundUpTo(sizeof(RegionInfo) * kNumClassesRounded,
+    return RoundUpTo(sizeof(RegionInfo) * kNumClassesRounded +
+                         sizeof(Stash) * kNumClassesRounded * kMaxNumaDomains,
                      GetPageSizeCached());
   }
 
@@ -606,6 +616,77 @@ class SizeClassAllocator64 {
     return &regions[class_id];
   }
 
+  // Stashed batches are at most as large as a thread cache ever moves at once
+  // (half its per-class capacity). Each slot is claimed by a CAS on its state,
+  // so a thread only ever waits to copy the chunks of a slot it owns.
+  static const uptr kMaxNumaDomains = 4;
+  static const uptr kStashSlots = 8;
+  static const uptr kStashBatchSize = SizeClassMap::kMaxNumCachedHint;
+  enum { kSlotEmpty, kSlotBusy, kSlotFull };
+
+  struct StashSlot {
+    atomic_uint32_t state;
+    u32 count;
+    CompactPtrT chunks[kStashBatchSize];
+  };
+
+  struct Stash {
+    StashSlot slots[kStashSlots];
+  };
+
+  Stash *GetStash(uptr class_id, uptr domain) const {
+    Stash *stashes = reinterpret_cast<Stash *>(
+        SpaceBeg() + kSpaceSize + sizeof(RegionInfo) * kNumClassesRounded);
+    return &stashes[class_id * kMaxNumaDomains + domain];
+  }
+
+  bool StashBatch(uptr class_id, const CompactPtrT *chunks, uptr n_chunks) {
+    if (n_chunks > kStashBatchSize)
+      return false;
+    Stash *stash =
+        GetStash(class_id, GetCurrentNumaDomain() % kMaxNumaDomains);
+    for (uptr i = 0; i < kStashSlots; i++) {
+      StashSlot *slot = &stash->slots[i];
+      u32 cmp = kSlotEmpty;
+      if (atomic_load(&slot->state, memory_order_relaxed) != kSlotEmpty ||
+          !atomic_compare_exchange_strong(&slot->state, &cmp, kSlotBusy,
+                                          memory_order_acquire))
+        continue;
+      internal_memcpy(slot->chunks, chunks, n_chunks * sizeof(CompactPtrT));
+      slot->count = n_chunks;
+      atomic_store(&slot->state, kSlotFull, memory_order_release);
+      return true;
+    }
+    return false;
+  }
+
+  // Takes n_chunks from a stashed batch, preferring the caller's domain.
+  bool UnstashBatch(uptr class_id, CompactPtrT *chunks, uptr n_chunks) {
+    uptr domain = GetCurrentNumaDomain() % kMaxNumaDomains;
+    for (uptr d = 0; d < kMaxNumaDomains; d++) {
+      Stash *stash = GetStash(class_id, (domain + d) % kMaxNumaDomains);
+      for (uptr i = 0; i < kStashSlots; i++) {
+        StashSlot *slot = &stash->slots[i];
+        u32 cmp = kSlotFull;
+        if (atomic_load(&slot->state, memory_order_relaxed) != kSlotFull ||
+            !atomic_compare_exchange_strong(&slot->state, &cmp, kSlotBusy,
+                                            memory_order_acquire))
+          continue;
+        if (slot->count < n_chunks) {
+          atomic_store(&slot->state, kSlotFull, memory_order_release);
+          continue;
+        }
+        slot->count -= n_chunks;
+        internal_memcpy(chunks, &slot->chunks[slot->count],
+                        n_chunks * sizeof(CompactPtrT));
+        atomic_store(&slot->state, slot->count ? kSlotFull : kSlotEmpty,
+                     memory_order_release);
+        return true;
+      }
+    }
+    return false;
+  }
+
   uptr GetMetadataEnd(uptr region_beg) const {
     return region_beg + kRegionSize - kFreeArraySize;
   }
@@ -922,6 +922,10 @@ INLINE void AvoidCVE_2016_2143() {}
 struct StackDepotStats {
   uptr n_uniq_ids;
   uptr allocated;
+  // Frames in all stored stacks, and how many of them take up space once
+  // common callers are shared.
+  uptr n_frames;
+  uptr n_stored_frames;
 };
 
 // The default value for allocator_release_to_os_interval_ms common flag to
@@ -943,6 +947,10 @@ INLINE u32 GetNumberOfCPUsCached() {
   return NumberOfCPUsCached;
 }
 
+// Returns the NUMA domain of the CPU the calling thread is running on, or 0
+// where that is not known.
+u32 GetCurrentNumaDomain();
+
 }  // namespace __sanitizer
 
 inline void *operator new(__sanitizer::operator_new_size_type size,
@@ -109,10 +109,13 @@ void BackgroundThread(void *arg) {
       StackDepotStats *stack_depot_stats = StackDepotGetStats();
       if (prev_reported_stack_depot_size * 11 / 10 <
           stack_depot_stats->allocated) {
-        Printf("%s: StackDepot: %zd ids; %zdM allocated\n",
+        Printf("%s: StackDepot: %zd ids; %zdM allocated; %zd of %zd frames "
+               "stored\n",
                SanitizerToolName,
                stack_depot_stats->n_uniq_ids,
-               stack_depot_stats->allocated >> 20);
+               stack_depot_stats->allocated >> 20,
+               stack_depot_stats->n_stored_frames,
+               stack_depot_stats->n_frames);
         prev_reported_stack_depot_size = stack_depot_stats->allocated;
       }
     }
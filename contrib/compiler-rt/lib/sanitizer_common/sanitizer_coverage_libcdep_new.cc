@@ -127,14 +127,16 @@ class TracePcGuardController {
     pc_vector.resize(i);
   }
 
-  void TracePcGuard(u32* guard, uptr pc) {
-    u32 idx = *guard;
-    if (!idx) return;
+  // Called on every edge, so skip the bounds check of operator[]: guard
+  // values are handed out by InitTracePcGuard and always fit.
+  ALWAYS_INLINE void TracePcGuard(u32 idx, uptr pc) {
+    DCHECK_LE(idx, pc_vector.size());
     // we start indices from 1.
     atomic_uintptr_t* pc_ptr =
-        reinterpret_cast<atomic_uintptr_t*>(&pc_vector[idx - 1]);
-    if (atomic_load(pc_ptr, memory_order_relaxed) == 0)
-      atomic_store(pc_ptr, pc, memory_order_relaxed);
+        reinterpret_cast<atomic_uintptr_t*>(pc_vector.data() + idx - 1);
+    if (LIKELY(atomic_load(pc_ptr, memory_order_relaxed) != 0))
+      return;
+    atomic_store(pc_ptr, pc, memory_order_relaxed);
   }
 
   void Reset() {
@@ -174,8 +176,9 @@ SANITIZER_INTERFACE_ATTRIBUTE void __sanitizer_dump_coverage(  // NOLINT
 }
 
 SANITIZER_INTERFACE_WEAK_DEF(void, __sanitizer_cov_trace_pc_guard, u32* guard) {
-  if (!*guard) return;
-  __sancov::pc_guard_controller.TracePcGuard(guard, GET_CALLER_PC() - 1);
+  u32 idx = *guard;
+  if (!idx) return;
+  __sancov::pc_guard_controller.TracePcGuard(idx, GET_CALLER_PC() - 1);
 }
 
 SANITIZER_INTERFACE_WEAK_DEF(void, __sanitizer_cov_trace_pc_guard_init,
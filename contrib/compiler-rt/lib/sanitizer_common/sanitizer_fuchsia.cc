@@ -510,6 +510,10 @@ u32 GetNumberOfCPUs() {
   return zx_system_get_num_cpus();
 }
 
+u32 GetCurrentNumaDomain() {
+  return 0;
+}
+
 uptr GetRSS() { UNIMPLEMENTED(); }
 
 }  // namespace __sanitizer
@@ -53,6 +53,7 @@
 
 #if SANITIZER_LINUX
 #include <sys/prctl.h>
+#include <sys/syscall.h>
 #endif
 
 #if SANITIZER_ANDROID
@@ -349,6 +350,9 @@ static void **ThreadSelfSegbase() {
 # elif defined(__x86_64__)
   // sysarch(AMD64_GET_FSBASE, segbase);
   __asm __volatile("movq %%fs:0, %0" : "=r" (segbase));
+# elif defined(__riscv)
+  // Variant I: tp points right past the two-word TCB {dtv, thread}.
+  __asm __volatile("addi %0, tp, -16" : "=r" (segbase));
 # else
 #  error "unsupported CPU arch"
 # endif
@@ -356,7 +360,11 @@ static void **ThreadSelfSegbase() {
 }
 
 uptr ThreadSelf() {
+# if defined(__riscv)
+  return (uptr)ThreadSelfSegbase()[1];
+# else
   return (uptr)ThreadSelfSegbase()[2];
+# endif
 }
 #endif  // SANITIZER_FREEBSD
 
@@ -374,7 +382,9 @@ static struct tls_tcb * ThreadSelfTlsTcb() {
 uptr ThreadSelf() {
   return (uptr)ThreadSelfTlsTcb()->tcb_pthread;
 }
+#endif  // SANITIZER_NETBSD
 
+#if SANITIZER_NETBSD || (SANITIZER_FREEBSD && defined(__riscv))
 int GetSizeFromHdr(struct dl_phdr_info *info, size_t size, void *data) {
   const Elf_Phdr *hdr = info->dlpi_phdr;
   const Elf_Phdr *last_hdr = hdr + info->dlpi_phnum;
@@ -387,7 +397,7 @@ int GetSizeFromHdr(struct dl_phdr_info *info, size_t size, void *data) {
   }
   return 0;
 }
-#endif  // SANITIZER_NETBSD
+#endif
 
 #if !SANITIZER_GO
 static void GetTls(uptr *addr, uptr *size) {
@@ -410,6 +420,15 @@ static void GetTls(uptr *addr, uptr *size) {
   *addr = 0;
   *size = 0;
   if (segbase != 0) {
+# if defined(__riscv)
+    // Variant I: dtv = segbase[0] and the TLS block of the main program,
+    // dtv[2], starts right after the TCB.  rtld does not export the size of
+    // the static TLS area, so only the main program's block is reported.
+    void **dtv = (void**) segbase[0];
+    *addr = (uptr) dtv[2];
+    if (*addr != 0)
+      dl_iterate_phdr(GetSizeFromHdr, size);
+# else
     // tcbalign = 16
     // tls_size = round(tls_static_space, tcbalign);
     // dtv = segbase[1];
@@ -417,6 +436,7 @@ static void GetTls(uptr *addr, uptr *size) {
     void **dtv = (void**) segbase[1];
     *addr = (uptr) dtv[2];
     *size = (*addr == 0) ? 0 : ((uptr) segbase[0] - (uptr) dtv[2]);
+# endif
   }
 #elif SANITIZER_NETBSD
   struct tls_tcb * const tcb = ThreadSelfTlsTcb();
@@ -664,6 +684,15 @@ u32 GetNumberOfCPUs() {
 #endif
 }
 
+u32 GetCurrentNumaDomain() {
+#if SANITIZER_LINUX && defined(__NR_getcpu)
+  unsigned cpu, node;
+  if (syscall(__NR_getcpu, &cpu, &node, nullptr) == 0)
+    return node;
+#endif
+  return 0;
+}
+
 #if SANITIZER_LINUX
 
 # if SANITIZER_ANDROID
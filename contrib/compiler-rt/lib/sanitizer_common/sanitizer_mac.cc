@@ -1021,6 +1021,10 @@ u32 GetNumberOfCPUs() {
   UNIMPLEMENTED();
 }
 
+u32 GetCurrentNumaDomain() {
+  return 0;
+}
+
 }  // namespace __sanitizer
 
 #endif  // SANITIZER_MAC
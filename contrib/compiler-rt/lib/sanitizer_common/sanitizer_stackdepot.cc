@@ -18,13 +18,113 @@
 
 namespace __sanitizer {
 
+// Frames are kept in a trie rooted at the outermost frame, so stacks that
+// share their callers share the storage for them. Each trie node holds a run
+// of frames, innermost first like a StackTrace. A node continues the path of
+// the outermost parent_keep frames of its parent, so a stack can branch off
+// in the middle of a run without the run being split. A path is named by its
+// innermost node and how many of that node's outermost frames it uses.
+struct StackTrieNode {
+  StackTrieNode *link;  // Next node in the same bucket of trie_tab.
+  const StackTrieNode *parent;
+  u32 parent_keep;
+  u32 size;
+  uptr frames[1];  // [size]
+};
+
+static const u32 kTrieTabSizeLog = 18;
+static const u32 kTrieTabSize = 1 << kTrieTabSizeLog;
+// Maps (parent, parent_keep, outermost frame) to the trie node.
+static atomic_uintptr_t trie_tab[kTrieTabSize];
+static atomic_uintptr_t trie_allocated;
+static atomic_uintptr_t trie_frames;
+static atomic_uintptr_t depot_frames;
+
+static u32 TrieEdgeHash(const StackTrieNode *parent, u32 keep, uptr pc) {
+  u64 h = (u64)(uptr)parent * 0x9e3779b97f4a7c15ULL;
+  h ^= ((u64)keep << 32) ^ pc;
+  h ^= h >> 29;
+  h *= 0xbf58476d1ce4e5b9ULL;
+  h ^= h >> 32;
+  return (u32)h;
+}
+
+static StackTrieNode *TrieFindEdge(StackTrieNode *s, StackTrieNode *end,
+                                   const StackTrieNode *parent, u32 keep,
+                                   uptr pc) {
+  for (; s != end; s = s->link) {
+    if (s->parent == parent && s->parent_keep == keep &&
+        s->frames[s->size - 1] == pc)
+      return s;
+  }
+  return nullptr;
+}
+
+// Adds the frames of a stack to the trie and returns its innermost node;
+// *keep is set to how many of that node's frames the stack uses. Like
+// StackDepotBase::Put, new nodes are published with a CAS on the bucket head.
+static const StackTrieNode *TrieInsert(const uptr *trace, u32 size,
+                                       u32 *keep) {
+  const StackTrieNode *parent = nullptr;
+  u32 parent_keep = 0;
+  // trace[0, pos) still has to be placed.
+  u32 pos = size;
+  while (pos > 0) {
+    uptr pc = trace[pos - 1];
+    atomic_uintptr_t *p = &trie_tab[TrieEdgeHash(parent, parent_keep, pc) %
+                                    kTrieTabSize];
+    uptr head = atomic_load(p, memory_order_consume);
+    const StackTrieNode *child = TrieFindEdge((StackTrieNode *)head, nullptr,
+                                              parent, parent_keep, pc);
+    if (!child) {
+      // Nothing shares the rest of this stack; store it as one run.
+      uptr memsz = sizeof(StackTrieNode) + (pos - 1) * sizeof(uptr);
+      StackTrieNode *s = (StackTrieNode *)PersistentAlloc(memsz);
+      atomic_fetch_add(&trie_allocated, memsz, memory_order_relaxed);
+      s->parent = parent;
+      s->parent_keep = parent_keep;
+      s->size = pos;
+      internal_memcpy(s->frames, trace, pos * sizeof(uptr));
+      for (;;) {
+        s->link = (StackTrieNode *)head;
+        if (atomic_compare_exchange_weak(p, &head, (uptr)s,
+                                         memory_order_release)) {
+          atomic_fetch_add(&trie_frames, pos, memory_order_relaxed);
+          *keep = pos;
+          return s;
+        }
+        // Someone else may have added the same edge; then s goes unused.
+        child = TrieFindEdge((StackTrieNode *)head, s->link, parent,
+                             parent_keep, pc);
+        if (child)
+          break;
+      }
+    }
+    // Follow the run for as long as it matches the stack.
+    u32 matched = 1;
+    while (matched < child->size && matched < pos &&
+           child->frames[child->size - 1 - matched] ==
+               trace[pos - 1 - matched])
+      matched++;
+    pos -= matched;
+    parent = child;
+    parent_keep = matched;
+  }
+  *keep = parent_keep;
+  return parent;
+}
+
 struct StackDepotNode {
   StackDepotNode *link;
   u32 id;
   atomic_uint32_t hash_and_use_count; // hash_bits : 12; use_count : 20;
   u32 size;
   u32 tag;
-  uptr stack[1];  // [size]
+  const StackTrieNode *frames;
+  u32 keep;
+  // Flat copy of the frames for load(), made the first time the stack is
+  // loaded if its frames are spread over more than one trie node.
+  atomic_uintptr_t flat;
 
   static const u32 kTabSizeLog = 20;
   // Lower kTabSizeLog bits are equal for all items in one bucket.
@@ -41,13 +141,17 @@ struct StackDepotNode {
     if ((hash & kHashMask) != hash_bits || args.size != size || args.tag != tag)
       return false;
     uptr i = 0;
-    for (; i < size; i++) {
-      if (stack[i] != args.trace[i]) return false;
+    u32 k = keep;
+    for (const StackTrieNode *n = frames; n;
+         k = n->parent_keep, n = n->parent) {
+      for (u32 j = n->size - k; j < n->size; j++, i++) {
+        if (n->frames[j] != args.trace[i]) return false;
+      }
     }
     return true;
   }
   static uptr storage_size(const args_type &args) {
-    return sizeof(StackDepotNode) + (args.size - 1) * sizeof(uptr);
+    return sizeof(StackDepotNode);
   }
   static u32 hash(const args_type &args) {
     // murmur2
@@ -75,10 +179,32 @@ struct StackDepotNode {
     atomic_store(&hash_and_use_count, hash & kHashMask, memory_order_relaxed);
     size = args.size;
     tag = args.tag;
-    internal_memcpy(stack, args.trace, size * sizeof(uptr));
+    frames = TrieInsert(args.trace, size, &keep);
+    atomic_store(&flat, 0, memory_order_relaxed);
   }
-  args_type load() const {
-    return args_type(&stack[0], size, tag);
+  args_type load() {
+    // A path that starts at the root is contiguous already.
+    if (!frames->parent)
+      return args_type(&frames->frames[frames->size - keep], size, tag);
+    uptr v = atomic_load(&flat, memory_order_acquire);
+    if (!v) {
+      uptr memsz = size * sizeof(uptr);
+      uptr *trace = (uptr *)PersistentAlloc(memsz);
+      atomic_fetch_add(&trie_allocated, memsz, memory_order_relaxed);
+      uptr i = 0;
+      u32 k = keep;
+      for (const StackTrieNode *n = frames; n;
+           k = n->parent_keep, n = n->parent) {
+        internal_memcpy(&trace[i], &n->frames[n->size - k], k * sizeof(uptr));
+        i += k;
+      }
+      CHECK_EQ(i, size);
+      // If another thread got there first, use its copy.
+      if (atomic_compare_exchange_strong(&flat, &v, (uptr)trace,
+                                         memory_order_acq_rel))
+        v = (uptr)trace;
+    }
+    return args_type((const uptr *)v, size, tag);
   }
   StackDepotHandle get_handle() { return StackDepotHandle(this); }
 
@@ -105,16 +231,31 @@ typedef StackDepotBase<StackDepotNode, 1, StackDepotNode::kTabSizeLog>
 static StackDepot theDepot;
 
 StackDepotStats *StackDepotGetStats() {
-  return theDepot.GetStats();
+  static StackDepotStats stats;
+  StackDepotStats *depot_stats = theDepot.GetStats();
+  stats.n_uniq_ids = depot_stats->n_uniq_ids;
+  stats.allocated = depot_stats->allocated +
+                    atomic_load(&trie_allocated, memory_order_relaxed);
+  stats.n_frames = atomic_load(&depot_frames, memory_order_relaxed);
+  stats.n_stored_frames = atomic_load(&trie_frames, memory_order_relaxed);
+  return &stats;
+}
+
+static StackDepotHandle PutAndCount(StackTrace stack) {
+  bool inserted;
+  StackDepotHandle h = theDepot.Put(stack, &inserted);
+  if (inserted)
+    atomic_fetch_add(&depot_frames, stack.size, memory_order_relaxed);
+  return h;
 }
 
 u32 StackDepotPut(StackTrace stack) {
-  StackDepotHandle h = theDepot.Put(stack);
+  StackDepotHandle h = PutAndCount(stack);
   return h.valid() ? h.id() : 0;
 }
 
 StackDepotHandle StackDepotPut_WithHandle(StackTrace stack) {
-  return theDepot.Put(stack);
+  return PutAndCount(stack);
 }
 
 StackTrace StackDepotGet(u32 id) {
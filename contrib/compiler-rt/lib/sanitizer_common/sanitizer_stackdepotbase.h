@@ -37,7 +37,7 @@ class StackDepotBase {
   void UnlockAll();
 
  private:
-  static Node *find(Node *s, args_type args, u32 hash);
+  static Node *find(Node *s, args_type args, u32 hash, Node *end = nullptr);
   static Node *lock(atomic_uintptr_t *p);
   static void unlock(atomic_uintptr_t *p, Node *s);
 
@@ -60,9 +60,10 @@ class StackDepotBase {
 template <class Node, int kReservedBits, int kTabSizeLog>
 Node *StackDepotBase<Node, kReservedBits, kTabSizeLog>::find(Node *s,
                                                              args_type args,
-                                                             u32 hash) {
-  // Searches linked list s for the stack, returns its id.
-  for (; s; s = s->link) {
+                                                             u32 hash,
+                                                             Node *end) {
+  // Searches linked list s up to end for the stack, returns its id.
+  for (; s != end; s = s->link) {
     if (s->eq(hash, args)) {
       return s;
     }
@@ -106,31 +107,41 @@ StackDepotBase<Node, kReservedBits, kTabSizeLog>::Put(args_type args,
   // First, try to find the existing stack.
   Node *node = find(s, args, h);
   if (node) return node->get_handle();
-  // If failed, lock, retry and insert new.
-  Node *s2 = lock(p);
-  if (s2 != s) {
-    node = find(s2, args, h);
-    if (node) {
-      unlock(p, s2);
-      return node->get_handle();
-    }
-  }
+  // If failed, build a new node and push it onto the list with a CAS. Nodes
+  // are only ever pushed at the head, so when the CAS fails just the nodes
+  // pushed since we last looked need to be searched for a duplicate. The loser
+  // of a race to insert the same stack leaves its node (and id) unused.
   uptr part = (h % kTabSize) / kPartSize;
   u32 id = atomic_fetch_add(&seq[part], 1, memory_order_relaxed) + 1;
-  stats.n_uniq_ids++;
   CHECK_LT(id, kMaxId);
   id |= part << kPartShift;
   CHECK_NE(id, 0);
   CHECK_EQ(id & (((u32)-1) >> kReservedBits), id);
   uptr memsz = Node::storage_size(args);
-  s = (Node *)PersistentAlloc(memsz);
+  node = (Node *)PersistentAlloc(memsz);
   stats.allocated += memsz;
-  s->id = id;
-  s->store(args, h);
-  s->link = s2;
-  unlock(p, s);
+  node->id = id;
+  node->store(args, h);
+  for (;;) {
+    Node *s2 = (Node *)(v & ~1);
+    if (s2 != s) {
+      Node *dup = find(s2, args, h, s);
+      if (dup) return dup->get_handle();
+      s = s2;
+    }
+    if (v & 1) {
+      // The list is held by LockAll().
+      internal_sched_yield();
+      v = atomic_load(p, memory_order_consume);
+      continue;
+    }
+    node->link = s;
+    if (atomic_compare_exchange_weak(p, &v, (uptr)node, memory_order_release))
+      break;
+  }
+  stats.n_uniq_ids++;
   if (inserted) *inserted = true;
-  return s->get_handle();
+  return node->get_handle();
 }
 
 template <class Node, int kReservedBits, int kTabSizeLog>
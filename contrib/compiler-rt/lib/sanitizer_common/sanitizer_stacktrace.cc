@@ -90,6 +90,10 @@ void BufferedStackTrace::FastUnwindStack(uptr pc, uptr bp, uptr stack_top,
     uhwptr pc1 = caller_frame[2];
 #elif defined(__s390__)
     uhwptr pc1 = frame[14];
+#elif defined(__riscv)
+    // The frame pointer points to the CFA; the return address and the
+    // caller's frame pointer are saved right below it.
+    uhwptr pc1 = frame[-1];
 #else
     uhwptr pc1 = frame[1];
 #endif
@@ -102,7 +106,11 @@ void BufferedStackTrace::FastUnwindStack(uptr pc, uptr bp, uptr stack_top,
       trace_buffer[size++] = (uptr) pc1;
     }
     bottom = (uptr)frame;
+#if defined(__riscv)
+    frame = GetCanonicFrame((uptr)frame[-2], stack_top, bottom);
+#else
     frame = GetCanonicFrame((uptr)frame[0], stack_top, bottom);
+#endif
   }
 }
 
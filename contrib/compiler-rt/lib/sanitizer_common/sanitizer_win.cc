@@ -1111,6 +1111,10 @@ u32 GetNumberOfCPUs() {
   UNIMPLEMENTED();
 }
 
+u32 GetCurrentNumaDomain() {
+  return 0;
+}
+
 }  // namespace __sanitizer
 
 #endif  // _WIN32
@@ -80,6 +80,8 @@ struct ucontext_t {
 #define PTHREAD_ABI_BASE  "GLIBC_2.3.2"
 #elif defined(__aarch64__) || SANITIZER_PPC64V2
 #define PTHREAD_ABI_BASE  "GLIBC_2.17"
+#elif defined(__riscv)
+#define PTHREAD_ABI_BASE  "GLIBC_2.27"
 #endif
 
 extern "C" int pthread_attr_init(void *attr);
@@ -503,7 +505,11 @@ static void LongJmp(ThreadState *thr, uptr *env) {
 #ifdef __powerpc__
   uptr mangled_sp = env[0];
 #elif SANITIZER_FREEBSD
+# ifdef __riscv
+  uptr mangled_sp = env[1];
+# else
   uptr mangled_sp = env[2];
+# endif
 #elif SANITIZER_NETBSD
   uptr mangled_sp = env[6];
 #elif SANITIZER_MAC
@@ -517,6 +523,8 @@ static void LongJmp(ThreadState *thr, uptr *env) {
   uptr mangled_sp = env[13];
 # elif defined(__mips64)
   uptr mangled_sp = env[1];
+# elif defined(__riscv)
+  uptr mangled_sp = env[13];
 # else
   uptr mangled_sp = env[6];
 # endif
@@ -222,6 +222,14 @@ void InitializePlatformEarly() {
     Printf("FATAL: Found %d - Supported 44, 46, and 47\n", vmaSize);
     Die();
   }
+#elif defined(__riscv)
+  // The top bit of the virtual address space is reserved for the kernel.
+  vmaSize = vmaSize + 1;
+  if (vmaSize != 39 && vmaSize != 48) {
+    Printf("FATAL: ThreadSanitizer: unsupported VMA range\n");
+    Printf("FATAL: Found %d - Supported 39 and 48\n", vmaSize);
+    Die();
+  }
 #endif
 #endif
 }
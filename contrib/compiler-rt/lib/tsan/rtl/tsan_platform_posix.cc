@@ -61,6 +61,10 @@ void InitializeShadowMemory() {
   } else {
     DCHECK(0);
   }
+#elif defined(__riscv)
+  // Modules are mapped at the bottom of the address space on FreeBSD.
+  uptr kMadviseRangeBeg = LoAppMemBeg();
+  uptr kMadviseRangeSize = LoAppMemEnd() - LoAppMemBeg();
 #elif defined(__powerpc64__)
   uptr kMadviseRangeBeg = 0;
   uptr kMadviseRangeSize = 0;
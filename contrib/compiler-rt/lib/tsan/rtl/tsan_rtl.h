@@ -55,7 +55,8 @@ namespace __tsan {
 
 #if !SANITIZER_GO
 struct MapUnmapCallback;
-#if defined(__mips64) || defined(__aarch64__) || defined(__powerpc__)
+#if defined(__mips64) || defined(__aarch64__) || defined(__powerpc__) || \
+    defined(__riscv)
 static const uptr kAllocatorRegionSizeLog = 20;
 static const uptr kAllocatorNumRegions =
     SANITIZER_MMAP_RANGE_SIZE >> kAllocatorRegionSizeLog;
@@ -820,6 +821,14 @@ void AcquireReleaseImpl(ThreadState *thr, uptr pc, SyncClock *c);
                        "add $1024, %%rsp;" \
                        CFI_INL_ADJUST_CFA_OFFSET(-1024) \
                        ::: "memory", "cc");
+#elif !SANITIZER_DEBUG && defined(__riscv)
+// There is no red zone to protect and the return address goes to t0, so
+// neither the stack pointer nor ra of the caller is touched.
+#define HACKY_CALL(f) \
+  __asm__ __volatile__(".hidden " #f "_thunk;" \
+                       "1: auipc t0, %%pcrel_hi(" #f "_thunk);" \
+                       "jalr t0, %%pcrel_lo(1b)(t0);" \
+                       ::: "memory", "t0");
 #else
 #define HACKY_CALL(f) f()
 #endif
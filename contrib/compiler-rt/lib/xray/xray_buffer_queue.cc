@@ -20,27 +20,101 @@
 using namespace __xray;
 using namespace __sanitizer;
 
-BufferQueue::BufferQueue(size_t B, size_t N, bool &Success)
-    : BufferSize(B), Buffers(new BufferRep[N]()), BufferCount(N), Finalizing{0},
-      OwnedBuffers(new void *[N]()), Next(Buffers), First(Buffers),
-      LiveBuffers(0) {
-  for (size_t i = 0; i < N; ++i) {
-    auto &T = Buffers[i];
-    void *Tmp = InternalAlloc(BufferSize, nullptr, 64);
-    if (Tmp == nullptr) {
-      Success = false;
-      return;
+void BufferQueue::Ring::init(size_t N) {
+  atomic_store(&Head, 0, memory_order_relaxed);
+  atomic_store(&Tail, 0, memory_order_relaxed);
+  Cells = new Cell[N]();
+  Capacity = N;
+  for (size_t I = 0; I < N; ++I)
+    atomic_store(&Cells[I].Sequence, I, memory_order_relaxed);
+}
+
+void BufferQueue::Ring::push(uint32_t Index) {
+  u64 Pos = atomic_load(&Tail, memory_order_relaxed);
+  for (;;) {
+    Cell &C = Cells[Pos % Capacity];
+    u64 Seq = atomic_load(&C.Sequence, memory_order_acquire);
+    s64 Diff = static_cast<s64>(Seq - Pos);
+    if (Diff == 0) {
+      if (atomic_compare_exchange_weak(&Tail, &Pos, Pos + 1,
+                                       memory_order_relaxed)) {
+        C.Index = Index;
+        atomic_store(&C.Sequence, Pos + 1, memory_order_release);
+        return;
+      }
+    } else if (Diff < 0) {
+      // The cell still belongs to a consumer of the previous lap. The ring
+      // cannot really be full, so wait for that consumer to finish.
+      proc_yield(1);
+      Pos = atomic_load(&Tail, memory_order_relaxed);
+    } else {
+      Pos = atomic_load(&Tail, memory_order_relaxed);
     }
-    void *Extents = InternalAlloc(sizeof(BufferExtents), nullptr, 64);
-    if (Extents == nullptr) {
-      Success = false;
-      return;
+  }
+}
+
+bool BufferQueue::Ring::pop(uint32_t &Index) {
+  u64 Pos = atomic_load(&Head, memory_order_relaxed);
+  for (;;) {
+    Cell &C = Cells[Pos % Capacity];
+    u64 Seq = atomic_load(&C.Sequence, memory_order_acquire);
+    s64 Diff = static_cast<s64>(Seq - (Pos + 1));
+    if (Diff == 0) {
+      if (atomic_compare_exchange_weak(&Head, &Pos, Pos + 1,
+                                       memory_order_relaxed)) {
+        Index = C.Index;
+        atomic_store(&C.Sequence, Pos + Capacity, memory_order_release);
+        return true;
+      }
+    } else if (Diff < 0) {
+      return false; // Empty.
+    } else {
+      Pos = atomic_load(&Head, memory_order_relaxed);
     }
-    auto &Buf = T.Buff;
-    Buf.Buffer = Tmp;
+  }
+}
+
+// The ring the calling thread last got a buffer from, plus one; zero until
+// the thread first asks.
+static thread_local uint32_t RingHint = 0;
+static atomic_uint32_t NextRingHint{0};
+
+size_t BufferQueue::ringHint() const {
+  if (RingHint == 0)
+    RingHint = atomic_fetch_add(&NextRingHint, 1, memory_order_relaxed) + 1;
+  return (RingHint - 1) % RingCount;
+}
+
+BufferQueue::BufferQueue(size_t B, size_t N, bool &Success, bool Streaming)
+    : BufferSize(B), Buffers(new BufferRep[N]()), BufferCount(N), Finalizing{0},
+      Streaming(Streaming), Refused{0}, BufferMemory(nullptr),
+      ExtentsMemory(nullptr),
+      RingCount(N < MaxRings ? (N ? N : 1) : MaxRings) {
+  Rings = reinterpret_cast<Ring *>(
+      InternalAlloc(sizeof(Ring) * RingCount, nullptr, 64));
+  // Any ring may end up holding every buffer, since a thread releases into
+  // the ring it took its buffer from.
+  for (size_t I = 0; I < RingCount; ++I)
+    Rings[I].init(N);
+  Completed.init(N ? N : 1);
+  Success = false;
+  if (N == 0)
+    return;
+
+  BufferMemory =
+      reinterpret_cast<char *>(InternalAlloc(BufferSize * N, nullptr, 64));
+  if (BufferMemory == nullptr)
+    return;
+  ExtentsMemory = reinterpret_cast<BufferExtents *>(
+      InternalAlloc(sizeof(BufferExtents) * N, nullptr, 64));
+  if (ExtentsMemory == nullptr)
+    return;
+  for (size_t i = 0; i < N; ++i) {
+    auto &Buf = Buffers[i].Buff;
+    Buf.Buffer = BufferMemory + i * BufferSize;
     Buf.Size = B;
-    Buf.Extents = reinterpret_cast<BufferExtents *>(Extents);
-    OwnedBuffers[i] = Tmp;
+    Buf.Extents = ExtentsMemory + i;
+    Rings[i % RingCount].push(static_cast<uint32_t>(i));
   }
   Success = true;
 }
@@ -48,53 +122,70 @@ BufferQueue::BufferQueue(size_t B, size_t N, bool &Success)
 BufferQueue::ErrorCode BufferQueue::getBuffer(Buffer &Buf) {
   if (__sanitizer::atomic_load(&Finalizing, __sanitizer::memory_order_acquire))
     return ErrorCode::QueueFinalizing;
-  __sanitizer::SpinMutexLock Guard(&Mutex);
-  if (LiveBuffers == BufferCount)
-    return ErrorCode::NotEnoughMemory;
-
-  auto &T = *Next;
-  auto &B = T.Buff;
-  Buf = B;
-  T.Used = true;
-  ++LiveBuffers;
 
-  if (++Next == (Buffers + BufferCount))
-    Next = Buffers;
-
-  return ErrorCode::Ok;
+  size_t Start = ringHint();
+  uint32_t Index;
+  for (size_t I = 0; I < RingCount; ++I) {
+    size_t R = (Start + I) % RingCount;
+    if (!Rings[R].pop(Index))
+      continue;
+    if (I != 0)
+      RingHint = static_cast<uint32_t>(R + 1);
+    auto &T = Buffers[Index];
+    atomic_store(&T.Live, 1, memory_order_relaxed);
+    atomic_store(&T.Used, 1, memory_order_release);
+    Buf = T.Buff;
+    return ErrorCode::Ok;
+  }
+  atomic_fetch_add(&Refused, 1, memory_order_relaxed);
+  return ErrorCode::NotEnoughMemory;
 }
 
 BufferQueue::ErrorCode BufferQueue::releaseBuffer(Buffer &Buf) {
-  // Blitz through the buffers array to find the buffer.
-  bool Found = false;
-  for (auto I = OwnedBuffers, E = OwnedBuffers + BufferCount; I != E; ++I) {
-    if (*I == Buf.Buffer) {
-      Found = true;
-      break;
-    }
-  }
-  if (!Found)
+  // Find the buffer's index from its address.
+  char *P = reinterpret_cast<char *>(Buf.Buffer);
+  if (P < BufferMemory || P >= BufferMemory + BufferSize * BufferCount ||
+      (P - BufferMemory) % BufferSize != 0)
     return ErrorCode::UnrecognizedBuffer;
-
-  __sanitizer::SpinMutexLock Guard(&Mutex);
+  size_t Index = (P - BufferMemory) / BufferSize;
 
   // This points to a semantic bug, we really ought to not be releasing more
   // buffers than we actually get.
-  if (LiveBuffers == 0)
+  auto &T = Buffers[Index];
+  uint8_t Expected = 1;
+  if (!atomic_compare_exchange_strong(&T.Live, &Expected, 0,
+                                      memory_order_acq_rel))
     return ErrorCode::NotEnoughMemory;
 
-  // Now that the buffer has been released, we mark it as "used".
-  First->Buff = Buf;
-  First->Used = true;
   Buf.Buffer = nullptr;
   Buf.Size = 0;
-  --LiveBuffers;
-  if (++First == (Buffers + BufferCount))
-    First = Buffers;
-
+  if (Streaming &&
+      atomic_load(&T.Buff.Extents->Size, memory_order_acquire) != 0)
+    Completed.push(static_cast<uint32_t>(Index));
+  else
+    Rings[ringHint()].push(static_cast<uint32_t>(Index));
   return ErrorCode::Ok;
 }
 
+bool BufferQueue::takeCompleted(Buffer &Buf) {
+  uint32_t Index;
+  if (!Streaming || !Completed.pop(Index))
+    return false;
+  Buf = Buffers[Index].Buff;
+  return true;
+}
+
+void BufferQueue::recycleCompleted(Buffer &Buf) {
+  size_t Index =
+      (reinterpret_cast<char *>(Buf.Buffer) - BufferMemory) / BufferSize;
+  // Once the extents are cleared, apply() no longer writes this buffer, so
+  // the final flush does not repeat what has already been streamed.
+  atomic_store(&Buf.Extents->Size, 0, memory_order_release);
+  Buf.Buffer = nullptr;
+  Buf.Size = 0;
+  Rings[Index % RingCount].push(static_cast<uint32_t>(Index));
+}
+
 BufferQueue::ErrorCode BufferQueue::finalize() {
   if (__sanitizer::atomic_exchange(&Finalizing, 1,
                                    __sanitizer::memory_order_acq_rel))
@@ -103,12 +194,13 @@ BufferQueue::ErrorCode BufferQueue::finalize() {
 }
 
 BufferQueue::~BufferQueue() {
-  for (auto I = Buffers, E = Buffers + BufferCount; I != E; ++I) {
-    auto &T = *I;
-    auto &Buf = T.Buff;
-    InternalFree(Buf.Buffer);
-    InternalFree(Buf.Extents);
-  }
+  for (size_t I = 0; I < RingCount; ++I)
+    delete[] Rings[I].Cells;
+  delete[] Completed.Cells;
+  InternalFree(Rings);
+  if (BufferMemory != nullptr)
+    InternalFree(BufferMemory);
+  if (ExtentsMemory != nullptr)
+    InternalFree(ExtentsMemory);
   delete[] Buffers;
-  delete[] OwnedBuffers;
 }
@@ -16,8 +16,8 @@
 #define XRAY_BUFFER_QUEUE_H
 
 #include <cstddef>
+#include <cstdint>
 #include "sanitizer_common/sanitizer_atomic.h"
-#include "sanitizer_common/sanitizer_mutex.h"
 
 namespace __xray {
 
@@ -43,32 +43,68 @@ class BufferQueue {
     // The managed buffer.
     Buffer Buff;
 
-    // This is true if the buffer has been returned to the available queue, and
-    // is considered "used" by another thread.
-    bool Used = false;
+    // This is true if the buffer has been handed out at least once, and is
+    // considered "used" by another thread.
+    __sanitizer::atomic_uint8_t Used;
+
+    // This is true while the buffer is held by a thread, between getBuffer and
+    // releaseBuffer.
+    __sanitizer::atomic_uint8_t Live;
+  };
+
+  // A bounded multi-producer multi-consumer ring of indices into Buffers. Each
+  // cell carries a sequence number that tells producers and consumers whether
+  // it is theirs to fill or drain, so neither side takes a lock.
+  struct Cell {
+    __sanitizer::atomic_uint64_t Sequence;
+    uint32_t Index;
   };
 
+  struct alignas(64) Ring {
+    __sanitizer::atomic_uint64_t Head;
+    char Pad0[64 - sizeof(__sanitizer::atomic_uint64_t)];
+    __sanitizer::atomic_uint64_t Tail;
+    char Pad1[64 - sizeof(__sanitizer::atomic_uint64_t)];
+    Cell *Cells;
+    size_t Capacity;
+
+    void init(size_t N);
+    // Never fails: every ring has room for all the buffers.
+    void push(uint32_t Index);
+    bool pop(uint32_t &Index);
+  };
+
+  // Free buffers are spread over a few rings. A thread keeps going back to the
+  // ring it last got a buffer from, and only looks at the others when that one
+  // is empty, so the threads do not all contend on a single pair of counters.
+  static constexpr size_t MaxRings = 8;
+
   // Size of each individual Buffer.
   size_t BufferSize;
 
   BufferRep *Buffers;
   size_t BufferCount;
 
-  __sanitizer::SpinMutex Mutex;
   __sanitizer::atomic_uint8_t Finalizing;
 
-  // Pointers to buffers managed/owned by the BufferQueue.
-  void **OwnedBuffers;
+  // In streaming mode, buffers that come back with records in them are parked
+  // in Completed until the flusher has written them out and recycled them.
+  bool Streaming;
+  Ring Completed;
 
-  // Pointer to the next buffer to be handed out.
-  BufferRep *Next;
+  // Number of getBuffer calls turned away because every buffer was either
+  // held by a thread or waiting for the flusher.
+  __sanitizer::atomic_uint64_t Refused;
 
-  // Pointer to the entry in the array where the next released buffer will be
-  // placed.
-  BufferRep *First;
+  // All buffers are carved out of one allocation, so that releaseBuffer can
+  // map a buffer back to its index with arithmetic.
+  char *BufferMemory;
+  BufferExtents *ExtentsMemory;
 
-  // Count of buffers that have been handed out through 'getBuffer'.
-  size_t LiveBuffers;
+  Ring *Rings;
+  size_t RingCount;
+
+  size_t ringHint() const;
 
  public:
   enum class ErrorCode : unsigned {
@@ -97,7 +133,7 @@ class BufferQueue {
 
   /// Initialise a queue of size |N| with buffers of size |B|. We report success
   /// through |Success|.
-  BufferQueue(size_t B, size_t N, bool &Success);
+  BufferQueue(size_t B, size_t N, bool &Success, bool Streaming = false);
 
   /// Updates |Buf| to contain the pointer to an appropriate buffer. Returns an
   /// error in case there are no available buffers to return when we will run
@@ -113,7 +149,9 @@ class BufferQueue {
   ///     a finalizing/finalized BufferQueue.
   ErrorCode getBuffer(Buffer &Buf);
 
-  /// Updates |Buf| to point to nullptr, with size 0.
+  /// Updates |Buf| to point to nullptr, with size 0. In streaming mode a
+  /// buffer holding records is handed to the flusher instead of going back
+  /// to the free list.
   ///
   /// Returns:
   ///   - ErrorCode::Ok when we successfully release the buffer.
@@ -121,6 +159,25 @@ class BufferQueue {
   ///     the buffer being released.
   ErrorCode releaseBuffer(Buffer &Buf);
 
+  /// Streaming mode only: updates |Buf| to the oldest buffer released with
+  /// records in it that has not been written out yet. Returns false when there
+  /// is none.
+  bool takeCompleted(Buffer &Buf);
+
+  /// Streaming mode only: clears the extents of a buffer obtained through
+  /// takeCompleted and makes it available to getBuffer again.
+  void recycleCompleted(Buffer &Buf);
+
+  bool streaming() const { return Streaming; }
+
+  /// Returns how many times getBuffer failed for lack of a free buffer. In
+  /// streaming mode this is the number of buffers' worth of records dropped
+  /// because the flusher could not keep up.
+  uint64_t refusedCount() const {
+    return __sanitizer::atomic_load(&Refused,
+                                    __sanitizer::memory_order_relaxed);
+  }
+
   bool finalizing() const {
     return __sanitizer::atomic_load(&Finalizing,
                                     __sanitizer::memory_order_acquire);
@@ -143,10 +200,10 @@ class BufferQueue {
   /// releaseBuffer(...) operation).
   template <class F>
   void apply(F Fn) {
-    __sanitizer::SpinMutexLock G(&Mutex);
     for (auto I = Buffers, E = Buffers + BufferCount; I != E; ++I) {
       const auto &T = *I;
-      if (T.Used) Fn(T.Buff);
+      if (__sanitizer::atomic_load(&T.Used, __sanitizer::memory_order_acquire))
+        Fn(T.Buff);
     }
   }
 
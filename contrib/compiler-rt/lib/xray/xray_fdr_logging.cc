@@ -44,6 +44,122 @@ FDRLoggingOptions FDROptions;
 
 __sanitizer::SpinMutex FDROptionsMutex;
 
+// When streaming, a background thread writes out buffers as threads release
+// them, into StreamFd; fdrLoggingFlush only has to write what is left.
+static int StreamFd = -1;
+static bool StreamToSocket = false;
+static void *StreamThread = nullptr;
+static __sanitizer::atomic_uint8_t StreamRunning{0};
+static uint64_t StreamedBuffers = 0;
+static uint64_t StreamedBytes = 0;
+
+static void writeFDRHeader(int Fd,
+                           const BufferQueue &Q) XRAY_NEVER_INSTRUMENT {
+  // Test for required CPU features and cache the cycle frequency
+  static bool TSCSupported = probeRequiredCPUFeatures();
+  static uint64_t CycleFrequency =
+      TSCSupported ? getTSCFrequency() : __xray::NanosecondsPerSecond;
+
+  XRayFileHeader Header;
+
+  // Version 2 of the log writes the extents of the buffer, instead of relying
+  // on an end-of-buffer record.
+  Header.Version = 2;
+  Header.Type = FileTypes::FDR_LOG;
+  Header.CycleFrequency = CycleFrequency;
+
+  // FIXME: Actually check whether we have 'constant_tsc' and 'nonstop_tsc'
+  // before setting the values in the header.
+  Header.ConstantTSC = 1;
+  Header.NonstopTSC = 1;
+  Header.FdrData = FdrAdditionalHeaderData{Q.ConfiguredBufferSize()};
+  retryingWriteAll(Fd, reinterpret_cast<char *>(&Header),
+                   reinterpret_cast<char *>(&Header) + sizeof(Header));
+}
+
+// Returns the number of bytes of records written.
+static uint64_t
+writeFDRBuffer(int Fd, const BufferQueue::Buffer &B) XRAY_NEVER_INSTRUMENT {
+  // Starting at version 2 of the FDR logging implementation, we only write
+  // the records identified by the extents of the buffer. We use the Extents
+  // from the Buffer and write that out as the first record in the buffer.
+  // We still use a Metadata record, but fill in the extents instead for the
+  // data.
+  MetadataRecord ExtentsRecord;
+  auto BufferExtents = __sanitizer::atomic_load(
+      &B.Extents->Size, __sanitizer::memory_order_acquire);
+  assert(BufferExtents <= B.Size);
+  ExtentsRecord.Type = uint8_t(RecordType::Metadata);
+  ExtentsRecord.RecordKind =
+      uint8_t(MetadataRecord::RecordKinds::BufferExtents);
+  std::memcpy(ExtentsRecord.Data, &BufferExtents, sizeof(BufferExtents));
+  if (BufferExtents > 0) {
+    retryingWriteAll(Fd, reinterpret_cast<char *>(&ExtentsRecord),
+                     reinterpret_cast<char *>(&ExtentsRecord) +
+                         sizeof(MetadataRecord));
+    retryingWriteAll(Fd, reinterpret_cast<char *>(B.Buffer),
+                     reinterpret_cast<char *>(B.Buffer) + BufferExtents);
+  }
+  return BufferExtents;
+}
+
+static void drainCompletedBuffers() XRAY_NEVER_INSTRUMENT {
+  BufferQueue::Buffer B;
+  while (BQ->takeCompleted(B)) {
+    StreamedBytes += writeFDRBuffer(StreamFd, B);
+    ++StreamedBuffers;
+    BQ->recycleCompleted(B);
+  }
+}
+
+static void streamingThread(void *) XRAY_NEVER_INSTRUMENT {
+  while (__sanitizer::atomic_load(&StreamRunning,
+                                  __sanitizer::memory_order_acquire)) {
+    drainCompletedBuffers();
+    __sanitizer::SleepForMillis(flags()->xray_fdr_log_stream_interval_ms);
+  }
+}
+
+// Stops the streaming thread, then writes out whatever it had not picked up
+// yet. Buffers still held by threads are left for apply().
+static void stopStreaming() XRAY_NEVER_INSTRUMENT {
+  if (StreamThread == nullptr)
+    return;
+  __sanitizer::atomic_store(&StreamRunning, 0,
+                            __sanitizer::memory_order_release);
+  __sanitizer::internal_join_thread(StreamThread);
+  StreamThread = nullptr;
+  drainCompletedBuffers();
+  if (__sanitizer::Verbosity())
+    Report("XRay FDR streamed %llu buffers (%llu bytes); %llu buffer requests "
+           "were refused while the queue was drained.\n",
+           StreamedBuffers, StreamedBytes, BQ->refusedCount());
+}
+
+static bool startStreaming() XRAY_NEVER_INSTRUMENT {
+  const char *SocketPath = flags()->xray_fdr_log_stream_socket;
+  StreamToSocket = SocketPath[0] != '\0';
+  if (StreamToSocket) {
+    StreamFd = getLogSocketFD(SocketPath);
+  } else {
+    {
+      __sanitizer::SpinMutexLock Guard(&FDROptionsMutex);
+      StreamFd = FDROptions.Fd;
+    }
+    if (StreamFd == -1)
+      StreamFd = getLogFD();
+  }
+  return StreamFd != -1;
+}
+
+static void closeStream() XRAY_NEVER_INSTRUMENT {
+  // Let the reader on the other end of the socket see the end of the log.
+  if (StreamToSocket && StreamFd != -1)
+    close(StreamFd);
+  StreamFd = -1;
+  StreamToSocket = false;
+}
+
 // Must finalize before flushing.
 XRayLogFlushStatus fdrLoggingFlush() XRAY_NEVER_INSTRUMENT {
   if (__sanitizer::atomic_load(&LoggingStatus,
@@ -83,8 +199,12 @@ XRayLogFlushStatus fdrLoggingFlush() XRAY_NEVER_INSTRUMENT {
   //      (fixed-sized) and let the tools reading the buffers deal with the data
   //      afterwards.
   //
-  int Fd = -1;
-  {
+  // When streaming, the header went out when tracing started and most of the
+  // buffers have already been written and had their extents cleared, so we
+  // only stop the streaming thread and write what remains.
+  //
+  int Fd = StreamFd;
+  if (Fd == -1) {
     __sanitizer::SpinMutexLock Guard(&FDROptionsMutex);
     Fd = FDROptions.Fd;
   }
@@ -97,49 +217,14 @@ XRayLogFlushStatus fdrLoggingFlush() XRAY_NEVER_INSTRUMENT {
     return Result;
   }
 
-  // Test for required CPU features and cache the cycle frequency
-  static bool TSCSupported = probeRequiredCPUFeatures();
-  static uint64_t CycleFrequency =
-      TSCSupported ? getTSCFrequency() : __xray::NanosecondsPerSecond;
+  if (StreamThread == nullptr)
+    writeFDRHeader(Fd, *BQ);
+  else
+    stopStreaming();
 
-  XRayFileHeader Header;
+  BQ->apply([&](const BufferQueue::Buffer &B) { writeFDRBuffer(Fd, B); });
 
-  // Version 2 of the log writes the extents of the buffer, instead of relying
-  // on an end-of-buffer record.
-  Header.Version = 2;
-  Header.Type = FileTypes::FDR_LOG;
-  Header.CycleFrequency = CycleFrequency;
-
-  // FIXME: Actually check whether we have 'constant_tsc' and 'nonstop_tsc'
-  // before setting the values in the header.
-  Header.ConstantTSC = 1;
-  Header.NonstopTSC = 1;
-  Header.FdrData = FdrAdditionalHeaderData{BQ->ConfiguredBufferSize()};
-  retryingWriteAll(Fd, reinterpret_cast<char *>(&Header),
-                   reinterpret_cast<char *>(&Header) + sizeof(Header));
-
-  BQ->apply([&](const BufferQueue::Buffer &B) {
-    // Starting at version 2 of the FDR logging implementation, we only write
-    // the records identified by the extents of the buffer. We use the Extents
-    // from the Buffer and write that out as the first record in the buffer.
-    // We still use a Metadata record, but fill in the extents instead for the
-    // data.
-    MetadataRecord ExtentsRecord;
-    auto BufferExtents = __sanitizer::atomic_load(
-        &B.Extents->Size, __sanitizer::memory_order_acquire);
-    assert(BufferExtents <= B.Size);
-    ExtentsRecord.Type = uint8_t(RecordType::Metadata);
-    ExtentsRecord.RecordKind =
-        uint8_t(MetadataRecord::RecordKinds::BufferExtents);
-    std::memcpy(ExtentsRecord.Data, &BufferExtents, sizeof(BufferExtents));
-    if (BufferExtents > 0) {
-      retryingWriteAll(Fd, reinterpret_cast<char *>(&ExtentsRecord),
-                       reinterpret_cast<char *>(&ExtentsRecord) +
-                           sizeof(MetadataRecord));
-      retryingWriteAll(Fd, reinterpret_cast<char *>(B.Buffer),
-                       reinterpret_cast<char *>(B.Buffer) + BufferExtents);
-    }
-  });
+  closeStream();
 
   __sanitizer::atomic_store(&LogFlushStatus,
                             XRayLogFlushStatus::XRAY_LOG_FLUSHED,
@@ -176,6 +261,11 @@ XRayLogInitStatus fdrLoggingReset() XRAY_NEVER_INSTRUMENT {
           __sanitizer::memory_order_release))
     return static_cast<XRayLogInitStatus>(CurrentStatus);
 
+  // The streaming thread may still be using the queue if the log was never
+  // flushed.
+  stopStreaming();
+  closeStream();
+
   // Release the in-memory buffer queue.
   delete BQ;
   BQ = nullptr;
@@ -317,12 +407,20 @@ XRayLogInitStatus fdrLoggingInit(std::size_t BufferSize, std::size_t BufferMax,
   bool Success = false;
 
   if (BQ != nullptr) {
+    stopStreaming();
+    closeStream();
     delete BQ;
     BQ = nullptr;
   }
 
+  bool Streaming = flags()->xray_fdr_log_stream;
+  if (Streaming && !startStreaming()) {
+    Report("Cannot open the FDR stream; buffers will be written on flush.\n");
+    Streaming = false;
+  }
+
   if (BQ == nullptr)
-    BQ = new BufferQueue(BufferSize, BufferMax, Success);
+    BQ = new BufferQueue(BufferSize, BufferMax, Success, Streaming);
 
   if (!Success) {
     Report("BufferQueue init failed.\n");
@@ -330,9 +428,19 @@ XRayLogInitStatus fdrLoggingInit(std::size_t BufferSize, std::size_t BufferMax,
       delete BQ;
       BQ = nullptr;
     }
+    closeStream();
     return XRayLogInitStatus::XRAY_LOG_UNINITIALIZED;
   }
 
+  if (Streaming) {
+    StreamedBuffers = 0;
+    StreamedBytes = 0;
+    writeFDRHeader(StreamFd, *BQ);
+    __sanitizer::atomic_store(&StreamRunning, 1,
+                              __sanitizer::memory_order_release);
+    StreamThread = __sanitizer::internal_start_thread(streamingThread, nullptr);
+  }
+
   static bool UNUSED Once = [] {
     pthread_key_create(&__xray_fdr_internal::Key, +[](void *) {
       auto &TLD = __xray_fdr_internal::getThreadLocalData();
@@ -465,8 +465,12 @@ inline bool prepareBuffer(uint64_t TSC, unsigned char CPU,
       return false;
     auto EC = TLD.BQ->getBuffer(TLD.Buffer);
     if (EC != BufferQueue::ErrorCode::Ok) {
-      Report("Failed to acquire a buffer; error=%s\n",
-             BufferQueue::getErrorString(EC));
+      // A streaming queue running dry only means the flusher is behind; the
+      // queue counts those refusals, so don't report each one.
+      if (EC != BufferQueue::ErrorCode::NotEnoughMemory ||
+          !TLD.BQ->streaming())
+        Report("Failed to acquire a buffer; error=%s\n",
+               BufferQueue::getErrorString(EC));
       return false;
     }
     setupNewBuffer(wall_clock_reader);
@@ -513,7 +517,9 @@ isLogInitializedAndReady(BufferQueue *LBQ, uint64_t TSC, unsigned char CPU,
       auto LS = __sanitizer::atomic_load(&LoggingStatus,
                                          __sanitizer::memory_order_acquire);
       if (LS != XRayLogInitStatus::XRAY_LOG_FINALIZING &&
-          LS != XRayLogInitStatus::XRAY_LOG_FINALIZED)
+          LS != XRayLogInitStatus::XRAY_LOG_FINALIZED &&
+          (EC != BufferQueue::ErrorCode::NotEnoughMemory ||
+           !LBQ->streaming()))
         Report("Failed to acquire a buffer; error=%s\n",
                BufferQueue::getErrorString(EC));
       return false;
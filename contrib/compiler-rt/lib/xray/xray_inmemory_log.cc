@@ -61,6 +61,7 @@ struct alignas(64) ThreadLocalData {
   size_t StackEntries = 0;
   int Fd = -1;
   pid_t TID = 0;
+  uint64_t LastTSC = 0;
 };
 
 static pthread_key_t PThreadKey;
@@ -71,15 +72,107 @@ BasicLoggingOptions GlobalOptions;
 
 thread_local volatile bool RecursionGuard = false;
 
-static uint64_t thresholdTicks() XRAY_NEVER_INSTRUMENT {
+static uint64_t ticksPerSecond() XRAY_NEVER_INSTRUMENT {
   static uint64_t TicksPerSec = probeRequiredCPUFeatures()
                                     ? getTSCFrequency()
                                     : __xray::NanosecondsPerSecond;
+  return TicksPerSec;
+}
+
+static uint64_t thresholdTicks() XRAY_NEVER_INSTRUMENT {
   static const uint64_t ThresholdTicks =
-      TicksPerSec * GlobalOptions.DurationFilterMicros / 1000000;
+      ticksPerSecond() * GlobalOptions.DurationFilterMicros / 1000000;
   return ThresholdTicks;
 }
 
+// In flight recorder mode, full thread buffers are kept in memory, oldest
+// first, instead of being written out. Buffers whose last record falls out of
+// the time window, or the oldest one when there is no room left, are dropped,
+// and their memory goes to the next thread that fills up a buffer. All of this
+// is guarded by LogMutex.
+struct FlightChunk {
+  XRayRecord *Records;
+  size_t Count;
+  uint64_t LastTSC;
+};
+
+static FlightChunk *FlightChunks = nullptr;
+static size_t FlightCapacity = 0;
+static size_t FlightHead = 0;
+static size_t FlightCount = 0;
+static XRayRecord **SpareBuffers = nullptr;
+static size_t SpareCount = 0;
+static uint64_t FlightWindowTicks = 0;
+
+static bool flightRecorderEnabled() XRAY_NEVER_INSTRUMENT {
+  return FlightChunks != nullptr;
+}
+
+static void initFlightRecorder() XRAY_NEVER_INSTRUMENT {
+  int Seconds = flags()->xray_naive_log_flight_recorder_seconds;
+  int Buffers = flags()->xray_naive_log_flight_recorder_buffers;
+  if (Seconds <= 0 || Buffers <= 0 || FlightChunks != nullptr)
+    return;
+  SpareBuffers = reinterpret_cast<XRayRecord **>(
+      InternalAlloc(sizeof(XRayRecord *) * Buffers));
+  FlightWindowTicks = ticksPerSecond() * Seconds;
+  FlightCapacity = Buffers;
+  FlightChunks = reinterpret_cast<FlightChunk *>(
+      InternalAlloc(sizeof(FlightChunk) * Buffers));
+}
+
+static void dropOldestChunk() XRAY_NEVER_INSTRUMENT {
+  auto &C = FlightChunks[FlightHead];
+  if (SpareCount < FlightCapacity)
+    SpareBuffers[SpareCount++] = C.Records;
+  else
+    InternalFree(C.Records);
+  FlightHead = (FlightHead + 1) % FlightCapacity;
+  --FlightCount;
+}
+
+// Hands the first |Count| records of |Buffer| over to the flight recorder.
+// If |WantReplacement| is set, returns a buffer for the thread to carry on
+// logging into.
+static XRayRecord *retireToFlightRecorder(XRayRecord *Buffer, size_t Count,
+                                          uint64_t LastTSC,
+                                          bool WantReplacement)
+    XRAY_NEVER_INSTRUMENT {
+  {
+    __sanitizer::SpinMutexLock L(&LogMutex);
+    while (FlightCount != 0 &&
+           FlightChunks[FlightHead].LastTSC + FlightWindowTicks < LastTSC)
+      dropOldestChunk();
+    if (FlightCount == FlightCapacity)
+      dropOldestChunk();
+    FlightChunks[(FlightHead + FlightCount) % FlightCapacity] = {Buffer, Count,
+                                                                 LastTSC};
+    ++FlightCount;
+    if (!WantReplacement)
+      return nullptr;
+    if (SpareCount != 0)
+      return SpareBuffers[--SpareCount];
+  }
+  return reinterpret_cast<XRayRecord *>(
+      InternalAlloc(sizeof(XRayRecord) * GlobalOptions.ThreadBufferSize,
+                    nullptr, alignof(XRayRecord)));
+}
+
+// Writes out everything the flight recorder holds, oldest first, and empties
+// it. Records still sitting in the buffers of running threads are not part
+// of this.
+static void writeFlightRecorder(int Fd) XRAY_NEVER_INSTRUMENT {
+  if (Fd == -1 || !flightRecorderEnabled())
+    return;
+  __sanitizer::SpinMutexLock L(&LogMutex);
+  while (FlightCount != 0) {
+    auto &C = FlightChunks[FlightHead];
+    retryingWriteAll(Fd, reinterpret_cast<char *>(C.Records),
+                     reinterpret_cast<char *>(C.Records + C.Count));
+    dropOldestChunk();
+  }
+}
+
 static int openLogFile() XRAY_NEVER_INSTRUMENT {
   int F = getLogFD();
   if (F == -1)
@@ -153,6 +246,24 @@ ThreadLocalData &getThreadLocalData() XRAY_NEVER_INSTRUMENT {
   return TLD;
 }
 
+// Writes out the records in the thread's buffer, or in flight recorder mode
+// keeps them in memory, and starts the thread on an empty buffer.
+static void writeThreadBuffer(ThreadLocalData &TLD,
+                              int Fd) XRAY_NEVER_INSTRUMENT {
+  auto RecordBuffer =
+      reinterpret_cast<__xray::XRayRecord *>(TLD.InMemoryBuffer);
+  if (flightRecorderEnabled()) {
+    TLD.InMemoryBuffer = retireToFlightRecorder(RecordBuffer, TLD.BufferOffset,
+                                                TLD.LastTSC, true);
+  } else {
+    __sanitizer::SpinMutexLock L(&LogMutex);
+    retryingWriteAll(Fd, reinterpret_cast<char *>(RecordBuffer),
+                     reinterpret_cast<char *>(RecordBuffer + TLD.BufferOffset));
+  }
+  TLD.BufferOffset = 0;
+  TLD.StackEntries = 0;
+}
+
 template <class RDTSC>
 void InMemoryRawLog(int32_t FuncId, XRayEntryType Type,
                     RDTSC ReadTSC) XRAY_NEVER_INSTRUMENT {
@@ -243,14 +354,9 @@ void InMemoryRawLog(int32_t FuncId, XRayEntryType Type,
   auto EntryPtr = static_cast<char *>(InMemoryBuffer) +
                   (sizeof(__xray::XRayRecord) * TLD.BufferOffset);
   __sanitizer::internal_memcpy(EntryPtr, &R, sizeof(R));
-  if (++TLD.BufferOffset == TLD.BufferSize) {
-    __sanitizer::SpinMutexLock L(&LogMutex);
-    auto RecordBuffer = reinterpret_cast<__xray::XRayRecord *>(InMemoryBuffer);
-    retryingWriteAll(Fd, reinterpret_cast<char *>(RecordBuffer),
-                     reinterpret_cast<char *>(RecordBuffer + TLD.BufferOffset));
-    TLD.BufferOffset = 0;
-    TLD.StackEntries = 0;
-  }
+  TLD.LastTSC = TSC;
+  if (++TLD.BufferOffset == TLD.BufferSize)
+    writeThreadBuffer(TLD, Fd);
 }
 
 template <class RDTSC>
@@ -267,14 +373,8 @@ void InMemoryRawLogWithArg(int32_t FuncId, XRayEntryType Type, uint64_t Arg1,
   // First we check whether there's enough space to write the data consecutively
   // in the thread-local buffer. If not, we first flush the buffer before
   // attempting to write the two records that must be consecutive.
-  if (Offset + 2 > BuffLen) {
-    __sanitizer::SpinMutexLock L(&LogMutex);
-    auto RecordBuffer = reinterpret_cast<__xray::XRayRecord *>(InMemoryBuffer);
-    retryingWriteAll(Fd, reinterpret_cast<char *>(RecordBuffer),
-                     reinterpret_cast<char *>(RecordBuffer + Offset));
-    Offset = 0;
-    TLD.StackEntries = 0;
-  }
+  if (Offset + 2 > BuffLen)
+    writeThreadBuffer(TLD, Fd);
 
   // Then we write the "we have an argument" record.
   InMemoryRawLog(FuncId, Type, ReadTSC);
@@ -293,14 +393,8 @@ void InMemoryRawLogWithArg(int32_t FuncId, XRayEntryType Type, uint64_t Arg1,
   auto EntryPtr =
       &reinterpret_cast<__xray::XRayArgPayload *>(&InMemoryBuffer)[Offset];
   std::memcpy(EntryPtr, &R, sizeof(R));
-  if (++Offset == BuffLen) {
-    __sanitizer::SpinMutexLock L(&LogMutex);
-    auto RecordBuffer = reinterpret_cast<__xray::XRayRecord *>(InMemoryBuffer);
-    retryingWriteAll(Fd, reinterpret_cast<char *>(RecordBuffer),
-                     reinterpret_cast<char *>(RecordBuffer + Offset));
-    Offset = 0;
-    TLD.StackEntries = 0;
-  }
+  if (++Offset == BuffLen)
+    writeThreadBuffer(TLD, Fd);
 }
 
 void basicLoggingHandleArg0RealTSC(int32_t FuncId,
@@ -361,6 +455,14 @@ static void TLDDestructor(void *P) XRAY_NEVER_INSTRUMENT {
     return;
   }
 
+  if (flightRecorderEnabled()) {
+    // The flight recorder takes ownership of the buffer.
+    retireToFlightRecorder(reinterpret_cast<XRayRecord *>(TLD.InMemoryBuffer),
+                           TLD.BufferOffset, TLD.LastTSC, false);
+    TLD.InMemoryBuffer = nullptr;
+    return;
+  }
+
   {
     __sanitizer::SpinMutexLock L(&LogMutex);
     retryingWriteAll(TLD.Fd, reinterpret_cast<char *>(TLD.InMemoryBuffer),
@@ -403,6 +505,7 @@ XRayLogInitStatus basicLoggingInit(size_t BufferSize, size_t BufferMax,
            "using emulation instead.\n");
 
   GlobalOptions = *reinterpret_cast<BasicLoggingOptions *>(Options);
+  initFlightRecorder();
   __xray_set_handler_arg1(UseRealTSC ? basicLoggingHandleArg1RealTSC
                                      : basicLoggingHandleArg1EmulateTSC);
   __xray_set_handler(UseRealTSC ? basicLoggingHandleArg0RealTSC
@@ -426,8 +529,10 @@ XRayLogInitStatus basicLoggingFinalize() XRAY_NEVER_INSTRUMENT {
 }
 
 XRayLogFlushStatus basicLoggingFlush() XRAY_NEVER_INSTRUMENT {
-  // This really does nothing, since flushing the logs happen at the end of a
-  // thread's lifetime, or when the buffers are full.
+  // Outside of flight recorder mode this really does nothing, since flushing
+  // the logs happen at the end of a thread's lifetime, or when the buffers are
+  // full.
+  writeFlightRecorder(getGlobalFd());
   return XRayLogFlushStatus::XRAY_LOG_FLUSHED;
 }
 
@@ -459,7 +564,10 @@ bool basicLogDynamicInitializer() XRAY_NEVER_INSTRUMENT {
                     sizeof(BasicLoggingOptions));
     static auto UNUSED Once = [] {
       static auto UNUSED &TLD = getThreadLocalData();
-      __sanitizer::Atexit(+[] { TLDDestructor(&TLD); });
+      __sanitizer::Atexit(+[] {
+        TLDDestructor(&TLD);
+        writeFlightRecorder(getGlobalFd());
+      });
       return false;
     }();
   }
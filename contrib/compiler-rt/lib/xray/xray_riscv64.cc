@@ -0,0 +1,176 @@
+//===-- xray_riscv64.cc -----------------------------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file is a part of XRay, a dynamic runtime instrumentation system.
+//
+// Implementation of RISC-V-specific routines (64-bit).
+//
+//===----------------------------------------------------------------------===//
+#include "sanitizer_common/sanitizer_common.h"
+#include "xray_defs.h"
+#include "xray_interface_internal.h"
+#include "xray_tsc.h"
+#include <atomic>
+#include <cassert>
+#include <time.h>
+
+extern "C" void __clear_cache(void *start, void *end);
+
+namespace __xray {
+
+// The machine codes for some instructions used in runtime patching.
+enum class PatchOpcodes : uint32_t {
+  PO_AddiSPSPm16 = 0xFF010113, // ADDI SP, SP, -16
+  PO_SdRA8SP = 0x00113423,     // SD RA, 8(SP)
+  PO_SdA00SP = 0x00A13023,     // SD A0, 0(SP)
+  PO_AuipcT10 = 0x00000317,    // AUIPC T1, 0
+  PO_LwuA016T1 = 0x01036503,   // LWU A0, 16(T1)
+  PO_LdT120T1 = 0x01433303,    // LD T1, 20(T1)
+  PO_JalrRAT1 = 0x000300E7,    // JALR RA, 0(T1)
+  PO_LdA00SP = 0x00013503,     // LD A0, 0(SP)
+  PO_LdRA8SP = 0x00813083,     // LD RA, 8(SP)
+  PO_AddiSPSP16 = 0x01010113,  // ADDI SP, SP, 16
+  PO_J52 = 0x0340006F          // J #52
+};
+
+inline static bool patchSled(const bool Enable, const uint32_t FuncId,
+                             const XRaySledEntry &Sled,
+                             void (*TracingHook)()) XRAY_NEVER_INSTRUMENT {
+  // When |Enable| == true,
+  // We replace the following compile-time stub (sled), which the compiler
+  // aligns to 8 bytes:
+  //
+  // xray_sled_n:
+  //   J #52
+  //   12 NOPs (48 bytes)
+  //
+  // With the following runtime patch:
+  //
+  // xray_sled_n:
+  //   ADDI SP, SP, -16
+  //   SD RA, 8(SP)
+  //   SD A0, 0(SP)
+  //   AUIPC T1, 0 ; T1 := address of this instruction
+  //   LWU A0, 16(T1) ; A0 := function ID
+  //   LD T1, 20(T1) ; T1 := address of the trampoline
+  //   JALR RA, 0(T1)
+  //   ;DATA: 32 bits of function ID
+  //   ;DATA: 64 bits of the address of the trampoline (8-byte aligned)
+  //   LD A0, 0(SP)
+  //   LD RA, 8(SP)
+  //   ADDI SP, SP, 16
+  //
+  // The trampoline returns past the 12 bytes of data.
+  //
+  // Replacement of the first 4-byte instruction should be the last and atomic
+  // operation, so that the user code which reaches the sled concurrently
+  // either jumps over the whole sled, or executes the whole sled when the
+  // latter is ready.
+  //
+  // When |Enable|==false, we set back the first instruction in the sled to be
+  //   J #52
+
+  uint32_t *FirstAddress = reinterpret_cast<uint32_t *>(Sled.Address);
+  uint32_t *CurAddress = FirstAddress + 1;
+  if (Enable) {
+    *CurAddress = uint32_t(PatchOpcodes::PO_SdRA8SP);
+    CurAddress++;
+    *CurAddress = uint32_t(PatchOpcodes::PO_SdA00SP);
+    CurAddress++;
+    *CurAddress = uint32_t(PatchOpcodes::PO_AuipcT10);
+    CurAddress++;
+    *CurAddress = uint32_t(PatchOpcodes::PO_LwuA016T1);
+    CurAddress++;
+    *CurAddress = uint32_t(PatchOpcodes::PO_LdT120T1);
+    CurAddress++;
+    *CurAddress = uint32_t(PatchOpcodes::PO_JalrRAT1);
+    CurAddress++;
+    *CurAddress = FuncId;
+    CurAddress++;
+    *reinterpret_cast<void (**)()>(CurAddress) = TracingHook;
+    CurAddress += 2;
+    *CurAddress = uint32_t(PatchOpcodes::PO_LdA00SP);
+    CurAddress++;
+    *CurAddress = uint32_t(PatchOpcodes::PO_LdRA8SP);
+    CurAddress++;
+    *CurAddress = uint32_t(PatchOpcodes::PO_AddiSPSP16);
+    CurAddress++;
+    std::atomic_store_explicit(
+        reinterpret_cast<std::atomic<uint32_t> *>(FirstAddress),
+        uint32_t(PatchOpcodes::PO_AddiSPSPm16), std::memory_order_release);
+  } else {
+    std::atomic_store_explicit(
+        reinterpret_cast<std::atomic<uint32_t> *>(FirstAddress),
+        uint32_t(PatchOpcodes::PO_J52), std::memory_order_release);
+  }
+  __clear_cache(reinterpret_cast<char *>(FirstAddress),
+                reinterpret_cast<char *>(CurAddress));
+  return true;
+}
+
+bool patchFunctionEntry(const bool Enable, const uint32_t FuncId,
+                        const XRaySledEntry &Sled,
+                        void (*Trampoline)()) XRAY_NEVER_INSTRUMENT {
+  return patchSled(Enable, FuncId, Sled, Trampoline);
+}
+
+bool patchFunctionExit(const bool Enable, const uint32_t FuncId,
+                       const XRaySledEntry &Sled) XRAY_NEVER_INSTRUMENT {
+  return patchSled(Enable, FuncId, Sled, __xray_FunctionExit);
+}
+
+bool patchFunctionTailExit(const bool Enable, const uint32_t FuncId,
+                           const XRaySledEntry &Sled) XRAY_NEVER_INSTRUMENT {
+  return patchSled(Enable, FuncId, Sled, __xray_FunctionTailExit);
+}
+
+// Custom event sleds are only emitted by the compiler for x86_64, so there is
+// nothing to patch here; report the sled as unsupported.
+bool patchCustomEvent(const bool Enable, const uint32_t FuncId,
+                      const XRaySledEntry &Sled) XRAY_NEVER_INSTRUMENT {
+  return false;
+}
+
+static uint64_t monotonicNanoseconds() XRAY_NEVER_INSTRUMENT {
+  timespec TS;
+  clock_gettime(CLOCK_MONOTONIC, &TS);
+  return TS.tv_sec * NanosecondsPerSecond + TS.tv_nsec;
+}
+
+// The timebase frequency is only described in the device tree, which user
+// code cannot portably read, so it is measured against CLOCK_MONOTONIC.
+static uint64_t measureTSCFrequency() XRAY_NEVER_INSTRUMENT {
+  uint8_t CPU;
+  uint64_t StartNS = monotonicNanoseconds();
+  uint64_t StartTicks = readTSC(CPU);
+  timespec Delay = {0, 10 * 1000 * 1000};
+  while (nanosleep(&Delay, &Delay) != 0)
+    ;
+  uint64_t ElapsedTicks = readTSC(CPU) - StartTicks;
+  uint64_t ElapsedNS = monotonicNanoseconds() - StartNS;
+  if (ElapsedNS == 0)
+    return 0;
+  return static_cast<uint64_t>(static_cast<double>(ElapsedTicks) *
+                               NanosecondsPerSecond / ElapsedNS);
+}
+
+uint64_t getTSCFrequency() XRAY_NEVER_INSTRUMENT {
+  static const uint64_t TSCFrequency = measureTSCFrequency();
+  return TSCFrequency;
+}
+
+bool probeRequiredCPUFeatures() XRAY_NEVER_INSTRUMENT {
+  if (!getTSCFrequency()) {
+    Report("Unable to determine the timebase frequency.\n");
+    return false;
+  }
+  return true;
+}
+
+} // namespace __xray
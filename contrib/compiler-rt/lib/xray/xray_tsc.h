@@ -21,6 +21,8 @@ static constexpr uint64_t NanosecondsPerSecond = 1000ULL * 1000 * 1000;
 #include "xray_x86_64.inc"
 #elif defined(__powerpc64__)
 #include "xray_powerpc64.inc"
+#elif defined(__riscv) && __riscv_xlen == 64
+#include "xray_riscv64.inc"
 #elif defined(__arm__) || defined(__aarch64__) || defined(__mips__)
 // Emulated TSC.
 // There is no instruction like RDTSCP in user mode on ARM. ARM's CP15 does
@@ -20,7 +20,9 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <iterator>
+#include <sys/socket.h>
 #include <sys/types.h>
+#include <sys/un.h>
 #include <tuple>
 #include <unistd.h>
 #include <utility>
@@ -123,4 +125,36 @@ int getLogFD() XRAY_NEVER_INSTRUMENT {
   return Fd;
 }
 
+int getLogSocketFD(const char *Path) XRAY_NEVER_INSTRUMENT {
+  sockaddr_un Addr = {};
+  if (internal_strlen(Path) >= sizeof(Addr.sun_path)) {
+    Report("XRay: Socket path too long: %s\n", Path);
+    return -1;
+  }
+  Addr.sun_family = AF_UNIX;
+  internal_strncpy(Addr.sun_path, Path, sizeof(Addr.sun_path) - 1);
+  int Fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (Fd == -1) {
+    Report("XRay: Failed creating socket; errno = %d\n", errno);
+    return -1;
+  }
+#ifdef SO_NOSIGPIPE
+  // A reader going away should end the stream, not the traced process.
+  int One = 1;
+  setsockopt(Fd, SOL_SOCKET, SO_NOSIGPIPE, &One, sizeof(One));
+#endif
+  int Result;
+  do
+    Result = connect(Fd, reinterpret_cast<sockaddr *>(&Addr), sizeof(Addr));
+  while (Result == -1 && errno == EINTR);
+  if (Result == -1) {
+    Report("XRay: Failed connecting to '%s'; errno = %d\n", Path, errno);
+    close(Fd);
+    return -1;
+  }
+  if (__sanitizer::Verbosity())
+    Report("XRay: Streaming log to '%s'\n", Path);
+  return Fd;
+}
+
 } // namespace __xray
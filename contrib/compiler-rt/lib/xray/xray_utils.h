@@ -36,6 +36,10 @@ std::pair<ssize_t, bool> retryingReadSome(int Fd, char *Begin, char *End);
 // file.
 int getLogFD();
 
+// Connects to the UNIX domain socket at |Path| for streaming a log. Returns -1
+// on failure.
+int getLogSocketFD(const char *Path);
+
 } // namespace __xray
 
 #endif // XRAY_UTILS_H
@@ -339,6 +339,9 @@
 /* GNU specific sched_getcpu support */
 /* #undef JEMALLOC_HAVE_SCHED_GETCPU */
 
+/* FreeBSD cpuset_getdomain(2) and vm.ndomains support */
+#define JEMALLOC_HAVE_CPUSET_DOMAIN 
+
 /* GNU specific sched_setaffinity support */
 /* #undef JEMALLOC_HAVE_SCHED_SETAFFINITY */
 
@@ -18,9 +18,11 @@ extern bool opt_utrace;
 extern bool opt_xmalloc;
 extern bool opt_zero;
 extern unsigned opt_narenas;
+extern bool opt_numa_arenas;
 
 /* Number of CPUs. */
 extern unsigned ncpus;
+extern unsigned ndomains;
 
 /* Number of arenas used for automatic multiplexing of threads and arenas. */
 extern unsigned narenas_auto;
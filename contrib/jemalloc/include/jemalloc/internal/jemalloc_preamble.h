@@ -169,6 +169,14 @@ static const bool have_percpu_arena =
     false
 #endif
     ;
+/* numa_arenas needs a way to learn each thread's memory domain. */
+static const bool have_numa_arenas =
+#ifdef JEMALLOC_HAVE_CPUSET_DOMAIN
+    true
+#else
+    false
+#endif
+    ;
 /*
  * Undocumented, and not recommended; the application should take full
  * responsibility for tracking provenance.
@@ -71,6 +71,7 @@ typedef enum {
 extern thp_mode_t opt_thp;
 extern thp_mode_t init_system_thp_mode; /* Initial system wide state. */
 extern const char *thp_mode_names[];
+extern bool opt_superpages;
 
 void *pages_map(void *addr, size_t size, size_t alignment, bool *commit);
 void pages_unmap(void *addr, size_t size);
@@ -84,5 +85,6 @@ bool pages_dontdump(void *addr, size_t size);
 bool pages_dodump(void *addr, size_t size);
 bool pages_boot(void);
 void pages_set_thp_state (void *ptr, size_t size);
+size_t pages_superpage_mapped(void);
 
 #endif /* JEMALLOC_INTERNAL_PAGES_EXTERNS_H */
@@ -19,12 +19,14 @@
 #define narenas_auto JEMALLOC_N(narenas_auto)
 #define narenas_total_get JEMALLOC_N(narenas_total_get)
 #define ncpus JEMALLOC_N(ncpus)
+#define ndomains JEMALLOC_N(ndomains)
 #define opt_abort JEMALLOC_N(opt_abort)
 #define opt_abort_conf JEMALLOC_N(opt_abort_conf)
 #define opt_junk JEMALLOC_N(opt_junk)
 #define opt_junk_alloc JEMALLOC_N(opt_junk_alloc)
 #define opt_junk_free JEMALLOC_N(opt_junk_free)
 #define opt_narenas JEMALLOC_N(opt_narenas)
+#define opt_numa_arenas JEMALLOC_N(opt_numa_arenas)
 #define opt_utrace JEMALLOC_N(opt_utrace)
 #define opt_xmalloc JEMALLOC_N(opt_xmalloc)
 #define opt_zero JEMALLOC_N(opt_zero)
@@ -250,6 +252,7 @@
 #define nstime_subtract JEMALLOC_N(nstime_subtract)
 #define nstime_update JEMALLOC_N(nstime_update)
 #define init_system_thp_mode JEMALLOC_N(init_system_thp_mode)
+#define opt_superpages JEMALLOC_N(opt_superpages)
 #define opt_thp JEMALLOC_N(opt_thp)
 #define pages_boot JEMALLOC_N(pages_boot)
 #define pages_commit JEMALLOC_N(pages_commit)
@@ -262,6 +265,7 @@
 #define pages_purge_forced JEMALLOC_N(pages_purge_forced)
 #define pages_purge_lazy JEMALLOC_N(pages_purge_lazy)
 #define pages_set_thp_state JEMALLOC_N(pages_set_thp_state)
+#define pages_superpage_mapped JEMALLOC_N(pages_superpage_mapped)
 #define pages_unmap JEMALLOC_N(pages_unmap)
 #define thp_mode_names JEMALLOC_N(thp_mode_names)
 #define bt2gctx_mtx JEMALLOC_N(bt2gctx_mtx)
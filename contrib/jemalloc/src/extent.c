@@ -1252,6 +1252,16 @@ extent_grow_retained(tsdn_t *tsdn, arena_t *arena,
 		alloc_size = sz_pind2sz(arena->extent_grow_next + egn_skip);
 	}
 
+	/*
+	 * With superpages, grow in whole superpages so that retained address
+	 * space never leaves a partial superpage at either end.
+	 */
+	size_t alloc_alignment = PAGE;
+	if (opt_superpages) {
+		alloc_size = HUGEPAGE_CEILING(alloc_size);
+		alloc_alignment = HUGEPAGE;
+	}
+
 	extent_t *extent = extent_alloc(tsdn, arena);
 	if (extent == NULL) {
 		goto label_err;
@@ -1262,11 +1272,11 @@ extent_grow_retained(tsdn_t *tsdn, arena_t *arena,
 	void *ptr;
 	if (*r_extent_hooks == &extent_hooks_default) {
 		ptr = extent_alloc_default_impl(tsdn, arena, NULL,
-		    alloc_size, PAGE, &zeroed, &committed);
+		    alloc_size, alloc_alignment, &zeroed, &committed);
 	} else {
 		extent_hook_pre_reentrancy(tsdn, arena);
 		ptr = (*r_extent_hooks)->alloc(*r_extent_hooks, NULL,
-		    alloc_size, PAGE, &zeroed, &committed,
+		    alloc_size, alloc_alignment, &zeroed, &committed,
 		    arena_ind_get(arena));
 		extent_hook_post_reentrancy(tsdn);
 	}
@@ -1871,8 +1881,22 @@ extent_purge_lazy_default(extent_hooks_t *extent_hooks, void *addr, size_t size,
 	assert(length != 0);
 	assert((length & PAGE_MASK) == 0);
 
-	return pages_purge_lazy((void *)((uintptr_t)addr + (uintptr_t)offset),
-	    length);
+	uintptr_t start = (uintptr_t)addr + (uintptr_t)offset;
+	uintptr_t end = start + length;
+	if (opt_superpages) {
+		/*
+		 * Purging part of a superpage demotes it, so only purge the
+		 * superpages fully inside the range.  The rest simply stays
+		 * resident; muzzy pages are allowed to be either.
+		 */
+		start = HUGEPAGE_CEILING(start);
+		end = (uintptr_t)HUGEPAGE_ADDR2BASE(end);
+		if (start >= end) {
+			return false;
+		}
+	}
+
+	return pages_purge_lazy((void *)start, end - start);
 }
 #endif
 
@@ -1918,8 +1942,14 @@ extent_purge_forced_default(extent_hooks_t *extent_hooks, void *addr,
 	assert(length != 0);
 	assert((length & PAGE_MASK) == 0);
 
-	return pages_purge_forced((void *)((uintptr_t)addr +
-	    (uintptr_t)offset), length);
+	void *start = (void *)((uintptr_t)addr + (uintptr_t)offset);
+	if (opt_superpages && (HUGEPAGE_ADDR2BASE(start) != start ||
+	    HUGEPAGE_CEILING(length) != length)) {
+		/* extent_dalloc_wrapper() falls back to lazy purging. */
+		return true;
+	}
+
+	return pages_purge_forced(start, length);
 }
 #endif
 
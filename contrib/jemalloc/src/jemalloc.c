@@ -18,6 +18,13 @@
 #include "jemalloc/internal/ticker.h"
 #include "jemalloc/internal/util.h"
 
+#ifdef JEMALLOC_HAVE_CPUSET_DOMAIN
+#include <sys/param.h>
+#include <sys/cpuset.h>
+#include <sys/domainset.h>
+#include <sys/sysctl.h>
+#endif
+
 /******************************************************************************/
 /* Data. */
 
@@ -71,8 +78,15 @@ bool	opt_utrace = false;
 bool	opt_xmalloc = false;
 bool	opt_zero = false;
 unsigned	opt_narenas = 0;
+bool	opt_numa_arenas = false;
 
 unsigned	ncpus;
+/* Number of memory domains; only greater than 1 if numa_arenas is active. */
+unsigned	ndomains = 1;
+#ifdef JEMALLOC_HAVE_CPUSET_DOMAIN
+/* Memory domain of each CPU, used when a thread is bound by CPU affinity. */
+static uint8_t	cpu_domain[CPU_SETSIZE];
+#endif
 
 /* Protects arenas initialization. */
 malloc_mutex_t arenas_lock;
@@ -484,6 +498,47 @@ arena_tdata_get_hard(tsd_t *tsd, unsigned ind) {
 	return tdata;
 }
 
+/*
+ * Return the memory domain the calling thread is confined to, or -1 if it may
+ * run or allocate in more than one domain.  An explicit domainset policy wins;
+ * otherwise the thread counts as local to a domain if all of the CPUs in its
+ * affinity mask belong to it.
+ */
+static int
+malloc_thread_domain(void) {
+#ifdef JEMALLOC_HAVE_CPUSET_DOMAIN
+	domainset_t domains;
+	cpuset_t cpus;
+	int cpu, domain, policy;
+
+	if (cpuset_getdomain(CPU_LEVEL_WHICH, CPU_WHICH_TID, -1,
+	    sizeof(domains), &domains, &policy) == 0 &&
+	    DOMAINSET_COUNT(&domains) == 1) {
+		domain = DOMAINSET_FFS(&domains) - 1;
+		return ((unsigned)domain < ndomains ? domain : -1);
+	}
+	if (cpuset_getaffinity(CPU_LEVEL_WHICH, CPU_WHICH_TID, -1,
+	    sizeof(cpus), &cpus) != 0) {
+		return -1;
+	}
+	domain = -1;
+	for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+		if (!CPU_ISSET(cpu, &cpus)) {
+			continue;
+		}
+		if (domain == -1) {
+			domain = cpu_domain[cpu];
+		} else if (domain != cpu_domain[cpu]) {
+			return -1;
+		}
+	}
+	return domain;
+#else
+	not_reached();
+	return -1;
+#endif
+}
+
 /* Slow path, called only by arena_choose(). */
 arena_t *
 arena_choose_hard(tsd_t *tsd, bool internal) {
@@ -500,8 +555,21 @@ arena_choose_hard(tsd_t *tsd, bool internal) {
 	}
 
 	if (narenas_auto > 1) {
-		unsigned i, j, choose[2], first_null;
-		bool is_new_arena[2];
+		unsigned i, j, choose[2], first, step, first_null;
+		bool is_new_arena[2], is_new_first;
+		int domain;
+
+		/*
+		 * With numa_arenas, auto arena i serves memory domain
+		 * (i % ndomains), and a thread confined to a domain only
+		 * considers that domain's arenas.
+		 */
+		first = 0;
+		step = 1;
+		if (ndomains > 1 && (domain = malloc_thread_domain()) >= 0) {
+			first = (unsigned)domain;
+			step = ndomains;
+		}
 
 		/*
 		 * Determine binding for both non-internal and internal
@@ -512,14 +580,24 @@ arena_choose_hard(tsd_t *tsd, bool internal) {
 		 */
 
 		for (j = 0; j < 2; j++) {
-			choose[j] = 0;
+			choose[j] = first;
 			is_new_arena[j] = false;
 		}
 
 		first_null = narenas_auto;
+		is_new_first = false;
 		malloc_mutex_lock(tsd_tsdn(tsd), &arenas_lock);
-		assert(arena_get(tsd_tsdn(tsd), 0, false) != NULL);
-		for (i = 1; i < narenas_auto; i++) {
+		if (arena_get(tsd_tsdn(tsd), first, false) == NULL) {
+			/* The domain's first arena is created on demand. */
+			assert(first > 0);
+			if (arena_init_locked(tsd_tsdn(tsd), first,
+			    (extent_hooks_t *)&extent_hooks_default) == NULL) {
+				malloc_mutex_unlock(tsd_tsdn(tsd), &arenas_lock);
+				return NULL;
+			}
+			is_new_first = true;
+		}
+		for (i = first + step; i < narenas_auto; i += step) {
 			if (arena_get(tsd_tsdn(tsd), i, false) != NULL) {
 				/*
 				 * Choose the first arena that has the lowest
@@ -582,6 +660,10 @@ arena_choose_hard(tsd_t *tsd, bool internal) {
 		}
 		malloc_mutex_unlock(tsd_tsdn(tsd), &arenas_lock);
 
+		if (is_new_first) {
+			arena_new_create_background_thread(tsd_tsdn(tsd),
+			    first);
+		}
 		for (j = 0; j < 2; j++) {
 			if (is_new_arena[j]) {
 				assert(choose[j] > 0);
@@ -1072,6 +1154,8 @@ malloc_conf_init(void) {
 				continue;
 			}
 			CONF_HANDLE_BOOL(opt_retain, "retain")
+			CONF_HANDLE_BOOL(opt_superpages, "superpages")
+			CONF_HANDLE_BOOL(opt_numa_arenas, "numa_arenas")
 			if (strncmp("dss", k, klen) == 0) {
 				int i;
 				bool match = false;
@@ -1399,6 +1483,45 @@ percpu_arena_as_initialized(percpu_arena_mode_t mode) {
 	return mode;
 }
 
+/*
+ * Read the number of memory domains and the domain of each CPU.  Returns true
+ * on error.
+ */
+static bool
+malloc_init_domains(void) {
+#ifdef JEMALLOC_HAVE_CPUSET_DOMAIN
+	char name[32];
+	size_t len;
+	int n, cpu;
+
+	len = sizeof(n);
+	if (sysctlbyname("vm.ndomains", &n, &len, NULL, 0) != 0 || n < 1) {
+		return true;
+	}
+	if (n == 1) {
+		return false;
+	}
+	for (cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+		int domain;
+
+		malloc_snprintf(name, sizeof(name), "dev.cpu.%d.%%domain", cpu);
+		len = sizeof(domain);
+		if (sysctlbyname(name, &domain, &len, NULL, 0) != 0) {
+			continue;
+		}
+		if (domain < 0 || domain >= n) {
+			return true;
+		}
+		cpu_domain[cpu] = (uint8_t)domain;
+	}
+	ndomains = (unsigned)n;
+	return false;
+#else
+	not_reached();
+	return true;
+#endif
+}
+
 static bool
 malloc_init_narenas(void) {
 	assert(ncpus > 0);
@@ -1456,6 +1579,19 @@ malloc_init_narenas(void) {
 		opt_narenas = malloc_narenas_default();
 	}
 	assert(opt_narenas > 0);
+	if (opt_numa_arenas) {
+		if (!have_numa_arenas || malloc_init_domains()) {
+			opt_numa_arenas = false;
+			malloc_printf("<jemalloc>: Memory domain information "
+			    "not available; disabling numa_arenas.\n");
+			if (opt_abort) {
+				abort();
+			}
+		} else if (ndomains > 1 && opt_narenas % ndomains != 0) {
+			/* Give every domain the same number of arenas. */
+			opt_narenas += ndomains - opt_narenas % ndomains;
+		}
+	}
 
 	narenas_auto = opt_narenas;
 	/*
@@ -6,6 +6,7 @@
 #include "jemalloc/internal/jemalloc_internal_includes.h"
 
 #include "jemalloc/internal/assert.h"
+#include "jemalloc/internal/extent_mmap.h"
 #include "jemalloc/internal/malloc_io.h"
 
 #ifdef JEMALLOC_SYSCTL_VM_OVERCOMMIT
@@ -37,6 +38,14 @@ const char *thp_mode_names[] = {
 thp_mode_t opt_thp = THP_MODE_DEFAULT;
 thp_mode_t init_system_thp_mode;
 
+/*
+ * Map huge extents superpage-aligned, and only purge whole superpages, so that
+ * the kernel can promote them and keep them promoted.
+ */
+bool opt_superpages = false;
+/* Bytes of whole superpages covered by live mappings; see pages_map(). */
+static atomic_zu_t pages_superpage_bytes = ATOMIC_INIT(0);
+
 /* Runtime support for lazy purge. Irrelevant when !pages_can_purge_lazy. */
 static bool pages_can_purge_lazy_runtime = true;
 
@@ -75,8 +84,14 @@ os_pages_map(void *addr, size_t size, size_t alignment, bool *commit) {
 	 */
 	{
 		int prot = *commit ? PAGES_PROT_COMMIT : PAGES_PROT_DECOMMIT;
+		int flags = mmap_flags;
 
-		ret = mmap(addr, size, prot, mmap_flags, -1, 0);
+#ifdef MAP_ALIGNED_SUPER
+		if (opt_superpages && addr == NULL && size >= HUGEPAGE) {
+			flags |= MAP_ALIGNED_SUPER;
+		}
+#endif
+		ret = mmap(addr, size, prot, flags, -1, 0);
 	}
 	assert(ret != NULL);
 
@@ -124,6 +139,20 @@ os_pages_trim(void *addr, size_t alloc_size, size_t leadsize, size_t size,
 #endif
 }
 
+/* Return the number of bytes in whole superpages within [addr, addr+size). */
+static size_t
+pages_superpage_span(void *addr, size_t size) {
+	uintptr_t start = HUGEPAGE_CEILING((uintptr_t)addr);
+	uintptr_t end = (uintptr_t)HUGEPAGE_ADDR2BASE((uintptr_t)addr + size);
+
+	return (start < end ? end - start : 0);
+}
+
+size_t
+pages_superpage_mapped(void) {
+	return atomic_load_zu(&pages_superpage_bytes, ATOMIC_RELAXED);
+}
+
 static void
 os_pages_unmap(void *addr, size_t size) {
 	assert(ALIGNMENT_ADDR2BASE(addr, os_page) == addr);
@@ -195,16 +224,19 @@ pages_map(void *addr, size_t size, size_t alignment, bool *commit) {
 	 */
 
 	void *ret = os_pages_map(addr, size, os_page, commit);
-	if (ret == NULL || ret == addr) {
-		return ret;
+	if (ret != NULL && ret != addr) {
+		assert(addr == NULL);
+		if (ALIGNMENT_ADDR2OFFSET(ret, alignment) != 0) {
+			os_pages_unmap(ret, size);
+			ret = pages_map_slow(size, alignment, commit);
+		}
 	}
-	assert(addr == NULL);
-	if (ALIGNMENT_ADDR2OFFSET(ret, alignment) != 0) {
-		os_pages_unmap(ret, size);
-		return pages_map_slow(size, alignment, commit);
+	if (config_stats && opt_superpages && ret != NULL) {
+		atomic_fetch_add_zu(&pages_superpage_bytes,
+		    pages_superpage_span(ret, size), ATOMIC_RELAXED);
 	}
 
-	assert(PAGE_ADDR2BASE(ret) == ret);
+	assert(ret == NULL || PAGE_ADDR2BASE(ret) == ret);
 	return ret;
 }
 
@@ -213,6 +245,10 @@ pages_unmap(void *addr, size_t size) {
 	assert(PAGE_ADDR2BASE(addr) == addr);
 	assert(PAGE_CEILING(size) == size);
 
+	if (config_stats && opt_superpages) {
+		atomic_fetch_sub_zu(&pages_superpage_bytes,
+		    pages_superpage_span(addr, size), ATOMIC_RELAXED);
+	}
 	os_pages_unmap(addr, size);
 }
 
@@ -588,6 +624,22 @@ pages_boot(void) {
 
 	init_thp_state();
 
+	if (opt_superpages) {
+#ifdef MAP_ALIGNED_SUPER
+		/*
+		 * Unmapping returns even partially used superpages to the
+		 * kernel, so hold on to address space instead.
+		 */
+		opt_retain = true;
+#else
+		malloc_write("<jemalloc>: No MAP_ALIGNED_SUPER support\n");
+		if (opt_abort) {
+			abort();
+		}
+		opt_superpages = false;
+#endif
+	}
+
 	/* Detect lazy purge runtime support. */
 	if (pages_can_purge_lazy) {
 		bool committed = false;
@@ -37,6 +37,9 @@ __FBSDID("$FreeBSD$");
 #ifdef HAVE_STRING_H
 #include <string.h>
 #endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
 #ifdef HAVE_ZSTD_H
 #include <zstd.h>
 #endif
@@ -48,8 +51,12 @@ __FBSDID("$FreeBSD$");
 
 /* Don't compile this if we don't have zstd.h */
 
+/* Worker threads were added to the stable zstd API in 1.4.0. */
+#define MINVER_NBWORKERS 10400
+
 struct private_data {
 	int		 compression_level;
+	int		 threads;
 #if HAVE_ZSTD_H && HAVE_LIBZSTD
 	ZSTD_CStream	*cstream;
 	int64_t		 total_in;
@@ -97,6 +104,7 @@ archive_write_add_filter_zstd(struct archive *_a)
 	f->code = ARCHIVE_FILTER_ZSTD;
 	f->name = "zstd";
 	data->compression_level = 3; /* Default level used by the zstd CLI */
+	data->threads = 1;
 #if HAVE_ZSTD_H && HAVE_LIBZSTD
 	data->cstream = ZSTD_createCStream();
 	if (data->cstream == NULL) {
@@ -156,6 +164,23 @@ archive_compressor_zstd_options(struct archive_write_filter *f, const char *key,
 		}
 		data->compression_level = level;
 		return (ARCHIVE_OK);
+	} else if (strcmp(key, "threads") == 0) {
+		int threads = atoi(value);
+		if (threads < 0) {
+			return (ARCHIVE_WARN);
+		}
+#if defined(_SC_NPROCESSORS_ONLN)
+		if (threads == 0) {
+			threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+			if (threads < 1)
+				threads = 1;
+		}
+#else
+		if (threads == 0)
+			threads = 1;
+#endif
+		data->threads = threads;
+		return (ARCHIVE_OK);
 	}
 
 	/* Note: The "warn" return is just to inform the options
@@ -209,6 +234,18 @@ archive_compressor_zstd_open(struct archive_write_filter *f)
 		return (ARCHIVE_FATAL);
 	}
 
+#if ZSTD_VERSION_NUMBER >= MINVER_NBWORKERS
+	/*
+	 * With workers, zstd compresses independent jobs of the input in
+	 * parallel; the output is still a single ordinary frame.
+	 */
+	if (data->threads > 1 && ZSTD_isError(ZSTD_CCtx_setParameter(
+	    data->cstream, ZSTD_c_nbWorkers, data->threads))) {
+		/* The library was built without multithreading. */
+		data->threads = 1;
+	}
+#endif
+
 	return (ARCHIVE_OK);
 }
 
@@ -308,6 +345,8 @@ archive_compressor_zstd_open(struct archive_write_filter *f)
 
 	archive_string_init(&as);
 	archive_string_sprintf(&as, "zstd -%d", data->compression_level);
+	if (data->threads != 1)
+		archive_string_sprintf(&as, " -T%d", data->threads);
 
 	f->write = archive_compressor_zstd_write;
 	r = __archive_write_program_open(f, data->pdata, as.s);
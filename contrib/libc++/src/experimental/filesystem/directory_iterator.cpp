@@ -14,6 +14,8 @@
 #include <Windows.h>
 #else
 #include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
 #endif
 #include <errno.h>
 
@@ -42,7 +44,27 @@ inline bool set_or_throw(std::error_code& my_ec,
 }
 
 #if !defined(_LIBCPP_WIN32API)
-inline path::string_type posix_readdir(DIR *dir_stream, error_code& ec) {
+// Translates d_type so that callers can skip a stat() for the common case.
+// file_type::none means the file system did not tell us.
+inline file_type get_file_type(struct dirent* ent) {
+#if defined(DT_UNKNOWN)
+    switch (ent->d_type) {
+    case DT_BLK:  return file_type::block;
+    case DT_CHR:  return file_type::character;
+    case DT_DIR:  return file_type::directory;
+    case DT_FIFO: return file_type::fifo;
+    case DT_LNK:  return file_type::symlink;
+    case DT_REG:  return file_type::regular;
+    case DT_SOCK: return file_type::socket;
+    default:      return file_type::none;
+    }
+#else
+    return file_type::none;
+#endif
+}
+
+inline pair<path::string_type, file_type>
+posix_readdir(DIR *dir_stream, error_code& ec) {
     struct dirent* dir_entry_ptr = nullptr;
     errno = 0; // zero errno in order to detect errors
     ec.clear();
@@ -51,7 +73,7 @@ inline path::string_type posix_readdir(DIR *dir_stream, error_code& ec) {
           ec = capture_errno();
         return {};
     } else {
-        return dir_entry_ptr->d_name;
+        return {dir_entry_ptr->d_name, get_file_type(dir_entry_ptr)};
     }
 }
 #endif
@@ -85,6 +107,10 @@ class __dir_stream {
     }
   }
 
+  __dir_stream(const __dir_stream& parent, directory_options opts,
+               error_code& ec)
+      : __dir_stream(parent.__entry_.path(), opts, ec) {}
+
   ~__dir_stream() noexcept {
     if (__stream_ == INVALID_HANDLE_VALUE)
       return;
@@ -120,6 +146,7 @@ class __dir_stream {
 public:
   path __root_;
   directory_entry __entry_;
+  file_type __entry_type_{file_type::none};
 };
 #else
 class __dir_stream {
@@ -129,7 +156,8 @@ class __dir_stream {
 
     __dir_stream(__dir_stream&& other) noexcept
         : __stream_(other.__stream_), __root_(std::move(other.__root_)),
-          __entry_(std::move(other.__entry_))
+          __entry_(std::move(other.__entry_)),
+          __entry_type_(other.__entry_type_)
     {
         other.__stream_ = nullptr;
     }
@@ -150,6 +178,29 @@ class __dir_stream {
         advance(ec);
     }
 
+    // Opens the sub-directory that parent is positioned on relative to the
+    // parent's descriptor, which avoids resolving the whole path again.
+    __dir_stream(const __dir_stream& parent, directory_options opts,
+                 error_code& ec)
+        : __stream_(nullptr),
+          __root_(parent.__entry_.path())
+    {
+        int fd = ::openat(::dirfd(parent.__stream_),
+                          __root_.filename().c_str(),
+                          O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (fd == -1 || (__stream_ = ::fdopendir(fd)) == nullptr) {
+            ec = detail::capture_errno();
+            if (fd != -1)
+                ::close(fd);
+            const bool allow_eacess =
+                bool(opts & directory_options::skip_permission_denied);
+            if (allow_eacess && ec.value() == EACCES)
+                ec.clear();
+            return;
+        }
+        advance(ec);
+    }
+
     ~__dir_stream() noexcept
       { if (__stream_) close(); }
 
@@ -157,7 +208,8 @@ class __dir_stream {
 
     bool advance(error_code &ec) {
         while (true) {
-            auto str = detail::posix_readdir(__stream_,  ec);
+            auto ent = detail::posix_readdir(__stream_,  ec);
+            auto& str = ent.first;
             if (str == "." || str == "..") {
                 continue;
             } else if (ec || str.empty()) {
@@ -165,6 +217,7 @@ class __dir_stream {
                 return false;
             } else {
                 __entry_.assign(__root_ / str);
+                __entry_type_ = ent.second;
                 return true;
             }
         }
@@ -182,6 +235,7 @@ class __dir_stream {
 public:
     path __root_;
     directory_entry __entry_;
+    file_type __entry_type_{file_type::none};
 };
 #endif
 
@@ -303,7 +357,13 @@ bool recursive_directory_iterator::__try_recursion(error_code *ec) {
 
     bool skip_rec = false;
     std::error_code m_ec;
-    if (!rec_sym) {
+    // Trust the type readdir() reported when it is enough to decide, so that
+    // walking a tree does not cost a stat() per entry.
+    const file_type ft = curr_it.__entry_type_;
+    if (ft != file_type::none && (!rec_sym || ft != file_type::symlink)) {
+      if (ft != file_type::directory)
+        skip_rec = true;
+    } else if (!rec_sym) {
       file_status st = curr_it.__entry_.symlink_status(m_ec);
       if (m_ec && status_known(st))
         m_ec.clear();
@@ -318,7 +378,7 @@ bool recursive_directory_iterator::__try_recursion(error_code *ec) {
     }
 
     if (!skip_rec) {
-        __dir_stream new_it(curr_it.__entry_.path(), __imp_->__options_, m_ec);
+        __dir_stream new_it(curr_it, __imp_->__options_, m_ec);
         if (new_it.good()) {
             __imp_->__stack_.push(_VSTD::move(new_it));
             return true;
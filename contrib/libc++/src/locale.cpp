@@ -183,9 +183,19 @@ class _LIBCPP_HIDDEN locale::__imp
         {return static_cast<size_t>(id) < facets_.size() && facets_[static_cast<size_t>(id)];}
     const locale::facet* use_facet(long id) const;
 
+    // The classic locale is never destroyed, so locales that share it do
+    // not maintain its reference count.  That keeps every thread that
+    // formats through the "C" locale (ios_base::getloc(), the locale
+    // copies made by the sentries and facet lookups) off one shared
+    // cache line.
+    void acquire() {if (this != classic_) __add_shared();}
+    void release() {if (this != classic_) __release_shared();}
+
     static const locale& make_classic();
     static       locale& make_global();
 private:
+    static __imp* classic_;
+
     void install(facet* f, long id);
     template <class F> void install(F* f) {install(f, f->id.__get());}
     template <class F> void install_from(const __imp& other);
@@ -478,6 +488,8 @@ locale::__imp::use_facet(long id) const
 
 // locale
 
+locale::__imp* locale::__imp::classic_ = nullptr;
+
 const locale&
 locale::__imp::make_classic()
 {
@@ -485,6 +497,7 @@ locale::__imp::make_classic()
     static aligned_storage<sizeof(locale)>::type buf;
     locale* c = reinterpret_cast<locale*>(&buf);
     c->__locale_ = &make<__imp>(1u);
+    classic_ = c->__locale_;
     return *c;
 }
 
@@ -514,25 +527,25 @@ locale::__global()
 locale::locale()  _NOEXCEPT
     : __locale_(__global().__locale_)
 {
-    __locale_->__add_shared();
+    __locale_->acquire();
 }
 
 locale::locale(const locale& l)  _NOEXCEPT
     : __locale_(l.__locale_)
 {
-    __locale_->__add_shared();
+    __locale_->acquire();
 }
 
 locale::~locale()
 {
-    __locale_->__release_shared();
+    __locale_->release();
 }
 
 const locale&
 locale::operator=(const locale& other)  _NOEXCEPT
 {
-    other.__locale_->__add_shared();
-    __locale_->__release_shared();
+    other.__locale_->acquire();
+    __locale_->release();
     __locale_ = other.__locale_;
     return *this;
 }
@@ -545,13 +558,13 @@ locale::locale(const char* name)
     : __locale_(new __imp(name))
 #endif
 {
-    __locale_->__add_shared();
+    __locale_->acquire();
 }
 
 locale::locale(const string& name)
     : __locale_(new __imp(name))
 {
-    __locale_->__add_shared();
+    __locale_->acquire();
 }
 
 locale::locale(const locale& other, const char* name, category c)
@@ -562,19 +575,19 @@ locale::locale(const locale& other, const char* name, category c)
     : __locale_(new __imp(*other.__locale_, name, c))
 #endif
 {
-    __locale_->__add_shared();
+    __locale_->acquire();
 }
 
 locale::locale(const locale& other, const string& name, category c)
     : __locale_(new __imp(*other.__locale_, name, c))
 {
-    __locale_->__add_shared();
+    __locale_->acquire();
 }
 
 locale::locale(const locale& other, const locale& one, category c)
     : __locale_(new __imp(*other.__locale_, *one.__locale_, c))
 {
-    __locale_->__add_shared();
+    __locale_->acquire();
 }
 
 string
@@ -590,7 +603,7 @@ locale::__install_ctor(const locale& other, facet* f, long id)
         __locale_ = new __imp(*other.__locale_, f, id);
     else
         __locale_ = other.__locale_;
-    __locale_->__add_shared();
+    __locale_->acquire();
 }
 
 locale
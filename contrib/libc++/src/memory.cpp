@@ -135,15 +135,27 @@ __shared_weak_count::__get_deleter(const type_info&) const _NOEXCEPT
 
 #if !defined(_LIBCPP_HAS_NO_ATOMIC_HEADER)
 
-_LIBCPP_SAFE_STATIC static const std::size_t __sp_mut_count = 16;
-_LIBCPP_SAFE_STATIC static __libcpp_mutex_t mut_back[__sp_mut_count] =
+// The critical sections guarded by these locks only copy or swap a
+// shared_ptr, so a spinlock is much cheaper than a full mutex, and giving
+// each lock its own cache line keeps unrelated objects from contending.
+struct _ALIGNAS(64) __sp_spin
 {
-    _LIBCPP_MUTEX_INITIALIZER, _LIBCPP_MUTEX_INITIALIZER, _LIBCPP_MUTEX_INITIALIZER, _LIBCPP_MUTEX_INITIALIZER,
-    _LIBCPP_MUTEX_INITIALIZER, _LIBCPP_MUTEX_INITIALIZER, _LIBCPP_MUTEX_INITIALIZER, _LIBCPP_MUTEX_INITIALIZER,
-    _LIBCPP_MUTEX_INITIALIZER, _LIBCPP_MUTEX_INITIALIZER, _LIBCPP_MUTEX_INITIALIZER, _LIBCPP_MUTEX_INITIALIZER,
-    _LIBCPP_MUTEX_INITIALIZER, _LIBCPP_MUTEX_INITIALIZER, _LIBCPP_MUTEX_INITIALIZER, _LIBCPP_MUTEX_INITIALIZER
+    int __state_;
 };
 
+_LIBCPP_SAFE_STATIC static const std::size_t __sp_mut_count = 64;
+_LIBCPP_SAFE_STATIC static __sp_spin spin_back[__sp_mut_count];
+
+static inline void
+__sp_relax() _NOEXCEPT
+{
+#if defined(__i386__) || defined(__x86_64__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
 _LIBCPP_CONSTEXPR __sp_mut::__sp_mut(void* p) _NOEXCEPT
    : __lx(p)
 {
@@ -152,23 +164,30 @@ _LIBCPP_CONSTEXPR __sp_mut::__sp_mut(void* p) _NOEXCEPT
 void
 __sp_mut::lock() _NOEXCEPT
 {
-    auto m = static_cast<__libcpp_mutex_t*>(__lx);
+    int* l = &static_cast<__sp_spin*>(__lx)->__state_;
     unsigned count = 0;
-    while (!__libcpp_mutex_trylock(m))
+    int expected = 0;
+    while (!__libcpp_atomic_compare_exchange(l, &expected, 1,
+                                             _AO_Acquire, _AO_Relaxed))
     {
-        if (++count > 16)
+        // Wait on plain loads so that the waiters share the cache line
+        // until the holder releases it.
+        while (__libcpp_atomic_load(l, _AO_Relaxed) != 0)
         {
-            __libcpp_mutex_lock(m);
-            break;
+            if (++count > 64)
+                this_thread::yield();
+            else
+                __sp_relax();
         }
-        this_thread::yield();
+        expected = 0;
     }
 }
 
 void
 __sp_mut::unlock() _NOEXCEPT
 {
-    __libcpp_mutex_unlock(static_cast<__libcpp_mutex_t*>(__lx));
+    __libcpp_atomic_store(&static_cast<__sp_spin*>(__lx)->__state_, 0,
+                          _AO_Release);
 }
 
 __sp_mut&
@@ -176,10 +195,22 @@ __get_sp_mut(const void* p)
 {
     static __sp_mut muts[__sp_mut_count]
     {
-        &mut_back[ 0], &mut_back[ 1], &mut_back[ 2], &mut_back[ 3],
-        &mut_back[ 4], &mut_back[ 5], &mut_back[ 6], &mut_back[ 7],
-        &mut_back[ 8], &mut_back[ 9], &mut_back[10], &mut_back[11],
-        &mut_back[12], &mut_back[13], &mut_back[14], &mut_back[15]
+        &spin_back[ 0], &spin_back[ 1], &spin_back[ 2], &spin_back[ 3],
+        &spin_back[ 4], &spin_back[ 5], &spin_back[ 6], &spin_back[ 7],
+        &spin_back[ 8], &spin_back[ 9], &spin_back[10], &spin_back[11],
+        &spin_back[12], &spin_back[13], &spin_back[14], &spin_back[15],
+        &spin_back[16], &spin_back[17], &spin_back[18], &spin_back[19],
+        &spin_back[20], &spin_back[21], &spin_back[22], &spin_back[23],
+        &spin_back[24], &spin_back[25], &spin_back[26], &spin_back[27],
+        &spin_back[28], &spin_back[29], &spin_back[30], &spin_back[31],
+        &spin_back[32], &spin_back[33], &spin_back[34], &spin_back[35],
+        &spin_back[36], &spin_back[37], &spin_back[38], &spin_back[39],
+        &spin_back[40], &spin_back[41], &spin_back[42], &spin_back[43],
+        &spin_back[44], &spin_back[45], &spin_back[46], &spin_back[47],
+        &spin_back[48], &spin_back[49], &spin_back[50], &spin_back[51],
+        &spin_back[52], &spin_back[53], &spin_back[54], &spin_back[55],
+        &spin_back[56], &spin_back[57], &spin_back[58], &spin_back[59],
+        &spin_back[60], &spin_back[61], &spin_back[62], &spin_back[63]
     };
     return muts[hash<const void*>()(p) & (__sp_mut_count-1)];
 }
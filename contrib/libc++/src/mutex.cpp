@@ -12,6 +12,10 @@
 #include "limits"
 #include "system_error"
 #include "include/atomic_support.h"
+#if defined(__FreeBSD__) && !defined(_LIBCPP_HAS_NO_THREADS)
+#include <sys/types.h>
+#include <sys/umtx.h>
+#endif
 #include "__undef_macros"
 
 _LIBCPP_BEGIN_NAMESPACE_STD
@@ -194,7 +198,36 @@ recursive_timed_mutex::unlock() _NOEXCEPT
 // call into dispatch_once_f instead of here. Relevant radar this code needs to
 // keep in sync with:  7741191.
 
-#ifndef _LIBCPP_HAS_NO_THREADS
+#if defined(__FreeBSD__) && !defined(_LIBCPP_HAS_NO_THREADS)
+// On FreeBSD each flag is its own wait channel: 0 means not yet run, 1 that a
+// thread is running the function, 2 that it is running and other threads are
+// waiting for it, and ~0ul that it has completed.  The kernel compares the
+// 32-bit word holding the low-order bits of the flag, which is enough to tell
+// those states apart.
+
+static unsigned int*
+__once_word(unsigned long* flag)
+{
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return reinterpret_cast<unsigned int*>(flag) +
+        (sizeof(unsigned long) / sizeof(unsigned int) - 1);
+#else
+    return reinterpret_cast<unsigned int*>(flag);
+#endif
+}
+
+static void
+__once_finish(unsigned long* flag, unsigned long value)
+{
+    unsigned long state = __libcpp_atomic_load(flag, _AO_Relaxed);
+    while (!__libcpp_atomic_compare_exchange(flag, &state, value,
+                                             _AO_Release, _AO_Relaxed))
+        ;
+    if (state == 2ul)
+        _umtx_op(__once_word(flag), UMTX_OP_WAKE_PRIVATE,
+                 numeric_limits<int>::max(), nullptr, nullptr);
+}
+#elif !defined(_LIBCPP_HAS_NO_THREADS)
 _LIBCPP_SAFE_STATIC static __libcpp_mutex_t mut = _LIBCPP_MUTEX_INITIALIZER;
 _LIBCPP_SAFE_STATIC static __libcpp_condvar_t cv = _LIBCPP_CONDVAR_INITIALIZER;
 #endif
@@ -221,6 +254,42 @@ __call_once(volatile unsigned long& flag, void* arg, void(*func)(void*))
         }
 #endif  // _LIBCPP_NO_EXCEPTIONS
     }
+#elif defined(__FreeBSD__)
+    unsigned long* f = const_cast<unsigned long*>(&flag);
+    for (;;)
+    {
+        unsigned long state = __libcpp_atomic_load(f, _AO_Acquire);
+        if (state == ~0ul)
+            return;
+        if (state == 0ul)
+        {
+            if (__libcpp_atomic_compare_exchange(f, &state, 1ul,
+                                                 _AO_Acquire, _AO_Relaxed))
+                break;
+            continue;
+        }
+        // Tell the running thread that it has to wake us up.
+        if (state == 1ul &&
+            !__libcpp_atomic_compare_exchange(f, &state, 2ul,
+                                              _AO_Relaxed, _AO_Relaxed))
+            continue;
+        _umtx_op(__once_word(f), UMTX_OP_WAIT_UINT_PRIVATE, 2ul, nullptr,
+                 nullptr);
+    }
+#ifndef _LIBCPP_NO_EXCEPTIONS
+    try
+    {
+#endif  // _LIBCPP_NO_EXCEPTIONS
+        func(arg);
+        __once_finish(f, ~0ul);
+#ifndef _LIBCPP_NO_EXCEPTIONS
+    }
+    catch (...)
+    {
+        __once_finish(f, 0ul);
+        throw;
+    }
+#endif  // _LIBCPP_NO_EXCEPTIONS
 #else // !_LIBCPP_HAS_NO_THREADS
     __libcpp_mutex_lock(&mut);
     while (flag == 1)
@@ -12,10 +12,24 @@
 
 #define _LIBCPP_BUILDING_SHARED_MUTEX
 #include "shared_mutex"
+#include "include/atomic_support.h"
 
 _LIBCPP_BEGIN_NAMESPACE_STD
 
 // Shared Mutex Base
+//
+// std::shared_mutex only reaches its state through the out-of-line members
+// of __shared_mutex_base, so they keep __state_ with atomic operations and
+// let readers in and out with a single compare-and-swap or add while no
+// writer is around.  __mut_ is only taken to wait on, or to signal, the gates:
+// __gate1_ for threads waiting for a writer to leave and __gate2_ for a
+// writer waiting for the readers to drain.  Writers are preferred: once
+// __write_entered_ is set no new reader is admitted.
+//
+// shared_timed_mutex has inline timed members that update __state_ under
+// __mut_ with plain loads and stores, so it keeps the fully locked protocol
+// in the __shared_timed_* helpers below.
+
 __shared_mutex_base::__shared_mutex_base()
     : __state_(0)
 {
@@ -27,30 +41,38 @@ void
 __shared_mutex_base::lock()
 {
     unique_lock<mutex> lk(__mut_);
-    while (__state_ & __write_entered_)
-        __gate1_.wait(lk);
-    __state_ |= __write_entered_;
-    while (__state_ & __n_readers_)
+    unsigned state = __libcpp_atomic_load(&__state_, _AO_Relaxed);
+    for (;;)
+    {
+        while (state & __write_entered_)
+        {
+            __gate1_.wait(lk);
+            state = __libcpp_atomic_load(&__state_, _AO_Relaxed);
+        }
+        if (__libcpp_atomic_compare_exchange(&__state_, &state,
+                                             state | __write_entered_,
+                                             _AO_Acquire, _AO_Relaxed))
+            break;
+    }
+    while (__libcpp_atomic_load(&__state_, _AO_Acquire) & __n_readers_)
         __gate2_.wait(lk);
 }
 
 bool
 __shared_mutex_base::try_lock()
 {
-    unique_lock<mutex> lk(__mut_);
-    if (__state_ == 0)
-    {
-        __state_ = __write_entered_;
-        return true;
-    }
-    return false;
+    unsigned state = 0;
+    return __libcpp_atomic_compare_exchange(&__state_, &state,
+                                            __write_entered_,
+                                            _AO_Acquire, _AO_Relaxed);
 }
 
 void
 __shared_mutex_base::unlock()
 {
+    __libcpp_atomic_store(&__state_, 0u, _AO_Release);
+    // Taking __mut_ orders this wakeup after any waiter's last check.
     lock_guard<mutex> _(__mut_);
-    __state_ = 0;
     __gate1_.notify_all();
 }
 
@@ -59,25 +81,23 @@ __shared_mutex_base::unlock()
 void
 __shared_mutex_base::lock_shared()
 {
+    if (try_lock_shared())
+        return;
     unique_lock<mutex> lk(__mut_);
-    while ((__state_ & __write_entered_) || (__state_ & __n_readers_) == __n_readers_)
+    while (!try_lock_shared())
         __gate1_.wait(lk);
-    unsigned num_readers = (__state_ & __n_readers_) + 1;
-    __state_ &= ~__n_readers_;
-    __state_ |= num_readers;
 }
 
 bool
 __shared_mutex_base::try_lock_shared()
 {
-    unique_lock<mutex> lk(__mut_);
-    unsigned num_readers = __state_ & __n_readers_;
-    if (!(__state_ & __write_entered_) && num_readers != __n_readers_)
+    unsigned state = __libcpp_atomic_load(&__state_, _AO_Relaxed);
+    while (!(state & __write_entered_) &&
+           (state & __n_readers_) != __n_readers_)
     {
-        ++num_readers;
-        __state_ &= ~__n_readers_;
-        __state_ |= num_readers;
-        return true;
+        if (__libcpp_atomic_compare_exchange(&__state_, &state, state + 1,
+                                             _AO_Acquire, _AO_Relaxed))
+            return true;
     }
     return false;
 }
@@ -85,19 +105,97 @@ __shared_mutex_base::try_lock_shared()
 void
 __shared_mutex_base::unlock_shared()
 {
-    lock_guard<mutex> _(__mut_);
-    unsigned num_readers = (__state_ & __n_readers_) - 1;
-    __state_ &= ~__n_readers_;
-    __state_ |= num_readers;
-    if (__state_ & __write_entered_)
+    unsigned state = __libcpp_atomic_add(&__state_, ~0u, _AO_Release);
+    if (state == __write_entered_)
+    {
+        // The last reader out lets the waiting writer in.
+        lock_guard<mutex> _(__mut_);
+        __gate2_.notify_one();
+    }
+    else if (state == __n_readers_ - 1)
+    {
+        lock_guard<mutex> _(__mut_);
+        __gate1_.notify_one();
+    }
+}
+
+// The fully locked protocol shared with shared_timed_mutex's inline members.
+
+static void
+__timed_lock(__shared_mutex_base& __b)
+{
+    unique_lock<mutex> lk(__b.__mut_);
+    while (__b.__state_ & __b.__write_entered_)
+        __b.__gate1_.wait(lk);
+    __b.__state_ |= __b.__write_entered_;
+    while (__b.__state_ & __b.__n_readers_)
+        __b.__gate2_.wait(lk);
+}
+
+static bool
+__timed_try_lock(__shared_mutex_base& __b)
+{
+    unique_lock<mutex> lk(__b.__mut_);
+    if (__b.__state_ == 0)
+    {
+        __b.__state_ = __b.__write_entered_;
+        return true;
+    }
+    return false;
+}
+
+static void
+__timed_unlock(__shared_mutex_base& __b)
+{
+    lock_guard<mutex> _(__b.__mut_);
+    __b.__state_ = 0;
+    __b.__gate1_.notify_all();
+}
+
+static void
+__timed_lock_shared(__shared_mutex_base& __b)
+{
+    unique_lock<mutex> lk(__b.__mut_);
+    while ((__b.__state_ & __b.__write_entered_) ||
+           (__b.__state_ & __b.__n_readers_) == __b.__n_readers_)
+        __b.__gate1_.wait(lk);
+    unsigned num_readers = (__b.__state_ & __b.__n_readers_) + 1;
+    __b.__state_ &= ~__b.__n_readers_;
+    __b.__state_ |= num_readers;
+}
+
+static bool
+__timed_try_lock_shared(__shared_mutex_base& __b)
+{
+    unique_lock<mutex> lk(__b.__mut_);
+    unsigned num_readers = __b.__state_ & __b.__n_readers_;
+    if (!(__b.__state_ & __b.__write_entered_) &&
+        num_readers != __b.__n_readers_)
+    {
+        ++num_readers;
+        __b.__state_ &= ~__b.__n_readers_;
+        __b.__state_ |= num_readers;
+        return true;
+    }
+    return false;
+}
+
+static void
+__timed_unlock_shared(__shared_mutex_base& __b)
+{
+    lock_guard<mutex> _(__b.__mut_);
+    unsigned num_readers = (__b.__state_ & __b.__n_readers_) - 1;
+    __b.__state_ &= ~__b.__n_readers_;
+    __b.__state_ |= num_readers;
+    if (__b.__state_ & __b.__write_entered_)
     {
         if (num_readers == 0)
-            __gate2_.notify_one();
+            __b.__gate2_.notify_one();
     }
     else
     {
-        if (num_readers == __n_readers_ - 1)
-            __gate1_.notify_one();
+        if (num_readers == __b.__n_readers_ - 1)
+            __b.__gate1_.notify_one();
     }
 }
 
@@ -105,12 +203,12 @@ __shared_mutex_base::unlock_shared()
 // Shared Timed Mutex
 // These routines are here for ABI stability
 shared_timed_mutex::shared_timed_mutex() : __base() {}
-void shared_timed_mutex::lock()     { return __base.lock(); }
-bool shared_timed_mutex::try_lock() { return __base.try_lock(); }
-void shared_timed_mutex::unlock()   { return __base.unlock(); }
-void shared_timed_mutex::lock_shared() { return __base.lock_shared(); }
-bool shared_timed_mutex::try_lock_shared() { return __base.try_lock_shared(); }
-void shared_timed_mutex::unlock_shared() { return __base.unlock_shared(); }
+void shared_timed_mutex::lock()     { return __timed_lock(__base); }
+bool shared_timed_mutex::try_lock() { return __timed_try_lock(__base); }
+void shared_timed_mutex::unlock()   { return __timed_unlock(__base); }
+void shared_timed_mutex::lock_shared() { return __timed_lock_shared(__base); }
+bool shared_timed_mutex::try_lock_shared() { return __timed_try_lock_shared(__base); }
+void shared_timed_mutex::unlock_shared() { return __timed_unlock_shared(__base); }
 
 _LIBCPP_END_NAMESPACE_STD
 
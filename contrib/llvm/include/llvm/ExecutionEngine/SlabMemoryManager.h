@@ -0,0 +1,84 @@
+//===- SlabMemoryManager.h - Slab-based memory manager for MCJIT -*- C++ -*-==//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file contains the declaration of a section memory manager that carves
+// sections out of large per-permission slabs.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef LLVM_EXECUTIONENGINE_SLABMEMORYMANAGER_H
+#define LLVM_EXECUTIONENGINE_SLABMEMORYMANAGER_H
+
+#include "llvm/ExecutionEngine/RTDyldMemoryManager.h"
+#include "llvm/Support/Memory.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace llvm {
+
+/// This memory manager suits programs that load many small objects. Instead
+/// of mapping memory for every section, it bump-allocates code, read-only
+/// data and read-write data out of slabs (one list of slabs per permission
+/// set) that are at least SlabSize bytes large.
+///
+/// finalizeMemory() invalidates the instruction cache and changes the
+/// permissions of each slab's newly used pages with one call apiece. Later
+/// allocations continue past those pages, so a slab is shared by all objects
+/// loaded until it fills up.
+class SlabMemoryManager : public RTDyldMemoryManager {
+public:
+  explicit SlabMemoryManager(size_t SlabSize = 1024 * 1024);
+  SlabMemoryManager(const SlabMemoryManager &) = delete;
+  void operator=(const SlabMemoryManager &) = delete;
+  ~SlabMemoryManager() override;
+
+  uint8_t *allocateCodeSection(uintptr_t Size, unsigned Alignment,
+                               unsigned SectionID,
+                               StringRef SectionName) override;
+
+  uint8_t *allocateDataSection(uintptr_t Size, unsigned Alignment,
+                               unsigned SectionID, StringRef SectionName,
+                               bool IsReadOnly) override;
+
+  /// Reserving lets all sections of an object land in the same slabs.
+  bool needsToReserveAllocationSpace() override { return true; }
+
+  void reserveAllocationSpace(uintptr_t CodeSize, uint32_t CodeAlign,
+                              uintptr_t RODataSize, uint32_t RODataAlign,
+                              uintptr_t RWDataSize,
+                              uint32_t RWDataAlign) override;
+
+  /// Applies the final permissions to all memory allocated since the last
+  /// call. Returns true and sets \p ErrMsg on failure.
+  bool finalizeMemory(std::string *ErrMsg = nullptr) override;
+
+private:
+  enum SlabKind { CodeSlab, RODataSlab, RWDataSlab, NumSlabKinds };
+
+  struct Slab {
+    sys::MemoryBlock Block;
+    // Bytes handed out so far.
+    size_t Used = 0;
+    // Page-aligned prefix that already has its final permissions.
+    size_t Finalized = 0;
+  };
+
+  uint8_t *allocate(SlabKind Kind, uintptr_t Size, unsigned Alignment);
+  bool reserve(SlabKind Kind, uintptr_t Size, unsigned Alignment);
+  Slab *addSlab(SlabKind Kind, size_t MinSize);
+
+  size_t SlabSize;
+  size_t PageSize;
+  std::vector<Slab> Slabs[NumSlabKinds];
+};
+
+} // end namespace llvm
+
+#endif // LLVM_EXECUTIONENGINE_SLABMEMORYMANAGER_H
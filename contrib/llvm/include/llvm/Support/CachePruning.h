@@ -56,6 +56,12 @@ struct CachePruningPolicy {
   /// systems have a limit on how many files can be contained in a directory
   /// (notably ext4, which is limited to around 6000000 files).
   uint64_t MaxSizeFiles = 1000000;
+
+  /// Prune from the index file "llvmcache.index" instead of listing and
+  /// stat()ing the whole directory. Cache users must then report every hit and
+  /// insertion through recordCacheAccess(). The directory is only scanned to
+  /// rebuild the index when it is missing.
+  bool UseIndex = false;
 };
 
 /// Parse the given string as a cache pruning policy. Defaults are taken from a
@@ -73,6 +79,11 @@ Expected<CachePruningPolicy> parseCachePruningPolicy(StringRef PolicyStr);
 /// pattern "llvmcache-*".
 bool pruneCache(StringRef Path, CachePruningPolicy Policy);
 
+/// Append a record to the index of the cache directory Path saying that the
+/// entry FileName (a "llvmcache-*" name within Path) of Size bytes was just
+/// created or used. This is only needed with CachePruningPolicy::UseIndex.
+void recordCacheAccess(StringRef Path, StringRef FileName, uint64_t Size);
+
 } // namespace llvm
 
 #endif
@@ -46,6 +46,42 @@ uint32_t crc32(StringRef Buffer);
 
 }  // End of namespace zlib
 
+namespace zstd {
+
+/// The zstd level used when none is given.
+const int DefaultCompression = 3;
+
+bool isAvailable();
+
+Error compress(StringRef InputBuffer, SmallVectorImpl<char> &CompressedBuffer,
+               int Level = DefaultCompression);
+
+/// Compress \p InputBuffer as a series of independent zstd frames, each
+/// holding at most \p ChunkSize bytes of input, compressing the frames in
+/// parallel. The result is an ordinary zstd stream that uncompress()
+/// accepts, and uncompressRange() can extract part of it without
+/// decompressing the frames before the part wanted.
+Error compressChunked(StringRef InputBuffer,
+                      SmallVectorImpl<char> &CompressedBuffer,
+                      size_t ChunkSize = 1 << 20,
+                      int Level = DefaultCompression);
+
+Error uncompress(StringRef InputBuffer, char *UncompressedBuffer,
+                 size_t &UncompressedSize);
+
+Error uncompress(StringRef InputBuffer,
+                 SmallVectorImpl<char> &UncompressedBuffer,
+                 size_t UncompressedSize);
+
+/// Decompress the \p Size bytes starting at uncompressed offset \p Offset
+/// of a stream made of several frames, such as one from compressChunked(),
+/// into \p UncompressedBuffer. Only the frames overlapping the range are
+/// decompressed.
+Error uncompressRange(StringRef InputBuffer, uint64_t Offset, size_t Size,
+                      char *UncompressedBuffer);
+
+}  // End of namespace zstd
+
 } // End of namespace llvm
 
 #endif
@@ -14,6 +14,8 @@
 #ifndef LLVM_SUPPORT_FILEOUTPUTBUFFER_H
 #define LLVM_SUPPORT_FILEOUTPUTBUFFER_H
 
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/ADT/StringRef.h"
 #include "llvm/Support/DataTypes.h"
@@ -52,6 +54,15 @@ class FileOutputBuffer {
   /// Returns path where file will show up if buffer is committed.
   StringRef getPath() const { return FinalPath; }
 
+  /// Fill the buffer from several threads at once. The buffer is cut into
+  /// disjoint regions of \p ChunkSize bytes, rounded up to a whole number of
+  /// pages so that no two threads dirty the same page, and \p Fill is called
+  /// concurrently for each region with its offset in the buffer and its
+  /// bytes. Returns when every region has been filled.
+  void parallelFill(
+      size_t ChunkSize,
+      function_ref<void(size_t Offset, MutableArrayRef<uint8_t> Region)> Fill);
+
   /// Flushes the content of the buffer to its file and deallocates the
   /// buffer.  If commit() is not called before this object's destructor
   /// is called, the file is deleted in the destructor. The optional parameter
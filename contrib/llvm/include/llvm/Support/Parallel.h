@@ -16,8 +16,12 @@
 
 #include <algorithm>
 #include <condition_variable>
+#include <cstddef>
 #include <functional>
 #include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 #if defined(_MSC_VER) && LLVM_ENABLE_THREADS
 #pragma warning(push)
@@ -44,6 +48,110 @@ constexpr parallel_execution_policy par{};
 
 namespace detail {
 
+/// \brief A move-only void() closure for the executor's queue.
+///
+/// Closures of up to InlineSize bytes, which covers every task spawned by
+/// the algorithms below, are stored in place so that spawning a task does
+/// not allocate.  Larger ones are moved to the heap.
+class SmallTask {
+public:
+  SmallTask() = default;
+
+  template <typename FuncTy,
+            typename = typename std::enable_if<!std::is_same<
+                typename std::decay<FuncTy>::type, SmallTask>::value>::type>
+  SmallTask(FuncTy &&F) {
+    using T = typename std::decay<FuncTy>::type;
+    construct<T>(std::forward<FuncTy>(F),
+                 std::integral_constant<
+                     bool, sizeof(T) <= InlineSize &&
+                               alignof(T) <= alignof(StorageTy) &&
+                               std::is_nothrow_move_constructible<T>::value>());
+  }
+
+  SmallTask(SmallTask &&Other) { moveFrom(Other); }
+
+  SmallTask &operator=(SmallTask &&Other) {
+    if (this != &Other) {
+      reset();
+      moveFrom(Other);
+    }
+    return *this;
+  }
+
+  SmallTask(const SmallTask &) = delete;
+  SmallTask &operator=(const SmallTask &) = delete;
+
+  ~SmallTask() { reset(); }
+
+  void operator()() { Ops->Call(&Storage); }
+
+private:
+  static const size_t InlineSize = 8 * sizeof(void *);
+  using StorageTy = std::aligned_storage<InlineSize>::type;
+
+  struct OpsTy {
+    void (*Call)(void *);
+    void (*Move)(void *Dst, void *Src);
+    void (*Destroy)(void *);
+  };
+
+  template <typename T> struct InlineOps {
+    static void call(void *P) { (*static_cast<T *>(P))(); }
+    static void move(void *Dst, void *Src) {
+      new (Dst) T(std::move(*static_cast<T *>(Src)));
+      static_cast<T *>(Src)->~T();
+    }
+    static void destroy(void *P) { static_cast<T *>(P)->~T(); }
+    static const OpsTy *get() {
+      static const OpsTy Ops = {&call, &move, &destroy};
+      return &Ops;
+    }
+  };
+
+  template <typename T> struct HeapOps {
+    static void call(void *P) { (**static_cast<T **>(P))(); }
+    static void move(void *Dst, void *Src) {
+      *static_cast<T **>(Dst) = *static_cast<T **>(Src);
+    }
+    static void destroy(void *P) { delete *static_cast<T **>(P); }
+    static const OpsTy *get() {
+      static const OpsTy Ops = {&call, &move, &destroy};
+      return &Ops;
+    }
+  };
+
+  template <typename T, typename FuncTy>
+  void construct(FuncTy &&F, std::true_type) {
+    new (&Storage) T(std::forward<FuncTy>(F));
+    Ops = InlineOps<T>::get();
+  }
+
+  template <typename T, typename FuncTy>
+  void construct(FuncTy &&F, std::false_type) {
+    *reinterpret_cast<T **>(&Storage) = new T(std::forward<FuncTy>(F));
+    Ops = HeapOps<T>::get();
+  }
+
+  void moveFrom(SmallTask &Other) {
+    if (!Other.Ops)
+      return;
+    Other.Ops->Move(&Storage, &Other.Storage);
+    Ops = Other.Ops;
+    Other.Ops = nullptr;
+  }
+
+  void reset() {
+    if (!Ops)
+      return;
+    Ops->Destroy(&Storage);
+    Ops = nullptr;
+  }
+
+  StorageTy Storage;
+  const OpsTy *Ops = nullptr;
+};
+
 #if LLVM_ENABLE_THREADS
 
 class Latch {
@@ -75,12 +183,23 @@ class Latch {
 class TaskGroup {
   Latch L;
 
+  void spawnTask(SmallTask Task);
+
 public:
-  void spawn(std::function<void()> f);
+  template <typename FuncTy> void spawn(FuncTy F) {
+    L.inc();
+    spawnTask([this, F]() mutable {
+      F();
+      L.dec();
+    });
+  }
 
   void sync() const { L.sync(); }
 };
 
+/// \brief The number of threads the default executor runs tasks on.
+unsigned getThreadCount();
+
 #if defined(_MSC_VER)
 template <class RandomAccessIterator, class Comparator>
 void parallel_sort(RandomAccessIterator Start, RandomAccessIterator End,
@@ -147,15 +266,21 @@ void parallel_sort(RandomAccessIterator Start, RandomAccessIterator End,
                       llvm::Log2_64(std::distance(Start, End)) + 1);
 }
 
+/// \brief Pick how many elements of a range of \p N each spawned task gets.
+///
+/// TaskGroup has a relatively high overhead, so we want to reduce the number
+/// of spawn() calls, but still want enough tasks per thread that a few slow
+/// chunks do not leave the other threads idle.  We'll create up to 16 tasks
+/// per thread and never more than 1024.
+inline ptrdiff_t getTaskSize(ptrdiff_t N) {
+  ptrdiff_t MaxTasks = std::min<ptrdiff_t>(1024, getThreadCount() * 16);
+  ptrdiff_t TaskSize = N / MaxTasks;
+  return TaskSize ? TaskSize : 1;
+}
+
 template <class IterTy, class FuncTy>
 void parallel_for_each(IterTy Begin, IterTy End, FuncTy Fn) {
-  // TaskGroup has a relatively high overhead, so we want to reduce
-  // the number of spawn() calls. We'll create up to 1024 tasks here.
-  // (Note that 1024 is an arbitrary number. This code probably needs
-  // improving to take the number of available cores into account.)
-  ptrdiff_t TaskSize = std::distance(Begin, End) / 1024;
-  if (TaskSize == 0)
-    TaskSize = 1;
+  ptrdiff_t TaskSize = getTaskSize(std::distance(Begin, End));
 
   TaskGroup TG;
   while (TaskSize < std::distance(Begin, End)) {
@@ -167,9 +292,7 @@ void parallel_for_each(IterTy Begin, IterTy End, FuncTy Fn) {
 
 template <class IndexTy, class FuncTy>
 void parallel_for_each_n(IndexTy Begin, IndexTy End, FuncTy Fn) {
-  ptrdiff_t TaskSize = (End - Begin) / 1024;
-  if (TaskSize == 0)
-    TaskSize = 1;
+  ptrdiff_t TaskSize = getTaskSize(End - Begin);
 
   TaskGroup TG;
   IndexTy I = Begin;
@@ -115,17 +115,56 @@ class SpecialCaseList {
   /// "literal" (i.e. no regex metacharacters) are stored in Strings.  The
   /// reason for doing so is efficiency; StringMap is much faster at matching
   /// literal strings than Regex.
+  ///
+  /// Expressions built only from literal characters, '.' and '*' (the glob
+  /// style that makes up nearly all real lists) are kept out of the regex
+  /// engine.  The longest literal run of each one is added to an Aho-Corasick
+  /// automaton, so a query is scanned once and only the globs whose run
+  /// occurs in it are checked.  Everything else stays a Regex.
   class Matcher {
   public:
     bool insert(std::string Regexp, unsigned LineNumber, std::string &REError);
+    // Builds the automaton over the globs inserted so far.  Called once the
+    // list has been parsed; until then match() checks every glob.
+    void compile();
     // Returns the line number in the source file that this query matches to.
     // Returns zero if no match is found.
     unsigned match(StringRef Query) const;
 
   private:
+    struct Glob {
+      // Literal bytes, or AnyChar / AnyString for '.' and '*'.
+      std::vector<int> Pattern;
+      unsigned LineNumber;
+      // Insertion order; the earliest pattern that matches wins.
+      unsigned Order;
+    };
+    struct GlobNode {
+      std::vector<std::pair<unsigned char, unsigned>> Next;
+      unsigned Fail = 0;
+      // Nearest node on the failure chain with a non-empty Out, or 0.
+      unsigned OutLink = 0;
+      std::vector<unsigned> Out;
+    };
+    struct RegexEntry {
+      std::unique_ptr<Regex> RE;
+      unsigned LineNumber;
+      unsigned Order;
+    };
+
+    static bool matchGlob(const std::vector<int> &Pattern, StringRef Query);
+    // Follows the automaton from State on byte C.
+    unsigned advance(unsigned State, unsigned char C) const;
+
     StringMap<unsigned> Strings;
     TrigramIndex Trigrams;
-    std::vector<std::pair<std::unique_ptr<Regex>, unsigned>> RegExes;
+    std::vector<RegexEntry> RegExes;
+    std::vector<Glob> Globs;
+    // Globs without a literal run; these are checked against every query.
+    std::vector<unsigned> UnfilteredGlobs;
+    std::vector<GlobNode> GlobTrie;
+    bool Compiled = false;
+    unsigned NumPatterns = 0;
   };
 
   using SectionEntries = StringMap<StringMap<Matcher>>;
@@ -139,6 +178,9 @@ class SpecialCaseList {
 
   std::vector<Section> Sections;
 
+  /// Builds the glob automata of every matcher once parsing is done.
+  void compile();
+
   /// Parses just-constructed SpecialCaseList entries from a memory buffer.
   bool parse(const MemoryBuffer *MB, StringMap<size_t> &SectionsMap,
              std::string &Error);
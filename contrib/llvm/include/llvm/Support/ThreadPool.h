@@ -7,7 +7,7 @@
 //
 //===----------------------------------------------------------------------===//
 //
-// This file defines a crude C++11 based thread pool.
+// This file defines a work-stealing C++11 based thread pool.
 //
 //===----------------------------------------------------------------------===//
 
@@ -20,19 +20,23 @@
 
 #include <atomic>
 #include <condition_variable>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <mutex>
 #include <queue>
 #include <utility>
+#include <vector>
 
 namespace llvm {
 
 /// A ThreadPool for asynchronous parallel execution on a defined number of
 /// threads.
 ///
-/// The pool keeps a vector of threads alive, waiting on a condition variable
-/// for some work to become available.
+/// The pool keeps a vector of threads alive, each with its own deque of
+/// tasks.  A worker runs the tasks it queued itself newest first and, when
+/// its deque is empty, steals the oldest task from another worker before
+/// parking on a condition variable.
 class ThreadPool {
 public:
   using TaskTy = std::function<void()>;
@@ -76,24 +80,51 @@ class ThreadPool {
   /// Threads in flight
   std::vector<llvm::thread> Threads;
 
-  /// Tasks waiting for execution in the pool.
-  std::queue<PackagedTaskTy> Tasks;
+#if LLVM_ENABLE_THREADS
+  /// A worker's task deque.  The owner pushes and pops at the back, thieves
+  /// take from the front.
+  struct WorkerQueue {
+    std::mutex Lock;
+    std::deque<PackagedTaskTy> Tasks;
+  };
+
+  /// Main loop of worker \p Index.
+  void work(unsigned Index);
+
+  /// Take a task from worker \p Index's deque, or steal one from another
+  /// worker starting at a random victim.
+  bool popTask(unsigned Index, unsigned &Seed, PackagedTaskTy &Task);
+
+  /// One deque per worker thread.
+  std::vector<std::unique_ptr<WorkerQueue>> Queues;
+
+  /// Round-robin cursor for tasks submitted from outside the pool.
+  std::atomic<unsigned> NextQueue;
+
+  /// Tasks sitting in some deque, used to decide when workers may park.
+  std::atomic<unsigned> QueuedTasks;
+
+  /// Tasks submitted but not yet finished running, for wait().
+  std::atomic<unsigned> PendingTasks;
+
+  /// Workers parked on QueueCondition; submitters only take QueueLock to
+  /// wake one up when this is non-zero.
+  std::atomic<unsigned> IdleThreads;
 
-  /// Locking and signaling for accessing the Tasks queue.
+  /// Locking and signaling for parking idle workers.
   std::mutex QueueLock;
   std::condition_variable QueueCondition;
 
+  /// Signal for the destruction of the pool, asking thread to exit.
+  std::atomic<bool> EnableFlag;
+#else
+  /// Tasks waiting for execution in the pool.
+  std::queue<PackagedTaskTy> Tasks;
+#endif
+
   /// Locking and signaling for job completion
   std::mutex CompletionLock;
   std::condition_variable CompletionCondition;
-
-  /// Keep track of the number of thread actually busy
-  std::atomic<unsigned> ActiveThreads;
-
-#if LLVM_ENABLE_THREADS // avoids warning for unused variable
-  /// Signal for the destruction of the pool, asking thread to exit.
-  bool EnableFlag;
-#endif
 };
 }
 
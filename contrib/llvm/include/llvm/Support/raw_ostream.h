@@ -20,6 +20,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <cstring>
+#include <memory>
 #include <string>
 #include <system_error>
 
@@ -442,6 +443,54 @@ class raw_fd_ostream : public raw_pwrite_stream {
   void clear_error() { EC = std::error_code(); }
 };
 
+/// A raw_ostream that writes to a file from a background thread.
+///
+/// Output is gathered in large chunks. Each full chunk is handed to a writer
+/// thread, which writes everything queued so far with one writev() while the
+/// caller goes on filling the next chunk. When a few chunks are already
+/// waiting, the caller blocks until the writer catches up. The data is only
+/// known to be in the file after close() or destruction; flush() just queues
+/// what is buffered.
+class raw_async_fd_ostream : public raw_ostream {
+  struct Writer;
+  std::unique_ptr<Writer> W;
+
+  uint64_t Pos = 0;
+
+  size_t ChunkSize;
+
+  /// See raw_ostream::write_impl.
+  void write_impl(const char *Ptr, size_t Size) override;
+
+  /// Return the current position within the stream, not counting the bytes
+  /// currently in the buffer.
+  uint64_t current_pos() const override { return Pos; }
+
+  size_t preferred_buffer_size() const override { return ChunkSize; }
+
+public:
+  /// Open the specified file for writing, as raw_fd_ostream does. If an error
+  /// occurs, information about the error is put into EC, and the stream
+  /// should be immediately destroyed. \p ChunkSize is the size of the
+  /// chunks handed to the writer thread.
+  raw_async_fd_ostream(StringRef Filename, std::error_code &EC,
+                       sys::fs::OpenFlags Flags,
+                       size_t ChunkSize = 1024 * 1024);
+
+  ~raw_async_fd_ostream() override;
+
+  /// Write out everything, wait for the writer thread and close the file.
+  void close();
+
+  /// Return the first error the writer thread ran into, if any.
+  std::error_code error() const;
+
+  bool has_error() const { return bool(error()); }
+
+  /// See raw_fd_ostream::clear_error().
+  void clear_error();
+};
+
 /// This returns a reference to a raw_ostream for standard output. Use it like:
 /// outs() << "foo" << "bar";
 raw_ostream &outs();
@@ -22,6 +22,7 @@
 #include "llvm/Support/ManagedStatic.h"
 #include "llvm/Support/MathExtras.h"
 #include "llvm/Support/MutexGuard.h"
+#include "llvm/Support/Parallel.h"
 
 using namespace llvm;
 using namespace llvm::object;
@@ -133,16 +134,25 @@ void RuntimeDyldImpl::resolveRelocations() {
     ErrorStr = toString(std::move(Err));
   }
 
-  // Iterate over all outstanding relocations
-  for (auto it = Relocations.begin(), e = Relocations.end(); it != e; ++it) {
-    // The Section here (Sections[i]) refers to the section in which the
-    // symbol for the relocation is located.  The SectionID in the relocation
-    // entry provides the section to which the relocation will be applied.
-    int Idx = it->first;
-    uint64_t Addr = Sections[Idx].getLoadAddress();
-    DEBUG(dbgs() << "Resolving relocations Section #" << Idx << "\t"
-                 << format("%p", (uintptr_t)Addr) << "\n");
-    resolveRelocationList(it->second, Addr);
+  size_t NumRelocations = 0;
+  for (const auto &KV : Relocations)
+    NumRelocations += KV.second.size();
+
+  if (NumRelocations >= MinParallelRelocations &&
+      canResolveRelocationsConcurrently()) {
+    resolveLocalRelocationsInParallel();
+  } else {
+    // Iterate over all outstanding relocations
+    for (auto it = Relocations.begin(), e = Relocations.end(); it != e; ++it) {
+      // The Section here (Sections[i]) refers to the section in which the
+      // symbol for the relocation is located.  The SectionID in the relocation
+      // entry provides the section to which the relocation will be applied.
+      int Idx = it->first;
+      uint64_t Addr = Sections[Idx].getLoadAddress();
+      DEBUG(dbgs() << "Resolving relocations Section #" << Idx << "\t"
+                   << format("%p", (uintptr_t)Addr) << "\n");
+      resolveRelocationList(it->second, Addr);
+    }
   }
   Relocations.clear();
 
@@ -154,6 +164,29 @@ void RuntimeDyldImpl::resolveRelocations() {
 
 }
 
+void RuntimeDyldImpl::resolveLocalRelocationsInParallel() {
+  // Regroup the relocations by the section they patch, keeping the order in
+  // which the serial loop would apply them, so that each task owns the memory
+  // it writes.
+  std::vector<std::vector<std::pair<const RelocationEntry *, uint64_t>>>
+      ByTarget(Sections.size());
+  for (const auto &KV : Relocations) {
+    uint64_t Addr = Sections[KV.first].getLoadAddress();
+    for (const RelocationEntry &RE : KV.second)
+      // Ignore relocations for sections that were not loaded
+      if (Sections[RE.SectionID].getAddress() != nullptr)
+        ByTarget[RE.SectionID].push_back({&RE, Addr});
+  }
+  DEBUG(dbgs() << "Resolving relocations of " << Sections.size()
+               << " sections in parallel\n");
+  parallel::for_each_n(parallel::par, size_t(0), ByTarget.size(),
+                       [&](size_t Idx) {
+                         for (const auto &RelocAndValue : ByTarget[Idx])
+                           resolveRelocation(*RelocAndValue.first,
+                                             RelocAndValue.second);
+                       });
+}
+
 void RuntimeDyldImpl::mapSectionAddress(const void *LocalAddress,
                                         uint64_t TargetAddress) {
   MutexGuard locked(lock);
@@ -939,6 +939,30 @@ void RuntimeDyldELF::resolveRelocation(const SectionEntry &Section,
   }
 }
 
+bool RuntimeDyldELF::canResolveRelocationsConcurrently() const {
+  // The resolvers above only patch the relocated bytes. MIPS is handled by a
+  // subclass that carries state between paired relocations.
+  switch (Arch) {
+  case Triple::x86_64:
+  case Triple::x86:
+  case Triple::aarch64:
+  case Triple::aarch64_be:
+  case Triple::arm:
+  case Triple::armeb:
+  case Triple::thumb:
+  case Triple::thumbeb:
+  case Triple::ppc:
+  case Triple::ppc64:
+  case Triple::ppc64le:
+  case Triple::systemz:
+  case Triple::bpfel:
+  case Triple::bpfeb:
+    return true;
+  default:
+    return false;
+  }
+}
+
 void *RuntimeDyldELF::computePlaceholderAddress(unsigned SectionID, uint64_t Offset) const {
   return (void *)(Sections[SectionID].getObjAddress() + Offset);
 }
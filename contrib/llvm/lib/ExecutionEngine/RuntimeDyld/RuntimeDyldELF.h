@@ -161,6 +161,8 @@ class RuntimeDyldELF : public RuntimeDyldImpl {
   bool relocationNeedsGot(const RelocationRef &R) const override;
   bool relocationNeedsStub(const RelocationRef &R) const override;
 
+  bool canResolveRelocationsConcurrently() const override;
+
 public:
   RuntimeDyldELF(RuntimeDyld::MemoryManager &MemMgr,
                  JITSymbolResolver &Resolver);
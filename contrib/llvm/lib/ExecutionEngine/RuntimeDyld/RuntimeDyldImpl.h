@@ -418,6 +418,13 @@ class RuntimeDyldImpl {
   /// \brief Resolves relocations from Relocs list with address from Value.
   void resolveRelocationList(const RelocationList &Relocs, uint64_t Value);
 
+  /// \brief Resolves all of Relocations, one task per relocated section.
+  void resolveLocalRelocationsInParallel();
+
+  /// \brief Below this many local relocations, resolveRelocations() stays on
+  /// the calling thread.
+  static const size_t MinParallelRelocations = 4096;
+
   /// \brief A object file specific relocation resolver
   /// \param RE The relocation to be resolved
   /// \param Value Target symbol address to apply the relocation action
@@ -465,6 +472,11 @@ class RuntimeDyldImpl {
     return true;    // Conservative answer
   }
 
+  // \brief Return true if resolveRelocation() only writes the relocated
+  // location, so that relocations targeting different sections can be
+  // resolved on different threads.
+  virtual bool canResolveRelocationsConcurrently() const { return false; }
+
 public:
   RuntimeDyldImpl(RuntimeDyld::MemoryManager &MemMgr,
                   JITSymbolResolver &Resolver)
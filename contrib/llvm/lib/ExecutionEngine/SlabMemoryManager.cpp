@@ -0,0 +1,131 @@
+//===- SlabMemoryManager.cpp - Slab-based memory manager for MCJIT --------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the slab-based section memory manager used by MCJIT.
+//
+//===----------------------------------------------------------------------===//
+
+#include "llvm/ExecutionEngine/SlabMemoryManager.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/Process.h"
+#include <algorithm>
+#include <cassert>
+
+namespace llvm {
+
+SlabMemoryManager::SlabMemoryManager(size_t SlabSize)
+    : SlabSize(SlabSize), PageSize(sys::Process::getPageSize()) {}
+
+SlabMemoryManager::~SlabMemoryManager() {
+  for (auto &KindSlabs : Slabs)
+    for (Slab &S : KindSlabs)
+      sys::Memory::releaseMappedMemory(S.Block);
+}
+
+uint8_t *SlabMemoryManager::allocateCodeSection(uintptr_t Size,
+                                                unsigned Alignment,
+                                                unsigned SectionID,
+                                                StringRef SectionName) {
+  return allocate(CodeSlab, Size, Alignment);
+}
+
+uint8_t *SlabMemoryManager::allocateDataSection(uintptr_t Size,
+                                                unsigned Alignment,
+                                                unsigned SectionID,
+                                                StringRef SectionName,
+                                                bool IsReadOnly) {
+  return allocate(IsReadOnly ? RODataSlab : RWDataSlab, Size, Alignment);
+}
+
+void SlabMemoryManager::reserveAllocationSpace(
+    uintptr_t CodeSize, uint32_t CodeAlign, uintptr_t RODataSize,
+    uint32_t RODataAlign, uintptr_t RWDataSize, uint32_t RWDataAlign) {
+  // Failing here is harmless: allocate() retries and reports the error.
+  reserve(CodeSlab, CodeSize, CodeAlign);
+  reserve(RODataSlab, RODataSize, RODataAlign);
+  reserve(RWDataSlab, RWDataSize, RWDataAlign);
+}
+
+SlabMemoryManager::Slab *SlabMemoryManager::addSlab(SlabKind Kind,
+                                                    size_t MinSize) {
+  std::error_code EC;
+  size_t Size = alignTo(std::max(SlabSize, MinSize), PageSize);
+  sys::MemoryBlock Block = sys::Memory::allocateMappedMemory(
+      Size, nullptr, sys::Memory::MF_READ | sys::Memory::MF_WRITE, EC);
+  if (EC)
+    return nullptr;
+  Slabs[Kind].emplace_back();
+  Slabs[Kind].back().Block = Block;
+  return &Slabs[Kind].back();
+}
+
+bool SlabMemoryManager::reserve(SlabKind Kind, uintptr_t Size,
+                                unsigned Alignment) {
+  if (Size == 0)
+    return true;
+  size_t Needed = Size + std::max(Alignment, 16u);
+  if (!Slabs[Kind].empty()) {
+    const Slab &S = Slabs[Kind].back();
+    if (S.Block.size() - std::max(S.Used, S.Finalized) >= Needed)
+      return true;
+  }
+  return addSlab(Kind, Needed) != nullptr;
+}
+
+uint8_t *SlabMemoryManager::allocate(SlabKind Kind, uintptr_t Size,
+                                     unsigned Alignment) {
+  if (!Alignment)
+    Alignment = 16;
+  assert(isPowerOf2_32(Alignment) && "Alignment must be a power of two.");
+
+  // Only the newest slab of each kind is still being filled.
+  auto TryAllocate = [&](Slab &S) -> uint8_t * {
+    uintptr_t Base = reinterpret_cast<uintptr_t>(S.Block.base());
+    uintptr_t Addr = alignTo(Base + std::max(S.Used, S.Finalized), Alignment);
+    if (Addr + Size > Base + S.Block.size())
+      return nullptr;
+    S.Used = Addr + Size - Base;
+    return reinterpret_cast<uint8_t *>(Addr);
+  };
+
+  if (!Slabs[Kind].empty())
+    if (uint8_t *Addr = TryAllocate(Slabs[Kind].back()))
+      return Addr;
+  Slab *S = addSlab(Kind, Size + Alignment);
+  if (!S)
+    return nullptr;
+  return TryAllocate(*S);
+}
+
+bool SlabMemoryManager::finalizeMemory(std::string *ErrMsg) {
+  // Read-write data needs no protection change and keeps filling its slabs.
+  for (SlabKind Kind : {CodeSlab, RODataSlab}) {
+    unsigned Flags = Kind == CodeSlab
+                         ? sys::Memory::MF_READ | sys::Memory::MF_EXEC
+                         : sys::Memory::MF_READ;
+    for (Slab &S : Slabs[Kind]) {
+      size_t End = alignTo(S.Used, PageSize);
+      if (End <= S.Finalized)
+        continue;
+      uint8_t *Base = static_cast<uint8_t *>(S.Block.base()) + S.Finalized;
+      if (Kind == CodeSlab)
+        sys::Memory::InvalidateInstructionCache(Base, S.Used - S.Finalized);
+      if (std::error_code EC = sys::Memory::protectMappedMemory(
+              sys::MemoryBlock(Base, End - S.Finalized), Flags)) {
+        if (ErrMsg)
+          *ErrMsg = EC.message();
+        return true;
+      }
+      S.Finalized = End;
+    }
+  }
+  return false;
+}
+
+} // end namespace llvm
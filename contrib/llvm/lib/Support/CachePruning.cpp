@@ -13,15 +13,21 @@
 
 #include "llvm/Support/CachePruning.h"
 
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringMap.h"
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/Errc.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/Path.h"
 #include "llvm/Support/raw_ostream.h"
 
 #define DEBUG_TYPE "cache-pruning"
 
+#include <algorithm>
+#include <limits>
 #include <set>
 #include <system_error>
 
@@ -117,6 +123,12 @@ llvm::parseCachePruningPolicy(StringRef PolicyStr) {
       if (Value.getAsInteger(0, Policy.MaxSizeFiles))
         return make_error<StringError>("'" + Value + "' not an integer",
                                        inconvertibleErrorCode());
+    } else if (Key == "cache_index") {
+      unsigned UseIndex;
+      if (Value.getAsInteger(0, UseIndex) || UseIndex > 1)
+        return make_error<StringError>("'" + Value + "' must be 0 or 1",
+                                       inconvertibleErrorCode());
+      Policy.UseIndex = UseIndex;
     } else {
       return make_error<StringError>("Unknown key: '" + Key + "'",
                                      inconvertibleErrorCode());
@@ -126,6 +138,229 @@ llvm::parseCachePruningPolicy(StringRef PolicyStr) {
   return Policy;
 }
 
+namespace {
+/// What the index knows about one cache entry.
+struct CacheIndexEntry {
+  uint64_t AccessTime; // Seconds since the epoch.
+  uint64_t Size;
+};
+} // end anonymous namespace
+
+/// Number of files handed to the thread pool at a time when pruning from the
+/// index.
+static const size_t PruneBatchSize = 1024;
+
+static uint64_t toIndexTime(sys::TimePoint<> Time) {
+  return std::chrono::duration_cast<std::chrono::seconds>(
+             Time.time_since_epoch())
+      .count();
+}
+
+static void getIndexFile(StringRef Path, SmallVectorImpl<char> &IndexFile) {
+  IndexFile.assign(Path.begin(), Path.end());
+  sys::path::append(IndexFile, "llvmcache.index");
+}
+
+/// Load the index of the cache at Path. The index is a journal of
+/// "<access time> <size> <file name>" lines, where the last record for a file
+/// wins. Returns the number of records read, which may be larger than the
+/// number of live entries.
+static ErrorOr<size_t> readCacheIndex(StringRef Path,
+                                      StringMap<CacheIndexEntry> &Entries) {
+  SmallString<128> IndexFile;
+  getIndexFile(Path, IndexFile);
+  auto BufferOrErr =
+      MemoryBuffer::getFile(IndexFile, /*FileSize=*/-1,
+                            /*RequiresNullTerminator=*/false,
+                            /*IsVolatile=*/true, /*IsSequential=*/true);
+  if (!BufferOrErr)
+    return BufferOrErr.getError();
+
+  size_t NumRecords = 0;
+  StringRef Rest = (*BufferOrErr)->getBuffer();
+  while (!Rest.empty()) {
+    StringRef Line;
+    std::tie(Line, Rest) = Rest.split('\n');
+    StringRef Time, Size, Name;
+    std::tie(Time, Line) = Line.split(' ');
+    std::tie(Size, Name) = Line.split(' ');
+    CacheIndexEntry Entry;
+    // A torn append from a crashed writer; skip it.
+    if (!Name.startswith("llvmcache-") ||
+        Time.getAsInteger(10, Entry.AccessTime) ||
+        Size.getAsInteger(10, Entry.Size))
+      continue;
+    Entries[Name] = Entry;
+    ++NumRecords;
+  }
+  return NumRecords;
+}
+
+/// Rebuild the index from the directory contents, using the file system's
+/// access times.
+static void scanCacheDirectory(StringRef Path,
+                               StringMap<CacheIndexEntry> &Entries) {
+  std::error_code EC;
+  SmallString<128> CachePathNative;
+  sys::path::native(Path, CachePathNative);
+  for (sys::fs::directory_iterator File(CachePathNative, EC), FileEnd;
+       File != FileEnd && !EC; File.increment(EC)) {
+    StringRef Name = sys::path::filename(File->path());
+    if (!Name.startswith("llvmcache-"))
+      continue;
+    ErrorOr<sys::fs::basic_file_status> StatusOrErr = File->status();
+    if (!StatusOrErr)
+      continue;
+    Entries[Name] = {toIndexTime(StatusOrErr->getLastAccessedTime()),
+                     StatusOrErr->getSize()};
+  }
+}
+
+/// Replace the index with one record per live entry. Records appended by other
+/// processes between reading the index and the rename are lost; those files
+/// are picked up again by the next rebuild.
+static void writeCacheIndex(StringRef Path,
+                            const StringMap<CacheIndexEntry> &Entries) {
+  SmallString<128> IndexFile, TempFile;
+  getIndexFile(Path, IndexFile);
+  int FD;
+  if (sys::fs::createUniqueFile(Twine(IndexFile) + "-%%%%%%", FD, TempFile))
+    return;
+  {
+    raw_fd_ostream OS(FD, /*shouldClose=*/true);
+    for (const auto &Entry : Entries)
+      OS << Entry.getValue().AccessTime << ' ' << Entry.getValue().Size << ' '
+         << Entry.getKey() << '\n';
+    OS.close();
+    if (OS.has_error()) {
+      OS.clear_error();
+      sys::fs::remove(TempFile);
+      return;
+    }
+  }
+  if (sys::fs::rename(TempFile, IndexFile))
+    sys::fs::remove(TempFile);
+}
+
+void llvm::recordCacheAccess(StringRef Path, StringRef FileName,
+                             uint64_t Size) {
+  SmallString<128> IndexFile;
+  getIndexFile(Path, IndexFile);
+  // Format the whole record first so that it reaches the file in a single
+  // O_APPEND write and concurrent writers don't interleave.
+  SmallString<128> Record;
+  raw_svector_ostream(Record)
+      << toIndexTime(std::chrono::system_clock::now()) << ' ' << Size << ' '
+      << FileName << '\n';
+  std::error_code EC;
+  raw_fd_ostream OS(IndexFile, EC, sys::fs::F_Append);
+  if (EC)
+    return;
+  OS << Record;
+  OS.close();
+  if (OS.has_error())
+    OS.clear_error();
+}
+
+/// Prune the cache using its index rather than the directory contents.
+static bool pruneCacheFromIndex(StringRef Path,
+                                const CachePruningPolicy &Policy,
+                                sys::TimePoint<> CurrentTime) {
+  StringMap<CacheIndexEntry> Entries;
+  bool Rewrite = false;
+  size_t NumRecords = 0;
+  ErrorOr<size_t> NumRecordsOrErr = readCacheIndex(Path, Entries);
+  if (NumRecordsOrErr) {
+    NumRecords = *NumRecordsOrErr;
+  } else if (NumRecordsOrErr.getError() == errc::no_such_file_or_directory) {
+    DEBUG(dbgs() << "No cache index, rebuilding it from the directory\n");
+    scanCacheDirectory(Path, Entries);
+    Rewrite = true;
+  } else {
+    return false;
+  }
+
+  // Oldest first; ties are broken by name for determinism.
+  std::vector<StringMapEntry<CacheIndexEntry> *> Sorted;
+  Sorted.reserve(Entries.size());
+  uint64_t TotalSize = 0;
+  for (auto &Entry : Entries) {
+    Sorted.push_back(&Entry);
+    TotalSize += Entry.getValue().Size;
+  }
+  std::sort(Sorted.begin(), Sorted.end(),
+            [](const StringMapEntry<CacheIndexEntry> *A,
+               const StringMapEntry<CacheIndexEntry> *B) {
+              if (A->getValue().AccessTime != B->getValue().AccessTime)
+                return A->getValue().AccessTime < B->getValue().AccessTime;
+              return A->getKey() < B->getKey();
+            });
+
+  uint64_t TotalSizeTarget = std::numeric_limits<uint64_t>::max();
+  if (Policy.MaxSizePercentageOfAvailableSpace > 0 || Policy.MaxSizeBytes > 0) {
+    auto ErrOrSpaceInfo = sys::fs::disk_space(Path);
+    if (!ErrOrSpaceInfo) {
+      report_fatal_error("Can't get available size");
+    }
+    uint64_t AvailableSpace = TotalSize + ErrOrSpaceInfo->free;
+    unsigned Percentage = Policy.MaxSizePercentageOfAvailableSpace
+                              ? Policy.MaxSizePercentageOfAvailableSpace
+                              : 100;
+    uint64_t MaxSizeBytes =
+        Policy.MaxSizeBytes ? Policy.MaxSizeBytes : AvailableSpace;
+    TotalSizeTarget = std::min<uint64_t>(AvailableSpace * Percentage / 100ull,
+                                         MaxSizeBytes);
+  }
+
+  // Walk from the oldest entry until every limit is satisfied.
+  uint64_t Now = toIndexTime(CurrentTime);
+  uint64_t Expiration = Policy.Expiration.count();
+  size_t NumFiles = Sorted.size();
+  size_t NumToRemove = 0;
+  for (auto *Entry : Sorted) {
+    bool Expired = Expiration && Entry->getValue().AccessTime < Now &&
+                   Now - Entry->getValue().AccessTime > Expiration;
+    bool TooMany = Policy.MaxSizeFiles && NumFiles > Policy.MaxSizeFiles;
+    if (!Expired && !TooMany && TotalSize <= TotalSizeTarget)
+      break;
+    TotalSize -= Entry->getValue().Size;
+    --NumFiles;
+    ++NumToRemove;
+  }
+  DEBUG(dbgs() << "Removing " << NumToRemove << " of " << Sorted.size()
+               << " indexed cache files\n");
+
+  // Remove in batches so that only a bounded number of paths is materialized
+  // at a time, with the removals of each batch spread over the thread pool.
+  std::vector<std::string> Paths;
+  std::vector<char> Removed;
+  for (size_t Begin = 0; Begin < NumToRemove; Begin += PruneBatchSize) {
+    size_t End = std::min(NumToRemove, Begin + PruneBatchSize);
+    Paths.clear();
+    for (size_t I = Begin; I != End; ++I) {
+      SmallString<128> File(Path);
+      sys::path::append(File, Sorted[I]->getKey());
+      Paths.push_back(std::string(File.str()));
+    }
+    Removed.assign(Paths.size(), false);
+    parallel::for_each_n(parallel::par, size_t(0), Paths.size(),
+                         [&](size_t I) {
+                           std::error_code EC = sys::fs::remove(Paths[I]);
+                           Removed[I] = !EC;
+                         });
+    // A file that could not be removed for reasons other than being gone
+    // already stays in the index.
+    for (size_t I = Begin; I != End; ++I)
+      if (Removed[I - Begin] || !sys::fs::exists(Paths[I - Begin]))
+        Entries.erase(Sorted[I]->getKey());
+  }
+
+  // Compact the journal once it mostly holds stale records.
+  if (NumToRemove || Rewrite || NumRecords > 2 * Entries.size())
+    writeCacheIndex(Path, Entries);
+  return true;
+}
+
 /// Prune the cache of files that haven't been accessed in a long time.
 bool llvm::pruneCache(StringRef Path, CachePruningPolicy Policy) {
   using namespace std::chrono;
@@ -185,6 +420,9 @@ bool llvm::pruneCache(StringRef Path, CachePruningPolicy Policy) {
     writeTimestampFile(TimestampFile);
   }
 
+  if (Policy.UseIndex)
+    return pruneCacheFromIndex(Path, Policy, CurrentTime);
+
   // Keep track of space. Needs to be kept ordered by size for determinism.
   std::set<std::pair<uint64_t, std::string>> FileSizes;
   uint64_t TotalSize = 0;
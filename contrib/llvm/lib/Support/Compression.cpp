@@ -18,16 +18,27 @@
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/Error.h"
 #include "llvm/Support/ErrorHandling.h"
+#include "llvm/Support/Parallel.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
 #if LLVM_ENABLE_ZLIB == 1 && HAVE_ZLIB_H
 #include <zlib.h>
 #endif
+#if LLVM_ENABLE_ZSTD == 1
+#define ZSTD_STATIC_LINKING_ONLY // for ZSTD_findFrameCompressedSize()
+#include <zstd.h>
+#endif
 
 using namespace llvm;
 
-#if LLVM_ENABLE_ZLIB == 1 && HAVE_LIBZ
+#if (LLVM_ENABLE_ZLIB == 1 && HAVE_LIBZ) || LLVM_ENABLE_ZSTD == 1
 static Error createError(StringRef Err) {
   return make_error<StringError>(Err, inconvertibleErrorCode());
 }
+#endif
+
+#if LLVM_ENABLE_ZLIB == 1 && HAVE_LIBZ
 
 static int encodeZlibCompressionLevel(zlib::CompressionLevel Level) {
   switch (Level) {
@@ -119,3 +130,144 @@ uint32_t zlib::crc32(StringRef Buffer) {
 }
 #endif
 
+#if LLVM_ENABLE_ZSTD == 1
+static Error createZstdError(size_t Code) {
+  return createError(std::string("zstd error: ") + ZSTD_getErrorName(Code));
+}
+
+bool zstd::isAvailable() { return true; }
+
+Error zstd::compress(StringRef InputBuffer,
+                     SmallVectorImpl<char> &CompressedBuffer, int Level) {
+  size_t CompressedSize = ZSTD_compressBound(InputBuffer.size());
+  CompressedBuffer.resize(CompressedSize);
+  size_t Res = ZSTD_compress(CompressedBuffer.data(), CompressedSize,
+                             InputBuffer.data(), InputBuffer.size(), Level);
+  if (ZSTD_isError(Res))
+    return createZstdError(Res);
+  // Tell MemorySanitizer that zstd output buffer is fully initialized.
+  __msan_unpoison(CompressedBuffer.data(), Res);
+  CompressedBuffer.resize(Res);
+  return Error::success();
+}
+
+Error zstd::compressChunked(StringRef InputBuffer,
+                            SmallVectorImpl<char> &CompressedBuffer,
+                            size_t ChunkSize, int Level) {
+  ChunkSize = std::max<size_t>(ChunkSize, 1);
+  size_t NumChunks = (InputBuffer.size() + ChunkSize - 1) / ChunkSize;
+  if (NumChunks <= 1)
+    return compress(InputBuffer, CompressedBuffer, Level);
+
+  // Compress every chunk into its own bound-sized slot, then pack the
+  // frames together.
+  size_t Bound = ZSTD_compressBound(ChunkSize);
+  std::vector<char> Scratch(Bound * NumChunks);
+  std::vector<size_t> Sizes(NumChunks);
+  parallel::for_each_n(parallel::par, size_t(0), NumChunks, [&](size_t I) {
+    StringRef Chunk = InputBuffer.substr(I * ChunkSize, ChunkSize);
+    Sizes[I] = ZSTD_compress(Scratch.data() + I * Bound, Bound, Chunk.data(),
+                             Chunk.size(), Level);
+  });
+
+  size_t Total = 0;
+  for (size_t Size : Sizes) {
+    if (ZSTD_isError(Size))
+      return createZstdError(Size);
+    Total += Size;
+  }
+  CompressedBuffer.resize(Total);
+  char *Out = CompressedBuffer.data();
+  for (size_t I = 0; I != NumChunks; ++I) {
+    memcpy(Out, Scratch.data() + I * Bound, Sizes[I]);
+    Out += Sizes[I];
+  }
+  __msan_unpoison(CompressedBuffer.data(), Total);
+  return Error::success();
+}
+
+Error zstd::uncompress(StringRef InputBuffer, char *UncompressedBuffer,
+                       size_t &UncompressedSize) {
+  size_t Res = ZSTD_decompress(UncompressedBuffer, UncompressedSize,
+                               InputBuffer.data(), InputBuffer.size());
+  if (ZSTD_isError(Res))
+    return createZstdError(Res);
+  // Tell MemorySanitizer that zstd output buffer is fully initialized.
+  __msan_unpoison(UncompressedBuffer, Res);
+  UncompressedSize = Res;
+  return Error::success();
+}
+
+Error zstd::uncompress(StringRef InputBuffer,
+                       SmallVectorImpl<char> &UncompressedBuffer,
+                       size_t UncompressedSize) {
+  UncompressedBuffer.resize(UncompressedSize);
+  Error E =
+      uncompress(InputBuffer, UncompressedBuffer.data(), UncompressedSize);
+  UncompressedBuffer.resize(UncompressedSize);
+  return E;
+}
+
+Error zstd::uncompressRange(StringRef InputBuffer, uint64_t Offset,
+                            size_t Size, char *UncompressedBuffer) {
+  const uint64_t End = Offset + Size;
+  // Uncompressed offset of the frame at the front of InputBuffer.
+  uint64_t FrameStart = 0;
+  std::vector<char> Frame;
+  while (FrameStart < End) {
+    if (InputBuffer.empty())
+      return createError("zstd error: range past the end of the stream");
+    size_t FrameSize =
+        ZSTD_findFrameCompressedSize(InputBuffer.data(), InputBuffer.size());
+    if (ZSTD_isError(FrameSize))
+      return createZstdError(FrameSize);
+    unsigned long long ContentSize =
+        ZSTD_getFrameContentSize(InputBuffer.data(), InputBuffer.size());
+    if (ContentSize == ZSTD_CONTENTSIZE_UNKNOWN ||
+        ContentSize == ZSTD_CONTENTSIZE_ERROR)
+      return createError("zstd error: frame does not record its size");
+
+    // Skip frames that end before the range without decompressing them.
+    uint64_t FrameEnd = FrameStart + ContentSize;
+    if (FrameEnd > Offset) {
+      Frame.resize(ContentSize);
+      size_t Res = ZSTD_decompress(Frame.data(), Frame.size(),
+                                   InputBuffer.data(), FrameSize);
+      if (ZSTD_isError(Res))
+        return createZstdError(Res);
+      uint64_t From = std::max(Offset, FrameStart);
+      uint64_t To = std::min(End, FrameEnd);
+      memcpy(UncompressedBuffer + (From - Offset),
+             Frame.data() + (From - FrameStart), To - From);
+    }
+    FrameStart = FrameEnd;
+    InputBuffer = InputBuffer.drop_front(FrameSize);
+  }
+  return Error::success();
+}
+
+#else
+bool zstd::isAvailable() { return false; }
+Error zstd::compress(StringRef InputBuffer,
+                     SmallVectorImpl<char> &CompressedBuffer, int Level) {
+  llvm_unreachable("zstd::compress is unavailable");
+}
+Error zstd::compressChunked(StringRef InputBuffer,
+                            SmallVectorImpl<char> &CompressedBuffer,
+                            size_t ChunkSize, int Level) {
+  llvm_unreachable("zstd::compressChunked is unavailable");
+}
+Error zstd::uncompress(StringRef InputBuffer, char *UncompressedBuffer,
+                       size_t &UncompressedSize) {
+  llvm_unreachable("zstd::uncompress is unavailable");
+}
+Error zstd::uncompress(StringRef InputBuffer,
+                       SmallVectorImpl<char> &UncompressedBuffer,
+                       size_t UncompressedSize) {
+  llvm_unreachable("zstd::uncompress is unavailable");
+}
+Error zstd::uncompressRange(StringRef InputBuffer, uint64_t Offset,
+                            size_t Size, char *UncompressedBuffer) {
+  llvm_unreachable("zstd::uncompressRange is unavailable");
+}
+#endif
@@ -15,8 +15,11 @@
 #include "llvm/ADT/STLExtras.h"
 #include "llvm/ADT/SmallString.h"
 #include "llvm/Support/Errc.h"
+#include "llvm/Support/MathExtras.h"
 #include "llvm/Support/Memory.h"
+#include "llvm/Support/Parallel.h"
 #include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
 #include <system_error>
 
 #if !defined(_MSC_VER) && !defined(__MINGW32__)
@@ -139,6 +142,23 @@ createOnDiskBuffer(StringRef Path, size_t Size, unsigned Mode) {
                                          std::move(MappedFile));
 }
 
+void FileOutputBuffer::parallelFill(
+    size_t ChunkSize,
+    function_ref<void(size_t Offset, MutableArrayRef<uint8_t> Region)> Fill) {
+  static size_t PageSize = Process::getPageSize();
+  size_t Size = getBufferSize();
+  if (Size == 0)
+    return;
+  ChunkSize = alignTo(std::max<size_t>(ChunkSize, 1), PageSize);
+  size_t NumChunks = (Size + ChunkSize - 1) / ChunkSize;
+  uint8_t *Start = getBufferStart();
+  parallel::for_each_n(parallel::par, size_t(0), NumChunks, [&](size_t I) {
+    size_t Offset = I * ChunkSize;
+    size_t Len = std::min(ChunkSize, Size - Offset);
+    Fill(Offset, MutableArrayRef<uint8_t>(Start + Offset, Len));
+  });
+}
+
 // Create an instance of FileOutputBuffer.
 Expected<std::unique_ptr<FileOutputBuffer>>
 FileOutputBuffer::create(StringRef Path, size_t Size, unsigned Flags) {
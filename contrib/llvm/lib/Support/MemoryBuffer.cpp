@@ -28,6 +28,8 @@
 #include <sys/types.h>
 #include <system_error>
 #if !defined(_MSC_VER) && !defined(__MINGW32__)
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <unistd.h>
 #else
 #include <io.h>
@@ -106,7 +108,8 @@ class MemoryBufferMem : public MB {
 template <typename MB>
 static ErrorOr<std::unique_ptr<MB>>
 getFileAux(const Twine &Filename, int64_t FileSize, uint64_t MapSize,
-           uint64_t Offset, bool RequiresNullTerminator, bool IsVolatile);
+           uint64_t Offset, bool RequiresNullTerminator, bool IsVolatile,
+           bool IsSequential = false);
 
 std::unique_ptr<MemoryBuffer>
 MemoryBuffer::getMemBuffer(StringRef InputData, StringRef BufferName,
@@ -190,9 +193,21 @@ class MemoryBufferMMapFile : public MB {
     return MFR.const_data() + (Offset - getLegalMapOffset(Offset));
   }
 
+  /// Tell the VM system the mapping will be read front to back, so that it
+  /// reads ahead aggressively and starts paging the file in right away
+  /// instead of faulting it in a page at a time.
+  void adviseSequential() {
+#if defined(POSIX_MADV_SEQUENTIAL) && defined(POSIX_MADV_WILLNEED)
+    void *Addr = const_cast<char *>(MFR.const_data());
+    ::posix_madvise(Addr, MFR.size(), POSIX_MADV_SEQUENTIAL);
+    ::posix_madvise(Addr, MFR.size(), POSIX_MADV_WILLNEED);
+#endif
+  }
+
 public:
   MemoryBufferMMapFile(bool RequiresNullTerminator, int FD, uint64_t Len,
-                       uint64_t Offset, std::error_code &EC)
+                       uint64_t Offset, std::error_code &EC,
+                       bool IsSequential = false)
       : MFR(FD,
             MB::Writable ? sys::fs::mapped_file_region::priv
                          : sys::fs::mapped_file_region::readonly,
@@ -200,6 +215,8 @@ class MemoryBufferMMapFile : public MB {
     if (!EC) {
       const char *Start = getStart(Len, Offset);
       MemoryBuffer::init(Start, Start + Len, RequiresNullTerminator);
+      if (IsSequential)
+        adviseSequential();
     }
   }
 
@@ -238,21 +255,24 @@ getMemoryBufferForStream(int FD, const Twine &BufferName) {
 
 ErrorOr<std::unique_ptr<MemoryBuffer>>
 MemoryBuffer::getFile(const Twine &Filename, int64_t FileSize,
-                      bool RequiresNullTerminator, bool IsVolatile) {
+                      bool RequiresNullTerminator, bool IsVolatile,
+                      bool IsSequential) {
   return getFileAux<MemoryBuffer>(Filename, FileSize, FileSize, 0,
-                                  RequiresNullTerminator, IsVolatile);
+                                  RequiresNullTerminator, IsVolatile,
+                                  IsSequential);
 }
 
 template <typename MB>
 static ErrorOr<std::unique_ptr<MB>>
 getOpenFileImpl(int FD, const Twine &Filename, uint64_t FileSize,
                 uint64_t MapSize, int64_t Offset, bool RequiresNullTerminator,
-                bool IsVolatile);
+                bool IsVolatile, bool IsSequential = false);
 
 template <typename MB>
 static ErrorOr<std::unique_ptr<MB>>
 getFileAux(const Twine &Filename, int64_t FileSize, uint64_t MapSize,
-           uint64_t Offset, bool RequiresNullTerminator, bool IsVolatile) {
+           uint64_t Offset, bool RequiresNullTerminator, bool IsVolatile,
+           bool IsSequential) {
   int FD;
   std::error_code EC = sys::fs::openFileForRead(Filename, FD);
 
@@ -260,7 +280,8 @@ getFileAux(const Twine &Filename, int64_t FileSize, uint64_t MapSize,
     return EC;
 
   auto Ret = getOpenFileImpl<MB>(FD, Filename, FileSize, MapSize, Offset,
-                                 RequiresNullTerminator, IsVolatile);
+                                 RequiresNullTerminator, IsVolatile,
+                                 IsSequential);
   close(FD);
   return Ret;
 }
@@ -365,7 +386,7 @@ template <typename MB>
 static ErrorOr<std::unique_ptr<MB>>
 getOpenFileImpl(int FD, const Twine &Filename, uint64_t FileSize,
                 uint64_t MapSize, int64_t Offset, bool RequiresNullTerminator,
-                bool IsVolatile) {
+                bool IsVolatile, bool IsSequential) {
   static int PageSize = sys::Process::getPageSize();
 
   // Default is to map the full file.
@@ -391,12 +412,18 @@ getOpenFileImpl(int FD, const Twine &Filename, uint64_t FileSize,
     MapSize = FileSize;
   }
 
+#if defined(POSIX_FADV_SEQUENTIAL)
+  // Let the file system read ahead of us whichever way the data is fetched.
+  if (IsSequential)
+    ::posix_fadvise(FD, Offset, MapSize, POSIX_FADV_SEQUENTIAL);
+#endif
+
   if (shouldUseMmap(FD, FileSize, MapSize, Offset, RequiresNullTerminator,
                     PageSize, IsVolatile)) {
     std::error_code EC;
     std::unique_ptr<MB> Result(
         new (NamedBufferAlloc(Filename)) MemoryBufferMMapFile<MB>(
-            RequiresNullTerminator, FD, MapSize, Offset, EC));
+            RequiresNullTerminator, FD, MapSize, Offset, EC, IsSequential));
     if (!EC)
       return std::move(Result);
   }
@@ -440,9 +467,10 @@ getOpenFileImpl(int FD, const Twine &Filename, uint64_t FileSize,
 
 ErrorOr<std::unique_ptr<MemoryBuffer>>
 MemoryBuffer::getOpenFile(int FD, const Twine &Filename, uint64_t FileSize,
-                          bool RequiresNullTerminator, bool IsVolatile) {
+                          bool RequiresNullTerminator, bool IsVolatile,
+                          bool IsSequential) {
   return getOpenFileImpl<MemoryBuffer>(FD, Filename, FileSize, FileSize, 0,
-                         RequiresNullTerminator, IsVolatile);
+                         RequiresNullTerminator, IsVolatile, IsSequential);
 }
 
 ErrorOr<std::unique_ptr<MemoryBuffer>>
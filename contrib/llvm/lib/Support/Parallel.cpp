@@ -12,10 +12,12 @@
 #include "llvm/Support/Threading.h"
 
 #include <atomic>
-#include <stack>
+#include <deque>
+#include <stdlib.h>
 #include <thread>
 
 using namespace llvm;
+using llvm::parallel::detail::SmallTask;
 
 namespace {
 
@@ -23,7 +25,7 @@ namespace {
 class Executor {
 public:
   virtual ~Executor() = default;
-  virtual void add(std::function<void()> func) = 0;
+  virtual void add(SmallTask Task) = 0;
 
   static Executor *getDefaultExecutor();
 };
@@ -31,7 +33,7 @@ class Executor {
 #if !LLVM_ENABLE_THREADS
 class SyncExecutor : public Executor {
 public:
-  virtual void add(std::function<void()> F) { F(); }
+  virtual void add(SmallTask Task) { Task(); }
 };
 
 Executor *Executor::getDefaultExecutor() {
@@ -43,9 +45,9 @@ Executor *Executor::getDefaultExecutor() {
 /// \brief An Executor that runs tasks via ConcRT.
 class ConcRTExecutor : public Executor {
   struct Taskish {
-    Taskish(std::function<void()> Task) : Task(Task) {}
+    Taskish(SmallTask Task) : Task(std::move(Task)) {}
 
-    std::function<void()> Task;
+    SmallTask Task;
 
     static void run(void *P) {
       Taskish *Self = static_cast<Taskish *>(P);
@@ -55,9 +57,10 @@ class ConcRTExecutor : public Executor {
   };
 
 public:
-  virtual void add(std::function<void()> F) {
+  virtual void add(SmallTask Task) {
     Concurrency::CurrentScheduler::ScheduleTask(
-        Taskish::run, new (concurrency::Alloc(sizeof(Taskish))) Taskish(F));
+        Taskish::run,
+        new (concurrency::Alloc(sizeof(Taskish))) Taskish(std::move(Task)));
   }
 };
 
@@ -71,8 +74,7 @@ Executor *Executor::getDefaultExecutor() {
 ///   in filo order.
 class ThreadPoolExecutor : public Executor {
 public:
-  explicit ThreadPoolExecutor(unsigned ThreadCount = hardware_concurrency())
-      : Done(ThreadCount) {
+  explicit ThreadPoolExecutor(unsigned ThreadCount) : Done(ThreadCount) {
     // Spawn all but one of the threads in another thread as spawning threads
     // can take a while.
     std::thread([&, ThreadCount] {
@@ -91,9 +93,9 @@ class ThreadPoolExecutor : public Executor {
     // Wait for ~Latch.
   }
 
-  void add(std::function<void()> F) override {
+  void add(SmallTask Task) override {
     std::unique_lock<std::mutex> Lock(Mutex);
-    WorkStack.push(F);
+    WorkStack.push_back(std::move(Task));
     Lock.unlock();
     Cond.notify_one();
   }
@@ -105,8 +107,8 @@ class ThreadPoolExecutor : public Executor {
       Cond.wait(Lock, [&] { return Stop || !WorkStack.empty(); });
       if (Stop)
         break;
-      auto Task = WorkStack.top();
-      WorkStack.pop();
+      SmallTask Task = std::move(WorkStack.back());
+      WorkStack.pop_back();
       Lock.unlock();
       Task();
     }
@@ -114,25 +116,46 @@ class ThreadPoolExecutor : public Executor {
   }
 
   std::atomic<bool> Stop{false};
-  std::stack<std::function<void()>> WorkStack;
+  std::deque<SmallTask> WorkStack;
   std::mutex Mutex;
   std::condition_variable Cond;
   parallel::detail::Latch Done;
 };
 
+/// The number of worker threads: LLVM_PARALLEL_THREADS if it is set to a
+/// positive number, otherwise one per CPU this process may run on.
+static unsigned computeThreadCount() {
+  if (const char *Env = ::getenv("LLVM_PARALLEL_THREADS")) {
+    char *End;
+    unsigned long Val = ::strtoul(Env, &End, 10);
+    if (End != Env && *End == '\0' && Val > 0 && Val <= 1024)
+      return Val;
+  }
+  return hardware_concurrency();
+}
+
+static unsigned getDefaultThreadCount() {
+  static unsigned ThreadCount = computeThreadCount();
+  return ThreadCount;
+}
+
 Executor *Executor::getDefaultExecutor() {
-  static ThreadPoolExecutor exec;
+  static ThreadPoolExecutor exec(getDefaultThreadCount());
   return &exec;
 }
 #endif
 }
 
 #if LLVM_ENABLE_THREADS
-void parallel::detail::TaskGroup::spawn(std::function<void()> F) {
-  L.inc();
-  Executor::getDefaultExecutor()->add([&, F] {
-    F();
-    L.dec();
-  });
+unsigned parallel::detail::getThreadCount() {
+#if defined(_MSC_VER)
+  return hardware_concurrency();
+#else
+  return getDefaultThreadCount();
+#endif
+}
+
+void parallel::detail::TaskGroup::spawnTask(SmallTask Task) {
+  Executor::getDefaultExecutor()->add(std::move(Task));
 }
 #endif
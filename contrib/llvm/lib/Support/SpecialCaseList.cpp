@@ -19,6 +19,8 @@
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/MemoryBuffer.h"
 #include "llvm/Support/Regex.h"
+#include <algorithm>
+#include <cctype>
 #include <string>
 #include <system_error>
 #include <utility>
@@ -26,6 +28,41 @@
 #include <stdio.h>
 namespace llvm {
 
+namespace {
+enum : int { AnyString = -1, AnyChar = -2 };
+} // end anonymous namespace
+
+// Translates an expression into a glob if it only uses literal characters,
+// '.' and '*'.  Since '*' is rewritten to ".*" below, the regex engine would
+// give such an expression exactly glob semantics.
+static bool parseGlob(StringRef Regexp, std::vector<int> &Pattern) {
+  for (size_t I = 0, E = Regexp.size(); I != E; ++I) {
+    char C = Regexp[I];
+    switch (C) {
+    case '*':
+      Pattern.push_back(AnyString);
+      break;
+    case '.':
+      Pattern.push_back(AnyChar);
+      break;
+    case '\\':
+      // An escaped punctuation character stands for itself; anything else
+      // (classes, back-references, a trailing backslash) is left to Regex.
+      if (I + 1 == E || !ispunct(static_cast<unsigned char>(Regexp[I + 1])))
+        return false;
+      Pattern.push_back(static_cast<unsigned char>(Regexp[++I]));
+      break;
+    case '^': case '$': case '|': case '(': case ')': case '[': case ']':
+    case '{': case '}': case '+': case '?':
+      return false;
+    default:
+      Pattern.push_back(static_cast<unsigned char>(C));
+      break;
+    }
+  }
+  return true;
+}
+
 bool SpecialCaseList::Matcher::insert(std::string Regexp,
                                       unsigned LineNumber,
                                       std::string &REError) {
@@ -38,6 +75,13 @@ bool SpecialCaseList::Matcher::insert(std::string Regexp,
     Strings[Regexp] = LineNumber;
     return true;
   }
+
+  std::vector<int> Pattern;
+  if (parseGlob(Regexp, Pattern)) {
+    Globs.push_back(Glob{std::move(Pattern), LineNumber, NumPatterns++});
+    Compiled = false;
+    return true;
+  }
   Trigrams.insert(Regexp);
 
   // Replace * with .*
@@ -53,21 +97,166 @@ bool SpecialCaseList::Matcher::insert(std::string Regexp,
   if (!CheckRE.isValid(REError))
     return false;
 
-  RegExes.emplace_back(
-      std::make_pair(make_unique<Regex>(std::move(CheckRE)), LineNumber));
+  RegExes.push_back(RegexEntry{make_unique<Regex>(std::move(CheckRE)),
+                               LineNumber, NumPatterns++});
   return true;
 }
 
+unsigned SpecialCaseList::Matcher::advance(unsigned State,
+                                           unsigned char C) const {
+  for (;;) {
+    for (const auto &Edge : GlobTrie[State].Next)
+      if (Edge.first == C)
+        return Edge.second;
+    if (State == 0)
+      return 0;
+    State = GlobTrie[State].Fail;
+  }
+}
+
+void SpecialCaseList::Matcher::compile() {
+  GlobTrie.assign(1, GlobNode());
+  UnfilteredGlobs.clear();
+
+  // Index every glob by its longest literal run.  Any query the glob matches
+  // contains that run, so the automaton never misses a candidate.
+  for (unsigned I = 0, E = Globs.size(); I != E; ++I) {
+    const std::vector<int> &Pattern = Globs[I].Pattern;
+    size_t RunBegin = 0, RunLength = 0;
+    for (size_t B = 0; B < Pattern.size();) {
+      if (Pattern[B] < 0) {
+        ++B;
+        continue;
+      }
+      size_t End = B;
+      while (End < Pattern.size() && Pattern[End] >= 0)
+        ++End;
+      if (End - B > RunLength) {
+        RunBegin = B;
+        RunLength = End - B;
+      }
+      B = End;
+    }
+    if (RunLength == 0) {
+      UnfilteredGlobs.push_back(I);
+      continue;
+    }
+
+    unsigned State = 0;
+    for (size_t K = RunBegin; K != RunBegin + RunLength; ++K) {
+      unsigned char C = Pattern[K];
+      auto &Next = GlobTrie[State].Next;
+      auto It = std::find_if(
+          Next.begin(), Next.end(),
+          [C](const std::pair<unsigned char, unsigned> &Edge) {
+            return Edge.first == C;
+          });
+      if (It != Next.end()) {
+        State = It->second;
+        continue;
+      }
+      unsigned Child = GlobTrie.size();
+      Next.emplace_back(C, Child);
+      GlobTrie.emplace_back();
+      State = Child;
+    }
+    GlobTrie[State].Out.push_back(I);
+  }
+
+  // Breadth-first pass to fill in the failure and output links.
+  std::vector<unsigned> Queue;
+  for (const auto &Edge : GlobTrie[0].Next)
+    Queue.push_back(Edge.second);
+  for (size_t Head = 0; Head != Queue.size(); ++Head) {
+    unsigned Node = Queue[Head];
+    for (const auto &Edge : GlobTrie[Node].Next) {
+      unsigned Fail = advance(GlobTrie[Node].Fail, Edge.first);
+      GlobNode &Child = GlobTrie[Edge.second];
+      Child.Fail = Fail;
+      Child.OutLink =
+          GlobTrie[Fail].Out.empty() ? GlobTrie[Fail].OutLink : Fail;
+      Queue.push_back(Edge.second);
+    }
+  }
+  Compiled = true;
+}
+
+bool SpecialCaseList::Matcher::matchGlob(const std::vector<int> &Pattern,
+                                         StringRef Query) {
+  // Greedy match; on a mismatch, let the most recent '*' swallow one more
+  // character.
+  size_t P = 0, Q = 0, StarP = std::string::npos, StarQ = 0;
+  while (Q < Query.size()) {
+    if (P < Pattern.size() &&
+        (Pattern[P] == AnyChar ||
+         Pattern[P] == static_cast<unsigned char>(Query[Q]))) {
+      ++P;
+      ++Q;
+    } else if (P < Pattern.size() && Pattern[P] == AnyString) {
+      StarP = P++;
+      StarQ = Q;
+    } else if (StarP != std::string::npos) {
+      P = StarP + 1;
+      Q = ++StarQ;
+    } else {
+      return false;
+    }
+  }
+  while (P < Pattern.size() && Pattern[P] == AnyString)
+    ++P;
+  return P == Pattern.size();
+}
+
 unsigned SpecialCaseList::Matcher::match(StringRef Query) const {
   auto It = Strings.find(Query);
   if (It != Strings.end())
     return It->second;
-  if (Trigrams.isDefinitelyOut(Query))
-    return false;
-  for (auto& RegExKV : RegExes)
-    if (RegExKV.first->match(Query))
-      return RegExKV.second;
-  return 0;
+
+  unsigned BestOrder = ~0U, BestLine = 0;
+  auto TryGlob = [&](unsigned I) {
+    const Glob &G = Globs[I];
+    if (G.Order < BestOrder && matchGlob(G.Pattern, Query)) {
+      BestOrder = G.Order;
+      BestLine = G.LineNumber;
+    }
+  };
+
+  if (!Compiled) {
+    for (unsigned I = 0, E = Globs.size(); I != E; ++I)
+      TryGlob(I);
+  } else if (!Globs.empty()) {
+    SmallVector<unsigned, 8> Candidates(UnfilteredGlobs.begin(),
+                                        UnfilteredGlobs.end());
+    unsigned State = 0;
+    for (unsigned char C : Query) {
+      State = advance(State, C);
+      unsigned Node =
+          GlobTrie[State].Out.empty() ? GlobTrie[State].OutLink : State;
+      for (; Node; Node = GlobTrie[Node].OutLink)
+        Candidates.append(GlobTrie[Node].Out.begin(),
+                          GlobTrie[Node].Out.end());
+    }
+    // Globs are numbered in insertion order, so checking them in ascending
+    // order lets the first hit end the search.
+    std::sort(Candidates.begin(), Candidates.end());
+    Candidates.erase(std::unique(Candidates.begin(), Candidates.end()),
+                     Candidates.end());
+    for (unsigned I : Candidates) {
+      TryGlob(I);
+      if (BestLine)
+        break;
+    }
+  }
+
+  if (RegExes.empty() || Trigrams.isDefinitelyOut(Query))
+    return BestLine;
+  for (auto &Entry : RegExes) {
+    if (Entry.Order > BestOrder)
+      break;
+    if (Entry.RE->match(Query))
+      return Entry.LineNumber;
+  }
+  return BestLine;
 }
 
 std::unique_ptr<SpecialCaseList>
@@ -111,6 +300,7 @@ bool SpecialCaseList::createInternal(const std::vector<std::string> &Paths,
       return false;
     }
   }
+  compile();
   return true;
 }
 
@@ -119,9 +309,19 @@ bool SpecialCaseList::createInternal(const MemoryBuffer *MB,
   StringMap<size_t> Sections;
   if (!parse(MB, Sections, Error))
     return false;
+  compile();
   return true;
 }
 
+void SpecialCaseList::compile() {
+  for (auto &S : Sections) {
+    S.SectionMatcher->compile();
+    for (auto &PrefixEntries : S.Entries)
+      for (auto &CategoryEntry : PrefixEntries.getValue())
+        CategoryEntry.getValue().compile();
+  }
+}
+
 bool SpecialCaseList::parse(const MemoryBuffer *MB,
                             StringMap<size_t> &SectionsMap,
                             std::string &Error) {
@@ -15,10 +15,56 @@
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/MathExtras.h"
+#include "llvm/Support/xxhash.h"
 #include <cassert>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
 using namespace llvm;
 
+// The table is probed a group of GroupSize adjacent buckets at a time: the
+// full hash values of a group are compared against the key's hash in one
+// go, and only the buckets that match are looked at.  Groups are visited
+// in triangular order, which reaches every group because the number of
+// groups is a power of two.  Within a group buckets are used in order, so
+// a key is never stored past an empty bucket of any group on its path.
+static const unsigned GroupSize = 4;
+
+/// Hash a key. The values are only ever seen by this file (and copied
+/// verbatim by StringMap's copy constructor), so any good hash will do.
+static unsigned hashKey(StringRef Key) { return (unsigned)xxHash64(Key); }
+
+/// Return a mask with bit I set if Hashes[I] equals Hash, for each of the
+/// GroupSize hashes starting at Hashes.
+static unsigned matchHashes(const unsigned *Hashes, unsigned Hash) {
+#if defined(__SSE2__)
+  __m128i Group = _mm_loadu_si128(reinterpret_cast<const __m128i *>(Hashes));
+  __m128i Eq = _mm_cmpeq_epi32(Group, _mm_set1_epi32((int)Hash));
+  return (unsigned)_mm_movemask_ps(_mm_castsi128_ps(Eq));
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  uint32x4_t Eq = vceqq_u32(vld1q_u32(Hashes), vdupq_n_u32(Hash));
+  static const uint32_t Bits[4] = {1, 2, 4, 8};
+  return vaddvq_u32(vandq_u32(Eq, vld1q_u32(Bits)));
+#else
+  unsigned Mask = 0;
+  for (unsigned I = 0; I != GroupSize; ++I)
+    Mask |= unsigned(Hashes[I] == Hash) << I;
+  return Mask;
+#endif
+}
+
+/// Return a mask with bit I set if Buckets[I] is empty.
+static unsigned matchEmpty(StringMapEntryBase *const *Buckets) {
+  unsigned Mask = 0;
+  for (unsigned I = 0; I != GroupSize; ++I)
+    Mask |= unsigned(Buckets[I] == nullptr) << I;
+  return Mask;
+}
+
 /// Returns the number of buckets to allocate to ensure that the DenseMap can
 /// accommodate \p NumEntries without need to grow().
 static unsigned getMinBucketToReserveForEntries(unsigned NumEntries) {
@@ -54,6 +100,9 @@ void StringMapImpl::init(unsigned InitSize) {
          "Init Size must be a power of 2 or zero!");
 
   unsigned NewNumBuckets = InitSize ? InitSize : 16;
+  // A table must hold at least one whole probe group.
+  if (NewNumBuckets < GroupSize)
+    NewNumBuckets = GroupSize;
   NumItems = 0;
   NumTombstones = 0;
   
@@ -83,36 +132,29 @@ unsigned StringMapImpl::LookupBucketFor(StringRef Name) {
     init(16);
     HTSize = NumBuckets;
   }
-  unsigned FullHashValue = HashString(Name);
-  unsigned BucketNo = FullHashValue & (HTSize-1);
+  unsigned FullHashValue = hashKey(Name);
   unsigned *HashTable = (unsigned *)(TheTable + NumBuckets + 1);
+  unsigned GroupMask = HTSize / GroupSize - 1;
+  unsigned Group = (FullHashValue / GroupSize) & GroupMask;
 
   unsigned ProbeAmt = 1;
   int FirstTombstone = -1;
   while (true) {
-    StringMapEntryBase *BucketItem = TheTable[BucketNo];
-    // If we found an empty bucket, this key isn't in the table yet, return it.
-    if (LLVM_LIKELY(!BucketItem)) {
-      // If we found a tombstone, we want to reuse the tombstone instead of an
-      // empty bucket.  This reduces probing.
-      if (FirstTombstone != -1) {
-        HashTable[FirstTombstone] = FullHashValue;
-        return FirstTombstone;
-      }
-      
-      HashTable[BucketNo] = FullHashValue;
-      return BucketNo;
-    }
-    
-    if (BucketItem == getTombstoneVal()) {
-      // Skip over tombstones.  However, remember the first one we see.
-      if (FirstTombstone == -1) FirstTombstone = BucketNo;
-    } else if (LLVM_LIKELY(HashTable[BucketNo] == FullHashValue)) {
-      // If the full hash value matches, check deeply for a match.  The common
-      // case here is that we are only looking at the buckets (for item info
-      // being non-null and for the full hash value) not at the items.  This
-      // is important for cache locality.
-      
+    unsigned Base = Group * GroupSize;
+    unsigned Empty = matchEmpty(TheTable + Base);
+    // Only buckets before the group's first empty one can hold the key.
+    unsigned Live =
+        Empty ? (1u << countTrailingZeros(Empty)) - 1 : (1u << GroupSize) - 1;
+
+    // The common case here is that we are only looking at the buckets (for
+    // item info being non-null and for the full hash value) not at the
+    // items.  This is important for cache locality.
+    for (unsigned Match = matchHashes(HashTable + Base, FullHashValue) & Live;
+         Match; Match &= Match - 1) {
+      unsigned BucketNo = Base + countTrailingZeros(Match);
+      StringMapEntryBase *BucketItem = TheTable[BucketNo];
+      if (BucketItem == getTombstoneVal())
+        continue;
       // Do the comparison like this because Name isn't necessarily
       // null-terminated!
       char *ItemStr = (char*)BucketItem+ItemSize;
@@ -121,13 +163,28 @@ unsigned StringMapImpl::LookupBucketFor(StringRef Name) {
         return BucketNo;
       }
     }
-    
-    // Okay, we didn't find the item.  Probe to the next bucket.
-    BucketNo = (BucketNo+ProbeAmt) & (HTSize-1);
-    
-    // Use quadratic probing, it has fewer clumping artifacts than linear
-    // probing and has good cache behavior in the common case.
-    ++ProbeAmt;
+
+    // Remember the first tombstone we see; reusing it instead of an empty
+    // bucket reduces probing.
+    if (FirstTombstone == -1) {
+      for (unsigned I = 0; I != GroupSize && (Live >> I & 1); ++I)
+        if (TheTable[Base + I] == getTombstoneVal()) {
+          FirstTombstone = Base + I;
+          break;
+        }
+    }
+
+    // If we found an empty bucket, this key isn't in the table yet, return it.
+    if (Empty) {
+      unsigned BucketNo = FirstTombstone != -1
+                              ? (unsigned)FirstTombstone
+                              : Base + countTrailingZeros(Empty);
+      HashTable[BucketNo] = FullHashValue;
+      return BucketNo;
+    }
+
+    // Okay, we didn't find the item.  Probe to the next group.
+    Group = (Group + ProbeAmt++) & GroupMask;
   }
 }
 
@@ -137,25 +194,24 @@ unsigned StringMapImpl::LookupBucketFor(StringRef Name) {
 int StringMapImpl::FindKey(StringRef Key) const {
   unsigned HTSize = NumBuckets;
   if (HTSize == 0) return -1;  // Really empty table?
-  unsigned FullHashValue = HashString(Key);
-  unsigned BucketNo = FullHashValue & (HTSize-1);
+  unsigned FullHashValue = hashKey(Key);
   unsigned *HashTable = (unsigned *)(TheTable + NumBuckets + 1);
+  unsigned GroupMask = HTSize / GroupSize - 1;
+  unsigned Group = (FullHashValue / GroupSize) & GroupMask;
 
   unsigned ProbeAmt = 1;
   while (true) {
-    StringMapEntryBase *BucketItem = TheTable[BucketNo];
-    // If we found an empty bucket, this key isn't in the table yet, return.
-    if (LLVM_LIKELY(!BucketItem))
-      return -1;
-    
-    if (BucketItem == getTombstoneVal()) {
-      // Ignore tombstones.
-    } else if (LLVM_LIKELY(HashTable[BucketNo] == FullHashValue)) {
-      // If the full hash value matches, check deeply for a match.  The common
-      // case here is that we are only looking at the buckets (for item info
-      // being non-null and for the full hash value) not at the items.  This
-      // is important for cache locality.
-      
+    unsigned Base = Group * GroupSize;
+    unsigned Empty = matchEmpty(TheTable + Base);
+    unsigned Live =
+        Empty ? (1u << countTrailingZeros(Empty)) - 1 : (1u << GroupSize) - 1;
+
+    for (unsigned Match = matchHashes(HashTable + Base, FullHashValue) & Live;
+         Match; Match &= Match - 1) {
+      unsigned BucketNo = Base + countTrailingZeros(Match);
+      StringMapEntryBase *BucketItem = TheTable[BucketNo];
+      if (BucketItem == getTombstoneVal())
+        continue;
       // Do the comparison like this because NameStart isn't necessarily
       // null-terminated!
       char *ItemStr = (char*)BucketItem+ItemSize;
@@ -164,13 +220,13 @@ int StringMapImpl::FindKey(StringRef Key) const {
         return BucketNo;
       }
     }
-    
-    // Okay, we didn't find the item.  Probe to the next bucket.
-    BucketNo = (BucketNo+ProbeAmt) & (HTSize-1);
-    
-    // Use quadratic probing, it has fewer clumping artifacts than linear
-    // probing and has good cache behavior in the common case.
-    ++ProbeAmt;
+
+    // If we found an empty bucket, this key isn't in the table.
+    if (Empty)
+      return -1;
+
+    // Okay, we didn't find the item.  Probe to the next group.
+    Group = (Group + ProbeAmt++) & GroupMask;
   }
 }
 
@@ -231,27 +287,19 @@ unsigned StringMapImpl::RehashTable(unsigned BucketNo) {
 
   // Rehash all the items into their new buckets.  Luckily :) we already have
   // the hash values available, so we don't have to rehash any strings.
+  unsigned GroupMask = NewSize / GroupSize - 1;
   for (unsigned I = 0, E = NumBuckets; I != E; ++I) {
     StringMapEntryBase *Bucket = TheTable[I];
     if (Bucket && Bucket != getTombstoneVal()) {
-      // Fast case, bucket available.
       unsigned FullHash = HashTable[I];
-      unsigned NewBucket = FullHash & (NewSize-1);
-      if (!NewTableArray[NewBucket]) {
-        NewTableArray[FullHash & (NewSize-1)] = Bucket;
-        NewHashArray[FullHash & (NewSize-1)] = FullHash;
-        if (I == BucketNo)
-          NewBucketNo = NewBucket;
-        continue;
-      }
-      
-      // Otherwise probe for a spot.
-      unsigned ProbeSize = 1;
-      do {
-        NewBucket = (NewBucket + ProbeSize++) & (NewSize-1);
-      } while (NewTableArray[NewBucket]);
-      
-      // Finally found a slot.  Fill it in.
+      unsigned Group = (FullHash / GroupSize) & GroupMask;
+      unsigned ProbeAmt = 1;
+      unsigned Empty;
+      while (!(Empty = matchEmpty(NewTableArray + Group * GroupSize)))
+        Group = (Group + ProbeAmt++) & GroupMask;
+
+      // Found a slot.  Fill it in.
+      unsigned NewBucket = Group * GroupSize + countTrailingZeros(Empty);
       NewTableArray[NewBucket] = Bucket;
       NewHashArray[NewBucket] = FullHash;
       if (I == BucketNo)
@@ -7,92 +7,172 @@
 //
 //===----------------------------------------------------------------------===//
 //
-// This file implements a crude C++11 based thread pool.
+// This file implements a work-stealing C++11 based thread pool.
 //
 //===----------------------------------------------------------------------===//
 
 #include "llvm/Support/ThreadPool.h"
 
 #include "llvm/Config/llvm-config.h"
+#include "llvm/Support/Compiler.h"
 #include "llvm/Support/Threading.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include <thread>
+
 using namespace llvm;
 
 #if LLVM_ENABLE_THREADS
 
+namespace {
+/// The pool and deque index of the current thread when it is a worker, so
+/// that tasks submitted from inside a task go to the worker's own deque.
+struct WorkerIdentity {
+  const ThreadPool *Pool;
+  unsigned Index;
+};
+}
+
+static LLVM_THREAD_LOCAL WorkerIdentity CurrentWorker = {nullptr, 0};
+
+/// How many times an idle worker looks for work before parking.
+static const unsigned MaxSpinCount = 64;
+
 // Default to hardware_concurrency
 ThreadPool::ThreadPool() : ThreadPool(hardware_concurrency()) {}
 
 ThreadPool::ThreadPool(unsigned ThreadCount)
-    : ActiveThreads(0), EnableFlag(true) {
-  // Create ThreadCount threads that will loop forever, wait on QueueCondition
-  // for tasks to be queued or the Pool to be destroyed.
+    : NextQueue(0), QueuedTasks(0), PendingTasks(0), IdleThreads(0),
+      EnableFlag(true) {
+  // Always have at least one deque so async() has somewhere to put tasks.
+  unsigned QueueCount = ThreadCount ? ThreadCount : 1;
+  Queues.reserve(QueueCount);
+  for (unsigned Index = 0; Index < QueueCount; ++Index)
+    Queues.emplace_back(new WorkerQueue);
+
+  // Create ThreadCount threads that will loop until the Pool is destroyed,
+  // running tasks from their own deque or stolen from the others.
   Threads.reserve(ThreadCount);
-  for (unsigned ThreadID = 0; ThreadID < ThreadCount; ++ThreadID) {
-    Threads.emplace_back([&] {
-      while (true) {
-        PackagedTaskTy Task;
-        {
-          std::unique_lock<std::mutex> LockGuard(QueueLock);
-          // Wait for tasks to be pushed in the queue
-          QueueCondition.wait(LockGuard,
-                              [&] { return !EnableFlag || !Tasks.empty(); });
-          // Exit condition
-          if (!EnableFlag && Tasks.empty())
-            return;
-          // Yeah, we have a task, grab it and release the lock on the queue
-
-          // We first need to signal that we are active before popping the queue
-          // in order for wait() to properly detect that even if the queue is
-          // empty, there is still a task in flight.
-          {
-            std::unique_lock<std::mutex> LockGuard(CompletionLock);
-            ++ActiveThreads;
-          }
-          Task = std::move(Tasks.front());
-          Tasks.pop();
-        }
-        // Run the task we just grabbed
-        Task();
-
-        {
-          // Adjust `ActiveThreads`, in case someone waits on ThreadPool::wait()
-          std::unique_lock<std::mutex> LockGuard(CompletionLock);
-          --ActiveThreads;
-        }
-
-        // Notify task completion, in case someone waits on ThreadPool::wait()
-        CompletionCondition.notify_all();
-      }
-    });
+  for (unsigned ThreadID = 0; ThreadID < ThreadCount; ++ThreadID)
+    Threads.emplace_back([this, ThreadID] { work(ThreadID); });
+}
+
+bool ThreadPool::popTask(unsigned Index, unsigned &Seed,
+                         PackagedTaskTy &Task) {
+  {
+    WorkerQueue &Own = *Queues[Index];
+    std::unique_lock<std::mutex> LockGuard(Own.Lock);
+    if (!Own.Tasks.empty()) {
+      Task = std::move(Own.Tasks.back());
+      Own.Tasks.pop_back();
+      --QueuedTasks;
+      return true;
+    }
+  }
+
+  unsigned Count = Queues.size();
+  if (Count == 1)
+    return false;
+  // xorshift, good enough to spread thieves over their victims.
+  Seed ^= Seed << 13;
+  Seed ^= Seed >> 17;
+  Seed ^= Seed << 5;
+  unsigned Start = Seed % Count;
+  for (unsigned I = 0; I < Count; ++I) {
+    unsigned Victim = (Start + I) % Count;
+    if (Victim == Index)
+      continue;
+    WorkerQueue &Other = *Queues[Victim];
+    std::unique_lock<std::mutex> LockGuard(Other.Lock, std::try_to_lock);
+    if (!LockGuard.owns_lock() || Other.Tasks.empty())
+      continue;
+    Task = std::move(Other.Tasks.front());
+    Other.Tasks.pop_front();
+    --QueuedTasks;
+    return true;
+  }
+  return false;
+}
+
+void ThreadPool::work(unsigned Index) {
+  CurrentWorker.Pool = this;
+  CurrentWorker.Index = Index;
+  unsigned Seed = Index * 2654435761u + 1;
+
+  while (true) {
+    PackagedTaskTy Task;
+    bool Found = false;
+    for (unsigned Spin = 0; !Found && Spin < MaxSpinCount; ++Spin) {
+      if (QueuedTasks)
+        Found = popTask(Index, Seed, Task);
+      if (!Found)
+        std::this_thread::yield();
+    }
+
+    if (!Found) {
+      // Nothing to do, park until a task is queued or the pool goes away.
+      // IdleThreads is raised before QueuedTasks is checked, and asyncImpl()
+      // bumps QueuedTasks before reading IdleThreads, so either we see the
+      // new task or the submitter sees us and takes QueueLock to notify.
+      std::unique_lock<std::mutex> LockGuard(QueueLock);
+      ++IdleThreads;
+      QueueCondition.wait(LockGuard,
+                          [&] { return !EnableFlag || QueuedTasks != 0; });
+      --IdleThreads;
+      // Exit condition
+      if (!EnableFlag && QueuedTasks == 0)
+        return;
+      continue;
+    }
+
+    // Run the task we just grabbed
+    Task();
+
+    // Notify task completion, in case someone waits on ThreadPool::wait()
+    if (--PendingTasks == 0) {
+      std::unique_lock<std::mutex> LockGuard(CompletionLock);
+      CompletionCondition.notify_all();
+    }
   }
 }
 
 void ThreadPool::wait() {
-  // Wait for all threads to complete and the queue to be empty
+  // Wait for every submitted task to have run; PendingTasks only drops to
+  // zero once no deque holds a task and no worker is running one.
   std::unique_lock<std::mutex> LockGuard(CompletionLock);
-  // The order of the checks for ActiveThreads and Tasks.empty() matters because
-  // any active threads might be modifying the Tasks queue, and this would be a
-  // race.
-  CompletionCondition.wait(LockGuard,
-                           [&] { return !ActiveThreads && Tasks.empty(); });
+  CompletionCondition.wait(LockGuard, [&] { return PendingTasks == 0; });
 }
 
 std::shared_future<void> ThreadPool::asyncImpl(TaskTy Task) {
   /// Wrap the Task in a packaged_task to return a future object.
   PackagedTaskTy PackagedTask(std::move(Task));
   auto Future = PackagedTask.get_future();
-  {
-    // Lock the queue and push the new task
-    std::unique_lock<std::mutex> LockGuard(QueueLock);
 
-    // Don't allow enqueueing after disabling the pool
-    assert(EnableFlag && "Queuing a thread during ThreadPool destruction");
+  // Don't allow enqueueing after disabling the pool
+  assert(EnableFlag && "Queuing a thread during ThreadPool destruction");
+
+  // Tasks spawned by a task stay on that worker's deque, where they are
+  // likely to run hot in its cache; others are spread over all workers.
+  unsigned Index;
+  if (CurrentWorker.Pool == this)
+    Index = CurrentWorker.Index;
+  else
+    Index = NextQueue++ % Queues.size();
+
+  // Count the task before it becomes visible so a thief can never take
+  // QueuedTasks below zero.
+  ++PendingTasks;
+  ++QueuedTasks;
+  {
+    WorkerQueue &Queue = *Queues[Index];
+    std::unique_lock<std::mutex> LockGuard(Queue.Lock);
+    Queue.Tasks.push_back(std::move(PackagedTask));
+  }
 
-    Tasks.push(std::move(PackagedTask));
+  if (IdleThreads) {
+    { std::unique_lock<std::mutex> LockGuard(QueueLock); }
+    QueueCondition.notify_one();
   }
-  QueueCondition.notify_one();
   return Future.share();
 }
 
@@ -112,8 +192,7 @@ ThreadPool::~ThreadPool() {
 ThreadPool::ThreadPool() : ThreadPool(0) {}
 
 // No threads are launched, issue a warning if ThreadCount is not 0
-ThreadPool::ThreadPool(unsigned ThreadCount)
-    : ActiveThreads(0) {
+ThreadPool::ThreadPool(unsigned ThreadCount) {
   if (ThreadCount) {
     errs() << "Warning: request a ThreadPool with " << ThreadCount
            << " threads, but LLVM_ENABLE_THREADS has been turned off\n";
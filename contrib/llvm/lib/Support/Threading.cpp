@@ -21,6 +21,11 @@
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(__FreeBSD__)
+#include <sys/param.h>
+#include <sys/cpuset.h>
+#endif
+
 using namespace llvm;
 
 //===----------------------------------------------------------------------===//
@@ -74,10 +79,18 @@ unsigned llvm::heavyweight_hardware_concurrency() {
 }
 
 unsigned llvm::hardware_concurrency() {
+  // Honour the CPUs this process may actually run on, so that a process
+  // confined to part of the machine does not start a thread per CPU.
 #if defined(HAVE_SCHED_GETAFFINITY) && defined(HAVE_CPU_COUNT)
   cpu_set_t Set;
-  if (sched_getaffinity(0, sizeof(Set), &Set))
+  if (sched_getaffinity(0, sizeof(Set), &Set) == 0)
     return CPU_COUNT(&Set);
+#elif defined(__FreeBSD__)
+  cpuset_t Mask;
+  if (cpuset_getaffinity(CPU_LEVEL_WHICH, CPU_WHICH_PID, -1, sizeof(Mask),
+                         &Mask) == 0)
+    if (int Count = CPU_COUNT(&Mask))
+      return Count;
 #endif
   // Guard against std::thread::hardware_concurrency() returning 0.
   if (unsigned Val = std::thread::hardware_concurrency())
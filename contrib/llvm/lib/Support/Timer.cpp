@@ -15,6 +15,7 @@
 #include "llvm/ADT/Statistic.h"
 #include "llvm/ADT/StringMap.h"
 #include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Compiler.h"
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/Format.h"
 #include "llvm/Support/ManagedStatic.h"
@@ -22,6 +23,9 @@
 #include "llvm/Support/Process.h"
 #include "llvm/Support/YAMLTraits.h"
 #include "llvm/Support/raw_ostream.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
 using namespace llvm;
 
 // This ugly hack is brought to you courtesy of constructor/destructor ordering
@@ -44,6 +48,12 @@ namespace {
                                       "tracking (this may be slow)"),
              cl::Hidden);
 
+  static cl::opt<bool>
+  UseCycleCounter("timer-cycle-counter",
+                  cl::desc("Take timer wall time from the CPU cycle counter "
+                           "and do not record user and system time"),
+                  cl::Hidden);
+
   static cl::opt<std::string, true>
   InfoOutputFilename("info-output-file", cl::value_desc("filename"),
                      cl::desc("File to append -stats and -timer output to"),
@@ -109,9 +119,78 @@ static inline size_t getMemUsage() {
   return sys::Process::GetMallocUsage();
 }
 
+/// Read a free-running counter that is far cheaper than the clocks behind
+/// sys::Process::GetTimeUsage().  Returns 0 where there is none.
+static inline uint64_t readCycleCounter() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+  unsigned Lo, Hi;
+  __asm__ __volatile__("rdtsc" : "=a"(Lo), "=d"(Hi));
+  return ((uint64_t)Hi << 32) | Lo;
+#elif defined(__GNUC__) && defined(__aarch64__)
+  uint64_t Ticks;
+  __asm__ __volatile__("mrs %0, cntvct_el0" : "=r"(Ticks));
+  return Ticks;
+#elif defined(__GNUC__) && defined(__riscv) && __riscv_xlen == 64
+  uint64_t Ticks;
+  __asm__ __volatile__("rdtime %0" : "=r"(Ticks));
+  return Ticks;
+#else
+  return 0;
+#endif
+}
+
+namespace {
+/// Converts cycle counter readings to seconds.  The counter rate is measured
+/// against steady_clock over the first CalibrationTime of use; readings taken
+/// before that are served by steady_clock itself, with the same origin.
+class CycleClock {
+  static constexpr double CalibrationTime = 0.05;
+
+  std::once_flag BaseFlag;
+  uint64_t BaseTicks = 0;
+  std::chrono::steady_clock::time_point BaseTime;
+  std::atomic<double> SecondsPerTick{0};
+
+public:
+  double now() {
+    using Seconds = std::chrono::duration<double, std::ratio<1>>;
+    std::call_once(BaseFlag, [this] {
+      BaseTime = std::chrono::steady_clock::now();
+      BaseTicks = readCycleCounter();
+    });
+
+    uint64_t Ticks = readCycleCounter();
+    double Scale = SecondsPerTick.load(std::memory_order_relaxed);
+    if (Scale != 0)
+      return static_cast<int64_t>(Ticks - BaseTicks) * Scale;
+
+    double Elapsed =
+        Seconds(std::chrono::steady_clock::now() - BaseTime).count();
+    if (Elapsed >= CalibrationTime && Ticks > BaseTicks)
+      SecondsPerTick.store(Elapsed / (Ticks - BaseTicks),
+                           std::memory_order_relaxed);
+    return Elapsed;
+  }
+};
+} // end anonymous namespace
+
+static ManagedStatic<CycleClock> TimerCycleClock;
+
 TimeRecord TimeRecord::getCurrentTime(bool Start) {
   using Seconds = std::chrono::duration<double, std::ratio<1>>;
   TimeRecord Result;
+
+  if (UseCycleCounter && readCycleCounter() != 0) {
+    if (Start) {
+      Result.MemUsed = getMemUsage();
+      Result.WallTime = TimerCycleClock->now();
+    } else {
+      Result.WallTime = TimerCycleClock->now();
+      Result.MemUsed = getMemUsage();
+    }
+    return Result;
+  }
+
   sys::TimePoint<> now;
   std::chrono::nanoseconds user, sys;
 
@@ -178,6 +257,10 @@ namespace {
 
 typedef StringMap<Timer> Name2TimerMap;
 
+/// Bumped whenever the map below is destroyed, which invalidates the
+/// per-thread caches pointing into it.
+static std::atomic<unsigned> NamedTimersGeneration(1);
+
 class Name2PairMap {
   StringMap<std::pair<TimerGroup*, Name2TimerMap> > Map;
 public:
@@ -185,13 +268,19 @@ class Name2PairMap {
     for (StringMap<std::pair<TimerGroup*, Name2TimerMap> >::iterator
          I = Map.begin(), E = Map.end(); I != E; ++I)
       delete I->second.first;
+    ++NamedTimersGeneration;
   }
 
+  /// Returns the timer, and in GroupKey the map's copy of the group name,
+  /// which lives as long as the map does.
   Timer &get(StringRef Name, StringRef Description, StringRef GroupName,
-             StringRef GroupDescription) {
+             StringRef GroupDescription, StringRef &GroupKey) {
     sys::SmartScopedLock<true> L(*TimerLock);
 
-    std::pair<TimerGroup*, Name2TimerMap> &GroupEntry = Map[GroupName];
+    auto &MapEntry = *Map.insert(std::make_pair(
+        GroupName, std::pair<TimerGroup *, Name2TimerMap>())).first;
+    std::pair<TimerGroup*, Name2TimerMap> &GroupEntry = MapEntry.second;
+    GroupKey = MapEntry.getKey();
 
     if (!GroupEntry.first)
       GroupEntry.first = new TimerGroup(GroupName, GroupDescription);
@@ -203,16 +292,49 @@ class Name2PairMap {
   }
 };
 
+/// A slot of the per-thread cache that lets NamedRegionTimer skip TimerLock
+/// and both map lookups for the timers a thread uses most.
+struct NamedTimerCacheEntry {
+  Timer *T;
+  const char *GroupName;
+  size_t GroupNameLength;
+  unsigned Generation;
+};
+
 }
 
 static ManagedStatic<Name2PairMap> NamedGroupedTimers;
 
+static const unsigned NamedTimerCacheSize = 8;
+static LLVM_THREAD_LOCAL NamedTimerCacheEntry
+    NamedTimerCache[NamedTimerCacheSize];
+
+static Timer *getNamedTimer(StringRef Name, StringRef Description,
+                            StringRef GroupName, StringRef GroupDescription) {
+  // Names are nearly always string literals, so their address picks the slot;
+  // a hit is still confirmed by comparing the names.
+  NamedTimerCacheEntry &Entry =
+      NamedTimerCache[(reinterpret_cast<uintptr_t>(Name.data()) >> 4) %
+                      NamedTimerCacheSize];
+  unsigned Generation = NamedTimersGeneration.load(std::memory_order_relaxed);
+  if (Entry.T && Entry.Generation == Generation &&
+      Entry.T->getName() == Name &&
+      StringRef(Entry.GroupName, Entry.GroupNameLength) == GroupName)
+    return Entry.T;
+
+  StringRef GroupKey;
+  Timer &T = NamedGroupedTimers->get(Name, Description, GroupName,
+                                     GroupDescription, GroupKey);
+  Entry = {&T, GroupKey.data(), GroupKey.size(), Generation};
+  return &T;
+}
+
 NamedRegionTimer::NamedRegionTimer(StringRef Name, StringRef Description,
                                    StringRef GroupName,
                                    StringRef GroupDescription, bool Enabled)
   : TimeRegion(!Enabled ? nullptr
-                 : &NamedGroupedTimers->get(Name, Description, GroupName,
-                                            GroupDescription)) {}
+                 : getNamedTimer(Name, Description, GroupName,
+                                 GroupDescription)) {}
 
 //===----------------------------------------------------------------------===//
 //   TimerGroup Implementation
@@ -16,6 +16,7 @@
 #include "llvm/ADT/SmallVector.h"
 #include "llvm/ADT/StringExtras.h"
 #include "llvm/Config/config.h"
+#include "llvm/Config/llvm-config.h"
 #include "llvm/Support/Compiler.h"
 #include "llvm/Support/ErrorHandling.h"
 #include "llvm/Support/FileSystem.h"
@@ -32,6 +33,13 @@
 #include <iterator>
 #include <sys/stat.h>
 #include <system_error>
+#include <vector>
+
+#if LLVM_ENABLE_THREADS
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
 
 // <fcntl.h> may provide O_BINARY.
 #if defined(HAVE_FCNTL_H)
@@ -730,6 +738,212 @@ bool raw_fd_ostream::has_colors() const {
   return sys::Process::FileDescriptorHasColors(FD);
 }
 
+//===----------------------------------------------------------------------===//
+//  raw_async_fd_ostream
+//===----------------------------------------------------------------------===//
+
+/// Write out each chunk in turn, retrying on EINTR and EAGAIN the way
+/// raw_fd_ostream::write_impl does, and using writev() to hand the kernel
+/// several chunks per call where it is available.
+static std::error_code writeChunks(int FD,
+                                   std::vector<std::vector<char>> &Chunks) {
+  size_t I = 0;   // First chunk not completely written.
+  size_t Off = 0; // Bytes of Chunks[I] already written.
+  while (true) {
+    while (I < Chunks.size() && Off == Chunks[I].size()) {
+      ++I;
+      Off = 0;
+    }
+    if (I == Chunks.size())
+      return std::error_code();
+
+#if defined(HAVE_SYS_UIO_H) && defined(HAVE_WRITEV)
+    const size_t MaxIOVs = 64;
+    struct iovec IOV[MaxIOVs];
+    int Count = 0;
+    for (size_t J = I; J < Chunks.size() && Count < (int)MaxIOVs; ++J) {
+      size_t Skip = J == I ? Off : 0;
+      IOV[Count].iov_base = Chunks[J].data() + Skip;
+      IOV[Count].iov_len = Chunks[J].size() - Skip;
+      ++Count;
+    }
+    ssize_t Ret = ::writev(FD, IOV, Count);
+#else
+    ssize_t Ret = ::write(FD, Chunks[I].data() + Off, Chunks[I].size() - Off);
+#endif
+
+    if (Ret < 0) {
+      if (errno == EINTR || errno == EAGAIN
+#ifdef EWOULDBLOCK
+          || errno == EWOULDBLOCK
+#endif
+          )
+        continue;
+      return std::error_code(errno, std::generic_category());
+    }
+
+    // Account for what was written, which may end part way into a chunk.
+    size_t Left = Ret;
+    while (Left) {
+      size_t Avail = Chunks[I].size() - Off;
+      if (Left < Avail) {
+        Off += Left;
+        break;
+      }
+      Left -= Avail;
+      ++I;
+      Off = 0;
+    }
+  }
+}
+
+struct raw_async_fd_ostream::Writer {
+  /// Chunks queued beyond this make the producer wait for the writer.
+  static const size_t MaxQueuedChunks = 4;
+
+  int FD;
+  bool ShouldClose;
+  std::error_code EC;
+  std::vector<std::vector<char>> Queue;
+#if LLVM_ENABLE_THREADS
+  /// Written chunks kept around so their storage can be reused.
+  std::vector<std::vector<char>> Spare;
+  bool Stop = false;
+  std::mutex Lock;
+  std::condition_variable Cond;
+  std::thread Thread;
+#endif
+
+  Writer(int FD, bool ShouldClose) : FD(FD), ShouldClose(ShouldClose) {
+#if LLVM_ENABLE_THREADS
+    if (FD >= 0)
+      Thread = std::thread([this] { run(); });
+#endif
+  }
+
+  void enqueue(const char *Ptr, size_t Size) {
+#if LLVM_ENABLE_THREADS
+    std::vector<char> Chunk;
+    {
+      std::unique_lock<std::mutex> Guard(Lock);
+      Cond.wait(Guard, [&] { return Queue.size() < MaxQueuedChunks; });
+      if (!Spare.empty()) {
+        Chunk = std::move(Spare.back());
+        Spare.pop_back();
+      }
+    }
+    Chunk.assign(Ptr, Ptr + Size);
+    {
+      std::unique_lock<std::mutex> Guard(Lock);
+      Queue.push_back(std::move(Chunk));
+    }
+    Cond.notify_all();
+#else
+    Queue.emplace_back(Ptr, Ptr + Size);
+    std::error_code WriteEC = writeChunks(FD, Queue);
+    if (WriteEC && !EC)
+      EC = WriteEC;
+    Queue.clear();
+#endif
+  }
+
+#if LLVM_ENABLE_THREADS
+  void run() {
+    std::unique_lock<std::mutex> Guard(Lock);
+    while (true) {
+      Cond.wait(Guard, [&] { return Stop || !Queue.empty(); });
+      if (Queue.empty())
+        return;
+      std::vector<std::vector<char>> Batch;
+      Batch.swap(Queue);
+      // Once a write has failed, drop the rest so the producer never
+      // blocks on a writer that cannot make progress.
+      bool Failed = bool(EC);
+      Guard.unlock();
+      Cond.notify_all();
+
+      std::error_code WriteEC;
+      if (!Failed)
+        WriteEC = writeChunks(FD, Batch);
+
+      Guard.lock();
+      if (WriteEC && !EC)
+        EC = WriteEC;
+      for (auto &Chunk : Batch)
+        if (Spare.size() < MaxQueuedChunks)
+          Spare.push_back(std::move(Chunk));
+    }
+  }
+#endif
+
+  /// Wait for everything queued to be written, stop the writer and close
+  /// the file descriptor if we own it.
+  void finish() {
+    if (FD < 0)
+      return;
+#if LLVM_ENABLE_THREADS
+    {
+      std::unique_lock<std::mutex> Guard(Lock);
+      Stop = true;
+    }
+    Cond.notify_all();
+    Thread.join();
+#endif
+    if (ShouldClose)
+      if (auto CloseEC = sys::Process::SafelyCloseFileDescriptor(FD))
+        if (!EC)
+          EC = CloseEC;
+    FD = -1;
+  }
+};
+
+raw_async_fd_ostream::raw_async_fd_ostream(StringRef Filename,
+                                           std::error_code &EC,
+                                           sys::fs::OpenFlags Flags,
+                                           size_t ChunkSize)
+    : ChunkSize(ChunkSize) {
+  int FD = getFD(Filename, EC, Flags);
+  // Do not attempt to close stdout; see raw_fd_ostream.
+  W.reset(new Writer(FD, FD > STDERR_FILENO));
+}
+
+raw_async_fd_ostream::~raw_async_fd_ostream() {
+  if (W->FD >= 0) {
+    flush();
+    W->finish();
+  }
+
+  // As with raw_fd_ostream, errors that were never looked at are fatal.
+  if (has_error())
+    report_fatal_error("IO failure on output stream: " + error().message(),
+                       /*GenCrashDiag=*/false);
+}
+
+void raw_async_fd_ostream::write_impl(const char *Ptr, size_t Size) {
+  assert(W->FD >= 0 && "File already closed.");
+  Pos += Size;
+  W->enqueue(Ptr, Size);
+}
+
+void raw_async_fd_ostream::close() {
+  flush();
+  W->finish();
+}
+
+std::error_code raw_async_fd_ostream::error() const {
+#if LLVM_ENABLE_THREADS
+  std::unique_lock<std::mutex> Guard(W->Lock);
+#endif
+  return W->EC;
+}
+
+void raw_async_fd_ostream::clear_error() {
+#if LLVM_ENABLE_THREADS
+  std::unique_lock<std::mutex> Guard(W->Lock);
+#endif
+  W->EC = std::error_code();
+}
+
 //===----------------------------------------------------------------------===//
 //  outs(), errs(), nulls()
 //===----------------------------------------------------------------------===//
@@ -994,35 +994,6 @@ class CommandObjectMemoryFind : public CommandObjectParsed {
   Options *GetOptions() override { return &m_option_group; }
 
 protected:
-  class ProcessMemoryIterator {
-  public:
-    ProcessMemoryIterator(ProcessSP process_sp, lldb::addr_t base)
-        : m_process_sp(process_sp), m_base_addr(base), m_is_valid(true) {
-      lldbassert(process_sp.get() != nullptr);
-    }
-
-    bool IsValid() { return m_is_valid; }
-
-    uint8_t operator[](lldb::addr_t offset) {
-      if (!IsValid())
-        return 0;
-
-      uint8_t retval = 0;
-      Status error;
-      if (0 ==
-          m_process_sp->ReadMemory(m_base_addr + offset, &retval, 1, error)) {
-        m_is_valid = false;
-        return 0;
-      }
-
-      return retval;
-    }
-
-  private:
-    ProcessSP m_process_sp;
-    lldb::addr_t m_base_addr;
-    bool m_is_valid;
-  };
   bool DoExecute(Args &command, CommandReturnObject &result) override {
     // No need to check "process" for validity as eCommandRequiresProcess
     // ensures it is valid
@@ -1148,29 +1119,91 @@ class CommandObjectMemoryFind : public CommandObjectParsed {
     return true;
   }
 
+  // Find the first occurrence of pattern in data.  memchr() on the first
+  // pattern byte is much faster than anything we could write here, so use
+  // it to find candidates and only compare the rest of the pattern there.
+  static const uint8_t *FindPattern(const uint8_t *data, size_t data_size,
+                                    const uint8_t *pattern,
+                                    size_t pattern_size) {
+    if (data_size < pattern_size)
+      return nullptr;
+    const uint8_t *p = data;
+    const uint8_t *last = data + data_size - pattern_size;
+    while (p <= last) {
+      p = (const uint8_t *)::memchr(p, pattern[0], last - p + 1);
+      if (p == nullptr)
+        return nullptr;
+      if (::memcmp(p + 1, pattern + 1, pattern_size - 1) == 0)
+        return p;
+      ++p;
+    }
+    return nullptr;
+  }
+
   lldb::addr_t FastSearch(lldb::addr_t low, lldb::addr_t high, uint8_t *buffer,
                           size_t buffer_size) {
     const size_t region_size = high - low;
 
-    if (region_size < buffer_size)
+    if (buffer_size == 0 || region_size < buffer_size)
       return LLDB_INVALID_ADDRESS;
 
-    std::vector<size_t> bad_char_heuristic(256, buffer_size);
+    // Read the range in large aligned chunks rather than a byte at a time,
+    // skipping regions the process reports as unreadable and pages that
+    // fail to read.  The last buffer_size - 1 bytes of each chunk are kept
+    // so matches that straddle a chunk boundary are still found.
+    const lldb::addr_t page_size = 4096;
+    const lldb::addr_t chunk_size = 1024 * 1024;
     ProcessSP process_sp = m_exe_ctx.GetProcessSP();
-    ProcessMemoryIterator iterator(process_sp, low);
+    std::vector<uint8_t> data;
+    lldb::addr_t data_addr = low;
+    lldb::addr_t addr = low;
+
+    while (addr < high) {
+      lldb::addr_t end = high;
+      MemoryRegionInfo region_info;
+      if (process_sp->GetMemoryRegionInfo(addr, region_info).Success()) {
+        lldb::addr_t region_end = region_info.GetRange().GetRangeEnd();
+        if (region_end > addr) {
+          if (region_info.GetReadable() == MemoryRegionInfo::eNo) {
+            data.clear();
+            addr = region_end;
+            continue;
+          }
+          end = std::min(end, region_end);
+        }
+      }
+      lldb::addr_t chunk_end = (addr & ~(chunk_size - 1)) + chunk_size;
+      if (chunk_end > addr && chunk_end < end)
+        end = chunk_end;
+
+      if (data.empty())
+        data_addr = addr;
+      const size_t offset = data.size();
+      data.resize(offset + (end - addr));
+      Status error;
+      const size_t bytes_read = process_sp->ReadMemory(
+          addr, data.data() + offset, end - addr, error);
+      data.resize(offset + bytes_read);
+      if (bytes_read == 0) {
+        data.clear();
+        lldb::addr_t next_page = (addr & ~(page_size - 1)) + page_size;
+        if (next_page <= addr)
+          break;
+        addr = next_page;
+        continue;
+      }
+      addr += bytes_read;
 
-    for (size_t idx = 0; idx < buffer_size - 1; idx++) {
-      decltype(bad_char_heuristic)::size_type bcu_idx = buffer[idx];
-      bad_char_heuristic[bcu_idx] = buffer_size - idx - 1;
-    }
-    for (size_t s = 0; s <= (region_size - buffer_size);) {
-      int64_t j = buffer_size - 1;
-      while (j >= 0 && buffer[j] == iterator[s + j])
-        j--;
-      if (j < 0)
-        return low + s;
-      else
-        s += bad_char_heuristic[iterator[s + buffer_size - 1]];
+      const uint8_t *match =
+          FindPattern(data.data(), data.size(), buffer, buffer_size);
+      if (match != nullptr)
+        return data_addr + (match - data.data());
+
+      if (data.size() >= buffer_size) {
+        const size_t drop = data.size() - (buffer_size - 1);
+        data.erase(data.begin(), data.begin() + drop);
+        data_addr += drop;
+      }
     }
 
     return LLDB_INVALID_ADDRESS;
@@ -28,6 +28,7 @@
 #include "Plugins/Process/Utility/RegisterContextFreeBSD_i386.h"
 #include "Plugins/Process/Utility/RegisterContextFreeBSD_mips64.h"
 #include "Plugins/Process/Utility/RegisterContextFreeBSD_powerpc.h"
+#include "Plugins/Process/Utility/RegisterContextFreeBSD_riscv64.h"
 #include "Plugins/Process/Utility/RegisterContextFreeBSD_x86_64.h"
 #include "Plugins/Process/Utility/RegisterInfoPOSIX_arm.h"
 #include "Plugins/Process/Utility/RegisterInfoPOSIX_arm64.h"
@@ -38,6 +39,7 @@
 #include "RegisterContextPOSIXProcessMonitor_arm64.h"
 #include "RegisterContextPOSIXProcessMonitor_mips64.h"
 #include "RegisterContextPOSIXProcessMonitor_powerpc.h"
+#include "RegisterContextPOSIXProcessMonitor_riscv64.h"
 #include "RegisterContextPOSIXProcessMonitor_x86.h"
 #include "lldb/Breakpoint/BreakpointLocation.h"
 #include "lldb/Breakpoint/Watchpoint.h"
@@ -100,10 +102,13 @@ void FreeBSDThread::RefreshStateAfterStop() {
   // which registers are valid by putting hooks in the register read and
   // register supply functions where they check the process stop ID and do
   // the right thing.
+  // A thread whose registers nobody has looked at yet has nothing to
+  // invalidate; its register context is created on first use rather than
+  // on every stop of every thread.
   // if (StateIsStoppedState(GetState())
-  {
+  if (m_reg_context_sp) {
     const bool force = false;
-    GetRegisterContext()->InvalidateIfNeeded(force);
+    m_reg_context_sp->InvalidateIfNeeded(force);
   }
 }
 
@@ -187,6 +192,9 @@ lldb::RegisterContextSP FreeBSDThread::GetRegisterContext() {
     case llvm::Triple::mips64:
       reg_interface = new RegisterContextFreeBSD_mips64(target_arch);
       break;
+    case llvm::Triple::riscv64:
+      reg_interface = new RegisterContextFreeBSD_riscv64(target_arch);
+      break;
     case llvm::Triple::x86:
       reg_interface = new RegisterContextFreeBSD_i386(target_arch);
       break;
@@ -229,6 +237,14 @@ lldb::RegisterContextSP FreeBSDThread::GetRegisterContext() {
       m_reg_context_sp.reset(reg_ctx);
       break;
     }
+    case llvm::Triple::riscv64: {
+      RegisterContextPOSIXProcessMonitor_riscv64 *reg_ctx =
+          new RegisterContextPOSIXProcessMonitor_riscv64(*this, 0,
+                                                         reg_interface);
+      m_posix_thread = reg_ctx;
+      m_reg_context_sp.reset(reg_ctx);
+      break;
+    }
     case llvm::Triple::x86:
     case llvm::Triple::x86_64: {
       RegisterContextPOSIXProcessMonitor_x86_64 *reg_ctx =
@@ -602,6 +618,7 @@ unsigned FreeBSDThread::GetRegisterIndexFromOffset(unsigned offset) {
   case llvm::Triple::mips64:
   case llvm::Triple::ppc:
   case llvm::Triple::ppc64:
+  case llvm::Triple::riscv64:
   case llvm::Triple::x86:
   case llvm::Triple::x86_64: {
     POSIXBreakpointProtocol *reg_ctx = GetPOSIXBreakpointProtocol();
@@ -629,6 +646,7 @@ const char *FreeBSDThread::GetRegisterName(unsigned reg) {
   case llvm::Triple::mips64:
   case llvm::Triple::ppc:
   case llvm::Triple::ppc64:
+  case llvm::Triple::riscv64:
   case llvm::Triple::x86:
   case llvm::Triple::x86_64:
     name = GetRegisterContext()->GetRegisterName(reg);
@@ -19,6 +19,7 @@
 #include <machine/elf.h>
 
 // C++ Includes
+#include <algorithm>
 #include <mutex>
 #include <unordered_map>
 
@@ -131,6 +132,7 @@ Status ProcessFreeBSD::DoResume() {
   Log *log(ProcessPOSIXLog::GetLogIfAllCategoriesSet(POSIX_LOG_PROCESS));
 
   SetPrivateState(eStateRunning);
+  InvalidateReadCache();
 
   std::lock_guard<std::recursive_mutex> guard(m_thread_list.GetMutex());
   bool do_step = false;
@@ -183,27 +185,54 @@ bool ProcessFreeBSD::UpdateThreadList(ThreadList &old_thread_list,
     return false;
   }
 
-  ThreadList old_thread_list_copy(old_thread_list);
+  // Most stops leave the LWP list as it was; reuse the old thread objects
+  // as they are in that case.
+  uint32_t old_count = old_thread_list.GetSize(false);
+  if (old_count == tds.size()) {
+    uint32_t i;
+    for (i = 0; i < old_count; ++i) {
+      ThreadSP thread_sp(old_thread_list.GetThreadAtIndex(i, false));
+      if (!thread_sp || thread_sp->GetID() != tds[i])
+        break;
+    }
+    if (i == old_count) {
+      for (i = 0; i < old_count; ++i)
+        new_thread_list.AddThread(old_thread_list.GetThreadAtIndex(i, false));
+      if (log)
+        log->Printf("ProcessFreeBSD::%s thread list unchanged (%u threads)",
+                    __FUNCTION__, old_count);
+      return true;
+    }
+  }
+
+  std::unordered_map<tid_t, ThreadSP> old_threads;
+  old_threads.reserve(old_count);
+  for (uint32_t i = 0; i < old_count; ++i) {
+    ThreadSP thread_sp(old_thread_list.GetThreadAtIndex(i, false));
+    if (thread_sp)
+      old_threads[thread_sp->GetID()] = thread_sp;
+  }
+
   for (size_t i = 0; i < tds.size(); ++i) {
     tid_t tid = tds[i];
-    ThreadSP thread_sp(old_thread_list_copy.RemoveThreadByID(tid, false));
-    if (!thread_sp) {
+    ThreadSP thread_sp;
+    auto pos = old_threads.find(tid);
+    if (pos == old_threads.end()) {
       thread_sp.reset(new FreeBSDThread(*this, tid));
       if (log)
         log->Printf("ProcessFreeBSD::%s new tid = %" PRIu64, __FUNCTION__, tid);
     } else {
+      thread_sp = pos->second;
+      old_threads.erase(pos);
       if (log)
         log->Printf("ProcessFreeBSD::%s existing tid = %" PRIu64, __FUNCTION__,
                     tid);
     }
     new_thread_list.AddThread(thread_sp);
   }
-  for (size_t i = 0; i < old_thread_list_copy.GetSize(false); ++i) {
-    ThreadSP old_thread_sp(old_thread_list_copy.GetThreadAtIndex(i, false));
-    if (old_thread_sp) {
-      if (log)
-        log->Printf("ProcessFreeBSD::%s remove tid", __FUNCTION__);
-    }
+  if (log) {
+    for (size_t i = 0; i < old_threads.size(); ++i)
+      log->Printf("ProcessFreeBSD::%s remove tid", __FUNCTION__);
   }
 
   return true;
@@ -503,6 +532,8 @@ Status ProcessFreeBSD::DoDestroy() {
 }
 
 void ProcessFreeBSD::DoDidExec() {
+  InvalidateReadCache();
+
   Target *target = &GetTarget();
   if (target) {
     PlatformSP platform_sp(target->GetPlatform());
@@ -590,15 +621,73 @@ bool ProcessFreeBSD::IsAlive() {
          state != eStateInvalid && state != eStateUnloaded;
 }
 
+void ProcessFreeBSD::InvalidateReadCache() {
+  std::lock_guard<std::mutex> guard(m_read_cache_mutex);
+  m_read_cache.clear();
+}
+
+size_t ProcessFreeBSD::ReadMemoryCached(addr_t vm_addr, void *buf, size_t size,
+                                        Status &error) {
+  std::lock_guard<std::mutex> guard(m_read_cache_mutex);
+  uint8_t *dst = static_cast<uint8_t *>(buf);
+  size_t done = 0;
+
+  while (done < size) {
+    addr_t addr = vm_addr + done;
+    addr_t block_addr = addr & ~(addr_t)(READ_CACHE_BLOCK_SIZE - 1);
+    size_t offset = addr - block_addr;
+
+    ReadCacheMap::iterator pos = m_read_cache.find(block_addr);
+    if (pos == m_read_cache.end()) {
+      std::vector<uint8_t> block(READ_CACHE_BLOCK_SIZE);
+      Status block_error;
+      size_t len = m_monitor->ReadMemory(block_addr, block.data(),
+                                         block.size(), block_error);
+      // The block may start in an unmapped page that precedes the range
+      // the caller asked for; let the caller fall back to a direct read.
+      if (block_error.Fail() || len <= offset)
+        break;
+      block.resize(len);
+      if (m_read_cache.size() >= READ_CACHE_MAX_BLOCKS)
+        m_read_cache.clear();
+      pos = m_read_cache.emplace(block_addr, std::move(block)).first;
+    }
+
+    const std::vector<uint8_t> &block = pos->second;
+    if (block.size() <= offset)
+      break;
+    size_t n = std::min(size - done, block.size() - offset);
+    memcpy(dst + done, block.data() + offset, n);
+    done += n;
+    // A short block marks the end of readable memory.
+    if (block.size() < READ_CACHE_BLOCK_SIZE)
+      break;
+  }
+
+  if (done == 0 && size != 0)
+    error.SetErrorStringWithFormat("unable to read memory at 0x%" PRIx64,
+                                   vm_addr);
+  return done;
+}
+
 size_t ProcessFreeBSD::DoReadMemory(addr_t vm_addr, void *buf, size_t size,
                                     Status &error) {
   assert(m_monitor);
+
+  // Large reads gain nothing from the cache and would evict it.
+  if (size < READ_CACHE_BLOCK_SIZE && IsStopped()) {
+    Status cache_error;
+    size_t len = ReadMemoryCached(vm_addr, buf, size, cache_error);
+    if (len == size)
+      return len;
+  }
   return m_monitor->ReadMemory(vm_addr, buf, size, error);
 }
 
 size_t ProcessFreeBSD::DoWriteMemory(addr_t vm_addr, const void *buf,
                                      size_t size, Status &error) {
   assert(m_monitor);
+  InvalidateReadCache();
   return m_monitor->WriteMemory(vm_addr, buf, size, error);
 }
 
@@ -682,6 +771,25 @@ ProcessFreeBSD::GetSoftwareBreakpointTrapOpcode(BreakpointSite *bp_site) {
     opcode_size = sizeof(g_aarch64_opcode);
     break;
 
+  case llvm::Triple::riscv64: {
+    static const uint8_t g_riscv_opcode[] = {0x73, 0x00, 0x10, 0x00};
+    static const uint8_t g_riscv_c_opcode[] = {0x02, 0x90};
+
+    // A 4-byte ebreak placed over a compressed instruction would clobber
+    // the instruction after it, so use c.ebreak there.
+    uint8_t insn[2];
+    Status error;
+    if (DoReadMemory(bp_site->GetLoadAddress(), insn, sizeof(insn), error) ==
+            sizeof(insn) &&
+        (insn[0] & 0x3) != 0x3) {
+      opcode = g_riscv_c_opcode;
+      opcode_size = sizeof(g_riscv_c_opcode);
+    } else {
+      opcode = g_riscv_opcode;
+      opcode_size = sizeof(g_riscv_opcode);
+    }
+  } break;
+
   case llvm::Triple::x86:
   case llvm::Triple::x86_64:
     opcode = g_i386_opcode;
@@ -1034,12 +1142,151 @@ bool ProcessFreeBSD::SupportHardwareSingleStepping() const {
       arch.GetMachine() == llvm::Triple::mips64 ||
       arch.GetMachine() == llvm::Triple::mips64el ||
       arch.GetMachine() == llvm::Triple::mips ||
-      arch.GetMachine() == llvm::Triple::mipsel)
+      arch.GetMachine() == llvm::Triple::mipsel ||
+      arch.GetMachine() == llvm::Triple::riscv64)
     return false;
   return true;
 }
 
+// Read integer register x<num> of a RISC-V thread.  The DWARF register
+// numbers of x0-x31 are the register numbers themselves.
+static uint64_t ReadRISCV64Register(RegisterContext *reg_ctx, uint32_t num) {
+  if (num == 0)
+    return 0;
+  uint32_t reg =
+      reg_ctx->ConvertRegisterKindToRegisterNumber(eRegisterKindDWARF, num);
+  return reg_ctx->ReadRegisterAsUnsigned(reg, 0);
+}
+
+static int64_t SignExtend(uint64_t value, unsigned bits) {
+  return (int64_t)(value << (64 - bits)) >> (64 - bits);
+}
+
+// Work out where a RISC-V thread goes after executing the instruction at
+// its PC.  Only jumps and branches move the PC other than by the length of
+// the instruction, and their targets depend on nothing but the instruction
+// and the registers it names, so they are decoded here directly rather
+// than through an instruction emulator plugin.
+static Status GetRISCV64NextPC(Process *process, RegisterContext *reg_ctx,
+                               lldb::addr_t &next_pc) {
+  lldb::addr_t pc = reg_ctx->GetPC();
+  uint8_t buf[4];
+  Status error;
+
+  if (pc == LLDB_INVALID_ADDRESS)
+    return Status("Unable to read the PC");
+  if (process->ReadMemory(pc, buf, 2, error) != 2)
+    return Status("Read instruction failed!");
+
+  uint32_t insn = buf[0] | (buf[1] << 8);
+  if ((insn & 0x3) != 0x3) {
+    // Compressed instruction.
+    uint32_t funct3 = insn >> 13;
+    uint64_t imm;
+
+    next_pc = pc + 2;
+    switch (insn & 0x3) {
+    case 0x1:
+      if (funct3 == 5) {
+        // c.j
+        imm = ((insn >> 1) & 0x800) | ((insn >> 7) & 0x10) |
+              ((insn >> 1) & 0x300) | ((insn << 2) & 0x400) |
+              ((insn >> 1) & 0x40) | ((insn << 1) & 0x80) |
+              ((insn >> 2) & 0xe) | ((insn << 3) & 0x20);
+        next_pc = pc + SignExtend(imm, 12);
+      } else if (funct3 == 6 || funct3 == 7) {
+        // c.beqz, c.bnez
+        uint64_t rs1 = ReadRISCV64Register(reg_ctx, 8 + ((insn >> 7) & 0x7));
+        imm = ((insn >> 4) & 0x100) | ((insn >> 7) & 0x18) |
+              ((insn << 1) & 0xc0) | ((insn >> 2) & 0x6) |
+              ((insn << 3) & 0x20);
+        if ((rs1 == 0) == (funct3 == 6))
+          next_pc = pc + SignExtend(imm, 9);
+      }
+      break;
+    case 0x2:
+      // c.jr, c.jalr
+      if (funct3 == 4 && ((insn >> 2) & 0x1f) == 0 &&
+          ((insn >> 7) & 0x1f) != 0)
+        next_pc = ReadRISCV64Register(reg_ctx, (insn >> 7) & 0x1f) & ~1ULL;
+      break;
+    }
+    return Status();
+  }
+
+  if (process->ReadMemory(pc + 2, buf + 2, 2, error) != 2)
+    return Status("Read instruction failed!");
+  insn |= (buf[2] << 16) | ((uint32_t)buf[3] << 24);
+
+  uint32_t rs1 = (insn >> 15) & 0x1f;
+  uint32_t rs2 = (insn >> 20) & 0x1f;
+  uint64_t imm, a, b;
+  bool taken;
+
+  next_pc = pc + 4;
+  switch (insn & 0x7f) {
+  case 0x6f:
+    // jal
+    imm = (insn & 0x80000000) >> 11 | (insn & 0xff000) |
+          ((insn >> 9) & 0x800) | ((insn >> 20) & 0x7fe);
+    next_pc = pc + SignExtend(imm, 21);
+    break;
+  case 0x67:
+    // jalr
+    next_pc = (ReadRISCV64Register(reg_ctx, rs1) + SignExtend(insn >> 20, 12)) &
+              ~1ULL;
+    break;
+  case 0x63:
+    // beq, bne, blt, bge, bltu, bgeu
+    a = ReadRISCV64Register(reg_ctx, rs1);
+    b = ReadRISCV64Register(reg_ctx, rs2);
+    switch ((insn >> 12) & 0x7) {
+    case 0:
+      taken = a == b;
+      break;
+    case 1:
+      taken = a != b;
+      break;
+    case 4:
+      taken = (int64_t)a < (int64_t)b;
+      break;
+    case 5:
+      taken = (int64_t)a >= (int64_t)b;
+      break;
+    case 6:
+      taken = a < b;
+      break;
+    case 7:
+      taken = a >= b;
+      break;
+    default:
+      return Status("Invalid branch instruction");
+    }
+    imm = (insn & 0x80000000) >> 19 | ((insn & 0x7e000000) >> 20) |
+          ((insn >> 7) & 0x1e) | ((insn << 4) & 0x800);
+    if (taken)
+      next_pc = pc + SignExtend(imm, 13);
+    break;
+  }
+  return Status();
+}
+
 Status ProcessFreeBSD::SetupSoftwareSingleStepping(lldb::tid_t tid) {
+  if (GetTarget().GetArchitecture().GetMachine() == llvm::Triple::riscv64) {
+    FreeBSDThread *thread = static_cast<FreeBSDThread *>(
+        m_thread_list.FindThreadByID(tid, false).get());
+    if (thread == NULL)
+      return Status("Thread not found not found!");
+
+    lldb::addr_t next_pc;
+    Status error =
+        GetRISCV64NextPC(this, thread->GetRegisterContext().get(), next_pc);
+    if (error.Fail())
+      return error;
+    SetSoftwareSingleStepBreakpoint(tid, next_pc);
+    return Status();
+  }
+
   std::unique_ptr<EmulateInstruction> emulator_ap(
       EmulateInstruction::FindPlugin(GetTarget().GetArchitecture(),
                                      eInstructionTypePCModifying, nullptr));
@@ -14,9 +14,11 @@
 #include "Plugins/Process/POSIX/ProcessMessage.h"
 #include "lldb/Target/Process.h"
 #include "lldb/Target/ThreadList.h"
+#include <map>
 #include <mutex>
 #include <queue>
 #include <set>
+#include <vector>
 
 class ProcessMonitor;
 class FreeBSDThread;
@@ -212,6 +214,21 @@ class ProcessFreeBSD : public lldb_private::Process {
   typedef std::map<lldb::addr_t, lldb::addr_t> MMapMap;
   MMapMap m_addr_to_mmap_size;
 
+  /// Inferior memory read while the process is stopped, kept in aligned
+  /// blocks so that the many small reads done while unwinding and
+  /// evaluating expressions cost one PT_IO per block.  Only valid for
+  /// the current stop; see InvalidateReadCache().
+  static const size_t READ_CACHE_BLOCK_SIZE = 4 * 4096;
+  static const size_t READ_CACHE_MAX_BLOCKS = 256;
+  typedef std::map<lldb::addr_t, std::vector<uint8_t>> ReadCacheMap;
+  std::mutex m_read_cache_mutex;
+  ReadCacheMap m_read_cache;
+
+  void InvalidateReadCache();
+
+  size_t ReadMemoryCached(lldb::addr_t vm_addr, void *buf, size_t size,
+                          lldb_private::Status &error);
+
   typedef std::set<lldb::tid_t> ThreadStopSet;
   /// Every thread begins with a stop signal. This keeps track
   /// of the threads for which we have received the stop signal.
@@ -293,9 +293,8 @@ class ReadRegOperation : public Operation {
 
 void ReadRegOperation::Execute(ProcessMonitor *monitor) {
   struct reg regs;
-  int rc;
 
-  if ((rc = PTRACE(PT_GETREGS, m_tid, (caddr_t)&regs, 0)) < 0) {
+  if (!monitor->FetchGPR(m_tid, &regs)) {
     m_result = false;
   } else {
     // 'struct reg' contains only 32- or 64-bit register values.  Punt on
@@ -332,16 +331,19 @@ class WriteRegOperation : public Operation {
 void WriteRegOperation::Execute(ProcessMonitor *monitor) {
   struct reg regs;
 
-  if (PTRACE(PT_GETREGS, m_tid, (caddr_t)&regs, 0) < 0) {
+  if (!monitor->FetchGPR(m_tid, &regs)) {
     m_result = false;
     return;
   }
   *(uintptr_t *)(((caddr_t)&regs) + m_offset) =
       (uintptr_t)m_value.GetAsUInt64();
-  if (PTRACE(PT_SETREGS, m_tid, (caddr_t)&regs, 0) < 0)
+  if (PTRACE(PT_SETREGS, m_tid, (caddr_t)&regs, 0) < 0) {
+    monitor->StoreGPR(m_tid, NULL);
     m_result = false;
-  else
+  } else {
+    monitor->StoreGPR(m_tid, &regs);
     m_result = true;
+  }
 }
 
 //------------------------------------------------------------------------------
@@ -429,14 +431,7 @@ class ReadGPROperation : public Operation {
 };
 
 void ReadGPROperation::Execute(ProcessMonitor *monitor) {
-  int rc;
-
-  errno = 0;
-  rc = PTRACE(PT_GETREGS, m_tid, (caddr_t)m_buf, 0);
-  if (errno != 0)
-    m_result = false;
-  else
-    m_result = true;
+  m_result = monitor->FetchGPR(m_tid, (struct reg *)m_buf);
 }
 
 //------------------------------------------------------------------------------
@@ -479,10 +474,13 @@ class WriteGPROperation : public Operation {
 };
 
 void WriteGPROperation::Execute(ProcessMonitor *monitor) {
-  if (PTRACE(PT_SETREGS, m_tid, (caddr_t)m_buf, 0) < 0)
+  if (PTRACE(PT_SETREGS, m_tid, (caddr_t)m_buf, 0) < 0) {
+    monitor->StoreGPR(m_tid, NULL);
     m_result = false;
-  else
+  } else {
+    monitor->StoreGPR(m_tid, (struct reg *)m_buf);
     m_result = true;
+  }
 }
 
 //------------------------------------------------------------------------------
@@ -530,6 +528,7 @@ void ResumeOperation::Execute(ProcessMonitor *monitor) {
   if (m_signo != LLDB_INVALID_SIGNAL_NUMBER)
     data = m_signo;
 
+  monitor->InvalidateGPRCache();
   if (PTRACE(PT_CONTINUE, pid, (caddr_t)1, data)) {
     Log *log(ProcessPOSIXLog::GetLogIfAllCategoriesSet(POSIX_LOG_PROCESS));
     LLDB_LOG(log, "ResumeOperation ({0}) failed: {1}", pid,
@@ -561,6 +560,7 @@ void SingleStepOperation::Execute(ProcessMonitor *monitor) {
   if (m_signo != LLDB_INVALID_SIGNAL_NUMBER)
     data = m_signo;
 
+  monitor->InvalidateGPRCache();
   if (PTRACE(PT_STEP, pid, NULL, data))
     m_result = false;
   else
@@ -662,6 +662,7 @@ class KillOperation : public Operation {
 void KillOperation::Execute(ProcessMonitor *monitor) {
   lldb::pid_t pid = monitor->GetPID();
 
+  monitor->InvalidateGPRCache();
   if (PTRACE(PT_KILL, pid, NULL, 0))
     m_result = false;
   else
@@ -684,6 +685,7 @@ class DetachOperation : public Operation {
 void DetachOperation::Execute(ProcessMonitor *monitor) {
   lldb::pid_t pid = monitor->GetPID();
 
+  monitor->InvalidateGPRCache();
   if (PTRACE(PT_DETACH, pid, NULL, 0) < 0)
     m_error.SetErrorToErrno();
 }
@@ -1234,6 +1236,28 @@ void ProcessMonitor::DoOperation(Operation *op) {
   sem_wait(&m_operation_done);
 }
 
+bool ProcessMonitor::FetchGPR(lldb::tid_t tid, struct reg *regs) {
+  auto pos = m_gpr_cache.find(tid);
+  if (pos != m_gpr_cache.end()) {
+    memcpy(regs, pos->second.data(), sizeof(*regs));
+    return true;
+  }
+
+  if (PTRACE(PT_GETREGS, tid, (caddr_t)regs, 0) < 0)
+    return false;
+  StoreGPR(tid, regs);
+  return true;
+}
+
+void ProcessMonitor::StoreGPR(lldb::tid_t tid, const struct reg *regs) {
+  if (regs == NULL) {
+    m_gpr_cache.erase(tid);
+    return;
+  }
+  const uint8_t *bytes = (const uint8_t *)regs;
+  m_gpr_cache[tid].assign(bytes, bytes + sizeof(*regs));
+}
+
 size_t ProcessMonitor::ReadMemory(lldb::addr_t vm_addr, void *buf, size_t size,
                                   Status &error) {
   size_t result;
@@ -15,7 +15,9 @@
 #include <signal.h>
 
 // C++ Includes
+#include <map>
 #include <mutex>
+#include <vector>
 
 // Other libraries and framework includes
 #include "lldb/Host/HostThread.h"
@@ -30,6 +32,7 @@ class Scalar;
 
 class ProcessFreeBSD;
 class Operation;
+struct reg;
 
 /// @class ProcessMonitor
 /// @brief Manages communication with the inferior (debugee) process.
@@ -185,6 +188,19 @@ class ProcessMonitor {
   // Waits for the initial stop message from a new thread.
   bool WaitForInitialTIDStop(lldb::tid_t tid);
 
+  /// Fetch the general purpose registers of @p tid, using the copy taken
+  /// earlier in this stop if there is one.  Every register read during a
+  /// stop is then answered from a single PT_GETREGS per thread.  These are
+  /// only called from the operation thread.
+  bool FetchGPR(lldb::tid_t tid, struct reg *regs);
+
+  /// Record @p regs as the current registers of @p tid, or forget them
+  /// if @p regs is NULL.
+  void StoreGPR(lldb::tid_t tid, const struct reg *regs);
+
+  /// Forget all register copies; the inferior is about to run.
+  void InvalidateGPRCache() { m_gpr_cache.clear(); }
+
 private:
   ProcessFreeBSD *m_process;
 
@@ -203,6 +219,9 @@ class ProcessMonitor {
   sem_t m_operation_pending;
   sem_t m_operation_done;
 
+  // struct reg copies for the current stop, owned by the operation thread.
+  std::map<lldb::tid_t, std::vector<uint8_t>> m_gpr_cache;
+
   struct OperationArgs {
     OperationArgs(ProcessMonitor *monitor);
 
@@ -0,0 +1,236 @@
+//===-- RegisterContextPOSIXProcessMonitor_riscv64.cpp ----------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "lldb/Core/RegisterValue.h"
+#include "lldb/Target/Thread.h"
+#include "lldb/Utility/DataBufferHeap.h"
+
+#include "Plugins/Process/Utility/RegisterContextPOSIX_riscv64.h"
+#include "ProcessFreeBSD.h"
+#include "ProcessMonitor.h"
+#include "RegisterContextPOSIXProcessMonitor_riscv64.h"
+
+using namespace lldb_private;
+using namespace lldb;
+
+#define REG_CONTEXT_SIZE (GetGPRSize() + sizeof(m_fpr_riscv64))
+
+RegisterContextPOSIXProcessMonitor_riscv64::
+    RegisterContextPOSIXProcessMonitor_riscv64(
+        Thread &thread, uint32_t concrete_frame_idx,
+        lldb_private::RegisterInfoInterface *register_info)
+    : RegisterContextPOSIX_riscv64(thread, concrete_frame_idx, register_info) {}
+
+ProcessMonitor &RegisterContextPOSIXProcessMonitor_riscv64::GetMonitor() {
+  ProcessSP base = CalculateProcess();
+  ProcessFreeBSD *process = static_cast<ProcessFreeBSD *>(base.get());
+  return process->GetMonitor();
+}
+
+bool RegisterContextPOSIXProcessMonitor_riscv64::ReadGPR() {
+  ProcessMonitor &monitor = GetMonitor();
+  return monitor.ReadGPR(m_thread.GetID(), &m_gpr_riscv64, GetGPRSize());
+}
+
+bool RegisterContextPOSIXProcessMonitor_riscv64::ReadFPR() {
+  ProcessMonitor &monitor = GetMonitor();
+  return monitor.ReadFPR(m_thread.GetID(), &m_fpr_riscv64,
+                         sizeof(m_fpr_riscv64));
+}
+
+bool RegisterContextPOSIXProcessMonitor_riscv64::WriteGPR() {
+  ProcessMonitor &monitor = GetMonitor();
+  return monitor.WriteGPR(m_thread.GetID(), &m_gpr_riscv64, GetGPRSize());
+}
+
+bool RegisterContextPOSIXProcessMonitor_riscv64::WriteFPR() {
+  ProcessMonitor &monitor = GetMonitor();
+  return monitor.WriteFPR(m_thread.GetID(), &m_fpr_riscv64,
+                          sizeof(m_fpr_riscv64));
+}
+
+// The FPR byte offsets count from the start of the GPRs; see
+// RegisterContextFreeBSD_riscv64.cpp.
+uint8_t *RegisterContextPOSIXProcessMonitor_riscv64::GetFPRBuffer(
+    const RegisterInfo *reg_info) {
+  assert(reg_info->byte_offset >= GetGPRSize() &&
+         reg_info->byte_offset + reg_info->byte_size <=
+             GetGPRSize() + sizeof(m_fpr_riscv64));
+  return (uint8_t *)&m_fpr_riscv64 + reg_info->byte_offset - GetGPRSize();
+}
+
+bool RegisterContextPOSIXProcessMonitor_riscv64::ReadRegister(
+    const unsigned reg, RegisterValue &value) {
+  ProcessMonitor &monitor = GetMonitor();
+  return monitor.ReadRegisterValue(m_thread.GetID(), GetRegisterOffset(reg),
+                                   GetRegisterName(reg), GetRegisterSize(reg),
+                                   value);
+}
+
+bool RegisterContextPOSIXProcessMonitor_riscv64::WriteRegister(
+    const unsigned reg, const RegisterValue &value) {
+  ProcessMonitor &monitor = GetMonitor();
+  return monitor.WriteRegisterValue(m_thread.GetID(), GetRegisterOffset(reg),
+                                    GetRegisterName(reg), value);
+}
+
+bool RegisterContextPOSIXProcessMonitor_riscv64::ReadRegister(
+    const RegisterInfo *reg_info, RegisterValue &value) {
+  if (!reg_info)
+    return false;
+
+  const uint32_t reg = reg_info->kinds[eRegisterKindLLDB];
+
+  if (IsGPR(reg))
+    return ReadRegister(reg, value);
+  if (!IsFPR(reg) || !ReadFPR())
+    return false;
+
+  uint8_t *src = GetFPRBuffer(reg_info);
+  switch (reg_info->byte_size) {
+  case 4:
+    value.SetUInt32(*(uint32_t *)src);
+    return true;
+  case 8:
+    value.SetUInt64(*(uint64_t *)src);
+    return true;
+  default:
+    assert(false && "Unhandled data size.");
+    return false;
+  }
+}
+
+bool RegisterContextPOSIXProcessMonitor_riscv64::WriteRegister(
+    const RegisterInfo *reg_info, const RegisterValue &value) {
+  const uint32_t reg = reg_info->kinds[eRegisterKindLLDB];
+
+  if (IsGPR(reg))
+    return WriteRegister(reg, value);
+  if (!IsFPR(reg) || !ReadFPR())
+    return false;
+
+  uint8_t *dst = GetFPRBuffer(reg_info);
+  switch (reg_info->byte_size) {
+  case 4:
+    *(uint32_t *)dst = value.GetAsUInt32();
+    break;
+  case 8:
+    *(uint64_t *)dst = value.GetAsUInt64();
+    break;
+  default:
+    assert(false && "Unhandled data size.");
+    return false;
+  }
+  return WriteFPR();
+}
+
+bool RegisterContextPOSIXProcessMonitor_riscv64::ReadAllRegisterValues(
+    DataBufferSP &data_sp) {
+  bool success = false;
+  data_sp.reset(new DataBufferHeap(REG_CONTEXT_SIZE, 0));
+  if (data_sp && ReadGPR() && ReadFPR()) {
+    uint8_t *dst = data_sp->GetBytes();
+    success = dst != 0;
+
+    if (success) {
+      ::memcpy(dst, &m_gpr_riscv64, GetGPRSize());
+      dst += GetGPRSize();
+      ::memcpy(dst, &m_fpr_riscv64, sizeof(m_fpr_riscv64));
+    }
+  }
+  return success;
+}
+
+bool RegisterContextPOSIXProcessMonitor_riscv64::WriteAllRegisterValues(
+    const DataBufferSP &data_sp) {
+  bool success = false;
+  if (data_sp && data_sp->GetByteSize() == REG_CONTEXT_SIZE) {
+    uint8_t *src = data_sp->GetBytes();
+    if (src) {
+      ::memcpy(&m_gpr_riscv64, src, GetGPRSize());
+      if (WriteGPR()) {
+        src += GetGPRSize();
+        ::memcpy(&m_fpr_riscv64, src, sizeof(m_fpr_riscv64));
+        success = WriteFPR();
+      }
+    }
+  }
+  return success;
+}
+
+uint32_t RegisterContextPOSIXProcessMonitor_riscv64::SetHardwareWatchpoint(
+    addr_t addr, size_t size, bool read, bool write) {
+  const uint32_t num_hw_watchpoints = NumSupportedHardwareWatchpoints();
+  uint32_t hw_index;
+
+  for (hw_index = 0; hw_index < num_hw_watchpoints; ++hw_index) {
+    if (IsWatchpointVacant(hw_index))
+      return SetHardwareWatchpointWithIndex(addr, size, read, write, hw_index);
+  }
+
+  return LLDB_INVALID_INDEX32;
+}
+
+bool RegisterContextPOSIXProcessMonitor_riscv64::ClearHardwareWatchpoint(
+    uint32_t hw_index) {
+  return false;
+}
+
+bool RegisterContextPOSIXProcessMonitor_riscv64::HardwareSingleStep(
+    bool enable) {
+  return false;
+}
+
+bool RegisterContextPOSIXProcessMonitor_riscv64::UpdateAfterBreakpoint() {
+  // sepc is left pointing at the ebreak responsible for the breakpoint.
+  if (GetPC() == LLDB_INVALID_ADDRESS)
+    return false;
+
+  return true;
+}
+
+unsigned RegisterContextPOSIXProcessMonitor_riscv64::GetRegisterIndexFromOffset(
+    unsigned offset) {
+  unsigned reg;
+  for (reg = 0; reg < k_num_registers_riscv64; reg++) {
+    if (GetRegisterInfo()[reg].byte_offset == offset)
+      break;
+  }
+  assert(reg < k_num_registers_riscv64 && "Invalid register offset.");
+  return reg;
+}
+
+bool RegisterContextPOSIXProcessMonitor_riscv64::IsWatchpointHit(
+    uint32_t hw_index) {
+  return false;
+}
+
+bool RegisterContextPOSIXProcessMonitor_riscv64::ClearWatchpointHits() {
+  return false;
+}
+
+addr_t RegisterContextPOSIXProcessMonitor_riscv64::GetWatchpointAddress(
+    uint32_t hw_index) {
+  return LLDB_INVALID_ADDRESS;
+}
+
+bool RegisterContextPOSIXProcessMonitor_riscv64::IsWatchpointVacant(
+    uint32_t hw_index) {
+  return false;
+}
+
+bool RegisterContextPOSIXProcessMonitor_riscv64::SetHardwareWatchpointWithIndex(
+    addr_t addr, size_t size, bool read, bool write, uint32_t hw_index) {
+  return false;
+}
+
+uint32_t
+RegisterContextPOSIXProcessMonitor_riscv64::NumSupportedHardwareWatchpoints() {
+  return 0;
+}
@@ -0,0 +1,180 @@
+//===-- RegisterContextFreeBSD_riscv64.cpp ---------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===---------------------------------------------------------------------===//
+
+#include "RegisterContextFreeBSD_riscv64.h"
+#include "lldb-riscv64-register-enums.h"
+#include "llvm/Support/Compiler.h"
+#include <stddef.h>
+
+using namespace lldb_private;
+using namespace lldb;
+
+static const uint32_t g_gpr_regnums[] = {
+    gpr_ra_riscv64, gpr_sp_riscv64, gpr_gp_riscv64, gpr_tp_riscv64,
+    gpr_t0_riscv64, gpr_t1_riscv64, gpr_t2_riscv64, gpr_fp_riscv64,
+    gpr_s1_riscv64, gpr_a0_riscv64, gpr_a1_riscv64, gpr_a2_riscv64,
+    gpr_a3_riscv64, gpr_a4_riscv64, gpr_a5_riscv64, gpr_a6_riscv64,
+    gpr_a7_riscv64, gpr_s2_riscv64, gpr_s3_riscv64, gpr_s4_riscv64,
+    gpr_s5_riscv64, gpr_s6_riscv64, gpr_s7_riscv64, gpr_s8_riscv64,
+    gpr_s9_riscv64, gpr_s10_riscv64, gpr_s11_riscv64, gpr_t3_riscv64,
+    gpr_t4_riscv64, gpr_t5_riscv64, gpr_t6_riscv64, gpr_pc_riscv64,
+    gpr_sstatus_riscv64};
+
+static const uint32_t g_fpr_regnums[] = {
+    fpr_f0_riscv64, fpr_f1_riscv64, fpr_f2_riscv64, fpr_f3_riscv64,
+    fpr_f4_riscv64, fpr_f5_riscv64, fpr_f6_riscv64, fpr_f7_riscv64,
+    fpr_f8_riscv64, fpr_f9_riscv64, fpr_f10_riscv64, fpr_f11_riscv64,
+    fpr_f12_riscv64, fpr_f13_riscv64, fpr_f14_riscv64, fpr_f15_riscv64,
+    fpr_f16_riscv64, fpr_f17_riscv64, fpr_f18_riscv64, fpr_f19_riscv64,
+    fpr_f20_riscv64, fpr_f21_riscv64, fpr_f22_riscv64, fpr_f23_riscv64,
+    fpr_f24_riscv64, fpr_f25_riscv64, fpr_f26_riscv64, fpr_f27_riscv64,
+    fpr_f28_riscv64, fpr_f29_riscv64, fpr_f30_riscv64, fpr_f31_riscv64,
+    fpr_fcsr_riscv64};
+
+// Number of register sets provided by this context.
+constexpr size_t k_num_register_sets = 2;
+
+static const RegisterSet g_reg_sets_riscv64[k_num_register_sets] = {
+    {"General Purpose Registers", "gpr", k_num_gpr_registers_riscv64,
+     g_gpr_regnums},
+    {"Floating Point Registers", "fpu", k_num_fpr_registers_riscv64,
+     g_fpr_regnums},
+};
+
+// The floating point registers follow the general purpose ones, as they do
+// in the buffer used by ReadAllRegisterValues().
+#define GPR_OFFSET(regname)                                                    \
+  (LLVM_EXTENSION offsetof(GPR_freebsd_riscv64, regname))
+#define FPR_OFFSET(regname)                                                    \
+  (sizeof(GPR_freebsd_riscv64) +                                               \
+   LLVM_EXTENSION offsetof(FPR_freebsd_riscv64, regname))
+
+// RegisterKind: EHFrame, DWARF, Generic, Process Plugin, LLDB
+#define DEFINE_GPR(reg, alt, field, dwarf, generic)                            \
+  {                                                                            \
+    #reg, alt, 8, GPR_OFFSET(field), eEncodingUint, eFormatHex,                \
+        {dwarf, dwarf, generic, LLDB_INVALID_REGNUM, gpr_##reg##_riscv64},     \
+        nullptr, nullptr, nullptr, 0                                           \
+  }
+
+#define DEFINE_FPR(reg, field, num)                                            \
+  {                                                                            \
+    #reg, nullptr, 8, FPR_OFFSET(field), eEncodingIEEE754, eFormatFloat,       \
+        {dwarf_f0_riscv64 + num, dwarf_f0_riscv64 + num, LLDB_INVALID_REGNUM,  \
+         LLDB_INVALID_REGNUM, fpr_##reg##_riscv64},                            \
+        nullptr, nullptr, nullptr, 0                                           \
+  }
+
+static RegisterInfo g_register_infos_riscv64[] = {
+    DEFINE_GPR(ra, "x1", ra, 1, LLDB_REGNUM_GENERIC_RA),
+    DEFINE_GPR(sp, "x2", sp, 2, LLDB_REGNUM_GENERIC_SP),
+    DEFINE_GPR(gp, "x3", gp, 3, LLDB_INVALID_REGNUM),
+    DEFINE_GPR(tp, "x4", tp, 4, LLDB_INVALID_REGNUM),
+    DEFINE_GPR(t0, nullptr, t[0], 5, LLDB_INVALID_REGNUM),
+    DEFINE_GPR(t1, nullptr, t[1], 6, LLDB_INVALID_REGNUM),
+    DEFINE_GPR(t2, nullptr, t[2], 7, LLDB_INVALID_REGNUM),
+    DEFINE_GPR(fp, "s0", s[0], 8, LLDB_REGNUM_GENERIC_FP),
+    DEFINE_GPR(s1, nullptr, s[1], 9, LLDB_INVALID_REGNUM),
+    DEFINE_GPR(a0, nullptr, a[0], 10, LLDB_REGNUM_GENERIC_ARG1),
+    DEFINE_GPR(a1, nullptr, a[1], 11, LLDB_REGNUM_GENERIC_ARG2),
+    DEFINE_GPR(a2, nullptr, a[2], 12, LLDB_REGNUM_GENERIC_ARG3),
+    DEFINE_GPR(a3, nullptr, a[3], 13, LLDB_REGNUM_GENERIC_ARG4),
+    DEFINE_GPR(a4, nullptr, a[4], 14, LLDB_REGNUM_GENERIC_ARG5),
+    DEFINE_GPR(a5, nullptr, a[5], 15, LLDB_REGNUM_GENERIC_ARG6),
+    DEFINE_GPR(a6, nullptr, a[6], 16, LLDB_REGNUM_GENERIC_ARG7),
+    DEFINE_GPR(a7, nullptr, a[7], 17, LLDB_REGNUM_GENERIC_ARG8),
+    DEFINE_GPR(s2, nullptr, s[2], 18, LLDB_INVALID_REGNUM),
+    DEFINE_GPR(s3, nullptr, s[3], 19, LLDB_INVALID_REGNUM),
+    DEFINE_GPR(s4, nullptr, s[4], 20, LLDB_INVALID_REGNUM),
+    DEFINE_GPR(s5, nullptr, s[5], 21, LLDB_INVALID_REGNUM),
+    DEFINE_GPR(s6, nullptr, s[6], 22, LLDB_INVALID_REGNUM),
+    DEFINE_GPR(s7, nullptr, s[7], 23, LLDB_INVALID_REGNUM),
+    DEFINE_GPR(s8, nullptr, s[8], 24, LLDB_INVALID_REGNUM),
+    DEFINE_GPR(s9, nullptr, s[9], 25, LLDB_INVALID_REGNUM),
+    DEFINE_GPR(s10, nullptr, s[10], 26, LLDB_INVALID_REGNUM),
+    DEFINE_GPR(s11, nullptr, s[11], 27, LLDB_INVALID_REGNUM),
+    DEFINE_GPR(t3, nullptr, t[3], 28, LLDB_INVALID_REGNUM),
+    DEFINE_GPR(t4, nullptr, t[4], 29, LLDB_INVALID_REGNUM),
+    DEFINE_GPR(t5, nullptr, t[5], 30, LLDB_INVALID_REGNUM),
+    DEFINE_GPR(t6, nullptr, t[6], 31, LLDB_INVALID_REGNUM),
+    DEFINE_GPR(pc, nullptr, sepc, LLDB_INVALID_REGNUM, LLDB_REGNUM_GENERIC_PC),
+    DEFINE_GPR(sstatus, nullptr, sstatus, LLDB_INVALID_REGNUM,
+               LLDB_INVALID_REGNUM),
+    DEFINE_FPR(f0, fp_x[0][0], 0),
+    DEFINE_FPR(f1, fp_x[1][0], 1),
+    DEFINE_FPR(f2, fp_x[2][0], 2),
+    DEFINE_FPR(f3, fp_x[3][0], 3),
+    DEFINE_FPR(f4, fp_x[4][0], 4),
+    DEFINE_FPR(f5, fp_x[5][0], 5),
+    DEFINE_FPR(f6, fp_x[6][0], 6),
+    DEFINE_FPR(f7, fp_x[7][0], 7),
+    DEFINE_FPR(f8, fp_x[8][0], 8),
+    DEFINE_FPR(f9, fp_x[9][0], 9),
+    DEFINE_FPR(f10, fp_x[10][0], 10),
+    DEFINE_FPR(f11, fp_x[11][0], 11),
+    DEFINE_FPR(f12, fp_x[12][0], 12),
+    DEFINE_FPR(f13, fp_x[13][0], 13),
+    DEFINE_FPR(f14, fp_x[14][0], 14),
+    DEFINE_FPR(f15, fp_x[15][0], 15),
+    DEFINE_FPR(f16, fp_x[16][0], 16),
+    DEFINE_FPR(f17, fp_x[17][0], 17),
+    DEFINE_FPR(f18, fp_x[18][0], 18),
+    DEFINE_FPR(f19, fp_x[19][0], 19),
+    DEFINE_FPR(f20, fp_x[20][0], 20),
+    DEFINE_FPR(f21, fp_x[21][0], 21),
+    DEFINE_FPR(f22, fp_x[22][0], 22),
+    DEFINE_FPR(f23, fp_x[23][0], 23),
+    DEFINE_FPR(f24, fp_x[24][0], 24),
+    DEFINE_FPR(f25, fp_x[25][0], 25),
+    DEFINE_FPR(f26, fp_x[26][0], 26),
+    DEFINE_FPR(f27, fp_x[27][0], 27),
+    DEFINE_FPR(f28, fp_x[28][0], 28),
+    DEFINE_FPR(f29, fp_x[29][0], 29),
+    DEFINE_FPR(f30, fp_x[30][0], 30),
+    DEFINE_FPR(f31, fp_x[31][0], 31),
+    {"fcsr", nullptr, 4, FPR_OFFSET(fp_fcsr), eEncodingUint, eFormatHex,
+     {LLDB_INVALID_REGNUM, LLDB_INVALID_REGNUM, LLDB_INVALID_REGNUM,
+      LLDB_INVALID_REGNUM, fpr_fcsr_riscv64},
+     nullptr, nullptr, nullptr, 0},
+};
+
+static_assert(sizeof(g_register_infos_riscv64) /
+                      sizeof(g_register_infos_riscv64[0]) ==
+                  k_num_registers_riscv64,
+              "g_register_infos_riscv64 does not match the register enums");
+
+RegisterContextFreeBSD_riscv64::RegisterContextFreeBSD_riscv64(
+    const ArchSpec &target_arch)
+    : RegisterInfoInterface(target_arch) {}
+
+size_t RegisterContextFreeBSD_riscv64::GetGPRSize() const {
+  return sizeof(GPR_freebsd_riscv64);
+}
+
+const RegisterSet *
+RegisterContextFreeBSD_riscv64::GetRegisterSet(size_t set) const {
+  // Check if RegisterSet is available
+  if (set < k_num_register_sets)
+    return &g_reg_sets_riscv64[set];
+  return nullptr;
+}
+
+size_t RegisterContextFreeBSD_riscv64::GetRegisterSetCount() const {
+  return k_num_register_sets;
+}
+
+const RegisterInfo *RegisterContextFreeBSD_riscv64::GetRegisterInfo() const {
+  assert(m_target_arch.GetMachine() == llvm::Triple::riscv64);
+  return g_register_infos_riscv64;
+}
+
+uint32_t RegisterContextFreeBSD_riscv64::GetRegisterCount() const {
+  return static_cast<uint32_t>(sizeof(g_register_infos_riscv64) /
+                               sizeof(g_register_infos_riscv64[0]));
+}
@@ -0,0 +1,49 @@
+//===-- RegisterContextFreeBSD_riscv64.h ------------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef liblldb_RegisterContextFreeBSD_riscv64_H_
+#define liblldb_RegisterContextFreeBSD_riscv64_H_
+
+#include "RegisterInfoInterface.h"
+
+// http://svnweb.freebsd.org/base/head/sys/riscv/include/reg.h
+struct GPR_freebsd_riscv64 {
+  uint64_t ra;
+  uint64_t sp;
+  uint64_t gp;
+  uint64_t tp;
+  uint64_t t[7];
+  uint64_t s[12];
+  uint64_t a[8];
+  uint64_t sepc;
+  uint64_t sstatus;
+};
+
+struct FPR_freebsd_riscv64 {
+  uint64_t fp_x[32][2];
+  uint64_t fp_fcsr;
+};
+
+class RegisterContextFreeBSD_riscv64
+    : public lldb_private::RegisterInfoInterface {
+public:
+  RegisterContextFreeBSD_riscv64(const lldb_private::ArchSpec &target_arch);
+
+  size_t GetGPRSize() const override;
+
+  const lldb_private::RegisterSet *GetRegisterSet(size_t set) const;
+
+  size_t GetRegisterSetCount() const;
+
+  const lldb_private::RegisterInfo *GetRegisterInfo() const override;
+
+  uint32_t GetRegisterCount() const override;
+};
+
+#endif
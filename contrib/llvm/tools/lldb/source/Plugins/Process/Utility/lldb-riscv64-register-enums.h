@@ -0,0 +1,108 @@
+//===-- lldb-riscv64-register-enums.h ---------------------------*- C++ -*-===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef lldb_riscv64_register_enums_h
+#define lldb_riscv64_register_enums_h
+
+namespace lldb_private {
+// LLDB register codes (e.g. RegisterKind == eRegisterKindLLDB)
+
+//---------------------------------------------------------------------------
+// Internal codes for all riscv64 registers.  The general purpose registers
+// are numbered x1 through x31, followed by pc (sepc) and sstatus; x0 is
+// hardwired to zero and has no slot in the FreeBSD struct reg.
+//---------------------------------------------------------------------------
+enum {
+  k_first_gpr_riscv64,
+  gpr_ra_riscv64 = k_first_gpr_riscv64,
+  gpr_sp_riscv64,
+  gpr_gp_riscv64,
+  gpr_tp_riscv64,
+  gpr_t0_riscv64,
+  gpr_t1_riscv64,
+  gpr_t2_riscv64,
+  gpr_fp_riscv64,
+  gpr_s1_riscv64,
+  gpr_a0_riscv64,
+  gpr_a1_riscv64,
+  gpr_a2_riscv64,
+  gpr_a3_riscv64,
+  gpr_a4_riscv64,
+  gpr_a5_riscv64,
+  gpr_a6_riscv64,
+  gpr_a7_riscv64,
+  gpr_s2_riscv64,
+  gpr_s3_riscv64,
+  gpr_s4_riscv64,
+  gpr_s5_riscv64,
+  gpr_s6_riscv64,
+  gpr_s7_riscv64,
+  gpr_s8_riscv64,
+  gpr_s9_riscv64,
+  gpr_s10_riscv64,
+  gpr_s11_riscv64,
+  gpr_t3_riscv64,
+  gpr_t4_riscv64,
+  gpr_t5_riscv64,
+  gpr_t6_riscv64,
+  gpr_pc_riscv64,
+  gpr_sstatus_riscv64,
+  k_last_gpr_riscv64 = gpr_sstatus_riscv64,
+
+  k_first_fpr_riscv64,
+  fpr_f0_riscv64 = k_first_fpr_riscv64,
+  fpr_f1_riscv64,
+  fpr_f2_riscv64,
+  fpr_f3_riscv64,
+  fpr_f4_riscv64,
+  fpr_f5_riscv64,
+  fpr_f6_riscv64,
+  fpr_f7_riscv64,
+  fpr_f8_riscv64,
+  fpr_f9_riscv64,
+  fpr_f10_riscv64,
+  fpr_f11_riscv64,
+  fpr_f12_riscv64,
+  fpr_f13_riscv64,
+  fpr_f14_riscv64,
+  fpr_f15_riscv64,
+  fpr_f16_riscv64,
+  fpr_f17_riscv64,
+  fpr_f18_riscv64,
+  fpr_f19_riscv64,
+  fpr_f20_riscv64,
+  fpr_f21_riscv64,
+  fpr_f22_riscv64,
+  fpr_f23_riscv64,
+  fpr_f24_riscv64,
+  fpr_f25_riscv64,
+  fpr_f26_riscv64,
+  fpr_f27_riscv64,
+  fpr_f28_riscv64,
+  fpr_f29_riscv64,
+  fpr_f30_riscv64,
+  fpr_f31_riscv64,
+  fpr_fcsr_riscv64,
+  k_last_fpr_riscv64 = fpr_fcsr_riscv64,
+
+  k_num_registers_riscv64,
+
+  k_num_gpr_registers_riscv64 = k_last_gpr_riscv64 - k_first_gpr_riscv64 + 1,
+  k_num_fpr_registers_riscv64 = k_last_fpr_riscv64 - k_first_fpr_riscv64 + 1
+};
+
+//---------------------------------------------------------------------------
+// DWARF register numbers from the RISC-V ELF psABI.
+//---------------------------------------------------------------------------
+enum {
+  dwarf_x0_riscv64 = 0,
+  dwarf_f0_riscv64 = 32
+};
+}
+#endif // #ifndef lldb_riscv64_register_enums_h
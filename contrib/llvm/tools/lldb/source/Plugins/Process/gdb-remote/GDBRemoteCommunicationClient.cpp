@@ -704,6 +704,53 @@ GDBRemoteCommunicationClient::SendPacketsAndConcatenateResponses(
   }
 }
 
+GDBRemoteCommunication::PacketResult
+GDBRemoteCommunicationClient::SendPacketsAndWaitForResponses(
+    const std::vector<std::string> &payloads,
+    std::vector<StringExtractorGDBRemote> &responses, size_t window) {
+  responses.clear();
+  Lock lock(*this, false);
+  if (!lock) {
+    Log *log(ProcessGDBRemoteLog::GetLogIfAnyCategoryIsSet(GDBR_LOG_PROCESS |
+                                                           GDBR_LOG_PACKETS));
+    if (log)
+      log->Printf("error: failed to get packet sequence mutex, not sending "
+                  "%zu pipelined packets",
+                  payloads.size());
+    return PacketResult::ErrorNoSequenceLock;
+  }
+
+  // With acks on, every packet has to be acknowledged before the next one
+  // can go out, so there is nothing to overlap.
+  if (GetSendAcks() || window == 0)
+    window = 1;
+
+  responses.reserve(payloads.size());
+  size_t sent = 0;
+  PacketResult result = PacketResult::Success;
+  while (responses.size() < payloads.size()) {
+    while (result == PacketResult::Success && sent < payloads.size() &&
+           sent - responses.size() < window) {
+      result = SendPacketNoLock(payloads[sent]);
+      if (result == PacketResult::Success)
+        ++sent;
+    }
+    // Replies to the packets already on the wire still have to be read
+    // even if a later send failed, or they would be taken as the replies
+    // to whatever is sent next.
+    if (sent == responses.size())
+      break;
+
+    StringExtractorGDBRemote response;
+    PacketResult read_result =
+        ReadPacket(response, GetPacketTimeout(), true);
+    if (read_result != PacketResult::Success)
+      return read_result;
+    responses.push_back(std::move(response));
+  }
+  return result;
+}
+
 lldb::pid_t GDBRemoteCommunicationClient::GetCurrentProcessID(bool allow_lazy) {
   if (allow_lazy && m_curr_pid_is_valid == eLazyBoolYes)
     return m_curr_pid;
@@ -63,6 +63,17 @@ class GDBRemoteCommunicationClient : public GDBRemoteClientBase {
   SendPacketsAndConcatenateResponses(const char *send_payload_prefix,
                                      std::string &response_string);
 
+  // Send every packet in "payloads" and collect the replies in order,
+  // keeping up to "window" requests outstanding at a time instead of
+  // waiting for each reply before sending the next request.  This only
+  // pays off, and is only safe, once the connection is in no-ack mode;
+  // with acks enabled the packets are sent one at a time.  On failure
+  // "responses" holds the replies received before the error.
+  PacketResult
+  SendPacketsAndWaitForResponses(const std::vector<std::string> &payloads,
+                                 std::vector<StringExtractorGDBRemote> &responses,
+                                 size_t window);
+
   bool GetThreadSuffixSupported();
 
   // This packet is usually sent first and the boolean return value
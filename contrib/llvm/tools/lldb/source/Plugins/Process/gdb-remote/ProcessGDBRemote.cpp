@@ -2759,6 +2759,9 @@ size_t ProcessGDBRemote::DoReadMemory(addr_t addr, void *buf, size_t size,
   // M and m packets take 2 bytes for 1 byte of memory
   size_t max_memory_size =
       binary_memory_read ? m_max_memory_size : m_max_memory_size / 2;
+  if (size > max_memory_size && !m_gdb_comm.GetSendAcks())
+    return DoReadMemoryPipelined(addr, buf, size, max_memory_size,
+                                 binary_memory_read, error);
   if (size > max_memory_size) {
     // Keep memory read sizes down to a sane limit. This function will be
     // called multiple times in order to complete the task by
@@ -2811,6 +2814,66 @@ size_t ProcessGDBRemote::DoReadMemory(addr_t addr, void *buf, size_t size,
   return 0;
 }
 
+size_t ProcessGDBRemote::DoReadMemoryPipelined(addr_t addr, void *buf,
+                                               size_t size, size_t chunk_size,
+                                               bool binary_memory_read,
+                                               Status &error) {
+  // Split the read into packet sized pieces and have them all in flight at
+  // once, so a large read costs one round trip per window rather than one
+  // per packet.  Like the single packet case, lldb_private::Process calls
+  // us again for whatever is left past the last chunk we issue.
+  const size_t max_chunks = 64;
+  const size_t window = 8;
+  std::vector<std::string> packets;
+  std::vector<size_t> lengths;
+  for (size_t offset = 0; offset < size && packets.size() < max_chunks;
+       offset += chunk_size) {
+    size_t len = std::min(chunk_size, size - offset);
+    StreamString packet;
+    packet.Printf("%c%" PRIx64 ",%" PRIx64, binary_memory_read ? 'x' : 'm',
+                  (uint64_t)(addr + offset), (uint64_t)len);
+    packets.push_back(packet.GetString());
+    lengths.push_back(len);
+  }
+
+  std::vector<StringExtractorGDBRemote> responses;
+  GDBRemoteCommunication::PacketResult result =
+      m_gdb_comm.SendPacketsAndWaitForResponses(packets, responses, window);
+
+  // Only the leading run of complete chunks is contiguous; stop at the
+  // first short or failed reply.
+  uint8_t *dst = (uint8_t *)buf;
+  size_t total = 0;
+  for (size_t i = 0; i < responses.size(); ++i) {
+    StringExtractorGDBRemote &response = responses[i];
+    if (!response.IsNormalResponse()) {
+      if (total == 0)
+        error.SetErrorStringWithFormat("memory read failed for 0x%" PRIx64,
+                                       addr);
+      else
+        error.Clear();
+      return total;
+    }
+    size_t received;
+    if (binary_memory_read) {
+      received = std::min(response.GetBytesLeft(), lengths[i]);
+      memcpy(dst + total, response.GetStringRef().data(), received);
+    } else {
+      received = response.GetHexBytes(
+          llvm::MutableArrayRef<uint8_t>(dst + total, lengths[i]), '\xdd');
+    }
+    total += received;
+    if (received < lengths[i])
+      break;
+  }
+  if (total == 0 && result != GDBRemoteCommunication::PacketResult::Success)
+    error.SetErrorStringWithFormat("failed to send packet: '%s'",
+                                   packets[0].c_str());
+  else
+    error.Clear();
+  return total;
+}
+
 size_t ProcessGDBRemote::DoWriteMemory(addr_t addr, const void *buf,
                                        size_t size, Status &error) {
   GetMaxMemorySize();
@@ -342,6 +342,10 @@ class ProcessGDBRemote : public Process,
 
   void GetMaxMemorySize();
 
+  size_t DoReadMemoryPipelined(lldb::addr_t addr, void *buf, size_t size,
+                               size_t chunk_size, bool binary_memory_read,
+                               Status &error);
+
   bool CalculateThreadStopInfo(ThreadGDBRemote *thread);
 
   size_t UpdateThreadPCsFromStopReplyThreadsValue(std::string &value);
@@ -93,6 +93,7 @@ typedef struct _dirdesc DIR;
 #define DTF_REWIND	0x0004	/* rewind after reading union stack */
 #define __DTF_READALL	0x0008	/* everything has been read */
 #define	__DTF_SKIPREAD	0x0010  /* assume internal buffer is populated */
+#define	__DTF_BIGBUF	0x0020	/* read with a large buffer */
 
 #else /* !__BSD_VISIBLE */
 
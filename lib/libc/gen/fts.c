@@ -641,9 +641,9 @@ fts_build(FTS *sp, int type)
 	 */
 #ifdef FTS_WHITEOUT
 	if (ISSET(FTS_WHITEOUT))
-		oflag = DTF_NODUP | DTF_REWIND;
+		oflag = DTF_NODUP | DTF_REWIND | __DTF_BIGBUF;
 	else
-		oflag = DTF_HIDEW | DTF_NODUP | DTF_REWIND;
+		oflag = DTF_HIDEW | DTF_NODUP | DTF_REWIND | __DTF_BIGBUF;
 #else
 #define __opendir2(path, flag) opendir(path)
 #endif
@@ -49,6 +49,9 @@ __FBSDID("$FreeBSD$");
 #include "gen-private.h"
 #include "telldir.h"
 
+/* Size of the read buffer for directories opened with __DTF_BIGBUF. */
+#define	DIRBUF_BIG	(64 * 1024)
+
 static DIR * __opendir_common(int, int, bool);
 
 /*
@@ -307,6 +310,14 @@ __opendir_common(int fd, int flags, bool use_current_pos)
 	if ((incr % DIRBLKSIZ) != 0) 
 		incr = DIRBLKSIZ;
 
+	/*
+	 * Callers that read the whole directory in one go, like fts(3),
+	 * ask for a bigger buffer so that each _getdirentries() call
+	 * returns many entries instead of a page worth of them.
+	 */
+	if ((flags & __DTF_BIGBUF) != 0 && incr < DIRBUF_BIG)
+		incr = DIRBUF_BIG;
+
 	/*
 	 * Determine whether this directory is the top of a union stack.
 	 */
@@ -0,0 +1,68 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause-FreeBSD
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <sys/cdefs.h>
+__FBSDID("$FreeBSD$");
+
+#include <sys/types.h>
+#include <string.h>
+
+#include "riscv_string.h"
+
+void *
+memchr(const void *s, int c, size_t n)
+{
+	const unsigned char *p;
+	const u_long *wp;
+	u_long pat, w;
+
+	p = s;
+	c = (unsigned char)c;
+	for (; n != 0 && ((uintptr_t)p & (sizeof(u_long) - 1)) != 0; n--, p++)
+		if (*p == c)
+			return ((void *)p);
+
+	/* XOR with the pattern turns matching bytes into NULs. */
+	pat = WORD_LO * c;
+	wp = (const u_long *)p;
+	if (riscv_has_zbb()) {
+		for (; n >= sizeof(u_long); n -= sizeof(u_long), wp++)
+			if (orc_b(*wp ^ pat) != ~0ul)
+				break;
+	} else {
+		for (; n >= sizeof(u_long); n -= sizeof(u_long), wp++) {
+			w = *wp ^ pat;
+			if (ZEROBYTES(w) != 0)
+				break;
+		}
+	}
+
+	for (p = (const unsigned char *)wp; n != 0; n--, p++)
+		if (*p == c)
+			return ((void *)p);
+	return (NULL);
+}
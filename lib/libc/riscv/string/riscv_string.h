@@ -0,0 +1,88 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause-FreeBSD
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $FreeBSD$
+ */
+
+#ifndef _RISCV_STRING_H_
+#define	_RISCV_STRING_H_
+
+#include <sys/types.h>
+#include <sys/auxv.h>
+
+#include <machine/riscv_isa.h>
+
+#include "libc_private.h"
+
+/*
+ * Word-at-a-time helpers for the string routines.  ZEROBYTES() is the
+ * usual ((x - 0x01..01) & ~x & 0x80..80); its lowest set bit marks the
+ * first NUL byte, higher bits may be spurious.  With Zbb, orc.b maps
+ * every nonzero byte to 0xff and every NUL byte to 0x00 in one
+ * instruction.  The assembler may predate Zbb, hence the .insn forms.
+ */
+#define	WORD_LO		0x0101010101010101ul
+#define	WORD_HI		0x8080808080808080ul
+#define	ZEROBYTES(x)	(((x) - WORD_LO) & ~(x) & WORD_HI)
+
+static __inline u_long
+orc_b(u_long x)
+{
+	u_long r;
+
+	__asm(".insn i 0x13, 0x5, %0, %1, 0x287" : "=r" (r) : "r" (x));
+	return (r);
+}
+
+static __inline u_long
+ctz(u_long x)
+{
+	u_long r;
+
+	__asm(".insn i 0x13, 0x1, %0, %1, 0x601" : "=r" (r) : "r" (x));
+	return (r);
+}
+
+/*
+ * The kernel reports Zbb in AT_HWCAP2 when every hart implements it.
+ * If the auxiliary vector cannot be read we use the base ISA.
+ */
+static __inline int
+riscv_has_zbb(void)
+{
+	static int zbb = -1;
+	u_long hwcap2;
+
+	if (__predict_false(zbb == -1)) {
+		if (_elf_aux_info(AT_HWCAP2, &hwcap2, sizeof(hwcap2)) != 0)
+			hwcap2 = 0;
+		zbb = ((hwcap2 << RISCV_ISA_HWCAP2_SHIFT) &
+		    RISCV_ISA_ZBB) != 0;
+	}
+	return (zbb);
+}
+
+#endif /* !_RISCV_STRING_H_ */
@@ -0,0 +1,75 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause-FreeBSD
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <sys/cdefs.h>
+__FBSDID("$FreeBSD$");
+
+#include <sys/types.h>
+#include <string.h>
+
+#include "riscv_string.h"
+
+/*
+ * When both strings share an alignment, compare a word at a time until
+ * the words differ or contain a NUL, then finish bytewise.
+ */
+int
+strcmp(const char *s1, const char *s2)
+{
+	const u_long *w1, *w2;
+	u_long w;
+
+	if ((((uintptr_t)s1 ^ (uintptr_t)s2) & (sizeof(u_long) - 1)) == 0) {
+		for (; ((uintptr_t)s1 & (sizeof(u_long) - 1)) != 0; s1++, s2++)
+			if (*s1 != *s2 || *s1 == '\0')
+				goto out;
+		w1 = (const u_long *)s1;
+		w2 = (const u_long *)s2;
+		if (riscv_has_zbb()) {
+			while (*w1 == *w2 && orc_b(*w1) == ~0ul) {
+				w1++;
+				w2++;
+			}
+		} else {
+			for (;;) {
+				w = *w1;
+				if (w != *w2 || ZEROBYTES(w) != 0)
+					break;
+				w1++;
+				w2++;
+			}
+		}
+		s1 = (const char *)w1;
+		s2 = (const char *)w2;
+	}
+
+	for (; *s1 == *s2; s1++, s2++)
+		if (*s1 == '\0')
+			return (0);
+out:
+	return (*(const unsigned char *)s1 - *(const unsigned char *)s2);
+}
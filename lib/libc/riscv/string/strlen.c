@@ -0,0 +1,64 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause-FreeBSD
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+#include <sys/cdefs.h>
+__FBSDID("$FreeBSD$");
+
+#include <sys/types.h>
+#include <string.h>
+
+#include "riscv_string.h"
+
+/*
+ * Scan aligned words.  The bytes of the first word that precede the
+ * string are forced nonzero; an aligned load never crosses a page.
+ */
+size_t
+strlen(const char *str)
+{
+	const u_long *p;
+	u_long mask, w;
+	u_int off;
+
+	off = (uintptr_t)str & (sizeof(u_long) - 1);
+	p = (const u_long *)(str - off);
+	mask = (1ul << (off * 8)) - 1;
+
+	if (riscv_has_zbb()) {
+		w = orc_b(*p | mask);
+		while (w == ~0ul)
+			w = orc_b(*++p);
+		return ((const char *)p - str + ctz(~w) / 8);
+	}
+
+	w = ZEROBYTES(*p | mask);
+	while (w == 0) {
+		w = *++p;
+		w = ZEROBYTES(w);
+	}
+	return ((const char *)p - str + __builtin_ctzl(w) / 8);
+}
@@ -35,7 +35,10 @@ static char sccsid[] = "@(#)qsort.c	8.1 (Berkeley) 6/4/93";
 #include <sys/cdefs.h>
 __FBSDID("$FreeBSD$");
 
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+#include <strings.h>
 
 #ifdef I_AM_QSORT_R
 typedef int		 cmp_t(void *, const void *, const void *);
@@ -47,14 +50,29 @@ static inline char	*med3(char *, char *, char *, cmp_t *, void *);
 #define	MIN(a, b)	((a) < (b) ? a : b)
 
 /*
- * Qsort routine from Bentley & McIlroy's "Engineering a Sort Function".
+ * Qsort routine from Bentley & McIlroy's "Engineering a Sort Function",
+ * with Musser's introsort depth limit: a partition that is still being
+ * split after 2 * log2(n) levels is heapsorted, so that inputs built
+ * to defeat the median-of-three pivot stay O(n log n).
  */
 
 static inline void
 swapfunc(char *a, char *b, size_t es)
 {
+	long l;
 	char t;
 
+	if ((((uintptr_t)a | (uintptr_t)b | es) & (sizeof(long) - 1)) == 0) {
+		do {
+			memcpy(&l, a, sizeof(l));
+			memcpy(a, b, sizeof(l));
+			memcpy(b, &l, sizeof(l));
+			a += sizeof(l);
+			b += sizeof(l);
+		} while ((es -= sizeof(l)) > 0);
+		return;
+	}
+
 	do {
 		t = *a;
 		*a++ = *b;
@@ -83,14 +101,41 @@ __unused
 	      :(CMP(thunk, b, c) > 0 ? b : (CMP(thunk, a, c) < 0 ? a : c ));
 }
 
-#ifdef I_AM_QSORT_R
-void
-qsort_r(void *a, size_t n, size_t es, void *thunk, cmp_t *cmp)
-#else
-#define	thunk NULL
-void
-qsort(void *a, size_t n, size_t es, cmp_t *cmp)
+static void
+siftdown(char *a, size_t i, size_t n, size_t es, cmp_t *cmp, void *thunk
+#ifndef I_AM_QSORT_R
+__unused
 #endif
+)
+{
+	size_t child;
+
+	for (; (child = 2 * i + 1) < n; i = child) {
+		if (child + 1 < n &&
+		    CMP(thunk, a + child * es, a + (child + 1) * es) < 0)
+			child++;
+		if (CMP(thunk, a + i * es, a + child * es) >= 0)
+			return;
+		swapfunc(a + i * es, a + child * es, es);
+	}
+}
+
+static void
+heapsort_fallback(char *a, size_t n, size_t es, cmp_t *cmp, void *thunk)
+{
+	size_t i;
+
+	for (i = n / 2; i > 0; i--)
+		siftdown(a, i - 1, n, es, cmp, thunk);
+	for (i = n - 1; i > 0; i--) {
+		swapfunc(a, a + i * es, es);
+		siftdown(a, 0, i, es, cmp, thunk);
+	}
+}
+
+static void
+local_qsort(void *a, size_t n, size_t es, cmp_t *cmp, void *thunk,
+    int depth)
 {
 	char *pa, *pb, *pc, *pd, *pl, *pm, *pn;
 	size_t d1, d2;
@@ -107,6 +152,10 @@ qsort(void *a, size_t n, size_t es, cmp_t *cmp)
 				swapfunc(pl, pl - es, es);
 		return;
 	}
+	if (depth-- == 0) {
+		heapsort_fallback(a, n, es, cmp, thunk);
+		return;
+	}
 	pm = (char *)a + (n / 2) * es;
 	if (n > 7) {
 		pl = a;
@@ -149,11 +198,21 @@ qsort(void *a, size_t n, size_t es, cmp_t *cmp)
 		pc -= es;
 	}
 	if (swap_cnt == 0) {  /* Switch to insertion sort */
+		/*
+		 * Only the pivot moved, so the input may be nearly sorted.
+		 * Put the pivot back and insertion sort, but give up after
+		 * n moves and partition again: insertion sort is quadratic
+		 * when the guess is wrong.
+		 */
+		swapfunc(a, pm, es);
 		for (pm = (char *)a + es; pm < (char *)a + n * es; pm += es)
 			for (pl = pm; 
 			     pl > (char *)a && CMP(thunk, pl - es, pl) > 0;
-			     pl -= es)
+			     pl -= es) {
 				swapfunc(pl, pl - es, es);
+				if ((size_t)++swap_cnt > n)
+					goto loop;
+			}
 		return;
 	}
 
@@ -167,13 +226,8 @@ qsort(void *a, size_t n, size_t es, cmp_t *cmp)
 	d2 = pd - pc;
 	if (d1 <= d2) {
 		/* Recurse on left partition, then iterate on right partition */
-		if (d1 > es) {
-#ifdef I_AM_QSORT_R
-			qsort_r(a, d1 / es, es, thunk, cmp);
-#else
-			qsort(a, d1 / es, es, cmp);
-#endif
-		}
+		if (d1 > es)
+			local_qsort(a, d1 / es, es, cmp, thunk, depth);
 		if (d2 > es) {
 			/* Iterate rather than recurse to save stack space */
 			/* qsort(pn - d2, d2 / es, es, cmp); */
@@ -183,13 +237,8 @@ qsort(void *a, size_t n, size_t es, cmp_t *cmp)
 		}
 	} else {
 		/* Recurse on right partition, then iterate on left partition */
-		if (d2 > es) {
-#ifdef I_AM_QSORT_R
-			qsort_r(pn - d2, d2 / es, es, thunk, cmp);
-#else
-			qsort(pn - d2, d2 / es, es, cmp);
-#endif
-		}
+		if (d2 > es)
+			local_qsort(pn - d2, d2 / es, es, cmp, thunk, depth);
 		if (d1 > es) {
 			/* Iterate rather than recurse to save stack space */
 			/* qsort(a, d1 / es, es, cmp); */
@@ -198,3 +247,19 @@ qsort(void *a, size_t n, size_t es, cmp_t *cmp)
 		}
 	}
 }
+
+#ifdef I_AM_QSORT_R
+void
+qsort_r(void *a, size_t n, size_t es, void *thunk, cmp_t *cmp)
+{
+
+	local_qsort(a, n, es, cmp, thunk, 2 * flsl(n));
+}
+#else
+void
+qsort(void *a, size_t n, size_t es, cmp_t *cmp)
+{
+
+	local_qsort(a, n, es, cmp, NULL, 2 * flsl(n));
+}
+#endif
@@ -50,6 +50,7 @@
 #include <list>
 #include <map>
 #include <string>
+#include <vector>
 
 #include "guid.h"
 #include "event.h"
@@ -79,7 +80,10 @@ Consumer::Consumer(Event::BuildMethod *defBuilder,
 		   size_t numEntries)
  : m_devdSockFD(-1),
    m_eventFactory(defBuilder),
-   m_replayingEvents(false)
+   m_replayingEvents(false),
+   m_buffer(MAX_EVENT_BATCH * MAX_EVENT_SIZE),
+   m_numRecords(0),
+   m_nextRecord(0)
 {
 	m_eventFactory.UpdateRegistry(regEntries, numEntries);
 }
@@ -132,6 +136,7 @@ Consumer::DisconnectFromDevd()
 		close(m_devdSockFD);
 	}
 	m_devdSockFD = -1;
+	m_numRecords = m_nextRecord = 0;
 }
 
 std::string
@@ -150,6 +155,32 @@ Consumer::ReadEvent()
 	}
 }
 
+size_t
+Consumer::ReadEvents()
+{
+	struct mmsghdr msgs[MAX_EVENT_BATCH];
+	struct iovec   iov[MAX_EVENT_BATCH];
+	ssize_t	       count;
+
+	memset(msgs, 0, sizeof(msgs));
+	for (size_t i = 0; i < MAX_EVENT_BATCH; i++) {
+		iov[i].iov_base = &m_buffer[i * MAX_EVENT_SIZE];
+		iov[i].iov_len = MAX_EVENT_SIZE;
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	m_numRecords = m_nextRecord = 0;
+	count = ::recvmmsg(m_devdSockFD, msgs, MAX_EVENT_BATCH,
+			   MSG_DONTWAIT, NULL);
+	if (count <= 0)
+		return (0);
+	for (ssize_t i = 0; i < count; i++)
+		m_recordLen[i] = msgs[i].msg_len;
+	m_numRecords = count;
+	return (m_numRecords);
+}
+
 void
 Consumer::ReplayUnconsumedEvents(bool discardUnconsumed)
 {
@@ -162,6 +193,7 @@ Consumer::ReplayUnconsumedEvents(bool discardUnconsumed)
 	while (event != m_unconsumedEvents.end()) {
 		bool consumed((*event)->Process());
 		if (consumed || discardUnconsumed) {
+			UnindexEvent(event);
 			delete *event;
 			event = m_unconsumedEvents.erase(event);
 		} else {
@@ -173,13 +205,79 @@ Consumer::ReplayUnconsumedEvents(bool discardUnconsumed)
 	m_replayingEvents = false;
 }
 
+void
+Consumer::ReplayUnconsumedEvents(const string &devName,
+				 bool discardUnconsumed)
+{
+	std::pair<EventIndex::iterator, EventIndex::iterator>
+	    range(m_unconsumedIndex.equal_range(devName));
+	EventIndex::iterator entry(range.first);
+
+	m_replayingEvents = true;
+	while (entry != range.second) {
+		EventList::iterator event(entry->second);
+		bool consumed((*event)->Process());
+		if (consumed || discardUnconsumed) {
+			delete *event;
+			m_unconsumedEvents.erase(event);
+			m_unconsumedIndex.erase(entry++);
+		} else {
+			entry++;
+		}
+	}
+	m_replayingEvents = false;
+}
+
+void
+Consumer::UnindexEvent(EventList::iterator event)
+{
+	std::pair<EventIndex::iterator, EventIndex::iterator> range;
+	string devName;
+
+	if (!(*event)->DevName(devName))
+		return;
+	range = m_unconsumedIndex.equal_range(devName);
+	for (EventIndex::iterator entry(range.first); entry != range.second;
+	     entry++) {
+		if (entry->second == event) {
+			m_unconsumedIndex.erase(entry);
+			return;
+		}
+	}
+}
+
+void
+Consumer::RegisterHandler(const string &system, EventHandler *handler,
+			  void *arg)
+{
+	if (handler == NULL) {
+		m_handlers.erase(system);
+		return;
+	}
+	m_handlers[system].m_handler = handler;
+	m_handlers[system].m_arg = arg;
+}
+
 bool
 Consumer::SaveEvent(const Event &event)
 {
         if (m_replayingEvents)
                 return (false);
-        m_unconsumedEvents.push_back(event.DeepCopy());
-        return (true);
+        return (SaveEvent(event.DeepCopy()));
+}
+
+bool
+Consumer::SaveEvent(Event *event)
+{
+	string devName;
+
+	if (m_replayingEvents)
+		return (false);
+	m_unconsumedEvents.push_back(event);
+	if (event->DevName(devName))
+		m_unconsumedIndex.insert(EventIndex::value_type(devName,
+		    --m_unconsumedEvents.end()));
+	return (true);
 }
 
 Event *
@@ -190,13 +288,15 @@ Consumer::NextEvent()
 
 	Event *event(NULL);
 	try {
-		string evString;
-
-		evString = ReadEvent();
-		if (! evString.empty()) {
-			Event::TimestampEventString(evString);
-			event = Event::CreateEvent(m_eventFactory, evString);
-		}
+		size_t record;
+
+		if (m_nextRecord == m_numRecords && ReadEvents() == 0)
+			return (NULL);
+		record = m_nextRecord++;
+		m_eventString.assign(&m_buffer[record * MAX_EVENT_SIZE],
+				     m_recordLen[record]);
+		Event::TimestampEventString(m_eventString);
+		event = Event::CreateEvent(m_eventFactory, m_eventString);
 	} catch (const Exception &exp) {
 		exp.Log();
 		DisconnectFromDevd();
@@ -210,17 +310,30 @@ Consumer::ProcessEvents()
 {
 	Event *event;
 	while ((event = NextEvent()) != NULL) {
-		if (event->Process())
-			SaveEvent(*event);
-		delete event;
+		if (!DispatchEvent(*event) || !SaveEvent(event))
+			delete event;
 	}
 }
 
+bool
+Consumer::DispatchEvent(Event &event)
+{
+	HandlerMap::const_iterator handler;
+
+	if (m_handlers.empty())
+		return (event.Process());
+	handler = m_handlers.find(event.Value("system"));
+	if (handler == m_handlers.end())
+		return (event.Process());
+	return (handler->second.m_handler(event, handler->second.m_arg));
+}
+
 void
 Consumer::FlushEvents()
 {
 	std::string s;
 
+	m_numRecords = m_nextRecord = 0;
 	do
 		s = ReadEvent();
 	while (! s.empty()) ;
@@ -232,6 +345,9 @@ Consumer::EventsPending()
 	struct pollfd fds[1];
 	int	      result;
 
+	if (m_nextRecord < m_numRecords)
+		return (true);
+
 	do {
 		fds->fd      = m_devdSockFD;
 		fds->events  = POLLIN;
@@ -53,6 +53,12 @@ class Event;
 class Consumer
 {
 public:
+	/**
+	 * Callback for events dispatched by ProcessEvents().  The
+	 * return value has the same meaning as that of Event::Process().
+	 */
+	typedef bool (EventHandler)(Event &event, void *arg);
+
 	Consumer(Event::BuildMethod *defBuilder = NULL,
 		 EventFactory::Record *regEntries = NULL,
 		 size_t numEntries = 0);
@@ -71,6 +77,15 @@ class Consumer
          */ 
 	bool SaveEvent(const Event &event);
 
+	/**
+	 * Queue an event for deferred processing or replay, taking
+	 * ownership of it instead of making a copy.
+	 *
+	 * \return  True if the event was queued.  Otherwise the caller
+	 *          still owns, and must delete, the event.
+	 */
+	bool SaveEvent(Event *event);
+
 	/**                                  
 	 * Reprocess any events saved via the SaveEvent() facility.   
 	 *
@@ -79,6 +94,26 @@ class Consumer
 	 */                                                              
 	void ReplayUnconsumedEvents(bool discardUnconsumed);
 
+	/**
+	 * Reprocess only the saved events for the given device.
+	 *
+	 * \param devName            The device name, as returned by
+	 *                           Event::DevName(), of the events to
+	 *                           replay.
+	 * \param discardUnconsumed  If true, events that are not consumed
+	 *                           during replay are discarded.
+	 */
+	void ReplayUnconsumedEvents(const std::string &devName,
+				    bool discardUnconsumed);
+
+	/**
+	 * Route events whose "system" value is \a system to \a handler
+	 * instead of their Process() method.  Registering a NULL handler
+	 * removes any existing registration.
+	 */
+	void RegisterHandler(const std::string &system, EventHandler *handler,
+			     void *arg = NULL);
+
 	/** Return an event, if one is available.  */
 	Event *NextEvent();
 
@@ -122,13 +157,47 @@ class Consumer
 	 */
 	std::string ReadEvent();
 
+	/**
+	 * \brief Refill the record buffer with a single recvmmsg(2) call.
+	 *
+	 * \returns  The number of records read.  Zero if none were
+	 *           available or an error occurred.
+	 */
+	size_t ReadEvents();
+
+	/**
+	 * Hand an event to its registered handler, or to its Process()
+	 * method if there is none.
+	 */
+	bool DispatchEvent(Event &event);
+
+	/** Remove an event from the per-device replay index. */
+	void UnindexEvent(EventList::iterator event);
+
 	enum {
 		/*
 		 * The maximum event size supported by libdevdctl.
 		 */
 		MAX_EVENT_SIZE = 8192,
+
+		/*
+		 * The maximum number of records read from devd at once.
+		 */
+		MAX_EVENT_BATCH = 32,
 	};
 
+	struct Handler
+	{
+		EventHandler *m_handler;
+		void         *m_arg;
+	};
+
+	/** Map type for handler lookups by event system. */
+	typedef std::map<std::string, Handler> HandlerMap;
+
+	/** Map type for finding saved events by device name. */
+	typedef std::multimap<std::string, EventList::iterator> EventIndex;
+
 	static const char  s_devdSockPath[];
 
 	/**
@@ -142,6 +211,21 @@ class Consumer
 	/** Queued events for replay. */
 	EventList	   m_unconsumedEvents;
 
+	/** Saved events that have a device name, in the order saved. */
+	EventIndex	   m_unconsumedIndex;
+
+	/** Handlers registered with RegisterHandler(). */
+	HandlerMap	   m_handlers;
+
+	/** Records read by ReadEvents() and not yet returned. */
+	std::vector<char>  m_buffer;
+	size_t		   m_recordLen[MAX_EVENT_BATCH];
+	size_t		   m_numRecords;
+	size_t		   m_nextRecord;
+
+	/** Reused to hold each record while it is parsed. */
+	std::string	   m_eventString;
+
 	/**                                                             
 	 * Flag controlling whether events can be queued.  This boolean
 	 * is set during event replay to ensure that previosuly deferred
@@ -50,6 +50,7 @@
 #include <syslog.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <cstdarg>
 #include <cstring>
 #include <iostream>
@@ -57,6 +58,7 @@
 #include <map>
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include "guid.h"
 #include "event.h"
@@ -78,6 +80,64 @@ namespace DevdCtl
 {
 
 /*=========================== Class Implementations ==========================*/
+/*--------------------------------- NVPairMap --------------------------------*/
+static bool
+NVPairNameLess(const NVPairMap::value_type &pair, const string &name)
+{
+	return (pair.first < name);
+}
+
+//- NVPairMap Public Methods ---------------------------------------------------
+NVPairMap::iterator
+NVPairMap::find(const string &name)
+{
+	iterator pair(LowerBound(name));
+
+	if (pair == m_pairs.end() || pair->first != name)
+		return (m_pairs.end());
+	return (pair);
+}
+
+NVPairMap::const_iterator
+NVPairMap::find(const string &name) const
+{
+	const_iterator pair(std::lower_bound(m_pairs.begin(), m_pairs.end(),
+					     name, NVPairNameLess));
+
+	if (pair == m_pairs.end() || pair->first != name)
+		return (m_pairs.end());
+	return (pair);
+}
+
+string &
+NVPairMap::operator[](const string &name)
+{
+	iterator pair(LowerBound(name));
+
+	if (pair == m_pairs.end() || pair->first != name)
+		pair = m_pairs.insert(pair, value_type(name, string()));
+	return (pair->second);
+}
+
+size_t
+NVPairMap::erase(const string &name)
+{
+	iterator pair(find(name));
+
+	if (pair == m_pairs.end())
+		return (0);
+	m_pairs.erase(pair);
+	return (1);
+}
+
+//- NVPairMap Private Methods --------------------------------------------------
+NVPairMap::iterator
+NVPairMap::LowerBound(const string &name)
+{
+	return (std::lower_bound(m_pairs.begin(), m_pairs.end(), name,
+				 NVPairNameLess));
+}
+
 /*----------------------------------- Event ----------------------------------*/
 //- Event Static Protected Data ------------------------------------------------
 const string Event::s_theEmptyString;
@@ -339,6 +399,14 @@ Event::ParseEventString(Event::Type type,
 {
 	size_t start;
 	size_t end;
+	string key;
+
+	/*
+	 * One pair per '=', plus those synthesized below.  Reserving up
+	 * front leaves a single allocation for the pair storage.
+	 */
+	nvpairs.reserve(std::count(eventString.begin(), eventString.end(), '=')
+		      + 3);
 
 	switch (type) {
 	case ATTACH:
@@ -361,7 +429,7 @@ Event::ParseEventString(Event::Type type,
 			throw ParseException(ParseException::INVALID_FORMAT,
 					     eventString, start);
 
-		nvpairs["device-name"] = eventString.substr(start, end - start);
+		nvpairs["device-name"].assign(eventString, start, end - start);
 
 		start = eventString.find(" on ", end);
 		if (end == string::npos)
@@ -369,7 +437,7 @@ Event::ParseEventString(Event::Type type,
 					     eventString, start);
 		start += 4;
 		end = eventString.find_first_of(" \t\n", start);
-		nvpairs["parent"] = eventString.substr(start, end);
+		nvpairs["parent"].assign(eventString, start, end);
 		break;
 	case NOTIFY:
 		break;
@@ -400,7 +468,7 @@ Event::ParseEventString(Event::Type type,
 			throw ParseException(ParseException::INVALID_FORMAT,
 					     eventString, end);
 		start++;
-		string key(eventString.substr(start, end - start));
+		key.assign(eventString, start, end - start);
 
 		/*
 		 * Walk forward from the '=' until either we exhaust
@@ -413,9 +481,7 @@ Event::ParseEventString(Event::Type type,
 		end = eventString.find_first_of(" \t\n", start);
 		if (end == string::npos)
 			end = eventString.length() - 1;
-		string value(eventString.substr(start, end - start));
-
-		nvpairs[key] = value;
+		nvpairs[key].assign(eventString, start, end - start);
 	}
 }
 
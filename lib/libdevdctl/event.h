@@ -52,9 +52,103 @@ class EventFactory;
 /*============================= Class Definitions ============================*/
 /*-------------------------------- NVPairMap ---------------------------------*/
 /**
- * NVPairMap is a specialization of the standard map STL container.
+ * \brief Name => value pairs of an event, kept in a vector sorted by name.
+ *
+ * Events carry a dozen or so short pairs, most of which fit in the inline
+ * buffer of std::string.  A flat vector therefore costs one allocation per
+ * event where a std::map costs one per pair, and cache misses on lookup.
+ * The interface is the subset of std::map used by event consumers, so code
+ * written against the old typedef keeps working.  Includers must provide
+ * <vector> in addition to <map> and <string>.
  */
-typedef std::map<std::string, std::string> NVPairMap;
+class NVPairMap
+{
+public:
+	typedef std::pair<std::string, std::string>	value_type;
+	typedef std::vector<value_type>::iterator	iterator;
+	typedef std::vector<value_type>::const_iterator	const_iterator;
+
+	iterator	 begin();
+	iterator	 end();
+	const_iterator	 begin()			const;
+	const_iterator	 end()				const;
+	size_t		 size()				const;
+	bool		 empty()			const;
+	void		 reserve(size_t count);
+
+	/**
+	 * Look up a name.
+	 *
+	 * \return  An iterator to the pair, or end() if name is not present.
+	 */
+	iterator	 find(const std::string &name);
+	const_iterator	 find(const std::string &name)	const;
+
+	/** Return 1 if name is present, otherwise 0. */
+	size_t		 count(const std::string &name)	const;
+
+	/**
+	 * Return the value stored for name, inserting an empty value
+	 * first if name is not yet present.
+	 */
+	std::string	&operator[](const std::string &name);
+
+	/** Remove the pair for name, if any.  \return  The number removed. */
+	size_t		 erase(const std::string &name);
+
+private:
+	iterator	 LowerBound(const std::string &name);
+
+	std::vector<value_type> m_pairs;
+};
+
+inline NVPairMap::iterator
+NVPairMap::begin()
+{
+	return (m_pairs.begin());
+}
+
+inline NVPairMap::iterator
+NVPairMap::end()
+{
+	return (m_pairs.end());
+}
+
+inline NVPairMap::const_iterator
+NVPairMap::begin() const
+{
+	return (m_pairs.begin());
+}
+
+inline NVPairMap::const_iterator
+NVPairMap::end() const
+{
+	return (m_pairs.end());
+}
+
+inline size_t
+NVPairMap::size() const
+{
+	return (m_pairs.size());
+}
+
+inline bool
+NVPairMap::empty() const
+{
+	return (m_pairs.empty());
+}
+
+inline void
+NVPairMap::reserve(size_t count)
+{
+	m_pairs.reserve(count);
+}
+
+inline size_t
+NVPairMap::count(const std::string &name) const
+{
+	return (find(name) != end() ? 1 : 0);
+}
 
 /*----------------------------------- Event ----------------------------------*/
 /**
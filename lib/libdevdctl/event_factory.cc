@@ -39,6 +39,7 @@
 #include <list>
 #include <map>
 #include <string>
+#include <vector>
 
 #include "guid.h"
 #include "event.h"
@@ -79,7 +80,7 @@ EventFactory::UpdateRegistry(Record regEntries[], size_t numEntries)
 
 Event *
 EventFactory::Build(Event::Type type, NVPairMap &nvpairs,
-		    const std::string eventString) const
+		    const std::string &eventString) const
 {
 	Key key(type, nvpairs["system"]);
 	Event::BuildMethod *buildMethod(m_defaultBuildMethod);
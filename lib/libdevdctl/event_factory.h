@@ -70,7 +70,7 @@ class EventFactory
 
 	const Registry &GetRegistry()				const;
 	Event *Build(Event::Type type, NVPairMap &nvpairs,
-		     const std::string eventString)		const;
+		     const std::string &eventString)		const;
 
 	EventFactory(Event::BuildMethod *defaultBuildMethod = NULL);
 
@@ -0,0 +1,121 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause-FreeBSD
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $FreeBSD$
+ */
+
+/**
+ * \file libdevdctl_parse_bench.cc
+ *
+ * Measure how fast Event::CreateEvent() turns devd event strings into
+ * events.  The strings resemble those zfsd sees during a pool import.
+ * The results of the parse are checked, so the program also fails if
+ * parsing is broken.
+ */
+#include <sys/time.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <list>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <devdctl/guid.h>
+#include <devdctl/event.h>
+#include <devdctl/event_factory.h>
+
+using namespace DevdCtl;
+using std::string;
+
+/*================================== Macros ==================================*/
+#define NUM_ELEMENTS(x) (sizeof(x) / sizeof(*x))
+
+static const char *events[] = {
+	"!system=ZFS subsystem=ZFS type=misc.fs.zfs.vdev_statechange "
+	    "pool_name=tank pool_guid=7779622063490637391 pool_context=0 "
+	    "vdev_guid=1504608668171300600 vdev_state=7 timestamp=1500000000\n",
+	"!system=DEVFS subsystem=CDEV type=CREATE cdev=da17p1 "
+	    "timestamp=1500000000\n",
+	"!system=GEOM subsystem=DEV type=CREATE cdev=gpt/disk17 "
+	    "timestamp=1500000000\n",
+	"+da17 at scbus0 target=17 unit=0 on mps0 timestamp=1500000000\n",
+};
+
+static double
+now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (tv.tv_sec + tv.tv_usec / 1e6);
+}
+
+int
+main(int argc, char **argv)
+{
+	EventFactory factory(Event::Builder);
+	std::vector<string> strings;
+	Event *event;
+	double elapsed, start;
+	long i, iterations;
+
+	iterations = argc > 1 ? strtol(argv[1], NULL, 0) : 200000;
+	for (i = 0; i < (long)NUM_ELEMENTS(events); i++)
+		strings.push_back(events[i]);
+
+	event = Event::CreateEvent(factory, strings[0]);
+	if (event == NULL || event->Value("pool_name") != "tank" ||
+	    event->Value("vdev_state") != "7" || !event->Contains("type")) {
+		printf("not ok: ZFS event parsed incorrectly\n");
+		return (1);
+	}
+	delete event;
+	event = Event::CreateEvent(factory, strings[3]);
+	if (event == NULL || event->Value("device-name") != "da17" ||
+	    event->Value("target") != "17") {
+		printf("not ok: attach event parsed incorrectly\n");
+		return (1);
+	}
+	delete event;
+
+	start = now();
+	for (i = 0; i < iterations; i++) {
+		event = Event::CreateEvent(factory,
+		    strings[i % strings.size()]);
+		if (event == NULL) {
+			printf("not ok: event %ld failed to parse\n", i);
+			return (1);
+		}
+		delete event;
+	}
+	elapsed = now() - start;
+	printf("%ld events in %.3f s: %.0f events/s\n", iterations, elapsed,
+	    elapsed > 0 ? iterations / elapsed : 0);
+	return (0);
+}
@@ -122,6 +122,7 @@ _kvm_open(kvm_t *kd, const char *uf, const char *mf, int flag, char *errout)
 	kd->nlfd = -1;
 	kd->vmst = NULL;
 	kd->procbase = NULL;
+	kd->procsize = 0;
 	kd->argspc = NULL;
 	kd->argv = NULL;
 
@@ -68,6 +68,7 @@ struct __kvm {
 	GElf_Ehdr nlehdr;	/* ELF file header for namelist file */
 	int	(*resolve_symbol)(const char *, kvaddr_t *);
 	struct kinfo_proc *procbase;
+	size_t	procsize;	/* allocated size of procbase (live only) */
 	char	*argspc;	/* (dynamic) storage for argv strings */
 	int	arglen;		/* length of the above */
 	char	**argv;		/* (dynamic) storage for argv pointers */
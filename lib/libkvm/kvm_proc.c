@@ -493,26 +493,44 @@ kvm_getprocs(kvm_t *kd, int op, int arg, int *cnt)
 {
 	int mib[4], st, nprocs;
 	size_t size, osize;
+	u_int miblen;
 	int temp_op;
 
-	if (kd->procbase != 0) {
+	if (kd->procbase != 0 && !ISALIVE(kd)) {
 		free((void *)kd->procbase);
 		/*
 		 * Clear this pointer in case this call fails.  Otherwise,
 		 * kvm_close() will free it again.
 		 */
 		kd->procbase = 0;
+		kd->procsize = 0;
 	}
 	if (ISALIVE(kd)) {
-		size = 0;
 		mib[0] = CTL_KERN;
 		mib[1] = KERN_PROC;
 		mib[2] = op;
 		mib[3] = arg;
 		temp_op = op & ~KERN_PROC_INC_THREAD;
-		st = sysctl(mib,
-		    temp_op == KERN_PROC_ALL || temp_op == KERN_PROC_PROC ?
-		    3 : 4, NULL, &size, NULL, 0);
+		miblen = temp_op == KERN_PROC_ALL || temp_op == KERN_PROC_PROC ?
+		    3 : 4;
+		/*
+		 * Callers such as top(1) and ps(1) ask for the same list
+		 * over and over.  Try the buffer left over from the last
+		 * call first, so that the common case is one pass over the
+		 * process table instead of a sizing pass plus a copy pass.
+		 */
+		if (kd->procbase != NULL && kd->procsize > 0) {
+			size = kd->procsize;
+			st = sysctl(mib, miblen, kd->procbase, &size, NULL, 0);
+			if (st == 0)
+				goto livecheck;
+			if (errno != ENOMEM) {
+				_kvm_syserr(kd, kd->program, "kvm_getprocs");
+				return (0);
+			}
+		}
+		size = 0;
+		st = sysctl(mib, miblen, NULL, &size, NULL, 0);
 		if (st == -1) {
 			_kvm_syserr(kd, kd->program, "kvm_getprocs");
 			return (0);
@@ -533,24 +551,28 @@ kvm_getprocs(kvm_t *kd, int op, int arg, int *cnt)
 			 * Then again, _kvm_freeprocs() isn't used
 			 * anywhere . . .
 			 */
-			kd->procbase = _kvm_malloc(kd, 1);
+			if (kd->procbase == NULL) {
+				kd->procbase = _kvm_malloc(kd, 1);
+				kd->procsize = 0;
+			}
 			goto liveout;
 		}
 		do {
 			size += size / 10;
 			kd->procbase = (struct kinfo_proc *)
 			    _kvm_realloc(kd, kd->procbase, size);
-			if (kd->procbase == NULL)
+			if (kd->procbase == NULL) {
+				kd->procsize = 0;
 				return (0);
-			osize = size;
-			st = sysctl(mib, temp_op == KERN_PROC_ALL ||
-			    temp_op == KERN_PROC_PROC ? 3 : 4,
-			    kd->procbase, &size, NULL, 0);
+			}
+			kd->procsize = osize = size;
+			st = sysctl(mib, miblen, kd->procbase, &size, NULL, 0);
 		} while (st == -1 && errno == ENOMEM && size == osize);
 		if (st == -1) {
 			_kvm_syserr(kd, kd->program, "kvm_getprocs");
 			return (0);
 		}
+livecheck:
 		/*
 		 * We have to check the size again because sysctl()
 		 * may "round up" oldlenp if oldp is NULL; hence it
@@ -636,6 +658,7 @@ _kvm_freeprocs(kvm_t *kd)
 
 	free(kd->procbase);
 	kd->procbase = NULL;
+	kd->procsize = 0;
 }
 
 void *
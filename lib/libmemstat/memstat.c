@@ -189,6 +189,7 @@ _memstat_mt_reset_stats(struct memory_type *mtp, int maxcpus)
 
 	mtp->mt_memalloced = 0;
 	mtp->mt_memfreed = 0;
+	mtp->mt_memrequested = 0;
 	mtp->mt_numallocs = 0;
 	mtp->mt_numfrees = 0;
 	mtp->mt_bytes = 0;
@@ -196,6 +197,8 @@ _memstat_mt_reset_stats(struct memory_type *mtp, int maxcpus)
 	mtp->mt_free = 0;
 	mtp->mt_failures = 0;
 	mtp->mt_sleeps = 0;
+	mtp->mt_xfers = 0;
+	mtp->mt_lockfails = 0;
 
 	mtp->mt_zonefree = 0;
 	mtp->mt_kegfree = 0;
@@ -270,6 +273,13 @@ memstat_get_memalloced(const struct memory_type *mtp)
 	return (mtp->mt_memalloced);
 }
 
+uint64_t
+memstat_get_memrequested(const struct memory_type *mtp)
+{
+
+	return (mtp->mt_memrequested);
+}
+
 uint64_t
 memstat_get_memfreed(const struct memory_type *mtp)
 {
@@ -326,6 +336,20 @@ memstat_get_sleeps(const struct memory_type *mtp)
 	return (mtp->mt_sleeps);
 }
 
+uint64_t
+memstat_get_xfers(const struct memory_type *mtp)
+{
+
+	return (mtp->mt_xfers);
+}
+
+uint64_t
+memstat_get_lockfails(const struct memory_type *mtp)
+{
+
+	return (mtp->mt_lockfails);
+}
+
 void *
 memstat_get_caller_pointer(const struct memory_type *mtp, int index)
 {
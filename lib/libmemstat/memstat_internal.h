@@ -62,6 +62,7 @@ struct memory_type {
 	 */
 	uint64_t	 mt_memalloced;	/* Bytes allocated over life time. */
 	uint64_t	 mt_memfreed;	/* Bytes freed over life time. */
+	uint64_t	 mt_memrequested; /* malloc: bytes requested over life time. */
 	uint64_t	 mt_numallocs;	/* Allocations over life time. */
 	uint64_t	 mt_numfrees;	/* Frees over life time. */
 	uint64_t	 mt_bytes;	/* Bytes currently allocated. */
@@ -69,6 +70,8 @@ struct memory_type {
 	uint64_t	 mt_free;	/* Number of cached free items. */
 	uint64_t	 mt_failures;	/* Number of allocation failures. */
 	uint64_t	 mt_sleeps;	/* Number of allocation sleeps. */
+	uint64_t	 mt_xfers;	/* Cache buckets passed between CPUs. */
+	uint64_t	 mt_lockfails;	/* Contended zone lock acquisitions. */
 
 	/*
 	 * Caller-owned memory.
@@ -198,6 +198,7 @@ memstat_sysctl_malloc(struct memory_type_list *list, int flags)
 			 */
 			mtp->mt_memalloced += mtsp->mts_memalloced;
 			mtp->mt_memfreed += mtsp->mts_memfreed;
+			mtp->mt_memrequested += mtsp->mts_memrequested;
 			mtp->mt_numallocs += mtsp->mts_numallocs;
 			mtp->mt_numfrees += mtsp->mts_numfrees;
 			mtp->mt_sizemask |= mtsp->mts_size;
@@ -390,6 +391,7 @@ memstat_kvm_malloc(struct memory_type_list *list, void *kvm_handle)
 			}
 			mtp->mt_memalloced += mts.mts_memalloced;
 			mtp->mt_memfreed += mts.mts_memfreed;
+			mtp->mt_memrequested += mts.mts_memrequested;
 			mtp->mt_numallocs += mts.mts_numallocs;
 			mtp->mt_numfrees += mts.mts_numfrees;
 			mtp->mt_sizemask |= mts.mts_size;
@@ -200,6 +200,8 @@ memstat_sysctl_uma(struct memory_type_list *list, int flags)
 		mtp->mt_numfrees = uthp->uth_frees;
 		mtp->mt_failures = uthp->uth_fails;
 		mtp->mt_sleeps = uthp->uth_sleeps;
+		mtp->mt_xfers = uthp->uth_xfers;
+		mtp->mt_lockfails = uthp->uth_lockfails;
 
 		for (j = 0; j < maxcpus; j++) {
 			upsp = (struct uma_percpu_stat *)p;
@@ -410,6 +412,8 @@ memstat_kvm_uma(struct memory_type_list *list, void *kvm_handle)
 			mtp->mt_numfrees = uz.uz_frees;
 			mtp->mt_failures = uz.uz_fails;
 			mtp->mt_sleeps = uz.uz_sleeps;
+			mtp->mt_xfers = uz.uz_xfers;
+			mtp->mt_lockfails = uz.uz_lockfails;
 			if (kz.uk_flags & UMA_ZFLAG_INTERNAL)
 				goto skip_percpu;
 			for (i = 0; i < mp_maxid + 1; i++) {
@@ -74,6 +74,10 @@ static int arm64_allocate_pmc(enum pmc_event _pe, char *_ctrspec,
 static int mips_allocate_pmc(enum pmc_event _pe, char* ctrspec,
 			     struct pmc_op_pmcallocate *_pmc_config);
 #endif /* __mips__ */
+#if defined(__riscv)
+static int riscv_allocate_pmc(enum pmc_event _pe, char *_ctrspec,
+    struct pmc_op_pmcallocate *_pmc_config);
+#endif
 static int soft_allocate_pmc(enum pmc_event _pe, char *_ctrspec,
     struct pmc_op_pmcallocate *_pmc_config);
 
@@ -149,6 +153,7 @@ PMC_CLASSDEP_TABLE(octeon, OCTEON);
 PMC_CLASSDEP_TABLE(ppc7450, PPC7450);
 PMC_CLASSDEP_TABLE(ppc970, PPC970);
 PMC_CLASSDEP_TABLE(e500, E500);
+PMC_CLASSDEP_TABLE(riscv, RISCV);
 
 static struct pmc_event_descr soft_event_table[PMC_EV_DYN_COUNT];
 
@@ -197,6 +202,7 @@ PMC_MDEP_TABLE(octeon, OCTEON, PMC_CLASS_SOFT, PMC_CLASS_OCTEON);
 PMC_MDEP_TABLE(ppc7450, PPC7450, PMC_CLASS_SOFT, PMC_CLASS_PPC7450, PMC_CLASS_TSC);
 PMC_MDEP_TABLE(ppc970, PPC970, PMC_CLASS_SOFT, PMC_CLASS_PPC970, PMC_CLASS_TSC);
 PMC_MDEP_TABLE(e500, E500, PMC_CLASS_SOFT, PMC_CLASS_E500, PMC_CLASS_TSC);
+PMC_MDEP_TABLE(riscv, RISCV, PMC_CLASS_SOFT, PMC_CLASS_RISCV);
 PMC_MDEP_TABLE(generic, SOFT, PMC_CLASS_SOFT);
 
 static const struct pmc_event_descr tsc_event_table[] =
@@ -244,6 +250,9 @@ PMC_CLASS_TABLE_DESC(ppc7450, PPC7450, ppc7450, powerpc);
 PMC_CLASS_TABLE_DESC(ppc970, PPC970, ppc970, powerpc);
 PMC_CLASS_TABLE_DESC(e500, E500, e500, powerpc);
 #endif
+#if defined(__riscv)
+PMC_CLASS_TABLE_DESC(riscv, RISCV, riscv, riscv);
+#endif
 
 static struct pmc_class_descr soft_class_table_descr =
 {
@@ -880,6 +889,45 @@ mips_allocate_pmc(enum pmc_event pe, char *ctrspec __unused,
 
 #endif /* __mips__ */
 
+#if defined(__riscv)
+
+static struct pmc_event_alias riscv_aliases[] = {
+	EV_ALIAS("cycles",		"CPU_CYCLES"),
+	EV_ALIAS("instructions",	"INSTRUCTIONS"),
+	EV_ALIAS("branches",		"BRANCH_INSTRUCTIONS"),
+	EV_ALIAS("branch-mispredicts",	"BRANCH_MISSES"),
+	EV_ALIAS("dc-misses",		"L1D_READ_MISS"),
+	EV_ALIAS("ic-misses",		"L1I_READ_MISS"),
+	EV_ALIAS(NULL, NULL)
+};
+
+#define	RISCV_KW_OS		"os"
+#define	RISCV_KW_USR		"usr"
+
+static int
+riscv_allocate_pmc(enum pmc_event pe, char *ctrspec,
+    struct pmc_op_pmcallocate *pmc_config)
+{
+	char *p;
+
+	(void) pe;
+
+	pmc_config->pm_caps |= (PMC_CAP_READ | PMC_CAP_WRITE);
+
+	while ((p = strsep(&ctrspec, ",")) != NULL) {
+		if (KWMATCH(p, RISCV_KW_OS))
+			pmc_config->pm_caps |= PMC_CAP_SYSTEM;
+		else if (KWMATCH(p, RISCV_KW_USR))
+			pmc_config->pm_caps |= PMC_CAP_USER;
+		else
+			return (-1);
+	}
+
+	return (0);
+}
+
+#endif /* __riscv */
+
 #if defined(__powerpc__)
 
 static struct pmc_event_alias ppc7450_aliases[] = {
@@ -1156,12 +1204,25 @@ pmc_configure_logfile(int fd)
 {
 	struct pmc_op_configurelog cla;
 
+	cla.pm_flags = 0;
 	cla.pm_logfd = fd;
 	if (PMC_CALL(CONFIGURELOG, &cla) < 0)
 		return (-1);
 	return (0);
 }
 
+int
+pmc_configure_logring(int fd)
+{
+	struct pmc_op_configurelog cla;
+
+	cla.pm_flags = 0;
+	cla.pm_logfd = fd;
+	if (PMC_CALL(CONFIGURERING, &cla) < 0)
+		return (-1);
+	return (0);
+}
+
 int
 pmc_cpuinfo(const struct pmc_cpuinfo **pci)
 {
@@ -1291,6 +1352,10 @@ pmc_event_names_of_class(enum pmc_class cl, const char ***eventnames,
 		ev = e500_event_table;
 		count = PMC_EVENT_TABLE_SIZE(e500);
 		break;
+	case PMC_CLASS_RISCV:
+		ev = riscv_event_table;
+		count = PMC_EVENT_TABLE_SIZE(riscv);
+		break;
 	case PMC_CLASS_SOFT:
 		ev = soft_event_table;
 		count = soft_event_info.pm_nevent;
@@ -1534,6 +1599,12 @@ pmc_init(void)
 		PMC_MDEP_INIT(e500);
 		pmc_class_table[n] = &e500_class_table_descr;
 		break;
+#endif
+#if defined(__riscv)
+	case PMC_CPU_RISCV_RV64:
+		PMC_MDEP_INIT(riscv);
+		pmc_class_table[n] = &riscv_class_table_descr;
+		break;
 #endif
 	default:
 		/*
@@ -1663,6 +1734,9 @@ _pmc_name_of_event(enum pmc_event pe, enum pmc_cputype cpu)
 	} else if (pe >= PMC_EV_E500_FIRST && pe <= PMC_EV_E500_LAST) {
 		ev = e500_event_table;
 		evfence = e500_event_table + PMC_EVENT_TABLE_SIZE(e500);
+	} else if (pe >= PMC_EV_RISCV_FIRST && pe <= PMC_EV_RISCV_LAST) {
+		ev = riscv_event_table;
+		evfence = riscv_event_table + PMC_EVENT_TABLE_SIZE(riscv);
 	} else if (pe == PMC_EV_TSC_TSC) {
 		ev = tsc_event_table;
 		evfence = tsc_event_table + PMC_EVENT_TABLE_SIZE(tsc);
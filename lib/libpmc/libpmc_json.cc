@@ -41,6 +41,7 @@
 #include <assert.h>
 #include <string>
 #include <sysexits.h>
+#include <unistd.h>
 #include <pmcformat.h>
 
 using std::string;
@@ -69,274 +70,316 @@ static const char *typenames[] = {
 	"{\"type\": \"proc_create\"",
 };
 
-static string
-startentry(struct pmclog_ev *ev)
+#define	JSON_LIT(out, s)	((out).append(s, sizeof(s) - 1))
+
+static const char hexdigits[] = "0123456789abcdef";
+
+/*
+ * Integer formatting is done by hand: it is nearly all of the work for
+ * callchains, and much cheaper than snprintf(3).
+ */
+static inline void
+json_hex(string &out, uint64_t v, int width)
 {
-	char eventbuf[128];
+	char buf[2 + 16];
+	int i;
+
+	buf[0] = '0';
+	buf[1] = 'x';
+	for (i = width + 1; i > 1; i--) {
+		buf[i] = hexdigits[v & 0xf];
+		v >>= 4;
+	}
+	out.append(buf, width + 2);
+}
 
-	snprintf(eventbuf, sizeof(eventbuf), "%s, \"tsc\": \"%jd\"",
-	    typenames[ev->pl_type], (uintmax_t)ev->pl_ts.tv_sec);
-	return (string(eventbuf));
+static inline void
+json_int(string &out, intmax_t v)
+{
+	char buf[24], *p;
+	uintmax_t u;
+
+	p = buf + sizeof(buf);
+	u = v < 0 ? -(uintmax_t)v : (uintmax_t)v;
+	do {
+		*--p = '0' + u % 10;
+		u /= 10;
+	} while (u != 0);
+	if (v < 0)
+		*--p = '-';
+	out.append(p, buf + sizeof(buf) - p);
 }
 
-static string
-initialize_to_json(struct pmclog_ev *ev)
+static void
+startentry(struct pmclog_ev *ev, string &out)
 {
-	char eventbuf[256];
-	string startent;
-
-	startent = startentry(ev);
-	snprintf(eventbuf, sizeof(eventbuf),
-	    "%s, \"version\": \"0x%08x\", \"arch\": \"0x%08x\", \"cpuid\": \"%s\", "
-		"\"tsc_freq\": \"%jd\", \"sec\": \"%jd\", \"nsec\": \"%jd\"}\n",
-		startent.c_str(), ev->pl_u.pl_i.pl_version, ev->pl_u.pl_i.pl_arch,
-		ev->pl_u.pl_i.pl_cpuid, (uintmax_t)ev->pl_u.pl_i.pl_tsc_freq,
-		(uintmax_t)ev->pl_u.pl_i.pl_ts.tv_sec, (uintmax_t)ev->pl_u.pl_i.pl_ts.tv_nsec);
-	return string(eventbuf);
+
+	out += typenames[ev->pl_type];
+	JSON_LIT(out, ", \"tsc\": \"");
+	json_int(out, (intmax_t)ev->pl_ts.tv_sec);
+	JSON_LIT(out, "\"");
 }
 
-static string
-pmcallocate_to_json(struct pmclog_ev *ev)
+static void
+initialize_to_json(struct pmclog_ev *ev, string &out)
 {
-	char eventbuf[256];
-	string startent;
-
-	startent = startentry(ev);
-	snprintf(eventbuf, sizeof(eventbuf),
-	    "%s, \"pmcid\": \"0x%08x\", \"event\": \"0x%08x\", \"flags\": \"0x%08x\", "
-	    "\"rate\": \"%jd\"}\n",
-		startent.c_str(), ev->pl_u.pl_a.pl_pmcid, ev->pl_u.pl_a.pl_event,
-	    ev->pl_u.pl_a.pl_flags, (intmax_t)ev->pl_u.pl_a.pl_rate);
-	return string(eventbuf);
+
+	startentry(ev, out);
+	JSON_LIT(out, ", \"version\": \"");
+	json_hex(out, ev->pl_u.pl_i.pl_version, 8);
+	JSON_LIT(out, "\", \"arch\": \"");
+	json_hex(out, ev->pl_u.pl_i.pl_arch, 8);
+	JSON_LIT(out, "\", \"cpuid\": \"");
+	out += ev->pl_u.pl_i.pl_cpuid;
+	JSON_LIT(out, "\", \"tsc_freq\": \"");
+	json_int(out, (intmax_t)ev->pl_u.pl_i.pl_tsc_freq);
+	JSON_LIT(out, "\", \"sec\": \"");
+	json_int(out, (intmax_t)ev->pl_u.pl_i.pl_ts.tv_sec);
+	JSON_LIT(out, "\", \"nsec\": \"");
+	json_int(out, (intmax_t)ev->pl_u.pl_i.pl_ts.tv_nsec);
+	JSON_LIT(out, "\"}\n");
 }
 
-static string
-pmcattach_to_json(struct pmclog_ev *ev)
+static void
+pmcallocate_to_json(struct pmclog_ev *ev, string &out)
 {
-	char eventbuf[2048];
-	string startent;
-
-	startent = startentry(ev);
-	snprintf(eventbuf, sizeof(eventbuf),
-	    "%s, \"pmcid\": \"0x%08x\", \"pid\": \"%d\", \"pathname\": \"%s\"}\n",
-		startent.c_str(), ev->pl_u.pl_t.pl_pmcid, ev->pl_u.pl_t.pl_pid,
-	    ev->pl_u.pl_t.pl_pathname);
-	return string(eventbuf);
+
+	startentry(ev, out);
+	JSON_LIT(out, ", \"pmcid\": \"");
+	json_hex(out, ev->pl_u.pl_a.pl_pmcid, 8);
+	JSON_LIT(out, "\", \"event\": \"");
+	json_hex(out, ev->pl_u.pl_a.pl_event, 8);
+	JSON_LIT(out, "\", \"flags\": \"");
+	json_hex(out, ev->pl_u.pl_a.pl_flags, 8);
+	JSON_LIT(out, "\", \"rate\": \"");
+	json_int(out, (intmax_t)ev->pl_u.pl_a.pl_rate);
+	JSON_LIT(out, "\"}\n");
 }
 
-static string
-pmcdetach_to_json(struct pmclog_ev *ev)
+static void
+pmcattach_to_json(struct pmclog_ev *ev, string &out)
 {
-	char eventbuf[128];
-	string startent;
-
-	startent = startentry(ev);
-	snprintf(eventbuf, sizeof(eventbuf),
-		"%s, \"pmcid\": \"0x%08x\", \"pid\": \"%d\"}\n",
-			 startent.c_str(), ev->pl_u.pl_d.pl_pmcid, ev->pl_u.pl_d.pl_pid);
-	return string(eventbuf);
+
+	startentry(ev, out);
+	JSON_LIT(out, ", \"pmcid\": \"");
+	json_hex(out, ev->pl_u.pl_t.pl_pmcid, 8);
+	JSON_LIT(out, "\", \"pid\": \"");
+	json_int(out, (int)ev->pl_u.pl_t.pl_pid);
+	JSON_LIT(out, "\", \"pathname\": \"");
+	out += ev->pl_u.pl_t.pl_pathname;
+	JSON_LIT(out, "\"}\n");
 }
 
+static void
+pmcdetach_to_json(struct pmclog_ev *ev, string &out)
+{
+
+	startentry(ev, out);
+	JSON_LIT(out, ", \"pmcid\": \"");
+	json_hex(out, ev->pl_u.pl_d.pl_pmcid, 8);
+	JSON_LIT(out, "\", \"pid\": \"");
+	json_int(out, (int)ev->pl_u.pl_d.pl_pid);
+	JSON_LIT(out, "\"}\n");
+}
 
-static string
-proccsw_to_json(struct pmclog_ev *ev)
+static void
+proccsw_to_json(struct pmclog_ev *ev, string &out)
 {
-	char eventbuf[128];
-	string startent;
-
-	startent = startentry(ev);
-	snprintf(eventbuf, sizeof(eventbuf), "%s, \"pmcid\": \"0x%08x\", \"pid\": \"%d\" "
-	    "\"tid\": \"%d\", \"value\": \"0x%016jx\"}\n",
-		startent.c_str(), ev->pl_u.pl_c.pl_pmcid, ev->pl_u.pl_c.pl_pid,
-	    ev->pl_u.pl_c.pl_tid, (uintmax_t)ev->pl_u.pl_c.pl_value);
-	return string(eventbuf);
+
+	startentry(ev, out);
+	JSON_LIT(out, ", \"pmcid\": \"");
+	json_hex(out, ev->pl_u.pl_c.pl_pmcid, 8);
+	JSON_LIT(out, "\", \"pid\": \"");
+	json_int(out, (int)ev->pl_u.pl_c.pl_pid);
+	JSON_LIT(out, "\" \"tid\": \"");
+	json_int(out, (int)ev->pl_u.pl_c.pl_tid);
+	JSON_LIT(out, "\", \"value\": \"");
+	json_hex(out, ev->pl_u.pl_c.pl_value, 16);
+	JSON_LIT(out, "\"}\n");
 }
 
-static string
-procexec_to_json(struct pmclog_ev *ev)
+static void
+procexec_to_json(struct pmclog_ev *ev, string &out)
 {
-	char eventbuf[2048];
-	string startent;
-
-	startent = startentry(ev);
-	snprintf(eventbuf, sizeof(eventbuf),
-		"%s, \"pmcid\": \"0x%08x\", \"pid\": \"%d\", "
-	    "\"start\": \"0x%016jx\", \"pathname\": \"%s\"}\n",
-		startent.c_str(), ev->pl_u.pl_x.pl_pmcid, ev->pl_u.pl_x.pl_pid,
-		(uintmax_t)ev->pl_u.pl_x.pl_entryaddr, ev->pl_u.pl_x.pl_pathname);
-	return string(eventbuf);
+
+	startentry(ev, out);
+	JSON_LIT(out, ", \"pmcid\": \"");
+	json_hex(out, ev->pl_u.pl_x.pl_pmcid, 8);
+	JSON_LIT(out, "\", \"pid\": \"");
+	json_int(out, (int)ev->pl_u.pl_x.pl_pid);
+	JSON_LIT(out, "\", \"start\": \"");
+	json_hex(out, ev->pl_u.pl_x.pl_entryaddr, 16);
+	JSON_LIT(out, "\", \"pathname\": \"");
+	out += ev->pl_u.pl_x.pl_pathname;
+	JSON_LIT(out, "\"}\n");
 }
 
-static string
-procexit_to_json(struct pmclog_ev *ev)
+static void
+procexit_to_json(struct pmclog_ev *ev, string &out)
 {
-	char eventbuf[128];
-	string startent;
-
-	startent = startentry(ev);
-	snprintf(eventbuf, sizeof(eventbuf),
-		"%s, \"pmcid\": \"0x%08x\", \"pid\": \"%d\", "
-	    "\"value\": \"0x%016jx\"}\n",
-		startent.c_str(), ev->pl_u.pl_e.pl_pmcid, ev->pl_u.pl_e.pl_pid,
-	    (uintmax_t)ev->pl_u.pl_e.pl_value);
-	return string(eventbuf);
+
+	startentry(ev, out);
+	JSON_LIT(out, ", \"pmcid\": \"");
+	json_hex(out, ev->pl_u.pl_e.pl_pmcid, 8);
+	JSON_LIT(out, "\", \"pid\": \"");
+	json_int(out, (int)ev->pl_u.pl_e.pl_pid);
+	JSON_LIT(out, "\", \"value\": \"");
+	json_hex(out, ev->pl_u.pl_e.pl_value, 16);
+	JSON_LIT(out, "\"}\n");
 }
 
-static string
-procfork_to_json(struct pmclog_ev *ev)
+static void
+procfork_to_json(struct pmclog_ev *ev, string &out)
 {
-	char eventbuf[128];
-	string startent;
-
-	startent = startentry(ev);
-	snprintf(eventbuf, sizeof(eventbuf),
-		"%s, \"oldpid\": \"%d\", \"newpid\": \"%d\"}\n",
-		startent.c_str(), ev->pl_u.pl_f.pl_oldpid, ev->pl_u.pl_f.pl_newpid);
-	return string(eventbuf);
+
+	startentry(ev, out);
+	JSON_LIT(out, ", \"oldpid\": \"");
+	json_int(out, (int)ev->pl_u.pl_f.pl_oldpid);
+	JSON_LIT(out, "\", \"newpid\": \"");
+	json_int(out, (int)ev->pl_u.pl_f.pl_newpid);
+	JSON_LIT(out, "\"}\n");
 }
 
-static string
-sysexit_to_json(struct pmclog_ev *ev)
+static void
+sysexit_to_json(struct pmclog_ev *ev, string &out)
 {
-	char eventbuf[128];
-	string startent;
 
-	startent = startentry(ev);
-	snprintf(eventbuf, sizeof(eventbuf), "%s, \"pid\": \"%d\"}\n",
-		startent.c_str(), ev->pl_u.pl_se.pl_pid);
-	return string(eventbuf);
+	startentry(ev, out);
+	JSON_LIT(out, ", \"pid\": \"");
+	json_int(out, (int)ev->pl_u.pl_se.pl_pid);
+	JSON_LIT(out, "\"}\n");
 }
 
-static string
-userdata_to_json(struct pmclog_ev *ev)
+static void
+userdata_to_json(struct pmclog_ev *ev, string &out)
 {
-	char eventbuf[128];
-	string startent;
 
-	startent = startentry(ev);
-	snprintf(eventbuf, sizeof(eventbuf), "%s, \"userdata\": \"0x%08x\"}\n",
-	    startent.c_str(), ev->pl_u.pl_u.pl_userdata);
-	return string(eventbuf);
+	startentry(ev, out);
+	JSON_LIT(out, ", \"userdata\": \"");
+	json_hex(out, ev->pl_u.pl_u.pl_userdata, 8);
+	JSON_LIT(out, "\"}\n");
 }
 
-static string
-map_in_to_json(struct pmclog_ev *ev)
+static void
+map_in_to_json(struct pmclog_ev *ev, string &out)
 {
-	char eventbuf[2048];
-	string startent;
-
-	startent = startentry(ev);
-	snprintf(eventbuf, sizeof(eventbuf), "%s, \"pid\": \"%d\", "
-	    "\"start\": \"0x%016jx\", \"pathname\": \"%s\"}\n",
-	    startent.c_str(), ev->pl_u.pl_mi.pl_pid,
-	    (uintmax_t)ev->pl_u.pl_mi.pl_start, ev->pl_u.pl_mi.pl_pathname);
-	return string(eventbuf);
+
+	startentry(ev, out);
+	JSON_LIT(out, ", \"pid\": \"");
+	json_int(out, (int)ev->pl_u.pl_mi.pl_pid);
+	JSON_LIT(out, "\", \"start\": \"");
+	json_hex(out, ev->pl_u.pl_mi.pl_start, 16);
+	JSON_LIT(out, "\", \"pathname\": \"");
+	out += ev->pl_u.pl_mi.pl_pathname;
+	JSON_LIT(out, "\"}\n");
 }
 
-static string
-map_out_to_json(struct pmclog_ev *ev)
+static void
+map_out_to_json(struct pmclog_ev *ev, string &out)
 {
-	char eventbuf[256];
-	string startent;
-
-	startent = startentry(ev);
-	snprintf(eventbuf, sizeof(eventbuf), "%s, \"pid\": \"%d\", "
-	    "\"start\": \"0x%016jx\", \"end\": \"0x%016jx\"}\n",
-	    startent.c_str(), ev->pl_u.pl_mi.pl_pid,
-	    (uintmax_t)ev->pl_u.pl_mi.pl_start,
-	    (uintmax_t)ev->pl_u.pl_mo.pl_end);
-	return string(eventbuf);
+
+	startentry(ev, out);
+	JSON_LIT(out, ", \"pid\": \"");
+	json_int(out, (int)ev->pl_u.pl_mo.pl_pid);
+	JSON_LIT(out, "\", \"start\": \"");
+	json_hex(out, ev->pl_u.pl_mo.pl_start, 16);
+	JSON_LIT(out, "\", \"end\": \"");
+	json_hex(out, ev->pl_u.pl_mo.pl_end, 16);
+	JSON_LIT(out, "\"}\n");
 }
 
-static string
-callchain_to_json(struct pmclog_ev *ev)
+static void
+callchain_to_json(struct pmclog_ev *ev, string &out)
 {
-	char eventbuf[1024];
-	string result;
 	uint32_t i;
-	string startent;
-
-	startent = startentry(ev);
-	snprintf(eventbuf, sizeof(eventbuf),
-	    "%s, \"pmcid\": \"0x%08x\", \"pid\": \"%d\", \"tid\": \"%d\", "
-	    "\"cpuflags\": \"0x%08x\", \"cpuflags2\": \"0x%08x\", \"pc\": [ ",
-		startent.c_str(), ev->pl_u.pl_cc.pl_pmcid, ev->pl_u.pl_cc.pl_pid,
-	    ev->pl_u.pl_cc.pl_tid, ev->pl_u.pl_cc.pl_cpuflags, ev->pl_u.pl_cc.pl_cpuflags2);
-	result = string(eventbuf);
-	for (i = 0; i < ev->pl_u.pl_cc.pl_npc - 1; i++) {
-		snprintf(eventbuf, sizeof(eventbuf), "\"0x%016jx\", ", (uintmax_t)ev->pl_u.pl_cc.pl_pc[i]);
-		result += string(eventbuf);
+
+	startentry(ev, out);
+	JSON_LIT(out, ", \"pmcid\": \"");
+	json_hex(out, ev->pl_u.pl_cc.pl_pmcid, 8);
+	JSON_LIT(out, "\", \"pid\": \"");
+	json_int(out, (int)ev->pl_u.pl_cc.pl_pid);
+	JSON_LIT(out, "\", \"tid\": \"");
+	json_int(out, (int)ev->pl_u.pl_cc.pl_tid);
+	JSON_LIT(out, "\", \"cpuflags\": \"");
+	json_hex(out, ev->pl_u.pl_cc.pl_cpuflags, 8);
+	JSON_LIT(out, "\", \"cpuflags2\": \"");
+	json_hex(out, ev->pl_u.pl_cc.pl_cpuflags2, 8);
+	JSON_LIT(out, "\", \"pc\": [ ");
+	for (i = 0; i + 1 < ev->pl_u.pl_cc.pl_npc; i++) {
+		JSON_LIT(out, "\"");
+		json_hex(out, ev->pl_u.pl_cc.pl_pc[i], 16);
+		JSON_LIT(out, "\", ");
 	}
-	snprintf(eventbuf, sizeof(eventbuf), "\"0x%016jx\"]}\n", (uintmax_t)ev->pl_u.pl_cc.pl_pc[i]);
-	result += string(eventbuf);
-	return (result);
+	JSON_LIT(out, "\"");
+	json_hex(out, ev->pl_u.pl_cc.pl_pc[i], 16);
+	JSON_LIT(out, "\"]}\n");
 }
 
-static string
-pmcallocatedyn_to_json(struct pmclog_ev *ev)
+static void
+pmcallocatedyn_to_json(struct pmclog_ev *ev, string &out)
 {
-	char eventbuf[2048];
-	string startent;
-
-	startent = startentry(ev);
-	snprintf(eventbuf, sizeof(eventbuf),
-	    "%s, \"pmcid\": \"0x%08x\", \"event\": \"%d\", \"flags\": \"0x%08x\", \"evname\": \"%s\"}\n",
-	    startent.c_str(), ev->pl_u.pl_ad.pl_pmcid, ev->pl_u.pl_ad.pl_event,
-	    ev->pl_u.pl_ad.pl_flags, ev->pl_u.pl_ad.pl_evname);
-	return string(eventbuf);
+
+	startentry(ev, out);
+	JSON_LIT(out, ", \"pmcid\": \"");
+	json_hex(out, ev->pl_u.pl_ad.pl_pmcid, 8);
+	JSON_LIT(out, "\", \"event\": \"");
+	json_int(out, (int)ev->pl_u.pl_ad.pl_event);
+	JSON_LIT(out, "\", \"flags\": \"");
+	json_hex(out, ev->pl_u.pl_ad.pl_flags, 8);
+	JSON_LIT(out, "\", \"evname\": \"");
+	out += ev->pl_u.pl_ad.pl_evname;
+	JSON_LIT(out, "\"}\n");
 }
 
-static string
-proccreate_to_json(struct pmclog_ev *ev)
+static void
+proccreate_to_json(struct pmclog_ev *ev, string &out)
 {
-	char eventbuf[2048];
-	string startent;
-
-	startent = startentry(ev);
-	snprintf(eventbuf, sizeof(eventbuf),
-	    "%s, \"pid\": \"%d\", \"flags\": \"0x%08x\", \"pcomm\": \"%s\"}\n",
-	    startent.c_str(), ev->pl_u.pl_pc.pl_pid,
-	    ev->pl_u.pl_pc.pl_flags, ev->pl_u.pl_pc.pl_pcomm);
-	return string(eventbuf);
+
+	startentry(ev, out);
+	JSON_LIT(out, ", \"pid\": \"");
+	json_int(out, (int)ev->pl_u.pl_pc.pl_pid);
+	JSON_LIT(out, "\", \"flags\": \"");
+	json_hex(out, ev->pl_u.pl_pc.pl_flags, 8);
+	JSON_LIT(out, "\", \"pcomm\": \"");
+	out += ev->pl_u.pl_pc.pl_pcomm;
+	JSON_LIT(out, "\"}\n");
 }
 
-static string
-threadcreate_to_json(struct pmclog_ev *ev)
+static void
+threadcreate_to_json(struct pmclog_ev *ev, string &out)
 {
-	char eventbuf[2048];
-	string startent;
-
-	startent = startentry(ev);
-	snprintf(eventbuf, sizeof(eventbuf),
-	    "%s, \"tid\": \"%d\", \"pid\": \"%d\", \"flags\": \"0x%08x\", \"tdname\": \"%s\"}\n",
-	    startent.c_str(), ev->pl_u.pl_tc.pl_tid, ev->pl_u.pl_tc.pl_pid,
-	    ev->pl_u.pl_tc.pl_flags, ev->pl_u.pl_tc.pl_tdname);
-	return string(eventbuf);
+
+	startentry(ev, out);
+	JSON_LIT(out, ", \"tid\": \"");
+	json_int(out, (int)ev->pl_u.pl_tc.pl_tid);
+	JSON_LIT(out, "\", \"pid\": \"");
+	json_int(out, (int)ev->pl_u.pl_tc.pl_pid);
+	JSON_LIT(out, "\", \"flags\": \"");
+	json_hex(out, ev->pl_u.pl_tc.pl_flags, 8);
+	JSON_LIT(out, "\", \"tdname\": \"");
+	out += ev->pl_u.pl_tc.pl_tdname;
+	JSON_LIT(out, "\"}\n");
 }
 
-static string
-threadexit_to_json(struct pmclog_ev *ev)
+static void
+threadexit_to_json(struct pmclog_ev *ev, string &out)
 {
-	char eventbuf[256];
-	string startent;
 
-	startent = startentry(ev);
-	snprintf(eventbuf, sizeof(eventbuf), "%s, \"tid\": \"%d\"}\n",
-	    startent.c_str(), ev->pl_u.pl_te.pl_tid);
-	return string(eventbuf);
+	startentry(ev, out);
+	JSON_LIT(out, ", \"tid\": \"");
+	json_int(out, (int)ev->pl_u.pl_te.pl_tid);
+	JSON_LIT(out, "\"}\n");
 }
 
-static string
-stub_to_json(struct pmclog_ev *ev)
+static void
+stub_to_json(struct pmclog_ev *ev, string &out)
 {
-	string startent;
 
-	startent = startentry(ev);
-	startent += string("}\n");
-	return startent;
+	startentry(ev, out);
+	JSON_LIT(out, "}\n");
 }
 
-typedef string (*jconv) (struct pmclog_ev*);
+typedef void (*jconv) (struct pmclog_ev*, string &);
 
 static jconv jsonconvert[] = {
 	NULL,
@@ -362,8 +405,13 @@ static jconv jsonconvert[] = {
 	proccreate_to_json,
 };
 
-string
-event_to_json(struct pmclog_ev *ev){
+/*
+ * Append the JSON form of an event to `out'.  Callers converting many
+ * events should reuse `out' to avoid an allocation per event.
+ */
+void
+event_to_json(struct pmclog_ev *ev, string &out)
+{
 
 	switch (ev->pl_type) {
 	case PMCLOG_TYPE_DROPNOTIFY:
@@ -385,9 +433,59 @@ event_to_json(struct pmclog_ev *ev){
 	case PMCLOG_TYPE_THR_CREATE:
 	case PMCLOG_TYPE_THR_EXIT:
 	case PMCLOG_TYPE_PROC_CREATE:
-		return jsonconvert[ev->pl_type](ev);
+		jsonconvert[ev->pl_type](ev, out);
+		break;
 	default:
 		errx(EX_USAGE, "ERROR: unrecognized event type: %d\n", ev->pl_type);
 	}
 }
 
+string
+event_to_json(struct pmclog_ev *ev)
+{
+	string result;
+
+	event_to_json(ev, result);
+	return (result);
+}
+
+/*
+ * Write out and empty a buffer filled by event_to_json().  Returns -1
+ * and sets errno if the write fails.
+ */
+int
+event_json_flush(int fd, string &buf)
+{
+	const char *p;
+	size_t resid;
+	ssize_t n;
+
+	p = buf.data();
+	resid = buf.size();
+	while (resid > 0) {
+		if ((n = write(fd, p, resid)) < 0) {
+			if (errno == EINTR)
+				continue;
+			return (-1);
+		}
+		p += n;
+		resid -= n;
+	}
+	buf.clear();
+	return (0);
+}
+
+/*
+ * Append the JSON form of an event to `buf', writing the buffer out to
+ * `fd' whenever it fills past PMC_JSON_FLUSH_SIZE.  The caller flushes
+ * what remains with event_json_flush() once done.
+ */
+int
+event_to_json_fd(int fd, struct pmclog_ev *ev, string &buf)
+{
+
+	event_to_json(ev, buf);
+	if (buf.size() >= PMC_JSON_FLUSH_SIZE)
+		return (event_json_flush(fd, buf));
+	return (0);
+}
@@ -583,11 +583,33 @@ pmc_pmu_event_get_by_idx(const char *c __unused, int idx __unused)
 	return (NULL);
 }
 
+#if defined(__riscv)
+/*
+ * There are no PMU event tables for RISC-V, pmc stat uses the generic
+ * SBI PMU events known to libpmc instead.
+ */
+static const char *stat_mode_cntrs[] = {
+	"CPU_CYCLES",
+	"INSTRUCTIONS",
+	"BRANCH_INSTRUCTIONS",
+	"BRANCH_MISSES",
+	"CACHE_REFERENCES",
+	"CACHE_MISSES",
+};
+
+int
+pmc_pmu_stat_mode(const char ***cntrs)
+{
+	*cntrs = stat_mode_cntrs;
+	return (0);
+}
+#else
 int
 pmc_pmu_stat_mode(const char ***a __unused)
 {
 	return (EOPNOTSUPP);
 }
+#endif
 
 int
 pmc_pmu_idx_get_by_event(const char *c __unused, const char *e __unused)
@@ -79,6 +79,7 @@ int	pmc_allocate(const char *_ctrspec, enum pmc_mode _mode, uint32_t _flags,
 int	pmc_attach(pmc_id_t _pmcid, pid_t _pid);
 int	pmc_capabilities(pmc_id_t _pmc, uint32_t *_caps);
 int	pmc_configure_logfile(int _fd);
+int	pmc_configure_logring(int _fd);
 int	pmc_flush_logfile(void);
 int	pmc_close_logfile(void);
 int	pmc_detach(pmc_id_t _pmcid, pid_t _pid);
@@ -29,5 +29,10 @@
  */
 #ifndef __PMCFORMAT_H_
 #define __PMCFORMAT_H_
+#define	PMC_JSON_FLUSH_SIZE	(64 * 1024)
+
 std::string event_to_json(struct pmclog_ev *ev);
+void event_to_json(struct pmclog_ev *ev, std::string &out);
+int event_to_json_fd(int fd, struct pmclog_ev *ev, std::string &buf);
+int event_json_flush(int fd, std::string &buf);
 #endif
@@ -34,11 +34,13 @@
 __FBSDID("$FreeBSD$");
 
 #include <sys/param.h>
+#include <sys/mman.h>
 #include <sys/pmc.h>
 #include <sys/pmclog.h>
 
 #include <assert.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <pmc.h>
 #include <pmclog.h>
 #include <stddef.h>
@@ -48,6 +50,7 @@ __FBSDID("$FreeBSD$");
 #include <unistd.h>
 #include <stdio.h>
 
+#include <machine/atomic.h>
 #include <machine/pmc_mdep.h>
 
 #include "libpmcinternal.h"
@@ -454,6 +457,59 @@ pmclog_get_event(void *cookie, char **data, ssize_t *len,
  * a parse error was encountered.
  */
 
+/*
+ * Copy the complete records waiting in the shared memory rings to the
+ * scratch buffer and hand the space back to the kernel.  Rings are
+ * drained one CPU after another, the records of each CPU stay in
+ * order.
+ */
+
+static ssize_t
+pmclog_ring_drain(struct pmclog_parse_state *ps)
+{
+	struct pmclog_ring_header *prh;
+	struct pmclog_ring_control *prc;
+	uint32_t h, head, len, mask, off, tail;
+	size_t room;
+	char *data, *dst;
+	u_int cpu;
+
+	prh = ps->ps_ring;
+	mask = prh->prh_size - 1;
+	dst = ps->ps_buffer;
+	room = PMCLOG_BUFFER_SIZE;
+	for (cpu = 0; cpu < prh->prh_ncpu; cpu++) {
+		prc = PMCLOG_RING_CONTROL(prh, cpu);
+		data = PMCLOG_RING_DATA(prh, cpu);
+		head = atomic_load_acq_32(&prc->prc_head);
+		tail = prc->prc_tail;
+		while (tail != head) {
+			off = tail & mask;
+			memcpy(&h, data + off, sizeof(h));
+			if (h == 0) {		/* wrap marker */
+				tail += prh->prh_size - off;
+				continue;
+			}
+			len = PMCLOG_HEADER_TO_LENGTH(h);
+			if (len < sizeof(h) || off + len > prh->prh_size ||
+			    len > head - tail) {
+				errno = EINVAL;
+				return (-1);
+			}
+			if (len > room)
+				break;
+			memcpy(dst, data + off, len);
+			dst += len;
+			room -= len;
+			tail += len;
+		}
+		atomic_store_rel_32(&prc->prc_tail, tail);
+		if (tail != head)
+			break;
+	}
+	return (dst - ps->ps_buffer);
+}
+
 int
 pmclog_read(void *cookie, struct pmclog_ev *ev)
 {
@@ -481,10 +537,17 @@ pmclog_read(void *cookie, struct pmclog_ev *ev)
 		 * (which may be EAGAIN or other recoverable error), or
 		 * can return EOF.
 		 */
-		if (ps->ps_fd != PMCLOG_FD_NONE) {
+		if (ps->ps_fd != PMCLOG_FD_NONE || ps->ps_ring != NULL) {
 		refill:
-			nread = read(ps->ps_fd, ps->ps_buffer,
-			    PMCLOG_BUFFER_SIZE);
+			if (ps->ps_ring != NULL) {
+				/* An empty ring just needs more data. */
+				if ((nread = pmclog_ring_drain(ps)) < 0)
+					ev->pl_state = PMCLOG_ERROR;
+				if (nread <= 0)
+					return -1;
+			} else
+				nread = read(ps->ps_fd, ps->ps_buffer,
+				    PMCLOG_BUFFER_SIZE);
 
 			if (nread <= 0) {
 				if (nread == 0)
@@ -511,7 +574,7 @@ pmclog_read(void *cookie, struct pmclog_ev *ev)
 	 * from it.
 	 */
 	if (retval < 0 && ev->pl_state == PMCLOG_REQUIRE_DATA &&
-	    ps->ps_fd != -1) {
+	    (ps->ps_fd != -1 || ps->ps_ring != NULL)) {
 		assert(ps->ps_len == 0);
 		goto refill;
 	}
@@ -568,6 +631,9 @@ pmclog_open(int fd)
 	ps->ps_data  = NULL;
 	ps->ps_buffer = NULL;
 	ps->ps_len   = 0;
+	ps->ps_ring  = NULL;
+	ps->ps_ringlen = 0;
+	ps->ps_ringfd = -1;
 
 	/* allocate space for a work area */
 	if (ps->ps_fd != PMCLOG_FD_NONE) {
@@ -580,6 +646,61 @@ pmclog_open(int fd)
 	return ps;
 }
 
+/*
+ * Allocate a parser reading from shared memory log rings of
+ * 'ringsize' bytes per CPU, and point hwpmc(4) at them.  The rings
+ * take the place of a log file for this process.
+ */
+
+void *
+pmclog_open_ring(size_t ringsize)
+{
+	struct pmclog_parse_state *ps;
+	size_t len, pagesize;
+	void *base;
+	int fd, ncpu, saved_errno;
+
+	if ((ncpu = pmc_ncpu()) < 0)
+		return NULL;
+	pagesize = getpagesize();
+	if (ringsize < 64*1024)
+		ringsize = 64*1024;
+	ringsize = 1UL << flsl(ringsize - 1);
+	len = pagesize + ncpu * (pagesize + ringsize);
+
+	if ((ps = pmclog_open(PMCLOG_FD_NONE)) == NULL)
+		return NULL;
+	base = MAP_FAILED;
+	if ((ps->ps_buffer = malloc(PMCLOG_BUFFER_SIZE)) == NULL ||
+	    (fd = shm_open(SHM_ANON, O_RDWR, 0600)) < 0)
+		goto error;
+	ps->ps_ringfd = fd;
+	if (ftruncate(fd, len) < 0 ||
+	    (base = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED,
+	    fd, 0)) == MAP_FAILED ||
+	    pmc_configure_logring(fd) < 0)
+		goto error;
+
+	ps->ps_ring = base;
+	ps->ps_ringlen = len;
+	if (ps->ps_ring->prh_magic != PMCLOG_RING_MAGIC ||
+	    ps->ps_ring->prh_version != PMCLOG_RING_VERSION) {
+		(void) pmc_configure_logfile(-1);
+		errno = EPROGMISMATCH;
+		goto error;
+	}
+	return ps;
+
+ error:
+	saved_errno = errno;
+	if (base != MAP_FAILED)
+		(void) munmap(base, len);
+	ps->ps_ring = NULL;
+	pmclog_close(ps);
+	errno = saved_errno;
+	return NULL;
+}
+
 
 /*
  * Free up parser state.
@@ -594,6 +715,10 @@ pmclog_close(void *cookie)
 
 	if (ps->ps_buffer)
 		free(ps->ps_buffer);
+	if (ps->ps_ring != NULL)
+		(void) munmap(ps->ps_ring, ps->ps_ringlen);
+	if (ps->ps_ringfd != -1)
+		(void) close(ps->ps_ringfd);
 
 	free(ps);
 }
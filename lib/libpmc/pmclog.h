@@ -218,12 +218,16 @@ struct pmclog_parse_state {
 	char			*ps_data;	/* current parse pointer */
 	char			*ps_cpuid;	/* log cpuid */
 	size_t			ps_len;		/* length of buffered data */
+	struct pmclog_ring_header *ps_ring;	/* mapped log rings or NULL */
+	size_t			ps_ringlen;	/* length of the mapping */
+	int			ps_ringfd;	/* shared memory object */
 };
 
 #define	PMCLOG_FD_NONE				(-1)
 
 __BEGIN_DECLS
 void	*pmclog_open(int _fd);
+void	*pmclog_open_ring(size_t _ringsize);
 int	pmclog_feed(void *_cookie, char *_data, int _len);
 int	pmclog_read(void *_cookie, struct pmclog_ev *_ev);
 void	pmclog_close(void *_cookie);
@@ -192,6 +192,16 @@ struct pmcstat_image {
 	struct pmcstat_symbol *pi_symbols;
 	size_t		pi_symcount;
 
+	/*
+	 * Search index over pi_symbols, built on the first lookup: the
+	 * symbol start addresses in Eytzinger (BFS) order along with
+	 * their position in pi_symbols, and a small direct-mapped cache
+	 * of recent lookups.
+	 */
+	uint64_t	*pi_symtree;
+	uint32_t	*pi_symtreeidx;
+	struct pmcstat_symcache *pi_symcache;
+
 	/* Handle to addr2line for this image. */
 	FILE *pi_addr2line;
 
@@ -298,6 +308,9 @@ struct pmc_plugins {
 
 	/* top keypress */
 	int (*pl_topkeypress)(int c, void *w);
+
+	/* periodic output */
+	void (*pl_interval)(void);
 };
 
 /*
@@ -320,6 +333,7 @@ __BEGIN_DECLS
 int pmcstat_symbol_compare(const void *a, const void *b);
 struct pmcstat_symbol *pmcstat_symbol_search(struct pmcstat_image *image,
     uintfptr_t addr);
+void pmcstat_symbol_index_free(struct pmcstat_image *image);
 void pmcstat_image_add_symbols(struct pmcstat_image *image, Elf *e,
     Elf_Scn *scn, GElf_Shdr *sh);
 
@@ -91,6 +91,7 @@ pmcstat_image_add_symbols(struct pmcstat_image *image, Elf *e,
 	 * Allocate space for the new entries.
 	 */
 	firsttime = image->pi_symbols == NULL;
+	pmcstat_symbol_index_free(image);
 	symptr = reallocarray(image->pi_symbols,
 	    image->pi_symcount + nfuncsyms, sizeof(*symptr));
 	if (symptr == image->pi_symbols) /* realloc() failed. */
@@ -150,6 +151,7 @@ pmcstat_image_add_symbols(struct pmcstat_image *image, Elf *e,
 	/*
 	 * Keep the list of symbols sorted.
 	 */
+	pmcstat_symbol_index_free(image);
 	qsort(image->pi_symbols, image->pi_symcount, sizeof(*symptr),
 	    pmcstat_symbol_compare);
 
@@ -504,6 +506,9 @@ pmcstat_image_from_path(pmcstat_interned_string internedpath,
 	pi->pi_dynlinkerpath = NULL;
 	pi->pi_symbols = NULL;
 	pi->pi_symcount = 0;
+	pi->pi_symtree = NULL;
+	pi->pi_symtreeidx = NULL;
+	pi->pi_symcache = NULL;
 	pi->pi_addr2line = NULL;
 
 	if (plugins[args->pa_pplugin].pl_initimage != NULL)
@@ -636,6 +636,7 @@ pmcstat_shutdown_logging(struct pmcstat_args *args,
 			if (plugins[args->pa_pplugin].pl_shutdownimage != NULL)
 				plugins[args->pa_pplugin].pl_shutdownimage(pi);
 
+			pmcstat_symbol_index_free(pi);
 			free(pi->pi_symbols);
 			if (pi->pi_addr2line != NULL)
 				pclose(pi->pi_addr2line);
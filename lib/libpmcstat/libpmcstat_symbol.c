@@ -50,6 +50,7 @@ __FBSDID("$FreeBSD$");
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 
 #include "libpmcstat.h"
 
@@ -126,6 +127,77 @@ pmcstat_symbol_compare(const void *a, const void *b)
 	return (0);
 }
 
+/*
+ * Symbol lookups are made for every frame of every callchain, and the
+ * same few thousand PCs recur constantly, so they go through a small
+ * direct-mapped cache in front of the search tree.
+ */
+#define	PMCSTAT_SYMCACHE_SIZE	1024	/* power of two */
+
+struct pmcstat_symcache {
+	uintfptr_t	sc_addr;
+	struct pmcstat_symbol *sc_sym;
+};
+
+void
+pmcstat_symbol_index_free(struct pmcstat_image *image)
+{
+
+	free(image->pi_symtree);
+	free(image->pi_symtreeidx);
+	free(image->pi_symcache);
+	image->pi_symtree = NULL;
+	image->pi_symtreeidx = NULL;
+	image->pi_symcache = NULL;
+}
+
+/*
+ * Fill the subtree rooted at node 'k' with the sorted symbols from
+ * index 'i' on, returning the index of the first symbol left over.
+ */
+static size_t
+pmcstat_symbol_index_fill(struct pmcstat_image *image, size_t i, size_t k)
+{
+
+	if (k <= image->pi_symcount) {
+		i = pmcstat_symbol_index_fill(image, i, 2 * k);
+		image->pi_symtree[k] = image->pi_symbols[i].ps_start;
+		image->pi_symtreeidx[k] = i++;
+		i = pmcstat_symbol_index_fill(image, i, 2 * k + 1);
+	}
+	return (i);
+}
+
+/*
+ * Lay the symbol start addresses out in Eytzinger order, so that the
+ * first levels of every search share a few cache lines and the lines a
+ * search will need next can be prefetched.
+ */
+static int
+pmcstat_symbol_index_build(struct pmcstat_image *image)
+{
+	size_t i, n;
+
+	n = image->pi_symcount;
+	if (n >= UINT32_MAX)
+		return (-1);
+	image->pi_symtree = malloc((n + 1) * sizeof(*image->pi_symtree));
+	image->pi_symtreeidx = malloc((n + 1) * sizeof(*image->pi_symtreeidx));
+	image->pi_symcache = malloc(PMCSTAT_SYMCACHE_SIZE *
+	    sizeof(*image->pi_symcache));
+	if (image->pi_symtree == NULL || image->pi_symtreeidx == NULL ||
+	    image->pi_symcache == NULL) {
+		pmcstat_symbol_index_free(image);
+		return (-1);
+	}
+	(void)pmcstat_symbol_index_fill(image, 0, 1);
+	for (i = 0; i < PMCSTAT_SYMCACHE_SIZE; i++) {
+		image->pi_symcache[i].sc_addr = ~(uintfptr_t)0;
+		image->pi_symcache[i].sc_sym = NULL;
+	}
+	return (0);
+}
+
 /*
  * Map an address to a symbol in an image.
  */
@@ -133,16 +205,50 @@ pmcstat_symbol_compare(const void *a, const void *b)
 struct pmcstat_symbol *
 pmcstat_symbol_search(struct pmcstat_image *image, uintfptr_t addr)
 {
-	struct pmcstat_symbol sym;
+	struct pmcstat_symbol sym, *symp;
+	struct pmcstat_symcache *sc;
+	const uint64_t *tree;
+	size_t i, k, n;
 
 	if (image->pi_symbols == NULL)
 		return (NULL);
 
-	sym.ps_name  = NULL;
-	sym.ps_start = addr;
-	sym.ps_end   = addr + 1;
+	if (image->pi_symcache == NULL &&
+	    pmcstat_symbol_index_build(image) != 0) {
+		sym.ps_name  = NULL;
+		sym.ps_start = addr;
+		sym.ps_end   = addr + 1;
 
-	return (bsearch((void *) &sym, image->pi_symbols,
-	    image->pi_symcount, sizeof(struct pmcstat_symbol),
-	    pmcstat_symbol_compare));
+		return (bsearch((void *) &sym, image->pi_symbols,
+		    image->pi_symcount, sizeof(struct pmcstat_symbol),
+		    pmcstat_symbol_compare));
+	}
+
+	sc = &image->pi_symcache[(addr ^ (addr >> 10)) &
+	    (PMCSTAT_SYMCACHE_SIZE - 1)];
+	if (sc->sc_addr == addr)
+		return (sc->sc_sym);
+
+	/*
+	 * Descend to the first symbol that starts above 'addr'; the one
+	 * sorted before it is the only candidate.  The path taken is
+	 * encoded in 'k', and shifting off the trailing right turns and
+	 * the last left turn yields the node where the search ended.
+	 */
+	tree = image->pi_symtree;
+	n = image->pi_symcount;
+	k = 1;
+	while (k <= n) {
+		__builtin_prefetch(&tree[16 * k]);
+		k = 2 * k + (tree[k] <= addr);
+	}
+	k >>= ffsl(~k);
+	i = k == 0 ? n : image->pi_symtreeidx[k];
+
+	symp = NULL;
+	if (i > 0 && addr < image->pi_symbols[i - 1].ps_end)
+		symp = &image->pi_symbols[i - 1];
+	sc->sc_addr = addr;
+	sc->sc_sym = symp;
+	return (symp);
 }
@@ -450,6 +450,7 @@ init_private(void)
 	_thr_umutex_init(&_suspend_all_lock);
 	_thr_spinlock_init();
 	_thr_list_init();
+	_thr_stack_init();
 	_thr_wake_addr_init();
 	_sleepq_init();
 	_single_thread = NULL;
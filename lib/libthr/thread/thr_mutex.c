@@ -61,6 +61,12 @@ _Static_assert(sizeof(struct pthread_mutex) <= PAGE_SIZE,
  * before entering the kernel to block
  */
 #define MUTEX_ADAPTIVE_SPINS	2000
+/*
+ * An adaptive mutex spins for at most twice the running average of the
+ * spins it took to acquire it before, plus this much, and never more than
+ * m_spinloops.
+ */
+#define	MUTEX_SPIN_SLACK	16
 
 /*
  * Prototypes
@@ -244,6 +250,7 @@ mutex_init_body(struct pthread_mutex *pmutex,
 	pmutex->m_count = 0;
 	pmutex->m_spinloops = 0;
 	pmutex->m_yieldloops = 0;
+	pmutex->m_spinavg = 0;
 	mutex_init_link(pmutex);
 	switch (attr->m_protocol) {
 	case PTHREAD_PRIO_NONE:
@@ -642,7 +649,7 @@ mutex_lock_sleep(struct pthread *curthread, struct pthread_mutex *m,
     const struct timespec *abstime)
 {
 	uint32_t id, owner;
-	int count, ret;
+	int count, limit, ret;
 
 	id = TID(curthread);
 	if (PMUTEX_OWNER_ID(m) == id)
@@ -661,18 +668,31 @@ mutex_lock_sleep(struct pthread *curthread, struct pthread_mutex *m,
 	if (!_thr_is_smp)
 		goto yield_loop;
 
-	count = m->m_spinloops;
-	while (count--) {
+	/*
+	 * Spin only about as long as it has taken to get this mutex
+	 * recently, so that short critical sections are waited out while
+	 * long ones quickly stop burning CPU.  Spins that fail make the
+	 * next ones shorter.  Once in the kernel, the waiter spins again
+	 * only while the owner is running on a CPU.  m_spinavg is updated
+	 * without synchronization as it is only a hint.
+	 */
+	limit = m->m_spinavg * 2 + MUTEX_SPIN_SLACK;
+	if (limit > m->m_spinloops)
+		limit = m->m_spinloops;
+	for (count = 0; count < limit; count++) {
 		owner = m->m_lock.m_owner;
 		if ((owner & ~UMUTEX_CONTESTED) == 0) {
 			if (atomic_cmpset_acq_32(&m->m_lock.m_owner, owner,
 			    id | owner)) {
+				m->m_spinavg += (count - m->m_spinavg) / 8;
 				ret = 0;
 				goto done;
 			}
 		}
 		CPU_SPINWAIT;
 	}
+	if (limit > 0)
+		m->m_spinavg -= m->m_spinavg / 8;
 
 yield_loop:
 	count = m->m_yieldloops;
@@ -121,6 +121,13 @@ static LIST_HEAD(, stack)	mstackq = LIST_HEAD_INITIALIZER(mstackq);
  */
 static char *last_stack = NULL;
 
+/*
+ * Protects the spare stack queues and last_stack.  It is separate from
+ * the thread list lock so that pthread_create() and the garbage collector
+ * do not have to take that lock for writing just to move a stack around.
+ */
+static struct umutex	stack_lock = DEFAULT_UMUTEX;
+
 /*
  * Round size up to the nearest multiple of
  * _thr_page_size.
@@ -134,6 +141,13 @@ round_up(size_t size)
 	return size;
 }
 
+void
+_thr_stack_init(void)
+{
+
+	_thr_umutex_init(&stack_lock);
+}
+
 void
 _thr_stack_fix_protection(struct pthread *thrd)
 {
@@ -176,12 +190,14 @@ __thr_map_stacks_exec(void)
 	}
 	curthread = _get_curthread();
 	THREAD_LIST_RDLOCK(curthread);
+	THR_LOCK_ACQUIRE(curthread, &stack_lock);
 	LIST_FOREACH(st, &mstackq, qe)
 		mprotect((char *)st->stackaddr + st->guardsize, st->stacksize,
 		    _rtld_get_stack_prot());
 	LIST_FOREACH(st, &dstackq, qe)
 		mprotect((char *)st->stackaddr + st->guardsize, st->stacksize,
 		    _rtld_get_stack_prot());
+	THR_LOCK_RELEASE(curthread, &stack_lock);
 	TAILQ_FOREACH(thrd, &_thread_gc_list, gcle)
 		_thr_stack_fix_protection(thrd);
 	TAILQ_FOREACH(thrd, &_thread_list, tle)
@@ -212,10 +228,10 @@ _thr_stack_alloc(struct pthread_attr *attr)
 	attr->flags &= ~THR_STACK_USER;
 
 	/*
-	 * Use the garbage collector lock for synchronization of the
-	 * spare stack lists and allocations from usrstack.
+	 * Use the stack lock for synchronization of the spare stack
+	 * lists and allocations from usrstack.
 	 */
-	THREAD_LIST_WRLOCK(curthread);
+	THR_LOCK_ACQUIRE(curthread, &stack_lock);
 	/*
 	 * If the stack and guard sizes are default, try to allocate a stack
 	 * from the default-size stack cache:
@@ -245,7 +261,7 @@ _thr_stack_alloc(struct pthread_attr *attr)
 	}
 	if (attr->stackaddr_attr != NULL) {
 		/* A cached stack was found.  Release the lock. */
-		THREAD_LIST_UNLOCK(curthread);
+		THR_LOCK_RELEASE(curthread, &stack_lock);
 	}
 	else {
 		/*
@@ -269,7 +285,7 @@ _thr_stack_alloc(struct pthread_attr *attr)
 		last_stack -= (stacksize + guardsize);
 
 		/* Release the lock before mmap'ing it. */
-		THREAD_LIST_UNLOCK(curthread);
+		THR_LOCK_RELEASE(curthread, &stack_lock);
 
 		/* Map the stack and guard page together, and split guard
 		   page from allocated space: */
@@ -292,14 +308,15 @@ _thr_stack_alloc(struct pthread_attr *attr)
 		return (-1);
 }
 
-/* This function must be called with _thread_list_lock held. */
 void
 _thr_stack_free(struct pthread_attr *attr)
 {
+	struct pthread *curthread;
 	struct stack *spare_stack;
 
 	if ((attr != NULL) && ((attr->flags & THR_STACK_USER) == 0)
 	    && (attr->stackaddr_attr != NULL)) {
+		curthread = _get_curthread();
 		spare_stack = (struct stack *)
 			((char *)attr->stackaddr_attr +
 			attr->stacksize_attr - sizeof(struct stack));
@@ -307,6 +324,7 @@ _thr_stack_free(struct pthread_attr *attr)
 		spare_stack->guardsize = round_up(attr->guardsize_attr);
 		spare_stack->stackaddr = attr->stackaddr_attr;
 
+		THR_LOCK_ACQUIRE(curthread, &stack_lock);
 		if (spare_stack->stacksize == THR_STACK_DEFAULT &&
 		    spare_stack->guardsize == _thr_guard_default) {
 			/* Default stack/guard size. */
@@ -315,6 +333,7 @@ _thr_stack_free(struct pthread_attr *attr)
 			/* Non-default stack/guard size. */
 			LIST_INSERT_HEAD(&mstackq, spare_stack, qe);
 		}
+		THR_LOCK_RELEASE(curthread, &stack_lock);
 		attr->stackaddr_attr = NULL;
 	}
 }
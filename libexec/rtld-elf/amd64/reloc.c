@@ -162,6 +162,16 @@ reloc_non_plt(Obj_Entry *obj, Obj_Entry *obj_rtld, int flags,
 		case R_X86_64_DTPMOD64:
 		case R_X86_64_DTPOFF64:
 		case R_X86_64_DTPOFF32:
+			/*
+			 * TLS relocations were completed by the first
+			 * pass, which also rejected IFUNC definitions
+			 * for them.  Do not repeat the symbol lookup.
+			 */
+			if ((flags & SYMLOOK_IFUNC) != 0 &&
+			    ELF_R_TYPE(rela->r_info) != R_X86_64_64 &&
+			    ELF_R_TYPE(rela->r_info) != R_X86_64_PC32 &&
+			    ELF_R_TYPE(rela->r_info) != R_X86_64_GLOB_DAT)
+				continue;
 			def = find_symdef(ELF_R_SYM(rela->r_info), obj,
 			    &defobj, flags, cache, lockstate);
 			if (def == NULL)
@@ -156,6 +156,16 @@ reloc_non_plt(Obj_Entry *obj, Obj_Entry *obj_rtld, int flags,
 		case R_386_TLS_TPOFF32:
 		case R_386_TLS_DTPMOD32:
 		case R_386_TLS_DTPOFF32:
+			/*
+			 * TLS relocations were completed by the first
+			 * pass, which also rejected IFUNC definitions
+			 * for them.  Do not repeat the symbol lookup.
+			 */
+			if ((flags & SYMLOOK_IFUNC) != 0 &&
+			    ELF_R_TYPE(rel->r_info) != R_386_32 &&
+			    ELF_R_TYPE(rel->r_info) != R_386_PC32 &&
+			    ELF_R_TYPE(rel->r_info) != R_386_GLOB_DAT)
+				continue;
 			def = find_symdef(ELF_R_SYM(rel->r_info), obj, &defobj,
 			    flags, cache, lockstate);
 			if (def == NULL)
@@ -0,0 +1,521 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause-FreeBSD
+ *
+ * Copyright 1996, 1997, 1998, 1999 John D. Polstra.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $FreeBSD$
+ */
+
+/*
+ * Dynamic linker for ELF.
+ *
+ * John Polstra <jdp@polstra.com>.
+ */
+
+#include <sys/cdefs.h>
+__FBSDID("$FreeBSD$");
+
+#include <sys/types.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "debug.h"
+#include "rtld.h"
+
+/*
+ * It is possible for the compiler to emit relocations for unaligned data.
+ * We handle this situation with these inlines.
+ */
+#define	RELOC_ALIGNED_P(x) \
+	(((uintptr_t)(x) & (sizeof(void *) - 1)) == 0)
+
+static __inline void
+store_ptr(void *where, Elf_Addr val)
+{
+
+	memcpy(where, &val, sizeof(val));
+}
+
+void _rtld_bind_start(void);
+
+void
+init_pltgot(Obj_Entry *obj)
+{
+
+	/*
+	 * The first two .got.plt entries are reserved for the dynamic
+	 * linker: the PLT header loads the lazy binding trampoline from
+	 * GOT[0] and passes GOT[1] to it in t0.
+	 */
+	if (obj->pltgot != NULL) {
+		obj->pltgot[0] = (Elf_Addr)&_rtld_bind_start;
+		obj->pltgot[1] = (Elf_Addr)obj;
+	}
+}
+
+int
+do_copy_relocations(Obj_Entry *dstobj)
+{
+	const Obj_Entry *srcobj, *defobj;
+	const Elf_Rela *relalim;
+	const Elf_Rela *rela;
+	const Elf_Sym *srcsym;
+	const Elf_Sym *dstsym;
+	const void *srcaddr;
+	const char *name;
+	void *dstaddr;
+	SymLook req;
+	size_t size;
+	int res;
+
+	/*
+	 * COPY relocs are invalid outside of the main program
+	 */
+	assert(dstobj->mainprog);
+
+	relalim = (const Elf_Rela *)((caddr_t)dstobj->rela +
+	    dstobj->relasize);
+	for (rela = dstobj->rela; rela < relalim; rela++) {
+		if (ELF_R_TYPE(rela->r_info) != R_RISCV_COPY)
+			continue;
+
+		dstaddr = (void *)(dstobj->relocbase + rela->r_offset);
+		dstsym = dstobj->symtab + ELF_R_SYM(rela->r_info);
+		name = dstobj->strtab + dstsym->st_name;
+		size = dstsym->st_size;
+
+		symlook_init(&req, name);
+		req.ventry = fetch_ventry(dstobj, ELF_R_SYM(rela->r_info));
+		req.flags = SYMLOOK_EARLY;
+
+		for (srcobj = globallist_next(dstobj); srcobj != NULL;
+		     srcobj = globallist_next(srcobj)) {
+			res = symlook_obj(&req, srcobj);
+			if (res == 0) {
+				srcsym = req.sym_out;
+				defobj = req.defobj_out;
+				break;
+			}
+		}
+		if (srcobj == NULL) {
+			_rtld_error(
+"Undefined symbol \"%s\" referenced from COPY relocation in %s",
+			    name, dstobj->path);
+			return (-1);
+		}
+
+		srcaddr = (const void *)(defobj->relocbase + srcsym->st_value);
+		memcpy(dstaddr, srcaddr, size);
+	}
+
+	return (0);
+}
+
+/*
+ * Process the PLT relocations.
+ */
+int
+reloc_plt(Obj_Entry *obj)
+{
+	const Elf_Rela *relalim;
+	const Elf_Rela *rela;
+
+	relalim = (const Elf_Rela *)((char *)obj->pltrela + obj->pltrelasize);
+	for (rela = obj->pltrela; rela < relalim; rela++) {
+		Elf_Addr *where;
+
+		switch (ELF_R_TYPE(rela->r_info)) {
+		case R_RISCV_JUMP_SLOT:
+			/* Relocate the GOT slot pointing into the PLT. */
+			where = (Elf_Addr *)(obj->relocbase + rela->r_offset);
+			*where += (Elf_Addr)obj->relocbase;
+			break;
+		case R_RISCV_IRELATIVE:
+			obj->irelative = true;
+			break;
+		default:
+			_rtld_error("Unknown relocation type %u in PLT",
+			    (unsigned int)ELF_R_TYPE(rela->r_info));
+			return (-1);
+		}
+	}
+
+	return (0);
+}
+
+/*
+ * LD_BIND_NOW was set - force relocation for all jump slots
+ */
+int
+reloc_jmpslots(Obj_Entry *obj, int flags, RtldLockState *lockstate)
+{
+	const Obj_Entry *defobj;
+	const Elf_Rela *relalim;
+	const Elf_Rela *rela;
+	const Elf_Sym *def;
+	Elf_Addr *where;
+
+	if (obj->jmpslots_done)
+		return (0);
+
+	relalim = (const Elf_Rela *)((char *)obj->pltrela + obj->pltrelasize);
+	for (rela = obj->pltrela; rela < relalim; rela++) {
+		switch (ELF_R_TYPE(rela->r_info)) {
+		case R_RISCV_JUMP_SLOT:
+			def = find_symdef(ELF_R_SYM(rela->r_info), obj,
+			    &defobj, SYMLOOK_IN_PLT | flags, NULL, lockstate);
+			if (def == NULL) {
+				dbg("reloc_jmpslots: sym not found");
+				return (-1);
+			}
+			if (ELF_ST_TYPE(def->st_info) == STT_GNU_IFUNC) {
+				obj->gnu_ifunc = true;
+				continue;
+			}
+
+			where = (Elf_Addr *)(obj->relocbase + rela->r_offset);
+			*where = (Elf_Addr)(defobj->relocbase + def->st_value);
+			break;
+		case R_RISCV_IRELATIVE:
+			break;
+		default:
+			_rtld_error("Unknown relocation type %x in jmpslot",
+			    (unsigned int)ELF_R_TYPE(rela->r_info));
+			return (-1);
+		}
+	}
+
+	obj->jmpslots_done = true;
+
+	return (0);
+}
+
+int
+reloc_iresolve(Obj_Entry *obj, struct Struct_RtldLockState *lockstate)
+{
+	const Elf_Rela *relalim;
+	const Elf_Rela *rela;
+	Elf_Addr *where, target, *ptr;
+
+	if (!obj->irelative)
+		return (0);
+
+	relalim = (const Elf_Rela *)((char *)obj->pltrela + obj->pltrelasize);
+	for (rela = obj->pltrela; rela < relalim; rela++) {
+		if (ELF_R_TYPE(rela->r_info) != R_RISCV_IRELATIVE)
+			continue;
+		ptr = (Elf_Addr *)(obj->relocbase + rela->r_addend);
+		where = (Elf_Addr *)(obj->relocbase + rela->r_offset);
+		lock_release(rtld_bind_lock, lockstate);
+		target = call_ifunc_resolver(ptr);
+		wlock_acquire(rtld_bind_lock, lockstate);
+		*where = target;
+	}
+	obj->irelative = false;
+
+	return (0);
+}
+
+int
+reloc_gnu_ifunc(Obj_Entry *obj, int flags,
+    struct Struct_RtldLockState *lockstate)
+{
+	const Obj_Entry *defobj;
+	const Elf_Rela *relalim;
+	const Elf_Rela *rela;
+	const Elf_Sym *def;
+	Elf_Addr *where, target;
+
+	if (!obj->gnu_ifunc)
+		return (0);
+
+	relalim = (const Elf_Rela *)((char *)obj->pltrela + obj->pltrelasize);
+	for (rela = obj->pltrela; rela < relalim; rela++) {
+		if (ELF_R_TYPE(rela->r_info) != R_RISCV_JUMP_SLOT)
+			continue;
+		where = (Elf_Addr *)(obj->relocbase + rela->r_offset);
+		def = find_symdef(ELF_R_SYM(rela->r_info), obj, &defobj,
+		    SYMLOOK_IN_PLT | flags, NULL, lockstate);
+		if (def == NULL)
+			return (-1);
+		if (ELF_ST_TYPE(def->st_info) != STT_GNU_IFUNC)
+			continue;
+		lock_release(rtld_bind_lock, lockstate);
+		target = (Elf_Addr)rtld_resolve_ifunc(defobj, def);
+		wlock_acquire(rtld_bind_lock, lockstate);
+		reloc_jmpslot(where, target, defobj, obj,
+		    (const Elf_Rel *)rela);
+	}
+	obj->gnu_ifunc = false;
+
+	return (0);
+}
+
+Elf_Addr
+reloc_jmpslot(Elf_Addr *where, Elf_Addr target, const Obj_Entry *defobj,
+    const Obj_Entry *obj, const Elf_Rel *rel)
+{
+
+	assert(ELF_R_TYPE(rel->r_info) == R_RISCV_JUMP_SLOT);
+
+	if (*where != target && !ld_bind_not)
+		*where = target;
+	return (target);
+}
+
+/*
+ * Process non-PLT relocations
+ */
+int
+reloc_non_plt(Obj_Entry *obj, Obj_Entry *obj_rtld, int flags,
+    RtldLockState *lockstate)
+{
+	const Obj_Entry *defobj;
+	const Elf_Rela *relalim;
+	const Elf_Rela *rela;
+	const Elf_Sym *def;
+	SymCache *cache;
+	Elf_Addr *where;
+	unsigned long symnum;
+	int r;
+
+	/*
+	 * The dynamic loader may be called from a thread, we have
+	 * limited amounts of stack available so we cannot use alloca().
+	 */
+	if (obj != obj_rtld) {
+		cache = calloc(obj->dynsymcount, sizeof(SymCache));
+		/* No need to check for NULL here */
+	} else
+		cache = NULL;
+
+	r = -1;
+	relalim = (const Elf_Rela *)((caddr_t)obj->rela + obj->relasize);
+	rela = obj->rela;
+
+	/*
+	 * The static linker sorts R_RISCV_RELATIVE relocations to the
+	 * front of .rela.dyn and records their number in DT_RELACOUNT.
+	 * Apply that run without the per-relocation dispatch below; it
+	 * is usually the bulk of a PIE or shared object's relocations.
+	 */
+	if ((flags & SYMLOOK_IFUNC) == 0 && obj->relacount != 0 &&
+	    obj->relacount <= (unsigned long)(relalim - rela)) {
+		const Elf_Rela *rellim;
+
+		rellim = rela + obj->relacount;
+		for (; rela < rellim; rela++) {
+			assert(ELF_R_TYPE(rela->r_info) == R_RISCV_RELATIVE);
+			where = (Elf_Addr *)(obj->relocbase + rela->r_offset);
+			if (__predict_true(RELOC_ALIGNED_P(where)))
+				*where = (Elf_Addr)(obj->relocbase +
+				    rela->r_addend);
+			else
+				store_ptr(where, (Elf_Addr)(obj->relocbase +
+				    rela->r_addend));
+		}
+	}
+
+	for (; rela < relalim; rela++) {
+		where = (Elf_Addr *)(obj->relocbase + rela->r_offset);
+		symnum = ELF_R_SYM(rela->r_info);
+
+		/*
+		 * The second pass, made once every object is relocated,
+		 * only applies the R_RISCV_64 relocations against IFUNC
+		 * symbols that the first pass skipped.
+		 */
+		if ((flags & SYMLOOK_IFUNC) != 0 &&
+		    ELF_R_TYPE(rela->r_info) != R_RISCV_64)
+			continue;
+
+		switch (ELF_R_TYPE(rela->r_info)) {
+		case R_RISCV_NONE:
+			break;
+
+		case R_RISCV_JUMP_SLOT:
+			/*
+			 * These will be handled by the plt/jmpslot routines
+			 */
+			break;
+
+		case R_RISCV_64:
+			def = find_symdef(symnum, obj, &defobj, flags, cache,
+			    lockstate);
+			if (def == NULL)
+				goto done;
+
+			if (ELF_ST_TYPE(def->st_info) == STT_GNU_IFUNC) {
+				if ((flags & SYMLOOK_IFUNC) == 0) {
+					obj->non_plt_gnu_ifunc = true;
+					break;
+				}
+				*where = (Elf_Addr)rtld_resolve_ifunc(defobj,
+				    def) + rela->r_addend;
+				break;
+			}
+			if ((flags & SYMLOOK_IFUNC) != 0)
+				break;
+
+			*where = (Elf_Addr)(defobj->relocbase + def->st_value +
+			    rela->r_addend);
+			break;
+
+		case R_RISCV_RELATIVE:
+			if (__predict_true(RELOC_ALIGNED_P(where)))
+				*where = (Elf_Addr)(obj->relocbase +
+				    rela->r_addend);
+			else
+				store_ptr(where, (Elf_Addr)(obj->relocbase +
+				    rela->r_addend));
+			break;
+
+		case R_RISCV_COPY:
+			/*
+			 * These are deferred until all other relocations have
+			 * been done.  All we do here is make sure that the
+			 * COPY relocation is not in a shared library.  They
+			 * are allowed only in executable files.
+			 */
+			if (!obj->mainprog) {
+				_rtld_error("%s: Unexpected R_RISCV_COPY "
+				    "relocation in shared library", obj->path);
+				goto done;
+			}
+			break;
+
+		case R_RISCV_TLS_DTPMOD64:
+			def = find_symdef(symnum, obj, &defobj, flags, cache,
+			    lockstate);
+			if (def == NULL)
+				goto done;
+
+			*where = (Elf_Addr)defobj->tlsindex;
+			break;
+
+		case R_RISCV_TLS_DTPREL64:
+			def = find_symdef(symnum, obj, &defobj, flags, cache,
+			    lockstate);
+			if (def == NULL)
+				goto done;
+
+			*where = (Elf_Addr)(def->st_value + rela->r_addend -
+			    TLS_DTV_OFFSET);
+			break;
+
+		case R_RISCV_TLS_TPREL64:
+			def = find_symdef(symnum, obj, &defobj, flags, cache,
+			    lockstate);
+			if (def == NULL)
+				goto done;
+
+			/*
+			 * We lazily allocate offsets for static TLS as we
+			 * see the first relocation that references the
+			 * TLS block. This allows us to support (small
+			 * amounts of) static TLS in dynamically loaded
+			 * modules. If we run out of space, we generate an
+			 * error.
+			 */
+			if (!defobj->tls_done) {
+				if (!allocate_tls_offset((Obj_Entry*)defobj)) {
+					_rtld_error(
+					    "%s: No space available for static "
+					    "Thread Local Storage", obj->path);
+					goto done;
+				}
+			}
+
+			*where = (Elf_Addr)(def->st_value + rela->r_addend +
+			    defobj->tlsoffset - TLS_TP_OFFSET - TLS_TCB_SIZE);
+			break;
+
+		default:
+			_rtld_error("%s: Unsupported relocation type %ld "
+			    "in non-PLT relocations", obj->path,
+			    (long)ELF_R_TYPE(rela->r_info));
+			goto done;
+		}
+	}
+	r = 0;
+done:
+	free(cache);
+	return (r);
+}
+
+void
+ifunc_init(Elf_Auxinfo aux_info[__min_size(AT_COUNT)] __unused)
+{
+
+}
+
+void
+pre_init(void)
+{
+
+}
+
+void
+allocate_initial_tls(Obj_Entry *objs)
+{
+	Elf_Addr **tp;
+
+	/*
+	 * Fix the size of the static TLS block by using the maximum
+	 * offset allocated so far and adding a bit for dynamic modules to
+	 * use.
+	 */
+	tls_static_space = tls_last_offset + tls_last_size +
+	    RTLD_STATIC_TLS_EXTRA;
+
+	tp = (Elf_Addr **)((char *)allocate_tls(objs, NULL, TLS_TCB_SIZE, 16)
+	    + TLS_TP_OFFSET + TLS_TCB_SIZE);
+
+	__asm __volatile("mv tp, %0" :: "r"(tp));
+}
+
+void *
+__tls_get_addr(tls_index* ti)
+{
+	Elf_Addr **dtvp, *dtv;
+	char *_tp;
+
+	__asm __volatile("mv %0, tp" : "=r" (_tp));
+	dtvp = (Elf_Addr **)(_tp - TLS_TP_OFFSET - TLS_TCB_SIZE);
+
+	/*
+	 * Blocks in static TLS, or dynamic blocks this thread has already
+	 * allocated, are reached through the DTV directly.  Only the first
+	 * access to a new dynamic module's block takes the locked path.
+	 */
+	dtv = *dtvp;
+	if (__predict_true(dtv[0] == tls_dtv_generation &&
+	    dtv[ti->ti_module + 1] != 0))
+		return ((char *)dtv[ti->ti_module + 1] + ti->ti_offset +
+		    TLS_DTV_OFFSET);
+
+	return ((char *)tls_get_addr_common(dtvp, ti->ti_module,
+	    ti->ti_offset) + TLS_DTV_OFFSET);
+}
@@ -1028,6 +1028,10 @@ digest_dynamic1(Obj_Entry *obj, int early, const Elf_Dyn **dyn_rpath,
 	    assert(dynp->d_un.d_val == sizeof(Elf_Rela));
 	    break;
 
+	case DT_RELACOUNT:
+	    obj->relacount = dynp->d_un.d_val;
+	    break;
+
 	case DT_PLTREL:
 	    plttype = dynp->d_un.d_val;
 	    assert(dynp->d_un.d_val == DT_REL || plttype == DT_RELA);
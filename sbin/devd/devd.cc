@@ -25,7 +25,7 @@
  * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
  * SUCH DAMAGE.
  *
- * my_system is a variation on lib/libc/stdlib/system.c:
+ * spawn_action is a variation on lib/libc/stdlib/system.c:
  *
  * Copyright (c) 1988, 1993
  *	The Regents of the University of California.  All rights reserved.
@@ -68,9 +68,11 @@
 __FBSDID("$FreeBSD$");
 
 #include <sys/param.h>
+#include <sys/event.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/sysctl.h>
+#include <sys/time.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <sys/un.h>
@@ -94,7 +96,9 @@ __FBSDID("$FreeBSD$");
 #include <unistd.h>
 
 #include <algorithm>
+#include <deque>
 #include <map>
+#include <set>
 #include <string>
 #include <list>
 #include <stdexcept>
@@ -132,11 +136,28 @@ __FBSDID("$FreeBSD$");
  */
 #define CLIENT_BUFSIZE 262144
 
+/*
+ * Events that don't fit in a client's socket buffer are queued in devd, up
+ * to this many bytes per client, so that a subscriber that is briefly slow
+ * doesn't hold up event processing.  A client that falls further behind is
+ * dropped.
+ */
+#define CLIENT_QUEUE_MAX CLIENT_BUFSIZE
+
+/*
+ * Maximum number of events read from devctl before they are processed and
+ * the other descriptors are serviced again.
+ */
+#define DEVCTL_BATCH 64
+
 using namespace std;
 
 typedef struct client {
 	int fd;
 	int socktype;
+	std::deque<std::string> pending;	/* events not yet sent */
+	size_t pending_len;			/* bytes in pending */
+	size_t offset;		/* already sent of pending.front() */
 } client_t;
 
 extern FILE *yyin;
@@ -152,6 +173,35 @@ static int no_daemon = 0;
 static int daemonize_quick = 0;
 static int quiet_mode = 0;
 static unsigned total_events = 0;
+static uintmax_t rules_tested = 0;
+static uintmax_t rules_skipped = 0;
+static uintmax_t regexes_skipped = 0;
+static uintmax_t clients_dropped = 0;
+static int kq = -1;
+
+/*
+ * Actions run asynchronously, at most max_actions at a time.  Actions that
+ * share a key (the device, or the system/subsystem of a notify event) run
+ * one after another in the order their events arrived.
+ */
+struct pending_action {
+	std::string cmd;
+	std::string key;
+};
+
+struct running_action {
+	std::string cmd;
+	std::string key;
+	uintmax_t start;	/* microseconds, CLOCK_MONOTONIC */
+};
+
+static unsigned int max_actions = 4;
+static std::deque<pending_action> action_queue;
+static std::map<pid_t, running_action> running_actions;
+static std::set<std::string> busy_keys;
+static uintmax_t actions_run = 0;
+static uintmax_t actions_usec = 0;
+static uintmax_t actions_max_usec = 0;
 static volatile sig_atomic_t got_siginfo = 0;
 static volatile sig_atomic_t romeo_must_die = 0;
 
@@ -201,6 +251,17 @@ event_proc::matches(config &c) const
 	return (true);
 }
 
+bool
+event_proc::literal(const string &var, string &val) const
+{
+	vector<eps *>::const_iterator i;
+
+	for (i = _epsvec.begin(); i != _epsvec.end(); ++i)
+		if ((*i)->literal(var, val))
+			return (true);
+	return (false);
+}
+
 bool
 event_proc::run(config &c) const
 {
@@ -223,75 +284,184 @@ action::~action()
 	// nothing
 }
 
-static int
-my_system(const char *command)
+static uintmax_t
+uptime_usec(void)
 {
-	pid_t pid, savedpid;
-	int pstat;
-	struct sigaction ign, intact, quitact;
-	sigset_t newsigblock, oldsigblock;
+	struct timespec ts;
 
-	if (!command)		/* just checking... */
-		return (1);
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ((uintmax_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
+
+static pid_t
+spawn_action(const char *command)
+{
+	pid_t pid;
 
 	/*
-	 * Ignore SIGINT and SIGQUIT, block SIGCHLD. Remember to save
-	 * existing signal dispositions.
+	 * The child only closes descriptors and execs, so vfork(2) is safe
+	 * and saves copying devd's address space for every action.
 	 */
-	ign.sa_handler = SIG_IGN;
-	::sigemptyset(&ign.sa_mask);
-	ign.sa_flags = 0;
-	::sigaction(SIGINT, &ign, &intact);
-	::sigaction(SIGQUIT, &ign, &quitact);
-	::sigemptyset(&newsigblock);
-	::sigaddset(&newsigblock, SIGCHLD);
-	::sigprocmask(SIG_BLOCK, &newsigblock, &oldsigblock);
-	switch (pid = ::fork()) {
-	case -1:			/* error */
-		break;
-	case 0:				/* child */
-		/*
-		 * Restore original signal dispositions and exec the command.
-		 */
-		::sigaction(SIGINT, &intact, NULL);
-		::sigaction(SIGQUIT,  &quitact, NULL);
-		::sigprocmask(SIG_SETMASK, &oldsigblock, NULL);
+	pid = ::vfork();
+	if (pid == 0) {
 		/*
 		 * Close the PID file, and all other open descriptors.
 		 * Inherit std{in,out,err} only.
 		 */
-		cfg.close_pidfile();
 		::closefrom(3);
 		::execl(_PATH_BSHELL, "sh", "-c", command, (char *)NULL);
 		::_exit(127);
-	default:			/* parent */
-		savedpid = pid;
-		do {
-			pid = ::wait4(savedpid, &pstat, 0, (struct rusage *)0);
-		} while (pid == -1 && errno == EINTR);
-		break;
 	}
-	::sigaction(SIGINT, &intact, NULL);
-	::sigaction(SIGQUIT,  &quitact, NULL);
-	::sigprocmask(SIG_SETMASK, &oldsigblock, NULL);
-	return (pid == -1 ? -1 : pstat);
+	return (pid);
+}
+
+/*
+ * Start queued actions as long as there are free slots.  An action whose
+ * key is busy waits, and so does every later action with the same key.
+ */
+static void
+start_actions(void)
+{
+	deque<pending_action>::iterator i;
+	running_action ra;
+	pid_t pid;
+
+	for (i = action_queue.begin(); i != action_queue.end() &&
+	    running_actions.size() < max_actions; ) {
+		if (busy_keys.count(i->key) != 0) {
+			++i;
+			continue;
+		}
+		devdlog(LOG_INFO, "Executing '%s'\n", i->cmd.c_str());
+		ra.start = uptime_usec();
+		pid = spawn_action(i->cmd.c_str());
+		if (pid == -1) {
+			devdlog(LOG_ERR, "Cannot run '%s': %s\n",
+			    i->cmd.c_str(), strerror(errno));
+			i = action_queue.erase(i);
+			continue;
+		}
+		ra.cmd = i->cmd;
+		ra.key = i->key;
+		running_actions[pid] = ra;
+		busy_keys.insert(i->key);
+		i = action_queue.erase(i);
+	}
+}
+
+static void
+finish_action(pid_t pid, int status)
+{
+	map<pid_t, running_action>::iterator i;
+	uintmax_t usec;
+
+	i = running_actions.find(pid);
+	if (i == running_actions.end())
+		return;
+	usec = uptime_usec() - i->second.start;
+	actions_run++;
+	actions_usec += usec;
+	actions_max_usec = max(actions_max_usec, usec);
+	devdlog(LOG_DEBUG, "'%s' finished in %ju.%06jus, status %d\n",
+	    i->second.cmd.c_str(), usec / 1000000, usec % 1000000, status);
+	busy_keys.erase(i->second.key);
+	running_actions.erase(i);
+}
+
+/*
+ * Collect the actions that have exited and start the next ones.
+ */
+static void
+reap_actions(void)
+{
+	pid_t pid;
+	int status;
+
+	while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
+		finish_action(pid, status);
+	start_actions();
+}
+
+/*
+ * Run every queued action to completion.
+ */
+static void
+wait_actions(void)
+{
+	pid_t pid;
+	int status;
+
+	start_actions();
+	while (!running_actions.empty()) {
+		pid = waitpid(-1, &status, 0);
+		if (pid == -1) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		finish_action(pid, status);
+		start_actions();
+	}
 }
 
 bool
 action::do_action(config &c)
 {
-	string s = c.expand_string(_cmd.c_str());
-	devdlog(LOG_INFO, "Executing '%s'\n", s.c_str());
-	my_system(s.c_str());
+	pending_action pa;
+
+	pa.cmd = c.expand_string(_cmd.c_str());
+	pa.key = c.get_variable("device-name");
+	if (pa.key.empty() && !c.get_variable("system").empty())
+		pa.key = c.get_variable("system") + "/" +
+		    c.get_variable("subsystem");
+	action_queue.push_back(pa);
+	start_actions();
 	return (true);
 }
 
+static bool
+is_re_special(char c)
+{
+	return (strchr(".[]()*+?{}|^$\\", c) != NULL);
+}
+
+static string
+lowercase(const string &s)
+{
+	string l(s);
+	string::iterator i;
+
+	for (i = l.begin(); i != l.end(); ++i)
+		*i = tolower(*i);
+	return (l);
+}
+
 match::match(config &c, const char *var, const char *re) :
 	_inv(re[0] == '!'),
+	_literal(false),
 	_var(var),
 	_re(c.expand_string(_inv ? re + 1 : re, "^", "$"))
 {
+	string::size_type len;
+
 	regcomp(&_regex, _re.c_str(), REG_EXTENDED | REG_NOSUB | REG_ICASE);
+
+	/*
+	 * Find the literal text the expression starts with, so that values
+	 * which cannot match are rejected without running the regex.  If
+	 * that text is the whole expression, no regex is needed at all.
+	 * Alternation defeats both, and a trailing quantifier makes the
+	 * last literal character optional.
+	 */
+	if (_re.find('|') != string::npos)
+		return;
+	for (len = 1; len < _re.size() && !is_re_special(_re[len]); len++)
+		;
+	if (len == _re.size() - 1 && _re[len] == '$')
+		_literal = true;
+	else if (len > 1 && len < _re.size() && strchr("*?{", _re[len]) != NULL)
+		len--;
+	_prefix = _re.substr(1, len - 1);
 }
 
 match::~match()
@@ -316,13 +486,30 @@ match::do_match(config &c)
 		    _var.c_str(), value.c_str(), _re.c_str(), _inv);
 	}
 
-	retval = (regexec(&_regex, value.c_str(), 0, NULL, 0) == 0);
+	if (_literal) {
+		retval = (strcasecmp(value.c_str(), _prefix.c_str()) == 0);
+		regexes_skipped++;
+	} else if (strncasecmp(value.c_str(), _prefix.c_str(),
+	    _prefix.size()) != 0) {
+		retval = false;
+		regexes_skipped++;
+	} else
+		retval = (regexec(&_regex, value.c_str(), 0, NULL, 0) == 0);
 	if (_inv == 1)
 		retval = (retval == 0) ? 1 : 0;
 
 	return (retval);
 }
 
+bool
+match::literal(const string &var, string &val) const
+{
+	if (_inv || !_literal || _var != var)
+		return (false);
+	val = _prefix;
+	return (true);
+}
+
 #include <sys/sockio.h>
 #include <net/if.h>
 #include <net/if_media.h>
@@ -451,6 +638,10 @@ config::reset(void)
 	delete_and_clear(_detach_list);
 	delete_and_clear(_nomatch_list);
 	delete_and_clear(_notify_list);
+	_attach_index.clear();
+	_detach_index.clear();
+	_nomatch_index.clear();
+	_notify_index.clear();
 }
 
 void
@@ -515,6 +706,58 @@ config::parse(void)
 	sort_vector(_detach_list);
 	sort_vector(_nomatch_list);
 	sort_vector(_notify_list);
+	_attach_index.build(_attach_list, "system");
+	_detach_index.build(_detach_list, "system");
+	_nomatch_index.build(_nomatch_list, "system");
+	_notify_index.build(_notify_list, "system");
+}
+
+void
+event_index::build(const vector<event_proc *> &v, const string &var)
+{
+	vector<event_proc *>::const_iterator i;
+	map<string, vector<event_proc *> >::iterator k;
+	string val;
+
+	clear();
+	_var = var;
+	for (i = v.begin(); i != v.end(); ++i)
+		if ((*i)->literal(var, val))
+			_keyed[lowercase(val)];
+	/*
+	 * A rule that does not insist on one value for the variable is a
+	 * candidate for every event, so it goes on every list.
+	 */
+	for (i = v.begin(); i != v.end(); ++i) {
+		if ((*i)->literal(var, val)) {
+			_keyed[lowercase(val)].push_back(*i);
+			continue;
+		}
+		_rest.push_back(*i);
+		for (k = _keyed.begin(); k != _keyed.end(); ++k)
+			k->second.push_back(*i);
+	}
+}
+
+const vector<event_proc *> &
+event_index::lookup(config &c) const
+{
+	map<string, vector<event_proc *> >::const_iterator k;
+
+	if (_keyed.empty())
+		return (_rest);
+	k = _keyed.find(lowercase(c.get_variable(_var)));
+	if (k == _keyed.end())
+		return (_rest);
+	return (k->second);
+}
+
+void
+event_index::clear()
+{
+	_var.clear();
+	_keyed.clear();
+	_rest.clear();
 }
 
 void
@@ -801,6 +1044,7 @@ config::find_and_execute(char type)
 {
 	vector<event_proc *> *l;
 	vector<event_proc *>::const_iterator i;
+	const event_index *idx;
 	const char *s;
 
 	switch (type) {
@@ -808,23 +1052,30 @@ config::find_and_execute(char type)
 		return;
 	case notify:
 		l = &_notify_list;
+		idx = &_notify_index;
 		s = "notify";
 		break;
 	case nomatch:
 		l = &_nomatch_list;
+		idx = &_nomatch_index;
 		s = "nomatch";
 		break;
 	case attach:
 		l = &_attach_list;
+		idx = &_attach_index;
 		s = "attach";
 		break;
 	case detach:
 		l = &_detach_list;
+		idx = &_detach_index;
 		s = "detach";
 		break;
 	}
 	devdlog(LOG_DEBUG, "Processing %s event\n", s);
-	for (i = l->begin(); i != l->end(); ++i) {
+	const vector<event_proc *> &cand = idx->lookup(*this);
+	rules_skipped += l->size() - cand.size();
+	for (i = cand.begin(); i != cand.end(); ++i) {
+		rules_tested++;
 		if ((*i)->matches(*this)) {
 			(*i)->run(*this);
 			break;
@@ -934,33 +1185,123 @@ static unsigned int num_clients;
 
 static list<client_t> clients;
 
+static list<client_t>::iterator
+drop_client(list<client_t>::iterator i)
+{
+	--num_clients;
+	close(i->fd);
+	return (clients.erase(i));
+}
+
+/*
+ * Ask to be told when the client can take more data, or stop asking.
+ */
+static void
+watch_client(const client_t &c, bool on)
+{
+	struct kevent ev;
+
+	EV_SET(&ev, c.fd, EVFILT_WRITE, on ? EV_ADD : EV_DELETE, 0, 0, NULL);
+	if (kevent(kq, &ev, 1, NULL, 0, NULL) == -1 && on)
+		err(1, "kevent");
+}
+
+/*
+ * Send as much of a client's backlog as its socket takes.  Returns false
+ * if the client has to be dropped.
+ */
+static bool
+flush_client(client_t &c)
+{
+	ssize_t rv;
+	size_t len;
+	int flags;
+
+	flags = c.socktype == SOCK_SEQPACKET ? MSG_EOR : 0;
+	while (!c.pending.empty()) {
+		const string &msg = c.pending.front();
+
+		len = msg.size() - c.offset;
+		rv = send(c.fd, msg.data() + c.offset, len, flags);
+		if (rv == -1) {
+			if (errno == EAGAIN || errno == ENOBUFS)
+				return (true);
+			return (false);
+		}
+		/* A record is sent whole or not at all. */
+		if ((size_t)rv < len && c.socktype == SOCK_STREAM) {
+			c.offset += rv;
+			return (true);
+		}
+		c.pending_len -= msg.size();
+		c.offset = 0;
+		c.pending.pop_front();
+	}
+	return (true);
+}
+
 static void
 notify_clients(const char *data, int len)
 {
 	list<client_t>::iterator i;
+	bool was_idle;
 
 	/*
-	 * Deliver the data to all clients.  Throw clients overboard at the
-	 * first sign of trouble.  This reaps clients who've died or closed
-	 * their sockets, and also clients who are alive but failing to keep up
-	 * (or who are maliciously not reading, to consume buffer space in
-	 * kernel memory or tie up the limited number of available connections).
+	 * Deliver the data to all clients.  Data a client's socket can't take
+	 * right now is queued and sent once the socket drains.  Throw clients
+	 * overboard when they fail, or when their backlog exceeds
+	 * CLIENT_QUEUE_MAX.  This reaps clients who've died or closed their
+	 * sockets, and also clients who are alive but failing to keep up (or
+	 * who are maliciously not reading, to consume buffer space in kernel
+	 * memory or tie up the limited number of available connections).
 	 */
 	for (i = clients.begin(); i != clients.end(); ) {
-		int flags;
-		if (i->socktype == SOCK_SEQPACKET)
-			flags = MSG_EOR;
-		else
-			flags = 0;
-
-		if (send(i->fd, data, len, flags) != len) {
-			--num_clients;
-			close(i->fd);
-			i = clients.erase(i);
+		if (i->pending_len + len > CLIENT_QUEUE_MAX) {
+			clients_dropped++;
+			i = drop_client(i);
+			devdlog(LOG_WARNING, "notify_clients: client queue "
+			    "full; dropping unresponsive client\n");
+			continue;
+		}
+		was_idle = i->pending.empty();
+		i->pending.push_back(string(data, len));
+		i->pending_len += len;
+		if (!was_idle) {
+			++i;
+			continue;
+		}
+		if (!flush_client(*i)) {
+			clients_dropped++;
+			i = drop_client(i);
 			devdlog(LOG_WARNING, "notify_clients: send() failed; "
 			    "dropping unresponsive client\n");
-		} else
-			++i;
+			continue;
+		}
+		if (!i->pending.empty())
+			watch_client(*i, true);
+		++i;
+	}
+}
+
+/*
+ * A client's socket has room again; push out what is queued for it.
+ */
+static void
+client_writable(int fd)
+{
+	list<client_t>::iterator i;
+
+	for (i = clients.begin(); i != clients.end(); ++i) {
+		if (i->fd != fd)
+			continue;
+		if (!flush_client(*i)) {
+			clients_dropped++;
+			drop_client(i);
+			devdlog(LOG_WARNING, "client_writable: send() failed; "
+			    "dropping unresponsive client\n");
+		} else if (i->pending.empty())
+			watch_client(*i, false);
+		return;
 	}
 }
 
@@ -984,9 +1325,7 @@ check_clients(void)
 		s = poll(&pfd, 1, 0);
 		if ((s < 0 && s != EINTR ) ||
 		    (s > 0 && (pfd.revents & POLLHUP))) {
-			--num_clients;
-			close(i->fd);
-			i = clients.erase(i);
+			i = drop_client(i);
 			devdlog(LOG_NOTICE, "check_clients:  "
 			    "dropping disconnected client\n");
 		} else
@@ -1007,6 +1346,8 @@ new_client(int fd, int socktype)
 	 */
 	check_clients();
 	s.socktype = socktype;
+	s.pending_len = 0;
+	s.offset = 0;
 	s.fd = accept(fd, NULL, NULL);
 	if (s.fd != -1) {
 		sndbuf_size = CLIENT_BUFSIZE;
@@ -1020,122 +1361,193 @@ new_client(int fd, int socktype)
 		err(1, "accept");
 }
 
+/*
+ * Read and process up to DEVCTL_BATCH pending events.  Returns false once
+ * devctl has gone away.
+ */
+static bool
+read_devctl(int fd)
+{
+	char buffer[DEVCTL_MAXBUF];
+	int n, rv;
+
+	for (n = 0; n < DEVCTL_BATCH; n++) {
+		rv = read(fd, buffer, sizeof(buffer) - 1);
+		if (rv == 0)
+			return (false);		/* EOF */
+		if (rv < 0)
+			return (errno == EAGAIN || errno == EINTR);
+		total_events++;
+		if (rv == sizeof(buffer) - 1) {
+			devdlog(LOG_WARNING, "Warning: "
+			    "available event data exceeded "
+			    "buffer space\n");
+		}
+		notify_clients(buffer, rv);
+		buffer[rv] = '\0';
+		while (buffer[--rv] == '\n')
+			buffer[rv] = '\0';
+		try {
+			process_event(buffer);
+		}
+		catch (const std::length_error& e) {
+			devdlog(LOG_ERR, "Dropping event %s "
+			    "due to low memory", buffer);
+		}
+	}
+	return (true);
+}
+
+/*
+ * (Re)create the kqueue.  It is not inherited across the fork in daemon(),
+ * so this is done again once we are detached.
+ */
+static void
+setup_kqueue(int fd, int stream_fd, int seqpacket_fd)
+{
+	struct kevent ev[4];
+	list<client_t>::const_iterator i;
+
+	if (kq != -1)
+		close(kq);
+	kq = kqueue();
+	if (kq == -1)
+		err(1, "kqueue");
+	EV_SET(&ev[0], fd, EVFILT_READ, EV_ADD, 0, 0, NULL);
+	EV_SET(&ev[1], stream_fd, EVFILT_READ, EV_ADD, 0, 0, NULL);
+	EV_SET(&ev[2], seqpacket_fd, EVFILT_READ, EV_ADD, 0, 0, NULL);
+	EV_SET(&ev[3], SIGCHLD, EVFILT_SIGNAL, EV_ADD, 0, 0, NULL);
+	if (kevent(kq, ev, nitems(ev), NULL, 0, NULL) == -1)
+		err(1, "kevent");
+	for (i = clients.begin(); i != clients.end(); ++i)
+		if (!i->pending.empty())
+			watch_client(*i, true);
+}
+
 static void
 event_loop(void)
 {
 	int rv;
 	int fd;
-	char buffer[DEVCTL_MAXBUF];
 	int once = 0;
-	int stream_fd, seqpacket_fd, max_fd;
+	int stream_fd, seqpacket_fd;
 	int accepting;
-	timeval tv;
-	fd_set fds;
+	int n;
+	struct kevent changes[2], events[16];
+	struct pollfd pfd;
+	struct timespec ts;
 
 	fd = open(PATH_DEVCTL, O_RDONLY | O_CLOEXEC);
 	if (fd == -1)
 		err(1, "Can't open devctl device %s", PATH_DEVCTL);
+	if (fcntl(fd, F_SETFL, O_NONBLOCK) < 0)
+		err(1, "fcntl");
 	stream_fd = create_socket(STREAMPIPE, SOCK_STREAM);
 	seqpacket_fd = create_socket(SEQPACKETPIPE, SOCK_SEQPACKET);
+	setup_kqueue(fd, stream_fd, seqpacket_fd);
 	accepting = 1;
-	max_fd = max(fd, max(stream_fd, seqpacket_fd)) + 1;
 	while (!romeo_must_die) {
 		if (!once && !no_daemon && !daemonize_quick) {
 			// Check to see if we have any events pending.
-			tv.tv_sec = 0;
-			tv.tv_usec = 0;
-			FD_ZERO(&fds);
-			FD_SET(fd, &fds);
-			rv = select(fd + 1, &fds, NULL, NULL, &tv);
+			pfd.fd = fd;
+			pfd.events = POLLIN;
+			rv = poll(&pfd, 1, 0);
 			// No events -> we've processed all pending events
 			if (rv == 0) {
+				wait_actions();
 				devdlog(LOG_DEBUG, "Calling daemon\n");
 				cfg.remove_pidfile();
 				cfg.open_pidfile();
 				daemon(0, 0);
 				cfg.write_pidfile();
+				setup_kqueue(fd, stream_fd, seqpacket_fd);
+				accepting = 1;
 				once++;
 			}
 		}
 		/*
 		 * When we've already got the max number of clients, stop
-		 * accepting new connections (don't put the listening sockets in
-		 * the set), shrink the accept() queue to reject connections
+		 * accepting new connections (don't watch the listening
+		 * sockets), shrink the accept() queue to reject connections
 		 * quickly, and poll the existing clients more often, so that we
 		 * notice more quickly when any of them disappear to free up
 		 * client slots.
 		 */
-		FD_ZERO(&fds);
-		FD_SET(fd, &fds);
+		n = 0;
 		if (num_clients < max_clients) {
 			if (!accepting) {
 				listen(stream_fd, max_clients);
 				listen(seqpacket_fd, max_clients);
+				EV_SET(&changes[n++], stream_fd, EVFILT_READ,
+				    EV_ENABLE, 0, 0, NULL);
+				EV_SET(&changes[n++], seqpacket_fd, EVFILT_READ,
+				    EV_ENABLE, 0, 0, NULL);
 				accepting = 1;
 			}
-			FD_SET(stream_fd, &fds);
-			FD_SET(seqpacket_fd, &fds);
-			tv.tv_sec = 60;
-			tv.tv_usec = 0;
+			ts.tv_sec = 60;
+			ts.tv_nsec = 0;
 		} else {
 			if (accepting) {
 				listen(stream_fd, 0);
 				listen(seqpacket_fd, 0);
+				EV_SET(&changes[n++], stream_fd, EVFILT_READ,
+				    EV_DISABLE, 0, 0, NULL);
+				EV_SET(&changes[n++], seqpacket_fd, EVFILT_READ,
+				    EV_DISABLE, 0, 0, NULL);
 				accepting = 0;
 			}
-			tv.tv_sec = 2;
-			tv.tv_usec = 0;
+			ts.tv_sec = 2;
+			ts.tv_nsec = 0;
 		}
-		rv = select(max_fd, &fds, NULL, NULL, &tv);
+		rv = kevent(kq, changes, n, events, nitems(events), &ts);
 		if (got_siginfo) {
 			devdlog(LOG_NOTICE, "Events received so far=%u\n",
 			    total_events);
+			devdlog(LOG_NOTICE, "Rules tested=%ju, skipped by "
+			    "index=%ju, regexes skipped=%ju\n", rules_tested,
+			    rules_skipped, regexes_skipped);
+			devdlog(LOG_NOTICE, "Clients=%u, dropped for falling "
+			    "behind=%ju\n", num_clients, clients_dropped);
+			devdlog(LOG_NOTICE, "Actions run=%ju, running=%zu, "
+			    "queued=%zu, average=%jums, max=%jums\n",
+			    actions_run, running_actions.size(),
+			    action_queue.size(),
+			    actions_run ? actions_usec / actions_run / 1000 : 0,
+			    actions_max_usec / 1000);
 			got_siginfo = 0;
 		}
 		if (rv == -1) {
 			if (errno == EINTR)
 				continue;
-			err(1, "select");
+			err(1, "kevent");
 		} else if (rv == 0)
 			check_clients();
-		if (FD_ISSET(fd, &fds)) {
-			rv = read(fd, buffer, sizeof(buffer) - 1);
-			if (rv > 0) {
-				total_events++;
-				if (rv == sizeof(buffer) - 1) {
-					devdlog(LOG_WARNING, "Warning: "
-					    "available event data exceeded "
-					    "buffer space\n");
-				}
-				notify_clients(buffer, rv);
-				buffer[rv] = '\0';
-				while (buffer[--rv] == '\n')
-					buffer[rv] = '\0';
-				try {
-					process_event(buffer);
-				}
-				catch (const std::length_error& e) {
-					devdlog(LOG_ERR, "Dropping event %s "
-					    "due to low memory", buffer);
-				}
-			} else if (rv < 0) {
-				if (errno != EINTR)
-					break;
-			} else {
-				/* EOF */
-				break;
+		for (int i = 0; i < rv; i++) {
+			if (events[i].filter == EVFILT_WRITE) {
+				client_writable(events[i].ident);
+				continue;
 			}
+			if (events[i].filter == EVFILT_SIGNAL) {
+				reap_actions();
+				continue;
+			}
+			if ((int)events[i].ident == fd) {
+				if (!read_devctl(fd))
+					goto out;
+			} else if ((int)events[i].ident == stream_fd)
+				new_client(stream_fd, SOCK_STREAM);
+			/*
+			 * Aside from the socket type, both sockets use the same
+			 * protocol, so we can process clients the same way.
+			 */
+			else if ((int)events[i].ident == seqpacket_fd)
+				new_client(seqpacket_fd, SOCK_SEQPACKET);
 		}
-		if (FD_ISSET(stream_fd, &fds))
-			new_client(stream_fd, SOCK_STREAM);
-		/*
-		 * Aside from the socket type, both sockets use the same
-		 * protocol, so we can process clients the same way.
-		 */
-		if (FD_ISSET(seqpacket_fd, &fds))
-			new_client(seqpacket_fd, SOCK_SEQPACKET);
 	}
+out:
+	wait_actions();
 	cfg.remove_pidfile();
+	close(kq);
 	close(seqpacket_fd);
 	close(stream_fd);
 	close(fd);
@@ -1263,8 +1675,8 @@ devdlog(int priority, const char* fmt, ...)
 static void
 usage()
 {
-	fprintf(stderr, "usage: %s [-dnq] [-l connlimit] [-f file]\n",
-	    getprogname());
+	fprintf(stderr, "usage: %s [-dnq] [-j maxactions] [-l connlimit] "
+	    "[-f file]\n", getprogname());
 	exit(1);
 }
 
@@ -1294,7 +1706,7 @@ main(int argc, char **argv)
 	int ch;
 
 	check_devd_enabled();
-	while ((ch = getopt(argc, argv, "df:l:nq")) != -1) {
+	while ((ch = getopt(argc, argv, "df:j:l:nq")) != -1) {
 		switch (ch) {
 		case 'd':
 			no_daemon = 1;
@@ -1302,6 +1714,9 @@ main(int argc, char **argv)
 		case 'f':
 			configfile = optarg;
 			break;
+		case 'j':
+			max_actions = MAX(1, strtoul(optarg, NULL, 0));
+			break;
 		case 'l':
 			max_clients = MAX(1, strtoul(optarg, NULL, 0));
 			break;
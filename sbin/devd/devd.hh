@@ -78,6 +78,11 @@ public:
 	/** Perform some action for this eps.
 	 */
 	virtual bool do_action(config &) = 0;
+	/** If this eps only matches when %var is exactly some literal
+	 * value (ignoring case), return true and set %val to it.
+	 */
+	virtual bool literal(const std::string &, std::string &) const
+	{ return false; }
 };
 
 /**
@@ -91,10 +96,13 @@ public:
 	virtual ~match();
 	virtual bool do_match(config &);
 	virtual bool do_action(config &) { return true; }
+	virtual bool literal(const std::string &var, std::string &val) const;
 private:
 	bool _inv;
+	bool _literal;
 	std::string _var;
 	std::string _re;
+	std::string _prefix;
 	regex_t _regex;
 };
 
@@ -138,11 +146,30 @@ public:
 	void add(eps *);
 	bool matches(config &) const;
 	bool run(config &) const;
+	bool literal(const std::string &var, std::string &val) const;
 private:
 	int _prio;
 	std::vector<eps *> _epsvec;
 };
 
+/**
+ * event_index pre-sorts the rules of one event type by the literal value
+ * they require for a single variable, so that an event is only tested
+ * against the rules that could possibly match it.  Every candidate list
+ * keeps the priority order of the rules it was built from.
+ */
+class event_index
+{
+public:
+	void build(const std::vector<event_proc *> &, const std::string &var);
+	const std::vector<event_proc *> &lookup(config &) const;
+	void clear();
+private:
+	std::string _var;
+	std::map<std::string, std::vector<event_proc *> > _keyed;
+	std::vector<event_proc *> _rest;
+};
+
 class config
 {
 public:
@@ -184,6 +211,10 @@ private:
 	std::vector<event_proc *> _detach_list;
 	std::vector<event_proc *> _nomatch_list;
 	std::vector<event_proc *> _notify_list;
+	event_index _attach_index;
+	event_index _detach_index;
+	event_index _nomatch_index;
+	event_index _notify_index;
 };
 
 #endif /* DEVD_HH */
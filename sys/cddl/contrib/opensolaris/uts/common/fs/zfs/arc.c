@@ -316,6 +316,26 @@ uint_t arc_reduce_dnlc_percent = 3;
  */
 int zfs_arc_evict_batch_limit = 10;
 
+/*
+ * Number of threads arc_evict_state() may use to evict from the sublists
+ * of a state in parallel; 1 keeps eviction in the calling thread.  A
+ * request is only spread out when each sublist gets at least
+ * ARC_EVICT_TASK_MIN bytes of it.
+ */
+int zfs_arc_evict_threads = 1;
+#define	ARC_EVICT_TASK_MIN	(8ULL << 20)
+static taskq_t *arc_evict_taskq;
+
+typedef struct arc_evict_arg {
+	taskq_ent_t	eva_tqent;
+	multilist_t	*eva_ml;
+	arc_buf_hdr_t	*eva_marker;
+	int		eva_idx;
+	uint64_t	eva_spa;
+	uint64_t	eva_bytes;
+	uint64_t	eva_evicted;
+} arc_evict_arg_t;
+
 /* number of seconds before growing cache again */
 static int		arc_grow_retry = 60;
 
@@ -440,6 +460,9 @@ SYSCTL_INT(_vfs_zfs, OID_AUTO, compressed_arc_enabled, CTLFLAG_RDTUN,
 SYSCTL_INT(_vfs_zfs, OID_AUTO, arc_kmem_cache_reap_retry_ms, CTLFLAG_RWTUN,
     &arc_kmem_cache_reap_retry_ms, 0,
     "Interval between ARC kmem_cache reapings");
+SYSCTL_INT(_vfs_zfs, OID_AUTO, arc_evict_threads, CTLFLAG_RDTUN,
+    &zfs_arc_evict_threads, 0,
+    "Number of threads evicting ARC sublists in parallel");
 
 /*
  * We don't have a tunable for arc_free_target due to the dependency on
@@ -3922,6 +3945,25 @@ arc_evict_state_impl(multilist_t *ml, int idx, arc_buf_hdr_t *marker,
 	return (bytes_evicted);
 }
 
+/*
+ * Evict up to eva_bytes from one sublist on behalf of arc_evict_state(),
+ * one batch at a time so that the sublist lock is dropped in between.
+ */
+static void
+arc_evict_task(void *arg)
+{
+	arc_evict_arg_t *eva = arg;
+	uint64_t evicted;
+
+	eva->eva_evicted = 0;
+	do {
+		evicted = arc_evict_state_impl(eva->eva_ml, eva->eva_idx,
+		    eva->eva_marker, eva->eva_spa,
+		    eva->eva_bytes - eva->eva_evicted);
+		eva->eva_evicted += evicted;
+	} while (evicted != 0 && eva->eva_evicted < eva->eva_bytes);
+}
+
 /*
  * Evict buffers from the given arc state, until we've removed the
  * specified number of bytes. Move the removed buffers to the
@@ -3943,10 +3985,15 @@ arc_evict_state(arc_state_t *state, uint64_t spa, int64_t bytes,
 	multilist_t *ml = state->arcs_list[type];
 	int num_sublists;
 	arc_buf_hdr_t **markers;
+	arc_evict_arg_t *eva;
 
 	IMPLY(bytes < 0, bytes == ARC_EVICT_ALL);
 
 	num_sublists = multilist_get_num_sublists(ml);
+	eva = NULL;
+	if (arc_evict_taskq != NULL && bytes != ARC_EVICT_ALL &&
+	    (uint64_t)bytes >= num_sublists * ARC_EVICT_TASK_MIN)
+		eva = kmem_zalloc(sizeof (*eva) * num_sublists, KM_SLEEP);
 
 	/*
 	 * If we've tried to evict from each sublist, made some
@@ -3991,6 +4038,33 @@ arc_evict_state(arc_state_t *state, uint64_t spa, int64_t bytes,
 			    zfs_arc_dnode_reduce_percent);
 		}
 
+		/*
+		 * For a large request, give every sublist an equal share
+		 * and evict them concurrently.  Once what is left is too
+		 * small to split, finish in this thread.
+		 */
+		if (eva != NULL &&
+		    bytes - total_evicted >= num_sublists * ARC_EVICT_TASK_MIN) {
+			uint64_t share = (bytes - total_evicted) / num_sublists;
+
+			for (int i = 0; i < num_sublists; i++) {
+				eva[i].eva_ml = ml;
+				eva[i].eva_marker = markers[i];
+				eva[i].eva_idx = i;
+				eva[i].eva_spa = spa;
+				eva[i].eva_bytes = share;
+				taskq_dispatch_ent(arc_evict_taskq,
+				    arc_evict_task, &eva[i], 0,
+				    &eva[i].eva_tqent);
+			}
+			taskq_wait(arc_evict_taskq);
+			for (int i = 0; i < num_sublists; i++)
+				scan_evicted += eva[i].eva_evicted;
+			total_evicted += scan_evicted;
+			if (scan_evicted != 0)
+				continue;
+		}
+
 		/*
 		 * Start eviction using a randomly selected sublist,
 		 * this is to try and evenly balance eviction across all
@@ -4052,6 +4126,8 @@ arc_evict_state(arc_state_t *state, uint64_t spa, int64_t bytes,
 		kmem_cache_free(hdr_full_cache, markers[i]);
 	}
 	kmem_free(markers, sizeof (*markers) * num_sublists);
+	if (eva != NULL)
+		kmem_free(eva, sizeof (*eva) * num_sublists);
 
 	return (total_evicted);
 }
@@ -7166,6 +7242,11 @@ arc_init(void)
 
 	arc_prune_taskq = taskq_create("arc_prune", max_ncpus, minclsyspri,
 	    max_ncpus, INT_MAX, TASKQ_PREPOPULATE | TASKQ_DYNAMIC);
+	if (zfs_arc_evict_threads > 1)
+		arc_evict_taskq = taskq_create("arc_evict",
+		    MIN(zfs_arc_evict_threads, max_ncpus), minclsyspri,
+		    MIN(zfs_arc_evict_threads, max_ncpus), INT_MAX,
+		    TASKQ_PREPOPULATE);
 
 	arc_reclaim_thread_exit = B_FALSE;
 	arc_dnlc_evicts_thread_exit = FALSE;
@@ -7291,6 +7372,10 @@ arc_fini(void)
 
 	taskq_wait(arc_prune_taskq);
 	taskq_destroy(arc_prune_taskq);
+	if (arc_evict_taskq != NULL) {
+		taskq_destroy(arc_evict_taskq);
+		arc_evict_taskq = NULL;
+	}
 
 	mutex_enter(&arc_prune_mtx);
 	while ((p = list_head(&arc_prune_list)) != NULL) {
@@ -0,0 +1,237 @@
+/*
+ * CDDL HEADER START
+ *
+ * The contents of this file are subject to the terms of the
+ * Common Development and Distribution License (the "License").
+ * You may not use this file except in compliance with the License.
+ *
+ * You can obtain a copy of the license at usr/src/OPENSOLARIS.LICENSE
+ * or http://www.opensolaris.org/os/licensing.
+ * See the License for the specific language governing permissions
+ * and limitations under the License.
+ *
+ * When distributing Covered Code, include this CDDL HEADER in each
+ * file and include the License file at usr/src/OPENSOLARIS.LICENSE.
+ * If applicable, add the following below this CDDL HEADER, with the
+ * fields enclosed by brackets "[]" replaced with your own identifying
+ * information: Portions Copyright [yyyy] [name of copyright owner]
+ *
+ * CDDL HEADER END
+ *
+ * $FreeBSD$
+ *
+ */
+
+/*
+ * Copyright 2006 Sun Microsystems, Inc.  All rights reserved.
+ * Use is subject to license terms.
+ */
+
+#include <sys/cdefs.h>
+#include <sys/param.h>
+#include <sys/malloc.h>
+
+#include <sys/dtrace.h>
+
+#include <vm/vm.h>
+#include <vm/pmap.h>
+
+#include <machine/encoding.h>
+#include <machine/frame.h>
+
+#include "fbt.h"
+
+#define	FBT_C_PATCHVAL		MATCH_C_EBREAK
+#define	FBT_PATCHVAL		MATCH_EBREAK
+#define	FBT_ENTRY		"entry"
+#define	FBT_RETURN		"return"
+
+/* Instructions whose two low bits are not both set are compressed. */
+#define	FBT_INSN_IS_C(insn)	(((insn) & 0x3) != 0x3)
+
+int
+fbt_invop(uintptr_t addr, struct trapframe *frame, uintptr_t rval)
+{
+	solaris_cpu_t *cpu;
+	fbt_probe_t *fbt;
+
+	cpu = &solaris_cpu[curcpu];
+	fbt = fbt_probetab[FBT_ADDR2NDX(addr)];
+
+	for (; fbt != NULL; fbt = fbt->fbtp_hashnext) {
+		if ((uintptr_t)fbt->fbtp_patchpoint != addr)
+			continue;
+
+		cpu->cpu_dtrace_caller = addr;
+		if (fbt->fbtp_roffset == 0) {
+			dtrace_probe(fbt->fbtp_id, frame->tf_a[0],
+			    frame->tf_a[1], frame->tf_a[2],
+			    frame->tf_a[3], frame->tf_a[4]);
+		} else {
+			dtrace_probe(fbt->fbtp_id, fbt->fbtp_roffset,
+			    frame->tf_a[0], frame->tf_a[1], 0, 0);
+		}
+		cpu->cpu_dtrace_caller = 0;
+
+		/*
+		 * The saved instruction is handed back to the trap handler,
+		 * which emulates it in place; see dtrace_invop_start().
+		 */
+		return (fbt->fbtp_savedval);
+	}
+
+	return (0);
+}
+
+void
+fbt_patch_tracepoint(fbt_probe_t *fbt, fbt_patchval_t val)
+{
+	vm_size_t sz;
+
+	if (fbt->fbtp_patchval == FBT_C_PATCHVAL) {
+		*(uint16_t *)fbt->fbtp_patchpoint = (uint16_t)val;
+		sz = INSN_C_SIZE;
+	} else {
+		*fbt->fbtp_patchpoint = val;
+		sz = INSN_SIZE;
+	}
+
+	/* Kernel text is shared by all harts. */
+	pmap_sync_icache(kernel_pmap, (vm_offset_t)fbt->fbtp_patchpoint, sz);
+}
+
+static int
+match_opcode(uint32_t insn, int match, int mask)
+{
+
+	if (((insn ^ match) & mask) == 0)
+		return (1);
+
+	return (0);
+}
+
+/*
+ * Fetch the instruction at "instr".  Compressed instructions are only
+ * 16-bit aligned, so a full-width instruction may straddle a 32-bit
+ * boundary; read it a halfword at a time.
+ */
+static uint32_t
+fbt_fetch(const uint16_t *instr, const uint16_t *limit, int *len)
+{
+	uint32_t insn;
+
+	insn = instr[0];
+	if (FBT_INSN_IS_C(insn)) {
+		*len = 1;
+		return (insn);
+	}
+	if (instr + 1 >= limit) {
+		*len = 0;
+		return (0);
+	}
+	*len = 2;
+	return (insn | (uint32_t)instr[1] << 16);
+}
+
+static fbt_probe_t *
+fbt_new_probe(linker_file_t lf, int symindx, const char *name,
+    uint16_t *instr, uint32_t insn, int rval)
+{
+	fbt_probe_t *fbt;
+
+	fbt = malloc(sizeof (fbt_probe_t), M_FBT, M_WAITOK | M_ZERO);
+	fbt->fbtp_name = name;
+	fbt->fbtp_patchpoint = (fbt_patchval_t *)instr;
+	fbt->fbtp_ctl = lf;
+	fbt->fbtp_loadcnt = lf->loadcnt;
+	fbt->fbtp_symindx = symindx;
+	fbt->fbtp_rval = rval;
+	fbt->fbtp_savedval = insn;
+	fbt->fbtp_patchval = FBT_INSN_IS_C(insn) ? FBT_C_PATCHVAL :
+	    FBT_PATCHVAL;
+	fbt->fbtp_hashnext = fbt_probetab[FBT_ADDR2NDX(instr)];
+	fbt_probetab[FBT_ADDR2NDX(instr)] = fbt;
+
+	lf->fbt_nentries++;
+
+	return (fbt);
+}
+
+int
+fbt_provide_module_function(linker_file_t lf, int symindx,
+    linker_symval_t *symval, void *opaque)
+{
+	fbt_probe_t *fbt, *retfbt;
+	uint16_t *instr, *limit;
+	const char *name;
+	char *modname;
+	uint32_t insn;
+	int len, rval;
+
+	modname = opaque;
+	name = symval->name;
+
+	/* Check if function is excluded from instrumentation */
+	if (fbt_excluded(name))
+		return (0);
+
+	instr = (uint16_t *)(symval->value);
+	limit = (uint16_t *)(symval->value + symval->size);
+
+	/* Look for the store of ra to the stack in the prologue. */
+	for (; instr < limit; instr += len) {
+		insn = fbt_fetch(instr, limit, &len);
+		if (len == 0)
+			return (0);
+		if (len == 2 && match_opcode(insn, (MATCH_SD | RS2_RA | RS1_SP),
+		    (MASK_SD | RS2_MASK | RS1_MASK))) {
+			rval = DTRACE_INVOP_SD;
+			break;
+		}
+		if (len == 1 && match_opcode(insn, (MATCH_C_SDSP | RS2_C_RA),
+		    (MASK_C_SDSP | RS2_C_MASK))) {
+			rval = DTRACE_INVOP_C_SDSP;
+			break;
+		}
+	}
+
+	if (instr >= limit)
+		return (0);
+
+	fbt = fbt_new_probe(lf, symindx, name, instr, insn, rval);
+	fbt->fbtp_id = dtrace_probe_create(fbt_id, modname,
+	    name, FBT_ENTRY, 3, fbt);
+
+	retfbt = NULL;
+	for (instr += len; instr < limit; instr += len) {
+		insn = fbt_fetch(instr, limit, &len);
+		if (len == 0)
+			break;
+		if (len == 2 && match_opcode(insn,
+		    (MATCH_JALR | (X_RA << RS1_SHIFT)),
+		    (MASK_JALR | RD_MASK | RS1_MASK | IMM_MASK)))
+			rval = DTRACE_INVOP_RET;
+		else if (len == 1 && match_opcode(insn,
+		    (MATCH_C_JR | (X_RA << RD_SHIFT)),
+		    (MASK_C_JR | RD_MASK)))
+			rval = DTRACE_INVOP_C_RET;
+		else
+			continue;
+
+		/*
+		 * We have a winner!
+		 */
+		fbt = fbt_new_probe(lf, symindx, name, instr, insn, rval);
+		fbt->fbtp_roffset = (uintptr_t)instr - symval->value;
+		if (retfbt == NULL) {
+			fbt->fbtp_id = dtrace_probe_create(fbt_id, modname,
+			    name, FBT_RETURN, 3, fbt);
+		} else {
+			retfbt->fbtp_probenext = fbt;
+			fbt->fbtp_id = retfbt->fbtp_id;
+		}
+		retfbt = fbt;
+	}
+
+	return (0);
+}
@@ -1402,6 +1402,93 @@ freebsd32_sendmsg(struct thread *td,
 	return (error);
 }
 
+/*
+ * The 32-bit vector calls go through freebsd32_sendmsg() and
+ * freebsd32_recvmsg() for each message, so they save the system call
+ * transitions but not the per-message socket lookup.
+ */
+int
+freebsd32_sendmmsg(struct thread *td, struct freebsd32_sendmmsg_args *uap)
+{
+	struct freebsd32_sendmsg_args sma;
+	struct mmsghdr32 *umsg;
+	int32_t len;
+	size_t i, vlen;
+	int error;
+
+	vlen = MIN(uap->vlen, UIO_MAXIOV);
+	umsg = uap->msgvec;
+	error = 0;
+	for (i = 0; i < vlen; i++, umsg++) {
+		sma.s = uap->s;
+		sma.msg = &umsg->msg_hdr;
+		sma.flags = uap->flags;
+		error = freebsd32_sendmsg(td, &sma);
+		if (error != 0)
+			break;
+		len = td->td_retval[0];
+		error = copyout(&len, &umsg->msg_len, sizeof(len));
+		if (error != 0)
+			break;
+	}
+	if (i > 0 || error == 0) {
+		td->td_retval[0] = i;
+		error = 0;
+	}
+	return (error);
+}
+
+int
+freebsd32_recvmmsg(struct thread *td, struct freebsd32_recvmmsg_args *uap)
+{
+	struct freebsd32_recvmsg_args rma;
+	struct mmsghdr32 *umsg;
+	struct timespec32 ts32;
+	struct timespec ts;
+	int32_t len;
+	size_t i, vlen;
+	int error, flags;
+
+	if (uap->timeout != NULL) {
+		error = copyin(uap->timeout, &ts32, sizeof(ts32));
+		if (error != 0)
+			return (error);
+		CP(ts32, ts, tv_sec);
+		CP(ts32, ts, tv_nsec);
+		error = kern_recvmmsg_wait(td, uap->s, &ts);
+		if (error == EWOULDBLOCK) {
+			td->td_retval[0] = 0;
+			return (0);
+		}
+		if (error != 0)
+			return (error);
+	}
+
+	vlen = MIN(uap->vlen, UIO_MAXIOV);
+	flags = uap->flags & ~MSG_WAITFORONE;
+	umsg = uap->msgvec;
+	error = 0;
+	for (i = 0; i < vlen; i++, umsg++) {
+		rma.s = uap->s;
+		rma.msg = &umsg->msg_hdr;
+		rma.flags = flags;
+		error = freebsd32_recvmsg(td, &rma);
+		if (error != 0)
+			break;
+		len = td->td_retval[0];
+		error = copyout(&len, &umsg->msg_len, sizeof(len));
+		if (error != 0)
+			break;
+		if (uap->flags & MSG_WAITFORONE)
+			flags |= MSG_DONTWAIT;
+	}
+	if (i > 0 || error == 0) {
+		td->td_retval[0] = i;
+		error = 0;
+	}
+	return (error);
+}
+
 int
 freebsd32_recvfrom(struct thread *td,
 		   struct freebsd32_recvfrom_args *uap)
@@ -710,6 +710,19 @@ struct freebsd32_cpuset_setdomain_args {
 	char mask_l_[PADL_(domainset_t *)]; domainset_t * mask; char mask_r_[PADR_(domainset_t *)];
 	char policy_l_[PADL_(int)]; int policy; char policy_r_[PADR_(int)];
 };
+struct freebsd32_recvmmsg_args {
+	char s_l_[PADL_(int)]; int s; char s_r_[PADR_(int)];
+	char msgvec_l_[PADL_(struct mmsghdr32 *)]; struct mmsghdr32 * msgvec; char msgvec_r_[PADR_(struct mmsghdr32 *)];
+	char vlen_l_[PADL_(size_t)]; size_t vlen; char vlen_r_[PADR_(size_t)];
+	char flags_l_[PADL_(int)]; int flags; char flags_r_[PADR_(int)];
+	char timeout_l_[PADL_(const struct timespec32 *)]; const struct timespec32 * timeout; char timeout_r_[PADR_(const struct timespec32 *)];
+};
+struct freebsd32_sendmmsg_args {
+	char s_l_[PADL_(int)]; int s; char s_r_[PADR_(int)];
+	char msgvec_l_[PADL_(struct mmsghdr32 *)]; struct mmsghdr32 * msgvec; char msgvec_r_[PADR_(struct mmsghdr32 *)];
+	char vlen_l_[PADL_(size_t)]; size_t vlen; char vlen_r_[PADR_(size_t)];
+	char flags_l_[PADL_(int)]; int flags; char flags_r_[PADR_(int)];
+};
 #if !defined(PAD64_REQUIRED) && (defined(__powerpc__) || defined(__mips__))
 #define PAD64_REQUIRED
 #endif
@@ -842,6 +855,8 @@ int	freebsd32_fhstat(struct thread *, struct freebsd32_fhstat_args *);
 int	freebsd32_kevent(struct thread *, struct freebsd32_kevent_args *);
 int	freebsd32_cpuset_getdomain(struct thread *, struct freebsd32_cpuset_getdomain_args *);
 int	freebsd32_cpuset_setdomain(struct thread *, struct freebsd32_cpuset_setdomain_args *);
+int	freebsd32_recvmmsg(struct thread *, struct freebsd32_recvmmsg_args *);
+int	freebsd32_sendmmsg(struct thread *, struct freebsd32_sendmmsg_args *);
 
 #ifdef COMPAT_43
 
@@ -1391,6 +1406,8 @@ int	freebsd11_freebsd32_mknodat(struct thread *, struct freebsd11_freebsd32_mkno
 #define	FREEBSD32_SYS_AUE_freebsd32_kevent	AUE_KEVENT
 #define	FREEBSD32_SYS_AUE_freebsd32_cpuset_getdomain	AUE_NULL
 #define	FREEBSD32_SYS_AUE_freebsd32_cpuset_setdomain	AUE_NULL
+#define	FREEBSD32_SYS_AUE_freebsd32_recvmmsg	AUE_RECVMSG
+#define	FREEBSD32_SYS_AUE_freebsd32_sendmmsg	AUE_SENDMSG
 
 #undef PAD_
 #undef PADL_
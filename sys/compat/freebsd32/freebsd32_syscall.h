@@ -489,4 +489,7 @@
 #define	FREEBSD32_SYS_freebsd32_cpuset_getdomain	561
 #define	FREEBSD32_SYS_freebsd32_cpuset_setdomain	562
 #define	FREEBSD32_SYS_getrandom	563
-#define	FREEBSD32_SYS_MAXSYSCALL	564
+#define	FREEBSD32_SYS_freebsd32_recvmmsg	564
+#define	FREEBSD32_SYS_freebsd32_sendmmsg	565
+#define	FREEBSD32_SYS_copy_file_range	566
+#define	FREEBSD32_SYS_MAXSYSCALL	567
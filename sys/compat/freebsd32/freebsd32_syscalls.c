@@ -596,4 +596,7 @@ const char *freebsd32_syscallnames[] = {
 	"freebsd32_cpuset_getdomain",			/* 561 = freebsd32_cpuset_getdomain */
 	"freebsd32_cpuset_setdomain",			/* 562 = freebsd32_cpuset_setdomain */
 	"getrandom",			/* 563 = getrandom */
+	"freebsd32_recvmmsg",			/* 564 = freebsd32_recvmmsg */
+	"freebsd32_sendmmsg",			/* 565 = freebsd32_sendmmsg */
+	"copy_file_range",			/* 566 = copy_file_range */
 };
@@ -168,7 +168,7 @@ aesni_attach(device_t dev)
 	sc = device_get_softc(dev);
 
 	sc->cid = crypto_get_driverid(dev, sizeof(struct aesni_session),
-	    CRYPTOCAP_F_HARDWARE | CRYPTOCAP_F_SYNC);
+	    CRYPTOCAP_F_HARDWARE | CRYPTOCAP_F_SYNC | CRYPTOCAP_F_CHAIN);
 	if (sc->cid < 0) {
 		device_printf(dev, "Could not get crypto driver id.\n");
 		return (ENOMEM);
@@ -318,12 +318,14 @@ aesni_process(device_t dev, struct cryptop *crp, int hint __unused)
 	struct aesni_session *ses;
 	struct cryptodesc *crd, *enccrd, *authcrd;
 	int error, needauth;
+	bool chained;
 
 	ses = NULL;
 	error = 0;
 	enccrd = NULL;
 	authcrd = NULL;
 	needauth = 0;
+	chained = false;
 
 	/* Sanity check. */
 	if (crp == NULL)
@@ -344,8 +346,18 @@ aesni_process(device_t dev, struct cryptop *crp, int hint __unused)
 		case CRYPTO_AES_ICM:
 		case CRYPTO_AES_XTS:
 			if (enccrd != NULL) {
-				error = EINVAL;
-				goto out;
+				/*
+				 * Several descriptors of the same cipher may
+				 * be chained, e.g. one per disk sector, and
+				 * are processed within a single FPU section.
+				 */
+				if (crd->crd_alg == CRYPTO_AES_NIST_GCM_16 ||
+				    crd->crd_alg != enccrd->crd_alg) {
+					error = EINVAL;
+					goto out;
+				}
+				chained = true;
+				break;
 			}
 			enccrd = crd;
 			break;
@@ -373,17 +385,20 @@ aesni_process(device_t dev, struct cryptop *crp, int hint __unused)
 	}
 
 	if ((enccrd == NULL && authcrd == NULL) ||
-	    (needauth && authcrd == NULL)) {
+	    (needauth && authcrd == NULL) ||
+	    (chained && authcrd != NULL)) {
 		error = EINVAL;
 		goto out;
 	}
 
 	/* CBC & XTS can only handle full blocks for now */
-	if (enccrd != NULL && (enccrd->crd_alg == CRYPTO_AES_CBC ||
-	    enccrd->crd_alg == CRYPTO_AES_XTS) &&
-	    (enccrd->crd_len % AES_BLOCK_LEN) != 0) {
-		error = EINVAL;
-		goto out;
+	for (crd = enccrd; crd != NULL; crd = chained ? crd->crd_next : NULL) {
+		if ((crd->crd_alg == CRYPTO_AES_CBC ||
+		    crd->crd_alg == CRYPTO_AES_XTS) &&
+		    (crd->crd_len % AES_BLOCK_LEN) != 0) {
+			error = EINVAL;
+			goto out;
+		}
 	}
 
 	ses = crypto_get_driver_session(crp->crp_session);
@@ -657,6 +672,7 @@ aesni_cipher_process(struct aesni_session *ses, struct cryptodesc *enccrd,
     struct cryptodesc *authcrd, struct cryptop *crp)
 {
 	struct fpu_kern_ctx *ctx;
+	struct cryptodesc *crd;
 	int error, ctxidx;
 	bool kt;
 
@@ -691,9 +707,12 @@ aesni_cipher_process(struct aesni_session *ses, struct cryptodesc *enccrd,
 			error = aesni_cipher_mac(ses, authcrd, crp);
 		else
 			error = aesni_cipher_crypt(ses, enccrd, authcrd, crp);
-	} else if (enccrd != NULL)
-		error = aesni_cipher_crypt(ses, enccrd, authcrd, crp);
-	else
+	} else if (enccrd != NULL) {
+		/* Without a MAC, enccrd heads a chain of cipher descriptors. */
+		for (crd = enccrd; crd != NULL && error == 0;
+		    crd = crd->crd_next)
+			error = aesni_cipher_crypt(ses, crd, NULL, crp);
+	} else
 		error = aesni_cipher_mac(ses, authcrd, crp);
 
 	if (error != 0)
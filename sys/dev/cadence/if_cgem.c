@@ -218,6 +218,13 @@ static void cgem_tick(void *);
 static void cgem_intr(void *);
 
 static void cgem_mediachange(struct cgem_softc *, struct mii_data *);
+static void cgem_init_locked(struct cgem_softc *);
+static void cgem_stop(struct cgem_softc *);
+
+#ifdef DEV_NETMAP
+#include <dev/netmap/if_cgem_netmap.h>
+MODULE_DEPEND(cgem, netmap, 1, 1, 1);
+#endif /* !DEV_NETMAP */
 
 static void
 cgem_get_mac(struct cgem_softc *sc, u_char eaddr[])
@@ -477,6 +484,12 @@ cgem_fill_rqueue(struct cgem_softc *sc)
 
 	CGEM_ASSERT_LOCKED(sc);
 
+#ifdef DEV_NETMAP
+	/* The netmap rings are set up by cgem_netmap_rx_init(). */
+	if (if_getcapenable(sc->ifp) & IFCAP_NETMAP)
+		return;
+#endif /* DEV_NETMAP */
+
 	while (sc->rxring_queued < sc->rxbufs) {
 		/* Get a cluster mbuf. */
 		m = m_getcl(M_NOWAIT, MT_DATA, M_PKTHDR);
@@ -534,6 +547,15 @@ cgem_recv(struct cgem_softc *sc)
 
 	CGEM_ASSERT_LOCKED(sc);
 
+#ifdef DEV_NETMAP
+	{
+		int n;
+
+		if (netmap_rx_irq(ifp, 0, &n))
+			return;
+	}
+#endif /* DEV_NETMAP */
+
 	/* Pick up all packets in which the OWN bit is set. */
 	m_hd = NULL;
 	m_tl = &m_hd;
@@ -633,6 +655,11 @@ cgem_clean_tx(struct cgem_softc *sc)
 
 	CGEM_ASSERT_LOCKED(sc);
 
+#ifdef DEV_NETMAP
+	if (netmap_tx_irq(sc->ifp, 0))
+		return;
+#endif /* DEV_NETMAP */
+
 	/* free up finished transmits. */
 	while (sc->txring_queued > 0 &&
 	       ((ctl = sc->txring[sc->txring_tl_ptr].ctl) &
@@ -1015,15 +1042,32 @@ cgem_config(struct cgem_softc *sc)
 	if_t ifp = sc->ifp;
 	uint32_t net_cfg;
 	uint32_t dma_cfg;
+	uint32_t intr_en;
 	u_char *eaddr = if_getlladdr(ifp);
+	int rx_offset = ETHER_ALIGN;
 
 	CGEM_ASSERT_LOCKED(sc);
 
+	intr_en = CGEM_INTR_RX_COMPLETE | CGEM_INTR_RX_OVERRUN |
+	    CGEM_INTR_TX_USED_READ | CGEM_INTR_RX_USED_READ |
+	    CGEM_INTR_HRESP_NOT_OK;
+
+#ifdef DEV_NETMAP
+	/*
+	 * Netmap buffers are handed out as is, so frames must start at
+	 * offset zero, and transmit completions have to wake up txsync.
+	 */
+	if (if_getcapenable(ifp) & IFCAP_NETMAP) {
+		rx_offset = 0;
+		intr_en |= CGEM_INTR_TX_COMPLETE;
+	}
+#endif /* DEV_NETMAP */
+
 	/* Program Net Config Register. */
 	net_cfg = CGEM_NET_CFG_DBUS_WIDTH_32 |
 		CGEM_NET_CFG_MDC_CLK_DIV_64 |
 		CGEM_NET_CFG_FCS_REMOVE |
-		CGEM_NET_CFG_RX_BUF_OFFSET(ETHER_ALIGN) |
+		CGEM_NET_CFG_RX_BUF_OFFSET(rx_offset) |
 		CGEM_NET_CFG_GIGE_EN |
 		CGEM_NET_CFG_1536RXEN |
 		CGEM_NET_CFG_FULL_DUPLEX |
@@ -1062,10 +1106,7 @@ cgem_config(struct cgem_softc *sc)
 	WR4(sc, CGEM_SPEC_ADDR_HI(0), (eaddr[5] << 8) | eaddr[4]);
 
 	/* Set up interrupts. */
-	WR4(sc, CGEM_INTR_EN,
-	    CGEM_INTR_RX_COMPLETE | CGEM_INTR_RX_OVERRUN |
-	    CGEM_INTR_TX_USED_READ | CGEM_INTR_RX_USED_READ |
-	    CGEM_INTR_HRESP_NOT_OK);
+	WR4(sc, CGEM_INTR_EN, intr_en);
 }
 
 /* Turn on interface and load up receive ring with buffers. */
@@ -1079,6 +1120,11 @@ cgem_init_locked(struct cgem_softc *sc)
 	if ((if_getdrvflags(sc->ifp) & IFF_DRV_RUNNING) != 0)
 		return;
 
+#ifdef DEV_NETMAP
+	cgem_netmap_tx_init(sc);
+	cgem_netmap_rx_init(sc);
+#endif /* DEV_NETMAP */
+
 	cgem_config(sc);
 	cgem_fill_rqueue(sc);
 
@@ -1126,6 +1172,13 @@ cgem_stop(struct cgem_softc *sc)
 			sc->txring_m_dmamap[i] = NULL;
 			m_freem(sc->txring_m[i]);
 			sc->txring_m[i] = NULL;
+		} else if (sc->txring_m_dmamap[i] != NULL) {
+			/* Map left behind by netmap mode. */
+			bus_dmamap_unload(sc->mbuf_dma_tag,
+					  sc->txring_m_dmamap[i]);
+			bus_dmamap_destroy(sc->mbuf_dma_tag,
+					   sc->txring_m_dmamap[i]);
+			sc->txring_m_dmamap[i] = NULL;
 		}
 	}
 	sc->txring[CGEM_NUM_TX_DESCS - 1].ctl |= CGEM_TXDESC_WRAP;
@@ -1148,6 +1201,13 @@ cgem_stop(struct cgem_softc *sc)
 
 			m_freem(sc->rxring_m[i]);
 			sc->rxring_m[i] = NULL;
+		} else if (sc->rxring_m_dmamap[i] != NULL) {
+			/* Map left behind by netmap mode. */
+			bus_dmamap_unload(sc->mbuf_dma_tag,
+				  sc->rxring_m_dmamap[i]);
+			bus_dmamap_destroy(sc->mbuf_dma_tag,
+				   sc->rxring_m_dmamap[i]);
+			sc->rxring_m_dmamap[i] = NULL;
 		}
 	}
 	sc->rxring[CGEM_NUM_RX_DESCS - 1].addr |= CGEM_RXDESC_WRAP;
@@ -1749,6 +1809,10 @@ cgem_attach(device_t dev)
 
 	cgem_add_sysctls(dev);
 
+#ifdef DEV_NETMAP
+	cgem_netmap_attach(sc);
+#endif /* DEV_NETMAP */
+
 	return (0);
 }
 
@@ -1767,6 +1831,9 @@ cgem_detach(device_t dev)
 		CGEM_UNLOCK(sc);
 		callout_drain(&sc->tick_ch);
 		if_setflagbits(sc->ifp, 0, IFF_UP);
+#ifdef DEV_NETMAP
+		netmap_detach(sc->ifp);
+#endif /* DEV_NETMAP */
 		ether_ifdetach(sc->ifp);
 	}
 
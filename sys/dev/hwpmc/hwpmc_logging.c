@@ -45,6 +45,7 @@ __FBSDID("$FreeBSD$");
 #include <sys/kernel.h>
 #include <sys/kthread.h>
 #include <sys/lock.h>
+#include <sys/mman.h>
 #include <sys/module.h>
 #include <sys/mutex.h>
 #include <sys/pmc.h>
@@ -54,6 +55,7 @@ __FBSDID("$FreeBSD$");
 #include <sys/sched.h>
 #include <sys/signalvar.h>
 #include <sys/smp.h>
+#include <sys/stat.h>
 #include <sys/syscallsubr.h>
 #include <sys/sysctl.h>
 #include <sys/systm.h>
@@ -225,14 +227,34 @@ struct pmclog_buffer {
 	uint16_t	 plb_domain;
 } __aligned(CACHE_LINE_SIZE);
 
+/*
+ * Shared memory log rings.  The geometry is kept here rather than
+ * read back from the header page, which the owner can modify.
+ */
+
+#define	PMCLOG_RING_MINSIZE	(64*1024)	/* fits any record */
+#define	PMCLOG_RING_MAXSIZE	(1U << 30)
+
+struct pmclog_ring {
+	void		*plr_base;	/* kernel mapping of the object */
+	size_t		plr_len;	/* length of the mapping */
+	size_t		plr_stride;	/* distance between CPU areas */
+	uint32_t	plr_size;	/* record bytes per CPU */
+	uint32_t	plr_head[MAXCPU]; /* reserved up to here */
+};
+
 /*
  * Prototypes
  */
 
+static int pmclog_emit_initialize(struct pmc_mdep *md,
+    struct pmc_owner *po);
 static int pmclog_get_buffer(struct pmc_owner *po);
 static void pmclog_loop(void *arg);
 static void pmclog_release(struct pmc_owner *po);
 static uint32_t *pmclog_reserve(struct pmc_owner *po, int length);
+static void pmclog_ring_commit(struct pmc_owner *po);
+static uint32_t *pmclog_ring_reserve(struct pmc_owner *po, int length);
 static void pmclog_schedule_io(struct pmc_owner *po, int wakeup);
 static void pmclog_schedule_all(struct pmc_owner *po);
 static void pmclog_stop_kthread(struct pmc_owner *po);
@@ -255,6 +277,13 @@ pmc_plb_rele(struct pmclog_buffer *plb)
 	mtx_unlock_spin(&pmc_dom_hdrs[plb->plb_domain]->pdbh_mtx);
 }
 
+static inline struct pmclog_ring_control *
+pmclog_ring_control(struct pmclog_ring *ring, int cpu)
+{
+	return ((struct pmclog_ring_control *)((char *)ring->plr_base +
+	    PAGE_SIZE + cpu * ring->plr_stride));
+}
+
 /*
  * Get a log buffer
  */
@@ -514,6 +543,11 @@ pmclog_release_flags(struct pmc_owner *po, int wakeup)
 {
 	struct pmclog_buffer *plb;
 
+	if (po->po_ring != NULL) {
+		pmclog_ring_commit(po);
+		return;
+	}
+
 	plb = po->po_curbuf[curcpu];
 	KASSERT(plb->plb_ptr >= plb->plb_base,
 	    ("[pmclog,%d] buffer invariants po=%p ptr=%p base=%p", __LINE__,
@@ -561,6 +595,9 @@ pmclog_reserve(struct pmc_owner *po, int length)
 	if (po->po_flags & PMC_PO_SHUTDOWN)
 		return (NULL);
 
+	if (po->po_ring != NULL)
+		return (pmclog_ring_reserve(po, length));
+
 	pplb = &po->po_curbuf[curcpu];
 	if (*pplb == NULL && pmclog_get_buffer(po) != 0)
 		goto fail;
@@ -620,6 +657,56 @@ pmclog_reserve(struct pmc_owner *po, int length)
 	return (NULL);
 }
 
+/*
+ * Reserve 'length' bytes in the current CPU's shared memory ring.
+ * Only this CPU writes to the ring and the caller keeps us on it, so
+ * no lock is needed; the record becomes visible to the reader when
+ * pmclog_ring_commit() publishes the new head.  A full ring drops
+ * the record rather than block.
+ */
+
+static uint32_t *
+pmclog_ring_reserve(struct pmc_owner *po, int length)
+{
+	struct pmclog_ring *ring;
+	struct pmclog_ring_control *prc;
+	uint32_t head, off, skip, used;
+	char *data;
+
+	ring = po->po_ring;
+	prc = pmclog_ring_control(ring, curcpu);
+	head = ring->plr_head[curcpu];
+	used = head - atomic_load_acq_32(&prc->prc_tail);
+	off = head & (ring->plr_size - 1);
+	skip = off + length > ring->plr_size ? ring->plr_size - off : 0;
+
+	/* A bogus tail from the reader only costs it its own records. */
+	if (used > ring->plr_size || ring->plr_size - used < skip + length) {
+		prc->prc_dropped++;
+		counter_u64_add(pmc_stats.pm_buffer_requests_failed, 1);
+		return (NULL);
+	}
+
+	data = (char *)prc + PAGE_SIZE;
+	if (skip != 0) {
+		*(uint32_t *)(data + off) = 0;	/* wrap marker */
+		off = 0;
+	}
+	ring->plr_head[curcpu] = head + skip + length;
+
+	return ((uint32_t *)(data + off));
+}
+
+static void
+pmclog_ring_commit(struct pmc_owner *po)
+{
+	struct pmclog_ring *ring;
+
+	ring = po->po_ring;
+	atomic_store_rel_32(&pmclog_ring_control(ring, curcpu)->prc_head,
+	    ring->plr_head[curcpu]);
+}
+
 /*
  * Schedule an I/O.
  *
@@ -631,6 +718,11 @@ pmclog_schedule_io(struct pmc_owner *po, int wakeup)
 {
 	struct pmclog_buffer *plb;
 
+	if (po->po_ring != NULL) {
+		pmclog_ring_commit(po);
+		return;
+	}
+
 	plb = po->po_curbuf[curcpu];
 	po->po_curbuf[curcpu] = NULL;
 	KASSERT(plb != NULL,
@@ -676,6 +768,41 @@ pmclog_stop_kthread(struct pmc_owner *po)
 	mtx_unlock(&pmc_kthread_mtx);
 }
 
+/*
+ * Write the record that starts every log.
+ */
+
+static int
+pmclog_emit_initialize(struct pmc_mdep *md, struct pmc_owner *po)
+{
+	struct timespec ts;
+	uint64_t tsc;
+	int error;
+
+	error = 0;
+	nanotime(&ts);
+	tsc = pmc_rdtsc();
+	/* create a log initialization entry */
+	PMCLOG_RESERVE_WITH_ERROR(po, INITIALIZE,
+	    sizeof(struct pmclog_initialize));
+	PMCLOG_EMIT32(PMC_VERSION);
+	PMCLOG_EMIT32(md->pmd_cputype);
+#if defined(__i386__) || defined(__amd64__)
+	PMCLOG_EMIT64(tsc_freq);
+#else
+	/* other architectures will need to fill this in */
+	PMCLOG_EMIT32(0);
+	PMCLOG_EMIT32(0);
+#endif
+	memcpy(_le, &ts, sizeof(ts));
+	_le += sizeof(ts)/4;
+	PMCLOG_EMITSTRING(pmc_cpuid, PMC_CPUID_LEN);
+	PMCLOG_DESPATCH_SYNC(po);
+
+ error:
+	return (error);
+}
+
 /*
  * Public functions
  */
@@ -691,8 +818,6 @@ int
 pmclog_configure_log(struct pmc_mdep *md, struct pmc_owner *po, int logfd)
 {
 	struct proc *p;
-	struct timespec ts;
-	uint64_t tsc;
 	int error;
 
 	sx_assert(&pmc_sx, SA_XLOCKED);
@@ -720,26 +845,9 @@ pmclog_configure_log(struct pmc_mdep *md, struct pmc_owner *po, int logfd)
 	PROC_LOCK(p);
 	p->p_flag |= P_HWPMC;
 	PROC_UNLOCK(p);
-	nanotime(&ts);
-	tsc = pmc_rdtsc();
-	/* create a log initialization entry */
-	PMCLOG_RESERVE_WITH_ERROR(po, INITIALIZE,
-	    sizeof(struct pmclog_initialize));
-	PMCLOG_EMIT32(PMC_VERSION);
-	PMCLOG_EMIT32(md->pmd_cputype);
-#if defined(__i386__) || defined(__amd64__)
-	PMCLOG_EMIT64(tsc_freq);
-#else
-	/* other architectures will need to fill this in */
-	PMCLOG_EMIT32(0);
-	PMCLOG_EMIT32(0);
-#endif
-	memcpy(_le, &ts, sizeof(ts));
-	_le += sizeof(ts)/4;
-	PMCLOG_EMITSTRING(pmc_cpuid, PMC_CPUID_LEN);
-	PMCLOG_DESPATCH_SYNC(po);
 
-	return (0);
+	if ((error = pmclog_emit_initialize(md, po)) == 0)
+		return (0);
 
  error:
 	KASSERT(po->po_kthread == NULL, ("[pmclog,%d] po=%p kthread not "
@@ -754,6 +862,99 @@ pmclog_configure_log(struct pmc_mdep *md, struct pmc_owner *po, int logfd)
 	return (error);
 }
 
+/*
+ * Configure shared memory log rings for pmc owner 'po'.
+ *
+ * Parameter 'shmfd' references a POSIX shared memory object in the
+ * owner process, which the owner maps to read the records in place.
+ * The object is split into per-CPU rings as described in
+ * <sys/pmclog.h>, each a power of 2 in size.  No helper kthread is
+ * involved.
+ */
+
+int
+pmclog_configure_ring(struct pmc_mdep *md, struct pmc_owner *po, int shmfd)
+{
+	struct pmclog_ring_header *prh;
+	struct pmclog_ring *ring;
+	struct stat sb;
+	struct proc *p;
+	size_t area;
+	u_int cpu, ncpu;
+	int error;
+
+	sx_assert(&pmc_sx, SA_XLOCKED);
+	PMCDBG2(LOG,CFG,1, "config po=%p shmfd=%d", po, shmfd);
+
+	p = po->po_owner;
+
+	/* return EBUSY if a log file was already present */
+	if (po->po_flags & PMC_PO_OWNS_LOGFILE)
+		return (EBUSY);
+
+	KASSERT(po->po_file == NULL,
+	    ("[pmclog,%d] po=%p file (%p) already present", __LINE__, po,
+		po->po_file));
+
+	error = fget(curthread, shmfd, &cap_mmap_rights, &po->po_file);
+	if (error)
+		return (error);
+	ring = NULL;
+	if ((error = fo_stat(po->po_file, &sb, curthread->td_ucred,
+	    curthread)) != 0)
+		goto error;
+
+	ncpu = pmc_cpu_max();
+	area = sb.st_size > PAGE_SIZE ? (sb.st_size - PAGE_SIZE) / ncpu : 0;
+	if (area < PAGE_SIZE + PMCLOG_RING_MINSIZE) {
+		error = EINVAL;
+		goto error;
+	}
+	area = MIN(area - PAGE_SIZE, PMCLOG_RING_MAXSIZE);
+
+	ring = malloc(sizeof(*ring), M_PMC, M_WAITOK | M_ZERO);
+	ring->plr_size = 1U << (flsl(area) - 1);
+	ring->plr_stride = PAGE_SIZE + ring->plr_size;
+	ring->plr_len = PAGE_SIZE + ncpu * ring->plr_stride;
+	if ((error = shm_map(po->po_file, ring->plr_len, 0,
+	    &ring->plr_base)) != 0)
+		goto error;
+
+	/* The reader may have left anything in the object. */
+	prh = ring->plr_base;
+	bzero(prh, PAGE_SIZE);
+	for (cpu = 0; cpu < ncpu; cpu++)
+		bzero(pmclog_ring_control(ring, cpu), PAGE_SIZE);
+	prh->prh_version = PMCLOG_RING_VERSION;
+	prh->prh_ncpu = ncpu;
+	prh->prh_pagesize = PAGE_SIZE;
+	prh->prh_size = ring->plr_size;
+	prh->prh_stride = ring->plr_stride;
+	atomic_store_rel_32(&prh->prh_magic, PMCLOG_RING_MAGIC);
+
+	po->po_ring = ring;
+	po->po_flags |= PMC_PO_OWNS_LOGFILE;
+
+	/* mark process as using HWPMCs */
+	PROC_LOCK(p);
+	p->p_flag |= P_HWPMC;
+	PROC_UNLOCK(p);
+
+	if ((error = pmclog_emit_initialize(md, po)) == 0)
+		return (0);
+
+	po->po_ring = NULL;
+	po->po_flags &= ~PMC_PO_OWNS_LOGFILE;
+	(void) shm_unmap(po->po_file, ring->plr_base, ring->plr_len);
+ error:
+	free(ring, M_PMC);
+	(void) fdrop(po->po_file, curthread);
+	po->po_file = NULL;
+	po->po_error = 0;
+
+	return (error);
+}
+
 
 /*
  * De-configure a log file.  This will throw away any buffers queued
@@ -802,6 +1003,14 @@ pmclog_deconfigure_log(struct pmc_owner *po)
 	sched_unbind(curthread);
 	thread_unlock(curthread);
 
+	/* producers are gone, release the kernel mapping of the rings */
+	if (po->po_ring != NULL) {
+		(void) shm_unmap(po->po_file, po->po_ring->plr_base,
+		    po->po_ring->plr_len);
+		free(po->po_ring, M_PMC);
+		po->po_ring = NULL;
+	}
+
 	/* drop a reference to the fd */
 	if (po->po_file != NULL) {
 		error = fdrop(po->po_file, curthread);
@@ -3470,6 +3470,30 @@ pmc_syscall_handler(struct thread *td, void *syscall_args)
 	}
 	break;
 
+	/*
+	 * Configure shared memory log rings.  They are torn down like
+	 * a log file, with CONFIGURELOG and a negative fd.
+	 */
+
+	case PMC_OP_CONFIGURERING:
+	{
+		struct pmc_owner *po;
+		struct pmc_op_configurelog cl;
+
+		if ((error = copyin(arg, &cl, sizeof(cl))) != 0)
+			break;
+
+		if ((po = pmc_find_owner_descriptor(td->td_proc)) == NULL)
+			if ((po = pmc_allocate_owner_descriptor(td->td_proc)) ==
+			    NULL) {
+				error = ENOMEM;
+				break;
+			}
+
+		error = pmclog_configure_ring(md, po, cl.pm_logfd);
+	}
+	break;
+
 	/*
 	 * Flush a log file.
 	 */
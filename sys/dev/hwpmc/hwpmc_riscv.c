@@ -0,0 +1,709 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause-FreeBSD
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * RISC-V hardware performance counters.
+ *
+ * Supervisor mode can read the cycle, instret and hpmcounter CSRs but
+ * can neither select events nor write the counters; both are done by
+ * the firmware through the SBI PMU extension.  Each SBI counter index
+ * is one PMC row.  Without the extension only cycle and instret are
+ * available, for counting.  Sampling needs the Sscofpmf extension,
+ * which raises a local counter-overflow interrupt.
+ */
+
+#include <sys/cdefs.h>
+__FBSDID("$FreeBSD$");
+
+#include <sys/param.h>
+#include <sys/systm.h>
+#include <sys/pmc.h>
+#include <sys/pmckern.h>
+
+#include <machine/pmc_mdep.h>
+#include <machine/cpu.h>
+#include <machine/cpufunc.h>
+#include <machine/riscvreg.h>
+
+/* SBI base extension */
+#define	SBI_EXT_ID_BASE			0x10
+#define	SBI_BASE_PROBE_EXTENSION	3
+
+/* SBI PMU extension */
+#define	SBI_EXT_ID_PMU			0x504D55
+#define	SBI_PMU_NUM_COUNTERS		0
+#define	SBI_PMU_COUNTER_GET_INFO	1
+#define	SBI_PMU_COUNTER_CONFIG_MATCHING	2
+#define	SBI_PMU_COUNTER_START		3
+#define	SBI_PMU_COUNTER_STOP		4
+
+#define	SBI_PMU_CFG_FLAG_SET_UINH	(1 << 5)
+#define	SBI_PMU_CFG_FLAG_SET_SINH	(1 << 6)
+#define	SBI_PMU_START_FLAG_SET_INIT_VALUE (1 << 0)
+#define	SBI_PMU_STOP_FLAG_RESET		(1 << 0)
+
+#define	SBI_PMU_INFO_CSR(i)		((i) & 0xfff)
+#define	SBI_PMU_INFO_WIDTH(i)		((((i) >> 12) & 0x3f) + 1)
+#define	SBI_PMU_INFO_FIRMWARE		(1ul << 63)
+
+/* SBI event indices, the event type is in bits 16 to 19. */
+#define	SBI_PMU_HW_EVENT(code)		(code)
+#define	SBI_PMU_CACHE_EVENT(id, op, res)			\
+	((1 << 16) | ((id) << 3) | ((op) << 1) | (res))
+
+#define	SBI_PMU_HW_CPU_CYCLES		SBI_PMU_HW_EVENT(1)
+#define	SBI_PMU_HW_INSTRUCTIONS		SBI_PMU_HW_EVENT(2)
+
+#define	CACHE_L1D		0
+#define	CACHE_L1I		1
+#define	CACHE_LL		2
+#define	CACHE_DTLB		3
+#define	CACHE_ITLB		4
+#define	CACHE_BPU		5
+#define	CACHE_OP_READ		0
+#define	CACHE_OP_WRITE		1
+#define	CACHE_ACCESS		0
+#define	CACHE_MISS		1
+
+/* Counter CSRs */
+#define	RISCV_CSR_CYCLE		0xc00
+#define	RISCV_CSR_TIME		0xc01
+#define	RISCV_CSR_INSTRET	0xc02
+#define	RISCV_CSR_HPMCOUNTER31	0xc1f
+
+#define	RISCV_MAX_PMCS		32
+
+struct riscv_event_code_map {
+	enum pmc_event	pe_ev;
+	uint32_t	pe_code;
+};
+
+#define	HW(ev, code)	{ PMC_EV_RISCV_##ev, SBI_PMU_HW_EVENT(code) }
+#define	CACHE(ev, id, op, res)						\
+	{ PMC_EV_RISCV_##ev, SBI_PMU_CACHE_EVENT(CACHE_##id,		\
+	    CACHE_OP_##op, CACHE_##res) }
+
+static const struct riscv_event_code_map riscv_event_codes[] = {
+	HW(CPU_CYCLES,			1),
+	HW(INSTRUCTIONS,		2),
+	HW(CACHE_REFERENCES,		3),
+	HW(CACHE_MISSES,		4),
+	HW(BRANCH_INSTRUCTIONS,		5),
+	HW(BRANCH_MISSES,		6),
+	HW(BUS_CYCLES,			7),
+	HW(STALLED_CYCLES_FRONTEND,	8),
+	HW(STALLED_CYCLES_BACKEND,	9),
+	HW(REF_CPU_CYCLES,		10),
+	CACHE(L1D_READ_ACCESS,		L1D,	READ,	ACCESS),
+	CACHE(L1D_READ_MISS,		L1D,	READ,	MISS),
+	CACHE(L1D_WRITE_ACCESS,		L1D,	WRITE,	ACCESS),
+	CACHE(L1D_WRITE_MISS,		L1D,	WRITE,	MISS),
+	CACHE(L1I_READ_ACCESS,		L1I,	READ,	ACCESS),
+	CACHE(L1I_READ_MISS,		L1I,	READ,	MISS),
+	CACHE(LL_READ_ACCESS,		LL,	READ,	ACCESS),
+	CACHE(LL_READ_MISS,		LL,	READ,	MISS),
+	CACHE(LL_WRITE_ACCESS,		LL,	WRITE,	ACCESS),
+	CACHE(LL_WRITE_MISS,		LL,	WRITE,	MISS),
+	CACHE(DTLB_READ_ACCESS,		DTLB,	READ,	ACCESS),
+	CACHE(DTLB_READ_MISS,		DTLB,	READ,	MISS),
+	CACHE(ITLB_READ_ACCESS,		ITLB,	READ,	ACCESS),
+	CACHE(ITLB_READ_MISS,		ITLB,	READ,	MISS),
+	CACHE(BPU_READ_ACCESS,		BPU,	READ,	ACCESS),
+	CACHE(BPU_READ_MISS,		BPU,	READ,	MISS),
+};
+
+#undef	HW
+#undef	CACHE
+
+static int riscv_npmcs;
+static bool riscv_pmu_sbi;		/* SBI PMU extension present */
+static bool riscv_pmu_sampling;		/* Sscofpmf overflow interrupt */
+static u_int riscv_pmc_csr[RISCV_MAX_PMCS];	/* 0 if row is unusable */
+static uint64_t riscv_pmc_mask[RISCV_MAX_PMCS];
+
+/*
+ * Per-processor information.
+ */
+struct riscv_cpu {
+	struct pmc_hw	*pc_riscvpmcs;
+	pmc_value_t	pc_value[RISCV_MAX_PMCS];	/* While stopped */
+	pmc_value_t	pc_offset[RISCV_MAX_PMCS];	/* Without SBI PMU */
+	uint32_t	pc_running;
+};
+
+static struct riscv_cpu **riscv_pcpu;
+
+struct riscv_sbiret {
+	long	error;
+	long	value;
+};
+
+static struct riscv_sbiret
+riscv_sbi_call(u_long ext, u_long func, u_long arg0, u_long arg1,
+    u_long arg2, u_long arg3, u_long arg4)
+{
+	struct riscv_sbiret ret;
+
+	register uintptr_t a0 __asm ("a0") = (uintptr_t)(arg0);
+	register uintptr_t a1 __asm ("a1") = (uintptr_t)(arg1);
+	register uintptr_t a2 __asm ("a2") = (uintptr_t)(arg2);
+	register uintptr_t a3 __asm ("a3") = (uintptr_t)(arg3);
+	register uintptr_t a4 __asm ("a4") = (uintptr_t)(arg4);
+	register uintptr_t a6 __asm ("a6") = (uintptr_t)(func);
+	register uintptr_t a7 __asm ("a7") = (uintptr_t)(ext);
+
+	__asm __volatile(
+	    "ecall"
+	    : "+r" (a0), "+r" (a1)
+	    : "r" (a2), "r" (a3), "r" (a4), "r" (a6), "r" (a7)
+	    : "memory");
+
+	ret.error = a0;
+	ret.value = a1;
+
+	return (ret);
+}
+
+#define	RISCV_CSR_CASE(n)						\
+	case RISCV_CSR_CYCLE + (n):					\
+		return (csr_read(0xc00 + n))
+
+static uint64_t
+riscv_csr_read(u_int csr)
+{
+
+	switch (csr) {
+	RISCV_CSR_CASE(0);	RISCV_CSR_CASE(1);	RISCV_CSR_CASE(2);
+	RISCV_CSR_CASE(3);	RISCV_CSR_CASE(4);	RISCV_CSR_CASE(5);
+	RISCV_CSR_CASE(6);	RISCV_CSR_CASE(7);	RISCV_CSR_CASE(8);
+	RISCV_CSR_CASE(9);	RISCV_CSR_CASE(10);	RISCV_CSR_CASE(11);
+	RISCV_CSR_CASE(12);	RISCV_CSR_CASE(13);	RISCV_CSR_CASE(14);
+	RISCV_CSR_CASE(15);	RISCV_CSR_CASE(16);	RISCV_CSR_CASE(17);
+	RISCV_CSR_CASE(18);	RISCV_CSR_CASE(19);	RISCV_CSR_CASE(20);
+	RISCV_CSR_CASE(21);	RISCV_CSR_CASE(22);	RISCV_CSR_CASE(23);
+	RISCV_CSR_CASE(24);	RISCV_CSR_CASE(25);	RISCV_CSR_CASE(26);
+	RISCV_CSR_CASE(27);	RISCV_CSR_CASE(28);	RISCV_CSR_CASE(29);
+	RISCV_CSR_CASE(30);	RISCV_CSR_CASE(31);
+	default:
+		panic("%s: invalid counter CSR %#x", __func__, csr);
+	}
+}
+
+#undef	RISCV_CSR_CASE
+
+static __inline pmc_value_t
+riscv_pmcn_read(struct riscv_cpu *pac, int ri)
+{
+
+	if ((pac->pc_running & (1u << ri)) == 0)
+		return (pac->pc_value[ri]);
+
+	return ((riscv_csr_read(riscv_pmc_csr[ri]) + pac->pc_offset[ri]) &
+	    riscv_pmc_mask[ri]);
+}
+
+/*
+ * Have the firmware program the counter for the event and start it
+ * from the saved value.
+ */
+static int
+riscv_counter_start(struct riscv_cpu *pac, int ri, struct pmc *pm)
+{
+	struct riscv_sbiret ret;
+
+	if (!riscv_pmu_sbi) {
+		pac->pc_offset[ri] = pac->pc_value[ri] -
+		    riscv_csr_read(riscv_pmc_csr[ri]);
+		pac->pc_running |= 1u << ri;
+		return (0);
+	}
+
+	ret = riscv_sbi_call(SBI_EXT_ID_PMU, SBI_PMU_COUNTER_CONFIG_MATCHING,
+	    ri, 1, pm->pm_md.pm_riscv.pm_riscv_cfg,
+	    pm->pm_md.pm_riscv.pm_riscv_evsel, 0);
+	if (ret.error != 0 || ret.value != ri)
+		return (EINVAL);
+
+	ret = riscv_sbi_call(SBI_EXT_ID_PMU, SBI_PMU_COUNTER_START, ri, 1,
+	    SBI_PMU_START_FLAG_SET_INIT_VALUE, pac->pc_value[ri], 0);
+	if (ret.error != 0)
+		return (EIO);
+
+	pac->pc_running |= 1u << ri;
+
+	return (0);
+}
+
+/*
+ * Stop the counter and release it in the firmware, but keep the
+ * count for riscv_pmcn_read().
+ */
+static void
+riscv_counter_stop(struct riscv_cpu *pac, int ri)
+{
+
+	if ((pac->pc_running & (1u << ri)) == 0)
+		return;
+
+	if (riscv_pmu_sbi)
+		riscv_sbi_call(SBI_EXT_ID_PMU, SBI_PMU_COUNTER_STOP, ri, 1,
+		    SBI_PMU_STOP_FLAG_RESET, 0, 0);
+	pac->pc_value[ri] = riscv_pmcn_read(pac, ri);
+	pac->pc_running &= ~(1u << ri);
+}
+
+static int
+riscv_allocate_pmc(int cpu, int ri, struct pmc *pm,
+  const struct pmc_op_pmcallocate *a)
+{
+	uint32_t caps, cfg, code;
+	enum pmc_event pe;
+	int i;
+
+	KASSERT(cpu >= 0 && cpu < pmc_cpu_max(),
+	    ("[riscv,%d] illegal CPU value %d", __LINE__, cpu));
+	KASSERT(ri >= 0 && ri < riscv_npmcs,
+	    ("[riscv,%d] illegal row index %d", __LINE__, ri));
+
+	if (a->pm_class != PMC_CLASS_RISCV)
+		return (EINVAL);
+	if (riscv_pmc_csr[ri] == 0)
+		return (EINVAL);
+	if (PMC_IS_SAMPLING_MODE(a->pm_mode) && !riscv_pmu_sampling)
+		return (EINVAL);
+
+	pe = a->pm_ev;
+	for (i = 0; i < nitems(riscv_event_codes); i++)
+		if (riscv_event_codes[i].pe_ev == pe)
+			break;
+	if (i == nitems(riscv_event_codes))
+		return (EINVAL);
+	code = riscv_event_codes[i].pe_code;
+
+	/* cycle and instret only count their own event. */
+	if (riscv_pmc_csr[ri] == RISCV_CSR_CYCLE &&
+	    code != SBI_PMU_HW_CPU_CYCLES)
+		return (EINVAL);
+	if (riscv_pmc_csr[ri] == RISCV_CSR_INSTRET &&
+	    code != SBI_PMU_HW_INSTRUCTIONS)
+		return (EINVAL);
+	if (!riscv_pmu_sbi && riscv_pmc_csr[ri] != RISCV_CSR_CYCLE &&
+	    riscv_pmc_csr[ri] != RISCV_CSR_INSTRET)
+		return (EINVAL);
+
+	/*
+	 * Only the firmware can filter by privilege level, without it
+	 * the counters include both user and kernel events.
+	 */
+	cfg = 0;
+	caps = a->pm_caps;
+	if ((caps & (PMC_CAP_USER | PMC_CAP_SYSTEM)) != 0) {
+		if ((caps & PMC_CAP_USER) == 0)
+			cfg |= SBI_PMU_CFG_FLAG_SET_UINH;
+		if ((caps & PMC_CAP_SYSTEM) == 0)
+			cfg |= SBI_PMU_CFG_FLAG_SET_SINH;
+	}
+
+	pm->pm_md.pm_riscv.pm_riscv_evsel = code;
+	pm->pm_md.pm_riscv.pm_riscv_cfg = cfg;
+
+	PMCDBG3(MDP, ALL, 2, "riscv-allocate ri=%d -> code=0x%x cfg=0x%x",
+	    ri, code, cfg);
+
+	return (0);
+}
+
+static int
+riscv_read_pmc(int cpu, int ri, pmc_value_t *v)
+{
+	pmc_value_t tmp;
+	struct pmc *pm;
+
+	KASSERT(cpu >= 0 && cpu < pmc_cpu_max(),
+	    ("[riscv,%d] illegal CPU value %d", __LINE__, cpu));
+	KASSERT(ri >= 0 && ri < riscv_npmcs,
+	    ("[riscv,%d] illegal row index %d", __LINE__, ri));
+
+	pm  = riscv_pcpu[cpu]->pc_riscvpmcs[ri].phw_pmc;
+
+	tmp = riscv_pmcn_read(riscv_pcpu[cpu], ri);
+
+	PMCDBG2(MDP, REA, 2, "riscv-read id=%d -> %jd", ri, tmp);
+	if (PMC_IS_SAMPLING_MODE(PMC_TO_MODE(pm)))
+		*v = RISCV_PERFCTR_VALUE_TO_RELOAD_COUNT(tmp) &
+		    riscv_pmc_mask[ri];
+	else
+		*v = tmp;
+
+	return (0);
+}
+
+static int
+riscv_write_pmc(int cpu, int ri, pmc_value_t v)
+{
+	struct riscv_cpu *pac;
+	struct pmc *pm;
+
+	KASSERT(cpu >= 0 && cpu < pmc_cpu_max(),
+	    ("[riscv,%d] illegal CPU value %d", __LINE__, cpu));
+	KASSERT(ri >= 0 && ri < riscv_npmcs,
+	    ("[riscv,%d] illegal row-index %d", __LINE__, ri));
+
+	pac = riscv_pcpu[cpu];
+	pm  = pac->pc_riscvpmcs[ri].phw_pmc;
+
+	if (PMC_IS_SAMPLING_MODE(PMC_TO_MODE(pm)))
+		v = RISCV_RELOAD_COUNT_TO_PERFCTR_VALUE(v);
+	v &= riscv_pmc_mask[ri];
+
+	PMCDBG3(MDP, WRI, 1, "riscv-write cpu=%d ri=%d v=%jx", cpu, ri, v);
+
+	/* The counters can only be set when the firmware starts them. */
+	if ((pac->pc_running & (1u << ri)) != 0) {
+		riscv_counter_stop(pac, ri);
+		pac->pc_value[ri] = v;
+		return (riscv_counter_start(pac, ri, pm));
+	}
+	pac->pc_value[ri] = v;
+
+	return (0);
+}
+
+static int
+riscv_config_pmc(int cpu, int ri, struct pmc *pm)
+{
+	struct pmc_hw *phw;
+
+	PMCDBG3(MDP, CFG, 1, "cpu=%d ri=%d pm=%p", cpu, ri, pm);
+
+	KASSERT(cpu >= 0 && cpu < pmc_cpu_max(),
+	    ("[riscv,%d] illegal CPU value %d", __LINE__, cpu));
+	KASSERT(ri >= 0 && ri < riscv_npmcs,
+	    ("[riscv,%d] illegal row-index %d", __LINE__, ri));
+
+	phw = &riscv_pcpu[cpu]->pc_riscvpmcs[ri];
+
+	KASSERT(pm == NULL || phw->phw_pmc == NULL,
+	    ("[riscv,%d] pm=%p phw->pm=%p hwpmc not unconfigured",
+	    __LINE__, pm, phw->phw_pmc));
+
+	phw->phw_pmc = pm;
+
+	return (0);
+}
+
+static int
+riscv_start_pmc(int cpu, int ri)
+{
+	struct riscv_cpu *pac;
+	struct pmc *pm;
+
+	pac = riscv_pcpu[cpu];
+	pm  = pac->pc_riscvpmcs[ri].phw_pmc;
+
+	return (riscv_counter_start(pac, ri, pm));
+}
+
+static int
+riscv_stop_pmc(int cpu, int ri)
+{
+
+	riscv_counter_stop(riscv_pcpu[cpu], ri);
+
+	return (0);
+}
+
+static int
+riscv_release_pmc(int cpu, int ri, struct pmc *pmc)
+{
+	struct pmc_hw *phw;
+
+	KASSERT(cpu >= 0 && cpu < pmc_cpu_max(),
+	    ("[riscv,%d] illegal CPU value %d", __LINE__, cpu));
+	KASSERT(ri >= 0 && ri < riscv_npmcs,
+	    ("[riscv,%d] illegal row-index %d", __LINE__, ri));
+
+	phw = &riscv_pcpu[cpu]->pc_riscvpmcs[ri];
+	KASSERT(phw->phw_pmc == NULL,
+	    ("[riscv,%d] PHW pmc %p non-NULL", __LINE__, phw->phw_pmc));
+
+	return (0);
+}
+
+static int
+riscv_intr(struct trapframe *tf)
+{
+	struct riscv_cpu *pac;
+	int retval, ri;
+	struct pmc *pm;
+	uint64_t ovf;
+	int error;
+	int cpu;
+
+	cpu = curcpu;
+	KASSERT(cpu >= 0 && cpu < pmc_cpu_max(),
+	    ("[riscv,%d] CPU %d out of range", __LINE__, cpu));
+
+	retval = 0;
+	pac = riscv_pcpu[cpu];
+
+	/* scountovf mirrors the overflow flag of each counter CSR. */
+	ovf = csr_read(0xda0);
+	csr_clear(sip, SIP_LCOFIP);
+
+	for (ri = 0; ri < riscv_npmcs; ri++) {
+		pm = pac->pc_riscvpmcs[ri].phw_pmc;
+		if (pm == NULL)
+			continue;
+		if (!PMC_IS_SAMPLING_MODE(PMC_TO_MODE(pm)))
+			continue;
+		if ((ovf & (1ul << (riscv_pmc_csr[ri] - RISCV_CSR_CYCLE))) == 0)
+			continue;
+
+		retval = 1; /* Found an interrupting PMC. */
+		if (pm->pm_state != PMC_STATE_RUNNING)
+			continue;
+
+		error = pmc_process_interrupt(PMC_HR, pm, tf);
+
+		/*
+		 * Reload the sampling count.  Restarting the counter also
+		 * clears its overflow flag.
+		 */
+		riscv_counter_stop(pac, ri);
+		riscv_write_pmc(cpu, ri, pm->pm_sc.pm_reloadcount);
+		if (error == 0)
+			riscv_counter_start(pac, ri, pm);
+	}
+
+	return (retval);
+}
+
+static int
+riscv_describe(int cpu, int ri, struct pmc_info *pi, struct pmc **ppmc)
+{
+	char riscv_name[PMC_NAME_MAX];
+	struct pmc_hw *phw;
+	int error;
+
+	KASSERT(cpu >= 0 && cpu < pmc_cpu_max(),
+	    ("[riscv,%d], illegal CPU %d", __LINE__, cpu));
+	KASSERT(ri >= 0 && ri < riscv_npmcs,
+	    ("[riscv,%d] row-index %d out of range", __LINE__, ri));
+
+	phw = &riscv_pcpu[cpu]->pc_riscvpmcs[ri];
+	snprintf(riscv_name, sizeof(riscv_name), "RISCV-%d", ri);
+	if ((error = copystr(riscv_name, pi->pm_name, PMC_NAME_MAX,
+	    NULL)) != 0)
+		return (error);
+	pi->pm_class = PMC_CLASS_RISCV;
+	if (phw->phw_state & PMC_PHW_FLAG_IS_ENABLED) {
+		pi->pm_enabled = TRUE;
+		*ppmc = phw->phw_pmc;
+	} else {
+		pi->pm_enabled = FALSE;
+		*ppmc = NULL;
+	}
+
+	return (0);
+}
+
+static int
+riscv_get_config(int cpu, int ri, struct pmc **ppm)
+{
+
+	*ppm = riscv_pcpu[cpu]->pc_riscvpmcs[ri].phw_pmc;
+
+	return (0);
+}
+
+static int
+riscv_switch_in(struct pmc_cpu *pc, struct pmc_process *pp)
+{
+
+	return (0);
+}
+
+static int
+riscv_switch_out(struct pmc_cpu *pc, struct pmc_process *pp)
+{
+
+	return (0);
+}
+
+static int
+riscv_pcpu_init(struct pmc_mdep *md, int cpu)
+{
+	struct riscv_cpu *pac;
+	struct pmc_hw  *phw;
+	struct pmc_cpu *pc;
+	int first_ri;
+	int i;
+
+	KASSERT(cpu >= 0 && cpu < pmc_cpu_max(),
+	    ("[riscv,%d] wrong cpu number %d", __LINE__, cpu));
+	PMCDBG1(MDP, INI, 1, "riscv-init cpu=%d", cpu);
+
+	riscv_pcpu[cpu] = pac = malloc(sizeof(struct riscv_cpu), M_PMC,
+	    M_WAITOK | M_ZERO);
+
+	pac->pc_riscvpmcs = malloc(sizeof(struct pmc_hw) * riscv_npmcs,
+	    M_PMC, M_WAITOK | M_ZERO);
+	pc = pmc_pcpu[cpu];
+	first_ri = md->pmd_classdep[PMC_MDEP_CLASS_INDEX_RISCV].pcd_ri;
+	KASSERT(pc != NULL, ("[riscv,%d] NULL per-cpu pointer", __LINE__));
+
+	for (i = 0, phw = pac->pc_riscvpmcs; i < riscv_npmcs; i++, phw++) {
+		phw->phw_state    = PMC_PHW_CPU_TO_STATE(cpu) |
+		    PMC_PHW_INDEX_TO_STATE(i);
+		if (riscv_pmc_csr[i] != 0)
+			phw->phw_state |= PMC_PHW_FLAG_IS_ENABLED;
+		phw->phw_pmc      = NULL;
+		pc->pc_hwpmcs[i + first_ri] = phw;
+	}
+
+	/* This runs on the target CPU, unmask its overflow interrupt. */
+	if (riscv_pmu_sampling)
+		csr_set(sie, SIE_LCOFIE);
+
+	return (0);
+}
+
+static int
+riscv_pcpu_fini(struct pmc_mdep *md, int cpu)
+{
+	struct riscv_cpu *pac;
+
+	if (riscv_pmu_sampling)
+		csr_clear(sie, SIE_LCOFIE);
+
+	pac = riscv_pcpu[cpu];
+	free(pac->pc_riscvpmcs, M_PMC);
+	free(pac, M_PMC);
+	riscv_pcpu[cpu] = NULL;
+
+	return (0);
+}
+
+struct pmc_mdep *
+pmc_riscv_initialize()
+{
+	struct pmc_mdep *pmc_mdep;
+	struct pmc_classdep *pcd;
+	struct riscv_sbiret ret;
+	u_long info;
+	u_int csr, width;
+	int i;
+
+	ret = riscv_sbi_call(SBI_EXT_ID_BASE, SBI_BASE_PROBE_EXTENSION,
+	    SBI_EXT_ID_PMU, 0, 0, 0, 0);
+	riscv_pmu_sbi = (ret.error == 0 && ret.value != 0);
+
+	if (riscv_pmu_sbi) {
+		ret = riscv_sbi_call(SBI_EXT_ID_PMU, SBI_PMU_NUM_COUNTERS,
+		    0, 0, 0, 0, 0);
+		riscv_npmcs = MIN(ret.value, RISCV_MAX_PMCS);
+		for (i = 0; i < riscv_npmcs; i++) {
+			ret = riscv_sbi_call(SBI_EXT_ID_PMU,
+			    SBI_PMU_COUNTER_GET_INFO, i, 0, 0, 0, 0);
+			info = ret.value;
+			if (ret.error != 0 ||
+			    (info & SBI_PMU_INFO_FIRMWARE) != 0)
+				continue;
+			csr = SBI_PMU_INFO_CSR(info);
+			width = SBI_PMU_INFO_WIDTH(info);
+			if (csr < RISCV_CSR_CYCLE ||
+			    csr > RISCV_CSR_HPMCOUNTER31 ||
+			    csr == RISCV_CSR_TIME)
+				continue;
+			riscv_pmc_csr[i] = csr;
+			riscv_pmc_mask[i] = width < 64 ?
+			    (1ul << width) - 1 : ~0ul;
+		}
+
+		/* sie.LCOFIE is read-only zero without Sscofpmf. */
+		csr_set(sie, SIE_LCOFIE);
+		riscv_pmu_sampling = (csr_read(sie) & SIE_LCOFIE) != 0;
+		csr_clear(sie, SIE_LCOFIE);
+	} else {
+		/* Rows match the counter CSRs, row 1 is the time CSR. */
+		riscv_npmcs = 3;
+		riscv_pmc_csr[0] = RISCV_CSR_CYCLE;
+		riscv_pmc_csr[2] = RISCV_CSR_INSTRET;
+		riscv_pmc_mask[0] = riscv_pmc_mask[2] = ~0ul;
+		riscv_pmu_sampling = false;
+	}
+
+	PMCDBG3(MDP, INI, 1, "riscv-init npmcs=%d sbi=%d sampling=%d",
+	    riscv_npmcs, riscv_pmu_sbi, riscv_pmu_sampling);
+
+	/*
+	 * Allocate space for pointers to PMC HW descriptors and for
+	 * the MDEP structure used by MI code.
+	 */
+	riscv_pcpu = malloc(sizeof(struct riscv_cpu *) * pmc_cpu_max(),
+		M_PMC, M_WAITOK | M_ZERO);
+
+	/* Just one class */
+	pmc_mdep = pmc_mdep_alloc(1);
+	pmc_mdep->pmd_cputype = PMC_CPU_RISCV_RV64;
+
+	pcd = &pmc_mdep->pmd_classdep[PMC_MDEP_CLASS_INDEX_RISCV];
+	pcd->pcd_caps  = RISCV_PMC_CAPS;
+	if (!riscv_pmu_sampling)
+		pcd->pcd_caps &= ~PMC_CAP_INTERRUPT;
+	pcd->pcd_class = PMC_CLASS_RISCV;
+	pcd->pcd_num   = riscv_npmcs;
+	pcd->pcd_ri    = pmc_mdep->pmd_npmc;
+	pcd->pcd_width = 64;
+
+	pcd->pcd_allocate_pmc   = riscv_allocate_pmc;
+	pcd->pcd_config_pmc     = riscv_config_pmc;
+	pcd->pcd_pcpu_fini      = riscv_pcpu_fini;
+	pcd->pcd_pcpu_init      = riscv_pcpu_init;
+	pcd->pcd_describe       = riscv_describe;
+	pcd->pcd_get_config     = riscv_get_config;
+	pcd->pcd_read_pmc       = riscv_read_pmc;
+	pcd->pcd_release_pmc    = riscv_release_pmc;
+	pcd->pcd_start_pmc      = riscv_start_pmc;
+	pcd->pcd_stop_pmc       = riscv_stop_pmc;
+	pcd->pcd_write_pmc      = riscv_write_pmc;
+
+	pmc_mdep->pmd_intr       = riscv_intr;
+	pmc_mdep->pmd_switch_in  = riscv_switch_in;
+	pmc_mdep->pmd_switch_out = riscv_switch_out;
+
+	pmc_mdep->pmd_npmc   += riscv_npmcs;
+
+	return (pmc_mdep);
+}
+
+void
+pmc_riscv_finalize(struct pmc_mdep *md)
+{
+
+	free(riscv_pcpu, M_PMC);
+	riscv_pcpu = NULL;
+}
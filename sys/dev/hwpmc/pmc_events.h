@@ -1753,6 +1753,41 @@ __PMC_EV_ALIAS("unhalted-core-cycles",		IAP_ARCH_UNH_COR_CYC)
 
 #define PMC_EV_E500_FIRST		PMC_EV_E500_CYCLES
 #define PMC_EV_E500_LAST		PMC_EV_E500_STWCX_FAILURES
+
+/*
+ * RISC-V events, the generic hardware and cache events of the SBI PMU
+ * extension.
+ */
+#define	__PMC_EV_RISCV()			\
+	__PMC_EV(RISCV, CPU_CYCLES)		\
+	__PMC_EV(RISCV, INSTRUCTIONS)		\
+	__PMC_EV(RISCV, CACHE_REFERENCES)	\
+	__PMC_EV(RISCV, CACHE_MISSES)		\
+	__PMC_EV(RISCV, BRANCH_INSTRUCTIONS)	\
+	__PMC_EV(RISCV, BRANCH_MISSES)		\
+	__PMC_EV(RISCV, BUS_CYCLES)		\
+	__PMC_EV(RISCV, STALLED_CYCLES_FRONTEND) \
+	__PMC_EV(RISCV, STALLED_CYCLES_BACKEND)	\
+	__PMC_EV(RISCV, REF_CPU_CYCLES)		\
+	__PMC_EV(RISCV, L1D_READ_ACCESS)	\
+	__PMC_EV(RISCV, L1D_READ_MISS)		\
+	__PMC_EV(RISCV, L1D_WRITE_ACCESS)	\
+	__PMC_EV(RISCV, L1D_WRITE_MISS)		\
+	__PMC_EV(RISCV, L1I_READ_ACCESS)	\
+	__PMC_EV(RISCV, L1I_READ_MISS)		\
+	__PMC_EV(RISCV, LL_READ_ACCESS)		\
+	__PMC_EV(RISCV, LL_READ_MISS)		\
+	__PMC_EV(RISCV, LL_WRITE_ACCESS)	\
+	__PMC_EV(RISCV, LL_WRITE_MISS)		\
+	__PMC_EV(RISCV, DTLB_READ_ACCESS)	\
+	__PMC_EV(RISCV, DTLB_READ_MISS)		\
+	__PMC_EV(RISCV, ITLB_READ_ACCESS)	\
+	__PMC_EV(RISCV, ITLB_READ_MISS)		\
+	__PMC_EV(RISCV, BPU_READ_ACCESS)	\
+	__PMC_EV(RISCV, BPU_READ_MISS)
+
+#define	PMC_EV_RISCV_FIRST	PMC_EV_RISCV_CPU_CYCLES
+#define	PMC_EV_RISCV_LAST	PMC_EV_RISCV_BPU_READ_MISS
 /*
  * All known PMC events.
  *
@@ -1779,6 +1814,7 @@ __PMC_EV_ALIAS("unhalted-core-cycles",		IAP_ARCH_UNH_COR_CYC)
  * 0x13300	0x00FF		Freescale e500 events
  * 0x14000	0x0100		ARMv7 events
  * 0x14100	0x0100		ARMv8 events
+ * 0x14200	0x0100		RISC-V events
  * 0x20000	0x1000		Software events
  */
 #define	__PMC_EVENTS()				\
@@ -1809,7 +1845,9 @@ __PMC_EV_ALIAS("unhalted-core-cycles",		IAP_ARCH_UNH_COR_CYC)
 	__PMC_EV_BLOCK(ARMV7,	0x14000)	\
 	__PMC_EV_ARMV7()			\
 	__PMC_EV_BLOCK(ARMV8,	0x14100)	\
-	__PMC_EV_ARMV8()
+	__PMC_EV_ARMV8()			\
+	__PMC_EV_BLOCK(RISCV,	0x14200)	\
+	__PMC_EV_RISCV()
 
 #define	PMC_EVENT_FIRST	PMC_EV_TSC_TSC
 #define	PMC_EVENT_LAST	PMC_EV_SOFT_LAST
@@ -84,6 +84,7 @@
 #include <sys/namei.h>
 #include <sys/proc.h>
 #include <sys/queue.h>
+#include <sys/rangelock.h>
 #include <sys/rwlock.h>
 #include <sys/sbuf.h>
 #include <sys/sched.h>
@@ -163,6 +164,9 @@ SYSCTL_INT(_debug, OID_AUTO, mddebug, CTLFLAG_RW, &md_debug, 0,
 static int md_malloc_wait;
 SYSCTL_INT(_vm, OID_AUTO, md_malloc_wait, CTLFLAG_RW, &md_malloc_wait, 0,
     "Allow malloc to wait for memory allocations");
+static int md_threads = 1;
+SYSCTL_INT(_kern, OID_AUTO, md_threads, CTLFLAG_RWTUN, &md_threads, 0,
+    "Number of worker threads for newly created md devices");
 
 #if defined(MD_ROOT) && !defined(MD_ROOT_FSTYPE)
 #define	MD_ROOT_FSTYPE	"ufs"
@@ -257,6 +261,10 @@ struct md_s {
 	unsigned flags;
 	char name[20];
 	struct proc *procp;
+	int nthreads;			/* worker threads started */
+	int nworkers;			/* worker threads still running */
+	struct rangelock rl;		/* orders overlapping requests */
+	struct mtx rl_mtx;
 	struct g_geom *gp;
 	struct g_provider *pp;
 	int (*start)(struct md_s *sc, struct bio *bp);
@@ -264,6 +272,7 @@ struct md_s {
 
 	/* MD_MALLOC related fields */
 	struct indir *indir;
+	struct sx indir_lock;		/* protects the shape of indir */
 	uma_zone_t uma;
 
 	/* MD_PRELOAD related fields */
@@ -482,7 +491,7 @@ g_md_start(struct bio *bp)
 	mtx_lock(&sc->queue_mtx);
 	bioq_disksort(&sc->bio_queue, bp);
 	mtx_unlock(&sc->queue_mtx);
-	wakeup(sc);
+	wakeup_one(sc);
 }
 
 #define	MD_MALLOC_MOVE_ZERO	1
@@ -633,6 +642,33 @@ md_malloc_move_vlist(bus_dma_segment_t **pvlist, int *pma_offs,
 	return (0);
 }
 
+/*
+ * The sector data itself is covered by the range lock taken in
+ * md_kthread(), but requests for different ranges share the interior
+ * nodes of the indir tree, which s_write() allocates and prunes.
+ */
+static uintptr_t
+md_s_read(struct md_s *sc, off_t secno)
+{
+	uintptr_t sp;
+
+	sx_slock(&sc->indir_lock);
+	sp = s_read(sc->indir, secno);
+	sx_sunlock(&sc->indir_lock);
+	return (sp);
+}
+
+static int
+md_s_write(struct md_s *sc, off_t secno, uintptr_t sp)
+{
+	int error;
+
+	sx_xlock(&sc->indir_lock);
+	error = s_write(sc->indir, secno, sp);
+	sx_xunlock(&sc->indir_lock);
+	return (error);
+}
+
 static int
 mdstart_malloc(struct md_s *sc, struct bio *bp)
 {
@@ -671,10 +707,10 @@ mdstart_malloc(struct md_s *sc, struct bio *bp)
 	secno = bp->bio_offset / sc->sectorsize;
 	error = 0;
 	while (nsec--) {
-		osp = s_read(sc->indir, secno);
+		osp = md_s_read(sc, secno);
 		if (bp->bio_cmd == BIO_DELETE) {
 			if (osp != 0)
-				error = s_write(sc->indir, secno, 0);
+				error = md_s_write(sc, secno, 0);
 		} else if (bp->bio_cmd == BIO_READ) {
 			if (osp == 0) {
 				if (notmapped) {
@@ -739,7 +775,7 @@ mdstart_malloc(struct md_s *sc, struct bio *bp)
 			}
 			if (i == sc->sectorsize) {
 				if (osp != uc)
-					error = s_write(sc->indir, secno, uc);
+					error = md_s_write(sc, secno, uc);
 			} else {
 				if (osp <= 255) {
 					sp = (uintptr_t)uma_zalloc(sc->uma,
@@ -763,7 +799,7 @@ mdstart_malloc(struct md_s *sc, struct bio *bp)
 						bcopy(dst, (void *)sp,
 						    sc->sectorsize);
 					}
-					error = s_write(sc->indir, secno, sp);
+					error = md_s_write(sc, secno, sp);
 				} else {
 					if (notmapped) {
 						error = md_malloc_move_ma(&m,
@@ -1196,6 +1232,7 @@ md_kthread(void *arg)
 {
 	struct md_s *sc;
 	struct bio *bp;
+	void *cookie;
 	int error;
 
 	sc = arg;
@@ -1208,9 +1245,10 @@ md_kthread(void *arg)
 	for (;;) {
 		mtx_lock(&sc->queue_mtx);
 		if (sc->flags & MD_SHUTDOWN) {
-			sc->flags |= MD_EXITING;
+			if (--sc->nworkers == 0)
+				sc->flags |= MD_EXITING;
 			mtx_unlock(&sc->queue_mtx);
-			kproc_exit(0);
+			kthread_exit();
 		}
 		bp = bioq_takefirst(&sc->bio_queue);
 		if (!bp) {
@@ -1235,14 +1273,36 @@ md_kthread(void *arg)
 				error = -1;
 			else
 				error = EOPNOTSUPP;
+		} else if (sc->nthreads > 1 && (bp->bio_cmd == BIO_READ ||
+		    bp->bio_cmd == BIO_WRITE || bp->bio_cmd == BIO_DELETE)) {
+			/*
+			 * With several workers, keep overlapping requests
+			 * from running against each other.
+			 */
+			if (bp->bio_cmd == BIO_READ)
+				cookie = rangelock_rlock(&sc->rl,
+				    bp->bio_offset,
+				    bp->bio_offset + bp->bio_length,
+				    &sc->rl_mtx);
+			else
+				cookie = rangelock_wlock(&sc->rl,
+				    bp->bio_offset,
+				    bp->bio_offset + bp->bio_length,
+				    &sc->rl_mtx);
+			error = sc->start(sc, bp);
+			rangelock_unlock(&sc->rl, cookie, &sc->rl_mtx);
 		} else {
 			error = sc->start(sc, bp);
 		}
 
 		if (error != -1) {
 			bp->bio_completed = bp->bio_length;
-			if ((bp->bio_cmd == BIO_READ) || (bp->bio_cmd == BIO_WRITE))
+			if ((bp->bio_cmd == BIO_READ) ||
+			    (bp->bio_cmd == BIO_WRITE)) {
+				mtx_lock(&sc->stat_mtx);
 				devstat_end_transaction_bio(sc->devstat, bp);
+				mtx_unlock(&sc->stat_mtx);
+			}
 			g_io_deliver(bp, error);
 		}
 	}
@@ -1264,7 +1324,7 @@ static struct md_s *
 mdnew(int unit, int *errp, enum md_types type)
 {
 	struct md_s *sc;
-	int error;
+	int error, i;
 
 	*errp = 0;
 	if (unit == -1)
@@ -1282,13 +1342,38 @@ mdnew(int unit, int *errp, enum md_types type)
 	bioq_init(&sc->bio_queue);
 	mtx_init(&sc->queue_mtx, "md bio queue", NULL, MTX_DEF);
 	mtx_init(&sc->stat_mtx, "md stat", NULL, MTX_DEF);
+	mtx_init(&sc->rl_mtx, "md range", NULL, MTX_DEF);
+	rangelock_init(&sc->rl);
+	sx_init(&sc->indir_lock, "md indir");
 	sc->unit = unit;
 	sprintf(sc->name, "md%d", unit);
 	LIST_INSERT_HEAD(&md_softc_list, sc, list);
+	sc->nthreads = sc->nworkers = 1;
 	error = kproc_create(md_kthread, sc, &sc->procp, 0, 0,"%s", sc->name);
-	if (error == 0)
+	if (error == 0) {
+		/*
+		 * Extra workers are best effort; the device works with
+		 * however many could be started.
+		 */
+		for (i = 1; i < md_threads; i++) {
+			mtx_lock(&sc->queue_mtx);
+			sc->nworkers++;
+			mtx_unlock(&sc->queue_mtx);
+			if (kthread_add(md_kthread, sc, sc->procp, NULL, 0, 0,
+			    "%s:%d", sc->name, i) != 0) {
+				mtx_lock(&sc->queue_mtx);
+				sc->nworkers--;
+				mtx_unlock(&sc->queue_mtx);
+				break;
+			}
+			sc->nthreads++;
+		}
 		return (sc);
+	}
 	LIST_REMOVE(sc, list);
+	sx_destroy(&sc->indir_lock);
+	rangelock_destroy(&sc->rl);
+	mtx_destroy(&sc->rl_mtx);
 	mtx_destroy(&sc->stat_mtx);
 	mtx_destroy(&sc->queue_mtx);
 	free_unr(md_uh, sc->unit);
@@ -1505,6 +1590,9 @@ mddestroy(struct md_s *sc, struct thread *td)
 	while (!(sc->flags & MD_EXITING))
 		msleep(sc->procp, &sc->queue_mtx, PRIBIO, "mddestroy", hz / 10);
 	mtx_unlock(&sc->queue_mtx);
+	sx_destroy(&sc->indir_lock);
+	rangelock_destroy(&sc->rl);
+	mtx_destroy(&sc->rl_mtx);
 	mtx_destroy(&sc->stat_mtx);
 	mtx_destroy(&sc->queue_mtx);
 	if (sc->vnode != NULL) {
@@ -0,0 +1,373 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause-FreeBSD
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * $FreeBSD$
+ *
+ * netmap support for: cgem
+ *
+ * The GEM has a single transmit and a single receive descriptor ring,
+ * each mapped one to one onto a netmap ring.  Every netmap slot is sent
+ * as one single-buffer frame.  Descriptors carry 32-bit buffer
+ * addresses and the receive buffer offset is cleared in netmap mode,
+ * so frames land at the start of the netmap buffer.
+ *
+ * For more details on netmap support please see ixgbe_netmap.h
+ */
+
+
+#include <net/netmap.h>
+#include <sys/selinfo.h>
+#include <vm/vm.h>
+#include <vm/pmap.h>    /* vtophys ? */
+#include <dev/netmap/netmap_kern.h>
+
+
+/*
+ * Register/unregister. We are already under netmap lock.
+ */
+static int
+cgem_netmap_reg(struct netmap_adapter *na, int onoff)
+{
+	struct ifnet *ifp = na->ifp;
+	struct cgem_softc *sc = ifp->if_softc;
+
+	/* The hardware writes up to MCLBYTES into every receive buffer. */
+	if (onoff && NETMAP_BUF_SIZE(na) < MCLBYTES)
+		return (EINVAL);
+
+	CGEM_LOCK(sc);
+	if_setdrvflagbits(ifp, 0, IFF_DRV_RUNNING);
+	cgem_stop(sc);
+	if (onoff) {
+		nm_set_native_flags(na);
+	} else {
+		nm_clear_native_flags(na);
+	}
+	cgem_init_locked(sc);	/* also enables intr */
+	CGEM_UNLOCK(sc);
+	return (if_getdrvflags(ifp) & IFF_DRV_RUNNING ? 0 : 1);
+}
+
+
+/*
+ * Reconcile kernel and user view of the transmit ring.
+ */
+static int
+cgem_netmap_txsync(struct netmap_kring *kring, int flags)
+{
+	struct netmap_adapter *na = kring->na;
+	struct ifnet *ifp = na->ifp;
+	struct netmap_ring *ring = kring->ring;
+	u_int nm_i;	/* index into the netmap ring */
+	u_int nic_i;	/* index into the NIC ring */
+	u_int n;
+	u_int const lim = kring->nkr_num_slots - 1;
+	u_int const head = kring->rhead;
+
+	/* device-specific */
+	struct cgem_softc *sc = ifp->if_softc;
+
+	/*
+	 * First part: process new packets to send.
+	 */
+	nm_i = kring->nr_hwcur;
+	if (nm_i != head) {	/* we have new packets to send */
+		nic_i = netmap_idx_k2n(kring, nm_i);
+		for (n = 0; nm_i != head; n++) {
+			struct netmap_slot *slot = &ring->slot[nm_i];
+			u_int len = slot->len;
+			uint64_t paddr;
+			void *addr = PNMB(na, slot, &paddr);
+
+			/* device-specific */
+			struct cgem_tx_desc *desc = &sc->txring[nic_i];
+			uint32_t ctl = CGEM_TXDESC_LAST_BUF;
+
+			NM_CHECK_ADDR_LEN(na, addr, len);
+
+			if (nic_i == lim)	/* mark end of ring */
+				ctl |= CGEM_TXDESC_WRAP;
+
+			if (slot->flags & NS_BUF_CHANGED) {
+				/* buffer has changed, reload map */
+				desc->addr = (uint32_t)paddr;
+				netmap_reload_map(na, sc->mbuf_dma_tag,
+				    sc->txring_m_dmamap[nic_i], addr);
+			}
+			slot->flags &= ~(NS_REPORT | NS_BUF_CHANGED);
+
+			/* make sure changes to the buffer are synced */
+			bus_dmamap_sync(sc->mbuf_dma_tag,
+			    sc->txring_m_dmamap[nic_i], BUS_DMASYNC_PREWRITE);
+
+			/*
+			 * Fill the slot in the NIC ring.  Clearing the
+			 * USED bit hands the descriptor to the hardware.
+			 */
+			desc->ctl = ctl | (len & CGEM_TXDESC_LENGTH_MASK);
+
+			nm_i = nm_next(nm_i, lim);
+			nic_i = nm_next(nic_i, lim);
+		}
+		sc->txring_hd_ptr = nic_i;
+		kring->nr_hwcur = head;
+
+		/* Kick the transmitter. */
+		WR4(sc, CGEM_NET_CTRL, sc->net_ctl_shadow |
+		    CGEM_NET_CTRL_START_TX);
+	}
+
+	/*
+	 * Second part: reclaim buffers for completed transmissions.
+	 */
+	if (flags & NAF_FORCE_RECLAIM || nm_kr_txempty(kring)) {
+		nic_i = sc->txring_tl_ptr;
+		for (n = 0; nic_i != sc->txring_hd_ptr; n++) {
+			if ((sc->txring[nic_i].ctl & CGEM_TXDESC_USED) == 0)
+				break;
+			bus_dmamap_sync(sc->mbuf_dma_tag,
+			    sc->txring_m_dmamap[nic_i], BUS_DMASYNC_POSTWRITE);
+			nic_i = nm_next(nic_i, lim);
+		}
+		if (n > 0) {
+			sc->txring_tl_ptr = nic_i;
+			kring->nr_hwtail = nm_prev(netmap_idx_n2k(kring, nic_i),
+			    lim);
+		}
+	}
+
+	return 0;
+}
+
+
+/*
+ * Reconcile kernel and user view of the receive ring.
+ */
+static int
+cgem_netmap_rxsync(struct netmap_kring *kring, int flags)
+{
+	struct netmap_adapter *na = kring->na;
+	struct ifnet *ifp = na->ifp;
+	struct netmap_ring *ring = kring->ring;
+	u_int nm_i;	/* index into the netmap ring */
+	u_int nic_i;	/* index into the NIC ring */
+	u_int n;
+	u_int const lim = kring->nkr_num_slots - 1;
+	u_int const head = kring->rhead;
+	int force_update = (flags & NAF_FORCE_READ) ||
+	    kring->nr_kflags & NKR_PENDINTR;
+
+	/* device-specific */
+	struct cgem_softc *sc = ifp->if_softc;
+
+	if (head > lim)
+		return netmap_ring_reinit(kring);
+
+	/*
+	 * First part: import newly received packets.
+	 *
+	 * The hardware sets the OWN bit on every buffer it fills.
+	 * Slots held by userspace also have it set, so stop right
+	 * before nm_hwcur.
+	 */
+	if (netmap_no_pendintr || force_update) {
+		uint32_t stop_i = nm_prev(kring->nr_hwcur, lim);
+
+		nic_i = sc->rxring_tl_ptr;	/* next pkt to check */
+		nm_i = netmap_idx_n2k(kring, nic_i);
+
+		while (nm_i != stop_i) {
+			struct cgem_rx_desc *desc = &sc->rxring[nic_i];
+			uint32_t ctl;
+
+			if ((desc->addr & CGEM_RXDESC_OWN) == 0)
+				break;
+			ctl = desc->ctl;
+			if ((ctl & CGEM_RXDESC_BAD_FCS) != 0 ||
+			    (ctl & (CGEM_RXDESC_SOF | CGEM_RXDESC_EOF)) !=
+			    (CGEM_RXDESC_SOF | CGEM_RXDESC_EOF)) {
+				/* Hand bad frames up as empty slots. */
+				if_inc_counter(ifp, IFCOUNTER_IERRORS, 1);
+				ring->slot[nm_i].len = 0;
+			} else
+				ring->slot[nm_i].len =
+				    ctl & CGEM_RXDESC_LENGTH_MASK;
+			ring->slot[nm_i].flags = 0;
+			bus_dmamap_sync(sc->mbuf_dma_tag,
+			    sc->rxring_m_dmamap[nic_i], BUS_DMASYNC_POSTREAD);
+			nm_i = nm_next(nm_i, lim);
+			nic_i = nm_next(nic_i, lim);
+		}
+		sc->rxring_tl_ptr = nic_i;
+		kring->nr_hwtail = nm_i;
+		kring->nr_kflags &= ~NKR_PENDINTR;
+	}
+
+	/*
+	 * Second part: skip past packets that userspace has released.
+	 */
+	nm_i = kring->nr_hwcur;
+	if (nm_i != head) {
+		nic_i = netmap_idx_k2n(kring, nm_i);
+		for (n = 0; nm_i != head; n++) {
+			struct netmap_slot *slot = &ring->slot[nm_i];
+			uint64_t paddr;
+			void *addr = PNMB(na, slot, &paddr);
+
+			struct cgem_rx_desc *desc = &sc->rxring[nic_i];
+			uint32_t daddr = (uint32_t)paddr;
+
+			if (addr == NETMAP_BUF_BASE(na)) /* bad buf */
+				goto ring_reset;
+
+			if (nic_i == lim)	/* mark end of ring */
+				daddr |= CGEM_RXDESC_WRAP;
+
+			if (slot->flags & NS_BUF_CHANGED) {
+				/* buffer has changed, reload map */
+				netmap_reload_map(na, sc->mbuf_dma_tag,
+				    sc->rxring_m_dmamap[nic_i], addr);
+				slot->flags &= ~NS_BUF_CHANGED;
+			}
+			bus_dmamap_sync(sc->mbuf_dma_tag,
+			    sc->rxring_m_dmamap[nic_i], BUS_DMASYNC_PREREAD);
+			/* Clearing the OWN bit returns the buffer. */
+			desc->ctl = 0;
+			desc->addr = daddr;
+			nm_i = nm_next(nm_i, lim);
+			nic_i = nm_next(nic_i, lim);
+		}
+		kring->nr_hwcur = head;
+	}
+
+	return 0;
+
+ring_reset:
+	return netmap_ring_reinit(kring);
+}
+
+
+/*
+ * Additional routines to init the tx and rx rings.
+ * In other drivers we do that inline in the main code.
+ */
+static void
+cgem_netmap_tx_init(struct cgem_softc *sc)
+{
+	struct netmap_adapter *na = NA(sc->ifp);
+	struct netmap_slot *slot;
+	int i;
+
+	slot = netmap_reset(na, NR_TX, 0, 0);
+	/* slot is NULL if we are not in native netmap mode */
+	if (!slot)
+		return;
+	/* in netmap mode, overwrite addresses and maps */
+	for (i = 0; i < CGEM_NUM_TX_DESCS; i++) {
+		uint64_t paddr;
+		int l = netmap_idx_n2k(na->tx_rings[0], i);
+		void *addr = PNMB(na, slot + l, &paddr);
+
+		if (sc->txring_m_dmamap[i] == NULL &&
+		    bus_dmamap_create(sc->mbuf_dma_tag, 0,
+		    &sc->txring_m_dmamap[i]) != 0) {
+			sc->txdmamapfails++;
+			continue;
+		}
+		netmap_load_map(na, sc->mbuf_dma_tag,
+		    sc->txring_m_dmamap[i], addr);
+		sc->txring[i].addr = (uint32_t)paddr;
+		sc->txring[i].ctl = CGEM_TXDESC_USED;
+	}
+	sc->txring[CGEM_NUM_TX_DESCS - 1].ctl |= CGEM_TXDESC_WRAP;
+}
+
+static void
+cgem_netmap_rx_init(struct cgem_softc *sc)
+{
+	struct netmap_adapter *na = NA(sc->ifp);
+	struct netmap_slot *slot = netmap_reset(na, NR_RX, 0, 0);
+	uint32_t daddr;
+	uint32_t nic_i, max_avail;
+	uint32_t const n = CGEM_NUM_RX_DESCS;
+
+	if (!slot)
+		return;
+	/*
+	 * Do not release the slots owned by userspace,
+	 * and also keep one empty.  The hardware skips
+	 * descriptors that still have the OWN bit set.
+	 */
+	max_avail = n - 1 - nm_kr_rxspace(na->rx_rings[0]);
+	for (nic_i = 0; nic_i < n; nic_i++) {
+		void *addr;
+		uint64_t paddr;
+		uint32_t nm_i = netmap_idx_n2k(na->rx_rings[0], nic_i);
+
+		addr = PNMB(na, slot + nm_i, &paddr);
+
+		if (sc->rxring_m_dmamap[nic_i] == NULL &&
+		    bus_dmamap_create(sc->mbuf_dma_tag, 0,
+		    &sc->rxring_m_dmamap[nic_i]) != 0) {
+			sc->rxdmamapfails++;
+			sc->rxring[nic_i].addr = CGEM_RXDESC_OWN;
+			continue;
+		}
+		netmap_reload_map(na, sc->mbuf_dma_tag,
+		    sc->rxring_m_dmamap[nic_i], addr);
+		bus_dmamap_sync(sc->mbuf_dma_tag,
+		    sc->rxring_m_dmamap[nic_i], BUS_DMASYNC_PREREAD);
+		daddr = (uint32_t)paddr;
+		if (nic_i == n - 1) /* mark the end of ring */
+			daddr |= CGEM_RXDESC_WRAP;
+		if (nic_i >= max_avail)
+			daddr |= CGEM_RXDESC_OWN;
+		sc->rxring[nic_i].ctl = 0;
+		sc->rxring[nic_i].addr = daddr;
+	}
+	sc->rxring_tl_ptr = 0;
+}
+
+
+static void
+cgem_netmap_attach(struct cgem_softc *sc)
+{
+	struct netmap_adapter na;
+
+	bzero(&na, sizeof(na));
+
+	na.ifp = sc->ifp;
+	na.na_flags = NAF_BDG_MAYSLEEP;
+	na.num_tx_desc = CGEM_NUM_TX_DESCS;
+	na.num_rx_desc = CGEM_NUM_RX_DESCS;
+	na.nm_txsync = cgem_netmap_txsync;
+	na.nm_rxsync = cgem_netmap_rxsync;
+	na.nm_register = cgem_netmap_reg;
+	na.num_tx_rings = na.num_rx_rings = 1;
+	netmap_attach(&na);
+}
+
+/* end of file */
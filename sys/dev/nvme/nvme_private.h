@@ -101,6 +101,13 @@ MALLOC_DECLARE(M_NVME);
 
 #define NVME_DEFAULT_RETRY_COUNT	(4)
 
+/*
+ * Completion latency histogram buckets.  Bucket 0 counts completions taking
+ *  less than 1us, bucket n those taking [2^(n-1), 2^n) us, and the last
+ *  bucket everything slower.
+ */
+#define NVME_LAT_BUCKETS		(24)
+
 /* Maximum log page size to fetch for AERs. */
 #define NVME_MAX_AER_LOG_SIZE		(4096)
 
@@ -174,6 +181,7 @@ struct nvme_tracker {
 	struct callout			timer;
 	bus_dmamap_t			payload_dma_map;
 	uint16_t			cid;
+	sbintime_t			submit_time;
 
 	uint64_t			*prp;
 	bus_addr_t			prp_bus_addr;
@@ -201,6 +209,13 @@ struct nvme_qpair {
 
 	int64_t			num_cmds;
 	int64_t			num_intr_handler_calls;
+	int64_t			num_polled_cpls;
+	uint32_t		num_outstanding;
+
+	/* Set while one context is consuming the completion queue. */
+	volatile u_int		completing;
+
+	uint64_t		lat_hist[NVME_LAT_BUCKETS];
 
 	struct nvme_command	*cmd;
 	struct nvme_completion	*cpl;
@@ -302,6 +317,12 @@ struct nvme_controller {
 	/** timeout period in seconds */
 	uint32_t		timeout_period;
 
+	/**
+	 * reap completions from the submitting thread once this many
+	 *  commands are outstanding on the I/O queue (0 = interrupts only)
+	 */
+	uint32_t		poll_depth;
+
 	struct nvme_qpair	adminq;
 	struct nvme_qpair	*ioq;
 
@@ -39,6 +39,9 @@ __FBSDID("$FreeBSD$");
 static void	_nvme_qpair_submit_request(struct nvme_qpair *qpair,
 					   struct nvme_request *req);
 static void	nvme_qpair_destroy(struct nvme_qpair *qpair);
+static bool	nvme_qpair_reap(struct nvme_qpair *qpair, bool polled);
+static bool	_nvme_qpair_process_completions(struct nvme_qpair *qpair,
+					   bool polled);
 
 struct nvme_opcode_string {
 
@@ -392,6 +395,7 @@ nvme_qpair_complete_tracker(struct nvme_qpair *qpair, struct nvme_tracker *tr,
 
 	mtx_lock(&qpair->lock);
 	callout_stop(&tr->timer);
+	qpair->num_outstanding--;
 
 	if (retry) {
 		req->retries++;
@@ -469,15 +473,92 @@ nvme_qpair_manual_complete_request(struct nvme_qpair *qpair,
 	nvme_free_request(req);
 }
 
+static void
+nvme_qpair_record_latency(struct nvme_qpair *qpair, struct nvme_tracker *tr)
+{
+	sbintime_t	us;
+	int		bucket;
+
+	us = (sbinuptime() - tr->submit_time) / SBT_1US;
+	bucket = us > 0 ? flsll(us) : 0;
+	if (bucket >= NVME_LAT_BUCKETS)
+		bucket = NVME_LAT_BUCKETS - 1;
+	qpair->lat_hist[bucket]++;
+}
+
+static bool
+nvme_qpair_cpl_pending(struct nvme_qpair *qpair)
+{
+	struct nvme_completion	cpl;
+
+	if (!qpair->is_enabled)
+		return (false);
+
+	bus_dmamap_sync(qpair->dma_tag, qpair->queuemem_map,
+	    BUS_DMASYNC_POSTREAD | BUS_DMASYNC_POSTWRITE);
+	cpl = qpair->cpl[qpair->cq_head];
+	nvme_completion_swapbytes(&cpl);
+
+	return (NVME_STATUS_GET_P(cpl.status) == qpair->phase);
+}
+
 bool
 nvme_qpair_process_completions(struct nvme_qpair *qpair)
+{
+
+	qpair->num_intr_handler_calls++;
+
+	return (nvme_qpair_reap(qpair, false));
+}
+
+/*
+ * Opportunistically reap completions from the submitting thread.  This
+ *  only pays off when enough commands are in flight that some of them are
+ *  likely to have completed already; at lower queue depths the interrupt
+ *  handler does the work.
+ */
+static void
+nvme_qpair_poll(struct nvme_qpair *qpair)
+{
+
+	nvme_qpair_reap(qpair, true);
+}
+
+/*
+ * The interrupt handler, the timeout handler and polling submitters may
+ *  all try to consume the completion queue.  Only one of them gets to; the
+ *  others return right away.  The consumer rechecks the queue after giving
+ *  up ownership so that a completion which arrived after its last look,
+ *  and whose interrupt was swallowed, is not left behind.
+ */
+static bool
+nvme_qpair_reap(struct nvme_qpair *qpair, bool polled)
+{
+	bool		owner, done;
+
+	done = false;
+	do {
+		/* The dump path polls with the scheduler stopped. */
+		owner = !SCHEDULER_STOPPED();
+		if (owner &&
+		    atomic_cmpset_acq_int(&qpair->completing, 0, 1) == 0)
+			break;
+		if (_nvme_qpair_process_completions(qpair, polled))
+			done = true;
+		if (owner)
+			atomic_store_rel_int(&qpair->completing, 0);
+	} while (owner && nvme_qpair_cpl_pending(qpair));
+
+	return (done);
+}
+
+static bool
+_nvme_qpair_process_completions(struct nvme_qpair *qpair, bool polled)
 {
 	struct nvme_tracker	*tr;
 	struct nvme_completion	cpl;
 	int done = 0;
 
-	qpair->num_intr_handler_calls++;
-
 	if (!qpair->is_enabled)
 		/*
 		 * qpair is not enabled, likely because a controller reset is
@@ -501,6 +582,7 @@ nvme_qpair_process_completions(struct nvme_qpair *qpair)
 		tr = qpair->act_tr[cpl.cid];
 
 		if (tr != NULL) {
+			nvme_qpair_record_latency(qpair, tr);
 			nvme_qpair_complete_tracker(qpair, tr, &cpl, TRUE);
 			qpair->sq_head = cpl.sqhd;
 			done++;
@@ -520,6 +602,8 @@ nvme_qpair_process_completions(struct nvme_qpair *qpair)
 		nvme_mmio_write_4(qpair->ctrlr, doorbell[qpair->id].cq_hdbl,
 		    qpair->cq_head);
 	}
+	if (polled)
+		qpair->num_polled_cpls += done;
 	return (done != 0);
 }
 
@@ -813,6 +897,7 @@ nvme_qpair_submit_tracker(struct nvme_qpair *qpair, struct nvme_tracker *tr)
 	req = tr->req;
 	req->cmd.cid = tr->cid;
 	qpair->act_tr[tr->cid] = tr;
+	qpair->num_outstanding++;
 	ctrlr = qpair->ctrlr;
 
 	if (req->timeout)
@@ -840,6 +925,7 @@ nvme_qpair_submit_tracker(struct nvme_qpair *qpair, struct nvme_tracker *tr)
 	wmb();
 #endif
 
+	tr->submit_time = sbinuptime();
 	nvme_mmio_write_4(qpair->ctrlr, doorbell[qpair->id].sq_tdbl,
 	    qpair->sq_tail);
 
@@ -996,10 +1082,24 @@ _nvme_qpair_submit_request(struct nvme_qpair *qpair, struct nvme_request *req)
 void
 nvme_qpair_submit_request(struct nvme_qpair *qpair, struct nvme_request *req)
 {
+	uint32_t	poll_depth;
+	bool		poll;
+
+	poll_depth = qpair->ctrlr->poll_depth;
 
 	mtx_lock(&qpair->lock);
 	_nvme_qpair_submit_request(qpair, req);
+	poll = poll_depth != 0 && qpair->id != 0 &&
+	    qpair->num_outstanding >= poll_depth;
 	mtx_unlock(&qpair->lock);
+
+	/*
+	 * The CAM SIM submits with the controller lock held, and its
+	 *  completion path may need that lock again.  Leave those to the
+	 *  interrupt handler.
+	 */
+	if (poll && !mtx_owned(&qpair->ctrlr->lock))
+		nvme_qpair_poll(qpair);
 }
 
 static void
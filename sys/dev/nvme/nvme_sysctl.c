@@ -33,6 +33,7 @@ __FBSDID("$FreeBSD$");
 
 #include <sys/param.h>
 #include <sys/bus.h>
+#include <sys/sbuf.h>
 #include <sys/sysctl.h>
 
 #include "nvme_private.h"
@@ -162,6 +163,30 @@ nvme_qpair_reset_stats(struct nvme_qpair *qpair)
 
 	qpair->num_cmds = 0;
 	qpair->num_intr_handler_calls = 0;
+	qpair->num_polled_cpls = 0;
+	memset(qpair->lat_hist, 0, sizeof(qpair->lat_hist));
+}
+
+static int
+nvme_sysctl_lat_hist(SYSCTL_HANDLER_ARGS)
+{
+	struct nvme_qpair	*qpair = arg1;
+	struct sbuf		sb;
+	int			error, i;
+
+	error = sysctl_wire_old_buffer(req, 0);
+	if (error != 0)
+		return (error);
+	sbuf_new_for_sysctl(&sb, NULL, 128, req);
+	for (i = 0; i < NVME_LAT_BUCKETS - 1; i++)
+		sbuf_printf(&sb, "\n < %8ju us: %ju", (uintmax_t)1 << i,
+		    (uintmax_t)qpair->lat_hist[i]);
+	sbuf_printf(&sb, "\n>= %8ju us: %ju", (uintmax_t)1 << (i - 1),
+	    (uintmax_t)qpair->lat_hist[i]);
+	error = sbuf_finish(&sb);
+	sbuf_delete(&sb);
+
+	return (error);
 }
 
 static int
@@ -245,6 +270,16 @@ nvme_sysctl_initialize_queue(struct nvme_qpair *qpair,
 	    "Number of times interrupt handler was invoked (will typically be "
 	    "less than number of actual interrupts generated due to "
 	    "coalescing)");
+	SYSCTL_ADD_QUAD(ctrlr_ctx, que_list, OID_AUTO, "num_polled_cpls",
+	    CTLFLAG_RD, &qpair->num_polled_cpls,
+	    "Number of completions reaped by submitting threads");
+	SYSCTL_ADD_UINT(ctrlr_ctx, que_list, OID_AUTO, "num_outstanding",
+	    CTLFLAG_RD, &qpair->num_outstanding, 0,
+	    "Number of commands outstanding in hardware queue");
+
+	SYSCTL_ADD_PROC(ctrlr_ctx, que_list, OID_AUTO,
+	    "latency_hist", CTLTYPE_STRING | CTLFLAG_RD, qpair, 0,
+	    nvme_sysctl_lat_hist, "A", "Command completion latency histogram");
 
 	SYSCTL_ADD_PROC(ctrlr_ctx, que_list, OID_AUTO,
 	    "dump_debug", CTLTYPE_UINT | CTLFLAG_RW, qpair, 0,
@@ -279,6 +314,11 @@ nvme_sysctl_initialize_ctrlr(struct nvme_controller *ctrlr)
 	    nvme_sysctl_int_coal_threshold, "IU",
 	    "Interrupt coalescing threshold");
 
+	SYSCTL_ADD_UINT(ctrlr_ctx, ctrlr_list, OID_AUTO, "poll_depth",
+	    CTLFLAG_RW, &ctrlr->poll_depth, 0,
+	    "Reap I/O completions from the submitting thread at this queue "
+	    "depth (0 = interrupts only)");
+
 	SYSCTL_ADD_PROC(ctrlr_ctx, ctrlr_list, OID_AUTO,
 	    "timeout_period", CTLTYPE_UINT | CTLFLAG_RW, ctrlr, 0,
 	    nvme_sysctl_timeout_period, "IU",
@@ -320,7 +320,30 @@ tcp_log_dev_read(struct cdev *dev __unused, struct uio *uio, int flags)
 		entry = priv->tldi_head;
 		if (entry->tldq_buf == NULL) {
 			TCP_LOG_DEV_QUEUE_LOCK_ASSERT();
+			/*
+			 * Only one reader may run the transform. Others
+			 * wait for it to finish and then recheck.
+			 */
+			if (entry->tldq_flags & TLDQ_XFORM) {
+				entry->tldq_flags |= TLDQ_XFORM_WAIT;
+				mtx_sleep(entry, &tcp_log_dev_queue_lock, 0,
+				    "tcplogxf", 0);
+				continue;
+			}
+
+			/*
+			 * The transform copies every log entry, so run it
+			 * with the queue unlocked to keep from stalling the
+			 * connections adding to the queue. Our reference
+			 * keeps the entry from being freed in the meantime.
+			 */
+			entry->tldq_flags |= TLDQ_XFORM;
+			TCP_LOG_DEV_QUEUE_UNLOCK();
 			buf = (*entry->tldq_xform)(entry);
+			TCP_LOG_DEV_QUEUE_LOCK();
+			if (entry->tldq_flags & TLDQ_XFORM_WAIT)
+				wakeup(entry);
+			entry->tldq_flags &= ~(TLDQ_XFORM | TLDQ_XFORM_WAIT);
 			if (buf == NULL) {
 				rv = EBUSY;
 				goto done;
@@ -468,6 +491,7 @@ tcp_log_dev_add_log(struct tcp_log_dev_queue *entry)
 
 	/* Add references for all current listeners. */
 	refcount_init(&entry->tldq_refcnt, tcp_log_dev_listeners);
+	entry->tldq_flags = 0;
 
 	/*
 	 * If any listener is currently stuck on NULL, that means they are
@@ -493,6 +517,20 @@ tcp_log_dev_add_log(struct tcp_log_dev_queue *entry)
 	return (rv);
 }
 
+/*
+ * Report whether anyone has the device open. This is checked without the
+ * queue lock so producers can skip building a queue entry that
+ * tcp_log_dev_add_log() would only reject. A reader that opens the device
+ * concurrently may miss that entry, just as it would if it had opened the
+ * device a moment later.
+ */
+bool
+tcp_log_dev_listening(void)
+{
+
+	return (atomic_load_int(&tcp_log_dev_listeners) != 0);
+}
+
 static int
 tcp_log_dev_modevent(module_t mod __unused, int type, void *data __unused)
 {
@@ -57,11 +57,14 @@ struct tcp_log_common_header {
  * tldq_xform: If tldq_buf is NULL, the code will call this to create the
  *     the tldq_buf object. The function should *not* directly modify tldq_buf,
  *     but should return the buffer (which must meet the restrictions
- *     indicated for tldq_buf).
+ *     indicated for tldq_buf). It is called without the queue lock held and
+ *     may take a while; the common code ensures that only one call per entry
+ *     is in progress at a time.
  * tldq_dtor: This function is called to free the queue entry. If tldq_buf is
  *     not NULL, the dtor function must free that, too.
  * tldq_refcnt: used by the common code to indicate how many readers still need
  *     this data.
+ * tldq_flags: used by the common code to serialize calls to tldq_xform.
  */
 struct tcp_log_dev_queue {
 	STAILQ_ENTRY(tcp_log_dev_queue) tldq_queue;
@@ -69,8 +72,12 @@ struct tcp_log_dev_queue {
 	struct tcp_log_common_header *(*tldq_xform)(struct tcp_log_dev_queue *entry);
 	void	(*tldq_dtor)(struct tcp_log_dev_queue *entry);
 	volatile u_int tldq_refcnt;
+	u_int	tldq_flags;
 };
 
+#define	TLDQ_XFORM	0x0001	/* tldq_xform running */
+#define	TLDQ_XFORM_WAIT	0x0002	/* a reader waits for tldq_xform */
+
 STAILQ_HEAD(log_queueh, tcp_log_dev_queue);
 
 struct tcp_log_dev_info {
@@ -84,6 +91,7 @@ STAILQ_HEAD(log_infoh, tcp_log_dev_info);
 #ifdef TCP_BLACKBOX
 MALLOC_DECLARE(M_TCPLOGDEV);
 int tcp_log_dev_add_log(struct tcp_log_dev_queue *entry);
+bool tcp_log_dev_listening(void);
 #endif /* TCP_BLACKBOX */
 #endif /* _KERNEL */
 #endif /* !__tcp_log_dev_h__ */
@@ -47,6 +47,7 @@ __FBSDID("$FreeBSD$");
 #include <sys/mutex.h>
 #include <sys/taskqueue.h>
 #include <sys/smp.h>
+#include <sys/cpuset.h>
 #include <machine/smp.h>
 
 #include <vm/uma.h>
@@ -85,6 +86,11 @@ __FBSDID("$FreeBSD$");
 
 #include "opt_inet.h"
 #include "opt_inet6.h"
+#include "opt_rss.h"
+
+#ifdef RSS
+#include <net/rss_config.h>
+#endif
 
 static int	vtnet_modevent(module_t, int, void *);
 
@@ -168,6 +174,10 @@ static void	vtnet_accum_stats(struct vtnet_softc *,
 static void	vtnet_tick(void *);
 
 static void	vtnet_start_taskqueues(struct vtnet_softc *);
+#ifdef RSS
+static int	vtnet_rss_cpu(int);
+static void	vtnet_bind_intrs(struct vtnet_softc *);
+#endif
 static void	vtnet_free_taskqueues(struct vtnet_softc *);
 static void	vtnet_drain_taskqueues(struct vtnet_softc *);
 
@@ -421,6 +431,10 @@ vtnet_attach(device_t dev)
 		goto fail;
 	}
 
+#ifdef RSS
+	vtnet_bind_intrs(sc);
+#endif
+
 #ifdef DEV_NETMAP
 	vtnet_netmap_attach(sc);
 #endif /* DEV_NETMAP */
@@ -2371,14 +2385,26 @@ vtnet_txq_mq_start(struct ifnet *ifp, struct mbuf *m)
 	struct vtnet_softc *sc;
 	struct vtnet_txq *txq;
 	int i, npairs, error;
+#ifdef RSS
+	uint32_t bucket;
+#endif
 
 	sc = ifp->if_softc;
 	npairs = sc->vtnet_act_vq_pairs;
 
-	/* check if flowid is set */
-	if (M_HASHTYPE_GET(m) != M_HASHTYPE_NONE)
-		i = m->m_pkthdr.flowid % npairs;
-	else
+	/*
+	 * Keep the flow on the queue pair whose interrupt and taskqueue
+	 * are bound to the CPU of its RSS bucket.
+	 */
+	if (M_HASHTYPE_GET(m) != M_HASHTYPE_NONE) {
+#ifdef RSS
+		if (rss_hash2bucket(m->m_pkthdr.flowid,
+		    M_HASHTYPE_GET(m), &bucket) == 0)
+			i = bucket % npairs;
+		else
+#endif
+			i = m->m_pkthdr.flowid % npairs;
+	} else
 		i = curcpu % npairs;
 
 	txq = &sc->vtnet_txqs[i];
@@ -2687,6 +2713,9 @@ vtnet_start_taskqueues(struct vtnet_softc *sc)
 	struct vtnet_rxq *rxq;
 	struct vtnet_txq *txq;
 	int i, error;
+#ifdef RSS
+	cpuset_t cpu_mask;
+#endif
 
 	dev = sc->vtnet_dev;
 
@@ -2700,17 +2729,33 @@ vtnet_start_taskqueues(struct vtnet_softc *sc)
 	 * with ENOMEM so an error is not likely.
 	 */
 	for (i = 0; i < sc->vtnet_max_vq_pairs; i++) {
+#ifdef RSS
+		CPU_SETOF(vtnet_rss_cpu(i), &cpu_mask);
+#endif
+
 		rxq = &sc->vtnet_rxqs[i];
+#ifdef RSS
+		error = taskqueue_start_threads_cpuset(&rxq->vtnrx_tq, 1,
+		    PI_NET, &cpu_mask, "%s rxq %d", device_get_nameunit(dev),
+		    rxq->vtnrx_id);
+#else
 		error = taskqueue_start_threads(&rxq->vtnrx_tq, 1, PI_NET,
 		    "%s rxq %d", device_get_nameunit(dev), rxq->vtnrx_id);
+#endif
 		if (error) {
 			device_printf(dev, "failed to start rx taskq %d\n",
 			    rxq->vtnrx_id);
 		}
 
 		txq = &sc->vtnet_txqs[i];
+#ifdef RSS
+		error = taskqueue_start_threads_cpuset(&txq->vtntx_tq, 1,
+		    PI_NET, &cpu_mask, "%s txq %d", device_get_nameunit(dev),
+		    txq->vtntx_id);
+#else
 		error = taskqueue_start_threads(&txq->vtntx_tq, 1, PI_NET,
 		    "%s txq %d", device_get_nameunit(dev), txq->vtntx_id);
+#endif
 		if (error) {
 			device_printf(dev, "failed to start tx taskq %d\n",
 			    txq->vtntx_id);
@@ -2718,6 +2763,47 @@ vtnet_start_taskqueues(struct vtnet_softc *sc)
 	}
 }
 
+#ifdef RSS
+static int
+vtnet_rss_cpu(int id)
+{
+
+	return (rss_getcpu(id % rss_getnumbuckets()));
+}
+
+/*
+ * Bind the interrupts of each queue pair to the CPU of the RSS bucket
+ * the pair serves, so the host's completions are processed on the same
+ * CPU the stack expects the flow on.  This is best effort: it is only
+ * possible when each virtqueue has its own MSIX vector.
+ */
+static void
+vtnet_bind_intrs(struct vtnet_softc *sc)
+{
+	device_t dev;
+	int i, cpu, error;
+
+	dev = sc->vtnet_dev;
+
+	for (i = 0; i < sc->vtnet_max_vq_pairs; i++) {
+		cpu = vtnet_rss_cpu(i);
+
+		error = virtio_bind_intr(dev,
+		    virtqueue_index(sc->vtnet_rxqs[i].vtnrx_vq), cpu);
+		if (error == 0)
+			error = virtio_bind_intr(dev,
+			    virtqueue_index(sc->vtnet_txqs[i].vtntx_vq), cpu);
+
+		if (error == EOPNOTSUPP)
+			break;
+		if (error) {
+			device_printf(dev, "cannot bind queue pair %d "
+			    "interrupts to CPU %d\n", i, cpu);
+		}
+	}
+}
+#endif
+
 static void
 vtnet_free_taskqueues(struct vtnet_softc *sc)
 {
@@ -120,6 +120,7 @@ static void	vtpci_stop(device_t);
 static int	vtpci_reinit(device_t, uint64_t);
 static void	vtpci_reinit_complete(device_t);
 static void	vtpci_notify_virtqueue(device_t, uint16_t);
+static int	vtpci_bind_intr(device_t, uint16_t, int);
 static uint8_t	vtpci_get_status(device_t);
 static void	vtpci_set_status(device_t, uint8_t);
 static void	vtpci_read_dev_config(device_t, bus_size_t, void *, int);
@@ -212,6 +213,7 @@ static device_method_t vtpci_methods[] = {
 	DEVMETHOD(virtio_bus_reinit,		  vtpci_reinit),
 	DEVMETHOD(virtio_bus_reinit_complete,	  vtpci_reinit_complete),
 	DEVMETHOD(virtio_bus_notify_vq,		  vtpci_notify_virtqueue),
+	DEVMETHOD(virtio_bus_bind_intr,		  vtpci_bind_intr),
 	DEVMETHOD(virtio_bus_read_device_config,  vtpci_read_dev_config),
 	DEVMETHOD(virtio_bus_write_device_config, vtpci_write_dev_config),
 
@@ -1097,6 +1099,34 @@ vtpci_set_host_msix_vectors(struct vtpci_softc *sc)
 	return (error);
 }
 
+/*
+ * Bind the interrupt of the given virtqueue to a CPU.  Only possible when
+ * each virtqueue has its own MSIX vector.
+ */
+static int
+vtpci_bind_intr(device_t dev, uint16_t queue, int cpu)
+{
+	struct vtpci_softc *sc;
+	struct vtpci_interrupt *intr;
+	int idx;
+
+	sc = device_get_softc(dev);
+
+	if ((sc->vtpci_flags & VTPCI_FLAG_MSIX) == 0 ||
+	    (sc->vtpci_flags & VTPCI_FLAG_SHARED_MSIX) != 0)
+		return (EOPNOTSUPP);
+	if (queue >= sc->vtpci_nvqs || sc->vtpci_vqs[queue].vtv_no_intr)
+		return (EINVAL);
+
+	intr = sc->vtpci_msix_vq_interrupts;
+	for (idx = 0; idx < queue; idx++) {
+		if (!sc->vtpci_vqs[idx].vtv_no_intr)
+			intr++;
+	}
+
+	return (bus_bind_intr(dev, intr->vti_irq, cpu));
+}
+
 static int
 vtpci_reinit_virtqueue(struct vtpci_softc *sc, int idx)
 {
@@ -212,6 +212,13 @@ virtio_setup_intr(device_t dev, enum intr_type type)
 	return (VIRTIO_BUS_SETUP_INTR(device_get_parent(dev), type));
 }
 
+int
+virtio_bind_intr(device_t dev, uint16_t queue, int cpu)
+{
+
+	return (VIRTIO_BUS_BIND_INTR(device_get_parent(dev), queue, cpu));
+}
+
 int
 virtio_with_feature(device_t dev, uint64_t feature)
 {
@@ -76,6 +76,7 @@ uint64_t virtio_negotiate_features(device_t dev, uint64_t child_features);
 int	 virtio_alloc_virtqueues(device_t dev, int flags, int nvqs,
 	     struct vq_alloc_info *info);
 int	 virtio_setup_intr(device_t dev, enum intr_type type);
+int	 virtio_bind_intr(device_t dev, uint16_t queue, int cpu);
 int	 virtio_with_feature(device_t dev, uint64_t feature);
 void	 virtio_stop(device_t dev);
 int	 virtio_config_generation(device_t dev);
@@ -40,6 +40,12 @@ CODE {
 	{
 		return (0);
 	}
+
+	static int
+	virtio_bus_default_bind_intr(device_t dev, uint16_t queue, int cpu)
+	{
+		return (EOPNOTSUPP);
+	}
 };
 
 METHOD uint64_t negotiate_features {
@@ -82,6 +88,12 @@ METHOD void notify_vq {
 	uint16_t	queue;
 };
 
+METHOD int bind_intr {
+	device_t	dev;
+	uint16_t	queue;
+	int		cpu;
+} DEFAULT virtio_bus_default_bind_intr;
+
 METHOD int config_generation {
 	device_t	dev;
 } DEFAULT virtio_bus_default_config_generation;
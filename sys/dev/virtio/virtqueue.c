@@ -86,6 +86,15 @@ struct virtqueue {
 	 * trails vq_ring.used->idx.
 	 */
 	uint16_t		 vq_used_cons_idx;
+	/*
+	 * Private copy of vq_ring.avail->idx, and the last value read
+	 * from vq_ring.used->idx. The ring indices live on cache lines
+	 * shared with the host; these let the enqueue path avoid reading
+	 * back what it wrote and the dequeue path read the used index
+	 * once per batch of completions rather than once per entry.
+	 */
+	uint16_t		 vq_avail_idx;
+	uint16_t		 vq_used_idx;
 
 	struct vq_desc_extra {
 		void		  *cookie;
@@ -321,6 +330,8 @@ virtqueue_reinit(struct virtqueue *vq, uint16_t size)
 
 	vq->vq_desc_head_idx = 0;
 	vq->vq_used_cons_idx = 0;
+	vq->vq_avail_idx = 0;
+	vq->vq_used_idx = 0;
 	vq->vq_queued_cnt = 0;
 	vq->vq_free_cnt = vq->vq_nentries;
 
@@ -478,10 +489,9 @@ virtqueue_enable_intr(struct virtqueue *vq)
 int
 virtqueue_postpone_intr(struct virtqueue *vq, vq_postpone_t hint)
 {
-	uint16_t ndesc, avail_idx;
+	uint16_t ndesc;
 
-	avail_idx = vq->vq_ring.avail->idx;
-	ndesc = (uint16_t)(avail_idx - vq->vq_used_cons_idx);
+	ndesc = (uint16_t)(vq->vq_avail_idx - vq->vq_used_cons_idx);
 
 	switch (hint) {
 	case VQ_POSTPONE_SHORT:
@@ -571,8 +581,11 @@ virtqueue_dequeue(struct virtqueue *vq, uint32_t *len)
 	void *cookie;
 	uint16_t used_idx, desc_idx;
 
-	if (vq->vq_used_cons_idx == vq->vq_ring.used->idx)
-		return (NULL);
+	if (vq->vq_used_cons_idx == vq->vq_used_idx) {
+		vq->vq_used_idx = vq->vq_ring.used->idx;
+		if (vq->vq_used_cons_idx == vq->vq_used_idx)
+			return (NULL);
+	}
 
 	used_idx = vq->vq_used_cons_idx++ & (vq->vq_nentries - 1);
 	uep = &vq->vq_ring.used->ring[used_idx];
@@ -677,11 +690,11 @@ vq_ring_update_avail(struct virtqueue *vq, uint16_t desc_idx)
 	 * currently running on another CPU, we can keep it processing the new
 	 * descriptor.
 	 */
-	avail_idx = vq->vq_ring.avail->idx & (vq->vq_nentries - 1);
+	avail_idx = vq->vq_avail_idx & (vq->vq_nentries - 1);
 	vq->vq_ring.avail->ring[avail_idx] = desc_idx;
 
 	wmb();
-	vq->vq_ring.avail->idx++;
+	vq->vq_ring.avail->idx = ++vq->vq_avail_idx;
 
 	/* Keep pending count until virtqueue_notify(). */
 	vq->vq_queued_cnt++;
@@ -806,7 +819,7 @@ vq_ring_must_notify_host(struct virtqueue *vq)
 	uint16_t new_idx, prev_idx, event_idx;
 
 	if (vq->vq_flags & VIRTQUEUE_FLAG_EVENT_IDX) {
-		new_idx = vq->vq_ring.avail->idx;
+		new_idx = vq->vq_avail_idx;
 		prev_idx = new_idx - vq->vq_queued_cnt;
 		event_idx = vring_avail_event(&vq->vq_ring);
 
@@ -204,6 +204,36 @@ SYSCTL_UINT(_vfs_nfsd, OID_AUTO, cachetcp, CTLFLAG_RW,
     &nfsrc_tcpnonidempotent, 0,
     "Enable the DRC for NFS over TCP");
 
+/*
+ * DRC statistics. The hit and miss counts are the ones nfsstat(1) reports;
+ * the rest describe how much work goes into keeping the TCP cache trimmed.
+ */
+SYSCTL_U64(_vfs_nfsd, OID_AUTO, cachemisses, CTLFLAG_RD,
+    &nfsstatsv1.srvcache_misses, 0,
+    "DRC lookups that did not find an entry");
+SYSCTL_U64(_vfs_nfsd, OID_AUTO, cacheinproghits, CTLFLAG_RD,
+    &nfsstatsv1.srvcache_inproghits, 0,
+    "DRC hits on requests still in progress");
+SYSCTL_U64(_vfs_nfsd, OID_AUTO, cachedonehits, CTLFLAG_RD,
+    &nfsstatsv1.srvcache_nonidemdonehits, 0,
+    "DRC hits answered from a saved reply");
+static u_long nfsrc_ackfrees = 0;
+SYSCTL_ULONG(_vfs_nfsd, OID_AUTO, cacheackfrees, CTLFLAG_RD,
+    &nfsrc_ackfrees, 0,
+    "TCP DRC entries freed as soon as the client ACKed the reply");
+static u_long nfsrc_trimpasses = 0;
+SYSCTL_ULONG(_vfs_nfsd, OID_AUTO, cachetrimpasses, CTLFLAG_RD,
+    &nfsrc_trimpasses, 0,
+    "Trim passes over the TCP DRC");
+static u_long nfsrc_trimfrees = 0;
+SYSCTL_ULONG(_vfs_nfsd, OID_AUTO, cachetrimfrees, CTLFLAG_RD,
+    &nfsrc_trimfrees, 0,
+    "TCP DRC entries freed by trim passes");
+static u_long nfsrc_trimusecs = 0;
+SYSCTL_ULONG(_vfs_nfsd, OID_AUTO, cachetrimusecs, CTLFLAG_RD,
+    &nfsrc_trimusecs, 0,
+    "Microseconds spent in TCP DRC trim passes");
+
 static int nfsrc_udpcachesize = 0;
 static TAILQ_HEAD(, nfsrvcache) nfsrvudplru;
 static struct nfsrvhashhead nfsrvudphashtbl[NFSRVCACHE_HASHSIZE];
@@ -285,6 +315,7 @@ static void nfsrc_lock(struct nfsrvcache *rp);
 static void nfsrc_unlock(struct nfsrvcache *rp);
 static void nfsrc_wanted(struct nfsrvcache *rp);
 static void nfsrc_freecache(struct nfsrvcache *rp);
+static void nfsrc_freeentry(struct nfsrvcache *rp);
 static int nfsrc_getlenandcksum(mbuf_t m1, u_int16_t *cksum);
 static void nfsrc_marksametcpconn(u_int64_t);
 
@@ -796,6 +827,17 @@ nfsrc_freecache(struct nfsrvcache *rp)
 			LIST_REMOVE(rp, rc_ahash);
 		mtx_unlock(&hbp->mtx);
 	}
+	nfsrc_freeentry(rp);
+}
+
+/*
+ * Release an entry that has already been unlinked from the hash lists.
+ * Must not sleep.
+ */
+static void
+nfsrc_freeentry(struct nfsrvcache *rp)
+{
+
 	nfsrc_wanted(rp);
 	if (rp->rc_flag & RC_REPMBUF) {
 		mbuf_freem(rp->rc_reply);
@@ -841,9 +883,11 @@ nfsrc_trimcache(u_int64_t sockref, uint32_t snd_una, int final)
 {
 	struct nfsrchash_bucket *hbp;
 	struct nfsrvcache *rp, *nextrp;
+	struct mtx *mutex;
+	sbintime_t sbt;
 	int force, lastslot, i, j, k, tto, time_histo[HISTSIZE];
 	time_t thisstamp;
-	static time_t udp_lasttrim = 0, tcp_lasttrim = 0;
+	static time_t udp_lasttrim = 0, tcp_lasttrim = 0, tcp_lastforce = 0;
 	static int onethread = 0, oneslot = 0;
 
 	if (sockref != 0) {
@@ -854,6 +898,26 @@ nfsrc_trimcache(u_int64_t sockref, uint32_t snd_una, int final)
 				if (SEQ_GEQ(snd_una, rp->rc_tcpseq)) {
 					rp->rc_acked = RC_ACK;
 					LIST_REMOVE(rp, rc_ahash);
+					/*
+					 * The client has the reply, so free
+					 * the entry now instead of leaving it
+					 * for a pass over the hash table.
+					 * The hash mutex is acquired before
+					 * the ACK one everywhere else, so only
+					 * try for it here.
+					 */
+					mutex = nfsrc_cachemutex(rp);
+					if (mtx_trylock(mutex) == 0)
+						continue;
+					if (!(rp->rc_flag &
+					    (RC_INPROG|RC_LOCKED|RC_WANTED)) &&
+					    rp->rc_refcnt == 0) {
+						LIST_REMOVE(rp, rc_hash);
+						nfsrc_freeentry(rp);
+						atomic_add_long(&nfsrc_ackfrees,
+						    1);
+					}
+					mtx_unlock(mutex);
 				} else if (final) {
 					rp->rc_acked = RC_NACK;
 					LIST_REMOVE(rp, rc_ahash);
@@ -882,9 +946,19 @@ nfsrc_trimcache(u_int64_t sockref, uint32_t snd_una, int final)
 	}
 	if (NFSD_MONOSEC != tcp_lasttrim ||
 	    nfsrc_tcpsavedreplies >= nfsrc_tcphighwater) {
+		sbt = sbinuptime();
 		force = nfsrc_tcphighwater / 4;
+		/*
+		 * A forced trim walks the whole table twice, so do it at
+		 * most once a second unless saving replies has stopped.
+		 * In between, acknowledged replies are freed as the ACKs
+		 * arrive and the table is swept one slot per call.
+		 */
 		if (force > 0 &&
-		    nfsrc_tcpsavedreplies + force >= nfsrc_tcphighwater) {
+		    nfsrc_tcpsavedreplies + force >= nfsrc_tcphighwater &&
+		    (NFSD_MONOSEC != tcp_lastforce ||
+		     nfsrc_tcpsavedreplies > nfsrc_floodlevel)) {
+			tcp_lastforce = NFSD_MONOSEC;
 			for (i = 0; i < HISTSIZE; i++)
 				time_histo[i] = 0;
 			i = 0;
@@ -913,6 +987,7 @@ nfsrc_trimcache(u_int64_t sockref, uint32_t snd_una, int final)
 					    tcp_lasttrim > rp->rc_timestamp ||
 					    rp->rc_acked == RC_ACK) {
 						nfsrc_freecache(rp);
+						nfsrc_trimfrees++;
 						continue;
 					}
 
@@ -961,12 +1036,16 @@ nfsrc_trimcache(u_int64_t sockref, uint32_t snd_una, int final)
 					     && rp->rc_refcnt == 0
 					     && ((rp->rc_flag & RC_REFCNT) ||
 						 thisstamp > rp->rc_timestamp ||
-						 rp->rc_acked == RC_ACK))
+						 rp->rc_acked == RC_ACK)) {
 						nfsrc_freecache(rp);
+						nfsrc_trimfrees++;
+					}
 				}
 				mtx_unlock(&nfsrchash_table[i].mtx);
 			}
 		}
+		nfsrc_trimpasses++;
+		nfsrc_trimusecs += sbttous(sbinuptime() - sbt);
 	}
 	atomic_store_rel_int(&onethread, 0);
 }
@@ -97,6 +97,13 @@ SYSCTL_PROC(_vfs_tmpfs, OID_AUTO, memory_reserved, CTLTYPE_LONG|CTLFLAG_RW,
     &tmpfs_pages_reserved, 0, sysctl_mem_reserved, "L",
     "Amount of available memory and swap below which tmpfs growth stops");
 
+#if VM_NRESERVLEVEL > 0
+static int tmpfs_superpages = 1;
+SYSCTL_INT(_vfs_tmpfs, OID_AUTO, superpages, CTLFLAG_RWTUN,
+    &tmpfs_superpages, 0,
+    "Allocate the data of files larger than a superpage from reservations");
+#endif
+
 static __inline int tmpfs_dirtree_cmp(struct tmpfs_dirent *a,
     struct tmpfs_dirent *b);
 RB_PROTOTYPE_STATIC(tmpfs_dir, tmpfs_dirent, uh.td_entries, tmpfs_dirtree_cmp);
@@ -1460,6 +1467,17 @@ tmpfs_reg_resize(struct vnode *vp, off_t newsize, boolean_t ignerr)
 		}
 	}
 	uobj->size = newpages;
+#if VM_NRESERVLEVEL > 0
+	/*
+	 * Pages written through tmpfs_write() are allocated before the
+	 * object is ever mapped, so nothing colors it and they never come
+	 * from reservations.  Color the object once the file covers a
+	 * whole superpage; smaller files are left alone so that each of
+	 * them does not hold on to a mostly empty reservation.
+	 */
+	if (tmpfs_superpages && newpages >= (1 << VM_LEVEL_0_ORDER))
+		vm_object_color(uobj, 0);
+#endif
 	VM_OBJECT_WUNLOCK(uobj);
 
 	atomic_add_long(&tmp->tm_pages_used, newpages - oldpages);
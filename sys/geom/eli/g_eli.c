@@ -85,6 +85,14 @@ SYSCTL_UINT(_kern_geom_eli, OID_AUTO, threads, CTLFLAG_RWTUN, &g_eli_threads, 0,
 u_int g_eli_batch = 0;
 SYSCTL_UINT(_kern_geom_eli, OID_AUTO, batch, CTLFLAG_RWTUN, &g_eli_batch, 0,
     "Use crypto operations batching");
+u_int g_eli_batch_sectors = 16;
+SYSCTL_UINT(_kern_geom_eli, OID_AUTO, batch_sectors, CTLFLAG_RWTUN,
+    &g_eli_batch_sectors, 0,
+    "Number of sectors per crypto request, if the crypto driver allows it");
+static u_int g_eli_same_cpu = 0;
+SYSCTL_UINT(_kern_geom_eli, OID_AUTO, same_cpu, CTLFLAG_RWTUN,
+    &g_eli_same_cpu, 0,
+    "Do the crypto work on the worker bound to the CPU queueing the request");
 
 /*
  * Passphrase cached during boot, in order to be more user-friendly if
@@ -203,6 +211,7 @@ g_eli_crypto_rerun(struct cryptop *crp)
 	    bp->bio_cmd == BIO_READ ? "READ" : "WRITE", wr->w_sid,
 	    crp->crp_session);
 	wr->w_sid = crp->crp_session;
+	wr->w_chain = (crypto_ses2caps(wr->w_sid) & CRYPTOCAP_F_CHAIN) != 0;
 	crp->crp_etype = 0;
 	error = crypto_dispatch(crp);
 	if (error == 0)
@@ -212,6 +221,29 @@ g_eli_crypto_rerun(struct cryptop *crp)
 	return (error);
 }
 
+/*
+ * Hand a request over to the workers.  If kern.geom.eli.same_cpu is set and
+ * the workers are bound to CPUs, the request goes to the worker of the CPU
+ * we are running on, so its data stays in that CPU's caches.  Otherwise any
+ * worker may pick it up.
+ */
+static void
+g_eli_queue(struct g_eli_softc *sc, struct bio *bp)
+{
+	struct g_eli_worker *wr;
+
+	mtx_lock(&sc->sc_queue_mtx);
+	wr = NULL;
+	if (g_eli_same_cpu && sc->sc_cpuworkers != NULL)
+		wr = sc->sc_cpuworkers[curcpu];
+	if (wr != NULL)
+		bioq_insert_tail(&wr->w_queue, bp);
+	else
+		bioq_insert_tail(&sc->sc_queue, bp);
+	mtx_unlock(&sc->sc_queue_mtx);
+	wakeup(sc);
+}
+
 static void
 g_eli_getattr_done(struct bio *bp)
 {
@@ -232,9 +264,17 @@ g_eli_read_done(struct bio *bp)
 {
 	struct g_eli_softc *sc;
 	struct bio *pbp;
+	struct mtx *mtxp;
+	bool last;
 
 	G_ELI_LOGREQ(2, bp, "Request done.");
 	pbp = bp->bio_parent;
+	/*
+	 * With direct dispatch the children may complete concurrently
+	 * on different CPUs.
+	 */
+	mtxp = mtx_pool_find(mtxpool_sleep, pbp);
+	mtx_lock(mtxp);
 	if (pbp->bio_error == 0 && bp->bio_error != 0)
 		pbp->bio_error = bp->bio_error;
 	g_destroy_bio(bp);
@@ -242,7 +282,9 @@ g_eli_read_done(struct bio *bp)
 	 * Do we have all sectors already?
 	 */
 	pbp->bio_inbed++;
-	if (pbp->bio_inbed < pbp->bio_children)
+	last = pbp->bio_inbed == pbp->bio_children;
+	mtx_unlock(mtxp);
+	if (!last)
 		return;
 	sc = pbp->bio_to->geom->softc;
 	if (pbp->bio_error != 0) {
@@ -258,10 +300,7 @@ g_eli_read_done(struct bio *bp)
 			atomic_subtract_int(&sc->sc_inflight, 1);
 		return;
 	}
-	mtx_lock(&sc->sc_queue_mtx);
-	bioq_insert_tail(&sc->sc_queue, pbp);
-	mtx_unlock(&sc->sc_queue_mtx);
-	wakeup(sc);
+	g_eli_queue(sc, pbp);
 }
 
 /*
@@ -274,9 +313,17 @@ g_eli_write_done(struct bio *bp)
 {
 	struct g_eli_softc *sc;
 	struct bio *pbp;
+	struct mtx *mtxp;
+	bool last;
 
 	G_ELI_LOGREQ(2, bp, "Request done.");
 	pbp = bp->bio_parent;
+	/*
+	 * With direct dispatch the children may complete concurrently
+	 * on different CPUs.
+	 */
+	mtxp = mtx_pool_find(mtxpool_sleep, pbp);
+	mtx_lock(mtxp);
 	if (pbp->bio_error == 0 && bp->bio_error != 0)
 		pbp->bio_error = bp->bio_error;
 	g_destroy_bio(bp);
@@ -284,7 +331,9 @@ g_eli_write_done(struct bio *bp)
 	 * Do we have all sectors already?
 	 */
 	pbp->bio_inbed++;
-	if (pbp->bio_inbed < pbp->bio_children)
+	last = pbp->bio_inbed == pbp->bio_children;
+	mtx_unlock(mtxp);
+	if (!last)
 		return;
 	free(pbp->bio_driver2, M_ELI);
 	pbp->bio_driver2 = NULL;
@@ -383,10 +432,7 @@ g_eli_start(struct bio *bp)
 		}
 		/* FALLTHROUGH */
 	case BIO_WRITE:
-		mtx_lock(&sc->sc_queue_mtx);
-		bioq_insert_tail(&sc->sc_queue, bp);
-		mtx_unlock(&sc->sc_queue_mtx);
-		wakeup(sc);
+		g_eli_queue(sc, bp);
 		break;
 	case BIO_GETATTR:
 	case BIO_FLUSH:
@@ -462,6 +508,11 @@ g_eli_newsession(struct g_eli_worker *wr)
 		panic("%s: invalid condition", __func__);
 	}
 
+	if (error == 0) {
+		wr->w_chain =
+		    (crypto_ses2caps(wr->w_sid) & CRYPTOCAP_F_CHAIN) != 0;
+	}
+
 	if ((sc->sc_flags & G_ELI_FLAG_FIRST_KEY) != 0)
 		g_eli_key_drop(sc, crie.cri_key);
 
@@ -476,37 +527,70 @@ g_eli_freesession(struct g_eli_worker *wr)
 }
 
 static void
-g_eli_cancel(struct g_eli_softc *sc)
+g_eli_cancel(struct g_eli_softc *sc, struct g_eli_worker *wr)
 {
+	struct bio_queue_head queue;
 	struct bio *bp;
 
 	mtx_assert(&sc->sc_queue_mtx, MA_OWNED);
 
-	while ((bp = bioq_takefirst(&sc->sc_queue)) != NULL) {
-		KASSERT(bp->bio_pflags == G_ELI_NEW_BIO,
-		    ("Not new bio when canceling (bp=%p).", bp));
-		g_io_deliver(bp, ENXIO);
+	/* Stop taking requests on behalf of our CPU. */
+	if (sc->sc_cpuworkers != NULL)
+		sc->sc_cpuworkers[wr->w_number] = NULL;
+
+	/*
+	 * Our provider dispatches completions directly, so the consumer's
+	 * done routine may run from g_io_deliver() and send us new I/O.
+	 * Complete the requests without holding the queue lock.
+	 */
+	while (bioq_first(&sc->sc_queue) != NULL ||
+	    bioq_first(&wr->w_queue) != NULL) {
+		bioq_init(&queue);
+		while ((bp = bioq_takefirst(&wr->w_queue)) != NULL ||
+		    (bp = bioq_takefirst(&sc->sc_queue)) != NULL) {
+			KASSERT(bp->bio_pflags == G_ELI_NEW_BIO,
+			    ("Not new bio when canceling (bp=%p).", bp));
+			bioq_insert_tail(&queue, bp);
+		}
+		mtx_unlock(&sc->sc_queue_mtx);
+		while ((bp = bioq_takefirst(&queue)) != NULL)
+			g_io_deliver(bp, ENXIO);
+		mtx_lock(&sc->sc_queue_mtx);
 	}
 }
 
 static struct bio *
-g_eli_takefirst(struct g_eli_softc *sc)
+g_eli_takefirst_queue(struct g_eli_softc *sc, struct bio_queue_head *queue)
 {
 	struct bio *bp;
 
 	mtx_assert(&sc->sc_queue_mtx, MA_OWNED);
 
 	if (!(sc->sc_flags & G_ELI_FLAG_SUSPEND))
-		return (bioq_takefirst(&sc->sc_queue));
+		return (bioq_takefirst(queue));
 	/*
 	 * Device suspended, so we skip new I/O requests.
 	 */
-	TAILQ_FOREACH(bp, &sc->sc_queue.queue, bio_queue) {
+	TAILQ_FOREACH(bp, &queue->queue, bio_queue) {
 		if (bp->bio_pflags != G_ELI_NEW_BIO)
 			break;
 	}
 	if (bp != NULL)
-		bioq_remove(&sc->sc_queue, bp);
+		bioq_remove(queue, bp);
+	return (bp);
+}
+
+/*
+ * Requests queued for our CPU come first, then the ones any worker may take.
+ */
+static struct bio *
+g_eli_takefirst(struct g_eli_softc *sc, struct g_eli_worker *wr)
+{
+	struct bio *bp;
+
+	bp = g_eli_takefirst_queue(sc, &wr->w_queue);
+	if (bp == NULL)
+		bp = g_eli_takefirst_queue(sc, &sc->sc_queue);
 	return (bp);
 }
 
@@ -546,10 +630,10 @@ g_eli_worker(void *arg)
 	for (;;) {
 		mtx_lock(&sc->sc_queue_mtx);
 again:
-		bp = g_eli_takefirst(sc);
+		bp = g_eli_takefirst(sc, wr);
 		if (bp == NULL) {
 			if (sc->sc_flags & G_ELI_FLAG_DESTROY) {
-				g_eli_cancel(sc);
+				g_eli_cancel(sc, wr);
 				LIST_REMOVE(wr, w_next);
 				g_eli_freesession(wr);
 				free(wr, M_ELI);
@@ -778,6 +862,7 @@ g_eli_create(struct gctl_req *req, struct g_class *mp, struct g_provider *bpp,
 
 	pp = NULL;
 	cp = g_new_consumer(gp);
+	cp->flags |= G_CF_DIRECT_SEND | G_CF_DIRECT_RECEIVE;
 	error = g_attach(cp, bpp);
 	if (error != 0) {
 		if (req != NULL) {
@@ -822,6 +907,10 @@ g_eli_create(struct gctl_req *req, struct g_class *mp, struct g_provider *bpp,
 	if (threads == 0)
 		threads = mp_ncpus;
 	sc->sc_cpubind = (mp_ncpus > 1 && threads == mp_ncpus);
+	if (sc->sc_cpubind) {
+		sc->sc_cpuworkers = malloc(sizeof(*sc->sc_cpuworkers) *
+		    (mp_maxid + 1), M_ELI, M_WAITOK | M_ZERO);
+	}
 	for (i = 0; i < threads; i++) {
 		if (g_eli_cpu_is_disabled(i)) {
 			G_ELI_DEBUG(1, "%s: CPU %u disabled, skipping.",
@@ -832,6 +921,7 @@ g_eli_create(struct gctl_req *req, struct g_class *mp, struct g_provider *bpp,
 		wr->w_softc = sc;
 		wr->w_number = i;
 		wr->w_active = TRUE;
+		bioq_init(&wr->w_queue);
 
 		error = g_eli_newsession(wr);
 		if (error != 0) {
@@ -861,12 +951,15 @@ g_eli_create(struct gctl_req *req, struct g_class *mp, struct g_provider *bpp,
 			goto failed;
 		}
 		LIST_INSERT_HEAD(&sc->sc_workers, wr, w_next);
+		if (sc->sc_cpuworkers != NULL)
+			sc->sc_cpuworkers[i] = wr;
 	}
 
 	/*
 	 * Create decrypted provider.
 	 */
 	pp = g_new_providerf(gp, "%s%s", bpp->name, G_ELI_SUFFIX);
+	pp->flags |= G_PF_DIRECT_SEND | G_PF_DIRECT_RECEIVE;
 	pp->mediasize = sc->sc_mediasize;
 	pp->sectorsize = sc->sc_sectorsize;
 
@@ -892,6 +985,7 @@ g_eli_create(struct gctl_req *req, struct g_class *mp, struct g_provider *bpp,
 		    "geli:destroy", 0);
 	}
 	mtx_destroy(&sc->sc_queue_mtx);
+	free(sc->sc_cpuworkers, M_ELI);
 	if (cp->provider != NULL) {
 		if (cp->acr == 1)
 			g_access(cp, -1, -1, -1);
@@ -942,6 +1036,7 @@ g_eli_destroy(struct g_eli_softc *sc, boolean_t force)
 		    "geli:destroy", 0);
 	}
 	mtx_destroy(&sc->sc_queue_mtx);
+	free(sc->sc_cpuworkers, M_ELI);
 	gp->softc = NULL;
 	g_eli_key_destroy(sc);
 	bzero(sc, sizeof(*sc));
@@ -151,6 +151,7 @@
 extern int g_eli_debug;
 extern u_int g_eli_overwrites;
 extern u_int g_eli_batch;
+extern u_int g_eli_batch_sectors;
 
 #define	G_ELI_DEBUG(lvl, ...)	do {					\
 	if (g_eli_debug >= (lvl)) {					\
@@ -181,6 +182,8 @@ struct g_eli_worker {
 	u_int			 w_number;
 	crypto_session_t	 w_sid;
 	boolean_t		 w_active;
+	boolean_t		 w_chain;	/* driver takes sector chains */
+	struct bio_queue_head	 w_queue;	/* requests for this CPU */
 	LIST_ENTRY(g_eli_worker) w_next;
 };
 
@@ -222,6 +225,7 @@ struct g_eli_softc {
 	struct bio_queue_head sc_queue;
 	struct mtx	 sc_queue_mtx;
 	LIST_HEAD(, g_eli_worker) sc_workers;
+	struct g_eli_worker **sc_cpuworkers;	/* indexed by bound CPU */
 #endif /* _KERNEL */
 };
 #define	sc_name		 sc_geom->name
@@ -66,6 +66,18 @@ MALLOC_DECLARE(M_ELI);
  *
  * g_eli_start -> g_eli_crypto_read -> g_io_request -> g_eli_read_done -> g_eli_crypto_run -> G_ELI_CRYPTO_READ_DONE -> g_io_deliver
  */
+/*
+ * Release the keys held for every sector of the request.
+ */
+static void
+g_eli_crypto_keys_drop(struct g_eli_softc *sc, struct cryptop *crp)
+{
+	struct cryptodesc *crd;
+
+	for (crd = crp->crp_desc; crd != NULL; crd = crd->crd_next)
+		g_eli_key_drop(sc, crd->crd_key);
+}
+
 static int
 g_eli_crypto_read_done(struct cryptop *crp)
 {
@@ -90,7 +102,7 @@ g_eli_crypto_read_done(struct cryptop *crp)
 	}
 	sc = bp->bio_to->geom->softc;
 	if (sc != NULL)
-		g_eli_key_drop(sc, crp->crp_desc->crd_key);
+		g_eli_crypto_keys_drop(sc, crp);
 	/*
 	 * Do we have all sectors already?
 	 */
@@ -142,7 +154,7 @@ g_eli_crypto_write_done(struct cryptop *crp)
 	}
 	gp = bp->bio_to->geom;
 	sc = gp->softc;
-	g_eli_key_drop(sc, crp->crp_desc->crd_key);
+	g_eli_crypto_keys_drop(sc, crp);
 	/*
 	 * All sectors are already encrypted?
 	 */
@@ -231,9 +243,10 @@ void
 g_eli_crypto_run(struct g_eli_worker *wr, struct bio *bp)
 {
 	struct g_eli_softc *sc;
+	struct cryptopq crpq;
 	struct cryptop *crp;
-	struct cryptodesc *crd;
-	u_int i, nsec, secsize;
+	struct cryptodesc *crd, *prevcrd;
+	u_int i, nsec, ncrp, batch, secsize;
 	off_t dstoff;
 	size_t size;
 	u_char *p, *data;
@@ -246,14 +259,24 @@ g_eli_crypto_run(struct g_eli_worker *wr, struct bio *bp)
 	secsize = LIST_FIRST(&sc->sc_geom->provider)->sectorsize;
 	nsec = bp->bio_length / secsize;
 
+	/*
+	 * Every sector needs its own crypto descriptor, as it has its own IV
+	 * and possibly its own key.  If the driver accepts a chain of cipher
+	 * descriptors, pack up to g_eli_batch_sectors of them into a single
+	 * crypto operation to save on per-operation overhead.
+	 */
+	batch = 1;
+	if (wr->w_chain && g_eli_batch_sectors > 1)
+		batch = g_eli_batch_sectors;
+	ncrp = howmany(nsec, batch);
+
 	/*
 	 * Calculate how much memory do we need.
-	 * We need separate crypto operation for every single sector.
 	 * It is much faster to calculate total amount of needed memory here and
 	 * do the allocation once instead of allocating memory in pieces (many,
 	 * many pieces).
 	 */
-	size = sizeof(*crp) * nsec;
+	size = sizeof(*crp) * ncrp;
 	size += sizeof(*crd) * nsec;
 	/*
 	 * If we write the data we cannot destroy current bio_data content,
@@ -264,7 +287,7 @@ g_eli_crypto_run(struct g_eli_worker *wr, struct bio *bp)
 	p = malloc(size, M_ELI, M_WAITOK);
 
 	bp->bio_inbed = 0;
-	bp->bio_children = nsec;
+	bp->bio_children = ncrp;
 	bp->bio_driver2 = p;
 
 	if (bp->bio_cmd == BIO_READ)
@@ -275,26 +298,39 @@ g_eli_crypto_run(struct g_eli_worker *wr, struct bio *bp)
 		bcopy(bp->bio_data, data, bp->bio_length);
 	}
 
+	TAILQ_INIT(&crpq);
+	crp = NULL;
+	prevcrd = NULL;
 	for (i = 0, dstoff = bp->bio_offset; i < nsec; i++, dstoff += secsize) {
-		crp = (struct cryptop *)p;	p += sizeof(*crp);
-		crd = (struct cryptodesc *)p;	p += sizeof(*crd);
+		if (i % batch == 0) {
+			crp = (struct cryptop *)p;	p += sizeof(*crp);
 
-		crp->crp_session = wr->w_sid;
-		crp->crp_ilen = secsize;
-		crp->crp_olen = secsize;
-		crp->crp_opaque = (void *)bp;
-		crp->crp_buf = (void *)data;
+			crp->crp_session = wr->w_sid;
+			crp->crp_ilen = 0;
+			crp->crp_olen = 0;
+			crp->crp_opaque = (void *)bp;
+			crp->crp_buf = (void *)data;
+			if (bp->bio_cmd == BIO_WRITE)
+				crp->crp_callback = g_eli_crypto_write_done;
+			else /* if (bp->bio_cmd == BIO_READ) */
+				crp->crp_callback = g_eli_crypto_read_done;
+			crp->crp_flags = CRYPTO_F_CBIFSYNC;
+			if (g_eli_batch)
+				crp->crp_flags |= CRYPTO_F_BATCH;
+			crp->crp_desc = NULL;
+			prevcrd = NULL;
+		}
+		crd = (struct cryptodesc *)p;	p += sizeof(*crd);
 		data += secsize;
-		if (bp->bio_cmd == BIO_WRITE)
-			crp->crp_callback = g_eli_crypto_write_done;
-		else /* if (bp->bio_cmd == BIO_READ) */
-			crp->crp_callback = g_eli_crypto_read_done;
-		crp->crp_flags = CRYPTO_F_CBIFSYNC;
-		if (g_eli_batch)
-			crp->crp_flags |= CRYPTO_F_BATCH;
-		crp->crp_desc = crd;
+		crp->crp_ilen += secsize;
+		crp->crp_olen += secsize;
+		if (prevcrd == NULL)
+			crp->crp_desc = crd;
+		else
+			prevcrd->crd_next = crd;
+		prevcrd = crd;
 
-		crd->crd_skip = 0;
+		crd->crd_skip = (i % batch) * secsize;
 		crd->crd_len = secsize;
 		crd->crd_flags = CRD_F_IV_EXPLICIT | CRD_F_IV_PRESENT;
 		if ((sc->sc_flags & G_ELI_FLAG_SINGLE_KEY) == 0)
@@ -310,9 +346,18 @@ g_eli_crypto_run(struct g_eli_worker *wr, struct bio *bp)
 		    sizeof(crd->crd_iv));
 		crd->crd_next = NULL;
 
+		if (i % batch != batch - 1 && i != nsec - 1)
+			continue;
 		crp->crp_etype = 0;
-		error = crypto_dispatch(crp);
-		KASSERT(error == 0, ("crypto_dispatch() failed (error=%d)",
-		    error));
+		TAILQ_INSERT_TAIL(&crpq, crp, crp_next);
 	}
+
+	/*
+	 * Submit all operations at once.  The last one to complete frees
+	 * the memory they live in, so nothing here may be touched after
+	 * this call.
+	 */
+	error = crypto_dispatch_batch(&crpq);
+	KASSERT(error == 0, ("crypto_dispatch_batch() failed (error=%d)",
+	    error));
 }
@@ -47,6 +47,7 @@ __FBSDID("$FreeBSD$");
 #include <sys/kernel.h>
 #include <sys/malloc.h>
 #include <sys/bio.h>
+#include <sys/counter.h>
 #include <sys/ktr.h>
 #include <sys/proc.h>
 #include <sys/stack.h>
@@ -83,6 +84,15 @@ static struct g_bioq g_bio_run_up;
  */
 static volatile u_int pace;
 
+/*
+ * Count how many requests and completions were dispatched directly
+ * versus handed to the g_down and g_up threads.
+ */
+static counter_u64_t g_io_down_direct;
+static counter_u64_t g_io_down_queued;
+static counter_u64_t g_io_up_direct;
+static counter_u64_t g_io_up_queued;
+
 static uma_zone_t	biozone;
 
 /*
@@ -284,6 +294,10 @@ g_io_init()
 
 	g_bioq_init(&g_bio_run_down);
 	g_bioq_init(&g_bio_run_up);
+	g_io_down_direct = counter_u64_alloc(M_WAITOK);
+	g_io_down_queued = counter_u64_alloc(M_WAITOK);
+	g_io_up_direct = counter_u64_alloc(M_WAITOK);
+	g_io_up_queued = counter_u64_alloc(M_WAITOK);
 	biozone = uma_zcreate("g_bio", sizeof (struct bio),
 	    NULL, NULL,
 	    NULL, NULL,
@@ -624,6 +638,7 @@ g_io_request(struct bio *bp, struct g_consumer *cp)
 	mtx_unlock(mtxp);
 
 	if (direct) {
+		counter_u64_add(g_io_down_direct, 1);
 		error = g_io_check(bp);
 		if (error >= 0) {
 			CTR3(KTR_GEOM, "g_io_request g_io_check on bp %p "
@@ -634,6 +649,7 @@ g_io_request(struct bio *bp, struct g_consumer *cp)
 		}
 		bp->bio_to->geom->start(bp);
 	} else {
+		counter_u64_add(g_io_down_queued, 1);
 		g_bioq_lock(&g_bio_run_down);
 		first = TAILQ_EMPTY(&g_bio_run_down.bio_queue);
 		TAILQ_INSERT_TAIL(&g_bio_run_down.bio_queue, bp, bio_queue);
@@ -737,8 +753,10 @@ g_io_deliver(struct bio *bp, int error)
 	if (error != ENOMEM) {
 		bp->bio_error = error;
 		if (direct) {
+			counter_u64_add(g_io_up_direct, 1);
 			biodone(bp);
 		} else {
+			counter_u64_add(g_io_up_queued, 1);
 			g_bioq_lock(&g_bio_run_up);
 			first = TAILQ_EMPTY(&g_bio_run_up.bio_queue);
 			TAILQ_INSERT_TAIL(&g_bio_run_up.bio_queue, bp, bio_queue);
@@ -787,6 +805,17 @@ SYSCTL_INT(_kern_geom, OID_AUTO, inflight_transient_maps, CTLFLAG_RD,
     &inflight_transient_maps, 0,
     "Current count of the active transient maps");
 
+static SYSCTL_NODE(_kern_geom, OID_AUTO, dispatch, CTLFLAG_RW, 0,
+    "GEOM I/O dispatch statistics");
+SYSCTL_COUNTER_U64(_kern_geom_dispatch, OID_AUTO, down_direct, CTLFLAG_RD,
+    &g_io_down_direct, "Requests started directly by the caller");
+SYSCTL_COUNTER_U64(_kern_geom_dispatch, OID_AUTO, down_queued, CTLFLAG_RD,
+    &g_io_down_queued, "Requests passed to the g_down thread");
+SYSCTL_COUNTER_U64(_kern_geom_dispatch, OID_AUTO, up_direct, CTLFLAG_RD,
+    &g_io_up_direct, "Completions delivered directly by the provider");
+SYSCTL_COUNTER_U64(_kern_geom_dispatch, OID_AUTO, up_queued, CTLFLAG_RD,
+    &g_io_up_queued, "Completions passed to the g_up thread");
+
 static int
 g_io_transient_map_bio(struct bio *bp)
 {
@@ -566,7 +566,16 @@ __elfN(load_section)(struct image_params *imgp, vm_ooffset_t offset,
 		map_len = round_page_ps(offset + filsz, pagesize) - file_addr;
 
 	if (map_len != 0) {
-		/* cow flags: don't dump readonly sections in core */
+		/*
+		 * cow flags: don't dump readonly sections in core.
+		 *
+		 * MAP_PREFAULT has vm_map_pmap_enter() install mappings for
+		 * all resident, fully valid pages of the segment, so the text
+		 * of a binary that was executed recently is mapped here and
+		 * does not take soft faults once the image starts running.
+		 * Only pages that have been evicted from the vnode object
+		 * are faulted in lazily.
+		 */
 		cow = MAP_COPY_ON_WRITE | MAP_PREFAULT |
 		    (prot & VM_PROT_WRITE ? 0 : MAP_DISABLE_COREDUMP);
 
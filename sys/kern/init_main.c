@@ -57,6 +57,7 @@ __FBSDID("$FreeBSD$");
 #include <sys/filedesc.h>
 #include <sys/jail.h>
 #include <sys/ktr.h>
+#include <sys/linker.h>
 #include <sys/lock.h>
 #include <sys/loginclass.h>
 #include <sys/mount.h>
@@ -208,6 +209,27 @@ symbol_name(vm_offset_t va, db_strategy_t strategy)
 }
 #endif
 
+#ifdef TSLOG
+/*
+ * Name a SYSINIT in the timestamp log after its function.  The kernel
+ * linker's symbol table outlives the log, so the name can be stored as a
+ * pointer; entries run before the linker knows about the kernel are
+ * logged under a generic name.
+ */
+static const char *
+sysinit_tslog_name(struct sysinit *sip)
+{
+	linker_symval_t symval;
+	c_linker_sym_t sym;
+	long offset;
+
+	if (linker_ddb_search_symbol((caddr_t)sip->func, &sym, &offset) == 0 &&
+	    offset == 0 && linker_ddb_symbol_values(sym, &symval) == 0)
+		return (symval.name);
+	return ("SYSINIT");
+}
+#endif
+
 /*
  * System startup; initialize the world, create process 0, mount root
  * filesystem, and fork to create init and pagedaemon.  Most of the
@@ -226,6 +248,9 @@ mi_startup(void)
 	struct sysinit **sipp;	/* system initialization*/
 	struct sysinit **xipp;	/* interior loop of sort*/
 	struct sysinit *save;	/* bubble*/
+#ifdef TSLOG
+	const char *tsname;
+#endif
 
 #if defined(VERBOSE_SYSINIT)
 	int last;
@@ -305,7 +330,14 @@ mi_startup(void)
 #endif
 
 		/* Call function */
+#ifdef TSLOG
+		tsname = sysinit_tslog_name(*sipp);
+		TSRAW(curthread, TS_ENTER, tsname, NULL);
+#endif
 		(*((*sipp)->func))((*sipp)->udata);
+#ifdef TSLOG
+		TSRAW(curthread, TS_EXIT, tsname, NULL);
+#endif
 
 #if defined(VERBOSE_SYSINIT)
 		if (verbose)
@@ -2700,6 +2700,43 @@ fget_unlocked(struct filedesc *fdp, int fd, cap_rights_t *needrightsp,
 	return (0);
 }
 
+/*
+ * Look up a descriptor without touching f_count.  As long as the process
+ * is single-threaded and does not share its table, the file cannot be
+ * closed from under us, so the reference owned by the table is enough
+ * and the atomic on the (possibly shared) struct file is skipped.
+ */
+int
+fget_only_user(struct filedesc *fdp, int fd, cap_rights_t *needrightsp,
+    struct file **fpp)
+{
+	const struct filedescent *fde;
+	const struct fdescenttbl *fdt;
+	struct file *fp;
+#ifdef CAPABILITIES
+	int error;
+#endif
+
+	MPASS(FILEDESC_IS_ONLY_USER(fdp));
+
+	*fpp = NULL;
+	fdt = fdp->fd_files;
+	if (__predict_false((u_int)fd >= fdt->fdt_nfiles))
+		return (EBADF);
+	fde = &fdt->fdt_ofiles[fd];
+	fp = fde->fde_file;
+	if (__predict_false(fp == NULL))
+		return (EBADF);
+	MPASS(fp->f_count > 0);
+#ifdef CAPABILITIES
+	error = cap_check(cap_rights_fde_inline(fde), needrightsp);
+	if (__predict_false(error != 0))
+		return (error);
+#endif
+	*fpp = fp;
+	return (0);
+}
+
 /*
  * Extract the file pointer associated with the specified descriptor for the
  * current user process.
@@ -47,6 +47,7 @@ __FBSDID("$FreeBSD$");
 #include <sys/rwlock.h>
 #include <sys/proc.h>
 #include <sys/malloc.h>
+#include <sys/mman.h>
 #include <sys/unistd.h>
 #include <sys/file.h>
 #include <sys/filedesc.h>
@@ -66,6 +67,7 @@ __FBSDID("$FreeBSD$");
 #include <sys/socketvar.h>
 #include <sys/stat.h>
 #include <sys/sysctl.h>
+#include <sys/sysent.h>
 #include <sys/sysproto.h>
 #include <sys/syscallsubr.h>
 #include <sys/taskqueue.h>
@@ -76,6 +78,14 @@ __FBSDID("$FreeBSD$");
 #endif
 #include <machine/atomic.h>
 
+#include <vm/vm.h>
+#include <vm/vm_param.h>
+#include <vm/pmap.h>
+#include <vm/vm_extern.h>
+#include <vm/vm_kern.h>
+#include <vm/vm_object.h>
+#include <vm/vm_page.h>
+#include <vm/vm_pager.h>
 #include <vm/uma.h>
 
 static MALLOC_DEFINE(M_KQUEUE, "kqueue", "memory for kqueue system");
@@ -110,6 +120,7 @@ static void	kqueue_drain(struct kqueue *kq, struct thread *td);
 static int	kqueue_expand(struct kqueue *kq, struct filterops *fops,
 		    uintptr_t ident, int waitok);
 static void	kqueue_task(void *arg, int pending);
+static void	kqueue_ringtask(void *arg, int pending);
 static int	kqueue_scan(struct kqueue *kq, int maxevents,
 		    struct kevent_copyops *k_ops,
 		    const struct timespec *timeout,
@@ -128,6 +139,7 @@ static fo_kqfilter_t	kqueue_kqfilter;
 static fo_stat_t	kqueue_stat;
 static fo_close_t	kqueue_close;
 static fo_fill_kinfo_t	kqueue_fill_kinfo;
+static fo_mmap_t	kqueue_mmap;
 
 static struct fileops kqueueops = {
 	.fo_read = invfo_rdwr,
@@ -142,6 +154,7 @@ static struct fileops kqueueops = {
 	.fo_chown = invfo_chown,
 	.fo_sendfile = invfo_sendfile,
 	.fo_fill_kinfo = kqueue_fill_kinfo,
+	.fo_mmap = kqueue_mmap,
 };
 
 static int 	knote_attach(struct knote *kn, struct kqueue *kq);
@@ -967,6 +980,7 @@ kqueue_init(struct kqueue *kq)
 	TAILQ_INIT(&kq->kq_head);
 	knlist_init_mtx(&kq->kq_sel.si_note, &kq->kq_lock);
 	TASK_INIT(&kq->kq_task, 0, kqueue_task, kq);
+	TASK_INIT(&kq->kq_ringtask, 0, kqueue_ringtask, kq);
 }
 
 int
@@ -1679,6 +1693,17 @@ kqueue_schedtask(struct kqueue *kq)
 	}
 }
 
+static void
+kqueue_schedring(struct kqueue *kq)
+{
+
+	KQ_OWNED(kq);
+	if ((kq->kq_state & (KQ_RINGSCHED | KQ_CLOSING)) == 0) {
+		taskqueue_enqueue(taskqueue_kqueue_ctx, &kq->kq_ringtask);
+		kq->kq_state |= KQ_RINGSCHED;
+	}
+}
+
 /*
  * Expand the kq to make sure we have storage for fops/ident pair.
  *
@@ -1773,6 +1798,79 @@ kqueue_task(void *arg, int pending)
 	KQ_GLOBAL_UNLOCK(&kq_global, haskqglobal);
 }
 
+/*
+ * k_copyout for the shared ring.  kqueue_ringtask() sized the scan to
+ * the free space, so the entries can be stored unconditionally; the
+ * release store of kr_tail publishes them to the consumer.
+ */
+static int
+kqueue_ring_copyout(void *arg, struct kevent *kevp, int count)
+{
+	struct kqueue *kq;
+	struct kqring_hdr *hdr;
+	struct kevent *ev;
+	u_int mask, tail;
+
+	kq = arg;
+	hdr = kq->kq_ring;
+	ev = KQRING_EVENTS(hdr);
+	mask = kq->kq_ringsize - 1;
+	tail = hdr->kr_tail;
+	while (count-- > 0)
+		ev[tail++ & mask] = *kevp++;
+	atomic_store_rel_int(&hdr->kr_tail, tail);
+	return (0);
+}
+
+/*
+ * Move triggered events into the shared ring.  This is an ordinary
+ * non-blocking kqueue_scan(), so filters, EV_CLEAR, EV_ONESHOT and
+ * EV_DISPATCH behave exactly as for kevent(2).  Events which do not fit
+ * stay queued and are returned by the next kevent(2) call.
+ */
+static void
+kqueue_ringtask(void *arg, int pending)
+{
+	struct kevent keva[KQ_NEVENTS];
+	struct kevent_copyops k_ops = {
+		.arg = arg,
+		.k_copyout = kqueue_ring_copyout,
+		.k_copyin = NULL,
+		.kevent_size = sizeof(struct kevent),
+	};
+	const struct timespec ts = { 0, 0 };
+	struct kqring_hdr *hdr;
+	struct kqueue *kq;
+	u_int head, used;
+
+	kq = arg;
+	KQ_LOCK(kq);
+	kq->kq_state &= ~KQ_RINGSCHED;
+	if ((kq->kq_state & KQ_CLOSING) == KQ_CLOSING) {
+		if ((kq->kq_state & KQ_TASKDRAIN) == KQ_TASKDRAIN)
+			wakeup(&kq->kq_state);
+		KQ_UNLOCK(kq);
+		return;
+	}
+	kq->kq_refcnt++;
+	KQ_UNLOCK(kq);
+
+	hdr = kq->kq_ring;
+	head = atomic_load_acq_int(&hdr->kr_head);
+	used = hdr->kr_tail - head;
+	if (used > kq->kq_ringsize) {
+		/* The consumer wrote a bogus index; drop the ring contents. */
+		hdr->kr_overflows++;
+		atomic_store_rel_int(&hdr->kr_head, hdr->kr_tail);
+		used = 0;
+	}
+	if (used < kq->kq_ringsize)
+		(void)kqueue_scan(kq, kq->kq_ringsize - used, &k_ops, &ts,
+		    keva, curthread);
+
+	kqueue_release(kq, 0);
+}
+
 /*
  * Scan, update kn_data (if not ONESHOT), and copyout triggered events.
  * We treat KN_MARKER knotes as if they are in flux.
@@ -1828,9 +1926,10 @@ kqueue_scan(struct kqueue *kq, int maxevents, struct kevent_copyops *k_ops,
 		if (asbt == -1) {
 			error = EWOULDBLOCK;
 		} else {
-			kq->kq_state |= KQ_SLEEP;
-			error = msleep_sbt(kq, &kq->kq_lock, PSOCK | PCATCH,
-			    "kqread", asbt, rsbt, C_ABSOLUTE);
+			kq->kq_sleepers++;
+			error = msleep_sbt(&kq->kq_sleepers, &kq->kq_lock,
+			    PSOCK | PCATCH, "kqread", asbt, rsbt, C_ABSOLUTE);
+			kq->kq_sleepers--;
 		}
 		if (error == 0)
 			goto retry;
@@ -1965,6 +2064,12 @@ kqueue_scan(struct kqueue *kq, int maxevents, struct kevent_copyops *k_ops,
 		}
 	}
 	TAILQ_REMOVE(&kq->kq_head, marker, kn_tqe);
+	/*
+	 * kqueue_wakeup() wakes a single sleeper per queued event; hand
+	 * what we left behind to the next one.
+	 */
+	if (kq->kq_count != 0 && kq->kq_sleepers != 0)
+		wakeup_one(&kq->kq_sleepers);
 done:
 	KQ_OWNED(kq);
 	KQ_UNLOCK_FLUX(kq);
@@ -1977,6 +2082,112 @@ kqueue_scan(struct kqueue *kq, int maxevents, struct kevent_copyops *k_ops,
 	return (error);
 }
 
+/*
+ * Attach a shared event ring of nentries to the kqueue.  The ring cannot
+ * be resized or removed until the kqueue is closed.
+ */
+static int
+kqueue_setring(struct file *fp, u_int nentries, struct thread *td)
+{
+	struct kqueue *kq;
+	struct kqring_hdr *hdr;
+	vm_object_t obj;
+	vm_page_t *ma;
+	vm_offset_t addr;
+	vm_size_t size;
+	int error, i, npages;
+
+	/* The ring holds native struct kevent; no 32-bit translation. */
+	if (SV_CURPROC_FLAG(SV_ILP32))
+		return (EOPNOTSUPP);
+	if (nentries == 0 || nentries > KQRING_MAXENTRIES ||
+	    !powerof2(nentries))
+		return (EINVAL);
+
+	if ((error = kqueue_acquire(fp, &kq)) != 0)
+		return (error);
+
+	size = round_page(KQRING_SIZE(nentries));
+	npages = atop(size);
+	obj = vm_pager_allocate(OBJT_PHYS, 0, size, VM_PROT_DEFAULT, 0,
+	    td->td_ucred);
+	if (obj == NULL) {
+		kqueue_release(kq, 0);
+		return (ENOMEM);
+	}
+	addr = kva_alloc(size);
+	if (addr == 0) {
+		vm_object_deallocate(obj);
+		kqueue_release(kq, 0);
+		return (ENOMEM);
+	}
+	ma = malloc(npages * sizeof(*ma), M_TEMP, M_WAITOK);
+	VM_OBJECT_WLOCK(obj);
+	for (i = 0; i < npages; i++) {
+		ma[i] = vm_page_grab(obj, i, VM_ALLOC_NOBUSY | VM_ALLOC_ZERO);
+		ma[i]->valid = VM_PAGE_BITS_ALL;
+	}
+	VM_OBJECT_WUNLOCK(obj);
+	pmap_qenter(addr, ma, npages);
+	free(ma, M_TEMP);
+	hdr = (struct kqring_hdr *)addr;
+	hdr->kr_nentries = nentries;
+
+	KQ_LOCK(kq);
+	if (kq->kq_ring != NULL) {
+		KQ_UNLOCK(kq);
+		pmap_qremove(addr, npages);
+		kva_free(addr, size);
+		vm_object_deallocate(obj);
+		kqueue_release(kq, 0);
+		return (EBUSY);
+	}
+	kq->kq_ringobj = obj;
+	kq->kq_ringsize = nentries;
+	kq->kq_ringbytes = size;
+	kq->kq_ring = hdr;
+	/* Publish anything which is already pending. */
+	if (kq->kq_count != 0)
+		kqueue_schedring(kq);
+	kqueue_release(kq, 1);
+	KQ_UNLOCK(kq);
+	return (0);
+}
+
+static int
+kqueue_mmap(struct file *fp, vm_map_t map, vm_offset_t *addr, vm_size_t size,
+    vm_prot_t prot, vm_prot_t cap_maxprot, int flags, vm_ooffset_t foff,
+    struct thread *td)
+{
+	struct kqueue *kq;
+	vm_object_t obj;
+	int error;
+
+	if ((flags & MAP_SHARED) == 0 || foff != 0)
+		return (EINVAL);
+	if ((error = kqueue_acquire(fp, &kq)) != 0)
+		return (error);
+	KQ_LOCK(kq);
+	obj = kq->kq_ringobj;
+	if (obj == NULL)
+		error = ENODEV;
+	else if (size > kq->kq_ringbytes)
+		error = ENXIO;
+	else
+		vm_object_reference(obj);
+	kqueue_release(kq, 1);
+	KQ_UNLOCK(kq);
+	if (error != 0)
+		return (error);
+
+	error = vm_mmap_object(map, addr, size, prot,
+	    (VM_PROT_READ | VM_PROT_WRITE) & cap_maxprot, flags, obj, foff,
+	    FALSE, td);
+	if (error != 0)
+		vm_object_deallocate(obj);
+	return (error);
+}
+
 /*ARGSUSED*/
 static int
 kqueue_ioctl(struct file *fp, u_long cmd, void *data,
@@ -2000,6 +2211,8 @@ kqueue_ioctl(struct file *fp, u_long cmd, void *data,
 	 *
 	 * Note, these two mechanisms are somewhat mutually exclusive!
 	 */
+	if (cmd == KQIOC_SETRING)
+		return (kqueue_setring(fp, *(u_int *)data, td));
 #if 0
 	struct kqueue *kq;
 
@@ -2119,7 +2332,7 @@ kqueue_drain(struct kqueue *kq, struct thread *td)
 		}
 	}
 
-	if ((kq->kq_state & KQ_TASKSCHED) == KQ_TASKSCHED) {
+	while ((kq->kq_state & (KQ_TASKSCHED | KQ_RINGSCHED)) != 0) {
 		kq->kq_state |= KQ_TASKDRAIN;
 		msleep(&kq->kq_state, &kq->kq_lock, PSOCK, "kqtqdr", 0);
 	}
@@ -2147,6 +2360,11 @@ kqueue_destroy(struct kqueue *kq)
 		free(kq->kq_knhash, M_KQUEUE);
 	if (kq->kq_knlist != NULL)
 		free(kq->kq_knlist, M_KQUEUE);
+	if (kq->kq_ring != NULL) {
+		pmap_qremove((vm_offset_t)kq->kq_ring, atop(kq->kq_ringbytes));
+		kva_free((vm_offset_t)kq->kq_ring, kq->kq_ringbytes);
+		vm_object_deallocate(kq->kq_ringobj);
+	}
 
 	funsetown(&kq->kq_sigio);
 }
@@ -2203,10 +2421,8 @@ kqueue_wakeup(struct kqueue *kq)
 {
 	KQ_OWNED(kq);
 
-	if ((kq->kq_state & KQ_SLEEP) == KQ_SLEEP) {
-		kq->kq_state &= ~KQ_SLEEP;
-		wakeup(kq);
-	}
+	if (kq->kq_sleepers != 0)
+		wakeup_one(&kq->kq_sleepers);
 	if ((kq->kq_state & KQ_SEL) == KQ_SEL) {
 		selwakeuppri(&kq->kq_sel, PSOCK);
 		if (!SEL_WAITING(&kq->kq_sel))
@@ -2214,6 +2430,8 @@ kqueue_wakeup(struct kqueue *kq)
 	}
 	if (!knlist_empty(&kq->kq_sel.si_note))
 		kqueue_schedtask(kq);
+	if (kq->kq_ring != NULL)
+		kqueue_schedring(kq);
 	if ((kq->kq_state & KQ_ASYNC) == KQ_ASYNC) {
 		pgsigio(&kq->kq_sigio, SIGIO, 0);
 	}
@@ -2232,7 +2450,7 @@ knote(struct knlist *list, long hint, int lockflags)
 {
 	struct kqueue *kq;
 	struct knote *kn, *tkn;
-	int error;
+	int error, exclusive;
 
 	if (list == NULL)
 		return;
@@ -2248,7 +2466,14 @@ knote(struct knlist *list, long hint, int lockflags)
 	 * four lock/unlock's for each knote to test.  Also, marker
 	 * would be needed to keep iteration position, since filters
 	 * or other threads could remove events.
+	 *
+	 * Of the EV_EXCLUSIVE knotes on the list, only the first one that
+	 * is not already active gets queued, so that an event on an
+	 * object watched by many kqueues wakes one of them.  Active
+	 * exclusive knotes are left alone; their own scan re-evaluates
+	 * them.
 	 */
+	exclusive = 0;
 	SLIST_FOREACH_SAFE(kn, &list->kl_list, kn_selnext, tkn) {
 		kq = kn->kn_kq;
 		KQ_LOCK(kq);
@@ -2262,19 +2487,30 @@ knote(struct knlist *list, long hint, int lockflags)
 			 * and cannot proceed until we finished.
 			 */
 			KQ_UNLOCK(kq);
+		} else if ((kn->kn_flags & EV_EXCLUSIVE) != 0 &&
+		    (exclusive || (kn->kn_status & KN_ACTIVE) != 0)) {
+			KQ_UNLOCK(kq);
 		} else if ((lockflags & KNF_NOKQLOCK) != 0) {
 			kn_enter_flux(kn);
 			KQ_UNLOCK(kq);
 			error = kn->kn_fop->f_event(kn, hint);
 			KQ_LOCK(kq);
 			kn_leave_flux(kn);
-			if (error)
+			if (error) {
 				KNOTE_ACTIVATE(kn, 1);
+				if ((kn->kn_flags & EV_EXCLUSIVE) != 0 &&
+				    (kn->kn_status & KN_QUEUED) != 0)
+					exclusive = 1;
+			}
 			KQ_UNLOCK_FLUX(kq);
 		} else {
 			kn->kn_status |= KN_HASKQLOCK;
-			if (kn->kn_fop->f_event(kn, hint))
+			if (kn->kn_fop->f_event(kn, hint)) {
 				KNOTE_ACTIVATE(kn, 1);
+				if ((kn->kn_flags & EV_EXCLUSIVE) != 0 &&
+				    (kn->kn_status & KN_QUEUED) != 0)
+					exclusive = 1;
+			}
 			kn->kn_status &= ~KN_HASKQLOCK;
 			KQ_UNLOCK(kq);
 		}
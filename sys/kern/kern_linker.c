@@ -203,6 +203,7 @@ linker_file_sysinit(linker_file_t lf)
 
 	if (linker_file_lookup_set(lf, "sysinit_set", &start, &stop, NULL) != 0)
 		return;
+	TSENTER2(lf->filename);
 	/*
 	 * Perform a bubble sort of the system initialization objects by
 	 * their subsystem (primary key) and order (secondary key).
@@ -237,6 +238,7 @@ linker_file_sysinit(linker_file_t lf)
 	}
 	mtx_unlock(&Giant);
 	sx_xlock(&kld_sx);
+	TSEXIT2(lf->filename);
 }
 
 static void
@@ -444,7 +446,9 @@ linker_load_file(const char *filename, linker_file_t *result)
 	TAILQ_FOREACH(lc, &classes, link) {
 		KLD_DPF(FILE, ("linker_load_file: trying to load %s\n",
 		    filename));
+		TSENTER2(filename);
 		error = LINKER_LOAD_FILE(lc, filename, &lf);
+		TSEXIT2(filename);
 		/*
 		 * If we got something other than ENOENT, then it exists but
 		 * we cannot load it for some other reason.
@@ -1491,6 +1495,8 @@ linker_preload(void *arg)
 	modlist_t mod;
 	struct sysinit **si_start, **si_stop;
 
+	TSENTER();
+
 	TAILQ_INIT(&loaded_files);
 	TAILQ_INIT(&depended_files);
 	TAILQ_INIT(&found_modules);
@@ -1661,7 +1667,9 @@ linker_preload(void *arg)
 		 * Now do relocation etc using the symbol search paths
 		 * established by the dependencies
 		 */
+		TSENTER2(lf->filename);
 		error = LINKER_LINK_PRELOAD_FINISH(lf);
+		TSEXIT2(lf->filename);
 		if (error) {
 			printf("KLD file %s - could not finalize loading\n",
 			    lf->filename);
@@ -1681,6 +1689,7 @@ linker_preload(void *arg)
 		linker_file_unload(lf, LINKER_UNLOAD_FORCE);
 	}
 	sx_xunlock(&kld_sx);
+	TSEXIT();
 	/* woohoo! we made it! */
 }
 
@@ -64,6 +64,9 @@ SDT_PROBE_DEFINE1(lockstat, , , sx__downgrade, "struct sx *");
 
 SDT_PROBE_DEFINE2(lockstat, , , thread__spin, "struct mtx *", "uint64_t");
 
+SDT_PROBE_DEFINE3(lockstat, , , rangelock__block, "struct rangelock *",
+    "uint64_t", "int");
+
 volatile bool __read_frequently lockstat_enabled;
 
 uint64_t 
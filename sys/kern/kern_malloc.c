@@ -138,11 +138,15 @@ static int numzones = MALLOC_DEBUG_MAXZONES;
 
 /*
  * Small malloc(9) memory allocations are allocated from a set of UMA buckets
- * of various sizes.
+ * of various sizes.  Above 64 bytes there are four classes per power of two,
+ * each about 1.25 times the previous one, which bounds the internal
+ * fragmentation of a request to roughly 20% instead of 50%.
  *
- * XXX: The comment here used to read "These won't be powers of two for
- * long."  It's possible that a significant amount of wasted memory could be
- * recovered by tuning the sizes of these buckets.
+ * A class that cannot be packed into slabs without wasting more than the
+ * rounding it saves (e.g. 1 1/2 items per page) gets no zone of its own in
+ * mallocinit(), and its requests are served by the next larger class.  Only
+ * power-of-two classes are naturally aligned to their size; all others are
+ * aligned to KMEM_ZBASE.
  */
 struct {
 	int kz_size;
@@ -151,20 +155,54 @@ struct {
 } kmemzones[] = {
 	{16, "16", },
 	{32, "32", },
+	{48, "48", },
 	{64, "64", },
+	{80, "80", },
+	{96, "96", },
+	{112, "112", },
 	{128, "128", },
+	{160, "160", },
+	{192, "192", },
+	{224, "224", },
 	{256, "256", },
+	{320, "320", },
+	{384, "384", },
+	{448, "448", },
 	{512, "512", },
+	{640, "640", },
+	{768, "768", },
+	{896, "896", },
 	{1024, "1024", },
+	{1280, "1280", },
+	{1536, "1536", },
+	{1792, "1792", },
 	{2048, "2048", },
+	{2560, "2560", },
+	{3072, "3072", },
+	{3584, "3584", },
 	{4096, "4096", },
+	{5120, "5120", },
+	{6144, "6144", },
+	{7168, "7168", },
 	{8192, "8192", },
+	{10240, "10240", },
+	{12288, "12288", },
+	{14336, "14336", },
 	{16384, "16384", },
+	{20480, "20480", },
+	{24576, "24576", },
+	{28672, "28672", },
 	{32768, "32768", },
+	{40960, "40960", },
+	{49152, "49152", },
+	{57344, "57344", },
 	{65536, "65536", },
 	{0, NULL},
 };
 
+/* Size classes are recorded as a bitmask in mts_size. */
+CTASSERT(nitems(kmemzones) - 1 <= sizeof(uint64_t) * NBBY);
+
 /*
  * Zone to allocate malloc type descriptions from.  For ABI reasons, memory
  * types are described by a data structure passed by the declaring code, but
@@ -218,6 +256,7 @@ static int sysctl_kern_mprof(SYSCTL_HANDLER_ARGS);
 #endif
 
 static int sysctl_kern_malloc_stats(SYSCTL_HANDLER_ARGS);
+static int sysctl_kern_malloc_sizes(SYSCTL_HANDLER_ARGS);
 
 /*
  * time_uptime of the last malloc(9) failure (induced or real).
@@ -359,11 +398,12 @@ malloc_last_fail(void)
  * An allocation has succeeded -- update malloc type statistics for the
  * amount of bucket size.  Occurs within a critical section so that the
  * thread isn't preempted and doesn't migrate while updating per-PCU
- * statistics.
+ * statistics.  reqsize is the size the caller asked for; the difference
+ * to size is memory lost to size class rounding.
  */
 static void
 malloc_type_zone_allocated(struct malloc_type *mtp, unsigned long size,
-    int zindx)
+    unsigned long reqsize, int zindx)
 {
 	struct malloc_type_internal *mtip;
 	struct malloc_type_stats *mtsp;
@@ -373,10 +413,11 @@ malloc_type_zone_allocated(struct malloc_type *mtp, unsigned long size,
 	mtsp = zpcpu_get(mtip->mti_stats);
 	if (size > 0) {
 		mtsp->mts_memalloced += size;
+		mtsp->mts_memrequested += reqsize;
 		mtsp->mts_numallocs++;
 	}
 	if (zindx != -1)
-		mtsp->mts_size |= 1 << zindx;
+		mtsp->mts_size |= (uint64_t)1 << zindx;
 
 #ifdef KDTRACE_HOOKS
 	if (__predict_false(dtrace_malloc_enabled)) {
@@ -396,7 +437,7 @@ malloc_type_allocated(struct malloc_type *mtp, unsigned long size)
 {
 
 	if (size > 0)
-		malloc_type_zone_allocated(mtp, size, -1);
+		malloc_type_zone_allocated(mtp, size, size, -1);
 }
 
 /*
@@ -542,6 +583,26 @@ malloc_dbg(caddr_t *vap, size_t *sizep, struct malloc_type *mtp,
 }
 #endif
 
+/*
+ * Map a small request to the zone of its size class.  The rounded-up
+ * size indexes kmemsize[], which mallocinit() filled with the smallest
+ * class that has a zone.
+ */
+static __inline uma_zone_t
+malloc_zone(size_t size, struct malloc_type *mtp, int *indxp)
+{
+	int indx;
+
+	if (size & KMEM_ZMASK)
+		size = (size & ~KMEM_ZMASK) + KMEM_ZBASE;
+#ifdef MALLOC_PROFILE
+	krequests[size >> KMEM_ZSHIFT]++;
+#endif
+	indx = kmemsize[size >> KMEM_ZSHIFT];
+	*indxp = indx;
+	return (kmemzones[indx].kz_zone[mtp_get_subzone(mtp)]);
+}
+
 /*
  *	malloc:
  *
@@ -553,6 +614,7 @@ malloc_dbg(caddr_t *vap, size_t *sizep, struct malloc_type *mtp,
 void *
 (malloc)(size_t size, struct malloc_type *mtp, int flags)
 {
+	size_t reqsize;
 	int indx;
 	caddr_t va;
 	uma_zone_t zone;
@@ -566,23 +628,20 @@ void *
 		return (va);
 #endif
 
+	reqsize = size;
 	if (size <= kmem_zmax && (flags & M_EXEC) == 0) {
-		if (size & KMEM_ZMASK)
-			size = (size & ~KMEM_ZMASK) + KMEM_ZBASE;
-		indx = kmemsize[size >> KMEM_ZSHIFT];
-		zone = kmemzones[indx].kz_zone[mtp_get_subzone(mtp)];
-#ifdef MALLOC_PROFILE
-		krequests[size >> KMEM_ZSHIFT]++;
-#endif
+		zone = malloc_zone(size, mtp, &indx);
 		va = uma_zalloc(zone, flags);
 		if (va != NULL)
 			size = zone->uz_size;
-		malloc_type_zone_allocated(mtp, va == NULL ? 0 : size, indx);
+		malloc_type_zone_allocated(mtp, va == NULL ? 0 : size, reqsize,
+		    indx);
 	} else {
 		size = roundup(size, PAGE_SIZE);
 		zone = NULL;
 		va = uma_large_malloc(size, flags);
-		malloc_type_allocated(mtp, va == NULL ? 0 : size);
+		malloc_type_zone_allocated(mtp, va == NULL ? 0 : size, reqsize,
+		    -1);
 	}
 	if (flags & M_WAITOK)
 		KASSERT(va != NULL, ("malloc(M_WAITOK) returned NULL"));
@@ -599,6 +658,7 @@ void *
 malloc_domain(size_t size, struct malloc_type *mtp, int domain,
     int flags)
 {
+	size_t reqsize;
 	int indx;
 	caddr_t va;
 	uma_zone_t zone;
@@ -611,23 +671,20 @@ malloc_domain(size_t size, struct malloc_type *mtp, int domain,
 	if (malloc_dbg(&va, &size, mtp, flags) != 0)
 		return (va);
 #endif
+	reqsize = size;
 	if (size <= kmem_zmax && (flags & M_EXEC) == 0) {
-		if (size & KMEM_ZMASK)
-			size = (size & ~KMEM_ZMASK) + KMEM_ZBASE;
-		indx = kmemsize[size >> KMEM_ZSHIFT];
-		zone = kmemzones[indx].kz_zone[mtp_get_subzone(mtp)];
-#ifdef MALLOC_PROFILE
-		krequests[size >> KMEM_ZSHIFT]++;
-#endif
+		zone = malloc_zone(size, mtp, &indx);
 		va = uma_zalloc_domain(zone, NULL, domain, flags);
 		if (va != NULL)
 			size = zone->uz_size;
-		malloc_type_zone_allocated(mtp, va == NULL ? 0 : size, indx);
+		malloc_type_zone_allocated(mtp, va == NULL ? 0 : size, reqsize,
+		    indx);
 	} else {
 		size = roundup(size, PAGE_SIZE);
 		zone = NULL;
 		va = uma_large_malloc_domain(size, domain, flags);
-		malloc_type_allocated(mtp, va == NULL ? 0 : size);
+		malloc_type_zone_allocated(mtp, va == NULL ? 0 : size, reqsize,
+		    -1);
 	}
 	if (flags & M_WAITOK)
 		KASSERT(va != NULL, ("malloc(M_WAITOK) returned NULL"));
@@ -938,6 +995,27 @@ kmeminit(void)
 #endif
 }
 
+/*
+ * Decide whether a size class is worth a zone of its own.  Slabs of at
+ * most a page hold floor(PAGE_SIZE / size) items, larger items get whole
+ * pages.  If the per-item share of the slab exceeds the size by more than
+ * an eighth, the class saves nothing over the next one.  Powers of two are
+ * always kept so that such requests stay naturally aligned.
+ */
+static bool
+malloc_class_usable(int size)
+{
+	int footprint;
+
+	if (powerof2(size))
+		return (true);
+	if (size <= PAGE_SIZE)
+		footprint = PAGE_SIZE / (PAGE_SIZE / size);
+	else
+		footprint = roundup(size, PAGE_SIZE);
+	return (footprint - size <= size / 8);
+}
+
 /*
  * Initialize the kernel memory allocator
  */
@@ -970,6 +1048,8 @@ mallocinit(void *dummy)
 		char *name = kmemzones[indx].kz_name;
 		int subzone;
 
+		if (!malloc_class_usable(size))
+			continue;
 		for (subzone = 0; subzone < numzones; subzone++) {
 			kmemzones[indx].kz_zone[subzone] =
 			    uma_zcreate(name, size,
@@ -1146,6 +1226,26 @@ SYSCTL_PROC(_kern, OID_AUTO, malloc_stats, CTLFLAG_RD|CTLTYPE_STRUCT,
     0, 0, sysctl_kern_malloc_stats, "s,malloc_type_ustats",
     "Return malloc types");
 
+/*
+ * Export the size of each class, indexed like the mts_size bitmask.
+ */
+static int
+sysctl_kern_malloc_sizes(SYSCTL_HANDLER_ARGS)
+{
+	int error, indx, size;
+
+	error = 0;
+	for (indx = 0; kmemzones[indx].kz_size != 0 && error == 0; indx++) {
+		size = kmemzones[indx].kz_size;
+		error = SYSCTL_OUT(req, &size, sizeof(size));
+	}
+	return (error);
+}
+
+SYSCTL_PROC(_kern, OID_AUTO, malloc_sizes, CTLFLAG_RD|CTLTYPE_OPAQUE|
+    CTLFLAG_MPSAFE, 0, 0, sysctl_kern_malloc_sizes, "I",
+    "Sizes of the malloc(9) size classes");
+
 SYSCTL_INT(_kern, OID_AUTO, malloc_count, CTLFLAG_RD, &kmemcount, 0,
     "Count of kernel malloc types");
 
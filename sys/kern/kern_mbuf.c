@@ -1134,8 +1134,30 @@ m_extadd(struct mbuf *mb, char *buf, u_int size, m_ext_free_t freef,
 void
 m_freem(struct mbuf *mb)
 {
+	void *batch[32];
+	struct mbuf *n;
+	int cnt;
 
 	MBUF_PROBE1(m__freem, mb);
-	while (mb != NULL)
-		mb = m_free(mb);
+	/*
+	 * Plain mbufs go back to the zone in batches, anything with
+	 * external storage or M_NOFREE takes the usual m_free() path.
+	 */
+	cnt = 0;
+	while (mb != NULL) {
+		if ((mb->m_flags & (M_EXT | M_NOFREE)) != 0) {
+			mb = m_free(mb);
+			continue;
+		}
+		MBUF_PROBE1(m__free, mb);
+		n = mb->m_next;
+		batch[cnt++] = mb;
+		if (cnt == nitems(batch)) {
+			uma_zfree_bulk(zone_mbuf, batch, cnt, NULL);
+			cnt = 0;
+		}
+		mb = n;
+	}
+	if (cnt > 0)
+		uma_zfree_bulk(zone_mbuf, batch, cnt, NULL);
 }
@@ -32,6 +32,7 @@ __FBSDID("$FreeBSD$");
 #include <sys/param.h>
 #include <sys/kernel.h>
 #include <sys/lock.h>
+#include <sys/lockstat.h>
 #include <sys/mutex.h>
 #include <sys/proc.h>
 #include <sys/rangelock.h>
@@ -41,7 +42,9 @@ __FBSDID("$FreeBSD$");
 
 struct rl_q_entry {
 	TAILQ_ENTRY(rl_q_entry) rl_q_link;
+	RB_ENTRY(rl_q_entry) rl_q_tree;
 	off_t		rl_q_start, rl_q_end;
+	off_t		rl_q_maxend;	/* Largest rl_q_end in the subtree */
 	int		rl_q_flags;
 };
 
@@ -70,73 +73,174 @@ rlqentry_free(struct rl_q_entry *rleq)
 	uma_zfree(rl_entry_zone, rleq);
 }
 
+/*
+ * The granted requests are kept in red-black trees ordered by start,
+ * each node augmented with the largest end in its subtree.
+ */
+static int
+rl_q_cmp(const struct rl_q_entry *e1, const struct rl_q_entry *e2)
+{
+
+	if (e1->rl_q_start != e2->rl_q_start)
+		return (e1->rl_q_start < e2->rl_q_start ? -1 : 1);
+	if (e1 != e2)
+		return ((uintptr_t)e1 < (uintptr_t)e2 ? -1 : 1);
+	return (0);
+}
+
+static void
+rl_q_augment(struct rl_q_entry *e)
+{
+	struct rl_q_entry *c;
+	off_t maxend;
+
+	maxend = e->rl_q_end;
+	if ((c = RB_LEFT(e, rl_q_tree)) != NULL && c->rl_q_maxend > maxend)
+		maxend = c->rl_q_maxend;
+	if ((c = RB_RIGHT(e, rl_q_tree)) != NULL && c->rl_q_maxend > maxend)
+		maxend = c->rl_q_maxend;
+	e->rl_q_maxend = maxend;
+}
+
+#undef	RB_AUGMENT
+#define	RB_AUGMENT(e)	rl_q_augment(e)
+RB_GENERATE_STATIC(rl_q_tree, rl_q_entry, rl_q_tree, rl_q_cmp);
+
+/*
+ * The tree macros only update the nodes they restructure, so redo the
+ * path from the lowest changed node to the root.
+ */
+static void
+rl_q_fixup(struct rl_q_entry *e)
+{
+
+	for (; e != NULL; e = RB_PARENT(e, rl_q_tree))
+		rl_q_augment(e);
+}
+
+static void
+rl_q_insert(struct rl_q_tree *t, struct rl_q_entry *e)
+{
+	struct rl_q_entry *c;
+
+	e->rl_q_maxend = e->rl_q_end;
+	RB_INSERT(rl_q_tree, t, e);
+	/* Rebalancing may have moved former ancestors below e. */
+	if ((c = RB_LEFT(e, rl_q_tree)) != NULL)
+		rl_q_augment(c);
+	if ((c = RB_RIGHT(e, rl_q_tree)) != NULL)
+		rl_q_augment(c);
+	rl_q_fixup(e);
+}
+
+static void
+rl_q_remove(struct rl_q_tree *t, struct rl_q_entry *e)
+{
+	struct rl_q_entry *p;
+
+	/* Find the node that loses a child: e's parent or successor's. */
+	if (RB_LEFT(e, rl_q_tree) != NULL && RB_RIGHT(e, rl_q_tree) != NULL) {
+		for (p = RB_RIGHT(e, rl_q_tree); RB_LEFT(p, rl_q_tree) != NULL;
+		    p = RB_LEFT(p, rl_q_tree))
+			;
+		if (RB_PARENT(p, rl_q_tree) != e)
+			p = RB_PARENT(p, rl_q_tree);
+	} else
+		p = RB_PARENT(e, rl_q_tree);
+	RB_REMOVE(rl_q_tree, t, e);
+	rl_q_fixup(p);
+}
+
+/*
+ * Does any entry of the tree overlap [start, end)?  Descend left while
+ * the left subtree reaches past start: if it holds no overlap, some
+ * entry there begins at or after end, and so does everything to the
+ * right.
+ */
+static bool
+rl_q_overlaps(const struct rl_q_tree *t, off_t start, off_t end)
+{
+	struct rl_q_entry *e, *l;
+
+	for (e = RB_ROOT(t); e != NULL && e->rl_q_maxend > start;) {
+		if (e->rl_q_start < end && e->rl_q_end > start)
+			return (true);
+		l = RB_LEFT(e, rl_q_tree);
+		if (l != NULL && l->rl_q_maxend > start)
+			e = l;
+		else if (e->rl_q_start >= end)
+			break;
+		else
+			e = RB_RIGHT(e, rl_q_tree);
+	}
+	return (false);
+}
+
 void
 rangelock_init(struct rangelock *lock)
 {
 
 	TAILQ_INIT(&lock->rl_waiters);
-	lock->rl_currdep = NULL;
+	RB_INIT(&lock->rl_reads);
+	RB_INIT(&lock->rl_writes);
 }
 
 void
 rangelock_destroy(struct rangelock *lock)
 {
 
-	KASSERT(TAILQ_EMPTY(&lock->rl_waiters), ("Dangling waiters"));
+	KASSERT(rangelock_idle(lock), ("Dangling waiters"));
+}
+
+bool
+rangelock_idle(struct rangelock *lock)
+{
+
+	return (TAILQ_EMPTY(&lock->rl_waiters) && RB_EMPTY(&lock->rl_reads) &&
+	    RB_EMPTY(&lock->rl_writes));
 }
 
 /*
- * Two entries are compatible if their ranges do not overlap, or both
- * entries are for read.
+ * A read is compatible with any granted read; a write with nothing it
+ * overlaps.
  */
-static int
-ranges_overlap(const struct rl_q_entry *e1,
-    const struct rl_q_entry *e2)
+static bool
+rangelock_grantable(struct rangelock *lock, const struct rl_q_entry *entry)
 {
 
-	if (e1->rl_q_start < e2->rl_q_end && e1->rl_q_end > e2->rl_q_start)
-		return (1);
-	return (0);
+	if (rl_q_overlaps(&lock->rl_writes, entry->rl_q_start,
+	    entry->rl_q_end))
+		return (false);
+	if ((entry->rl_q_flags & RL_LOCK_READ) == 0 &&
+	    rl_q_overlaps(&lock->rl_reads, entry->rl_q_start, entry->rl_q_end))
+		return (false);
+	return (true);
+}
+
+static struct rl_q_tree *
+rangelock_tree(struct rangelock *lock, const struct rl_q_entry *entry)
+{
+
+	return ((entry->rl_q_flags & RL_LOCK_READ) != 0 ? &lock->rl_reads :
+	    &lock->rl_writes);
 }
 
 /*
- * Recalculate the lock->rl_currdep after an unlock.
+ * Grant waiting requests in order of arrival, up to the first one that
+ * still conflicts.
  */
 static void
 rangelock_calc_block(struct rangelock *lock)
 {
-	struct rl_q_entry *entry, *nextentry, *entry1;
-
-	for (entry = lock->rl_currdep; entry != NULL; entry = nextentry) {
-		nextentry = TAILQ_NEXT(entry, rl_q_link);
-		if (entry->rl_q_flags & RL_LOCK_READ) {
-			/* Reads must not overlap with granted writes. */
-			for (entry1 = TAILQ_FIRST(&lock->rl_waiters);
-			    !(entry1->rl_q_flags & RL_LOCK_READ);
-			    entry1 = TAILQ_NEXT(entry1, rl_q_link)) {
-				if (ranges_overlap(entry, entry1))
-					goto out;
-			}
-		} else {
-			/* Write must not overlap with any granted locks. */
-			for (entry1 = TAILQ_FIRST(&lock->rl_waiters);
-			    entry1 != entry;
-			    entry1 = TAILQ_NEXT(entry1, rl_q_link)) {
-				if (ranges_overlap(entry, entry1))
-					goto out;
-			}
-
-			/* Move grantable write locks to the front. */
-			TAILQ_REMOVE(&lock->rl_waiters, entry, rl_q_link);
-			TAILQ_INSERT_HEAD(&lock->rl_waiters, entry, rl_q_link);
-		}
-
-		/* Grant this lock. */
+	struct rl_q_entry *entry;
+
+	while ((entry = TAILQ_FIRST(&lock->rl_waiters)) != NULL &&
+	    rangelock_grantable(lock, entry)) {
+		TAILQ_REMOVE(&lock->rl_waiters, entry, rl_q_link);
+		rl_q_insert(rangelock_tree(lock, entry), entry);
 		entry->rl_q_flags |= RL_LOCK_GRANTED;
 		wakeup(entry);
 	}
-out:
-	lock->rl_currdep = entry;
 }
 
 static void
@@ -146,9 +250,10 @@ rangelock_unlock_locked(struct rangelock *lock, struct rl_q_entry *entry,
 
 	MPASS(lock != NULL && entry != NULL && ilk != NULL);
 	mtx_assert(ilk, MA_OWNED);
-	KASSERT(entry != lock->rl_currdep, ("stuck currdep"));
+	KASSERT(entry->rl_q_flags & RL_LOCK_GRANTED,
+	    ("Unlocking non-granted lock"));
 
-	TAILQ_REMOVE(&lock->rl_waiters, entry, rl_q_link);
+	rl_q_remove(rangelock_tree(lock, entry), entry);
 	rangelock_calc_block(lock);
 	mtx_unlock(ilk);
 	if (curthread->td_rlqe == NULL)
@@ -189,6 +294,7 @@ rangelock_unlock_range(struct rangelock *lock, void *cookie, off_t start,
 		return (NULL);
 	}
 	entry->rl_q_end = end;
+	rl_q_fixup(entry);
 	rangelock_calc_block(lock);
 	mtx_unlock(ilk);
 	return (cookie);
@@ -204,6 +310,9 @@ rangelock_enqueue(struct rangelock *lock, off_t start, off_t end, int mode,
 {
 	struct rl_q_entry *entry;
 	struct thread *td;
+#ifdef KDTRACE_HOOKS
+	sbintime_t sleep_start;
+#endif
 
 	MPASS(lock != NULL && ilk != NULL);
 
@@ -225,13 +334,34 @@ rangelock_enqueue(struct rangelock *lock, off_t start, off_t end, int mode,
 	 * thread.
 	 */
 
+	/*
+	 * With nobody queued ahead, a compatible request is granted
+	 * without sleeping.  Otherwise it waits its turn; the head of
+	 * the queue is already known to conflict.
+	 */
+	if (TAILQ_EMPTY(&lock->rl_waiters) &&
+	    rangelock_grantable(lock, entry)) {
+		rl_q_insert(rangelock_tree(lock, entry), entry);
+		entry->rl_q_flags |= RL_LOCK_GRANTED;
+		mtx_unlock(ilk);
+		return (entry);
+	}
+
 	TAILQ_INSERT_TAIL(&lock->rl_waiters, entry, rl_q_link);
-	if (lock->rl_currdep == NULL)
-		lock->rl_currdep = entry;
-	rangelock_calc_block(lock);
+#ifdef KDTRACE_HOOKS
+	sleep_start = 0;
+	if (LOCKSTAT_PROFILE_ENABLED(rangelock__block))
+		sleep_start = sbinuptime();
+#endif
 	while (!(entry->rl_q_flags & RL_LOCK_GRANTED))
 		msleep(entry, ilk, 0, "range", 0);
 	mtx_unlock(ilk);
+#ifdef KDTRACE_HOOKS
+	if (sleep_start != 0)
+		LOCKSTAT_RECORD2(rangelock__block, lock,
+		    sbttons(sbinuptime() - sleep_start),
+		    mode == RL_LOCK_READ ? LOCKSTAT_READER : LOCKSTAT_WRITER);
+#endif
 	return (entry);
 }
 
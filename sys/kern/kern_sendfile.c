@@ -49,6 +49,7 @@ __FBSDID("$FreeBSD$");
 #include <sys/socketvar.h>
 #include <sys/syscallsubr.h>
 #include <sys/sysctl.h>
+#include <sys/time.h>
 #include <sys/vnode.h>
 
 #include <net/vnet.h>
@@ -81,6 +82,7 @@ struct sf_io {
 	volatile u_int	nios;
 	u_int		error;
 	int		npages;
+	sbintime_t	start;
 	struct socket	*so;
 	struct mbuf	*m;
 	vm_page_t	pa[];
@@ -119,6 +121,16 @@ sfstat_sysctl(SYSCTL_HANDLER_ARGS)
 SYSCTL_PROC(_kern_ipc, OID_AUTO, sfstat, CTLTYPE_OPAQUE | CTLFLAG_RW,
     NULL, 0, sfstat_sysctl, "I", "sendfile statistics");
 
+static int sendfile_readahead_msec = 100;
+SYSCTL_INT(_kern_ipc, OID_AUTO, sendfile_readahead_msec, CTLFLAG_RWTUN,
+    &sendfile_readahead_msec, 0,
+    "Time worth of data to read ahead for sequential sendfile streams");
+
+static int sendfile_readahead_min = 8;
+SYSCTL_INT(_kern_ipc, OID_AUTO, sendfile_readahead_min, CTLFLAG_RWTUN,
+    &sendfile_readahead_min, 0,
+    "Initial readahead window in pages for sequential sendfile streams");
+
 /*
  * Detach mapped page and release resources back to the system.  Called
  * by mbuf(9) code when last reference to a page is freed.
@@ -281,6 +293,9 @@ sendfile_iodone(void *arg, vm_page_t *pg, int count, int error)
 	if (!refcount_release(&sfio->nios))
 		return;
 
+	SFSTAT_HIST(sf_iowait_hist, sbttous(sbinuptime() - sfio->start));
+	SFSTAT_HIST(sf_nrdy_hist, sfio->npages);
+
 	CURVNET_SET(so->so_vnet);
 	if (sfio->error) {
 		struct mbuf *m;
@@ -436,6 +451,47 @@ sendfile_swapin(vm_object_t obj, struct sf_io *sfio, off_t off, off_t len,
 	return (nios);
 }
 
+/*
+ * Compute the readahead window for a socket that is sending a file
+ * sequentially, one sendfile(2) call after another.  The window grows
+ * twofold per call, limited by the data that the socket is observed to
+ * drain in sendfile_readahead_msec, so that slow streams do not read ahead
+ * further than they need to, and fast streams on slow disks get large
+ * reads.  A call at any other offset starts a new stream.  Requires the
+ * socket send buffer to be locked with sblock().
+ */
+static int
+sendfile_readahead(struct socket *so, off_t off)
+{
+	sbintime_t now;
+	uint64_t bps, usecs;
+	int pages;
+
+	now = sbinuptime();
+	if (sendfile_readahead_msec <= 0 || so->so_sf_stamp == 0 ||
+	    off != so->so_sf_nextoff) {
+		so->so_sf_startoff = off;
+		so->so_sf_stamp = now;
+		so->so_sf_bps = 0;
+		so->so_sf_rhpages = 0;
+		return (0);
+	}
+
+	usecs = max(sbttous(now - so->so_sf_stamp), 1);
+	bps = (uint64_t)(off - so->so_sf_startoff) * 1000000 / usecs;
+	so->so_sf_bps = so->so_sf_bps == 0 ? bps :
+	    (3 * so->so_sf_bps + bps) / 4;
+	so->so_sf_startoff = off;
+	so->so_sf_stamp = now;
+
+	pages = max(so->so_sf_rhpages * 2, sendfile_readahead_min);
+	pages = min(pages, howmany(so->so_sf_bps * sendfile_readahead_msec /
+	    1000, PAGE_SIZE));
+	pages = min(pages, howmany(MAXPHYS, PAGE_SIZE));
+	so->so_sf_rhpages = pages;
+	return (pages);
+}
+
 static int
 sendfile_getobj(struct thread *td, struct file *fp, vm_object_t *obj_res,
     struct vnode **vp_res, struct shmfd **shmfd_res, off_t *obj_size,
@@ -544,7 +600,7 @@ vn_sendfile(struct file *fp, int sockfd, struct uio *hdr_uio,
 	struct sendfile_sync *sfs;
 	struct vattr va;
 	off_t off, sbytes, rem, obj_size;
-	int error, softerr, bsize, hdrlen;
+	int error, softerr, bsize, hdrlen, rhseq;
 
 	obj = NULL;
 	so = NULL;
@@ -586,6 +642,12 @@ vn_sendfile(struct file *fp, int sockfd, struct uio *hdr_uio,
 	 */
 	(void)sblock(&so->so_snd, SBL_WAIT | SBL_NOINTR);
 
+	if ((flags & SF_USER_READAHEAD) == 0) {
+		rhseq = sendfile_readahead(so, offset);
+		SFSTAT_ADD(sf_rhpages_adaptive, rhseq);
+	} else
+		rhseq = 0;
+
 	/*
 	 * Loop through the pages of the file, starting with the requested
 	 * offset. Get a file page (do I/O if necessary), map the file page
@@ -729,7 +791,7 @@ vn_sendfile(struct file *fp, int sockfd, struct uio *hdr_uio,
 		} else {
 			rhpages = howmany(rem + (off & PAGE_MASK), PAGE_SIZE) -
 			    npages;
-			rhpages += SF_READAHEAD(flags);
+			rhpages += SF_READAHEAD(flags) + rhseq;
 		}
 		rhpages = min(howmany(MAXPHYS, PAGE_SIZE), rhpages);
 		rhpages = min(howmany(obj_size - trunc_page(off), PAGE_SIZE) -
@@ -740,6 +802,7 @@ vn_sendfile(struct file *fp, int sockfd, struct uio *hdr_uio,
 		refcount_init(&sfio->nios, 1);
 		sfio->so = so;
 		sfio->error = 0;
+		sfio->start = sbinuptime();
 
 		nios = sendfile_swapin(obj, sfio, off, space, npages, rhpages,
 		    flags);
@@ -840,6 +903,7 @@ vn_sendfile(struct file *fp, int sockfd, struct uio *hdr_uio,
 		/* Keep track of bytes processed. */
 		off += space;
 		rem -= space;
+		so->so_sf_nextoff = off;
 
 		/* Prepend header, if any. */
 		if (hdrlen) {
@@ -515,6 +515,21 @@ callout_process(sbintime_t now)
 				}
 				continue;
 			}
+			/*
+			 * A callout whose deadline was pushed out lazily by
+			 * callout_reset_sbt_on() may still sit in an earlier
+			 * bucket.  Move it to the bucket it belongs to now.
+			 */
+			if (callout_get_bucket(tmp->c_time) !=
+			    (firstb & callwheelmask)) {
+				tmpn = LIST_NEXT(tmp, c_links.le);
+				LIST_REMOVE(tmp, c_links.le);
+				LIST_INSERT_HEAD(&cc->cc_callwheel[
+				    callout_get_bucket(tmp->c_time)], tmp,
+				    c_links.le);
+				tmp = tmpn;
+				continue;
+			}
 			/* Skip events from distant future. */
 			if (tmp->c_time >= max)
 				goto next;
@@ -1096,6 +1111,33 @@ callout_reset_sbt_on(struct callout *c, sbintime_t sbt, sbintime_t prec,
 		}
 #endif
 	}
+	/*
+	 * Pushing the deadline of a pending callout further out on the
+	 * same CPU, as TCP does for its timers on every ACK, only updates
+	 * the callout in place.  It stays in its current, earlier bucket
+	 * and callout_process() moves it along when the wheel gets there,
+	 * so repeated reschedules cost no list manipulation.  An earlier
+	 * deadline needs requeueing since its bucket may be scanned first.
+	 */
+	if ((c->c_iflags & (CALLOUT_PENDING | CALLOUT_PROCESSED)) ==
+	    CALLOUT_PENDING && c->c_cpu == cpu &&
+	    cc_exec_curr(cc, direct) != c &&
+	    ((c->c_iflags & CALLOUT_DIRECT) != 0) == direct &&
+	    to_sbt >= c->c_time) {
+		c->c_func = ftn;
+		c->c_arg = arg;
+		c->c_time = to_sbt;
+		if (SBT_MAX - to_sbt < precision)
+			precision = SBT_MAX - to_sbt;
+		c->c_precision = precision;
+		c->c_flags |= CALLOUT_ACTIVE;
+		CTR5(KTR_CALLOUT,
+		    "lazily rescheduled %p func %p arg %p in %d.%08x",
+		    c, c->c_func, c->c_arg, (int)(to_sbt >> 32),
+		    (u_int)(to_sbt & 0xffffffff));
+		CC_UNLOCK(cc);
+		return (1);
+	}
 	if (c->c_iflags & CALLOUT_PENDING) {
 		if ((c->c_iflags & CALLOUT_PROCESSED) == 0) {
 			if (cc_exec_next(cc) == c)
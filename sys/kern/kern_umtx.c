@@ -179,11 +179,15 @@ struct umtxq_chain {
 	/* All PI in the list */
 	TAILQ_HEAD(,umtx_pi)	uc_pi_list;
 
+	/* Contention statistics */
+	u_long			uc_sleeps;
+	u_long			uc_busy_waits;
+
 #ifdef UMTX_PROFILING
 	u_int 			length;
 	u_int			max_length;
 #endif
-};
+} __aligned(CACHE_LINE_SIZE);
 
 #define	UMTXQ_LOCKED_ASSERT(uc)		mtx_assert(&(uc)->uc_lock, MA_OWNED)
 
@@ -202,9 +206,9 @@ struct umtxq_chain {
 
 #define	GOLDEN_RATIO_PRIME	2654404609U
 #ifndef	UMTX_CHAINS
-#define	UMTX_CHAINS		512
+#define	UMTX_CHAINS		512	/* minimum, a power of 2 */
 #endif
-#define	UMTX_SHIFTS		(__WORD_BIT - 9)
+#define	UMTX_CHAINS_PER_CPU	16
 
 #define	GET_SHARE(flags)	\
     (((flags) & USYNC_PROCESS_SHARED) == 0 ? THREAD_SHARE : PROCESS_SHARE)
@@ -243,7 +247,9 @@ SYSCTL_INT(_kern_ipc, OID_AUTO, umtx_max_robust, CTLFLAG_RWTUN,
     "");
 
 static uma_zone_t		umtx_pi_zone;
-static struct umtxq_chain	umtxq_chains[2][UMTX_CHAINS];
+static struct umtxq_chain	*umtxq_chains[2];
+static u_int			umtxq_nchains;
+static u_int			umtxq_shift;
 static MALLOC_DEFINE(M_UMTX, "umtx", "UMTX queue memory");
 static int			umtx_pi_allocated;
 
@@ -254,6 +260,16 @@ static int umtx_verbose_rb = 1;
 SYSCTL_INT(_debug_umtx, OID_AUTO, robust_faults_verbose, CTLFLAG_RWTUN,
     &umtx_verbose_rb, 0,
     "");
+SYSCTL_UINT(_debug_umtx, OID_AUTO, nchains, CTLFLAG_RD, &umtxq_nchains, 0,
+    "Number of umtx wait-queue chains per table");
+static int umtx_spin_max = 1000;
+SYSCTL_INT(_kern_ipc, OID_AUTO, umtx_spin_max, CTLFLAG_RWTUN,
+    &umtx_spin_max, 0,
+    "Spins on a locked umutex while its owner is running before sleeping");
+static u_long umtx_spin_acquired;
+SYSCTL_ULONG(_debug_umtx, OID_AUTO, spin_acquired, CTLFLAG_RD,
+    &umtx_spin_acquired, 0,
+    "Contested umutexes released while spinning on a running owner");
 
 #ifdef UMTX_PROFILING
 static long max_length;
@@ -298,7 +314,7 @@ umtx_init_profiling(void)
 	char chain_name[10];
 	int i;
 
-	for (i = 0; i < UMTX_CHAINS; ++i) {
+	for (i = 0; i < umtxq_nchains; ++i) {
 		snprintf(chain_name, sizeof(chain_name), "%d", i);
 		chain_oid = SYSCTL_ADD_NODE(NULL, 
 		    SYSCTL_STATIC_CHILDREN(_debug_umtx_chains), OID_AUTO, 
@@ -324,7 +340,7 @@ sysctl_debug_umtx_chains_peaks(SYSCTL_HANDLER_ARGS)
 	sbuf_new(&sb, buf, sizeof(buf), SBUF_FIXEDLEN);
 	for (i = 0; i < 2; i++) {
 		tot = 0;
-		for (j = 0; j < UMTX_CHAINS; ++j) {
+		for (j = 0; j < umtxq_nchains; ++j) {
 			uc = &umtxq_chains[i][j];
 			mtx_lock(&uc->uc_lock);
 			tot += uc->max_length;
@@ -336,7 +352,7 @@ sysctl_debug_umtx_chains_peaks(SYSCTL_HANDLER_ARGS)
 			sf0 = sf1 = sf2 = sf3 = sf4 = 0;
 			si0 = si1 = si2 = si3 = si4 = 0;
 			sw0 = sw1 = sw2 = sw3 = sw4 = 0;
-			for (j = 0; j < UMTX_CHAINS; j++) {
+			for (j = 0; j < umtxq_nchains; j++) {
 				uc = &umtxq_chains[i][j];
 				mtx_lock(&uc->uc_lock);
 				whole = uc->max_length * 100;
@@ -402,7 +418,7 @@ sysctl_debug_umtx_chains_clear(SYSCTL_HANDLER_ARGS)
 
 	if (clear != 0) {
 		for (i = 0; i < 2; ++i) {
-			for (j = 0; j < UMTX_CHAINS; ++j) {
+			for (j = 0; j < umtxq_nchains; ++j) {
 				uc = &umtxq_chains[i][j];
 				mtx_lock(&uc->uc_lock);
 				uc->length = 0;
@@ -422,15 +438,83 @@ SYSCTL_PROC(_debug_umtx_chains, OID_AUTO, peaks,
     sysctl_debug_umtx_chains_peaks, "A", "Highest peaks in chains max length");
 #endif
 
+#define	UMTX_HOT_CHAINS		5
+
+/*
+ * Report the chains of each table that threads most often had to sleep
+ * on, either waiting for a umtx object or for the busy chain.
+ */
+static int
+sysctl_debug_umtx_contention(SYSCTL_HANDLER_ARGS)
+{
+	struct sbuf sb;
+	struct umtxq_chain *uc;
+	u_long cnt, hotcnt[UMTX_HOT_CHAINS];
+	u_int hotidx[UMTX_HOT_CHAINS];
+	u_int i, j, k;
+	int error;
+
+	error = sysctl_wire_old_buffer(req, 0);
+	if (error != 0)
+		return (error);
+	sbuf_new_for_sysctl(&sb, NULL, 256, req);
+	for (i = 0; i < 2; i++) {
+		bzero(hotcnt, sizeof(hotcnt));
+		bzero(hotidx, sizeof(hotidx));
+		for (j = 0; j < umtxq_nchains; j++) {
+			uc = &umtxq_chains[i][j];
+			cnt = uc->uc_sleeps + uc->uc_busy_waits;
+			for (k = UMTX_HOT_CHAINS; k > 0 && cnt > hotcnt[k - 1];
+			    k--) {
+				if (k < UMTX_HOT_CHAINS) {
+					hotcnt[k] = hotcnt[k - 1];
+					hotidx[k] = hotidx[k - 1];
+				}
+			}
+			if (k < UMTX_HOT_CHAINS) {
+				hotcnt[k] = cnt;
+				hotidx[k] = j;
+			}
+		}
+		sbuf_printf(&sb, "\nqueue %u:", i);
+		for (k = 0; k < UMTX_HOT_CHAINS && hotcnt[k] != 0; k++) {
+			uc = &umtxq_chains[i][hotidx[k]];
+			sbuf_printf(&sb, "\n idx %u: %lu sleeps, %lu busy",
+			    hotidx[k], uc->uc_sleeps, uc->uc_busy_waits);
+		}
+	}
+	error = sbuf_finish(&sb);
+	sbuf_delete(&sb);
+	return (error);
+}
+SYSCTL_PROC(_debug_umtx, OID_AUTO, contention,
+    CTLTYPE_STRING | CTLFLAG_RD | CTLFLAG_MPSAFE, 0, 0,
+    sysctl_debug_umtx_contention, "A", "Most contended umtx chains");
+
 static void
 umtxq_sysinit(void *arg __unused)
 {
-	int i, j;
+	int i, j, n;
 
 	umtx_pi_zone = uma_zcreate("umtx pi", sizeof(struct umtx_pi),
 		NULL, NULL, NULL, NULL, UMA_ALIGN_PTR, 0);
+
+	/*
+	 * Scale the chain tables with the number of CPUs, so that heavily
+	 * threaded programs do not pile up on a few hot chain locks.
+	 */
+	n = mp_ncpus * UMTX_CHAINS_PER_CPU;
+	TUNABLE_INT_FETCH("kern.ipc.umtx_chains", &n);
+	umtxq_nchains = UMTX_CHAINS;
+	while (umtxq_nchains < (u_int)n && umtxq_nchains < (1U << 16))
+		umtxq_nchains <<= 1;
+	umtxq_shift = __WORD_BIT - (fls(umtxq_nchains) - 1);
+	for (i = 0; i < 2; ++i)
+		umtxq_chains[i] = malloc(umtxq_nchains *
+		    sizeof(struct umtxq_chain), M_UMTX, M_WAITOK | M_ZERO);
+
 	for (i = 0; i < 2; ++i) {
-		for (j = 0; j < UMTX_CHAINS; ++j) {
+		for (j = 0; j < umtxq_nchains; ++j) {
 			mtx_init(&umtxq_chains[i][j].uc_lock, "umtxql", NULL,
 				 MTX_DEF | MTX_DUPOK);
 			LIST_INIT(&umtxq_chains[i][j].uc_queue[0]);
@@ -483,7 +567,8 @@ umtxq_hash(struct umtx_key *key)
 	unsigned n;
 
 	n = (uintptr_t)key->info.both.a + key->info.both.b;
-	key->hash = ((n * GOLDEN_RATIO_PRIME) >> UMTX_SHIFTS) % UMTX_CHAINS;
+	key->hash = ((n * GOLDEN_RATIO_PRIME) >> umtxq_shift) &
+	    (umtxq_nchains - 1);
 }
 
 static inline struct umtxq_chain *
@@ -543,6 +628,7 @@ umtxq_busy(struct umtx_key *key)
 		}
 #endif
 		while (uc->uc_busy) {
+			uc->uc_busy_waits++;
 			uc->uc_waiters++;
 			msleep(uc, &uc->uc_lock, 0, "umtxqb", 0);
 			uc->uc_waiters--;
@@ -844,6 +930,8 @@ umtxq_sleep(struct umtx_q *uq, const char *wmesg, struct abs_timeout *abstime)
 
 	uc = umtxq_getchain(&uq->uq_key);
 	UMTXQ_LOCKED_ASSERT(uc);
+	if (uq->uq_flags & UQF_UMTXQ)
+		uc->uc_sleeps++;
 	for (;;) {
 		if (!(uq->uq_flags & UQF_UMTXQ)) {
 			error = 0;
@@ -1007,6 +1095,41 @@ kern_umtx_wake(struct thread *td, void *uaddr, int n_wake, int is_private)
 /*
  * Lock PTHREAD_PRIO_NONE protocol POSIX mutex.
  */
+/*
+ * Spin for a while on a normal umutex whose owner is running on another
+ * CPU, on the bet that it is released sooner than a sleep and wakeup
+ * would take.  Returns true if the owner word changed during the spin.
+ */
+static bool
+umtx_spin_owner(struct thread *td, struct umutex *m, uint32_t flags,
+    uint32_t owner)
+{
+	struct thread *otd;
+	uint32_t cur;
+	bool running;
+	int i;
+
+	if (umtx_spin_max <= 0 || mp_ncpus == 1)
+		return (false);
+	otd = tdfind(owner & ~UMUTEX_CONTESTED,
+	    (flags & USYNC_PROCESS_SHARED) != 0 ? -1 : td->td_proc->p_pid);
+	if (otd == NULL)
+		return (false);
+	running = TD_IS_RUNNING(otd);
+	PROC_UNLOCK(otd->td_proc);
+	if (!running)
+		return (false);
+
+	for (i = 0; i < umtx_spin_max; i++) {
+		cpu_spinwait();
+		if (fueword32(&m->m_owner, &cur) == -1 || cur != owner) {
+			atomic_add_long(&umtx_spin_acquired, 1);
+			return (true);
+		}
+	}
+	return (false);
+}
+
 static int
 do_lock_normal(struct thread *td, struct umutex *m, uint32_t flags,
     struct _umtx_time *timeout, int mode)
@@ -1015,10 +1138,12 @@ do_lock_normal(struct thread *td, struct umutex *m, uint32_t flags,
 	struct umtx_q *uq;
 	uint32_t owner, old, id;
 	int error, rv;
+	bool spun;
 
 	id = td->td_tid;
 	uq = td->td_umtxq;
 	error = 0;
+	spun = false;
 	if (timeout != NULL)
 		abs_timeout_init2(&timo, timeout);
 
@@ -1111,6 +1236,12 @@ do_lock_normal(struct thread *td, struct umutex *m, uint32_t flags,
 		if (error != 0)
 			return (error);
 
+		if (!spun) {
+			spun = true;
+			if (umtx_spin_owner(td, m, flags, owner))
+				continue;
+		}
+
 		if ((error = umtx_key_get(m, TYPE_NORMAL_UMUTEX,
 		    GET_SHARE(flags), &uq->uq_key)) != 0)
 			return (error);
@@ -3667,6 +3798,8 @@ TAILQ_HEAD(umtx_shm_reg_head, umtx_shm_reg);
 
 static uma_zone_t umtx_shm_reg_zone;
 static struct umtx_shm_reg_head umtx_shm_registry[UMTX_CHAINS];
+#define	UMTX_SHM_REG(hash)						\
+    (&umtx_shm_registry[(hash) & (UMTX_CHAINS - 1)])
 static struct mtx umtx_shm_lock;
 static struct umtx_shm_reg_head umtx_shm_reg_delfree =
     TAILQ_HEAD_INITIALIZER(umtx_shm_reg_delfree);
@@ -3700,7 +3833,7 @@ umtx_shm_find_reg_locked(const struct umtx_key *key)
 
 	KASSERT(key->shared, ("umtx_p_find_rg: private key"));
 	mtx_assert(&umtx_shm_lock, MA_OWNED);
-	reg_head = &umtx_shm_registry[key->hash];
+	reg_head = UMTX_SHM_REG(key->hash);
 	TAILQ_FOREACH(reg, reg_head, ushm_reg_link) {
 		KASSERT(reg->ushm_key.shared,
 		    ("non-shared key on reg %p %d", reg, reg->ushm_key.shared));
@@ -3752,7 +3885,7 @@ umtx_shm_unref_reg_locked(struct umtx_shm_reg *reg, bool force)
 	res = reg->ushm_refcnt == 0;
 	if (res || force) {
 		if ((reg->ushm_flags & USHMF_REG_LINKED) != 0) {
-			TAILQ_REMOVE(&umtx_shm_registry[reg->ushm_key.hash],
+			TAILQ_REMOVE(UMTX_SHM_REG(reg->ushm_key.hash),
 			    reg, ushm_reg_link);
 			reg->ushm_flags &= ~USHMF_REG_LINKED;
 		}
@@ -3845,7 +3978,7 @@ umtx_shm_create_reg(struct thread *td, const struct umtx_key *key,
 		return (0);
 	}
 	reg->ushm_refcnt++;
-	TAILQ_INSERT_TAIL(&umtx_shm_registry[key->hash], reg, ushm_reg_link);
+	TAILQ_INSERT_TAIL(UMTX_SHM_REG(key->hash), reg, ushm_reg_link);
 	LIST_INSERT_HEAD(USHM_OBJ_UMTX(key->info.shared.object), reg,
 	    ushm_obj_link);
 	reg->ushm_flags = USHMF_REG_LINKED | USHMF_OBJ_LINKED;
@@ -73,6 +73,12 @@ __FBSDID("$FreeBSD$");
 
 #include "linker_if.h"
 
+/*
+ * Module contents are read front to back.  Tell the filesystem so that it
+ * clusters the reads and reads ahead as it would for a sequential reader.
+ */
+#define	LINK_ELF_SEQ_IO	(IO_NODELOCKED | (IO_SEQMAX << IO_SEQSHIFT))
+
 #define MAXSEGS 4
 
 typedef struct elf_file {
@@ -958,7 +964,7 @@ link_elf_load_file(linker_class_t cls, const char* filename,
 		caddr_t segbase = mapbase + segs[i]->p_vaddr - base_vaddr;
 		error = vn_rdwr(UIO_READ, nd.ni_vp,
 		    segbase, segs[i]->p_filesz, segs[i]->p_offset,
-		    UIO_SYSSPACE, IO_NODELOCKED, td->td_ucred, NOCRED,
+		    UIO_SYSSPACE, LINK_ELF_SEQ_IO, td->td_ucred, NOCRED,
 		    &resid, td);
 		if (error != 0)
 			goto out;
@@ -67,6 +67,12 @@ __FBSDID("$FreeBSD$");
 
 #include "linker_if.h"
 
+/*
+ * Module contents are read front to back.  Tell the filesystem so that it
+ * clusters the reads and reads ahead as it would for a sequential reader.
+ */
+#define	LINK_ELF_SEQ_IO	(IO_NODELOCKED | (IO_SEQMAX << IO_SEQSHIFT))
+
 typedef struct {
 	void		*addr;
 	Elf_Off		size;
@@ -873,7 +879,7 @@ link_elf_load_file(linker_class_t cls, const char *filename,
 				error = vn_rdwr(UIO_READ, nd->ni_vp,
 				    ef->progtab[pb].addr,
 				    shdr[i].sh_size, shdr[i].sh_offset,
-				    UIO_SYSSPACE, IO_NODELOCKED, td->td_ucred,
+				    UIO_SYSSPACE, LINK_ELF_SEQ_IO, td->td_ucred,
 				    NOCRED, &resid, td);
 				if (error)
 					goto out;
@@ -916,7 +922,7 @@ link_elf_load_file(linker_class_t cls, const char *filename,
 			error = vn_rdwr(UIO_READ, nd->ni_vp,
 			    (void *)ef->reltab[rl].rel,
 			    shdr[i].sh_size, shdr[i].sh_offset,
-			    UIO_SYSSPACE, IO_NODELOCKED, td->td_ucred, NOCRED,
+			    UIO_SYSSPACE, LINK_ELF_SEQ_IO, td->td_ucred, NOCRED,
 			    &resid, td);
 			if (error)
 				goto out;
@@ -937,7 +943,7 @@ link_elf_load_file(linker_class_t cls, const char *filename,
 			error = vn_rdwr(UIO_READ, nd->ni_vp,
 			    (void *)ef->relatab[ra].rela,
 			    shdr[i].sh_size, shdr[i].sh_offset,
-			    UIO_SYSSPACE, IO_NODELOCKED, td->td_ucred, NOCRED,
+			    UIO_SYSSPACE, LINK_ELF_SEQ_IO, td->td_ucred, NOCRED,
 			    &resid, td);
 			if (error)
 				goto out;
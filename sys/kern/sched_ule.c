@@ -100,6 +100,9 @@ struct td_sched {
 	int		ts_ltick;	/* Last tick that we were running on */
 	int		ts_ftick;	/* First tick that we were running on */
 	int		ts_ticks;	/* Tick count */
+#ifdef SCHED_STATS
+	sbintime_t	ts_waketime;	/* Time of the last wakeup. */
+#endif
 #ifdef KTR
 	char		ts_name[TS_NAME_LEN];
 #endif
@@ -274,6 +277,8 @@ static int balance_interval = 128;	/* Default set in sched_initticks(). */
 static int affinity;
 static int steal_idle = 1;
 static int steal_thresh = 2;
+static int steal_remote_delta = 1;
+static int steal_batch = 2;
 static int always_steal = 0;
 static int trysteal_limit = 2;
 
@@ -835,6 +840,39 @@ sched_highest(const struct cpu_group *cg, cpuset_t mask, int minload)
 	return high.cs_cpu;
 }
 
+#ifdef SCHED_STATS
+/*
+ * Steals by the level of the topology group the victim was found in.
+ */
+DPCPU_DEFINE_STATIC(unsigned long, steal_level[MAX_CACHE_LEVELS + 1]);
+SCHED_STAT_DEFINE_VAR(steal_remote, &DPCPU_NAME(steal_level[CG_SHARE_NONE]),
+    "Threads stolen from CPUs not sharing a cache");
+SCHED_STAT_DEFINE_VAR(steal_l1, &DPCPU_NAME(steal_level[CG_SHARE_L1]),
+    "Threads stolen from CPUs sharing the L1 cache");
+SCHED_STAT_DEFINE_VAR(steal_l2, &DPCPU_NAME(steal_level[CG_SHARE_L2]),
+    "Threads stolen from CPUs sharing the L2 cache");
+SCHED_STAT_DEFINE_VAR(steal_l3, &DPCPU_NAME(steal_level[CG_SHARE_L3]),
+    "Threads stolen from CPUs sharing the L3 cache");
+#define	SCHED_STEAL_STAT(cg)	DPCPU_GET(steal_level[(cg)->cg_level])++
+#else
+#define	SCHED_STEAL_STAT(cg)	(void)0
+#endif
+
+/*
+ * The load a CPU in the given group must carry before an idle CPU steals
+ * from it.  Groups that do not share a cache, i.e. other sockets or LLCs,
+ * require an extra steal_remote_delta so that work stays in the local LLC
+ * unless the imbalance is worth the cache misses.
+ */
+static inline int
+sched_steal_thresh(const struct cpu_group *cg)
+{
+
+	if (cg->cg_level == CG_SHARE_NONE)
+		return (steal_thresh + steal_remote_delta);
+	return (steal_thresh);
+}
+
 static void
 sched_balance_group(struct cpu_group *cg)
 {
@@ -989,7 +1027,7 @@ tdq_idled(struct tdq *tdq)
 	struct cpu_group *cg;
 	struct tdq *steal;
 	cpuset_t mask;
-	int cpu, switchcnt;
+	int cpu, n, switchcnt, thresh;
 
 	if (smp_started == 0 || steal_idle == 0 || tdq->tdq_cg == NULL)
 		return (1);
@@ -998,7 +1036,8 @@ tdq_idled(struct tdq *tdq)
     restart:
 	switchcnt = tdq->tdq_switchcnt + tdq->tdq_oldswitchcnt;
 	for (cg = tdq->tdq_cg; ; ) {
-		cpu = sched_highest(cg, mask, steal_thresh);
+		thresh = sched_steal_thresh(cg);
+		cpu = sched_highest(cg, mask, thresh);
 		/*
 		 * We were assigned a thread but not preempted.  Returning
 		 * 0 here will cause our caller to switch to it.
@@ -1020,7 +1059,7 @@ tdq_idled(struct tdq *tdq)
 		 * this situation about 20% of the time on an 8 core
 		 * 16 thread Ryzen 7, but it still helps performance.
 		 */
-		if (steal->tdq_load < steal_thresh ||
+		if (steal->tdq_load < thresh ||
 		    steal->tdq_transferable == 0)
 			goto restart;
 		tdq_lock_pair(tdq, steal);
@@ -1037,17 +1076,28 @@ tdq_idled(struct tdq *tdq)
 		 * of date.  The latter is rare.  In either case restart
 		 * the search.
 		 */
-		if (steal->tdq_load < steal_thresh ||
+		if (steal->tdq_load < thresh ||
 		    steal->tdq_transferable == 0 ||
 		    switchcnt != tdq->tdq_switchcnt + tdq->tdq_oldswitchcnt) {
 			tdq_unlock_pair(tdq, steal);
 			goto restart;
 		}
 		/*
-		 * Steal the thread and switch to it.
+		 * Steal the thread and switch to it.  While the victim
+		 * stays more loaded than we are, take up to steal_batch
+		 * threads so that it is not raided again on our next idle.
 		 */
-		if (tdq_move(steal, tdq) != NULL)
+		if (tdq_move(steal, tdq) != NULL) {
+			SCHED_STEAL_STAT(cg);
+			for (n = 1; n < steal_batch; n++) {
+				if (steal->tdq_transferable == 0 ||
+				    steal->tdq_load - 1 <= tdq->tdq_load ||
+				    tdq_move(steal, tdq) == NULL)
+					break;
+				SCHED_STEAL_STAT(cg);
+			}
 			break;
+		}
 		/*
 		 * We failed to acquire a thread even though it looked
 		 * like one was available.  This could be due to affinity
@@ -1872,7 +1922,7 @@ tdq_trysteal(struct tdq *tdq)
 	struct cpu_group *cg;
 	struct tdq *steal;
 	cpuset_t mask;
-	int cpu, i;
+	int cpu, i, thresh;
 
 	if (smp_started == 0 || trysteal_limit == 0 || tdq->tdq_cg == NULL)
 		return;
@@ -1882,7 +1932,8 @@ tdq_trysteal(struct tdq *tdq)
 	spinlock_enter();
 	TDQ_UNLOCK(tdq);
 	for (i = 1, cg = tdq->tdq_cg; ; ) {
-		cpu = sched_highest(cg, mask, steal_thresh);
+		thresh = sched_steal_thresh(cg);
+		cpu = sched_highest(cg, mask, thresh);
 		/*
 		 * If a thread was added while interrupts were disabled don't
 		 * steal one here.
@@ -1905,7 +1956,7 @@ tdq_trysteal(struct tdq *tdq)
 		 * The data returned by sched_highest() is stale and
                  * the chosen CPU no longer has an eligible thread.
 		 */
-		if (steal->tdq_load < steal_thresh ||
+		if (steal->tdq_load < thresh ||
 		    steal->tdq_transferable == 0)
 			continue;
 		tdq_lock_pair(tdq, steal);
@@ -1924,7 +1975,7 @@ tdq_trysteal(struct tdq *tdq)
 		 * The data returned by sched_highest() is stale and
                  * the chosen CPU no longer has an eligible thread.
 		 */
-		if (steal->tdq_load < steal_thresh ||
+		if (steal->tdq_load < thresh ||
 		    steal->tdq_transferable == 0) {
 			TDQ_UNLOCK(steal);
 			break;
@@ -1938,6 +1989,7 @@ tdq_trysteal(struct tdq *tdq)
 			TDQ_UNLOCK(steal);
 			break;
 		}
+		SCHED_STEAL_STAT(cg);
 		TDQ_UNLOCK(steal);
 		break;
 	}
@@ -1996,6 +2048,55 @@ thread_unblock_switch(struct thread *td, struct mtx *mtx)
 	    (uintptr_t)mtx);
 }
 
+#ifdef SCHED_STATS
+/*
+ * Histogram of the time from sched_wakeup() until the thread runs, in
+ * power-of-four buckets of microseconds.
+ */
+#define	WAKEUP_LAT_BUCKETS	10
+DPCPU_DEFINE_STATIC(unsigned long, wakeup_lat[WAKEUP_LAT_BUCKETS]);
+SCHED_STAT_DEFINE_VAR(wakeup_1us, &DPCPU_NAME(wakeup_lat[0]),
+    "Woken threads run within 1us");
+SCHED_STAT_DEFINE_VAR(wakeup_4us, &DPCPU_NAME(wakeup_lat[1]),
+    "Woken threads run within 4us");
+SCHED_STAT_DEFINE_VAR(wakeup_16us, &DPCPU_NAME(wakeup_lat[2]),
+    "Woken threads run within 16us");
+SCHED_STAT_DEFINE_VAR(wakeup_64us, &DPCPU_NAME(wakeup_lat[3]),
+    "Woken threads run within 64us");
+SCHED_STAT_DEFINE_VAR(wakeup_256us, &DPCPU_NAME(wakeup_lat[4]),
+    "Woken threads run within 256us");
+SCHED_STAT_DEFINE_VAR(wakeup_1ms, &DPCPU_NAME(wakeup_lat[5]),
+    "Woken threads run within 1ms");
+SCHED_STAT_DEFINE_VAR(wakeup_4ms, &DPCPU_NAME(wakeup_lat[6]),
+    "Woken threads run within 4ms");
+SCHED_STAT_DEFINE_VAR(wakeup_16ms, &DPCPU_NAME(wakeup_lat[7]),
+    "Woken threads run within 16ms");
+SCHED_STAT_DEFINE_VAR(wakeup_64ms, &DPCPU_NAME(wakeup_lat[8]),
+    "Woken threads run within 64ms");
+SCHED_STAT_DEFINE_VAR(wakeup_max, &DPCPU_NAME(wakeup_lat[9]),
+    "Woken threads run after 64ms or more");
+
+static inline void
+sched_wakeup_latency(struct thread *td)
+{
+	struct td_sched *ts;
+	uint64_t us;
+	int bucket;
+
+	ts = td_get_sched(td);
+	if (ts->ts_waketime == 0)
+		return;
+	us = sbttous(sbinuptime() - ts->ts_waketime);
+	ts->ts_waketime = 0;
+	bucket = us == 0 ? 0 : (flsll(us) + 1) / 2;
+	if (bucket >= WAKEUP_LAT_BUCKETS)
+		bucket = WAKEUP_LAT_BUCKETS - 1;
+	DPCPU_GET(wakeup_lat[bucket])++;
+}
+#else
+#define	sched_wakeup_latency(td)	(void)0
+#endif
+
 /*
  * Switch threads.  This function has to handle threads coming in while
  * blocked for some reason, running, or idle.  It also must deal with
@@ -2080,6 +2181,7 @@ sched_switch(struct thread *td, struct thread *newtd, int flags)
 	 */
 	TDQ_LOCK_ASSERT(tdq, MA_OWNED | MA_NOTRECURSED);
 	newtd = choosethread();
+	sched_wakeup_latency(newtd);
 	/*
 	 * Call the MD code to switch contexts if necessary.
 	 */
@@ -2202,6 +2304,9 @@ sched_wakeup(struct thread *td)
 	 * Reset the slice value since we slept and advanced the round-robin.
 	 */
 	ts->ts_slice = 0;
+#ifdef SCHED_STATS
+	ts->ts_waketime = sbinuptime();
+#endif
 	sched_add(td, SRQ_BORING);
 }
 
@@ -2266,6 +2371,9 @@ sched_fork_thread(struct thread *td, struct thread *child)
 	ts2->ts_runtime = ts->ts_runtime;
 	/* Attempt to quickly learn interactivity. */
 	ts2->ts_slice = tdq_slice(tdq) - sched_slice_min;
+#ifdef SCHED_STATS
+	ts2->ts_waketime = 0;
+#endif
 #ifdef KTR
 	bzero(ts2->ts_name, sizeof(ts2->ts_name));
 #endif
@@ -3060,6 +3168,11 @@ SYSCTL_INT(_kern_sched, OID_AUTO, steal_idle, CTLFLAG_RW, &steal_idle, 0,
     "Attempts to steal work from other cores before idling");
 SYSCTL_INT(_kern_sched, OID_AUTO, steal_thresh, CTLFLAG_RW, &steal_thresh, 0,
     "Minimum load on remote CPU before we'll steal");
+SYSCTL_INT(_kern_sched, OID_AUTO, steal_remote_delta, CTLFLAG_RW,
+    &steal_remote_delta, 0,
+    "Additional load required to steal from CPUs not sharing a cache");
+SYSCTL_INT(_kern_sched, OID_AUTO, steal_batch, CTLFLAG_RW, &steal_batch, 0,
+    "Maximum number of threads an idle CPU steals at once");
 SYSCTL_INT(_kern_sched, OID_AUTO, trysteal_limit, CTLFLAG_RW, &trysteal_limit,
     0, "Topological distance limit for stealing threads in sched_switch()");
 SYSCTL_INT(_kern_sched, OID_AUTO, always_steal, CTLFLAG_RW, &always_steal, 0,
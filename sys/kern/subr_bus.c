@@ -2940,7 +2940,10 @@ device_attach(device_t dev)
 		device_print_child(dev->parent, dev);
 	attachtime = get_cyclecount();
 	dev->state = DS_ATTACHING;
-	if ((error = DEVICE_ATTACH(dev)) != 0) {
+	TSENTER2(device_get_name(dev));
+	error = DEVICE_ATTACH(dev);
+	TSEXIT2(device_get_name(dev));
+	if (error != 0) {
 		printf("device_attach: %s%d attach returned %d\n",
 		    dev->driver->name, dev->unit, error);
 		if (!(dev->flags & DF_FIXEDCLASS))
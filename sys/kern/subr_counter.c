@@ -43,6 +43,52 @@ __FBSDID("$FreeBSD$");
 #define IN_SUBR_COUNTER_C
 #include <sys/counter.h>
 
+/*
+ * Per-CPU zones for counter arrays, with item sizes from one cache line
+ * up to one block of COUNTER_U64_ARRAY_CHUNK counters.
+ */
+#define	COUNTER_ARRAY_MINSIZE	CACHE_LINE_SIZE
+#define	COUNTER_ARRAY_MAXSIZE	(COUNTER_U64_ARRAY_CHUNK * 8)
+#define	COUNTER_ARRAY_NZONES	8
+CTASSERT(powerof2(COUNTER_ARRAY_MAXSIZE));
+CTASSERT(COUNTER_ARRAY_MAXSIZE < UMA_PCPU_ALLOC_SIZE);
+CTASSERT(COUNTER_ARRAY_MAXSIZE <=
+    COUNTER_ARRAY_MINSIZE << (COUNTER_ARRAY_NZONES - 1));
+
+static uma_zone_t counter_array_zones[COUNTER_ARRAY_NZONES];
+static char counter_array_names[COUNTER_ARRAY_NZONES][24];
+
+static void
+counter_array_zones_startup(void *arg __unused)
+{
+	size_t size;
+	int i;
+
+	for (i = 0; (COUNTER_ARRAY_MINSIZE << i) <= COUNTER_ARRAY_MAXSIZE;
+	    i++) {
+		size = COUNTER_ARRAY_MINSIZE << i;
+		snprintf(counter_array_names[i], sizeof(counter_array_names[i]),
+		    "counter array %zu", size);
+		counter_array_zones[i] = uma_zcreate(counter_array_names[i],
+		    size, NULL, NULL, NULL, NULL, CACHE_LINE_SIZE - 1,
+		    UMA_ZONE_PCPU);
+	}
+}
+SYSINIT(counter_array, SI_SUB_VM, SI_ORDER_ANY, counter_array_zones_startup,
+    NULL);
+
+static uma_zone_t
+counter_array_zone(int n)
+{
+	size_t size;
+	int i;
+
+	size = n * sizeof(uint64_t);
+	for (i = 0; (COUNTER_ARRAY_MINSIZE << i) < size; i++)
+		;
+	return (counter_array_zones[i]);
+}
+
 void
 counter_u64_zero(counter_u64_t c)
 {
@@ -71,6 +117,86 @@ counter_u64_free(counter_u64_t c)
 	uma_zfree_pcpu(pcpu_zone_64, c);
 }
 
+/*
+ * Allocate n counters into a, in blocks of up to COUNTER_U64_ARRAY_CHUNK
+ * counters that are contiguous within each CPU's copy.
+ */
+int
+counter_u64_array_alloc(counter_u64_t *a, int n, int flags)
+{
+	counter_u64_t base;
+	int i, j, len;
+
+	for (i = 0; i < n; i += len) {
+		len = min(n - i, COUNTER_U64_ARRAY_CHUNK);
+		base = uma_zalloc_pcpu(counter_array_zone(len),
+		    flags | M_ZERO);
+		if (base == NULL) {
+			counter_u64_array_free(a, i);
+			return (ENOMEM);
+		}
+		for (j = 0; j < len; j++)
+			a[i + j] = base + j;
+	}
+	return (0);
+}
+
+void
+counter_u64_array_free(counter_u64_t *a, int n)
+{
+	int i, len;
+
+	for (i = 0; i < n; i += len) {
+		len = min(n - i, COUNTER_U64_ARRAY_CHUNK);
+		uma_zfree_pcpu(counter_array_zone(len), a[i]);
+	}
+}
+
+void
+counter_u64_array_fetch(counter_u64_t *a, int n, uint64_t *out)
+{
+	counter_u64_t base;
+	int cpu, i, j, len;
+
+	bzero(out, n * sizeof(*out));
+	for (i = 0; i < n; i += len) {
+		len = min(n - i, COUNTER_U64_ARRAY_CHUNK);
+		base = a[i];
+		CPU_FOREACH(cpu) {
+			for (j = 0; j < len; j++)
+				out[i + j] += counter_u64_read_one(base + j,
+				    cpu);
+		}
+	}
+}
+
+struct counter_array_zero_args {
+	counter_u64_t	*a;
+	int		n;
+};
+
+static void
+counter_u64_array_zero_one_cpu(void *arg)
+{
+	struct counter_array_zero_args *args;
+	int i;
+
+	args = arg;
+	for (i = 0; i < args->n; i++)
+		counter_u64_zero_one_cpu(args->a[i]);
+}
+
+void
+counter_u64_array_zero(counter_u64_t *a, int n)
+{
+	struct counter_array_zero_args args;
+
+	args.a = a;
+	args.n = n;
+	smp_rendezvous(smp_no_rendezvous_barrier,
+	    counter_u64_array_zero_one_cpu, smp_no_rendezvous_barrier, &args);
+}
+
 int
 sysctl_handle_counter_u64(SYSCTL_HANDLER_ARGS)
 {
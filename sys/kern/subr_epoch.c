@@ -89,6 +89,25 @@ static counter_u64_t epoch_call_task_count;
 SYSCTL_COUNTER_U64(_kern_epoch_stats, OID_AUTO, epoch_call_tasks, CTLFLAG_RW,
     &epoch_call_task_count, "# of times a callback task was run");
 
+static u_int epoch_max_pending = 16384;
+SYSCTL_UINT(_kern_epoch, OID_AUTO, max_pending, CTLFLAG_RWTUN,
+    &epoch_max_pending, 0,
+    "Deferred callbacks per CPU and epoch that force a grace period "
+    "(0 disables)");
+
+/*
+ * Per-epoch statistics, indexed like allepochs[] and exported under
+ * kern.epoch.<index>.
+ */
+struct epoch_stats {
+	counter_u64_t	es_waits;	/* Grace periods waited for. */
+	counter_u64_t	es_wait_us;	/* Total wait time. */
+	counter_u64_t	es_forced;	/* Waits forced by max_pending. */
+	u_int		es_wait_max_us;	/* Longest wait. */
+	struct sysctl_ctx_list es_ctx;
+};
+static struct epoch_stats epoch_stats[MAX_EPOCHS];
+
 TAILQ_HEAD (threadlist, thread);
 
 CK_STACK_CONTAINER(struct ck_epoch_entry, stack_entry,
@@ -156,6 +175,88 @@ epoch_ctor(epoch_t epoch)
 	}
 }
 
+static int
+epoch_sysctl_pending(SYSCTL_HANDLER_ARGS)
+{
+	epoch_record_t er;
+	epoch_t epoch;
+	u_int val;
+	int cpu;
+
+	epoch = arg1;
+	val = 0;
+	CPU_FOREACH(cpu) {
+		er = zpcpu_get_cpu(epoch->e_pcpu_record, cpu);
+		if (arg2 == 0)
+			val += er->er_record.n_pending;
+		else
+			val = max(val, er->er_record.n_peak);
+	}
+	return (sysctl_handle_int(oidp, &val, 0, req));
+}
+
+static void
+epoch_stats_init(epoch_t epoch)
+{
+	struct epoch_stats *es;
+	struct sysctl_oid *oid;
+	char name[16];
+
+	es = &epoch_stats[epoch->e_idx];
+	es->es_waits = counter_u64_alloc(M_WAITOK);
+	es->es_wait_us = counter_u64_alloc(M_WAITOK);
+	es->es_forced = counter_u64_alloc(M_WAITOK);
+	es->es_wait_max_us = 0;
+	sysctl_ctx_init(&es->es_ctx);
+	snprintf(name, sizeof(name), "%d", epoch->e_idx);
+	oid = SYSCTL_ADD_NODE(&es->es_ctx, SYSCTL_STATIC_CHILDREN(_kern_epoch),
+	    OID_AUTO, name, CTLFLAG_RD, NULL,
+	    (epoch->e_flags & EPOCH_PREEMPT) ? "preemptible epoch" : "epoch");
+	SYSCTL_ADD_PROC(&es->es_ctx, SYSCTL_CHILDREN(oid), OID_AUTO,
+	    "pending", CTLTYPE_UINT | CTLFLAG_RD | CTLFLAG_MPSAFE, epoch, 0,
+	    epoch_sysctl_pending, "IU", "Deferred callbacks not yet run");
+	SYSCTL_ADD_PROC(&es->es_ctx, SYSCTL_CHILDREN(oid), OID_AUTO,
+	    "peak", CTLTYPE_UINT | CTLFLAG_RD | CTLFLAG_MPSAFE, epoch, 1,
+	    epoch_sysctl_pending, "IU", "Largest per-CPU callback backlog");
+	SYSCTL_ADD_COUNTER_U64(&es->es_ctx, SYSCTL_CHILDREN(oid), OID_AUTO,
+	    "waits", CTLFLAG_RW, &es->es_waits, "Grace periods waited for");
+	SYSCTL_ADD_COUNTER_U64(&es->es_ctx, SYSCTL_CHILDREN(oid), OID_AUTO,
+	    "wait_us", CTLFLAG_RW, &es->es_wait_us,
+	    "Total time spent waiting for grace periods in microseconds");
+	SYSCTL_ADD_UINT(&es->es_ctx, SYSCTL_CHILDREN(oid), OID_AUTO,
+	    "wait_max_us", CTLFLAG_RW, &es->es_wait_max_us, 0,
+	    "Longest grace period wait in microseconds");
+	SYSCTL_ADD_COUNTER_U64(&es->es_ctx, SYSCTL_CHILDREN(oid), OID_AUTO,
+	    "forced", CTLFLAG_RW, &es->es_forced,
+	    "Grace periods forced by kern.epoch.max_pending");
+}
+
+static void
+epoch_stats_fini(epoch_t epoch)
+{
+	struct epoch_stats *es;
+
+	es = &epoch_stats[epoch->e_idx];
+	sysctl_ctx_free(&es->es_ctx);
+	counter_u64_free(es->es_waits);
+	counter_u64_free(es->es_wait_us);
+	counter_u64_free(es->es_forced);
+}
+
+static void
+epoch_stats_wait(epoch_t epoch, sbintime_t start)
+{
+	struct epoch_stats *es;
+	u_int us;
+
+	es = &epoch_stats[epoch->e_idx];
+	us = sbttous(sbinuptime() - start);
+	counter_u64_add(es->es_waits, 1);
+	counter_u64_add(es->es_wait_us, us);
+	if (us > es->es_wait_max_us)
+		es->es_wait_max_us = us;
+}
+
 epoch_t
 epoch_alloc(int flags)
 {
@@ -169,6 +270,7 @@ epoch_alloc(int flags)
 	MPASS(epoch_count < MAX_EPOCHS - 2);
 	epoch->e_flags = flags;
 	epoch->e_idx = epoch_count;
+	epoch_stats_init(epoch);
 	allepochs[epoch_count++] = epoch;
 	return (epoch);
 }
@@ -187,6 +289,7 @@ epoch_free(epoch_t epoch)
 #endif
 	allepochs[epoch->e_idx] = NULL;
 	epoch_wait(global_epoch);
+	epoch_stats_fini(epoch);
 	uma_zfree_pcpu(pcpu_zone_record, epoch->e_pcpu_record);
 	free(epoch, M_EPOCH);
 }
@@ -370,6 +473,7 @@ void
 epoch_wait_preempt(epoch_t epoch)
 {
 	struct thread *td;
+	sbintime_t start;
 	int was_bound;
 	int old_cpu;
 	int old_pinned;
@@ -400,7 +504,9 @@ epoch_wait_preempt(epoch_t epoch)
 	td->td_pinned = 0;
 	sched_bind(td, old_cpu);
 
+	start = sbinuptime();
 	ck_epoch_synchronize_wait(&epoch->e_epoch, epoch_block_handler_preempt, NULL);
+	epoch_stats_wait(epoch, start);
 
 	/* restore CPU binding, if any */
 	if (was_bound != 0) {
@@ -432,12 +538,15 @@ epoch_block_handler(struct ck_epoch *g __unused, ck_epoch_record_t *c __unused,
 void
 epoch_wait(epoch_t epoch)
 {
+	sbintime_t start;
 
 	MPASS(cold || epoch != NULL);
 	INIT_CHECK(epoch);
 	MPASS(epoch->e_flags == 0);
 	critical_enter();
+	start = sbinuptime();
 	ck_epoch_synchronize_wait(&epoch->e_epoch, epoch_block_handler, NULL);
+	epoch_stats_wait(epoch, start);
 	critical_exit();
 }
 
@@ -462,6 +571,13 @@ epoch_call(epoch_t epoch, epoch_context_t ctx, void (*callback) (epoch_context_t
 	*DPCPU_PTR(epoch_cb_count) += 1;
 	er = epoch_currecord(epoch);
 	ck_epoch_call(&er->er_record, cb, (ck_epoch_cb_t *)callback);
+	/*
+	 * Don't wait for the next hardclock tick if the backlog is over
+	 * the limit; the task will force a grace period.
+	 */
+	if (__predict_false(epoch_max_pending != 0 &&
+	    er->er_record.n_pending > epoch_max_pending))
+		GROUPTASK_ENQUEUE(DPCPU_PTR(epoch_cb_task));
 	critical_exit();
 	return;
 boottime:
@@ -476,7 +592,32 @@ epoch_call_task(void *arg __unused)
 	epoch_record_t er;
 	epoch_t epoch;
 	ck_stack_t cb_stack;
-	int i, npending, total;
+	uint64_t forced;
+	int i, npending, npoll, total;
+
+	/*
+	 * Readers drifting through epochs normally let each poll retire
+	 * one bucket.  If this CPU's backlog for an epoch is over the
+	 * limit, wait for a full grace period and then poll every bucket
+	 * so that the backlog cannot grow without bound.  This thread is
+	 * bound to the CPU, so the record stays ours while we sleep.
+	 */
+	forced = 0;
+	if (epoch_max_pending != 0) {
+		for (i = 0; i < epoch_count; i++) {
+			if (__predict_false((epoch = allepochs[i]) == NULL))
+				continue;
+			er = epoch_currecord(epoch);
+			if (er->er_record.n_pending <= epoch_max_pending)
+				continue;
+			if (epoch->e_flags & EPOCH_PREEMPT)
+				epoch_wait_preempt(epoch);
+			else
+				epoch_wait(epoch);
+			counter_u64_add(epoch_stats[i].es_forced, 1);
+			forced |= (uint64_t)1 << i;
+		}
+	}
 
 	ck_stack_init(&cb_stack);
 	critical_enter();
@@ -488,7 +629,9 @@ epoch_call_task(void *arg __unused)
 		record = &er->er_record;
 		if ((npending = record->n_pending) == 0)
 			continue;
-		ck_epoch_poll_deferred(record, &cb_stack);
+		npoll = (forced & ((uint64_t)1 << i)) ? CK_EPOCH_LENGTH : 1;
+		while (npoll-- > 0 && record->n_pending != 0)
+			ck_epoch_poll_deferred(record, &cb_stack);
 		total += npending - record->n_pending;
 	}
 	epoch_exit(global_epoch);
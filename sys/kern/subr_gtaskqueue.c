@@ -41,9 +41,12 @@ __FBSDID("$FreeBSD$");
 #include <sys/lock.h>
 #include <sys/malloc.h>
 #include <sys/mutex.h>
+#include <sys/pcpu.h>
 #include <sys/proc.h>
+#include <sys/sbuf.h>
 #include <sys/sched.h>
 #include <sys/smp.h>
+#include <sys/sysctl.h>
 #include <sys/gtaskqueue.h>
 #include <sys/unistd.h>
 #include <machine/stdarg.h>
@@ -55,6 +58,20 @@ static void	gtaskqueue_thread_loop(void *arg);
 TASKQGROUP_DEFINE(softirq, mp_ncpus, 1);
 TASKQGROUP_DEFINE(config, 1, 1);
 
+static SYSCTL_NODE(_kern, OID_AUTO, taskqgroup, CTLFLAG_RW, 0,
+    "Group task queues");
+
+static int gtaskqueue_stats;
+SYSCTL_INT(_kern_taskqgroup, OID_AUTO, stats, CTLFLAG_RWTUN,
+    &gtaskqueue_stats, 0,
+    "Record task queueing latency and run time histograms");
+
+/*
+ * Statistics histograms have one bucket per power of two microseconds;
+ * bucket 0 counts samples under 1us, the last one everything longer.
+ */
+#define	TQ_HIST_BUCKETS		16
+
 struct gtaskqueue_busy {
 	struct gtask	*tb_running;
 	TAILQ_ENTRY(gtaskqueue_busy) tb_link;
@@ -76,6 +93,8 @@ struct gtaskqueue {
 	int			tq_callouts;
 	taskqueue_callback_fn	tq_callbacks[TASKQUEUE_NUM_CALLBACKS];
 	void			*tq_cb_contexts[TASKQUEUE_NUM_CALLBACKS];
+	uint64_t		tq_latency[TQ_HIST_BUCKETS];
+	uint64_t		tq_runtime[TQ_HIST_BUCKETS];
 };
 
 #define	TQ_FLAGS_ACTIVE		(1 << 0)
@@ -111,6 +130,19 @@ gtask_dump(struct gtask *gtask)
 }
 #endif
 
+static __inline void
+TQ_HIST_ADD(uint64_t *hist, sbintime_t d)
+{
+	uint64_t us;
+	int b;
+
+	us = d > 0 ? sbttous(d) : 0;
+	b = us != 0 ? flsll(us) : 0;
+	if (b >= TQ_HIST_BUCKETS)
+		b = TQ_HIST_BUCKETS - 1;
+	hist[b]++;
+}
+
 static __inline int
 TQ_SLEEP(struct gtaskqueue *tq, void *p, struct mtx *m, int pri, const char *wm,
     int t)
@@ -199,6 +231,8 @@ grouptaskqueue_enqueue(struct gtaskqueue *queue, struct gtask *gtask)
 	}
 	STAILQ_INSERT_TAIL(&queue->tq_queue, gtask, ta_link);
 	gtask->ta_flags |= TASK_ENQUEUED;
+	if (gtaskqueue_stats)
+		gtask->ta_enqueued = sbinuptime();
 	TQ_UNLOCK(queue);
 	if ((queue->tq_flags & TQ_FLAGS_BLOCKED) == 0)
 		queue->tq_enqueue(queue->tq_context);
@@ -309,6 +343,7 @@ gtaskqueue_run_locked(struct gtaskqueue *queue)
 	struct gtaskqueue_busy tb;
 	struct gtaskqueue_busy *tb_first;
 	struct gtask *gtask;
+	sbintime_t start;
 
 	KASSERT(queue != NULL, ("tq is NULL"));
 	TQ_ASSERT_LOCKED(queue);
@@ -326,12 +361,21 @@ gtaskqueue_run_locked(struct gtaskqueue *queue)
 		STAILQ_REMOVE_HEAD(&queue->tq_queue, ta_link);
 		gtask->ta_flags &= ~TASK_ENQUEUED;
 		tb.tb_running = gtask;
+		start = 0;
+		if (gtask->ta_enqueued != 0) {
+			start = sbinuptime();
+			TQ_HIST_ADD(queue->tq_latency,
+			    start - gtask->ta_enqueued);
+			gtask->ta_enqueued = 0;
+		}
 		TQ_UNLOCK(queue);
 
 		KASSERT(gtask->ta_func != NULL, ("task->ta_func is NULL"));
 		gtask->ta_func(gtask->ta_context);
 
 		TQ_LOCK(queue);
+		if (start != 0)
+			TQ_HIST_ADD(queue->tq_runtime, sbinuptime() - start);
 		tb.tb_running = NULL;
 		wakeup(gtask);
 
@@ -556,6 +600,7 @@ struct taskqgroup_cpu {
 	struct gtaskqueue	*tgc_taskq;
 	int	tgc_cnt;
 	int	tgc_cpu;
+	int	tgc_domain;
 };
 
 struct taskqgroup {
@@ -584,6 +629,7 @@ taskqgroup_cpu_create(struct taskqgroup *qgroup, int idx, int cpu)
 	gtaskqueue_start_threads(&qcpu->tgc_taskq, 1, PI_SOFT,
 	    "%s_%d", qgroup->tqg_name, idx);
 	qcpu->tgc_cpu = cpu;
+	qcpu->tgc_domain = pcpu_find(cpu)->pc_domain;
 }
 
 static void
@@ -595,14 +641,15 @@ taskqgroup_cpu_remove(struct taskqgroup *qgroup, int idx)
 
 /*
  * Find the taskq with least # of tasks that doesn't currently have any
- * other queues from the uniq identifier.
+ * other queues from the uniq identifier, preferring queues whose CPU is
+ * in the given memory domain.
  */
 static int
-taskqgroup_find(struct taskqgroup *qgroup, void *uniq)
+taskqgroup_find(struct taskqgroup *qgroup, void *uniq, int domain)
 {
 	struct grouptask *n;
 	int i, idx, mincnt;
-	int strict;
+	int pass, strict;
 
 	mtx_assert(&qgroup->tqg_lock, MA_OWNED);
 	if (qgroup->tqg_cnt == 0)
@@ -610,14 +657,20 @@ taskqgroup_find(struct taskqgroup *qgroup, void *uniq)
 	idx = -1;
 	mincnt = INT_MAX;
 	/*
-	 * Two passes;  First scan for a queue with the least tasks that
-	 * does not already service this uniq id.  If that fails simply find
-	 * the queue with the least total tasks;
+	 * Up to four passes;  First scan the queues in the caller's domain
+	 * for one with the least tasks that does not already service this
+	 * uniq id, then any queue in that domain.  If that fails, or no
+	 * domain was given, repeat the two scans over all queues.
 	 */
-	for (strict = 1; mincnt == INT_MAX; strict = 0) {
+	for (pass = domain < 0 ? 2 : 0; mincnt == INT_MAX && pass < 4;
+	    pass++) {
+		strict = (pass & 1) == 0;
 		for (i = 0; i < qgroup->tqg_cnt; i++) {
 			if (qgroup->tqg_queue[i].tgc_cnt > mincnt)
 				continue;
+			if (pass < 2 &&
+			    qgroup->tqg_queue[i].tgc_domain != domain)
+				continue;
 			if (strict) {
 				LIST_FOREACH(n,
 				    &qgroup->tqg_queue[i].tgc_tasks, gt_list)
@@ -663,17 +716,20 @@ SYSINIT(tqg_record_smp_started, SI_SUB_SMP, SI_ORDER_FOURTH,
 
 void
 taskqgroup_attach(struct taskqgroup *qgroup, struct grouptask *gtask,
-    void *uniq, int irq, const char *name)
+    void *uniq, device_t dev, int irq, const char *name)
 {
 	cpuset_t mask;
-	int qid, error;
+	int qid, error, domain;
 
 	gtask->gt_uniq = uniq;
 	snprintf(gtask->gt_name, GROUPTASK_NAMELEN, "%s", name ? name : "grouptask");
 	gtask->gt_irq = irq;
 	gtask->gt_cpu = -1;
+	gtask->gt_domain = -1;
+	if (dev != NULL && bus_get_domain(dev, &domain) == 0)
+		gtask->gt_domain = domain;
 	mtx_lock(&qgroup->tqg_lock);
-	qid = taskqgroup_find(qgroup, uniq);
+	qid = taskqgroup_find(qgroup, uniq, gtask->gt_domain);
 	qgroup->tqg_queue[qid].tgc_cnt++;
 	LIST_INSERT_HEAD(&qgroup->tqg_queue[qid].tgc_tasks, gtask, gt_list);
 	gtask->gt_taskqueue = qgroup->tqg_queue[qid].tgc_taskq;
@@ -696,7 +752,7 @@ taskqgroup_attach_deferred(struct taskqgroup *qgroup, struct grouptask *gtask)
 	int qid, cpu, error;
 
 	mtx_lock(&qgroup->tqg_lock);
-	qid = taskqgroup_find(qgroup, gtask->gt_uniq);
+	qid = taskqgroup_find(qgroup, gtask->gt_uniq, gtask->gt_domain);
 	cpu = qgroup->tqg_queue[qid].tgc_cpu;
 	if (gtask->gt_irq != -1) {
 		mtx_unlock(&qgroup->tqg_lock);
@@ -730,6 +786,7 @@ taskqgroup_attach_cpu(struct taskqgroup *qgroup, struct grouptask *gtask,
 	snprintf(gtask->gt_name, GROUPTASK_NAMELEN, "%s", name ? name : "grouptask");
 	gtask->gt_irq = irq;
 	gtask->gt_cpu = cpu;
+	gtask->gt_domain = -1;
 	mtx_lock(&qgroup->tqg_lock);
 	if (tqg_smp_started) {
 		for (i = 0; i < qgroup->tqg_cnt; i++)
@@ -978,16 +1035,66 @@ taskqgroup_adjust(struct taskqgroup *qgroup, int cnt, int stride)
 	return (error);
 }
 
+static int
+sysctl_taskqgroup_hist(SYSCTL_HANDLER_ARGS)
+{
+	struct taskqgroup *qgroup;
+	struct taskqgroup_cpu *qcpu;
+	struct gtaskqueue *tq;
+	struct sbuf sb;
+	uint64_t hist[TQ_HIST_BUCKETS];
+	int error, i, b;
+
+	qgroup = arg1;
+	error = sysctl_wire_old_buffer(req, 0);
+	if (error != 0)
+		return (error);
+	sbuf_new_for_sysctl(&sb, NULL, 128, req);
+	sbuf_printf(&sb, "\nqueue cpu domain counts (log2 us buckets)");
+	mtx_lock(&qgroup->tqg_lock);
+	for (i = 0; i < qgroup->tqg_cnt; i++) {
+		qcpu = &qgroup->tqg_queue[i];
+		if ((tq = qcpu->tgc_taskq) == NULL)
+			continue;
+		TQ_LOCK(tq);
+		memcpy(hist, arg2 == 0 ? tq->tq_latency : tq->tq_runtime,
+		    sizeof(hist));
+		TQ_UNLOCK(tq);
+		sbuf_printf(&sb, "\n%5d %3d %6d", i, qcpu->tgc_cpu,
+		    qcpu->tgc_domain);
+		for (b = 0; b < TQ_HIST_BUCKETS; b++)
+			sbuf_printf(&sb, " %ju", (uintmax_t)hist[b]);
+	}
+	mtx_unlock(&qgroup->tqg_lock);
+	error = sbuf_finish(&sb);
+	sbuf_delete(&sb);
+	return (error);
+}
+
 struct taskqgroup *
 taskqgroup_create(const char *name)
 {
 	struct taskqgroup *qgroup;
+	struct sysctl_oid *oid;
 
 	qgroup = malloc(sizeof(*qgroup), M_GTASKQUEUE, M_WAITOK | M_ZERO);
 	mtx_init(&qgroup->tqg_lock, "taskqgroup", NULL, MTX_DEF);
 	qgroup->tqg_name = name;
 	LIST_INIT(&qgroup->tqg_queue[0].tgc_tasks);
 
+	oid = SYSCTL_ADD_NODE(NULL, SYSCTL_STATIC_CHILDREN(_kern_taskqgroup),
+	    OID_AUTO, name, CTLFLAG_RD, NULL, "");
+	if (oid != NULL) {
+		SYSCTL_ADD_PROC(NULL, SYSCTL_CHILDREN(oid), OID_AUTO,
+		    "latency", CTLTYPE_STRING | CTLFLAG_RD | CTLFLAG_MPSAFE,
+		    qgroup, 0, sysctl_taskqgroup_hist, "A",
+		    "Enqueue to run latency histogram, per queue");
+		SYSCTL_ADD_PROC(NULL, SYSCTL_CHILDREN(oid), OID_AUTO,
+		    "runtime", CTLTYPE_STRING | CTLFLAG_RD | CTLFLAG_MPSAFE,
+		    qgroup, 1, sysctl_taskqgroup_hist, "A",
+		    "Task run time histogram, per queue");
+	}
+
 	return (qgroup);
 }
 
@@ -1003,7 +1110,7 @@ taskqgroup_config_gtask_init(void *ctx, struct grouptask *gtask, gtask_fn_t *fn,
 {
 
 	GROUPTASK_INIT(gtask, 0, fn, ctx);
-	taskqgroup_attach(qgroup_config, gtask, gtask, -1, name);
+	taskqgroup_attach(qgroup_config, gtask, gtask, NULL, -1, name);
 }
 
 void
@@ -94,10 +94,16 @@ __FBSDID("$FreeBSD$");
 /*
  * Constants for the hash table of sleep queue chains.
  * SC_TABLESIZE must be a power of two for SC_MASK to work properly.
+ * Kernels built for many CPUs get a larger table, as more concurrent
+ * wakeups hash onto the same chain spin locks.
  */
 #ifndef SC_TABLESIZE
+#if MAXCPU > 64
+#define	SC_TABLESIZE	1024
+#else
 #define	SC_TABLESIZE	256
 #endif
+#endif
 CTASSERT(powerof2(SC_TABLESIZE));
 #define	SC_MASK		(SC_TABLESIZE - 1)
 #define	SC_SHIFT	8
@@ -899,12 +905,15 @@ sleepq_signal(void *wchan, int flags, int pri, int queue)
 	 * Find the highest priority thread on the queue.  If there is a
 	 * tie, use the thread that first appears in the queue as it has
 	 * been sleeping the longest since threads are always added to
-	 * the tail of sleep queues.
+	 * the tail of sleep queues.  A lone waiter, the common case for
+	 * condition variables, needs no scan.
 	 */
 	besttd = TAILQ_FIRST(&sq->sq_blocked[queue]);
-	TAILQ_FOREACH(td, &sq->sq_blocked[queue], td_slpq) {
-		if (td->td_priority < besttd->td_priority)
-			besttd = td;
+	if (sq->sq_blockedcnt[queue] > 1) {
+		TAILQ_FOREACH(td, &sq->sq_blocked[queue], td_slpq) {
+			if (td->td_priority < besttd->td_priority)
+				besttd = td;
+		}
 	}
 	MPASS(besttd != NULL);
 	thread_lock(besttd);
@@ -90,13 +90,22 @@ __FBSDID("$FreeBSD$");
 /*
  * Constants for the hash table of turnstile chains.  TC_SHIFT is a magic
  * number chosen because the sleep queue's use the same value for the
- * shift.  Basically, we ignore the lower 8 bits of the address.
+ * shift.  The low bits are folded back in as for sleep queues, so that
+ * locks embedded in neighbouring structures do not share a chain.
  * TC_TABLESIZE must be a power of two for TC_MASK to work properly.
  */
-#define	TC_TABLESIZE	128			/* Must be power of 2. */
+#ifndef TC_TABLESIZE
+#if MAXCPU > 64
+#define	TC_TABLESIZE	512
+#else
+#define	TC_TABLESIZE	128
+#endif
+#endif
+CTASSERT(powerof2(TC_TABLESIZE));
 #define	TC_MASK		(TC_TABLESIZE - 1)
 #define	TC_SHIFT	8
-#define	TC_HASH(lock)	(((uintptr_t)(lock) >> TC_SHIFT) & TC_MASK)
+#define	TC_HASH(lock)							\
+	((((uintptr_t)(lock) >> TC_SHIFT) ^ (uintptr_t)(lock)) & TC_MASK)
 #define	TC_LOOKUP(lock)	&turnstile_chains[TC_HASH(lock)]
 
 /*
@@ -137,7 +146,7 @@ struct turnstile_chain {
 	u_int	tc_depth;			/* Length of tc_queues. */
 	u_int	tc_max_depth;			/* Max length of tc_queues. */
 #endif
-};
+} __aligned(CACHE_LINE_SIZE);
 
 #ifdef TURNSTILE_PROFILING
 u_int turnstile_max_depth;
@@ -137,6 +137,8 @@ struct seltd {
 	STAILQ_HEAD(, selfd)	st_selq;	/* (k) List of selfds. */
 	struct selfd		*st_free1;	/* (k) free fd for read set. */
 	struct selfd		*st_free2;	/* (k) free fd for write set. */
+	STAILQ_HEAD(, selfd)	st_cache;	/* (k) Recycled selfds. */
+	u_int			st_ncache;	/* (k) Length of st_cache. */
 	struct mtx		st_mtx;		/* Protects struct seltd */
 	struct cv		st_wait;	/* (t) Wait channel. */
 	int			st_flags;	/* (t) SELTD_ flags. */
@@ -162,6 +164,16 @@ struct selfd {
 static uma_zone_t selfd_zone;
 static struct mtx_pool *mtxpool_select;
 
+/*
+ * Every poll() or select() call allocates one selfd per descriptor and
+ * frees it again on return.  Keep up to this many freed selfds on the
+ * thread so that repeated calls over large sets bypass the zone.
+ */
+static u_int selfd_cache_max = 128;
+SYSCTL_UINT(_kern, OID_AUTO, selfd_cache_max, CTLFLAG_RW,
+    &selfd_cache_max, 0,
+    "Number of free selfd structures cached per thread");
+
 #ifdef __LP64__
 size_t
 devfs_iosize_max(void)
@@ -280,9 +292,23 @@ sys_readv(struct thread *td, struct readv_args *uap)
 int
 kern_readv(struct thread *td, int fd, struct uio *auio)
 {
+	struct filedesc *fdp;
 	struct file *fp;
 	int error;
 
+	fdp = td->td_proc->p_fd;
+	if (FILEDESC_IS_ONLY_USER(fdp)) {
+		error = fget_only_user(fdp, fd, &cap_read_rights, &fp);
+		if (error != 0)
+			return (error);
+		if (fp->f_ops == &badfileops || (fp->f_flag & FREAD) == 0)
+			error = EBADF;
+		else
+			error = dofileread(td, fd, fp, auio, (off_t)-1, 0);
+		fput_only_user(fdp, fp);
+		return (error);
+	}
+
 	error = fget_read(td, fd, &cap_read_rights, &fp);
 	if (error)
 		return (error);
@@ -482,9 +508,23 @@ sys_writev(struct thread *td, struct writev_args *uap)
 int
 kern_writev(struct thread *td, int fd, struct uio *auio)
 {
+	struct filedesc *fdp;
 	struct file *fp;
 	int error;
 
+	fdp = td->td_proc->p_fd;
+	if (FILEDESC_IS_ONLY_USER(fdp)) {
+		error = fget_only_user(fdp, fd, &cap_write_rights, &fp);
+		if (error != 0)
+			return (error);
+		if (fp->f_ops == &badfileops || (fp->f_flag & FWRITE) == 0)
+			error = EBADF;
+		else
+			error = dofilewrite(td, fd, fp, auio, (off_t)-1, 0);
+		fput_only_user(fdp, fp);
+		return (error);
+	}
+
 	error = fget_write(td, fd, &cap_write_rights, &fp);
 	if (error)
 		return (error);
@@ -1610,6 +1650,20 @@ selsocket(struct socket *so, int events, struct timeval *tvp, struct thread *td)
  * Preallocate two selfds associated with 'cookie'.  Some fo_poll routines
  * have two select sets, one for read and another for write.
  */
+static struct selfd *
+selfdget(struct seltd *stp)
+{
+	struct selfd *sfp;
+
+	sfp = STAILQ_FIRST(&stp->st_cache);
+	if (sfp == NULL)
+		return (uma_zalloc(selfd_zone, M_WAITOK|M_ZERO));
+	STAILQ_REMOVE_HEAD(&stp->st_cache, sf_link);
+	stp->st_ncache--;
+	bzero(sfp, sizeof(*sfp));
+	return (sfp);
+}
+
 static void
 selfdalloc(struct thread *td, void *cookie)
 {
@@ -1617,11 +1671,11 @@ selfdalloc(struct thread *td, void *cookie)
 
 	stp = td->td_sel;
 	if (stp->st_free1 == NULL)
-		stp->st_free1 = uma_zalloc(selfd_zone, M_WAITOK|M_ZERO);
+		stp->st_free1 = selfdget(stp);
 	stp->st_free1->sf_td = stp;
 	stp->st_free1->sf_cookie = cookie;
 	if (stp->st_free2 == NULL)
-		stp->st_free2 = uma_zalloc(selfd_zone, M_WAITOK|M_ZERO);
+		stp->st_free2 = selfdget(stp);
 	stp->st_free2->sf_td = stp;
 	stp->st_free2->sf_cookie = cookie;
 }
@@ -1638,7 +1692,12 @@ selfdfree(struct seltd *stp, struct selfd *sfp)
 		}
 		mtx_unlock(sfp->sf_mtx);
 	}
-	if (refcount_release(&sfp->sf_refs))
+	if (!refcount_release(&sfp->sf_refs))
+		return;
+	if (stp->st_ncache < selfd_cache_max) {
+		STAILQ_INSERT_HEAD(&stp->st_cache, sfp, sf_link);
+		stp->st_ncache++;
+	} else
 		uma_zfree(selfd_zone, sfp);
 }
 
@@ -1768,6 +1827,7 @@ seltdinit(struct thread *td)
 	td->td_sel = stp = malloc(sizeof(*stp), M_SELECT, M_WAITOK|M_ZERO);
 	mtx_init(&stp->st_mtx, "sellck", NULL, MTX_DEF);
 	cv_init(&stp->st_wait, "select");
+	STAILQ_INIT(&stp->st_cache);
 out:
 	stp->st_flags = 0;
 	STAILQ_INIT(&stp->st_selq);
@@ -1809,6 +1869,7 @@ void
 seltdfini(struct thread *td)
 {
 	struct seltd *stp;
+	struct selfd *sfp;
 
 	stp = td->td_sel;
 	if (stp == NULL)
@@ -1817,6 +1878,10 @@ seltdfini(struct thread *td)
 		uma_zfree(selfd_zone, stp->st_free1);
 	if (stp->st_free2)
 		uma_zfree(selfd_zone, stp->st_free2);
+	while ((sfp = STAILQ_FIRST(&stp->st_cache)) != NULL) {
+		STAILQ_REMOVE_HEAD(&stp->st_cache, sf_link);
+		uma_zfree(selfd_zone, sfp);
+	}
 	td->td_sel = NULL;
 	cv_destroy(&stp->st_wait);
 	mtx_destroy(&stp->st_mtx);
@@ -96,6 +96,7 @@ __FBSDID("$FreeBSD$");
 
 #include <sys/param.h>
 #include <sys/systm.h>
+#include <sys/capsicum.h>
 #include <sys/conf.h>
 #include <sys/fcntl.h>
 #include <sys/file.h>
@@ -103,13 +104,17 @@ __FBSDID("$FreeBSD$");
 #include <sys/filio.h>
 #include <sys/kernel.h>
 #include <sys/lock.h>
+#include <sys/mbuf.h>
 #include <sys/mutex.h>
 #include <sys/ttycom.h>
 #include <sys/stat.h>
 #include <sys/malloc.h>
 #include <sys/poll.h>
+#include <sys/protosw.h>
 #include <sys/selinfo.h>
 #include <sys/signalvar.h>
+#include <sys/socket.h>
+#include <sys/socketvar.h>
 #include <sys/syscallsubr.h>
 #include <sys/sysctl.h>
 #include <sys/sysproto.h>
@@ -120,6 +125,8 @@ __FBSDID("$FreeBSD$");
 #include <sys/user.h>
 #include <sys/event.h>
 
+#include <net/vnet.h>
+
 #include <security/mac/mac_framework.h>
 
 #include <vm/vm.h>
@@ -156,6 +163,7 @@ static fo_close_t	pipe_close;
 static fo_chmod_t	pipe_chmod;
 static fo_chown_t	pipe_chown;
 static fo_fill_kinfo_t	pipe_fill_kinfo;
+static fo_sendfile_t	pipe_sendfile;
 
 struct fileops pipeops = {
 	.fo_read = pipe_read,
@@ -168,7 +176,7 @@ struct fileops pipeops = {
 	.fo_close = pipe_close,
 	.fo_chmod = pipe_chmod,
 	.fo_chown = pipe_chown,
-	.fo_sendfile = invfo_sendfile,
+	.fo_sendfile = pipe_sendfile,
 	.fo_fill_kinfo = pipe_fill_kinfo,
 	.fo_flags = DFLAG_PASSABLE
 };
@@ -814,6 +822,165 @@ pipe_read(struct file *fp, struct uio *uio, struct ucred *active_cred,
 	return (error);
 }
 
+/*
+ * Maximum number of mbufs, and thus pages, filled from the pipe per
+ * protocol send in pipe_sendfile().
+ */
+#define	PIPE_SENDFILE_IOV	64
+
+/*
+ * sendfile(2) from a pipe.  Data is moved from the pipe buffer, or from the
+ * wired pages of a direct write, straight into mbuf clusters that are handed
+ * to the protocol, so that it never passes through user space.  The loop
+ * follows vn_sendfile(): it waits for significant space in the socket
+ * buffer, then fills up to that much from the pipe with a single read.  A
+ * pipe has no offset, so "offset" must be 0.  With "nbytes" 0, data is sent
+ * until the pipe reaches EOF.
+ */
+static int
+pipe_sendfile(struct file *fp, int sockfd, struct uio *hdr_uio,
+    struct uio *trl_uio, off_t offset, size_t nbytes, off_t *sent, int flags,
+    struct thread *td)
+{
+	struct iovec iov[PIPE_SENDFILE_IOV];
+	struct uio auio;
+	struct file *sock_fp;
+	struct socket *so;
+	struct mbuf *m, *n;
+	off_t moved, sbytes;
+	int error, i, len, space;
+
+	if (offset != 0)
+		return (ESPIPE);
+
+	moved = sbytes = 0;
+	error = getsock_cap(td, sockfd, &cap_send_rights, &sock_fp, NULL,
+	    NULL);
+	if (error != 0)
+		goto out;
+	so = sock_fp->f_data;
+	if (so->so_type != SOCK_STREAM) {
+		error = EINVAL;
+		goto drop;
+	}
+#ifdef MAC
+	error = mac_socket_check_send(td->td_ucred, so);
+	if (error != 0)
+		goto drop;
+#endif
+
+	if (hdr_uio != NULL && hdr_uio->uio_resid > 0) {
+		error = kern_writev(td, sockfd, hdr_uio);
+		if (error != 0)
+			goto drop;
+		sbytes += td->td_retval[0];
+	}
+
+	(void)sblock(&so->so_snd, SBL_WAIT | SBL_NOINTR);
+	while (nbytes == 0 || moved < nbytes) {
+		SOCKBUF_LOCK(&so->so_snd);
+		if (so->so_snd.sb_lowat < so->so_snd.sb_hiwat / 2)
+			so->so_snd.sb_lowat = so->so_snd.sb_hiwat / 2;
+retry_space:
+		if (so->so_snd.sb_state & SBS_CANTSENDMORE) {
+			error = EPIPE;
+			SOCKBUF_UNLOCK(&so->so_snd);
+			break;
+		} else if (so->so_error) {
+			error = so->so_error;
+			so->so_error = 0;
+			SOCKBUF_UNLOCK(&so->so_snd);
+			break;
+		}
+		if ((so->so_state & SS_ISCONNECTED) == 0) {
+			SOCKBUF_UNLOCK(&so->so_snd);
+			error = ENOTCONN;
+			break;
+		}
+		space = sbspace(&so->so_snd);
+		if (space <= 0 || space < so->so_snd.sb_lowat) {
+			if (so->so_state & SS_NBIO) {
+				SOCKBUF_UNLOCK(&so->so_snd);
+				error = EAGAIN;
+				break;
+			}
+			error = sbwait(&so->so_snd);
+			if (error != 0) {
+				SOCKBUF_UNLOCK(&so->so_snd);
+				break;
+			}
+			goto retry_space;
+		}
+		SOCKBUF_UNLOCK(&so->so_snd);
+
+		len = min(space, PIPE_SENDFILE_IOV * MJUMPAGESIZE);
+		if (nbytes != 0 && len > nbytes - moved)
+			len = nbytes - moved;
+		m = m_getm2(NULL, len, M_WAITOK, MT_DATA, 0);
+		for (n = m, i = 0; n != NULL; n = n->m_next, i++) {
+			KASSERT(i < PIPE_SENDFILE_IOV,
+			    ("%s: too many mbufs for %d bytes", __func__, len));
+			iov[i].iov_base = mtod(n, void *);
+			iov[i].iov_len = M_SIZE(n);
+		}
+		auio.uio_iov = iov;
+		auio.uio_iovcnt = i;
+		auio.uio_offset = 0;
+		auio.uio_resid = len;
+		auio.uio_segflg = UIO_SYSSPACE;
+		auio.uio_rw = UIO_READ;
+		auio.uio_td = td;
+		error = pipe_read(fp, &auio, td->td_ucred, 0, td);
+		len -= auio.uio_resid;
+		if (len == 0) {
+			/* EOF, or nothing could be read. */
+			m_freem(m);
+			break;
+		}
+
+		/* Trim the chain to the data actually read. */
+		for (n = m, i = len; n != NULL; n = n->m_next) {
+			n->m_len = min(M_SIZE(n), i);
+			i -= n->m_len;
+			if (i == 0) {
+				m_freem(n->m_next);
+				n->m_next = NULL;
+			}
+		}
+
+		CURVNET_SET(so->so_vnet);
+		i = (*so->so_proto->pr_usrreqs->pru_send)(so, 0, m, NULL,
+		    NULL, td);
+		CURVNET_RESTORE();
+		if (i != 0) {
+			error = i;
+			break;
+		}
+		moved += len;
+		if (error != 0)
+			break;
+	}
+	sbunlock(&so->so_snd);
+	sbytes += moved;
+
+	if (error == 0 && trl_uio != NULL) {
+		error = kern_writev(td, sockfd, trl_uio);
+		if (error == 0)
+			sbytes += td->td_retval[0];
+	}
+drop:
+	fdrop(sock_fp, td);
+out:
+	/* td_retval[0] may have been set by writev. */
+	if (error == 0)
+		td->td_retval[0] = 0;
+	if (sent != NULL)
+		*sent = sbytes;
+	if (error == ERESTART)
+		error = EINTR;
+	return (error);
+}
+
 #ifndef PIPE_NODIRECT
 /*
  * Map the sending processes' buffer into kernel space and wire it.
@@ -570,4 +570,7 @@ const char *syscallnames[] = {
 	"cpuset_getdomain",			/* 561 = cpuset_getdomain */
 	"cpuset_setdomain",			/* 562 = cpuset_setdomain */
 	"getrandom",			/* 563 = getrandom */
+	"recvmmsg",			/* 564 = recvmmsg */
+	"sendmmsg",			/* 565 = sendmmsg */
+	"copy_file_range",			/* 566 = copy_file_range */
 };
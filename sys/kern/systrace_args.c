@@ -3266,6 +3266,39 @@ systrace_args(int sysnum, void *params, uint64_t *uarg, int *n_args)
 		*n_args = 3;
 		break;
 	}
+	/* recvmmsg */
+	case 564: {
+		struct recvmmsg_args *p = params;
+		iarg[0] = p->s; /* int */
+		uarg[1] = (intptr_t) p->msgvec; /* struct mmsghdr * */
+		uarg[2] = p->vlen; /* size_t */
+		iarg[3] = p->flags; /* int */
+		uarg[4] = (intptr_t) p->timeout; /* const struct timespec * */
+		*n_args = 5;
+		break;
+	}
+	/* sendmmsg */
+	case 565: {
+		struct sendmmsg_args *p = params;
+		iarg[0] = p->s; /* int */
+		uarg[1] = (intptr_t) p->msgvec; /* struct mmsghdr * */
+		uarg[2] = p->vlen; /* size_t */
+		iarg[3] = p->flags; /* int */
+		*n_args = 4;
+		break;
+	}
+	/* copy_file_range */
+	case 566: {
+		struct copy_file_range_args *p = params;
+		iarg[0] = p->infd; /* int */
+		uarg[1] = (intptr_t) p->inoffp; /* off_t * */
+		iarg[2] = p->outfd; /* int */
+		uarg[3] = (intptr_t) p->outoffp; /* off_t * */
+		uarg[4] = p->len; /* size_t */
+		uarg[5] = p->flags; /* unsigned int */
+		*n_args = 6;
+		break;
+	}
 	default:
 		*n_args = 0;
 		break;
@@ -8710,6 +8743,72 @@ systrace_entry_setargdesc(int sysnum, int ndx, char *desc, size_t descsz)
 			break;
 		};
 		break;
+	/* recvmmsg */
+	case 564:
+		switch(ndx) {
+		case 0:
+			p = "int";
+			break;
+		case 1:
+			p = "userland struct mmsghdr *";
+			break;
+		case 2:
+			p = "size_t";
+			break;
+		case 3:
+			p = "int";
+			break;
+		case 4:
+			p = "userland const struct timespec *";
+			break;
+		default:
+			break;
+		};
+		break;
+	/* sendmmsg */
+	case 565:
+		switch(ndx) {
+		case 0:
+			p = "int";
+			break;
+		case 1:
+			p = "userland struct mmsghdr *";
+			break;
+		case 2:
+			p = "size_t";
+			break;
+		case 3:
+			p = "int";
+			break;
+		default:
+			break;
+		};
+		break;
+	/* copy_file_range */
+	case 566:
+		switch(ndx) {
+		case 0:
+			p = "int";
+			break;
+		case 1:
+			p = "userland off_t *";
+			break;
+		case 2:
+			p = "int";
+			break;
+		case 3:
+			p = "userland off_t *";
+			break;
+		case 4:
+			p = "size_t";
+			break;
+		case 5:
+			p = "unsigned int";
+			break;
+		default:
+			break;
+		};
+		break;
 	default:
 		break;
 	};
@@ -10586,6 +10685,21 @@ systrace_return_setargdesc(int sysnum, int ndx, char *desc, size_t descsz)
 		if (ndx == 0 || ndx == 1)
 			p = "int";
 		break;
+	/* recvmmsg */
+	case 564:
+		if (ndx == 0 || ndx == 1)
+			p = "ssize_t";
+		break;
+	/* sendmmsg */
+	case 565:
+		if (ndx == 0 || ndx == 1)
+			p = "ssize_t";
+		break;
+	/* copy_file_range */
+	case 566:
+		if (ndx == 0 || ndx == 1)
+			p = "ssize_t";
+		break;
 	default:
 		break;
 	};
@@ -72,8 +72,15 @@ __FBSDID("$FreeBSD$");
 #include <security/audit/audit.h>
 #include <security/mac/mac_framework.h>
 
-static int sendit(struct thread *td, int s, struct msghdr *mp, int flags);
+static int sendit(struct thread *td, int s, struct file *fp,
+		  struct msghdr *mp, int flags);
+static int sendit_file(struct thread *td, int s, struct file *fp,
+		  struct msghdr *mp, int flags, struct mbuf *control,
+		  enum uio_seg segflg);
 static int recvit(struct thread *td, int s, struct msghdr *mp, void *namelenp);
+static int recvit_file(struct thread *td, int s, struct file *fp,
+		  struct msghdr *mp, enum uio_seg fromseg,
+		  struct mbuf **controlp);
 
 static int accept1(struct thread *td, int s, struct sockaddr *uname,
 		   socklen_t *anamelen, int flags);
@@ -667,8 +674,13 @@ sys_socketpair(struct thread *td, struct socketpair_args *uap)
 	return (error);
 }
 
+/*
+ * Copy in a destination address and control messages from userspace and
+ * hand the message to kern_sendit().  If fp is not NULL it is the
+ * already referenced socket for s and is used directly.
+ */
 static int
-sendit(struct thread *td, int s, struct msghdr *mp, int flags)
+sendit(struct thread *td, int s, struct file *fp, struct msghdr *mp, int flags)
 {
 	struct mbuf *control;
 	struct sockaddr *to;
@@ -718,7 +730,11 @@ sendit(struct thread *td, int s, struct msghdr *mp, int flags)
 		control = NULL;
 	}
 
-	error = kern_sendit(td, s, mp, flags, control, UIO_USERSPACE);
+	if (fp != NULL)
+		error = sendit_file(td, s, fp, mp, flags, control,
+		    UIO_USERSPACE);
+	else
+		error = kern_sendit(td, s, mp, flags, control, UIO_USERSPACE);
 
 bad:
 	free(to, M_SONAME);
@@ -730,27 +746,42 @@ kern_sendit(struct thread *td, int s, struct msghdr *mp, int flags,
     struct mbuf *control, enum uio_seg segflg)
 {
 	struct file *fp;
-	struct uio auio;
-	struct iovec *iov;
-	struct socket *so;
 	cap_rights_t *rights;
-#ifdef KTRACE
-	struct uio *ktruio = NULL;
-#endif
-	ssize_t len;
-	int i, error;
+	int error;
 
 	AUDIT_ARG_FD(s);
 	rights = &cap_send_rights;
-	if (mp->msg_name != NULL) {
-		AUDIT_ARG_SOCKADDR(td, AT_FDCWD, mp->msg_name);
+	if (mp->msg_name != NULL)
 		rights = &cap_send_connect_rights;
-	}
 	error = getsock_cap(td, s, rights, &fp, NULL, NULL);
 	if (error != 0) {
 		m_freem(control);
 		return (error);
 	}
+	error = sendit_file(td, s, fp, mp, flags, control, segflg);
+	fdrop(fp, td);
+	return (error);
+}
+
+/*
+ * The body of kern_sendit() once the socket has been looked up; the caller
+ * holds the file reference and has checked the capability rights.
+ */
+static int
+sendit_file(struct thread *td, int s, struct file *fp, struct msghdr *mp,
+    int flags, struct mbuf *control, enum uio_seg segflg)
+{
+	struct uio auio;
+	struct iovec *iov;
+	struct socket *so;
+#ifdef KTRACE
+	struct uio *ktruio = NULL;
+#endif
+	ssize_t len;
+	int i, error;
+
+	if (mp->msg_name != NULL)
+		AUDIT_ARG_SOCKADDR(td, AT_FDCWD, mp->msg_name);
 	so = (struct socket *)fp->f_data;
 
 #ifdef KTRACE
@@ -815,7 +846,6 @@ kern_sendit(struct thread *td, int s, struct msghdr *mp, int flags,
 	}
 #endif
 bad:
-	fdrop(fp, td);
 	return (error);
 }
 
@@ -835,7 +865,7 @@ sys_sendto(struct thread *td, struct sendto_args *uap)
 #endif
 	aiov.iov_base = uap->buf;
 	aiov.iov_len = uap->len;
-	return (sendit(td, uap->s, &msg, uap->flags));
+	return (sendit(td, uap->s, NULL, &msg, uap->flags));
 }
 
 #ifdef COMPAT_OLDSOCK
@@ -853,7 +883,7 @@ osend(struct thread *td, struct osend_args *uap)
 	aiov.iov_len = uap->len;
 	msg.msg_control = 0;
 	msg.msg_flags = 0;
-	return (sendit(td, uap->s, &msg, uap->flags));
+	return (sendit(td, uap->s, NULL, &msg, uap->flags));
 }
 
 int
@@ -871,7 +901,7 @@ osendmsg(struct thread *td, struct osendmsg_args *uap)
 		return (error);
 	msg.msg_iov = iov;
 	msg.msg_flags = MSG_COMPAT;
-	error = sendit(td, uap->s, &msg, uap->flags);
+	error = sendit(td, uap->s, NULL, &msg, uap->flags);
 	free(iov, M_IOV);
 	return (error);
 }
@@ -894,20 +924,112 @@ sys_sendmsg(struct thread *td, struct sendmsg_args *uap)
 #ifdef COMPAT_OLDSOCK
 	msg.msg_flags = 0;
 #endif
-	error = sendit(td, uap->s, &msg, uap->flags);
+	error = sendit(td, uap->s, NULL, &msg, uap->flags);
 	free(iov, M_IOV);
 	return (error);
 }
 
+/*
+ * Send a vector of messages.  The socket is looked up once for the whole
+ * vector, and again only if a message carrying a destination address needs
+ * the connect right on top of the send right.  An error after at least one
+ * message was sent is not reported; the number of messages sent so far is
+ * returned instead and the error, if persistent, is seen by the next call.
+ */
+int
+sys_sendmmsg(struct thread *td, struct sendmmsg_args *uap)
+{
+	struct mmsghdr *umsg;
+	struct msghdr msg;
+	struct iovec *iov;
+	struct file *fp;
+	cap_rights_t *rights;
+	ssize_t len;
+	size_t i, vlen;
+	int error;
+
+	AUDIT_ARG_FD(uap->s);
+	fp = NULL;
+	rights = &cap_send_rights;
+	vlen = MIN(uap->vlen, UIO_MAXIOV);
+	umsg = uap->msgvec;
+	error = 0;
+	for (i = 0; i < vlen; i++, umsg++) {
+		error = copyin(&umsg->msg_hdr, &msg, sizeof(msg));
+		if (error != 0)
+			break;
+		if (msg.msg_name != NULL && rights == &cap_send_rights) {
+			rights = &cap_send_connect_rights;
+			if (fp != NULL) {
+				fdrop(fp, td);
+				fp = NULL;
+			}
+		}
+		if (fp == NULL) {
+			error = getsock_cap(td, uap->s, rights, &fp, NULL,
+			    NULL);
+			if (error != 0) {
+				fp = NULL;
+				break;
+			}
+		}
+		error = copyiniov(msg.msg_iov, msg.msg_iovlen, &iov, EMSGSIZE);
+		if (error != 0)
+			break;
+		msg.msg_iov = iov;
+#ifdef COMPAT_OLDSOCK
+		msg.msg_flags = 0;
+#endif
+		error = sendit(td, uap->s, fp, &msg, uap->flags);
+		free(iov, M_IOV);
+		if (error != 0)
+			break;
+		len = td->td_retval[0];
+		error = copyout(&len, &umsg->msg_len, sizeof(len));
+		if (error != 0)
+			break;
+	}
+	if (fp != NULL)
+		fdrop(fp, td);
+	if (i > 0 || error == 0) {
+		td->td_retval[0] = i;
+		error = 0;
+	}
+	return (error);
+}
+
 int
 kern_recvit(struct thread *td, int s, struct msghdr *mp, enum uio_seg fromseg,
     struct mbuf **controlp)
+{
+	struct file *fp;
+	int error;
+
+	if (controlp != NULL)
+		*controlp = NULL;
+
+	AUDIT_ARG_FD(s);
+	error = getsock_cap(td, s, &cap_recv_rights,
+	    &fp, NULL, NULL);
+	if (error != 0)
+		return (error);
+	error = recvit_file(td, s, fp, mp, fromseg, controlp);
+	fdrop(fp, td);
+	return (error);
+}
+
+/*
+ * The body of kern_recvit() once the socket has been looked up; the caller
+ * holds the file reference and has checked the capability rights.
+ */
+static int
+recvit_file(struct thread *td, int s, struct file *fp, struct msghdr *mp,
+    enum uio_seg fromseg, struct mbuf **controlp)
 {
 	struct uio auio;
 	struct iovec *iov;
 	struct mbuf *control, *m;
 	caddr_t ctlbuf;
-	struct file *fp;
 	struct socket *so;
 	struct sockaddr *fromsa = NULL;
 #ifdef KTRACE
@@ -918,20 +1040,12 @@ kern_recvit(struct thread *td, int s, struct msghdr *mp, enum uio_seg fromseg,
 
 	if (controlp != NULL)
 		*controlp = NULL;
-
-	AUDIT_ARG_FD(s);
-	error = getsock_cap(td, s, &cap_recv_rights,
-	    &fp, NULL, NULL);
-	if (error != 0)
-		return (error);
 	so = fp->f_data;
 
 #ifdef MAC
 	error = mac_socket_check_receive(td->td_ucred, so);
-	if (error != 0) {
-		fdrop(fp, td);
+	if (error != 0)
 		return (error);
-	}
 #endif
 
 	auio.uio_iov = mp->msg_iov;
@@ -943,10 +1057,8 @@ kern_recvit(struct thread *td, int s, struct msghdr *mp, enum uio_seg fromseg,
 	auio.uio_resid = 0;
 	iov = mp->msg_iov;
 	for (i = 0; i < mp->msg_iovlen; i++, iov++) {
-		if ((auio.uio_resid += iov->iov_len) < 0) {
-			fdrop(fp, td);
+		if ((auio.uio_resid += iov->iov_len) < 0)
 			return (EINVAL);
-		}
 	}
 #ifdef KTRACE
 	if (KTRPOINT(td, KTR_GENIO))
@@ -1034,7 +1146,6 @@ kern_recvit(struct thread *td, int s, struct msghdr *mp, enum uio_seg fromseg,
 		}
 	}
 out:
-	fdrop(fp, td);
 #ifdef KTRACE
 	if (fromsa && KTRPOINT(td, KTR_STRUCT))
 		ktrsockaddr(fromsa);
@@ -1182,6 +1293,133 @@ sys_recvmsg(struct thread *td, struct recvmsg_args *uap)
 	return (error);
 }
 
+/*
+ * Wait for up to *tsp for data to be queued on the receive buffer of
+ * socket s.  Returns EWOULDBLOCK if the timeout expires first; an error or
+ * end of file on the socket counts as readable, so the receive that follows
+ * reports it.
+ */
+int
+kern_recvmmsg_wait(struct thread *td, int s, const struct timespec *tsp)
+{
+	struct file *fp;
+	struct socket *so;
+	struct sockbuf *sb;
+	sbintime_t sbt;
+	int error;
+
+	if (tsp->tv_sec < 0 || tsp->tv_nsec < 0 ||
+	    tsp->tv_nsec >= 1000000000)
+		return (EINVAL);
+	error = getsock_cap(td, s, &cap_recv_rights, &fp, NULL, NULL);
+	if (error != 0)
+		return (error);
+	so = fp->f_data;
+	sb = &so->so_rcv;
+	if (tsp->tv_sec > INT32_MAX / 2)
+		sbt = SBT_MAX;
+	else
+		sbt = sbinuptime() + tstosbt(*tsp);
+	SOCKBUF_LOCK(sb);
+	while (sbavail(sb) == 0 && so->so_error == 0 &&
+	    (sb->sb_state & SBS_CANTRCVMORE) == 0) {
+		if (sbt <= sbinuptime()) {
+			error = EWOULDBLOCK;
+			break;
+		}
+		sb->sb_flags |= SB_WAIT;
+		error = msleep_sbt(&sb->sb_acc, &sb->sb_mtx, PSOCK | PCATCH,
+		    "rmmsgw", sbt, 0, C_ABSOLUTE);
+		if (error != 0)
+			break;
+	}
+	SOCKBUF_UNLOCK(sb);
+	fdrop(fp, td);
+	if (error == ERESTART)
+		error = EINTR;
+	return (error);
+}
+
+/*
+ * Receive a vector of messages.  The socket is looked up and its rights
+ * checked once for the whole vector.  With a timeout the call first waits
+ * at most that long for data and returns zero if none arrives; messages are
+ * then received as by recvmsg(2), with MSG_WAITFORONE turning on
+ * MSG_DONTWAIT once the first has been received.  As for sendmmsg(2), an
+ * error after at least one message is swallowed in favour of the count.
+ */
+int
+sys_recvmmsg(struct thread *td, struct recvmmsg_args *uap)
+{
+	struct mmsghdr *umsg;
+	struct msghdr msg;
+	struct timespec ts;
+	struct iovec *uiov, *iov;
+	struct file *fp;
+	ssize_t len;
+	size_t i, vlen;
+	int error, flags;
+
+	if (uap->timeout != NULL) {
+		error = copyin(uap->timeout, &ts, sizeof(ts));
+		if (error != 0)
+			return (error);
+		error = kern_recvmmsg_wait(td, uap->s, &ts);
+		if (error == EWOULDBLOCK) {
+			td->td_retval[0] = 0;
+			return (0);
+		}
+		if (error != 0)
+			return (error);
+	}
+
+	AUDIT_ARG_FD(uap->s);
+	error = getsock_cap(td, uap->s, &cap_recv_rights, &fp, NULL, NULL);
+	if (error != 0)
+		return (error);
+	vlen = MIN(uap->vlen, UIO_MAXIOV);
+	flags = uap->flags & ~MSG_WAITFORONE;
+#ifdef COMPAT_OLDSOCK
+	flags &= ~MSG_COMPAT;
+#endif
+	umsg = uap->msgvec;
+	for (i = 0; i < vlen; i++, umsg++) {
+		error = copyin(&umsg->msg_hdr, &msg, sizeof(msg));
+		if (error != 0)
+			break;
+		error = copyiniov(msg.msg_iov, msg.msg_iovlen, &iov, EMSGSIZE);
+		if (error != 0)
+			break;
+		msg.msg_flags = flags;
+		uiov = msg.msg_iov;
+		msg.msg_iov = iov;
+		error = recvit_file(td, uap->s, fp, &msg, UIO_USERSPACE, NULL);
+		free(iov, M_IOV);
+		if (error != 0)
+			break;
+		len = td->td_retval[0];
+		msg.msg_iov = uiov;
+		error = copyout(&msg, &umsg->msg_hdr, sizeof(msg));
+		if (error == 0)
+			error = copyout(&len, &umsg->msg_len, sizeof(len));
+		if (error != 0)
+			break;
+		if (uap->flags & MSG_WAITFORONE)
+			flags |= MSG_DONTWAIT;
+		/* Out of band data, return right away. */
+		if (msg.msg_flags & MSG_OOB) {
+			i++;
+			break;
+		}
+	}
+	fdrop(fp, td);
+	if (i > 0 || error == 0) {
+		td->td_retval[0] = i;
+		error = 0;
+	}
+	return (error);
+}
+
 int
 sys_shutdown(struct thread *td, struct shutdown_args *uap)
 {
@@ -64,6 +64,7 @@ __FBSDID("$FreeBSD$");
 
 #include <sys/param.h>
 #include <sys/capsicum.h>
+#include <sys/counter.h>
 #include <sys/domain.h>
 #include <sys/fcntl.h>
 #include <sys/malloc.h>		/* XXX must be before <sys/file.h> */
@@ -81,6 +82,7 @@ __FBSDID("$FreeBSD$");
 #include <sys/queue.h>
 #include <sys/resourcevar.h>
 #include <sys/rwlock.h>
+#include <sys/sf_buf.h>
 #include <sys/socket.h>
 #include <sys/socketvar.h>
 #include <sys/signalvar.h>
@@ -101,6 +103,11 @@ __FBSDID("$FreeBSD$");
 
 #include <security/mac/mac_framework.h>
 
+#include <vm/vm.h>
+#include <vm/pmap.h>
+#include <vm/vm_extern.h>
+#include <vm/vm_map.h>
+#include <vm/vm_page.h>
 #include <vm/uma.h>
 
 MALLOC_DECLARE(M_FILECAPS);
@@ -162,6 +169,7 @@ static u_long	unpdg_sendspace = 2*1024;	/* really max datagram size */
 static u_long	unpdg_recvspace = 4*1024;
 static u_long	unpsp_sendspace = PIPSIZ;	/* really max datagram size */
 static u_long	unpsp_recvspace = PIPSIZ;
+static u_long	unpst_loanmin = 0;		/* loaning disabled */
 
 static SYSCTL_NODE(_net, PF_LOCAL, local, CTLFLAG_RW, 0, "Local domain");
 static SYSCTL_NODE(_net_local, SOCK_STREAM, stream, CTLFLAG_RW, 0,
@@ -174,6 +182,12 @@ SYSCTL_ULONG(_net_local_stream, OID_AUTO, sendspace, CTLFLAG_RW,
 	   &unpst_sendspace, 0, "Default stream send space.");
 SYSCTL_ULONG(_net_local_stream, OID_AUTO, recvspace, CTLFLAG_RW,
 	   &unpst_recvspace, 0, "Default stream receive space.");
+SYSCTL_ULONG(_net_local_stream, OID_AUTO, loanmin, CTLFLAG_RWTUN,
+	   &unpst_loanmin, 0,
+	   "Minimum stream write size to loan user pages to the peer (0 off)");
+static counter_u64_t unpst_loaned;
+SYSCTL_COUNTER_U64(_net_local_stream, OID_AUTO, loaned, CTLFLAG_RD,
+	   &unpst_loaned, "Bytes written by loaning user pages");
 SYSCTL_ULONG(_net_local_dgram, OID_AUTO, maxdgram, CTLFLAG_RW,
 	   &unpdg_sendspace, 0, "Default datagram send space.");
 SYSCTL_ULONG(_net_local_dgram, OID_AUTO, recvspace, CTLFLAG_RW,
@@ -1346,6 +1360,280 @@ uipc_sockaddr(struct socket *so, struct sockaddr **nam)
 	return (0);
 }
 
+/*
+ * Large writes to a connected SOCK_STREAM socket can loan the pages of the
+ * user buffer to the receive buffer of the peer instead of copying them
+ * into mbuf clusters, much like pipe_direct_write() does for pipes.  The
+ * data is then copied only once, by the receiver.  The writer keeps the
+ * pages held and waits until every loaned mbuf has been freed; if it is
+ * interrupted first, the data still queued is copied into kernel memory
+ * so that the write can return.
+ */
+#define	UNP_LOAN_NPAGES	(65536 / PAGE_SIZE + 1)
+
+struct unp_loan {
+	u_int		 ul_refs;	/* loaned pages not yet freed */
+	struct socket	*ul_so;		/* receiving socket, referenced */
+};
+
+static void
+unp_loan_release(struct unp_loan *ul, struct sf_buf *sf)
+{
+	struct mtx *mtx;
+	vm_page_t pg;
+
+	pg = sf_buf_page(sf);
+	sf_buf_free(sf);
+	vm_page_unhold_pages(&pg, 1);
+
+	mtx = mtx_pool_find(mtxpool_sleep, ul);
+	mtx_lock(mtx);
+	KASSERT(ul->ul_refs > 0, ("%s: loan %p has no refs", __func__, ul));
+	if (--ul->ul_refs == 0)
+		wakeup(ul);
+	mtx_unlock(mtx);
+}
+
+static void
+unp_loan_free(struct mbuf *m)
+{
+
+	unp_loan_release(m->m_ext.ext_arg2, m->m_ext.ext_arg1);
+}
+
+static void
+unp_loan_copy_free(struct mbuf *m)
+{
+
+	free(m->m_ext.ext_buf, M_TEMP);
+}
+
+static struct mbuf *
+unp_loan_mbufs(struct unp_loan *ul, vm_page_t *ma, int npages, int off,
+    int len)
+{
+	struct mbuf *m, *top, **mp;
+	struct sf_buf *sf;
+	int i;
+
+	top = NULL;
+	mp = &top;
+	for (i = 0; i < npages; i++) {
+		sf = sf_buf_alloc(ma[i], 0);
+		m = m_get(M_WAITOK, MT_DATA);
+		m->m_ext.ext_buf = (char *)sf_buf_kva(sf);
+		m->m_ext.ext_size = PAGE_SIZE;
+		m->m_ext.ext_arg1 = sf;
+		m->m_ext.ext_arg2 = ul;
+		m->m_ext.ext_type = EXT_SFBUF;
+		m->m_ext.ext_flags = EXT_FLAG_EMBREF;
+		m->m_ext.ext_free = unp_loan_free;
+		m->m_ext.ext_count = 1;
+		m->m_flags |= M_EXT | M_RDONLY;
+		m->m_data = m->m_ext.ext_buf + off;
+		m->m_len = min(len, PAGE_SIZE - off);
+		len -= m->m_len;
+		off = 0;
+		*mp = m;
+		mp = &m->m_next;
+	}
+	return (top);
+}
+
+/*
+ * Replace the loaned pages still queued on the receiving socket with
+ * private copies.  The sblock keeps receivers from consuming, and thus
+ * freeing, the mbufs while the socket buffer is unlocked; loaned mbufs
+ * are read-only, so appends never touch them either.
+ */
+static void
+unp_loan_clone(struct unp_loan *ul)
+{
+	struct sockbuf *sb;
+	struct sf_buf *sf;
+	struct mbuf *m, *n;
+	char *buf;
+
+	sb = &ul->ul_so->so_rcv;
+	(void)sblock(sb, SBL_WAIT | SBL_NOINTR);
+	SOCKBUF_LOCK(sb);
+	for (m = sb->sb_mb; m != NULL; m = m->m_nextpkt) {
+		for (n = m; n != NULL; n = n->m_next) {
+			if ((n->m_flags & M_EXT) == 0 ||
+			    n->m_ext.ext_free != unp_loan_free ||
+			    n->m_ext.ext_arg2 != ul)
+				continue;
+			SOCKBUF_UNLOCK(sb);
+			buf = malloc(n->m_len, M_TEMP, M_WAITOK);
+			bcopy(mtod(n, char *), buf, n->m_len);
+			sf = n->m_ext.ext_arg1;
+			/* ext_size stays as accounted for in sb_mbcnt. */
+			n->m_ext.ext_buf = buf;
+			n->m_ext.ext_arg1 = n->m_ext.ext_arg2 = NULL;
+			n->m_ext.ext_type = EXT_MOD_TYPE;
+			n->m_ext.ext_free = unp_loan_copy_free;
+			n->m_data = buf;
+			unp_loan_release(ul, sf);
+			SOCKBUF_LOCK(sb);
+		}
+	}
+	SOCKBUF_UNLOCK(sb);
+	sbunlock(sb);
+}
+
+/*
+ * Wait for the peer to consume the loaned pages.  If it has not done so
+ * within a short while, or the wait is interrupted, the rest is copied
+ * instead: the peer may itself be blocked writing to us.
+ */
+static void
+unp_loan_wait(struct unp_loan *ul)
+{
+	struct mtx *mtx;
+	int error;
+
+	mtx = mtx_pool_find(mtxpool_sleep, ul);
+	mtx_lock(mtx);
+	while (ul->ul_refs > 0) {
+		error = msleep(ul, mtx, PSOCK | PCATCH, "unplon",
+		    max(1, hz / 10));
+		if (error == 0 || ul->ul_refs == 0)
+			continue;
+		mtx_unlock(mtx);
+		unp_loan_clone(ul);
+		mtx_lock(mtx);
+		/*
+		 * Whatever is left was already taken off the socket
+		 * buffer by an in-kernel consumer; it is released as
+		 * soon as that consumer is done with it.
+		 */
+		while (ul->ul_refs > 0)
+			msleep(ul, mtx, PSOCK, "unplon", 0);
+	}
+	mtx_unlock(mtx);
+}
+
+static int
+uipc_sosend_stream(struct socket *so, struct sockaddr *addr, struct uio *uio,
+    struct mbuf *top, struct mbuf *control, int flags, struct thread *td)
+{
+	vm_page_t ma[UNP_LOAN_NPAGES];
+	struct unp_loan ul;
+	struct unpcb *unp, *unp2;
+	struct socket *so2;
+	struct iovec *iov;
+	struct mbuf *m;
+	vm_offset_t va;
+	u_long loanmin;
+	long space;
+	int error, len, npages, off;
+
+	loanmin = unpst_loanmin;
+	if (loanmin == 0 || uio == NULL || uio->uio_segflg != UIO_USERSPACE ||
+	    (u_long)uio->uio_resid < loanmin || top != NULL || control != NULL ||
+	    addr != NULL || (flags & (MSG_OOB | MSG_EOF | MSG_EOR)) != 0 ||
+	    (so->so_state & SS_NBIO) != 0 ||
+	    (flags & (MSG_DONTWAIT | MSG_NBIO)) != 0)
+		return (sosend_generic(so, addr, uio, top, control, flags,
+		    td));
+
+	unp = sotounpcb(so);
+	KASSERT(unp != NULL, ("%s: unp == NULL", __func__));
+
+	error = sblock(&so->so_snd, SBLOCKWAIT(flags));
+	if (error)
+		return (error);
+	while ((u_long)uio->uio_resid >= loanmin) {
+		iov = uio->uio_iov;
+		if (iov->iov_len == 0) {
+			uio->uio_iov++;
+			uio->uio_iovcnt--;
+			continue;
+		}
+		SOCKBUF_LOCK(&so->so_snd);
+		if (so->so_snd.sb_state & SBS_CANTSENDMORE) {
+			SOCKBUF_UNLOCK(&so->so_snd);
+			error = EPIPE;
+			break;
+		}
+		if (so->so_error) {
+			error = so->so_error;
+			so->so_error = 0;
+			SOCKBUF_UNLOCK(&so->so_snd);
+			break;
+		}
+		if ((so->so_state & SS_ISCONNECTED) == 0) {
+			SOCKBUF_UNLOCK(&so->so_snd);
+			error = ENOTCONN;
+			break;
+		}
+		space = sbspace(&so->so_snd);
+		if (space < (long)iov->iov_len && space < so->so_snd.sb_lowat) {
+			if ((so->so_state & SS_NBIO) || (flags & MSG_NBIO)) {
+				SOCKBUF_UNLOCK(&so->so_snd);
+				error = EWOULDBLOCK;
+				break;
+			}
+			error = sbwait(&so->so_snd);
+			SOCKBUF_UNLOCK(&so->so_snd);
+			if (error)
+				break;
+			continue;
+		}
+		SOCKBUF_UNLOCK(&so->so_snd);
+
+		va = (vm_offset_t)iov->iov_base;
+		off = va & PAGE_MASK;
+		len = MIN(iov->iov_len, (u_long)space);
+		len = MIN(len, UNP_LOAN_NPAGES * PAGE_SIZE - off);
+		npages = vm_fault_quick_hold_pages(&curproc->p_vmspace->vm_map,
+		    va, len, VM_PROT_READ, ma, nitems(ma));
+		if (npages < 0) {
+			error = EFAULT;
+			break;
+		}
+
+		UNP_PCB_LOCK(unp);
+		unp2 = unp->unp_conn;
+		so2 = unp2 != NULL ? unp2->unp_socket : NULL;
+		if (so2 != NULL)
+			soref(so2);
+		UNP_PCB_UNLOCK(unp);
+		if (so2 == NULL) {
+			vm_page_unhold_pages(ma, npages);
+			error = ENOTCONN;
+			break;
+		}
+
+		ul.ul_refs = npages;
+		ul.ul_so = so2;
+		m = unp_loan_mbufs(&ul, ma, npages, off, len);
+		error = (*so->so_proto->pr_usrreqs->pru_send)(so,
+		    uio->uio_resid > len ? PRUS_MORETOCOME : 0, m, NULL, NULL,
+		    td);
+		unp_loan_wait(&ul);
+		SOCK_LOCK(so2);
+		sorele(so2);
+		if (error)
+			break;
+		counter_u64_add(unpst_loaned, len);
+
+		iov->iov_base = (char *)iov->iov_base + len;
+		iov->iov_len -= len;
+		uio->uio_resid -= len;
+		uio->uio_offset += len;
+	}
+	sbunlock(&so->so_snd);
+
+	/* Copy the tail, too short to be worth loaning. */
+	if (error == 0 && uio->uio_resid > 0)
+		return (sosend_generic(so, addr, uio, top, control, flags,
+		    td));
+	if (td != NULL)
+		td->td_ru.ru_msgsnd++;
+	return (error);
+}
+
 static struct pr_usrreqs uipc_usrreqs_dgram = {
 	.pru_abort = 		uipc_abort,
 	.pru_accept =		uipc_accept,
@@ -1409,6 +1697,7 @@ static struct pr_usrreqs uipc_usrreqs_stream = {
 	.pru_sense =		uipc_sense,
 	.pru_shutdown =		uipc_shutdown,
 	.pru_sockaddr =		uipc_sockaddr,
+	.pru_sosend =		uipc_sosend_stream,
 	.pru_soreceive =	soreceive_generic,
 	.pru_close =		uipc_close,
 };
@@ -2111,6 +2400,7 @@ unp_init(void)
 		panic("unp_init");
 	uma_zone_set_max(unp_zone, maxsockets);
 	uma_zone_set_warning(unp_zone, "kern.ipc.maxsockets limit reached");
+	unpst_loaned = counter_u64_alloc(M_WAITOK);
 	EVENTHANDLER_REGISTER(maxsockets_change, unp_zone_change,
 	    NULL, EVENTHANDLER_PRI_ANY);
 	LIST_INIT(&unp_dhead);
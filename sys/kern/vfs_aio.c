@@ -80,11 +80,6 @@ __FBSDID("$FreeBSD$");
  */
 static u_long jobrefid;
 
-/*
- * Counter for aio_fsync.
- */
-static uint64_t jobseqno;
-
 #ifndef MAX_AIO_PER_PROC
 #define MAX_AIO_PER_PROC	32
 #endif
@@ -268,7 +263,8 @@ struct kaioinfo {
 	int	kaio_flags;		/* (a) per process kaio flags */
 	int	kaio_active_count;	/* (c) number of currently used AIOs */
 	int	kaio_count;		/* (a) size of AIO queue */
-	int	kaio_buffer_count;	/* (a) number of physio buffers */
+	u_int	kaio_buffer_count;	/* (*) number of physio buffers */
+	uint64_t kaio_seqno;		/* (a) job counter for aio_fsync */
 	TAILQ_HEAD(,kaiocb) kaio_all;	/* (a) all AIOs in a process */
 	TAILQ_HEAD(,kaiocb) kaio_done;	/* (a) done queue for process */
 	TAILQ_HEAD(,aioliojob) kaio_liojoblist; /* (a) list of lio jobs */
@@ -443,6 +439,7 @@ aio_init_aioinfo(struct proc *p)
 	ki->kaio_active_count = 0;
 	ki->kaio_count = 0;
 	ki->kaio_buffer_count = 0;
+	ki->kaio_seqno = 0;
 	TAILQ_INIT(&ki->kaio_all);
 	TAILQ_INIT(&ki->kaio_done);
 	TAILQ_INIT(&ki->kaio_jobqueue);
@@ -1262,16 +1259,15 @@ aio_qphysio(struct proc *p, struct kaiocb *job)
 			error = -1;
 			goto unref;
 		}
-		if (ki->kaio_buffer_count >= max_buf_aio) {
+		if (atomic_fetchadd_int(&ki->kaio_buffer_count, 1) >=
+		    max_buf_aio) {
+			atomic_subtract_int(&ki->kaio_buffer_count, 1);
 			error = EAGAIN;
 			goto unref;
 		}
 
 		job->pbuf = pbuf = (struct buf *)getpbuf(NULL);
 		BUF_KERNPROC(pbuf);
-		AIO_LOCK(ki);
-		ki->kaio_buffer_count++;
-		AIO_UNLOCK(ki);
 	}
 	job->bp = bp = g_alloc_bio();
 
@@ -1315,9 +1311,7 @@ aio_qphysio(struct proc *p, struct kaiocb *job)
 
 doerror:
 	if (pbuf != NULL) {
-		AIO_LOCK(ki);
-		ki->kaio_buffer_count--;
-		AIO_UNLOCK(ki);
+		atomic_subtract_int(&ki->kaio_buffer_count, 1);
 		relpbuf(pbuf, NULL);
 		job->pbuf = NULL;
 	}
@@ -1564,10 +1558,14 @@ aio_aqueue(struct thread *td, struct aiocb *ujob, struct aioliojob *lj,
 
 	job->fd_file = fp;
 
-	mtx_lock(&aio_job_mtx);
-	jid = jobrefid++;
-	job->seqno = jobseqno++;
-	mtx_unlock(&aio_job_mtx);
+	/*
+	 * The sequence number only orders aio_fsync() against the jobs
+	 * of the same process, so it does not need a global counter.
+	 */
+	jid = atomic_fetchadd_long(&jobrefid, 1);
+	AIO_LOCK(ki);
+	job->seqno = ki->kaio_seqno++;
+	AIO_UNLOCK(ki);
 	error = ops->store_kernelinfo(ujob, jid);
 	if (error) {
 		error = EINVAL;
@@ -2345,9 +2343,7 @@ aio_physwakeup(struct bio *bp)
 		relpbuf(job->pbuf, NULL);
 		job->pbuf = NULL;
 		atomic_subtract_int(&num_buf_aio, 1);
-		AIO_LOCK(ki);
-		ki->kaio_buffer_count--;
-		AIO_UNLOCK(ki);
+		atomic_subtract_int(&ki->kaio_buffer_count, 1);
 	} else
 		atomic_subtract_int(&num_unmapped_aio, 1);
 	vm_page_unhold_pages(job->pages, job->npages);
@@ -145,6 +145,7 @@ struct bufdomain {
 #define	BD_RUN_LOCK(bd)		mtx_lock(BD_RUN_LOCKPTR((bd)))
 #define	BD_RUN_UNLOCK(bd)	mtx_unlock(BD_RUN_LOCKPTR((bd)))
 #define	BD_DOMAIN(bd)		(bd - bdomain)
+#define	BD_VMDOMAIN(bd)		(BD_DOMAIN(bd) % vm_ndomains)
 
 static struct buf *buf;		/* buffer header pool */
 extern struct buf *swbuf;	/* Swap buffer header pool. */
@@ -307,6 +308,26 @@ SYSCTL_INT(_vfs, OID_AUTO, flushbufqtarget, CTLFLAG_RW, &flushbufqtarget, 0,
 static counter_u64_t notbufdflushes;
 SYSCTL_COUNTER_U64(_vfs, OID_AUTO, notbufdflushes, CTLFLAG_RD, &notbufdflushes,
     "Number of dirty buffer flushes done by the bufdaemon helpers");
+static SYSCTL_NODE(_vfs, OID_AUTO, bufstats, CTLFLAG_RD, 0,
+    "Buffer cache statistics");
+static counter_u64_t bufspace_waits;
+SYSCTL_COUNTER_U64(_vfs_bufstats, OID_AUTO, bufspace_waits, CTLFLAG_RD,
+    &bufspace_waits, "Number of sleeps waiting for buffer space");
+static counter_u64_t recycle_calls;
+SYSCTL_COUNTER_U64(_vfs_bufstats, OID_AUTO, recycle_calls, CTLFLAG_RD,
+    &recycle_calls, "Number of clean queue scans by buf_recycle");
+static counter_u64_t recycle_scanned;
+SYSCTL_COUNTER_U64(_vfs_bufstats, OID_AUTO, recycle_scanned, CTLFLAG_RD,
+    &recycle_scanned, "Number of buffers examined by buf_recycle");
+static counter_u64_t recycle_fails;
+SYSCTL_COUNTER_U64(_vfs_bufstats, OID_AUTO, recycle_fails, CTLFLAG_RD,
+    &recycle_fails, "Number of buf_recycle scans that found no buffer");
+static u_long recycle_scan_max;
+SYSCTL_ULONG(_vfs_bufstats, OID_AUTO, recycle_scan_max, CTLFLAG_RW,
+    &recycle_scan_max, 0, "Longest buf_recycle scan");
+static counter_u64_t domain_allocs;
+SYSCTL_COUNTER_U64(_vfs_bufstats, OID_AUTO, domain_allocs, CTLFLAG_RD,
+    &domain_allocs, "Number of malloced buffer pages from the local domain");
 static long barrierwrites;
 SYSCTL_LONG(_vfs, OID_AUTO, barrierwrites, CTLFLAG_RW, &barrierwrites, 0,
     "Number of barrier writes");
@@ -770,6 +791,7 @@ bufspace_wait(struct bufdomain *bd, struct vnode *vp, int gbflags,
 			if (bd->bd_wanted == 0)
 				break;
 		}
+		counter_u64_add(bufspace_waits, 1);
 		error = msleep(&bd->bd_wanted, BD_LOCKPTR(bd),
 		    (PRIBIO + 4) | slpflag, "newbuf", slptimeo);
 		if (error != 0)
@@ -1259,9 +1281,14 @@ bufinit(void)
 	/*
 	 * Size the clean queue according to the amount of buffer space.
 	 * One queue per-256mb up to the max.  More queues gives better
-	 * concurrency but less accurate LRU.
+	 * concurrency but less accurate LRU.  On NUMA machines use a
+	 * multiple of the number of memory domains so that every memory
+	 * domain owns the same number of buffer domains, see BD_VMDOMAIN().
 	 */
 	buf_domains = MIN(howmany(maxbufspace, 256*1024*1024), BUF_DOMAINS);
+	if (vm_ndomains > 1 && vm_ndomains <= BUF_DOMAINS)
+		buf_domains = MAX(rounddown(buf_domains, vm_ndomains),
+		    vm_ndomains);
 	for (i = 0 ; i < buf_domains; i++) {
 		struct bufdomain *bd;
 
@@ -1290,6 +1317,11 @@ bufinit(void)
 	buffreekvacnt = counter_u64_alloc(M_WAITOK);
 	bufdefragcnt = counter_u64_alloc(M_WAITOK);
 	bufkvaspace = counter_u64_alloc(M_WAITOK);
+	bufspace_waits = counter_u64_alloc(M_WAITOK);
+	recycle_calls = counter_u64_alloc(M_WAITOK);
+	recycle_scanned = counter_u64_alloc(M_WAITOK);
+	recycle_fails = counter_u64_alloc(M_WAITOK);
+	domain_allocs = counter_u64_alloc(M_WAITOK);
 }
 
 #ifdef INVARIANTS
@@ -1705,6 +1737,18 @@ buf_alloc(struct bufdomain *bd)
 	return (bp);
 }
 
+static void
+buf_recycle_stat(u_long scanned)
+{
+	u_long old;
+
+	counter_u64_add(recycle_scanned, scanned);
+	old = recycle_scan_max;
+	while (scanned > old &&
+	    !atomic_fcmpset_long(&recycle_scan_max, &old, scanned))
+		;
+}
+
 /*
  *	buf_recycle:
  *
@@ -1717,9 +1761,12 @@ buf_recycle(struct bufdomain *bd, bool kva)
 {
 	struct bufqueue *bq;
 	struct buf *bp, *nbp;
+	u_long scanned;
 
 	if (kva)
 		counter_u64_add(bufdefragcnt, 1);
+	counter_u64_add(recycle_calls, 1);
+	scanned = 0;
 	nbp = NULL;
 	bq = bd->bd_cleanq;
 	BQ_LOCK(bq);
@@ -1737,6 +1784,7 @@ buf_recycle(struct bufdomain *bd, bool kva)
 		 * release the bqlock).
 		 */
 		nbp = TAILQ_NEXT(bp, b_freelist);
+		scanned++;
 
 		/*
 		 * If we are defragging then we need a buffer with 
@@ -1793,10 +1841,13 @@ buf_recycle(struct bufdomain *bd, bool kva)
 		}
 		bp->b_flags |= B_INVAL;
 		brelse(bp);
+		buf_recycle_stat(scanned);
 		return (0);
 	}
 	bd->bd_wanted = 1;
 	BQ_UNLOCK(bq);
+	buf_recycle_stat(scanned);
+	counter_u64_add(recycle_fails, 1);
 
 	return (ENOBUFS);
 }
@@ -4886,13 +4937,14 @@ vm_hold_load_pages(struct buf *bp, vm_offset_t from, vm_offset_t to)
 {
 	vm_offset_t pg;
 	vm_page_t p;
-	int index;
+	int domain, index;
 
 	BUF_CHECK_MAPPED(bp);
 
 	to = round_page(to);
 	from = round_page(from);
 	index = (from - trunc_page((vm_offset_t)bp->b_data)) >> PAGE_SHIFT;
+	domain = BD_VMDOMAIN(bufdomain(bp));
 
 	for (pg = from; pg < to; pg += PAGE_SIZE, index++) {
 		/*
@@ -4900,9 +4952,16 @@ vm_hold_load_pages(struct buf *bp, vm_offset_t from, vm_offset_t to)
 		 * could interfere with paging I/O, no matter which
 		 * process we are.
 		 */
-		p = vm_page_alloc(NULL, 0, VM_ALLOC_SYSTEM | VM_ALLOC_NOOBJ |
-		    VM_ALLOC_WIRED | VM_ALLOC_COUNT((to - pg) >> PAGE_SHIFT) |
-		    VM_ALLOC_WAITOK);
+		p = vm_page_alloc_domain(NULL, 0, domain, VM_ALLOC_SYSTEM |
+		    VM_ALLOC_NOOBJ | VM_ALLOC_WIRED |
+		    VM_ALLOC_COUNT((to - pg) >> PAGE_SHIFT));
+		if (p != NULL)
+			counter_u64_add(domain_allocs, 1);
+		else
+			p = vm_page_alloc(NULL, 0, VM_ALLOC_SYSTEM |
+			    VM_ALLOC_NOOBJ | VM_ALLOC_WIRED |
+			    VM_ALLOC_COUNT((to - pg) >> PAGE_SHIFT) |
+			    VM_ALLOC_WAITOK);
 		pmap_qenter(pg, &p, 1);
 		bp->b_pages[index] = p;
 	}
@@ -5042,10 +5101,19 @@ bufstrategy(struct bufobj *bo, struct buf *bp)
 void
 bufobj_init(struct bufobj *bo, void *private)
 {
-	static volatile int bufobj_cleanq;
+	static volatile u_int bufobj_cleanq;
+	u_int n;
 
-        bo->bo_domain =
-            atomic_fetchadd_int(&bufobj_cleanq, 1) % buf_domains;
+	/*
+	 * Prefer the buffer domains backed by the memory domain of the
+	 * current CPU, see bufinit().
+	 */
+	n = atomic_fetchadd_int(&bufobj_cleanq, 1);
+	if (vm_ndomains > 1 && buf_domains % vm_ndomains == 0)
+		bo->bo_domain = (n % (buf_domains / vm_ndomains)) *
+		    vm_ndomains + PCPU_GET(domain);
+	else
+		bo->bo_domain = n % buf_domains;
         rw_init(BO_LOCKPTR(bo), "bufobj interlock");
         bo->bo_private = private;
         TAILQ_INIT(&bo->bo_clean.bv_hd);
@@ -43,6 +43,7 @@ __FBSDID("$FreeBSD$");
 #include <sys/param.h>
 #include <sys/systm.h>
 #include <sys/counter.h>
+#include <sys/epoch.h>
 #include <sys/filedesc.h>
 #include <sys/fnv_hash.h>
 #include <sys/kernel.h>
@@ -52,12 +53,15 @@ __FBSDID("$FreeBSD$");
 #include <sys/mount.h>
 #include <sys/namei.h>
 #include <sys/proc.h>
+#include <sys/refcount.h>
 #include <sys/rwlock.h>
+#include <sys/sbuf.h>
 #include <sys/sdt.h>
 #include <sys/smp.h>
 #include <sys/syscallsubr.h>
 #include <sys/sysctl.h>
 #include <sys/sysproto.h>
+#include <sys/taskqueue.h>
 #include <sys/vnode.h>
 #ifdef KTRACE
 #include <sys/ktrace.h>
@@ -112,6 +116,7 @@ struct	namecache {
 	} n_un;
 	u_char	nc_flag;		/* flag bits */
 	u_char	nc_nlen;		/* length of name */
+	u_char	nc_neglist;		/* negative list index */
 	char	nc_name[0];		/* segment name + nul */
 };
 
@@ -166,8 +171,8 @@ struct	namecache_ts {
  * bucketlock	rwlock	for access to given set of hash buckets
  * neglist	mtx	negative entry LRU management
  *
- * Additionally, ncneg_shrink_lock mtx is used to have at most one thread
- * shrinking the LRU list.
+ * Negative entries are only shrunk from a single task, so there is at most
+ * one thread shrinking the LRU lists.
  *
  * It is legal to take multiple vnodelock and bucketlock locks. The locking
  * order is lower address first. Both are recursive.
@@ -177,6 +182,11 @@ struct	namecache_ts {
  * ".." and vnode -> name lookups require vnodelock.
  *
  * name -> vnode lookup requires the relevant bucketlock to be held for reading.
+ * The exception is a positive hit without timestamps, which is looked up
+ * within global_epoch without taking the bucketlock.  Entries are immutable
+ * once inserted and both namecache entries and vnodes are freed only after
+ * an epoch grace period, so the reader may safely walk the chain and try to
+ * grab a hold on the vnode.  Anything else falls back to the locked path.
  *
  * Insertions and removals of entries require involved vnodes and bucketlocks
  * to be write-locked to prevent other threads from seeing the entry.
@@ -219,30 +229,29 @@ SYSCTL_UINT(_vfs, OID_AUTO, ncsizefactor, CTLFLAG_RW, &ncsizefactor, 0,
 static u_int __read_mostly	ncpurgeminvnodes;
 SYSCTL_UINT(_vfs, OID_AUTO, ncpurgeminvnodes, CTLFLAG_RW, &ncpurgeminvnodes, 0,
     "Number of vnodes below which purgevfs ignores the request");
-static u_int __read_mostly	ncneghitsrequeue = 8;
-SYSCTL_UINT(_vfs, OID_AUTO, ncneghitsrequeue, CTLFLAG_RW, &ncneghitsrequeue, 0,
-    "Number of hits to requeue a negative entry in the LRU list");
 
 struct nchstats	nchstats;		/* cache effectiveness statistics */
 
-static struct mtx       ncneg_shrink_lock;
-static int	shrink_list_turn;
+static struct task	ncneg_shrink_task;
+static int	ncneg_shrinking;
+static u_int	shrink_list_turn;
 
 struct neglist {
 	struct mtx		nl_lock;
 	TAILQ_HEAD(, namecache) nl_list;
+	u_int			nl_count;
 } __aligned(CACHE_LINE_SIZE);
 
 static struct neglist __read_mostly	*neglists;
-static struct neglist ncneg_hot;
 
-#define	numneglists (ncneghash + 1)
-static u_int __read_mostly	ncneghash;
+/* One list per CPU, bounded by the width of nc_neglist. */
+#define	NCNEGLISTS_MAX	(1 << (NBBY * sizeof(u_char)))
+static u_int __read_mostly	numneglists;
 static inline struct neglist *
 NCP2NEGLIST(struct namecache *ncp)
 {
 
-	return (&neglists[(((uintptr_t)(ncp) >> 8) & ncneghash)]);
+	return (&neglists[ncp->nc_neglist]);
 }
 
 #define	numbucketlocks (ncbuckethash + 1)
@@ -296,15 +305,21 @@ cache_alloc(int len, int ts)
 	return (ncp);
 }
 
+/*
+ * Lockless lookups may still be walking the entry, so the memory is returned
+ * to the zone only after an epoch grace period.  nc_dst is no longer used
+ * once the entry is zapped and doubles as the epoch context.
+ */
+CTASSERT(sizeof(((struct namecache *)0)->nc_dst) >=
+    sizeof(struct epoch_context));
+
 static void
-cache_free(struct namecache *ncp)
+cache_free_deferred(epoch_context_t ctx)
 {
+	struct namecache *ncp;
 	struct namecache_ts *ncp_ts;
 
-	if (ncp == NULL)
-		return;
-	if ((ncp->nc_flag & NCF_DVDROP) != 0)
-		vdrop(ncp->nc_dvp);
+	ncp = __containerof((void *)ctx, struct namecache, nc_dst);
 	if (__predict_false(ncp->nc_flag & NCF_TS)) {
 		ncp_ts = __containerof(ncp, struct namecache_ts, nc_nc);
 		if (ncp->nc_nlen <= CACHE_PATH_CUTOFF)
@@ -319,6 +334,18 @@ cache_free(struct namecache *ncp)
 	}
 }
 
+static void
+cache_free(struct namecache *ncp)
+{
+
+	if (ncp == NULL)
+		return;
+	if ((ncp->nc_flag & NCF_DVDROP) != 0)
+		vdrop(ncp->nc_dvp);
+	epoch_call(global_epoch, (epoch_context_t)&ncp->nc_dst,
+	    cache_free_deferred);
+}
+
 static void
 cache_out_ts(struct namecache *ncp, struct timespec *tsp, int *ticksp)
 {
@@ -367,6 +394,7 @@ STATNODE_COUNTER(nummisszap, "Number of cache misses we do not want to cache");
 STATNODE_COUNTER(numposzaps,
     "Number of cache hits (positive) we do not want to cache");
 STATNODE_COUNTER(numposhits, "Number of cache hits (positive)");
+STATNODE_COUNTER(numlockless, "Number of positive hits found locklessly");
 STATNODE_COUNTER(numnegzaps,
     "Number of cache hits (negative) we do not want to cache");
 STATNODE_COUNTER(numneghits, "Number of cache hits (negative)");
@@ -389,6 +417,76 @@ static int vn_fullpath1(struct thread *td, struct vnode *vp, struct vnode *rdir,
 
 static MALLOC_DEFINE(M_VFSCACHE, "vfscache", "VFS name cache entries");
 
+static int __read_mostly cache_lockless = 1;
+SYSCTL_INT(_vfs_cache, OID_AUTO, lockless, CTLFLAG_RWTUN, &cache_lockless, 0,
+    "Look up positive entries without taking the bucket lock");
+static int cache_resizing;
+
+/*
+ * Per-mount tally of lookups, see vfs.cache.mount_stats.
+ */
+#define	NCMNT_HIT	0
+#define	NCMNT_NEGHIT	1
+#define	NCMNT_MISS	2
+
+static __inline void
+cache_mount_count(struct vnode *dvp, int what)
+{
+	struct mount *mp;
+
+	mp = dvp->v_mount;
+	if (__predict_false(mp == NULL))
+		return;
+	switch (what) {
+	case NCMNT_HIT:
+		counter_u64_add(mp->mnt_nchits, 1);
+		break;
+	case NCMNT_NEGHIT:
+		counter_u64_add(mp->mnt_ncneghits, 1);
+		break;
+	case NCMNT_MISS:
+		counter_u64_add(mp->mnt_ncmisses, 1);
+		break;
+	}
+}
+
+static int
+sysctl_vfs_cache_mount_stats(SYSCTL_HANDLER_ARGS)
+{
+	struct sbuf sb;
+	struct mount *mp, *nmp;
+	int error;
+
+	error = sysctl_wire_old_buffer(req, 0);
+	if (error != 0)
+		return (error);
+	sbuf_new_for_sysctl(&sb, NULL, 128, req);
+	sbuf_printf(&sb, "\n%-24s %16s %16s %16s\n", "MOUNTPOINT", "HITS",
+	    "NEGHITS", "MISSES");
+	mtx_lock(&mountlist_mtx);
+	for (mp = TAILQ_FIRST(&mountlist); mp != NULL; mp = nmp) {
+		if (vfs_busy(mp, MBF_NOWAIT | MBF_MNTLSTLOCK)) {
+			nmp = TAILQ_NEXT(mp, mnt_list);
+			continue;
+		}
+		sbuf_printf(&sb, "%-24s %16ju %16ju %16ju\n",
+		    mp->mnt_stat.f_mntonname,
+		    (uintmax_t)counter_u64_fetch(mp->mnt_nchits),
+		    (uintmax_t)counter_u64_fetch(mp->mnt_ncneghits),
+		    (uintmax_t)counter_u64_fetch(mp->mnt_ncmisses));
+		mtx_lock(&mountlist_mtx);
+		nmp = TAILQ_NEXT(mp, mnt_list);
+		vfs_unbusy(mp);
+	}
+	mtx_unlock(&mountlist_mtx);
+	error = sbuf_finish(&sb);
+	sbuf_delete(&sb);
+	return (error);
+}
+SYSCTL_PROC(_vfs_cache, OID_AUTO, mount_stats, CTLTYPE_STRING | CTLFLAG_RD |
+    CTLFLAG_MPSAFE, NULL, 0, sysctl_vfs_cache_mount_stats, "A",
+    "Per-mount name cache hits, negative hits and misses");
+
 static int cache_yield;
 SYSCTL_INT(_vfs_cache, OID_AUTO, yield, CTLFLAG_RD, &cache_yield, 0,
     "Number of times cache called yield");
@@ -648,48 +746,29 @@ SYSCTL_PROC(_debug_hashstat, OID_AUTO, nchash, CTLTYPE_INT|CTLFLAG_RD|
 /*
  * Negative entries management
  *
- * A variation of LRU scheme is used. New entries are hashed into one of
- * numneglists cold lists. Entries get promoted to the hot list on first hit.
- * Partial LRU for the hot list is maintained by requeueing them every
- * ncneghitsrequeue hits.
+ * Every CPU has its own negative list.  New entries are appended to the list
+ * of the CPU creating them, which keeps lookup storms (e.g. a compiler probing
+ * a long include path) from contending on shared locks.  A hit only sets
+ * NCF_HOTNEGATIVE, giving the entry a second chance: the shrinker rotates hot
+ * entries to the tail of their list, clearing the flag, and evicts the first
+ * cold one it finds.  Lists are visited in a round-robin manner.
  *
- * The shrinker will demote hot list head and evict from the cold list in a
- * round-robin manner.
+ * Shrinking is done asynchronously from a task scheduled by cache_enter once
+ * negative entries exceed their share of the cache.
  */
 static void
 cache_negative_hit(struct namecache *ncp)
 {
 	struct neglist *neglist;
-	u_int hits;
 
 	MPASS(ncp->nc_flag & NCF_NEGATIVE);
-	hits = atomic_fetchadd_int(&ncp->nc_neghits, 1);
-	if (ncp->nc_flag & NCF_HOTNEGATIVE) {
-		if ((hits % ncneghitsrequeue) != 0)
-			return;
-		mtx_lock(&ncneg_hot.nl_lock);
-		if (ncp->nc_flag & NCF_HOTNEGATIVE) {
-			TAILQ_REMOVE(&ncneg_hot.nl_list, ncp, nc_dst);
-			TAILQ_INSERT_TAIL(&ncneg_hot.nl_list, ncp, nc_dst);
-			mtx_unlock(&ncneg_hot.nl_lock);
-			return;
-		}
-		/*
-		 * The shrinker cleared the flag and removed the entry from
-		 * the hot list. Put it back.
-		 */
-	} else {
-		mtx_lock(&ncneg_hot.nl_lock);
-	}
+	atomic_add_int(&ncp->nc_neghits, 1);
+	if (ncp->nc_flag & NCF_HOTNEGATIVE)
+		return;
 	neglist = NCP2NEGLIST(ncp);
 	mtx_lock(&neglist->nl_lock);
-	if (!(ncp->nc_flag & NCF_HOTNEGATIVE)) {
-		TAILQ_REMOVE(&neglist->nl_list, ncp, nc_dst);
-		TAILQ_INSERT_TAIL(&ncneg_hot.nl_list, ncp, nc_dst);
-		ncp->nc_flag |= NCF_HOTNEGATIVE;
-	}
+	ncp->nc_flag |= NCF_HOTNEGATIVE;
 	mtx_unlock(&neglist->nl_lock);
-	mtx_unlock(&ncneg_hot.nl_lock);
 }
 
 static void
@@ -699,13 +778,17 @@ cache_negative_insert(struct namecache *ncp, bool neg_locked)
 
 	MPASS(ncp->nc_flag & NCF_NEGATIVE);
 	cache_assert_bucket_locked(ncp, RA_WLOCKED);
-	neglist = NCP2NEGLIST(ncp);
 	if (!neg_locked) {
+		ncp->nc_neglist = curcpu % numneglists;
+		neglist = NCP2NEGLIST(ncp);
 		mtx_lock(&neglist->nl_lock);
 	} else {
+		neglist = NCP2NEGLIST(ncp);
 		mtx_assert(&neglist->nl_lock, MA_OWNED);
 	}
+	ncp->nc_flag &= ~NCF_HOTNEGATIVE;
 	TAILQ_INSERT_TAIL(&neglist->nl_list, ncp, nc_dst);
+	neglist->nl_count++;
 	if (!neg_locked)
 		mtx_unlock(&neglist->nl_lock);
 	atomic_add_rel_long(&numneg, 1);
@@ -715,103 +798,73 @@ static void
 cache_negative_remove(struct namecache *ncp, bool neg_locked)
 {
 	struct neglist *neglist;
-	bool hot_locked = false;
-	bool list_locked = false;
 
 	MPASS(ncp->nc_flag & NCF_NEGATIVE);
 	cache_assert_bucket_locked(ncp, RA_WLOCKED);
 	neglist = NCP2NEGLIST(ncp);
-	if (!neg_locked) {
-		if (ncp->nc_flag & NCF_HOTNEGATIVE) {
-			hot_locked = true;
-			mtx_lock(&ncneg_hot.nl_lock);
-			if (!(ncp->nc_flag & NCF_HOTNEGATIVE)) {
-				list_locked = true;
-				mtx_lock(&neglist->nl_lock);
-			}
-		} else {
-			list_locked = true;
-			mtx_lock(&neglist->nl_lock);
-		}
-	}
-	if (ncp->nc_flag & NCF_HOTNEGATIVE) {
-		mtx_assert(&ncneg_hot.nl_lock, MA_OWNED);
-		TAILQ_REMOVE(&ncneg_hot.nl_list, ncp, nc_dst);
-	} else {
+	if (!neg_locked)
+		mtx_lock(&neglist->nl_lock);
+	else
 		mtx_assert(&neglist->nl_lock, MA_OWNED);
-		TAILQ_REMOVE(&neglist->nl_list, ncp, nc_dst);
-	}
-	if (list_locked)
+	TAILQ_REMOVE(&neglist->nl_list, ncp, nc_dst);
+	neglist->nl_count--;
+	if (!neg_locked)
 		mtx_unlock(&neglist->nl_lock);
-	if (hot_locked)
-		mtx_unlock(&ncneg_hot.nl_lock);
 	atomic_subtract_rel_long(&numneg, 1);
 }
 
-static void
-cache_negative_shrink_select(int start, struct namecache **ncpp,
-    struct neglist **neglistpp)
+/*
+ * Return the first cold entry of the list, giving hot entries found on the
+ * way a second chance.  Every entry is visited at most once, so the list is
+ * fully rotated in the worst case.
+ */
+static struct namecache *
+cache_negative_shrink_select(struct neglist *neglist)
 {
-	struct neglist *neglist;
 	struct namecache *ncp;
-	int i;
-
-	*ncpp = ncp = NULL;
-	neglist = NULL;
+	int count;
 
-	for (i = start; i < numneglists; i++) {
-		neglist = &neglists[i];
-		if (TAILQ_FIRST(&neglist->nl_list) == NULL)
-			continue;
-		mtx_lock(&neglist->nl_lock);
-		ncp = TAILQ_FIRST(&neglist->nl_list);
-		if (ncp != NULL)
+	mtx_assert(&neglist->nl_lock, MA_OWNED);
+	count = 0;
+	while ((ncp = TAILQ_FIRST(&neglist->nl_list)) != NULL) {
+		if ((ncp->nc_flag & NCF_HOTNEGATIVE) == 0 ||
+		    count++ == neglist->nl_count)
 			break;
-		mtx_unlock(&neglist->nl_lock);
+		TAILQ_REMOVE(&neglist->nl_list, ncp, nc_dst);
+		TAILQ_INSERT_TAIL(&neglist->nl_list, ncp, nc_dst);
+		ncp->nc_flag &= ~NCF_HOTNEGATIVE;
 	}
-
-	*neglistpp = neglist;
-	*ncpp = ncp;
+	return (ncp);
 }
 
-static void
+static bool
 cache_negative_zap_one(void)
 {
 	struct namecache *ncp, *ncp2;
 	struct neglist *neglist;
 	struct mtx *dvlp;
 	struct rwlock *blp;
+	u_int i;
 
-	if (!mtx_trylock(&ncneg_shrink_lock))
-		return;
-
-	mtx_lock(&ncneg_hot.nl_lock);
-	ncp = TAILQ_FIRST(&ncneg_hot.nl_list);
-	if (ncp != NULL) {
-		neglist = NCP2NEGLIST(ncp);
+	for (i = 0; i < numneglists; i++) {
+		neglist = &neglists[shrink_list_turn];
+		if (++shrink_list_turn == numneglists)
+			shrink_list_turn = 0;
+		if (TAILQ_EMPTY(&neglist->nl_list))
+			continue;
 		mtx_lock(&neglist->nl_lock);
-		TAILQ_REMOVE(&ncneg_hot.nl_list, ncp, nc_dst);
-		TAILQ_INSERT_TAIL(&neglist->nl_list, ncp, nc_dst);
-		ncp->nc_flag &= ~NCF_HOTNEGATIVE;
+		ncp = cache_negative_shrink_select(neglist);
+		if (ncp != NULL)
+			break;
 		mtx_unlock(&neglist->nl_lock);
 	}
-
-	cache_negative_shrink_select(shrink_list_turn, &ncp, &neglist);
-	shrink_list_turn++;
-	if (shrink_list_turn == numneglists)
-		shrink_list_turn = 0;
-	if (ncp == NULL && shrink_list_turn == 0)
-		cache_negative_shrink_select(shrink_list_turn, &ncp, &neglist);
-	if (ncp == NULL) {
-		mtx_unlock(&ncneg_hot.nl_lock);
-		goto out;
-	}
+	if (i == numneglists)
+		return (false);
 
 	MPASS(ncp->nc_flag & NCF_NEGATIVE);
 	dvlp = VP2VNODELOCK(ncp->nc_dvp);
 	blp = NCP2BUCKETLOCK(ncp);
 	mtx_unlock(&neglist->nl_lock);
-	mtx_unlock(&ncneg_hot.nl_lock);
 	mtx_lock(dvlp);
 	rw_wlock(blp);
 	mtx_lock(&neglist->nl_lock);
@@ -829,9 +882,37 @@ cache_negative_zap_one(void)
 	mtx_unlock(&neglist->nl_lock);
 	rw_wunlock(blp);
 	mtx_unlock(dvlp);
-out:
-	mtx_unlock(&ncneg_shrink_lock);
 	cache_free(ncp);
+	return (true);
+}
+
+static bool
+cache_negative_over_limit(void)
+{
+
+	return (numneg * ncnegfactor > numcache);
+}
+
+static void
+cache_negative_shrink_task(void *arg __unused, int pending __unused)
+{
+
+	while (cache_negative_over_limit()) {
+		if (!cache_negative_zap_one())
+			break;
+		cache_maybe_yield();
+	}
+	atomic_store_rel_int(&ncneg_shrinking, 0);
+}
+
+static void
+cache_negative_shrink_schedule(void)
+{
+
+	if (ncneg_shrinking != 0 ||
+	    !atomic_cmpset_int(&ncneg_shrinking, 0, 1))
+		return;
+	taskqueue_enqueue(taskqueue_thread, &ncneg_shrink_task);
 }
 
 /*
@@ -1229,6 +1310,50 @@ cache_lookup_nomakeentry(struct vnode *dvp, struct vnode **vpp,
 	return (0);
 }
 
+/*
+ * Look for a positive entry without taking the bucket lock.  On success the
+ * vnode is returned held, but not referenced or locked.
+ */
+static bool
+cache_lookup_lockless(struct vnode *dvp, struct vnode **vpp,
+    struct componentname *cnp, uint32_t hash)
+{
+	struct namecache *ncp;
+	struct vnode *vp;
+	bool found;
+
+	found = false;
+	epoch_enter(global_epoch);
+	if (atomic_load_acq_int(&cache_resizing) != 0)
+		goto out;
+	LIST_FOREACH(ncp, (NCHHASH(hash)), nc_hash) {
+		counter_u64_add(numchecks, 1);
+		if (ncp->nc_dvp == dvp && ncp->nc_nlen == cnp->cn_namelen &&
+		    !bcmp(ncp->nc_name, cnp->cn_nameptr, ncp->nc_nlen))
+			break;
+	}
+	if (ncp == NULL || (ncp->nc_flag & NCF_NEGATIVE) != 0)
+		goto out;
+	vp = ncp->nc_vp;
+	/*
+	 * A zero hold count means the vnode is either on the free list or
+	 * about to be freed.  Let the locked path sort it out.
+	 */
+	if (!refcount_acquire_if_not_zero(&vp->v_holdcnt))
+		goto out;
+	counter_u64_add(numposhits, 1);
+	counter_u64_add(numlockless, 1);
+	cache_mount_count(dvp, NCMNT_HIT);
+	*vpp = vp;
+	CTR4(KTR_VFS, "cache_lookup(%p, %s) found %p via ncp %p",
+	    dvp, cnp->cn_nameptr, *vpp, ncp);
+	SDT_PROBE3(vfs, namecache, lookup, hit, dvp, ncp->nc_name, *vpp);
+	found = true;
+out:
+	epoch_exit(global_epoch);
+	return (found);
+}
+
 int
 cache_lookup(struct vnode *dvp, struct vnode **vpp, struct componentname *cnp,
     struct timespec *tsp, int *ticksp)
@@ -1239,6 +1364,7 @@ cache_lookup(struct vnode *dvp, struct vnode **vpp, struct componentname *cnp,
 	struct mtx *dvlp;
 	uint32_t hash;
 	int error, ltype;
+	bool lockless;
 
 	if (__predict_false(!doingcache)) {
 		cnp->cn_flags &= ~MAKEENTRY;
@@ -1253,6 +1379,7 @@ cache_lookup(struct vnode *dvp, struct vnode **vpp, struct componentname *cnp,
 	if ((cnp->cn_flags & MAKEENTRY) == 0)
 		return (cache_lookup_nomakeentry(dvp, vpp, cnp, tsp, ticksp));
 
+	lockless = cache_lockless != 0 && tsp == NULL && ticksp == NULL;
 retry:
 	blp = NULL;
 	dvlp = NULL;
@@ -1293,6 +1420,12 @@ cache_lookup(struct vnode *dvp, struct vnode **vpp, struct componentname *cnp,
 	}
 
 	hash = cache_get_hash(cnp->cn_nameptr, cnp->cn_namelen, dvp);
+	if (lockless && cache_lookup_lockless(dvp, vpp, cnp, hash)) {
+		/* Retry with the bucket lock should vget fail. */
+		lockless = false;
+		ltype = 0;
+		goto success_held;
+	}
 	blp = HASH2BUCKETLOCK(hash);
 	rw_rlock(blp);
 
@@ -1309,12 +1442,14 @@ cache_lookup(struct vnode *dvp, struct vnode **vpp, struct componentname *cnp,
 		SDT_PROBE3(vfs, namecache, lookup, miss, dvp, cnp->cn_nameptr,
 		    NULL);
 		counter_u64_add(nummiss, 1);
+		cache_mount_count(dvp, NCMNT_MISS);
 		return (0);
 	}
 
 	/* We found a "positive" match, return the vnode */
 	if (!(ncp->nc_flag & NCF_NEGATIVE)) {
 		counter_u64_add(numposhits, 1);
+		cache_mount_count(dvp, NCMNT_HIT);
 		*vpp = ncp->nc_vp;
 		CTR4(KTR_VFS, "cache_lookup(%p, %s) found %p via ncp %p",
 		    dvp, cnp->cn_nameptr, *vpp, ncp);
@@ -1332,6 +1467,7 @@ cache_lookup(struct vnode *dvp, struct vnode **vpp, struct componentname *cnp,
 	}
 
 	counter_u64_add(numneghits, 1);
+	cache_mount_count(dvp, NCMNT_NEGHIT);
 	cache_negative_hit(ncp);
 	if (ncp->nc_flag & NCF_WHITE)
 		cnp->cn_flags |= ISWHITEOUT;
@@ -1354,6 +1490,7 @@ cache_lookup(struct vnode *dvp, struct vnode **vpp, struct componentname *cnp,
 	}
 	vhold(*vpp);
 	cache_lookup_unlock(blp, dvlp);
+success_held:
 	error = vget(*vpp, cnp->cn_lkflags | LK_VNHELD, cnp->cn_thread);
 	if (cnp->cn_flags & ISDOTDOT) {
 		vn_lock(dvp, ltype | LK_RETRY);
@@ -1656,7 +1793,6 @@ cache_enter_time(struct vnode *dvp, struct vnode *vp, struct componentname *cnp,
 				neg_locked = false;
 				if (ncp->nc_flag & NCF_NEGATIVE || vp == NULL) {
 					neglist = NCP2NEGLIST(ncp);
-					mtx_lock(&ncneg_hot.nl_lock);
 					mtx_lock(&neglist->nl_lock);
 					neg_locked = true;
 				}
@@ -1675,10 +1811,8 @@ cache_enter_time(struct vnode *dvp, struct vnode *vp, struct componentname *cnp,
 					ncp->nc_flag |= NCF_NEGATIVE;
 					cache_negative_insert(ncp, true);
 				}
-				if (neg_locked) {
+				if (neg_locked)
 					mtx_unlock(&neglist->nl_lock);
-					mtx_unlock(&ncneg_hot.nl_lock);
-				}
 				ncp->nc_vp = vp;
 				cache_enter_unlock(&cel);
 				return;
@@ -1734,11 +1868,14 @@ cache_enter_time(struct vnode *dvp, struct vnode *vp, struct componentname *cnp,
 				n2_ts->nc_ticks = ncp_ts->nc_ticks;
 				if (dtsp != NULL) {
 					n2_ts->nc_dotdottime = ncp_ts->nc_dotdottime;
-					if (ncp->nc_flag & NCF_NEGATIVE)
-						mtx_lock(&ncneg_hot.nl_lock);
+					neglist = NULL;
+					if (n2->nc_flag & NCF_NEGATIVE) {
+						neglist = NCP2NEGLIST(n2);
+						mtx_lock(&neglist->nl_lock);
+					}
 					n2_ts->nc_nc.nc_flag |= NCF_DTS;
-					if (ncp->nc_flag & NCF_NEGATIVE)
-						mtx_unlock(&ncneg_hot.nl_lock);
+					if (neglist != NULL)
+						mtx_unlock(&neglist->nl_lock);
 				}
 			}
 			goto out_unlock_free;
@@ -1788,8 +1925,10 @@ cache_enter_time(struct vnode *dvp, struct vnode *vp, struct componentname *cnp,
 
 	/*
 	 * Insert the new namecache entry into the appropriate chain
-	 * within the cache entries table.
+	 * within the cache entries table.  The entry has to be fully
+	 * constructed before lockless lookups can find it.
 	 */
+	atomic_thread_fence_rel();
 	LIST_INSERT_HEAD(ncpp, ncp, nc_hash);
 
 	/*
@@ -1811,7 +1950,7 @@ cache_enter_time(struct vnode *dvp, struct vnode *vp, struct componentname *cnp,
 	cache_enter_unlock(&cel);
 	lnumcache = atomic_fetchadd_long(&numcache, 1) + 1;
 	if (numneg * ncnegfactor > lnumcache)
-		cache_negative_zap_one();
+		cache_negative_shrink_schedule();
 	cache_free(ndd);
 	return;
 out_unlock_free:
@@ -1871,17 +2010,14 @@ nchinit(void *dummy __unused)
 		mtx_init(&vnodelocks[i], "ncvn", NULL, MTX_DUPOK | MTX_RECURSE);
 	ncpurgeminvnodes = numbucketlocks;
 
-	ncneghash = 3;
+	numneglists = MIN(mp_maxid + 1, NCNEGLISTS_MAX);
 	neglists = malloc(sizeof(*neglists) * numneglists, M_VFSCACHE,
 	    M_WAITOK | M_ZERO);
 	for (i = 0; i < numneglists; i++) {
 		mtx_init(&neglists[i].nl_lock, "ncnegl", NULL, MTX_DEF);
 		TAILQ_INIT(&neglists[i].nl_list);
 	}
-	mtx_init(&ncneg_hot.nl_lock, "ncneglh", NULL, MTX_DEF);
-	TAILQ_INIT(&ncneg_hot.nl_list);
-
-	mtx_init(&ncneg_shrink_lock, "ncnegs", NULL, MTX_DEF);
+	TASK_INIT(&ncneg_shrink_task, 0, cache_negative_shrink_task, NULL);
 
 	numcalls = counter_u64_alloc(M_WAITOK);
 	dothits = counter_u64_alloc(M_WAITOK);
@@ -1891,6 +2027,7 @@ nchinit(void *dummy __unused)
 	nummisszap = counter_u64_alloc(M_WAITOK);
 	numposzaps = counter_u64_alloc(M_WAITOK);
 	numposhits = counter_u64_alloc(M_WAITOK);
+	numlockless = counter_u64_alloc(M_WAITOK);
 	numnegzaps = counter_u64_alloc(M_WAITOK);
 	numneghits = counter_u64_alloc(M_WAITOK);
 	numfullpathcalls = counter_u64_alloc(M_WAITOK);
@@ -1924,7 +2061,11 @@ cache_changesize(int newmaxvnodes)
 	 * Move everything from the old hash table to the new table.
 	 * None of the namecache entries in the table can be removed
 	 * because to do so, they have to be removed from the hash table.
+	 * Entries change chains while being moved, so lockless lookups are
+	 * disabled and drained first.
 	 */
+	atomic_store_rel_int(&cache_resizing, 1);
+	epoch_wait(global_epoch);
 	cache_lock_all_vnodes();
 	cache_lock_all_buckets();
 	old_nchashtbl = nchashtbl;
@@ -1941,6 +2082,7 @@ cache_changesize(int newmaxvnodes)
 	}
 	cache_unlock_all_buckets();
 	cache_unlock_all_vnodes();
+	atomic_store_rel_int(&cache_resizing, 0);
 	free(old_nchashtbl, M_VFSCACHE);
 }
 
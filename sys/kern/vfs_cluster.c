@@ -44,12 +44,14 @@ __FBSDID("$FreeBSD$");
 #include <sys/proc.h>
 #include <sys/bio.h>
 #include <sys/buf.h>
+#include <sys/counter.h>
 #include <sys/vnode.h>
 #include <sys/malloc.h>
 #include <sys/mount.h>
 #include <sys/racct.h>
 #include <sys/resourcevar.h>
 #include <sys/rwlock.h>
+#include <sys/sdt.h>
 #include <sys/vmmeter.h>
 #include <vm/vm.h>
 #include <vm/vm_object.h>
@@ -83,6 +85,75 @@ static int read_min = 1;
 SYSCTL_INT(_vfs, OID_AUTO, read_min, CTLFLAG_RW, &read_min, 0,
     "Cluster read min block count");
 
+/*
+ * The read-ahead window is scaled up for devices slower than
+ * read_latency_target, based on the latency of synchronous cluster reads
+ * observed on the mount.  Each stream's window still grows and shrinks
+ * with its sequential count.
+ */
+static int read_latency_target = 2000;
+SYSCTL_INT(_vfs, OID_AUTO, read_latency_target, CTLFLAG_RW,
+    &read_latency_target, 0,
+    "Read latency (us) above which read-ahead is scaled up, 0 to disable");
+
+static int read_scale_max = 4;
+SYSCTL_INT(_vfs, OID_AUTO, read_scale_max, CTLFLAG_RW, &read_scale_max, 0,
+    "Maximum read-ahead scale factor for slow devices");
+
+static SYSCTL_NODE(_vfs, OID_AUTO, cluster, CTLFLAG_RD, 0,
+    "Cluster read-ahead statistics");
+static counter_u64_t ra_hits;
+SYSCTL_COUNTER_U64(_vfs_cluster, OID_AUTO, ra_hits, CTLFLAG_RD, &ra_hits,
+    "Sequential reads satisfied by earlier read-ahead");
+static counter_u64_t ra_misses;
+SYSCTL_COUNTER_U64(_vfs_cluster, OID_AUTO, ra_misses, CTLFLAG_RD, &ra_misses,
+    "Sequential reads which had to wait for a synchronous read");
+static counter_u64_t ra_blocks;
+SYSCTL_COUNTER_U64(_vfs_cluster, OID_AUTO, ra_blocks, CTLFLAG_RD, &ra_blocks,
+    "Number of blocks scheduled for read-ahead");
+
+SDT_PROVIDER_DECLARE(vfs);
+SDT_PROBE_DEFINE3(vfs, cluster, read, hit, "struct vnode *", "daddr_t",
+    "int");
+SDT_PROBE_DEFINE3(vfs, cluster, read, miss, "struct vnode *", "daddr_t",
+    "int");
+
+static void
+cluster_init(void *dummy __unused)
+{
+
+	ra_hits = counter_u64_alloc(M_WAITOK);
+	ra_misses = counter_u64_alloc(M_WAITOK);
+	ra_blocks = counter_u64_alloc(M_WAITOK);
+}
+SYSINIT(cluster, SI_SUB_VFS, SI_ORDER_ANY, cluster_init, NULL);
+
+static int
+cluster_read_scale(struct mount *mp)
+{
+	sbintime_t target;
+	int scale;
+
+	if (read_latency_target <= 0)
+		return (1);
+	target = read_latency_target * SBT_1US;
+	scale = mp->mnt_ralatency / target;
+	return (MAX(1, MIN(scale, read_scale_max)));
+}
+
+/*
+ * Fold a synchronous read latency sample into the mount's estimate.  The
+ * update is racy, but so is the use of the estimate.
+ */
+static void
+cluster_read_latency(struct mount *mp, sbintime_t sbt)
+{
+	sbintime_t lat;
+
+	lat = mp->mnt_ralatency;
+	mp->mnt_ralatency = lat + (sbt - lat) / 8;
+}
+
 /*
  * Read data to a buf, including read-ahead if we find this to be beneficial.
  * cluster_read replaces bread.
@@ -95,12 +166,14 @@ cluster_read(struct vnode *vp, u_quad_t filesize, daddr_t lblkno, long size,
 	struct buf *bp, *rbp, *reqbp;
 	struct bufobj *bo;
 	struct thread *td;
+	sbintime_t start;
 	daddr_t blkno, origblkno;
-	int maxra, racluster;
+	int maxra, racluster, scale;
 	int error, ncontig;
 	int i;
 
 	error = 0;
+	start = 0;
 	td = curthread;
 	bo = &vp->v_bufobj;
 	if (!unmapped_buf_allowed)
@@ -111,8 +184,9 @@ cluster_read(struct vnode *vp, u_quad_t filesize, daddr_t lblkno, long size,
 	 * ad-hoc parameters.  This needs work!!!
 	 */
 	racluster = vp->v_mount->mnt_iosize_max / size;
-	maxra = seqcount;
-	maxra = min(read_max, maxra);
+	scale = cluster_read_scale(vp->v_mount);
+	maxra = seqcount * scale;
+	maxra = min(read_max * scale, maxra);
 	maxra = min(nbuf/8, maxra);
 	if (((u_quad_t)(lblkno + maxra + 1) * size) > filesize)
 		maxra = (filesize / size) - lblkno;
@@ -140,6 +214,8 @@ cluster_read(struct vnode *vp, u_quad_t filesize, daddr_t lblkno, long size,
 		} else if ((bp->b_flags & B_RAM) == 0) {
 			return 0;
 		} else {
+			counter_u64_add(ra_hits, 1);
+			SDT_PROBE3(vfs, cluster, read, hit, vp, lblkno, maxra);
 			bp->b_flags &= ~B_RAM;
 			BO_RLOCK(bo);
 			for (i = 1; i < maxra; i++) {
@@ -183,6 +259,12 @@ cluster_read(struct vnode *vp, u_quad_t filesize, daddr_t lblkno, long size,
 		KASSERT(bp->b_offset != NOOFFSET,
 		    ("cluster_read: no buffer offset"));
 
+		if (seqcount > 0) {
+			counter_u64_add(ra_misses, 1);
+			SDT_PROBE3(vfs, cluster, read, miss, vp, lblkno,
+			    maxra);
+		}
+		start = sbinuptime();
 		ncontig = 0;
 
 		/*
@@ -306,6 +388,7 @@ cluster_read(struct vnode *vp, u_quad_t filesize, daddr_t lblkno, long size,
 		if ((rbp->b_flags & B_ASYNC) || rbp->b_iodone != NULL)
 			BUF_KERNPROC(rbp);
 		rbp->b_iooffset = dbtob(rbp->b_blkno);
+		counter_u64_add(ra_blocks, howmany(rbp->b_bufsize, size));
 		bstrategy(rbp);
 #ifdef RACCT
 		if (racct_enable) {
@@ -326,7 +409,9 @@ cluster_read(struct vnode *vp, u_quad_t filesize, daddr_t lblkno, long size,
 		if (error != 0) {
 			brelse(reqbp);
 			*bpp = NULL;
-		}
+		} else if (start != 0)
+			cluster_read_latency(vp->v_mount,
+			    sbinuptime() - start);
 	}
 	return (error);
 }
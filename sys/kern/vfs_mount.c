@@ -490,6 +490,9 @@ vfs_mount_alloc(struct vnode *vp, struct vfsconf *vfsp, const char *fspath,
 	mp->mnt_stat.f_owner = cred->cr_uid;
 	strlcpy(mp->mnt_stat.f_mntonname, fspath, MNAMELEN);
 	mp->mnt_iosize_max = DFLTPHYS;
+	mp->mnt_nchits = counter_u64_alloc(M_WAITOK);
+	mp->mnt_ncneghits = counter_u64_alloc(M_WAITOK);
+	mp->mnt_ncmisses = counter_u64_alloc(M_WAITOK);
 #ifdef MAC
 	mac_mount_init(mp);
 	mac_mount_create(cred, mp);
@@ -547,6 +550,9 @@ vfs_mount_destroy(struct mount *mp)
 	if (mp->mnt_opt != NULL)
 		vfs_freeopts(mp->mnt_opt);
 	crfree(mp->mnt_cred);
+	counter_u64_free(mp->mnt_nchits);
+	counter_u64_free(mp->mnt_ncneghits);
+	counter_u64_free(mp->mnt_ncmisses);
 	uma_zfree(mount_zone, mp);
 }
 
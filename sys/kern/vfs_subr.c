@@ -54,6 +54,7 @@ __FBSDID("$FreeBSD$");
 #include <sys/conf.h>
 #include <sys/counter.h>
 #include <sys/dirent.h>
+#include <sys/epoch.h>
 #include <sys/event.h>
 #include <sys/eventhandler.h>
 #include <sys/extattr.h>
@@ -110,6 +111,7 @@ static void	v_incr_usecount_locked(struct vnode *);
 static void	v_incr_devcount(struct vnode *);
 static void	v_decr_devcount(struct vnode *);
 static void	vgonel(struct vnode *);
+static void	vnode_free_deferred(epoch_context_t ctx);
 static void	vfs_knllock(void *arg);
 static void	vfs_knlunlock(void *arg);
 static void	vfs_knl_assert_locked(void *arg);
@@ -125,6 +127,9 @@ static void	destroy_vpollinfo(struct vpollinfo *vi);
  * flags without acquiring the lock.  Thus, these fences are INVARIANTS-only
  * for now.
  */
+CTASSERT(sizeof(((struct vnode *)0)->v_actfreelist) >=
+    sizeof(struct epoch_context));
+
 #ifdef INVARIANTS
 #define	VNODE_REFCOUNT_FENCE_ACQ()	atomic_thread_fence_acq()
 #define	VNODE_REFCOUNT_FENCE_REL()	atomic_thread_fence_rel()
@@ -2965,7 +2970,6 @@ _vdrop(struct vnode *vp, bool locked)
 	 * so as not to contaminate the freshly allocated vnode.
 	 */
 	CTR2(KTR_VFS, "%s: destroying the vnode %p", __func__, vp);
-	atomic_subtract_long(&numvnodes, 1);
 	bo = &vp->v_bufobj;
 	VNASSERT((vp->v_iflag & VI_FREE) == 0, vp,
 	    ("cleaned vnode still on the free list."));
@@ -2983,7 +2987,7 @@ _vdrop(struct vnode *vp, bool locked)
 	VNASSERT(TAILQ_EMPTY(&vp->v_cache_dst), vp, ("vp has namecache dst"));
 	VNASSERT(LIST_EMPTY(&vp->v_cache_src), vp, ("vp has namecache src"));
 	VNASSERT(vp->v_cache_dd == NULL, vp, ("vp has namecache for .."));
-	VNASSERT(TAILQ_EMPTY(&vp->v_rl.rl_waiters), vp,
+	VNASSERT(rangelock_idle(&vp->v_rl), vp,
 	    ("Dangling rangelock waiters"));
 	VI_UNLOCK(vp);
 #ifdef MAC
@@ -3005,7 +3009,24 @@ _vdrop(struct vnode *vp, bool locked)
 	vp->v_iflag = 0;
 	vp->v_vflag = 0;
 	bo->bo_flag = 0;
+	/*
+	 * Lockless namecache lookups may still try to hold the vnode, so
+	 * delay the free until they are done.  The vnode is off all lists
+	 * and v_actfreelist is reused as the epoch context.  It still
+	 * counts against desiredvnodes until the memory is returned.
+	 */
+	epoch_call(global_epoch, (epoch_context_t)&vp->v_actfreelist,
+	    vnode_free_deferred);
+}
+
+static void
+vnode_free_deferred(epoch_context_t ctx)
+{
+	struct vnode *vp;
+
+	vp = __containerof((void *)ctx, struct vnode, v_actfreelist);
 	uma_zfree(vnode_zone, vp);
+	atomic_subtract_long(&numvnodes, 1);
 }
 
 /*
@@ -3747,6 +3768,12 @@ DB_SHOW_COMMAND(mount, db_show_mount)
 	db_printf("    mnt_secondary_writes = %d\n", mp->mnt_secondary_writes);
 	db_printf("    mnt_secondary_accwrites = %d\n",
 	    mp->mnt_secondary_accwrites);
+	db_printf("    mnt_nchits = %ju\n",
+	    (uintmax_t)counter_u64_fetch(mp->mnt_nchits));
+	db_printf("    mnt_ncneghits = %ju\n",
+	    (uintmax_t)counter_u64_fetch(mp->mnt_ncneghits));
+	db_printf("    mnt_ncmisses = %ju\n",
+	    (uintmax_t)counter_u64_fetch(mp->mnt_ncmisses));
 	db_printf("    mnt_gjprovider = %s\n",
 	    mp->mnt_gjprovider != NULL ? mp->mnt_gjprovider : "NULL");
 
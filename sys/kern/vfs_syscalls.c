@@ -4611,3 +4611,112 @@ sys_posix_fadvise(struct thread *td, struct posix_fadvise_args *uap)
 	    uap->advice);
 	return (kern_posix_error(td, error));
 }
+
+int
+kern_copy_file_range(struct thread *td, int infd, off_t *inoffp, int outfd,
+    off_t *outoffp, size_t len, unsigned int flags)
+{
+	struct file *infp, *outfp;
+	struct vnode *invp, *outvp;
+	off_t inoff, outoff;
+	size_t retlen;
+	int error;
+
+	infp = outfp = NULL;
+	retlen = 0;
+	if (flags != 0) {
+		error = EINVAL;
+		goto out;
+	}
+	if (len > SSIZE_MAX)
+		len = SSIZE_MAX;
+
+	error = fget_read(td, infd,
+	    inoffp != NULL ? &cap_pread_rights : &cap_read_rights, &infp);
+	if (error != 0)
+		goto out;
+	error = fget_write(td, outfd,
+	    outoffp != NULL ? &cap_pwrite_rights : &cap_write_rights, &outfp);
+	if (error != 0)
+		goto out;
+	if (infp->f_type != DTYPE_VNODE || outfp->f_type != DTYPE_VNODE) {
+		error = EINVAL;
+		goto out;
+	}
+	if ((outfp->f_flag & O_APPEND) != 0) {
+		error = EBADF;
+		goto out;
+	}
+	invp = infp->f_vnode;
+	outvp = outfp->f_vnode;
+	if (inoffp == NULL && outoffp == NULL && infp == outfp) {
+		/* Both ranges start at the same file offset. */
+		error = len == 0 ? 0 : EINVAL;
+		goto out;
+	}
+
+	/*
+	 * Take the file offset locks in a fixed order, so that two copies in
+	 * opposite directions cannot deadlock.
+	 */
+	if (infp < outfp) {
+		inoff = inoffp != NULL ? *inoffp : foffset_lock(infp, 0);
+		outoff = outoffp != NULL ? *outoffp : foffset_lock(outfp, 0);
+	} else {
+		outoff = outoffp != NULL ? *outoffp : foffset_lock(outfp, 0);
+		inoff = inoffp != NULL ? *inoffp : foffset_lock(infp, 0);
+	}
+	if (invp == outvp && len > 0 && inoff < outoff + (off_t)len &&
+	    outoff < inoff + (off_t)len) {
+		/* Overlapping ranges of the same file. */
+		error = EINVAL;
+	} else {
+		retlen = len;
+		error = vn_copy_file_range(invp, &inoff, outvp, &outoff,
+		    &retlen, flags, infp->f_cred, outfp->f_cred);
+	}
+	if (inoffp != NULL)
+		*inoffp = inoff;
+	else
+		foffset_unlock(infp, inoff, retlen == 0 ? FOF_NOUPDATE : 0);
+	if (outoffp != NULL)
+		*outoffp = outoff;
+	else
+		foffset_unlock(outfp, outoff, retlen == 0 ? FOF_NOUPDATE : 0);
+out:
+	if (outfp != NULL)
+		fdrop(outfp, td);
+	if (infp != NULL)
+		fdrop(infp, td);
+	if (error == 0)
+		td->td_retval[0] = retlen;
+	return (error);
+}
+
+int
+sys_copy_file_range(struct thread *td, struct copy_file_range_args *uap)
+{
+	off_t inoff, outoff, *inoffp, *outoffp;
+	int error;
+
+	inoffp = outoffp = NULL;
+	if (uap->inoffp != NULL) {
+		error = copyin(uap->inoffp, &inoff, sizeof(off_t));
+		if (error != 0)
+			return (error);
+		inoffp = &inoff;
+	}
+	if (uap->outoffp != NULL) {
+		error = copyin(uap->outoffp, &outoff, sizeof(off_t));
+		if (error != 0)
+			return (error);
+		outoffp = &outoff;
+	}
+	error = kern_copy_file_range(td, uap->infd, inoffp, uap->outfd,
+	    outoffp, uap->len, uap->flags);
+	if (error == 0 && uap->inoffp != NULL)
+		error = copyout(inoffp, uap->inoffp, sizeof(off_t));
+	if (error == 0 && uap->outoffp != NULL)
+		error = copyout(outoffp, uap->outoffp, sizeof(off_t));
+	return (error);
+}
@@ -69,6 +69,7 @@ __FBSDID("$FreeBSD$");
 #include <sys/filio.h>
 #include <sys/resourcevar.h>
 #include <sys/rwlock.h>
+#include <sys/sdt.h>
 #include <sys/sx.h>
 #include <sys/sysctl.h>
 #include <sys/ttycom.h>
@@ -468,6 +469,53 @@ vn_close(struct vnode *vp, int flags, struct ucred *file_cred,
 	return (vn_close1(vp, flags, file_cred, td, false));
 }
 
+SDT_PROVIDER_DECLARE(vfs);
+SDT_PROBE_DEFINE3(vfs, , vnops, stream__switch, "struct file *",
+    "off_t", "int");
+
+/*
+ * f_nextoff and f_seqcount describe the active stream of the file.  When an
+ * I/O continues one of the inactive streams instead, it is swapped with the
+ * active one, so that foffset_unlock() keeps updating the right f_nextoff.
+ * Streams are only tracked with the vnode locked, and like f_seqcount itself
+ * are merely a heuristic which may race with shared-locked readers.
+ */
+static bool
+sequential_stream_switch(struct uio *uio, struct file *fp)
+{
+	struct file_rastream *rs, *victim;
+	off_t nextoff;
+	int i, seqcount;
+
+	victim = NULL;
+	for (i = 0; i < FILE_RASTREAMS; i++) {
+		rs = &fp->f_rastream[i];
+		if (rs->fr_seqcount > 0 && rs->fr_nextoff == uio->uio_offset) {
+			nextoff = rs->fr_nextoff;
+			seqcount = rs->fr_seqcount;
+			rs->fr_nextoff = fp->f_nextoff;
+			rs->fr_seqcount = fp->f_seqcount;
+			fp->f_nextoff = nextoff;
+			fp->f_seqcount = seqcount;
+			SDT_PROBE3(vfs, , vnops, stream__switch, fp,
+			    uio->uio_offset, seqcount);
+			return (true);
+		}
+		if (victim == NULL || rs->fr_seqcount < victim->fr_seqcount)
+			victim = rs;
+	}
+
+	/*
+	 * A new stream.  Park the active one, if it was sequential, in
+	 * place of the least sequential inactive stream.
+	 */
+	if (fp->f_seqcount > 1 && fp->f_seqcount > victim->fr_seqcount) {
+		victim->fr_nextoff = fp->f_nextoff;
+		victim->fr_seqcount = fp->f_seqcount;
+	}
+	return (false);
+}
+
 /*
  * Heuristic to detect sequential operation.
  */
@@ -487,7 +535,8 @@ sequential_heuristic(struct uio *uio, struct file *fp)
 	 * case offset 0 is not special.
 	 */
 	if ((uio->uio_offset == 0 && fp->f_seqcount > 0) ||
-	    uio->uio_offset == fp->f_nextoff) {
+	    uio->uio_offset == fp->f_nextoff ||
+	    sequential_stream_switch(uio, fp)) {
 		/*
 		 * f_seqcount is in units of fixed-size blocks so that it
 		 * depends mainly on the amount of sequential I/O and not
@@ -2189,6 +2238,197 @@ vn_bmap_seekhole(struct vnode *vp, u_long cmd, off_t *off, struct ucred *cred)
 	return (error);
 }
 
+/*
+ * Copy up to *lenp bytes between two regular files, for copy_file_range(2).
+ * When both vnodes use the same vnode operations, the file system gets a
+ * chance to do the copy itself; by default, or across file systems, the data
+ * goes through vn_generic_copy_file_range().  On return, *lenp is the number
+ * of bytes copied and both offsets have been advanced by it.
+ */
+int
+vn_copy_file_range(struct vnode *invp, off_t *inoffp, struct vnode *outvp,
+    off_t *outoffp, size_t *lenp, unsigned int flags, struct ucred *incred,
+    struct ucred *outcred)
+{
+	size_t len;
+	int error;
+
+	len = *lenp;
+	*lenp = 0;
+	if (invp->v_type == VDIR || outvp->v_type == VDIR)
+		return (EISDIR);
+	if (invp->v_type != VREG || outvp->v_type != VREG ||
+	    *inoffp < 0 || *outoffp < 0 || flags != 0)
+		return (EINVAL);
+
+	/* Clip the length so that neither offset can overflow. */
+	if ((uoff_t)len > (uoff_t)(OFF_MAX - *inoffp))
+		len = OFF_MAX - *inoffp;
+	if ((uoff_t)len > (uoff_t)(OFF_MAX - *outoffp))
+		len = OFF_MAX - *outoffp;
+	if (len == 0)
+		return (0);
+
+	if (invp->v_op == outvp->v_op)
+		error = VOP_COPY_FILE_RANGE(invp, inoffp, outvp, outoffp,
+		    &len, flags, incred, outcred);
+	else
+		error = vn_generic_copy_file_range(invp, inoffp, outvp,
+		    outoffp, &len, flags, incred, outcred);
+	*lenp = len;
+	return (error);
+}
+
+/*
+ * Copy a file range through the buffer cache, a chunk at a time, without
+ * holding both vnode locks at once.  A hole in the input that lies past the
+ * end of the output is skipped rather than written, so sparse files stay
+ * sparse.  Like vop_stdallocate(), the copy stops early when the thread
+ * should yield; the caller sees a short count and calls again.
+ */
+int
+vn_generic_copy_file_range(struct vnode *invp, off_t *inoffp,
+    struct vnode *outvp, off_t *outoffp, size_t *lenp, unsigned int flags,
+    struct ucred *incred, struct ucred *outcred)
+{
+	struct vattr va;
+	struct thread *td;
+	off_t dataoff, holeoff, inoff, insize, outoff, outsize, xfer;
+	size_t blksize, copied, len;
+	ssize_t aresid;
+	char *buf;
+	int error;
+
+	td = curthread;
+	inoff = *inoffp;
+	outoff = *outoffp;
+	len = *lenp;
+	copied = 0;
+	buf = NULL;
+
+	error = vn_lock(invp, LK_SHARED);
+	if (error != 0)
+		goto out;
+	error = VOP_GETATTR(invp, &va, incred);
+	VOP_UNLOCK(invp, 0);
+	if (error != 0)
+		goto out;
+	insize = va.va_size;
+	blksize = va.va_blocksize;
+	error = vn_lock(outvp, LK_SHARED);
+	if (error != 0)
+		goto out;
+	error = VOP_GETATTR(outvp, &va, outcred);
+	VOP_UNLOCK(outvp, 0);
+	if (error != 0)
+		goto out;
+	outsize = va.va_size;
+
+	/* Move whole blocks of both file systems, at least MAXPHYS at once. */
+	blksize = MAX(blksize, va.va_blocksize);
+	if (blksize == 0)
+		blksize = BLKDEV_IOSIZE;
+	blksize = howmany(MAXPHYS, blksize) * blksize;
+	buf = malloc(blksize, M_TEMP, M_WAITOK);
+
+	/*
+	 * [inoff, dataoff) is known to be a hole and [dataoff, holeoff) data;
+	 * look again once the copy moves past holeoff.
+	 */
+	dataoff = holeoff = inoff;
+	while (len > 0 && inoff < insize) {
+		if (inoff >= holeoff) {
+			dataoff = inoff;
+			error = VOP_IOCTL(invp, FIOSEEKDATA, &dataoff, 0,
+			    incred, td);
+			if (error == ENXIO) {
+				/* Only a hole is left. */
+				dataoff = insize;
+				error = 0;
+			}
+			holeoff = dataoff;
+			if (error != 0) {
+				/* The file system does not report holes. */
+				dataoff = inoff;
+				holeoff = insize;
+				error = 0;
+			} else if (dataoff >= insize || VOP_IOCTL(invp,
+			    FIOSEEKHOLE, &holeoff, 0, incred, td) != 0 ||
+			    holeoff <= dataoff)
+				holeoff = insize;
+		}
+		if (inoff < dataoff && outoff >= outsize) {
+			/*
+			 * Nothing in the output needs to be overwritten with
+			 * zeroes, so leave a hole there too.
+			 */
+			xfer = dataoff - inoff;
+			if ((uoff_t)xfer > len)
+				xfer = len;
+			inoff += xfer;
+			outoff += xfer;
+			len -= xfer;
+			copied += xfer;
+			continue;
+		}
+
+		/* Stop where a hole starts or ends, so it can be skipped. */
+		xfer = blksize;
+		if ((uoff_t)xfer > len)
+			xfer = len;
+		if (inoff < dataoff)
+			xfer = MIN(xfer, dataoff - inoff);
+		else
+			xfer = MIN(xfer, holeoff - inoff);
+		error = vn_rdwr(UIO_READ, invp, buf, xfer, inoff, UIO_SYSSPACE,
+		    0, td->td_ucred, incred, &aresid, td);
+		if (error != 0)
+			break;
+		xfer -= aresid;
+		if (xfer == 0)
+			break;
+		bwillwrite();
+		error = vn_rdwr(UIO_WRITE, outvp, buf, xfer, outoff,
+		    UIO_SYSSPACE, 0, td->td_ucred, outcred, &aresid, td);
+		if (error != 0)
+			break;
+		xfer -= aresid;
+		inoff += xfer;
+		outoff += xfer;
+		len -= xfer;
+		copied += xfer;
+		if (outoff > outsize)
+			outsize = outoff;
+		if (aresid != 0 || should_yield())
+			break;
+	}
+
+	if (error == 0 && outoff > outsize) {
+		/*
+		 * The copy ended in a skipped hole.  Writing its last byte
+		 * extends the output without filling the hole in.
+		 */
+		buf[0] = '\0';
+		error = vn_rdwr(UIO_WRITE, outvp, buf, 1, outoff - 1,
+		    UIO_SYSSPACE, 0, td->td_ucred, outcred, NULL, td);
+		if (error != 0) {
+			xfer = outoff - outsize;
+			inoff -= xfer;
+			outoff -= xfer;
+			copied -= xfer;
+		}
+	}
+out:
+	free(buf, M_TEMP);
+	/* Report a partial copy, like a short write; the next call fails. */
+	if (copied > 0)
+		error = 0;
+	*inoffp = inoff;
+	*outoffp = outoff;
+	*lenp = copied;
+	return (error);
+}
+
 int
 vn_seek(struct file *fp, off_t offset, int whence, struct thread *td)
 {
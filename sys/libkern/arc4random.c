@@ -50,6 +50,7 @@ __FBSDID("$FreeBSD$");
 CTASSERT(CHACHA20_KEYBYTES*8 >= CHACHA_MINKEYLEN);
 
 int arc4rand_iniseed_state = ARC4_ENTR_NONE;
+int arc4rand_seeded = 0;
 
 MALLOC_DEFINE(M_CHACHA20RANDOM, "chacha20random", "chacha20random structures");
 
@@ -159,7 +160,15 @@ arc4rand(void *ptr, u_int len, int reseed)
 	u_int length;
 	u_int8_t *p;
 
-	if (reseed || atomic_cmpset_int(&arc4rand_iniseed_state, ARC4_ENTR_HAVE, ARC4_ENTR_SEED))
+	if (atomic_cmpset_int(&arc4rand_iniseed_state, ARC4_ENTR_HAVE, ARC4_ENTR_SEED)) {
+		CHACHA20_FOREACH(chacha20)
+			chacha20_randomstir(chacha20);
+		/*
+		 * The state above changes before the loop runs; consumers
+		 * that need every instance keyed wait for this instead.
+		 */
+		atomic_store_rel_int(&arc4rand_seeded, 1);
+	} else if (reseed)
 		CHACHA20_FOREACH(chacha20)
 			chacha20_randomstir(chacha20);
 
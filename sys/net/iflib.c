@@ -1925,7 +1925,8 @@ _rxq_refill_cb(void *arg, bus_dma_segment_t *segs, int nseg, int error)
 static void
 _iflib_fl_refill(if_ctx_t ctx, iflib_fl_t fl, int count)
 {
-	struct mbuf *m;
+	struct mbuf *m, *mbufs[IFLIB_MAX_RX_REFRESH];
+	int mcnt, midx;
 	int idx, frag_idx = fl->ifl_fragidx;
         int pidx = fl->ifl_pidx;
 	caddr_t cl, *sd_cl;
@@ -1960,6 +1961,7 @@ _iflib_fl_refill(if_ctx_t ctx, iflib_fl_t fl, int count)
 	if (n > 8)
 		DBG_COUNTER_INC(fl_refills_large);
 	iru_init(&iru, fl->ifl_rxq, fl->ifl_id);
+	mcnt = midx = 0;
 	while (n--) {
 		/*
 		 * We allocate an uninitialized mbuf + cluster, mbuf is
@@ -1977,9 +1979,15 @@ _iflib_fl_refill(if_ctx_t ctx, iflib_fl_t fl, int count)
 			fl->ifl_cl_enqueued++;
 #endif
 		}
-		if ((m = m_gethdr(M_NOWAIT, MT_NOINIT)) == NULL) {
-			break;
+		/* Take the mbufs out of UMA a batch at a time. */
+		if (midx == mcnt) {
+			mcnt = m_gethdr_bulk(mbufs, min(n + 1,
+			    IFLIB_MAX_RX_REFRESH), M_NOWAIT, MT_NOINIT);
+			midx = 0;
+			if (mcnt == 0)
+				break;
 		}
+		m = mbufs[midx++];
 #if MEMORY_LOGGING
 		fl->ifl_m_enqueued++;
 #endif
@@ -2041,6 +2049,13 @@ _iflib_fl_refill(if_ctx_t ctx, iflib_fl_t fl, int count)
 
 	}
 done:
+	if (midx < mcnt) {
+		/* MT_NOINIT mbufs, make sure the dtor finds no tags. */
+		for (n = midx; n < mcnt; n++)
+			mbufs[n]->m_flags = 0;
+		uma_zfree_bulk(zone_mbuf, (void **)&mbufs[midx], mcnt - midx,
+		    NULL);
+	}
 	if (i) {
 		iru.iru_pidx = pidx;
 		iru.iru_count = i;
@@ -4606,7 +4621,8 @@ iflib_device_register(device_t dev, void *sc, if_shared_ctx_t sctx, if_ctx_t *ct
 
 	GROUPTASK_INIT(&ctx->ifc_admin_task, 0, _task_fn_admin, ctx);
 	/* XXX format name */
-	taskqgroup_attach(qgroup_if_config_tqg, &ctx->ifc_admin_task, ctx, -1, "admin");
+	taskqgroup_attach(qgroup_if_config_tqg, &ctx->ifc_admin_task, ctx,
+	    ctx->ifc_dev, -1, "admin");
 
 	/* Set up cpu set.  If it fails, use the set of all CPUs. */
 	if (bus_get_cpus(dev, INTR_CPUS, sizeof(ctx->ifc_cpus), &ctx->ifc_cpus) != 0) {
@@ -4866,7 +4882,8 @@ iflib_pseudo_register(device_t dev, if_shared_ctx_t sctx, if_ctx_t *ctxp,
 
 	GROUPTASK_INIT(&ctx->ifc_admin_task, 0, _task_fn_admin, ctx);
 	/* XXX format name */
-	taskqgroup_attach(qgroup_if_config_tqg, &ctx->ifc_admin_task, ctx, -1, "admin");
+	taskqgroup_attach(qgroup_if_config_tqg, &ctx->ifc_admin_task, ctx,
+	    ctx->ifc_dev, -1, "admin");
 
 	/* XXX --- can support > 1 -- but keep it simple for now */
 	scctx->isc_intr = IFLIB_INTR_LEGACY;
@@ -5845,7 +5862,8 @@ iflib_irq_alloc_generic(if_ctx_t ctx, if_irq_t irq, int rid,
 		if (err)
 			return (err);
 	} else {
-		taskqgroup_attach(tqg, gtask, q, rman_get_start(irq->ii_res), name);
+		taskqgroup_attach(tqg, gtask, q, ctx->ifc_dev,
+		    rman_get_start(irq->ii_res), name);
 	}
 
 	return (0);
@@ -5891,10 +5909,12 @@ iflib_softirq_alloc_generic(if_ctx_t ctx, if_irq_t irq, iflib_intr_type_t type,
 	if (irq_num != -1) {
 		err = iflib_irq_set_affinity(ctx, irq_num, type, qid, gtask, tqg, q, name);
 		if (err)
-			taskqgroup_attach(tqg, gtask, q, irq_num, name);
+			taskqgroup_attach(tqg, gtask, q, ctx->ifc_dev,
+			    irq_num, name);
 	}
 	else {
-		taskqgroup_attach(tqg, gtask, q, irq_num, name);
+		taskqgroup_attach(tqg, gtask, q, ctx->ifc_dev, irq_num,
+		    name);
 	}
 }
 
@@ -5939,10 +5959,12 @@ iflib_legacy_setup(if_ctx_t ctx, driver_filter_t filter, void *filter_arg, int *
 	if ((err = _iflib_irq_alloc(ctx, irq, tqrid, iflib_fast_intr_ctx, NULL, info, name)) != 0)
 		return (err);
 	GROUPTASK_INIT(gtask, 0, fn, q);
-	taskqgroup_attach(tqg, gtask, q, rman_get_start(irq->ii_res), name);
+	taskqgroup_attach(tqg, gtask, q, ctx->ifc_dev,
+	    rman_get_start(irq->ii_res), name);
 
 	GROUPTASK_INIT(&txq->ift_task, 0, _task_fn_tx, txq);
-	taskqgroup_attach(qgroup_if_io_tqg, &txq->ift_task, txq, rman_get_start(irq->ii_res), "tx");
+	taskqgroup_attach(qgroup_if_io_tqg, &txq->ift_task, txq,
+	    ctx->ifc_dev, rman_get_start(irq->ii_res), "tx");
 	return (0);
 }
 
@@ -6001,7 +6023,8 @@ iflib_config_gtask_init(void *ctx, struct grouptask *gtask, gtask_fn_t *fn,
 {
 
 	GROUPTASK_INIT(gtask, 0, fn, ctx);
-	taskqgroup_attach(qgroup_if_config_tqg, gtask, gtask, -1, name);
+	taskqgroup_attach(qgroup_if_config_tqg, gtask, gtask, NULL, -1,
+	    name);
 }
 
 void
@@ -6467,6 +6490,9 @@ iflib_add_device_sysctl_post(if_ctx_t ctx)
 				       CTLFLAG_RD,
 				       &rxq->ifr_cq_cidx, 1, "Consumer Index");
 		}
+#if defined(INET6) || defined(INET)
+		tcp_lro_sysctl_attach(&rxq->ifr_lc, ctx_list, queue_list);
+#endif
 
 		for (j = 0, fl = rxq->ifr_fl; j < rxq->ifr_nfl; j++, fl++) {
 			snprintf(namebuf, NAME_BUFLEN, "rxq_fl%d", j);
@@ -409,6 +409,31 @@ drbr_dequeue(struct ifnet *ifp, struct buf_ring *br)
 	return (buf_ring_dequeue_sc(br));
 }
 
+/*
+ * Dequeue up to n packets into mp[] with a single update of the ring
+ * indices, returning how many were dequeued.
+ */
+static __inline int
+drbr_dequeue_burst(struct ifnet *ifp, struct buf_ring *br, struct mbuf **mp,
+    int n)
+{
+#ifdef ALTQ
+	struct mbuf *m;
+	int i;
+
+	if (ifp != NULL && ALTQ_IS_ENABLED(&ifp->if_snd)) {
+		for (i = 0; i < n; i++) {
+			IFQ_DEQUEUE(&ifp->if_snd, m);
+			if (m == NULL)
+				break;
+			mp[i] = m;
+		}
+		return (i);
+	}
+#endif
+	return (buf_ring_dequeue_burst_sc(br, (void **)mp, n));
+}
+
 static __inline void
 drbr_advance(struct ifnet *ifp, struct buf_ring *br)
 {
@@ -1234,6 +1234,7 @@ rt_unlinkrte(struct rib_head *rnh, struct rt_addrinfo *info, int *perror)
 	RT_LOCK(rt);
 	RT_ADDREF(rt);
 	rt->rt_flags &= ~RTF_UP;
+	rnh->rnh_gen++;		/* Routing table updated */
 
 	*perror = 0;
 
@@ -1378,6 +1379,7 @@ rt_updatemtu(struct ifnet *ifp)
 				continue;
 			RIB_WLOCK(rnh);
 			rnh->rnh_walktree(&rnh->head, if_updatemtu_cb, &ifmtu);
+			rnh->rnh_gen++;	/* Route MTUs may have changed */
 			RIB_WUNLOCK(rnh);
 		}
 	}
@@ -97,11 +97,12 @@ struct vnet {
     VNET_DEFINE_STATIC(counter_u64_t, name[sizeof(type) / sizeof(uint64_t)])
 
 #define	VNET_PCPUSTAT_ALLOC(name, wait)	\
-    COUNTER_ARRAY_ALLOC(VNET(name), \
+    counter_u64_array_alloc(VNET(name), \
 	sizeof(VNET(name)) / sizeof(counter_u64_t), (wait))
 
 #define	VNET_PCPUSTAT_FREE(name)	\
-    COUNTER_ARRAY_FREE(VNET(name), sizeof(VNET(name)) / sizeof(counter_u64_t))
+    counter_u64_array_free(VNET(name), \
+	sizeof(VNET(name)) / sizeof(counter_u64_t))
 
 #define	VNET_PCPUSTAT_ADD(type, name, f, v)	\
     counter_u64_add(VNET(name)[offsetof(type, f) / sizeof(uint64_t)], (v))
@@ -135,9 +136,10 @@ array##_sysctl(SYSCTL_HANDLER_ARGS)					\
 	type s;								\
 	CTASSERT((sizeof(type) / sizeof(uint64_t)) ==			\
 	    (sizeof(VNET(array)) / sizeof(counter_u64_t)));		\
-	COUNTER_ARRAY_COPY(VNET(array), &s, sizeof(type) / sizeof(uint64_t));\
+	counter_u64_array_fetch(VNET(array),				\
+	    sizeof(type) / sizeof(uint64_t), (uint64_t *)&s);		\
 	if (req->newptr)						\
-		COUNTER_ARRAY_ZERO(VNET(array),				\
+		counter_u64_array_zero(VNET(array),			\
 		    sizeof(type) / sizeof(uint64_t));			\
 	return (SYSCTL_OUT(req, &s, sizeof(type)));			\
 }									\
@@ -43,6 +43,10 @@ __FBSDID("$FreeBSD$");
 #include <sys/socket.h>
 #include <sys/sysctl.h>
 #include <sys/kernel.h>
+#include <sys/epoch.h>
+#include <sys/taskqueue.h>
+
+#include <ck_pr.h>
 
 #include <net/if.h>
 #include <net/if_var.h>
@@ -67,6 +71,559 @@ static void fib4_rte_to_nh_extended(struct rtentry *rte, struct in_addr dst,
 
 #define RNTORT(p)	((struct rtentry *)(p))
 
+/*
+ * Compressed lookup structure, loosely following DXR (Zec, Rizzo, Mikuc:
+ * "DXR: towards a billion routing lookups per second in software").
+ *
+ * The radix tree of a fib is flattened into a sorted list of address
+ * ranges, each mapping to a nexthop index.  The upper 16 bits of the
+ * destination index a direct table; a chunk covered by a single range
+ * resolves to its nexthop right away, otherwise the ranges falling into
+ * the chunk are binary searched on the lower 16 bits.
+ *
+ * Tables are read-only once published and are looked up under the net
+ * epoch without touching the rib lock.  Each table records the rib
+ * generation it was built from; a lookup that finds it stale falls back
+ * to the radix tree and schedules a rebuild, so bursts of route changes
+ * are coalesced into one rebuild per fib.
+ */
+#define	DXR_DSHIFT		16
+#define	DXR_DCHUNKS		(1 << DXR_DSHIFT)
+#define	DXR_RMASK		(DXR_DCHUNKS - 1)
+#define	DXR_MAX_NHOPS		4096	/* fall back to radix beyond that */
+
+struct dxr_nhop {
+	struct ifnet	*nh_ifp;	/* NULL for "no route" */
+	struct in_addr	nh_gw;		/* gateway, if NHF_GATEWAY */
+	uint16_t	nh_mtu;		/* rt_mtu */
+	uint16_t	nh_flags;	/* NHF_ flags */
+};
+
+struct dxr_direct {
+	uint32_t	dd_base;	/* first range of the chunk */
+	uint16_t	dd_nranges;	/* 0: whole chunk maps to dd_nh */
+	uint16_t	dd_nh;
+};
+
+struct dxr_range {
+	uint16_t	dr_start;	/* lower 16 bits of the first address */
+	uint16_t	dr_nh;
+};
+
+struct fib4_dxr {
+	struct epoch_context	dt_epoch_ctx;
+	u_int			dt_gen;		/* rnh_gen built from */
+	u_int			dt_nnhops;
+	u_int			dt_nranges;
+	struct dxr_nhop		*dt_nhops;
+	struct dxr_range	*dt_ranges;
+	struct dxr_direct	dt_direct[DXR_DCHUNKS];
+};
+
+struct fib4_dxr_ctl {
+	struct fib4_dxr		*dc_table;
+	struct timeout_task	dc_task;
+	struct vnet		*dc_vnet;
+	uint32_t		dc_fibnum;
+	volatile u_int		dc_pending;
+};
+
+/* Temporary state while flattening a radix tree. */
+struct dxr_prefix {
+	uint32_t	dp_start;
+	uint32_t	dp_end;
+	uint16_t	dp_nh;
+	uint8_t		dp_plen;
+};
+
+struct dxr_ival {
+	uint32_t	di_start;	/* runs up to the next start */
+	uint16_t	di_nh;
+};
+
+struct dxr_build {
+	struct dxr_prefix	*db_pfx;
+	size_t			db_npfx;
+	size_t			db_maxpfx;
+	struct dxr_nhop		*db_nhops;
+	u_int			db_nnhops;
+	u_int			db_lastnh;
+};
+
+static MALLOC_DEFINE(M_DXR, "dxr", "IPv4 compressed forwarding table");
+
+VNET_DEFINE_STATIC(struct fib4_dxr_ctl *, fib4_dxr_ctl);
+#define	V_fib4_dxr_ctl		VNET(fib4_dxr_ctl)
+VNET_DEFINE_STATIC(int, fib4_dxr_enable) = 0;
+#define	V_fib4_dxr_enable	VNET(fib4_dxr_enable)
+VNET_DEFINE_STATIC(int, fib4_dxr_delay) = 50;
+#define	V_fib4_dxr_delay	VNET(fib4_dxr_delay)
+VNET_DEFINE_STATIC(u_int, fib4_dxr_rebuilds);
+#define	V_fib4_dxr_rebuilds	VNET(fib4_dxr_rebuilds)
+VNET_DEFINE_STATIC(u_int, fib4_dxr_failures);
+#define	V_fib4_dxr_failures	VNET(fib4_dxr_failures)
+
+static int sysctl_fib4_dxr_enable(SYSCTL_HANDLER_ARGS);
+
+static SYSCTL_NODE(_net_inet_ip, OID_AUTO, dxr, CTLFLAG_RW, 0,
+    "Compressed IPv4 forwarding table");
+SYSCTL_PROC(_net_inet_ip_dxr, OID_AUTO, enable,
+    CTLFLAG_VNET | CTLTYPE_INT | CTLFLAG_RW, NULL, 0,
+    sysctl_fib4_dxr_enable, "I",
+    "Look up IPv4 routes in a compressed table under the net epoch");
+SYSCTL_INT(_net_inet_ip_dxr, OID_AUTO, rebuild_delay,
+    CTLFLAG_VNET | CTLFLAG_RW, &VNET_NAME(fib4_dxr_delay), 0,
+    "Milliseconds to coalesce route changes before a rebuild");
+SYSCTL_UINT(_net_inet_ip_dxr, OID_AUTO, rebuilds,
+    CTLFLAG_VNET | CTLFLAG_RD, &VNET_NAME(fib4_dxr_rebuilds), 0,
+    "Tables built");
+SYSCTL_UINT(_net_inet_ip_dxr, OID_AUTO, failures,
+    CTLFLAG_VNET | CTLFLAG_RD, &VNET_NAME(fib4_dxr_failures), 0,
+    "Rebuilds abandoned, leaving the fib on the radix tree");
+
+static int
+dxr_walk_count(struct radix_node *rn, void *arg)
+{
+
+	(*(size_t *)arg)++;
+	return (0);
+}
+
+static int
+dxr_walk_collect(struct radix_node *rn, void *arg)
+{
+	struct dxr_build *db = arg;
+	struct rtentry *rte = RNTORT(rn);
+	struct sockaddr_in *sin, mask;
+	struct dxr_prefix *dp;
+	struct dxr_nhop nh;
+	uint32_t addr, m;
+	u_int i;
+	int plen;
+
+	/* The table grew since it was counted. */
+	if (db->db_npfx == db->db_maxpfx)
+		return (EAGAIN);
+
+	sin = (struct sockaddr_in *)rt_key(rte);
+	addr = ntohl(sin->sin_addr.s_addr);
+	if ((rte->rt_flags & RTF_HOST) != 0 || rt_mask(rte) == NULL)
+		plen = 32;
+	else {
+		/* Masks may be stored truncated after the last set byte. */
+		bzero(&mask, sizeof(mask));
+		bcopy(rt_mask(rte), &mask,
+		    min(rt_mask(rte)->sa_len, sizeof(mask)));
+		m = ntohl(mask.sin_addr.s_addr);
+		plen = bitcount32(m);
+		if (plen != 0 && m != 0xffffffffU << (32 - plen))
+			return (EINVAL);	/* non-contiguous mask */
+	}
+
+	bzero(&nh, sizeof(nh));
+	nh.nh_ifp = rte->rt_ifp;
+	nh.nh_mtu = ulmin(rte->rt_mtu, UINT16_MAX);
+	nh.nh_flags = fib_rte_to_nh_flags(rte->rt_flags);
+	if (addr == 0)
+		nh.nh_flags |= NHF_DEFAULT;
+	if (rte->rt_flags & RTF_GATEWAY)
+		nh.nh_gw = ((struct sockaddr_in *)rte->rt_gateway)->sin_addr;
+
+	/* Few distinct nexthops, and routes tend to repeat the last one. */
+	i = db->db_lastnh;
+	if (memcmp(&db->db_nhops[i], &nh, sizeof(nh)) != 0) {
+		for (i = 1; i < db->db_nnhops; i++)
+			if (memcmp(&db->db_nhops[i], &nh, sizeof(nh)) == 0)
+				break;
+		if (i == db->db_nnhops) {
+			if (i == DXR_MAX_NHOPS)
+				return (E2BIG);
+			/* Released in dxr_nhops_rele(). */
+			if_ref(nh.nh_ifp);
+			db->db_nhops[db->db_nnhops++] = nh;
+		}
+		db->db_lastnh = i;
+	}
+
+	dp = &db->db_pfx[db->db_npfx++];
+	dp->dp_start = plen == 0 ? 0 : addr & (0xffffffffU << (32 - plen));
+	dp->dp_end = dp->dp_start | (plen == 32 ? 0 :
+	    0xffffffffU >> plen);
+	dp->dp_plen = plen;
+	dp->dp_nh = i;
+	return (0);
+}
+
+static int
+dxr_prefix_cmp(const void *a, const void *b)
+{
+	const struct dxr_prefix *pa = a, *pb = b;
+
+	if (pa->dp_start != pb->dp_start)
+		return (pa->dp_start < pb->dp_start ? -1 : 1);
+	return ((int)pa->dp_plen - (int)pb->dp_plen);
+}
+
+static void
+dxr_emit(struct dxr_ival *iv, size_t *niv, uint64_t start, uint16_t nh)
+{
+
+	if (*niv > 0 && iv[*niv - 1].di_nh == nh)
+		return;
+	if (*niv > 0 && iv[*niv - 1].di_start == start) {
+		/* Empty predecessor, overwrite it. */
+		iv[*niv - 1].di_nh = nh;
+		if (*niv > 1 && iv[*niv - 2].di_nh == nh)
+			(*niv)--;
+		return;
+	}
+	iv[*niv].di_start = start;
+	iv[*niv].di_nh = nh;
+	(*niv)++;
+}
+
+/*
+ * Turn the sorted prefix list into the list of address ranges at which
+ * the longest match changes.  Prefixes either nest or are disjoint, so
+ * a stack of the enclosing ones is enough.
+ */
+static size_t
+dxr_flatten(const struct dxr_prefix *pfx, size_t npfx, struct dxr_ival *iv)
+{
+	const struct dxr_prefix *stack[33];
+	size_t i, niv;
+	int sp;
+
+	niv = 0;
+	sp = 0;
+	dxr_emit(iv, &niv, 0, 0);
+	for (i = 0; i < npfx; i++) {
+		while (sp > 0 && stack[sp - 1]->dp_end < pfx[i].dp_start) {
+			sp--;
+			dxr_emit(iv, &niv, (uint64_t)stack[sp]->dp_end + 1,
+			    sp > 0 ? stack[sp - 1]->dp_nh : 0);
+		}
+		dxr_emit(iv, &niv, pfx[i].dp_start, pfx[i].dp_nh);
+		stack[sp++] = &pfx[i];
+	}
+	while (sp > 0) {
+		sp--;
+		if (stack[sp]->dp_end == 0xffffffffU)
+			break;
+		dxr_emit(iv, &niv, (uint64_t)stack[sp]->dp_end + 1,
+		    sp > 0 ? stack[sp - 1]->dp_nh : 0);
+	}
+	return (niv);
+}
+
+/*
+ * Lay the ranges out over the direct table.  Called once with dt == NULL
+ * to size the range array, then again to fill it in.  Returns -1 if a
+ * chunk holds more ranges than dd_nranges can count.
+ */
+static ssize_t
+dxr_chunk(const struct dxr_ival *iv, size_t niv, struct fib4_dxr *dt)
+{
+	struct dxr_direct *dd;
+	struct dxr_range *dr;
+	size_t i, j, nranges;
+	uint32_t c, cstart, cend;
+
+	nranges = 0;
+	i = 0;
+	for (c = 0; c < DXR_DCHUNKS; c++) {
+		cstart = c << DXR_DSHIFT;
+		cend = cstart | DXR_RMASK;
+		while (i + 1 < niv && iv[i + 1].di_start <= cstart)
+			i++;
+		for (j = i; j + 1 < niv && iv[j + 1].di_start <= cend; j++)
+			;
+		if (j - i + 1 > UINT16_MAX)
+			return (-1);
+		if (dt == NULL) {
+			if (j > i)
+				nranges += j - i + 1;
+			continue;
+		}
+		dd = &dt->dt_direct[c];
+		dd->dd_base = nranges;
+		dd->dd_nh = iv[i].di_nh;
+		dd->dd_nranges = 0;
+		if (j == i)
+			continue;
+		dd->dd_nranges = j - i + 1;
+		dr = &dt->dt_ranges[nranges];
+		dr->dr_start = 0;
+		dr->dr_nh = iv[i].di_nh;
+		for (dr++, i++; i <= j; i++, dr++) {
+			dr->dr_start = iv[i].di_start & DXR_RMASK;
+			dr->dr_nh = iv[i].di_nh;
+		}
+		nranges += dd->dd_nranges;
+		i = j;
+	}
+	return (nranges);
+}
+
+/*
+ * Every nexthop but the "no route" one at index 0 holds a reference on
+ * its interface, so a table that outlives the routes it was built from
+ * never points to a freed ifnet.
+ */
+static void
+dxr_nhops_rele(struct dxr_nhop *nhops, u_int nnhops)
+{
+	u_int i;
+
+	for (i = 1; i < nnhops; i++)
+		if_rele(nhops[i].nh_ifp);
+}
+
+static struct fib4_dxr *
+fib4_dxr_build(struct rib_head *rh)
+{
+	RIB_RLOCK_TRACKER;
+	struct dxr_build db;
+	struct dxr_ival *iv;
+	struct fib4_dxr *dt;
+	size_t count, niv;
+	ssize_t nranges;
+	u_int gen;
+	int error;
+
+	if (rh->rnh_multipath)
+		return (NULL);
+
+	bzero(&db, sizeof(db));
+	db.db_nhops = malloc(DXR_MAX_NHOPS * sizeof(*db.db_nhops), M_DXR,
+	    M_WAITOK | M_ZERO);
+	dt = NULL;
+	iv = NULL;
+	do {
+		count = 0;
+		RIB_RLOCK(rh);
+		rh->rnh_walktree(&rh->head, dxr_walk_count, &count);
+		RIB_RUNLOCK(rh);
+
+		free(db.db_pfx, M_DXR);
+		dxr_nhops_rele(db.db_nhops, db.db_nnhops);
+		db.db_maxpfx = count + count / 8 + 16;
+		db.db_pfx = malloc(db.db_maxpfx * sizeof(*db.db_pfx), M_DXR,
+		    M_WAITOK);
+		db.db_npfx = 0;
+		db.db_nnhops = 1;	/* 0 is "no route" */
+		db.db_lastnh = 0;
+
+		RIB_RLOCK(rh);
+		gen = rh->rnh_gen;
+		error = rh->rnh_walktree(&rh->head, dxr_walk_collect, &db);
+		RIB_RUNLOCK(rh);
+	} while (error == EAGAIN);
+	if (error != 0)
+		goto out;
+
+	qsort(db.db_pfx, db.db_npfx, sizeof(*db.db_pfx), dxr_prefix_cmp);
+	iv = malloc((2 * db.db_npfx + 1) * sizeof(*iv), M_DXR, M_WAITOK);
+	niv = dxr_flatten(db.db_pfx, db.db_npfx, iv);
+	nranges = dxr_chunk(iv, niv, NULL);
+	if (nranges < 0)
+		goto out;
+
+	dt = malloc(sizeof(*dt) + db.db_nnhops * sizeof(struct dxr_nhop) +
+	    nranges * sizeof(struct dxr_range), M_DXR, M_WAITOK | M_ZERO);
+	dt->dt_gen = gen;
+	dt->dt_nnhops = db.db_nnhops;
+	dt->dt_nranges = nranges;
+	dt->dt_nhops = (struct dxr_nhop *)(dt + 1);
+	dt->dt_ranges = (struct dxr_range *)(dt->dt_nhops + db.db_nnhops);
+	bcopy(db.db_nhops, dt->dt_nhops, db.db_nnhops * sizeof(struct dxr_nhop));
+	db.db_nnhops = 1;	/* The references now belong to dt. */
+	dxr_chunk(iv, niv, dt);
+out:
+	dxr_nhops_rele(db.db_nhops, db.db_nnhops);
+	free(iv, M_DXR);
+	free(db.db_pfx, M_DXR);
+	free(db.db_nhops, M_DXR);
+	return (dt);
+}
+
+static void
+fib4_dxr_free_deferred(epoch_context_t ctx)
+{
+	struct fib4_dxr *dt;
+
+	dt = __containerof(ctx, struct fib4_dxr, dt_epoch_ctx);
+	dxr_nhops_rele(dt->dt_nhops, dt->dt_nnhops);
+	free(dt, M_DXR);
+}
+
+static void
+fib4_dxr_publish(struct fib4_dxr_ctl *dc, struct fib4_dxr *dt)
+{
+	struct fib4_dxr *old;
+
+	old = dc->dc_table;
+	ck_pr_fence_store();
+	ck_pr_store_ptr(&dc->dc_table, dt);
+	if (old != NULL)
+		epoch_call(net_epoch_preempt, &old->dt_epoch_ctx,
+		    fib4_dxr_free_deferred);
+}
+
+static void
+fib4_dxr_rebuild_task(void *arg, int pending __unused)
+{
+	struct fib4_dxr_ctl *dc = arg;
+	struct rib_head *rh;
+	struct fib4_dxr *dt;
+
+	CURVNET_SET(dc->dc_vnet);
+	/* Route changes from here on schedule another pass. */
+	atomic_store_rel_int(&dc->dc_pending, 0);
+	rh = rt_tables_get_rnh(dc->dc_fibnum, AF_INET);
+	if (V_fib4_dxr_enable && rh != NULL) {
+		dt = fib4_dxr_build(rh);
+		if (dt != NULL) {
+			fib4_dxr_publish(dc, dt);
+			V_fib4_dxr_rebuilds++;
+		} else
+			V_fib4_dxr_failures++;
+	}
+	CURVNET_RESTORE();
+}
+
+static void
+fib4_dxr_schedule(struct fib4_dxr_ctl *dc)
+{
+
+	if (atomic_cmpset_int(&dc->dc_pending, 0, 1))
+		taskqueue_enqueue_timeout(taskqueue_thread, &dc->dc_task,
+		    max(1, V_fib4_dxr_delay * hz / 1000));
+}
+
+/*
+ * Lockless counterpart of the radix lookup in fib4_lookup_nh_basic().
+ * Returns EAGAIN if there is no up to date table for the fib.
+ */
+static int
+fib4_dxr_lookup(uint32_t fibnum, struct rib_head *rh, struct in_addr dst,
+    struct nhop4_basic *pnh4)
+{
+	struct fib4_dxr_ctl *dc;
+	struct fib4_dxr *dt;
+	const struct dxr_direct *dd;
+	const struct dxr_range *dr;
+	const struct dxr_nhop *nh;
+	uint32_t addr, key;
+	u_int lo, hi, mid;
+	int error;
+	NET_EPOCH_ENTER();
+
+	dc = &V_fib4_dxr_ctl[fibnum];
+	dt = ck_pr_load_ptr(&dc->dc_table);
+	if (dt == NULL || dt->dt_gen != rh->rnh_gen) {
+		NET_EPOCH_EXIT();
+		fib4_dxr_schedule(dc);
+		return (EAGAIN);
+	}
+
+	addr = ntohl(dst.s_addr);
+	dd = &dt->dt_direct[addr >> DXR_DSHIFT];
+	if (dd->dd_nranges == 0)
+		nh = &dt->dt_nhops[dd->dd_nh];
+	else {
+		dr = dt->dt_ranges;
+		key = addr & DXR_RMASK;
+		lo = dd->dd_base;
+		hi = lo + dd->dd_nranges - 1;
+		while (lo < hi) {
+			mid = (lo + hi + 1) / 2;
+			if (dr[mid].dr_start <= key)
+				lo = mid;
+			else
+				hi = mid - 1;
+		}
+		nh = &dt->dt_nhops[dr[lo].dr_nh];
+	}
+
+	/* Same semantics as the radix path: a down link means no route. */
+	if (nh->nh_ifp == NULL || !RT_LINK_IS_UP(nh->nh_ifp))
+		error = ENOENT;
+	else {
+		pnh4->nh_ifp = nh->nh_ifp;
+		pnh4->nh_mtu = min(nh->nh_mtu, nh->nh_ifp->if_mtu);
+		pnh4->nh_flags = nh->nh_flags;
+		pnh4->nh_addr = (nh->nh_flags & NHF_GATEWAY) ? nh->nh_gw : dst;
+		error = 0;
+	}
+	NET_EPOCH_EXIT();
+	return (error);
+}
+
+static int
+sysctl_fib4_dxr_enable(SYSCTL_HANDLER_ARGS)
+{
+	struct fib4_dxr_ctl *dc;
+	uint32_t fibnum;
+	int error, enable;
+
+	enable = V_fib4_dxr_enable;
+	error = sysctl_handle_int(oidp, &enable, 0, req);
+	if (error != 0 || req->newptr == NULL)
+		return (error);
+	V_fib4_dxr_enable = enable != 0;
+	for (fibnum = 0; fibnum < rt_numfibs; fibnum++) {
+		dc = &V_fib4_dxr_ctl[fibnum];
+		if (V_fib4_dxr_enable)
+			fib4_dxr_schedule(dc);
+		else {
+			taskqueue_cancel_timeout(taskqueue_thread,
+			    &dc->dc_task, NULL);
+			taskqueue_drain_timeout(taskqueue_thread, &dc->dc_task);
+			atomic_store_rel_int(&dc->dc_pending, 0);
+			fib4_dxr_publish(dc, NULL);
+		}
+	}
+	return (0);
+}
+
+static void
+vnet_fib4_dxr_init(const void *unused __unused)
+{
+	struct fib4_dxr_ctl *dc;
+	uint32_t fibnum;
+
+	V_fib4_dxr_ctl = malloc(rt_numfibs * sizeof(*V_fib4_dxr_ctl), M_DXR,
+	    M_WAITOK | M_ZERO);
+	for (fibnum = 0; fibnum < rt_numfibs; fibnum++) {
+		dc = &V_fib4_dxr_ctl[fibnum];
+		dc->dc_vnet = curvnet;
+		dc->dc_fibnum = fibnum;
+		TIMEOUT_TASK_INIT(taskqueue_thread, &dc->dc_task, 0,
+		    fib4_dxr_rebuild_task, dc);
+	}
+}
+VNET_SYSINIT(vnet_fib4_dxr_init, SI_SUB_PROTO_DOMAIN, SI_ORDER_ANY,
+    vnet_fib4_dxr_init, NULL);
+
+static void
+vnet_fib4_dxr_uninit(const void *unused __unused)
+{
+	struct fib4_dxr_ctl *dc;
+	uint32_t fibnum;
+
+	V_fib4_dxr_enable = 0;
+	for (fibnum = 0; fibnum < rt_numfibs; fibnum++) {
+		dc = &V_fib4_dxr_ctl[fibnum];
+		taskqueue_cancel_timeout(taskqueue_thread, &dc->dc_task, NULL);
+		taskqueue_drain_timeout(taskqueue_thread, &dc->dc_task);
+		fib4_dxr_publish(dc, NULL);
+	}
+	free(V_fib4_dxr_ctl, M_DXR);
+}
+VNET_SYSUNINIT(vnet_fib4_dxr_uninit, SI_SUB_PROTO_DOMAIN, SI_ORDER_ANY,
+    vnet_fib4_dxr_uninit, NULL);
+
 static void
 fib4_rte_to_nh_basic(struct rtentry *rte, struct in_addr dst,
     uint32_t flags, struct nhop4_basic *pnh4)
@@ -139,12 +696,19 @@ fib4_lookup_nh_basic(uint32_t fibnum, struct in_addr dst, uint32_t flags,
 	struct radix_node *rn;
 	struct sockaddr_in sin;
 	struct rtentry *rte;
+	int error;
 
 	KASSERT((fibnum < rt_numfibs), ("fib4_lookup_nh_basic: bad fibnum"));
 	rh = rt_tables_get_rnh(fibnum, AF_INET);
 	if (rh == NULL)
 		return (ENOENT);
 
+	if (V_fib4_dxr_enable && (flags & NHR_IFAIF) == 0) {
+		error = fib4_dxr_lookup(fibnum, rh, dst, pnh4);
+		if (error != EAGAIN)
+			return (error);
+	}
+
 	/* Prepare lookup key */
 	memset(&sin, 0, sizeof(sin));
 	sin.sin_len = sizeof(struct sockaddr_in);
@@ -68,6 +68,7 @@ __FBSDID("$FreeBSD$");
 #include <sys/jail.h>
 #include <sys/kernel.h>
 #include <sys/sysctl.h>
+#include <sys/taskqueue.h>
 
 #ifdef DDB
 #include <ddb/ddb.h>
@@ -111,6 +112,14 @@ __FBSDID("$FreeBSD$");
 #define	INPCBLBGROUP_SIZMIN	8
 #define	INPCBLBGROUP_SIZMAX	256
 
+/*
+ * Connection hash tables are grown once they hold more than this many
+ * entries per bucket on average; buckets are copied into the new table
+ * this many at a time under the hash lock.
+ */
+#define	INP_HASH_MIGRATE_CHUNK	128
+int	in_pcbhash_maxload = 2;
+
 static struct callout	ipport_tick_callout;
 
 /*
@@ -143,6 +152,10 @@ VNET_DEFINE_STATIC(int, ipport_tcplastcount);
 #define	V_ipport_tcplastcount		VNET(ipport_tcplastcount)
 
 static void	in_pcbremlists(struct inpcb *inp);
+static void	in_pcbhash_insert(struct inpcbinfo *pcbinfo, struct inpcb *inp,
+		    u_int32_t hashkey_faddr);
+static void	in_pcbhash_remove(struct inpcbinfo *pcbinfo, struct inpcb *inp);
+static void	in_pcbhash_grow_task(void *arg, int pending);
 #ifdef INET
 static struct inpcb	*in_pcblookup_hash_locked(struct inpcbinfo *pcbinfo,
 			    struct in_addr faddr, u_int fport_arg,
@@ -467,8 +480,11 @@ in_pcbinfo_init(struct inpcbinfo *pcbinfo, const char *name,
 	pcbinfo->ipi_listhead = listhead;
 	CK_LIST_INIT(pcbinfo->ipi_listhead);
 	pcbinfo->ipi_count = 0;
-	pcbinfo->ipi_hashbase = hashinit(hash_nelements, M_PCB,
-	    &pcbinfo->ipi_hashmask);
+	pcbinfo->ipi_hash = malloc(sizeof(struct inpcbhash), M_PCB,
+	    M_WAITOK | M_ZERO);
+	pcbinfo->ipi_hash->ih_base = hashinit(hash_nelements, M_PCB,
+	    &pcbinfo->ipi_hash->ih_mask);
+	TASK_INIT(&pcbinfo->ipi_hash_task, 0, in_pcbhash_grow_task, pcbinfo);
 	pcbinfo->ipi_porthashbase = hashinit(porthash_nelements, M_PCB,
 	    &pcbinfo->ipi_porthashmask);
 	pcbinfo->ipi_lbgrouphashbase = hashinit(hash_nelements, M_PCB,
@@ -493,7 +509,10 @@ in_pcbinfo_destroy(struct inpcbinfo *pcbinfo)
 	KASSERT(pcbinfo->ipi_count == 0,
 	    ("%s: ipi_count = %u", __func__, pcbinfo->ipi_count));
 
-	hashdestroy(pcbinfo->ipi_hashbase, M_PCB, pcbinfo->ipi_hashmask);
+	taskqueue_drain(taskqueue_thread, &pcbinfo->ipi_hash_task);
+	hashdestroy(pcbinfo->ipi_hash->ih_base, M_PCB,
+	    pcbinfo->ipi_hash->ih_mask);
+	free(pcbinfo->ipi_hash, M_PCB);
 	hashdestroy(pcbinfo->ipi_porthashbase, M_PCB,
 	    pcbinfo->ipi_porthashmask);
 	hashdestroy(pcbinfo->ipi_lbgrouphashbase, M_PCB,
@@ -1694,7 +1713,7 @@ in_pcbdrop(struct inpcb *inp)
 
 		INP_HASH_WLOCK(inp->inp_pcbinfo);
 		in_pcbremlbgrouphash(inp);
-		CK_LIST_REMOVE(inp, inp_hash);
+		in_pcbhash_remove(inp->inp_pcbinfo, inp);
 		CK_LIST_REMOVE(inp, inp_portlist);
 		if (CK_LIST_FIRST(&phd->phd_pcblist) == NULL) {
 			CK_LIST_REMOVE(phd, phd_hash);
@@ -1857,14 +1876,15 @@ in_pcblookup_local(struct inpcbinfo *pcbinfo, struct in_addr laddr,
 	INP_HASH_LOCK_ASSERT(pcbinfo);
 
 	if ((lookupflags & INPLOOKUP_WILDCARD) == 0) {
+		struct inpcbhash *ih;
 		struct inpcbhead *head;
 		/*
 		 * Look for an unconnected (wildcard foreign addr) PCB that
 		 * matches the local address and port we're looking for.
 		 */
-		head = &pcbinfo->ipi_hashbase[INP_PCBHASH(INADDR_ANY, lport,
-		    0, pcbinfo->ipi_hashmask)];
-		CK_LIST_FOREACH(inp, head, inp_hash) {
+		ih = INP_HASH_TABLE(pcbinfo);
+		head = INP_HASH_HEAD(ih, INADDR_ANY, lport, 0);
+		INP_HASH_FOREACH(inp, ih, head) {
 #ifdef INET6
 			/* XXX inp locking */
 			if ((inp->inp_vflag & INP_IPV4) == 0)
@@ -2246,6 +2266,7 @@ in_pcblookup_hash_locked(struct inpcbinfo *pcbinfo, struct in_addr faddr,
     u_int fport_arg, struct in_addr laddr, u_int lport_arg, int lookupflags,
     struct ifnet *ifp)
 {
+	struct inpcbhash *ih;
 	struct inpcbhead *head;
 	struct inpcb *inp, *tmpinp;
 	u_short fport = fport_arg, lport = lport_arg;
@@ -2260,9 +2281,9 @@ in_pcblookup_hash_locked(struct inpcbinfo *pcbinfo, struct in_addr faddr,
 	 * First look for an exact match.
 	 */
 	tmpinp = NULL;
-	head = &pcbinfo->ipi_hashbase[INP_PCBHASH(faddr.s_addr, lport, fport,
-	    pcbinfo->ipi_hashmask)];
-	CK_LIST_FOREACH(inp, head, inp_hash) {
+	ih = INP_HASH_TABLE(pcbinfo);
+	head = INP_HASH_HEAD(ih, faddr.s_addr, lport, fport);
+	INP_HASH_FOREACH(inp, ih, head) {
 #ifdef INET6
 		/* XXX inp locking */
 		if ((inp->inp_vflag & INP_IPV4) == 0)
@@ -2317,9 +2338,8 @@ in_pcblookup_hash_locked(struct inpcbinfo *pcbinfo, struct in_addr faddr,
 		 *      4. non-jailed, wild.
 		 */
 
-		head = &pcbinfo->ipi_hashbase[INP_PCBHASH(INADDR_ANY, lport,
-		    0, pcbinfo->ipi_hashmask)];
-		CK_LIST_FOREACH(inp, head, inp_hash) {
+		head = INP_HASH_HEAD(ih, INADDR_ANY, lport, 0);
+		INP_HASH_FOREACH(inp, ih, head) {
 #ifdef INET6
 			/* XXX inp locking */
 			if ((inp->inp_vflag & INP_IPV4) == 0)
@@ -2499,13 +2519,185 @@ in_pcblookup_mbuf(struct inpcbinfo *pcbinfo, struct in_addr faddr,
 }
 #endif /* INET */
 
+/*
+ * Link an inpcb onto the connection hash.  While the table is being grown
+ * the entry goes onto the replacement table as well, and is marked so the
+ * migration in in_pcbhash_grow_task() will not copy it a second time.
+ */
+static void
+in_pcbhash_insert(struct inpcbinfo *pcbinfo, struct inpcb *inp,
+    u_int32_t hashkey_faddr)
+{
+	struct inpcbhash *ih;
+
+	INP_HASH_WLOCK_ASSERT(pcbinfo);
+
+	ih = pcbinfo->ipi_hash;
+	CK_LIST_INSERT_HEAD(INP_HASH_HEAD(ih, hashkey_faddr, inp->inp_lport,
+	    inp->inp_fport), inp, inp_hashl[ih->ih_link]);
+	inp->inp_hashgen = ih->ih_gen;
+	ih = pcbinfo->ipi_hash_next;
+	if (ih != NULL) {
+		CK_LIST_INSERT_HEAD(INP_HASH_HEAD(ih, hashkey_faddr,
+		    inp->inp_lport, inp->inp_fport), inp,
+		    inp_hashl[ih->ih_link]);
+		inp->inp_hashgen = ih->ih_gen;
+	}
+}
+
+static void
+in_pcbhash_remove(struct inpcbinfo *pcbinfo, struct inpcb *inp)
+{
+	struct inpcbhash *ih;
+
+	INP_HASH_WLOCK_ASSERT(pcbinfo);
+
+	ih = pcbinfo->ipi_hash;
+	CK_LIST_REMOVE(inp, inp_hashl[ih->ih_link]);
+	ih = pcbinfo->ipi_hash_next;
+	if (ih != NULL && inp->inp_hashgen == ih->ih_gen)
+		CK_LIST_REMOVE(inp, inp_hashl[ih->ih_link]);
+}
+
+static int
+in_pcbhash_overloaded(struct inpcbinfo *pcbinfo)
+{
+	u_long nbuckets;
+
+	INP_HASH_WLOCK_ASSERT(pcbinfo);
+
+	if (in_pcbhash_maxload <= 0 || pcbinfo->ipi_hash_next != NULL)
+		return (0);
+	nbuckets = pcbinfo->ipi_hash->ih_mask + 1;
+	return (nbuckets * 2 <= (u_long)maxsockets &&
+	    pcbinfo->ipi_count > nbuckets * in_pcbhash_maxload);
+}
+
+/*
+ * Replace an overloaded connection hash with one twice the size.  Lookups
+ * keep using the current table throughout; its entries are linked onto the
+ * new one through their spare linkage a chunk of buckets at a time, with
+ * the hash lock dropped in between so that connection setup and teardown
+ * are never held off for long.  Once every bucket is copied the new table
+ * is published and the old one is freed after the epoch drains.
+ *
+ * The wait for the epoch is synchronous: the next grow links entries
+ * through the linkage the old table used, so it must not start while a
+ * reader may still be walking the old chains.
+ */
+static void
+in_pcbhash_grow_task(void *arg, int pending __unused)
+{
+	struct inpcbinfo *pcbinfo = arg;
+	struct inpcbhash *ih, *nih;
+	struct inpcb *inp;
+	u_int32_t hashkey_faddr;
+	u_long i, end;
+
+	INP_HASH_WLOCK(pcbinfo);
+	if (!in_pcbhash_overloaded(pcbinfo)) {
+		INP_HASH_WUNLOCK(pcbinfo);
+		return;
+	}
+	ih = pcbinfo->ipi_hash;
+	INP_HASH_WUNLOCK(pcbinfo);
+
+	/* Only this task replaces ipi_hash, so ih stays current. */
+	nih = malloc(sizeof(*nih), M_PCB, M_WAITOK | M_ZERO);
+	nih->ih_base = hashinit(2 * (ih->ih_mask + 1), M_PCB, &nih->ih_mask);
+	nih->ih_link = !ih->ih_link;
+	nih->ih_gen = ih->ih_gen + 1;
+
+	INP_HASH_WLOCK(pcbinfo);
+	pcbinfo->ipi_hash_next = nih;
+	for (i = 0; i <= ih->ih_mask; ) {
+		end = MIN(i + INP_HASH_MIGRATE_CHUNK, ih->ih_mask + 1);
+		for (; i < end; i++) {
+			INP_HASH_FOREACH(inp, ih, &ih->ih_base[i]) {
+				if (inp->inp_hashgen == nih->ih_gen)
+					continue;
+#ifdef INET6
+				if (inp->inp_vflag & INP_IPV6)
+					hashkey_faddr =
+					    INP6_PCBHASHKEY(&inp->in6p_faddr);
+				else
+#endif
+				hashkey_faddr = inp->inp_faddr.s_addr;
+				CK_LIST_INSERT_HEAD(INP_HASH_HEAD(nih,
+				    hashkey_faddr, inp->inp_lport,
+				    inp->inp_fport), inp,
+				    inp_hashl[nih->ih_link]);
+				inp->inp_hashgen = nih->ih_gen;
+			}
+		}
+		INP_HASH_WUNLOCK(pcbinfo);
+		maybe_yield();
+		INP_HASH_WLOCK(pcbinfo);
+	}
+	ck_pr_fence_store();
+	ck_pr_store_ptr(&pcbinfo->ipi_hash, nih);
+	pcbinfo->ipi_hash_next = NULL;
+	pcbinfo->ipi_hash_resizes++;
+	INP_HASH_WUNLOCK(pcbinfo);
+	epoch_wait_preempt(net_epoch_preempt);
+	/* The chains still carry stale linkage, so no hashdestroy(). */
+	free(ih->ih_base, M_PCB);
+	free(ih, M_PCB);
+}
+
+/*
+ * Report on the shape of a connection hash.  The chain walk runs inside
+ * the epoch, so it sees a consistent table but not a consistent snapshot
+ * of the connections on it.
+ */
+int
+in_pcbhash_sysctl(struct inpcbinfo *pcbinfo, int stat, struct sysctl_req *req)
+{
+	struct epoch_tracker et;
+	struct inpcbhash *ih;
+	struct inpcb *inp;
+	u_long chains[INP_HASHSTAT_NCHAINS];
+	u_long buckets, len, maxchain, i;
+
+	if (stat == INP_HASHSTAT_RESIZES) {
+		buckets = pcbinfo->ipi_hash_resizes;
+		return (SYSCTL_OUT(req, &buckets, sizeof(buckets)));
+	}
+
+	bzero(chains, sizeof(chains));
+	maxchain = 0;
+	INP_HASH_RLOCK_ET(pcbinfo, et);
+	ih = INP_HASH_TABLE(pcbinfo);
+	buckets = ih->ih_mask + 1;
+	if (stat != INP_HASHSTAT_BUCKETS) {
+		for (i = 0; i < buckets; i++) {
+			len = 0;
+			INP_HASH_FOREACH(inp, ih, &ih->ih_base[i])
+				len++;
+			chains[MIN(len, INP_HASHSTAT_NCHAINS - 1)]++;
+			maxchain = MAX(maxchain, len);
+		}
+	}
+	INP_HASH_RUNLOCK_ET(pcbinfo, et);
+
+	switch (stat) {
+	case INP_HASHSTAT_BUCKETS:
+		return (SYSCTL_OUT(req, &buckets, sizeof(buckets)));
+	case INP_HASHSTAT_MAXCHAIN:
+		return (SYSCTL_OUT(req, &maxchain, sizeof(maxchain)));
+	case INP_HASHSTAT_CHAINS:
+		return (SYSCTL_OUT(req, chains, sizeof(chains)));
+	default:
+		return (EINVAL);
+	}
+}
+
 /*
  * Insert PCB onto various hash lists.
  */
 static int
 in_pcbinshash_internal(struct inpcb *inp, int do_pcbgroup_update)
 {
-	struct inpcbhead *pcbhash;
 	struct inpcbporthead *pcbporthash;
 	struct inpcbinfo *pcbinfo = inp->inp_pcbinfo;
 	struct inpcbport *phd;
@@ -2525,9 +2717,6 @@ in_pcbinshash_internal(struct inpcb *inp, int do_pcbgroup_update)
 #endif
 	hashkey_faddr = inp->inp_faddr.s_addr;
 
-	pcbhash = &pcbinfo->ipi_hashbase[INP_PCBHASH(hashkey_faddr,
-		 inp->inp_lport, inp->inp_fport, pcbinfo->ipi_hashmask)];
-
 	pcbporthash = &pcbinfo->ipi_porthashbase[
 	    INP_PCBPORTHASH(inp->inp_lport, pcbinfo->ipi_porthashmask)];
 
@@ -2566,8 +2755,10 @@ in_pcbinshash_internal(struct inpcb *inp, int do_pcbgroup_update)
 	}
 	inp->inp_phd = phd;
 	CK_LIST_INSERT_HEAD(&phd->phd_pcblist, inp, inp_portlist);
-	CK_LIST_INSERT_HEAD(pcbhash, inp, inp_hash);
+	in_pcbhash_insert(pcbinfo, inp, hashkey_faddr);
 	inp->inp_flags |= INP_INHASHLIST;
+	if (in_pcbhash_overloaded(pcbinfo))
+		taskqueue_enqueue(taskqueue_thread, &pcbinfo->ipi_hash_task);
 #ifdef PCBGROUP
 	if (do_pcbgroup_update)
 		in_pcbgroup_update(inp);
@@ -2610,7 +2801,6 @@ void
 in_pcbrehash_mbuf(struct inpcb *inp, struct mbuf *m)
 {
 	struct inpcbinfo *pcbinfo = inp->inp_pcbinfo;
-	struct inpcbhead *head;
 	u_int32_t hashkey_faddr;
 
 	INP_WLOCK_ASSERT(inp);
@@ -2626,11 +2816,8 @@ in_pcbrehash_mbuf(struct inpcb *inp, struct mbuf *m)
 #endif
 	hashkey_faddr = inp->inp_faddr.s_addr;
 
-	head = &pcbinfo->ipi_hashbase[INP_PCBHASH(hashkey_faddr,
-		inp->inp_lport, inp->inp_fport, pcbinfo->ipi_hashmask)];
-
-	CK_LIST_REMOVE(inp, inp_hash);
-	CK_LIST_INSERT_HEAD(head, inp, inp_hash);
+	in_pcbhash_remove(pcbinfo, inp);
+	in_pcbhash_insert(pcbinfo, inp, hashkey_faddr);
 
 #ifdef PCBGROUP
 	if (m != NULL)
@@ -2675,7 +2862,7 @@ in_pcbremlists(struct inpcb *inp)
 		/* XXX: Only do if SO_REUSEPORT_LB set? */
 		in_pcbremlbgrouphash(inp);
 
-		CK_LIST_REMOVE(inp, inp_hash);
+		in_pcbhash_remove(pcbinfo, inp);
 		CK_LIST_REMOVE(inp, inp_portlist);
 		if (CK_LIST_FIRST(&phd->phd_pcblist) == NULL) {
 			CK_LIST_REMOVE(phd, phd_hash);
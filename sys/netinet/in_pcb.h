@@ -45,6 +45,7 @@
 #include <sys/_lock.h>
 #include <sys/_mutex.h>
 #include <sys/_rwlock.h>
+#include <sys/_task.h>
 #include <net/route.h>
 
 #ifdef _KERNEL
@@ -235,7 +236,7 @@ struct inpcbpolicy;
 struct m_snd_tag;
 struct inpcb {
 	/* Cache line #1 (amd64) */
-	CK_LIST_ENTRY(inpcb) inp_hash;	/* [w](h/i) [r](e/i)  hash list */
+	CK_LIST_ENTRY(inpcb) inp_hashl[2]; /* [w](h/i) [r](e/i) hash lists */
 	CK_LIST_ENTRY(inpcb) inp_pcbgrouphash;	/* (g/i) hash list */
 	struct rwlock	inp_lock;
 	/* Cache line #2 (amd64) */
@@ -266,6 +267,7 @@ struct inpcb {
 	u_int	inp_refcount;		/* (i) refcount */
 	int	inp_flags;		/* (i) generic IP/datagram flags */
 	int	inp_flags2;		/* (i) generic IP/datagram flags #2*/
+	u_int	inp_hashgen;		/* (h) newest hash table linked on */
 	volatile uint16_t  inp_input_cpu; /* Lock (i) */
 	volatile uint8_t inp_hpts_cpu_set :1,  /* on output hpts (i) */
 			 inp_input_cpu_set : 1,	/* on input hpts (i) */
@@ -411,6 +413,19 @@ struct inpcbport {
 	u_short phd_port;
 };
 
+/*
+ * Connection hash table.  Every inpcb carries two hash linkages so that a
+ * replacement table can be populated through the spare one while lookups
+ * keep walking the current table; ih_link names the linkage this table
+ * uses and ih_gen lets writers tell which tables an inpcb is on.
+ */
+struct inpcbhash {
+	struct inpcbhead *ih_base;
+	u_long ih_mask;
+	u_int ih_link;
+	u_int ih_gen;
+};
+
 struct in_pcblist {
 	int il_count;
 	struct epoch_context il_epoch_ctx;
@@ -492,10 +507,13 @@ struct inpcbinfo {
 
 	/*
 	 * Global hash of inpcbs, hashed by local and foreign addresses and
-	 * port numbers.
+	 * port numbers.  While the table is being grown, ipi_hash_next is
+	 * the replacement that in_pcbhash_grow_task() is copying into.
 	 */
-	struct inpcbhead	*ipi_hashbase;		/* (h) */
-	u_long			 ipi_hashmask;		/* (h) */
+	struct inpcbhash	*ipi_hash;		/* (h) */
+	struct inpcbhash	*ipi_hash_next;		/* (h) */
+	u_int			 ipi_hash_resizes;	/* (h) */
+	struct task		 ipi_hash_task;		/* (c) */
 
 	/*
 	 * Global hash of inpcbs, hashed by only local port number.
@@ -675,6 +693,8 @@ int	inp_so_options(const struct inpcb *inp);
 #define	INP_HASH_WUNLOCK(ipi)		mtx_unlock(&(ipi)->ipi_hash_lock)
 #define	INP_HASH_LOCK_ASSERT(ipi)	MPASS(in_epoch(net_epoch_preempt) || mtx_owned(&(ipi)->ipi_hash_lock))
 #define	INP_HASH_WLOCK_ASSERT(ipi)	mtx_assert(&(ipi)->ipi_hash_lock, MA_OWNED);
+#define	INP_HASH_TABLE(ipi) \
+	((struct inpcbhash *)ck_pr_load_ptr(&(ipi)->ipi_hash))
 
 #define	INP_GROUP_LOCK_INIT(ipg, d)	mtx_init(&(ipg)->ipg_lock, (d), NULL, \
 					    MTX_DEF | MTX_DUPOK)
@@ -686,6 +706,10 @@ int	inp_so_options(const struct inpcb *inp);
 
 #define INP_PCBHASH(faddr, lport, fport, mask) \
 	(((faddr) ^ ((faddr) >> 16) ^ ntohs((lport) ^ (fport))) & (mask))
+#define INP_HASH_HEAD(ih, faddr, lport, fport) \
+	(&(ih)->ih_base[INP_PCBHASH((faddr), (lport), (fport), (ih)->ih_mask)])
+#define	INP_HASH_FOREACH(inp, ih, head) \
+	CK_LIST_FOREACH((inp), (head), inp_hashl[(ih)->ih_link])
 #define INP_PCBPORTHASH(lport, mask) \
 	(ntohs((lport)) & (mask))
 #define	INP_PCBLBGROUP_PORTHASH(lport, mask) \
@@ -786,6 +810,15 @@ int	inp_so_options(const struct inpcb *inp);
 #define	IPI_HASHFIELDS_2TUPLE	1
 #define	IPI_HASHFIELDS_4TUPLE	2
 
+/*
+ * Statistics reported by in_pcbhash_sysctl().
+ */
+#define	INP_HASHSTAT_BUCKETS	0	/* buckets in the current table */
+#define	INP_HASHSTAT_MAXCHAIN	1	/* longest chain */
+#define	INP_HASHSTAT_RESIZES	2	/* completed table resizes */
+#define	INP_HASHSTAT_CHAINS	3	/* histogram of chain lengths */
+#define	INP_HASHSTAT_NCHAINS	8	/* histogram size, last is "or more" */
+
 #ifdef _KERNEL
 VNET_DECLARE(int, ipport_reservedhigh);
 VNET_DECLARE(int, ipport_reservedlow);
@@ -815,7 +848,10 @@ VNET_DECLARE(int, ipport_tcpallocs);
 #define	V_ipport_stoprandom	VNET(ipport_stoprandom)
 #define	V_ipport_tcpallocs	VNET(ipport_tcpallocs)
 
+extern int	in_pcbhash_maxload;
+
 void	in_pcbinfo_destroy(struct inpcbinfo *);
+int	in_pcbhash_sysctl(struct inpcbinfo *, int, struct sysctl_req *);
 void	in_pcbinfo_init(struct inpcbinfo *, const char *, struct inpcbhead *,
 	    int, int, char *, uma_init, u_int);
 
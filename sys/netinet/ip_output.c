@@ -45,6 +45,7 @@ __FBSDID("$FreeBSD$");
 
 #include <sys/param.h>
 #include <sys/systm.h>
+#include <sys/counter.h>
 #include <sys/kernel.h>
 #include <sys/lock.h>
 #include <sys/malloc.h>
@@ -81,6 +82,7 @@ __FBSDID("$FreeBSD$");
 #include <netinet/ip_var.h>
 #include <netinet/ip_options.h>
 
+#include <netinet/tcp.h>
 #include <netinet/udp.h>
 #include <netinet/udp_var.h>
 
@@ -101,6 +103,31 @@ SYSCTL_INT(_net_inet_ip, OID_AUTO, mbuf_frag_size, CTLFLAG_RW,
 	&mbuf_frag_size, 0, "Fragment outgoing mbufs to this size");
 #endif
 
+VNET_DEFINE(int, ip_gso) = 1;
+
+static SYSCTL_NODE(_net_inet_ip, OID_AUTO, gso, CTLFLAG_RW, 0,
+    "Software TCP segmentation offload");
+SYSCTL_INT(_net_inet_ip_gso, OID_AUTO, enable, CTLFLAG_VNET | CTLFLAG_RW,
+    &VNET_NAME(ip_gso), 0,
+    "Let TCP send TSO-sized packets to interfaces without TSO support");
+
+static counter_u64_t ip_gso_packets;
+SYSCTL_COUNTER_U64(_net_inet_ip_gso, OID_AUTO, packets, CTLFLAG_RD,
+    &ip_gso_packets, "Packets segmented in software");
+static counter_u64_t ip_gso_segments;
+SYSCTL_COUNTER_U64(_net_inet_ip_gso, OID_AUTO, segments, CTLFLAG_RD,
+    &ip_gso_segments, "Segments produced by software segmentation");
+
+static void
+ip_gso_init(void *arg __unused)
+{
+
+	ip_gso_packets = counter_u64_alloc(M_WAITOK);
+	ip_gso_segments = counter_u64_alloc(M_WAITOK);
+}
+SYSINIT(ip_gso_init, SI_SUB_PROTO_DOMAIN, SI_ORDER_ANY, ip_gso_init, NULL);
+
+static int	ip_gso(struct mbuf **, int, u_long);
 static void	ip_mloopback(struct ifnet *, const struct mbuf *, int);
 
 
@@ -225,6 +252,7 @@ ip_output(struct mbuf *m, struct mbuf *opt, struct route *ro, int flags,
 	const struct sockaddr_in *gw;
 	struct in_ifaddr *ia;
 	int isbroadcast;
+	bool gso = false;
 	uint16_t ip_len, ip_off;
 	struct route iproute;
 	struct rtentry *rte;	/* cache for ro->ro_rt */
@@ -599,6 +627,24 @@ ip_output(struct mbuf *m, struct mbuf *opt, struct route *ro, int flags,
 	}
 
 	m->m_pkthdr.csum_flags |= CSUM_IP;
+
+	/*
+	 * TCP handed down a TSO packet but the interface cannot segment
+	 * it, e.g. a tunnel or a NIC without TSO.  Cut it into wire sized
+	 * segments here, before any checksum is computed over the whole.
+	 */
+	if (ip_len > mtu && (m->m_pkthdr.csum_flags & CSUM_TSO) != 0 &&
+	    (ifp->if_hwassist & CSUM_TSO) == 0) {
+		error = ip_gso(&m, mtu, ifp->if_hwassist);
+		if (error) {
+			if (error == EMSGSIZE)
+				IPSTAT_INC(ips_cantfrag);
+			goto bad;
+		}
+		gso = true;
+		goto sendchain;
+	}
+
 	if (m->m_pkthdr.csum_flags & CSUM_DELAY_DATA & ~ifp->if_hwassist) {
 		in_delayed_cksum(m);
 		m->m_pkthdr.csum_flags &= ~CSUM_DELAY_DATA;
@@ -681,6 +727,7 @@ ip_output(struct mbuf *m, struct mbuf *opt, struct route *ro, int flags,
 	error = ip_fragment(ip, &m, mtu, ifp->if_hwassist);
 	if (error)
 		goto bad;
+sendchain:
 	for (; m; m = m0) {
 		m0 = m->m_nextpkt;
 		m->m_nextpkt = 0;
@@ -720,7 +767,7 @@ ip_output(struct mbuf *m, struct mbuf *opt, struct route *ro, int flags,
 			m_freem(m);
 	}
 
-	if (error == 0)
+	if (error == 0 && !gso)
 		IPSTAT_INC(ips_fragmented);
 
 done:
@@ -921,6 +968,117 @@ ip_fragment(struct ip *ip, struct mbuf **m_frag, int mtu,
 	return error;
 }
 
+/*
+ * Segment a TCP packet carrying CSUM_TSO in software.  Each segment gets
+ * a copy of the original IP and TCP headers followed by at most
+ * tso_segsz bytes of payload; the IP length and id, the TCP sequence
+ * number and flags and both checksums are fixed up as the hardware
+ * would.  On success *m_gso points to the list of segments, linked by
+ * m_nextpkt, and the original packet has been freed.  On failure the
+ * caller keeps ownership of *m_gso.
+ */
+static int
+ip_gso(struct mbuf **m_gso, int mtu, u_long if_hwassist_flags)
+{
+	struct mbuf *m0, *m, *mfirst, **mnext;
+	struct ip *ip, *mip;
+	struct tcphdr *th, *mth;
+	int hdrlen, hlen, ip_len, len, nsegs, off, segsz;
+	tcp_seq seq;
+
+	m0 = *m_gso;
+	ip = mtod(m0, struct ip *);
+	hlen = ip->ip_hl << 2;
+	segsz = m0->m_pkthdr.tso_segsz;
+	if (ip->ip_p != IPPROTO_TCP || segsz == 0)
+		return (EMSGSIZE);
+	if (m0->m_len < hlen + sizeof(struct tcphdr)) {
+		m0 = *m_gso = m_pullup(m0, hlen + sizeof(struct tcphdr));
+		if (m0 == NULL)
+			return (ENOBUFS);
+		ip = mtod(m0, struct ip *);
+	}
+	th = (struct tcphdr *)((caddr_t)ip + hlen);
+	hdrlen = hlen + (th->th_off << 2);
+	if (hdrlen + segsz > mtu || hdrlen + max_linkhdr > MHLEN)
+		return (EMSGSIZE);
+	if (m0->m_len < hdrlen) {
+		m0 = *m_gso = m_pullup(m0, hdrlen);
+		if (m0 == NULL)
+			return (ENOBUFS);
+		ip = mtod(m0, struct ip *);
+		th = (struct tcphdr *)((caddr_t)ip + hlen);
+	}
+	ip_len = ntohs(ip->ip_len);
+	seq = ntohl(th->th_seq);
+
+	mfirst = NULL;
+	mnext = &mfirst;
+	for (nsegs = 0, off = hdrlen; off < ip_len; off += len, nsegs++) {
+		len = min(segsz, ip_len - off);
+		m = m_gethdr(M_NOWAIT, MT_DATA);
+		if (m == NULL)
+			goto nobufs;
+		/* Carry over tags, flow id, VLAN and the like, see above. */
+		if (m_dup_pkthdr(m, m0, M_NOWAIT) == 0) {
+			m_free(m);
+			goto nobufs;
+		}
+		m->m_data += max_linkhdr;
+		bcopy(ip, mtod(m, caddr_t), hdrlen);
+		m->m_len = hdrlen;
+		m->m_next = m_copym(m0, off, len, M_NOWAIT);
+		if (m->m_next == NULL) {
+			m_free(m);
+			goto nobufs;
+		}
+		m->m_pkthdr.len = hdrlen + len;
+		m->m_pkthdr.csum_flags &= ~CSUM_TSO;
+		m->m_pkthdr.tso_segsz = 0;
+#ifdef MAC
+		mac_netinet_fragment(m0, m);
+#endif
+
+		mip = mtod(m, struct ip *);
+		mth = (struct tcphdr *)((caddr_t)mip + hlen);
+		mip->ip_len = htons(hdrlen + len);
+		if (nsegs > 0)
+			ip_fillid(mip);
+		mth->th_seq = htonl(seq + (off - hdrlen));
+		if (off + len < ip_len)
+			mth->th_flags &= ~(TH_FIN | TH_PUSH);
+		if (nsegs > 0)
+			mth->th_flags &= ~TH_CWR;
+		mth->th_sum = in_pseudo(mip->ip_src.s_addr, mip->ip_dst.s_addr,
+		    htons(hdrlen - hlen + len + IPPROTO_TCP));
+		if (m->m_pkthdr.csum_flags & CSUM_TCP & ~if_hwassist_flags) {
+			mth->th_sum = in_cksum_skip(m, hdrlen + len, hlen);
+			m->m_pkthdr.csum_flags &= ~CSUM_TCP;
+		}
+		mip->ip_sum = 0;
+		if (m->m_pkthdr.csum_flags & CSUM_IP & ~if_hwassist_flags) {
+			mip->ip_sum = in_cksum(m, hlen);
+			m->m_pkthdr.csum_flags &= ~CSUM_IP;
+		}
+		*mnext = m;
+		mnext = &m->m_nextpkt;
+	}
+	counter_u64_add(ip_gso_packets, 1);
+	counter_u64_add(ip_gso_segments, nsegs);
+
+	m_freem(m0);
+	*m_gso = mfirst;
+	return (0);
+
+nobufs:
+	for (; mfirst != NULL; mfirst = m) {
+		m = mfirst->m_nextpkt;
+		m_freem(mfirst);
+	}
+	IPSTAT_INC(ips_odropped);
+	return (ENOBUFS);
+}
+
 void
 in_delayed_cksum(struct mbuf *m)
 {
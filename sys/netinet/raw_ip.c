@@ -156,6 +156,7 @@ static void
 rip_inshash(struct inpcb *inp)
 {
 	struct inpcbinfo *pcbinfo = inp->inp_pcbinfo;
+	struct inpcbhash *ih = pcbinfo->ipi_hash;
 	struct inpcbhead *pcbhash;
 	int hash;
 
@@ -166,11 +167,11 @@ rip_inshash(struct inpcb *inp)
 	    inp->inp_laddr.s_addr != INADDR_ANY &&
 	    inp->inp_faddr.s_addr != INADDR_ANY) {
 		hash = INP_PCBHASH_RAW(inp->inp_ip_p, inp->inp_laddr.s_addr,
-		    inp->inp_faddr.s_addr, pcbinfo->ipi_hashmask);
+		    inp->inp_faddr.s_addr, ih->ih_mask);
 	} else
 		hash = 0;
-	pcbhash = &pcbinfo->ipi_hashbase[hash];
-	CK_LIST_INSERT_HEAD(pcbhash, inp, inp_hash);
+	pcbhash = &ih->ih_base[hash];
+	CK_LIST_INSERT_HEAD(pcbhash, inp, inp_hashl[ih->ih_link]);
 }
 
 static void
@@ -180,7 +181,8 @@ rip_delhash(struct inpcb *inp)
 	INP_INFO_WLOCK_ASSERT(inp->inp_pcbinfo);
 	INP_WLOCK_ASSERT(inp);
 
-	CK_LIST_REMOVE(inp, inp_hash);
+	/* The raw hash is never resized, it has only the one linkage. */
+	CK_LIST_REMOVE(inp, inp_hashl[inp->inp_pcbinfo->ipi_hash->ih_link]);
 }
 #endif /* INET */
 
@@ -286,6 +288,7 @@ rip_input(struct mbuf **mp, int *offp, int proto)
 	struct inpcb *inp, *last;
 	struct sockaddr_in ripsrc;
 	struct epoch_tracker et;
+	struct inpcbhash *ih;
 	int hash;
 
 	*mp = NULL;
@@ -298,10 +301,11 @@ rip_input(struct mbuf **mp, int *offp, int proto)
 
 	ifp = m->m_pkthdr.rcvif;
 
+	ih = V_ripcbinfo.ipi_hash;
 	hash = INP_PCBHASH_RAW(proto, ip->ip_src.s_addr,
-	    ip->ip_dst.s_addr, V_ripcbinfo.ipi_hashmask);
+	    ip->ip_dst.s_addr, ih->ih_mask);
 	INP_INFO_RLOCK_ET(&V_ripcbinfo, et);
-	CK_LIST_FOREACH(inp, &V_ripcbinfo.ipi_hashbase[hash], inp_hash) {
+	INP_HASH_FOREACH(inp, ih, &ih->ih_base[hash]) {
 		if (inp->inp_ip_p != proto)
 			continue;
 #ifdef INET6
@@ -339,7 +343,7 @@ rip_input(struct mbuf **mp, int *offp, int proto)
 	skip_1:
 		INP_RUNLOCK(inp);
 	}
-	CK_LIST_FOREACH(inp, &V_ripcbinfo.ipi_hashbase[0], inp_hash) {
+	INP_HASH_FOREACH(inp, ih, &ih->ih_base[0]) {
 		if (inp->inp_ip_p && inp->inp_ip_p != proto)
 			continue;
 #ifdef INET6
@@ -206,6 +206,11 @@ SYSCTL_NODE(_net_inet_tcp, OID_AUTO, hpts, CTLFLAG_RW, 0, "TCP Hpts controls");
 static int32_t logging_on = 0;
 static int32_t hpts_sleep_max = (NUM_OF_HPTSI_SLOTS - 2);
 static int32_t tcp_hpts_precision = 120;
+uint32_t tcp_hpts_slot_usecs = HPTS_DEFAULT_SLOT_USECS;
+
+SYSCTL_UINT(_net_inet_tcp_hpts, OID_AUTO, slot_usecs, CTLFLAG_RDTUN,
+    &tcp_hpts_slot_usecs, 0,
+    "Width of a hpts wheel slot in usecs, must divide 1000");
 
 SYSCTL_INT(_net_inet_tcp_hpts, OID_AUTO, precision, CTLFLAG_RW,
     &tcp_hpts_precision, 120,
@@ -225,6 +230,17 @@ counter_u64_t back_tosleep;
 SYSCTL_COUNTER_U64(_net_inet_tcp_hpts, OID_AUTO, no_tcbsfound, CTLFLAG_RD,
     &back_tosleep, "Number of times hpts found no tcbs");
 
+/*
+ * How late each output call ran relative to its slot: bucket 0 is on
+ * time, bucket n covers [2^(n-1), 2^n) usecs, the last one is open.
+ */
+#define	HPTS_LATE_NBUCKETS	16
+static counter_u64_t hpts_late_hist[HPTS_LATE_NBUCKETS];
+
+SYSCTL_COUNTER_U64_ARRAY(_net_inet_tcp_hpts, OID_AUTO, late_hist, CTLFLAG_RD,
+    hpts_late_hist, HPTS_LATE_NBUCKETS,
+    "Histogram of output lateness in log2 usecs");
+
 static int32_t in_newts_every_tcb = 0;
 
 SYSCTL_INT(_net_inet_tcp_hpts, OID_AUTO, in_tsperpcb, CTLFLAG_RW,
@@ -1548,6 +1564,8 @@ tcp_hptsi(struct tcp_hpts_entry *hpts, struct timeval *ctick)
 				did_prefetch = 1;
 			}
 			inp->inp_hpts_calls = 1;
+			counter_u64_add(hpts_late_hist[min(fls(hpts->p_delayed_by),
+			    HPTS_LATE_NBUCKETS - 1)], 1);
 			if (tp->t_fb->tfb_tcp_output_wtime != NULL) {
 				error = (*tp->t_fb->tfb_tcp_output_wtime) (tp, &tv);
 			} else {
@@ -1788,6 +1806,14 @@ tcp_init_hptsi(void *st)
 	tcp_pace.rp_num_hptss = ncpus;
 	hpts_loops = counter_u64_alloc(M_WAITOK);
 	back_tosleep = counter_u64_alloc(M_WAITOK);
+	for (i = 0; i < HPTS_LATE_NBUCKETS; i++)
+		hpts_late_hist[i] = counter_u64_alloc(M_WAITOK);
+	if (tcp_hpts_slot_usecs == 0 ||
+	    (HPTS_USEC_IN_MSEC % tcp_hpts_slot_usecs) != 0) {
+		printf("TCP Hpts: invalid slot_usecs %u, using %u\n",
+		    tcp_hpts_slot_usecs, HPTS_DEFAULT_SLOT_USECS);
+		tcp_hpts_slot_usecs = HPTS_DEFAULT_SLOT_USECS;
+	}
 
 	sz = (tcp_pace.rp_num_hptss * sizeof(struct tcp_hpts_entry *));
 	tcp_pace.rp_ent = malloc(sz, M_TCPHPTS, M_WAITOK | M_ZERO);
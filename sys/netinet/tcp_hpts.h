@@ -30,7 +30,8 @@
 
 /*
  * The hpts uses a 102400 wheel. The wheel
- * defines the time in 10 usec increments (102400 x 10).
+ * defines the time in slot_usecs increments, by
+ * default 10 usec (102400 x 10).
  * This gives a range of 10usec - 1024ms to place
  * an entry within. If the user requests more than
  * 1.024 second, a remaineder is attached and the hpts
@@ -43,10 +44,14 @@
 
 TAILQ_HEAD(hptsh, inpcb);
 
-/* Number of useconds in a hpts tick */
-#define HPTS_TICKS_PER_USEC 10
-#define HPTS_MS_TO_SLOTS(x) (x * 100)
-#define HPTS_USEC_TO_SLOTS(x) ((x+9) /10)
+/*
+ * Number of useconds in a hpts tick, the loader tunable
+ * net.inet.tcp.hpts.slot_usecs.  It must divide 1000.
+ */
+#define HPTS_DEFAULT_SLOT_USECS 10
+#define HPTS_TICKS_PER_USEC tcp_hpts_slot_usecs
+#define HPTS_MS_TO_SLOTS(x) ((x) * (HPTS_USEC_IN_MSEC / tcp_hpts_slot_usecs))
+#define HPTS_USEC_TO_SLOTS(x) (((x) + tcp_hpts_slot_usecs - 1) / tcp_hpts_slot_usecs)
 #define HPTS_USEC_IN_SEC 1000000
 #define HPTS_MSEC_IN_SEC 1000
 #define HPTS_USEC_IN_MSEC 1000
@@ -190,7 +195,7 @@ struct tcp_hptsi {
  */
 #define DEFAULT_MIN_SLEEP 250	/* How many usec's is default for hpts sleep
 				 * this determines min granularity of the
-				 * hpts. If 0, granularity is 10useconds at
+				 * hpts. If 0, granularity is one slot at
 				 * the cost of more CPU (context switching). */
 #ifdef _KERNEL
 #define HPTS_MTX_ASSERT(hpts) mtx_assert(&(hpts)->p_mtx, MA_OWNED)
@@ -253,11 +258,13 @@ void __tcp_set_inp_to_drop(struct inpcb *inp, uint16_t reason, int32_t line);
 #define tcp_set_inp_to_drop(a, b) __tcp_set_inp_to_drop(a, b, __LINE__)
 
 extern int32_t tcp_min_hptsi_time;
+extern uint32_t tcp_hpts_slot_usecs;
 
 static __inline uint32_t
 tcp_tv_to_hptstick(struct timeval *sv)
 {
-	return ((sv->tv_sec * 100000) + (sv->tv_usec / 10));
+	return ((sv->tv_sec * (HPTS_USEC_IN_SEC / tcp_hpts_slot_usecs)) +
+	    (sv->tv_usec / tcp_hpts_slot_usecs));
 }
 
 static __inline uint32_t
@@ -1507,6 +1507,85 @@ tcp_autorcvbuf(struct mbuf *m, struct tcphdr *th, struct socket *so,
 	return (newsize);
 }
 
+/*
+ * Back-to-back segments for one connection, as handed up by an LRO
+ * flush, would each wake the reader (or writer) of the socket.  While
+ * a thread has a batch open, tcp_do_segment() records sockets that
+ * need a wakeup and tcp_batch_end() issues one per socket.  Batches
+ * nest; only the outermost one takes effect.
+ */
+void
+tcp_batch_begin(struct tcp_batch *tb)
+{
+	struct thread *td;
+
+	td = curthread;
+	if (td->td_tcpbatch != NULL)
+		return;
+	tb->tb_count = 0;
+	td->td_tcpbatch = tb;
+}
+
+void
+tcp_batch_end(struct tcp_batch *tb)
+{
+	struct thread *td;
+	struct socket *so;
+	int i;
+
+	td = curthread;
+	if (td->td_tcpbatch != tb)
+		return;
+	td->td_tcpbatch = NULL;
+	for (i = 0; i < tb->tb_count; i++) {
+		so = tb->tb_ent[i].so;
+		if (tb->tb_ent[i].which & TCP_BATCH_RCV)
+			sorwakeup(so);
+		if (tb->tb_ent[i].which & TCP_BATCH_SND)
+			sowwakeup(so);
+		SOCK_LOCK(so);
+		sorele(so);
+	}
+}
+
+/*
+ * Wake up the socket buffer's waiters, or defer that to the end of the
+ * current batch.  The socket buffer lock is dropped.
+ */
+static void
+tcp_batch_wakeup_locked(struct socket *so, struct sockbuf *sb, int which)
+{
+	struct tcp_batch *tb;
+	int i;
+
+	SOCKBUF_LOCK_ASSERT(sb);
+	if (!sb_notify(sb)) {
+		SOCKBUF_UNLOCK(sb);
+		return;
+	}
+	tb = curthread->td_tcpbatch;
+	if (tb == NULL) {
+		sowakeup(so, sb);
+		return;
+	}
+	for (i = 0; i < tb->tb_count; i++) {
+		if (tb->tb_ent[i].so == so) {
+			tb->tb_ent[i].which |= which;
+			SOCKBUF_UNLOCK(sb);
+			return;
+		}
+	}
+	if (tb->tb_count == TCP_BATCH_MAX) {
+		sowakeup(so, sb);
+		return;
+	}
+	SOCKBUF_UNLOCK(sb);
+	soref(so);
+	tb->tb_ent[tb->tb_count].so = so;
+	tb->tb_ent[tb->tb_count].which = which;
+	tb->tb_count++;
+}
+
 void
 tcp_do_segment(struct mbuf *m, struct tcphdr *th, struct socket *so,
     struct tcpcb *tp, int drop_hdrlen, int tlen, uint8_t iptos)
@@ -1850,7 +1929,9 @@ tcp_do_segment(struct mbuf *m, struct tcphdr *th, struct socket *so,
 				else if (!tcp_timer_active(tp, TT_PERSIST))
 					tcp_timer_activate(tp, TT_REXMT,
 						      tp->t_rxtcur);
-				sowwakeup(so);
+				SOCKBUF_LOCK(&so->so_snd);
+				tcp_batch_wakeup_locked(so, &so->so_snd,
+				    TCP_BATCH_SND);
 				if (sbavail(&so->so_snd))
 					(void) tp->t_fb->tfb_tcp_output(tp);
 				goto check_delack;
@@ -1906,8 +1987,9 @@ tcp_do_segment(struct mbuf *m, struct tcphdr *th, struct socket *so,
 				m_adj(m, drop_hdrlen);	/* delayed header drop */
 				sbappendstream_locked(&so->so_rcv, m, 0);
 			}
-			/* NB: sorwakeup_locked() does an implicit unlock. */
-			sorwakeup_locked(so);
+			/* NB: this does an implicit unlock. */
+			tcp_batch_wakeup_locked(so, &so->so_rcv,
+			    TCP_BATCH_RCV);
 			if (DELAY_ACK(tp, tlen)) {
 				tp->t_flags |= TF_DELACK;
 			} else {
@@ -3035,8 +3117,9 @@ tcp_do_segment(struct mbuf *m, struct tcphdr *th, struct socket *so,
 				m_freem(m);
 			else
 				sbappendstream_locked(&so->so_rcv, m, 0);
-			/* NB: sorwakeup_locked() does an implicit unlock. */
-			sorwakeup_locked(so);
+			/* NB: this does an implicit unlock. */
+			tcp_batch_wakeup_locked(so, &so->so_rcv,
+			    TCP_BATCH_RCV);
 		} else {
 			/*
 			 * XXX: Due to the header drop above "th" is
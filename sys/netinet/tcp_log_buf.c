@@ -1982,6 +1982,26 @@ tcp_log_dump_tp_logbuf(struct tcpcb *tp, char *reason, int how, bool force)
 		return (0);
 	}
 
+	/*
+	 * If no one is listening, the queue entry would be rejected and
+	 * the log entries freed anyway. Skip straight to the freeing, so
+	 * continual and auto-dumped sessions do not take the device queue
+	 * lock on every dump.
+	 */
+	if (!tcp_log_dev_listening()) {
+		struct tcp_log_mem *log_entry;
+
+#ifdef TCPLOG_DEBUG_COUNTERS
+		counter_u64_add(tcp_log_que_fail1, tp->t_lognum);
+#endif
+		while ((log_entry = STAILQ_FIRST(&tp->t_logs)) != NULL)
+			tcp_log_remove_log_head(tp, log_entry);
+		KASSERT(tp->t_lognum == 0,
+		    ("%s: After freeing entries, tp->t_lognum=%d (expected 0)",
+			__func__, tp->t_lognum));
+		return (0);
+	}
+
 	/*
 	 * Allocate memory. If we must wait, we'll need to drop the locks
 	 * and reacquire them (and do all the related business that goes
@@ -101,6 +101,15 @@ tcp_lro_active_remove(struct lro_entry *le)
 	LIST_REMOVE(le, hash_next);	/* hash bucket */
 }
 
+static __inline void
+tcp_lro_active_flush(struct lro_ctrl *lc, struct lro_entry *le, int reason)
+{
+
+	tcp_lro_active_remove(le);
+	lc->lro_flush_reason[reason]++;
+	tcp_lro_flush(lc, le);
+}
+
 int
 tcp_lro_init(struct lro_ctrl *lc)
 {
@@ -118,6 +127,9 @@ tcp_lro_init_args(struct lro_ctrl *lc, struct ifnet *ifp,
 	lc->lro_bad_csum = 0;
 	lc->lro_queued = 0;
 	lc->lro_flushed = 0;
+	lc->lro_no_entries = 0;
+	memset(lc->lro_flush_reason, 0, sizeof(lc->lro_flush_reason));
+	timevalclear(&lc->lro_hold);
 	lc->lro_mbuf_count = 0;
 	lc->lro_mbuf_max = lro_mbufs;
 	lc->lro_cnt = lro_entries;
@@ -282,10 +294,8 @@ tcp_lro_rx_done(struct lro_ctrl *lc)
 {
 	struct lro_entry *le;
 
-	while ((le = LIST_FIRST(&lc->lro_active)) != NULL) {
-		tcp_lro_active_remove(le);
-		tcp_lro_flush(lc, le);
-	}
+	while ((le = LIST_FIRST(&lc->lro_active)) != NULL)
+		tcp_lro_active_flush(lc, le, TCP_LRO_FLUSH_DONE);
 }
 
 void
@@ -300,10 +310,8 @@ tcp_lro_flush_inactive(struct lro_ctrl *lc, const struct timeval *timeout)
 	getmicrotime(&tv);
 	timevalsub(&tv, timeout);
 	LIST_FOREACH_SAFE(le, &lc->lro_active, next, le_tmp) {
-		if (timevalcmp(&tv, &le->mtime, >=)) {
-			tcp_lro_active_remove(le);
-			tcp_lro_flush(lc, le);
-		}
+		if (timevalcmp(&tv, &le->mtime, >=))
+			tcp_lro_active_flush(lc, le, TCP_LRO_FLUSH_INACTIVE);
 	}
 }
 
@@ -492,9 +500,15 @@ tcp_lro_sort(struct lro_mbuf_sort *parray, uint32_t size)
 void
 tcp_lro_flush_all(struct lro_ctrl *lc)
 {
+	struct tcp_batch tb;
 	uint64_t seq;
 	uint64_t nseq;
 	unsigned x;
+	int hold;
+
+	/* One socket wakeup per connection for the whole batch. */
+	tcp_batch_begin(&tb);
+	hold = timevalisset(&lc->lro_hold);
 
 	/* check if no mbufs to flush */
 	if (lc->lro_mbuf_count == 0)
@@ -514,16 +528,20 @@ tcp_lro_flush_all(struct lro_ctrl *lc)
 		/* get sequence number, masking away the packet index */
 		nseq = lc->lro_mbuf_data[x].seq & (-1ULL << 24);
 
-		/* check for new stream */
+		/*
+		 * Check for new stream.  Held entries from earlier
+		 * batches stay in the hash table instead.
+		 */
 		if (seq != nseq) {
 			seq = nseq;
 
 			/* flush active streams */
-			tcp_lro_rx_done(lc);
+			if (!hold)
+				tcp_lro_rx_done(lc);
 		}
 
 		/* add packet to LRO engine */
-		if (tcp_lro_rx2(lc, mb, 0, 0) != 0) {
+		if (tcp_lro_rx2(lc, mb, 0, hold) != 0) {
 			/* input packet to network layer */
 			(*lc->ifp->if_input)(lc->ifp, mb);
 			lc->lro_queued++;
@@ -532,9 +550,13 @@ tcp_lro_flush_all(struct lro_ctrl *lc)
 	}
 done:
 	/* flush active streams */
-	tcp_lro_rx_done(lc);
+	if (hold)
+		tcp_lro_flush_inactive(lc, &lc->lro_hold);
+	else
+		tcp_lro_rx_done(lc);
 
 	lc->lro_mbuf_count = 0;
+	tcp_batch_end(&tb);
 }
 
 #ifdef INET6
@@ -781,15 +803,13 @@ tcp_lro_rx2(struct lro_ctrl *lc, struct mbuf *m, uint32_t csum, int use_hash)
 
 		if (force_flush) {
 			/* Timestamps mismatch; this is a FIN, etc */
-			tcp_lro_active_remove(le);
-			tcp_lro_flush(lc, le);
+			tcp_lro_active_flush(lc, le, TCP_LRO_FLUSH_FORCE);
 			return (TCP_LRO_CANNOT);
 		}
 
 		/* Flush now if appending will result in overflow. */
 		if (le->p_len > (lc->lro_length_lim - tcp_data_len)) {
-			tcp_lro_active_remove(le);
-			tcp_lro_flush(lc, le);
+			tcp_lro_active_flush(lc, le, TCP_LRO_FLUSH_LENGTH);
 			break;
 		}
 
@@ -799,8 +819,7 @@ tcp_lro_rx2(struct lro_ctrl *lc, struct mbuf *m, uint32_t csum, int use_hash)
 		    le->ack_seq == th->th_ack &&
 		    le->window == th->th_win))) {
 			/* Out of order packet or duplicate ACK. */
-			tcp_lro_active_remove(le);
-			tcp_lro_flush(lc, le);
+			tcp_lro_active_flush(lc, le, TCP_LRO_FLUSH_OOO);
 			return (TCP_LRO_CANNOT);
 		}
 
@@ -839,10 +858,9 @@ tcp_lro_rx2(struct lro_ctrl *lc, struct mbuf *m, uint32_t csum, int use_hash)
 			 * Flush this LRO entry, if this ACK should not
 			 * be further delayed.
 			 */
-			if (le->append_cnt >= lc->lro_ackcnt_lim) {
-				tcp_lro_active_remove(le);
-				tcp_lro_flush(lc, le);
-			}
+			if (le->append_cnt >= lc->lro_ackcnt_lim)
+				tcp_lro_active_flush(lc, le,
+				    TCP_LRO_FLUSH_ACKCNT);
 			return (0);
 		}
 
@@ -863,10 +881,9 @@ tcp_lro_rx2(struct lro_ctrl *lc, struct mbuf *m, uint32_t csum, int use_hash)
 		 * If a possible next full length packet would cause an
 		 * overflow, pro-actively flush now.
 		 */
-		if (le->p_len > (lc->lro_length_lim - lc->ifp->if_mtu)) {
-			tcp_lro_active_remove(le);
-			tcp_lro_flush(lc, le);
-		} else
+		if (le->p_len > (lc->lro_length_lim - lc->ifp->if_mtu))
+			tcp_lro_active_flush(lc, le, TCP_LRO_FLUSH_LENGTH);
+		else
 			getmicrotime(&le->mtime);
 
 		return (0);
@@ -881,8 +898,17 @@ tcp_lro_rx2(struct lro_ctrl *lc, struct mbuf *m, uint32_t csum, int use_hash)
 	}
 
 	/* Try to find an empty slot. */
-	if (LIST_EMPTY(&lc->lro_free))
-		return (TCP_LRO_NO_ENTRIES);
+	if (LIST_EMPTY(&lc->lro_free)) {
+		lc->lro_no_entries++;
+		if (!timevalisset(&lc->lro_hold))
+			return (TCP_LRO_NO_ENTRIES);
+		/*
+		 * Entries are held across batches; make room rather
+		 * than passing the segment up unaggregated.
+		 */
+		while ((le = LIST_FIRST(&lc->lro_active)) != NULL)
+			tcp_lro_active_flush(lc, le, TCP_LRO_FLUSH_FULL);
+	}
 
 	/* Start a new segment chain. */
 	le = LIST_FIRST(&lc->lro_free);
@@ -987,3 +1013,44 @@ tcp_lro_queue_mbuf(struct lro_ctrl *lc, struct mbuf *mb)
 }
 
 /* end */
+
+static const char *tcp_lro_flush_names[TCP_LRO_FLUSH_NREASONS] = {
+	[TCP_LRO_FLUSH_DONE] = "flush_done",
+	[TCP_LRO_FLUSH_INACTIVE] = "flush_inactive",
+	[TCP_LRO_FLUSH_LENGTH] = "flush_length",
+	[TCP_LRO_FLUSH_ACKCNT] = "flush_ackcnt",
+	[TCP_LRO_FLUSH_OOO] = "flush_ooo",
+	[TCP_LRO_FLUSH_FORCE] = "flush_force",
+	[TCP_LRO_FLUSH_FULL] = "flush_full",
+};
+
+/*
+ * Export the per-ring LRO statistics below a driver's queue node.
+ * lro_queued / lro_flushed is the aggregation ratio.
+ */
+void
+tcp_lro_sysctl_attach(struct lro_ctrl *lc, struct sysctl_ctx_list *ctx,
+    struct sysctl_oid_list *parent)
+{
+	struct sysctl_oid *node;
+	struct sysctl_oid_list *list;
+	int i;
+
+	node = SYSCTL_ADD_NODE(ctx, parent, OID_AUTO, "lro", CTLFLAG_RD,
+	    NULL, "LRO statistics");
+	list = SYSCTL_CHILDREN(node);
+	SYSCTL_ADD_UINT(ctx, list, OID_AUTO, "entries", CTLFLAG_RD,
+	    &lc->lro_cnt, 0, "LRO entries");
+	SYSCTL_ADD_U64(ctx, list, OID_AUTO, "queued", CTLFLAG_RD,
+	    &lc->lro_queued, 0, "segments passed to LRO");
+	SYSCTL_ADD_U64(ctx, list, OID_AUTO, "flushed", CTLFLAG_RD,
+	    &lc->lro_flushed, 0, "packets flushed to the stack");
+	SYSCTL_ADD_U64(ctx, list, OID_AUTO, "bad_csum", CTLFLAG_RD,
+	    &lc->lro_bad_csum, 0, "segments with bad checksum");
+	SYSCTL_ADD_U64(ctx, list, OID_AUTO, "no_entries", CTLFLAG_RD,
+	    &lc->lro_no_entries, 0, "segments that found no free entry");
+	for (i = 0; i < TCP_LRO_FLUSH_NREASONS; i++)
+		SYSCTL_ADD_U64(ctx, list, OID_AUTO, tcp_lro_flush_names[i],
+		    CTLFLAG_RD, &lc->lro_flush_reason[i], 0,
+		    "entries flushed for this reason");
+}
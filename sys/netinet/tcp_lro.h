@@ -80,6 +80,16 @@ LIST_HEAD(lro_head, lro_entry);
 #define	source_ip6		lesource.s_ip6
 #define	dest_ip6		ledest.d_ip6
 
+/* Reasons for flushing an LRO entry, see lro_flush_reason[]. */
+#define	TCP_LRO_FLUSH_DONE	0	/* end of batch or stream */
+#define	TCP_LRO_FLUSH_INACTIVE	1	/* tcp_lro_flush_inactive() */
+#define	TCP_LRO_FLUSH_LENGTH	2	/* lro_length_lim reached */
+#define	TCP_LRO_FLUSH_ACKCNT	3	/* lro_ackcnt_lim reached */
+#define	TCP_LRO_FLUSH_OOO	4	/* out of order or duplicate ACK */
+#define	TCP_LRO_FLUSH_FORCE	5	/* segment cannot be delayed */
+#define	TCP_LRO_FLUSH_FULL	6	/* evicted, no free entries */
+#define	TCP_LRO_FLUSH_NREASONS	7
+
 struct lro_mbuf_sort {
 	uint64_t seq;
 	struct mbuf *mb;
@@ -102,6 +112,18 @@ struct lro_ctrl {
 	struct lro_head	*lro_hash;
 	struct lro_head	lro_active;
 	struct lro_head	lro_free;
+
+	/*
+	 * If lro_hold is set, tcp_lro_flush_all() keeps aggregating
+	 * entries across calls and only flushes those idle for longer
+	 * than lro_hold; when the table is full all active entries are
+	 * flushed to make room.  The driver must then also call
+	 * tcp_lro_flush_inactive() from a timer, and should size
+	 * lro_entries to the expected number of flows.
+	 */
+	struct timeval	lro_hold;
+	uint64_t	lro_no_entries;
+	uint64_t	lro_flush_reason[TCP_LRO_FLUSH_NREASONS];
 };
 
 #define	TCP_LRO_LENGTH_MAX	65535
@@ -115,6 +137,10 @@ void tcp_lro_flush(struct lro_ctrl *, struct lro_entry *);
 void tcp_lro_flush_all(struct lro_ctrl *);
 int tcp_lro_rx(struct lro_ctrl *, struct mbuf *, uint32_t);
 void tcp_lro_queue_mbuf(struct lro_ctrl *, struct mbuf *);
+struct sysctl_ctx_list;
+struct sysctl_oid_list;
+void tcp_lro_sysctl_attach(struct lro_ctrl *, struct sysctl_ctx_list *,
+    struct sysctl_oid_list *);
 
 #define	TCP_LRO_NO_ENTRIES	-2
 #define	TCP_LRO_CANNOT		-1
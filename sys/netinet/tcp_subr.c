@@ -2241,6 +2241,34 @@ SYSCTL_PROC(_net_inet_tcp, TCPCTL_PCBLIST, pcblist,
     CTLTYPE_OPAQUE | CTLFLAG_RD, NULL, 0,
     tcp_pcblist, "S,xtcpcb", "List of active TCP connections");
 
+static SYSCTL_NODE(_net_inet_tcp, OID_AUTO, pcbhash, CTLFLAG_RW, 0,
+    "TCP connection hash table");
+
+static int
+tcp_pcbhash_stat(SYSCTL_HANDLER_ARGS)
+{
+
+	return (in_pcbhash_sysctl(&V_tcbinfo, arg2, req));
+}
+
+SYSCTL_INT(_net_inet_tcp_pcbhash, OID_AUTO, maxload, CTLFLAG_RW,
+    &in_pcbhash_maxload, 0,
+    "Average chain length above which TCP and UDP hash tables are grown "
+    "(0 disables)");
+SYSCTL_PROC(_net_inet_tcp_pcbhash, OID_AUTO, buckets,
+    CTLFLAG_VNET | CTLTYPE_ULONG | CTLFLAG_RD, NULL, INP_HASHSTAT_BUCKETS,
+    tcp_pcbhash_stat, "LU", "Number of hash buckets");
+SYSCTL_PROC(_net_inet_tcp_pcbhash, OID_AUTO, maxchain,
+    CTLFLAG_VNET | CTLTYPE_ULONG | CTLFLAG_RD, NULL, INP_HASHSTAT_MAXCHAIN,
+    tcp_pcbhash_stat, "LU", "Longest hash chain");
+SYSCTL_PROC(_net_inet_tcp_pcbhash, OID_AUTO, resizes,
+    CTLFLAG_VNET | CTLTYPE_ULONG | CTLFLAG_RD, NULL, INP_HASHSTAT_RESIZES,
+    tcp_pcbhash_stat, "LU", "Number of times the table was grown");
+SYSCTL_PROC(_net_inet_tcp_pcbhash, OID_AUTO, chains,
+    CTLFLAG_VNET | CTLTYPE_OPAQUE | CTLFLAG_RD, NULL, INP_HASHSTAT_CHAINS,
+    tcp_pcbhash_stat, "LU",
+    "Histogram of chain lengths (buckets holding 0, 1, ... or more entries)");
+
 #ifdef INET
 static int
 tcp_getcred(SYSCTL_HANDLER_ARGS)
@@ -2849,6 +2877,13 @@ tcp_maxmtu(struct in_conninfo *inc, struct tcp_ifcap *cap)
 				cap->tsomax = ifp->if_hw_tsomax;
 				cap->tsomaxsegcount = ifp->if_hw_tsomaxsegcount;
 				cap->tsomaxsegsize = ifp->if_hw_tsomaxsegsize;
+			} else if (V_ip_gso &&
+			    (ifp->if_flags & IFF_LOOPBACK) == 0) {
+				/* ip_output() will segment in software. */
+				cap->ifcap |= CSUM_TSO;
+				cap->tsomax = IP_MAXPACKET;
+				cap->tsomaxsegcount = 0;
+				cap->tsomaxsegsize = 0;
 			}
 		}
 		fib4_free_nh_ext(inc->inc_fibnum, &nh4);
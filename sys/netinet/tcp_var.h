@@ -863,7 +863,24 @@ void	hhook_run_tcp_est_in(struct tcpcb *tp,
 			    struct tcphdr *th, struct tcpopt *to);
 #endif
 
+/*
+ * Socket wakeups deferred by tcp_do_segment() while the current thread
+ * has a batch open, see tcp_batch_begin().
+ */
+#define	TCP_BATCH_MAX	16
+#define	TCP_BATCH_RCV	0x01
+#define	TCP_BATCH_SND	0x02
+struct tcp_batch {
+	int		tb_count;
+	struct {
+		struct socket	*so;
+		int		which;
+	}		tb_ent[TCP_BATCH_MAX];
+};
+
 int	 tcp_input(struct mbuf **, int *, int);
+void	 tcp_batch_begin(struct tcp_batch *);
+void	 tcp_batch_end(struct tcp_batch *);
 int	 tcp_autorcvbuf(struct mbuf *, struct tcphdr *, struct socket *,
 	    struct tcpcb *, int);
 void	 tcp_do_segment(struct mbuf *, struct tcphdr *,
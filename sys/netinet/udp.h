@@ -51,6 +51,7 @@ struct udphdr {
  * User-settable options (used with setsockopt).
  */
 #define	UDP_ENCAP			1
+#define	UDP_SEGMENT			8 /* u_int16_t; split sends */
 
 /* Start of reserved space for third-party user-settable options. */
 #define	UDP_VENDOR			SO_VENDOR
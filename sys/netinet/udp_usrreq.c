@@ -1069,6 +1069,25 @@ udp_ctloutput(struct socket *so, struct sockopt *sopt)
 				up->u_rxcslen = optval;
 			INP_WUNLOCK(inp);
 			break;
+		case UDP_SEGMENT:
+			INP_WUNLOCK(inp);
+			error = sooptcopyin(sopt, &optval, sizeof(optval),
+			    sizeof(optval));
+			if (error != 0)
+				break;
+			if (optval < 0 ||
+			    optval > IP_MAXPACKET - sizeof(struct udpiphdr)) {
+				error = EINVAL;
+				break;
+			}
+			inp = sotoinpcb(so);
+			KASSERT(inp != NULL, ("%s: inp == NULL", __func__));
+			INP_WLOCK(inp);
+			up = intoudpcb(inp);
+			KASSERT(up != NULL, ("%s: up == NULL", __func__));
+			up->u_segsize = optval;
+			INP_WUNLOCK(inp);
+			break;
 		default:
 			INP_WUNLOCK(inp);
 			error = ENOPROTOOPT;
@@ -1104,6 +1123,13 @@ udp_ctloutput(struct socket *so, struct sockopt *sopt)
 			INP_WUNLOCK(inp);
 			error = sooptcopyout(sopt, &optval, sizeof(optval));
 			break;
+		case UDP_SEGMENT:
+			up = intoudpcb(inp);
+			KASSERT(up != NULL, ("%s: up == NULL", __func__));
+			optval = up->u_segsize;
+			INP_WUNLOCK(inp);
+			error = sooptcopyout(sopt, &optval, sizeof(optval));
+			break;
 		default:
 			INP_WUNLOCK(inp);
 			error = ENOPROTOOPT;
@@ -1778,7 +1804,7 @@ udp_disconnect(struct socket *so)
 }
 
 static int
-udp_send(struct socket *so, int flags, struct mbuf *m, struct sockaddr *addr,
+udp_send1(struct socket *so, int flags, struct mbuf *m, struct sockaddr *addr,
     struct mbuf *control, struct thread *td)
 {
 	struct inpcb *inp;
@@ -1787,8 +1813,97 @@ udp_send(struct socket *so, int flags, struct mbuf *m, struct sockaddr *addr,
 	KASSERT(inp != NULL, ("udp_send: inp == NULL"));
 	return (udp_output(inp, m, addr, control, td));
 }
+
+static int
+udp_send(struct socket *so, int flags, struct mbuf *m, struct sockaddr *addr,
+    struct mbuf *control, struct thread *td)
+{
+
+	return (udp_send_segmented(so, flags, m, addr, control, td,
+	    udp_send1));
+}
 #endif /* INET */
 
+/*
+ * Segment size for a send: a UDP_SEGMENT control message overrides the
+ * socket option.
+ */
+static u_int
+udp_segsize(struct socket *so, struct mbuf *control)
+{
+	struct cmsghdr *cm;
+	struct udpcb *up;
+	u_int segsize;
+	int len;
+
+	up = intoudpcb(sotoinpcb(so));
+	segsize = (up != NULL) ? up->u_segsize : 0;
+	if (control == NULL)
+		return (segsize);
+	cm = mtod(control, struct cmsghdr *);
+	for (len = control->m_len; len >= sizeof(*cm) &&
+	    cm->cmsg_len >= sizeof(*cm) && cm->cmsg_len <= len;
+	    len -= CMSG_ALIGN(cm->cmsg_len),
+	    cm = (struct cmsghdr *)((caddr_t)cm + CMSG_ALIGN(cm->cmsg_len))) {
+		if (cm->cmsg_level == IPPROTO_UDP &&
+		    cm->cmsg_type == UDP_SEGMENT &&
+		    cm->cmsg_len == CMSG_LEN(sizeof(uint16_t)))
+			segsize = *(uint16_t *)CMSG_DATA(cm);
+	}
+	return (segsize);
+}
+
+/*
+ * Hand a send to the protocol output routine, first cutting it into
+ * datagrams of the UDP_SEGMENT size, if one is set; the last datagram
+ * carries the remainder.  The whole send was accounted against the send
+ * buffer by sosend_dgram(), so SO_SNDBUF bounds how much a single call can
+ * emit.  Each datagram gets its own copy of the control messages.
+ */
+int
+udp_send_segmented(struct socket *so, int flags, struct mbuf *m,
+    struct sockaddr *addr, struct mbuf *control, struct thread *td,
+    int (*send1)(struct socket *, int, struct mbuf *, struct sockaddr *,
+    struct mbuf *, struct thread *))
+{
+	struct mbuf *c, *n;
+	u_int segsize;
+	int error;
+
+	segsize = udp_segsize(so, control);
+	if (segsize == 0 || m->m_pkthdr.len <= segsize)
+		return (send1(so, flags, m, addr, control, td));
+
+	error = 0;
+	while (m != NULL) {
+		n = NULL;
+		c = control;
+		if (m->m_pkthdr.len > segsize) {
+			n = m_split(m, segsize, M_NOWAIT);
+			if (n == NULL) {
+				error = ENOBUFS;
+				break;
+			}
+			if (control != NULL) {
+				c = m_copym(control, 0, M_COPYALL, M_NOWAIT);
+				if (c == NULL) {
+					m_freem(n);
+					error = ENOBUFS;
+					break;
+				}
+			}
+		} else
+			control = NULL;
+		error = send1(so, flags, m, addr, c, td);
+		m = n;
+		if (error != 0)
+			break;
+	}
+	m_freem(m);
+	m_freem(control);
+	return (error);
+}
+
 int
 udp_shutdown(struct socket *so)
 {
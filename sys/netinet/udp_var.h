@@ -70,6 +70,7 @@ struct udpcb {
 	u_int		u_flags;	/* Generic UDP flags. */
 	uint16_t	u_rxcslen;	/* Coverage for incoming datagrams. */
 	uint16_t	u_txcslen;	/* Coverage for outgoing datagrams. */
+	uint16_t	u_segsize;	/* UDP_SEGMENT payload size, 0 off. */
 	void 		*u_tun_ctx;	/* Tunneling callback context. */
 };
 
@@ -177,6 +178,11 @@ int		udp_input(struct mbuf **, int *, int);
 void		udplite_input(struct mbuf *, int);
 struct inpcb	*udp_notify(struct inpcb *inp, int errno);
 int		udp_shutdown(struct socket *so);
+int		udp_send_segmented(struct socket *so, int flags,
+		    struct mbuf *m, struct sockaddr *addr,
+		    struct mbuf *control, struct thread *td,
+		    int (*send1)(struct socket *, int, struct mbuf *,
+		    struct sockaddr *, struct mbuf *, struct thread *));
 
 int		udp_set_kernel_tunneling(struct socket *so, udp_tun_func_t f,
 		    udp_tun_icmp_t i, void *ctx);
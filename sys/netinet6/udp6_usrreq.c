@@ -1352,7 +1352,8 @@ udp6_send(struct socket *so, int flags, struct mbuf *m,
 		}
 	}
 
-	return (udp6_output(so, flags, m, addr, control, td));
+	return (udp_send_segmented(so, flags, m, addr, control, td,
+	    udp6_output));
 
 bad:
 	if (control)
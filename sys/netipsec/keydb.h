@@ -183,7 +183,7 @@ struct secasvar {
 	LIST_ENTRY(secasvar) spihash;
 	LIST_ENTRY(secasvar) drainq;	/* used ONLY by flush callout */
 
-	uint64_t cntr;			/* counter for GCM and CTR */
+	uint64_t cntr;			/* counter for GCM and CTR, atomic */
 	volatile u_int refcnt;		/* reference count */
 };
 
@@ -199,10 +199,11 @@ struct secasvar {
 
 /* Replay prevention, protected by SECASVAR_LOCK:
  *  (m) locked by mtx
+ *  (a) updated with atomics by the sender, (m) for the receiver
  *  (c) read only except during creation / free
  */
 struct secreplay {
-	u_int32_t count;	/* (m) */
+	u_int32_t count;	/* (a) */
 	u_int wsize;		/* (c) window size, i.g. 4 bytes */
 	u_int32_t seq;		/* (m) used by sender */
 	u_int32_t lastseq;	/* (m) used by receiver */
@@ -48,6 +48,7 @@
 #include <sys/lock.h>
 #include <sys/mutex.h>
 #include <sys/sysctl.h>
+#include <machine/atomic.h>
 
 #include <net/if.h>
 #include <net/vnet.h>
@@ -942,27 +943,37 @@ ah_output(struct mbuf *m, struct secpolicy *sp, struct secasvar *sav,
 	    ipseczeroes);
 
 	/* Insert packet replay counter, as requested.  */
-	SECASVAR_LOCK(sav);
 	if (sav->replay) {
-		if (sav->replay->count == ~0 &&
-		    (sav->flags & SADB_X_EXT_CYCSEQ) == 0) {
-			SECASVAR_UNLOCK(sav);
-			DPRINTF(("%s: replay counter wrapped for SA %s/%08lx\n",
-			    __func__, ipsec_address(&sav->sah->saidx.dst, buf,
-			    sizeof(buf)), (u_long) ntohl(sav->spi)));
-			AHSTAT_INC(ahs_wrap);
-			error = EACCES;
-			goto bad;
-		}
+		uint32_t seq;
+
+		/*
+		 * Take the next sequence number without the SA lock;
+		 * the loop only retries when another CPU raced us.
+		 */
+		do {
+			seq = sav->replay->count;
+			if (seq == ~0 &&
+			    (sav->flags & SADB_X_EXT_CYCSEQ) == 0) {
+				DPRINTF(("%s: replay counter wrapped for SA "
+				    "%s/%08lx\n", __func__,
+				    ipsec_address(&sav->sah->saidx.dst, buf,
+				    sizeof(buf)), (u_long) ntohl(sav->spi)));
+				AHSTAT_INC(ahs_wrap);
+				error = EACCES;
+				goto bad;
+			}
 #ifdef REGRESSION
-		/* Emulate replay attack when ipsec_replay is TRUE. */
-		if (!V_ipsec_replay)
+			/* Emulate replay attack when ipsec_replay is TRUE. */
+			if (V_ipsec_replay) {
+				seq--;
+				break;
+			}
 #endif
-			sav->replay->count++;
-		ah->ah_seq = htonl(sav->replay->count);
+		} while (atomic_cmpset_32(&sav->replay->count, seq,
+		    seq + 1) == 0);
+		ah->ah_seq = htonl(seq + 1);
 	}
 	cryptoid = sav->tdb_cryptoid;
-	SECASVAR_UNLOCK(sav);
 
 	/* Get crypto descriptors. */
 	crp = crypto_getreq(1);
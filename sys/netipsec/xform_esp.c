@@ -729,24 +729,36 @@ esp_output(struct mbuf *m, struct secpolicy *sp, struct secasvar *sav,
 	/* Initialize ESP header. */
 	bcopy((caddr_t) &sav->spi, mtod(mo, caddr_t) + roff,
 	    sizeof(uint32_t));
-	SECASVAR_LOCK(sav);
+	/*
+	 * The sequence number and nonce counter are taken with atomics
+	 * rather than under the SA lock, so that transmitting on one SA
+	 * from several CPUs does not serialize on it.
+	 */
 	if (sav->replay) {
 		uint32_t replay;
 
 #ifdef REGRESSION
 		/* Emulate replay attack when ipsec_replay is TRUE. */
-		if (!V_ipsec_replay)
+		if (V_ipsec_replay)
+			replay = htonl(sav->replay->count);
+		else
 #endif
-			sav->replay->count++;
-		replay = htonl(sav->replay->count);
+			replay = htonl(atomic_fetchadd_32(&sav->replay->count,
+			    1) + 1);
 
 		bcopy((caddr_t) &replay, mtod(mo, caddr_t) + roff +
 		    sizeof(uint32_t), sizeof(uint32_t));
 	}
 	cryptoid = sav->tdb_cryptoid;
-	if (SAV_ISCTRORGCM(sav))
+	if (SAV_ISCTRORGCM(sav)) {
+#ifdef __LP64__
+		cntr = atomic_fetchadd_64(&sav->cntr, 1);
+#else
+		SECASVAR_LOCK(sav);
 		cntr = sav->cntr++;
-	SECASVAR_UNLOCK(sav);
+		SECASVAR_UNLOCK(sav);
+#endif
+	}
 
 	/*
 	 * Add padding -- better to do it ourselves than use the crypto engine,
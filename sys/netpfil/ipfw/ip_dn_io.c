@@ -826,7 +826,11 @@ dummynet_send(struct mbuf *m)
 	}
 }
 
-static inline int
+/*
+ * Called without the dummynet lock, the caller sets output_time
+ * once it holds it.
+ */
+static inline struct dn_pkt_tag *
 tag_mbuf(struct mbuf *m, int dir, struct ip_fw_args *fwa)
 {
 	struct dn_pkt_tag *dt;
@@ -835,17 +839,15 @@ tag_mbuf(struct mbuf *m, int dir, struct ip_fw_args *fwa)
 	mtag = m_tag_get(PACKET_TAG_DUMMYNET,
 		    sizeof(*dt), M_NOWAIT | M_ZERO);
 	if (mtag == NULL)
-		return 1;		/* Cannot allocate packet header. */
+		return (NULL);		/* Cannot allocate packet header. */
 	m_tag_prepend(m, mtag);		/* Attach to mbuf chain. */
 	dt = (struct dn_pkt_tag *)(mtag + 1);
 	dt->rule = fwa->rule;
 	dt->rule.info &= IPFW_ONEPASS;	/* only keep this info */
 	dt->dn_dir = dir;
 	dt->ifp = fwa->oif;
-	/* dt->output tame is updated as we move through */
-	dt->output_time = dn_cfg.curr_time;
 	dt->iphdr_off = (dir & PROTO_LAYER2) ? ETHER_HDR_LEN : 0;
-	return 0;
+	return (dt);
 }
 
 
@@ -867,14 +869,21 @@ dummynet_io(struct mbuf **m0, int dir, struct ip_fw_args *fwa)
 	struct dn_fsk *fs = NULL;
 	struct dn_sch_inst *si;
 	struct dn_queue *q = NULL;	/* default */
+	struct dn_pkt_tag *dt;
 
 	int fs_id = (fwa->rule.info & IPFW_INFO_MASK) +
 		((fwa->rule.info & IPFW_IS_PIPE) ? 2*DN_MAX_ID : 0);
+	/*
+	 * Allocate the tag before taking the lock, every packet on
+	 * every pipe serializes on it.
+	 */
+	dt = tag_mbuf(m, dir, fwa);
 	DN_BH_WLOCK();
 	io_pkt++;
-	/* we could actually tag outside the lock, but who cares... */
-	if (tag_mbuf(m, dir, fwa))
+	if (dt == NULL)
 		goto dropit;
+	/* dt->output_time is updated as we move through */
+	dt->output_time = dn_cfg.curr_time;
 	if (dn_cfg.busy) {
 		/* if the upper half is busy doing something expensive,
 		 * lets queue the packet and move forward
@@ -124,6 +124,7 @@ static int default_to_accept;
 
 VNET_DEFINE(int, autoinc_step);
 VNET_DEFINE(int, fw_one_pass) = 1;
+VNET_DEFINE(int, fw_skip_proto) = 1;
 
 VNET_DEFINE(unsigned int, fw_tables_max);
 VNET_DEFINE(unsigned int, fw_tables_sets) = 0;	/* Don't use set-aware tables */
@@ -183,6 +184,9 @@ SYSCTL_NODE(_net_inet_ip, OID_AUTO, fw, CTLFLAG_RW, 0, "Firewall");
 SYSCTL_INT(_net_inet_ip_fw, OID_AUTO, one_pass,
     CTLFLAG_VNET | CTLFLAG_RW | CTLFLAG_SECURE3, &VNET_NAME(fw_one_pass), 0,
     "Only do a single pass through ipfw when using dummynet(4)");
+SYSCTL_INT(_net_inet_ip_fw, OID_AUTO, skip_proto,
+    CTLFLAG_VNET | CTLFLAG_RW, &VNET_NAME(fw_skip_proto), 0,
+    "Skip rules that require a different protocol without evaluating them");
 SYSCTL_INT(_net_inet_ip_fw, OID_AUTO, autoinc_step,
     CTLFLAG_VNET | CTLFLAG_RW, &VNET_NAME(autoinc_step), 0,
     "Rule number auto-increment step");
@@ -1752,6 +1756,11 @@ do {								\
 		f = chain->map[f_pos];
 		if (V_set_disable & (1 << f->set) )
 			continue;
+		if (f->proto != 0 && f->proto != proto && V_fw_skip_proto) {
+			/* Loop increment moves us to f->proto_skip. */
+			f_pos = f->proto_skip - 1;
+			continue;
+		}
 
 		skip_or = 0;
 		for (l = f->cmd_len, cmd = f->cmd ; l > 0 ;
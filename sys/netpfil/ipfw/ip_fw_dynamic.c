@@ -311,6 +311,18 @@ VNET_DEFINE_STATIC(struct callout, dyn_timeout);
 VNET_DEFINE_STATIC(uint32_t, curr_max_length);
 #define	V_curr_max_length		VNET(curr_max_length)
 
+/*
+ * dyn_tick() scans 1/dyn_expire_slices of the buckets on each tick,
+ * starting at dyn_expire_next.  dyn_expire_length collects the chain
+ * length maximum until the pass completes and curr_max_length is set.
+ */
+VNET_DEFINE_STATIC(uint32_t, dyn_expire_slices);
+VNET_DEFINE_STATIC(uint32_t, dyn_expire_next);
+VNET_DEFINE_STATIC(uint32_t, dyn_expire_length);
+#define	V_dyn_expire_slices		VNET(dyn_expire_slices)
+#define	V_dyn_expire_next		VNET(dyn_expire_next)
+#define	V_dyn_expire_length		VNET(dyn_expire_length)
+
 VNET_DEFINE_STATIC(uint32_t, dyn_keep_states);
 #define	V_dyn_keep_states		VNET(dyn_keep_states)
 
@@ -482,6 +494,9 @@ SYSCTL_U32(_net_inet_ip_fw, OID_AUTO, dyn_keepalive,
 SYSCTL_U32(_net_inet_ip_fw, OID_AUTO, dyn_keep_states,
     CTLFLAG_VNET | CTLFLAG_RW, &VNET_NAME(dyn_keep_states), 0,
     "Do not flush dynamic states on rule deletion");
+SYSCTL_U32(_net_inet_ip_fw, OID_AUTO, dyn_expire_slices,
+    CTLFLAG_VNET | CTLFLAG_RW, &VNET_NAME(dyn_expire_slices), 0,
+    "Number of ticks over which a full expiration pass is spread.");
 
 
 #ifdef IPFIREWALL_DYNDEBUG
@@ -540,6 +555,8 @@ static struct dyn_ipv4_state *dyn_add_ipv4_parent(void *, uint32_t, uint16_t,
 
 static void dyn_tick(void *);
 static void dyn_expire_states(struct ip_fw_chain *, ipfw_range_tlv *);
+static uint32_t dyn_expire_buckets(struct ip_fw_chain *, ipfw_range_tlv *,
+    uint32_t, uint32_t);
 static void dyn_free_states(struct ip_fw_chain *);
 static void dyn_export_parent(const struct dyn_parent *, uint16_t,
     ipfw_dyn_rule *);
@@ -2154,6 +2171,20 @@ dyn_match_ipv6_state(struct dyn_ipv6_state *s, const ipfw_range_tlv *rt)
  */
 static void
 dyn_expire_states(struct ip_fw_chain *chain, ipfw_range_tlv *rt)
+{
+
+	/* Update curr_max_length for statistics. */
+	V_curr_max_length = dyn_expire_buckets(chain, rt, 0,
+	    V_curr_dyn_buckets);
+}
+
+/*
+ * Unlink expired states from buckets [first, last).
+ * Returns the maximum chain length seen in these buckets.
+ */
+static uint32_t
+dyn_expire_buckets(struct ip_fw_chain *chain, ipfw_range_tlv *rt,
+    uint32_t first, uint32_t last)
 {
 	struct dyn_ipv4_slist expired_ipv4;
 #ifdef INET6
@@ -2161,7 +2192,8 @@ dyn_expire_states(struct ip_fw_chain *chain, ipfw_range_tlv *rt)
 	struct dyn_ipv6_state *s6, *s6n, *s6p;
 #endif
 	struct dyn_ipv4_state *s4, *s4n, *s4p;
-	int bucket, removed, length, max_length;
+	uint32_t bucket;
+	int removed, length, max_length;
 
 	/*
 	 * Unlink expired states from each bucket.
@@ -2221,7 +2253,7 @@ dyn_expire_states(struct ip_fw_chain *chain, ipfw_range_tlv *rt)
 	SLIST_INIT(&expired_ipv6);
 #endif
 	max_length = 0;
-	for (bucket = 0; bucket < V_curr_dyn_buckets; bucket++) {
+	for (bucket = first; bucket < last; bucket++) {
 		DYN_BUCKET_LOCK(bucket);
 		DYN_UNLINK_STATES(s4, s4p, s4n, data->expire, ipv4, ipv4, 1);
 		DYN_UNLINK_STATES(s4, s4p, s4n, limit->expire, ipv4,
@@ -2233,8 +2265,6 @@ dyn_expire_states(struct ip_fw_chain *chain, ipfw_range_tlv *rt)
 #endif
 		DYN_BUCKET_UNLOCK(bucket);
 	}
-	/* Update curr_max_length for statistics. */
-	V_curr_max_length = max_length;
 	/*
 	 * Concatenate temporary lists with global expired lists.
 	 */
@@ -2248,6 +2278,7 @@ dyn_expire_states(struct ip_fw_chain *chain, ipfw_range_tlv *rt)
 	DYN_EXPIRED_UNLOCK();
 #undef DYN_UNLINK_STATES
 #undef DYN_UNREF_STATES
+	return (max_length);
 }
 
 static struct mbuf *
@@ -2622,7 +2653,7 @@ dyn_grow_hashtable(struct ip_fw_chain *chain, uint32_t new)
 static void
 dyn_tick(void *vnetx)
 {
-	uint32_t buckets;
+	uint32_t buckets, first, last, length;
 
 	CURVNET_SET((struct vnet *)vnetx);
 	/*
@@ -2636,7 +2667,33 @@ dyn_tick(void *vnetx)
 	 * deletion of state entries from states lists.
 	 */
 	IPFW_UH_WLOCK(&V_layer3_chain);
-	dyn_expire_states(&V_layer3_chain, NULL);
+	if (V_dyn_expire_slices <= 1)
+		dyn_expire_states(&V_layer3_chain, NULL);
+	else {
+		/*
+		 * With millions of states a full pass holds the lock
+		 * for too long, so scan only one slice per tick.  A
+		 * state may then outlive its expire time by up to
+		 * dyn_expire_slices - 1 seconds.
+		 */
+		first = V_dyn_expire_next;
+		if (first >= V_curr_dyn_buckets) {
+			/* Start over, the hash may have been resized. */
+			first = 0;
+			V_dyn_expire_length = 0;
+		}
+		last = first + howmany(V_curr_dyn_buckets,
+		    V_dyn_expire_slices);
+		if (last > V_curr_dyn_buckets)
+			last = V_curr_dyn_buckets;
+		length = dyn_expire_buckets(&V_layer3_chain, NULL,
+		    first, last);
+		if (length > V_dyn_expire_length)
+			V_dyn_expire_length = length;
+		V_dyn_expire_next = last;
+		if (last == V_curr_dyn_buckets)
+			V_curr_max_length = V_dyn_expire_length;
+	}
 	IPFW_UH_WUNLOCK(&V_layer3_chain);
 	/*
 	 * Send keepalives if they are enabled and the time has come.
@@ -2980,6 +3037,8 @@ ipfw_dyn_init(struct ip_fw_chain *chain)
 	V_dyn_keepalive = 1;		/* send keepalives */
 	V_dyn_keepalive_last = time_uptime;
 
+	V_dyn_expire_slices = 1;	/* full pass on every tick */
+
 	V_dyn_data_zone = uma_zcreate("IPFW dynamic states data",
 	    sizeof(struct dyn_data), NULL, NULL, NULL, NULL,
 	    UMA_ALIGN_PTR, 0);
@@ -231,6 +231,9 @@ uint32_t ipfw_dyn_get_count(void);
 VNET_DECLARE(int, fw_one_pass);
 #define	V_fw_one_pass		VNET(fw_one_pass)
 
+VNET_DECLARE(int, fw_skip_proto);
+#define	V_fw_skip_proto		VNET(fw_skip_proto)
+
 VNET_DECLARE(int, fw_verbose);
 #define	V_fw_verbose		VNET(fw_verbose)
 
@@ -267,6 +270,12 @@ struct tables_config;
  *  r->cmd		is the start of the first instruction.
  *  ACTION_PTR(r)	is the start of the first action (things to do
  *			once a rule matched).
+ *
+ * If the rule body can only match a single protocol, r->proto holds
+ * it and r->proto_skip is the index of the next rule in the map that
+ * does not require the same protocol.  ipfw_chk() uses these to skip
+ * runs of rules for other protocols without interpreting them.
+ * Both are recomputed whenever a new map is installed.
  */
 
 struct ip_fw {
@@ -280,6 +289,8 @@ struct ip_fw {
 	uint32_t	id;		/* rule id			*/
 	uint32_t	cached_id;	/* used by jump_fast		*/
 	uint32_t	cached_pos;	/* used by jump_fast		*/
+	uint32_t	proto_skip;	/* next rule with other proto	*/
+	uint8_t		proto;		/* protocol required, or 0	*/
 
 	ipfw_insn	cmd[1];		/* storage for commands		*/
 };
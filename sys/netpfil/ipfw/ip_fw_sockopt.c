@@ -374,6 +374,54 @@ get_map(struct ip_fw_chain *chain, int extra, int locked)
 	}
 }
 
+/*
+ * Returns the protocol the body of rule @rule must match for the rule
+ * to match, or 0 if there is no such single protocol.  Only a plain
+ * O_PROTO outside any OR block qualifies.  Rules that probe dynamic
+ * states may jump into another rule's body and are never filtered.
+ */
+static uint8_t
+rule_required_proto(struct ip_fw *rule)
+{
+	ipfw_insn *cmd;
+	int l, cmdlen, prev_or;
+
+	prev_or = 0;
+	for (l = rule->act_ofs, cmd = rule->cmd; l > 0;
+	    l -= cmdlen, cmd += cmdlen) {
+		cmdlen = F_LEN(cmd);
+		if (cmd->opcode == O_PROBE_STATE)
+			return (0);
+		if (cmd->opcode == O_PROTO && prev_or == 0 &&
+		    (cmd->len & (F_NOT | F_OR)) == 0)
+			return (cmd->arg1);
+		prev_or = cmd->len & F_OR;
+	}
+	return (0);
+}
+
+/*
+ * Builds the per-rule protocol skip steps on rule set @map.
+ * Walking backwards, each rule points past the run of following
+ * rules that require the same protocol.  The default rule never
+ * requires one, so every run ends before it.
+ */
+static void
+update_proto_skip(struct ip_fw **map, int n)
+{
+	struct ip_fw *rule;
+	int i;
+
+	for (i = n - 1; i >= 0; i--) {
+		rule = map[i];
+		rule->proto = rule_required_proto(rule);
+		if (i == n - 1 || rule->proto != map[i + 1]->proto)
+			rule->proto_skip = i + 1;
+		else
+			rule->proto_skip = map[i + 1]->proto_skip;
+	}
+}
+
 /*
  * swap the maps. It is supposed to be called with IPFW_UH_WLOCK
  */
@@ -388,6 +436,11 @@ swap_map(struct ip_fw_chain *chain, struct ip_fw **new_map, int new_len)
 	old_map = chain->map;
 	chain->map = new_map;
 	swap_skipto_cache(chain);
+	/*
+	 * Rules are shared with the old map, so their skip steps may
+	 * only change once no packet can be walking it.
+	 */
+	update_proto_skip(new_map, new_len);
 	IPFW_WUNLOCK(chain);
 	return old_map;
 }
@@ -422,14 +422,29 @@ pf_addr_cmp(struct pf_addr *a, struct pf_addr *b, sa_family_t af)
 	return (0);
 }
 
+CTASSERT(offsetof(struct pf_state_key_cmp, port) == 8 * sizeof(uint32_t));
+CTASSERT(sizeof(struct pf_state_key_cmp) == 10 * sizeof(uint32_t));
+
 static __inline uint32_t
 pf_hashkey(struct pf_state_key *sk)
 {
-	uint32_t h;
+	uint32_t h, k[4];
 
-	h = murmur3_32_hash32((uint32_t *)sk,
-	    sizeof(struct pf_state_key_cmp)/sizeof(uint32_t),
-	    V_pf_hashseed);
+	/*
+	 * An IPv4 key only uses the first word of each address, so only
+	 * hash the four words that can differ.  This is the common case
+	 * and runs for every packet.
+	 */
+	if (sk->af == AF_INET) {
+		k[0] = sk->addr[0].v4.s_addr;
+		k[1] = sk->addr[1].v4.s_addr;
+		k[2] = ((uint32_t *)sk)[8];	/* port[2] */
+		k[3] = ((uint32_t *)sk)[9];	/* af, proto and pad */
+		h = murmur3_32_hash32(k, nitems(k), V_pf_hashseed);
+	} else
+		h = murmur3_32_hash32((uint32_t *)sk,
+		    sizeof(struct pf_state_key_cmp)/sizeof(uint32_t),
+		    V_pf_hashseed);
 
 	return (h & pf_hashmask);
 }
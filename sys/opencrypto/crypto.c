@@ -952,10 +952,12 @@ crypto_unblock(u_int32_t driverid, int what)
 }
 
 /*
- * Add a crypto request to a queue, to be processed by the kernel thread.
+ * Hand a request to its driver, or to the crypto task queue for
+ * CRYPTO_F_ASYNC requests.  Returns ERESTART if the request has to go
+ * on the queue serviced by the kernel thread instead.
  */
-int
-crypto_dispatch(struct cryptop *crp)
+static int
+crypto_dispatch_one(struct cryptop *crp, int hint)
 {
 	struct cryptocap *cap;
 	u_int32_t hid;
@@ -986,7 +988,13 @@ crypto_dispatch(struct cryptop *crp)
 		return (0);
 	}
 
-	if ((crp->crp_flags & CRYPTO_F_BATCH) == 0) {
+	/*
+	 * Synchronous drivers do the work on the CPU; there is nothing
+	 * to gain from batching for them, only a thread hop, so run
+	 * those requests inline even if the caller asked for a batch.
+	 */
+	if ((crp->crp_flags & CRYPTO_F_BATCH) == 0 ||
+	    (crypto_ses2caps(crp->crp_session) & CRYPTOCAP_F_SYNC) != 0) {
 		hid = crypto_ses2hid(crp->crp_session);
 
 		/*
@@ -998,7 +1006,7 @@ crypto_dispatch(struct cryptop *crp)
 		/* Driver cannot disappeared when there is an active session. */
 		KASSERT(cap != NULL, ("%s: Driver disappeared.", __func__));
 		if (!cap->cc_qblocked) {
-			result = crypto_invoke(cap, crp, 0);
+			result = crypto_invoke(cap, crp, hint);
 			if (result != ERESTART)
 				return (result);
 			/*
@@ -1007,8 +1015,62 @@ crypto_dispatch(struct cryptop *crp)
 			 */
 		}
 	}
-	crypto_batch_enqueue(crp);
-	return 0;
+	return (ERESTART);
+}
+
+/*
+ * Add a crypto request to a queue, to be processed by the kernel thread.
+ */
+int
+crypto_dispatch(struct cryptop *crp)
+{
+	int result;
+
+	result = crypto_dispatch_one(crp, 0);
+	if (result == ERESTART) {
+		crypto_batch_enqueue(crp);
+		result = 0;
+	}
+	return (result);
+}
+
+/*
+ * Dispatch a list of crypto requests.  Each one is handled as by
+ * crypto_dispatch(), but the driver is told when more requests for it
+ * follow, and the requests that must wait for the kernel thread are
+ * queued with a single lock round trip and wakeup.  The list is empty
+ * on return; the first error returned by a driver, if any, is passed
+ * back, and the remaining requests are still dispatched.
+ */
+int
+crypto_dispatch_batch(struct cryptopq *crpq)
+{
+	struct cryptopq queued;
+	struct cryptop *crp, *next;
+	int error, hint, result;
+
+	error = 0;
+	TAILQ_INIT(&queued);
+	TAILQ_FOREACH_SAFE(crp, crpq, crp_next, next) {
+		TAILQ_REMOVE(crpq, crp, crp_next);
+		hint = 0;
+		if (next != NULL && crypto_ses2hid(next->crp_session) ==
+		    crypto_ses2hid(crp->crp_session))
+			hint = CRYPTO_HINT_MORE;
+		result = crypto_dispatch_one(crp, hint);
+		if (result == ERESTART)
+			TAILQ_INSERT_TAIL(&queued, crp, crp_next);
+		else if (result != 0 && error == 0)
+			error = result;
+	}
+	if (!TAILQ_EMPTY(&queued)) {
+		CRYPTO_Q_LOCK();
+		TAILQ_CONCAT(&crp_q, &queued, crp_next);
+		if (crp_sleep)
+			wakeup_one(&crp_q);
+		CRYPTO_Q_UNLOCK();
+	}
+	return (error);
 }
 
 void
@@ -73,6 +73,31 @@ static	int swcr_authenc(struct cryptop *crp);
 static	int swcr_compdec(struct cryptodesc *, struct swcr_data *, caddr_t, int);
 static	void swcr_freesession(device_t dev, crypto_session_t cses);
 
+/*
+ * Callers such as GELI pass a key with every request even when it has not
+ * changed since the last one.  Remember the key the session's schedule was
+ * built from so that it, rather than a fresh setkey(), can be reused.
+ */
+static int
+swcr_key_cached(const struct swcr_data *sw, const void *key, int klen)
+{
+
+	return (sw->sw_kschedule != NULL && sw->sw_keylen != 0 &&
+	    sw->sw_keylen == klen && memcmp(sw->sw_key, key, klen) == 0);
+}
+
+static void
+swcr_key_cache(struct swcr_data *sw, const void *key, int klen)
+{
+
+	if (klen > sizeof(sw->sw_key)) {
+		sw->sw_keylen = 0;
+		return;
+	}
+	memcpy(sw->sw_key, key, klen);
+	sw->sw_keylen = klen;
+}
+
 /*
  * Apply a symmetric encryption/decryption algorithm.
  */
@@ -126,7 +151,8 @@ swcr_encdec(struct cryptodesc *crd, struct swcr_data *sw, caddr_t buf,
 		}
 	}
 
-	if (crd->crd_flags & CRD_F_KEY_EXPLICIT) {
+	if ((crd->crd_flags & CRD_F_KEY_EXPLICIT) &&
+	    !swcr_key_cached(sw, crd->crd_key, crd->crd_klen / 8)) {
 		int error; 
 
 		if (sw->sw_kschedule)
@@ -136,6 +162,7 @@ swcr_encdec(struct cryptodesc *crd, struct swcr_data *sw, caddr_t buf,
 				crd->crd_key, crd->crd_klen / 8);
 		if (error)
 			return (error);
+		swcr_key_cache(sw, crd->crd_key, crd->crd_klen / 8);
 	}
 
 	iov = iovlcl;
@@ -820,6 +847,8 @@ swcr_newsession(device_t dev, crypto_session_t cses, struct cryptoini *cri)
 					swcr_freesession(dev, cses);
 					return error;
 				}
+				swcr_key_cache(swd, cri->cri_key,
+				    cri->cri_klen / 8);
 			}
 			swd->sw_exf = txf;
 			break;
@@ -1046,6 +1075,8 @@ swcr_freesession(device_t dev, crypto_session_t cses)
 
 			if (swd->sw_kschedule)
 				txf->zerokey(&(swd->sw_kschedule));
+			explicit_bzero(swd->sw_key, sizeof(swd->sw_key));
+			swd->sw_keylen = 0;
 			break;
 
 		case CRYPTO_MD5_HMAC:
@@ -1246,7 +1277,8 @@ swcr_attach(device_t dev)
 	memset(hmac_opad_buffer, HMAC_OPAD_VAL, HMAC_MAX_BLOCK_LEN);
 
 	swcr_id = crypto_get_driverid(dev, sizeof(struct swcr_session),
-			CRYPTOCAP_F_SOFTWARE | CRYPTOCAP_F_SYNC);
+			CRYPTOCAP_F_SOFTWARE | CRYPTOCAP_F_SYNC |
+			CRYPTOCAP_F_CHAIN);
 	if (swcr_id < 0) {
 		device_printf(dev, "cannot initialize!");
 		return ENOMEM;
@@ -39,6 +39,8 @@ struct swcr_data {
 		struct {
 			u_int8_t	 *SW_kschedule;
 			struct enc_xform *SW_exf;
+			u_int16_t	 SW_keylen;
+			u_int8_t	 SW_key[AES_XTS_MAX_KEY];
 		} SWCR_ENC;
 		struct {
 			u_int32_t	 SW_size;
@@ -53,6 +55,8 @@ struct swcr_data {
 #define sw_axf		SWCR_UN.SWCR_AUTH.SW_axf
 #define sw_kschedule	SWCR_UN.SWCR_ENC.SW_kschedule
 #define sw_exf		SWCR_UN.SWCR_ENC.SW_exf
+#define sw_keylen	SWCR_UN.SWCR_ENC.SW_keylen
+#define sw_key		SWCR_UN.SWCR_ENC.SW_key
 #define sw_size		SWCR_UN.SWCR_COMP.SW_size
 #define sw_cxf		SWCR_UN.SWCR_COMP.SW_cxf
 };
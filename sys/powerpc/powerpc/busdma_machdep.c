@@ -534,7 +534,8 @@ bus_dmamem_alloc(bus_dma_tag_t dmat, void** vaddr, int flags,
 	   (dmat->alignment <= dmat->maxsize) &&
 	    dmat->lowaddr >= ptoa((vm_paddr_t)Maxmem) &&
 	    attr == VM_MEMATTR_DEFAULT) {
-		*vaddr = malloc(dmat->maxsize, M_DEVBUF, mflags);
+		*vaddr = malloc(MALLOC_ALIGNED_SIZE(dmat->maxsize), M_DEVBUF,
+		    mflags);
 	} else {
 		/*
 		 * XXX Use Contigmalloc until it is merged into this facility
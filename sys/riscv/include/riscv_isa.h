@@ -0,0 +1,74 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause-FreeBSD
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $FreeBSD$
+ */
+
+#ifndef	_MACHINE_RISCV_ISA_H_
+#define	_MACHINE_RISCV_ISA_H_
+
+/*
+ * ISA extension bits.  The single-letter extensions use bit (c - 'a'),
+ * which is also the layout of AT_HWCAP.  Multi-letter extensions the
+ * kernel knows about live above bit 31; AT_HWCAP2 carries them shifted
+ * down by RISCV_ISA_HWCAP2_SHIFT.
+ */
+#define	RISCV_ISA_BIT(c)	(1ul << ((c) - 'a'))
+#define	RISCV_ISA_A		RISCV_ISA_BIT('a')
+#define	RISCV_ISA_C		RISCV_ISA_BIT('c')
+#define	RISCV_ISA_D		RISCV_ISA_BIT('d')
+#define	RISCV_ISA_F		RISCV_ISA_BIT('f')
+#define	RISCV_ISA_I		RISCV_ISA_BIT('i')
+#define	RISCV_ISA_M		RISCV_ISA_BIT('m')
+#define	RISCV_ISA_V		RISCV_ISA_BIT('v')
+#define	RISCV_ISA_LETTERS	(RISCV_ISA_BIT('z') * 2 - 1)
+
+#define	RISCV_ISA_ZBA		(1ul << 32)
+#define	RISCV_ISA_ZBB		(1ul << 33)
+#define	RISCV_ISA_ZBS		(1ul << 34)
+#define	RISCV_ISA_ZICBOM	(1ul << 35)
+#define	RISCV_ISA_ZICBOZ	(1ul << 36)
+#define	RISCV_ISA_SSTC		(1ul << 37)
+
+#define	RISCV_ISA_HWCAP2_SHIFT	32
+
+#ifdef _KERNEL
+/*
+ * Extensions implemented by every hart, valid from SI_SUB_CPU on.
+ * Routines with optimized variants pick one from a SYSINIT at
+ * SI_SUB_CPU, SI_ORDER_ANY or later by testing these bits.
+ */
+extern u_long	riscv_isa;
+extern u_long	elf_hwcap;
+extern u_long	elf_hwcap2;
+
+#define	riscv_isa_has(mask)	((riscv_isa & (mask)) == (mask))
+
+u_long	riscv_isa_parse(const char *);
+u_long	riscv_cpu_isa(u_int);
+#endif
+
+#endif /* !_MACHINE_RISCV_ISA_H_ */
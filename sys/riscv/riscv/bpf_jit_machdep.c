@@ -0,0 +1,562 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (C) 2002-2003 NetGroup, Politecnico di Torino (Italy)
+ * Copyright (C) 2005-2017 Jung-uk Kim <jkim@FreeBSD.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Politecnico di Torino nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <sys/cdefs.h>
+__FBSDID("$FreeBSD$");
+
+#ifdef _KERNEL
+#include "opt_bpf.h"
+#include <sys/param.h>
+#include <sys/systm.h>
+#include <sys/kernel.h>
+#include <sys/malloc.h>
+#include <sys/mbuf.h>
+#include <sys/socket.h>
+
+#include <net/if.h>
+
+#include <vm/vm.h>
+#include <vm/pmap.h>
+#else
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/param.h>
+#endif
+
+#include <sys/types.h>
+
+#include <net/bpf.h>
+#include <net/bpf_jitter.h>
+
+#include <riscv/riscv/bpf_jit_machdep.h>
+
+/*
+ * Emit routine to update the jump table.
+ */
+static void
+emit_length(bpf_bin_stream *stream, __unused u_int value, u_int len)
+{
+
+	if (stream->refs != NULL)
+		(stream->refs)[stream->bpf_pc] += len;
+	stream->cur_ip += len;
+}
+
+/*
+ * Emit routine to output the actual binary code.
+ */
+static void
+emit_code(bpf_bin_stream *stream, u_int value, u_int len)
+{
+
+	*((u_int *)(void *)(stream->ibuf + stream->cur_ip)) = value;
+	stream->cur_ip += len;
+}
+
+/*
+ * Scan the filter program and find possible optimization.
+ */
+static int
+bpf_jit_optimize(struct bpf_insn *prog, u_int nins)
+{
+	int flags;
+	u_int i;
+
+	/* Do we return immediately? */
+	if (BPF_CLASS(prog[0].code) == BPF_RET)
+		return (BPF_JIT_FRET);
+
+	for (flags = 0, i = 0; i < nins; i++) {
+		switch (prog[i].code) {
+		case BPF_LD|BPF_W|BPF_ABS:
+		case BPF_LD|BPF_H|BPF_ABS:
+		case BPF_LD|BPF_B|BPF_ABS:
+		case BPF_LD|BPF_W|BPF_IND:
+		case BPF_LD|BPF_H|BPF_IND:
+		case BPF_LD|BPF_B|BPF_IND:
+		case BPF_LDX|BPF_MSH|BPF_B:
+			flags |= BPF_JIT_FPKT;
+			break;
+		case BPF_LD|BPF_MEM:
+		case BPF_LDX|BPF_MEM:
+		case BPF_ST:
+		case BPF_STX:
+			flags |= BPF_JIT_FMEM;
+			break;
+		case BPF_JMP|BPF_JA:
+		case BPF_JMP|BPF_JGT|BPF_K:
+		case BPF_JMP|BPF_JGE|BPF_K:
+		case BPF_JMP|BPF_JEQ|BPF_K:
+		case BPF_JMP|BPF_JSET|BPF_K:
+		case BPF_JMP|BPF_JGT|BPF_X:
+		case BPF_JMP|BPF_JGE|BPF_X:
+		case BPF_JMP|BPF_JEQ|BPF_X:
+		case BPF_JMP|BPF_JSET|BPF_X:
+			flags |= BPF_JIT_FJMP;
+			break;
+		}
+		if (flags == BPF_JIT_FLAG_ALL)
+			break;
+	}
+
+	return (flags);
+}
+
+/*
+ * Check that the 'len' bytes at [k, k + len) are inside the buffer and
+ * leave a pointer past their end in T1.
+ */
+#define	PKT_ABS(len) do {						\
+	if (ins->k + (u_int)(len) < ins->k) {				\
+		ADDI(A0, ZERO, 0);					\
+		if (fmem)						\
+			ADDI(SP, SP, BPF_JIT_FRAME);			\
+		RET();							\
+	} else {							\
+		LIU(T0, ins->k + (len));				\
+		RET0_UNLESS(fmem, BGEU, REG_BLEN, T0);			\
+		ADD(T1, REG_P, T0);					\
+	}								\
+} while (0)
+
+/*
+ * Same as above for [X + k, X + k + len).  The sum is computed on 64
+ * bits so it cannot wrap.
+ */
+#define	PKT_IND(len) do {						\
+	ZEXT(T0, REG_X);						\
+	if (ins->k <= 2047 - (len))					\
+		ADDI(T0, T0, ins->k + (len));				\
+	else {								\
+		LIU(T1, ins->k);					\
+		ADD(T0, T0, T1);					\
+		ADDI(T0, T0, (len));					\
+	}								\
+	RET0_UNLESS(fmem, BGEU, REG_BLEN, T0);				\
+	ADD(T1, REG_P, T0);						\
+} while (0)
+
+/*
+ * Function that does the real stuff.
+ */
+bpf_filter_func
+bpf_jit_compile(struct bpf_insn *prog, u_int nins, size_t *size)
+{
+	bpf_bin_stream stream;
+	struct bpf_insn *ins;
+	int flags, fret, fpkt, fmem, fjmp;
+	u_int i, pass;
+
+	/*
+	 * NOTE: Do not modify the name of this variable, as it's used by
+	 * the macros to emit code.
+	 */
+	emit_func emitm;
+
+	flags = bpf_jit_optimize(prog, nins);
+	fret = (flags & BPF_JIT_FRET) != 0;
+	fpkt = (flags & BPF_JIT_FPKT) != 0;
+	fmem = (flags & BPF_JIT_FMEM) != 0;
+	fjmp = (flags & BPF_JIT_FJMP) != 0;
+
+	if (fret)
+		nins = 1;
+
+	memset(&stream, 0, sizeof(stream));
+
+	/* Allocate the reference table for the jumps. */
+	if (fjmp) {
+#ifdef _KERNEL
+		stream.refs = malloc((nins + 1) * sizeof(u_int), M_BPFJIT,
+		    M_NOWAIT | M_ZERO);
+#else
+		stream.refs = calloc(nins + 1, sizeof(u_int));
+#endif
+		if (stream.refs == NULL)
+			return (NULL);
+	}
+
+	/*
+	 * The first pass will emit the lengths of the instructions
+	 * to create the reference table.
+	 */
+	emitm = emit_length;
+
+	for (pass = 0; pass < 2; pass++) {
+		ins = prog;
+
+		/* Create the procedure header. */
+		if (fmem)
+			ADDI(SP, SP, -BPF_JIT_FRAME);
+		if (fpkt)
+			ZEXT(REG_BLEN, REG_BLEN);
+		MV(REG_A, ZERO);
+		MV(REG_X, ZERO);
+
+		for (i = 0; i < nins; i++) {
+			stream.bpf_pc++;
+
+			switch (ins->code) {
+			default:
+#ifdef _KERNEL
+				return (NULL);
+#else
+				abort();
+#endif
+
+			case BPF_RET|BPF_K:
+				LI(A0, ins->k);
+				if (fmem)
+					ADDI(SP, SP, BPF_JIT_FRAME);
+				RET();
+				break;
+
+			case BPF_RET|BPF_A:
+				MV(A0, REG_A);
+				if (fmem)
+					ADDI(SP, SP, BPF_JIT_FRAME);
+				RET();
+				break;
+
+			case BPF_LD|BPF_W|BPF_ABS:
+				PKT_ABS(sizeof(int32_t));
+				LDW(REG_A, T1);
+				break;
+
+			case BPF_LD|BPF_H|BPF_ABS:
+				PKT_ABS(sizeof(int16_t));
+				LDH(REG_A, T1);
+				break;
+
+			case BPF_LD|BPF_B|BPF_ABS:
+				PKT_ABS(sizeof(int8_t));
+				LDB(REG_A, T1);
+				break;
+
+			case BPF_LD|BPF_W|BPF_LEN:
+				MV(REG_A, REG_WLEN);
+				break;
+
+			case BPF_LDX|BPF_W|BPF_LEN:
+				MV(REG_X, REG_WLEN);
+				break;
+
+			case BPF_LD|BPF_W|BPF_IND:
+				PKT_IND(sizeof(int32_t));
+				LDW(REG_A, T1);
+				break;
+
+			case BPF_LD|BPF_H|BPF_IND:
+				PKT_IND(sizeof(int16_t));
+				LDH(REG_A, T1);
+				break;
+
+			case BPF_LD|BPF_B|BPF_IND:
+				PKT_IND(sizeof(int8_t));
+				LDB(REG_A, T1);
+				break;
+
+			case BPF_LDX|BPF_MSH|BPF_B:
+				PKT_ABS(sizeof(int8_t));
+				LDB(REG_X, T1);
+				ANDI(REG_X, REG_X, 0x0f);
+				SLLI(REG_X, REG_X, 2);
+				break;
+
+			case BPF_LD|BPF_IMM:
+				LI(REG_A, ins->k);
+				break;
+
+			case BPF_LDX|BPF_IMM:
+				LI(REG_X, ins->k);
+				break;
+
+			case BPF_LD|BPF_MEM:
+				LW(REG_A, SP, ins->k * sizeof(uint32_t));
+				break;
+
+			case BPF_LDX|BPF_MEM:
+				LW(REG_X, SP, ins->k * sizeof(uint32_t));
+				break;
+
+			case BPF_ST:
+				SW(REG_A, SP, ins->k * sizeof(uint32_t));
+				break;
+
+			case BPF_STX:
+				SW(REG_X, SP, ins->k * sizeof(uint32_t));
+				break;
+
+			case BPF_JMP|BPF_JA:
+				JUMP(ins->k);
+				break;
+
+			case BPF_JMP|BPF_JGT|BPF_K:
+			case BPF_JMP|BPF_JGE|BPF_K:
+			case BPF_JMP|BPF_JEQ|BPF_K:
+			case BPF_JMP|BPF_JSET|BPF_K:
+			case BPF_JMP|BPF_JGT|BPF_X:
+			case BPF_JMP|BPF_JGE|BPF_X:
+			case BPF_JMP|BPF_JEQ|BPF_X:
+			case BPF_JMP|BPF_JSET|BPF_X:
+				if (ins->jt == ins->jf) {
+					JUMP(ins->jt);
+					break;
+				}
+				if (BPF_SRC(ins->code) == BPF_K &&
+				    (BPF_OP(ins->code) != BPF_JSET ||
+				    !IMM12(ins->k)))
+					LI(T0, ins->k);
+				switch (ins->code) {
+				case BPF_JMP|BPF_JGT|BPF_K:
+					JCC(BLTU, BGEU, T0, REG_A);
+					break;
+
+				case BPF_JMP|BPF_JGE|BPF_K:
+					JCC(BGEU, BLTU, REG_A, T0);
+					break;
+
+				case BPF_JMP|BPF_JEQ|BPF_K:
+					JCC(BEQ, BNE, REG_A, T0);
+					break;
+
+				case BPF_JMP|BPF_JSET|BPF_K:
+					if (IMM12(ins->k))
+						ANDI(T0, REG_A, ins->k);
+					else
+						AND(T0, REG_A, T0);
+					JCC(BNE, BEQ, T0, ZERO);
+					break;
+
+				case BPF_JMP|BPF_JGT|BPF_X:
+					JCC(BLTU, BGEU, REG_X, REG_A);
+					break;
+
+				case BPF_JMP|BPF_JGE|BPF_X:
+					JCC(BGEU, BLTU, REG_A, REG_X);
+					break;
+
+				case BPF_JMP|BPF_JEQ|BPF_X:
+					JCC(BEQ, BNE, REG_A, REG_X);
+					break;
+
+				case BPF_JMP|BPF_JSET|BPF_X:
+					AND(T0, REG_A, REG_X);
+					JCC(BNE, BEQ, T0, ZERO);
+					break;
+				}
+				break;
+
+			case BPF_ALU|BPF_ADD|BPF_X:
+				ADDW(REG_A, REG_A, REG_X);
+				break;
+
+			case BPF_ALU|BPF_SUB|BPF_X:
+				SUBW(REG_A, REG_A, REG_X);
+				break;
+
+			case BPF_ALU|BPF_MUL|BPF_X:
+				MULW(REG_A, REG_A, REG_X);
+				break;
+
+			case BPF_ALU|BPF_DIV|BPF_X:
+			case BPF_ALU|BPF_MOD|BPF_X:
+				RET0_UNLESS(fmem, BNE, REG_X, ZERO);
+				if (BPF_OP(ins->code) == BPF_MOD)
+					REMUW(REG_A, REG_A, REG_X);
+				else
+					DIVUW(REG_A, REG_A, REG_X);
+				break;
+
+			case BPF_ALU|BPF_AND|BPF_X:
+				AND(REG_A, REG_A, REG_X);
+				break;
+
+			case BPF_ALU|BPF_OR|BPF_X:
+				OR(REG_A, REG_A, REG_X);
+				break;
+
+			case BPF_ALU|BPF_XOR|BPF_X:
+				XOR(REG_A, REG_A, REG_X);
+				break;
+
+			case BPF_ALU|BPF_LSH|BPF_X:
+				SLLW(REG_A, REG_A, REG_X);
+				break;
+
+			case BPF_ALU|BPF_RSH|BPF_X:
+				SRLW(REG_A, REG_A, REG_X);
+				break;
+
+			case BPF_ALU|BPF_ADD|BPF_K:
+				if (IMM12(ins->k))
+					ADDIW(REG_A, REG_A, ins->k);
+				else {
+					LI(T0, ins->k);
+					ADDW(REG_A, REG_A, T0);
+				}
+				break;
+
+			case BPF_ALU|BPF_SUB|BPF_K:
+				LI(T0, ins->k);
+				SUBW(REG_A, REG_A, T0);
+				break;
+
+			case BPF_ALU|BPF_MUL|BPF_K:
+				LI(T0, ins->k);
+				MULW(REG_A, REG_A, T0);
+				break;
+
+			case BPF_ALU|BPF_DIV|BPF_K:
+			case BPF_ALU|BPF_MOD|BPF_K:
+				LI(T0, ins->k);
+				if (BPF_OP(ins->code) == BPF_MOD)
+					REMUW(REG_A, REG_A, T0);
+				else
+					DIVUW(REG_A, REG_A, T0);
+				break;
+
+			case BPF_ALU|BPF_AND|BPF_K:
+				if (IMM12(ins->k))
+					ANDI(REG_A, REG_A, ins->k);
+				else {
+					LI(T0, ins->k);
+					AND(REG_A, REG_A, T0);
+				}
+				break;
+
+			case BPF_ALU|BPF_OR|BPF_K:
+				if (IMM12(ins->k))
+					ORI(REG_A, REG_A, ins->k);
+				else {
+					LI(T0, ins->k);
+					OR(REG_A, REG_A, T0);
+				}
+				break;
+
+			case BPF_ALU|BPF_XOR|BPF_K:
+				if (IMM12(ins->k))
+					XORI(REG_A, REG_A, ins->k);
+				else {
+					LI(T0, ins->k);
+					XOR(REG_A, REG_A, T0);
+				}
+				break;
+
+			case BPF_ALU|BPF_LSH|BPF_K:
+				SLLIW(REG_A, REG_A, ins->k);
+				break;
+
+			case BPF_ALU|BPF_RSH|BPF_K:
+				SRLIW(REG_A, REG_A, ins->k);
+				break;
+
+			case BPF_ALU|BPF_NEG:
+				SUBW(REG_A, ZERO, REG_A);
+				break;
+
+			case BPF_MISC|BPF_TAX:
+				MV(REG_X, REG_A);
+				break;
+
+			case BPF_MISC|BPF_TXA:
+				MV(REG_A, REG_X);
+				break;
+			}
+			ins++;
+		}
+
+		if (pass > 0)
+			continue;
+
+		*size = stream.cur_ip;
+#ifdef _KERNEL
+		stream.ibuf = malloc(*size, M_BPFJIT, M_EXEC | M_NOWAIT);
+		if (stream.ibuf == NULL)
+			break;
+#else
+		stream.ibuf = mmap(NULL, *size, PROT_READ | PROT_WRITE,
+		    MAP_ANON, -1, 0);
+		if (stream.ibuf == MAP_FAILED) {
+			stream.ibuf = NULL;
+			break;
+		}
+#endif
+
+		/*
+		 * Modify the reference table to contain the offsets and
+		 * not the lengths of the instructions.
+		 */
+		if (fjmp)
+			for (i = 1; i < nins + 1; i++)
+				stream.refs[i] += stream.refs[i - 1];
+
+		/* Reset the counters. */
+		stream.cur_ip = 0;
+		stream.bpf_pc = 0;
+
+		/* The second pass creates the actual code. */
+		emitm = emit_code;
+	}
+
+	/*
+	 * The reference table is needed only during compilation,
+	 * now we can free it.
+	 */
+	if (fjmp)
+#ifdef _KERNEL
+		free(stream.refs, M_BPFJIT);
+#else
+		free(stream.refs);
+#endif
+
+	/*
+	 * The code was written through the data cache; make it visible
+	 * to instruction fetch before anybody calls it.
+	 */
+#ifdef _KERNEL
+	if (stream.ibuf != NULL)
+		pmap_sync_icache(kernel_pmap, (vm_offset_t)stream.ibuf, *size);
+#else
+	if (stream.ibuf != NULL &&
+	    mprotect(stream.ibuf, *size, PROT_READ | PROT_EXEC) != 0) {
+		munmap(stream.ibuf, *size);
+		stream.ibuf = NULL;
+	}
+	if (stream.ibuf != NULL)
+		__builtin___clear_cache(stream.ibuf, stream.ibuf + *size);
+#endif
+
+	return ((bpf_filter_func)(void *)stream.ibuf);
+}
@@ -0,0 +1,372 @@
+/*-
+ * SPDX-License-Identifier: BSD-3-Clause
+ *
+ * Copyright (C) 2002-2003 NetGroup, Politecnico di Torino (Italy)
+ * Copyright (C) 2005-2016 Jung-uk Kim <jkim@FreeBSD.org>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ * notice, this list of conditions and the following disclaimer in the
+ * documentation and/or other materials provided with the distribution.
+ * 3. Neither the name of the Politecnico di Torino nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * $FreeBSD$
+ */
+
+#ifndef _BPF_JIT_MACHDEP_H_
+#define _BPF_JIT_MACHDEP_H_
+
+/*
+ * Registers
+ */
+#define	ZERO	0
+#define	RA	1
+#define	SP	2
+#define	T0	5
+#define	T1	6
+#define	T2	7
+#define	A0	10
+#define	A1	11
+#define	A2	12
+#define	A4	14
+#define	A5	15
+
+/*
+ * Register assignment.  The filter is called as func(pkt, wirelen,
+ * buflen) and the arguments are left in place.  A and X are kept
+ * sign-extended from 32 bits, as the RV64 *W instructions produce them,
+ * so unsigned 64-bit compares give the unsigned 32-bit BPF result.
+ */
+#define	REG_P	A0		/* packet pointer */
+#define	REG_WLEN A1		/* wire length */
+#define	REG_BLEN A2		/* buffer length, zero-extended */
+#define	REG_X	A4
+#define	REG_A	A5
+
+/* Stack frame holding the scratch memory */
+#define	BPF_JIT_FRAME	(BPF_MEMWORDS * sizeof(uint32_t))
+
+/* Optimization flags */
+#define	BPF_JIT_FRET	0x01
+#define	BPF_JIT_FPKT	0x02
+#define	BPF_JIT_FMEM	0x04
+#define	BPF_JIT_FJMP	0x08
+
+#define	BPF_JIT_FLAG_ALL	\
+    (BPF_JIT_FPKT | BPF_JIT_FMEM | BPF_JIT_FJMP)
+
+/* A stream of native binary code */
+typedef struct bpf_bin_stream {
+	/* Current native instruction pointer. */
+	int		cur_ip;
+
+	/*
+	 * Current BPF instruction pointer, i.e. position in
+	 * the BPF program reached by the jitter.
+	 */
+	int		bpf_pc;
+
+	/* Instruction buffer, contains the generated native code. */
+	char		*ibuf;
+
+	/* Jumps reference table. */
+	u_int		*refs;
+} bpf_bin_stream;
+
+/*
+ * Prototype of the emit functions.
+ *
+ * Different emit functions are used to create the reference table and
+ * to generate the actual filtering code. This allows to have simpler
+ * instruction macros.
+ * The first parameter is the stream that will receive the data.
+ * The second one is a variable containing the data.
+ * The third one is the length, which is always 4 since all the
+ * instructions emitted are uncompressed.
+ */
+typedef void (*emit_func)(bpf_bin_stream *stream, u_int value, u_int n);
+
+/*
+ * Instruction formats
+ */
+#define	OPC_OP		0x33
+#define	OPC_OP_32	0x3b
+#define	OPC_OP_IMM	0x13
+#define	OPC_OP_IMM_32	0x1b
+#define	OPC_LOAD	0x03
+#define	OPC_STORE	0x23
+#define	OPC_LUI		0x37
+#define	OPC_BRANCH	0x63
+#define	OPC_JAL		0x6f
+#define	OPC_JALR	0x67
+
+#define	RTYPE(op, f3, f7, rd, rs1, rs2)					\
+	((u_int)(f7) << 25 | (u_int)(rs2) << 20 | (u_int)(rs1) << 15 |	\
+	    (u_int)(f3) << 12 | (u_int)(rd) << 7 | (op))
+
+#define	ITYPE(op, f3, rd, rs1, imm)					\
+	(((u_int)(imm) & 0xfff) << 20 | (u_int)(rs1) << 15 |		\
+	    (u_int)(f3) << 12 | (u_int)(rd) << 7 | (op))
+
+#define	STYPE(op, f3, rs1, rs2, imm)					\
+	((((u_int)(imm) >> 5) & 0x7f) << 25 | (u_int)(rs2) << 20 |	\
+	    (u_int)(rs1) << 15 | (u_int)(f3) << 12 |			\
+	    ((u_int)(imm) & 0x1f) << 7 | (op))
+
+#define	BTYPE(f3, rs1, rs2, off)					\
+	((((u_int)(off) >> 12) & 0x1) << 31 |				\
+	    (((u_int)(off) >> 5) & 0x3f) << 25 | (u_int)(rs2) << 20 |	\
+	    (u_int)(rs1) << 15 | (u_int)(f3) << 12 |			\
+	    (((u_int)(off) >> 1) & 0xf) << 8 |				\
+	    (((u_int)(off) >> 11) & 0x1) << 7 | OPC_BRANCH)
+
+#define	UTYPE(op, rd, imm20)						\
+	(((u_int)(imm20) & 0xfffff) << 12 | (u_int)(rd) << 7 | (op))
+
+#define	JTYPE(rd, off)							\
+	((((u_int)(off) >> 20) & 0x1) << 31 |				\
+	    (((u_int)(off) >> 1) & 0x3ff) << 21 |			\
+	    (((u_int)(off) >> 11) & 0x1) << 20 |			\
+	    (((u_int)(off) >> 12) & 0xff) << 12 | (u_int)(rd) << 7 | OPC_JAL)
+
+/* Branch conditions */
+#define	BEQ	0
+#define	BNE	1
+#define	BLTU	6
+#define	BGEU	7
+
+/*
+ * Native instruction macros
+ */
+
+/* add rd,rs1,rs2 */
+#define ADD(rd, rs1, rs2)						\
+	emitm(&stream, RTYPE(OPC_OP, 0, 0x00, rd, rs1, rs2), 4)
+
+/* and rd,rs1,rs2 */
+#define AND(rd, rs1, rs2)						\
+	emitm(&stream, RTYPE(OPC_OP, 7, 0x00, rd, rs1, rs2), 4)
+
+/* or rd,rs1,rs2 */
+#define OR(rd, rs1, rs2)						\
+	emitm(&stream, RTYPE(OPC_OP, 6, 0x00, rd, rs1, rs2), 4)
+
+/* xor rd,rs1,rs2 */
+#define XOR(rd, rs1, rs2)						\
+	emitm(&stream, RTYPE(OPC_OP, 4, 0x00, rd, rs1, rs2), 4)
+
+/* addw rd,rs1,rs2 */
+#define ADDW(rd, rs1, rs2)						\
+	emitm(&stream, RTYPE(OPC_OP_32, 0, 0x00, rd, rs1, rs2), 4)
+
+/* subw rd,rs1,rs2 */
+#define SUBW(rd, rs1, rs2)						\
+	emitm(&stream, RTYPE(OPC_OP_32, 0, 0x20, rd, rs1, rs2), 4)
+
+/* sllw rd,rs1,rs2 */
+#define SLLW(rd, rs1, rs2)						\
+	emitm(&stream, RTYPE(OPC_OP_32, 1, 0x00, rd, rs1, rs2), 4)
+
+/* srlw rd,rs1,rs2 */
+#define SRLW(rd, rs1, rs2)						\
+	emitm(&stream, RTYPE(OPC_OP_32, 5, 0x00, rd, rs1, rs2), 4)
+
+/* mulw rd,rs1,rs2 */
+#define MULW(rd, rs1, rs2)						\
+	emitm(&stream, RTYPE(OPC_OP_32, 0, 0x01, rd, rs1, rs2), 4)
+
+/* divuw rd,rs1,rs2 */
+#define DIVUW(rd, rs1, rs2)						\
+	emitm(&stream, RTYPE(OPC_OP_32, 5, 0x01, rd, rs1, rs2), 4)
+
+/* remuw rd,rs1,rs2 */
+#define REMUW(rd, rs1, rs2)						\
+	emitm(&stream, RTYPE(OPC_OP_32, 7, 0x01, rd, rs1, rs2), 4)
+
+/* addi rd,rs1,imm12 */
+#define ADDI(rd, rs1, imm)						\
+	emitm(&stream, ITYPE(OPC_OP_IMM, 0, rd, rs1, imm), 4)
+
+/* andi rd,rs1,imm12 */
+#define ANDI(rd, rs1, imm)						\
+	emitm(&stream, ITYPE(OPC_OP_IMM, 7, rd, rs1, imm), 4)
+
+/* ori rd,rs1,imm12 */
+#define ORI(rd, rs1, imm)						\
+	emitm(&stream, ITYPE(OPC_OP_IMM, 6, rd, rs1, imm), 4)
+
+/* xori rd,rs1,imm12 */
+#define XORI(rd, rs1, imm)						\
+	emitm(&stream, ITYPE(OPC_OP_IMM, 4, rd, rs1, imm), 4)
+
+/* slli rd,rs1,shamt6 */
+#define SLLI(rd, rs1, sh)						\
+	emitm(&stream, ITYPE(OPC_OP_IMM, 1, rd, rs1, (sh) & 0x3f), 4)
+
+/* srli rd,rs1,shamt6 */
+#define SRLI(rd, rs1, sh)						\
+	emitm(&stream, ITYPE(OPC_OP_IMM, 5, rd, rs1, (sh) & 0x3f), 4)
+
+/* addiw rd,rs1,imm12 */
+#define ADDIW(rd, rs1, imm)						\
+	emitm(&stream, ITYPE(OPC_OP_IMM_32, 0, rd, rs1, imm), 4)
+
+/* slliw rd,rs1,shamt5 */
+#define SLLIW(rd, rs1, sh)						\
+	emitm(&stream, ITYPE(OPC_OP_IMM_32, 1, rd, rs1, (sh) & 0x1f), 4)
+
+/* srliw rd,rs1,shamt5 */
+#define SRLIW(rd, rs1, sh)						\
+	emitm(&stream, ITYPE(OPC_OP_IMM_32, 5, rd, rs1, (sh) & 0x1f), 4)
+
+/* lbu rd,off12(rs1) */
+#define LBU(rd, rs1, off)						\
+	emitm(&stream, ITYPE(OPC_LOAD, 4, rd, rs1, off), 4)
+
+/* lw rd,off12(rs1) */
+#define LW(rd, rs1, off)						\
+	emitm(&stream, ITYPE(OPC_LOAD, 2, rd, rs1, off), 4)
+
+/* sw rs2,off12(rs1) */
+#define SW(rs2, rs1, off)						\
+	emitm(&stream, STYPE(OPC_STORE, 2, rs1, rs2, off), 4)
+
+/* lui rd,imm20 */
+#define LUI(rd, imm20)							\
+	emitm(&stream, UTYPE(OPC_LUI, rd, imm20), 4)
+
+/* b<cond> rs1,rs2,off13 */
+#define BRANCH(cond, rs1, rs2, off)					\
+	emitm(&stream, BTYPE(cond, rs1, rs2, off), 4)
+
+/* jal zero,off21 */
+#define JMP(off)							\
+	emitm(&stream, JTYPE(ZERO, off), 4)
+
+/* ret */
+#define RET()								\
+	emitm(&stream, ITYPE(OPC_JALR, 0, ZERO, RA, 0), 4)
+
+/* mv rd,rs */
+#define MV(rd, rs)	ADDI(rd, rs, 0)
+
+/* Does a 32-bit immediate fit in a signed 12-bit field? */
+#define	IMM12(i32)	((int32_t)(i32) >= -2048 && (int32_t)(i32) < 2048)
+
+/* li rd,i32 (sign-extended) */
+#define LI(rd, i32) do {						\
+	if (IMM12(i32))							\
+		ADDI(rd, ZERO, (i32));					\
+	else {								\
+		LUI(rd, ((u_int)(i32) + 0x800) >> 12);			\
+		if (((i32) & 0xfff) != 0)				\
+			ADDIW(rd, rd, (i32));				\
+	}								\
+} while (0)
+
+/* zero-extend rs from 32 bits into rd */
+#define ZEXT(rd, rs) do {						\
+	SLLI(rd, rs, 32);						\
+	SRLI(rd, rd, 32);						\
+} while (0)
+
+/* li rd,u32 (zero-extended) */
+#define LIU(rd, u32) do {						\
+	LI(rd, u32);							\
+	if (((u32) & 0x80000000) != 0)					\
+		ZEXT(rd, rd);						\
+} while (0)
+
+/*
+ * Return 0 from the filter unless the condition holds.  'fm' tells
+ * whether a stack frame has to be popped first.
+ */
+#define RET0_UNLESS(fm, cond, rs1, rs2) do {				\
+	BRANCH(cond, rs1, rs2, (fm) ? 16 : 12);				\
+	ADDI(A0, ZERO, 0);						\
+	if (fm)								\
+		ADDI(SP, SP, BPF_JIT_FRAME);				\
+	RET();								\
+} while (0)
+
+/*
+ * Big-endian loads from the packet.  'base' points past the end of the
+ * field, so the bytes sit at negative offsets from it.  Only byte loads
+ * are used since the packet data has no alignment guarantee.
+ */
+#define LDB(rd, base) do {						\
+	LBU(rd, base, -1);						\
+} while (0)
+
+#define LDH(rd, base) do {						\
+	LBU(rd, base, -2);						\
+	SLLI(rd, rd, 8);						\
+	LBU(T2, base, -1);						\
+	OR(rd, rd, T2);							\
+} while (0)
+
+#define LDW(rd, base) do {						\
+	LBU(rd, base, -4);						\
+	SLLIW(rd, rd, 24);						\
+	LBU(T2, base, -3);						\
+	SLLI(T2, T2, 16);						\
+	OR(rd, rd, T2);							\
+	LBU(T2, base, -2);						\
+	SLLI(T2, T2, 8);						\
+	OR(rd, rd, T2);							\
+	LBU(T2, base, -1);						\
+	OR(rd, rd, T2);							\
+} while (0)
+
+/*
+ * Conditional jumps
+ *
+ * The jump targets may be out of reach of a conditional branch, so the
+ * branch only skips over an unconditional jal.  't' is the condition
+ * that selects jt and 'f' its negation.
+ */
+#define	JCC(t, f, rs1, rs2) do {					\
+	if (ins->jt != 0 && ins->jf != 0) {				\
+		BRANCH(f, rs1, rs2, 8);					\
+		JMP(stream.refs[stream.bpf_pc + ins->jt] -		\
+		    stream.cur_ip);					\
+		JMP(stream.refs[stream.bpf_pc + ins->jf] -		\
+		    stream.cur_ip);					\
+	} else if (ins->jt != 0) {					\
+		BRANCH(f, rs1, rs2, 8);					\
+		JMP(stream.refs[stream.bpf_pc + ins->jt] -		\
+		    stream.cur_ip);					\
+	} else {							\
+		BRANCH(t, rs1, rs2, 8);					\
+		JMP(stream.refs[stream.bpf_pc + ins->jf] -		\
+		    stream.cur_ip);					\
+	}								\
+} while (0)
+
+#define	JUMP(off) do {							\
+	if ((off) != 0)							\
+		JMP(stream.refs[stream.bpf_pc + (off)] -		\
+		    stream.cur_ip);					\
+} while (0)
+
+#endif	/* _BPF_JIT_MACHDEP_H_ */
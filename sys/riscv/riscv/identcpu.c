@@ -35,15 +35,24 @@
 #include <sys/cdefs.h>
 __FBSDID("$FreeBSD$");
 
+#include "opt_platform.h"
+
 #include <sys/param.h>
 #include <sys/pcpu.h>
+#include <sys/smp.h>
 #include <sys/sysctl.h>
 #include <sys/systm.h>
 
 #include <machine/cpu.h>
 #include <machine/cpufunc.h>
+#include <machine/riscv_isa.h>
 #include <machine/trap.h>
 
+#ifdef FDT
+#include <dev/ofw/openfirm.h>
+#include <dev/ofw/ofw_cpu.h>
+#endif
+
 char machine[] = "riscv";
 
 SYSCTL_STRING(_hw, HW_MACHINE, machine, CTLFLAG_RD, machine, 0,
@@ -54,10 +63,27 @@ struct cpu_desc {
 	u_int		cpu_part_num;
 	const char	*cpu_impl_name;
 	const char	*cpu_part_name;
+	u_long		cpu_isa;
 };
 
 struct cpu_desc cpu_desc[MAXCPU];
 
+u_long riscv_isa;
+u_long elf_hwcap;
+u_long elf_hwcap2;
+
+static const struct {
+	const char	*name;
+	u_long		bit;
+} riscv_isa_exts[] = {
+	{ "zba",	RISCV_ISA_ZBA },
+	{ "zbb",	RISCV_ISA_ZBB },
+	{ "zbs",	RISCV_ISA_ZBS },
+	{ "zicbom",	RISCV_ISA_ZICBOM },
+	{ "zicboz",	RISCV_ISA_ZICBOZ },
+	{ "sstc",	RISCV_ISA_SSTC },
+};
+
 struct cpu_parts {
 	u_int		part_id;
 	const char	*part_name;
@@ -88,6 +114,128 @@ const struct cpu_implementers cpu_implementers[] = {
 	CPU_IMPLEMENTER_NONE,
 };
 
+#define	ISDIGIT(c)	((c) >= '0' && (c) <= '9')
+
+/*
+ * Parse an ISA string such as "rv64imafdc_zba_zbb".  Version numbers
+ * ("m2p0", "zba1p0") are skipped and unknown extensions are ignored.
+ */
+u_long
+riscv_isa_parse(const char *isa)
+{
+	const char *p, *q;
+	u_long caps;
+	size_t i, len;
+	int ver;
+
+	if (strncmp(isa, "rv64", 4) != 0 && strncmp(isa, "rv32", 4) != 0)
+		return (0);
+
+	caps = 0;
+	ver = 0;
+	for (p = isa + 4; *p != '\0' && *p != '_'; p++) {
+		if (*p == 's' || *p == 'x' || *p == 'z')
+			break;
+		if (ISDIGIT(*p) || (*p == 'p' && ver)) {
+			ver = ISDIGIT(*p);
+			continue;
+		}
+		ver = 0;
+		if (*p < 'a' || *p > 'z')
+			continue;
+		if (*p == 'g')
+			caps |= RISCV_ISA_I | RISCV_ISA_M | RISCV_ISA_A |
+			    RISCV_ISA_F | RISCV_ISA_D;
+		caps |= RISCV_ISA_BIT(*p);
+	}
+
+	while (*p != '\0') {
+		if (*p == '_') {
+			p++;
+			continue;
+		}
+		for (q = p; *q != '\0' && *q != '_'; q++)
+			;
+		len = q - p;
+		while (len > 0 && ISDIGIT(p[len - 1]))
+			len--;
+		if (len > 1 && p[len - 1] == 'p' && ISDIGIT(p[len - 2])) {
+			len--;
+			while (len > 0 && ISDIGIT(p[len - 1]))
+				len--;
+		}
+		for (i = 0; i < nitems(riscv_isa_exts); i++) {
+			if (strlen(riscv_isa_exts[i].name) == len &&
+			    strncmp(riscv_isa_exts[i].name, p, len) == 0) {
+				caps |= riscv_isa_exts[i].bit;
+				break;
+			}
+		}
+		p = q;
+	}
+
+	return (caps);
+}
+
+u_long
+riscv_cpu_isa(u_int cpu)
+{
+
+	KASSERT(cpu < MAXCPU, ("%s: bad cpu %u", __func__, cpu));
+	return (cpu_desc[cpu].cpu_isa);
+}
+
+#ifdef FDT
+static int riscv_isa_harts;
+
+/*
+ * Record the extensions of one hart.  The kernel and userland may run
+ * on any hart, so only the extensions common to all of them are used.
+ */
+static boolean_t
+riscv_isa_fdt(u_int id, phandle_t node, u_int addr_size, pcell_t *reg)
+{
+	char isa[256];
+	u_long caps;
+	int len;
+
+	if (id > mp_maxid || id >= MAXCPU)
+		return (false);
+
+	len = OF_getprop(node, "riscv,isa", isa, sizeof(isa) - 1);
+	if (len > 0) {
+		isa[len] = '\0';
+		caps = riscv_isa_parse(isa);
+	} else
+		caps = 0;
+
+	cpu_desc[id].cpu_isa = caps;
+	riscv_isa = riscv_isa_harts++ == 0 ? caps : riscv_isa & caps;
+	return (true);
+}
+#endif
+
+static void
+print_cpu_isa(u_int cpu)
+{
+	u_long isa;
+	size_t i;
+	int c;
+
+	isa = cpu_desc[cpu].cpu_isa;
+	if (isa == 0)
+		return;
+
+	printf("  ISA: rv64");
+	for (c = 'a'; c <= 'z'; c++)
+		if ((isa & RISCV_ISA_BIT(c)) != 0)
+			printf("%c", c);
+	for (i = 0; i < nitems(riscv_isa_exts); i++)
+		if ((isa & riscv_isa_exts[i].bit) != 0)
+			printf("_%s", riscv_isa_exts[i].name);
+	printf("\n");
+}
+
 void
 identify_cpu(void)
 {
@@ -101,12 +249,34 @@ identify_cpu(void)
 
 	cpu_partsp = NULL;
 
-	/* TODO: can we get mimpid and misa somewhere ? */
+	/*
+	 * mimpid and misa are machine-mode CSRs and the legacy SBI has no
+	 * call to read them.  The extensions come from the FDT instead.
+	 */
 	mimpid = 0;
 	misa = 0;
 
 	cpu = PCPU_GET(cpuid);
 
+	/*
+	 * The boot CPU reads the ISA of every hart, so that the common
+	 * set is known before the optimized routines are selected and
+	 * before the APs are started.
+	 */
+	if (cpu == 0) {
+#ifdef FDT
+		riscv_isa_harts = 0;
+		if (ofw_cpu_early_foreach(riscv_isa_fdt, true) <= 0)
+			riscv_isa = 0;
+#endif
+		/*
+		 * User vector state is not saved across context switches,
+		 * so V is not offered to userland.
+		 */
+		elf_hwcap = riscv_isa & RISCV_ISA_LETTERS & ~RISCV_ISA_V;
+		elf_hwcap2 = riscv_isa >> RISCV_ISA_HWCAP2_SHIFT;
+	}
+
 	impl_id	= CPU_IMPL(mimpid);
 	for (i = 0; i < nitems(cpu_implementers); i++) {
 		if (impl_id == cpu_implementers[i].impl_id ||
@@ -133,5 +303,6 @@ identify_cpu(void)
 		printf("CPU(%d): %s %s\n", cpu,
 		    cpu_desc[cpu].cpu_impl_name,
 		    cpu_desc[cpu].cpu_part_name);
+		print_cpu_isa(cpu);
 	}
 }
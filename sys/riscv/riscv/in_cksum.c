@@ -43,12 +43,15 @@
 __FBSDID("$FreeBSD$");
 
 #include <sys/param.h>
+#include <sys/kernel.h>
 #include <sys/mbuf.h>
 #include <sys/systm.h>
 #include <netinet/in_systm.h>
 #include <netinet/in.h>
 #include <netinet/ip.h>
 #include <machine/in_cksum.h>
+#include <machine/riscv_isa.h>
+#include <machine/riscvreg.h>
 
 /*
  * Checksum routine for Internet Protocol family headers
@@ -90,13 +93,146 @@ union q_util {
 	u_int64_t q;
 };
 
+/*
+ * Sum nwords 32-bit words from a 4-byte aligned buffer.  The result is
+ * congruent to the sum modulo 0xffff and fits in 33 bits.
+ */
+static u_int64_t
+in_cksum_words_scalar(const u_int32_t *lw, int nwords)
+{
+	const u_int64_t *qw;
+	u_int64_t sum, carry, w0, w1, w2, w3;
+
+	sum = carry = 0;
+	if ((4 & (long) lw) != 0 && nwords > 0) {
+		sum = *lw++;
+		nwords--;
+	}
+
+	/* Add 64-bit words, counting the carries out separately. */
+	qw = (const u_int64_t *) lw;
+	for (; nwords >= 8; nwords -= 8, qw += 4) {
+		w0 = qw[0];
+		w1 = qw[1];
+		w2 = qw[2];
+		w3 = qw[3];
+		sum += w0;
+		carry += sum < w0;
+		sum += w1;
+		carry += sum < w1;
+		sum += w2;
+		carry += sum < w2;
+		sum += w3;
+		carry += sum < w3;
+	}
+	for (; nwords >= 2; nwords -= 2, qw++) {
+		w0 = *qw;
+		sum += w0;
+		carry += sum < w0;
+	}
+	if (nwords > 0) {
+		w0 = *(const u_int32_t *) qw;
+		sum += w0;
+		carry += sum < w0;
+	}
+
+	/* 2^64 is 1 modulo 0xffff, so the carries fold back in. */
+	sum += carry;
+	if (sum < carry)
+		sum++;
+	return ((sum & 0xffffffff) + (sum >> 32));
+}
+
+/*
+ * RVV version: widening 32 to 64-bit adds into a vector of
+ * accumulators.  The kernel does not preserve user vector state, which
+ * is fine as long as user threads never run with sstatus.VS enabled.
+ */
+#define	IN_CKSUM_RVV_MIN	64	/* Words, below this use scalar */
+
+static u_int64_t
+in_cksum_words_rvv(const u_int32_t *lw, int nwords)
+{
+	u_long n, vl;
+	u_int64_t sum;
+
+	n = nwords;
+	critical_enter();
+	csr_set(sstatus, SSTATUS_VS_INITIAL);
+	__asm __volatile(
+	    ".option push\n"
+	    ".option arch, +v\n"
+	    "vsetvli	%[vl], zero, e64, m8, ta, ma\n"
+	    "vmv.v.i	v16, 0\n"
+	    "1:\n"
+	    "vsetvli	%[vl], %[n], e32, m4, tu, ma\n"
+	    "vle32.v	v8, (%[lw])\n"
+	    "vwaddu.wv	v16, v16, v8\n"
+	    "sub	%[n], %[n], %[vl]\n"
+	    "slli	%[vl], %[vl], 2\n"
+	    "add	%[lw], %[lw], %[vl]\n"
+	    "bnez	%[n], 1b\n"
+	    "vsetvli	%[vl], zero, e64, m8, ta, ma\n"
+	    "vmv.s.x	v24, zero\n"
+	    "vredsum.vs	v24, v16, v24\n"
+	    "vmv.x.s	%[sum], v24\n"
+	    ".option pop\n"
+	    : [sum] "=r" (sum), [vl] "=&r" (vl), [lw] "+r" (lw), [n] "+r" (n)
+	    :
+	    : "memory");
+	csr_clear(sstatus, SSTATUS_VS_MASK);
+	critical_exit();
+
+	/* Each lane adds fewer than 2^31 words, it cannot overflow. */
+	return ((sum & 0xffffffff) + (sum >> 32));
+}
+
+static u_int64_t (*in_cksum_words)(const u_int32_t *, int) =
+    in_cksum_words_scalar;
+
+/*
+ * Use the vector routine if every hart implements RVV and it agrees
+ * with the scalar one.
+ */
+static void
+in_cksum_select(void *dummy __unused)
+{
+	u_int32_t buf[512 + 1];
+	u_int64_t a, b;
+	u_int32_t x;
+	int i, n;
+
+	if (!riscv_isa_has(RISCV_ISA_V))
+		return;
+
+	for (i = 0, x = 1; i < nitems(buf); i++) {
+		x = x * 1103515245 + 12345;
+		buf[i] = x;
+	}
+	for (n = IN_CKSUM_RVV_MIN; n <= 512; n += 37) {
+		for (i = 0; i < 2; i++) {
+			a = in_cksum_words_scalar(buf + i, n);
+			b = in_cksum_words_rvv(buf + i, n);
+			if (a % 0xffff != b % 0xffff) {
+				printf("in_cksum: RVV checksum mismatch, "
+				    "using scalar\n");
+				return;
+			}
+		}
+	}
+
+	in_cksum_words = in_cksum_words_rvv;
+	if (bootverbose)
+		printf("in_cksum: using RVV\n");
+}
+SYSINIT(in_cksum, SI_SUB_CPU, SI_ORDER_ANY, in_cksum_select, NULL);
+
 static u_int64_t
 in_cksumdata(const void *buf, int len)
 {
 	const u_int32_t *lw = (const u_int32_t *) buf;
 	u_int64_t sum = 0;
-	u_int64_t prefilled;
-	int offset;
+	int offset, nwords;
 	union q_util q_util;
 
 	if ((3 & (long) lw) == 0 && len == 20) {
@@ -115,56 +251,13 @@ in_cksumdata(const void *buf, int len)
 			return sum;
 		}
 	}
-#if 0
-	/*
-	 * Force to cache line boundary.
-	 */
-	offset = 32 - (0x1f & (long) lw);
-	if (offset < 32 && len > offset) {
-		len -= offset;
-		if (4 & offset) {
-			sum += (u_int64_t) lw[0];
-			lw += 1;
-		}
-		if (8 & offset) {
-			sum += (u_int64_t) lw[0] + lw[1];
-			lw += 2;
-		}
-		if (16 & offset) {
-			sum += (u_int64_t) lw[0] + lw[1] + lw[2] + lw[3];
-			lw += 4;
-		}
-	}
-#endif
-	/*
-	 * access prefilling to start load of next cache line.
-	 * then add current cache line
-	 * save result of prefilling for loop iteration.
-	 */
-	prefilled = lw[0];
-	while ((len -= 32) >= 4) {
-		u_int64_t prefilling = lw[8];
-		sum += prefilled + lw[1] + lw[2] + lw[3]
-			+ lw[4] + lw[5] + lw[6] + lw[7];
-		lw += 8;
-		prefilled = prefilling;
-	}
-	if (len >= 0) {
-		sum += prefilled + lw[1] + lw[2] + lw[3]
-			+ lw[4] + lw[5] + lw[6] + lw[7];
-		lw += 8;
-	} else {
-		len += 32;
-	}
-	while ((len -= 16) >= 0) {
-		sum += (u_int64_t) lw[0] + lw[1] + lw[2] + lw[3];
-		lw += 4;
-	}
-	len += 16;
-	while ((len -= 4) >= 0) {
-		sum += (u_int64_t) *lw++;
-	}
-	len += 4;
+	nwords = len >> 2;
+	if (nwords >= IN_CKSUM_RVV_MIN)
+		sum += in_cksum_words(lw, nwords);
+	else
+		sum += in_cksum_words_scalar(lw, nwords);
+	lw += nwords;
+	len &= 3;
 	if (len > 0)
 		sum += (u_int64_t) (in_masks[len] & *lw);
 	REDUCE32;
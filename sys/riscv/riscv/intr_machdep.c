@@ -35,6 +35,8 @@
 #include <sys/cdefs.h>
 __FBSDID("$FreeBSD$");
 
+#include "opt_hwpmc_hooks.h"
+
 #include <sys/param.h>
 #include <sys/systm.h>
 #include <sys/bus.h>
@@ -42,7 +44,13 @@ __FBSDID("$FreeBSD$");
 #include <sys/module.h>
 #include <sys/cpuset.h>
 #include <sys/interrupt.h>
+#include <sys/ktr.h>
+#include <sys/rman.h>
 #include <sys/smp.h>
+#include <sys/sysctl.h>
+#ifdef HWPMC_HOOKS
+#include <sys/pmckern.h>
+#endif
 
 #include <machine/bus.h>
 #include <machine/clock.h>
@@ -175,6 +183,14 @@ riscv_cpu_intr(struct trapframe *frame)
 	case IRQ_EXTERNAL_SUPERVISOR:
 		intr_irq_handler(frame);
 		break;
+#ifdef HWPMC_HOOKS
+	case IRQ_COUNTER_OVERFLOW:
+		if (pmc_intr != NULL)
+			(*pmc_intr)(frame);
+		else
+			csr_clear(sip, SIP_LCOFIP);
+		break;
+#endif
 	default:
 		break;
 	}
@@ -198,18 +214,209 @@ riscv_unmask_ipi(void)
 	csr_set(sie, SIE_SSIE);
 }
 
+/*
+ * Harts that implement an ACLINT SSWI device can raise a supervisor
+ * software interrupt on each other with a single store, without a trip
+ * through the SBI firmware.
+ */
+static struct resource *sswi_res;
+
+#define	SSWI_SETSSIP(hart)	((hart) * 4)
+
+static int
+sswi_probe(device_t dev)
+{
+
+	if (!ofw_bus_status_okay(dev))
+		return (ENXIO);
+
+	if (!ofw_bus_is_compatible(dev, "riscv,aclint-sswi"))
+		return (ENXIO);
+
+	device_set_desc(dev, "RISC-V ACLINT SSWI");
+
+	return (BUS_PROBE_DEFAULT);
+}
+
+static int
+sswi_attach(device_t dev)
+{
+	struct resource *res;
+	int rid;
+
+	rid = 0;
+	res = bus_alloc_resource_any(dev, SYS_RES_MEMORY, &rid, RF_ACTIVE);
+	if (res == NULL) {
+		device_printf(dev, "Could not allocate memory resource\n");
+		return (ENXIO);
+	}
+	if (rman_get_size(res) < SSWI_SETSSIP(mp_maxid + 1)) {
+		device_printf(dev, "Register window too small for %d harts\n",
+		    mp_maxid + 1);
+		bus_release_resource(dev, SYS_RES_MEMORY, rid, res);
+		return (ENXIO);
+	}
+	sswi_res = res;
+
+	return (0);
+}
+
+static device_method_t sswi_methods[] = {
+	DEVMETHOD(device_probe,		sswi_probe),
+	DEVMETHOD(device_attach,	sswi_attach),
+
+	DEVMETHOD_END
+};
+
+static driver_t sswi_driver = {
+	"sswi",
+	sswi_methods,
+	0,
+};
+
+static devclass_t sswi_devclass;
+
+EARLY_DRIVER_MODULE(sswi, simplebus, sswi_driver, sswi_devclass,
+    0, 0, BUS_PASS_INTERRUPT + BUS_PASS_ORDER_MIDDLE);
+
+static SYSCTL_NODE(_machdep, OID_AUTO, ipi, CTLFLAG_RD, 0,
+    "Inter-processor interrupts");
+
+static struct ipi_stat {
+	u_int		ipi;
+	const char	*name;
+	u_long		count;
+} ipi_stats[] = {
+	{ IPI_AST,		"ast" },
+	{ IPI_PREEMPT,		"preempt" },
+	{ IPI_RENDEZVOUS,	"rendezvous" },
+	{ IPI_STOP,		"stop" },
+	{ IPI_STOP_HARD,	"stop_hard" },
+	{ IPI_HARDCLOCK,	"hardclock" },
+};
+
+static u_long ipi_coalesced;
+SYSCTL_ULONG(_machdep_ipi, OID_AUTO, coalesced, CTLFLAG_RD, &ipi_coalesced,
+    0, "IPIs folded into an interrupt already pending on the target");
+
+static void
+ipi_stats_init(void *dummy __unused)
+{
+	int i;
+
+	for (i = 0; i < nitems(ipi_stats); i++)
+		SYSCTL_ADD_ULONG(NULL, SYSCTL_STATIC_CHILDREN(_machdep_ipi),
+		    OID_AUTO, ipi_stats[i].name, CTLFLAG_RD,
+		    &ipi_stats[i].count, "IPIs sent to a hart");
+}
+SYSINIT(ipi_stats, SI_SUB_INTR, SI_ORDER_ANY, ipi_stats_init, NULL);
+
+static void
+ipi_count(u_int ipi, u_long n)
+{
+	int i;
+
+	for (i = 0; i < nitems(ipi_stats); i++) {
+		if (ipi_stats[i].ipi == ipi) {
+			atomic_add_long(&ipi_stats[i].count, n);
+			return;
+		}
+	}
+}
+
+/*
+ * Post an IPI to the target hart.  Returns true if the hart has to be
+ * interrupted, or false if an earlier IPI is still outstanding: the
+ * handler clears the software interrupt before it collects the pending
+ * set, so it is guaranteed to see this one too.
+ */
+static bool
+ipi_post(struct pcpu *pc, u_int ipi)
+{
+	uint32_t old;
+
+	old = pc->pc_pending_ipis;
+	while (!atomic_fcmpset_32(&pc->pc_pending_ipis, &old, old | ipi))
+		;
+	return (old == 0);
+}
+
+/*
+ * Convert a set of CPUs into the hart mask taken by the SBI.  CPU IDs
+ * are hart IDs on this port, see locore.S; the legacy SBI calls take a
+ * single XLEN-wide mask.
+ */
+static u_long
+ipi_hart_mask(const cpuset_t *cpus)
+{
+	u_long mask;
+	u_int cpu;
+
+	mask = 0;
+	CPU_FOREACH(cpu) {
+		if (!CPU_ISSET(cpu, cpus))
+			continue;
+		KASSERT(cpu < sizeof(mask) * NBBY,
+		    ("%s: hart %u does not fit in the SBI hart mask",
+		    __func__, cpu));
+		mask |= 1ul << cpu;
+	}
+	return (mask);
+}
+
+static void
+ipi_raise(cpuset_t *cpus)
+{
+	u_long mask;
+	u_int cpu;
+
+	if (CPU_EMPTY(cpus))
+		return;
+
+	/* Make the pending bits visible before the target is interrupted. */
+	wmb();
+
+	if (sswi_res != NULL) {
+		CPU_FOREACH(cpu) {
+			if (CPU_ISSET(cpu, cpus))
+				bus_write_4(sswi_res, SSWI_SETSSIP(cpu), 1);
+		}
+		return;
+	}
+
+	mask = ipi_hart_mask(cpus);
+	sbi_send_ipi(&mask);
+}
+
+/*
+ * Acknowledge a supervisor software interrupt on the current hart.
+ */
+void
+riscv_clear_ipi(void)
+{
+
+	if (sswi_res != NULL)
+		csr_clear(sip, SIE_SSIE);
+	else
+		sbi_clear_ipi();
+}
+
 /* Sending IPI */
 static void
 ipi_send(struct pcpu *pc, int ipi)
 {
-	uintptr_t mask;
+	cpuset_t cpus;
 
 	CTR3(KTR_SMP, "%s: cpu=%d, ipi=%x", __func__, pc->pc_cpuid, ipi);
 
-	atomic_set_32(&pc->pc_pending_ipis, ipi);
-	mask = (1 << (pc->pc_cpuid));
+	ipi_count(ipi, 1);
+	if (!ipi_post(pc, ipi)) {
+		atomic_add_long(&ipi_coalesced, 1);
+		return;
+	}
 
-	sbi_send_ipi(&mask);
+	CPU_SETOF(pc->pc_cpuid, &cpus);
+	ipi_raise(&cpus);
 
 	CTR1(KTR_SMP, "%s: sent", __func__);
 }
@@ -229,10 +436,6 @@ ipi_all_but_self(u_int ipi)
 void
 ipi_cpu(int cpu, u_int ipi)
 {
-	cpuset_t cpus;
-
-	CPU_ZERO(&cpus);
-	CPU_SET(cpu, &cpus);
 
 	CTR3(KTR_SMP, "%s: cpu: %d, ipi: %x\n", __func__, cpu, ipi);
 	ipi_send(cpuid_to_pcpu[cpu], ipi);
@@ -242,20 +445,30 @@ void
 ipi_selected(cpuset_t cpus, u_int ipi)
 {
 	struct pcpu *pc;
-	uintptr_t mask;
+	cpuset_t raise;
+	u_long n, skipped;
 
 	CTR1(KTR_SMP, "ipi_selected: ipi: %x", ipi);
 
-	mask = 0;
+	CPU_ZERO(&raise);
+	n = skipped = 0;
 	STAILQ_FOREACH(pc, &cpuhead, pc_allcpu) {
 		if (CPU_ISSET(pc->pc_cpuid, &cpus)) {
 			CTR3(KTR_SMP, "%s: pc: %p, ipi: %x\n", __func__, pc,
 			    ipi);
-			atomic_set_32(&pc->pc_pending_ipis, ipi);
-			mask |= (1 << (pc->pc_cpuid));
+			n++;
+			if (ipi_post(pc, ipi))
+				CPU_SET(pc->pc_cpuid, &raise);
+			else
+				skipped++;
 		}
 	}
-	sbi_send_ipi(&mask);
+	ipi_count(ipi, n);
+	if (skipped != 0)
+		atomic_add_long(&ipi_coalesced, skipped);
+
+	/* One call for every hart that is not already being interrupted. */
+	ipi_raise(&raise);
 }
 #endif
 
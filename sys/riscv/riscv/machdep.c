@@ -178,7 +178,9 @@ set_regs(struct thread *td, struct reg *regs)
 
 	frame = td->td_frame;
 	frame->tf_sepc = regs->sepc;
-	frame->tf_sstatus = regs->sstatus;
+	/* The FS field tracks this hart's FPE state; see fpe_switch(). */
+	frame->tf_sstatus = (regs->sstatus & ~SSTATUS_FS_MASK) |
+	    (frame->tf_sstatus & SSTATUS_FS_MASK);
 	frame->tf_ra = regs->ra;
 	frame->tf_sp = regs->sp;
 	frame->tf_gp = regs->gp;
@@ -191,6 +193,116 @@ set_regs(struct thread *td, struct reg *regs)
 	return (0);
 }
 
+#ifdef FPE
+/*
+ * The FPE registers are switched lazily.  A thread switched in on a
+ * hart that does not hold its FPE state runs with sstatus.FS set to
+ * Off, and its first floating-point instruction traps into
+ * fpe_restore_state().  The hart remembers the last thread to load
+ * its registers, so switching back to that thread costs nothing.
+ */
+static __inline bool
+fpe_owned(struct thread *td)
+{
+
+	return (PCPU_GET(fpcurthread) == td &&
+	    td->td_pcb->pcb_fpcpu == PCPU_GET(cpuid));
+}
+
+static __inline void
+fpe_set_fs(struct trapframe *frame, register_t fs)
+{
+
+	frame->tf_sstatus &= ~SSTATUS_FS_MASK;
+	frame->tf_sstatus |= fs;
+}
+
+/*
+ * Called from cpu_switch() and cpu_throw() with the old thread, if
+ * any, still the current one.
+ */
+void
+fpe_switch(struct thread *old, struct thread *new)
+{
+	struct trapframe *frame;
+
+	if (old != NULL) {
+		frame = old->td_frame;
+		if ((frame->tf_sstatus & SSTATUS_FS_MASK) == SSTATUS_FS_DIRTY) {
+			fpe_state_save(old);
+			fpe_set_fs(frame, SSTATUS_FS_CLEAN);
+		}
+	}
+
+	frame = new->td_frame;
+	if ((frame->tf_sstatus & SSTATUS_FS_MASK) != SSTATUS_FS_OFF &&
+	    !fpe_owned(new))
+		fpe_set_fs(frame, SSTATUS_FS_OFF);
+}
+
+/*
+ * Handle the first floating-point instruction since curthread was
+ * switched in or started using the FPE.
+ */
+void
+fpe_restore_state(void)
+{
+	struct thread *td;
+	struct pcb *pcb;
+
+	critical_enter();
+	td = curthread;
+	pcb = td->td_pcb;
+	if ((pcb->pcb_fpflags & PCB_FP_STARTED) == 0) {
+		fpe_state_clear();
+		memset(pcb->pcb_x, 0, sizeof(pcb->pcb_x));
+		pcb->pcb_fcsr = 0;
+		pcb->pcb_fpflags |= PCB_FP_STARTED;
+	} else if (!fpe_owned(td))
+		fpe_state_load(td);
+	pcb->pcb_fpcpu = PCPU_GET(cpuid);
+	PCPU_SET(fpcurthread, td);
+	fpe_set_fs(td->td_frame, SSTATUS_FS_CLEAN);
+	critical_exit();
+}
+
+/*
+ * Bring the pcb copy of the FPE registers up to date.  Only the
+ * running thread can have live state that is newer than its pcb.
+ */
+void
+fpe_save_state(struct thread *td)
+{
+	struct trapframe *frame;
+
+	critical_enter();
+	frame = td->td_frame;
+	if (td == curthread && fpe_owned(td) &&
+	    (frame->tf_sstatus & SSTATUS_FS_MASK) == SSTATUS_FS_DIRTY) {
+		fpe_state_save(td);
+		fpe_set_fs(frame, SSTATUS_FS_CLEAN);
+	}
+	critical_exit();
+}
+
+/*
+ * Forget any copy of the thread's FPE registers held by a hart, e.g.
+ * after its pcb copy has been replaced.  The caller must be in a
+ * critical section.
+ */
+void
+fpe_discard(struct thread *td)
+{
+
+	if (PCPU_GET(fpcurthread) == td)
+		PCPU_SET(fpcurthread, NULL);
+	if (td != NULL) {
+		td->td_pcb->pcb_fpcpu = UINT_MAX;
+		fpe_set_fs(td->td_frame, SSTATUS_FS_OFF);
+	}
+}
+#endif
+
 int
 fill_fpregs(struct thread *td, struct fpreg *regs)
 {
@@ -204,8 +316,7 @@ fill_fpregs(struct thread *td, struct fpreg *regs)
 		 * If we have just been running FPE instructions we will
 		 * need to save the state to memcpy it below.
 		 */
-		if (td == curthread)
-			fpe_state_save(td);
+		fpe_save_state(td);
 
 		memcpy(regs->fp_x, pcb->pcb_x, sizeof(regs->fp_x));
 		regs->fp_fcsr = pcb->pcb_fcsr;
@@ -220,17 +331,18 @@ int
 set_fpregs(struct thread *td, struct fpreg *regs)
 {
 #ifdef FPE
-	struct trapframe *frame;
 	struct pcb *pcb;
 
-	frame = td->td_frame;
 	pcb = td->td_pcb;
 
 	memcpy(pcb->pcb_x, regs->fp_x, sizeof(regs->fp_x));
 	pcb->pcb_fcsr = regs->fp_fcsr;
 	pcb->pcb_fpflags |= PCB_FP_STARTED;
-	frame->tf_sstatus &= ~SSTATUS_FS_MASK;
-	frame->tf_sstatus |= SSTATUS_FS_CLEAN;
+
+	/* Make the thread load the new registers on its next FPE use. */
+	critical_enter();
+	fpe_discard(td);
+	critical_exit();
 #endif
 
 	return (0);
@@ -254,7 +366,7 @@ int
 ptrace_set_pc(struct thread *td, u_long addr)
 {
 
-	panic("ptrace_set_pc");
+	td->td_frame->tf_sepc = addr;
 	return (0);
 }
 
@@ -262,8 +374,12 @@ int
 ptrace_single_step(struct thread *td)
 {
 
-	/* TODO; */
-	return (0);
+	/*
+	 * There is no hardware single step.  Debuggers step by planting
+	 * a breakpoint on the next instruction themselves; failing here
+	 * keeps PT_STEP from quietly behaving like PT_CONTINUE.
+	 */
+	return (EOPNOTSUPP);
 }
 
 int
@@ -349,7 +465,9 @@ set_mcontext(struct thread *td, mcontext_t *mcp)
 	tf->tf_sp = mcp->mc_gpregs.gp_sp;
 	tf->tf_gp = mcp->mc_gpregs.gp_gp;
 	tf->tf_sepc = mcp->mc_gpregs.gp_sepc;
-	tf->tf_sstatus = mcp->mc_gpregs.gp_sstatus;
+	/* The FS field tracks this hart's FPE state; see fpe_switch(). */
+	tf->tf_sstatus = (mcp->mc_gpregs.gp_sstatus & ~SSTATUS_FS_MASK) |
+	    (tf->tf_sstatus & SSTATUS_FS_MASK);
 
 	return (0);
 }
@@ -371,7 +489,7 @@ get_fpcontext(struct thread *td, mcontext_t *mcp)
 		 * If we have just been running FPE instructions we will
 		 * need to save the state to memcpy it below.
 		 */
-		fpe_state_save(td);
+		fpe_save_state(td);
 
 		KASSERT((curpcb->pcb_fpflags & ~PCB_FP_USERMASK) == 0,
 		    ("Non-userspace FPE flags set in get_fpcontext"));
@@ -401,6 +519,7 @@ set_fpcontext(struct thread *td, mcontext_t *mcp)
 		    sizeof(mcp->mc_fpregs));
 		curpcb->pcb_fcsr = mcp->mc_fpregs.fp_fcsr;
 		curpcb->pcb_fpflags = mcp->mc_fpregs.fp_flags & PCB_FP_USERMASK;
+		fpe_discard(td);
 	}
 
 	critical_exit();
@@ -48,14 +48,381 @@ __FBSDID("$FreeBSD$");
 #include <machine/atomic.h>
 #include <machine/elf.h>
 #include <machine/md_var.h>
+#include <machine/pte.h>
 #include <machine/minidump.h>
 
 CTASSERT(sizeof(struct kerneldumpheader) == 512);
+
+uint64_t *vm_page_dump;
+int vm_page_dump_size;
+
+static struct kerneldumpheader kdh;
+
+/* Handle chunked writes. */
+static size_t fragsz;
+static void *dump_va;
+static size_t counter, progress, dumpsize;
+
+static uint64_t tmpbuffer[PAGE_SIZE / sizeof(uint64_t)];
+
 CTASSERT(sizeof(*vm_page_dump) == 8);
 
+static int
+is_dumpable(vm_paddr_t pa)
+{
+	vm_page_t m;
+	int i;
+
+	if ((m = vm_phys_paddr_to_vm_page(pa)) != NULL)
+		return ((m->flags & PG_NODUMP) == 0);
+	for (i = 0; dump_avail[i] != 0 || dump_avail[i + 1] != 0; i += 2) {
+		if (pa >= dump_avail[i] && pa < dump_avail[i + 1])
+			return (1);
+	}
+	return (0);
+}
+
+static int
+blk_flush(struct dumperinfo *di)
+{
+	int error;
+
+	if (fragsz == 0)
+		return (0);
+
+	error = dump_append(di, dump_va, 0, fragsz);
+	fragsz = 0;
+	return (error);
+}
+
+static struct {
+	int min_per;
+	int max_per;
+	int visited;
+} progress_track[10] = {
+	{  0,  10, 0},
+	{ 10,  20, 0},
+	{ 20,  30, 0},
+	{ 30,  40, 0},
+	{ 40,  50, 0},
+	{ 50,  60, 0},
+	{ 60,  70, 0},
+	{ 70,  80, 0},
+	{ 80,  90, 0},
+	{ 90, 100, 0}
+};
+
+static void
+report_progress(size_t progress, size_t dumpsize)
+{
+	int sofar, i;
+
+	sofar = 100 - ((progress * 100) / dumpsize);
+	for (i = 0; i < nitems(progress_track); i++) {
+		if (sofar < progress_track[i].min_per ||
+		    sofar > progress_track[i].max_per)
+			continue;
+		if (progress_track[i].visited)
+			return;
+		progress_track[i].visited = 1;
+		printf("..%d%%", sofar);
+		return;
+	}
+}
+
+static int
+blk_write(struct dumperinfo *di, char *ptr, vm_paddr_t pa, size_t sz)
+{
+	size_t len;
+	int error, c;
+	u_int maxdumpsz;
+
+	maxdumpsz = min(di->maxiosize, MAXDUMPPGS * PAGE_SIZE);
+	if (maxdumpsz == 0)	/* seatbelt */
+		maxdumpsz = PAGE_SIZE;
+	error = 0;
+	if ((sz % PAGE_SIZE) != 0) {
+		printf("size not page aligned\n");
+		return (EINVAL);
+	}
+	if (ptr != NULL && pa != 0) {
+		printf("cant have both va and pa!\n");
+		return (EINVAL);
+	}
+	if ((((uintptr_t)pa) % PAGE_SIZE) != 0) {
+		printf("address not page aligned %p\n", ptr);
+		return (EINVAL);
+	}
+	if (ptr != NULL) {
+		/*
+		 * If we're doing a virtual dump, flush any
+		 * pre-existing pa pages.
+		 */
+		error = blk_flush(di);
+		if (error)
+			return (error);
+	}
+	while (sz) {
+		len = maxdumpsz - fragsz;
+		if (len > sz)
+			len = sz;
+		counter += len;
+		progress -= len;
+		if (counter >> 22) {
+			report_progress(progress, dumpsize);
+			counter &= (1 << 22) - 1;
+		}
+
+		wdog_kern_pat(WD_LASTVAL);
+
+		if (ptr) {
+			error = dump_append(di, ptr, 0, len);
+			if (error)
+				return (error);
+			ptr += len;
+			sz -= len;
+		} else {
+			dump_va = (void *)PHYS_TO_DMAP(pa);
+			fragsz += len;
+			pa += len;
+			sz -= len;
+			error = blk_flush(di);
+			if (error)
+				return (error);
+		}
+
+		/* Check for user abort. */
+		c = cncheckc();
+		if (c == 0x03)
+			return (ECANCELED);
+		if (c != -1)
+			printf(" (CTRL-C to abort) ");
+	}
+
+	return (0);
+}
+
 int
 minidumpsys(struct dumperinfo *di)
 {
+	pd_entry_t *l1, *l2;
+	pt_entry_t *l3;
+	struct minidumphdr mdhdr;
+	uint32_t pmapsize;
+	vm_offset_t va;
+	vm_paddr_t pa;
+	uint64_t bits;
+	int error;
+	int i, bit;
+	int retry_count;
+
+	retry_count = 0;
+ retry:
+	retry_count++;
+	error = 0;
+	pmapsize = 0;
+
+	/* Build set of dumpable pages from kernel pmap */
+	for (va = VM_MIN_KERNEL_ADDRESS; va < kernel_vm_end; va += L2_SIZE) {
+		pmapsize += PAGE_SIZE;
+		if (!pmap_get_tables(pmap_kernel(), va, &l1, &l2, &l3))
+			continue;
+
+		/* The kernel map is built from L2 tables only */
+		if (l2 == NULL)
+			continue;
+
+		/* l2 may be a superpage */
+		if ((*l2 & PTE_RWX) != 0) {
+			pa = PTE_TO_PHYS(*l2);
+			for (i = 0; i < Ln_ENTRIES; i++, pa += PAGE_SIZE) {
+				if (is_dumpable(pa))
+					dump_add_page(pa);
+			}
+		} else {
+			for (i = 0; i < Ln_ENTRIES; i++) {
+				if ((l3[i] & PTE_V) == 0)
+					continue;
+				pa = PTE_TO_PHYS(l3[i]);
+				if (is_dumpable(pa))
+					dump_add_page(pa);
+			}
+		}
+	}
+
+	/* Calculate dump size */
+	dumpsize = pmapsize;
+	dumpsize += round_page(msgbufp->msg_size);
+	dumpsize += round_page(vm_page_dump_size);
+	for (i = 0; i < vm_page_dump_size / sizeof(*vm_page_dump); i++) {
+		bits = vm_page_dump[i];
+		while (bits) {
+			bit = ffsl(bits) - 1;
+			pa = (((uint64_t)i * sizeof(*vm_page_dump) * NBBY) +
+			    bit) * PAGE_SIZE;
+			/* Clear out undumpable pages now if needed */
+			if (is_dumpable(pa))
+				dumpsize += PAGE_SIZE;
+			else
+				dump_drop_page(pa);
+			bits &= ~(1ul << bit);
+		}
+	}
+	dumpsize += PAGE_SIZE;
+
+	progress = dumpsize;
+
+	/* Initialize mdhdr */
+	bzero(&mdhdr, sizeof(mdhdr));
+	strcpy(mdhdr.magic, MINIDUMP_MAGIC);
+	mdhdr.version = MINIDUMP_VERSION;
+	mdhdr.msgbufsize = msgbufp->msg_size;
+	mdhdr.bitmapsize = vm_page_dump_size;
+	mdhdr.pmapsize = pmapsize;
+	mdhdr.kernbase = VM_MIN_KERNEL_ADDRESS;
+	mdhdr.dmapphys = dmap_phys_base;
+	mdhdr.dmapbase = DMAP_MIN_ADDRESS;
+	mdhdr.dmapend = dmap_max_addr;
+
+	dump_init_header(di, &kdh, KERNELDUMPMAGIC, KERNELDUMP_RISCV_VERSION,
+	    dumpsize);
+
+	error = dump_start(di, &kdh);
+	if (error != 0)
+		goto fail;
+
+	printf("Dumping %llu out of %ju MB:", (long long)dumpsize >> 20,
+	    ptoa((uintmax_t)physmem) / 1048576);
+
+	/* Dump minidump header */
+	bzero(&tmpbuffer, sizeof(tmpbuffer));
+	bcopy(&mdhdr, &tmpbuffer, sizeof(mdhdr));
+	error = blk_write(di, (char *)&tmpbuffer, 0, PAGE_SIZE);
+	if (error)
+		goto fail;
+
+	/* Dump msgbuf up front */
+	error = blk_write(di, (char *)msgbufp->msg_ptr, 0,
+	    round_page(msgbufp->msg_size));
+	if (error)
+		goto fail;
+
+	/* Dump bitmap */
+	error = blk_write(di, (char *)vm_page_dump, 0,
+	    round_page(vm_page_dump_size));
+	if (error)
+		goto fail;
+
+	/*
+	 * Dump kernel page directory pages.  Each 2MB of KVA contributes one
+	 * page of L3 entries, synthesised for superpages, so that libkvm can
+	 * translate any kernel address with a single lookup.
+	 */
+	bzero(&tmpbuffer, sizeof(tmpbuffer));
+	for (va = VM_MIN_KERNEL_ADDRESS; va < kernel_vm_end; va += L2_SIZE) {
+		if (!pmap_get_tables(pmap_kernel(), va, &l1, &l2, &l3) ||
+		    l2 == NULL) {
+			/* We always write a page, even if it is zero */
+			error = blk_write(di, (char *)&tmpbuffer, 0, PAGE_SIZE);
+			if (error)
+				goto fail;
+			/* Flush, in case we reuse tmpbuffer in the same block */
+			error = blk_flush(di);
+			if (error)
+				goto fail;
+		} else if ((*l2 & PTE_RWX) != 0) {
+			pa = PTE_TO_PHYS(*l2);
+
+			/* Generate fake l3 entries based on the l2 superpage */
+			for (i = 0; i < Ln_ENTRIES; i++) {
+				tmpbuffer[i] = (*l2 & ((1ul << PTE_PPN0_S) - 1)) |
+				    (((pa + i * PAGE_SIZE) >> PAGE_SHIFT) <<
+				    PTE_PPN0_S);
+			}
+			/* We always write a page, even if it is zero */
+			error = blk_write(di, (char *)&tmpbuffer, 0, PAGE_SIZE);
+			if (error)
+				goto fail;
+			/* Flush, in case we reuse tmpbuffer in the same block */
+			error = blk_flush(di);
+			if (error)
+				goto fail;
+			bzero(&tmpbuffer, sizeof(tmpbuffer));
+		} else {
+			pa = PTE_TO_PHYS(*l2);
+
+			/* We always write a page, even if it is zero */
+			error = blk_write(di, NULL, pa, PAGE_SIZE);
+			if (error)
+				goto fail;
+		}
+	}
+
+	/* Dump memory chunks */
+	/* XXX cluster it up and use blk_dump() */
+	for (i = 0; i < vm_page_dump_size / sizeof(*vm_page_dump); i++) {
+		bits = vm_page_dump[i];
+		while (bits) {
+			bit = ffsl(bits) - 1;
+			pa = (((uint64_t)i * sizeof(*vm_page_dump) * NBBY) +
+			    bit) * PAGE_SIZE;
+			error = blk_write(di, 0, pa, PAGE_SIZE);
+			if (error)
+				goto fail;
+			bits &= ~(1ul << bit);
+		}
+	}
+
+	error = blk_flush(di);
+	if (error)
+		goto fail;
+
+	error = dump_finish(di, &kdh);
+	if (error != 0)
+		goto fail;
+
+	printf("\nDump complete\n");
+	return (0);
+
+fail:
+	if (error < 0)
+		error = -error;
+
+	printf("\n");
+	if (error == ENOSPC) {
+		printf("Dump map grown while dumping. ");
+		if (retry_count < 5) {
+			printf("Retrying...\n");
+			goto retry;
+		}
+		printf("Dump failed.\n");
+	} else if (error == ECANCELED)
+		printf("Dump aborted\n");
+	else if (error == E2BIG)
+		printf("Dump failed. Partition too small.\n");
+	else
+		printf("** DUMP FAILED (ERROR %d) **\n", error);
+	return (error);
+}
+
+void
+dump_add_page(vm_paddr_t pa)
+{
+	int idx, bit;
+
+	pa >>= PAGE_SHIFT;
+	idx = pa >> 6;		/* 2^6 = 64 */
+	bit = pa & 63;
+	atomic_set_long(&vm_page_dump[idx], 1ul << bit);
+}
+
+void
+dump_drop_page(vm_paddr_t pa)
+{
+	int idx, bit;
 
-	panic("minidumpsys");
+	pa >>= PAGE_SHIFT;
+	idx = pa >> 6;		/* 2^6 = 64 */
+	bit = pa & 63;
+	atomic_clear_long(&vm_page_dump[idx], 1ul << bit);
 }
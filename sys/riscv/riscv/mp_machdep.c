@@ -65,6 +65,7 @@ __FBSDID("$FreeBSD$");
 
 #ifdef FDT
 #include <dev/ofw/openfirm.h>
+#include <dev/ofw/ofw_bus_subr.h>
 #include <dev/ofw/ofw_cpu.h>
 #endif
 
@@ -196,7 +197,7 @@ release_aps(void *dummy __unused)
 	mask = 0;
 
 	for (i = 1; i < mp_ncpus; i++)
-		mask |= (1 << i);
+		mask |= (1ul << i);
 
 	sbi_send_ipi(&mask);
 
@@ -231,6 +232,9 @@ init_secondary(uint64_t cpu)
 	csr_set(sie, SIE_SSIE);
 	csr_set(sip, SIE_SSIE);
 
+	/* Let user mode read time, see riscv_timer_attach(). */
+	csr_set(scounteren, SCOUNTEREN_TM);
+
 	/* Spin until the BSP releases the APs */
 	while (!aps_ready)
 		__asm __volatile("wfi");
@@ -284,7 +288,7 @@ ipi_handler(void *arg)
 	u_int cpu, ipi;
 	int bit;
 
-	sbi_clear_ipi();
+	riscv_clear_ipi();
 
 	cpu = PCPU_GET(cpuid);
 
@@ -341,9 +345,220 @@ ipi_handler(void *arg)
 	return (FILTER_HANDLED);
 }
 
+#ifdef FDT
+/*
+ * Cache nodes seen by each CPU, indexed by cache level, found by
+ * following the next-level-cache chain from its cpu node.
+ */
+static phandle_t cpu_cache_node[MAXCPU][MAX_CACHE_LEVELS + 1];
+
+static void
+cpu_map_caches(u_int cpu, phandle_t node)
+{
+	pcell_t level, xref;
+	int i;
+
+	for (i = 0; i < MAX_CACHE_LEVELS; i++) {
+		if (OF_getencprop(node, "next-level-cache", &xref,
+		    sizeof(xref)) <= 0)
+			break;
+		node = OF_node_from_xref(xref);
+		if (OF_getencprop(node, "cache-level", &level,
+		    sizeof(level)) <= 0 || level > MAX_CACHE_LEVELS)
+			break;
+		cpu_cache_node[cpu][level] = node;
+	}
+}
+
+static bool
+cpu_map_is(phandle_t node, const char *kind)
+{
+	char name[16];
+
+	if (OF_getprop(node, "name", name, sizeof(name)) <= 0)
+		return (false);
+	return (strncmp(name, kind, strlen(kind)) == 0);
+}
+
+/*
+ * Collect the CPUs below a cpu-map node.  Leaves refer to cpu nodes,
+ * whose hart ID is the CPU ID on this port.  CPUs that did not start
+ * are ignored; a CPU listed twice makes the whole map unusable.
+ */
+static int
+cpu_map_mask(phandle_t node, cpuset_t *mask, int *ngroups)
+{
+	phandle_t child, cpu_node;
+	pcell_t reg[2], xref;
+	cpuset_t cmask;
+	u_int cpu;
+	int error, len;
+
+	if (OF_getencprop(node, "cpu", &xref, sizeof(xref)) > 0) {
+		cpu_node = OF_node_from_xref(xref);
+		len = OF_getencprop(cpu_node, "reg", reg, sizeof(reg));
+		if (len <= 0)
+			return (EINVAL);
+		cpu = reg[len / sizeof(pcell_t) - 1];
+		if (cpu > mp_maxid || CPU_ABSENT(cpu))
+			return (0);
+		if (CPU_ISSET(cpu, mask))
+			return (EEXIST);
+		CPU_SET(cpu, mask);
+		cpu_map_caches(cpu, cpu_node);
+		return (0);
+	}
+
+	for (child = OF_child(node); child > 0; child = OF_peer(child)) {
+		CPU_ZERO(&cmask);
+		error = cpu_map_mask(child, &cmask, ngroups);
+		if (error != 0)
+			return (error);
+		if (CPU_EMPTY(&cmask))
+			continue;
+		if (CPU_OVERLAP(mask, &cmask))
+			return (EEXIST);
+		CPU_OR(mask, &cmask);
+		(*ngroups)++;
+	}
+	return (0);
+}
+
+/*
+ * The deepest cache level shared by every CPU in the set.
+ */
+static int
+cpu_map_level(cpuset_t *mask)
+{
+	phandle_t node;
+	u_int cpu, first;
+	int level;
+
+	first = CPU_FFS(mask) - 1;
+	for (level = CG_SHARE_L1; level <= MAX_CACHE_LEVELS; level++) {
+		node = cpu_cache_node[first][level];
+		if (node == 0)
+			continue;
+		CPU_FOREACH(cpu) {
+			if (CPU_ISSET(cpu, mask) &&
+			    cpu_cache_node[cpu][level] != node)
+				break;
+		}
+		if (cpu > mp_maxid)
+			return (level);
+	}
+	return (CG_SHARE_NONE);
+}
+
+static void
+cpu_map_fill(struct cpu_group *cg, phandle_t node)
+{
+	struct cpu_group *child_cg;
+	phandle_t child;
+	cpuset_t cmask;
+	bool leaves;
+	int children, ngroups;
+
+	CPU_ZERO(&cg->cg_mask);
+	ngroups = 0;
+	cpu_map_mask(node, &cg->cg_mask, &ngroups);
+	cg->cg_count = CPU_COUNT(&cg->cg_mask);
+	cg->cg_child = NULL;
+	cg->cg_children = 0;
+	cg->cg_flags = 0;
+	cg->cg_level = cg->cg_count > 1 ? cpu_map_level(&cg->cg_mask) :
+	    CG_SHARE_NONE;
+
+	/* Threads of a core share its L1. */
+	if (cpu_map_is(node, "core") && OF_child(node) > 0) {
+		cg->cg_level = CG_SHARE_L1;
+		cg->cg_flags = CG_FLAG_SMT;
+	}
+
+	/*
+	 * If every child is a bare CPU, the CPUs are members of this
+	 * group.  Otherwise each child becomes a group of its own so
+	 * that the children cover the whole group.
+	 */
+	children = 0;
+	leaves = true;
+	for (child = OF_child(node); child > 0; child = OF_peer(child)) {
+		CPU_ZERO(&cmask);
+		ngroups = 0;
+		cpu_map_mask(child, &cmask, &ngroups);
+		if (CPU_EMPTY(&cmask))
+			continue;
+		children++;
+		if (OF_child(child) > 0)
+			leaves = false;
+	}
+	if (leaves)
+		return;
+
+	cg->cg_child = smp_topo_alloc(children);
+	cg->cg_children = children;
+	child_cg = cg->cg_child;
+	for (child = OF_child(node); child > 0; child = OF_peer(child)) {
+		CPU_ZERO(&cmask);
+		ngroups = 0;
+		cpu_map_mask(child, &cmask, &ngroups);
+		if (CPU_EMPTY(&cmask))
+			continue;
+		child_cg->cg_parent = cg;
+		cpu_map_fill(child_cg, child);
+		child_cg++;
+	}
+}
+
+/*
+ * Build the scheduler topology from the cpu-map node, see
+ * Documentation/devicetree/bindings/cpu/cpu-topology.txt, with the
+ * cache level shared by each cluster taken from the cache nodes.
+ */
+static struct cpu_group *
+cpu_topo_fdt(void)
+{
+	struct cpu_group *top;
+	phandle_t cpus, map;
+	cpuset_t mask;
+	int ngroups;
+
+	cpus = OF_finddevice("/cpus");
+	if (cpus == -1)
+		return (NULL);
+	map = ofw_bus_find_child(cpus, "cpu-map");
+	if (map == 0)
+		return (NULL);
+
+	CPU_ZERO(&mask);
+	ngroups = 0;
+	if (cpu_map_mask(map, &mask, &ngroups) != 0 ||
+	    CPU_CMP(&mask, &all_cpus) != 0 ||
+	    ngroups + 1 > MAXCPU * MAX_CACHE_LEVELS) {
+		printf("Ignoring inconsistent cpu-map\n");
+		return (NULL);
+	}
+
+	top = smp_topo_alloc(1);
+	top->cg_parent = NULL;
+	cpu_map_fill(top, map);
+	top->cg_level = CG_SHARE_NONE;
+	return (top);
+}
+#endif
+
 struct cpu_group *
 cpu_topo(void)
 {
+#ifdef FDT
+	struct cpu_group *top;
+
+	if (cpu_enum_method == CPUS_FDT && mp_ncpus > 1) {
+		top = cpu_topo_fdt();
+		if (top != NULL)
+			return (top);
+	}
+#endif
 
 	return (smp_topo_none());
 }
@@ -39,9 +39,13 @@ __FBSDID("$FreeBSD$");
 #include <sys/bus.h>
 #include <sys/kernel.h>
 #include <sys/ktr.h>
+#include <sys/lock.h>
 #include <sys/module.h>
+#include <sys/mutex.h>
 #include <sys/proc.h>
 #include <sys/rman.h>
+#include <sys/smp.h>
+#include <sys/sysctl.h>
 
 #include <machine/bus.h>
 #include <machine/intr.h>
@@ -54,7 +58,7 @@ __FBSDID("$FreeBSD$");
 
 #define	PLIC_NIRQS		32
 #define	PLIC_PRIORITY(n)	(0x000000 + (n) * 0x4)
-#define	PLIC_ENABLE(n, h)	(0x002000 + (h) * 0x80 + (n) / 32)
+#define	PLIC_ENABLE(n, h)	(0x002000 + (h) * 0x80 + ((n) / 32) * 4)
 #define	PLIC_THRESHOLD(h)	(0x200000 + (h) * 0x1000 + 0x0)
 #define	PLIC_CLAIM(h)		(0x200000 + (h) * 0x1000 + 0x4)
 
@@ -66,14 +70,41 @@ struct plic_irqsrc {
 struct plic_softc {
 	device_t		dev;
 	struct resource *	intc_res;
+	struct mtx		mtx;
 	struct plic_irqsrc	isrcs[PLIC_NIRQS];
 };
 
+static u_int plic_irq_cpu;
+
 #define	RD4(sc, reg)				\
     bus_read_4(sc->intc_res, (reg))
 #define	WR4(sc, reg, val)			\
     bus_write_4(sc->intc_res, (reg), (val))
 
+/*
+ * Set or clear the enable bit of an interrupt source in the context of
+ * each hart in the given set, and clear it everywhere else.  The enable
+ * words are shared between sources, so the update is done under the
+ * softc lock.
+ */
+static void
+plic_set_enables(struct plic_softc *sc, u_int irq, cpuset_t *cpus)
+{
+	uint32_t reg;
+	u_int cpu;
+
+	mtx_lock_spin(&sc->mtx);
+	CPU_FOREACH(cpu) {
+		reg = RD4(sc, PLIC_ENABLE(irq, cpu));
+		if (cpus != NULL && CPU_ISSET(cpu, cpus))
+			reg |= (1 << (irq % 32));
+		else
+			reg &= ~(1 << (irq % 32));
+		WR4(sc, PLIC_ENABLE(irq, cpu), reg);
+	}
+	mtx_unlock_spin(&sc->mtx);
+}
+
 static inline void
 plic_irq_dispatch(struct plic_softc *sc, u_int irq,
     struct trapframe *tf)
@@ -82,8 +113,16 @@ plic_irq_dispatch(struct plic_softc *sc, u_int irq,
 
 	src = &sc->isrcs[irq];
 
-	if (intr_isrc_dispatch(&src->isrc, tf) != 0)
+	if (intr_isrc_dispatch(&src->isrc, tf) != 0) {
+		/*
+		 * Nobody handled it, so neither post_filter nor
+		 * pre_ithread completed the claim.  Mask the source and
+		 * complete it here so it is not presented again.
+		 */
+		plic_set_enables(sc, irq, NULL);
+		WR4(sc, PLIC_CLAIM(PCPU_GET(cpuid)), irq);
 		device_printf(sc->dev, "Stray irq %u detected\n", irq);
+	}
 }
 
 static int
@@ -96,12 +135,20 @@ plic_intr(void *arg)
 
 	sc = arg;
 	cpu = PCPU_GET(cpuid);
-
-	pending = RD4(sc, PLIC_CLAIM(cpu));
-	if (pending) {
-		tf = curthread->td_intr_frame;
+	tf = curthread->td_intr_frame;
+
+	/*
+	 * Keep claiming until the PLIC has nothing left for this hart,
+	 * rather than taking a new trap for each interrupt.  The claim is
+	 * completed by post_filter or pre_ithread once the source has been
+	 * dispatched.
+	 */
+	while ((pending = RD4(sc, PLIC_CLAIM(cpu))) != 0) {
+		if (pending >= PLIC_NIRQS) {
+			WR4(sc, PLIC_CLAIM(cpu), pending);
+			continue;
+		}
 		plic_irq_dispatch(sc, pending, tf);
-		WR4(sc, PLIC_CLAIM(cpu), pending);
 	}
 
 	return (FILTER_HANDLED);
@@ -112,17 +159,11 @@ plic_disable_intr(device_t dev, struct intr_irqsrc *isrc)
 {
 	struct plic_softc *sc;
 	struct plic_irqsrc *src;
-	uint32_t reg;
-	uint32_t cpu;
 
 	sc = device_get_softc(dev);
 	src = (struct plic_irqsrc *)isrc;
 
-	cpu = PCPU_GET(cpuid);
-
-	reg = RD4(sc, PLIC_ENABLE(src->irq, cpu));
-	reg &= ~(1 << (src->irq % 32));
-	WR4(sc, PLIC_ENABLE(src->irq, cpu), reg);
+	plic_set_enables(sc, src->irq, NULL);
 }
 
 static void
@@ -130,19 +171,85 @@ plic_enable_intr(device_t dev, struct intr_irqsrc *isrc)
 {
 	struct plic_softc *sc;
 	struct plic_irqsrc *src;
-	uint32_t reg;
-	uint32_t cpu;
 
 	sc = device_get_softc(dev);
 	src = (struct plic_irqsrc *)isrc;
 
 	WR4(sc, PLIC_PRIORITY(src->irq), 1);
 
-	cpu = PCPU_GET(cpuid);
+	/* Sources not bound yet are taken by the hart enabling them. */
+	if (CPU_EMPTY(&isrc->isrc_cpu))
+		CPU_SETOF(PCPU_GET(cpuid), &isrc->isrc_cpu);
 
-	reg = RD4(sc, PLIC_ENABLE(src->irq, cpu));
-	reg |= (1 << (src->irq % 32));
-	WR4(sc, PLIC_ENABLE(src->irq, cpu), reg);
+	plic_set_enables(sc, src->irq, &isrc->isrc_cpu);
+}
+
+static void
+plic_post_filter(device_t dev, struct intr_irqsrc *isrc)
+{
+	struct plic_softc *sc;
+	struct plic_irqsrc *src;
+
+	sc = device_get_softc(dev);
+	src = (struct plic_irqsrc *)isrc;
+
+	WR4(sc, PLIC_CLAIM(PCPU_GET(cpuid)), src->irq);
+}
+
+static void
+plic_pre_ithread(device_t dev, struct intr_irqsrc *isrc)
+{
+
+	plic_disable_intr(dev, isrc);
+	plic_post_filter(dev, isrc);
+}
+
+static void
+plic_post_ithread(device_t dev, struct intr_irqsrc *isrc)
+{
+
+	plic_enable_intr(dev, isrc);
+}
+
+static int
+plic_bind_intr(device_t dev, struct intr_irqsrc *isrc)
+{
+	struct plic_softc *sc;
+	struct plic_irqsrc *src;
+
+	sc = device_get_softc(dev);
+	src = (struct plic_irqsrc *)isrc;
+
+	if (CPU_EMPTY(&isrc->isrc_cpu)) {
+		plic_irq_cpu = intr_irq_next_cpu(plic_irq_cpu, &all_cpus);
+		CPU_SETOF(plic_irq_cpu, &isrc->isrc_cpu);
+	}
+
+	plic_set_enables(sc, src->irq, &isrc->isrc_cpu);
+
+	return (0);
+}
+
+static int
+plic_threshold_sysctl(SYSCTL_HANDLER_ARGS)
+{
+	struct plic_softc *sc;
+	uint32_t cpu;
+	int error, val;
+
+	sc = arg1;
+	cpu = arg2;
+
+	val = RD4(sc, PLIC_THRESHOLD(cpu));
+	error = sysctl_handle_int(oidp, &val, 0, req);
+	if (error != 0 || req->newptr == NULL)
+		return (error);
+	if (val < 0)
+		return (EINVAL);
+
+	WR4(sc, PLIC_THRESHOLD(cpu), val);
+
+	return (0);
 }
 
 static int
@@ -187,9 +294,12 @@ plic_attach(device_t dev)
 	struct plic_irqsrc *isrcs;
 	struct plic_softc *sc;
 	struct intr_pic *pic;
+	struct sysctl_ctx_list *ctx;
+	struct sysctl_oid *oid;
 	uint32_t irq;
 	const char *name;
 	phandle_t xref;
+	char buf[8];
 	uint32_t cpu;
 	int error;
 	int rid;
@@ -208,9 +318,10 @@ plic_attach(device_t dev)
 		return (ENXIO);
 	}
 
+	mtx_init(&sc->mtx, "plic", NULL, MTX_SPIN);
+
 	isrcs = sc->isrcs;
 	name = device_get_nameunit(sc->dev);
-	cpu = PCPU_GET(cpuid);
 	for (irq = 0; irq < PLIC_NIRQS; irq++) {
 		isrcs[irq].irq = irq;
 		error = intr_isrc_register(&isrcs[irq].isrc, sc->dev,
@@ -219,9 +330,24 @@ plic_attach(device_t dev)
 			return (error);
 
 		WR4(sc, PLIC_PRIORITY(irq), 0);
-		WR4(sc, PLIC_ENABLE(irq, cpu), 0);
 	}
-	WR4(sc, PLIC_THRESHOLD(cpu), 0);
+
+	/* Mask everything and accept any priority on every hart. */
+	ctx = device_get_sysctl_ctx(dev);
+	oid = SYSCTL_ADD_NODE(ctx,
+	    SYSCTL_CHILDREN(device_get_sysctl_tree(dev)), OID_AUTO,
+	    "threshold", CTLFLAG_RD, NULL, "Per-hart priority thresholds");
+	CPU_FOREACH(cpu) {
+		for (irq = 0; irq < PLIC_NIRQS; irq += 32)
+			WR4(sc, PLIC_ENABLE(irq, cpu), 0);
+		WR4(sc, PLIC_THRESHOLD(cpu), 0);
+
+		snprintf(buf, sizeof(buf), "%u", cpu);
+		SYSCTL_ADD_PROC(ctx, SYSCTL_CHILDREN(oid), OID_AUTO, buf,
+		    CTLTYPE_INT | CTLFLAG_RW | CTLFLAG_MPSAFE, sc, cpu,
+		    plic_threshold_sysctl, "I",
+		    "Priority threshold of the hart's context");
+	}
 
 	xref = OF_xref_from_node(ofw_bus_get_node(sc->dev));
 	pic = intr_pic_register(sc->dev, xref);
@@ -240,6 +366,10 @@ static device_method_t plic_methods[] = {
 	DEVMETHOD(pic_disable_intr,	plic_disable_intr),
 	DEVMETHOD(pic_enable_intr,	plic_enable_intr),
 	DEVMETHOD(pic_map_intr,		plic_map_intr),
+	DEVMETHOD(pic_pre_ithread,	plic_pre_ithread),
+	DEVMETHOD(pic_post_ithread,	plic_post_ithread),
+	DEVMETHOD(pic_post_filter,	plic_post_filter),
+	DEVMETHOD(pic_bind_intr,	plic_bind_intr),
 
 	DEVMETHOD_END
 };
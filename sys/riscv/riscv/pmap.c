@@ -118,6 +118,7 @@ __FBSDID("$FreeBSD$");
  */
 
 #include <sys/param.h>
+#include <sys/bitstring.h>
 #include <sys/bus.h>
 #include <sys/systm.h>
 #include <sys/kernel.h>
@@ -145,6 +146,7 @@ __FBSDID("$FreeBSD$");
 #include <vm/vm_extern.h>
 #include <vm/vm_pageout.h>
 #include <vm/vm_pager.h>
+#include <vm/vm_phys.h>
 #include <vm/vm_radix.h>
 #include <vm/vm_reserv.h>
 #include <vm/uma.h>
@@ -152,6 +154,7 @@ __FBSDID("$FreeBSD$");
 #include <machine/machdep.h>
 #include <machine/md_var.h>
 #include <machine/pcb.h>
+#include <machine/sbi.h>
 
 #define	NPDEPG		(PAGE_SIZE/(sizeof (pd_entry_t)))
 #define	NUPDE			(NPDEPG * NPDEPG)
@@ -174,6 +177,7 @@ __FBSDID("$FreeBSD$");
 #endif
 
 #define	pmap_l2_pindex(v)	((v) >> L2_SHIFT)
+#define	pa_to_pvh(pa)		(&pv_table[pmap_l2_pindex(pa)])
 
 #define	NPV_LIST_LOCKS	MAXCPU
 
@@ -236,16 +240,116 @@ static struct rwlock_padalign pvh_global_lock;
 static TAILQ_HEAD(pch, pv_chunk) pv_chunks = TAILQ_HEAD_INITIALIZER(pv_chunks);
 static struct mtx pv_chunks_mutex;
 static struct rwlock pv_list_locks[NPV_LIST_LOCKS];
+static struct md_page *pv_table;
+static struct md_page pv_dummy;
+
+/*
+ * Per-CPU pages of KVA used by pmap_quick_enter_page() for physical
+ * memory beyond the reach of the direct map.
+ */
+static vm_offset_t qmap_base;
+
+static SYSCTL_NODE(_vm, OID_AUTO, pmap, CTLFLAG_RD, 0, "VM/pmap parameters");
+
+static int superpages_enabled = 1;
+SYSCTL_INT(_vm_pmap, OID_AUTO, superpages_enabled,
+    CTLFLAG_RDTUN | CTLFLAG_NOFETCH, &superpages_enabled, 0,
+    "Are large page mappings enabled?");
+
+static int pmap_has_svpbmt = 0;
+SYSCTL_INT(_vm_pmap, OID_AUTO, svpbmt, CTLFLAG_RDTUN | CTLFLAG_NOFETCH,
+    &pmap_has_svpbmt, 0,
+    "Do the harts implement Svpbmt page-based memory types?");
+
+static SYSCTL_NODE(_vm_pmap, OID_AUTO, l2, CTLFLAG_RD, 0,
+    "2MB page mapping counters");
+
+static u_long pmap_l2_demotions;
+SYSCTL_ULONG(_vm_pmap_l2, OID_AUTO, demotions, CTLFLAG_RD,
+    &pmap_l2_demotions, 0, "2MB page demotions");
+
+static u_long pmap_l2_p_failures;
+SYSCTL_ULONG(_vm_pmap_l2, OID_AUTO, p_failures, CTLFLAG_RD,
+    &pmap_l2_p_failures, 0, "2MB page promotion failures");
+
+static u_long pmap_l2_mappings;
+SYSCTL_ULONG(_vm_pmap_l2, OID_AUTO, mappings, CTLFLAG_RD,
+    &pmap_l2_mappings, 0, "2MB page mappings");
+
+static u_long pmap_l2_promotions;
+SYSCTL_ULONG(_vm_pmap_l2, OID_AUTO, promotions, CTLFLAG_RD,
+    &pmap_l2_promotions, 0, "2MB page promotions");
+
+/*
+ * ASID management.
+ *
+ * Each user pmap is tagged with an address space identifier so that its
+ * TLB entries survive a context switch.  pm_asid holds the ASID in its
+ * low asid_bits bits and the generation in which it was allocated above
+ * them.  ASIDs are never returned to the allocator; a pmap whose
+ * generation is stale is given a new ASID the next time it is activated.
+ * When the ASID space is exhausted the generation is advanced, the
+ * allocation bitmap is reset to the ASIDs that are live on some hart,
+ * and every hart performs a single full TLB flush before it next
+ * activates a pmap with a new ASID.
+ *
+ * ASID 0 is reserved for vmspace0, which has no user mappings, and is
+ * used for every pmap on harts that do not implement ASIDs.
+ */
+static struct mtx asid_mtx;
+static u_int asid_bits;
+static u_long asid_gen;
+static int asid_next;
+static bitstr_t *asid_map;
+static cpuset_t asid_flush_pending;
+static u_long asid_rollovers;
+DPCPU_DEFINE_STATIC(u_long, asid_active);
+DPCPU_DEFINE_STATIC(u_long, asid_reserved);
+
+/* The pmap most recently activated on each hart. */
+DPCPU_DEFINE_STATIC(pmap_t, curpmap);
+
+/*
+ * Instruction cache synchronization generations.  Each call to
+ * pmap_sync_icache() takes a new generation and records it in the pmap.
+ * Each hart records the generation current at its last full fence.i, and
+ * executes another when it switches to a pmap synchronized since then.
+ */
+static u_long icache_gen;
+DPCPU_DEFINE_STATIC(u_long, icache_synced);
+
+#define	ASID_FIRST_GEN		(1ul << asid_bits)
+#define	ASID_NUM(ctx)		((ctx) & (ASID_FIRST_GEN - 1))
+#define	ASID_GEN_MATCH(ctx)	\
+	((((ctx) ^ atomic_load_acq_long(&asid_gen)) >> asid_bits) == 0)
+
+SYSCTL_UINT(_vm_pmap, OID_AUTO, asid_bits, CTLFLAG_RD, &asid_bits, 0,
+    "Number of implemented ASID bits");
+SYSCTL_ULONG(_vm_pmap, OID_AUTO, asid_rollovers, CTLFLAG_RD,
+    &asid_rollovers, 0,
+    "Number of times the ASID space has been exhausted");
 
 static void	free_pv_chunk(struct pv_chunk *pc);
 static void	free_pv_entry(pmap_t pmap, pv_entry_t pv);
 static pv_entry_t get_pv_entry(pmap_t pmap, struct rwlock **lockp);
 static vm_page_t reclaim_pv_chunk(pmap_t locked_pmap, struct rwlock **lockp);
+static void	reserve_pv_entries(pmap_t pmap, int needed,
+		    struct rwlock **lockp);
+static void	pmap_pv_demote_l2(pmap_t pmap, vm_offset_t va, vm_paddr_t pa,
+		    struct rwlock **lockp);
 static void	pmap_pvh_free(struct md_page *pvh, pmap_t pmap, vm_offset_t va);
 static pv_entry_t pmap_pvh_remove(struct md_page *pvh, pmap_t pmap,
 		    vm_offset_t va);
+static boolean_t pmap_demote_l1(pmap_t pmap, pd_entry_t *l1, vm_offset_t va);
+static pt_entry_t *pmap_demote_l2(pmap_t pmap, pd_entry_t *l2, vm_offset_t va);
+static pt_entry_t *pmap_demote_l2_locked(pmap_t pmap, pd_entry_t *l2,
+		    vm_offset_t va, struct rwlock **lockp);
+static int pmap_enter_l2(pmap_t pmap, vm_offset_t va, pd_entry_t new_l2,
+    u_int flags, vm_page_t m, struct rwlock **lockp);
 static vm_page_t pmap_enter_quick_locked(pmap_t pmap, vm_offset_t va,
     vm_page_t m, vm_prot_t prot, vm_page_t mpte, struct rwlock **lockp);
+static int pmap_remove_l2(pmap_t pmap, pd_entry_t *l2, vm_offset_t sva,
+    pd_entry_t l1e, struct spglist *free, struct rwlock **lockp);
 static int pmap_remove_l3(pmap_t pmap, pt_entry_t *l3, vm_offset_t sva,
     pd_entry_t ptepde, struct spglist *free, struct rwlock **lockp);
 static boolean_t pmap_try_insert_pv_entry(pmap_t pmap, vm_offset_t va,
@@ -257,6 +361,12 @@ static vm_page_t _pmap_alloc_l3(pmap_t pmap, vm_pindex_t ptepindex,
 static void _pmap_unwire_l3(pmap_t pmap, vm_offset_t va, vm_page_t m,
     struct spglist *free);
 static int pmap_unuse_l3(pmap_t, vm_offset_t, pd_entry_t, struct spglist *);
+static void pmap_asid_init(void);
+static int pmap_change_attr_locked(vm_offset_t va, vm_size_t size, int mode);
+
+/* Unrolled page copy and zero routines, in support.S. */
+void pagecopy(void *s, void *d);
+void pagezero(void *p);
 
 /*
  * These load the old table data and store the new value.
@@ -265,6 +375,7 @@ static int pmap_unuse_l3(pmap_t, vm_offset_t, pd_entry_t, struct spglist *);
  */
 #define	pmap_load_store(table, entry) atomic_swap_64(table, entry)
 #define	pmap_set(table, mask) atomic_set_64(table, mask)
+#define	pmap_clear_bits(table, mask) atomic_clear_64(table, mask)
 #define	pmap_load_clear(table) atomic_swap_64(table, 0)
 #define	pmap_load(table) (*table)
 
@@ -272,25 +383,29 @@ static int pmap_unuse_l3(pmap_t, vm_offset_t, pd_entry_t, struct spglist *);
 /* Inline functions */
 /********************/
 
-static __inline void
-pagecopy(void *s, void *d)
-{
-
-	memcpy(d, s, PAGE_SIZE);
-}
-
-static __inline void
-pagezero(void *p)
-{
-
-	bzero(p, PAGE_SIZE);
-}
-
 #define	pmap_l1_index(va)	(((va) >> L1_SHIFT) & Ln_ADDR_MASK)
 #define	pmap_l2_index(va)	(((va) >> L2_SHIFT) & Ln_ADDR_MASK)
 #define	pmap_l3_index(va)	(((va) >> L3_SHIFT) & Ln_ADDR_MASK)
 
-#define	PTE_TO_PHYS(pte)	((pte >> PTE_PPN0_S) * PAGE_SIZE)
+/*
+ * Svpbmt page-based memory types, in bits 62:61 of a leaf PTE.  NC is
+ * non-cacheable, idempotent, weakly-ordered memory, suitable both for
+ * uncached and for write-combining mappings.  IO is non-cacheable,
+ * non-idempotent, strongly-ordered device memory.  These bits, like the
+ * rest of bits 63:54, are reserved on harts without the extension.
+ */
+#define	PTE_MA_SHIFT	61
+#define	PTE_MA_MASK	(0x3ul << PTE_MA_SHIFT)
+#define	PTE_MA_NONE	(0ul)
+#define	PTE_MA_NC	(1ul << PTE_MA_SHIFT)
+#define	PTE_MA_IO	(2ul << PTE_MA_SHIFT)
+
+/*
+ * The PTE bits that must be identical in each of the 4KB page mappings
+ * within a page table page for them to be promoted to a 2MB page mapping.
+ */
+#define	PTE_PROMOTE	(PTE_V | PTE_RWX | PTE_D | PTE_A | PTE_U | \
+			    PTE_SW_MANAGED | PTE_SW_WIRED | PTE_MA_MASK)
 
 static __inline pd_entry_t *
 pmap_l1(pmap_t pmap, vm_offset_t va)
@@ -355,6 +470,44 @@ pmap_l3(pmap_t pmap, vm_offset_t va)
 	return (pmap_l2_to_l3(l2, va));
 }
 
+/*
+ * Return the page table entries mapping va at each level.  A 1GB or 2MB
+ * leaf ends the walk, leaving the lower level pointers NULL.
+ */
+bool
+pmap_get_tables(pmap_t pmap, vm_offset_t va, pd_entry_t **l1, pd_entry_t **l2,
+    pt_entry_t **l3)
+{
+	pd_entry_t *l1p, *l2p;
+
+	l1p = pmap_l1(pmap, va);
+	*l1 = l1p;
+
+	if ((pmap_load(l1p) & PTE_V) == 0)
+		return (false);
+
+	if ((pmap_load(l1p) & PTE_RX) != 0) {
+		*l2 = NULL;
+		*l3 = NULL;
+		return (true);
+	}
+
+	l2p = pmap_l1_to_l2(l1p, va);
+	*l2 = l2p;
+
+	if ((pmap_load(l2p) & PTE_V) == 0)
+		return (false);
+
+	if ((pmap_load(l2p) & PTE_RX) != 0) {
+		*l3 = NULL;
+		return (true);
+	}
+
+	*l3 = pmap_l2_to_l3(l2p, va);
+
+	return (true);
+}
+
 
 static __inline int
 pmap_is_write(pt_entry_t entry)
@@ -404,6 +557,33 @@ pmap_page_dirty(pt_entry_t pte)
 	return (pte & PTE_D);
 }
 
+/* Returns the PTE memory type bits for the given memory attribute. */
+static __inline pt_entry_t
+pmap_memattr_bits(vm_memattr_t ma)
+{
+
+	if (!pmap_has_svpbmt)
+		return (PTE_MA_NONE);
+	switch (ma) {
+	case VM_MEMATTR_DEVICE:
+		return (PTE_MA_IO);
+	case VM_MEMATTR_UNCACHEABLE:
+#ifdef VM_MEMATTR_WRITE_COMBINING
+	case VM_MEMATTR_WRITE_COMBINING:
+#endif
+		return (PTE_MA_NC);
+	default:
+		return (PTE_MA_NONE);
+	}
+}
+
+bool
+pmap_ps_enabled(pmap_t pmap __unused)
+{
+
+	return (superpages_enabled != 0);
+}
+
 static __inline void
 pmap_resident_count_inc(pmap_t pmap, int count)
 {
@@ -755,7 +935,24 @@ pmap_page_init(vm_page_t m)
 void
 pmap_init(void)
 {
-	int i;
+	vm_size_t s;
+	int error, i, pv_npg;
+
+	/*
+	 * Are large page mappings enabled?
+	 */
+	TUNABLE_INT_FETCH("vm.pmap.superpages_enabled", &superpages_enabled);
+
+	/*
+	 * Nothing reports the extensions a hart implements, so the memory
+	 * type bits are only used when the administrator says so.
+	 */
+	TUNABLE_INT_FETCH("vm.pmap.svpbmt", &pmap_has_svpbmt);
+	if (superpages_enabled) {
+		KASSERT(MAXPAGESIZES > 1 && pagesizes[1] == 0,
+		    ("pmap_init: can't assign to pagesizes[1]"));
+		pagesizes[1] = L2_SIZE;
+	}
 
 	/*
 	 * Initialize the pv chunk list mutex.
@@ -767,42 +964,316 @@ pmap_init(void)
 	 */
 	for (i = 0; i < NPV_LIST_LOCKS; i++)
 		rw_init(&pv_list_locks[i], "pmap pv list");
+
+	/*
+	 * Calculate the size of the pv head table for superpages.
+	 */
+	pv_npg = howmany(vm_phys_segs[vm_phys_nsegs - 1].end, L2_SIZE);
+
+	/*
+	 * Allocate memory for the pv head table for superpages.
+	 */
+	s = (vm_size_t)(pv_npg * sizeof(struct md_page));
+	s = round_page(s);
+	pv_table = (struct md_page *)kmem_malloc(s, M_WAITOK | M_ZERO);
+	for (i = 0; i < pv_npg; i++)
+		TAILQ_INIT(&pv_table[i].pv_list);
+	TAILQ_INIT(&pv_dummy.pv_list);
+
+	error = vmem_alloc(kernel_arena, PAGE_SIZE * (mp_maxid + 1),
+	    M_BESTFIT | M_WAITOK, (vmem_addr_t *)&qmap_base);
+	if (error != 0)
+		panic("qmap allocation failed");
+
+	pmap_asid_init();
+}
+
+/*
+ * Probe the number of implemented ASID bits by writing all ones to the
+ * ASID field of satp and reading back the bits that stick, then set up
+ * the ASID allocator.
+ */
+static void
+pmap_asid_init(void)
+{
+	uint64_t satp, mask;
+	u_int bits;
+
+	mtx_init(&asid_mtx, "pmap asid", NULL, MTX_SPIN);
+
+	satp = csr_read(sptbr);
+	csr_write(sptbr, satp | SATP_ASID_M);
+	mask = (csr_read(sptbr) & SATP_ASID_M) >> SATP_ASID_S;
+	csr_write(sptbr, satp);
+	__asm __volatile("sfence.vma" ::: "memory");
+
+	bits = flsl(mask);
+	if (bits == 0)
+		return;
+
+	asid_map = bit_alloc(1 << bits, M_VMPMAP, M_WAITOK);
+	bit_set(asid_map, 0);
+	asid_next = 1;
+	asid_gen = 1ul << bits;
+	atomic_store_rel_int(&asid_bits, bits);
+}
+
+/*
+ * Start a new ASID generation.  The ASIDs that are live on each hart
+ * are carried over into the new generation so that running threads do
+ * not need to be interrupted; every other ASID becomes free.  Harts
+ * flush their TLB the next time they activate a pmap.
+ */
+static void
+pmap_asid_rollover(void)
+{
+	u_long ctx;
+	int cpu;
+
+	mtx_assert(&asid_mtx, MA_OWNED);
+
+	bit_nclear(asid_map, 0, (1 << asid_bits) - 1);
+	bit_set(asid_map, 0);
+	CPU_FOREACH(cpu) {
+		ctx = atomic_readandclear_long(DPCPU_ID_PTR(cpu, asid_active));
+		/*
+		 * If the hart has already been through a rollover without
+		 * switching, keep the ASID that was reserved for it then.
+		 */
+		if (ctx == 0)
+			ctx = DPCPU_ID_GET(cpu, asid_reserved);
+		bit_set(asid_map, ASID_NUM(ctx));
+		DPCPU_ID_SET(cpu, asid_reserved, ctx);
+	}
+	asid_flush_pending = all_cpus;
+	atomic_add_rel_long(&asid_gen, ASID_FIRST_GEN);
+	asid_rollovers++;
+}
+
+/*
+ * If the given context was live on some hart at the last rollover, move
+ * each such reservation into the current generation and return true.
+ */
+static bool
+pmap_asid_update_reserved(u_long ctx, u_long newctx)
+{
+	bool hit;
+	int cpu;
+
+	hit = false;
+	CPU_FOREACH(cpu) {
+		if (DPCPU_ID_GET(cpu, asid_reserved) == ctx) {
+			DPCPU_ID_SET(cpu, asid_reserved, newctx);
+			hit = true;
+		}
+	}
+	return (hit);
+}
+
+/*
+ * Allocate an ASID in the current generation for the given pmap,
+ * preferring the ASID it held in an earlier generation.
+ */
+static u_long
+pmap_asid_alloc(pmap_t pmap)
+{
+	u_long ctx, gen;
+	int asid;
+
+	mtx_assert(&asid_mtx, MA_OWNED);
+
+	ctx = pmap->pm_asid;
+	gen = asid_gen;
+	if (ctx != 0) {
+		asid = ASID_NUM(ctx);
+		if (pmap_asid_update_reserved(ctx, gen | asid))
+			return (gen | asid);
+		if (!bit_test(asid_map, asid)) {
+			bit_set(asid_map, asid);
+			return (gen | asid);
+		}
+	}
+
+	bit_ffc_at(asid_map, asid_next, 1 << asid_bits, &asid);
+	if (asid == -1) {
+		pmap_asid_rollover();
+		gen = asid_gen;
+		bit_ffc_at(asid_map, 1, 1 << asid_bits, &asid);
+		KASSERT(asid != -1, ("pmap_asid_alloc: no ASID after rollover"));
+	}
+	bit_set(asid_map, asid);
+	asid_next = asid + 1;
+	return (gen | asid);
+}
+
+/*
+ * Make the pmap's ASID current on this hart, allocating a new one if its
+ * generation is stale, and return the ASID to load into satp.
+ */
+static u_long
+pmap_asid_activate(pmap_t pmap)
+{
+	u_long ctx, old;
+	u_int cpuid;
+
+	if (asid_bits == 0 || pmap == vmspace_pmap(&vmspace0))
+		return (0);
+
+	/*
+	 * Fast path: the ASID belongs to the current generation and no
+	 * rollover has cleared this hart's active ASID since we last
+	 * switched.  A concurrent rollover either sees the new value or
+	 * makes the compare-and-set fail.
+	 */
+	ctx = pmap->pm_asid;
+	old = DPCPU_GET(asid_active);
+	if (old != 0 && ASID_GEN_MATCH(ctx) &&
+	    atomic_cmpset_long(DPCPU_PTR(asid_active), old, ctx))
+		return (ASID_NUM(ctx));
+
+	mtx_lock_spin(&asid_mtx);
+	ctx = pmap->pm_asid;
+	if (!ASID_GEN_MATCH(ctx)) {
+		ctx = pmap_asid_alloc(pmap);
+		pmap->pm_asid = ctx;
+	}
+	cpuid = PCPU_GET(cpuid);
+	if (CPU_ISSET(cpuid, &asid_flush_pending)) {
+		CPU_CLR(cpuid, &asid_flush_pending);
+		__asm __volatile("sfence.vma" ::: "memory");
+	}
+	atomic_store_rel_long(DPCPU_PTR(asid_active), ctx);
+	mtx_unlock_spin(&asid_mtx);
+
+	return (ASID_NUM(ctx));
 }
 
 /*
- * Normal, non-SMP, invalidation functions.
- * We inline these within pmap.c for speed.
+ * Invalidation functions.
+ *
+ * Kernel mappings are shared by every address space, so they are flushed
+ * for all ASIDs on every hart.  User mappings are flushed only for the
+ * pmap's ASID, and only on the harts in pm_active.  With ASIDs a hart
+ * stays in pm_active after it switches away, because its TLB may still
+ * hold the pmap's entries.  Remote harts are reached through the SBI
+ * remote fence calls, which take the whole range in one request.
+ */
+
+/*
+ * Ranges larger than this many pages are flushed in full rather than
+ * page by page.  The crossover point depends on the cost of a TLB refill
+ * relative to sfence.vma on a given hart implementation.
+ */
+static u_int pmap_invalidate_pages_max = 16;
+SYSCTL_UINT(_vm_pmap, OID_AUTO, invalidate_pages_max, CTLFLAG_RWTUN,
+    &pmap_invalidate_pages_max, 0,
+    "Largest range, in pages, invalidated one page at a time");
+
+/*
+ * Return the set of other harts that may cache translations from the
+ * given pmap.  The caller must be pinned.
  */
+static __inline cpuset_t
+pmap_invalidate_remote(pmap_t pmap)
+{
+	cpuset_t mask;
+
+	/*
+	 * Order the preceding page table updates before the load of the
+	 * active set, pairing with the store in pmap_activate_sw().
+	 */
+	__asm __volatile("fence" ::: "memory");
+	if (pmap == kernel_pmap)
+		mask = all_cpus;
+	else
+		mask = pmap->pm_active;
+	CPU_CLR(PCPU_GET(cpuid), &mask);
+	if (!smp_started)
+		CPU_ZERO(&mask);
+	return (mask);
+}
+
+static __inline void
+pmap_sfence_page(u_long asid, vm_offset_t va)
+{
+
+	if (asid == 0)
+		__asm __volatile("sfence.vma %0" :: "r" (va) : "memory");
+	else
+		__asm __volatile("sfence.vma %0, %1" :: "r" (va), "r" (asid)
+		    : "memory");
+}
+
+static __inline void
+pmap_sfence_all(u_long asid)
+{
+
+	if (asid == 0)
+		__asm __volatile("sfence.vma" ::: "memory");
+	else
+		__asm __volatile("sfence.vma x0, %0" :: "r" (asid) : "memory");
+}
+
+static void
+pmap_sfence_remote(cpuset_t *mask, u_long asid, vm_offset_t va,
+    vm_size_t size)
+{
+
+	if (asid == 0)
+		sbi_remote_sfence_vma(mask->__bits, va, size);
+	else
+		sbi_remote_sfence_vma_asid(mask->__bits, va, size, asid);
+}
+
 PMAP_INLINE void
 pmap_invalidate_page(pmap_t pmap, vm_offset_t va)
 {
-
-	/* TODO */
+	cpuset_t mask;
+	u_long asid;
 
 	sched_pin();
-	__asm __volatile("sfence.vma %0" :: "r" (va) : "memory");
+	asid = ASID_NUM(pmap->pm_asid);
+	mask = pmap_invalidate_remote(pmap);
+	if (!CPU_EMPTY(&mask))
+		pmap_sfence_remote(&mask, asid, va, PAGE_SIZE);
+	pmap_sfence_page(asid, va);
 	sched_unpin();
 }
 
 PMAP_INLINE void
 pmap_invalidate_range(pmap_t pmap, vm_offset_t sva, vm_offset_t eva)
 {
+	cpuset_t mask;
+	vm_offset_t va;
+	u_long asid;
 
-	/* TODO */
+	if (atop(eva - sva) > pmap_invalidate_pages_max) {
+		pmap_invalidate_all(pmap);
+		return;
+	}
 
 	sched_pin();
-	__asm __volatile("sfence.vma");
+	asid = ASID_NUM(pmap->pm_asid);
+	mask = pmap_invalidate_remote(pmap);
+	if (!CPU_EMPTY(&mask))
+		pmap_sfence_remote(&mask, asid, sva, eva - sva);
+	for (va = sva; va < eva; va += PAGE_SIZE)
+		pmap_sfence_page(asid, va);
 	sched_unpin();
 }
 
 PMAP_INLINE void
 pmap_invalidate_all(pmap_t pmap)
 {
-
-	/* TODO */
+	cpuset_t mask;
+	u_long asid;
 
 	sched_pin();
-	__asm __volatile("sfence.vma");
+	asid = ASID_NUM(pmap->pm_asid);
+	mask = pmap_invalidate_remote(pmap);
+	if (!CPU_EMPTY(&mask))
+		pmap_sfence_remote(&mask, asid, 0, -1ul);
+	pmap_sfence_all(asid);
 	sched_unpin();
 }
 
@@ -837,7 +1308,7 @@ pmap_extract(pmap_t pmap, vm_offset_t va)
 			}
 		} else {
 			/* L2 is superpages */
-			pa = (l2 >> PTE_PPN1_S) << L2_SHIFT;
+			pa = PTE_TO_PHYS(l2);
 			pa |= (va & L2_OFFSET);
 		}
 	}
@@ -855,6 +1326,7 @@ pmap_extract(pmap_t pmap, vm_offset_t va)
 vm_page_t
 pmap_extract_and_hold(pmap_t pmap, vm_offset_t va, vm_prot_t prot)
 {
+	pd_entry_t *l2p;
 	pt_entry_t *l3p, l3;
 	vm_paddr_t phys;
 	vm_paddr_t pa;
@@ -864,10 +1336,18 @@ pmap_extract_and_hold(pmap_t pmap, vm_offset_t va, vm_prot_t prot)
 	m = NULL;
 	PMAP_LOCK(pmap);
 retry:
-	l3p = pmap_l3(pmap, va);
-	if (l3p != NULL && (l3 = pmap_load(l3p)) != 0) {
+	l3 = 0;
+	phys = 0;
+	l2p = pmap_l2(pmap, va);
+	if (l2p != NULL && (pmap_load(l2p) & PTE_RX) != 0) {
+		/* L2 is a superpage */
+		l3 = pmap_load(l2p);
+		phys = PTE_TO_PHYS(l3) | (va & L2_OFFSET & ~L3_OFFSET);
+	} else if ((l3p = pmap_l3(pmap, va)) != NULL &&
+	    (l3 = pmap_load(l3p)) != 0)
+		phys = PTE_TO_PHYS(l3);
+	if (l3 != 0) {
 		if ((pmap_is_write(l3)) || ((prot & VM_PROT_WRITE) == 0)) {
-			phys = PTE_TO_PHYS(l3);
 			if (vm_page_pa_tryrelock(pmap, phys, &pa))
 				goto retry;
 			m = PHYS_TO_VM_PAGE(phys);
@@ -894,7 +1374,7 @@ pmap_kextract(vm_offset_t va)
 			panic("pmap_kextract: No l2");
 		if ((pmap_load(l2) & PTE_RX) != 0) {
 			/* superpages */
-			pa = (pmap_load(l2) >> PTE_PPN1_S) << L2_SHIFT;
+			pa = PTE_TO_PHYS(pmap_load(l2));
 			pa |= (va & L2_OFFSET);
 			return (pa);
 		}
@@ -933,7 +1413,7 @@ pmap_kenter_device(vm_offset_t sva, vm_size_t size, vm_paddr_t pa)
 		KASSERT(l3 != NULL, ("Invalid page table, va: 0x%lx", va));
 
 		pn = (pa / PAGE_SIZE);
-		entry = PTE_KERN;
+		entry = PTE_KERN | pmap_memattr_bits(VM_MEMATTR_DEVICE);
 		entry |= (pn << PTE_PPN0_S);
 		pmap_load_store(l3, entry);
 
@@ -1035,7 +1515,7 @@ pmap_qenter(vm_offset_t sva, vm_page_t *ma, int count)
 		pn = (pa / PAGE_SIZE);
 		l3 = pmap_l3(kernel_pmap, va);
 
-		entry = PTE_KERN;
+		entry = PTE_KERN | pmap_memattr_bits(m->md.pv_memattr);
 		entry |= (pn << PTE_PPN0_S);
 		pmap_load_store(l3, entry);
 
@@ -1092,6 +1572,34 @@ pmap_add_delayed_free_list(vm_page_t m, struct spglist *free,
 		m->flags &= ~PG_ZERO;
 	SLIST_INSERT_HEAD(free, m, plinks.s.ss);
 }
+
+/*
+ * Inserts the specified page table page into the specified pmap's collection
+ * of idle page table pages.  Each of a pmap's page table pages is responsible
+ * for mapping a distinct range of virtual addresses.  The pmap's collection is
+ * ordered by this virtual address range.
+ */
+static __inline int
+pmap_insert_pt_page(pmap_t pmap, vm_page_t ml3)
+{
+
+	PMAP_LOCK_ASSERT(pmap, MA_OWNED);
+	return (vm_radix_insert(&pmap->pm_root, ml3));
+}
+
+/*
+ * Removes the page table page mapping the specified virtual address from the
+ * specified pmap's collection of idle page table pages, and returns it.
+ * Otherwise, returns NULL if there is no page table page corresponding to the
+ * specified virtual address.
+ */
+static __inline vm_page_t
+pmap_remove_pt_page(pmap_t pmap, vm_offset_t va)
+{
+
+	PMAP_LOCK_ASSERT(pmap, MA_OWNED);
+	return (vm_radix_remove(&pmap->pm_root, pmap_l2_pindex(va)));
+}
 	
 /*
  * Decrements a page table page's wire count, which is used to record the
@@ -1185,6 +1693,11 @@ pmap_pinit0(pmap_t pmap)
 	PMAP_LOCK_INIT(pmap);
 	bzero(&pmap->pm_stats, sizeof(pmap->pm_stats));
 	pmap->pm_l1 = kernel_pmap->pm_l1;
+	pmap->pm_root.rt_root = 0;
+	pmap->pm_asid = 0;
+	pmap->pm_icache_gen = 0;
+	CPU_ZERO(&pmap->pm_active);
+	DPCPU_SET(curpmap, pmap);
 }
 
 int
@@ -1207,6 +1720,12 @@ pmap_pinit(pmap_t pmap)
 		pagezero(pmap->pm_l1);
 
 	bzero(&pmap->pm_stats, sizeof(pmap->pm_stats));
+	pmap->pm_root.rt_root = 0;
+
+	/* An ASID is assigned when the pmap is first activated. */
+	pmap->pm_asid = 0;
+	pmap->pm_icache_gen = 0;
+	CPU_ZERO(&pmap->pm_active);
 
 	/* Install kernel pagetables */
 	memcpy(pmap->pm_l1, kernel_pmap->pm_l1, PAGE_SIZE);
@@ -1357,6 +1876,29 @@ pmap_alloc_l3(pmap_t pmap, vm_offset_t va, struct rwlock **lockp)
 	return (m);
 }
 
+/*
+ * Return the page directory page that holds the L2 entry for va, with an
+ * added reference for that entry.  Allocates the page if necessary.
+ */
+static vm_page_t
+pmap_alloc_l2(pmap_t pmap, vm_offset_t va, struct rwlock **lockp)
+{
+	pd_entry_t *l1;
+	vm_page_t l2pg;
+
+retry:
+	l1 = pmap_l1(pmap, va);
+	if ((pmap_load(l1) & PTE_V) != 0) {
+		l2pg = PHYS_TO_VM_PAGE(PTE_TO_PHYS(pmap_load(l1)));
+		l2pg->wire_count++;
+	} else {
+		l2pg = _pmap_alloc_l3(pmap, NUPDE + pmap_l1_index(va), lockp);
+		if (l2pg == NULL && lockp != NULL)
+			goto retry;
+	}
+	return (l2pg);
+}
+
 
 /***************************************************
  * Pmap allocation/deallocation routines.
@@ -1375,6 +1917,8 @@ pmap_release(pmap_t pmap)
 	KASSERT(pmap->pm_stats.resident_count == 0,
 	    ("pmap_release: pmap resident count %ld != 0",
 	    pmap->pm_stats.resident_count));
+	KASSERT(vm_radix_is_empty(&pmap->pm_root),
+	    ("pmap_release: pmap has reserved page table page(s)"));
 
 	m = PHYS_TO_VM_PAGE(DMAP_TO_PHYS((vm_offset_t)pmap->pm_l1));
 	vm_page_unwire_noq(m);
@@ -1537,6 +2081,11 @@ SYSCTL_INT(_vm_pmap, OID_AUTO, pv_entry_spare, CTLFLAG_RD, &pv_entry_spare, 0,
 #endif
 #endif /* 0 */
 
+static u_long pv_chunk_reclaims;
+SYSCTL_ULONG(_vm_pmap, OID_AUTO, pv_chunk_reclaims, CTLFLAG_RD,
+    &pv_chunk_reclaims, 0,
+    "Number of times PV entries were reclaimed to allocate a PV chunk");
+
 /*
  * We are in a serious low memory condition.  Resort to
  * drastic measures to free some pages so we can allocate
@@ -1551,58 +2100,232 @@ SYSCTL_INT(_vm_pmap, OID_AUTO, pv_entry_spare, CTLFLAG_RD, &pv_entry_spare, 0,
 static vm_page_t
 reclaim_pv_chunk(pmap_t locked_pmap, struct rwlock **lockp)
 {
+	struct pv_chunk *pc, *pc_marker, *pc_marker_end;
+	struct pv_chunk_header pc_marker_b, pc_marker_end_b;
+	struct md_page *pvh;
+	pd_entry_t *l2;
+	pmap_t next_pmap, pmap;
+	pt_entry_t *l3, tl3;
+	pv_entry_t pv;
+	vm_offset_t va;
+	vm_page_t m, m_pc;
+	struct spglist free;
+	uint64_t inuse;
+	int bit, field, freed;
+	static int active_reclaims = 0;
 
-	panic("RISCVTODO: reclaim_pv_chunk");
-}
+	rw_assert(&pvh_global_lock, RA_LOCKED);
+	PMAP_LOCK_ASSERT(locked_pmap, MA_OWNED);
+	KASSERT(lockp != NULL, ("reclaim_pv_chunk: lockp is NULL"));
 
-/*
- * free the pv_entry back to the free list
- */
-static void
-free_pv_entry(pmap_t pmap, pv_entry_t pv)
-{
-	struct pv_chunk *pc;
-	int idx, field, bit;
+	atomic_add_long(&pv_chunk_reclaims, 1);
+	pmap = NULL;
+	m_pc = NULL;
+	SLIST_INIT(&free);
+	bzero(&pc_marker_b, sizeof(pc_marker_b));
+	bzero(&pc_marker_end_b, sizeof(pc_marker_end_b));
+	pc_marker = (struct pv_chunk *)&pc_marker_b;
+	pc_marker_end = (struct pv_chunk *)&pc_marker_end_b;
 
-	rw_assert(&pvh_global_lock, RA_LOCKED);
-	PMAP_LOCK_ASSERT(pmap, MA_OWNED);
-	PV_STAT(atomic_add_long(&pv_entry_frees, 1));
-	PV_STAT(atomic_add_int(&pv_entry_spare, 1));
-	PV_STAT(atomic_subtract_long(&pv_entry_count, 1));
-	pc = pv_to_chunk(pv);
-	idx = pv - &pc->pc_pventry[0];
-	field = idx / 64;
-	bit = idx % 64;
-	pc->pc_map[field] |= 1ul << bit;
-	if (pc->pc_map[0] != PC_FREE0 || pc->pc_map[1] != PC_FREE1 ||
-	    pc->pc_map[2] != PC_FREE2) {
-		/* 98% of the time, pc is already at the head of the list. */
-		if (__predict_false(pc != TAILQ_FIRST(&pmap->pm_pvchunk))) {
-			TAILQ_REMOVE(&pmap->pm_pvchunk, pc, pc_list);
-			TAILQ_INSERT_HEAD(&pmap->pm_pvchunk, pc, pc_list);
+	mtx_lock(&pv_chunks_mutex);
+	active_reclaims++;
+	TAILQ_INSERT_HEAD(&pv_chunks, pc_marker, pc_lru);
+	TAILQ_INSERT_TAIL(&pv_chunks, pc_marker_end, pc_lru);
+	while ((pc = TAILQ_NEXT(pc_marker, pc_lru)) != pc_marker_end &&
+	    SLIST_EMPTY(&free)) {
+		next_pmap = pc->pc_pmap;
+		if (next_pmap == NULL) {
+			/*
+			 * The next chunk is a marker.  However, it is
+			 * not our marker, so active_reclaims must be
+			 * > 1.  Consequently, the next_chunk code
+			 * will not rotate the pv_chunks list.
+			 */
+			goto next_chunk;
 		}
-		return;
-	}
-	TAILQ_REMOVE(&pmap->pm_pvchunk, pc, pc_list);
-	free_pv_chunk(pc);
-}
+		mtx_unlock(&pv_chunks_mutex);
 
-static void
-free_pv_chunk(struct pv_chunk *pc)
-{
-	vm_page_t m;
+		/*
+		 * A pv_chunk can only be removed from the pc_lru list
+		 * when both pv_chunks_mutex is owned and the
+		 * corresponding pmap is locked.
+		 */
+		if (pmap != next_pmap) {
+			if (pmap != NULL && pmap != locked_pmap)
+				PMAP_UNLOCK(pmap);
+			pmap = next_pmap;
+			/* Avoid deadlock and lock recursion. */
+			if (pmap > locked_pmap) {
+				RELEASE_PV_LIST_LOCK(lockp);
+				PMAP_LOCK(pmap);
+				mtx_lock(&pv_chunks_mutex);
+				continue;
+			} else if (pmap != locked_pmap) {
+				if (PMAP_TRYLOCK(pmap)) {
+					mtx_lock(&pv_chunks_mutex);
+					continue;
+				} else {
+					pmap = NULL; /* pmap is not locked */
+					mtx_lock(&pv_chunks_mutex);
+					pc = TAILQ_NEXT(pc_marker, pc_lru);
+					if (pc == NULL ||
+					    pc->pc_pmap != next_pmap)
+						continue;
+					goto next_chunk;
+				}
+			}
+		}
 
-	mtx_lock(&pv_chunks_mutex);
- 	TAILQ_REMOVE(&pv_chunks, pc, pc_lru);
-	mtx_unlock(&pv_chunks_mutex);
-	PV_STAT(atomic_subtract_int(&pv_entry_spare, _NPCPV));
+		/*
+		 * Destroy every non-wired, 4 KB page mapping in the chunk.
+		 */
+		freed = 0;
+		for (field = 0; field < _NPCM; field++) {
+			for (inuse = ~pc->pc_map[field] & pc_freemask[field];
+			    inuse != 0; inuse &= ~(1UL << bit)) {
+				bit = ffsl(inuse) - 1;
+				pv = &pc->pc_pventry[field * 64 + bit];
+				va = pv->pv_va;
+				l2 = pmap_l2(pmap, va);
+				if ((pmap_load(l2) & PTE_RX) != 0)
+					continue;
+				l3 = pmap_l2_to_l3(l2, va);
+				tl3 = pmap_load(l3);
+				if ((tl3 & PTE_SW_WIRED) != 0)
+					continue;
+				tl3 = pmap_load_clear(l3);
+				PTE_SYNC(l3);
+				pmap_invalidate_page(pmap, va);
+				m = PHYS_TO_VM_PAGE(PTE_TO_PHYS(tl3));
+				if (pmap_page_dirty(tl3))
+					vm_page_dirty(m);
+				if ((tl3 & PTE_A) != 0)
+					vm_page_aflag_set(m, PGA_REFERENCED);
+				CHANGE_PV_LIST_LOCK_TO_VM_PAGE(lockp, m);
+				TAILQ_REMOVE(&m->md.pv_list, pv, pv_next);
+				m->md.pv_gen++;
+				if (TAILQ_EMPTY(&m->md.pv_list) &&
+				    (m->flags & PG_FICTITIOUS) == 0) {
+					pvh = pa_to_pvh(VM_PAGE_TO_PHYS(m));
+					if (TAILQ_EMPTY(&pvh->pv_list)) {
+						vm_page_aflag_clear(m,
+						    PGA_WRITEABLE);
+					}
+				}
+				pc->pc_map[field] |= 1UL << bit;
+				pmap_unuse_l3(pmap, va, pmap_load(l2), &free);
+				freed++;
+			}
+		}
+		if (freed == 0) {
+			mtx_lock(&pv_chunks_mutex);
+			goto next_chunk;
+		}
+		/* Every freed mapping is for a 4 KB page. */
+		pmap_resident_count_dec(pmap, freed);
+		PV_STAT(atomic_add_long(&pv_entry_frees, freed));
+		PV_STAT(atomic_add_int(&pv_entry_spare, freed));
+		PV_STAT(atomic_subtract_long(&pv_entry_count, freed));
+		TAILQ_REMOVE(&pmap->pm_pvchunk, pc, pc_list);
+		if (pc->pc_map[0] == PC_FREE0 && pc->pc_map[1] == PC_FREE1 &&
+		    pc->pc_map[2] == PC_FREE2) {
+			PV_STAT(atomic_subtract_int(&pv_entry_spare, _NPCPV));
+			PV_STAT(atomic_subtract_int(&pc_chunk_count, 1));
+			PV_STAT(atomic_add_int(&pc_chunk_frees, 1));
+			/* Entire chunk is free; return it. */
+			m_pc = PHYS_TO_VM_PAGE(DMAP_TO_PHYS((vm_offset_t)pc));
+			dump_drop_page(m_pc->phys_addr);
+			mtx_lock(&pv_chunks_mutex);
+			TAILQ_REMOVE(&pv_chunks, pc, pc_lru);
+			break;
+		}
+		TAILQ_INSERT_HEAD(&pmap->pm_pvchunk, pc, pc_list);
+		mtx_lock(&pv_chunks_mutex);
+		/* One freed pv entry in locked_pmap is sufficient. */
+		if (pmap == locked_pmap)
+			break;
+
+next_chunk:
+		TAILQ_REMOVE(&pv_chunks, pc_marker, pc_lru);
+		TAILQ_INSERT_AFTER(&pv_chunks, pc, pc_marker, pc_lru);
+		if (active_reclaims == 1 && pmap != NULL) {
+			/*
+			 * Rotate the pv chunks list so that we do not
+			 * scan the same pv chunks that could not be
+			 * freed (because they contained a wired
+			 * and/or superpage mapping) on every
+			 * invocation of reclaim_pv_chunk().
+			 */
+			while ((pc = TAILQ_FIRST(&pv_chunks)) != pc_marker) {
+				MPASS(pc->pc_pmap != NULL);
+				TAILQ_REMOVE(&pv_chunks, pc, pc_lru);
+				TAILQ_INSERT_TAIL(&pv_chunks, pc, pc_lru);
+			}
+		}
+	}
+	TAILQ_REMOVE(&pv_chunks, pc_marker, pc_lru);
+	TAILQ_REMOVE(&pv_chunks, pc_marker_end, pc_lru);
+	active_reclaims--;
+	mtx_unlock(&pv_chunks_mutex);
+	if (pmap != NULL && pmap != locked_pmap)
+		PMAP_UNLOCK(pmap);
+	if (m_pc == NULL && !SLIST_EMPTY(&free)) {
+		m_pc = SLIST_FIRST(&free);
+		SLIST_REMOVE_HEAD(&free, plinks.s.ss);
+		/* Recycle a freed page table page. */
+		m_pc->wire_count = 1;
+		vm_wire_add(1);
+	}
+	vm_page_free_pages_toq(&free, false);
+	return (m_pc);
+}
+
+/*
+ * free the pv_entry back to the free list
+ */
+static void
+free_pv_entry(pmap_t pmap, pv_entry_t pv)
+{
+	struct pv_chunk *pc;
+	int idx, field, bit;
+
+	rw_assert(&pvh_global_lock, RA_LOCKED);
+	PMAP_LOCK_ASSERT(pmap, MA_OWNED);
+	PV_STAT(atomic_add_long(&pv_entry_frees, 1));
+	PV_STAT(atomic_add_int(&pv_entry_spare, 1));
+	PV_STAT(atomic_subtract_long(&pv_entry_count, 1));
+	pc = pv_to_chunk(pv);
+	idx = pv - &pc->pc_pventry[0];
+	field = idx / 64;
+	bit = idx % 64;
+	pc->pc_map[field] |= 1ul << bit;
+	if (pc->pc_map[0] != PC_FREE0 || pc->pc_map[1] != PC_FREE1 ||
+	    pc->pc_map[2] != PC_FREE2) {
+		/* 98% of the time, pc is already at the head of the list. */
+		if (__predict_false(pc != TAILQ_FIRST(&pmap->pm_pvchunk))) {
+			TAILQ_REMOVE(&pmap->pm_pvchunk, pc, pc_list);
+			TAILQ_INSERT_HEAD(&pmap->pm_pvchunk, pc, pc_list);
+		}
+		return;
+	}
+	TAILQ_REMOVE(&pmap->pm_pvchunk, pc, pc_list);
+	free_pv_chunk(pc);
+}
+
+static void
+free_pv_chunk(struct pv_chunk *pc)
+{
+	vm_page_t m;
+
+	mtx_lock(&pv_chunks_mutex);
+ 	TAILQ_REMOVE(&pv_chunks, pc, pc_lru);
+	mtx_unlock(&pv_chunks_mutex);
+	PV_STAT(atomic_subtract_int(&pv_entry_spare, _NPCPV));
 	PV_STAT(atomic_subtract_int(&pc_chunk_count, 1));
 	PV_STAT(atomic_add_int(&pc_chunk_frees, 1));
 	/* entire chunk is free, return it */
 	m = PHYS_TO_VM_PAGE(DMAP_TO_PHYS((vm_offset_t)pc));
-#if 0 /* TODO: For minidump */
 	dump_drop_page(m->phys_addr);
-#endif
 	vm_page_unwire(m, PQ_NONE);
 	vm_page_free(m);
 }
@@ -1664,9 +2387,7 @@ get_pv_entry(pmap_t pmap, struct rwlock **lockp)
 	}
 	PV_STAT(atomic_add_int(&pc_chunk_count, 1));
 	PV_STAT(atomic_add_int(&pc_chunk_allocs, 1));
-#if 0 /* TODO: This is for minidump */
 	dump_add_page(m->phys_addr);
-#endif
 	pc = (void *)PHYS_TO_DMAP(m->phys_addr);
 	pc->pc_pmap = pmap;
 	pc->pc_map[0] = PC_FREE0 & ~1ul;	/* preallocated bit 0 */
@@ -1682,6 +2403,79 @@ get_pv_entry(pmap_t pmap, struct rwlock **lockp)
 	return (pv);
 }
 
+/*
+ * Ensure that the number of spare PV entries in the specified pmap meets or
+ * exceeds the given count, "needed".
+ *
+ * The given PV list lock may be released.
+ */
+static void
+reserve_pv_entries(pmap_t pmap, int needed, struct rwlock **lockp)
+{
+	struct pch new_tail;
+	struct pv_chunk *pc;
+	vm_page_t m;
+	int avail, free;
+	bool reclaimed;
+
+	rw_assert(&pvh_global_lock, RA_LOCKED);
+	PMAP_LOCK_ASSERT(pmap, MA_OWNED);
+	KASSERT(lockp != NULL, ("reserve_pv_entries: lockp is NULL"));
+
+	/*
+	 * Newly allocated PV chunks must be stored in a private list until
+	 * the required number of PV chunks have been allocated.  Otherwise,
+	 * reclaim_pv_chunk() could recycle one of these chunks.  In
+	 * contrast, these chunks must be added to the pmap upon allocation.
+	 */
+	TAILQ_INIT(&new_tail);
+retry:
+	avail = 0;
+	TAILQ_FOREACH(pc, &pmap->pm_pvchunk, pc_list) {
+		bit_count((bitstr_t *)pc->pc_map, 0,
+		    sizeof(pc->pc_map) * NBBY, &free);
+		if (free == 0)
+			break;
+		avail += free;
+		if (avail >= needed)
+			break;
+	}
+	for (reclaimed = false; avail < needed; avail += _NPCPV) {
+		m = vm_page_alloc(NULL, 0, VM_ALLOC_NORMAL | VM_ALLOC_NOOBJ |
+		    VM_ALLOC_WIRED);
+		if (m == NULL) {
+			m = reclaim_pv_chunk(pmap, lockp);
+			if (m == NULL)
+				goto retry;
+			reclaimed = true;
+		}
+		PV_STAT(atomic_add_int(&pc_chunk_count, 1));
+		PV_STAT(atomic_add_int(&pc_chunk_allocs, 1));
+		dump_add_page(m->phys_addr);
+		pc = (void *)PHYS_TO_DMAP(m->phys_addr);
+		pc->pc_pmap = pmap;
+		pc->pc_map[0] = PC_FREE0;
+		pc->pc_map[1] = PC_FREE1;
+		pc->pc_map[2] = PC_FREE2;
+		TAILQ_INSERT_HEAD(&pmap->pm_pvchunk, pc, pc_list);
+		TAILQ_INSERT_TAIL(&new_tail, pc, pc_lru);
+		PV_STAT(atomic_add_int(&pv_entry_spare, _NPCPV));
+
+		/*
+		 * The reclaim might have freed a chunk from the current pmap.
+		 * If that chunk contained available entries, we need to
+		 * re-count the number of available entries.
+		 */
+		if (reclaimed)
+			goto retry;
+	}
+	if (!TAILQ_EMPTY(&new_tail)) {
+		mtx_lock(&pv_chunks_mutex);
+		TAILQ_CONCAT(&pv_chunks, &new_tail, pc_lru);
+		mtx_unlock(&pv_chunks_mutex);
+	}
+}
+
 /*
  * First find and then remove the pv entry for the specified pmap and virtual
  * address from the specified pv list.  Returns the pv entry if found and NULL
@@ -1720,6 +2514,119 @@ pmap_pvh_free(struct md_page *pvh, pmap_t pmap, vm_offset_t va)
 	free_pv_entry(pmap, pv);
 }
 
+/*
+ * After demotion from a 2MB page mapping to 512 4KB page mappings,
+ * destroy the pv entry for the 2MB page mapping and reinstantiate the pv
+ * entries for each of the 4KB page mappings.
+ */
+static void
+pmap_pv_demote_l2(pmap_t pmap, vm_offset_t va, vm_paddr_t pa,
+    struct rwlock **lockp)
+{
+	struct md_page *pvh;
+	struct pv_chunk *pc;
+	pv_entry_t pv;
+	vm_offset_t va_last;
+	vm_page_t m;
+	int bit, field;
+
+	rw_assert(&pvh_global_lock, RA_LOCKED);
+	PMAP_LOCK_ASSERT(pmap, MA_OWNED);
+	KASSERT((pa & L2_OFFSET) == 0,
+	    ("pmap_pv_demote_l2: pa is not 2mpage aligned"));
+	CHANGE_PV_LIST_LOCK_TO_PHYS(lockp, pa);
+
+	/*
+	 * Transfer the 2mpage's pv entry for this mapping to the first
+	 * page's pv list.  Once this transfer begins, the pv list lock
+	 * must not be released until the last pv entry is reinstantiated.
+	 */
+	pvh = pa_to_pvh(pa);
+	va &= ~L2_OFFSET;
+	pv = pmap_pvh_remove(pvh, pmap, va);
+	KASSERT(pv != NULL, ("pmap_pv_demote_l2: pv not found"));
+	m = PHYS_TO_VM_PAGE(pa);
+	TAILQ_INSERT_TAIL(&m->md.pv_list, pv, pv_next);
+	m->md.pv_gen++;
+	/* Instantiate the remaining Ln_ENTRIES - 1 pv entries. */
+	PV_STAT(atomic_add_long(&pv_entry_allocs, Ln_ENTRIES - 1));
+	va_last = va + L2_SIZE - PAGE_SIZE;
+	for (;;) {
+		pc = TAILQ_FIRST(&pmap->pm_pvchunk);
+		KASSERT(pc->pc_map[0] != 0 || pc->pc_map[1] != 0 ||
+		    pc->pc_map[2] != 0, ("pmap_pv_demote_l2: missing spare"));
+		for (field = 0; field < _NPCM; field++) {
+			while (pc->pc_map[field] != 0) {
+				bit = ffsl(pc->pc_map[field]) - 1;
+				pc->pc_map[field] &= ~(1ul << bit);
+				pv = &pc->pc_pventry[field * 64 + bit];
+				va += PAGE_SIZE;
+				pv->pv_va = va;
+				m++;
+				KASSERT((m->oflags & VPO_UNMANAGED) == 0,
+			    ("pmap_pv_demote_l2: page %p is not managed", m));
+				TAILQ_INSERT_TAIL(&m->md.pv_list, pv, pv_next);
+				m->md.pv_gen++;
+				if (va == va_last)
+					goto out;
+			}
+		}
+		TAILQ_REMOVE(&pmap->pm_pvchunk, pc, pc_list);
+		TAILQ_INSERT_TAIL(&pmap->pm_pvchunk, pc, pc_list);
+	}
+out:
+	if (pc->pc_map[0] == 0 && pc->pc_map[1] == 0 && pc->pc_map[2] == 0) {
+		TAILQ_REMOVE(&pmap->pm_pvchunk, pc, pc_list);
+		TAILQ_INSERT_TAIL(&pmap->pm_pvchunk, pc, pc_list);
+	}
+	PV_STAT(atomic_add_long(&pv_entry_count, Ln_ENTRIES - 1));
+	PV_STAT(atomic_subtract_int(&pv_entry_spare, Ln_ENTRIES - 1));
+}
+
+#if VM_NRESERVLEVEL > 0
+/*
+ * After promotion from 512 4KB page mappings to a single 2MB page mapping,
+ * replace the many pv entries for the 4KB page mappings by a single pv entry
+ * for the 2MB page mapping.
+ */
+static void
+pmap_pv_promote_l2(pmap_t pmap, vm_offset_t va, vm_paddr_t pa,
+    struct rwlock **lockp)
+{
+	struct md_page *pvh;
+	pv_entry_t pv;
+	vm_offset_t va_last;
+	vm_page_t m;
+
+	rw_assert(&pvh_global_lock, RA_LOCKED);
+	KASSERT((pa & L2_OFFSET) == 0,
+	    ("pmap_pv_promote_l2: pa is not 2mpage aligned"));
+	CHANGE_PV_LIST_LOCK_TO_PHYS(lockp, pa);
+
+	/*
+	 * Transfer the first page's pv entry for this mapping to the 2mpage's
+	 * pv list.  Aside from avoiding the cost of a call to get_pv_entry(),
+	 * a transfer avoids the possibility that get_pv_entry() calls
+	 * reclaim_pv_chunk() and that reclaim_pv_chunk() removes one of the
+	 * mappings that is being promoted.
+	 */
+	m = PHYS_TO_VM_PAGE(pa);
+	va &= ~L2_OFFSET;
+	pv = pmap_pvh_remove(&m->md, pmap, va);
+	KASSERT(pv != NULL, ("pmap_pv_promote_l2: pv not found"));
+	pvh = pa_to_pvh(pa);
+	TAILQ_INSERT_TAIL(&pvh->pv_list, pv, pv_next);
+	pvh->pv_gen++;
+	/* Free the remaining Ln_ENTRIES - 1 pv entries. */
+	va_last = va + L2_SIZE - PAGE_SIZE;
+	do {
+		m++;
+		va += PAGE_SIZE;
+		pmap_pvh_free(&m->md, pmap, va);
+	} while (va < va_last);
+}
+#endif /* VM_NRESERVLEVEL > 0 */
+
 /*
  * Conditionally create the PV entry for a 4KB page mapping if the required
  * memory can be allocated without resorting to reclamation.
@@ -1743,8 +2650,236 @@ pmap_try_insert_pv_entry(pmap_t pmap, vm_offset_t va, vm_page_t m,
 		return (FALSE);
 }
 
+/*
+ * pmap_remove_l2: do the things to unmap a 2MB page mapping in a process
+ *
+ * Unlike pmap_remove_l3(), this invalidates the TLB itself: 4KB mappings
+ * cached before the superpage was promoted may still be present anywhere
+ * within its range.
+ */
+static int
+pmap_remove_l2(pmap_t pmap, pd_entry_t *l2, vm_offset_t sva,
+    pd_entry_t l1e, struct spglist *free, struct rwlock **lockp)
+{
+	struct md_page *pvh;
+	pd_entry_t oldl2;
+	vm_offset_t eva, va;
+	vm_page_t m, ml3;
+
+	PMAP_LOCK_ASSERT(pmap, MA_OWNED);
+	KASSERT((sva & L2_OFFSET) == 0, ("pmap_remove_l2: sva is not aligned"));
+	oldl2 = pmap_load_clear(l2);
+	PTE_SYNC(l2);
+	KASSERT((oldl2 & PTE_RX) != 0,
+	    ("pmap_remove_l2: L2e %lx is not a superpage mapping", oldl2));
+	pmap_invalidate_range(pmap, sva, sva + L2_SIZE);
+	if (oldl2 & PTE_SW_WIRED)
+		pmap->pm_stats.wired_count -= L2_SIZE / PAGE_SIZE;
+	pmap_resident_count_dec(pmap, L2_SIZE / PAGE_SIZE);
+	if (oldl2 & PTE_SW_MANAGED) {
+		CHANGE_PV_LIST_LOCK_TO_PHYS(lockp, PTE_TO_PHYS(oldl2));
+		pvh = pa_to_pvh(PTE_TO_PHYS(oldl2));
+		pmap_pvh_free(pvh, pmap, sva);
+		eva = sva + L2_SIZE;
+		for (va = sva, m = PHYS_TO_VM_PAGE(PTE_TO_PHYS(oldl2));
+		    va < eva; va += PAGE_SIZE, m++) {
+			if (pmap_page_dirty(oldl2))
+				vm_page_dirty(m);
+			if (oldl2 & PTE_A)
+				vm_page_aflag_set(m, PGA_REFERENCED);
+			if (TAILQ_EMPTY(&m->md.pv_list) &&
+			    TAILQ_EMPTY(&pvh->pv_list))
+				vm_page_aflag_clear(m, PGA_WRITEABLE);
+		}
+	}
+	ml3 = pmap_remove_pt_page(pmap, sva);
+	if (ml3 != NULL) {
+		pmap_resident_count_dec(pmap, 1);
+		KASSERT(ml3->wire_count == Ln_ENTRIES,
+		    ("pmap_remove_l2: l3 page wire count error"));
+		ml3->wire_count = 1;
+		vm_page_unwire_noq(ml3);
+		pmap_add_delayed_free_list(ml3, free, FALSE);
+	}
+	return (pmap_unuse_l3(pmap, sva, l1e, free));
+}
+
+/*
+ * Fill the given L3 table with the 4KB page mappings that make up the
+ * 2MB page mapping "newl2".
+ */
+static void
+pmap_fill_l3(pt_entry_t *firstl3, pd_entry_t newl2)
+{
+	int i;
+
+	for (i = 0; i < Ln_ENTRIES; i++)
+		firstl3[i] = newl2 + ((pt_entry_t)i << PTE_PPN0_S);
+}
+
+/*
+ * Create an L3 table to map all addresses within a 2MB page mapping, and
+ * return a pointer to its first entry.  If a page table page cannot be
+ * allocated, the 2MB page mapping is destroyed instead and NULL is returned.
+ *
+ * A superpage whose PTE_A has been cleared by pmap_ts_referenced() is
+ * destroyed rather than demoted.  Otherwise PTE_A is set, and PTE_D is set
+ * whenever PTE_W is, so the hardware cannot update the L2 entry while it
+ * is being replaced.
+ */
+static pt_entry_t *
+pmap_demote_l2_locked(pmap_t pmap, pd_entry_t *l2, vm_offset_t va,
+    struct rwlock **lockp)
+{
+	struct spglist free;
+	pd_entry_t newl2, oldl2;
+	pt_entry_t *firstl3;
+	vm_paddr_t ml3pa;
+	vm_page_t ml3;
+
+	rw_assert(&pvh_global_lock, RA_LOCKED);
+	PMAP_LOCK_ASSERT(pmap, MA_OWNED);
+	va &= ~L2_OFFSET;
+	oldl2 = pmap_load(l2);
+	KASSERT((oldl2 & PTE_RX) != 0,
+	    ("pmap_demote_l2_locked: oldl2 is not a superpage mapping"));
+	if ((oldl2 & PTE_A) == 0 ||
+	    (ml3 = pmap_remove_pt_page(pmap, va)) == NULL) {
+		KASSERT((oldl2 & PTE_SW_WIRED) == 0,
+		    ("pmap_demote_l2_locked: page table page for a wired "
+		    "mapping is missing"));
+
+		/*
+		 * Invalidate the 2MB page mapping and return "failure" if the
+		 * mapping was never accessed or the allocation of the new
+		 * page table page fails.
+		 */
+		if ((oldl2 & PTE_A) == 0 || (ml3 = vm_page_alloc(NULL,
+		    pmap_l2_pindex(va), (va >= VM_MAXUSER_ADDRESS ?
+		    VM_ALLOC_INTERRUPT : VM_ALLOC_NORMAL) | VM_ALLOC_NOOBJ |
+		    VM_ALLOC_WIRED)) == NULL) {
+			SLIST_INIT(&free);
+			(void)pmap_remove_l2(pmap, l2, va,
+			    pmap_load(pmap_l1(pmap, va)), &free, lockp);
+			vm_page_free_pages_toq(&free, true);
+			CTR2(KTR_PMAP, "pmap_demote_l2_locked: "
+			    "failure for va %#lx in pmap %p", va, pmap);
+			return (NULL);
+		}
+		if (va < VM_MAXUSER_ADDRESS)
+			pmap_resident_count_inc(pmap, 1);
+	}
+	ml3pa = VM_PAGE_TO_PHYS(ml3);
+	firstl3 = (pt_entry_t *)PHYS_TO_DMAP(ml3pa);
+
+	/*
+	 * If the page table page is new, initialize it.  A saved page table
+	 * page is refilled if the superpage's attributes have changed since
+	 * it was promoted.
+	 */
+	if (ml3->wire_count == 1) {
+		if (va < VM_MAXUSER_ADDRESS)
+			ml3->wire_count = Ln_ENTRIES;
+		pmap_fill_l3(firstl3, oldl2);
+	} else if (pmap_load(firstl3) != oldl2)
+		pmap_fill_l3(firstl3, oldl2);
+
+	/*
+	 * The spare PV entries must be reserved prior to demoting the
+	 * mapping, that is, prior to changing the L2 entry.  Otherwise, the
+	 * state of the L2 entry and the PV lists will be inconsistent, which
+	 * can result in reclaim_pv_chunk() attempting to remove a PV entry
+	 * from the wrong PV list and pmap_pv_demote_l2() failing to find the
+	 * expected PV entry for the 2MB page mapping that is being demoted.
+	 */
+	if ((oldl2 & PTE_SW_MANAGED) != 0)
+		reserve_pv_entries(pmap, Ln_ENTRIES - 1, lockp);
+
+	/*
+	 * Demote the mapping.  A single fence removes the superpage's TLB
+	 * entry, whichever address within it was used to create that entry.
+	 */
+	newl2 = PTE_V | ((ml3pa / PAGE_SIZE) << PTE_PPN0_S);
+	pmap_load_store(l2, newl2);
+	PTE_SYNC(l2);
+	pmap_invalidate_page(pmap, va);
+
+	/*
+	 * Demote the PV entry.
+	 */
+	if ((oldl2 & PTE_SW_MANAGED) != 0)
+		pmap_pv_demote_l2(pmap, va, PTE_TO_PHYS(oldl2), lockp);
+
+	atomic_add_long(&pmap_l2_demotions, 1);
+	CTR2(KTR_PMAP, "pmap_demote_l2_locked: success for va %#lx in pmap %p",
+	    va, pmap);
+	return (firstl3);
+}
+
+static pt_entry_t *
+pmap_demote_l2(pmap_t pmap, pd_entry_t *l2, vm_offset_t va)
+{
+	struct rwlock *lock;
+	pt_entry_t *l3;
+
+	lock = NULL;
+	l3 = pmap_demote_l2_locked(pmap, l2, va, &lock);
+	if (lock != NULL)
+		rw_wunlock(lock);
+	return (l3);
+}
+
+/*
+ * Replace a 1GB page mapping in the kernel pmap, such as those of the
+ * direct map, with an L2 table of 2MB page mappings.  Returns FALSE if
+ * the L2 table cannot be allocated, leaving the 1GB page mapping intact.
+ */
+static boolean_t
+pmap_demote_l1(pmap_t pmap, pd_entry_t *l1, vm_offset_t va)
+{
+	pd_entry_t newl1, oldl1;
+	pd_entry_t *l2;
+	vm_paddr_t l2pa;
+	vm_page_t ml2;
+	int i;
+
+	KASSERT(pmap == kernel_pmap,
+	    ("pmap_demote_l1: pmap %p is not the kernel pmap", pmap));
+	PMAP_LOCK_ASSERT(pmap, MA_OWNED);
+	oldl1 = pmap_load(l1);
+	KASSERT((oldl1 & PTE_RX) != 0,
+	    ("pmap_demote_l1: oldl1 is not a superpage mapping"));
+	KASSERT((oldl1 & PTE_A) != 0 &&
+	    (oldl1 & (PTE_W | PTE_D)) != PTE_W,
+	    ("pmap_demote_l1: oldl1 may be updated by the hardware"));
+
+	ml2 = vm_page_alloc(NULL, 0, VM_ALLOC_INTERRUPT | VM_ALLOC_NOOBJ |
+	    VM_ALLOC_WIRED);
+	if (ml2 == NULL) {
+		CTR2(KTR_PMAP, "pmap_demote_l1: failure for va %#lx in pmap %p",
+		    va, pmap);
+		return (FALSE);
+	}
+	l2pa = VM_PAGE_TO_PHYS(ml2);
+	l2 = (pd_entry_t *)PHYS_TO_DMAP(l2pa);
+	for (i = 0; i < Ln_ENTRIES; i++)
+		l2[i] = oldl1 + ((pt_entry_t)i << PTE_PPN1_S);
+
+	newl1 = PTE_V | ((l2pa / PAGE_SIZE) << PTE_PPN0_S);
+	pmap_load_store(l1, newl1);
+	pmap_distribute_l1(pmap, pmap_l1_index(va), newl1);
+	PTE_SYNC(l1);
+	pmap_invalidate_page(pmap, va & ~L1_OFFSET);
+	CTR2(KTR_PMAP, "pmap_demote_l1: success for va %#lx in pmap %p",
+	    va, pmap);
+	return (TRUE);
+}
+
 /*
  * pmap_remove_l3: do the things to unmap a page in a process
+ *
+ * The caller is responsible for invalidating the TLB entry, which lets
+ * pmap_remove() batch the invalidation of a run of pages.
  */
 static int
 pmap_remove_l3(pmap_t pmap, pt_entry_t *l3, vm_offset_t va, 
@@ -1759,7 +2894,6 @@ pmap_remove_l3(pmap_t pmap, pt_entry_t *l3, vm_offset_t va,
 		cpu_dcache_wb_range(va, L3_SIZE);
 	old_l3 = pmap_load_clear(l3);
 	PTE_SYNC(l3);
-	pmap_invalidate_page(pmap, va);
 	if (old_l3 & PTE_SW_WIRED)
 		pmap->pm_stats.wired_count -= 1;
 	pmap_resident_count_dec(pmap, 1);
@@ -1834,8 +2968,16 @@ pmap_remove(pmap_t pmap, vm_offset_t sva, vm_offset_t eva)
 		 */
 		if (l3_pte == 0)
 			continue;
-		if ((pmap_load(l2) & PTE_RX) != 0)
-			continue;
+		if ((l3_pte & PTE_RX) != 0) {
+			if (sva + L2_SIZE == va_next && eva >= va_next) {
+				(void)pmap_remove_l2(pmap, l2, sva,
+				    pmap_load(l1), &free, &lock);
+				continue;
+			} else if (pmap_demote_l2_locked(pmap, l2, sva,
+			    &lock) == NULL)
+				continue;
+			l3_pte = pmap_load(l2);
+		}
 
 		/*
 		 * Limit our scan to either the end of the va represented
@@ -1891,16 +3033,28 @@ pmap_remove(pmap_t pmap, vm_offset_t sva, vm_offset_t eva)
 void
 pmap_remove_all(vm_page_t m)
 {
+	struct md_page *pvh;
 	pv_entry_t pv;
 	pmap_t pmap;
 	pt_entry_t *l3, tl3;
 	pd_entry_t *l2, tl2;
 	struct spglist free;
+	vm_offset_t va;
 
 	KASSERT((m->oflags & VPO_UNMANAGED) == 0,
 	    ("pmap_remove_all: page %p is not managed", m));
 	SLIST_INIT(&free);
+	pvh = (m->flags & PG_FICTITIOUS) != 0 ? &pv_dummy :
+	    pa_to_pvh(VM_PAGE_TO_PHYS(m));
 	rw_wlock(&pvh_global_lock);
+	while ((pv = TAILQ_FIRST(&pvh->pv_list)) != NULL) {
+		pmap = PV_PMAP(pv);
+		PMAP_LOCK(pmap);
+		va = pv->pv_va;
+		l2 = pmap_l2(pmap, va);
+		(void)pmap_demote_l2(pmap, l2, va);
+		PMAP_UNLOCK(pmap);
+	}
 	while ((pv = TAILQ_FIRST(&m->md.pv_list)) != NULL) {
 		pmap = PV_PMAP(pv);
 		PMAP_LOCK(pmap);
@@ -1949,9 +3103,9 @@ void
 pmap_protect(pmap_t pmap, vm_offset_t sva, vm_offset_t eva, vm_prot_t prot)
 {
 	vm_offset_t va, va_next;
-	pd_entry_t *l1, *l2;
+	pd_entry_t *l1, *l2, l2e;
 	pt_entry_t *l3p, l3;
-	pt_entry_t entry;
+	boolean_t pv_lists_locked;
 
 	if ((prot & VM_PROT_READ) == VM_PROT_NONE) {
 		pmap_remove(pmap, sva, eva);
@@ -1961,6 +3115,8 @@ pmap_protect(pmap_t pmap, vm_offset_t sva, vm_offset_t eva, vm_prot_t prot)
 	if ((prot & VM_PROT_WRITE) == VM_PROT_WRITE)
 		return;
 
+	pv_lists_locked = FALSE;
+resume:
 	PMAP_LOCK(pmap);
 	for (; sva < eva; sva = va_next) {
 
@@ -1979,31 +3135,173 @@ pmap_protect(pmap_t pmap, vm_offset_t sva, vm_offset_t eva, vm_prot_t prot)
 		l2 = pmap_l1_to_l2(l1, sva);
 		if (l2 == NULL)
 			continue;
-		if (pmap_load(l2) == 0)
-			continue;
-		if ((pmap_load(l2) & PTE_RX) != 0)
+		l2e = pmap_load(l2);
+		if (l2e == 0)
 			continue;
+		if ((l2e & PTE_RX) != 0) {
+			if (sva + L2_SIZE == va_next && eva >= va_next) {
+				/*
+				 * Write protect the entire superpage.  PTE_D
+				 * is preserved, as in the 4KB case.
+				 */
+				while ((l2e & PTE_W) != 0 &&
+				    !atomic_cmpset_long(l2, l2e, l2e & ~PTE_W))
+					l2e = pmap_load(l2);
+				if ((l2e & PTE_W) != 0) {
+					PTE_SYNC(l2);
+					pmap_invalidate_range(pmap, sva,
+					    va_next);
+				}
+				continue;
+			}
+			if (!pv_lists_locked) {
+				pv_lists_locked = TRUE;
+				if (!rw_try_rlock(&pvh_global_lock)) {
+					PMAP_UNLOCK(pmap);
+					rw_rlock(&pvh_global_lock);
+					/* Repeat sva. */
+					goto resume;
+				}
+			}
+			if (pmap_demote_l2(pmap, l2, sva) == NULL)
+				continue;
+		}
 
 		if (va_next > eva)
 			va_next = eva;
 
+		/*
+		 * Coalesce each run of downgraded mappings into a single
+		 * ranged invalidation.
+		 */
 		va = va_next;
 		for (l3p = pmap_l2_to_l3(l2, sva); sva != va_next; l3p++,
 		    sva += L3_SIZE) {
 			l3 = pmap_load(l3p);
-			if (pmap_l3_valid(l3)) {
-				entry = pmap_load(l3p);
-				entry &= ~(PTE_W);
-				pmap_load_store(l3p, entry);
-				PTE_SYNC(l3p);
-				/* XXX: Use pmap_invalidate_range */
-				pmap_invalidate_page(pmap, sva);
+			if (!pmap_l3_valid(l3) || !pmap_is_write(l3)) {
+				if (va != va_next) {
+					pmap_invalidate_range(pmap, va, sva);
+					va = va_next;
+				}
+				continue;
 			}
+			/* Do not lose a concurrent update of PTE_D. */
+			while (!atomic_cmpset_long(l3p, l3, l3 & ~PTE_W))
+				l3 = pmap_load(l3p);
+			PTE_SYNC(l3p);
+			if (va == va_next)
+				va = sva;
 		}
+		if (va != va_next)
+			pmap_invalidate_range(pmap, va, sva);
 	}
+	if (pv_lists_locked)
+		rw_runlock(&pvh_global_lock);
 	PMAP_UNLOCK(pmap);
 }
 
+#if VM_NRESERVLEVEL > 0
+/*
+ * Tries to promote the 512, contiguous 4KB page mappings that are within a
+ * single page table page to a single 2MB page mapping.  For promotion to
+ * occur, two conditions must be met: (1) the 4KB page mappings must map
+ * aligned, contiguous physical memory and (2) the 4KB page mappings must have
+ * identical characteristics.
+ */
+static void
+pmap_promote_l2(pmap_t pmap, pd_entry_t *l2, vm_offset_t va,
+    struct rwlock **lockp)
+{
+	pt_entry_t *firstl3, firstl3e, *l3, l3e;
+	vm_paddr_t pa;
+	vm_page_t ml3;
+
+	rw_assert(&pvh_global_lock, RA_LOCKED);
+	PMAP_LOCK_ASSERT(pmap, MA_OWNED);
+	va &= ~L2_OFFSET;
+	KASSERT((pmap_load(l2) & PTE_RX) == 0,
+	    ("pmap_promote_l2: invalid l2 entry %p", l2));
+
+	/*
+	 * Examine the first L3E in the specified PTP.  Abort if this L3E is
+	 * invalid, has not been accessed, or does not map the first 4KB
+	 * physical page within a 2MB page.
+	 */
+	firstl3 = (pt_entry_t *)PHYS_TO_DMAP(PTE_TO_PHYS(pmap_load(l2)));
+	firstl3e = pmap_load(firstl3);
+setl2:
+	if ((firstl3e & (PTE_V | PTE_A)) != (PTE_V | PTE_A) ||
+	    (PTE_TO_PHYS(firstl3e) & L2_OFFSET) != 0)
+		goto fail;
+	if ((firstl3e & (PTE_W | PTE_D)) == PTE_W) {
+		/*
+		 * When the mapping is clean, just clear PTE_W.  The
+		 * superpage may then never be writable and clean, so the
+		 * hardware cannot set PTE_D behind pmap_demote_l2()'s back.
+		 */
+		if (!atomic_cmpset_long(firstl3, firstl3e, firstl3e & ~PTE_W)) {
+			firstl3e = pmap_load(firstl3);
+			goto setl2;
+		}
+		firstl3e &= ~PTE_W;
+	}
+
+	/*
+	 * Examine each of the other L3Es in the specified PTP.  Abort if this
+	 * L3E maps an unexpected 4KB physical page or does not have identical
+	 * characteristics to the first L3E.
+	 */
+	pa = PTE_TO_PHYS(firstl3e) + L2_SIZE - PAGE_SIZE;
+	for (l3 = firstl3 + Ln_ENTRIES - 1; l3 > firstl3; l3--) {
+		l3e = pmap_load(l3);
+setl3:
+		if (PTE_TO_PHYS(l3e) != pa)
+			goto fail;
+		if ((l3e & (PTE_W | PTE_D)) == PTE_W) {
+			if (!atomic_cmpset_long(l3, l3e, l3e & ~PTE_W)) {
+				l3e = pmap_load(l3);
+				goto setl3;
+			}
+			l3e &= ~PTE_W;
+		}
+		if ((l3e & PTE_PROMOTE) != (firstl3e & PTE_PROMOTE))
+			goto fail;
+		pa -= PAGE_SIZE;
+	}
+
+	/*
+	 * Save the page table page in its current state until the L2
+	 * mapping the superpage is demoted by pmap_demote_l2() or
+	 * destroyed by pmap_remove_l2().
+	 */
+	ml3 = PHYS_TO_VM_PAGE(PTE_TO_PHYS(pmap_load(l2)));
+	KASSERT(ml3->pindex == pmap_l2_pindex(va),
+	    ("pmap_promote_l2: page table page's pindex is wrong"));
+	if (pmap_insert_pt_page(pmap, ml3))
+		goto fail;
+
+	if ((firstl3e & PTE_SW_MANAGED) != 0)
+		pmap_pv_promote_l2(pmap, va, PTE_TO_PHYS(firstl3e), lockp);
+
+	/*
+	 * No invalidation is needed: whatever 4KB mappings remain cached are
+	 * equivalent to the superpage, and they are invalidated along with
+	 * it by pmap_remove_l2().
+	 */
+	pmap_load_store(l2, firstl3e);
+	PTE_SYNC(l2);
+
+	atomic_add_long(&pmap_l2_promotions, 1);
+	CTR2(KTR_PMAP, "pmap_promote_l2: success for va %#lx in pmap %p", va,
+	    pmap);
+	return;
+fail:
+	atomic_add_long(&pmap_l2_p_failures, 1);
+	CTR2(KTR_PMAP, "pmap_promote_l2: failure for va %#lx in pmap %p", va,
+	    pmap);
+}
+#endif /* VM_NRESERVLEVEL > 0 */
+
 /*
  *	Insert the given physical page (p) at
  *	the specified virtual address (v) in the
@@ -2018,7 +3316,7 @@ pmap_protect(pmap_t pmap, vm_offset_t sva, vm_offset_t eva, vm_prot_t prot)
  */
 int
 pmap_enter(pmap_t pmap, vm_offset_t va, vm_page_t m, vm_prot_t prot,
-    u_int flags, int8_t psind __unused)
+    u_int flags, int8_t psind)
 {
 	struct rwlock *lock;
 	pd_entry_t *l1, *l2;
@@ -2029,6 +3327,7 @@ pmap_enter(pmap_t pmap, vm_offset_t va, vm_page_t m, vm_prot_t prot,
 	vm_page_t mpte, om, l2_m, l3_m;
 	boolean_t nosleep;
 	pt_entry_t entry;
+	int rv;
 	pn_t l2_pn;
 	pn_t l3_pn;
 	pn_t pn;
@@ -2039,18 +3338,24 @@ pmap_enter(pmap_t pmap, vm_offset_t va, vm_page_t m, vm_prot_t prot,
 	pa = VM_PAGE_TO_PHYS(m);
 	pn = (pa / PAGE_SIZE);
 
-	new_l3 = PTE_V | PTE_R | PTE_X;
-	if (prot & VM_PROT_WRITE)
+	/*
+	 * The mapping is being created in response to an access, so it starts
+	 * out referenced, and dirty if the access was a write.  Unmanaged
+	 * pages have no modified state to track, so their writable mappings
+	 * are created dirty to avoid a fault on the first write.
+	 */
+	new_l3 = PTE_V | PTE_R | PTE_X | PTE_A;
+	if (prot & VM_PROT_WRITE) {
 		new_l3 |= PTE_W;
-	if ((va >> 63) == 0)
-		new_l3 |= PTE_U;
-	else {
-		new_l3 |= PTE_A;
-		if ((flags & VM_PROT_WRITE) != 0)
+		if ((flags & VM_PROT_WRITE) != 0 ||
+		    (m->oflags & VPO_UNMANAGED) != 0)
 			new_l3 |= PTE_D;
 	}
+	if ((va >> 63) == 0)
+		new_l3 |= PTE_U;
 
 	new_l3 |= (pn << PTE_PPN0_S);
+	new_l3 |= pmap_memattr_bits(m->md.pv_memattr);
 	if ((flags & PMAP_ENTER_WIRED) != 0)
 		new_l3 |= PTE_SW_WIRED;
 	if ((m->oflags & VPO_UNMANAGED) == 0)
@@ -2064,6 +3369,25 @@ pmap_enter(pmap_t pmap, vm_offset_t va, vm_page_t m, vm_prot_t prot,
 	rw_rlock(&pvh_global_lock);
 	PMAP_LOCK(pmap);
 
+	if (psind == 1 && va < VM_MAXUSER_ADDRESS) {
+		/* Assert the required virtual and physical alignment. */
+		KASSERT((va & L2_OFFSET) == 0, ("pmap_enter: va unaligned"));
+		KASSERT(m->psind > 0, ("pmap_enter: m->psind < psind"));
+		rv = pmap_enter_l2(pmap, va, new_l3, flags, m, &lock);
+		goto out;
+	}
+
+	l2 = pmap_l2(pmap, va);
+	if (l2 != NULL && (pmap_load(l2) & PTE_RX) != 0 &&
+	    (l3 = pmap_demote_l2_locked(pmap, l2, va, &lock)) != NULL) {
+		l3 = &l3[pmap_l3_index(va)];
+		if (va < VM_MAXUSER_ADDRESS) {
+			mpte = PHYS_TO_VM_PAGE(PTE_TO_PHYS(pmap_load(l2)));
+			mpte->wire_count++;
+		}
+		goto havel3;
+	}
+
 	if (va < VM_MAXUSER_ADDRESS) {
 		nosleep = (flags & PMAP_ENTER_NOSLEEP) != 0;
 		mpte = pmap_alloc_l3(pmap, va, nosleep ? NULL : &lock);
@@ -2123,7 +3447,7 @@ pmap_enter(pmap_t pmap, vm_offset_t va, vm_page_t m, vm_prot_t prot,
 		}
 		pmap_invalidate_page(pmap, va);
 	}
-
+havel3:
 	orig_l3 = pmap_load(l3);
 	opa = PTE_TO_PHYS(orig_l3);
 	pv = NULL;
@@ -2162,15 +3486,9 @@ pmap_enter(pmap_t pmap, vm_offset_t va, vm_page_t m, vm_prot_t prot,
 			/*
 			 * No, might be a protection or wiring change.
 			 */
-			if ((orig_l3 & PTE_SW_MANAGED) != 0) {
-				if (pmap_is_write(new_l3)) {
-					if (flags & PROT_WRITE)
-						new_l3 |= PTE_D;
-					vm_page_aflag_set(m, PGA_WRITEABLE);
-				}
-				if (flags & PROT_READ)
-					new_l3 |= PTE_A;
-			}
+			if ((orig_l3 & PTE_SW_MANAGED) != 0 &&
+			    pmap_is_write(new_l3))
+				vm_page_aflag_set(m, PGA_WRITEABLE);
 			goto validate;
 		}
 
@@ -2208,7 +3526,9 @@ pmap_enter(pmap_t pmap, vm_offset_t va, vm_page_t m, vm_prot_t prot,
 			if ((new_l3 & PTE_SW_MANAGED) == 0)
 				free_pv_entry(pmap, pv);
 			if ((om->aflags & PGA_WRITEABLE) != 0 &&
-			    TAILQ_EMPTY(&om->md.pv_list))
+			    TAILQ_EMPTY(&om->md.pv_list) &&
+			    ((om->flags & PG_FICTITIOUS) != 0 ||
+			    TAILQ_EMPTY(&pa_to_pvh(opa)->pv_list)))
 				vm_page_aflag_clear(om, PGA_WRITEABLE);
 		}
 		pmap_invalidate_page(pmap, va);
@@ -2256,10 +3576,111 @@ pmap_enter(pmap_t pmap, vm_offset_t va, vm_page_t m, vm_prot_t prot,
 	if ((pmap != pmap_kernel()) && (pmap == &curproc->p_vmspace->vm_pmap))
 	    cpu_icache_sync_range(va, PAGE_SIZE);
 
+#if VM_NRESERVLEVEL > 0
+	/*
+	 * If both the page table page and the reservation are fully
+	 * populated, then attempt promotion.
+	 */
+	if (mpte != NULL && mpte->wire_count == Ln_ENTRIES &&
+	    pmap_ps_enabled(pmap) &&
+	    (m->flags & PG_FICTITIOUS) == 0 &&
+	    vm_reserv_level_iffullpop(m) == 0)
+		pmap_promote_l2(pmap, pmap_l2(pmap, va), va, &lock);
+#endif
+
+	rv = KERN_SUCCESS;
+out:
 	if (lock != NULL)
 		rw_wunlock(lock);
 	rw_runlock(&pvh_global_lock);
 	PMAP_UNLOCK(pmap);
+	return (rv);
+}
+
+/*
+ * Create the 2MB page mapping "new_l2" for va in a user pmap, replacing
+ * any existing mappings in that range.  Returns KERN_RESOURCE_SHORTAGE if
+ * PMAP_ENTER_NOSLEEP was specified and a page table page could not be
+ * allocated.
+ */
+static int
+pmap_enter_l2(pmap_t pmap, vm_offset_t va, pd_entry_t new_l2, u_int flags,
+    vm_page_t m, struct rwlock **lockp)
+{
+	struct spglist free;
+	struct md_page *pvh;
+	pd_entry_t *l2, old_l2;
+	pt_entry_t *l3;
+	vm_offset_t sva;
+	vm_page_t l2pg, mt;
+	pv_entry_t pv;
+
+	rw_assert(&pvh_global_lock, RA_LOCKED);
+	PMAP_LOCK_ASSERT(pmap, MA_OWNED);
+
+	if ((l2pg = pmap_alloc_l2(pmap, va, (flags & PMAP_ENTER_NOSLEEP) != 0 ?
+	    NULL : lockp)) == NULL) {
+		CTR2(KTR_PMAP, "pmap_enter_l2: failure for va %#lx in pmap %p",
+		    va, pmap);
+		return (KERN_RESOURCE_SHORTAGE);
+	}
+
+	l2 = (pd_entry_t *)PHYS_TO_DMAP(VM_PAGE_TO_PHYS(l2pg));
+	l2 = &l2[pmap_l2_index(va)];
+	if ((old_l2 = pmap_load(l2)) != 0) {
+		KASSERT(l2pg->wire_count > 1,
+		    ("pmap_enter_l2: l2pg's wire count is too low"));
+		SLIST_INIT(&free);
+		if ((old_l2 & PTE_RX) != 0)
+			(void)pmap_remove_l2(pmap, l2, va,
+			    pmap_load(pmap_l1(pmap, va)), &free, lockp);
+		else {
+			for (sva = va; sva < va + L2_SIZE; sva += PAGE_SIZE) {
+				l3 = pmap_l2_to_l3(l2, sva);
+				if (pmap_l3_valid(pmap_load(l3)) &&
+				    pmap_remove_l3(pmap, l3, sva, old_l2, &free,
+				    lockp) != 0)
+					break;
+			}
+			pmap_invalidate_range(pmap, va, va + L2_SIZE);
+		}
+		vm_page_free_pages_toq(&free, true);
+		KASSERT(pmap_load(l2) == 0,
+		    ("pmap_enter_l2: non-zero L2 entry %p", l2));
+	}
+
+	if ((new_l2 & PTE_SW_MANAGED) != 0) {
+		pv = get_pv_entry(pmap, lockp);
+		pv->pv_va = va;
+		CHANGE_PV_LIST_LOCK_TO_PHYS(lockp, PTE_TO_PHYS(new_l2));
+		pvh = pa_to_pvh(PTE_TO_PHYS(new_l2));
+		TAILQ_INSERT_TAIL(&pvh->pv_list, pv, pv_next);
+		pvh->pv_gen++;
+		if ((new_l2 & PTE_W) != 0)
+			for (mt = m; mt < &m[Ln_ENTRIES]; mt++)
+				vm_page_aflag_set(mt, PGA_WRITEABLE);
+	}
+
+	/*
+	 * Increment counters.
+	 */
+	if ((new_l2 & PTE_SW_WIRED) != 0)
+		pmap->pm_stats.wired_count += L2_SIZE / PAGE_SIZE;
+	pmap_resident_count_inc(pmap, L2_SIZE / PAGE_SIZE);
+
+	/*
+	 * Map the superpage.
+	 */
+	pmap_load_store(l2, new_l2);
+	PTE_SYNC(l2);
+	pmap_invalidate_page(pmap, va);
+	if (pmap == &curproc->p_vmspace->vm_pmap)
+		cpu_icache_sync_range(va, L2_SIZE);
+
+	atomic_add_long(&pmap_l2_mappings, 1);
+	CTR2(KTR_PMAP, "pmap_enter_l2: success for va %#lx in pmap %p",
+	    va, pmap);
+
 	return (KERN_SUCCESS);
 }
 
@@ -2372,6 +3793,8 @@ pmap_enter_quick_locked(pmap_t pmap, vm_offset_t va, vm_page_t m,
 			 * attempt fails, we don't retry.  Instead, we give up.
 			 */
 			if (l2 != NULL && pmap_load(l2) != 0) {
+				if ((pmap_load(l2) & PTE_RX) != 0)
+					return (NULL);
 				phys = PTE_TO_PHYS(pmap_load(l2));
 				mpte = PHYS_TO_VM_PAGE(phys);
 				mpte->wire_count++;
@@ -2427,6 +3850,7 @@ pmap_enter_quick_locked(pmap_t pmap, vm_offset_t va, vm_page_t m,
 
 	entry = (PTE_V | PTE_R);
 	entry |= (pn << PTE_PPN0_S);
+	entry |= pmap_memattr_bits(m->md.pv_memattr);
 
 	/*
 	 * Now validate mapping with RO protection
@@ -2437,6 +3861,22 @@ pmap_enter_quick_locked(pmap_t pmap, vm_offset_t va, vm_page_t m,
 
 	PTE_SYNC(l3);
 	pmap_invalidate_page(pmap, va);
+
+#if VM_NRESERVLEVEL > 0
+	/*
+	 * If both the page table page and the reservation are fully
+	 * populated, then attempt promotion.  The page table page is no
+	 * longer a valid hint for the caller if this succeeds.
+	 */
+	if (mpte != NULL && mpte->wire_count == Ln_ENTRIES &&
+	    pmap_ps_enabled(pmap) &&
+	    (m->flags & PG_FICTITIOUS) == 0 &&
+	    vm_reserv_level_iffullpop(m) == 0) {
+		pmap_promote_l2(pmap, pmap_l2(pmap, va), va, lockp);
+		mpte = NULL;
+	}
+#endif
+
 	return (mpte);
 }
 
@@ -2468,11 +3908,12 @@ void
 pmap_unwire(pmap_t pmap, vm_offset_t sva, vm_offset_t eva)
 {
 	vm_offset_t va_next;
-	pd_entry_t *l1, *l2;
+	pd_entry_t *l1, *l2, l2e;
 	pt_entry_t *l3;
 	boolean_t pv_lists_locked;
 
 	pv_lists_locked = FALSE;
+resume:
 	PMAP_LOCK(pmap);
 	for (; sva < eva; sva = va_next) {
 		l1 = pmap_l1(pmap, sva);
@@ -2488,8 +3929,36 @@ pmap_unwire(pmap_t pmap, vm_offset_t sva, vm_offset_t eva)
 			va_next = eva;
 
 		l2 = pmap_l1_to_l2(l1, sva);
-		if (pmap_load(l2) == 0)
+		if ((l2e = pmap_load(l2)) == 0)
 			continue;
+		if ((l2e & PTE_RX) != 0) {
+			if ((l2e & PTE_SW_WIRED) == 0)
+				panic("pmap_unwire: l2 %#jx is missing "
+				    "PTE_SW_WIRED", (uintmax_t)l2e);
+
+			/*
+			 * Are we unwiring the entire superpage?  If not,
+			 * demote the mapping and fall through.
+			 */
+			if (sva + L2_SIZE == va_next && eva >= va_next) {
+				atomic_clear_long(l2, PTE_SW_WIRED);
+				pmap->pm_stats.wired_count -= L2_SIZE /
+				    PAGE_SIZE;
+				continue;
+			} else {
+				if (!pv_lists_locked) {
+					pv_lists_locked = TRUE;
+					if (!rw_try_rlock(&pvh_global_lock)) {
+						PMAP_UNLOCK(pmap);
+						rw_rlock(&pvh_global_lock);
+						/* Repeat sva. */
+						goto resume;
+					}
+				}
+				if (pmap_demote_l2(pmap, l2, sva) == NULL)
+					panic("pmap_unwire: demotion failed");
+			}
+		}
 
 		if (va_next > eva)
 			va_next = eva;
@@ -2527,7 +3996,117 @@ void
 pmap_copy(pmap_t dst_pmap, pmap_t src_pmap, vm_offset_t dst_addr, vm_size_t len,
     vm_offset_t src_addr)
 {
+	struct rwlock *lock;
+	struct spglist free;
+	pd_entry_t *l1, *l2, srcl2;
+	pt_entry_t *dst_l3, *src_l3, ptetemp;
+	vm_offset_t addr, end_addr, va_next;
+	vm_page_t dst_l3m, srcmpte;
+
+	if (dst_addr != src_addr)
+		return;
+	end_addr = src_addr + len;
+	lock = NULL;
+	rw_rlock(&pvh_global_lock);
+	if (dst_pmap < src_pmap) {
+		PMAP_LOCK(dst_pmap);
+		PMAP_LOCK(src_pmap);
+	} else {
+		PMAP_LOCK(src_pmap);
+		PMAP_LOCK(dst_pmap);
+	}
+	for (addr = src_addr; addr < end_addr; addr = va_next) {
+		KASSERT(addr < VM_MAXUSER_ADDRESS,
+		    ("pmap_copy: invalid to pmap_copy page tables"));
+
+		l1 = pmap_l1(src_pmap, addr);
+		if (pmap_load(l1) == 0) {
+			va_next = (addr + L1_SIZE) & ~L1_OFFSET;
+			if (va_next < addr)
+				va_next = end_addr;
+			continue;
+		}
+
+		va_next = (addr + L2_SIZE) & ~L2_OFFSET;
+		if (va_next < addr)
+			va_next = end_addr;
+
+		l2 = pmap_l1_to_l2(l1, addr);
+		srcl2 = pmap_load(l2);
+		if (srcl2 == 0)
+			continue;
+
+		/*
+		 * Superpage mappings are not copied.  The child recreates
+		 * them through faults and promotion.
+		 */
+		if ((srcl2 & PTE_RX) != 0)
+			continue;
+
+		srcmpte = PHYS_TO_VM_PAGE(PTE_TO_PHYS(srcl2));
+		KASSERT(srcmpte->wire_count > 0,
+		    ("pmap_copy: source page table page is unused"));
+		if (va_next > end_addr)
+			va_next = end_addr;
 
+		/* Leave alone any destination superpage. */
+		l2 = pmap_l2(dst_pmap, addr);
+		if (l2 != NULL && (pmap_load(l2) & PTE_RX) != 0)
+			continue;
+
+		src_l3 = (pt_entry_t *)PHYS_TO_DMAP(PTE_TO_PHYS(srcl2));
+		src_l3 = &src_l3[pmap_l3_index(addr)];
+		dst_l3m = NULL;
+		for (; addr < va_next; addr += PAGE_SIZE, src_l3++) {
+			ptetemp = pmap_load(src_l3);
+
+			/*
+			 * We only virtual copy managed pages.
+			 */
+			if ((ptetemp & PTE_SW_MANAGED) == 0)
+				continue;
+
+			if (dst_l3m != NULL) {
+				dst_l3m->wire_count++;
+			} else if ((dst_l3m = pmap_alloc_l3(dst_pmap, addr,
+			    NULL)) == NULL)
+				goto out;
+			dst_l3 = (pt_entry_t *)
+			    PHYS_TO_DMAP(VM_PAGE_TO_PHYS(dst_l3m));
+			dst_l3 = &dst_l3[pmap_l3_index(addr)];
+			if (pmap_load(dst_l3) == 0 &&
+			    pmap_try_insert_pv_entry(dst_pmap, addr,
+			    PHYS_TO_VM_PAGE(PTE_TO_PHYS(ptetemp)), &lock)) {
+				/*
+				 * Clear the wired, modified, and accessed
+				 * bits during the copy.  The parent's
+				 * mapping still holds the modified state,
+				 * and the child's first access sets them
+				 * again through pmap_fault_fixup().
+				 */
+				pmap_load_store(dst_l3, ptetemp &
+				    ~(PTE_SW_WIRED | PTE_D | PTE_A));
+				PTE_SYNC(dst_l3);
+				pmap_resident_count_inc(dst_pmap, 1);
+			} else {
+				SLIST_INIT(&free);
+				if (pmap_unwire_l3(dst_pmap, addr, dst_l3m,
+				    &free))
+					vm_page_free_pages_toq(&free, true);
+				goto out;
+			}
+
+			/* Have we copied all of the valid mappings? */
+			if (dst_l3m->wire_count >= srcmpte->wire_count)
+				break;
+		}
+	}
+out:
+	if (lock != NULL)
+		rw_wunlock(lock);
+	rw_runlock(&pvh_global_lock);
+	PMAP_UNLOCK(src_pmap);
+	PMAP_UNLOCK(dst_pmap);
 }
 
 /*
@@ -2615,13 +4194,44 @@ pmap_copy_pages(vm_page_t ma[], vm_offset_t a_offset, vm_page_t mb[],
 vm_offset_t
 pmap_quick_enter_page(vm_page_t m)
 {
+	pt_entry_t entry, *l3;
+	vm_offset_t qaddr;
+	vm_paddr_t pa;
+
+	pa = VM_PAGE_TO_PHYS(m);
+	if (PHYS_IN_DMAP(pa))
+		return (PHYS_TO_DMAP(pa));
 
-	return (PHYS_TO_DMAP(VM_PAGE_TO_PHYS(m)));
+	/*
+	 * The mapping is private to this CPU until pmap_quick_remove_page(),
+	 * so only the local TLB needs to be invalidated.
+	 */
+	critical_enter();
+	qaddr = qmap_base + PCPU_GET(cpuid) * PAGE_SIZE;
+	l3 = pmap_l3(kernel_pmap, qaddr);
+	KASSERT(pmap_load(l3) == 0, ("pmap_quick_enter_page: PTE busy"));
+	entry = PTE_KERN | pmap_memattr_bits(m->md.pv_memattr);
+	entry |= ((pa / PAGE_SIZE) << PTE_PPN0_S);
+	pmap_load_store(l3, entry);
+	PTE_SYNC(l3);
+	pmap_sfence_page(0, qaddr);
+	return (qaddr);
 }
 
 void
 pmap_quick_remove_page(vm_offset_t addr)
 {
+	pt_entry_t *l3;
+
+	if (addr >= DMAP_MIN_ADDRESS && addr < DMAP_MAX_ADDRESS)
+		return;
+	KASSERT(addr == qmap_base + PCPU_GET(cpuid) * PAGE_SIZE,
+	    ("pmap_quick_remove_page: invalid address"));
+	l3 = pmap_l3(kernel_pmap, addr);
+	KASSERT(pmap_load(l3) != 0, ("pmap_quick_remove_page: PTE not in use"));
+	pmap_load_clear(l3);
+	PTE_SYNC(l3);
+	critical_exit();
 }
 
 /*
@@ -2634,6 +4244,7 @@ pmap_quick_remove_page(vm_offset_t addr)
 boolean_t
 pmap_page_exists_quick(pmap_t pmap, vm_page_t m)
 {
+	struct md_page *pvh;
 	struct rwlock *lock;
 	pv_entry_t pv;
 	int loops = 0;
@@ -2654,6 +4265,18 @@ pmap_page_exists_quick(pmap_t pmap, vm_page_t m)
 		if (loops >= 16)
 			break;
 	}
+	if (!rv && loops < 16 && (m->flags & PG_FICTITIOUS) == 0) {
+		pvh = pa_to_pvh(VM_PAGE_TO_PHYS(m));
+		TAILQ_FOREACH(pv, &pvh->pv_list, pv_next) {
+			if (PV_PMAP(pv) == pmap) {
+				rv = TRUE;
+				break;
+			}
+			loops++;
+			if (loops >= 16)
+				break;
+		}
+	}
 	rw_runlock(lock);
 	rw_runlock(&pvh_global_lock);
 	return (rv);
@@ -2668,11 +4291,13 @@ pmap_page_exists_quick(pmap_t pmap, vm_page_t m)
 int
 pmap_page_wired_mappings(vm_page_t m)
 {
+	struct md_page *pvh;
 	struct rwlock *lock;
 	pmap_t pmap;
+	pd_entry_t *l2;
 	pt_entry_t *l3;
 	pv_entry_t pv;
-	int count, md_gen;
+	int count, md_gen, pvh_gen;
 
 	if ((m->oflags & VPO_UNMANAGED) != 0)
 		return (0);
@@ -2698,6 +4323,28 @@ pmap_page_wired_mappings(vm_page_t m)
 			count++;
 		PMAP_UNLOCK(pmap);
 	}
+	if ((m->flags & PG_FICTITIOUS) == 0) {
+		pvh = pa_to_pvh(VM_PAGE_TO_PHYS(m));
+		TAILQ_FOREACH(pv, &pvh->pv_list, pv_next) {
+			pmap = PV_PMAP(pv);
+			if (!PMAP_TRYLOCK(pmap)) {
+				md_gen = m->md.pv_gen;
+				pvh_gen = pvh->pv_gen;
+				rw_runlock(lock);
+				PMAP_LOCK(pmap);
+				rw_rlock(lock);
+				if (md_gen != m->md.pv_gen ||
+				    pvh_gen != pvh->pv_gen) {
+					PMAP_UNLOCK(pmap);
+					goto restart;
+				}
+			}
+			l2 = pmap_l2(pmap, pv->pv_va);
+			if ((pmap_load(l2) & PTE_SW_WIRED) != 0)
+				count++;
+			PMAP_UNLOCK(pmap);
+		}
+	}
 	rw_runlock(lock);
 	rw_runlock(&pvh_global_lock);
 	return (count);
@@ -2725,13 +4372,15 @@ pmap_remove_pages(pmap_t pmap)
 	pd_entry_t ptepde, *l2;
 	pt_entry_t *l3, tl3;
 	struct spglist free;
-	vm_page_t m;
+	struct md_page *pvh;
+	vm_page_t m, ml3, mt;
 	pv_entry_t pv;
 	struct pv_chunk *pc, *npc;
 	struct rwlock *lock;
 	int64_t bit;
 	uint64_t inuse, bitmask;
 	int allfree, field, freed, idx;
+	bool superpage;
 	vm_paddr_t pa;
 
 	lock = NULL;
@@ -2752,8 +4401,16 @@ pmap_remove_pages(pmap_t pmap)
 				inuse &= ~bitmask;
 
 				l2 = pmap_l2(pmap, pv->pv_va);
-				ptepde = pmap_load(l2);
-				l3 = pmap_l2_to_l3(l2, pv->pv_va);
+				superpage = (pmap_load(l2) & PTE_RX) != 0;
+				if (superpage) {
+					/* The pv entry maps a superpage. */
+					ptepde = pmap_load(pmap_l1(pmap,
+					    pv->pv_va));
+					l3 = l2;
+				} else {
+					ptepde = pmap_load(l2);
+					l3 = pmap_l2_to_l3(l2, pv->pv_va);
+				}
 				tl3 = pmap_load(l3);
 
 /*
@@ -2781,22 +4438,64 @@ pmap_remove_pages(pmap_t pmap)
 					cpu_dcache_wb_range(pv->pv_va, L3_SIZE);
 				pmap_load_clear(l3);
 				PTE_SYNC(l3);
-				pmap_invalidate_page(pmap, pv->pv_va);
 
 				/*
 				 * Update the vm_page_t clean/reference bits.
 				 */
-				if (pmap_page_dirty(tl3))
-					vm_page_dirty(m);
+				if (pmap_page_dirty(tl3)) {
+					if (superpage) {
+						for (mt = m;
+						    mt < &m[L2_SIZE / PAGE_SIZE];
+						    mt++)
+							vm_page_dirty(mt);
+					} else
+						vm_page_dirty(m);
+				}
 
 				CHANGE_PV_LIST_LOCK_TO_VM_PAGE(&lock, m);
 
 				/* Mark free */
 				pc->pc_map[field] |= bitmask;
 
-				pmap_resident_count_dec(pmap, 1);
-				TAILQ_REMOVE(&m->md.pv_list, pv, pv_next);
-				m->md.pv_gen++;
+				if (superpage) {
+					pmap_resident_count_dec(pmap,
+					    L2_SIZE / PAGE_SIZE);
+					pvh = pa_to_pvh(pa);
+					TAILQ_REMOVE(&pvh->pv_list, pv,
+					    pv_next);
+					pvh->pv_gen++;
+					if (TAILQ_EMPTY(&pvh->pv_list)) {
+						for (mt = m;
+						    mt < &m[L2_SIZE / PAGE_SIZE];
+						    mt++)
+							if ((mt->aflags &
+							    PGA_WRITEABLE) != 0 &&
+							    TAILQ_EMPTY(
+							    &mt->md.pv_list))
+								vm_page_aflag_clear(
+								    mt,
+								    PGA_WRITEABLE);
+					}
+					ml3 = pmap_remove_pt_page(pmap,
+					    pv->pv_va);
+					if (ml3 != NULL) {
+						pmap_resident_count_dec(pmap,
+						    1);
+						KASSERT(ml3->wire_count ==
+						    Ln_ENTRIES,
+						    ("pmap_remove_pages: l3 "
+						    "page wire count error"));
+						ml3->wire_count = 1;
+						vm_page_unwire_noq(ml3);
+						pmap_add_delayed_free_list(ml3,
+						    &free, FALSE);
+					}
+				} else {
+					pmap_resident_count_dec(pmap, 1);
+					TAILQ_REMOVE(&m->md.pv_list, pv,
+					    pv_next);
+					m->md.pv_gen++;
+				}
 
 				pmap_unuse_l3(pmap, pv->pv_va, ptepde, &free);
 				freed++;
@@ -2819,20 +4518,31 @@ pmap_remove_pages(pmap_t pmap)
 }
 
 /*
- * This is used to check if a page has been accessed or modified. As we
- * don't have a bit to see if it has been modified we have to assume it
- * has been if the page is read/write.
+ * This is used to check if a page has been accessed or modified.
  */
 static boolean_t
 pmap_page_test_mappings(vm_page_t m, boolean_t accessed, boolean_t modified)
 {
+	struct md_page *pvh;
 	struct rwlock *lock;
 	pv_entry_t pv;
+	pd_entry_t *l2;
 	pt_entry_t *l3, mask, value;
 	pmap_t pmap;
-	int md_gen;
+	int md_gen, pvh_gen;
 	boolean_t rv;
 
+	mask = 0;
+	value = 0;
+	if (modified) {
+		mask |= PTE_D;
+		value |= PTE_D;
+	}
+	if (accessed) {
+		mask |= PTE_A;
+		value |= PTE_A;
+	}
+
 	rv = FALSE;
 	rw_rlock(&pvh_global_lock);
 	lock = VM_PAGE_TO_PV_LIST_LOCK(m);
@@ -2851,33 +4561,34 @@ pmap_page_test_mappings(vm_page_t m, boolean_t accessed, boolean_t modified)
 			}
 		}
 		l3 = pmap_l3(pmap, pv->pv_va);
-		mask = 0;
-		value = 0;
-		if (modified) {
-			mask |= PTE_D;
-			value |= PTE_D;
-		}
-		if (accessed) {
-			mask |= PTE_A;
-			value |= PTE_A;
-		}
-
-#if 0
-		if (modified) {
-			mask |= ATTR_AP_RW_BIT;
-			value |= ATTR_AP(ATTR_AP_RW);
-		}
-		if (accessed) {
-			mask |= ATTR_AF | ATTR_DESCR_MASK;
-			value |= ATTR_AF | L3_PAGE;
-		}
-#endif
-
 		rv = (pmap_load(l3) & mask) == value;
 		PMAP_UNLOCK(pmap);
 		if (rv)
 			goto out;
 	}
+	if ((m->flags & PG_FICTITIOUS) == 0) {
+		pvh = pa_to_pvh(VM_PAGE_TO_PHYS(m));
+		TAILQ_FOREACH(pv, &pvh->pv_list, pv_next) {
+			pmap = PV_PMAP(pv);
+			if (!PMAP_TRYLOCK(pmap)) {
+				md_gen = m->md.pv_gen;
+				pvh_gen = pvh->pv_gen;
+				rw_runlock(lock);
+				PMAP_LOCK(pmap);
+				rw_rlock(lock);
+				if (md_gen != m->md.pv_gen ||
+				    pvh_gen != pvh->pv_gen) {
+					PMAP_UNLOCK(pmap);
+					goto restart;
+				}
+			}
+			l2 = pmap_l2(pmap, pv->pv_va);
+			rv = (pmap_load(l2) & mask) == value;
+			PMAP_UNLOCK(pmap);
+			if (rv)
+				goto out;
+		}
+	}
 out:
 	rw_runlock(lock);
 	rw_runlock(&pvh_global_lock);
@@ -2951,12 +4662,15 @@ pmap_is_referenced(vm_page_t m)
 void
 pmap_remove_write(vm_page_t m)
 {
+	struct md_page *pvh;
 	pmap_t pmap;
 	struct rwlock *lock;
-	pv_entry_t pv;
+	pv_entry_t next_pv, pv;
+	pd_entry_t *l2;
 	pt_entry_t *l3, oldl3;
 	pt_entry_t newl3;
-	int md_gen;
+	vm_offset_t va;
+	int md_gen, pvh_gen;
 
 	KASSERT((m->oflags & VPO_UNMANAGED) == 0,
 	    ("pmap_remove_write: page %p is not managed", m));
@@ -2971,16 +4685,42 @@ pmap_remove_write(vm_page_t m)
 		return;
 	rw_rlock(&pvh_global_lock);
 	lock = VM_PAGE_TO_PV_LIST_LOCK(m);
+	pvh = (m->flags & PG_FICTITIOUS) != 0 ? &pv_dummy :
+	    pa_to_pvh(VM_PAGE_TO_PHYS(m));
 retry_pv_loop:
 	rw_wlock(lock);
+	TAILQ_FOREACH_SAFE(pv, &pvh->pv_list, pv_next, next_pv) {
+		pmap = PV_PMAP(pv);
+		if (!PMAP_TRYLOCK(pmap)) {
+			pvh_gen = pvh->pv_gen;
+			rw_wunlock(lock);
+			PMAP_LOCK(pmap);
+			rw_wlock(lock);
+			if (pvh_gen != pvh->pv_gen) {
+				PMAP_UNLOCK(pmap);
+				rw_wunlock(lock);
+				goto retry_pv_loop;
+			}
+		}
+		va = pv->pv_va;
+		l2 = pmap_l2(pmap, va);
+		if (pmap_is_write(pmap_load(l2)))
+			(void)pmap_demote_l2_locked(pmap, l2, va, &lock);
+		KASSERT(lock == VM_PAGE_TO_PV_LIST_LOCK(m),
+		    ("inconsistent pv lock %p %p for page %p",
+		    lock, VM_PAGE_TO_PV_LIST_LOCK(m), m));
+		PMAP_UNLOCK(pmap);
+	}
 	TAILQ_FOREACH(pv, &m->md.pv_list, pv_next) {
 		pmap = PV_PMAP(pv);
 		if (!PMAP_TRYLOCK(pmap)) {
+			pvh_gen = pvh->pv_gen;
 			md_gen = m->md.pv_gen;
 			rw_wunlock(lock);
 			PMAP_LOCK(pmap);
 			rw_wlock(lock);
-			if (md_gen != m->md.pv_gen) {
+			if (pvh_gen != pvh->pv_gen ||
+			    md_gen != m->md.pv_gen) {
 				PMAP_UNLOCK(pmap);
 				rw_wunlock(lock);
 				goto retry_pv_loop;
@@ -2991,11 +4731,10 @@ pmap_remove_write(vm_page_t m)
 		oldl3 = pmap_load(l3);
 
 		if (pmap_is_write(oldl3)) {
-			newl3 = oldl3 & ~(PTE_W);
+			newl3 = oldl3 & ~(PTE_W | PTE_D);
 			if (!atomic_cmpset_long(l3, oldl3, newl3))
 				goto retry;
-			/* TODO: use pmap_page_dirty(oldl3) ? */
-			if ((oldl3 & PTE_A) != 0)
+			if (pmap_page_dirty(oldl3))
 				vm_page_dirty(m);
 			pmap_invalidate_page(pmap, pv->pv_va);
 		}
@@ -3006,13 +4745,6 @@ pmap_remove_write(vm_page_t m)
 	rw_runlock(&pvh_global_lock);
 }
 
-static __inline boolean_t
-safe_to_clear_referenced(pmap_t pmap, pt_entry_t pte)
-{
-
-	return (FALSE);
-}
-
 /*
  *	pmap_ts_referenced:
  *
@@ -3032,25 +4764,87 @@ safe_to_clear_referenced(pmap_t pmap, pt_entry_t pte)
 int
 pmap_ts_referenced(vm_page_t m)
 {
+	struct md_page *pvh;
 	pv_entry_t pv, pvf;
 	pmap_t pmap;
 	struct rwlock *lock;
-	pd_entry_t *l2;
+	pd_entry_t *l2, l2e;
 	pt_entry_t *l3, old_l3;
+	vm_offset_t va;
 	vm_paddr_t pa;
-	int cleared, md_gen, not_cleared;
-	struct spglist free;
+	int cleared, md_gen, not_cleared, pvh_gen;
 
 	KASSERT((m->oflags & VPO_UNMANAGED) == 0,
 	    ("pmap_ts_referenced: page %p is not managed", m));
-	SLIST_INIT(&free);
 	cleared = 0;
 	pa = VM_PAGE_TO_PHYS(m);
 	lock = PHYS_TO_PV_LIST_LOCK(pa);
+	pvh = (m->flags & PG_FICTITIOUS) != 0 ? &pv_dummy : pa_to_pvh(pa);
 	rw_rlock(&pvh_global_lock);
 	rw_wlock(lock);
 retry:
 	not_cleared = 0;
+	if ((pvf = TAILQ_FIRST(&pvh->pv_list)) == NULL)
+		goto small_mappings;
+	pv = pvf;
+	do {
+		if (pvf == NULL)
+			pvf = pv;
+		pmap = PV_PMAP(pv);
+		if (!PMAP_TRYLOCK(pmap)) {
+			pvh_gen = pvh->pv_gen;
+			rw_wunlock(lock);
+			PMAP_LOCK(pmap);
+			rw_wlock(lock);
+			if (pvh_gen != pvh->pv_gen) {
+				PMAP_UNLOCK(pmap);
+				goto retry;
+			}
+		}
+		va = pv->pv_va;
+		l2 = pmap_l2(pmap, va);
+		l2e = pmap_load(l2);
+		if (pmap_page_dirty(l2e))
+			vm_page_dirty(m);
+		if ((l2e & PTE_A) != 0) {
+			/*
+			 * Since this reference bit is shared by 512 4KB
+			 * pages, it should not be cleared every time it is
+			 * tested.  Apply a simple "hash" function on the
+			 * physical page number, the virtual superpage number,
+			 * and the pmap address to select one 4KB page out of
+			 * the 512 on which testing the reference bit will
+			 * result in clearing that reference bit.  This
+			 * function is designed to avoid the selection of the
+			 * same 4KB page for every 2MB page mapping.
+			 *
+			 * On demotion, a mapping that hasn't been referenced
+			 * is simply destroyed.  To avoid the possibility of a
+			 * subsequent page fault on a demoted wired mapping,
+			 * always leave its reference bit set.  Moreover,
+			 * since the superpage is wired, the current state of
+			 * its reference bit won't affect page replacement.
+			 */
+			if ((((pa >> PAGE_SHIFT) ^ (va >> L2_SHIFT) ^
+			    (uintptr_t)pmap) & (Ln_ENTRIES - 1)) == 0 &&
+			    (l2e & PTE_SW_WIRED) == 0) {
+				pmap_clear_bits(l2, PTE_A);
+				pmap_invalidate_page(pmap, va);
+				cleared++;
+			} else
+				not_cleared++;
+		}
+		PMAP_UNLOCK(pmap);
+		/* Rotate the PV list if it has more than one entry. */
+		if (pv != NULL && TAILQ_NEXT(pv, pv_next) != NULL) {
+			TAILQ_REMOVE(&pvh->pv_list, pv, pv_next);
+			TAILQ_INSERT_TAIL(&pvh->pv_list, pv, pv_next);
+			pvh->pv_gen++;
+		}
+		if (cleared + not_cleared >= PMAP_TS_REFERENCED_MAX)
+			goto out;
+	} while ((pv = TAILQ_FIRST(&pvh->pv_list)) != pvf);
+small_mappings:
 	if ((pvf = TAILQ_FIRST(&m->md.pv_list)) == NULL)
 		goto out;
 	pv = pvf;
@@ -3059,11 +4853,13 @@ pmap_ts_referenced(vm_page_t m)
 			pvf = pv;
 		pmap = PV_PMAP(pv);
 		if (!PMAP_TRYLOCK(pmap)) {
+			pvh_gen = pvh->pv_gen;
 			md_gen = m->md.pv_gen;
 			rw_wunlock(lock);
 			PMAP_LOCK(pmap);
 			rw_wlock(lock);
-			if (md_gen != m->md.pv_gen) {
+			if (pvh_gen != pvh->pv_gen ||
+			    md_gen != m->md.pv_gen) {
 				PMAP_UNLOCK(pmap);
 				goto retry;
 			}
@@ -3078,32 +4874,14 @@ pmap_ts_referenced(vm_page_t m)
 		if (pmap_page_dirty(old_l3))
 			vm_page_dirty(m);
 		if ((old_l3 & PTE_A) != 0) {
-			if (safe_to_clear_referenced(pmap, old_l3)) {
-				/*
-				 * TODO: We don't handle the access flag
-				 * at all. We need to be able to set it in
-				 * the exception handler.
-				 */
-				panic("RISCVTODO: safe_to_clear_referenced\n");
-			} else if ((old_l3 & PTE_SW_WIRED) == 0) {
-				/*
-				 * Wired pages cannot be paged out so
-				 * doing accessed bit emulation for
-				 * them is wasted effort. We do the
-				 * hard work for unwired pages only.
-				 */
-				pmap_remove_l3(pmap, l3, pv->pv_va,
-				    pmap_load(l2), &free, &lock);
-				pmap_invalidate_page(pmap, pv->pv_va);
-				cleared++;
-				if (pvf == pv)
-					pvf = NULL;
-				pv = NULL;
-				KASSERT(lock == VM_PAGE_TO_PV_LIST_LOCK(m),
-				    ("inconsistent pv lock %p %p for page %p",
-				    lock, VM_PAGE_TO_PV_LIST_LOCK(m), m));
-			} else
-				not_cleared++;
+			/*
+			 * A later access either has the hardware set PTE_A
+			 * again or faults, in which case pmap_fault_fixup()
+			 * sets it.  Either way the mapping survives.
+			 */
+			pmap_clear_bits(l3, PTE_A);
+			pmap_invalidate_page(pmap, pv->pv_va);
+			cleared++;
 		}
 		PMAP_UNLOCK(pmap);
 		/* Rotate the PV list if it has more than one entry. */
@@ -3117,7 +4895,6 @@ pmap_ts_referenced(vm_page_t m)
 out:
 	rw_wunlock(lock);
 	rw_runlock(&pvh_global_lock);
-	vm_page_free_pages_toq(&free, false);
 	return (cleared + not_cleared);
 }
 
@@ -3137,6 +4914,14 @@ pmap_advise(pmap_t pmap, vm_offset_t sva, vm_offset_t eva, int advice)
 void
 pmap_clear_modify(vm_page_t m)
 {
+	struct md_page *pvh;
+	struct rwlock *lock;
+	pmap_t pmap;
+	pv_entry_t next_pv, pv;
+	pd_entry_t *l2, oldl2;
+	pt_entry_t *l3;
+	vm_offset_t va;
+	int md_gen, pvh_gen;
 
 	KASSERT((m->oflags & VPO_UNMANAGED) == 0,
 	    ("pmap_clear_modify: page %p is not managed", m));
@@ -3151,8 +4936,72 @@ pmap_clear_modify(vm_page_t m)
 	 */
 	if ((m->aflags & PGA_WRITEABLE) == 0)
 		return;
-
-	/* RISCVTODO: We lack support for tracking if a page is modified */
+	pvh = (m->flags & PG_FICTITIOUS) != 0 ? &pv_dummy :
+	    pa_to_pvh(VM_PAGE_TO_PHYS(m));
+	lock = VM_PAGE_TO_PV_LIST_LOCK(m);
+	rw_rlock(&pvh_global_lock);
+	rw_wlock(lock);
+restart:
+	TAILQ_FOREACH_SAFE(pv, &pvh->pv_list, pv_next, next_pv) {
+		pmap = PV_PMAP(pv);
+		if (!PMAP_TRYLOCK(pmap)) {
+			pvh_gen = pvh->pv_gen;
+			rw_wunlock(lock);
+			PMAP_LOCK(pmap);
+			rw_wlock(lock);
+			if (pvh_gen != pvh->pv_gen) {
+				PMAP_UNLOCK(pmap);
+				goto restart;
+			}
+		}
+		va = pv->pv_va;
+		l2 = pmap_l2(pmap, va);
+		oldl2 = pmap_load(l2);
+		if (pmap_page_dirty(oldl2) &&
+		    pmap_demote_l2_locked(pmap, l2, va, &lock) != NULL &&
+		    (oldl2 & PTE_SW_WIRED) == 0) {
+			/*
+			 * Write protect the mapping to a single page so that
+			 * a subsequent write access may repromote.
+			 */
+			va += VM_PAGE_TO_PHYS(m) - PTE_TO_PHYS(oldl2);
+			l3 = pmap_l2_to_l3(l2, va);
+			pmap_clear_bits(l3, PTE_D | PTE_W);
+			vm_page_dirty(m);
+			pmap_invalidate_page(pmap, va);
+		}
+		PMAP_UNLOCK(pmap);
+	}
+	TAILQ_FOREACH(pv, &m->md.pv_list, pv_next) {
+		pmap = PV_PMAP(pv);
+		if (!PMAP_TRYLOCK(pmap)) {
+			md_gen = m->md.pv_gen;
+			pvh_gen = pvh->pv_gen;
+			rw_wunlock(lock);
+			PMAP_LOCK(pmap);
+			rw_wlock(lock);
+			if (pvh_gen != pvh->pv_gen || md_gen != m->md.pv_gen) {
+				PMAP_UNLOCK(pmap);
+				goto restart;
+			}
+		}
+		l2 = pmap_l2(pmap, pv->pv_va);
+		KASSERT((pmap_load(l2) & PTE_RX) == 0,
+		    ("pmap_clear_modify: found a 2mpage in page %p's pv list",
+		    m));
+		l3 = pmap_l2_to_l3(l2, pv->pv_va);
+		if (pmap_page_dirty(pmap_load(l3))) {
+			/*
+			 * The next write either has the hardware set PTE_D
+			 * again or faults into pmap_fault_fixup().
+			 */
+			pmap_clear_bits(l3, PTE_D);
+			pmap_invalidate_page(pmap, pv->pv_va);
+		}
+		PMAP_UNLOCK(pmap);
+	}
+	rw_wunlock(lock);
+	rw_runlock(&pvh_global_lock);
 }
 
 void *
@@ -3177,14 +5026,174 @@ pmap_page_set_memattr(vm_page_t m, vm_memattr_t ma)
 	m->md.pv_memattr = ma;
 
 	/*
-	 * RISCVTODO: Implement the below (from the amd64 pmap)
 	 * If "m" is a normal page, update its direct mapping.  This update
 	 * can be relied upon to perform any cache operations that are
 	 * required for data coherence.
 	 */
 	if ((m->flags & PG_FICTITIOUS) == 0 &&
-	    PHYS_IN_DMAP(VM_PAGE_TO_PHYS(m)))
-		panic("RISCVTODO: pmap_page_set_memattr");
+	    PHYS_IN_DMAP(VM_PAGE_TO_PHYS(m)) &&
+	    pmap_change_attr(PHYS_TO_DMAP(VM_PAGE_TO_PHYS(m)), PAGE_SIZE,
+	    m->md.pv_memattr) != 0)
+		panic("memory attribute change on the direct map failed");
+}
+
+/*
+ * Changes the specified virtual address range's memory type to that given
+ * by the parameter "mode".  The specified virtual address range must be
+ * completely contained within the kernel map.
+ *
+ * Returns zero if the change completed successfully, and either EINVAL or
+ * ENOMEM if the change failed.  Specifically, EINVAL is returned if some
+ * part of the virtual address range was not mapped, and ENOMEM is returned
+ * if there was insufficient memory available to complete the change.  In
+ * the latter case, the memory type may have been changed on some part of
+ * the virtual address range.
+ */
+int
+pmap_change_attr(vm_offset_t va, vm_size_t size, int mode)
+{
+	int error;
+
+	rw_rlock(&pvh_global_lock);
+	PMAP_LOCK(kernel_pmap);
+	error = pmap_change_attr_locked(va, size, mode);
+	PMAP_UNLOCK(kernel_pmap);
+	rw_runlock(&pvh_global_lock);
+	return (error);
+}
+
+static int
+pmap_change_attr_locked(vm_offset_t va, vm_size_t size, int mode)
+{
+	vm_offset_t base, offset, tmpva;
+	pd_entry_t *l1, *l2;
+	pt_entry_t bits, *l3, pte;
+
+	PMAP_LOCK_ASSERT(kernel_pmap, MA_OWNED);
+	base = trunc_page(va);
+	offset = va & PAGE_MASK;
+	size = round_page(offset + size);
+
+	if (!(base >= DMAP_MIN_ADDRESS && base < DMAP_MAX_ADDRESS) &&
+	    !(base >= VM_MIN_KERNEL_ADDRESS && base < VM_MAX_KERNEL_ADDRESS))
+		return (EINVAL);
+
+	/*
+	 * Without Svpbmt every mapping uses the memory type given by the
+	 * platform's physical memory attributes, and there is nothing to do.
+	 */
+	if (!pmap_has_svpbmt)
+		return (0);
+	bits = pmap_memattr_bits(mode);
+
+	/*
+	 * Pages that aren't mapped aren't supported.  Also break down 1GB
+	 * and 2MB pages into smaller pages if required.
+	 */
+	for (tmpva = base; tmpva < base + size; ) {
+		l1 = pmap_l1(kernel_pmap, tmpva);
+		pte = pmap_load(l1);
+		if ((pte & PTE_V) == 0)
+			return (EINVAL);
+		if ((pte & PTE_RX) != 0) {
+			/*
+			 * If the current 1GB page already has the required
+			 * memory type, then we need not demote this page.
+			 * Just increment tmpva to the next 1GB page frame.
+			 */
+			if ((pte & PTE_MA_MASK) == bits) {
+				tmpva = (tmpva & ~L1_OFFSET) + L1_SIZE;
+				continue;
+			}
+
+			/*
+			 * If the current offset aligns with a 1GB page frame
+			 * and there is at least 1GB left within the range,
+			 * then we need not break down this page into 2MB
+			 * pages.
+			 */
+			if ((tmpva & L1_OFFSET) == 0 &&
+			    tmpva + L1_OFFSET < base + size) {
+				tmpva += L1_SIZE;
+				continue;
+			}
+			if (!pmap_demote_l1(kernel_pmap, l1, tmpva))
+				return (ENOMEM);
+		}
+		l2 = pmap_l1_to_l2(l1, tmpva);
+		pte = pmap_load(l2);
+		if ((pte & PTE_V) == 0)
+			return (EINVAL);
+		if ((pte & PTE_RX) != 0) {
+			/*
+			 * If the current 2MB page already has the required
+			 * memory type, then we need not demote this page.
+			 * Just increment tmpva to the next 2MB page frame.
+			 */
+			if ((pte & PTE_MA_MASK) == bits) {
+				tmpva = (tmpva & ~L2_OFFSET) + L2_SIZE;
+				continue;
+			}
+
+			/*
+			 * If the current offset aligns with a 2MB page frame
+			 * and there is at least 2MB left within the range,
+			 * then we need not break down this page into 4KB
+			 * pages.
+			 */
+			if ((tmpva & L2_OFFSET) == 0 &&
+			    tmpva + L2_OFFSET < base + size) {
+				tmpva += L2_SIZE;
+				continue;
+			}
+			if (pmap_demote_l2_locked(kernel_pmap, l2, tmpva,
+			    NULL) == NULL)
+				return (ENOMEM);
+		}
+		l3 = pmap_l2_to_l3(l2, tmpva);
+		if ((pmap_load(l3) & PTE_V) == 0)
+			return (EINVAL);
+		tmpva += PAGE_SIZE;
+	}
+
+	/*
+	 * Ok, all the pages exist, so run through them updating their
+	 * memory type.
+	 */
+	for (tmpva = base; tmpva < base + size; ) {
+		l1 = pmap_l1(kernel_pmap, tmpva);
+		pte = pmap_load(l1);
+		if ((pte & PTE_RX) != 0) {
+			if ((pte & PTE_MA_MASK) != bits) {
+				pte = (pte & ~PTE_MA_MASK) | bits;
+				pmap_load_store(l1, pte);
+				pmap_distribute_l1(kernel_pmap,
+				    pmap_l1_index(tmpva), pte);
+				PTE_SYNC(l1);
+			}
+			tmpva = (tmpva & ~L1_OFFSET) + L1_SIZE;
+			continue;
+		}
+		l2 = pmap_l1_to_l2(l1, tmpva);
+		pte = pmap_load(l2);
+		if ((pte & PTE_RX) != 0) {
+			if ((pte & PTE_MA_MASK) != bits) {
+				pmap_load_store(l2, (pte & ~PTE_MA_MASK) | bits);
+				PTE_SYNC(l2);
+			}
+			tmpva = (tmpva & ~L2_OFFSET) + L2_SIZE;
+			continue;
+		}
+		l3 = pmap_l2_to_l3(l2, tmpva);
+		pte = pmap_load(l3);
+		if ((pte & PTE_MA_MASK) != bits) {
+			pmap_load_store(l3, (pte & ~PTE_MA_MASK) | bits);
+			PTE_SYNC(l3);
+		}
+		tmpva += PAGE_SIZE;
+	}
+	pmap_invalidate_range(kernel_pmap, base, tmpva);
+	return (0);
 }
 
 /*
@@ -3236,34 +5245,129 @@ pmap_mincore(pmap_t pmap, vm_offset_t addr, vm_paddr_t *locked_pa)
 	return (val);
 }
 
+/*
+ * Handle a page fault on a valid mapping that the hardware refused to use
+ * because its PTE_A bit is clear, or because the access is a write and its
+ * PTE_D bit is clear.  Implementations are allowed to leave the update of
+ * these bits to software.  Returns 1 if the access may be retried, and 0 if
+ * the fault must be handled by vm_fault().
+ */
+int
+pmap_fault_fixup(pmap_t pmap, vm_offset_t va, vm_prot_t ftype)
+{
+	pd_entry_t *l2, l2e;
+	pt_entry_t bits, oldpte, *pte;
+	int rv;
+
+	rv = 0;
+	PMAP_LOCK(pmap);
+	l2 = pmap_l2(pmap, va);
+	if (l2 == NULL || ((l2e = pmap_load(l2)) & PTE_V) == 0)
+		goto done;
+	if ((l2e & PTE_RX) != 0)
+		pte = l2;
+	else
+		pte = pmap_l2_to_l3(l2, va);
+	oldpte = pmap_load(pte);
+	if ((oldpte & PTE_V) == 0 ||
+	    ((ftype & VM_PROT_READ) != 0 && (oldpte & PTE_R) == 0) ||
+	    ((ftype & VM_PROT_WRITE) != 0 && (oldpte & PTE_W) == 0) ||
+	    ((ftype & VM_PROT_EXECUTE) != 0 && (oldpte & PTE_X) == 0) ||
+	    (va < VM_MAXUSER_ADDRESS && (oldpte & PTE_U) == 0))
+		goto done;
+
+	bits = PTE_A;
+	if ((ftype & VM_PROT_WRITE) != 0)
+		bits |= PTE_D;
+	if ((oldpte & bits) != bits)
+		pmap_set(pte, bits);
+
+	/*
+	 * Another hart may have set the bits first, leaving only a stale TLB
+	 * entry on this one.  In either case, the other harts fault on their
+	 * own stale entries, so a local fence suffices.
+	 */
+	pmap_sfence_page(ASID_NUM(pmap->pm_asid), va);
+	rv = 1;
+done:
+	PMAP_UNLOCK(pmap);
+	return (rv);
+}
+
 void
 pmap_activate(struct thread *td)
 {
 	pmap_t pmap;
-	uint64_t reg;
 
 	critical_enter();
 	pmap = vmspace_pmap(td->td_proc->p_vmspace);
 	td->td_pcb->pcb_l1addr = vtophys(pmap->pm_l1);
+	pmap_activate_sw(td);
+	critical_exit();
+}
+
+/*
+ * Load the page table and ASID of the given thread's address space into
+ * satp.  Called from cpu_switch() and cpu_throw() before curthread is
+ * updated.
+ */
+void
+pmap_activate_sw(struct thread *td)
+{
+	pmap_t oldpmap, pmap;
+	uint64_t reg;
+	u_long asid, gen;
+	u_int cpuid;
+
+	oldpmap = DPCPU_GET(curpmap);
+	pmap = vmspace_pmap(td->td_proc->p_vmspace);
+	asid = pmap_asid_activate(pmap);
+
+	/*
+	 * Join the new pmap's active set before its page table can be
+	 * walked so that no shootdown misses this hart.  Without ASIDs
+	 * the flush below discards the old pmap's entries, so this hart
+	 * can leave its active set.  The fence also orders the update of
+	 * curpmap before the load of the pmap's icache generation, pairing
+	 * with pmap_sync_icache().
+	 */
+	cpuid = PCPU_GET(cpuid);
+	CPU_SET_ATOMIC(cpuid, &pmap->pm_active);
+	DPCPU_SET(curpmap, pmap);
+	__asm __volatile("fence" ::: "memory");
+	if (asid_bits == 0 && oldpmap != NULL && oldpmap != pmap)
+		CPU_CLR_ATOMIC(cpuid, &oldpmap->pm_active);
 
 	reg = SATP_MODE_SV39;
+	reg |= (asid << SATP_ASID_S);
 	reg |= (td->td_pcb->pcb_l1addr >> PAGE_SHIFT);
 	__asm __volatile("csrw sptbr, %0" :: "r"(reg));
 
-	pmap_invalidate_all(pmap);
-	critical_exit();
-}
-
-static void
-pmap_sync_icache_one(void *arg __unused)
-{
+	/*
+	 * Without ASIDs the TLB cannot tell the old address space from
+	 * the new one.  vmspace0 holds no user mappings, so it needs no
+	 * flush when ASIDs are implemented.
+	 */
+	if (asid_bits == 0)
+		__asm __volatile("sfence.vma" ::: "memory");
 
-	__asm __volatile("fence.i");
+	/*
+	 * Catch up with any pmap_sync_icache() on the new pmap that was
+	 * not delivered to this hart because the pmap was not running here.
+	 */
+	if (pmap->pm_icache_gen > DPCPU_GET(icache_synced)) {
+		gen = atomic_load_acq_long(&icache_gen);
+		__asm __volatile("fence.i" ::: "memory");
+		DPCPU_SET(icache_synced, gen);
+	}
 }
 
 void
 pmap_sync_icache(pmap_t pm, vm_offset_t va, vm_size_t sz)
 {
+	cpuset_t mask;
+	u_long gen;
+	u_int cpu;
 
 	/*
 	 * From the RISC-V User-Level ISA V2.2:
@@ -3273,8 +5377,34 @@ pmap_sync_icache(pmap_t pm, vm_offset_t va, vm_size_t sz)
 	 * before requesting that all remote RISC-V harts execute a
 	 * FENCE.I."
 	 */
-	__asm __volatile("fence");
-	smp_rendezvous(NULL, pmap_sync_icache_one, NULL, NULL);
+	__asm __volatile("fence" ::: "memory");
+
+	sched_pin();
+	gen = atomic_fetchadd_long(&icache_gen, 1) + 1;
+	if (pm == kernel_pmap) {
+		/* Kernel text is executed everywhere. */
+		mask = all_cpus;
+	} else {
+		/*
+		 * Only the harts currently running the pmap are interrupted.
+		 * The others see the new generation when they next switch to
+		 * it, in pmap_activate_sw().  The fence orders the store of
+		 * the generation before the loads of curpmap.
+		 */
+		pm->pm_icache_gen = gen;
+		__asm __volatile("fence" ::: "memory");
+		CPU_ZERO(&mask);
+		CPU_FOREACH(cpu) {
+			if (DPCPU_ID_GET(cpu, curpmap) == pm)
+				CPU_SET(cpu, &mask);
+		}
+	}
+	__asm __volatile("fence.i" ::: "memory");
+	DPCPU_SET(icache_synced, gen);
+	CPU_CLR(PCPU_GET(cpuid), &mask);
+	if (smp_started && !CPU_EMPTY(&mask))
+		sbi_remote_fence_i(mask.__bits);
+	sched_unpin();
 }
 
 /*
@@ -3285,6 +5415,20 @@ void
 pmap_align_superpage(vm_object_t object, vm_ooffset_t offset,
     vm_offset_t *addr, vm_size_t size)
 {
+	vm_offset_t superpage_offset;
+
+	if (size < L2_SIZE)
+		return;
+	if (object != NULL && (object->flags & OBJ_COLORED) != 0)
+		offset += ptoa(object->pg_color);
+	superpage_offset = offset & L2_OFFSET;
+	if (size - ((L2_SIZE - superpage_offset) & L2_OFFSET) < L2_SIZE ||
+	    (*addr & L2_OFFSET) == superpage_offset)
+		return;
+	if ((*addr & L2_OFFSET) < superpage_offset)
+		*addr = (*addr & ~L2_OFFSET) + superpage_offset;
+	else
+		*addr = ((*addr + L2_OFFSET) & ~L2_OFFSET) + superpage_offset;
 }
 
 /**
@@ -3308,6 +5452,7 @@ boolean_t
 pmap_map_io_transient(vm_page_t page[], vm_offset_t vaddr[], int count,
     boolean_t can_fault)
 {
+	pt_entry_t entry, *l3;
 	vm_paddr_t paddr;
 	boolean_t needs_mapping;
 	int error, i;
@@ -3319,7 +5464,7 @@ pmap_map_io_transient(vm_page_t page[], vm_offset_t vaddr[], int count,
 	needs_mapping = FALSE;
 	for (i = 0; i < count; i++) {
 		paddr = VM_PAGE_TO_PHYS(page[i]);
-		if (__predict_false(paddr >= DMAP_MAX_PHYSADDR)) {
+		if (__predict_false(!PHYS_IN_DMAP(paddr))) {
 			error = vmem_alloc(kernel_arena, PAGE_SIZE,
 			    M_BESTFIT | M_WAITOK, &vaddr[i]);
 			KASSERT(error == 0, ("vmem_alloc failed: %d", error));
@@ -3337,9 +5482,24 @@ pmap_map_io_transient(vm_page_t page[], vm_offset_t vaddr[], int count,
 		sched_pin();
 	for (i = 0; i < count; i++) {
 		paddr = VM_PAGE_TO_PHYS(page[i]);
-		if (paddr >= DMAP_MAX_PHYSADDR) {
-			panic(
-			   "pmap_map_io_transient: TODO: Map out of DMAP data");
+		if (!PHYS_IN_DMAP(paddr)) {
+			if (can_fault) {
+				/*
+				 * Slow path, since we can get page faults
+				 * while mappings are active don't pin the
+				 * thread to the CPU and instead add a global
+				 * mapping visible to all CPUs.
+				 */
+				pmap_qenter(vaddr[i], &page[i], 1);
+			} else {
+				l3 = pmap_l3(kernel_pmap, vaddr[i]);
+				entry = PTE_KERN |
+				    pmap_memattr_bits(page[i]->md.pv_memattr);
+				entry |= ((paddr / PAGE_SIZE) << PTE_PPN0_S);
+				pmap_load_store(l3, entry);
+				PTE_SYNC(l3);
+				pmap_sfence_page(0, vaddr[i]);
+			}
 		}
 	}
 
@@ -3350,22 +5510,42 @@ void
 pmap_unmap_io_transient(vm_page_t page[], vm_offset_t vaddr[], int count,
     boolean_t can_fault)
 {
+	pt_entry_t *l3;
 	vm_paddr_t paddr;
 	int i;
 
-	if (!can_fault)
-		sched_unpin();
 	for (i = 0; i < count; i++) {
 		paddr = VM_PAGE_TO_PHYS(page[i]);
-		if (paddr >= DMAP_MAX_PHYSADDR) {
-			panic("RISCVTODO: pmap_unmap_io_transient: Unmap data");
+		if (!PHYS_IN_DMAP(paddr)) {
+			if (can_fault)
+				pmap_qremove(vaddr[i], 1);
+			else {
+				/* The mapping was only used by this CPU. */
+				l3 = pmap_l3(kernel_pmap, vaddr[i]);
+				pmap_load_clear(l3);
+				PTE_SYNC(l3);
+				pmap_sfence_page(0, vaddr[i]);
+			}
+			vmem_free(kernel_arena, vaddr[i], PAGE_SIZE);
 		}
 	}
+	if (!can_fault)
+		sched_unpin();
 }
 
 boolean_t
 pmap_is_valid_memattr(pmap_t pmap __unused, vm_memattr_t mode)
 {
 
-	return (mode >= VM_MEMATTR_DEVICE && mode <= VM_MEMATTR_WRITE_BACK);
+	switch (mode) {
+	case VM_MEMATTR_DEVICE:
+	case VM_MEMATTR_UNCACHEABLE:
+#ifdef VM_MEMATTR_WRITE_COMBINING
+	case VM_MEMATTR_WRITE_COMBINING:
+#endif
+	case VM_MEMATTR_WRITE_BACK:
+		return (TRUE);
+	default:
+		return (FALSE);
+	}
 }
@@ -47,9 +47,13 @@ __FBSDID("$FreeBSD$");
 #include <sys/kernel.h>
 #include <sys/module.h>
 #include <sys/malloc.h>
+#include <sys/pcpu.h>
 #include <sys/rman.h>
+#include <sys/smp.h>
+#include <sys/sysctl.h>
 #include <sys/timeet.h>
 #include <sys/timetc.h>
+#include <sys/vdso.h>
 #include <sys/watchdog.h>
 
 #include <sys/proc.h>
@@ -58,6 +62,7 @@ __FBSDID("$FreeBSD$");
 #include <machine/cpu.h>
 #include <machine/intr.h>
 #include <machine/asm.h>
+#include <machine/riscv_isa.h>
 #include <machine/trap.h>
 #include <machine/sbi.h>
 
@@ -74,7 +79,61 @@ struct riscv_timer_softc {
 
 static struct riscv_timer_softc *riscv_timer_sc = NULL;
 
+/*
+ * Programming the comparator through the SBI traps into machine mode, so
+ * each hart remembers what it last asked for.  A new deadline that falls
+ * no earlier than, and within riscv_timer_coalesce_us of, the pending one
+ * is left to that one.  With Sstc, stimecmp is written directly.
+ */
+struct riscv_timer_pcpu {
+	uint64_t	deadline;	/* Last programmed compare value */
+	uint64_t	sbi_calls;	/* sbi_set_timer() calls */
+	uint64_t	coalesced;	/* Reprograms skipped */
+};
+DPCPU_DEFINE_STATIC(struct riscv_timer_pcpu, timer_pcpu);
+
+static SYSCTL_NODE(_hw, OID_AUTO, riscv_timer, CTLFLAG_RD, 0,
+    "RISC-V timer");
+
+static u_int riscv_timer_coalesce_us = 1;
+SYSCTL_UINT(_hw_riscv_timer, OID_AUTO, coalesce_us, CTLFLAG_RWTUN,
+    &riscv_timer_coalesce_us, 0,
+    "Microseconds a pending deadline may be late and still reused");
+
+static int riscv_timer_sstc = 1;
+SYSCTL_INT(_hw_riscv_timer, OID_AUTO, sstc, CTLFLAG_RDTUN,
+    &riscv_timer_sstc, 0, "Write stimecmp directly when Sstc is present");
+
+static int
+sysctl_riscv_timer_pcpu(SYSCTL_HANDLER_ARGS)
+{
+	struct riscv_timer_pcpu *tp;
+	uint64_t val;
+	int c, error;
+
+	if (req->oldptr == NULL)
+		return (SYSCTL_OUT(req, 0, sizeof(val) * (mp_maxid + 1)));
+	for (error = 0, c = 0; error == 0 && c <= mp_maxid; c++) {
+		val = 0;
+		if (!CPU_ABSENT(c)) {
+			tp = DPCPU_ID_PTR(c, timer_pcpu);
+			val = *(uint64_t *)((char *)tp + arg2);
+		}
+		error = SYSCTL_OUT(req, &val, sizeof(val));
+	}
+	return (error);
+}
+SYSCTL_PROC(_hw_riscv_timer, OID_AUTO, sbi_calls,
+    CTLTYPE_U64 | CTLFLAG_RD | CTLFLAG_MPSAFE, NULL,
+    offsetof(struct riscv_timer_pcpu, sbi_calls), sysctl_riscv_timer_pcpu,
+    "QU", "Per-CPU sbi_set_timer() calls");
+SYSCTL_PROC(_hw_riscv_timer, OID_AUTO, coalesced,
+    CTLTYPE_U64 | CTLFLAG_RD | CTLFLAG_MPSAFE, NULL,
+    offsetof(struct riscv_timer_pcpu, coalesced), sysctl_riscv_timer_pcpu,
+    "QU", "Per-CPU timer reprograms satisfied by the pending deadline");
+
 static timecounter_get_t riscv_timer_get_timecount;
+static timecounter_fill_vdso_timehands_t riscv_timer_fill_vdso_timehands;
 
 static struct timecounter riscv_timer_timecount = {
 	.tc_name           = "RISC-V Timecounter",
@@ -83,6 +142,7 @@ static struct timecounter riscv_timer_timecount = {
 	.tc_counter_mask   = ~0u,
 	.tc_frequency      = 0,
 	.tc_quality        = 1000,
+	.tc_fill_vdso_timehands = riscv_timer_fill_vdso_timehands,
 };
 
 static inline uint64_t
@@ -115,28 +175,63 @@ riscv_timer_get_timecount(struct timecounter *tc)
 	return (get_counts(sc));
 }
 
+/*
+ * The time CSR is readable from user mode, so libc can compute the
+ * time from the shared page without entering the kernel.
+ */
+static uint32_t
+riscv_timer_fill_vdso_timehands(struct vdso_timehands *vdso_th,
+    struct timecounter *tc)
+{
+
+	vdso_th->th_algo = VDSO_TH_ALGO_RISCV_RDTIME;
+	bzero(vdso_th->th_res, sizeof(vdso_th->th_res));
+	return (1);
+}
+
 static int
 riscv_timer_start(struct eventtimer *et, sbintime_t first, sbintime_t period)
 {
-	uint64_t counts;
+	struct riscv_timer_pcpu *tp;
+	uint64_t counts, deadline, slack;
 
-	if (first != 0) {
-		counts = ((uint32_t)et->et_frequency * first) >> 32;
-		sbi_set_timer(get_cycles() + counts);
-		csr_set(sie, SIE_STIE);
+	if (first == 0)
+		return (EINVAL);
 
-		return (0);
-	}
+	counts = ((uint32_t)et->et_frequency * first) >> 32;
+	deadline = get_cycles() + counts;
+	tp = DPCPU_PTR(timer_pcpu);
 
-	return (EINVAL);
+	/*
+	 * A pending deadline is at least the current time, so one that
+	 * has already fired never matches here.
+	 */
+	slack = (uint64_t)riscv_timer_coalesce_us *
+	    (et->et_frequency / 1000000);
+	if (tp->deadline >= deadline && tp->deadline - deadline <= slack) {
+		tp->coalesced++;
+	} else if (riscv_timer_sstc) {
+		__asm __volatile("csrw 0x14d, %0" :: "r" (deadline));
+		tp->deadline = deadline;
+	} else {
+		sbi_set_timer(deadline);
+		tp->deadline = deadline;
+		tp->sbi_calls++;
+	}
+	csr_set(sie, SIE_STIE);
 
+	return (0);
 }
 
+/*
+ * Masking the interrupt is enough; the comparator keeps its value, so a
+ * restart toward the same deadline does not need the firmware.
+ */
 static int
 riscv_timer_stop(struct eventtimer *et)
 {
 
-	/* TODO */
+	csr_clear(sie, SIE_STIE);
 
 	return (0);
 }
@@ -186,6 +281,12 @@ riscv_timer_attach(device_t dev)
 
 	riscv_timer_sc = sc;
 
+	if (!riscv_isa_has(RISCV_ISA_SSTC))
+		riscv_timer_sstc = 0;
+
+	/* Let user mode read time, for the vdso timecounter. */
+	csr_set(scounteren, SCOUNTEREN_TM);
+
 	/* Setup IRQs handler */
 	error = riscv_setup_intr(device_get_nameunit(dev), riscv_timer_intr,
 	    NULL, sc, IRQ_TIMER_SUPERVISOR, INTR_TYPE_CLK, &sc->ih);
@@ -78,6 +78,7 @@ extern register_t fsu_intr_fault;
 /* Called from exception.S */
 void do_trap_supervisor(struct trapframe *);
 void do_trap_user(struct trapframe *);
+void do_syscall(struct trapframe *);
 
 static __inline void
 call_trapsignal(struct thread *td, int sig, int code, void *addr)
@@ -97,7 +98,7 @@ cpu_fetch_syscall_args(struct thread *td)
 	struct proc *p;
 	register_t *ap;
 	struct syscall_args *sa;
-	int nap;
+	int error, nap;
 
 	nap = NARGREG;
 	p = td->td_proc;
@@ -120,8 +121,18 @@ cpu_fetch_syscall_args(struct thread *td)
 
 	sa->narg = sa->callp->sy_narg;
 	memcpy(sa->args, ap, nap * sizeof(register_t));
-	if (sa->narg > nap)
-		panic("TODO: Could we have more then %d args?", NARGREG);
+	if (sa->narg > nap) {
+		/*
+		 * Any arguments that did not fit in a0-a7 were passed on the
+		 * user stack, as for an ordinary function call.
+		 */
+		if (sa->narg > nitems(sa->args))
+			return (EINVAL);
+		error = copyin((void *)td->td_frame->tf_sp, &sa->args[nap],
+		    (sa->narg - nap) * sizeof(register_t));
+		if (error != 0)
+			return (error);
+	}
 
 	td->td_retval[0] = 0;
 	td->td_retval[1] = 0;
@@ -153,14 +164,19 @@ dump_regs(struct trapframe *frame)
 	printf("sstatus == 0x%016lx\n", frame->tf_sstatus);
 }
 
-static void
-svc_handler(struct trapframe *frame)
+/*
+ * System call entry.  The user exception vector calls this directly for
+ * an ecall, bypassing the dispatch in do_trap_user().
+ */
+void
+do_syscall(struct trapframe *frame)
 {
 	struct thread *td;
 	int error;
 
 	td = curthread;
 	td->td_frame = frame;
+	frame->tf_sepc += 4;	/* Next instruction */
 
 	error = syscallenter(td);
 	syscallret(td, error);
@@ -208,10 +224,19 @@ data_abort(struct trapframe *frame, int lower)
 	if ((frame->tf_scause == EXCP_FAULT_STORE) ||
 	    (frame->tf_scause == EXCP_STORE_PAGE_FAULT)) {
 		ftype = (VM_PROT_READ | VM_PROT_WRITE);
+	} else if (frame->tf_scause == EXCP_INST_PAGE_FAULT) {
+		ftype = VM_PROT_EXECUTE;
 	} else {
 		ftype = (VM_PROT_READ);
 	}
 
+	/*
+	 * The mapping may be valid and lack only its accessed or dirty bit,
+	 * which the hardware is permitted to leave to software.
+	 */
+	if (pmap_fault_fixup(map->pmap, va, ftype))
+		goto done;
+
 	if (map != kernel_map) {
 		/*
 		 * Keep swapout from messing with us during this
@@ -256,6 +281,7 @@ data_abort(struct trapframe *frame, int lower)
 		}
 	}
 
+done:
 	if (lower)
 		userret(td, frame);
 }
@@ -296,10 +322,13 @@ do_trap_supervisor(struct trapframe *frame)
 		break;
 	case EXCP_BREAKPOINT:
 #ifdef KDTRACE_HOOKS
-		if (dtrace_invop_jump_addr != 0) {
-			dtrace_invop_jump_addr(frame);
+		/*
+		 * An ebreak planted by fbt is emulated by the handler, which
+		 * returns 0.  Anything else is a debugger breakpoint.
+		 */
+		if (dtrace_invop_jump_addr != NULL &&
+		    dtrace_invop_jump_addr(frame) == 0)
 			break;
-		}
 #endif
 #ifdef KDB
 		kdb_trap(exception, 0, frame);
@@ -325,11 +354,9 @@ do_trap_user(struct trapframe *frame)
 	uint64_t exception;
 	struct thread *td;
 	uint64_t sstatus;
-	struct pcb *pcb;
 
 	td = curthread;
 	td->td_frame = frame;
-	pcb = td->td_pcb;
 
 	/* Ensure we came from usermode, interrupts disabled */
 	__asm __volatile("csrr %0, sstatus" : "=&r" (sstatus));
@@ -356,20 +383,16 @@ do_trap_user(struct trapframe *frame)
 		data_abort(frame, 1);
 		break;
 	case EXCP_USER_ECALL:
-		frame->tf_sepc += 4;	/* Next instruction */
-		svc_handler(frame);
+		do_syscall(frame);
 		break;
 	case EXCP_ILLEGAL_INSTRUCTION:
 #ifdef FPE
-		if ((pcb->pcb_fpflags & PCB_FP_STARTED) == 0) {
+		if ((frame->tf_sstatus & SSTATUS_FS_MASK) == SSTATUS_FS_OFF) {
 			/*
-			 * May be a FPE trap. Enable FPE usage
-			 * for this thread and try again.
+			 * May be a FPE trap. Load or initialise the FPE
+			 * state for this thread and try again.
 			 */
-			fpe_state_clear();
-			frame->tf_sstatus &= ~SSTATUS_FS_MASK;
-			frame->tf_sstatus |= SSTATUS_FS_CLEAN;
-			pcb->pcb_fpflags |= PCB_FP_STARTED;
+			fpe_restore_state();
 			break;
 		}
 #endif
@@ -53,8 +53,13 @@ __FBSDID("$FreeBSD$");
 #include <machine/cpu.h>
 #include <machine/pcb.h>
 #include <machine/frame.h>
+#include <machine/md_var.h>
 #include <machine/sbi.h>
 
+#ifdef FPE
+#include <machine/fpe.h>
+#endif
+
 #if __riscv_xlen == 64
 #define	TP_OFFSET	16	/* sizeof(struct tcb) */
 #endif
@@ -76,14 +81,16 @@ cpu_fork(struct thread *td1, struct proc *p2, struct thread *td2, int flags)
 
 	if (td1 == curthread) {
 		/*
-		 * Save the tp. These normally happen in cpu_switch,
-		 * but if userland changes this then forks this may
-		 * not have happened.
+		 * Save the tp and the FPE state, these normally happen
+		 * in cpu_switch, but if userland changes these then
+		 * forks this may not have happened.
 		 */
 		__asm __volatile("mv %0, tp" : "=&r"(val));
 		td1->td_pcb->pcb_tp = val;
 
-		/* RISCVTODO: save the FPU state here */
+#ifdef FPE
+		fpe_save_state(td1);
+#endif
 	}
 
 	pcb2 = (struct pcb *)(td2->td_kstack +
@@ -91,6 +98,8 @@ cpu_fork(struct thread *td1, struct proc *p2, struct thread *td2, int flags)
 
 	td2->td_pcb = pcb2;
 	bcopy(td1->td_pcb, pcb2, sizeof(*pcb2));
+	/* The child loads its FPE state from the pcb on first use. */
+	pcb2->pcb_fpcpu = UINT_MAX;
 
 	td2->td_pcb->pcb_l1addr =
 	    vtophys(vmspace_pmap(td2->td_proc->p_vmspace)->pm_l1);
@@ -175,8 +184,14 @@ void
 cpu_copy_thread(struct thread *td, struct thread *td0)
 {
 
+#ifdef FPE
+	if (td0 == curthread)
+		fpe_save_state(td0);
+#endif
+
 	bcopy(td0->td_frame, td->td_frame, sizeof(struct trapframe));
 	bcopy(td0->td_pcb, td->td_pcb, sizeof(struct pcb));
+	td->td_pcb->pcb_fpcpu = UINT_MAX;
 
 	td->td_pcb->pcb_s[0] = (uintptr_t)fork_return;
 	td->td_pcb->pcb_s[1] = (uintptr_t)td;
@@ -271,5 +286,6 @@ void
 swi_vm(void *v)
 {
 
-	/* Nothing to do here - busdma bounce buffers are not implemented. */
+	if (busdma_swi_pending != 0)
+		busdma_swi();
 }
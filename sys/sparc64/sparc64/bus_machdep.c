@@ -528,7 +528,8 @@ nexus_dmamem_alloc(bus_dma_tag_t dmat, void **vaddr, int flags,
 	 */
 	if (dmat->dt_maxsize <= PAGE_SIZE &&
 	    dmat->dt_alignment <= dmat->dt_maxsize)
-		*vaddr = malloc(dmat->dt_maxsize, M_DEVBUF, mflags);
+		*vaddr = malloc(MALLOC_ALIGNED_SIZE(dmat->dt_maxsize),
+		    M_DEVBUF, mflags);
 	else {
 		/*
 		 * XXX use contigmalloc until it is merged into this
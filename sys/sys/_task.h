@@ -60,6 +60,7 @@ struct gtask {
 	u_short	ta_priority;		/* (c) Priority */
 	gtask_fn_t *ta_func;		/* (c) task handler */
 	void	*ta_context;		/* (c) argument for handler */
+	sbintime_t ta_enqueued;		/* (q) enqueue time, for statistics */
 };
 
 struct grouptask {
@@ -71,6 +72,7 @@ struct grouptask {
 	char			gt_name[GROUPTASK_NAMELEN];
 	int16_t			gt_irq;
 	int16_t			gt_cpu;
+	int			gt_domain;
 };
 
 #endif /* !_SYS__TASK_H_ */
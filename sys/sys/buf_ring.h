@@ -112,6 +112,64 @@ buf_ring_enqueue(struct buf_ring *br, void *buf)
 	return (0);
 }
 
+/*
+ * multi-producer safe lock-free ring buffer enqueue of n buffers
+ * all n slots are reserved with a single compare-and-set, so either
+ * all of them are enqueued, in order, or none is
+ */
+static __inline int
+buf_ring_enqueue_bulk(struct buf_ring *br, void **bufs, int n)
+{
+	uint32_t prod_head, prod_next, cons_tail, avail;
+	int i;
+
+	KASSERT(n > 0 && n < br->br_prod_size,
+	    ("%s: bad count %d", __func__, n));
+	critical_enter();
+	for (;;) {
+		prod_head = br->br_prod_head;
+		cons_tail = br->br_cons_tail;
+		avail = (cons_tail - prod_head - 1) & br->br_prod_mask;
+
+		/*
+		 * Unlike the single enqueue, a moved cons_tail does not
+		 * mean there is room for all n, so recheck from the top.
+		 */
+		if (avail < (uint32_t)n) {
+			rmb();
+			if (prod_head == br->br_prod_head &&
+			    cons_tail == br->br_cons_tail) {
+				br->br_drops += n;
+				critical_exit();
+				return (ENOBUFS);
+			}
+			continue;
+		}
+		prod_next = (prod_head + n) & br->br_prod_mask;
+		if (atomic_cmpset_acq_int(&br->br_prod_head, prod_head,
+		    prod_next))
+			break;
+	}
+	for (i = 0; i < n; i++) {
+#ifdef DEBUG_BUFRING
+		if (br->br_ring[(prod_head + i) & br->br_prod_mask] != NULL)
+			panic("dangling value in enqueue");
+#endif
+		br->br_ring[(prod_head + i) & br->br_prod_mask] = bufs[i];
+	}
+
+	/*
+	 * If there are other enqueues in progress
+	 * that preceded us, we need to wait for them
+	 * to complete
+	 */
+	while (br->br_prod_tail != prod_head)
+		cpu_spinwait();
+	atomic_store_rel_int(&br->br_prod_tail, prod_next);
+	critical_exit();
+	return (0);
+}
+
 /*
  * multi-consumer safe dequeue 
  *
@@ -228,6 +286,99 @@ buf_ring_dequeue_sc(struct buf_ring *br)
 	return (buf);
 }
 
+/*
+ * multi-consumer safe dequeue of up to n buffers
+ * returns the number of buffers stored in bufs
+ */
+static __inline int
+buf_ring_dequeue_burst_mc(struct buf_ring *br, void **bufs, int n)
+{
+	uint32_t cons_head, cons_next, avail, i;
+
+	critical_enter();
+	do {
+		cons_head = br->br_cons_head;
+		avail = (br->br_prod_tail - cons_head) & br->br_cons_mask;
+
+		if (avail == 0) {
+			critical_exit();
+			return (0);
+		}
+		if (avail > (uint32_t)n)
+			avail = n;
+		cons_next = (cons_head + avail) & br->br_cons_mask;
+	} while (!atomic_cmpset_acq_int(&br->br_cons_head, cons_head, cons_next));
+
+	for (i = 0; i < avail; i++) {
+		bufs[i] = br->br_ring[(cons_head + i) & br->br_cons_mask];
+#ifdef DEBUG_BUFRING
+		br->br_ring[(cons_head + i) & br->br_cons_mask] = NULL;
+#endif
+	}
+	/*
+	 * If there are other dequeues in progress
+	 * that preceded us, we need to wait for them
+	 * to complete
+	 */
+	while (br->br_cons_tail != cons_head)
+		cpu_spinwait();
+
+	atomic_store_rel_int(&br->br_cons_tail, cons_next);
+	critical_exit();
+#ifdef PREFETCH_DEFINED
+	for (i = 0; i < avail; i++)
+		prefetch(bufs[i]);
+#endif
+	return (avail);
+}
+
+/*
+ * single-consumer dequeue of up to n buffers
+ * use where dequeue is protected by a lock
+ * e.g. a network driver's tx queue lock
+ * the returned buffers are prefetched, so a driver filling its
+ * descriptors in order finds them in cache
+ */
+static __inline int
+buf_ring_dequeue_burst_sc(struct buf_ring *br, void **bufs, int n)
+{
+	uint32_t cons_head, cons_next, prod_tail, avail, i;
+
+	/* See buf_ring_dequeue_sc() for the ordering on ARM. */
+#if defined(__arm__) || defined(__aarch64__)
+	cons_head = atomic_load_acq_32(&br->br_cons_head);
+#else
+	cons_head = br->br_cons_head;
+#endif
+	prod_tail = atomic_load_acq_32(&br->br_prod_tail);
+	avail = (prod_tail - cons_head) & br->br_cons_mask;
+	if (avail == 0)
+		return (0);
+	if (avail > (uint32_t)n)
+		avail = n;
+
+	cons_next = (cons_head + avail) & br->br_cons_mask;
+	for (i = 0; i < avail; i++) {
+		bufs[i] = br->br_ring[(cons_head + i) & br->br_cons_mask];
+#ifdef PREFETCH_DEFINED
+		prefetch(bufs[i]);
+#endif
+#ifdef DEBUG_BUFRING
+		br->br_ring[(cons_head + i) & br->br_cons_mask] = NULL;
+#endif
+	}
+	br->br_cons_head = cons_next;
+#ifdef DEBUG_BUFRING
+	if (!mtx_owned(br->br_lock))
+		panic("lock not held on single consumer dequeue");
+	if (br->br_cons_tail != cons_head)
+		panic("inconsistent list cons_tail=%d cons_head=%d",
+		    br->br_cons_tail, cons_head);
+#endif
+	atomic_store_rel_32(&br->br_cons_tail, cons_next);
+	return (avail);
+}
+
 /*
  * single-consumer advance after a peek
  * use where it is protected by a lock
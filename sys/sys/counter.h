@@ -42,6 +42,18 @@ void		counter_u64_free(counter_u64_t);
 void		counter_u64_zero(counter_u64_t);
 uint64_t	counter_u64_fetch(counter_u64_t);
 
+/*
+ * Arrays of counters that are laid out contiguously in each CPU's copy,
+ * so that they can be fetched and zeroed in one pass per CPU.  The
+ * counters are still updated individually through the pointer array.
+ */
+#define	COUNTER_U64_ARRAY_CHUNK	256	/* counters per block */
+
+int		counter_u64_array_alloc(counter_u64_t *, int, int);
+void		counter_u64_array_free(counter_u64_t *, int);
+void		counter_u64_array_fetch(counter_u64_t *, int, uint64_t *);
+void		counter_u64_array_zero(counter_u64_t *, int);
+
 #define	COUNTER_ARRAY_ALLOC(a, n, wait)	do {			\
 	for (int i = 0; i < (n); i++)				\
 		(a)[i] = counter_u64_alloc(wait);		\
@@ -32,6 +32,7 @@
 #define _SYS_EVENT_H_
 
 #include <sys/_types.h>
+#include <sys/ioccom.h>
 #include <sys/queue.h>
 
 #define EVFILT_READ		(-1)
@@ -143,6 +144,7 @@ struct kevent32_freebsd11 {
 #define EV_CLEAR	0x0020		/* clear event state after reporting */
 #define EV_RECEIPT	0x0040		/* force EV_ERROR on success, data=0 */
 #define EV_DISPATCH	0x0080		/* disable event after reporting */
+#define EV_EXCLUSIVE	0x0200		/* wake one of the watching kqs */
 
 #define EV_SYSFLAGS	0xF000		/* reserved by system */
 #define	EV_DROP		0x1000		/* note should be dropped */
@@ -230,6 +232,30 @@ struct knlist {
 	int	kl_autodestroy;
 };
 
+/*
+ * Shared-memory event ring.  After KQIOC_SETRING the kqueue descriptor
+ * can be mmap(2)ed MAP_SHARED at offset 0; the kernel appends triggered
+ * events at kr_tail and the process consumes them from kr_head, without
+ * a kevent(2) call per batch.  kevent(2) is still used to register
+ * changes and to sleep when the ring is empty.  Both indices run freely
+ * and are masked with kr_nentries - 1.
+ */
+struct kqring_hdr {
+	volatile __uint32_t kr_head;		/* consumer index (process) */
+	__uint32_t	kr_pad0[15];
+	volatile __uint32_t kr_tail;		/* producer index (kernel) */
+	__uint32_t	kr_nentries;		/* ring size, power of 2 */
+	volatile __uint32_t kr_overflows;	/* bogus kr_head resets */
+	__uint32_t	kr_pad1[13];
+};
+
+#define	KQRING_MAXENTRIES	65536
+#define	KQRING_EVENTS(hdr)	((struct kevent *)((struct kqring_hdr *)(hdr) + 1))
+#define	KQRING_SIZE(n)		(sizeof(struct kqring_hdr) + \
+				    (n) * sizeof(struct kevent))
+
+#define	KQIOC_SETRING	_IOW('k', 100, __uint32_t)	/* ring entries */
+
 
 #ifdef _KERNEL
 
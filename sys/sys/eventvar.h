@@ -46,23 +46,29 @@ struct kqueue {
 	TAILQ_ENTRY(kqueue)	kq_list;
 	TAILQ_HEAD(, knote)	kq_head;	/* list of pending event */
 	int		kq_count;		/* number of pending events */
+	int		kq_sleepers;		/* threads in kqueue_scan() */
 	struct		selinfo kq_sel;
 	struct		sigio *kq_sigio;
 	struct		filedesc *kq_fdp;
 	int		kq_state;
 #define KQ_SEL		0x01
-#define KQ_SLEEP	0x02
 #define KQ_FLUXWAIT	0x04			/* waiting for a in flux kn */
 #define KQ_ASYNC	0x08
 #define KQ_CLOSING	0x10
 #define	KQ_TASKSCHED	0x20			/* task scheduled */
 #define	KQ_TASKDRAIN	0x40			/* waiting for task to drain */
+#define	KQ_RINGSCHED	0x80			/* ring task scheduled */
 	int		kq_knlistsize;		/* size of knlist */
 	struct		klist *kq_knlist;	/* list of knotes */
 	u_long		kq_knhashmask;		/* size of knhash */
 	struct		klist *kq_knhash;	/* hash table for knotes */
 	struct		task kq_task;
 	struct		ucred *kq_cred;
+	struct		vm_object *kq_ringobj;	/* KQIOC_SETRING backing pages */
+	struct		kqring_hdr *kq_ring;	/* kernel mapping of the ring */
+	u_int		kq_ringsize;		/* entries, power of 2 */
+	vm_size_t	kq_ringbytes;		/* mapping size, page rounded */
+	struct		task kq_ringtask;
 };
 
 #endif /* !_SYS_EVENTVAR_H_ */
@@ -167,6 +167,17 @@ struct fadvise_info {
 	off_t		fa_end;		/* (f) Region end. */
 };
 
+/*
+ * Additional sequential streams tracked per file, so that interleaved
+ * readers of the same open file do not destroy each other's read-ahead.
+ */
+#define	FILE_RASTREAMS	3
+
+struct file_rastream {
+	off_t		fr_nextoff;	/* next expected offset */
+	int		fr_seqcount;	/* count of sequential accesses */
+};
+
 struct file {
 	void		*f_data;	/* file descriptor specific data */
 	struct fileops	*f_ops;		/* File operations */
@@ -181,6 +192,8 @@ struct file {
 	 */
 	int		f_seqcount;	/* (a) Count of sequential accesses. */
 	off_t		f_nextoff;	/* next expected read/write offset. */
+	struct file_rastream f_rastream[FILE_RASTREAMS];
+					/* (a) inactive sequential streams */
 	union {
 		struct cdev_privdata *fvn_cdevpriv;
 					/* (d) Private data for the cdev. */
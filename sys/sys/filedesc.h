@@ -136,6 +136,15 @@ struct filedesc_to_leader {
 					    SX_NOTRECURSED)
 #define	FILEDESC_UNLOCK_ASSERT(fdp)	sx_assert(&(fdp)->fd_sx, SX_UNLOCKED)
 
+/*
+ * The table belongs to the current single-threaded process and is not
+ * shared with any other one, so nobody but curthread can close a
+ * descriptor in it.
+ */
+#define	FILEDESC_IS_ONLY_USER(fdp)					\
+	(curproc->p_numthreads == 1 && curproc->p_fd == (fdp) &&	\
+	    (fdp)->fd_refcnt == 1)
+
 /* Operation types for kern_dup(). */
 enum {
 	FDDUP_NORMAL,		/* dup() behavior. */
@@ -201,6 +210,17 @@ int	fget_cap(struct thread *td, int fd, cap_rights_t *needrightsp,
 int	fget_unlocked(struct filedesc *fdp, int fd, cap_rights_t *needrightsp,
 	    struct file **fpp, seq_t *seqp);
 
+/*
+ * Return a file without a reference.  Only valid while
+ * FILEDESC_IS_ONLY_USER(fdp) holds; release with fput_only_user().
+ */
+int	fget_only_user(struct filedesc *fdp, int fd, cap_rights_t *needrightsp,
+	    struct file **fpp);
+#define	fput_only_user(fdp, fp)	do {					\
+	MPASS(FILEDESC_IS_ONLY_USER(fdp));				\
+	MPASS((fp)->f_count > 0);					\
+} while (0)
+
 /* Requires a FILEDESC_{S,X}LOCK held and returns without a ref. */
 static __inline struct file *
 fget_locked(struct filedesc *fdp, int fd)
@@ -31,6 +31,7 @@
 
 #ifndef _SYS_GTASKQUEUE_H_
 #define _SYS_GTASKQUEUE_H_
+#include <sys/bus.h>
 #include <sys/taskqueue.h>
 
 #ifndef _KERNEL
@@ -54,7 +55,7 @@ void	gtaskqueue_drain_all(struct gtaskqueue *queue);
 
 int grouptaskqueue_enqueue(struct gtaskqueue *queue, struct gtask *task);
 void	taskqgroup_attach(struct taskqgroup *qgroup, struct grouptask *grptask,
-	    void *uniq, int irq, const char *name);
+	    void *uniq, device_t dev, int irq, const char *name);
 int		taskqgroup_attach_cpu(struct taskqgroup *qgroup, struct grouptask *grptask,
 		void *uniq, int cpu, int irq, const char *name);
 void	taskqgroup_detach(struct taskqgroup *qgroup, struct grouptask *gtask);
@@ -74,6 +75,7 @@ void	taskqgroup_config_gtask_deinit(struct grouptask *gtask);
 	(task)->ta_priority = (priority);		\
 	(task)->ta_func = (func);			\
 	(task)->ta_context = (context);			\
+	(task)->ta_enqueued = 0;			\
 } while (0)
 
 #define	GROUPTASK_INIT(gtask, priority, func, context)	\
@@ -122,6 +122,7 @@ static __inline quad_t qabs(quad_t a) { return (a < 0 ? -a : a); }
 #define	ARC4_ENTR_HAVE	1	/* Have entropy. */
 #define	ARC4_ENTR_SEED	2	/* Reseeding. */
 extern int arc4rand_iniseed_state;
+extern int arc4rand_seeded;	/* Every instance keyed from random(4). */
 
 /* Prototypes for non-quad routines. */
 struct malloc_type;
@@ -67,6 +67,8 @@ SDT_PROBE_DECLARE(lockstat, , , sx__downgrade);
 
 SDT_PROBE_DECLARE(lockstat, , , thread__spin);
 
+SDT_PROBE_DECLARE(lockstat, , , rangelock__block);
+
 #define	LOCKSTAT_WRITER		0
 #define	LOCKSTAT_READER		1
 
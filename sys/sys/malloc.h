@@ -85,7 +85,7 @@ struct malloc_type_stats {
 	uint64_t	mts_numallocs;	/* Number of allocates on CPU. */
 	uint64_t	mts_numfrees;	/* number of frees on CPU. */
 	uint64_t	mts_size;	/* Bitmask of sizes allocated on CPU. */
-	uint64_t	_mts_reserved1;	/* Reserved field. */
+	uint64_t	mts_memrequested; /* Bytes requested on CPU. */
 	uint64_t	_mts_reserved2;	/* Reserved field. */
 	uint64_t	_mts_reserved3;	/* Reserved field. */
 };
@@ -162,6 +162,15 @@ MALLOC_DECLARE(M_IOV);
 
 extern struct mtx malloc_mtx;
 
+/*
+ * Only the power-of-two malloc(9) size classes are naturally aligned, and
+ * so never cross a boundary that is a multiple of their size; the classes
+ * in between are aligned to 16 bytes.  Callers that rely on the old
+ * guarantees, such as busdma, round their request up with this.
+ */
+#define	MALLOC_ALIGNED_SIZE(size)					\
+	(powerof2(size) ? (size) : (size_t)1 << flsl((size) - 1))
+
 /*
  * Function type used when iterating over the list of malloc types.
  */
@@ -805,6 +805,30 @@ m_getcl(int how, short type, int flags)
 	return (m);
 }
 
+/*
+ * Allocate up to count packet header mbufs, or mbufs with clusters
+ * attached, for receive ring refill.  Returns how many were allocated.
+ */
+static __inline int
+m_gethdr_bulk(struct mbuf **mp, int count, int how, short type)
+{
+	struct mb_args args;
+
+	args.flags = M_PKTHDR;
+	args.type = type;
+	return (uma_zalloc_bulk(zone_mbuf, (void **)mp, count, &args, how));
+}
+
+static __inline int
+m_getcl_bulk(struct mbuf **mp, int count, int how, short type, int flags)
+{
+	struct mb_args args;
+
+	args.flags = flags;
+	args.type = type;
+	return (uma_zalloc_bulk(zone_pack, (void **)mp, count, &args, how));
+}
+
 /*
  * XXX: m_cljset() is a dangerous API.  One must attach only a new,
  * unreferenced cluster to an mbuf(9).  It is not possible to assert
@@ -38,6 +38,7 @@
 #include <sys/ucred.h>
 #include <sys/queue.h>
 #ifdef _KERNEL
+#include <sys/counter.h>
 #include <sys/lock.h>
 #include <sys/lockmgr.h>
 #include <sys/tslog.h>
@@ -216,6 +217,10 @@ struct mount {
 	int		mnt_secondary_writes;   /* (i) # of secondary writes */
 	int		mnt_secondary_accwrites;/* (i) secondary wr. starts */
 	struct thread	*mnt_susp_owner;	/* (i) thread owning suspension */
+	counter_u64_t	mnt_nchits;		/* name cache positive hits */
+	counter_u64_t	mnt_ncneghits;		/* name cache negative hits */
+	counter_u64_t	mnt_ncmisses;		/* name cache misses */
+	sbintime_t	mnt_ralatency;		/* cluster read latency */
 #define	mnt_endzero	mnt_gjprovider
 	char		*mnt_gjprovider;	/* gjournal provider name */
 	struct mtx	mnt_listmtx;
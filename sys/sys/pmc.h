@@ -62,7 +62,7 @@
  * The patch version is incremented for every bug fix.
  */
 #define	PMC_VERSION_MAJOR	0x09
-#define	PMC_VERSION_MINOR	0x03
+#define	PMC_VERSION_MINOR	0x05
 #define	PMC_VERSION_PATCH	0x0000
 
 #define	PMC_VERSION		(PMC_VERSION_MAJOR << 24 |		\
@@ -125,7 +125,8 @@ extern char pmc_cpuid[PMC_CPUID_LEN];
 	__PMC_CPU(ARMV7_CORTEX_A15,	0x504,	"ARMv7 Cortex A15")	\
 	__PMC_CPU(ARMV7_CORTEX_A17,	0x505,	"ARMv7 Cortex A17")	\
 	__PMC_CPU(ARMV8_CORTEX_A53,	0x600,	"ARMv8 Cortex A53")	\
-	__PMC_CPU(ARMV8_CORTEX_A57,	0x601,	"ARMv8 Cortex A57")
+	__PMC_CPU(ARMV8_CORTEX_A57,	0x601,	"ARMv8 Cortex A57")	\
+	__PMC_CPU(RISCV_RV64,	0x700,	"RISC-V RV64")
 
 enum pmc_cputype {
 #undef	__PMC_CPU
@@ -160,7 +161,8 @@ enum pmc_cputype {
 	__PMC_CLASS(ARMV7,	0x10,	"ARMv7")			\
 	__PMC_CLASS(ARMV8,	0x11,	"ARMv8")			\
 	__PMC_CLASS(MIPS74K,	0x12,	"MIPS 74K")			\
-	__PMC_CLASS(E500,	0x13,	"Freescale e500 class")
+	__PMC_CLASS(E500,	0x13,	"Freescale e500 class")		\
+	__PMC_CLASS(RISCV,	0x14,	"RISC-V")
 
 enum pmc_class {
 #undef  __PMC_CLASS
@@ -169,7 +171,7 @@ enum pmc_class {
 };
 
 #define	PMC_CLASS_FIRST	PMC_CLASS_TSC
-#define	PMC_CLASS_LAST	PMC_CLASS_E500
+#define	PMC_CLASS_LAST	PMC_CLASS_RISCV
 
 /*
  * A PMC can be in the following states:
@@ -350,7 +352,8 @@ enum pmc_event {
 	__PMC_OP(PMCSTOP, "Stop a PMC")					\
 	__PMC_OP(WRITELOG, "Write a cookie to the log file")		\
 	__PMC_OP(CLOSELOG, "Close log file")				\
-	__PMC_OP(GETDYNEVENTINFO, "Get dynamic events list")
+	__PMC_OP(GETDYNEVENTINFO, "Get dynamic events list")		\
+	__PMC_OP(CONFIGURERING, "Set shared memory log ring")
 
 
 enum pmc_ops {
@@ -551,6 +554,10 @@ struct pmc_op_getcpuinfo {
  * OP CONFIGURELOG
  *
  * Configure a log file for writing system-wide statistics to.
+ *
+ * OP CONFIGURERING uses the same argument; 'pm_logfd' then names a
+ * POSIX shared memory object that will hold per-CPU log rings, see
+ * <sys/pmclog.h>.
  */
 
 struct pmc_op_configurelog {
@@ -875,6 +882,7 @@ struct pmc_owner  {
 	short			po_sscount;	/* # SS PMCs owned */
 	short			po_logprocmaps;	/* global mappings done */
 	struct pmclog_buffer	*po_curbuf[MAXCPU];	/* current log buffer */
+	struct pmclog_ring	*po_ring;	/* shared memory rings, if any */
 };
 
 #define	PMC_PO_OWNS_LOGFILE		0x00000001 /* has a log file */
@@ -285,6 +285,45 @@ union pmclog_entry {		/* only used to size scratch areas */
 #define	PMCLOG_HEADER_CHECK_MAGIC(H)				\
 	(PMCLOG_HEADER_TO_MAGIC(H) == PMCLOG_HEADER_MAGIC)
 
+/*
+ * Layout of a shared memory log ring (OP CONFIGURERING).
+ *
+ * The first page holds a 'struct pmclog_ring_header'.  It is followed
+ * by one area per CPU, 'prh_stride' bytes apart: a page holding a
+ * 'struct pmclog_ring_control', then 'prh_size' bytes of log records.
+ * Records from a CPU are written only by that CPU.  The kernel
+ * advances 'prc_head' once a record is complete and the reader
+ * advances 'prc_tail' once it has consumed it; both count bytes and
+ * wrap freely.  Records never straddle the end of a ring: a zero
+ * header word means the next record starts at offset zero.
+ */
+
+#define	PMCLOG_RING_MAGIC	0x504d4352	/* "PMCR" */
+#define	PMCLOG_RING_VERSION	1
+
+struct pmclog_ring_header {
+	uint32_t	prh_magic;
+	uint32_t	prh_version;
+	uint32_t	prh_ncpu;	/* number of per-CPU areas */
+	uint32_t	prh_pagesize;	/* offset of the first area */
+	uint32_t	prh_size;	/* record bytes per CPU, a power of 2 */
+	uint32_t	prh_stride;	/* distance between areas */
+};
+
+struct pmclog_ring_control {
+	volatile uint32_t prc_head;	/* (k) end of committed records */
+	uint32_t	prc_pad0[15];
+	volatile uint32_t prc_tail;	/* (u) end of consumed records */
+	uint32_t	prc_pad1[15];
+	volatile uint32_t prc_dropped;	/* (k) records lost, ring full */
+};
+
+#define	PMCLOG_RING_CONTROL(H, CPU)					\
+	((struct pmclog_ring_control *)((char *)(H) +			\
+	    (H)->prh_pagesize + (size_t)(CPU) * (H)->prh_stride))
+#define	PMCLOG_RING_DATA(H, CPU)					\
+	((char *)PMCLOG_RING_CONTROL(H, CPU) + (H)->prh_pagesize)
+
 #ifdef	_KERNEL
 
 /*
@@ -292,6 +331,8 @@ union pmclog_entry {		/* only used to size scratch areas */
  */
 int	pmclog_configure_log(struct pmc_mdep *_md, struct pmc_owner *_po,
     int _logfd);
+int	pmclog_configure_ring(struct pmc_mdep *_md, struct pmc_owner *_po,
+    int _shmfd);
 int	pmclog_deconfigure_log(struct pmc_owner *_po);
 int	pmclog_flush(struct pmc_owner *_po, int force);
 int	pmclog_close(struct pmc_owner *_po);
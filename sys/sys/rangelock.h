@@ -32,6 +32,7 @@
 #define	_SYS_RANGELOCK_H
 
 #include <sys/queue.h>
+#include <sys/tree.h>
 
 #define	RL_LOCK_READ		0x0001
 #define	RL_LOCK_WRITE		0x0002
@@ -39,6 +40,7 @@
 #define	RL_LOCK_GRANTED		0x0004
 
 struct rl_q_entry;
+RB_HEAD(rl_q_tree, rl_q_entry);
 
 /*
  * The structure representing the range lock.  Caller may request
@@ -50,17 +52,15 @@ struct rl_q_entry;
  * Access to the structure itself is synchronized with the externally
  * supplied mutex.
  *
- * rl_waiters is the queue containing in order (a) granted write lock
- * requests, (b) granted read lock requests, and (c) in order of arrival,
- * lock requests which cannot be granted yet.
- *
- * rl_currdep is the first lock request that cannot be granted now due
- * to the preceding requests conflicting with it (i.e., it points to
- * position (c) in the list above).
+ * Granted requests are kept in two interval trees, one for reads and
+ * one for writes, so that a conflict is found in logarithmic time.
+ * rl_waiters is the queue of requests which cannot be granted yet, in
+ * order of arrival; only its head is ever tested against the trees.
  */
 struct rangelock {
 	TAILQ_HEAD(, rl_q_entry) rl_waiters;
-	struct rl_q_entry	*rl_currdep;
+	struct rl_q_tree	rl_reads;
+	struct rl_q_tree	rl_writes;
 };
 
 #ifdef _KERNEL
@@ -69,6 +69,7 @@ struct mtx;
 
 void	 rangelock_init(struct rangelock *lock);
 void	 rangelock_destroy(struct rangelock *lock);
+bool	 rangelock_idle(struct rangelock *lock);
 void	 rangelock_unlock(struct rangelock *lock, void *cookie,
 	    struct mtx *ilk);
 void	*rangelock_unlock_range(struct rangelock *lock, void *cookie,
@@ -32,6 +32,8 @@
 #ifndef _SYS_SF_BUF_H_
 #define _SYS_SF_BUF_H_
 
+#define	SF_HIST_NBUCKETS	20
+
 struct sfstat {				/* sendfile statistics */
 	uint64_t	sf_syscalls;	/* times sendfile was called */
 	uint64_t	sf_noiocnt;	/* times sendfile didn't require I/O */
@@ -44,6 +46,13 @@ struct sfstat {				/* sendfile statistics */
 	uint64_t	sf_allocfail;	/* times sfbuf allocation failed */
 	uint64_t	sf_allocwait;	/* times sfbuf allocation had to wait */
 	uint64_t	sf_pages_bogus;	/* times bogus page was used */
+	uint64_t	sf_rhpages_adaptive;	/* readahead pages added for
+					   sequential streams */
+	/* Power of two histograms, bucket i counts values < 2^i. */
+	uint64_t	sf_iowait_hist[SF_HIST_NBUCKETS]; /* usecs until I/O
+					   of a request completed */
+	uint64_t	sf_nrdy_hist[SF_HIST_NBUCKETS]; /* mbufs held not
+					   ready per request */
 };
 
 #ifdef _KERNEL
@@ -192,5 +201,8 @@ extern counter_u64_t sfstat[sizeof(struct sfstat) / sizeof(uint64_t)];
     counter_u64_add(sfstat[offsetof(struct sfstat, name) / sizeof(uint64_t)],\
 	(val))
 #define	SFSTAT_INC(name)	SFSTAT_ADD(name, 1)
+#define	SFSTAT_HIST(name, val)	\
+    counter_u64_add(sfstat[offsetof(struct sfstat, name) / sizeof(uint64_t) +\
+	min(flsll(val), SF_HIST_NBUCKETS - 1)], 1)
 #endif /* _KERNEL */
 #endif /* !_SYS_SF_BUF_H_ */
@@ -131,6 +131,13 @@ struct socket {
 			/* (b) cached MAC label for peer */
 			struct	label		*so_peerlabel;
 			u_long	so_oobmark;	/* chars to oob mark */
+
+			/* (cs) sendfile(2) sequential stream state. */
+			off_t		so_sf_nextoff;	/* expected offset */
+			off_t		so_sf_startoff;	/* offset at so_sf_stamp */
+			sbintime_t	so_sf_stamp;	/* time of last call */
+			uint64_t	so_sf_bps;	/* observed rate */
+			int		so_sf_rhpages;	/* readahead window */
 		};
 		/*
 		 * Listening socket, where accepts occur, is so_listen in all
@@ -499,4 +499,7 @@
 #define	SYS_cpuset_getdomain	561
 #define	SYS_cpuset_setdomain	562
 #define	SYS_getrandom	563
-#define	SYS_MAXSYSCALL	564
+#define	SYS_recvmmsg	564
+#define	SYS_sendmmsg	565
+#define	SYS_copy_file_range	566
+#define	SYS_MAXSYSCALL	567
@@ -404,4 +404,7 @@ MIASM =  \
 	kevent.o \
 	cpuset_getdomain.o \
 	cpuset_setdomain.o \
-	getrandom.o
+	getrandom.o \
+	recvmmsg.o \
+	sendmmsg.o \
+	copy_file_range.o
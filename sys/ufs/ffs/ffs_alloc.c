@@ -77,6 +77,8 @@ __FBSDID("$FreeBSD$");
 #include <sys/filedesc.h>
 #include <sys/priv.h>
 #include <sys/proc.h>
+#include <sys/sdt.h>
+#include <sys/smp.h>
 #include <sys/vnode.h>
 #include <sys/mount.h>
 #include <sys/kernel.h>
@@ -1577,6 +1579,10 @@ ffs_blkpref_ufs2(ip, lbn, indx, bap)
  * Must be called with the UFS lock held.  Will release the lock on success
  * and return with it held on failure.
  */
+static int cgspread = 1;
+SYSCTL_INT(_vfs_ffs, OID_AUTO, cgspread, CTLFLAG_RWTUN, &cgspread, 0,
+    "Start the cylinder group rehash at a per-CPU offset");
+
 /*VARARGS5*/
 static ufs2_daddr_t
 ffs_hashalloc(ip, cg, pref, size, rsize, allocator)
@@ -1603,6 +1609,21 @@ ffs_hashalloc(ip, cg, pref, size, rsize, allocator)
 	result = (*allocator)(ip, cg, pref, size, rsize);
 	if (result)
 		return (result);
+	/*
+	 * Writers whose preferred group is full would otherwise all
+	 * follow the same rehash sequence and contend for the same
+	 * cylinder group buffers.  Spread them out by CPU, probing the
+	 * new starting group here since steps 2 and 3 skip it.
+	 */
+	if (cgspread && mp_ncpus > 1 && fs->fs_ncg > 1) {
+		cg = (cg + PCPU_GET(cpuid)) % fs->fs_ncg;
+		if (cg != icg) {
+			icg = cg;
+			result = (*allocator)(ip, cg, 0, size, rsize);
+			if (result)
+				return (result);
+		}
+	}
 	/*
 	 * 2: quadratic rehash
 	 */
@@ -2899,8 +2920,14 @@ ffs_getmntstat(struct vnode *devvp)
 	return (ffs_getmntstat(VFSTOUFS(devvp->v_mount)->um_devvp));
 }
 
+SDT_PROVIDER_DEFINE(ffs);
+SDT_PROBE_DEFINE2(ffs, , getcg, start, "struct fs *", "u_int");
+SDT_PROBE_DEFINE3(ffs, , getcg, done, "struct fs *", "u_int", "int");
+
 /*
- * Fetch and verify a cylinder group.
+ * Fetch and verify a cylinder group.  The getcg start and done probes
+ * bracket the buffer lookup, so that time spent waiting for a busy or
+ * uncached cylinder group buffer can be measured.
  */
 int
 ffs_getcg(fs, devvp, cg, bpp, cgpp)
@@ -2920,10 +2947,12 @@ ffs_getcg(fs, devvp, cg, bpp, cgpp)
 	flags = 0;
 	if ((fs->fs_metackhash & CK_CYLGRP) != 0)
 		flags |= GB_CKHASH;
+	SDT_PROBE2(ffs, , getcg, start, fs, cg);
 	error = breadn_flags(devvp, devvp->v_type == VREG ?
 	    fragstoblks(fs, cgtod(fs, cg)) : fsbtodb(fs, cgtod(fs, cg)),
 	    (int)fs->fs_cgsize, NULL, NULL, 0, NOCRED, flags,
 	    ffs_ckhash_cg, &bp);
+	SDT_PROBE3(ffs, , getcg, done, fs, cg, error);
 	if (error != 0)
 		return (error);
 	cgp = (struct cg *)bp->b_data;
@@ -629,11 +629,17 @@ static SYSCTL_NODE(_debug_softdep, OID_AUTO, current, CTLFLAG_RW, 0,
     "current dependencies allocated");
 static SYSCTL_NODE(_debug_softdep, OID_AUTO, write, CTLFLAG_RW, 0,
     "current dependencies written");
+static SYSCTL_NODE(_debug_softdep, OID_AUTO, process, CTLFLAG_RW, 0,
+    "worklist items processed");
+static SYSCTL_NODE(_debug_softdep, OID_AUTO, proctime, CTLFLAG_RW, 0,
+    "time spent processing worklist items (us)");
 
 unsigned long dep_current[D_LAST + 1];
 unsigned long dep_highuse[D_LAST + 1];
 unsigned long dep_total[D_LAST + 1];
 unsigned long dep_write[D_LAST + 1];
+unsigned long dep_process[D_LAST + 1];
+unsigned long dep_proctime[D_LAST + 1];
 
 #define	SOFTDEP_TYPE(type, str, long)					\
     static MALLOC_DEFINE(M_ ## type, #str, long);			\
@@ -644,7 +650,11 @@ unsigned long dep_write[D_LAST + 1];
     SYSCTL_ULONG(_debug_softdep_highuse, OID_AUTO, str, CTLFLAG_RD, 	\
 	&dep_highuse[D_ ## type], 0, "");				\
     SYSCTL_ULONG(_debug_softdep_write, OID_AUTO, str, CTLFLAG_RD, 	\
-	&dep_write[D_ ## type], 0, "");
+	&dep_write[D_ ## type], 0, "");					\
+    SYSCTL_ULONG(_debug_softdep_process, OID_AUTO, str, CTLFLAG_RD, 	\
+	&dep_process[D_ ## type], 0, "");				\
+    SYSCTL_ULONG(_debug_softdep_proctime, OID_AUTO, str, CTLFLAG_RD, 	\
+	&dep_proctime[D_ ## type], 0, "");
 
 SOFTDEP_TYPE(PAGEDEP, pagedep, "File page dependencies"); 
 SOFTDEP_TYPE(INODEDEP, inodedep, "Inode dependencies");
@@ -1762,8 +1772,9 @@ process_worklist_item(mp, target, flags)
 	struct worklist sentinel;
 	struct worklist *wk;
 	struct ufsmount *ump;
+	sbintime_t start;
 	int matchcnt;
-	int error;
+	int error, type;
 
 	KASSERT(mp != NULL, ("process_worklist_item: NULL mp"));
 	/*
@@ -1795,7 +1806,10 @@ process_worklist_item(mp, target, flags)
 		FREE_LOCK(ump);
 		if (vn_start_secondary_write(NULL, &mp, V_NOWAIT))
 			panic("process_worklist_item: suspended filesystem");
-		switch (wk->wk_type) {
+		/* The handlers may free wk, so remember its type. */
+		type = wk->wk_type;
+		start = sbinuptime();
+		switch (type) {
 		case D_DIRREM:
 			/* removal of a directory entry */
 			error = handle_workitem_remove(WK_DIRREM(wk), flags);
@@ -1824,6 +1838,9 @@ process_worklist_item(mp, target, flags)
 			    "softdep", TYPENAME(wk->wk_type));
 			/* NOTREACHED */
 		}
+		atomic_add_long(&dep_process[type], 1);
+		atomic_add_long(&dep_proctime[type],
+		    (sbinuptime() - start) / SBT_1US);
 		vn_finished_secondary_write(mp);
 		ACQUIRE_LOCK(ump);
 		if (error == 0) {
@@ -69,9 +69,15 @@
  * candidates is much larger than the configured memry limit). In this
  * case it limits the number of hash builds to 1/DH_SCOREINIT of the
  * number of accesses.
+ *
+ * Large directories are expensive to rehash, so a new hash also gets
+ * one extra point of initial score for every DH_SCOREBLKS directory
+ * blocks it covers, up to DH_SCOREMAX.  Such hashes survive more
+ * recycling passes before being discarded.
  */ 
 #define	DH_SCOREINIT	8	/* initial dh_score when dirhash built */
 #define	DH_SCOREMAX	64	/* max dh_score value */
+#define	DH_SCOREBLKS	64	/* dir blocks per extra initial score */
 
 /*
  * The main hash table has 2 levels. It is an array of pointers to
@@ -92,6 +92,12 @@ static int ufsdirhash_set_reclaimpercent(SYSCTL_HANDLER_ARGS);
 SYSCTL_PROC(_vfs_ufs, OID_AUTO, dirhash_reclaimpercent,
     CTLTYPE_INT | CTLFLAG_RW, 0, 0, ufsdirhash_set_reclaimpercent, "I",
     "set percentage of dirhash cache to be removed in low VM events");
+static int ufs_dirhashbuilds;
+SYSCTL_INT(_vfs_ufs, OID_AUTO, dirhash_builds, CTLFLAG_RD,
+    &ufs_dirhashbuilds, 0, "number of dirhashes built");
+static int ufs_dirhashrecycled;
+SYSCTL_INT(_vfs_ufs, OID_AUTO, dirhash_recycled, CTLFLAG_RD,
+    &ufs_dirhashrecycled, 0, "number of dirhashes recycled to free memory");
 
 
 static int ufsdirhash_hash(struct dirhash *dh, char *name, int namelen);
@@ -409,7 +415,8 @@ ufsdirhash_build(struct inode *ip)
 	dh->dh_firstfree[DH_NFSTATS] = 0;
 	dh->dh_hused = 0;
 	dh->dh_seqoff = -1;
-	dh->dh_score = DH_SCOREINIT;
+	dh->dh_score = imin(DH_SCOREINIT + dirblocks / DH_SCOREBLKS,
+	    DH_SCOREMAX);
 	dh->dh_lastused = time_second;
 
 	/*
@@ -468,6 +475,7 @@ ufsdirhash_build(struct inode *ip)
 	DIRHASHLIST_LOCK();
 	TAILQ_INSERT_TAIL(&ufsdirhash_list, dh, dh_list);
 	dh->dh_onlist = 1;
+	ufs_dirhashbuilds++;
 	DIRHASHLIST_UNLOCK();
 	sx_downgrade(&dh->dh_lock);
 	return (0);
@@ -564,6 +572,14 @@ ufsdirhash_lookup(struct inode *ip, char *name, int namelen, doff_t *offp,
 	KASSERT(dh != NULL && dh->dh_hash != NULL,
 	    ("ufsdirhash_lookup: Invalid dirhash %p\n", dh));
 	DIRHASH_ASSERT_LOCKED(dh);
+	/*
+	 * A hash that is already at the maximum score and was used
+	 * within the last second gains nothing from another pass over
+	 * the list.  Skip the list lock, which is otherwise taken by
+	 * every lookup on every directory.  Both fields are only hints.
+	 */
+	if (dh->dh_score >= DH_SCOREMAX && dh->dh_lastused == time_second)
+		goto hinted;
 	/*
 	 * Move this dirhash towards the end of the list if it has a
 	 * score higher than the next entry, and acquire the dh_lock.
@@ -592,6 +608,7 @@ ufsdirhash_lookup(struct inode *ip, char *name, int namelen, doff_t *offp,
 	dh->dh_lastused = time_second;
 	DIRHASHLIST_UNLOCK();
 
+hinted:
 	vp = ip->i_vnode;
 	bmask = vp->v_mount->mnt_stat.f_iosize - 1;
 	blkoff = -1;
@@ -1238,6 +1255,7 @@ ufsdirhash_recycle(int wanted)
 		}
 
 		ufsdirhash_destroy(dh);
+		ufs_dirhashrecycled++;
 
 		/* Repeat if necessary. */
 		dh = TAILQ_FIRST(&ufsdirhash_list);
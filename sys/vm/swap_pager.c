@@ -96,6 +96,7 @@ __FBSDID("$FreeBSD$");
 #include <sys/sbuf.h>
 #include <sys/sysctl.h>
 #include <sys/sysproto.h>
+#include <sys/time.h>
 #include <sys/blist.h>
 #include <sys/lock.h>
 #include <sys/sx.h>
@@ -326,14 +327,20 @@ static int swap_pager_full = 2;	/* swap space exhaustion (task killing) */
 static int swap_pager_almost_full = 1; /* swap space exhaustion (w/hysteresis)*/
 static int nsw_rcount;		/* free read buffers			*/
 static int nsw_wcount_sync;	/* limit write buffers / synchronous	*/
-static int nsw_wcount_async;	/* limit write buffers / asynchronous	*/
-static int nsw_wcount_async_max;/* assigned maximum			*/
+static int nsw_wcount_async_max;/* limit async writes per device	*/
 static int nsw_cluster_max;	/* maximum VOP I/O allowed		*/
 
 static int sysctl_swap_async_max(SYSCTL_HANDLER_ARGS);
 SYSCTL_PROC(_vm, OID_AUTO, swap_async_max, CTLTYPE_INT | CTLFLAG_RW |
     CTLFLAG_MPSAFE, NULL, 0, sysctl_swap_async_max, "I",
-    "Maximum running async swap ops");
+    "Maximum running async swap ops per device");
+static int swap_prefer_fast = 0;
+SYSCTL_INT(_vm, OID_AUTO, swap_prefer_fast, CTLFLAG_RWTUN, &swap_prefer_fast,
+    0, "Allocate swap from the device with the lowest write latency first");
+static int sysctl_swap_latency(SYSCTL_HANDLER_ARGS);
+SYSCTL_PROC(_vm, OID_AUTO, swap_latency, CTLTYPE_STRING | CTLFLAG_RD |
+    CTLFLAG_MPSAFE, NULL, 0, sysctl_swap_latency, "A",
+    "Swap I/O latency histograms by device");
 static int sysctl_swap_fragmentation(SYSCTL_HANDLER_ARGS);
 SYSCTL_PROC(_vm, OID_AUTO, swap_fragmentation, CTLTYPE_STRING | CTLFLAG_RD |
     CTLFLAG_MPSAFE, NULL, 0, sysctl_swap_fragmentation, "A",
@@ -526,24 +533,19 @@ swap_pager_swap_init(void)
 	 * MAX_PAGEOUT_CLUSTER.   Also be aware that swap ops are
 	 * constrained by the swap device interleave stripe size.
 	 *
-	 * Currently we hardwire nsw_wcount_async to 4.  This limit is
+	 * Currently we hardwire nsw_wcount_async_max to 4.  This limit is
 	 * designed to prevent other I/O from having high latencies due to
-	 * our pageout I/O.  The value 4 works well for one or two active swap
-	 * devices but is probably a little low if you have more.  Even so,
-	 * a higher value would probably generate only a limited improvement
-	 * with three or four active swap devices since the system does not
-	 * typically have to pageout at extreme bandwidths.   We will want
-	 * at least 2 per swap devices, and 4 is a pretty good value if you
-	 * have one NFS swap device due to the command/ack latency over NFS.
-	 * So it all works out pretty well.
+	 * our pageout I/O.  It applies to each swap device separately, so
+	 * that a slow device saturated with pageouts does not hold back
+	 * writes to a fast one.  4 is a pretty good value even if you have
+	 * an NFS swap device due to the command/ack latency over NFS.
 	 */
 	nsw_cluster_max = min((MAXPHYS/PAGE_SIZE), MAX_PAGEOUT_CLUSTER);
 
 	mtx_lock(&pbuf_mtx);
 	nsw_rcount = (nswbuf + 1) / 2;
 	nsw_wcount_sync = (nswbuf + 3) / 4;
-	nsw_wcount_async = 4;
-	nsw_wcount_async_max = nsw_wcount_async;
+	nsw_wcount_async_max = 4;
 	mtx_unlock(&pbuf_mtx);
 
 	/*
@@ -723,11 +725,35 @@ static daddr_t
 swp_pager_getswapspace(int npages)
 {
 	daddr_t blk;
-	struct swdevt *sp;
+	struct swdevt *best, *sp;
 	int i;
 
 	blk = SWAPBLK_NONE;
 	mtx_lock(&sw_dev_mtx);
+
+	/*
+	 * If requested, first try the device that has been completing
+	 * writes fastest, falling back to round-robin if it is full.
+	 */
+	if (swap_prefer_fast) {
+		best = NULL;
+		TAILQ_FOREACH(sp, &swtailq, sw_list) {
+			if ((sp->sw_flags & SW_CLOSING) == 0 &&
+			    (best == NULL || sp->sw_wlat < best->sw_wlat))
+				best = sp;
+		}
+		if (best != NULL) {
+			blk = blist_alloc(best->sw_blist, npages);
+			if (blk != SWAPBLK_NONE) {
+				blk += best->sw_first;
+				best->sw_used += npages;
+				swap_pager_avail -= npages;
+				swp_sizecheck();
+				goto done;
+			}
+		}
+	}
+
 	sp = swdevhd;
 	for (i = 0; i < nswapdev; i++) {
 		if (sp == NULL)
@@ -763,6 +789,44 @@ swp_pager_isondev(daddr_t blk, struct swdevt *sp)
 	return (blk >= sp->sw_first && blk < sp->sw_end);
 }
 
+/*
+ * Returns a free-running microsecond clock for I/O latency measurement.
+ * It wraps, but differences remain correct for any realistic latency.
+ */
+static u_int
+swp_pager_usecs(void)
+{
+
+	return ((u_int)(sbinuptime() / SBT_1US));
+}
+
+/*
+ * Wait for an asynchronous write slot on the device holding "blk".  Each
+ * device has its own limit, so a slow device does not hold back writes to
+ * the others.  The slot is released by swp_pager_async_iodone().
+ *
+ * The device cannot go away while we sleep, since swapoff waits for the
+ * swap space that the caller has allocated on it to be freed.
+ */
+static void
+swp_pager_wqueue_enter(daddr_t blk)
+{
+	struct swdevt *sp;
+
+	mtx_lock(&sw_dev_mtx);
+	TAILQ_FOREACH(sp, &swtailq, sw_list) {
+		if (swp_pager_isondev(blk, sp)) {
+			while (sp->sw_wcount_async >= nsw_wcount_async_max)
+				msleep(&sp->sw_wcount_async, &sw_dev_mtx, PVM,
+				    "swwrtq", 0);
+			sp->sw_wcount_async++;
+			mtx_unlock(&sw_dev_mtx);
+			return;
+		}
+	}
+	panic("Swapdev not found");
+}
+
 static void
 swp_pager_strategy(struct buf *bp)
 {
@@ -772,6 +836,12 @@ swp_pager_strategy(struct buf *bp)
 	TAILQ_FOREACH(sp, &swtailq, sw_list) {
 		if (bp->b_blkno >= sp->sw_first && bp->b_blkno < sp->sw_end) {
 			mtx_unlock(&sw_dev_mtx);
+			/*
+			 * Record the device and the start time for
+			 * swp_pager_async_iodone().
+			 */
+			bp->b_fsprivate1 = sp;
+			bp->b_fsprivate2 = (void *)(uintptr_t)swp_pager_usecs();
 			if ((sp->sw_flags & SW_UNMAPPED) != 0 &&
 			    unmapped_buf_allowed) {
 				bp->b_data = unmapped_buf;
@@ -854,6 +924,50 @@ sysctl_swap_fragmentation(SYSCTL_HANDLER_ARGS)
 	return (error);
 }
 
+/*
+ * SYSCTL_SWAP_LATENCY() -	produce swap I/O latency histograms
+ */
+static int
+sysctl_swap_latency(SYSCTL_HANDLER_ARGS)
+{
+	struct sbuf sbuf;
+	struct swdevt *sp;
+	const char *devname;
+	int error, i;
+
+	error = sysctl_wire_old_buffer(req, 0);
+	if (error != 0)
+		return (error);
+	sbuf_new_for_sysctl(&sbuf, NULL, 128, req);
+	mtx_lock(&sw_dev_mtx);
+	TAILQ_FOREACH(sp, &swtailq, sw_list) {
+		if (vn_isdisk(sp->sw_vp, NULL))
+			devname = devtoname(sp->sw_vp->v_rdev);
+		else
+			devname = "[file]";
+		sbuf_printf(&sbuf, "\nDevice %s: %u usecs/page average "
+		    "write latency, %u async writes in progress\n",
+		    devname, sp->sw_wlat, sp->sw_wcount_async);
+		sbuf_printf(&sbuf, "%10s %12s %12s\n", "usecs <", "reads",
+		    "writes");
+		for (i = 0; i < SW_LAT_NBUCKETS; i++) {
+			if (sp->sw_rlat_hist[i] == 0 &&
+			    sp->sw_wlat_hist[i] == 0)
+				continue;
+			if (i == SW_LAT_NBUCKETS - 1)
+				sbuf_printf(&sbuf, "%10s", "inf");
+			else
+				sbuf_printf(&sbuf, "%10u", 1u << i);
+			sbuf_printf(&sbuf, " %12lu %12lu\n",
+			    sp->sw_rlat_hist[i], sp->sw_wlat_hist[i]);
+		}
+	}
+	mtx_unlock(&sw_dev_mtx);
+	error = sbuf_finish(&sbuf);
+	sbuf_delete(&sbuf);
+	return (error);
+}
+
 /*
  * SWAP_PAGER_FREESPACE() -	frees swap blocks associated with a page
  *				range within an object.
@@ -1409,7 +1523,8 @@ swap_pager_putpages(vm_object_t object, vm_page_t *ma, int count,
 		if (sync == TRUE) {
 			bp = getpbuf(&nsw_wcount_sync);
 		} else {
-			bp = getpbuf(&nsw_wcount_async);
+			swp_pager_wqueue_enter(blk);
+			bp = getpbuf(NULL);
 			bp->b_flags = B_ASYNC;
 		}
 		bp->b_flags |= B_PAGING;
@@ -1501,6 +1616,8 @@ swap_pager_putpages(vm_object_t object, vm_page_t *ma, int count,
 static void
 swp_pager_async_iodone(struct buf *bp)
 {
+	struct swdevt *sp;
+	u_int usecs;
 	int i;
 	vm_object_t object = NULL;
 
@@ -1518,6 +1635,28 @@ swp_pager_async_iodone(struct buf *bp)
 		);
 	}
 
+	/*
+	 * Account for the I/O latency and release the device's async
+	 * write slot.  This must be done before the pages are unbusied,
+	 * since a swapoff may free the device after that.
+	 */
+	sp = bp->b_fsprivate1;
+	usecs = swp_pager_usecs() - (u_int)(uintptr_t)bp->b_fsprivate2;
+	i = min(fls(usecs), SW_LAT_NBUCKETS - 1);
+	mtx_lock(&sw_dev_mtx);
+	if (bp->b_iocmd == BIO_READ)
+		sp->sw_rlat_hist[i]++;
+	else {
+		sp->sw_wlat_hist[i]++;
+		if (bp->b_npages > 0)
+			sp->sw_wlat = (sp->sw_wlat * 7 +
+			    usecs / bp->b_npages) / 8;
+		if ((bp->b_flags & B_ASYNC) != 0 &&
+		    sp->sw_wcount_async-- == nsw_wcount_async_max)
+			wakeup(&sp->sw_wcount_async);
+	}
+	mtx_unlock(&sw_dev_mtx);
+
 	/*
 	 * remove the mapping for kernel virtual
 	 */
@@ -1638,7 +1777,7 @@ swp_pager_async_iodone(struct buf *bp)
 	    bp,
 	    ((bp->b_iocmd == BIO_READ) ? &nsw_rcount :
 		((bp->b_flags & B_ASYNC) ?
-		    &nsw_wcount_async :
+		    NULL :
 		    &nsw_wcount_sync
 		)
 	    )
@@ -2870,7 +3009,8 @@ swaponvp(struct thread *td, struct vnode *vp, u_long nblks)
 static int
 sysctl_swap_async_max(SYSCTL_HANDLER_ARGS)
 {
-	int error, new, n;
+	struct swdevt *sp;
+	int error, new;
 
 	new = nsw_wcount_async_max;
 	error = sysctl_handle_int(oidp, &new, 0, req);
@@ -2880,26 +3020,15 @@ sysctl_swap_async_max(SYSCTL_HANDLER_ARGS)
 	if (new > nswbuf / 2 || new < 1)
 		return (EINVAL);
 
-	mtx_lock(&pbuf_mtx);
-	while (nsw_wcount_async_max != new) {
-		/*
-		 * Adjust difference.  If the current async count is too low,
-		 * we will need to sqeeze our update slowly in.  Sleep with a
-		 * higher priority than getpbuf() to finish faster.
-		 */
-		n = new - nsw_wcount_async_max;
-		if (nsw_wcount_async + n >= 0) {
-			nsw_wcount_async += n;
-			nsw_wcount_async_max += n;
-			wakeup(&nsw_wcount_async);
-		} else {
-			nsw_wcount_async_max -= nsw_wcount_async;
-			nsw_wcount_async = 0;
-			msleep(&nsw_wcount_async, &pbuf_mtx, PSWP,
-			    "swpsysctl", 0);
-		}
-	}
-	mtx_unlock(&pbuf_mtx);
+	/*
+	 * Devices already above a lowered limit drain on their own; writers
+	 * waiting for a raised limit are woken up.
+	 */
+	mtx_lock(&sw_dev_mtx);
+	nsw_wcount_async_max = new;
+	TAILQ_FOREACH(sp, &swtailq, sw_list)
+		wakeup(&sp->sw_wcount_async);
+	mtx_unlock(&sw_dev_mtx);
 
 	return (0);
 }
@@ -47,6 +47,12 @@ typedef	int32_t	swblk_t;	/*
 				 * 2^32 pages.
 				 */
 
+/*
+ * Number of log2(microseconds) buckets in the per-device I/O latency
+ * histograms.  The last bucket collects everything above ~0.5 seconds.
+ */
+#define	SW_LAT_NBUCKETS	20
+
 struct buf;
 struct swdevt;
 typedef void sw_strategy_t(struct buf *, struct swdevt *);
@@ -68,6 +74,10 @@ struct swdevt {
 	TAILQ_ENTRY(swdevt)	sw_list;
 	sw_strategy_t		*sw_strategy;
 	sw_close_t		*sw_close;
+	u_int	sw_wcount_async;	/* async writes in progress */
+	u_int	sw_wlat;		/* average write latency, usecs/page */
+	u_long	sw_rlat_hist[SW_LAT_NBUCKETS];	/* read latencies */
+	u_long	sw_wlat_hist[SW_LAT_NBUCKETS];	/* write latencies */
 };
 
 #define	SW_UNMAPPED	0x01
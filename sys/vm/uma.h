@@ -334,6 +334,24 @@ void uma_zdestroy(uma_zone_t zone);
 void *uma_zalloc_arg(uma_zone_t zone, void *arg, int flags);
 void *uma_zalloc_pcpu_arg(uma_zone_t zone, void *arg, int flags);
 
+/*
+ * Allocates several items out of a zone
+ *
+ * Arguments:
+ *	zone  The zone we are allocating from
+ *	items Array receiving the items
+ *	count The number of items wanted
+ *	arg   This data is passed to the ctor function
+ *	flags See sys/malloc.h for available flags.
+ *
+ * Returns:
+ *	The number of items stored in items, which may be less than count
+ *	if M_NOWAIT was passed and the zone ran dry or a ctor failed.  Items
+ *	are taken out of the per-CPU cache a bucket at a time.
+ */
+int uma_zalloc_bulk(uma_zone_t zone, void **items, int count, void *arg,
+    int flags);
+
 /*
  * Allocate an item from a specific NUMA domain.  This uses a slow path in
  * the allocator but is guaranteed to allocate memory from the requested
@@ -383,6 +401,20 @@ uma_zalloc_pcpu(uma_zone_t zone, int flags)
 void uma_zfree_arg(uma_zone_t zone, void *item, void *arg);
 void uma_zfree_pcpu_arg(uma_zone_t zone, void *item, void *arg);
 
+/*
+ * Frees several items back into the specified zone.
+ *
+ * Arguments:
+ *	zone  The zone the items were originally allocated out of.
+ *	items The items to be freed, NULL entries are skipped.
+ *	count The number of entries in items.
+ *	arg   Argument passed to the destructor
+ *
+ * Returns:
+ *	Nothing.  The contents of items are clobbered.
+ */
+void uma_zfree_bulk(uma_zone_t zone, void **items, int count, void *arg);
+
 /*
  * Frees an item back to the specified zone's domain specific pool.
  *
@@ -692,7 +724,8 @@ struct uma_type_header {
 	uint64_t	uth_frees;	/* Zone: number of frees. */
 	uint64_t	uth_fails;	/* Zone: number of alloc failures. */
 	uint64_t	uth_sleeps;	/* Zone: number of alloc sleeps. */
-	uint64_t	_uth_reserved1[2];	/* Reserved. */
+	uint64_t	uth_xfers;	/* Zone: buckets passed between CPUs. */
+	uint64_t	uth_lockfails;	/* Zone: contended lock acquisitions. */
 };
 
 struct uma_percpu_stat {
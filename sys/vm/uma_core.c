@@ -254,6 +254,8 @@ static void uma_timeout(void *);
 static void uma_startup3(void);
 static void *zone_alloc_item(uma_zone_t, void *, int, int);
 static void zone_free_item(uma_zone_t, void *, void *, enum zfreeskip);
+static void *zone_ctor_item(uma_zone_t, void *, void *, int);
+static void zone_free_cached(uma_zone_t, void *, void *);
 static void bucket_enable(void);
 static void bucket_init(void);
 static uma_bucket_t bucket_alloc(uma_zone_t zone, void *, int);
@@ -677,6 +679,49 @@ hash_free(struct uma_hash *hash)
  *	Nothing
  */
 
+/*
+ * Each zone domain has a single slot through which a full bucket can be
+ * passed from a freeing CPU to an allocating one without the zone lock.
+ * This is the common producer/consumer split, e.g. mbufs allocated by a
+ * receive thread and freed by transmit completion on another CPU, which
+ * would otherwise take the zone lock for every bucket in both directions.
+ */
+static inline uma_zone_domain_t
+zone_domain_cur(uma_zone_t zone)
+{
+	int domain;
+
+	if ((zone->uz_flags & UMA_ZONE_NUMA) == 0)
+		return (&zone->uz_domain[0]);
+	domain = PCPU_GET(domain);
+	if (VM_DOMAIN_EMPTY(domain))
+		domain = 0;
+	return (&zone->uz_domain[domain]);
+}
+
+static inline bool
+zone_xbucket_give(uma_zone_domain_t zdom, uma_bucket_t bucket)
+{
+
+	return (zdom->uzd_xbucket == NULL &&
+	    atomic_cmpset_rel_ptr((volatile uintptr_t *)&zdom->uzd_xbucket,
+	    (uintptr_t)NULL, (uintptr_t)bucket));
+}
+
+static inline uma_bucket_t
+zone_xbucket_take(uma_zone_domain_t zdom)
+{
+	uma_bucket_t bucket;
+
+	do {
+		bucket = zdom->uzd_xbucket;
+		if (bucket == NULL)
+			return (NULL);
+	} while (!atomic_cmpset_acq_ptr((volatile uintptr_t *)&zdom->uzd_xbucket,
+	    (uintptr_t)bucket, (uintptr_t)NULL));
+	return (bucket);
+}
+
 static void
 bucket_drain(uma_zone_t zone, uma_bucket_t bucket)
 {
@@ -849,6 +894,12 @@ bucket_cache_drain(uma_zone_t zone)
 			bucket_free(zone, bucket, NULL);
 			ZONE_LOCK(zone);
 		}
+		if ((bucket = zone_xbucket_take(zdom)) != NULL) {
+			ZONE_UNLOCK(zone);
+			bucket_drain(zone, bucket);
+			bucket_free(zone, bucket, NULL);
+			ZONE_LOCK(zone);
+		}
 	}
 
 	/*
@@ -2359,9 +2410,6 @@ uma_zalloc_arg(uma_zone_t zone, void *udata, int flags)
 	uma_cache_t cache;
 	void *item;
 	int cpu, domain, lockfail;
-#ifdef INVARIANTS
-	bool skipdbg;
-#endif
 
 	/* Enable entropy collection for RANDOM_ENABLE_UMA kernel option */
 	random_harvest_fast_uma(&zone, sizeof(zone), RANDOM_UMA);
@@ -2425,26 +2473,7 @@ uma_zalloc_arg(uma_zone_t zone, void *udata, int flags)
 		KASSERT(item != NULL, ("uma_zalloc: Bucket pointer mangled."));
 		cache->uc_allocs++;
 		critical_exit();
-#ifdef INVARIANTS
-		skipdbg = uma_dbg_zskip(zone, item);
-#endif
-		if (zone->uz_ctor != NULL &&
-#ifdef INVARIANTS
-		    (!skipdbg || zone->uz_ctor != trash_ctor ||
-		    zone->uz_dtor != trash_dtor) &&
-#endif
-		    zone->uz_ctor(item, zone->uz_size, udata, flags) != 0) {
-			atomic_add_long(&zone->uz_fails, 1);
-			zone_free_item(zone, item, udata, SKIP_DTOR);
-			return (NULL);
-		}
-#ifdef INVARIANTS
-		if (!skipdbg)
-			uma_dbg_alloc(zone, NULL, item);
-#endif
-		if (flags & M_ZERO)
-			uma_zero_item(item, zone);
-		return (item);
+		return (zone_ctor_item(zone, item, udata, flags));
 	}
 
 	/*
@@ -2481,6 +2510,29 @@ uma_zalloc_arg(uma_zone_t zone, void *udata, int flags)
 	if (zone->uz_count == 0 || bucketdisable)
 		goto zalloc_item;
 
+	/*
+	 * A full bucket freed on another CPU may be waiting in the handoff
+	 * slot; take it without the zone lock.
+	 */
+	zdom = zone_domain_cur(zone);
+	if ((bucket = zone_xbucket_take(zdom)) != NULL) {
+		critical_enter();
+		cpu = curcpu;
+		cache = &zone->uz_cpu[cpu];
+		if (cache->uc_allocbucket == NULL) {
+			cache->uc_allocbucket = bucket;
+			goto zalloc_start;
+		}
+		critical_exit();
+		ZONE_LOCK(zone);
+		LIST_INSERT_HEAD(&zdom->uzd_buckets, bucket, ub_link);
+		ZONE_UNLOCK(zone);
+		critical_enter();
+		cpu = curcpu;
+		cache = &zone->uz_cpu[cpu];
+		goto zalloc_start;
+	}
+
 	/*
 	 * Attempt to retrieve the item from the per-CPU cache has failed, so
 	 * we must go back to the zone.  This requires the zone lock, so we
@@ -2495,6 +2547,7 @@ uma_zalloc_arg(uma_zone_t zone, void *udata, int flags)
 		/* Record contention to size the buckets. */
 		ZONE_LOCK(zone);
 		lockfail = 1;
+		zone->uz_lockfails++;
 	}
 	critical_enter();
 	cpu = curcpu;
@@ -2570,6 +2623,126 @@ uma_zalloc_arg(uma_zone_t zone, void *udata, int flags)
 	return (item);
 }
 
+/*
+ * Run the constructor and debugging hooks on an item just taken out of a
+ * per-CPU bucket.  On failure the item is released and NULL returned.
+ */
+static void *
+zone_ctor_item(uma_zone_t zone, void *item, void *udata, int flags)
+{
+#ifdef INVARIANTS
+	bool skipdbg;
+
+	skipdbg = uma_dbg_zskip(zone, item);
+#endif
+	if (zone->uz_ctor != NULL &&
+#ifdef INVARIANTS
+	    (!skipdbg || zone->uz_ctor != trash_ctor ||
+	    zone->uz_dtor != trash_dtor) &&
+#endif
+	    zone->uz_ctor(item, zone->uz_size, udata, flags) != 0) {
+		atomic_add_long(&zone->uz_fails, 1);
+		zone_free_item(zone, item, udata, SKIP_DTOR);
+		return (NULL);
+	}
+#ifdef INVARIANTS
+	if (!skipdbg)
+		uma_dbg_alloc(zone, NULL, item);
+#endif
+	if (flags & M_ZERO)
+		uma_zero_item(item, zone);
+	return (item);
+}
+
+/* See uma.h */
+int
+uma_zalloc_bulk(uma_zone_t zone, void **items, int count, void *udata,
+    int flags)
+{
+	uma_bucket_t bucket;
+	uma_cache_t cache;
+	void *item;
+	int end, i, n, take;
+
+	random_harvest_fast_uma(&zone, sizeof(zone), RANDOM_UMA);
+
+	CTR5(KTR_UMA, "uma_zalloc_bulk thread %x zone %s(%p) count %d flags %d",
+	    curthread, zone->uz_name, zone, count, flags);
+
+	if (flags & M_WAITOK) {
+		WITNESS_WARN(WARN_GIANTOK | WARN_SLEEPOK, NULL,
+		    "uma_zalloc_bulk: zone \"%s\"", zone->uz_name);
+	}
+	KASSERT(curthread->td_critnest == 0 || SCHEDULER_STOPPED(),
+	    ("uma_zalloc_bulk: called with spinlock or critical section held"));
+	KASSERT(count >= 0, ("uma_zalloc_bulk: negative count %d", count));
+
+	n = 0;
+#ifdef DEBUG_MEMGUARD
+	if (memguard_cmp_zone(zone))
+		goto zalloc_single;
+#endif
+	while (n < count) {
+		/*
+		 * Take as many items as the current allocation bucket
+		 * holds in one critical section, swapping in the free
+		 * bucket when it runs dry.
+		 */
+		critical_enter();
+		cache = &zone->uz_cpu[curcpu];
+		bucket = cache->uc_allocbucket;
+		if ((bucket == NULL || bucket->ub_cnt == 0) &&
+		    cache->uc_freebucket != NULL &&
+		    cache->uc_freebucket->ub_cnt > 0) {
+			cache->uc_allocbucket = cache->uc_freebucket;
+			cache->uc_freebucket = bucket;
+			bucket = cache->uc_allocbucket;
+		}
+		if (bucket == NULL || bucket->ub_cnt == 0) {
+			critical_exit();
+			/*
+			 * Let the single item path refill the cache from
+			 * the zone, then come back for the rest.
+			 */
+			item = uma_zalloc_arg(zone, udata, flags);
+			if (item == NULL)
+				break;
+			items[n++] = item;
+			continue;
+		}
+		take = min(count - n, bucket->ub_cnt);
+		bucket->ub_cnt -= take;
+		bcopy(&bucket->ub_bucket[bucket->ub_cnt], &items[n],
+		    take * sizeof(void *));
+#ifdef INVARIANTS
+		bzero(&bucket->ub_bucket[bucket->ub_cnt],
+		    take * sizeof(void *));
+#endif
+		cache->uc_allocs += take;
+		critical_exit();
+
+		/* Compact over items whose constructor failed. */
+		for (i = n, end = n + take; i < end; i++) {
+			KASSERT(items[i] != NULL,
+			    ("uma_zalloc_bulk: Bucket pointer mangled."));
+			item = zone_ctor_item(zone, items[i], udata, flags);
+			if (item != NULL)
+				items[n++] = item;
+		}
+		if (n < i)
+			break;
+	}
+	return (n);
+
+#ifdef DEBUG_MEMGUARD
+zalloc_single:
+	for (; n < count; n++)
+		if ((items[n] = uma_zalloc_arg(zone, udata, flags)) == NULL)
+			break;
+	return (n);
+#endif
+}
+
 void *
 uma_zalloc_domain(uma_zone_t zone, void *udata, int domain, int flags)
 {
@@ -3038,10 +3211,6 @@ zone_alloc_item(uma_zone_t zone, void *udata, int domain, int flags)
 void
 uma_zfree_arg(uma_zone_t zone, void *item, void *udata)
 {
-	uma_cache_t cache;
-	uma_bucket_t bucket;
-	uma_zone_domain_t zdom;
-	int cpu, domain, lockfail;
 #ifdef INVARIANTS
 	bool skipdbg;
 #endif
@@ -3083,6 +3252,21 @@ uma_zfree_arg(uma_zone_t zone, void *item, void *udata)
 #endif
 		zone->uz_dtor(item, zone->uz_size, udata);
 
+	zone_free_cached(zone, item, udata);
+}
+
+/*
+ * Free an already destructed item through the per-CPU cache, going back
+ * to the zone for a fresh bucket if the cache is full.
+ */
+static void
+zone_free_cached(uma_zone_t zone, void *item, void *udata)
+{
+	uma_cache_t cache;
+	uma_bucket_t bucket;
+	uma_zone_domain_t zdom;
+	int cpu, domain, lockfail;
+
 	/*
 	 * The race here is acceptable.  If we miss it we'll just have to wait
 	 * a little longer for the limits to be reset.
@@ -3137,11 +3321,39 @@ uma_zfree_arg(uma_zone_t zone, void *item, void *udata)
 	if (zone->uz_count == 0 || bucketdisable)
 		goto zfree_item;
 
+	/*
+	 * Pass the full free bucket to an allocating CPU through the
+	 * handoff slot if it is empty, then carry on with a new bucket.
+	 */
+	if ((zone->uz_flags & UMA_ZONE_NOBUCKETCACHE) == 0) {
+		critical_enter();
+		cpu = curcpu;
+		cache = &zone->uz_cpu[cpu];
+		bucket = cache->uc_freebucket;
+		if (bucket != NULL && bucket->ub_cnt < bucket->ub_entries)
+			goto zfree_start;
+		if (bucket != NULL &&
+		    zone_xbucket_give(zone_domain_cur(zone), bucket)) {
+			cache->uc_freebucket = NULL;
+			critical_exit();
+			atomic_add_long(&zone->uz_xfers, 1);
+			if ((zone->uz_flags & UMA_ZONE_NUMA) != 0) {
+				domain = PCPU_GET(domain);
+				if (VM_DOMAIN_EMPTY(domain))
+					domain = UMA_ANYDOMAIN;
+			} else
+				domain = 0;
+			goto zfree_newbucket;
+		}
+		critical_exit();
+	}
+
 	lockfail = 0;
 	if (ZONE_TRYLOCK(zone) == 0) {
 		/* Record contention to size the buckets. */
 		ZONE_LOCK(zone);
 		lockfail = 1;
+		zone->uz_lockfails++;
 	}
 	critical_enter();
 	cpu = curcpu;
@@ -3162,7 +3374,7 @@ uma_zfree_arg(uma_zone_t zone, void *item, void *udata)
 			domain = UMA_ANYDOMAIN;
 	} else
 		domain = 0;
-	zdom = &zone->uz_domain[0];
+	zdom = zone_domain_cur(zone);
 
 	/* Can we throw this on the zone full list? */
 	if (bucket != NULL) {
@@ -3177,8 +3389,14 @@ uma_zfree_arg(uma_zone_t zone, void *item, void *udata)
 			bucket_drain(zone, bucket);
 			bucket_free(zone, bucket, udata);
 			goto zfree_restart;
-		} else
-			LIST_INSERT_HEAD(&zdom->uzd_buckets, bucket, ub_link);
+		}
+		LIST_INSERT_HEAD(&zdom->uzd_buckets, bucket, ub_link);
+		/*
+		 * With the handoff slot still occupied the allocating side
+		 * is not keeping up; larger buckets mean fewer handoffs.
+		 */
+		if (zdom->uzd_xbucket != NULL && zone->uz_count < BUCKET_MAX)
+			zone->uz_count++;
 	}
 
 	/*
@@ -3189,6 +3407,7 @@ uma_zfree_arg(uma_zone_t zone, void *item, void *udata)
 		zone->uz_count++;
 	ZONE_UNLOCK(zone);
 
+zfree_newbucket:
 	bucket = bucket_alloc(zone, udata, M_NOWAIT);
 	CTR3(KTR_UMA, "uma_zfree: zone %s(%p) allocated bucket %p",
 	    zone->uz_name, zone, bucket);
@@ -3220,6 +3439,92 @@ uma_zfree_arg(uma_zone_t zone, void *item, void *udata)
 	return;
 }
 
+/* See uma.h */
+void
+uma_zfree_bulk(uma_zone_t zone, void **items, int count, void *udata)
+{
+	uma_bucket_t bucket;
+	uma_cache_t cache;
+	void *item;
+	int i, n, put;
+#ifdef INVARIANTS
+	bool skipdbg;
+#endif
+
+	random_harvest_fast_uma(&zone, sizeof(zone), RANDOM_UMA);
+
+	CTR3(KTR_UMA, "uma_zfree_bulk thread %x zone %s count %d", curthread,
+	    zone->uz_name, count);
+
+	KASSERT(curthread->td_critnest == 0 || SCHEDULER_STOPPED(),
+	    ("uma_zfree_bulk: called with spinlock or critical section held"));
+
+	/* Destruct everything first, dropping NULL and memguard items. */
+	for (i = n = 0; i < count; i++) {
+		item = items[i];
+		if (item == NULL)
+			continue;
+#ifdef DEBUG_MEMGUARD
+		if (is_memguard_addr(item)) {
+			if (zone->uz_dtor != NULL)
+				zone->uz_dtor(item, zone->uz_size, udata);
+			if (zone->uz_fini != NULL)
+				zone->uz_fini(item, zone->uz_size);
+			memguard_free(item);
+			continue;
+		}
+#endif
+#ifdef INVARIANTS
+		skipdbg = uma_dbg_zskip(zone, item);
+		if (skipdbg == false) {
+			if (zone->uz_flags & UMA_ZONE_MALLOC)
+				uma_dbg_free(zone, udata, item);
+			else
+				uma_dbg_free(zone, NULL, item);
+		}
+		if (zone->uz_dtor != NULL && (!skipdbg ||
+		    zone->uz_dtor != trash_dtor ||
+		    zone->uz_ctor != trash_ctor))
+#else
+		if (zone->uz_dtor != NULL)
+#endif
+			zone->uz_dtor(item, zone->uz_size, udata);
+		items[n++] = item;
+	}
+	count = n;
+
+	for (n = 0; n < count;) {
+		if (zone->uz_flags & UMA_ZFLAG_FULL) {
+			zone_free_item(zone, items[n++], udata, SKIP_DTOR);
+			continue;
+		}
+		/*
+		 * Fill whatever room the two cached buckets have in one
+		 * critical section.
+		 */
+		critical_enter();
+		cache = &zone->uz_cpu[curcpu];
+		bucket = cache->uc_allocbucket;
+		if (bucket == NULL || bucket->ub_cnt >= bucket->ub_entries)
+			bucket = cache->uc_freebucket;
+		if (bucket == NULL || bucket->ub_cnt >= bucket->ub_entries) {
+			critical_exit();
+			/* Let the single item path cycle the full bucket. */
+			zone_free_cached(zone, items[n++], udata);
+			continue;
+		}
+		put = min(count - n, bucket->ub_entries - bucket->ub_cnt);
+		KASSERT(bucket->ub_bucket[bucket->ub_cnt] == NULL,
+		    ("uma_zfree_bulk: Freeing to non free bucket index."));
+		bcopy(&items[n], &bucket->ub_bucket[bucket->ub_cnt],
+		    put * sizeof(void *));
+		bucket->ub_cnt += put;
+		cache->uc_frees += put;
+		critical_exit();
+		n += put;
+	}
+}
+
 void
 uma_zfree_domain(uma_zone_t zone, void *item, void *udata)
 {
@@ -3978,11 +4283,15 @@ sysctl_vm_zone_stats(SYSCTL_HANDLER_ARGS)
 				LIST_FOREACH(bucket, &zdom->uzd_buckets,
 				    ub_link)
 					uth.uth_zone_free += bucket->ub_cnt;
+				if ((bucket = zdom->uzd_xbucket) != NULL)
+					uth.uth_zone_free += bucket->ub_cnt;
 			}
 			uth.uth_allocs = z->uz_allocs;
 			uth.uth_frees = z->uz_frees;
 			uth.uth_fails = z->uz_fails;
 			uth.uth_sleeps = z->uz_sleeps;
+			uth.uth_xfers = z->uz_xfers;
+			uth.uth_lockfails = z->uz_lockfails;
 			/*
 			 * While it is not normally safe to access the cache
 			 * bucket pointers while not on the CPU that owns the
@@ -4204,6 +4513,8 @@ DB_SHOW_COMMAND(uma, db_show_uma)
 				LIST_FOREACH(bucket, &zdom->uzd_buckets,
 				    ub_link)
 					cachefree += bucket->ub_cnt;
+				if ((bucket = zdom->uzd_xbucket) != NULL)
+					cachefree += bucket->ub_cnt;
 			}
 			db_printf("%18s %8ju %8jd %8d %12ju %8ju %8u\n",
 			    z->uz_name, (uintmax_t)kz->uk_size,
@@ -4231,6 +4542,8 @@ DB_SHOW_COMMAND(umacache, db_show_umacache)
 			zdom = &z->uz_domain[i];
 			LIST_FOREACH(bucket, &zdom->uzd_buckets, ub_link)
 				cachefree += bucket->ub_cnt;
+			if ((bucket = zdom->uzd_xbucket) != NULL)
+				cachefree += bucket->ub_cnt;
 		}
 		db_printf("%18s %8ju %8jd %8d %12ju %8u\n",
 		    z->uz_name, (uintmax_t)z->uz_size,
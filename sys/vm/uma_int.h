@@ -303,6 +303,7 @@ typedef struct uma_klink *uma_klink_t;
 
 struct uma_zone_domain {
 	LIST_HEAD(,uma_bucket)	uzd_buckets;	/* full buckets */
+	uma_bucket_t		uzd_xbucket;	/* lockless full bucket handoff */
 };
 
 typedef struct uma_zone_domain * uma_zone_domain_t;
@@ -356,6 +357,8 @@ struct uma_zone {
 	volatile u_long	uz_fails;	/* Total number of alloc failures */
 	volatile u_long	uz_frees;	/* Total number of frees */
 	uint64_t	uz_sleeps;	/* Total number of alloc sleeps */
+	volatile u_long	uz_xfers;	/* Full buckets passed between CPUs */
+	uint64_t	uz_lockfails;	/* Contended zone lock acquisitions */
 
 	/*
 	 * This HAS to be the last item because we adjust the zone size
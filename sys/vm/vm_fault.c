@@ -129,10 +129,15 @@ struct faultstate {
 	struct vnode *vp;
 };
 
+static int vm_fault_speculative = 1;
+SYSCTL_INT(_vm, OID_AUTO, fault_speculative, CTLFLAG_RWTUN,
+    &vm_fault_speculative, 0,
+    "Handle soft faults without acquiring the map lock");
+
 static void vm_fault_dontneed(const struct faultstate *fs, vm_offset_t vaddr,
 	    int ahead);
-static void vm_fault_prefault(const struct faultstate *fs, vm_offset_t addra,
-	    int backward, int forward, bool obj_locked);
+static vm_offset_t vm_fault_prefault(const struct faultstate *fs,
+	    vm_offset_t addra, int backward, int forward, bool obj_locked);
 
 static inline void
 release_page(struct faultstate *fs)
@@ -262,6 +267,89 @@ vm_fault_fill_hold(vm_page_t *m_hold, vm_page_t m)
 	}
 }
 
+#if (defined(__aarch64__) || defined(__amd64__) || (defined(__arm__) && \
+    __ARM_ARCH >= 6) || defined(__i386__) || defined(__riscv)) && \
+    VM_NRESERVLEVEL > 0
+/*
+ * Returns the first page of the reservation containing "m" if that
+ * reservation is fully populated and can be mapped at "vaddr" by a single
+ * superpage mapping within the map entry.  Returns NULL otherwise.  The
+ * first object must be locked.
+ */
+static vm_page_t
+vm_fault_superpage(const struct faultstate *fs, vm_offset_t vaddr,
+    vm_page_t m, vm_prot_t prot, int *fault_type)
+{
+	vm_page_t m_super;
+	int flags;
+
+	if ((m->flags & PG_FICTITIOUS) != 0 ||
+	    (m_super = vm_reserv_to_superpage(m)) == NULL ||
+	    rounddown2(vaddr, pagesizes[m_super->psind]) < fs->entry->start ||
+	    roundup2(vaddr + 1, pagesizes[m_super->psind]) > fs->entry->end ||
+	    (vaddr & (pagesizes[m_super->psind] - 1)) != (VM_PAGE_TO_PHYS(m) &
+	    (pagesizes[m_super->psind] - 1)) ||
+	    !pmap_ps_enabled(fs->map->pmap))
+		return (NULL);
+	flags = PS_ALL_VALID;
+	if ((prot & VM_PROT_WRITE) != 0) {
+		/*
+		 * Create a superpage mapping allowing write access
+		 * only if none of the constituent pages are busy and
+		 * all of them are already dirty (except possibly for
+		 * the page that was faulted on).
+		 */
+		flags |= PS_NONE_BUSY;
+		if ((fs->first_object->flags & OBJ_UNMANAGED) == 0)
+			flags |= PS_ALL_DIRTY;
+	}
+	if (!vm_page_ps_test(m_super, flags, m))
+		return (NULL);
+	/* Preset the modified bit for dirty superpages. */
+	if ((flags & PS_ALL_DIRTY) != 0)
+		*fault_type |= VM_PROT_WRITE;
+	return (m_super);
+}
+#endif
+
+/*
+ * Returns the number of pages to prefault ahead of a soft fault at "vaddr".
+ * A fault at the address where the previous window ended is sequential, and
+ * grows the map entry's read-ahead window in the same way that
+ * vm_fault_hold() does for faults that are satisfied by the pager.  Other
+ * faults leave the window unchanged and return zero.  A read lock on the
+ * map suffices to update the read-ahead state.
+ */
+static int
+vm_fault_soft_ahead(const struct faultstate *fs, vm_offset_t vaddr)
+{
+	vm_map_entry_t entry;
+	int era, nera;
+
+	entry = fs->entry;
+	if (vaddr != entry->next_read)
+		return (0);
+	switch (vm_map_entry_behavior(entry)) {
+	case MAP_ENTRY_BEHAV_RANDOM:
+		return (0);
+	case MAP_ENTRY_BEHAV_SEQUENTIAL:
+		nera = VM_FAULT_READ_AHEAD_MAX;
+		break;
+	default:
+		era = entry->read_ahead;
+		nera = VM_FAULT_READ_AHEAD_MIN;
+		if (era > 0) {
+			nera += era + 1;
+			if (nera > VM_FAULT_READ_AHEAD_MAX)
+				nera = VM_FAULT_READ_AHEAD_MAX;
+		}
+		break;
+	}
+	if (entry->read_ahead != nera)
+		entry->read_ahead = nera;
+	return (nera);
+}
+
 /*
  * Unlocks fs.first_object and fs.map on success.
  */
@@ -271,11 +359,11 @@ vm_fault_soft_fast(struct faultstate *fs, vm_offset_t vaddr, vm_prot_t prot,
 {
 	vm_page_t m, m_map;
 #if (defined(__aarch64__) || defined(__amd64__) || (defined(__arm__) && \
-    __ARM_ARCH >= 6) || defined(__i386__)) && VM_NRESERVLEVEL > 0
+    __ARM_ARCH >= 6) || defined(__i386__) || defined(__riscv)) && \
+    VM_NRESERVLEVEL > 0
 	vm_page_t m_super;
-	int flags;
 #endif
-	int psind, rv;
+	int ahead, psind, rv;
 
 	MPASS(fs->vp == NULL);
 	m = vm_page_lookup(fs->first_object, fs->first_pindex);
@@ -286,34 +374,13 @@ vm_fault_soft_fast(struct faultstate *fs, vm_offset_t vaddr, vm_prot_t prot,
 	m_map = m;
 	psind = 0;
 #if (defined(__aarch64__) || defined(__amd64__) || (defined(__arm__) && \
-    __ARM_ARCH >= 6) || defined(__i386__)) && VM_NRESERVLEVEL > 0
-	if ((m->flags & PG_FICTITIOUS) == 0 &&
-	    (m_super = vm_reserv_to_superpage(m)) != NULL &&
-	    rounddown2(vaddr, pagesizes[m_super->psind]) >= fs->entry->start &&
-	    roundup2(vaddr + 1, pagesizes[m_super->psind]) <= fs->entry->end &&
-	    (vaddr & (pagesizes[m_super->psind] - 1)) == (VM_PAGE_TO_PHYS(m) &
-	    (pagesizes[m_super->psind] - 1)) &&
-	    pmap_ps_enabled(fs->map->pmap)) {
-		flags = PS_ALL_VALID;
-		if ((prot & VM_PROT_WRITE) != 0) {
-			/*
-			 * Create a superpage mapping allowing write access
-			 * only if none of the constituent pages are busy and
-			 * all of them are already dirty (except possibly for
-			 * the page that was faulted on).
-			 */
-			flags |= PS_NONE_BUSY;
-			if ((fs->first_object->flags & OBJ_UNMANAGED) == 0)
-				flags |= PS_ALL_DIRTY;
-		}
-		if (vm_page_ps_test(m_super, flags, m)) {
-			m_map = m_super;
-			psind = m_super->psind;
-			vaddr = rounddown2(vaddr, pagesizes[psind]);
-			/* Preset the modified bit for dirty superpages. */
-			if ((flags & PS_ALL_DIRTY) != 0)
-				fault_type |= VM_PROT_WRITE;
-		}
+    __ARM_ARCH >= 6) || defined(__i386__) || defined(__riscv)) && \
+    VM_NRESERVLEVEL > 0
+	if ((m_super = vm_fault_superpage(fs, vaddr, m, prot,
+	    &fault_type)) != NULL) {
+		m_map = m_super;
+		psind = m_super->psind;
+		vaddr = rounddown2(vaddr, pagesizes[psind]);
 	}
 #endif
 	rv = pmap_enter(fs->map->pmap, vaddr, m_map, prot, fault_type |
@@ -322,14 +389,75 @@ vm_fault_soft_fast(struct faultstate *fs, vm_offset_t vaddr, vm_prot_t prot,
 		return (rv);
 	vm_fault_fill_hold(m_hold, m);
 	vm_fault_dirty(fs->entry, m, prot, fault_type, fault_flags, false);
-	if (psind == 0 && !wired)
-		vm_fault_prefault(fs, vaddr, PFBAK, PFFOR, true);
+	if (psind == 0 && !wired) {
+		/*
+		 * A soft fault that continues a sequential run maps the
+		 * resident pages of the whole read-ahead window, and moves
+		 * the expected address of the next fault past them.
+		 */
+		ahead = vm_fault_soft_ahead(fs, vaddr);
+		if (ahead > PFFOR)
+			fs->entry->next_read = vm_fault_prefault(fs, vaddr, 0,
+			    ahead, true);
+		else
+			(void)vm_fault_prefault(fs, vaddr, PFBAK, PFFOR, true);
+	}
 	VM_OBJECT_RUNLOCK(fs->first_object);
 	vm_map_lookup_done(fs->map, fs->entry);
 	curthread->td_ru.ru_minflt++;
 	return (KERN_SUCCESS);
 }
 
+/*
+ * Try to handle a soft fault without acquiring the map lock.  Only faults
+ * that map a resident, valid page from the top-level object, and that do not
+ * need to mark the object as containing dirty pages, qualify.  No lock is
+ * acquired in a way that could sleep, so that map writers waiting for the
+ * lookup to finish are not held up.
+ */
+static int
+vm_fault_soft_speculative(vm_map_t map, vm_offset_t vaddr,
+    vm_prot_t fault_type, int fault_flags, vm_page_t *m_hold)
+{
+	vm_map_entry_t entry;
+	vm_object_t object;
+	vm_page_t m;
+	vm_pindex_t pindex;
+	vm_prot_t prot;
+	int rv;
+
+	if (!vm_fault_speculative ||
+	    (fault_flags & (VM_FAULT_WIRE | VM_FAULT_DIRTY)) != 0)
+		return (KERN_FAILURE);
+	if (vm_map_lookup_speculative(map, vaddr, fault_type, &entry, &object,
+	    &pindex, &prot) != KERN_SUCCESS)
+		return (KERN_FAILURE);
+	rv = KERN_FAILURE;
+	if (!VM_OBJECT_TRYRLOCK(object))
+		goto out;
+	/* Avoid calling vm_object_set_writeable_dirty(). */
+	if ((prot & VM_PROT_WRITE) != 0 && (object->type == OBJT_VNODE ||
+	    (object->flags & OBJ_TMPFS_NODE) != 0) &&
+	    (object->flags & OBJ_MIGHTBEDIRTY) == 0)
+		goto unlock;
+	m = vm_page_lookup(object, pindex);
+	if (m == NULL || ((prot & VM_PROT_WRITE) != 0 &&
+	    vm_page_busied(m)) || m->valid != VM_PAGE_BITS_ALL)
+		goto unlock;
+	rv = pmap_enter(map->pmap, vaddr, m, prot, fault_type |
+	    PMAP_ENTER_NOSLEEP, 0);
+	if (rv != KERN_SUCCESS)
+		goto unlock;
+	vm_fault_fill_hold(m_hold, m);
+	vm_fault_dirty(entry, m, prot, fault_type, fault_flags, false);
+	curthread->td_ru.ru_minflt++;
+unlock:
+	VM_OBJECT_RUNLOCK(object);
+out:
+	vm_map_lookup_speculative_done(map);
+	return (rv);
+}
+
 static void
 vm_fault_restore_map_lock(struct faultstate *fs)
 {
@@ -463,7 +591,7 @@ vm_fault_populate(struct faultstate *fs, vm_prot_t prot, int fault_type,
 	    pidx += npages, m = vm_page_next(&m[npages - 1])) {
 		vaddr = fs->entry->start + IDX_TO_OFF(pidx) - fs->entry->offset;
 #if defined(__aarch64__) || defined(__amd64__) || (defined(__arm__) && \
-    __ARM_ARCH >= 6) || defined(__i386__)
+    __ARM_ARCH >= 6) || defined(__i386__) || defined(__riscv)
 		psind = m->psind;
 		if (psind > 0 && ((vaddr & (pagesizes[psind] - 1)) != 0 ||
 		    pidx + OFF_TO_IDX(pagesizes[psind]) - 1 > pager_last ||
@@ -554,12 +682,22 @@ vm_fault_hold(vm_map_t map, vm_offset_t vaddr, vm_prot_t fault_type,
 	vm_pindex_t retry_pindex;
 	vm_prot_t prot, retry_prot;
 	int ahead, alloc_req, behind, cluster_offset, error, era, faultcount;
-	int locked, nera, result, rv;
+	int locked, nera, psind, result, rv;
+#if (defined(__aarch64__) || defined(__amd64__) || (defined(__arm__) && \
+    __ARM_ARCH >= 6) || defined(__i386__) || defined(__riscv)) && \
+    VM_NRESERVLEVEL > 0
+	vm_page_t m_super;
+	int super_type;
+#endif
 	u_char behavior;
 	boolean_t wired;	/* Passed by reference. */
 	bool dead, hardfault, is_first_object_locked;
 
 	VM_CNT_INC(v_vm_faults);
+	if (vm_fault_soft_speculative(map, vaddr, fault_type, fault_flags,
+	    m_hold) == KERN_SUCCESS)
+		return (KERN_SUCCESS);
+
 	fs.vp = NULL;
 	faultcount = 0;
 	nera = -1;
@@ -1275,6 +1413,27 @@ RetryFault:;
 	 */
 	KASSERT(fs.m->valid == VM_PAGE_BITS_ALL,
 	    ("vm_fault: page %p partially invalid", fs.m));
+
+	/*
+	 * If the pager has just completed the reservation that backs this
+	 * page, map all of it at once.  This is attempted without sleeping,
+	 * while the object lock keeps the constituent pages in place.
+	 */
+	psind = 0;
+#if (defined(__aarch64__) || defined(__amd64__) || (defined(__arm__) && \
+    __ARM_ARCH >= 6) || defined(__i386__) || defined(__riscv)) && \
+    VM_NRESERVLEVEL > 0
+	if (fs.object == fs.first_object && !wired) {
+		super_type = fault_type;
+		m_super = vm_fault_superpage(&fs, vaddr, fs.m, prot,
+		    &super_type);
+		if (m_super != NULL && pmap_enter(fs.map->pmap,
+		    rounddown2(vaddr, pagesizes[m_super->psind]), m_super,
+		    prot, super_type | PMAP_ENTER_NOSLEEP, m_super->psind) ==
+		    KERN_SUCCESS)
+			psind = m_super->psind;
+	}
+#endif
 	VM_OBJECT_WUNLOCK(fs.object);
 
 	/*
@@ -1283,13 +1442,15 @@ RetryFault:;
 	 * back on the active queue until later so that the pageout daemon
 	 * won't find it (yet).
 	 */
-	pmap_enter(fs.map->pmap, vaddr, fs.m, prot,
-	    fault_type | (wired ? PMAP_ENTER_WIRED : 0), 0);
-	if (faultcount != 1 && (fault_flags & VM_FAULT_WIRE) == 0 &&
-	    wired == 0)
-		vm_fault_prefault(&fs, vaddr,
-		    faultcount > 0 ? behind : PFBAK,
-		    faultcount > 0 ? ahead : PFFOR, false);
+	if (psind == 0) {
+		pmap_enter(fs.map->pmap, vaddr, fs.m, prot,
+		    fault_type | (wired ? PMAP_ENTER_WIRED : 0), 0);
+		if (faultcount != 1 && (fault_flags & VM_FAULT_WIRE) == 0 &&
+		    wired == 0)
+			vm_fault_prefault(&fs, vaddr,
+			    faultcount > 0 ? behind : PFBAK,
+			    faultcount > 0 ? ahead : PFFOR, false);
+	}
 	VM_OBJECT_WLOCK(fs.object);
 	vm_page_lock(fs.m);
 
@@ -1418,22 +1579,26 @@ vm_fault_dontneed(const struct faultstate *fs, vm_offset_t vaddr, int ahead)
  * pagefaults into a processes address space.  It is a "cousin"
  * of vm_map_pmap_enter, except it runs at page fault time instead
  * of mmap time.
+ *
+ * Returns the address that follows the run of mapped pages starting just
+ * after "addra".
  */
-static void
+static vm_offset_t
 vm_fault_prefault(const struct faultstate *fs, vm_offset_t addra,
     int backward, int forward, bool obj_locked)
 {
 	pmap_t pmap;
 	vm_map_entry_t entry;
 	vm_object_t backing_object, lobject;
-	vm_offset_t addr, starta;
+	vm_offset_t addr, enda, starta;
 	vm_pindex_t pindex;
 	vm_page_t m;
 	int i;
 
+	enda = addra + PAGE_SIZE;
 	pmap = fs->map->pmap;
 	if (pmap != vmspace_pmap(curthread->td_proc->p_vmspace))
-		return;
+		return (enda);
 
 	entry = fs->entry;
 
@@ -1462,8 +1627,11 @@ vm_fault_prefault(const struct faultstate *fs, vm_offset_t addra,
 		if (addr < starta || addr >= entry->end)
 			continue;
 
-		if (!pmap_is_prefaultable(pmap, addr))
+		if (!pmap_is_prefaultable(pmap, addr)) {
+			if (addr == enda)
+				enda += PAGE_SIZE;
 			continue;
+		}
 
 		pindex = ((addr - entry->start) + entry->offset) >> PAGE_SHIFT;
 		lobject = entry->object.vm_object;
@@ -1486,11 +1654,15 @@ vm_fault_prefault(const struct faultstate *fs, vm_offset_t addra,
 			break;
 		}
 		if (m->valid == VM_PAGE_BITS_ALL &&
-		    (m->flags & PG_FICTITIOUS) == 0)
+		    (m->flags & PG_FICTITIOUS) == 0) {
 			pmap_enter_quick(pmap, addr, m, entry->protection);
+			if (addr == enda)
+				enda += PAGE_SIZE;
+		}
 		if (!obj_locked || lobject != entry->object.vm_object)
 			VM_OBJECT_RUNLOCK(lobject);
 	}
+	return (enda);
 }
 
 /*
@@ -503,14 +503,37 @@ vmspace_switch_aio(struct vmspace *newvm)
 	vmspace_free(oldvm);
 }
 
+#define	VM_MAP_SPEC_SPINS	1000
+
+/*
+ * Wait for speculative lookups, started before the caller acquired the map
+ * lock exclusively, to finish.  Those lookups hold no lock, but they never
+ * sleep, so the wait is short.
+ */
+static void
+vm_map_wait_speculative(vm_map_t map)
+{
+	int spins;
+
+	atomic_thread_fence_seq_cst();
+	for (spins = 0; atomic_load_int(&map->spec_lookups) != 0; spins++) {
+		if (spins < VM_MAP_SPEC_SPINS)
+			cpu_spinwait();
+		else
+			kern_yield(PRI_USER);
+	}
+}
+
 void
 _vm_map_lock(vm_map_t map, const char *file, int line)
 {
 
 	if (map->system_map)
 		mtx_lock_flags_(&map->system_mtx, 0, file, line);
-	else
+	else {
 		sx_xlock_(&map->lock, file, line);
+		vm_map_wait_speculative(map);
+	}
 	map->timestamp++;
 }
 
@@ -585,6 +608,17 @@ _vm_map_trylock(vm_map_t map, const char *file, int line)
 	error = map->system_map ?
 	    !mtx_trylock_flags_(&map->system_mtx, 0, file, line) :
 	    !sx_try_xlock_(&map->lock, file, line);
+	if (error == 0 && !map->system_map) {
+		/*
+		 * Do not wait for speculative lookups; the caller may not be
+		 * able to sleep.
+		 */
+		atomic_thread_fence_seq_cst();
+		if (atomic_load_int(&map->spec_lookups) != 0) {
+			sx_xunlock_(&map->lock, file, line);
+			error = 1;
+		}
+	}
 	if (error == 0)
 		map->timestamp++;
 	return (error == 0);
@@ -633,6 +667,7 @@ _vm_map_lock_upgrade(vm_map_t map, const char *file, int line)
 				return (1);
 			}
 		}
+		vm_map_wait_speculative(map);
 	}
 	map->timestamp++;
 	return (0);
@@ -760,6 +795,8 @@ vm_map_wait_busy(vm_map_t map)
 		else
 			sx_sleep(&map->busy, &map->lock, 0, "mbusy", 0);
 	}
+	if (!map->system_map)
+		vm_map_wait_speculative(map);
 	map->timestamp++;
 }
 
@@ -805,6 +842,7 @@ _vm_map_init(vm_map_t map, pmap_t pmap, vm_offset_t min, vm_offset_t max)
 	map->root = NULL;
 	map->timestamp = 0;
 	map->busy = 0;
+	map->spec_lookups = 0;
 }
 
 void
@@ -1087,6 +1125,26 @@ vm_map_entry_resize_free(vm_map_t map, vm_map_entry_t entry)
 	vm_map_entry_set_max_free(entry);
 }
 
+/*
+ * Try to upgrade a read lock on the map for the purpose of splaying the
+ * tree.  Speculative lookups walk the tree without the map lock, so fail
+ * the upgrade rather than wait for them; the caller can always fall back to
+ * a plain search.
+ */
+static bool
+vm_map_try_upgrade_splay(vm_map_t map)
+{
+
+	if (map->system_map || !sx_try_upgrade(&map->lock))
+		return (false);
+	atomic_thread_fence_seq_cst();
+	if (atomic_load_int(&map->spec_lookups) != 0) {
+		sx_downgrade(&map->lock);
+		return (false);
+	}
+	return (true);
+}
+
 /*
  *	vm_map_lookup_entry:	[ internal use only ]
  *
@@ -1117,7 +1175,7 @@ vm_map_lookup_entry(
 		*entry = cur;
 		return (TRUE);
 	} else if ((locked = vm_map_locked(map)) ||
-	    sx_try_upgrade(&map->lock)) {
+	    vm_map_try_upgrade_splay(map)) {
 		/*
 		 * Splay requires a write lock on the map.  However, it only
 		 * restructures the binary search tree; it does not otherwise
@@ -4310,6 +4368,99 @@ vm_map_lookup_locked(vm_map_t *var_map,		/* IN/OUT */
 	return (KERN_SUCCESS);
 }
 
+/*
+ *	vm_map_lookup_speculative:
+ *
+ *	Lookup the faulting address without acquiring the map lock, for
+ *	faults that can be resolved by mapping an already resident page.
+ *	Returns KERN_FAILURE if the fault must instead be handled through
+ *	vm_map_lookup(), which is the case whenever the map is write locked
+ *	or the entry requires any change.
+ *
+ *	On success, the entry and the object remain valid, and the map
+ *	unmodified, until vm_map_lookup_speculative_done() is called, since
+ *	writers wait for speculative lookups in progress after acquiring the
+ *	map lock.  The caller must not sleep in between.
+ */
+int
+vm_map_lookup_speculative(vm_map_t map,		/* IN */
+			  vm_offset_t vaddr,
+			  vm_prot_t fault_type,
+			  vm_map_entry_t *out_entry,	/* OUT */
+			  vm_object_t *object,		/* OUT */
+			  vm_pindex_t *pindex,		/* OUT */
+			  vm_prot_t *out_prot)		/* OUT */
+{
+	vm_map_entry_t entry;
+	vm_prot_t prot;
+
+	if (map->system_map || (fault_type & VM_PROT_COPY) != 0)
+		return (KERN_FAILURE);
+
+	/*
+	 * Pairs with the fence in vm_map_wait_speculative(): either the
+	 * writer observes this lookup, or this lookup observes the writer.
+	 */
+	atomic_add_int(&map->spec_lookups, 1);
+	atomic_thread_fence_seq_cst();
+	if (sx_xholder(&map->lock) != NULL)
+		goto fail;
+
+	/*
+	 * Perform a standard binary search tree lookup for "vaddr".  The
+	 * tree cannot be splayed while this lookup is in progress.
+	 */
+	entry = map->root;
+	while (entry != NULL) {
+		if (vaddr < entry->start)
+			entry = entry->left;
+		else if (vaddr >= entry->end)
+			entry = entry->right;
+		else
+			break;
+	}
+	if (entry == NULL ||
+	    (entry->eflags & (MAP_ENTRY_IS_SUB_MAP | MAP_ENTRY_GUARD |
+	    MAP_ENTRY_IN_TRANSITION | MAP_ENTRY_NOFAULT)) != 0 ||
+	    entry->wired_count != 0 || entry->object.vm_object == NULL)
+		goto fail;
+
+	prot = entry->protection;
+	fault_type &= VM_PROT_READ | VM_PROT_WRITE | VM_PROT_EXECUTE;
+	if ((fault_type & prot) != fault_type || prot == VM_PROT_NONE)
+		goto fail;
+	if ((entry->eflags & MAP_ENTRY_NEEDS_COPY) != 0) {
+		/*
+		 * A write fault must shadow the object first.
+		 */
+		if ((fault_type & VM_PROT_WRITE) != 0)
+			goto fail;
+		prot &= ~VM_PROT_WRITE;
+	}
+
+	*out_entry = entry;
+	*pindex = UOFF_TO_IDX((vaddr - entry->start) + entry->offset);
+	*object = entry->object.vm_object;
+	*out_prot = prot;
+	return (KERN_SUCCESS);
+
+fail:
+	atomic_subtract_rel_int(&map->spec_lookups, 1);
+	return (KERN_FAILURE);
+}
+
+/*
+ *	vm_map_lookup_speculative_done:
+ *
+ *	Ends a successful speculative lookup, allowing writers to proceed.
+ */
+void
+vm_map_lookup_speculative_done(vm_map_t map)
+{
+
+	atomic_subtract_rel_int(&map->spec_lookups, 1);
+}
+
 /*
  *	vm_map_lookup_done:
  *
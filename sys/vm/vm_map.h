@@ -204,6 +204,7 @@ struct vm_map {
 	vm_map_entry_t root;		/* Root of a binary search tree */
 	pmap_t pmap;			/* (c) Physical map */
 	int busy;
+	u_int spec_lookups;		/* lockless lookups in progress */
 };
 
 /*
@@ -407,6 +408,9 @@ int vm_map_lookup (vm_map_t *, vm_offset_t, vm_prot_t, vm_map_entry_t *, vm_obje
 int vm_map_lookup_locked(vm_map_t *, vm_offset_t, vm_prot_t, vm_map_entry_t *, vm_object_t *,
     vm_pindex_t *, vm_prot_t *, boolean_t *);
 void vm_map_lookup_done (vm_map_t, vm_map_entry_t);
+int vm_map_lookup_speculative(vm_map_t, vm_offset_t, vm_prot_t,
+    vm_map_entry_t *, vm_object_t *, vm_pindex_t *, vm_prot_t *);
+void vm_map_lookup_speculative_done(vm_map_t);
 boolean_t vm_map_lookup_entry (vm_map_t, vm_offset_t, vm_map_entry_t *);
 int vm_map_protect (vm_map_t, vm_offset_t, vm_offset_t, vm_prot_t, boolean_t);
 int vm_map_remove (vm_map_t, vm_offset_t, vm_offset_t);
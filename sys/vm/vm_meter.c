@@ -543,6 +543,30 @@ vm_domain_stats_init(struct vm_domain *vmd, struct sysctl_oid *parent)
 	SYSCTL_ADD_UINT(NULL, SYSCTL_CHILDREN(oid), OID_AUTO,
 	    "free_severe", CTLFLAG_RD, &vmd->vmd_free_severe, 0,
 	    "Severe free pages");
+	SYSCTL_ADD_COUNTER_U64(NULL, SYSCTL_CHILDREN(oid), OID_AUTO,
+	    "free_lock_acq", CTLFLAG_RD, &vmd->vmd_free_lock_acq,
+	    "Free queue lock acquisitions by the page allocator");
+	SYSCTL_ADD_COUNTER_U64(NULL, SYSCTL_CHILDREN(oid), OID_AUTO,
+	    "free_lock_contended", CTLFLAG_RD, &vmd->vmd_free_lock_contended,
+	    "Contended free queue lock acquisitions by the page allocator");
+	SYSCTL_ADD_COUNTER_U64(NULL, SYSCTL_CHILDREN(oid), OID_AUTO,
+	    "free_lock_pages", CTLFLAG_RD, &vmd->vmd_free_lock_pages,
+	    "Pages allocated or freed under the free queue lock");
+	SYSCTL_ADD_INT(NULL, SYSCTL_CHILDREN(oid), OID_AUTO,
+	    "inactive_threads", CTLFLAG_RD, &vmd->vmd_inactive_threads, 0,
+	    "Page daemon threads scanning the inactive queue");
+	SYSCTL_ADD_UINT(NULL, SYSCTL_CHILDREN(oid), OID_AUTO,
+	    "inactive_scan_rate", CTLFLAG_RD, &vmd->vmd_inactive_scan_pps, 0,
+	    "Inactive pages scanned per second by the page daemon");
+	SYSCTL_ADD_UINT(NULL, SYSCTL_CHILDREN(oid), OID_AUTO,
+	    "inactive_free_rate", CTLFLAG_RD, &vmd->vmd_inactive_free_pps, 0,
+	    "Inactive pages freed per second by the page daemon");
+	SYSCTL_ADD_COUNTER_U64(NULL, SYSCTL_CHILDREN(oid), OID_AUTO,
+	    "vm_wait_stalls", CTLFLAG_RD, &vmd->vmd_wait_stalls,
+	    "Number of times a thread slept in vm_wait() for this domain");
+	SYSCTL_ADD_COUNTER_U64(NULL, SYSCTL_CHILDREN(oid), OID_AUTO,
+	    "vm_wait_usecs", CTLFLAG_RD, &vmd->vmd_wait_usecs,
+	    "Microseconds threads spent in vm_wait() for this domain");
 
 }
 
@@ -91,6 +91,7 @@ __FBSDID("$FreeBSD$");
 #include <sys/param.h>
 #include <sys/systm.h>
 #include <sys/lock.h>
+#include <sys/counter.h>
 #include <sys/domainset.h>
 #include <sys/kernel.h>
 #include <sys/limits.h>
@@ -105,6 +106,7 @@ __FBSDID("$FreeBSD$");
 #include <sys/sched.h>
 #include <sys/smp.h>
 #include <sys/sysctl.h>
+#include <sys/time.h>
 #include <sys/vmmeter.h>
 #include <sys/vnode.h>
 
@@ -201,6 +203,23 @@ vm_page_init(void *dummy)
 	    VM_ALLOC_NORMAL | VM_ALLOC_WIRED);
 }
 
+/*
+ * Acquire the domain's free queue lock on behalf of the page allocator,
+ * recording the acquisition, whether it was contended, and the number of
+ * pages that will be moved while the lock is held.
+ */
+static __inline void
+vm_domain_free_lock_acct(struct vm_domain *vmd, u_long npages)
+{
+
+	if (!vm_domain_free_trylock(vmd)) {
+		counter_u64_add(vmd->vmd_free_lock_contended, 1);
+		vm_domain_free_lock(vmd);
+	}
+	counter_u64_add(vmd->vmd_free_lock_acq, 1);
+	counter_u64_add(vmd->vmd_free_lock_pages, npages);
+}
+
 /*
  * The cache page zone is initialized later since we need to be able to allocate
  * pages before UMA is fully initialized.
@@ -209,20 +228,33 @@ static void
 vm_page_init_cache_zones(void *dummy __unused)
 {
 	struct vm_domain *vmd;
-	int i;
+	struct vm_pgcache *pgcache;
+	int i, pool;
 
 	for (i = 0; i < vm_ndomains; i++) {
 		vmd = VM_DOMAIN(i);
+		vmd->vmd_free_lock_acq = counter_u64_alloc(M_WAITOK);
+		vmd->vmd_free_lock_contended = counter_u64_alloc(M_WAITOK);
+		vmd->vmd_free_lock_pages = counter_u64_alloc(M_WAITOK);
+		vmd->vmd_wait_stalls = counter_u64_alloc(M_WAITOK);
+		vmd->vmd_wait_usecs = counter_u64_alloc(M_WAITOK);
+
 		/*
 		 * Don't allow the page cache to take up more than .25% of
 		 * memory.
 		 */
-		if (vmd->vmd_page_count / 400 < 256 * mp_ncpus)
+		if (vmd->vmd_page_count / 400 < 256 * mp_ncpus * VM_NFREEPOOL)
 			continue;
-		vmd->vmd_pgcache = uma_zcache_create("vm pgcache",
-		    sizeof(struct vm_page), NULL, NULL, NULL, NULL,
-		    vm_page_import, vm_page_release, vmd,
-		    UMA_ZONE_NOBUCKETCACHE | UMA_ZONE_MAXBUCKET | UMA_ZONE_VM);
+		for (pool = 0; pool < VM_NFREEPOOL; pool++) {
+			pgcache = &vmd->vmd_pgcache[pool];
+			pgcache->domain = i;
+			pgcache->pool = pool;
+			pgcache->zone = uma_zcache_create("vm pgcache",
+			    sizeof(struct vm_page), NULL, NULL, NULL, NULL,
+			    vm_page_import, vm_page_release, pgcache,
+			    UMA_ZONE_NOBUCKETCACHE | UMA_ZONE_MAXBUCKET |
+			    UMA_ZONE_VM);
+		}
 	}
 }
 SYSINIT(vm_page2, SI_SUB_VM_CONF, SI_ORDER_ANY, vm_page_init_cache_zones, NULL);
@@ -442,7 +474,7 @@ sysctl_vm_page_blacklist(SYSCTL_HANDLER_ARGS)
  * Nonetheless, it write busies and initializes the hold count to one as
  * safety precautions.
  */
-static void
+void
 vm_page_init_marker(vm_page_t marker, int queue, uint8_t aflags)
 {
 
@@ -476,6 +508,11 @@ vm_page_domain_init(int domain)
 	vmd->vmd_free_count = 0;
 	vmd->vmd_segs = 0;
 	vmd->vmd_oom = FALSE;
+	vmd->vmd_free_lock_acq = EARLY_COUNTER;
+	vmd->vmd_free_lock_contended = EARLY_COUNTER;
+	vmd->vmd_free_lock_pages = EARLY_COUNTER;
+	vmd->vmd_wait_stalls = EARLY_COUNTER;
+	vmd->vmd_wait_usecs = EARLY_COUNTER;
 	for (i = 0; i < PQ_COUNT; i++) {
 		pq = &vmd->vmd_pagequeues[i];
 		TAILQ_INIT(&pq->pq_pl);
@@ -628,7 +665,7 @@ vm_page_startup(vm_offset_t vaddr)
 #endif
 
 #if defined(__aarch64__) || defined(__amd64__) || defined(__arm__) || \
-    defined(__i386__) || defined(__mips__)
+    defined(__i386__) || defined(__mips__) || defined(__riscv)
 	/*
 	 * Allocate a bitmap to indicate that a random physical page
 	 * needs to be included in a minidump.
@@ -653,7 +690,8 @@ vm_page_startup(vm_offset_t vaddr)
 #else
 	(void)last_pa;
 #endif
-#if defined(__aarch64__) || defined(__amd64__) || defined(__mips__)
+#if defined(__aarch64__) || defined(__amd64__) || defined(__mips__) || \
+    defined(__riscv)
 	/*
 	 * Include the UMA bootstrap pages and vm_page_dump in a crash dump.
 	 * When pmap_map() uses the direct map, they are not automatically 
@@ -768,7 +806,8 @@ vm_page_startup(vm_offset_t vaddr)
 		high_avail = new_end;
 	new_end = vm_reserv_startup(&vaddr, new_end, high_avail);
 #endif
-#if defined(__aarch64__) || defined(__amd64__) || defined(__mips__)
+#if defined(__aarch64__) || defined(__amd64__) || defined(__mips__) || \
+    defined(__riscv)
 	/*
 	 * Include vm_page_array and vm_reserv_array in a crash dump.
 	 */
@@ -1810,7 +1849,7 @@ vm_page_alloc_domain_after(vm_object_t object, vm_pindex_t pindex, int domain,
 {
 	struct vm_domain *vmd;
 	vm_page_t m;
-	int flags;
+	int flags, pool;
 
 	KASSERT((object != NULL) == ((req & VM_ALLOC_NOOBJ) == 0) &&
 	    (object != NULL || (req & VM_ALLOC_SBUSY) == 0) &&
@@ -1840,8 +1879,9 @@ vm_page_alloc_domain_after(vm_object_t object, vm_pindex_t pindex, int domain,
 	}
 #endif
 	vmd = VM_DOMAIN(domain);
-	if (object != NULL && vmd->vmd_pgcache != NULL) {
-		m = uma_zalloc(vmd->vmd_pgcache, M_NOWAIT);
+	pool = object != NULL ? VM_FREEPOOL_DEFAULT : VM_FREEPOOL_DIRECT;
+	if (vmd->vmd_pgcache[pool].zone != NULL) {
+		m = uma_zalloc(vmd->vmd_pgcache[pool].zone, M_NOWAIT);
 		if (m != NULL)
 			goto found;
 	}
@@ -1849,9 +1889,8 @@ vm_page_alloc_domain_after(vm_object_t object, vm_pindex_t pindex, int domain,
 		/*
 		 * If not, allocate it from the free page queues.
 		 */
-		vm_domain_free_lock(vmd);
-		m = vm_phys_alloc_pages(domain, object != NULL ?
-		    VM_FREEPOOL_DEFAULT : VM_FREEPOOL_DIRECT, 0);
+		vm_domain_free_lock_acct(vmd, 1);
+		m = vm_phys_alloc_pages(domain, pool, 0);
 		vm_domain_free_unlock(vmd);
 		if (m == NULL) {
 			vm_domain_freecnt_inc(vmd, 1);
@@ -2052,7 +2091,7 @@ vm_page_alloc_contig_domain(vm_object_t object, vm_pindex_t pindex, int domain,
 		/*
 		 * allocate them from the free page queues.
 		 */
-		vm_domain_free_lock(vmd);
+		vm_domain_free_lock_acct(vmd, npages);
 		m_ret = vm_phys_alloc_contig(domain, npages, low, high,
 		    alignment, boundary);
 		vm_domain_free_unlock(vmd);
@@ -2207,7 +2246,7 @@ vm_page_alloc_freelist_domain(int domain, int freelist, int req)
 	vmd = VM_DOMAIN(domain);
 again:
 	if (vm_domain_allocate(vmd, req, 1)) {
-		vm_domain_free_lock(vmd);
+		vm_domain_free_lock_acct(vmd, 1);
 		m = vm_phys_alloc_freelist_pages(domain, freelist,
 		    VM_FREEPOOL_DIRECT, 0);
 		vm_domain_free_unlock(vmd);
@@ -2247,15 +2286,17 @@ static int
 vm_page_import(void *arg, void **store, int cnt, int domain, int flags)
 {
 	struct vm_domain *vmd;
+	struct vm_pgcache *pgcache;
 	int i;
 
-	vmd = arg;
+	pgcache = arg;
+	vmd = VM_DOMAIN(pgcache->domain);
 	/* Only import if we can bring in a full bucket. */
 	if (cnt == 1 || !vm_domain_allocate(vmd, VM_ALLOC_NORMAL, cnt))
 		return (0);
 	domain = vmd->vmd_domain;
-	vm_domain_free_lock(vmd);
-	i = vm_phys_alloc_npages(domain, VM_FREEPOOL_DEFAULT, cnt,
+	vm_domain_free_lock_acct(vmd, cnt);
+	i = vm_phys_alloc_npages(domain, pgcache->pool, cnt,
 	    (vm_page_t *)store);
 	vm_domain_free_unlock(vmd);
 	if (cnt != i)
@@ -2268,11 +2309,13 @@ static void
 vm_page_release(void *arg, void **store, int cnt)
 {
 	struct vm_domain *vmd;
+	struct vm_pgcache *pgcache;
 	vm_page_t m;
 	int i;
 
-	vmd = arg;
-	vm_domain_free_lock(vmd);
+	pgcache = arg;
+	vmd = VM_DOMAIN(pgcache->domain);
+	vm_domain_free_lock_acct(vmd, cnt);
 	for (i = 0; i < cnt; i++) {
 		m = (vm_page_t)store[i];
 		vm_phys_free_pages(m, 0);
@@ -2938,6 +2981,10 @@ vm_wait_count(void)
 void
 vm_wait_doms(const domainset_t *wdoms)
 {
+	struct vm_domain *vmd;
+	sbintime_t start;
+	u_long usecs;
+	int i;
 
 	/*
 	 * We use racey wakeup synchronization to avoid expensive global
@@ -2961,8 +3008,22 @@ vm_wait_doms(const domainset_t *wdoms)
 		mtx_lock(&vm_domainset_lock);
 		if (vm_page_count_min_set(wdoms)) {
 			vm_min_waiters++;
+			start = sbinuptime();
 			msleep(&vm_min_domains, &vm_domainset_lock,
 			    PVM | PDROP, "vmwait", 0);
+
+			/*
+			 * Charge the stall to each domain that we waited on,
+			 * so that reclaim lag is visible per domain.
+			 */
+			usecs = (sbinuptime() - start) / SBT_1US;
+			for (i = 0; i < vm_ndomains; i++) {
+				if (!DOMAINSET_ISSET(i, wdoms))
+					continue;
+				vmd = VM_DOMAIN(i);
+				counter_u64_add(vmd->vmd_wait_stalls, 1);
+				counter_u64_add(vmd->vmd_wait_usecs, usecs);
+			}
 		} else
 			mtx_unlock(&vm_domainset_lock);
 	}
@@ -3521,16 +3582,18 @@ void
 vm_page_free_toq(vm_page_t m)
 {
 	struct vm_domain *vmd;
+	uma_zone_t zone;
 
 	if (!vm_page_free_prep(m))
 		return;
 
 	vmd = vm_pagequeue_domain(m);
-	if (m->pool == VM_FREEPOOL_DEFAULT && vmd->vmd_pgcache != NULL) {
-		uma_zfree(vmd->vmd_pgcache, m);
+	zone = vmd->vmd_pgcache[m->pool].zone;
+	if (zone != NULL) {
+		uma_zfree(zone, m);
 		return;
 	}
-	vm_domain_free_lock(vmd);
+	vm_domain_free_lock_acct(vmd, 1);
 	vm_phys_free_pages(m, 0);
 	vm_domain_free_unlock(vmd);
 	vm_domain_freecnt_inc(vmd, 1);
@@ -149,6 +149,11 @@ SDT_PROBE_DEFINE(vm, , , vm__lowmem_scan);
 
 static int vm_pageout_oom_seq = 12;
 
+static int vm_pageout_cpus_per_thread = 16;
+SYSCTL_INT(_vm, OID_AUTO, pageout_cpus_per_thread, CTLFLAG_RDTUN,
+    &vm_pageout_cpus_per_thread, 0,
+    "Number of CPUs per page daemon inactive queue scan thread");
+
 static int vm_pageout_update_period;
 static int disable_swap_pageouts;
 static int lowmem_period = 10;
@@ -1353,21 +1358,23 @@ vm_pageout_reinsert_inactive(struct scan_state *ss, struct vm_batchqueue *bq,
 }
 
 /*
- * Attempt to reclaim the requested number of pages from the inactive queue.
- * Returns true if the shortage was addressed.
+ * Scan the inactive queue from the head, freeing up to "page_shortage" pages.
+ * Each concurrent scan uses its own marker; pages are physically dequeued in
+ * batches, so concurrent scans never visit the same page.  Returns the number
+ * of pages freed and stores the number of temporarily stuck pages that were
+ * encountered in "addl_shortage".
  */
 static int
-vm_pageout_scan_inactive(struct vm_domain *vmd, int shortage,
-    int *addl_shortage)
+vm_pageout_scan_inactive_pages(struct vm_domain *vmd, vm_page_t marker,
+    int page_shortage, int *addl_shortage)
 {
 	struct scan_state ss;
 	struct vm_batchqueue rq;
 	struct mtx *mtx;
-	vm_page_t m, marker;
+	vm_page_t m;
 	struct vm_pagequeue *pq;
 	vm_object_t object;
-	int act_delta, addl_page_shortage, deficit, page_shortage;
-	int starting_page_shortage;
+	int act_delta, addl_page_shortage, starting_page_shortage;
 	bool obj_locked;
 
 	/*
@@ -1377,15 +1384,7 @@ vm_pageout_scan_inactive(struct vm_domain *vmd, int shortage,
 	 * discounted in setting the target for the active queue scan.
 	 */
 	addl_page_shortage = 0;
-
-	/*
-	 * vmd_pageout_deficit counts the number of pages requested in
-	 * allocations that failed because of a free page shortage.  We assume
-	 * that the allocations will be reattempted and thus include the deficit
-	 * in our scan target.
-	 */
-	deficit = atomic_readandclear_int(&vmd->vmd_pageout_deficit);
-	starting_page_shortage = page_shortage = shortage + deficit;
+	starting_page_shortage = page_shortage;
 
 	mtx = NULL;
 	obj_locked = false;
@@ -1398,7 +1397,6 @@ vm_pageout_scan_inactive(struct vm_domain *vmd, int shortage,
 	 * entire queue.  (Note that m->act_count is not used to make
 	 * decisions for the inactive queue, only for the active queue.)
 	 */
-	marker = &vmd->vmd_markers[PQ_INACTIVE];
 	pq = &vmd->vmd_pagequeues[PQ_INACTIVE];
 	vm_pagequeue_lock(pq);
 	vm_pageout_init_scan(&ss, pq, marker, NULL, pq->pq_cnt);
@@ -1577,7 +1575,143 @@ vm_pageout_scan_inactive(struct vm_domain *vmd, int shortage,
 	vm_pageout_end_scan(&ss);
 	vm_pagequeue_unlock(pq);
 
-	VM_CNT_ADD(v_dfree, starting_page_shortage - page_shortage);
+	*addl_shortage = addl_page_shortage;
+	return (starting_page_shortage - page_shortage);
+}
+
+/*
+ * Helper thread for parallel inactive queue scans.  Waits for
+ * vm_pageout_inactive_dispatch() to hand out work, scans with a private
+ * marker, and reports the results back through the domain.
+ */
+static void
+vm_pageout_inactive_helper(void *arg)
+{
+	struct vm_domain *vmd;
+	struct vm_page marker;
+	int addl, freed;
+
+	vmd = VM_DOMAIN((uintptr_t)arg);
+	vm_page_init_marker(&marker, PQ_INACTIVE, 0);
+
+	vm_domain_pageout_lock(vmd);
+	for (;;) {
+		while (vmd->vmd_inactive_pending == 0)
+			mtx_sleep(&vmd->vmd_inactive_pending,
+			    vm_domain_pageout_lockptr(vmd), PVM, "psleep", 0);
+		vmd->vmd_inactive_pending--;
+		vm_domain_pageout_unlock(vmd);
+
+		freed = vm_pageout_scan_inactive_pages(vmd, &marker,
+		    vmd->vmd_inactive_shortage, &addl);
+		atomic_add_int(&vmd->vmd_inactive_freed, freed);
+		atomic_add_int(&vmd->vmd_inactive_addl, addl);
+
+		vm_domain_pageout_lock(vmd);
+		if (--vmd->vmd_inactive_running == 0)
+			wakeup(&vmd->vmd_inactive_running);
+	}
+}
+
+/*
+ * Scan the inactive queue for "shortage" pages to free, splitting the scan
+ * across the domain's helper threads if one thread is unlikely to keep up.
+ * Returns the number of pages freed.
+ */
+static int
+vm_pageout_inactive_dispatch(struct vm_domain *vmd, int shortage,
+    int *addl_shortage)
+{
+	int freed, helpers, share, threads;
+
+	/*
+	 * Only spread the work if the shortage is well beyond what a single
+	 * thread has recently managed to free in a fraction of a scan
+	 * interval.  Otherwise, the extra threads would mostly contend on the
+	 * page queue lock.
+	 */
+	threads = vmd->vmd_inactive_threads;
+	if (threads == 1 || vmd->vmd_inactive_free_pps == 0 ||
+	    shortage <= vmd->vmd_inactive_free_pps / VM_INACT_SCAN_RATE / 4)
+		return (vm_pageout_scan_inactive_pages(vmd,
+		    &vmd->vmd_markers[PQ_INACTIVE], shortage, addl_shortage));
+
+	helpers = threads - 1;
+	share = shortage / threads;
+	vmd->vmd_inactive_freed = 0;
+	vmd->vmd_inactive_addl = 0;
+	vm_domain_pageout_lock(vmd);
+	vmd->vmd_inactive_shortage = share;
+	vmd->vmd_inactive_pending = helpers;
+	vmd->vmd_inactive_running = helpers;
+	wakeup(&vmd->vmd_inactive_pending);
+	vm_domain_pageout_unlock(vmd);
+
+	freed = vm_pageout_scan_inactive_pages(vmd,
+	    &vmd->vmd_markers[PQ_INACTIVE], shortage - share * helpers,
+	    addl_shortage);
+
+	vm_domain_pageout_lock(vmd);
+	while (vmd->vmd_inactive_running != 0)
+		mtx_sleep(&vmd->vmd_inactive_running,
+		    vm_domain_pageout_lockptr(vmd), PVM, "pwait", 0);
+	vm_domain_pageout_unlock(vmd);
+
+	*addl_shortage += atomic_load_int(&vmd->vmd_inactive_addl);
+	return (freed + atomic_load_int(&vmd->vmd_inactive_freed));
+}
+
+/*
+ * Recompute the per-domain inactive queue scan and free rates, at most once
+ * a second.
+ */
+static void
+vm_pageout_update_rates(struct vm_domain *vmd)
+{
+	uint64_t freed, scanned;
+	int elapsed;
+
+	elapsed = ticks - vmd->vmd_rate_ticks;
+	if (elapsed < hz)
+		return;
+	scanned = vmd->vmd_pagequeues[PQ_INACTIVE].pq_pdpages;
+	freed = vmd->vmd_pdfreed;
+	vmd->vmd_inactive_scan_pps = (scanned - vmd->vmd_rate_scanned) * hz /
+	    elapsed;
+	vmd->vmd_inactive_free_pps = (freed - vmd->vmd_rate_freed) * hz /
+	    elapsed;
+	vmd->vmd_rate_scanned = scanned;
+	vmd->vmd_rate_freed = freed;
+	vmd->vmd_rate_ticks = ticks;
+}
+
+/*
+ * Attempt to reclaim the requested number of pages from the inactive queue.
+ * Returns true if the shortage was addressed.
+ */
+static int
+vm_pageout_scan_inactive(struct vm_domain *vmd, int shortage,
+    int *addl_shortage)
+{
+	struct vm_pagequeue *pq;
+	int addl_page_shortage, deficit, freed, page_shortage;
+	int starting_page_shortage;
+
+	/*
+	 * vmd_pageout_deficit counts the number of pages requested in
+	 * allocations that failed because of a free page shortage.  We assume
+	 * that the allocations will be reattempted and thus include the deficit
+	 * in our scan target.
+	 */
+	deficit = atomic_readandclear_int(&vmd->vmd_pageout_deficit);
+	starting_page_shortage = shortage + deficit;
+
+	freed = vm_pageout_inactive_dispatch(vmd, starting_page_shortage,
+	    &addl_page_shortage);
+	page_shortage = starting_page_shortage - freed;
+	vmd->vmd_pdfreed += freed;
+
+	VM_CNT_ADD(v_dfree, freed);
 
 	/*
 	 * Wake up the laundry thread so that it can perform any needed
@@ -1604,8 +1738,7 @@ vm_pageout_scan_inactive(struct vm_domain *vmd, int shortage,
 				    VM_LAUNDRY_BACKGROUND;
 			wakeup(&vmd->vmd_laundry_request);
 		}
-		vmd->vmd_clean_pages_freed +=
-		    starting_page_shortage - page_shortage;
+		vmd->vmd_clean_pages_freed += freed;
 		vm_pagequeue_unlock(pq);
 	}
 
@@ -1903,6 +2036,7 @@ vm_pageout_worker(void *arg)
 
 	KASSERT(vmd->vmd_segs != 0, ("domain without segments"));
 	vmd->vmd_last_active_scan = ticks;
+	vmd->vmd_rate_ticks = ticks;
 
 	/*
 	 * The pageout daemon worker is never done, so loop forever.
@@ -1967,6 +2101,8 @@ vm_pageout_worker(void *arg)
 		 */
 		shortage = vm_pageout_active_target(vmd) + addl_shortage;
 		vm_pageout_scan_active(vmd, shortage);
+
+		vm_pageout_update_rates(vmd);
 	}
 }
 
@@ -1978,6 +2114,7 @@ vm_pageout_init_domain(int domain)
 {
 	struct vm_domain *vmd;
 	struct sysctl_oid *oid;
+	int ncpus;
 
 	vmd = VM_DOMAIN(domain);
 	vmd->vmd_interrupt_free_min = 2;
@@ -2024,6 +2161,18 @@ vm_pageout_init_domain(int domain)
 	oid = SYSCTL_ADD_NODE(NULL, SYSCTL_CHILDREN(vmd->vmd_oid), OID_AUTO,
 	    "pidctrl", CTLFLAG_RD, NULL, "");
 	pidctrl_init_sysctl(&vmd->vmd_pid, SYSCTL_CHILDREN(oid));
+
+	/*
+	 * Scale the number of inactive queue scan threads with the number of
+	 * CPUs in the domain, since those are what drive allocation bursts.
+	 */
+	ncpus = CPU_COUNT(&cpuset_domain[domain]);
+	if (ncpus == 0)
+		ncpus = mp_ncpus / vm_ndomains;
+	vmd->vmd_inactive_threads = 1;
+	if (vm_pageout_cpus_per_thread > 0)
+		vmd->vmd_inactive_threads = min(MAXCPU, max(1,
+		    ncpus / vm_pageout_cpus_per_thread));
 }
 
 static void
@@ -2069,6 +2218,21 @@ vm_pageout_init(void)
 /*
  *     vm_pageout is the high level pageout daemon.
  */
+static void
+vm_pageout_start_helpers(int domain)
+{
+	int error, i;
+
+	for (i = 1; i < VM_DOMAIN(domain)->vmd_inactive_threads; i++) {
+		error = kthread_add(vm_pageout_inactive_helper,
+		    (void *)(uintptr_t)domain, curproc, NULL, 0, 0,
+		    "dom%d helper%d", domain, i);
+		if (error != 0)
+			panic("starting pageout helper %d for domain %d, "
+			    "error %d", i, domain, error);
+	}
+}
+
 static void
 vm_pageout(void)
 {
@@ -2081,6 +2245,7 @@ vm_pageout(void)
 	    0, 0, "laundry: dom0");
 	if (error != 0)
 		panic("starting laundry for domain 0, error %d", error);
+	vm_pageout_start_helpers(0);
 	for (i = 1; i < vm_ndomains; i++) {
 		if (VM_DOMAIN_EMPTY(i)) {
 			if (bootverbose)
@@ -2101,6 +2266,7 @@ vm_pageout(void)
 		if (error != 0)
 			panic("starting laundry for domain %d, error %d",
 			    i, error);
+		vm_pageout_start_helpers(i);
 	}
 	error = kthread_add(uma_reclaim_worker, NULL, curproc, NULL,
 	    0, 0, "uma");
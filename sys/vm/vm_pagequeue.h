@@ -84,6 +84,7 @@ struct vm_batchqueue {
 } __aligned(CACHE_LINE_SIZE);
 
 #include <vm/uma.h>
+#include <sys/counter.h>
 #include <sys/pidctrl.h>
 struct sysctl_oid;
 
@@ -103,7 +104,11 @@ struct vm_domain {
 	struct vm_pagequeue vmd_pagequeues[PQ_COUNT];
 	struct mtx_padalign vmd_free_mtx;
 	struct mtx_padalign vmd_pageout_mtx;
-	uma_zone_t vmd_pgcache;		/* (c) page free cache. */
+	struct vm_pgcache {
+		int domain;
+		int pool;
+		uma_zone_t zone;
+	} vmd_pgcache[VM_NFREEPOOL];	/* (c) per-CPU page free caches. */
 	struct vmem *vmd_kernel_arena;	/* (c) per-domain kva R/W arena. */
 	struct vmem *vmd_kernel_rwx_arena; /* (c) per-domain kva R/W/X arena. */
 	u_int vmd_domain;		/* (c) Domain number. */
@@ -144,6 +149,29 @@ struct vm_domain {
 	u_int vmd_interrupt_free_min;	/* (c) reserved pages for int code */
 	u_int vmd_free_severe;		/* (c) severe page depletion point */
 
+	/* Free queue lock statistics, maintained by the page allocator. */
+	counter_u64_t vmd_free_lock_acq; /* (c) lock acquisitions */
+	counter_u64_t vmd_free_lock_contended; /* (c) contended acquisitions */
+	counter_u64_t vmd_free_lock_pages; /* (c) pages moved under the lock */
+
+	/* Parallel inactive queue scans, see vm_pageout_inactive_dispatch(). */
+	int vmd_inactive_threads;	/* (c) threads scanning the queue */
+	int vmd_inactive_shortage;	/* (p) per-helper scan target */
+	int vmd_inactive_pending;	/* (p) helpers yet to start */
+	int vmd_inactive_running;	/* (p) helpers yet to finish */
+	u_int vmd_inactive_freed;	/* (a) pages freed by helpers */
+	u_int vmd_inactive_addl;	/* (a) stuck pages seen by helpers */
+
+	/* Reclaim telemetry, updated by the page daemon once a second. */
+	uint64_t vmd_pdfreed;		/* (p) pages freed by inactive scans */
+	uint64_t vmd_rate_scanned;	/* (p) inactive pages scanned at last */
+	uint64_t vmd_rate_freed;	/* (p) pages freed at last update */
+	int vmd_rate_ticks;		/* (p) time of last update */
+	u_int vmd_inactive_scan_pps;	/* (p) inactive pages scanned/sec */
+	u_int vmd_inactive_free_pps;	/* (p) inactive pages freed/sec */
+	counter_u64_t vmd_wait_stalls;	/* (c) vm_wait() sleeps */
+	counter_u64_t vmd_wait_usecs;	/* (c) time spent in vm_wait() */
+
 	/* Name for sysctl etc. */
 	struct sysctl_oid *vmd_oid;
 	char vmd_name[sizeof(__XSTRING(MAXMEMDOM))];
@@ -45,14 +45,17 @@ __FBSDID("$FreeBSD$");
 
 #include <sys/param.h>
 #include <sys/kernel.h>
+#include <sys/kthread.h>
 #include <sys/lock.h>
 #include <sys/malloc.h>
 #include <sys/mutex.h>
+#include <sys/proc.h>
 #include <sys/queue.h>
 #include <sys/rwlock.h>
 #include <sys/sbuf.h>
 #include <sys/sysctl.h>
 #include <sys/systm.h>
+#include <sys/time.h>
 #include <sys/counter.h>
 #include <sys/ktr.h>
 #include <sys/vmmeter.h>
@@ -121,6 +124,12 @@ typedef	u_long		popmap_t;
  */
 #define	PARTPOPSLOP	1
 
+/*
+ * The maximum number of reservations that a single compaction pass collects
+ * from a domain's partially populated reservation queue.
+ */
+#define	VM_RESERV_COMPACT_BATCH	16
+
 /*
  * Clear a bit in the population map.
  */
@@ -265,6 +274,44 @@ static counter_u64_t vm_reserv_reclaimed = EARLY_COUNTER;
 SYSCTL_COUNTER_U64(_vm_reserv, OID_AUTO, reclaimed, CTLFLAG_RD,
     &vm_reserv_reclaimed, "Cumulative number of reclaimed reservations");
 
+/*
+ * Per-domain reservation statistics, exported under vm.reserv.domain.
+ */
+struct vm_reserv_domain_stats {
+	counter_u64_t	promotions;	/* reservations fully populated */
+	counter_u64_t	compacted;	/* superpages rebuilt by compaction */
+	counter_u64_t	compact_failed;	/* failed compaction attempts */
+	counter_u64_t	compact_pages;	/* pages relocated by compaction */
+	counter_u64_t	compact_usec;	/* time spent compacting */
+};
+
+static struct vm_reserv_domain_stats vm_reserv_dstats[MAXMEMDOM];
+
+/*
+ * The reservation compaction daemon periodically relocates the pages of
+ * sparse, idle reservations so that their superpages return to the physical
+ * memory allocator in one piece.
+ */
+static int vm_reserv_compact_interval = 1000;
+SYSCTL_INT(_vm_reserv, OID_AUTO, compact_interval, CTLFLAG_RWTUN,
+    &vm_reserv_compact_interval, 0,
+    "Milliseconds between compaction passes, 0 disables compaction");
+
+static int vm_reserv_compact_duty = 5;
+SYSCTL_INT(_vm_reserv, OID_AUTO, compact_duty, CTLFLAG_RWTUN,
+    &vm_reserv_compact_duty, 0,
+    "Maximum percentage of each compaction interval spent relocating pages");
+
+static int vm_reserv_compact_maxpop = VM_LEVEL_0_NPAGES / 8;
+SYSCTL_INT(_vm_reserv, OID_AUTO, compact_maxpop, CTLFLAG_RWTUN,
+    &vm_reserv_compact_maxpop, 0,
+    "Maximum population of a reservation chosen for compaction");
+
+static int vm_reserv_compact_idle = 10;
+SYSCTL_INT(_vm_reserv, OID_AUTO, compact_idle, CTLFLAG_RWTUN,
+    &vm_reserv_compact_idle, 0,
+    "Seconds a reservation must go unchanged before it is compacted");
+
 /*
  * The object lock pool is used to synchronize the rvq.  We can not use a
  * pool mutex because it is required before malloc works.
@@ -565,6 +612,7 @@ vm_reserv_populate(vm_reserv_t rv, int index)
 		    ("vm_reserv_populate: reserv %p is already promoted",
 		    rv));
 		rv->pages->psind = 1;
+		counter_u64_add(vm_reserv_dstats[rv->domain].promotions, 1);
 	}
 	vm_reserv_domain_unlock(rv->domain);
 }
@@ -1170,6 +1218,11 @@ vm_reserv_init(void)
 		mtx_init(&vm_reserv_domain_locks[i], "VM reserv domain", NULL,
 		    MTX_DEF);
 		TAILQ_INIT(&vm_rvq_partpop[i]);
+		vm_reserv_dstats[i].promotions = EARLY_COUNTER;
+		vm_reserv_dstats[i].compacted = EARLY_COUNTER;
+		vm_reserv_dstats[i].compact_failed = EARLY_COUNTER;
+		vm_reserv_dstats[i].compact_pages = EARLY_COUNTER;
+		vm_reserv_dstats[i].compact_usec = EARLY_COUNTER;
 	}
 
 	for (i = 0; i < VM_RESERV_OBJ_LOCK_COUNT; i++)
@@ -1382,6 +1435,114 @@ vm_reserv_reclaim_contig(int domain, u_long npages, vm_paddr_t low,
 	return (FALSE);
 }
 
+/*
+ * Relocates the allocated pages of sparse, idle reservations in the given
+ * domain using vm_page_reclaim_contig_domain().  Once a reservation's last
+ * page is relocated, vm_reserv_depopulate() frees the entire superpage to
+ * the physical memory allocator, where it can back a new reservation.  Stops
+ * early if "deadline" passes or the domain runs short of free pages.
+ *
+ * A reservation that cannot be compacted has its "lasttick" refreshed so
+ * that it is not retried until it has been idle again.
+ */
+static void
+vm_reserv_compact_domain(int domain, sbintime_t deadline)
+{
+	struct vm_reserv_domain_stats *ds;
+	struct vm_domain *vmd;
+	vm_paddr_t pa;
+	vm_reserv_t rv, rvs[VM_RESERV_COMPACT_BATCH];
+	sbintime_t start;
+	int count, i, idle, maxpop, popcnt;
+
+	ds = &vm_reserv_dstats[domain];
+	vmd = VM_DOMAIN(domain);
+	idle = vm_reserv_compact_idle * hz;
+	maxpop = vm_reserv_compact_maxpop;
+	if (maxpop <= 0 || vm_paging_target(vmd) > 0)
+		return;
+
+	/*
+	 * Collect candidates from the head of the queue, where the least
+	 * recently changed reservations are found.  The candidates are only
+	 * hints; vm_page_reclaim_contig_domain() revalidates every page.
+	 */
+	count = 0;
+	vm_reserv_domain_lock(domain);
+	TAILQ_FOREACH(rv, &vm_rvq_partpop[domain], partpopq) {
+		if ((unsigned)(ticks - rv->lasttick) < (unsigned)idle)
+			continue;
+		if (rv->popcnt > maxpop)
+			continue;
+		rvs[count++] = rv;
+		if (count == VM_RESERV_COMPACT_BATCH)
+			break;
+	}
+	vm_reserv_domain_unlock(domain);
+
+	for (i = 0; i < count; i++) {
+		if (sbinuptime() >= deadline || vm_paging_target(vmd) > 0)
+			break;
+		rv = rvs[i];
+		popcnt = rv->popcnt;
+		if (rv->object == NULL || popcnt == 0 || popcnt > maxpop)
+			continue;
+		pa = VM_PAGE_TO_PHYS(rv->pages);
+		start = sbinuptime();
+		if (vm_page_reclaim_contig_domain(domain, VM_ALLOC_NORMAL,
+		    VM_LEVEL_0_NPAGES, pa, pa + VM_LEVEL_0_SIZE,
+		    VM_LEVEL_0_SIZE, 0)) {
+			counter_u64_add(ds->compacted, 1);
+			counter_u64_add(ds->compact_pages, popcnt);
+		} else {
+			counter_u64_add(ds->compact_failed, 1);
+			vm_reserv_lock(rv);
+			if (rv->object != NULL)
+				rv->lasttick = ticks;
+			vm_reserv_unlock(rv);
+		}
+		counter_u64_add(ds->compact_usec,
+		    (sbinuptime() - start) / SBT_1US);
+	}
+}
+
+/*
+ * The reservation compaction daemon.  Every "compact_interval" milliseconds,
+ * compacts each domain for at most "compact_duty" percent of the interval.
+ */
+static void
+vm_reserv_compactd(void)
+{
+	sbintime_t budget, deadline;
+	int domain, interval;
+
+	for (;;) {
+		interval = vm_reserv_compact_interval;
+		if (interval <= 0) {
+			tsleep(&vm_reserv_compact_interval, PPAUSE, "rvidle",
+			    hz);
+			continue;
+		}
+		budget = SBT_1MS * interval * imin(imax(vm_reserv_compact_duty,
+		    0), 100) / 100;
+		deadline = sbinuptime() + budget;
+		for (domain = 0; domain < vm_ndomains; domain++)
+			vm_reserv_compact_domain(domain, deadline);
+		tsleep(&vm_reserv_compact_interval, PPAUSE, "rvcmpt",
+		    imax(1, (int)((int64_t)interval * hz / 1000)));
+	}
+}
+
+static struct proc *vm_reserv_compactproc;
+
+static struct kproc_desc vm_reserv_compact_kp = {
+	"reservd",
+	vm_reserv_compactd,
+	&vm_reserv_compactproc
+};
+SYSINIT(reservd, SI_SUB_KTHREAD_VM, SI_ORDER_ANY, kproc_start,
+    &vm_reserv_compact_kp);
+
 /*
  * Transfers the reservation underlying the given page to a new object.
  *
@@ -1474,10 +1635,45 @@ vm_reserv_startup(vm_offset_t *vaddr, vm_paddr_t end, vm_paddr_t high_water)
 static void
 vm_reserv_counter_init(void *unused)
 {
+	struct vm_reserv_domain_stats *ds;
+	struct sysctl_oid *oid, *doid;
+	char name[16];
+	int i;
 
 	vm_reserv_freed = counter_u64_alloc(M_WAITOK); 
 	vm_reserv_broken = counter_u64_alloc(M_WAITOK); 
 	vm_reserv_reclaimed = counter_u64_alloc(M_WAITOK); 
+
+	oid = SYSCTL_ADD_NODE(NULL, SYSCTL_STATIC_CHILDREN(_vm_reserv),
+	    OID_AUTO, "domain", CTLFLAG_RD, NULL, "");
+	for (i = 0; i < vm_ndomains; i++) {
+		ds = &vm_reserv_dstats[i];
+		ds->promotions = counter_u64_alloc(M_WAITOK);
+		ds->compacted = counter_u64_alloc(M_WAITOK);
+		ds->compact_failed = counter_u64_alloc(M_WAITOK);
+		ds->compact_pages = counter_u64_alloc(M_WAITOK);
+		ds->compact_usec = counter_u64_alloc(M_WAITOK);
+
+		snprintf(name, sizeof(name), "%d", i);
+		doid = SYSCTL_ADD_NODE(NULL, SYSCTL_CHILDREN(oid), OID_AUTO,
+		    name, CTLFLAG_RD, NULL, "");
+		SYSCTL_ADD_COUNTER_U64(NULL, SYSCTL_CHILDREN(doid), OID_AUTO,
+		    "promotions", CTLFLAG_RD, &ds->promotions,
+		    "Cumulative number of reservations that became fully "
+		    "populated and thus eligible for promotion");
+		SYSCTL_ADD_COUNTER_U64(NULL, SYSCTL_CHILDREN(doid), OID_AUTO,
+		    "compacted", CTLFLAG_RD, &ds->compacted,
+		    "Cumulative number of superpages rebuilt by compaction");
+		SYSCTL_ADD_COUNTER_U64(NULL, SYSCTL_CHILDREN(doid), OID_AUTO,
+		    "compact_failed", CTLFLAG_RD, &ds->compact_failed,
+		    "Cumulative number of failed compaction attempts");
+		SYSCTL_ADD_COUNTER_U64(NULL, SYSCTL_CHILDREN(doid), OID_AUTO,
+		    "compact_pages", CTLFLAG_RD, &ds->compact_pages,
+		    "Cumulative number of pages relocated by compaction");
+		SYSCTL_ADD_COUNTER_U64(NULL, SYSCTL_CHILDREN(doid), OID_AUTO,
+		    "compact_usec", CTLFLAG_RD, &ds->compact_usec,
+		    "Cumulative microseconds spent in compaction");
+	}
 }
 SYSINIT(vm_reserv_counter_init, SI_SUB_CPU, SI_ORDER_ANY,
     vm_reserv_counter_init, NULL);
@@ -447,8 +447,8 @@ dmar_bus_dmamem_alloc(bus_dma_tag_t dmat, void** vaddr, int flags,
 	if (tag->common.maxsize < PAGE_SIZE &&
 	    tag->common.alignment <= tag->common.maxsize &&
 	    attr == VM_MEMATTR_DEFAULT) {
-		*vaddr = malloc_domain(tag->common.maxsize, M_DEVBUF,
-		    tag->common.domain, mflags);
+		*vaddr = malloc_domain(MALLOC_ALIGNED_SIZE(tag->common.maxsize),
+		    M_DEVBUF, tag->common.domain, mflags);
 		map->flags |= BUS_DMAMAP_DMAR_MALLOC;
 	} else {
 		*vaddr = (void *)kmem_alloc_attr_domain(tag->common.domain,
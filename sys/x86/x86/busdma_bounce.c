@@ -452,7 +452,8 @@ bounce_bus_dmamem_alloc(bus_dma_tag_t dmat, void** vaddr, int flags,
 	   (dmat->common.alignment <= dmat->common.maxsize) &&
 	    dmat->common.lowaddr >= ptoa((vm_paddr_t)Maxmem) &&
 	    attr == VM_MEMATTR_DEFAULT) {
-		*vaddr = malloc_domain(dmat->common.maxsize, M_DEVBUF,
+		*vaddr = malloc_domain(
+		    MALLOC_ALIGNED_SIZE(dmat->common.maxsize), M_DEVBUF,
 		    dmat->common.domain, mflags);
 	} else if (dmat->common.nsegments >=
 	    howmany(dmat->common.maxsize, MIN(dmat->common.maxsegsz, PAGE_SIZE)) &&
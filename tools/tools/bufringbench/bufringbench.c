@@ -0,0 +1,208 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause-FreeBSD
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $FreeBSD$
+ */
+
+/*
+ * Multi-producer, single-consumer buf_ring(9) microbenchmark.
+ *
+ * Each producer kthread pushes its share of the items either one at a
+ * time or in batches; the thread running the sysctl drains the ring
+ * with the matching single or burst dequeue until every item has been
+ * seen, so the measured rate is what a driver transmit path would get.
+ */
+
+#include <sys/param.h>
+#include <sys/systm.h>
+#include <sys/buf_ring.h>
+#include <sys/kernel.h>
+#include <sys/kthread.h>
+#include <sys/lock.h>
+#include <sys/malloc.h>
+#include <sys/module.h>
+#include <sys/mutex.h>
+#include <sys/proc.h>
+#include <sys/sched.h>
+#include <sys/sysctl.h>
+
+#define	BRB_MAXBATCH	256
+#define	BRB_MAXPROD	64
+
+static MALLOC_DEFINE(M_BRB, "bufringbench", "buf_ring benchmark");
+
+static int brb_ringsize = 4096;
+static int brb_producers = 2;
+static int brb_batch = 32;
+static int brb_items = 10000000;
+static char brb_result[128];
+
+struct brb_run {
+	struct buf_ring	*br;
+	struct mtx	lock;
+	int		batch;
+	int		items;		/* per producer */
+	volatile int	running;
+	volatile int	go;
+	volatile u_long	retries;
+};
+
+static void
+brb_producer(void *arg)
+{
+	struct brb_run *run = arg;
+	void *bufs[BRB_MAXBATCH];
+	int i, n, sent;
+
+	while (run->go == 0)
+		cpu_spinwait();
+	for (sent = 0; sent < run->items; sent += n) {
+		n = min(run->batch, run->items - sent);
+		for (i = 0; i < n; i++)
+			bufs[i] = (void *)(uintptr_t)(sent + i + 1);
+		if (n == 1) {
+			while (buf_ring_enqueue(run->br, bufs[0]) != 0) {
+				atomic_add_long(&run->retries, 1);
+				cpu_spinwait();
+			}
+		} else {
+			while (buf_ring_enqueue_bulk(run->br, bufs, n) != 0) {
+				atomic_add_long(&run->retries, 1);
+				cpu_spinwait();
+			}
+		}
+	}
+	atomic_subtract_int(&run->running, 1);
+	kthread_exit();
+}
+
+static int
+brb_run(void)
+{
+	struct brb_run run;
+	void *bufs[BRB_MAXBATCH];
+	sbintime_t start, elapsed;
+	uint64_t total, seen, rate;
+	int error, i, n;
+
+	if (brb_producers < 1 || brb_producers > BRB_MAXPROD ||
+	    brb_batch < 1 || brb_batch > BRB_MAXBATCH ||
+	    brb_batch >= brb_ringsize || brb_items < 1 ||
+	    !powerof2(brb_ringsize))
+		return (EINVAL);
+
+	bzero(&run, sizeof(run));
+	mtx_init(&run.lock, "bufringbench", NULL, MTX_DEF);
+	run.br = buf_ring_alloc(brb_ringsize, M_BRB, M_WAITOK, &run.lock);
+	run.batch = brb_batch;
+	run.items = brb_items / brb_producers;
+	total = (uint64_t)run.items * brb_producers;
+
+	error = 0;
+	for (i = 0; i < brb_producers; i++) {
+		error = kthread_add(brb_producer, &run, NULL, NULL, 0, 0,
+		    "brb_prod%d", i);
+		if (error != 0)
+			break;
+		atomic_add_int(&run.running, 1);
+	}
+	if (error != 0) {
+		run.items = 0;
+		total = 0;
+	}
+
+	start = sbinuptime();
+	atomic_store_rel_int(&run.go, 1);
+	mtx_lock(&run.lock);
+	for (seen = 0; seen < total; seen += n) {
+		if (run.batch == 1)
+			n = buf_ring_dequeue_sc(run.br) != NULL;
+		else
+			n = buf_ring_dequeue_burst_sc(run.br, bufs, run.batch);
+		if (n == 0)
+			cpu_spinwait();
+	}
+	mtx_unlock(&run.lock);
+	elapsed = sbinuptime() - start;
+
+	while (run.running != 0)
+		pause("brbexit", 1);
+	if (error == 0) {
+		rate = elapsed > 0 ? total * SBT_1S / elapsed : 0;
+		snprintf(brb_result, sizeof(brb_result),
+		    "%d producers, batch %d: %ju items/s, %lu retries",
+		    brb_producers, brb_batch, (uintmax_t)rate, run.retries);
+	}
+	buf_ring_free(run.br, M_BRB);
+	mtx_destroy(&run.lock);
+	return (error);
+}
+
+static int
+sysctl_brb_run(SYSCTL_HANDLER_ARGS)
+{
+	int error, val;
+
+	val = 0;
+	error = sysctl_handle_int(oidp, &val, 0, req);
+	if (error != 0 || req->newptr == NULL || val == 0)
+		return (error);
+	return (brb_run());
+}
+
+static SYSCTL_NODE(_debug, OID_AUTO, bufringbench, CTLFLAG_RW, 0,
+    "buf_ring benchmark");
+SYSCTL_INT(_debug_bufringbench, OID_AUTO, ringsize, CTLFLAG_RW,
+    &brb_ringsize, 0, "Ring size, a power of 2");
+SYSCTL_INT(_debug_bufringbench, OID_AUTO, producers, CTLFLAG_RW,
+    &brb_producers, 0, "Producer threads");
+SYSCTL_INT(_debug_bufringbench, OID_AUTO, batch, CTLFLAG_RW,
+    &brb_batch, 0, "Items per enqueue and dequeue call");
+SYSCTL_INT(_debug_bufringbench, OID_AUTO, items, CTLFLAG_RW,
+    &brb_items, 0, "Items to move per run");
+SYSCTL_PROC(_debug_bufringbench, OID_AUTO, run,
+    CTLTYPE_INT | CTLFLAG_RW | CTLFLAG_MPSAFE, NULL, 0, sysctl_brb_run, "I",
+    "Write 1 to run the benchmark");
+SYSCTL_STRING(_debug_bufringbench, OID_AUTO, result, CTLFLAG_RD,
+    brb_result, 0, "Outcome of the last run");
+
+static int
+brb_modevent(module_t mod __unused, int type, void *data __unused)
+{
+
+	switch (type) {
+	case MOD_LOAD:
+	case MOD_UNLOAD:
+		return (0);
+	default:
+		return (EOPNOTSUPP);
+	}
+}
+
+static moduledata_t brb_mod = {
+	"bufringbench",
+	brb_modevent,
+	NULL
+};
+DECLARE_MODULE(bufringbench, brb_mod, SI_SUB_PSEUDO, SI_ORDER_ANY);
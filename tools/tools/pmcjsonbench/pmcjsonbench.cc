@@ -0,0 +1,135 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause-FreeBSD
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ *
+ * $FreeBSD$
+ */
+
+/*
+ * Measure the conversion of recorded pmclog events to JSON.  See README.
+ */
+#include <sys/types.h>
+#include <sys/time.h>
+
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pmc.h>
+#include <pmclog.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include <pmcformat.h>
+
+static double
+now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return (tv.tv_sec + tv.tv_usec / 1e6);
+}
+
+static void
+report(const char *name, size_t nevents, size_t bytes, double elapsed)
+{
+
+	if (elapsed <= 0)
+		elapsed = 1e-6;
+	printf("%-8s %10.0f events/s %8.1f MB/s\n", name, nevents / elapsed,
+	    bytes / elapsed / (1024 * 1024));
+}
+
+int
+main(int argc, char **argv)
+{
+	std::vector<struct pmclog_ev> events;
+	std::string buf, one, all;
+	struct pmclog_ev ev;
+	size_t bytes, maxevents, npasses, pass;
+	double start;
+	void *ps;
+	int fd;
+
+	if (argc < 2 || argc > 4)
+		errx(EX_USAGE, "usage: pmcjsonbench log [events [passes]]");
+	maxevents = argc > 2 ? strtoul(argv[2], NULL, 0) : 50000;
+	npasses = argc > 3 ? strtoul(argv[3], NULL, 0) : 20;
+
+	if ((fd = open(argv[1], O_RDONLY)) < 0)
+		err(EX_NOINPUT, "%s", argv[1]);
+	if ((ps = pmclog_open(fd)) == NULL)
+		err(EX_OSERR, "pmclog_open");
+	while (events.size() < maxevents && pmclog_read(ps, &ev) == 0)
+		events.push_back(ev);
+	pmclog_close(ps);
+	close(fd);
+	if (events.empty())
+		errx(EX_DATAERR, "%s: no events", argv[1]);
+
+	/* Both methods must produce the same text. */
+	for (auto &e : events) {
+		all += event_to_json(&e);
+		event_to_json(&e, buf);
+	}
+	if (all != buf)
+		errx(EX_SOFTWARE, "outputs differ");
+	printf("%zu events, %zu bytes of JSON per pass, %zu passes\n",
+	    events.size(), buf.size(), npasses);
+
+	bytes = 0;
+	start = now();
+	for (pass = 0; pass < npasses; pass++) {
+		for (auto &e : events) {
+			one = event_to_json(&e);
+			bytes += one.size();
+		}
+	}
+	report("string", events.size() * npasses, bytes, now() - start);
+
+	bytes = 0;
+	buf.clear();
+	start = now();
+	for (pass = 0; pass < npasses; pass++) {
+		for (auto &e : events) {
+			event_to_json(&e, buf);
+			if (buf.size() >= PMC_JSON_FLUSH_SIZE) {
+				bytes += buf.size();
+				buf.clear();
+			}
+		}
+	}
+	bytes += buf.size();
+	report("append", events.size() * npasses, bytes, now() - start);
+	return (0);
+}
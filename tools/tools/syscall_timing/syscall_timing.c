@@ -36,9 +36,12 @@
 #include <sys/resource.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/sysctl.h>
 #include <sys/time.h>
 #include <sys/wait.h>
 
+#include <netinet/in.h>
+
 #include <assert.h>
 #include <err.h>
 #include <errno.h>
@@ -50,6 +53,7 @@
 #endif
 #include <semaphore.h>
 #include <signal.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -154,6 +158,57 @@ test_clock_gettime(uintmax_t num, uintmax_t int_arg __unused, const char *path _
 	return (i);
 }
 
+/*
+ * The cost of these two is dominated by copyin(9) and copyout(9) for all
+ * but the smallest sizes: writes to a shared memory object are copied in
+ * page by page, and reads from /dev/zero are copied out of the kernel's
+ * zero region.
+ */
+static uintmax_t
+test_copyin(uintmax_t num, uintmax_t int_arg, const char *path __unused)
+{
+	char buf[int_arg];
+	uintmax_t i;
+	int shmfd;
+
+	shmfd = shm_open(SHM_ANON, O_CREAT | O_RDWR, 0600);
+	if (shmfd < 0)
+		err(-1, "test_copyin: shm_open");
+	if (ftruncate(shmfd, int_arg) < 0)
+		err(-1, "test_copyin: ftruncate");
+	memset(buf, 0, int_arg);
+	if (pwrite(shmfd, buf, int_arg, 0) != (ssize_t)int_arg)
+		err(-1, "test_copyin: pwrite");
+	benchmark_start();
+	BENCHMARK_FOREACH(i, num) {
+		(void)pwrite(shmfd, buf, int_arg, 0);
+	}
+	benchmark_stop();
+	close(shmfd);
+	return (i);
+}
+
+static uintmax_t
+test_copyout(uintmax_t num, uintmax_t int_arg, const char *path __unused)
+{
+	char buf[int_arg];
+	uintmax_t i;
+	int fd;
+
+	fd = open("/dev/zero", O_RDONLY);
+	if (fd < 0)
+		err(-1, "test_copyout: open: /dev/zero");
+	if (read(fd, buf, int_arg) != (ssize_t)int_arg)
+		err(-1, "test_copyout: read");
+	benchmark_start();
+	BENCHMARK_FOREACH(i, num) {
+		(void)read(fd, buf, int_arg);
+	}
+	benchmark_stop();
+	close(fd);
+	return (i);
+}
+
 static uintmax_t
 test_create_unlink(uintmax_t num, uintmax_t int_arg __unused, const char *path)
 {
@@ -242,6 +297,23 @@ test_fork_exec(uintmax_t num, uintmax_t int_arg __unused, const char *path __unu
 	return (i);
 }
 
+static uintmax_t
+test_getpid(uintmax_t num, uintmax_t int_arg __unused, const char *path __unused)
+{
+	uintmax_t i;
+
+	/*
+	 * This is process-local and does not change, so it is about the
+	 * cheapest system call there is.
+	 */
+	benchmark_start();
+	BENCHMARK_FOREACH(i, num) {
+		getpid();
+	}
+	benchmark_stop();
+	return (i);
+}
+
 static uintmax_t
 test_getppid(uintmax_t num, uintmax_t int_arg __unused, const char *path __unused)
 {
@@ -401,6 +473,33 @@ test_open_read_close(uintmax_t num, uintmax_t int_arg, const char *path)
 	return (i);
 }
 
+/*
+ * Map, touch and unmap int_arg anonymous pages: one zero-fill fault per
+ * page, plus the cost of tearing the mapping down again.
+ */
+static uintmax_t
+test_pagefault(uintmax_t num, uintmax_t int_arg, const char *path __unused)
+{
+	volatile char *p;
+	size_t len, off;
+	uintmax_t i;
+
+	len = int_arg * getpagesize();
+	benchmark_start();
+	BENCHMARK_FOREACH(i, num) {
+		p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+		    MAP_ANON | MAP_PRIVATE, -1, 0);
+		if (p == MAP_FAILED)
+			err(-1, "test_pagefault: mmap");
+		for (off = 0; off < len; off += getpagesize())
+			p[off] = 1;
+		if (munmap(__DEVOLATILE(char *, p), len) < 0)
+			err(-1, "test_pagefault: munmap");
+	}
+	benchmark_stop();
+	return (i);
+}
+
 static uintmax_t
 test_pipe(uintmax_t num, uintmax_t int_arg __unused, const char *path __unused)
 {
@@ -739,6 +838,66 @@ test_shmfd_fstat(uintmax_t num, uintmax_t int_arg __unused, const char *path __u
 	return (i);
 }
 
+#ifdef WITH_PTHREAD
+static volatile int shootdown_stop;
+
+static void *
+shootdown_proc(void *arg __unused)
+{
+
+	while (shootdown_stop == 0)
+		;
+	return (NULL);
+}
+
+/*
+ * Write-protect a dirty page while int_arg other threads spin in the same
+ * address space, so each iteration has to invalidate the TLB entry on every
+ * CPU running one of them.  Then make the page writable and dirty it again.
+ */
+static uintmax_t
+test_shootdown(uintmax_t num, uintmax_t int_arg, const char *path __unused)
+{
+	pthread_t *td;
+	volatile char *p;
+	uintmax_t i, j;
+	int error;
+
+	p = mmap(NULL, getpagesize(), PROT_READ | PROT_WRITE,
+	    MAP_ANON | MAP_PRIVATE, -1, 0);
+	if (p == MAP_FAILED)
+		err(-1, "test_shootdown: mmap");
+	td = calloc(MAX(int_arg, 1), sizeof(*td));
+	if (td == NULL)
+		err(1, "calloc");
+	shootdown_stop = 0;
+	for (j = 0; j < int_arg; j++) {
+		error = pthread_create(&td[j], NULL, shootdown_proc, NULL);
+		if (error != 0)
+			errc(1, error, "pthread_create");
+	}
+
+	benchmark_start();
+	BENCHMARK_FOREACH(i, num) {
+		p[0] = 1;
+		if (mprotect(__DEVOLATILE(char *, p), getpagesize(),
+		    PROT_READ) < 0)
+			err(-1, "test_shootdown: mprotect");
+		if (mprotect(__DEVOLATILE(char *, p), getpagesize(),
+		    PROT_READ | PROT_WRITE) < 0)
+			err(-1, "test_shootdown: mprotect");
+	}
+	benchmark_stop();
+
+	shootdown_stop = 1;
+	for (j = 0; j < int_arg; j++)
+		pthread_join(td[j], NULL);
+	free(td);
+	munmap(__DEVOLATILE(char *, p), getpagesize());
+	return (i);
+}
+#endif /* WITH_PTHREAD */
+
 static uintmax_t
 test_socket_stream(uintmax_t num, uintmax_t int_arg, const char *path __unused)
 {
@@ -823,6 +982,88 @@ test_socketpair_dgram(uintmax_t num, uintmax_t int_arg __unused, const char *pat
 	return (i);
 }
 
+/*
+ * Same as pipeping, but over a UNIX domain stream socket pair, to compare
+ * the two local IPC paths for a given message size.
+ */
+static uintmax_t
+test_socketpairping(uintmax_t num, uintmax_t int_arg, const char *path __unused)
+{
+	char buf[int_arg];
+	uintmax_t i;
+	pid_t pid;
+	int so[2], procfd;
+
+	if (socketpair(PF_LOCAL, SOCK_STREAM, 0, so) == -1)
+		err(-1, "test_socketpairping: socketpair");
+
+	pid = pdfork(&procfd, 0);
+	if (pid < 0)
+		err(1, "pdfork");
+
+	if (pid == 0) {
+		close(so[0]);
+
+		for (;;) {
+			readx(so[1], buf, int_arg);
+			writex(so[1], buf, int_arg);
+		}
+	}
+
+	close(so[1]);
+
+	benchmark_start();
+	BENCHMARK_FOREACH(i, num) {
+		writex(so[0], buf, int_arg);
+		readx(so[0], buf, int_arg);
+	}
+	benchmark_stop();
+
+	close(procfd);
+	return (i);
+}
+
+/*
+ * Send int_arg bytes to ourselves over UDP on the loopback interface and
+ * receive them again.  The inverse of the time per iteration is the
+ * loopback packet rate.
+ */
+static uintmax_t
+test_udpping(uintmax_t num, uintmax_t int_arg, const char *path __unused)
+{
+	struct sockaddr_in sin;
+	socklen_t len;
+	char buf[int_arg];
+	uintmax_t i;
+	int so;
+
+	so = socket(PF_INET, SOCK_DGRAM, 0);
+	if (so < 0)
+		err(-1, "test_udpping: socket");
+	bzero(&sin, sizeof(sin));
+	sin.sin_len = sizeof(sin);
+	sin.sin_family = AF_INET;
+	sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	if (bind(so, (struct sockaddr *)&sin, sizeof(sin)) < 0)
+		err(-1, "test_udpping: bind");
+	len = sizeof(sin);
+	if (getsockname(so, (struct sockaddr *)&sin, &len) < 0)
+		err(-1, "test_udpping: getsockname");
+	if (connect(so, (struct sockaddr *)&sin, sizeof(sin)) < 0)
+		err(-1, "test_udpping: connect");
+
+	benchmark_start();
+	BENCHMARK_FOREACH(i, num) {
+		if (send(so, buf, int_arg, 0) != (ssize_t)int_arg)
+			err(-1, "test_udpping: send");
+		if (recv(so, buf, int_arg, 0) != (ssize_t)int_arg)
+			err(-1, "test_udpping: recv");
+	}
+	benchmark_stop();
+	close(so);
+	return (i);
+}
+
 static uintmax_t
 test_vfork(uintmax_t num, uintmax_t int_arg __unused, const char *path __unused)
 {
@@ -895,9 +1136,24 @@ static const struct test tests[] = {
 	{ "bad_open", test_bad_open, .t_flags = 0 },
 	{ "chroot", test_chroot, .t_flags = 0 },
 	{ "clock_gettime", test_clock_gettime, .t_flags = 0 },
+	{ "copyin_1", test_copyin, .t_flags = 0, .t_int = 1 },
+	{ "copyin_10", test_copyin, .t_flags = 0, .t_int = 10 },
+	{ "copyin_100", test_copyin, .t_flags = 0, .t_int = 100 },
+	{ "copyin_1000", test_copyin, .t_flags = 0, .t_int = 1000 },
+	{ "copyin_10000", test_copyin, .t_flags = 0, .t_int = 10000 },
+	{ "copyin_100000", test_copyin, .t_flags = 0, .t_int = 100000 },
+	{ "copyin_1000000", test_copyin, .t_flags = 0, .t_int = 1000000 },
+	{ "copyout_1", test_copyout, .t_flags = 0, .t_int = 1 },
+	{ "copyout_10", test_copyout, .t_flags = 0, .t_int = 10 },
+	{ "copyout_100", test_copyout, .t_flags = 0, .t_int = 100 },
+	{ "copyout_1000", test_copyout, .t_flags = 0, .t_int = 1000 },
+	{ "copyout_10000", test_copyout, .t_flags = 0, .t_int = 10000 },
+	{ "copyout_100000", test_copyout, .t_flags = 0, .t_int = 100000 },
+	{ "copyout_1000000", test_copyout, .t_flags = 0, .t_int = 1000000 },
 	{ "create_unlink", test_create_unlink, .t_flags = FLAG_PATH },
 	{ "fork", test_fork, .t_flags = 0 },
 	{ "fork_exec", test_fork_exec, .t_flags = 0 },
+	{ "getpid", test_getpid, .t_flags = 0 },
 	{ "getppid", test_getppid, .t_flags = 0 },
 	{ "getpriority", test_getpriority, .t_flags = 0 },
 	{ "getprogname", test_getprogname, .t_flags = 0 },
@@ -926,6 +1182,9 @@ static const struct test tests[] = {
 	    .t_flags = FLAG_PATH, .t_int = 100000 },
 	{ "open_read_close_1000000", test_open_read_close,
 	    .t_flags = FLAG_PATH, .t_int = 1000000 },
+	{ "pagefault_1", test_pagefault, .t_flags = 0, .t_int = 1 },
+	{ "pagefault_16", test_pagefault, .t_flags = 0, .t_int = 16 },
+	{ "pagefault_512", test_pagefault, .t_flags = 0, .t_int = 512 },
 	{ "pipe", test_pipe, .t_flags = 0 },
 	{ "pipeping_1", test_pipeping, .t_flags = 0, .t_int = 1 },
 	{ "pipeping_10", test_pipeping, .t_flags = 0, .t_int = 10 },
@@ -956,12 +1215,28 @@ static const struct test tests[] = {
 	{ "shmfd", test_shmfd, .t_flags = 0 },
 	{ "shmfd_dup", test_shmfd_dup, .t_flags = 0 },
 	{ "shmfd_fstat", test_shmfd_fstat, .t_flags = 0 },
+#ifdef WITH_PTHREAD
+	{ "shootdown_0", test_shootdown, .t_flags = 0, .t_int = 0 },
+	{ "shootdown_1", test_shootdown, .t_flags = 0, .t_int = 1 },
+	{ "shootdown_3", test_shootdown, .t_flags = 0, .t_int = 3 },
+	{ "shootdown_7", test_shootdown, .t_flags = 0, .t_int = 7 },
+#endif
 	{ "socket_local_stream", test_socket_stream, .t_int = PF_LOCAL },
 	{ "socket_local_dgram", test_socket_dgram, .t_int = PF_LOCAL },
 	{ "socketpair_stream", test_socketpair_stream, .t_flags = 0 },
 	{ "socketpair_dgram", test_socketpair_dgram, .t_flags = 0 },
+	{ "socketpairping_1", test_socketpairping, .t_int = 1 },
+	{ "socketpairping_10", test_socketpairping, .t_int = 10 },
+	{ "socketpairping_100", test_socketpairping, .t_int = 100 },
+	{ "socketpairping_1000", test_socketpairping, .t_int = 1000 },
+	{ "socketpairping_10000", test_socketpairping, .t_int = 10000 },
+	{ "socketpairping_100000", test_socketpairping, .t_int = 100000 },
+	{ "socketpairping_1000000", test_socketpairping, .t_int = 1000000 },
 	{ "socket_tcp", test_socket_stream, .t_int = PF_INET },
 	{ "socket_udp", test_socket_dgram, .t_int = PF_INET },
+	{ "udpping_1", test_udpping, .t_int = 1 },
+	{ "udpping_100", test_udpping, .t_int = 100 },
+	{ "udpping_1000", test_udpping, .t_int = 1000 },
 	{ "vfork", test_vfork, .t_flags = 0 },
 	{ "vfork_exec", test_vfork_exec, .t_flags = 0 },
 };
@@ -972,7 +1247,7 @@ usage(void)
 {
 	int i;
 
-	fprintf(stderr, "syscall_timing [-i iterations] [-l loops] "
+	fprintf(stderr, "syscall_timing [-j] [-i iterations] [-l loops] "
 	    "[-p path] [-s seconds] test\n");
 	for (i = 0; i < tests_count; i++)
 		fprintf(stderr, "  %s\n", tests[i].t_name);
@@ -988,15 +1263,19 @@ main(int argc, char *argv[])
 	char *tmp_dir, *tmp_path;
 	long long ll;
 	char *endp;
+	char arch[32];
+	size_t archlen;
 	int ch, fd, error, i, j, rv;
 	uintmax_t iterations, k, loops;
+	bool json, first;
 
 	alarm_timeout = 1;
+	json = false;
 	iterations = 0;
 	loops = 10;
 	path = NULL;
 	tmp_path = NULL;
-	while ((ch = getopt(argc, argv, "i:l:p:s:")) != -1) {
+	while ((ch = getopt(argc, argv, "i:jl:p:s:")) != -1) {
 		switch (ch) {
 		case 'i':
 			ll = strtol(optarg, &endp, 10);
@@ -1005,6 +1284,10 @@ main(int argc, char *argv[])
 			iterations = ll;
 			break;
 
+		case 'j':
+			json = true;
+			break;
+
 		case 'l':
 			ll = strtol(optarg, &endp, 10);
 			if (*endp != 0 || ll < 1 || ll > 100000)
@@ -1068,9 +1351,26 @@ main(int argc, char *argv[])
 
 	error = clock_getres(CLOCK_REALTIME, &ts_res);
 	assert(error == 0);
-	printf("Clock resolution: %ju.%09ju\n", (uintmax_t)ts_res.tv_sec,
-	    (uintmax_t)ts_res.tv_nsec);
-	printf("test\tloop\ttime\titerations\tperiteration\n");
+	if (json) {
+		/*
+		 * One document per run, tagged with the architecture so
+		 * results from different machines can be stored together.
+		 */
+		archlen = sizeof(arch);
+		if (sysctlbyname("hw.machine_arch", arch, &archlen, NULL,
+		    0) < 0)
+			err(1, "sysctlbyname");
+		printf("{\n  \"machine_arch\": \"%s\",\n", arch);
+		printf("  \"clock_resolution_ns\": %ju,\n",
+		    (uintmax_t)ts_res.tv_sec * 1000000000 +
+		    (uintmax_t)ts_res.tv_nsec);
+		printf("  \"results\": [");
+	} else {
+		printf("Clock resolution: %ju.%09ju\n",
+		    (uintmax_t)ts_res.tv_sec, (uintmax_t)ts_res.tv_nsec);
+		printf("test\tloop\ttime\titerations\tperiteration\n");
+	}
+	first = true;
 
 	for (j = 0; j < argc; j++) {
 		uintmax_t calls, nsecsperit;
@@ -1103,9 +1403,12 @@ main(int argc, char *argv[])
 			calls = the_test->t_func(iterations, the_test->t_int,
 			    path);
 			timespecsub(&ts_end, &ts_start, &ts_end);
-			printf("%s\t%ju\t", the_test->t_name, k);
-			printf("%ju.%09ju\t%ju\t", (uintmax_t)ts_end.tv_sec,
-			    (uintmax_t)ts_end.tv_nsec, calls);
+			if (!json) {
+				printf("%s\t%ju\t", the_test->t_name, k);
+				printf("%ju.%09ju\t%ju\t",
+				    (uintmax_t)ts_end.tv_sec,
+				    (uintmax_t)ts_end.tv_nsec, calls);
+			}
 
 		/*
 		 * Note.  This assumes that each iteration takes less than
@@ -1116,9 +1419,21 @@ main(int argc, char *argv[])
 			nsecsperit = ts_end.tv_sec * 1000000000;
 			nsecsperit += ts_end.tv_nsec;
 			nsecsperit /= calls;
-			printf("0.%09ju\n", (uintmax_t)nsecsperit);
+			if (json) {
+				printf("%s\n    { \"test\": \"%s\", \"loop\": %ju, "
+				    "\"time_ns\": %ju, \"iterations\": %ju, "
+				    "\"periteration_ns\": %ju }",
+				    first ? "" : ",", the_test->t_name, k,
+				    (uintmax_t)ts_end.tv_sec * 1000000000 +
+				    (uintmax_t)ts_end.tv_nsec, calls,
+				    (uintmax_t)nsecsperit);
+				first = false;
+			} else
+				printf("0.%09ju\n", (uintmax_t)nsecsperit);
 		}
 	}
+	if (json)
+		printf("\n  ]\n}\n");
 
 	if (tmp_path != NULL) {
 		error = unlink(tmp_path);
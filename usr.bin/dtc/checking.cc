@@ -118,7 +118,7 @@ namespace
 bool
 checker::visit_node(device_tree *tree, const node_ptr &n)
 {
-	path.push_back(std::make_pair(n->name, n->unit_address));
+	path.push_back(n.get());
 	// Check this node
 	if (!check_node(tree, n))
 	{
@@ -149,21 +149,21 @@ void
 checker::report_error(const char *errmsg)
 {
 	fprintf(stderr, "Error: %s, while checking node: ", errmsg);
-	for (auto &p : path)
+	for (auto *p : path)
 	{
 		putc('/', stderr);
-		puts(p.first.c_str());
-		if (!(p.second.empty()))
+		puts(p->name.c_str());
+		if (!(p->unit_address.empty()))
 		{
 			putc('@', stderr);
-			puts(p.second.c_str());
+			puts(p->unit_address.c_str());
 		}
 	}
 	fprintf(stderr, " [-W%s]\n", checker_name);
 }
 
 bool
-property_checker::check_property(device_tree *tree, const node_ptr &n, property_ptr p)
+property_checker::check_property(device_tree *tree, const node_ptr &n, const property_ptr &p)
 {
 	if (p->get_key() == key)
 	{
@@ -177,7 +177,7 @@ property_checker::check_property(device_tree *tree, const node_ptr &n, property_
 }
 
 bool
-property_size_checker::check(device_tree *, const node_ptr &, property_ptr p)
+property_size_checker::check(device_tree *, const node_ptr &, const property_ptr &p)
 {
 	uint32_t psize = 0;
 	for (property::value_iterator i=p->begin(),e=p->end() ; i!=e ; ++i)
@@ -54,9 +54,10 @@ class checker
 {
 	/**
 	 * The path to the current node being checked.  This is used for
-	 * printing error messages.
+	 * printing error messages, so it holds the nodes rather than copies of
+	 * their names.
 	 */
-	device_tree::node_path path;
+	std::vector<const node*> path;
 	/**
 	 * The name of the checker.  This is used for printing error messages
 	 * and for enabling / disabling specific checkers from the command
@@ -96,7 +97,7 @@ class checker
 	 * Method for checking that a property is valid.  The root class
 	 * version does nothing, subclasses should override this.
 	 */
-	virtual bool check_property(device_tree *, const node_ptr &, property_ptr )
+	virtual bool check_property(device_tree *, const node_ptr &, const property_ptr &)
 	{
 		return true;
 	}
@@ -126,7 +127,7 @@ class property_checker : public checker
 	 * Implementation of the generic property-checking method that checks
 	 * for a property with the name specified in the constructor.
 	 */
-	virtual bool check_property(device_tree *tree, const node_ptr &n, property_ptr p);
+	virtual bool check_property(device_tree *tree, const node_ptr &n, const property_ptr &p);
 	/**
 	 * Constructor.  Takes the name of the checker and the name of the
 	 * property to check.
@@ -136,7 +137,7 @@ class property_checker : public checker
 	/**
 	 * The check method, which subclasses should implement.
 	 */
-	virtual bool check(device_tree *tree, const node_ptr &n, property_ptr p) = 0;
+	virtual bool check(device_tree *tree, const node_ptr &n, const property_ptr &p) = 0;
 };
 
 /**
@@ -151,7 +152,7 @@ struct property_type_checker : public property_checker
 	 */
 	property_type_checker(const char* name, const std::string &property_name) :
 		property_checker(name, property_name) {}
-	virtual bool check(device_tree *tree, const node_ptr &n, property_ptr p) = 0;
+	virtual bool check(device_tree *tree, const node_ptr &n, const property_ptr &p) = 0;
 };
 
 /**
@@ -162,7 +163,7 @@ struct property_type_checker <property_value::EMPTY> : public property_checker
 {
 	property_type_checker(const char* name, const std::string &property_name) :
 		property_checker(name, property_name) {}
-	virtual bool check(device_tree *, const node_ptr &, property_ptr p)
+	virtual bool check(device_tree *, const node_ptr &, const property_ptr &p)
 	{
 		return p->begin() == p->end();
 	}
@@ -177,7 +178,7 @@ struct property_type_checker <property_value::STRING> : public property_checker
 {
 	property_type_checker(const char* name, const std::string &property_name) :
 		property_checker(name, property_name) {}
-	virtual bool check(device_tree *, const node_ptr &, property_ptr p)
+	virtual bool check(device_tree *, const node_ptr &, const property_ptr &p)
 	{
 		return (p->begin() + 1 == p->end()) && p->begin()->is_string();
 	}
@@ -192,7 +193,7 @@ struct property_type_checker <property_value::STRING_LIST> :
 {
 	property_type_checker(const char* name, const std::string &property_name) :
 		property_checker(name, property_name) {}
-	virtual bool check(device_tree *, const node_ptr &, property_ptr p)
+	virtual bool check(device_tree *, const node_ptr &, const property_ptr &p)
 	{
 		for (property::value_iterator i=p->begin(),e=p->end() ; i!=e ;
 		     ++i)
@@ -215,7 +216,7 @@ struct property_type_checker <property_value::PHANDLE> : public property_checker
 {
 	property_type_checker(const char* name, const std::string &property_name) :
 		property_checker(name, property_name) {}
-	virtual bool check(device_tree *tree, const node_ptr &, property_ptr p)
+	virtual bool check(device_tree *tree, const node_ptr &, const property_ptr &p)
 	{
 		return (p->begin() + 1 == p->end()) &&
 			(tree->referenced_node(*p->begin()) != 0);
@@ -243,7 +244,7 @@ struct property_size_checker : public property_checker
 	/**
 	 * Check, validates that the property has the correct size.
 	 */
-	virtual bool check(device_tree *tree, const node_ptr &n, property_ptr p);
+	virtual bool check(device_tree *tree, const node_ptr &n, const property_ptr &p);
 };
 
 
@@ -33,7 +33,10 @@
  */
 
 #include "dtb.hh"
+#include <algorithm>
+#include <unordered_map>
 #include <sys/types.h>
+#include <errno.h>
 #include <inttypes.h>
 #include <stdio.h>
 #include <unistd.h>
@@ -45,7 +48,42 @@ namespace dtc
 namespace dtb
 {
 
-void output_writer::write_data(byte_buffer b)
+namespace
+{
+/**
+ * The amount of output that a streaming writer accumulates before flushing
+ * it to the file.
+ */
+const size_t stream_flush_size = 64 * 1024;
+
+/**
+ * Writes all of the buffer to fd, retrying short and interrupted writes.
+ * Returns false if the write fails.
+ */
+bool
+write_all(int fd, const byte_buffer &b)
+{
+	const uint8_t *p = b.data();
+	size_t left = b.size();
+	while (left > 0)
+	{
+		ssize_t r = write(fd, p, left);
+		if (r == -1)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			return false;
+		}
+		p += r;
+		left -= r;
+	}
+	return true;
+}
+}
+
+void output_writer::write_data(const byte_buffer &b)
 {
 	for (auto i : b)
 	{
@@ -53,51 +91,97 @@ void output_writer::write_data(byte_buffer b)
 	}
 }
 
+void
+binary_writer::flush_if_full()
+{
+	if ((stream_fd != -1) && (buffer.size() >= stream_flush_size))
+	{
+		if (!write_failed && !write_all(stream_fd, buffer))
+		{
+			write_failed = true;
+		}
+		flushed += buffer.size();
+		buffer.clear();
+	}
+}
+
+void
+binary_writer::align(uint32_t alignment)
+{
+	while (size() % alignment != 0)
+	{
+		buffer.push_back(0);
+	}
+}
+
 void
 binary_writer::write_string(const string &name)
 {
 	push_string(buffer, name);
 	// Trailing nul
 	buffer.push_back(0);
+	flush_if_full();
 }
 
 void
 binary_writer::write_data(uint8_t v)
 {
 	buffer.push_back(v);
+	flush_if_full();
 }
 
 void
 binary_writer::write_data(uint32_t v)
 {
-	while (buffer.size() % 4 != 0)
-	{
-		buffer.push_back(0);
-	}
+	align(4);
 	push_big_endian(buffer, v);
+	flush_if_full();
 }
 
 void
 binary_writer::write_data(uint64_t v)
 {
-	while (buffer.size() % 8 != 0)
-	{
-		buffer.push_back(0);
-	}
+	align(8);
 	push_big_endian(buffer, v);
+	flush_if_full();
 }
 
 void
+binary_writer::write_data(const byte_buffer &b)
+{
+	buffer.insert(buffer.end(), b.begin(), b.end());
+	flush_if_full();
+}
+
+bool
 binary_writer::write_to_file(int fd)
 {
-	// FIXME: Check return
-	write(fd, buffer.data(), buffer.size());
+	if (!write_failed && !write_all(fd, buffer))
+	{
+		write_failed = true;
+	}
+	flushed += buffer.size();
+	buffer.clear();
+	return !write_failed;
 }
 
 uint32_t
 binary_writer::size()
 {
-	return buffer.size();
+	return flushed + buffer.size();
+}
+
+void
+asm_writer::flush_if_full()
+{
+	if ((stream_fd != -1) && (buffer.size() >= stream_flush_size))
+	{
+		if (!write_failed && !write_all(stream_fd, buffer))
+		{
+			write_failed = true;
+		}
+		buffer.clear();
+	}
 }
 
 void
@@ -176,6 +260,7 @@ asm_writer::write_string(const string &name)
 	push_string(buffer, name);
 	write_line("\"\n");
 	bytes_written += name.size() + 1;
+	flush_if_full();
 }
 
 void
@@ -183,6 +268,7 @@ asm_writer::write_data(uint8_t v)
 {
 	write_byte(v);
 	bytes_written++;
+	flush_if_full();
 }
 
 void
@@ -198,6 +284,7 @@ asm_writer::write_data(uint32_t v)
 	write_byte((v >> 8) & 0xff);
 	write_byte((v >> 0) & 0xff);
 	bytes_written += 4;
+	flush_if_full();
 }
 
 void
@@ -217,13 +304,18 @@ asm_writer::write_data(uint64_t v)
 	write_byte((v >> 8) & 0xff);
 	write_byte((v >> 0) & 0xff);
 	bytes_written += 8;
+	flush_if_full();
 }
 
-void
+bool
 asm_writer::write_to_file(int fd)
 {
-	// FIXME: Check return
-	write(fd, buffer.data(), buffer.size());
+	if (!write_failed && !write_all(fd, buffer))
+	{
+		write_failed = true;
+	}
+	buffer.clear();
+	return !write_failed;
 }
 
 uint32_t
@@ -302,6 +394,61 @@ string_table::add_string(const string &str)
 	}
 }
 
+void
+string_table::add_strings(const std::vector<string> &strs)
+{
+	assert(size == 0);
+	// Sort the distinct strings by their reversed text.  Every string that
+	// ends with s then follows s directly, so walking the sorted list
+	// backwards finds, for each string, the longest string that it is a
+	// tail of.
+	std::vector<string> reversed;
+	reversed.reserve(strs.size());
+	for (auto &str : strs)
+	{
+		reversed.emplace_back(str.rbegin(), str.rend());
+	}
+	std::sort(reversed.begin(), reversed.end());
+	reversed.erase(std::unique(reversed.begin(), reversed.end()),
+	               reversed.end());
+	// Map from each string to the string that will hold its bytes.
+	std::unordered_map<string, string> containers;
+	containers.reserve(reversed.size());
+	const string *container = nullptr;
+	string container_fwd;
+	for (auto i = reversed.rbegin(), e = reversed.rend() ; i != e ; ++i)
+	{
+		string fwd(i->rbegin(), i->rend());
+		if ((container == nullptr) ||
+		    (container->compare(0, i->size(), *i) != 0))
+		{
+			container = &*i;
+			container_fwd = fwd;
+		}
+		containers.emplace(std::move(fwd), container_fwd);
+	}
+	// Lay out the containers in the order in which they (or one of their
+	// tails) were first used, and place each tail inside its container.
+	for (auto &str : strs)
+	{
+		if (string_offsets.count(str) > 0)
+		{
+			continue;
+		}
+		const string &outer = containers[str];
+		auto placed = string_offsets.find(outer);
+		if (placed == string_offsets.end())
+		{
+			placed = string_offsets.insert(std::make_pair(outer, size)).first;
+			strings.push_back(outer);
+			// Don't forget the trailing nul
+			size += outer.size() + 1;
+		}
+		string_offsets.insert(std::make_pair(str, placed->second +
+		                                     outer.size() - str.size()));
+	}
+}
+
 void
 string_table::write(dtb::output_writer &writer)
 {
@@ -152,8 +152,9 @@ struct output_writer
 	virtual void write_data(uint64_t)       = 0;
 	/**
 	 * Writes the collected output to the specified file descriptor.
+	 * Returns false if this or any earlier streamed write failed.
 	 */
-	virtual void write_to_file(int fd)      = 0;
+	virtual bool write_to_file(int fd)      = 0;
 	/**
 	 * Returns the number of bytes.
 	 */
@@ -170,9 +171,49 @@ struct output_writer
 	}
 	/**
 	 * Helper function that writes a byte buffer to the output, one byte at
-	 * a time.
+	 * a time.  Writers that can copy the bytes directly override this.
 	 */
-	void write_data(byte_buffer b);
+	virtual void write_data(const byte_buffer &b);
+	/**
+	 * Virtual destructor.
+	 */
+	virtual ~output_writer() {}
+};
+
+/**
+ * Writer that discards its output and only counts the bytes that a binary
+ * writer would produce, including alignment padding.  This is used to find
+ * the size of the structure block before it is written, so that it can be
+ * streamed straight to the output after the header.
+ */
+class size_writer : public output_writer
+{
+	/**
+	 * The number of bytes written so far.
+	 */
+	uint32_t bytes_written = 0;
+	public:
+	void write_label(const std::string &) override {}
+	void write_comment(const std::string&)  override {}
+	void write_string(const std::string &name) override
+	{
+		bytes_written += name.size() + 1;
+	}
+	void write_data(uint8_t) override { bytes_written++; }
+	void write_data(uint32_t) override
+	{
+		bytes_written = ((bytes_written + 3) & ~3U) + 4;
+	}
+	void write_data(uint64_t) override
+	{
+		bytes_written = ((bytes_written + 7) & ~7U) + 8;
+	}
+	void write_data(const byte_buffer &b) override
+	{
+		bytes_written += b.size();
+	}
+	bool write_to_file(int) override { return true; }
+	uint32_t size() override { return bytes_written; }
 };
 
 /**
@@ -186,7 +227,40 @@ class binary_writer : public output_writer
 	 * constructed.
 	 */
 	byte_buffer buffer;
+	/**
+	 * The file descriptor that the buffer is flushed to as it fills, or -1
+	 * if the whole section is kept in memory until write_to_file().
+	 */
+	int stream_fd = -1;
+	/**
+	 * The number of bytes already flushed to stream_fd.
+	 */
+	uint32_t flushed = 0;
+	/**
+	 * Set when a write to the output file fails.  Later output is
+	 * discarded.
+	 */
+	bool write_failed = false;
+	/**
+	 * Flushes the buffer if this writer is streaming and enough data has
+	 * accumulated.
+	 */
+	void flush_if_full();
+	/**
+	 * Pads the output with zeros to the specified alignment, measured from
+	 * the start of the section.
+	 */
+	void align(uint32_t alignment);
 	public:
+	/**
+	 * Constructs a writer that builds its output in memory.
+	 */
+	binary_writer() {}
+	/**
+	 * Constructs a writer that streams its output to fd as it is produced.
+	 * Any remaining output is written by write_to_file().
+	 */
+	explicit binary_writer(int fd) : stream_fd(fd) {}
 	/**
 	 *  The binary format does not support labels, so this method
 	 * does nothing.
@@ -200,7 +274,8 @@ class binary_writer : public output_writer
 	void write_data(uint8_t v) override;
 	void write_data(uint32_t v) override;
 	void write_data(uint64_t v) override;
-	void write_to_file(int fd) override;
+	void write_data(const byte_buffer &b) override;
+	bool write_to_file(int fd) override;
 	uint32_t size() override;
 };
 /**
@@ -227,6 +302,21 @@ class asm_writer : public output_writer
 	 * format, not the number of bytes in the buffer.
 	 */
 	uint32_t bytes_written;
+	/**
+	 * The file descriptor that the buffer is flushed to as it fills, or -1
+	 * if the whole section is kept in memory until write_to_file().
+	 */
+	int stream_fd;
+	/**
+	 * Set when a write to the output file fails.  Later output is
+	 * discarded.
+	 */
+	bool write_failed = false;
+	/**
+	 * Flushes the buffer if this writer is streaming and enough text has
+	 * accumulated.
+	 */
+	void flush_if_full();
 
 	/**
 	 * Writes a string directly to the output as-is.  This is the function that
@@ -247,13 +337,19 @@ class asm_writer : public output_writer
 	 */
 	void write_byte(uint8_t b);
 	public:
-	asm_writer() : byte_count(0), bytes_written(0) {}
+	asm_writer() : byte_count(0), bytes_written(0), stream_fd(-1) {}
+	/**
+	 * Constructs a writer that streams its output to fd as it is produced.
+	 * Any remaining output is written by write_to_file().
+	 */
+	explicit asm_writer(int fd) : byte_count(0), bytes_written(0),
+		stream_fd(fd) {}
 	void write_label(const std::string &name) override;
 	void write_comment(const std::string &name) override;
 	void write_data(uint8_t v) override;
 	void write_data(uint32_t v) override;
 	void write_data(uint64_t v) override;
-	void write_to_file(int fd) override;
+	bool write_to_file(int fd) override;
 	uint32_t size() override;
 };
 
@@ -360,6 +456,14 @@ class string_table {
 	 * offset.
 	 */
 	uint32_t add_string(const std::string &str);
+	/**
+	 * Adds a set of strings to the table at once.  Any string that is the
+	 * tail of another string in the set (for example, "cells" and
+	 * "#address-cells") shares its bytes instead of being stored again.
+	 * Strings are laid out in the order in which they first appear.  This
+	 * must be called before any strings are added individually.
+	 */
+	void add_strings(const std::vector<std::string> &strs);
 	/**
 	 * Writes the strings table to the specified output.
 	 */
@@ -33,14 +33,21 @@
  */
 
 #include <sys/resource.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <libgen.h>
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 #include <unistd.h>
 
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include "fdt.hh"
 #include "checking.hh"
@@ -76,7 +83,9 @@ void usage(const string &argv0)
 			"[-O output_format]\n"
 		"\t\t[-o output_file] [-R entries] [-S bytes] [-p bytes]"
 			"[-V blob_version]\n"
-		"\t\t-W [no-]checker_name] input_file\n", basename(argv0).c_str());
+		"\t\t-W [no-]checker_name] input_file\n"
+		"\t%s\t-B output_dir [-j jobs] [options] input_file ...\n",
+		basename(argv0).c_str(), basename(argv0).c_str());
 }
 
 /**
@@ -90,10 +99,145 @@ void version(const char* progname)
 		version_patch_compatible);
 }
 
-} // Anonymous namespace
-
 using fdt::device_tree;
 
+/**
+ * Settings that are applied to every tree compiled in batch mode.  Options
+ * that configure the tree are recorded as functions so that they can be
+ * replayed on each tree, and the checkers are configured from the recorded
+ * enable and disable requests.
+ */
+struct batch_options
+{
+	std::vector<std::function<void(device_tree&)>> tree_options;
+	std::vector<std::pair<string, bool>> checker_options;
+	void (device_tree::*read_fn)(const string &, FILE *);
+	bool (device_tree::*write_fn)(int);
+	const char *extension;
+	string output_dir;
+	bool boot_cpu_specified;
+	uint32_t boot_cpu = 0;
+	bool keep_going;
+	bool sort;
+};
+
+/**
+ * Returns the name of the file that batch mode writes for the given input:
+ * the input's base name, with its extension replaced, in the output
+ * directory.
+ */
+string batch_output_name(const batch_options &opts, const char *in_file)
+{
+	string name(basename(string(in_file)));
+	auto dot = name.rfind('.');
+	if (dot != string::npos)
+	{
+		name.erase(dot);
+	}
+	return opts.output_dir + '/' + name + opts.extension;
+}
+
+/**
+ * Compiles one input file in batch mode.  Each call uses its own tree and
+ * check manager, so calls may run concurrently.  Returns true on success.
+ */
+bool batch_compile(const batch_options &opts, const char *in_file)
+{
+	device_tree tree;
+	fdt::checking::check_manager checks;
+
+	for (auto &fn : opts.tree_options)
+	{
+		fn(tree);
+	}
+	for (auto &c : opts.checker_options)
+	{
+		if (c.second)
+		{
+			checks.enable_checker(c.first);
+		}
+		else
+		{
+			checks.disable_checker(c.first);
+		}
+	}
+	(tree.*opts.read_fn)(in_file, 0);
+	if (opts.boot_cpu_specified)
+	{
+		tree.set_boot_cpu(opts.boot_cpu);
+	}
+	if (opts.sort)
+	{
+		tree.sort();
+	}
+	if (!(tree.is_valid() || opts.keep_going))
+	{
+		fprintf(stderr, "%s: Failed to parse tree.\n", in_file);
+		return false;
+	}
+	if (!(checks.run_checks(&tree, true) || opts.keep_going))
+	{
+		return false;
+	}
+	string out_name = batch_output_name(opts, in_file);
+	int outfile = open(out_name.c_str(), O_CREAT | O_TRUNC | O_WRONLY, 0666);
+	if (outfile == -1)
+	{
+		fprintf(stderr, "Unable to open output file %s: %s\n",
+		        out_name.c_str(), strerror(errno));
+		return false;
+	}
+	bool written = (tree.*opts.write_fn)(outfile);
+	if (!written)
+	{
+		fprintf(stderr, "Unable to write output file %s: %s\n",
+		        out_name.c_str(), strerror(errno));
+	}
+	close(outfile);
+	return written;
+}
+
+/**
+ * Compiles every input file in batch mode, using up to `jobs` threads.
+ * Files are handed out to the threads one at a time, so that a few large
+ * boards do not leave the other threads idle.  Includes shared between the
+ * boards are read once, through the input buffer file cache.
+ */
+bool batch_compile_all(const batch_options &opts, char **files, int count,
+                       unsigned jobs)
+{
+	std::atomic<int> next(0);
+	std::atomic<bool> success(true);
+	auto worker = [&]()
+	{
+		int i;
+		while ((i = next++) < count)
+		{
+			if (!batch_compile(opts, files[i]))
+			{
+				success = false;
+			}
+		}
+	};
+	std::vector<std::thread> threads;
+	if (jobs > (unsigned)count)
+	{
+		jobs = count;
+	}
+	for (unsigned i = 1; i < jobs; i++)
+	{
+		threads.emplace_back(worker);
+	}
+	worker();
+	for (auto &t : threads)
+	{
+		t.join();
+	}
+	return success;
+}
+
+} // Anonymous namespace
+
 int
 main(int argc, char **argv)
 {
@@ -105,14 +249,24 @@ main(int argc, char **argv)
 	bool debug_mode = false;
 	auto write_fn = &device_tree::write_binary;
 	auto read_fn = &device_tree::parse_dts;
-	uint32_t boot_cpu;
+	uint32_t boot_cpu = 0;
 	bool boot_cpu_specified = false;
 	bool keep_going = false;
 	bool sort = false;
 	clock_t c0 = clock();
 	class device_tree tree;
 	fdt::checking::check_manager checks;
-	const char *options = "@hqI:O:o:V:d:R:S:p:b:fi:svH:W:E:DP:";
+	const char *options = "@hqI:O:o:V:d:R:S:p:b:fi:svH:W:E:DP:B:j:";
+	const char *extension = ".dtb";
+	const char *output_dir = 0;
+	unsigned jobs = 0;
+	batch_options batch;
+	// Applies a tree option now and records it for batch mode.
+	auto tree_option = [&](std::function<void(device_tree&)> fn)
+	{
+		fn(tree);
+		batch.tree_options.push_back(std::move(fn));
+	};
 
 	// Don't forget to update the man page if any more options are added.
 	while ((ch = getopt(argc, argv, options)) != -1)
@@ -126,7 +280,7 @@ main(int argc, char **argv)
 			version(argv[0]);
 			return EXIT_SUCCESS;
 		case '@':
-			tree.write_symbols = true;
+			tree_option([](device_tree &t) { t.write_symbols = true; });
 			break;
 		case 'I':
 		{
@@ -152,14 +306,17 @@ main(int argc, char **argv)
 			if (arg == "dtb")
 			{
 				write_fn = &device_tree::write_binary;
+				extension = ".dtb";
 			}
 			else if (arg == "asm")
 			{
 				write_fn = &device_tree::write_asm;
+				extension = ".S";
 			}
 			else if (arg == "dts")
 			{
 				write_fn = &device_tree::write_dts;
+				extension = ".dts";
 			}
 			else
 			{
@@ -218,15 +375,15 @@ main(int argc, char **argv)
 			string arg(optarg);
 			if (arg == "both")
 			{
-				tree.set_phandle_format(device_tree::BOTH);
+				tree_option([](device_tree &t) { t.set_phandle_format(device_tree::BOTH); });
 			}
 			else if (arg == "epapr")
 			{
-				tree.set_phandle_format(device_tree::EPAPR);
+				tree_option([](device_tree &t) { t.set_phandle_format(device_tree::EPAPR); });
 			}
 			else if (arg == "linux")
 			{
-				tree.set_phandle_format(device_tree::LINUX);
+				tree_option([](device_tree &t) { t.set_phandle_format(device_tree::LINUX); });
 			}
 			else
 			{
@@ -251,12 +408,14 @@ main(int argc, char **argv)
 			if ((arg.size() > 3) && (strncmp(optarg, "no-", 3) == 0))
 			{
 				arg = string(optarg+3);
+				batch.checker_options.emplace_back(arg, false);
 				if (!checks.disable_checker(arg))
 				{
 					fprintf(stderr, "Checker %s either does not exist or is already disabled\n", optarg+3);
 				}
 				break;
 			}
+			batch.checker_options.emplace_back(arg, true);
 			if (!checks.enable_checker(arg))
 			{
 				fprintf(stderr, "Checker %s either does not exist or is already enabled\n", optarg);
@@ -270,33 +429,86 @@ main(int argc, char **argv)
 		}
 		case 'i':
 		{
-			tree.add_include_path(optarg);
+			string path(optarg);
+			tree_option([=](device_tree &t) { t.add_include_path(path.c_str()); });
 			break;
 		}
 		// Should quiet warnings, but for now is silently ignored.
 		case 'q':
 			break;
 		case 'R':
-			tree.set_empty_reserve_map_entries(strtoll(optarg, 0, 10));
+		{
+			uint32_t e = strtoll(optarg, 0, 10);
+			tree_option([=](device_tree &t) { t.set_empty_reserve_map_entries(e); });
 			break;
+		}
 		case 'S':
-			tree.set_blob_minimum_size(strtoll(optarg, 0, 10));
+		{
+			uint32_t size = strtoll(optarg, 0, 10);
+			tree_option([=](device_tree &t) { t.set_blob_minimum_size(size); });
 			break;
+		}
 		case 'p':
-			tree.set_blob_padding(strtoll(optarg, 0, 10));
+		{
+			uint32_t padding = strtoll(optarg, 0, 10);
+			tree_option([=](device_tree &t) { t.set_blob_padding(padding); });
 			break;
+		}
 		case 'P':
 			if (!tree.parse_define(optarg))
 			{
 				fprintf(stderr, "Invalid predefine value %s\n",
 				        optarg);
 			}
+			else
+			{
+				string def(optarg);
+				batch.tree_options.push_back([=](device_tree &t)
+					{ t.parse_define(def.c_str()); });
+			}
+			break;
+		case 'B':
+			output_dir = optarg;
+			break;
+		case 'j':
+			jobs = (unsigned)strtoll(optarg, 0, 10);
 			break;
 		default:
 			fprintf(stderr, "Unknown option %c\n", ch);
 			return EXIT_FAILURE;
 		}
 	}
+	if (output_dir != 0)
+	{
+		if (depfile != 0 || strcmp(outfile_name, "-") != 0)
+		{
+			fprintf(stderr, "-d and -o cannot be used with -B\n");
+			return EXIT_FAILURE;
+		}
+		if (optind >= argc)
+		{
+			usage(argv[0]);
+			return EXIT_FAILURE;
+		}
+		if (jobs == 0)
+		{
+			long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+			jobs = ncpu > 0 ? ncpu : 1;
+		}
+		batch.read_fn = read_fn;
+		batch.write_fn = write_fn;
+		batch.extension = extension;
+		batch.output_dir = output_dir;
+		batch.boot_cpu_specified = boot_cpu_specified;
+		batch.boot_cpu = boot_cpu;
+		batch.keep_going = keep_going;
+		batch.sort = sort;
+		if (!batch_compile_all(batch, argv + optind, argc - optind, jobs))
+		{
+			return EXIT_FAILURE;
+		}
+		return EXIT_SUCCESS;
+	}
 	if (optind < argc)
 	{
 		in_file = argv[optind];
@@ -334,7 +546,12 @@ main(int argc, char **argv)
 		return EXIT_FAILURE;
 	}
 	clock_t c3 = clock();
-	(tree.*write_fn)(outfile);
+	if (!(tree.*write_fn)(outfile))
+	{
+		fprintf(stderr, "Unable to write output file %s: %s\n",
+		        outfile_name, strerror(errno));
+		return EXIT_FAILURE;
+	}
 	close(outfile);
 	clock_t c4 = clock();
 
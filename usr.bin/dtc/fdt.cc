@@ -230,7 +230,19 @@ property_value::write_as_cells(FILE *file)
 		v = (v << 8) | *i;
 		++i;
 		v = (v << 8) | *i;
-		fprintf(file, "0x%" PRIx32, v);
+		// Equivalent to printing with "0x%" PRIx32, without a printf
+		// call per cell.
+		char buf[sizeof("0xffffffff")];
+		char *p = buf + sizeof(buf);
+		*--p = '\0';
+		do
+		{
+			*--p = "0123456789abcdef"[v & 0xf];
+			v >>= 4;
+		} while (v != 0);
+		*--p = 'x';
+		*--p = '0';
+		fputs(p, file);
 		if (i+1 != e)
 		{
 			putc(' ', file);
@@ -242,10 +254,14 @@ property_value::write_as_cells(FILE *file)
 void
 property_value::write_as_bytes(FILE *file)
 {
+	static const char hex[] = "0123456789abcdef";
 	putc('[', file);
 	for (auto i=byte_data.begin(), e=byte_data.end(); i!=e ; i++)
 	{
-		fprintf(file, "%02hhx", *i);
+		// Large binary properties are common in blobs being decompiled, so
+		// avoid a printf call per byte.
+		putc(hex[*i >> 4], file);
+		putc(hex[*i & 0xf], file);
 		if (i+1 != e)
 		{
 			putc(' ', file);
@@ -438,18 +454,13 @@ property::property(input_buffer &structs, input_buffer &strings)
 		return;
 
 	// Read the value
-	uint8_t byte;
 	property_value v;
-	for (uint32_t i=0 ; i<length ; i++)
+	if (!(valid = structs.consume_bytes(length, v.byte_data)))
 	{
-		if (!(valid = structs.consume_binary(byte)))
-		{
-			fprintf(stderr, "Failed to read property value\n");
-			return;
-		}
-		v.byte_data.push_back(byte);
+		fprintf(stderr, "Failed to read property value\n");
+		return;
 	}
-	values.push_back(v);
+	values.push_back(std::move(v));
 }
 
 void property::parse_define(text_input_buffer &input, define_map *defines)
@@ -757,23 +768,12 @@ node::visit(std::function<visit_behavior(node&, node*)> fn, node *parent)
 
 node::node(input_buffer &structs, input_buffer &strings) : valid(true)
 {
-	std::vector<char> bytes;
-	while (structs[0] != '\0' && structs[0] != '@')
-	{
-		bytes.push_back(structs[0]);
-		++structs;
-	}
-	name = string(bytes.begin(), bytes.end());
-	bytes.clear();
-	if (structs[0] == '@')
+	name = structs.parse_to('\0');
+	auto at = name.find('@');
+	if (at != string::npos)
 	{
-		++structs;
-		while (structs[0] != '\0')
-		{
-			bytes.push_back(structs[0]);
-			++structs;
-		}
-		unit_address = string(bytes.begin(), bytes.end());
+		unit_address = name.substr(at + 1);
+		name.erase(at);
 	}
 	++structs;
 	uint32_t token;
@@ -1046,21 +1046,44 @@ node::merge_node(node_ptr &other)
 	{
 		labels.insert(l);
 	}
-	// Note: this is an O(n*m) operation.  It might be sensible to
-	// optimise this if we find that there are nodes with very
-	// large numbers of properties, but for typical usage the
-	// entire vector will fit (easily) into cache, so iterating
-	// over it repeatedly isn't that expensive.
+	// Properties and children are matched by name.  Overlays that patch
+	// large nodes (pinmux tables, for example) would make a nested scan
+	// O(n*m), so once the other node has more than one entry to merge we
+	// index this node's entries by name.  Only the first entry with a
+	// given name is indexed, matching the order of the linear scan, and
+	// entries appended during the merge are indexed as they are added.
+	const bool index_props = other->props.size() > 1;
+	std::unordered_map<string, size_t> prop_index;
+	if (index_props)
+	{
+		prop_index.reserve(props.size() + other->props.size());
+		for (size_t i = 0 ; i < props.size() ; i++)
+		{
+			prop_index.emplace(props[i]->get_key(), i);
+		}
+	}
 	for (auto &p : other->properties())
 	{
 		bool found = false;
-		for (auto &mp : properties())
+		if (index_props)
 		{
-			if (mp->get_key() == p->get_key())
+			auto i = prop_index.emplace(p->get_key(), props.size());
+			if (!i.second)
 			{
-				mp = p;
+				props[i.first->second] = p;
 				found = true;
-				break;
+			}
+		}
+		else
+		{
+			for (auto &mp : properties())
+			{
+				if (mp->get_key() == p->get_key())
+				{
+					mp = p;
+					found = true;
+					break;
+				}
 			}
 		}
 		if (!found)
@@ -1068,16 +1091,38 @@ node::merge_node(node_ptr &other)
 			add_property(p);
 		}
 	}
+	const bool index_children = other->children.size() > 1;
+	std::unordered_map<string, size_t> child_index;
+	if (index_children)
+	{
+		child_index.reserve(children.size() + other->children.size());
+		for (size_t i = 0 ; i < children.size() ; i++)
+		{
+			child_index.emplace(children[i]->full_name(), i);
+		}
+	}
 	for (auto &c : other->children)
 	{
 		bool found = false;
-		for (auto &i : children)
+		if (index_children)
 		{
-			if (i->name == c->name && i->unit_address == c->unit_address)
+			auto i = child_index.emplace(c->full_name(), children.size());
+			if (!i.second)
 			{
-				i->merge_node(c);
+				children[i.first->second]->merge_node(c);
 				found = true;
-				break;
+			}
+		}
+		else
+		{
+			for (auto &i : children)
+			{
+				if (i->name == c->name && i->unit_address == c->unit_address)
+				{
+					i->merge_node(c);
+					found = true;
+					break;
+				}
 			}
 		}
 		if (!found)
@@ -1087,12 +1132,11 @@ node::merge_node(node_ptr &other)
 	}
 	children.erase(std::remove_if(children.begin(), children.end(),
 			[&](const node_ptr &p) {
-				string full_name = p->name;
-				if (p->unit_address != string())
+				if (other->deleted_children.empty())
 				{
-					full_name += '@';
-					full_name += p->unit_address;
+					return false;
 				}
+				string full_name = p->full_name();
 				if (other->deleted_children.count(full_name) > 0)
 				{
 					other->deleted_children.erase(full_name);
@@ -1312,7 +1356,10 @@ device_tree::resolve_cross_references(uint32_t &phandle)
 {
 	for (auto *pv : cross_references)
 	{
-		node_path path = node_paths[pv->string_data];
+		static const node_path no_path;
+		auto found = node_paths.find(pv->string_data);
+		const node_path &path = found == node_paths.end() ? no_path :
+			found->second;
 		auto p = path.begin();
 		auto pe = path.end();
 		if (p != pe)
@@ -1332,11 +1379,13 @@ device_tree::resolve_cross_references(uint32_t &phandle)
 		}
 	}
 	std::unordered_map<property_value*, fixup&> phandle_set;
+	phandle_set.reserve(fixups.size());
 	for (auto &i : fixups)
 	{
 		phandle_set.insert({&i.val, i});
 	}
 	std::vector<std::reference_wrapper<fixup>> sorted_phandles;
+	sorted_phandles.reserve(fixups.size());
 	root->visit([&](node &n, node *) {
 		for (auto &p : n.properties())
 		{
@@ -1354,14 +1403,27 @@ device_tree::resolve_cross_references(uint32_t &phandle)
 	}, nullptr);
 	assert(sorted_phandles.size() == fixups.size());
 
+	// Paths that have already been resolved.  Large trees refer to the
+	// same node by path many times, and each lookup walks every child of
+	// every node along the path.
+	std::unordered_map<string, node*> path_targets;
 	for (auto &i : sorted_phandles)
 	{
-		string target_name = i.get().val.string_data;
+		const string &target_name = i.get().val.string_data;
 		node *target = nullptr;
 		string possible;
 		// If the node name is a path, then look it up by following the path,
 		// otherwise jump directly to the named node.
+		auto cached = path_targets.end();
 		if (target_name[0] == '/')
+		{
+			cached = path_targets.find(target_name);
+		}
+		if (cached != path_targets.end())
+		{
+			target = cached->second;
+		}
+		else if (target_name[0] == '/')
 		{
 			string path;
 			target = root.get();
@@ -1411,6 +1473,10 @@ device_tree::resolve_cross_references(uint32_t &phandle)
 					break;
 				}
 			}
+			if (target != nullptr)
+			{
+				path_targets.emplace(target_name, target);
+			}
 		}
 		else
 		{
@@ -1526,14 +1592,14 @@ device_tree::parse_file(text_input_buffer &input,
 	}
 }
 
-template<class writer> void
+template<class writer> bool
 device_tree::write(int fd)
 {
 	dtb::string_table st;
 	dtb::header head;
 	writer head_writer;
 	writer reservation_writer;
-	writer struct_writer;
+	dtb::size_writer struct_size;
 	writer strings_writer;
 
 	// Build the reservation table
@@ -1553,12 +1619,24 @@ device_tree::write(int fd)
 		reservation_writer.write_data((uint64_t)0);
 	}
 
+	// Lay out the strings table up front, so that property names that
+	// are tails of other names can share their bytes, and so that the
+	// table is complete before the structure block is written.
+	std::vector<string> keys;
+	root->visit([&](node &n, node *) {
+		for (auto &p : n.properties())
+		{
+			keys.push_back(p->get_key());
+		}
+		return node::VISIT_RECURSE;
+	}, nullptr);
+	st.add_strings(keys);
 
-	struct_writer.write_comment(string("Device tree"));
-	struct_writer.write_label(string("dt_struct_start"));
-	root->write(struct_writer, st);
-	struct_writer.write_token(dtb::FDT_END);
-	struct_writer.write_label(string("dt_struct_end"));
+	// The structure block is most of the blob.  Measure it first, so that
+	// the header can be written before it, and then stream it directly
+	// to the output instead of building it in memory.
+	root->write(struct_size, st);
+	struct_size.write_token(dtb::FDT_END);
 
 	st.write(strings_writer);
 	// Find the strings size before we stick padding on the end.
@@ -1575,24 +1653,37 @@ device_tree::write(int fd)
 		strings_writer.write_data((uint8_t)0);
 	}
 	head.totalsize = sizeof(head) + strings_writer.size() +
-		struct_writer.size() + reservation_writer.size();
+		struct_size.size() + reservation_writer.size();
 	while (head.totalsize < minimum_blob_size)
 	{
 		head.totalsize++;
 		strings_writer.write_data((uint8_t)0);
 	}
 	head.off_dt_struct = sizeof(head) + reservation_writer.size();;
-	head.off_dt_strings = head.off_dt_struct + struct_writer.size();
+	head.off_dt_strings = head.off_dt_struct + struct_size.size();
 	head.off_mem_rsvmap = sizeof(head);
 	head.boot_cpuid_phys = boot_cpu;
-	head.size_dt_struct = struct_writer.size();
+	head.size_dt_struct = struct_size.size();
 	head.write(head_writer);
 
-	head_writer.write_to_file(fd);
-	reservation_writer.write_to_file(fd);
-	struct_writer.write_to_file(fd);
+	if (!(head_writer.write_to_file(fd) &&
+	      reservation_writer.write_to_file(fd)))
+	{
+		return false;
+	}
+	writer struct_writer(fd);
+	struct_writer.write_comment(string("Device tree"));
+	struct_writer.write_label(string("dt_struct_start"));
+	root->write(struct_writer, st);
+	struct_writer.write_token(dtb::FDT_END);
+	struct_writer.write_label(string("dt_struct_end"));
+	if (!struct_writer.write_to_file(fd))
+	{
+		return false;
+	}
+	assert(struct_writer.size() == struct_size.size());
 	strings_writer.write_label(string("dt_blob_end"));
-	strings_writer.write_to_file(fd);
+	return strings_writer.write_to_file(fd);
 }
 
 node*
@@ -1609,19 +1700,19 @@ device_tree::referenced_node(property_value &v)
 	return 0;
 }
 
-void
+bool
 device_tree::write_binary(int fd)
 {
-	write<dtb::binary_writer>(fd);
+	return write<dtb::binary_writer>(fd);
 }
 
-void
+bool
 device_tree::write_asm(int fd)
 {
-	write<dtb::asm_writer>(fd);
+	return write<dtb::asm_writer>(fd);
 }
 
-void
+bool
 device_tree::write_dts(int fd)
 {
 	FILE *file = fdopen(fd, "w");
@@ -1640,7 +1731,8 @@ device_tree::write_dts(int fd)
 	putc('/', file);
 	putc(' ', file);
 	root->write_dts(file, 0);
-	fclose(file);
+	bool ok = !ferror(file);
+	return (fclose(file) == 0) && ok;
 }
 
 void
@@ -1800,6 +1892,28 @@ device_tree::reassign_fragment_numbers(node_ptr &node, int &delta)
 	}
 }
 
+namespace
+{
+/**
+ * Returns whether any node in the tree rooted at n has a label.  Merging a
+ * tree without labels cannot add any names to node_names.
+ */
+bool
+has_labels(node &n)
+{
+	bool found = false;
+	n.visit([&](node &c, node *) {
+		if (!c.labels.empty())
+		{
+			found = true;
+			return node::VISIT_BREAK;
+		}
+		return node::VISIT_RECURSE;
+	}, nullptr);
+	return found;
+}
+} // anonymous namespace
+
 void
 device_tree::parse_dts(const string &fn, FILE *depfile)
 {
@@ -1847,6 +1961,12 @@ device_tree::parse_dts(const string &fn, FILE *depfile)
 				input.parse_error("Failed to find root node /.");
 				return;
 			}
+			// Whether node_names holds every label in the current tree.
+			// Walking the tree for every reference to a label that is not
+			// (yet) known would make merging quadratic in the number of
+			// fragments, so only walk it again if a merge since the last
+			// walk may have added labels.
+			bool names_current = false;
 			for (auto i=++(roots.begin()), e=roots.end() ; i!=e ; ++i)
 			{
 				auto &node = *i;
@@ -1859,14 +1979,16 @@ device_tree::parse_dts(const string &fn, FILE *depfile)
 						// fragnum before we merge it
 						reassign_fragment_numbers(node, fragnum);
 					}
+					names_current &= !has_labels(*node);
 					root->merge_node(node);
 				}
 				else
 				{
 					auto existing = node_names.find(name);
-					if (existing == node_names.end())
+					if (existing == node_names.end() && !names_current)
 					{
 						collect_names();
+						names_current = true;
 						existing = node_names.find(name);
 					}
 					if (existing == node_names.end())
@@ -1874,6 +1996,7 @@ device_tree::parse_dts(const string &fn, FILE *depfile)
 						if (is_plugin)
 						{
 							auto fragment = create_fragment_wrapper(node, fragnum);
+							names_current &= !has_labels(*fragment);
 							root->merge_node(fragment);
 						}
 						else
@@ -1883,6 +2006,7 @@ device_tree::parse_dts(const string &fn, FILE *depfile)
 					}
 					else
 					{
+						names_current &= !has_labels(*node);
 						existing->second->merge_node(node);
 					}
 				}
@@ -639,6 +639,18 @@ class node
 	{
 		children.push_back(std::move(n));
 	}
+	/**
+	 * Returns the name of this node as it appears in a path, including the
+	 * unit address if there is one.
+	 */
+	inline std::string full_name() const
+	{
+		if (unit_address.empty())
+		{
+			return name;
+		}
+		return name + '@' + unit_address;
+	}
 	/**
 	 * Merges a node into this one.  Any properties present in both are
 	 * overridden, any properties present in only one are preserved.
@@ -861,10 +873,11 @@ class device_tree
 	                bool &read_header);
 	/**
 	 * Template function that writes a dtb blob using the specified writer.
-	 * The writer defines the output format (assembly, blob).
+	 * The writer defines the output format (assembly, blob).  Returns
+	 * false if writing the output fails.
 	 */
 	template<class writer>
-	void write(int fd);
+	bool write(int fd);
 	public:
 	/**
 	 * Should we write the __symbols__ node (to allow overlays to be linked
@@ -878,19 +891,20 @@ class device_tree
 	 */
 	node *referenced_node(property_value &v);
 	/**
-	 * Writes this FDT as a DTB to the specified output.
+	 * Writes this FDT as a DTB to the specified output.  This and the
+	 * other output functions return false if writing fails.
 	 */
-	void write_binary(int fd);
+	bool write_binary(int fd);
 	/**
 	 * Writes this FDT as an assembly representation of the DTB to the
 	 * specified output.  The result can then be assembled and linked into
 	 * a program.
 	 */
-	void write_asm(int fd);
+	bool write_asm(int fd);
 	/**
 	 * Writes the tree in DTS (source) format.
 	 */
-	void write_dts(int fd);
+	bool write_dts(int fd);
 	/**
 	 * Default constructor.  Creates a valid, but empty FDT.
 	 */
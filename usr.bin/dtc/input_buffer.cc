@@ -41,6 +41,9 @@
 #include <stdlib.h>
 #include <string.h>
 #include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 #ifndef NDEBUG
 #include <iostream>
 #endif
@@ -61,26 +64,51 @@ using std::string;
 namespace
 {
 /**
- * Subclass of input_buffer that mmap()s a file and owns the resulting memory.
- * When this object is destroyed, the memory is unmapped.
+ * A file that has been mmap()ed.  Mappings are shared by every buffer that
+ * reads the file and the memory is unmapped when the last one goes away.
  */
-struct mmap_input_buffer : public dtc::input_buffer
+struct mapped_file
 {
 	string fn;
+	const char *buffer;
+	int size;
+	/**
+	 * Maps the file passed in as a file descriptor.
+	 */
+	mapped_file(int fd, string &&filename);
+	/**
+	 * Unmaps the file, if it was mapped.
+	 */
+	~mapped_file();
+};
+typedef std::shared_ptr<const mapped_file> mapped_file_ptr;
+/**
+ * Subclass of input_buffer that reads from an mmap()ed file and keeps the
+ * mapping alive.
+ */
+struct mmap_input_buffer : public dtc::input_buffer
+{
+	mapped_file_ptr file;
 	const string &filename() const override
 	{
-		return fn;
+		return file->fn;
 	}
 	/**
-	 * Constructs a new buffer from the file passed in as a file
-	 * descriptor.
-	 */
-	mmap_input_buffer(int fd, string &&filename);
-	/**
-	 * Unmaps the buffer, if one exists.
+	 * Constructs a new buffer reading from the start of a mapped file.
 	 */
-	virtual ~mmap_input_buffer();
+	mmap_input_buffer(mapped_file_ptr f)
+		: input_buffer(f->buffer, f->size), file(std::move(f)) {}
 };
+/**
+ * Cache of the files opened by input_buffer::buffer_for_file(), indexed by
+ * the path used to open them.  Board files share long chains of includes,
+ * so when several trees are compiled in one process each include is only
+ * opened and mapped once.  Paths that could not be opened map to a null
+ * pointer so that the include path search does not retry them.  Shared
+ * between threads, so protected by file_cache_lock.
+ */
+std::unordered_map<string, mapped_file_ptr> file_cache;
+std::mutex file_cache_lock;
 /**
  * Input buffer read from standard input.  This is used for reading device tree
  * blobs and source from standard input.  It reads the entire input into
@@ -104,8 +132,8 @@ struct stream_input_buffer : public dtc::input_buffer
 	stream_input_buffer();
 };
 
-mmap_input_buffer::mmap_input_buffer(int fd, string &&filename)
-	: input_buffer(0, 0), fn(filename)
+mapped_file::mapped_file(int fd, string &&filename)
+	: fn(filename), buffer(0), size(0)
 {
 	struct stat sb;
 	if (fstat(fd, &sb))
@@ -122,7 +150,7 @@ mmap_input_buffer::mmap_input_buffer(int fd, string &&filename)
 	}
 }
 
-mmap_input_buffer::~mmap_input_buffer()
+mapped_file::~mapped_file()
 {
 	if (buffer != 0)
 	{
@@ -1203,12 +1231,33 @@ text_input_buffer::parse_node_or_property_name(bool &is_property)
 string
 input_buffer::parse_to(char stop)
 {
-	std::vector<char> bytes;
-	for (char c=*(*this) ; c != stop ; c=*(++(*this)))
+	if ((cursor < 0) || (cursor >= size))
 	{
-		bytes.push_back(c);
+		return string();
 	}
-	return string(bytes.begin(), bytes.end());
+	const char *start = buffer + cursor;
+	const char *end = static_cast<const char*>(
+		memchr(start, stop, size - cursor));
+	// Reading past the end of the buffer yields nul bytes, so a nul stop
+	// character is considered to be found at the end.
+	if (end == nullptr)
+	{
+		end = buffer + size;
+	}
+	cursor = end - buffer;
+	return string(start, end);
+}
+
+bool
+input_buffer::consume_bytes(uint32_t length, byte_buffer &out)
+{
+	if ((cursor < 0) || (cursor > size) || ((uint32_t)(size - cursor) < length))
+	{
+		return false;
+	}
+	out.insert(out.end(), buffer + cursor, buffer + cursor + length);
+	cursor += length;
+	return true;
 }
 
 string
@@ -1240,6 +1289,21 @@ input_buffer::buffer_for_file(const string &path, bool warn)
 		std::unique_ptr<input_buffer> b(new stream_input_buffer());
 		return b;
 	}
+	{
+		std::lock_guard<std::mutex> l(file_cache_lock);
+		auto cached = file_cache.find(path);
+		if (cached != file_cache.end() && (cached->second || !warn))
+		{
+			if (!cached->second)
+			{
+				return 0;
+			}
+			std::unique_ptr<input_buffer> b(
+				new mmap_input_buffer(cached->second));
+			return b;
+		}
+	}
+	mapped_file_ptr file;
 	int source = open(path.c_str(), O_RDONLY);
 	if (source == -1)
 	{
@@ -1247,20 +1311,35 @@ input_buffer::buffer_for_file(const string &path, bool warn)
 		{
 			fprintf(stderr, "Unable to open file '%s'.  %s\n", path.c_str(), strerror(errno));
 		}
-		return 0;
 	}
-	struct stat st;
-	if (fstat(source, &st) == 0 && S_ISDIR(st.st_mode))
+	else
 	{
-		if (warn)
+		struct stat st;
+		if (fstat(source, &st) == 0 && S_ISDIR(st.st_mode))
 		{
-			fprintf(stderr, "File %s is a directory\n", path.c_str());
+			if (warn)
+			{
+				fprintf(stderr, "File %s is a directory\n", path.c_str());
+			}
+		}
+		else
+		{
+			file = std::make_shared<mapped_file>(source, string(path));
 		}
 		close(source);
+	}
+	std::lock_guard<std::mutex> l(file_cache_lock);
+	// Another thread may have mapped the same file while we did.
+	auto &cached = file_cache[path];
+	if (!cached)
+	{
+		cached = file;
+	}
+	if (!cached)
+	{
 		return 0;
 	}
-	std::unique_ptr<input_buffer> b(new mmap_input_buffer(source, string(path)));
-	close(source);
+	std::unique_ptr<input_buffer> b(new mmap_input_buffer(cached));
 	return b;
 }
 
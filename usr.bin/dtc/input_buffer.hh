@@ -215,6 +215,12 @@ class input_buffer
 	 * cursor in place.
 	 */
 	bool consume_hex_byte(uint8_t &outByte);
+	/**
+	 * Appends the next `length` bytes of the input to `out` and advances
+	 * the cursor past them.  Returns false, without consuming anything, if
+	 * fewer than `length` bytes remain.
+	 */
+	bool consume_bytes(uint32_t length, byte_buffer &out);
 	/**
 	 * Template function that consumes a binary value in big-endian format
 	 * from the input stream.  Returns true and advances the cursor if
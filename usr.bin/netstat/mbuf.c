@@ -63,6 +63,35 @@ __FBSDID("$FreeBSD$");
 #include <libxo/xo.h>
 #include "netstat.h"
 
+/*
+ * Print the non-empty buckets of a power of two histogram.
+ */
+static void
+sfstat_hist(const char *name, const char *desc, const char *unit,
+    const uint64_t *hist)
+{
+	uintmax_t low;
+	int i;
+
+	xo_emit("{T:/%s}:\n", desc);
+	xo_open_list(name);
+	for (i = 0; i < SF_HIST_NBUCKETS; i++) {
+		if (hist[i] == 0)
+			continue;
+		low = i == 0 ? 0 : (uintmax_t)1 << (i - 1);
+		xo_open_instance(name);
+		if (i == SF_HIST_NBUCKETS - 1)
+			xo_emit("\t{:low/%ju}+ {N:/%s}: "
+			    "{:count/%ju}\n", low, unit, (uintmax_t)hist[i]);
+		else
+			xo_emit("\t{:low/%ju}-{:high/%ju} {N:/%s}: "
+			    "{:count/%ju}\n", low, ((uintmax_t)1 << i) - 1,
+			    unit, (uintmax_t)hist[i]);
+		xo_close_instance(name);
+	}
+	xo_close_list(name);
+}
+
 /*
  * Print mbuf statistics.
  */
@@ -358,6 +387,13 @@ mbpr(void *kvmd, u_long mbaddr)
 	    (uintmax_t)sfstat.sf_allocfail);
 	xo_emit("{:sfbufs-alloc-wait/%ju} {N:requests for sfbufs delayed}\n",
 	    (uintmax_t)sfstat.sf_allocwait);
+        xo_emit("{:sendfile-adaptive-readahead/%ju} "
+	    "{N:pages were read ahead for sequential sendfile streams}\n",
+            (uintmax_t)sfstat.sf_rhpages_adaptive);
+	sfstat_hist("sendfile-io-wait", "sendfile I/O wait time",
+	    "usecs", sfstat.sf_iowait_hist);
+	sfstat_hist("sendfile-not-ready", "sendfile mbufs waiting for I/O",
+	    "mbufs", sfstat.sf_nrdy_hist);
 out:
 	xo_close_container("mbuf-statistics");
 	memstat_mtl_free(mtlp);
@@ -1389,7 +1389,22 @@ domemstat_malloc(void)
 {
 	struct memory_type_list *mtlp;
 	struct memory_type *mtp;
-	int error, first, i;
+	uint64_t alloced, wasted;
+	size_t len;
+	int error, first, i, nsizes, sizes[64];
+
+	/*
+	 * The kernel exports its malloc(9) size classes in mts_size bit
+	 * order; older kernels and crash dumps use powers of two from 16.
+	 */
+	len = sizeof(sizes);
+	if (kd != NULL || sysctlbyname("kern.malloc_sizes", sizes, &len,
+	    NULL, 0) != 0) {
+		for (i = 0; i < 32; i++)
+			sizes[i] = 1 << (i + 4);
+		len = 32 * sizeof(sizes[0]);
+	}
+	nsizes = len / sizeof(sizes[0]);
 
 	mtlp = memstat_mtl_alloc();
 	if (mtlp == NULL) {
@@ -1414,28 +1429,40 @@ domemstat_malloc(void)
 		}
 	}
 	xo_open_container("malloc-statistics");
-	xo_emit("{T:/%13s} {T:/%5s} {T:/%6s} {T:/%7s} {T:/%8s}  {T:Size(s)}\n",
-	    "Type", "InUse", "MemUse", "HighUse", "Requests");
+	xo_emit("{T:/%13s} {T:/%5s} {T:/%6s} {T:/%7s} {T:/%8s} {T:/%6s}  "
+	    "{T:Size(s)}\n", "Type", "InUse", "MemUse", "HighUse", "Requests",
+	    "Waste");
 	xo_open_list("memory");
 	for (mtp = memstat_mtl_first(mtlp); mtp != NULL;
 	    mtp = memstat_mtl_next(mtp)) {
 		if (memstat_get_numallocs(mtp) == 0 &&
 		    memstat_get_count(mtp) == 0)
 			continue;
+		/*
+		 * Estimate the memory in use lost to size class rounding
+		 * from the lifetime ratio of requested to allocated bytes.
+		 */
+		alloced = memstat_get_memalloced(mtp);
+		wasted = 0;
+		if (alloced > memstat_get_memrequested(mtp) &&
+		    memstat_get_memrequested(mtp) != 0)
+			wasted = (double)memstat_get_bytes(mtp) *
+			    (alloced - memstat_get_memrequested(mtp)) / alloced;
 		xo_open_instance("memory");
 		xo_emit("{k:type/%13s/%s} {:in-use/%5ju} "
 		    "{:memory-use/%5ju}{U:K} {:high-use/%7s} "
-		    "{:requests/%8ju}  ",
+		    "{:requests/%8ju} {:wasted/%5ju}{U:K}  ",
 		    memstat_get_name(mtp), (uintmax_t)memstat_get_count(mtp),
 		    ((uintmax_t)memstat_get_bytes(mtp) + 1023) / 1024, "-",
-		    (uintmax_t)memstat_get_numallocs(mtp));
+		    (uintmax_t)memstat_get_numallocs(mtp),
+		    ((uintmax_t)wasted + 1023) / 1024);
 		first = 1;
 		xo_open_list("size");
-		for (i = 0; i < 32; i++) {
-			if (memstat_get_sizemask(mtp) & (1 << i)) {
+		for (i = 0; i < nsizes; i++) {
+			if (memstat_get_sizemask(mtp) & ((uint64_t)1 << i)) {
 				if (!first)
 					xo_emit(",");
-				xo_emit("{l:size/%d}", 1 << (i + 4));
+				xo_emit("{l:size/%d}", sizes[i]);
 				first = 0;
 			}
 		}
@@ -1480,8 +1507,8 @@ domemstat_zone(void)
 	}
 	xo_open_container("memory-zone-statistics");
 	xo_emit("{T:/%-20s} {T:/%6s} {T:/%6s} {T:/%8s} {T:/%8s} {T:/%8s} "
-	    "{T:/%4s} {T:/%4s}\n\n", "ITEM", "SIZE",
-	    "LIMIT", "USED", "FREE", "REQ", "FAIL", "SLEEP");
+	    "{T:/%4s} {T:/%4s} {T:/%8s} {T:/%6s}\n\n", "ITEM", "SIZE",
+	    "LIMIT", "USED", "FREE", "REQ", "FAIL", "SLEEP", "XFER", "CONT");
 	xo_open_list("zone");
 	for (mtp = memstat_mtl_first(mtlp); mtp != NULL;
 	    mtp = memstat_mtl_next(mtp)) {
@@ -1491,7 +1518,8 @@ domemstat_zone(void)
 		xo_emit("{d:name/%-20s}{ke:name/%s} {:size/%6ju}, "
 		    "{:limit/%6ju},{:used/%8ju},"
 		    "{:free/%8ju},{:requests/%8ju},"
-		    "{:fail/%4ju},{:sleep/%4ju}\n", name,
+		    "{:fail/%4ju},{:sleep/%4ju},"
+		    "{:xfer/%8ju},{:contended/%6ju}\n", name,
 		    memstat_get_name(mtp),
 		    (uintmax_t)memstat_get_size(mtp),
 		    (uintmax_t)memstat_get_countlimit(mtp),
@@ -1499,7 +1527,9 @@ domemstat_zone(void)
 		    (uintmax_t)memstat_get_free(mtp),
 		    (uintmax_t)memstat_get_numallocs(mtp),
 		    (uintmax_t)memstat_get_failures(mtp),
-		    (uintmax_t)memstat_get_sleeps(mtp));
+		    (uintmax_t)memstat_get_sleeps(mtp),
+		    (uintmax_t)memstat_get_xfers(mtp),
+		    (uintmax_t)memstat_get_lockfails(mtp));
 		xo_close_instance("zone");
 	}
 	memstat_mtl_free(mtlp);
@@ -57,6 +57,7 @@ __FBSDID("$FreeBSD$");
 #include <fcntl.h>
 #include <grp.h>
 #include <libgen.h>
+#include <limits.h>
 #include <md5.h>
 #include <paths.h>
 #include <pwd.h>
@@ -1206,6 +1207,9 @@ copy(int from_fd, const char *from_name, int to_fd, const char *to_name,
 	char buf[MAXBSIZE];
 	int done_copy;
 	DIGEST_CTX ctx;
+#ifndef BOOTSTRAP_XINSTALL
+	ssize_t ret;
+#endif
 
 	/* Rewind file descriptors. */
 	if (lseek(from_fd, (off_t)0, SEEK_SET) == (off_t)-1)
@@ -1215,13 +1219,35 @@ copy(int from_fd, const char *from_name, int to_fd, const char *to_name,
 
 	digest_init(&ctx);
 
+	done_copy = 0;
+#ifndef BOOTSTRAP_XINSTALL
+	/*
+	 * Without a digest to compute there is no need to see the data, so
+	 * let the kernel copy it.  If that is not possible, start over.
+	 */
+	if (digesttype == DIGEST_NONE) {
+		do {
+			ret = copy_file_range(from_fd, NULL, to_fd, NULL,
+			    SSIZE_MAX, 0);
+		} while (ret > 0);
+		if (ret == 0)
+			done_copy = 1;
+		else if (lseek(from_fd, (off_t)0, SEEK_SET) == (off_t)-1 ||
+		    lseek(to_fd, (off_t)0, SEEK_SET) == (off_t)-1) {
+			serrno = errno;
+			(void)unlink(to_name);
+			errno = serrno;
+			err(EX_OSERR, "lseek: %s", to_name);
+		}
+	}
+#endif
+
 	/*
 	 * Mmap and write if less than 8M (the limit is so we don't totally
 	 * trash memory on big files.  This is really a minor hack, but it
 	 * wins some CPU back.
 	 */
-	done_copy = 0;
-	if (size <= 8 * 1048576 && trymmap(from_fd) &&
+	if (!done_copy && size <= 8 * 1048576 && trymmap(from_fd) &&
 	    (p = mmap(NULL, (size_t)size, PROT_READ, MAP_SHARED,
 		    from_fd, (off_t)0)) != MAP_FAILED) {
 		nw = write(to_fd, p, size);
@@ -166,6 +166,7 @@ struct pci_vtnet_softc {
 	void (*pci_vtnet_rx)(struct pci_vtnet_softc *sc);
 	void (*pci_vtnet_tx)(struct pci_vtnet_softc *sc, struct iovec *iov,
 			     int iovcnt, int len);
+	void (*pci_vtnet_txsync)(struct pci_vtnet_softc *sc);
 };
 
 static void pci_vtnet_reset(void *);
@@ -388,12 +389,18 @@ pci_vtnet_tap_rx(struct pci_vtnet_softc *sc)
 	vq_endchains(vq, 1);
 }
 
+/*
+ * The netmap rings are only synchronized when they run out of slots or
+ * at the end of a batch, so that a burst of packets from the guest costs
+ * one system call instead of one per packet.
+ */
 static __inline int
 pci_vtnet_netmap_writev(struct nm_desc *nmd, struct iovec *iov, int iovcnt)
 {
-	int r, i;
+	int r, i, synced;
 	int len = 0;
 
+	synced = 0;
 	for (r = nmd->cur_tx_ring; ; ) {
 		struct netmap_ring *ring = NETMAP_TXRING(nmd->nifp, r);
 		uint32_t cur, idx;
@@ -403,8 +410,16 @@ pci_vtnet_netmap_writev(struct nm_desc *nmd, struct iovec *iov, int iovcnt)
 			r++;
 			if (r > nmd->last_tx_ring)
 				r = nmd->first_tx_ring;
-			if (r == nmd->cur_tx_ring)
-				break;
+			if (r == nmd->cur_tx_ring) {
+				/*
+				 * All rings are full: push out what has
+				 * been queued and look once more.
+				 */
+				if (synced)
+					break;
+				ioctl(nmd->fd, NIOCTXSYNC, NULL);
+				synced = 1;
+			}
 			continue;
 		}
 		cur = ring->cur;
@@ -420,7 +435,6 @@ pci_vtnet_netmap_writev(struct nm_desc *nmd, struct iovec *iov, int iovcnt)
 		ring->slot[cur].len = len;
 		ring->head = ring->cur = nm_ring_next(ring, cur);
 		nmd->cur_tx_ring = r;
-		ioctl(nmd->fd, NIOCTXSYNC, NULL);
 		break;
 	}
 
@@ -432,8 +446,9 @@ pci_vtnet_netmap_readv(struct nm_desc *nmd, struct iovec *iov, int iovcnt)
 {
 	int len = 0;
 	int i = 0;
-	int r;
+	int r, synced;
 
+	synced = 0;
 	for (r = nmd->cur_rx_ring; ; ) {
 		struct netmap_ring *ring = NETMAP_RXRING(nmd->nifp, r);
 		uint32_t cur, idx;
@@ -444,8 +459,16 @@ pci_vtnet_netmap_readv(struct nm_desc *nmd, struct iovec *iov, int iovcnt)
 			r++;
 			if (r > nmd->last_rx_ring)
 				r = nmd->first_rx_ring;
-			if (r == nmd->cur_rx_ring)
-				break;
+			if (r == nmd->cur_rx_ring) {
+				/*
+				 * All rings are drained: hand the consumed
+				 * slots back and look for new packets.
+				 */
+				if (synced)
+					break;
+				ioctl(nmd->fd, NIOCRXSYNC, NULL);
+				synced = 1;
+			}
 			continue;
 		}
 		cur = ring->cur;
@@ -462,7 +485,6 @@ pci_vtnet_netmap_readv(struct nm_desc *nmd, struct iovec *iov, int iovcnt)
 		}
 		ring->head = ring->cur = nm_ring_next(ring, cur);
 		nmd->cur_rx_ring = r;
-		ioctl(nmd->fd, NIOCRXSYNC, NULL);
 		break;
 	}
 	for (; i < iovcnt; i++)
@@ -496,6 +518,18 @@ pci_vtnet_netmap_tx(struct pci_vtnet_softc *sc, struct iovec *iov, int iovcnt,
 	(void) pci_vtnet_netmap_writev(sc->vsc_nmd, iov, iovcnt);
 }
 
+/*
+ * Called at the end of a transmit batch to push the queued slots out
+ */
+static void
+pci_vtnet_netmap_txsync(struct pci_vtnet_softc *sc)
+{
+
+	if (sc->vsc_nmd == NULL)
+		return;
+	ioctl(sc->vsc_nmd->fd, NIOCTXSYNC, NULL);
+}
+
 static void
 pci_vtnet_netmap_rx(struct pci_vtnet_softc *sc)
 {
@@ -581,6 +615,9 @@ pci_vtnet_netmap_rx(struct pci_vtnet_softc *sc)
 		vq_relchain(vq, idx, len + sc->rx_vhdrlen);
 	} while (vq_has_descs(vq));
 
+	/* Return the slots consumed by this batch to netmap. */
+	ioctl(sc->vsc_nmd->fd, NIOCRXSYNC, NULL);
+
 	/* Interrupt if needed, including for NOTIFY_ON_EMPTY. */
 	vq_endchains(vq, 1);
 }
@@ -705,6 +742,12 @@ pci_vtnet_tx_thread(void *param)
 			pci_vtnet_proctx(sc, vq);
 		} while (vq_has_descs(vq));
 
+		/*
+		 * Flush the batch to the backend, if it queues packets.
+		 */
+		if (sc->pci_vtnet_txsync != NULL)
+			sc->pci_vtnet_txsync(sc);
+
 		/*
 		 * Generate an interrupt if needed.
 		 */
@@ -799,6 +842,7 @@ pci_vtnet_netmap_setup(struct pci_vtnet_softc *sc, char *ifname)
 {
 	sc->pci_vtnet_rx = pci_vtnet_netmap_rx;
 	sc->pci_vtnet_tx = pci_vtnet_netmap_tx;
+	sc->pci_vtnet_txsync = pci_vtnet_netmap_txsync;
 
 	sc->vsc_nmd = nm_open(ifname, NULL, 0, 0);
 	if (sc->vsc_nmd == NULL) {
@@ -35,6 +35,7 @@
 #include <sys/devicestat.h>
 #include <sys/mman.h>
 #include <sys/resource.h>
+#include <sys/sysctl.h>
 #include <sys/time.h>
 
 #include <curses.h>
@@ -68,6 +69,46 @@ static int flag_I = 1000000;
 
 static void usage(void);
 
+/*
+ * Counters of requests and completions that GEOM dispatched directly
+ * versus through the g_down and g_up threads.
+ */
+#define	DISPATCH_DOWN_DIRECT	0
+#define	DISPATCH_DOWN_QUEUED	1
+#define	DISPATCH_UP_DIRECT	2
+#define	DISPATCH_UP_QUEUED	3
+#define	DISPATCH_NSTATS		4
+
+static const char *dispatch_oids[DISPATCH_NSTATS] = {
+	"kern.geom.dispatch.down_direct",
+	"kern.geom.dispatch.down_queued",
+	"kern.geom.dispatch.up_direct",
+	"kern.geom.dispatch.up_queued",
+};
+
+static int
+dispatch_stats(uint64_t *v)
+{
+	size_t len;
+	int i;
+
+	for (i = 0; i < DISPATCH_NSTATS; i++) {
+		len = sizeof(v[i]);
+		if (sysctlbyname(dispatch_oids[i], &v[i], &len, NULL, 0) != 0)
+			return (-1);
+	}
+	return (0);
+}
+
+static double
+dispatch_pct(uint64_t direct, uint64_t queued)
+{
+
+	if (direct + queued == 0)
+		return (0.0);
+	return (100.0 * direct / (direct + queued));
+}
+
 static const char*
 el_prompt(void)
 {
@@ -95,7 +136,8 @@ main(int argc, char **argv)
 	char ts[100], g_name[4096];
 	const char *line;
 	long double ld[16];
-	uint64_t u64;
+	uint64_t u64, dp[DISPATCH_NSTATS], dq[DISPATCH_NSTATS];
+	int dispatch_ok;
 	EditLine *el;
 	History *hist;
 	HistEvent hist_ev;
@@ -217,6 +259,7 @@ main(int argc, char **argv)
 		keypad(stdscr, TRUE);
 	}
 	geom_stats_snapshot_timestamp(sq, &tq);
+	dispatch_ok = dispatch_stats(dq) == 0;
 	for (quit = 0; !quit;) {
 		sp = geom_stats_snapshot_get();
 		if (sp == NULL)
@@ -239,6 +282,16 @@ main(int argc, char **argv)
 		if (!flag_C)
 			PRINTMSG("dT: %5.3fs  w: %.3fs", dt,
 					(float)flag_I / 1000000);
+		if (!flag_C && dispatch_ok && dispatch_stats(dp) == 0) {
+			PRINTMSG("  direct: %3.0f%% down %3.0f%% up",
+			    dispatch_pct(dp[DISPATCH_DOWN_DIRECT] -
+			    dq[DISPATCH_DOWN_DIRECT],
+			    dp[DISPATCH_DOWN_QUEUED] - dq[DISPATCH_DOWN_QUEUED]),
+			    dispatch_pct(dp[DISPATCH_UP_DIRECT] -
+			    dq[DISPATCH_UP_DIRECT],
+			    dp[DISPATCH_UP_QUEUED] - dq[DISPATCH_UP_QUEUED]));
+			memcpy(dq, dp, sizeof(dq));
+		}
 		if (!flag_C && f_s[0] != '\0') {
 			PRINTMSG("  filter: ");
 			if (!flag_b) {
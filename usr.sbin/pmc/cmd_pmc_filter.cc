@@ -32,12 +32,14 @@ __FBSDID("$FreeBSD$");
 #include <sys/param.h>
 #include <sys/cpuset.h>
 #include <sys/event.h>
+#include <sys/mman.h>
 #include <sys/queue.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/sysctl.h>
 #include <sys/time.h>
 #include <sys/ttycom.h>
+#include <sys/uio.h>
 #include <sys/user.h>
 #include <sys/wait.h>
 
@@ -79,7 +81,12 @@ typedef unordered_map < int ,string > idmap;
 typedef pair < int ,string > identry;
 
 #define LIST_MAX 64
+
+/* Kept output is written once this many bytes are pending. */
+#define	FILTER_FLUSH_SIZE	(1024 * 1024)
+
 static struct option longopts[] = {
+	{"json", no_argument, NULL, 'j'},
 	{"lwps", required_argument, NULL, 't'},
 	{"pids", required_argument, NULL, 'p'},
 	{"threads", required_argument, NULL, 'T'},
@@ -94,6 +101,7 @@ usage(void)
 	errx(EX_USAGE,
 	    "\t filter log file\n"
 	    "\t -e <events>, --events <events> -- comma-delimited list of events to filter on\n"
+	    "\t -j, --json -- write the kept records as JSON\n"
 	    "\t -p <pids>, --pids <pids> -- comma-delimited list of pids to filter on\n"
 	    "\t -P <processes>, --processes <processes> -- comma-delimited list of process names to filter on\n"
 	    "\t -t <lwps>, --lwps <lwps> -- comma-delimited list of lwps to filter on\n"
@@ -150,10 +158,6 @@ parse_names(char *strlist, char *namelist[LIST_MAX], int *pcount)
 }
 
 
-struct pmcid_ent {
-	uint32_t pe_pmcid;
-	uint32_t pe_idx;
-};
 #define	_PMCLOG_TO_HEADER(T,L)						\
 	((PMCLOG_HEADER_MAGIC << 24) |					\
 	 (PMCLOG_TYPE_ ## T << 16)   |					\
@@ -177,22 +181,136 @@ pmc_find_name(idmap & map, uint32_t id, char *list[LIST_MAX], int count)
 	return (false);
 }
 
+/*
+ * Kept records are written straight out of the mapped log with writev(2),
+ * runs of adjacent records sharing one vector.  In JSON mode only the kept
+ * records are decoded, into a buffer that is reused from flush to flush.
+ */
+struct filter_output {
+	int		fo_fd;
+	bool		fo_json;
+	void		*fo_ps;
+	struct iovec	fo_iov[IOV_MAX];
+	int		fo_iovcnt;
+	size_t		fo_pending;
+	string		fo_jsonbuf;
+};
+
+static void
+filter_writev(int fd, struct iovec *iov, int iovcnt)
+{
+	ssize_t n;
+
+	while (iovcnt > 0) {
+		if ((n = writev(fd, iov, iovcnt)) < 0) {
+			if (errno == EINTR)
+				continue;
+			errx(EX_OSERR, "ERROR: failed output write");
+		}
+		while (iovcnt > 0 && (size_t)n >= iov->iov_len) {
+			n -= iov->iov_len;
+			iov++;
+			iovcnt--;
+		}
+		if (iovcnt > 0) {
+			iov->iov_base = (char *)iov->iov_base + n;
+			iov->iov_len -= n;
+		}
+	}
+}
+
 static void
-pmc_log_event(int fd, struct pmclog_ev *ev, bool json)
+filter_flush(struct filter_output *fo)
 {
-	int len;
-	const void *buf;
 
-	if (json) {
-		string ret = event_to_json(ev);
-		buf = ret.c_str();
-		len = ret.size();
+	if (fo->fo_json) {
+		if (event_json_flush(fo->fo_fd, fo->fo_jsonbuf) != 0)
+			errx(EX_OSERR, "ERROR: failed output write");
 	} else {
-		len = ev->pl_len;
-		buf = ev->pl_data;
+		filter_writev(fo->fo_fd, fo->fo_iov, fo->fo_iovcnt);
+		fo->fo_iovcnt = 0;
+	}
+	fo->fo_pending = 0;
+}
+
+static void
+filter_emit(struct filter_output *fo, const char *rec, uint32_t len)
+{
+	struct pmclog_ev ev;
+	struct iovec *last;
+
+	if (fo->fo_json) {
+		if (pmclog_feed(fo->fo_ps, const_cast<char *>(rec), len) != 0 ||
+		    pmclog_read(fo->fo_ps, &ev) != 0)
+			errx(EX_DATAERR, "ERROR: cannot decode record");
+		if (event_to_json_fd(fo->fo_fd, &ev, fo->fo_jsonbuf) != 0)
+			errx(EX_OSERR, "ERROR: failed output write");
+		return;
+	}
+	last = fo->fo_iovcnt > 0 ? &fo->fo_iov[fo->fo_iovcnt - 1] : NULL;
+	if (last != NULL && (const char *)last->iov_base + last->iov_len == rec)
+		last->iov_len += len;
+	else {
+		if (fo->fo_iovcnt == IOV_MAX)
+			filter_flush(fo);
+		fo->fo_iov[fo->fo_iovcnt].iov_base = const_cast<char *>(rec);
+		fo->fo_iov[fo->fo_iovcnt].iov_len = len;
+		fo->fo_iovcnt++;
+	}
+	if ((fo->fo_pending += len) >= FILTER_FLUSH_SIZE)
+		filter_flush(fo);
+}
+
+/*
+ * Step to the next record of a mapped log.  Returns false at the end of
+ * the log or at the first damaged record.
+ */
+static bool
+filter_next(const char *base, size_t len, size_t *offp, const char **recp,
+    uint32_t *typep, uint32_t *lenp)
+{
+	size_t off;
+	uint32_t h;
+
+	off = *offp;
+	if (len - off < sizeof(struct pmclog_header)) {
+		if (off != len)
+			warnx("WARNING: truncated record at offset %zu", off);
+		return (false);
 	}
-	if (write(fd, buf, len) != (ssize_t)len)
-		errx(EX_OSERR, "ERROR: failed output write");
+	memcpy(&h, base + off, sizeof(h));
+	if (!PMCLOG_HEADER_CHECK_MAGIC(h) ||
+	    PMCLOG_HEADER_TO_LENGTH(h) < sizeof(struct pmclog_header) ||
+	    PMCLOG_HEADER_TO_LENGTH(h) > len - off) {
+		warnx("WARNING: damaged record at offset %zu", off);
+		return (false);
+	}
+	*recp = base + off;
+	*typep = PMCLOG_HEADER_TO_TYPE(h);
+	*lenp = PMCLOG_HEADER_TO_LENGTH(h);
+	*offp = off + *lenp;
+	return (true);
+}
+
+/* Read a field of a record in place. */
+static uint32_t
+rec32(const char *rec, uint32_t len, size_t off)
+{
+	uint32_t v;
+
+	if (off + sizeof(v) > len)
+		errx(EX_DATAERR, "ERROR: short record");
+	memcpy(&v, rec + off, sizeof(v));
+	return (v);
+}
+
+static string
+recname(const char *rec, uint32_t len, size_t off)
+{
+
+	if (off + MAXCOMLEN + 1 > len)
+		errx(EX_DATAERR, "ERROR: short record");
+	return (string(rec + off, strnlen(rec + off, MAXCOMLEN + 1)));
 }
 
 static void
@@ -200,86 +318,108 @@ pmc_filter_handler(uint32_t *lwplist, int lwpcount, uint32_t *pidlist, int pidco
     char *events, char *processes, char *threads, bool exclusive, bool json, int infd,
     int outfd)
 {
-	struct pmclog_ev ev;
-	struct pmclog_parse_state *ps;
-	struct pmcid_ent *pe;
+	struct filter_output fo;
+	struct stat sb;
 	uint32_t eventlist[LIST_MAX];
 	char cpuid[PMC_CPUID_LEN];
 	char *proclist[LIST_MAX];
 	char *threadlist[LIST_MAX];
-	int i, pmccount, copies, eventcount;
+	const char *base, *rec;
+	size_t len, off;
+	int i, eventcount;
 	int proccount, threadcount;
-	uint32_t idx;
+	uint32_t idx, pid, reclen, tid, type;
+	unordered_map<uint32_t, uint32_t> pmcevents;
 	idmap pidmap, tidmap;
 
-	if ((ps = static_cast < struct pmclog_parse_state *>(pmclog_open(infd)))== NULL)
-		errx(EX_OSERR, "ERROR: Cannot allocate pmclog parse state: %s\n", strerror(errno));
+	if (fstat(infd, &sb) < 0)
+		errx(EX_OSERR, "ERROR: Cannot stat log: %s", strerror(errno));
+	if (!S_ISREG(sb.st_mode))
+		errx(EX_USAGE, "ERROR: log must be a regular file");
+	if ((len = sb.st_size) == 0)
+		return;
+	base = static_cast<const char *>(mmap(NULL, len, PROT_READ, MAP_SHARED,
+	    infd, 0));
+	if (base == MAP_FAILED)
+		errx(EX_OSERR, "ERROR: Cannot map log: %s", strerror(errno));
+	(void)madvise(const_cast<char *>(base), len, MADV_SEQUENTIAL);
 
-	threadcount = proccount = eventcount = pmccount = 0;
+	threadcount = proccount = eventcount = 0;
 	if (processes)
 		parse_names(processes, proclist, &proccount);
 	if (threads)
 		parse_names(threads, threadlist, &threadcount);
-	while (pmclog_read(ps, &ev) == 0) {
-		if (ev.pl_type == PMCLOG_TYPE_INITIALIZE)
-			memcpy(cpuid, ev.pl_u.pl_i.pl_cpuid, PMC_CPUID_LEN);
-		if (ev.pl_type == PMCLOG_TYPE_PMCALLOCATE)
-			pmccount++;
-	}
-	if (events)
-		parse_events(events, eventlist, &eventcount, cpuid);
-	lseek(infd, 0, SEEK_SET);
-	pmclog_close(ps);
-	if ((ps = static_cast < struct pmclog_parse_state *>(pmclog_open(infd)))== NULL)
-		errx(EX_OSERR, "ERROR: Cannot allocate pmclog parse state: %s\n", strerror(errno));
-	if ((pe = (struct pmcid_ent *) malloc(sizeof(*pe) * pmccount)) == NULL)
-		errx(EX_OSERR, "ERROR: failed to allocate pmcid map");
-	i = 0;
-	while (pmclog_read(ps, &ev) == 0 && i < pmccount) {
-		if (ev.pl_type == PMCLOG_TYPE_PMCALLOCATE) {
-			pe[i].pe_pmcid = ev.pl_u.pl_a.pl_pmcid;
-			pe[i].pe_idx = ev.pl_u.pl_a.pl_event;
-			i++;
+	if (events) {
+		/*
+		 * Event names are resolved against the log's CPU, and
+		 * samples may precede the allocation of their PMC, so
+		 * collect both before filtering.
+		 */
+		memset(cpuid, 0, sizeof(cpuid));
+		off = 0;
+		while (filter_next(base, len, &off, &rec, &type, &reclen)) {
+			if (type == PMCLOG_TYPE_INITIALIZE) {
+				if (reclen < sizeof(struct pmclog_initialize))
+					errx(EX_DATAERR, "ERROR: short record");
+				memcpy(cpuid, rec + offsetof(struct pmclog_initialize,
+				    pl_cpuid), PMC_CPUID_LEN);
+			}
+			if (type == PMCLOG_TYPE_PMCALLOCATE)
+				pmcevents.emplace(rec32(rec, reclen,
+				    offsetof(struct pmclog_pmcallocate, pl_pmcid)),
+				    rec32(rec, reclen,
+				    offsetof(struct pmclog_pmcallocate, pl_event)));
 		}
+		parse_events(events, eventlist, &eventcount, cpuid);
 	}
-	lseek(infd, 0, SEEK_SET);
-	pmclog_close(ps);
-	if ((ps = static_cast < struct pmclog_parse_state *>(pmclog_open(infd)))== NULL)
+
+	fo.fo_fd = outfd;
+	fo.fo_json = json;
+	fo.fo_iovcnt = 0;
+	fo.fo_pending = 0;
+	fo.fo_ps = NULL;
+	if (json && (fo.fo_ps = pmclog_open(PMCLOG_FD_NONE)) == NULL)
 		errx(EX_OSERR, "ERROR: Cannot allocate pmclog parse state: %s\n", strerror(errno));
-	copies = 0;
-	while (pmclog_read(ps, &ev) == 0) {
-		if (ev.pl_type == PMCLOG_TYPE_THR_CREATE)
-			tidmap[ev.pl_u.pl_tc.pl_tid] = ev.pl_u.pl_tc.pl_tdname;
-		if (ev.pl_type == PMCLOG_TYPE_PROC_CREATE)
-			pidmap[ev.pl_u.pl_pc.pl_pid] = ev.pl_u.pl_pc.pl_pcomm;
-		if (ev.pl_type != PMCLOG_TYPE_CALLCHAIN) {
-			pmc_log_event(outfd, &ev, json);
+	off = 0;
+	while (filter_next(base, len, &off, &rec, &type, &reclen)) {
+		if (type == PMCLOG_TYPE_THR_CREATE)
+			tidmap[rec32(rec, reclen,
+			    offsetof(struct pmclog_threadcreate, pl_tid))] =
+			    recname(rec, reclen,
+			    offsetof(struct pmclog_threadcreate, pl_tdname));
+		if (type == PMCLOG_TYPE_PROC_CREATE)
+			pidmap[rec32(rec, reclen,
+			    offsetof(struct pmclog_proccreate, pl_pid))] =
+			    recname(rec, reclen,
+			    offsetof(struct pmclog_proccreate, pl_pcomm));
+		if (type != PMCLOG_TYPE_CALLCHAIN) {
+			filter_emit(&fo, rec, reclen);
 			continue;
 		}
+		pid = rec32(rec, reclen, offsetof(struct pmclog_callchain, pl_pid));
+		tid = rec32(rec, reclen, offsetof(struct pmclog_callchain, pl_tid));
 		if (pidcount) {
 			for (i = 0; i < pidcount; i++)
-				if (pidlist[i] == ev.pl_u.pl_cc.pl_pid)
+				if (pidlist[i] == pid)
 					break;
 			if ((i == pidcount) == exclusive)
 				continue;
 		}
 		if (lwpcount) {
 			for (i = 0; i < lwpcount; i++)
-				if (lwplist[i] == ev.pl_u.pl_cc.pl_tid)
+				if (lwplist[i] == tid)
 					break;
 			if ((i == lwpcount) == exclusive)
 				continue;
 		}
 		if (eventcount) {
-			for (i = 0; i < pmccount; i++) {
-				if (pe[i].pe_pmcid == ev.pl_u.pl_cc.pl_pmcid)
-					break;
-			}
-			if (i == pmccount)
-				errx(EX_USAGE, "ERROR: unallocated pmcid: %d\n",
-				    ev.pl_u.pl_cc.pl_pmcid);
+			idx = rec32(rec, reclen,
+			    offsetof(struct pmclog_callchain, pl_pmcid));
+			auto pe = pmcevents.find(idx);
+			if (pe == pmcevents.end())
+				errx(EX_USAGE, "ERROR: unallocated pmcid: %d\n", idx);
 
-			idx = pe[i].pe_idx;
+			idx = pe->second;
 			for (i = 0; i < eventcount; i++) {
 				if (idx == eventlist[i])
 					break;
@@ -288,13 +428,17 @@ pmc_filter_handler(uint32_t *lwplist, int lwpcount, uint32_t *pidlist, int pidco
 				continue;
 		}
 		if (proccount &&
-		    pmc_find_name(pidmap, ev.pl_u.pl_cc.pl_pid, proclist, proccount) == exclusive)
+		    pmc_find_name(pidmap, pid, proclist, proccount) == exclusive)
 			continue;
 		if (threadcount &&
-		    pmc_find_name(tidmap, ev.pl_u.pl_cc.pl_tid, threadlist, threadcount) == exclusive)
+		    pmc_find_name(tidmap, tid, threadlist, threadcount) == exclusive)
 			continue;
-		pmc_log_event(outfd, &ev, json);
+		filter_emit(&fo, rec, reclen);
 	}
+	filter_flush(&fo);
+	if (fo.fo_ps != NULL)
+		pmclog_close(fo.fo_ps);
+	munmap(const_cast<char *>(base), len);
 }
 
 int
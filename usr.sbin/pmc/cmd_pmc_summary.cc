@@ -32,6 +32,7 @@ __FBSDID("$FreeBSD$");
 #include <sys/param.h>
 #include <sys/cpuset.h>
 #include <sys/event.h>
+#include <sys/mman.h>
 #include <sys/queue.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
@@ -68,8 +69,12 @@ __FBSDID("$FreeBSD$");
 #include <libpmcstat.h>
 #include "cmd_pmc.h"
 
+#include <algorithm>
+#include <chrono>
 #include <iostream>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 #include <unordered_map>
 
@@ -83,65 +88,299 @@ typedef unordered_map <uint32_t, std::vector<samplename>> eventcountmap;
 
 #define	P_KPROC		0x00004	/* Kernel process. */
 
+/*
+ * Mapped logs are split into chunks of about this size, cut at record
+ * boundaries, and summarized by parallel workers.
+ */
+#define	SUMMARY_CHUNK_SIZE	(64 * 1024 * 1024)
+
+/*
+ * A sample, identified by the PMC and process that it was taken for.
+ * Allocation and process records can redefine an id partway through the
+ * log, so each id also carries a generation: 0 refers to the definition
+ * in force when the chunk started, and n to the n'th definition made
+ * within the chunk.  This lets chunks be summarized independently and
+ * still attribute every sample exactly as a serial pass would.
+ */
+struct samplekey {
+	uint32_t	sk_pmcid;
+	uint32_t	sk_pmcgen;
+	uint32_t	sk_pid;
+	uint32_t	sk_pidgen;
+
+	bool operator==(const samplekey &o) const
+	{
+		return (sk_pmcid == o.sk_pmcid && sk_pmcgen == o.sk_pmcgen &&
+		    sk_pid == o.sk_pid && sk_pidgen == o.sk_pidgen);
+	}
+};
+
+struct samplekey_hash {
+	size_t operator()(const samplekey &k) const
+	{
+		return (std::hash<uint64_t>()(((uint64_t)k.sk_pmcid << 32 |
+		    k.sk_pid) ^ ((uint64_t)k.sk_pmcgen << 48 | k.sk_pidgen)));
+	}
+};
+
+struct pmcalloc {
+	uint32_t	pa_event;
+	uint64_t	pa_rate;
+	std::string	pa_name;
+};
+
+/* The part of a log summarized by one worker. */
+struct chunksummary {
+	/* Definitions made within the chunk, in log order. */
+	unordered_map<uint32_t, std::vector<uint32_t>> cs_pmcdefs;
+	unordered_map<uint32_t, std::vector<std::string>> cs_piddefs;
+	std::vector<pmcalloc> cs_allocs;
+	unordered_map<samplekey, uint64_t, samplekey_hash> cs_samples;
+};
+
+/* Shared state of a parallel summary. */
+struct summaryjob {
+	std::mutex	sj_lock;
+	const char	*sj_base;	/* mapped log */
+	size_t		sj_len;
+	size_t		sj_next;	/* start of the next chunk */
+	const char	*sj_init;	/* log initialization record */
+	size_t		sj_initlen;
+	std::vector<chunksummary> sj_chunks;
+	size_t		sj_done;	/* bytes summarized so far */
+	bool		sj_progress;
+	std::chrono::steady_clock::time_point sj_start, sj_report;
+};
+
 static void __dead2
 usage(void)
 {
 	errx(EX_USAGE,
 	    "\t summarize log file\n"
 		 "\t -k <k>, --topk <k> show topk processes for each counter\n"
+		 "\t -j <n>, --jobs <n> summarize with n threads\n"
 	    );
 }
 
-static int
-pmc_summary_handler(int logfd, int k, bool do_full)
+/*
+ * Summarize the events that the parser returns until it runs out of data.
+ */
+static void
+summarize_events(struct pmclog_parse_state *ps, chunksummary &cs)
 {
-	struct pmclog_parse_state *ps;
 	struct pmclog_ev ev;
-	idmap pidmap, tidmap, eventnamemap;
-	strintmap tideventmap, pideventmap;
-	intmap eventmap, pmcidmap, ratemap;
-	intmap kerntidmap, kernpidmap;
-	eventcountmap countmap;
 
-	ps = static_cast<struct pmclog_parse_state*>(pmclog_open(logfd));
-	if (ps == NULL)
-		errx(EX_OSERR, "ERROR: Cannot allocate pmclog parse state: %s\n",
-			 strerror(errno));
 	while (pmclog_read(ps, &ev) == 0) {
 		if (ev.pl_type == PMCLOG_TYPE_PMCALLOCATE) {
-			pmcidmap[ev.pl_u.pl_a.pl_pmcid] = ev.pl_u.pl_a.pl_event;
-			ratemap[ev.pl_u.pl_a.pl_event] = ev.pl_u.pl_a.pl_rate;
-			eventnamemap[ev.pl_u.pl_a.pl_event] = ev.pl_u.pl_a.pl_evname;
+			cs.cs_pmcdefs[ev.pl_u.pl_a.pl_pmcid].push_back(
+			    ev.pl_u.pl_a.pl_event);
+			cs.cs_allocs.push_back({ev.pl_u.pl_a.pl_event,
+			    ev.pl_u.pl_a.pl_rate, ev.pl_u.pl_a.pl_evname});
 		}
-		if (ev.pl_type == PMCLOG_TYPE_THR_CREATE) {
-			tidmap[ev.pl_u.pl_tc.pl_tid] = ev.pl_u.pl_tc.pl_tdname;
-			kerntidmap[ev.pl_u.pl_tc.pl_tid] = !!(ev.pl_u.pl_tc.pl_flags & P_KPROC);
-			if (tideventmap.find(ev.pl_u.pl_tc.pl_tdname) == tideventmap.end())
-				tideventmap[ev.pl_u.pl_tc.pl_tdname] = intmap();
+		if (ev.pl_type == PMCLOG_TYPE_PROC_CREATE)
+			cs.cs_piddefs[ev.pl_u.pl_pc.pl_pid].push_back(
+			    ev.pl_u.pl_pc.pl_pcomm);
+		if (ev.pl_type == PMCLOG_TYPE_CALLCHAIN) {
+			samplekey key = { ev.pl_u.pl_cc.pl_pmcid, 0,
+			    ev.pl_u.pl_cc.pl_pid, 0 };
+			auto pmcdef = cs.cs_pmcdefs.find(key.sk_pmcid);
+			auto piddef = cs.cs_piddefs.find(key.sk_pid);
+
+			if (pmcdef != cs.cs_pmcdefs.end())
+				key.sk_pmcgen = pmcdef->second.size();
+			if (piddef != cs.cs_piddefs.end())
+				key.sk_pidgen = piddef->second.size();
+			cs.cs_samples[key]++;
 		}
-		if (ev.pl_type == PMCLOG_TYPE_PROC_CREATE) {
-			pidmap[ev.pl_u.pl_pc.pl_pid] = ev.pl_u.pl_pc.pl_pcomm;
-			kernpidmap[ev.pl_u.pl_pc.pl_pid] = !!(ev.pl_u.pl_pc.pl_flags & P_KPROC);
-			if (pideventmap.find(ev.pl_u.pl_pc.pl_pcomm) == pideventmap.end())
-				pideventmap[ev.pl_u.pl_pc.pl_pcomm] = intmap();
+	}
+}
+
+/*
+ * Cut the next chunk off the mapped log, summarize it, and repeat until the
+ * log is exhausted.  Chunks are cut under the job lock by walking record
+ * headers, which is cheap next to parsing the records.
+ */
+static void
+summary_worker(summaryjob *job)
+{
+	struct pmclog_parse_state *ps;
+	struct pmclog_ev ev;
+	size_t idx, start, end;
+	uint32_t h;
+
+	for (;;) {
+		job->sj_lock.lock();
+		start = end = job->sj_next;
+		while (end < job->sj_len && end - start < SUMMARY_CHUNK_SIZE) {
+			if (job->sj_len - end < sizeof(h)) {
+				end = job->sj_len;
+				break;
+			}
+			memcpy(&h, job->sj_base + end, sizeof(h));
+			if (!PMCLOG_HEADER_CHECK_MAGIC(h) ||
+			    PMCLOG_HEADER_TO_LENGTH(h) == 0) {
+				/* Let the parser report the damage. */
+				end = job->sj_len;
+				break;
+			}
+			end += PMCLOG_HEADER_TO_LENGTH(h);
 		}
-		if (ev.pl_type == PMCLOG_TYPE_CALLCHAIN) {
-			auto event = pmcidmap[ev.pl_u.pl_cc.pl_pmcid];
+		end = std::min(end, job->sj_len);
+		job->sj_next = end;
+		idx = job->sj_chunks.size();
+		job->sj_chunks.emplace_back();
+		job->sj_lock.unlock();
+		if (start == end)
+			return;
+
+		/*
+		 * Decoding allocation records needs the CPU type from the
+		 * log's initialization record, so replay it first.
+		 */
+		chunksummary cs;
+		ps = static_cast<struct pmclog_parse_state*>(
+		    pmclog_open(PMCLOG_FD_NONE));
+		if (ps == NULL)
+			errx(EX_OSERR, "ERROR: Cannot allocate pmclog parse "
+			    "state: %s\n", strerror(errno));
+		if (start != 0) {
+			pmclog_feed(ps, const_cast<char *>(job->sj_init),
+			    job->sj_initlen);
+			(void)pmclog_read(ps, &ev);
+		}
+		pmclog_feed(ps, const_cast<char *>(job->sj_base + start),
+		    end - start);
+		summarize_events(ps, cs);
+		pmclog_close(ps);
+
+		job->sj_lock.lock();
+		job->sj_chunks[idx] = std::move(cs);
+		job->sj_done += end - start;
+		if (job->sj_progress) {
+			auto now = std::chrono::steady_clock::now();
+			std::chrono::duration<double> elapsed =
+			    now - job->sj_start;
+
+			if (now - job->sj_report >= std::chrono::seconds(1)) {
+				job->sj_report = now;
+				fprintf(stderr, "\r%zu/%zu MB, %.0f MB/s",
+				    job->sj_done >> 20, job->sj_len >> 20,
+				    (job->sj_done >> 20) / elapsed.count());
+			}
+		}
+		job->sj_lock.unlock();
+	}
+}
+
+/*
+ * Summarize a log that can be mapped with up to `nthreads' threads,
+ * returning the chunk summaries in log order.  Returns false if the log
+ * could not be mapped.
+ */
+static bool
+summarize_mapped(int logfd, int nthreads, std::vector<chunksummary> &chunks)
+{
+	std::vector<std::thread> workers;
+	summaryjob job;
+	struct stat sb;
+	uint32_t h;
+	void *base;
+
+	if (fstat(logfd, &sb) < 0 || !S_ISREG(sb.st_mode) ||
+	    sb.st_size < (off_t)sizeof(h))
+		return (false);
+	base = mmap(NULL, sb.st_size, PROT_READ, MAP_SHARED, logfd, 0);
+	if (base == MAP_FAILED)
+		return (false);
+
+	job.sj_base = static_cast<const char *>(base);
+	job.sj_len = sb.st_size;
+	job.sj_next = 0;
+	memcpy(&h, job.sj_base, sizeof(h));
+	job.sj_init = job.sj_base;
+	job.sj_initlen = std::min<size_t>(PMCLOG_HEADER_TO_LENGTH(h),
+	    job.sj_len);
+	job.sj_done = 0;
+	job.sj_progress = isatty(STDERR_FILENO);
+	job.sj_start = job.sj_report = std::chrono::steady_clock::now();
+
+	for (int i = 1; i < nthreads; i++)
+		workers.emplace_back(summary_worker, &job);
+	summary_worker(&job);
+	for (auto &t : workers)
+		t.join();
+
+	if (job.sj_progress) {
+		std::chrono::duration<double> elapsed =
+		    std::chrono::steady_clock::now() - job.sj_start;
 
+		fprintf(stderr, "\r%zu MB in %.1fs, %.0f MB/s, %d threads\n",
+		    job.sj_len >> 20, elapsed.count(),
+		    (job.sj_len >> 20) / std::max(elapsed.count(), 1e-3),
+		    nthreads);
+	}
+	munmap(base, sb.st_size);
+	chunks = std::move(job.sj_chunks);
+	return (true);
+}
+
+static int
+pmc_summary_handler(int logfd, int k, bool do_full, int nthreads)
+{
+	struct pmclog_parse_state *ps;
+	std::vector<chunksummary> chunks;
+	idmap pidmap, eventnamemap;
+	strintmap pideventmap;
+	intmap pmcidmap, ratemap;
+	eventcountmap countmap;
+
+	if (!summarize_mapped(logfd, nthreads, chunks)) {
+		/* Not a regular file; read it serially. */
+		ps = static_cast<struct pmclog_parse_state*>(pmclog_open(logfd));
+		if (ps == NULL)
+			errx(EX_OSERR, "ERROR: Cannot allocate pmclog parse state: %s\n",
+				 strerror(errno));
+		chunks.resize(1);
+		summarize_events(ps, chunks[0]);
+		pmclog_close(ps);
+	}
+
+	/*
+	 * Merge the chunks in log order, resolving each sample's PMC and
+	 * process with the definitions in force when it was taken.
+	 */
+	for (auto &cs : chunks) {
+		for (auto &kv : cs.cs_samples) {
+			const samplekey &key = kv.first;
+			uint32_t event;
+			const std::string *comm;
+
+			if (key.sk_pmcgen != 0)
+				event = cs.cs_pmcdefs[key.sk_pmcid][key.sk_pmcgen - 1];
+			else
+				event = pmcidmap[key.sk_pmcid];
 			if (event == 0)
 				continue;
-			eventmap[event]++;
-			auto tidname = tidmap.find(ev.pl_u.pl_cc.pl_tid);
-			auto pidname = pidmap.find(ev.pl_u.pl_cc.pl_pid);
-			if (tidname != tidmap.end()) {
-				auto &teventmap = tideventmap[tidname->second];
-				teventmap[event]++;
-			}
-			if (pidname != pidmap.end()) {
-				auto &peventmap = pideventmap[pidname->second];
-				peventmap[event]++;
+			if (key.sk_pidgen != 0)
+				comm = &cs.cs_piddefs[key.sk_pid][key.sk_pidgen - 1];
+			else {
+				auto pidname = pidmap.find(key.sk_pid);
+
+				if (pidname == pidmap.end())
+					continue;
+				comm = &pidname->second;
 			}
+			pideventmap[*comm][event] += kv.second;
+		}
+		for (auto &kv : cs.cs_pmcdefs)
+			pmcidmap[kv.first] = kv.second.back();
+		for (auto &kv : cs.cs_piddefs)
+			pidmap[kv.first] = kv.second.back();
+		for (auto &a : cs.cs_allocs) {
+			ratemap[a.pa_event] = a.pa_rate;
+			eventnamemap[a.pa_event] = a.pa_name;
 		}
+		cs = chunksummary();
 	}
 	for (auto &pkv : pideventmap)
 		for (auto &ekv : pkv.second) {
@@ -179,18 +418,20 @@ pmc_summary_handler(int logfd, int k, bool do_full)
 static struct option longopts[] = {
 	{"full", no_argument, NULL, 'f'},
 	{"topk", required_argument, NULL, 'k'},
+	{"jobs", required_argument, NULL, 'j'},
 	{NULL, 0, NULL, 0}
 };
 
 int
 cmd_pmc_summary(int argc, char **argv)
 {
-	int option, logfd, k;
+	int option, logfd, k, nthreads;
 	bool do_full;
 
 	do_full = false;
 	k = 5;
-	while ((option = getopt_long(argc, argv, "k:f", longopts, NULL)) != -1) {
+	nthreads = sysconf(_SC_NPROCESSORS_ONLN);
+	while ((option = getopt_long(argc, argv, "k:fj:", longopts, NULL)) != -1) {
 		switch (option) {
 		case 'f':
 			do_full = 1;
@@ -198,6 +439,9 @@ cmd_pmc_summary(int argc, char **argv)
 		case 'k':
 			k = atoi(optarg);
 			break;
+		case 'j':
+			nthreads = atoi(optarg);
+			break;
 		case '?':
 		default:
 			usage();
@@ -216,5 +460,7 @@ cmd_pmc_summary(int argc, char **argv)
 		errx(EX_OSERR, "ERROR: Cannot open \"%s\" for reading: %s.", argv[0],
 		    strerror(errno));
 
-	return (pmc_summary_handler(logfd, k, do_full));
+	if (nthreads < 1)
+		nthreads = 1;
+	return (pmc_summary_handler(logfd, k, do_full, nthreads));
 }
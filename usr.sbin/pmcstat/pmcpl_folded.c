@@ -0,0 +1,412 @@
+/*-
+ * SPDX-License-Identifier: BSD-2-Clause-FreeBSD
+ *
+ * Copyright (c) 2026 agent <agent@local>
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND CONTRIBUTORS ``AS IS'' AND
+ * ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS
+ * OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION)
+ * HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ * LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY
+ * OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/*
+ * Process hwpmc(4) samples as folded stacks.
+ *
+ * Each output line is "pmc;outer;...;leaf count", the input format of
+ * the common flame graph renderers.  Callchains are aggregated in a
+ * trie kept in a single hash table keyed by (parent node, image, function),
+ * so a sample costs one hash probe per frame and nothing is rebuilt.
+ * Nodes touched since the last output are kept on a dirty list; every
+ * interval only those are written, with the count accumulated since
+ * they were last written.  Summing all lines of the output therefore
+ * gives the totals for the whole run.
+ */
+
+#include <sys/cdefs.h>
+__FBSDID("$FreeBSD$");
+
+#include <sys/param.h>
+
+#include <assert.h>
+#include <curses.h>
+#include <err.h>
+#include <pmc.h>
+#include <pmclog.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sysexits.h>
+
+#include "pmcstat.h"
+#include "pmcstat_log.h"
+#include "pmcstat_top.h"
+#include "pmcpl_folded.h"
+
+#define	PMCPL_FD_HASHSIZE	4096	/* initial number of buckets */
+#define	PMCPL_FD_NAMELEN	256	/* longest frame name */
+#define	PMCPL_FD_MAXLINE	4096	/* longest line in top mode */
+
+/*
+ * One node per distinct call path prefix.  Roots have no image and
+ * carry the PMC index in place of a function address.
+ */
+struct pmcpl_fd_node {
+	struct pmcpl_fd_node	*pfn_parent;
+	struct pmcstat_image	*pfn_image;
+	uintfptr_t		pfn_func;
+	struct pmcstat_symbol	*pfn_sym;
+	int			pfn_pmcin;
+	unsigned		pfn_hash;
+	unsigned		pfn_samples;	/* samples ending here */
+	unsigned		pfn_emitted;	/* of which already output */
+	int			pfn_dirty;
+	struct pmcpl_fd_node	*pfn_hnext;	/* hash chain */
+	struct pmcpl_fd_node	*pfn_dnext;	/* dirty list */
+};
+
+static struct pmcpl_fd_node **pmcpl_fd_hash;
+static unsigned pmcpl_fd_hashmask;
+static unsigned pmcpl_fd_nnodes;
+static struct pmcpl_fd_node *pmcpl_fd_dirty;
+
+static unsigned
+pmcpl_fd_hashval(struct pmcpl_fd_node *parent, struct pmcstat_image *image,
+    uintfptr_t func)
+{
+	uint64_t h;
+
+	h = (uint64_t)(uintptr_t)parent * 0x9e3779b97f4a7c15ULL;
+	h ^= (uint64_t)(uintptr_t)image * 0xc2b2ae3d27d4eb4fULL;
+	h ^= (uint64_t)func * 0x165667b19e3779f9ULL;
+	return ((unsigned)(h ^ (h >> 32)));
+}
+
+/*
+ * Double the bucket count once chains average two nodes.
+ */
+
+static void
+pmcpl_fd_hash_grow(void)
+{
+	struct pmcpl_fd_node **nh, *fn, *next;
+	unsigned i, nmask;
+
+	nmask = pmcpl_fd_hashmask * 2 + 1;
+	if ((nh = calloc(nmask + 1, sizeof(*nh))) == NULL)
+		return;		/* Keep using the longer chains. */
+	for (i = 0; i <= pmcpl_fd_hashmask; i++) {
+		for (fn = pmcpl_fd_hash[i]; fn != NULL; fn = next) {
+			next = fn->pfn_hnext;
+			fn->pfn_hnext = nh[fn->pfn_hash & nmask];
+			nh[fn->pfn_hash & nmask] = fn;
+		}
+	}
+	free(pmcpl_fd_hash);
+	pmcpl_fd_hash = nh;
+	pmcpl_fd_hashmask = nmask;
+}
+
+/*
+ * Find the child of `parent' for function `func' in `image', creating
+ * it if this path has not been seen before.
+ */
+
+static struct pmcpl_fd_node *
+pmcpl_fd_lookup(struct pmcpl_fd_node *parent, struct pmcstat_image *image,
+    uintfptr_t func, struct pmcstat_symbol *sym, int pmcin)
+{
+	struct pmcpl_fd_node *fn;
+	unsigned hash;
+
+	hash = pmcpl_fd_hashval(parent, image, func);
+	for (fn = pmcpl_fd_hash[hash & pmcpl_fd_hashmask]; fn != NULL;
+	    fn = fn->pfn_hnext)
+		if (fn->pfn_parent == parent && fn->pfn_image == image &&
+		    fn->pfn_func == func)
+			return (fn);
+
+	if ((fn = calloc(1, sizeof(*fn))) == NULL)
+		err(EX_OSERR, "ERROR: Could not allocate folded stack node");
+	fn->pfn_parent = parent;
+	fn->pfn_image = image;
+	fn->pfn_func = func;
+	fn->pfn_sym = sym;
+	fn->pfn_pmcin = pmcin;
+	fn->pfn_hash = hash;
+	fn->pfn_hnext = pmcpl_fd_hash[hash & pmcpl_fd_hashmask];
+	pmcpl_fd_hash[hash & pmcpl_fd_hashmask] = fn;
+
+	if (++pmcpl_fd_nnodes > 2 * (pmcpl_fd_hashmask + 1))
+		pmcpl_fd_hash_grow();
+	return (fn);
+}
+
+/*
+ * Name of a frame: the PMC for roots, else the function, else the
+ * offset in the image.
+ */
+
+static const char *
+pmcpl_fd_name(struct pmcpl_fd_node *fn, char *buf, size_t len)
+{
+	const char *s;
+
+	if (fn->pfn_image == NULL) {
+		s = pmcstat_pmcindex_to_name(fn->pfn_pmcin);
+		if (s != NULL)
+			return (s);
+		snprintf(buf, len, "pmc%d", fn->pfn_pmcin);
+	} else if (fn->pfn_sym != NULL)
+		return (pmcstat_string_unintern(fn->pfn_sym->ps_name));
+	else
+		snprintf(buf, len, "%s+%#jx",
+		    pmcstat_string_unintern(fn->pfn_image->pi_name),
+		    (uintmax_t)fn->pfn_func);
+	return (buf);
+}
+
+/*
+ * Format the path ending at `fn' into `buf', outermost frame first.
+ */
+
+static void
+pmcpl_fd_format(struct pmcpl_fd_node *fn, char *buf, size_t len)
+{
+	struct pmcpl_fd_node *stack[PMC_CALLCHAIN_DEPTH_MAX + 1];
+	char name[PMCPL_FD_NAMELEN];
+	size_t off;
+	int n;
+
+	for (n = 0; fn != NULL && n < (int)nitems(stack); fn = fn->pfn_parent)
+		stack[n++] = fn;
+	buf[0] = '\0';
+	for (off = 0; n-- > 0 && off < len; )
+		off += snprintf(buf + off, len - off, "%s%s",
+		    pmcpl_fd_name(stack[n], name, sizeof(name)),
+		    n > 0 ? ";" : "");
+}
+
+/*
+ * Write the samples gathered since the last call and clear the dirty
+ * list.
+ */
+
+static void
+pmcpl_fd_flush(FILE *f)
+{
+	struct pmcpl_fd_node *fn;
+	char line[PMCPL_FD_MAXLINE];
+
+	while ((fn = pmcpl_fd_dirty) != NULL) {
+		pmcpl_fd_dirty = fn->pfn_dnext;
+		fn->pfn_dnext = NULL;
+		fn->pfn_dirty = 0;
+		if (fn->pfn_samples == fn->pfn_emitted)
+			continue;
+		pmcpl_fd_format(fn, line, sizeof(line));
+		fprintf(f, "%s %u\n", line, fn->pfn_samples - fn->pfn_emitted);
+		fn->pfn_emitted = fn->pfn_samples;
+	}
+	fflush(f);
+}
+
+/*
+ * Record a callchain.
+ */
+
+void
+pmcpl_fd_process(struct pmcstat_process *pp, struct pmcstat_pmcrecord *pmcr,
+    uint32_t nsamples, uintfptr_t *cc, int usermode, uint32_t cpu)
+{
+	int n;
+	uintfptr_t pc, loadaddress;
+	struct pmcstat_image *image;
+	struct pmcstat_symbol *sym;
+	struct pmcstat_pcmap *ppm[PMC_CALLCHAIN_DEPTH_MAX];
+	struct pmcstat_process *km;
+	struct pmcpl_fd_node *fn;
+
+	(void) cpu;
+
+	assert(nsamples>0 && nsamples<=PMC_CALLCHAIN_DEPTH_MAX);
+
+	/*
+	 * Validate mapping for the callchain.
+	 * Go from bottom to first invalid entry.
+	 */
+	km = pmcstat_kernproc;
+	for (n = 0; n < (int)nsamples; n++) {
+		ppm[n] = pmcstat_process_find_map(usermode ?
+		    pp : km, cc[n]);
+		if (ppm[n] == NULL) {
+			/* Detect full frame capture (kernel + user). */
+			if (!usermode) {
+				ppm[n] = pmcstat_process_find_map(pp, cc[n]);
+				if (ppm[n] != NULL)
+					km = pp;
+			}
+		}
+		if (ppm[n] == NULL)
+			break;
+	}
+	if (n-- == 0) {
+		pmcstat_stats.ps_callchain_dubious_frames++;
+		pmcr->pr_dubious_frames++;
+		return;
+	}
+
+	/* Walk from the outermost frame down to the leaf. */
+	fn = pmcpl_fd_lookup(NULL, NULL, pmcr->pr_pmcin, NULL,
+	    pmcr->pr_pmcin);
+	for (; n >= 0; n--) {
+		image = ppm[n]->ppm_image;
+		loadaddress = ppm[n]->ppm_lowpc +
+		    image->pi_vaddr - image->pi_start;
+		pc = cc[n] - loadaddress;
+		if ((sym = pmcstat_symbol_search(image, pc)) != NULL)
+			pc = sym->ps_start;
+		else
+			pmcstat_stats.ps_samples_unknown_function++;
+		fn = pmcpl_fd_lookup(fn, image, pc, sym, pmcr->pr_pmcin);
+	}
+
+	fn->pfn_samples++;
+	if (!fn->pfn_dirty) {
+		fn->pfn_dirty = 1;
+		fn->pfn_dnext = pmcpl_fd_dirty;
+		pmcpl_fd_dirty = fn;
+	}
+}
+
+/*
+ * Periodic output of the samples accumulated since the last interval.
+ */
+
+void
+pmcpl_fd_interval(void)
+{
+
+	if ((args.pa_flags & FLAG_DO_CALLGRAPHS) && args.pa_graphfile != NULL)
+		pmcpl_fd_flush(args.pa_graphfile);
+}
+
+static int
+pmcpl_fd_compare(const void *a, const void *b)
+{
+	const struct pmcpl_fd_node *fa, *fb;
+
+	fa = *(const struct pmcpl_fd_node * const *)a;
+	fb = *(const struct pmcpl_fd_node * const *)b;
+	if (fa->pfn_samples != fb->pfn_samples)
+		return (fa->pfn_samples < fb->pfn_samples ? 1 : -1);
+	return (0);
+}
+
+/*
+ * Output top mode snapshot: the heaviest stacks, leaf end shown when
+ * a stack is wider than the screen.
+ */
+
+void
+pmcpl_fd_topdisplay(void)
+{
+	struct pmcpl_fd_node **list, *fn;
+	char line[PMCPL_FD_MAXLINE];
+	unsigned i, n, total;
+	size_t len, width;
+	int v_attrs, y;
+	float v;
+
+	PMCSTAT_PRINTW("%5.5s %s\n", "%SAMP", "STACK");
+
+	if ((list = malloc((pmcpl_fd_nnodes + 1) * sizeof(*list))) == NULL)
+		return;
+	n = total = 0;
+	for (i = 0; i <= pmcpl_fd_hashmask; i++)
+		for (fn = pmcpl_fd_hash[i]; fn != NULL; fn = fn->pfn_hnext)
+			if (fn->pfn_samples != 0 &&
+			    fn->pfn_pmcin == pmcstat_pmcinfilter) {
+				list[n++] = fn;
+				total += fn->pfn_samples;
+			}
+	qsort(list, n, sizeof(*list), pmcpl_fd_compare);
+
+	width = pmcstat_displaywidth > 8 ? pmcstat_displaywidth - 7 : 1;
+	for (i = 0, y = 2; i < n && y < pmcstat_displayheight - 1; i++, y++) {
+		v = list[i]->pfn_samples * 100.0 / total;
+		if (v < pmcstat_threshold)
+			break;
+		pmcpl_fd_format(list[i], line, sizeof(line));
+		len = strlen(line);
+		v_attrs = PMCSTAT_ATTRPERCENT(v);
+		PMCSTAT_ATTRON(v_attrs);
+		PMCSTAT_PRINTW("%5.1f", v);
+		PMCSTAT_ATTROFF(v_attrs);
+		if (len > width && width > 3)
+			PMCSTAT_PRINTW(" ...%s\n", line + len - width + 3);
+		else
+			PMCSTAT_PRINTW(" %s\n", line);
+	}
+	if (i < n)
+		PMCSTAT_PRINTW("...\n");
+
+	free(list);
+}
+
+int
+pmcpl_fd_init(void)
+{
+
+	pmcpl_fd_hashmask = PMCPL_FD_HASHSIZE - 1;
+	if ((pmcpl_fd_hash = calloc(PMCPL_FD_HASHSIZE,
+	    sizeof(*pmcpl_fd_hash))) == NULL)
+		err(EX_OSERR, "ERROR: Could not allocate folded stack table");
+	pmcpl_fd_nnodes = 0;
+	pmcpl_fd_dirty = NULL;
+
+	return (0);
+}
+
+void
+pmcpl_fd_shutdown(FILE *mf)
+{
+	struct pmcpl_fd_node *fn, *next;
+	unsigned i;
+
+	(void) mf;
+
+	/* Write what is left since the last interval. */
+	pmcpl_fd_interval();
+
+	/*
+	 * Free memory.
+	 */
+
+	for (i = 0; i <= pmcpl_fd_hashmask; i++)
+		for (fn = pmcpl_fd_hash[i]; fn != NULL; fn = next) {
+			next = fn->pfn_hnext;
+			free(fn);
+		}
+	free(pmcpl_fd_hash);
+	pmcpl_fd_hash = NULL;
+	pmcpl_fd_hashmask = 0;
+	pmcpl_fd_nnodes = 0;
+	pmcpl_fd_dirty = NULL;
+}
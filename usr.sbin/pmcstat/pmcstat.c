@@ -365,6 +365,7 @@ pmcstat_show_usage(void)
 	    "\t -F file\t write a system-wide callgraph (Kcachegrind format)"
 		" to \"file\"\n"
 	    "\t -G file\t write a system-wide callgraph to \"file\"\n"
+	    "\t -H file\t write system-wide folded stacks to \"file\"\n"
 	    "\t -I\t\t don't resolve leaf function name, show address instead\n"
 	    "\t -L\t\t list all counters available on this host\n"
 	    "\t -M file\t print executable/gmon file map to \"file\"\n"
@@ -511,7 +512,7 @@ main(int argc, char **argv)
 	CPU_COPY(&rootmask, &cpumask);
 
 	while ((option = getopt(argc, argv,
-	    "CD:EF:G:ILM:NO:P:R:S:TUWZa:c:def:gi:k:l:m:n:o:p:qr:s:t:u:vw:z:")) != -1)
+	    "CD:EF:G:H:ILM:NO:P:R:S:TUWZa:c:def:gi:k:l:m:n:o:p:qr:s:t:u:vw:z:")) != -1)
 		switch (option) {
 		case 'a':	/* Annotate + callgraph */
 			args.pa_flags |= FLAG_DO_ANNOTATE;
@@ -580,6 +581,12 @@ main(int argc, char **argv)
 			graphfilename = optarg;
 			break;
 
+		case 'H':	/* produce system-wide folded stacks */
+			args.pa_flags |= FLAG_DO_CALLGRAPHS;
+			args.pa_plugin = PMCSTAT_PL_FOLDED;
+			graphfilename = optarg;
+			break;
+
 		case 'g':	/* produce gprof compatible profiles */
 			args.pa_flags |= FLAG_DO_GPROF;
 			args.pa_pplugin = PMCSTAT_PL_CALLGRAPH;
@@ -1109,7 +1116,8 @@ main(int argc, char **argv)
 			args.pa_logfd = pipefd[WRITEPIPEFD];
 
 			args.pa_flags |= FLAG_HAS_PIPE;
-			if ((args.pa_flags & FLAG_DO_TOP) == 0)
+			if ((args.pa_flags & FLAG_DO_TOP) == 0 &&
+			    args.pa_plugin != PMCSTAT_PL_FOLDED)
 				args.pa_flags |= FLAG_DO_PRINT;
 			args.pa_logparser = pmclog_open(pipefd[READPIPEFD]);
 		}
@@ -1216,12 +1224,14 @@ main(int argc, char **argv)
 		err(EX_OSERR, "ERROR: Cannot register kevent for SIGCHLD");
 
 	/* 
-	 * Setup a timer if we have counting mode PMCs needing to be printed or
-	 * top mode plugin is active.
+	 * Setup a timer if we have counting mode PMCs needing to be printed,
+	 * top mode plugin is active or folded stacks are written live.
 	 */
 	if (((args.pa_flags & FLAG_HAS_COUNTING_PMCS) &&
 	     (args.pa_required & FLAG_HAS_OUTPUT_LOGFILE) == 0) ||
-	    (args.pa_flags & FLAG_DO_TOP)) {
+	    (args.pa_flags & FLAG_DO_TOP) ||
+	    (args.pa_plugin == PMCSTAT_PL_FOLDED &&
+	     (args.pa_flags & FLAG_HAS_PIPE))) {
 		EV_SET(&kev, 0, EVFILT_TIMER, EV_ADD, 0,
 		    args.pa_interval * 1000, NULL);
 
@@ -1394,7 +1404,8 @@ main(int argc, char **argv)
 				break;
 			}
 			/* print out counting PMCs */
-			if ((args.pa_flags & FLAG_DO_TOP) &&
+			if (((args.pa_flags & FLAG_DO_TOP) ||
+			     args.pa_plugin == PMCSTAT_PL_FOLDED) &&
 			    (args.pa_flags & FLAG_HAS_PIPE) &&
 			     pmc_flush_logfile() == 0)
 				do_read = 1;
@@ -1411,6 +1422,7 @@ main(int argc, char **argv)
 				    (args.pa_flags & FLAG_DO_PRINT) == 0)
 					(void) fprintf(args.pa_printfile, "\n");
 			}
+			pmcstat_interval_log();
 			if (args.pa_flags & FLAG_DO_TOP)
 				pmcstat_display_log();
 			do_print = 0;
@@ -62,6 +62,7 @@
 #define PMCSTAT_PL_ANNOTATE	3
 #define PMCSTAT_PL_CALLTREE	4
 #define PMCSTAT_PL_ANNOTATE_CG	5
+#define PMCSTAT_PL_FOLDED	6
 
 #define PMCSTAT_TOP_DELTA 	0
 #define PMCSTAT_TOP_ACCUM	1
@@ -82,6 +83,7 @@ void	pmcstat_start_pmcs(void);
 int	pmcstat_process_log(void);
 int	pmcstat_keypress_log(void);
 void	pmcstat_display_log(void);
+void	pmcstat_interval_log(void);
 void	pmcstat_pluginconfigure_log(char *_opt);
 void	pmcstat_topexit(void);
 
@@ -151,6 +151,7 @@ struct pmcstat_process *pmcstat_kernproc; /* kernel 'process' */
 #include "pmcpl_annotate.h"
 #include "pmcpl_annotate_cg.h"
 #include "pmcpl_calltree.h"
+#include "pmcpl_folded.h"
 
 static struct pmc_plugins plugins[] = {
 	{
@@ -189,6 +190,14 @@ static struct pmc_plugins plugins[] = {
 		.pl_name		= "annotate_cg",
 		.pl_process		= pmcpl_annotate_cg_process
 	},
+	{
+		.pl_name		= "folded",
+		.pl_init		= pmcpl_fd_init,
+		.pl_shutdown		= pmcpl_fd_shutdown,
+		.pl_process		= pmcpl_fd_process,
+		.pl_topdisplay		= pmcpl_fd_topdisplay,
+		.pl_interval		= pmcpl_fd_interval
+	},
 
 	{
 		.pl_name		= NULL
@@ -707,6 +716,18 @@ pmcstat_display_log(void)
 	}
 }
 
+/*
+ * Periodic output of plugins streaming their results.
+ */
+
+void
+pmcstat_interval_log(void)
+{
+
+	if (plugins[args.pa_plugin].pl_interval != NULL)
+		plugins[args.pa_plugin].pl_interval();
+}
+
 /*
  * Configure a plugins.
  */
@@ -257,6 +257,9 @@ struct filed {
 	size_t	f_prevlen;			/* length of f_prevline */
 	int	f_prevcount;			/* repetition cnt of prevline */
 	u_int	f_repeatcount;			/* number of "repeated" msgs */
+	u_long	f_written;			/* messages written */
+	u_long	f_dropped;			/* messages lost to a busy or
+						   unreachable destination */
 	int	f_flags;			/* file-specific flags */
 #define	FFLAG_SYNC 0x01
 #define	FFLAG_NEEDSYNC	0x02
@@ -371,6 +374,7 @@ static int	sigpipe[2];	/* Pipe to catch a signal during select(). */
 static bool	RFC3164OutputFormat = true; /* Use legacy format by default. */
 
 static volatile sig_atomic_t MarkSet, WantDie, WantInitialize, WantReapchild;
+static volatile sig_atomic_t WantStats;
 
 struct iovlist;
 
@@ -394,6 +398,7 @@ static void	fprintlog_write(struct filed *, struct iovlist *, int);
 static void	fprintlog_successive(struct filed *, int);
 static void	init(int);
 static void	logerror(const char *);
+static void	logstats(void);
 static void	logmsg(int, const struct logtime *, const char *, const char *,
     const char *, const char *, const char *, const char *, int);
 static void	log_deadchild(pid_t, int, const char *);
@@ -727,6 +732,7 @@ main(int argc, char *argv[])
 	(void)signal(SIGQUIT, Debug ? dodie : SIG_IGN);
 	(void)signal(SIGHUP, sighandler);
 	(void)signal(SIGCHLD, sighandler);
+	(void)signal(SIGINFO, sighandler);
 	(void)signal(SIGALRM, domark);
 	(void)signal(SIGPIPE, SIG_IGN);	/* We'll catch EPIPE instead. */
 	(void)alarm(TIMERINTVL);
@@ -755,6 +761,8 @@ main(int argc, char *argv[])
 			init(WantInitialize);
 		if (WantReapchild)
 			reapchild(WantReapchild);
+		if (WantStats)
+			logstats();
 		if (MarkSet)
 			markit();
 		if (WantDie) {
@@ -821,6 +829,9 @@ socklist_recv_signal(struct socklist *sl __unused)
 		case SIGCHLD:
 			WantReapchild = 1;
 			break;
+		case SIGINFO:
+			WantStats = 1;
+			break;
 		}
 	}
 	return (0);
@@ -1682,7 +1693,9 @@ fprintlog_write(struct filed *f, struct iovlist *il, int flags)
 				break;
 		}
 		dprintf("lsent/totalsize: %zd/%zu\n", lsent, il->totalsize);
-		if (lsent != (ssize_t)il->totalsize) {
+		if (lsent == (ssize_t)il->totalsize)
+			f->f_written++;
+		else {
 			int e = errno;
 			logerror("sendto");
 			errno = e;
@@ -1693,6 +1706,7 @@ fprintlog_write(struct filed *f, struct iovlist *il, int flags)
 			case EHOSTUNREACH:
 			case EHOSTDOWN:
 			case EADDRNOTAVAIL:
+				f->f_dropped++;
 				break;
 			/* case EBADF: */
 			/* case EACCES: */
@@ -1724,10 +1738,14 @@ fprintlog_write(struct filed *f, struct iovlist *il, int flags)
 				close_filed(f);
 				errno = e;
 				logerror(f->fu_fname);
+			} else
+				f->f_dropped++;
+		} else {
+			f->f_written++;
+			if ((flags & SYNC_FILE) && (f->f_flags & FFLAG_SYNC)) {
+				f->f_flags |= FFLAG_NEEDSYNC;
+				needdofsync = 1;
 			}
-		} else if ((flags & SYNC_FILE) && (f->f_flags & FFLAG_SYNC)) {
-			f->f_flags |= FFLAG_NEEDSYNC;
-			needdofsync = 1;
 		}
 		break;
 
@@ -1744,11 +1762,21 @@ fprintlog_write(struct filed *f, struct iovlist *il, int flags)
 		if (writev(f->f_file, il->iov, il->iovcnt) < 0) {
 			int e = errno;
 
+			/*
+			 * The pipe is non-blocking so that a slow reader
+			 * cannot stall syslogd.  When it is full, drop the
+			 * message instead of restarting the command.
+			 */
+			if (e == EAGAIN) {
+				f->f_dropped++;
+				break;
+			}
 			deadq_enter(f->fu_pipe_pid, f->fu_pipe_pname);
 			close_filed(f);
 			errno = e;
 			logerror(f->fu_pipe_pname);
-		}
+		} else
+			f->f_written++;
 		break;
 
 	case F_CONSOLE:
@@ -2142,6 +2170,44 @@ logerror(const char *msg)
 	recursed--;
 }
 
+/*
+ * Log how many messages each file, pipe and remote host has taken and
+ * how many were lost.  Triggered by SIGINFO.
+ */
+static void
+logstats(void)
+{
+	struct filed *f;
+	const char *prefix, *name;
+	char buf[MAXLINE];
+
+	WantStats = 0;
+	STAILQ_FOREACH(f, &fhead, next) {
+		switch (f->f_type) {
+		case F_FILE:
+			prefix = "";
+			name = f->fu_fname;
+			break;
+		case F_PIPE:
+			prefix = "|";
+			name = f->fu_pipe_pname;
+			break;
+		case F_FORW:
+			prefix = "@";
+			name = f->fu_forw_hname;
+			break;
+		default:
+			continue;
+		}
+		(void)snprintf(buf, sizeof(buf),
+		    "%s%s: %lu messages written, %lu dropped", prefix, name,
+		    f->f_written, f->f_dropped);
+		dprintf("%s\n", buf);
+		logmsg(LOG_SYSLOG|LOG_INFO, NULL, LocalHostName, "syslogd",
+		    NULL, NULL, NULL, buf, 0);
+	}
+}
+
 static void
 die(int signo)
 {